@@ -21,6 +21,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef ARCHIVE_H
 #define ARCHIVE_H
 
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
@@ -143,6 +144,10 @@ public:  // Declarations
   using FileChangeCallback = std::function<void(FileChangeType, std::wstring const&)>;
   using ErrorCallback      = std::function<void(std::wstring const&)>;
 
+  // index, path and directory flag of an entry, returns false to stop the listing
+  using EntryCallback =
+      std::function<bool(std::size_t, std::wstring const&, bool isDirectory)>;
+
   /**
    *
    */
@@ -210,9 +215,27 @@ public:
 
   /**
    * @return the list of files in the currently opened archive.
+   *
+   * The list is read from the archive on the first call after open(), which can take
+   * a while for archives with many entries. Use forEachEntry() if only the paths are
+   * needed.
    */
   virtual const std::vector<FileData*>& getFileList() const = 0;
 
+  /**
+   * @brief List the entries of the currently opened archive one at a time.
+   *
+   * Only the path and the directory flag of each entry are read, and nothing is kept
+   * once the callback returns, so this is much cheaper than getFileList() for large
+   * archives. Indices are the same as in getFileList().
+   *
+   * @param callback Function called for each entry, in the order of the archive. The
+   * listing stops as soon as it returns false.
+   *
+   * @return false if no archive is open or the entries could not be read.
+   */
+  virtual bool forEachEntry(EntryCallback callback) const = 0;
+
   /**
    * @brief Extract the content of the archive.
    *
@@ -239,6 +262,17 @@ public:
    */
   virtual void cancel() = 0;
 
+  /**
+   * @brief Set the number of threads used to extract archives whose entries can be
+   * decompressed independently (zip, non-solid 7z or rar, ...).
+   *
+   * Solid or encrypted archives are always extracted by a single thread.
+   *
+   * @param threads Number of threads to use, values below 2 extract everything on
+   * a single thread.
+   */
+  virtual void setExtractThreadCount(std::size_t threads) = 0;
+
   // A bunch of useful overloads (with one or two callbacks):
   bool extract(std::wstring const& outputDirectory, ErrorCallback errorCallback)
   {
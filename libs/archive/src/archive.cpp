@@ -29,14 +29,22 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <algorithm>
 #include <map>
+#include <mutex>
+#include <numeric>
 #include <sstream>
 #include <stddef.h>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
 namespace PropID = NArchive::NHandlerPropID;
 
+static UInt64 sum(std::vector<UInt64> const& values)
+{
+  return std::accumulate(values.begin(), values.end(), UInt64(0));
+}
+
 class FileDataImpl : public FileData
 {
   friend class Archive;
@@ -96,7 +104,8 @@ public:
   virtual bool open(std::wstring const& archiveName,
                     PasswordCallback passwordCallback) override;
   virtual void close() override;
-  const std::vector<FileData*>& getFileList() const override { return m_FileList; }
+  const std::vector<FileData*>& getFileList() const override;
+  virtual bool forEachEntry(EntryCallback callback) const override;
   virtual bool extract(std::wstring const& outputDirectory,
                        ProgressCallback progressCallback,
                        FileChangeCallback fileChangeCallback,
@@ -104,9 +113,25 @@ public:
 
   virtual void cancel() override;
 
+  virtual void setExtractThreadCount(std::size_t threads) override
+  {
+    m_ExtractThreadCount = threads;
+  }
+
 private:
   void clearFileList();
-  void resetFileList();
+  void resetFileList() const;
+
+  // check if the given entries can be decompressed independently of each other
+  bool canExtractInParallel(std::vector<UInt32> const& indices) const;
+
+  // extract the given entries using one archive handler per thread, returns false
+  // if the handlers could not be opened, in which case nothing has been extracted
+  bool extractInParallel(std::wstring const& outputDirectory,
+                         std::vector<UInt32> const& indices, UInt64 totalSize,
+                         ProgressCallback progressCallback,
+                         FileChangeCallback fileChangeCallback,
+                         ErrorCallback errorCallback, HRESULT* result);
 
   HRESULT loadFormats();
 
@@ -135,10 +160,25 @@ private:
   CComPtr<IInArchive> m_ArchivePtr;
   CArchiveExtractCallback* m_ExtractCallback;
 
+  // the format the archive was opened with and the path to open it again from the
+  // extraction threads
+  CLSID m_ClassID;
+  std::filesystem::path m_ArchivePath;
+
+  std::size_t m_ExtractThreadCount;
+
+  // callbacks of the extraction threads, guarded since cancel() can be called from
+  // any thread
+  std::mutex m_CancelMutex;
+  std::vector<CComPtr<CArchiveExtractCallback>> m_ThreadCallbacks;
+
   LogCallback m_LogCallback;
   PasswordCallback m_PasswordCallback;
 
-  std::vector<FileData*> m_FileList;
+  // only read on the first call to getFileList(), the installers usually only need
+  // the paths which forEachEntry() gives without keeping anything around
+  mutable std::vector<FileData*> m_FileList;
+  mutable bool m_FileListRead;
 
   std::wstring m_Password;
 
@@ -270,7 +310,8 @@ HRESULT ArchiveImpl::loadFormats()
 
 ArchiveImpl::ArchiveImpl()
     : m_Valid(false), m_LastError(Error::ERROR_NONE), m_Library("dlls/7zip.dll"),
-      m_PasswordCallback{}
+      m_ExtractCallback(nullptr), m_ClassID{}, m_ExtractThreadCount(1),
+      m_PasswordCallback{}, m_FileListRead(false)
 {
   // Reset the log callback:
   setLogCallback({});
@@ -363,6 +404,7 @@ bool ArchiveImpl::open(std::wstring const& archiveName,
       file->Seek(0, STREAM_SEEK_SET, nullptr);
       std::string signature = std::string(buff.data(), act);
       if (signatureInfo.first == std::string(buff.data(), signatureInfo.first.size())) {
+        m_ClassID = signatureInfo.second.m_ClassID;
         if (m_CreateObjectFunc(&signatureInfo.second.m_ClassID, &IID_IInArchive,
                                (void**)&m_ArchivePtr) != S_OK) {
           m_LastError = Error::ERROR_LIBRARY_ERROR;
@@ -425,6 +467,7 @@ bool ArchiveImpl::open(std::wstring const& archiveName,
           // OK, we have some potential formats. If there is only one, try it now. If
           // there are multiple formats, we'll try by signature lookup first.
           for (ArchiveFormatInfo format : *formats) {
+            m_ClassID = format.m_ClassID;
             if (m_CreateObjectFunc(&format.m_ClassID, &IID_IInArchive,
                                    (void**)&m_ArchivePtr) != S_OK) {
               m_LastError = Error::ERROR_LIBRARY_ERROR;
@@ -471,6 +514,7 @@ bool ArchiveImpl::open(std::wstring const& archiveName,
         LogLevel::Debug,
         L"Attempting to open the file with the remaining formats as a fallback...");
     for (auto format : formatList) {
+      m_ClassID = format.m_ClassID;
       if (m_CreateObjectFunc(&format.m_ClassID, &IID_IInArchive,
                              (void**)&m_ArchivePtr) != S_OK) {
         m_LastError = Error::ERROR_LIBRARY_ERROR;
@@ -493,7 +537,8 @@ bool ArchiveImpl::open(std::wstring const& archiveName,
     return false;
   }
 
-  m_Password = openCallbackPtr->GetPassword();
+  m_Password    = openCallbackPtr->GetPassword();
+  m_ArchivePath = filepath;
   /*
     UInt32 subFile = ULONG_MAX;
     {
@@ -517,9 +562,10 @@ bool ArchiveImpl::open(std::wstring const& archiveName,
       }
     }*/
 
-  m_LastError = Error::ERROR_NONE;
+  // the entries are read once they're asked for
+  clearFileList();
 
-  resetFileList();
+  m_LastError = Error::ERROR_NONE;
   return true;
 }
 
@@ -530,6 +576,7 @@ void ArchiveImpl::close()
   }
   clearFileList();
   m_ArchivePtr.Release();
+  m_ArchivePath.clear();
   m_PasswordCallback = {};
 }
 
@@ -540,20 +587,65 @@ void ArchiveImpl::clearFileList()
     delete *iter;
   }
   m_FileList.clear();
+  m_FileListRead = false;
 }
 
-void ArchiveImpl::resetFileList()
+void ArchiveImpl::resetFileList() const
 {
   UInt32 numItems = 0;
-  clearFileList();
-
   m_ArchivePtr->GetNumberOfItems(&numItems);
 
+  m_FileList.reserve(numItems);
   for (UInt32 i = 0; i < numItems; ++i) {
     m_FileList.push_back(new FileDataImpl(
         readProperty<std::wstring>(i, kpidPath), readProperty<UInt64>(i, kpidSize),
         readProperty<UInt64>(i, kpidCRC), readProperty<bool>(i, kpidIsDir)));
   }
+  m_FileListRead = true;
+}
+
+const std::vector<FileData*>& ArchiveImpl::getFileList() const
+{
+  if (!m_FileListRead && m_ArchivePtr != nullptr) {
+    resetFileList();
+  }
+  return m_FileList;
+}
+
+bool ArchiveImpl::forEachEntry(EntryCallback callback) const
+{
+  if (m_ArchivePtr == nullptr) {
+    return false;
+  }
+
+  // the list is already there, no need to go through the archive again
+  if (m_FileListRead) {
+    for (std::size_t i = 0; i < m_FileList.size(); ++i) {
+      if (!callback(i, m_FileList[i]->getArchiveFilePath(),
+                    m_FileList[i]->isDirectory())) {
+        break;
+      }
+    }
+    return true;
+  }
+
+  UInt32 numItems = 0;
+  if (m_ArchivePtr->GetNumberOfItems(&numItems) != S_OK) {
+    return false;
+  }
+
+  for (UInt32 i = 0; i < numItems; ++i) {
+    PropertyVariant path, isDir;
+    if (m_ArchivePtr->GetProperty(i, kpidPath, &path) != S_OK ||
+        m_ArchivePtr->GetProperty(i, kpidIsDir, &isDir) != S_OK) {
+      return false;
+    }
+    if (!callback(i, static_cast<std::wstring>(path), static_cast<bool>(isDir))) {
+      break;
+    }
+  }
+
+  return true;
 }
 
 bool ArchiveImpl::extract(std::wstring const& outputDirectory,
@@ -562,6 +654,8 @@ bool ArchiveImpl::extract(std::wstring const& outputDirectory,
                           ErrorCallback errorCallback)
 
 {
+  getFileList();
+
   // Retrieve the list of indices we want to extract:
   std::vector<UInt32> indices;
   UInt64 totalSize = 0;
@@ -573,13 +667,46 @@ bool ArchiveImpl::extract(std::wstring const& outputDirectory,
     }
   }
 
-  m_ExtractCallback = new CArchiveExtractCallback(
-      progressCallback, fileChangeCallback, errorCallback, m_PasswordCallback,
-      m_LogCallback, m_ArchivePtr, outputDirectory, &m_FileList[0], m_FileList.size(),
-      totalSize, &m_Password);
+  if (m_ExtractThreadCount > 1 && indices.size() > 1 &&
+      canExtractInParallel(indices)) {
+    HRESULT result;
+    if (extractInParallel(outputDirectory, indices, totalSize, progressCallback,
+                          fileChangeCallback, errorCallback, &result)) {
+      switch (result) {
+      case S_OK: {
+        // nop
+      } break;
+      case E_ABORT: {
+        m_LastError = Error::ERROR_EXTRACT_CANCELLED;
+      } break;
+      case E_OUTOFMEMORY: {
+        m_LastError = Error::ERROR_OUT_OF_MEMORY;
+      } break;
+      default: {
+        m_LastError = Error::ERROR_LIBRARY_ERROR;
+      } break;
+      }
+      return result == S_OK;
+    }
+  }
+
+  // Note: the reference keeps the callback alive until cancel() cannot reach it
+  // anymore, Extract would delete it otherwise
+  CComPtr<CArchiveExtractCallback> extractCallback;
+  {
+    std::scoped_lock lock(m_CancelMutex);
+    m_ExtractCallback = new CArchiveExtractCallback(
+        progressCallback, fileChangeCallback, errorCallback, m_PasswordCallback,
+        m_LogCallback, m_ArchivePtr, outputDirectory, &m_FileList[0],
+        m_FileList.size(), totalSize, &m_Password);
+    extractCallback = m_ExtractCallback;
+  }
   HRESULT result = m_ArchivePtr->Extract(
       indices.data(), static_cast<UInt32>(indices.size()), false, m_ExtractCallback);
-  // Note: m_ExtractCallBack is deleted by Extract
+  {
+    std::scoped_lock lock(m_CancelMutex);
+    m_ExtractCallback = nullptr;
+  }
   switch (result) {
   case S_OK: {
     // nop
@@ -598,9 +725,200 @@ bool ArchiveImpl::extract(std::wstring const& outputDirectory,
   return result == S_OK;
 }
 
+bool ArchiveImpl::canExtractInParallel(std::vector<UInt32> const& indices) const
+{
+  if (m_ArchivePath.empty()) {
+    return false;
+  }
+
+  // the entries of a solid archive can only be decoded in order
+  PropertyVariant solid;
+  if (m_ArchivePtr->GetArchiveProperty(kpidSolid, &solid) != S_OK) {
+    return false;
+  }
+  if (!solid.is_empty() && static_cast<bool>(solid)) {
+    return false;
+  }
+
+  // the threads cannot share a password prompt
+  for (UInt32 index : indices) {
+    PropertyVariant encrypted;
+    if (m_ArchivePtr->GetProperty(index, kpidEncrypted, &encrypted) != S_OK) {
+      return false;
+    }
+    if (!encrypted.is_empty() && static_cast<bool>(encrypted)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool ArchiveImpl::extractInParallel(std::wstring const& outputDirectory,
+                                    std::vector<UInt32> const& indices,
+                                    UInt64 totalSize, ProgressCallback progressCallback,
+                                    FileChangeCallback fileChangeCallback,
+                                    ErrorCallback errorCallback, HRESULT* result)
+{
+  const std::size_t nThreads = std::min(m_ExtractThreadCount, indices.size());
+
+  // split the entries in consecutive ranges of about the same size, so each handler
+  // reads its part of the archive front to back
+  std::vector<std::vector<UInt32>> ranges(nThreads);
+  std::vector<UInt64> rangeSizes(nThreads, 0);
+  {
+    UInt64 done = 0;
+    for (UInt32 index : indices) {
+      std::size_t range =
+          totalSize > 0 ? static_cast<std::size_t>(done * nThreads / totalSize) : 0;
+      range = std::min(range, nThreads - 1);
+
+      ranges[range].push_back(index);
+      rangeSizes[range] += m_FileList[index]->getSize();
+      done += m_FileList[index]->getSize();
+    }
+  }
+
+  // drop the ranges that got nothing when a few entries hold most of the data
+  for (std::size_t i = ranges.size(); i-- > 0;) {
+    if (ranges[i].empty()) {
+      ranges.erase(ranges.begin() + i);
+      rangeSizes.erase(rangeSizes.begin() + i);
+    }
+  }
+
+  // open one handler per range, all of them before extracting anything so a
+  // failure can still fall back to a single thread
+  std::vector<CComPtr<IInArchive>> archives;
+  for (std::size_t i = 0; i < ranges.size(); ++i) {
+    CComPtr<InputStream> file(new InputStream);
+    if (!file->Open(m_ArchivePath)) {
+      return false;
+    }
+
+    CComPtr<IInArchive> archive;
+    if (m_CreateObjectFunc(&m_ClassID, &IID_IInArchive, (void**)&archive) != S_OK) {
+      return false;
+    }
+
+    CComPtr<CArchiveOpenCallback> openCallback;
+    try {
+      openCallback = new CArchiveOpenCallback(
+          [this]() {
+            return m_Password;
+          },
+          m_LogCallback, m_ArchivePath);
+    } catch (std::runtime_error const&) {
+      return false;
+    }
+
+    if (archive->Open(file, 0, openCallback) != S_OK) {
+      m_LogCallback(LogLevel::Debug,
+                    std::format(L"Failed to open {} again for parallel extraction.",
+                                m_ArchiveName));
+      return false;
+    }
+
+    archives.push_back(archive);
+  }
+
+  m_LogCallback(LogLevel::Debug, std::format(L"Extracting {} entries using {} threads.",
+                                             indices.size(), archives.size()));
+
+  // the callbacks were written for a single extraction, so the threads take turns
+  // calling them and the progress is added up over all threads
+  std::mutex callbackMutex;
+  std::vector<UInt64> archiveCompleted(archives.size(), 0);
+  std::vector<UInt64> archiveTotal(archives.size(), 0);
+  std::vector<UInt64> extracted(archives.size(), 0);
+
+  std::vector<std::wstring> passwords(archives.size(), m_Password);
+  std::vector<HRESULT> results(archives.size(), S_OK);
+
+  {
+    std::scoped_lock lock(m_CancelMutex);
+    for (std::size_t i = 0; i < archives.size(); ++i) {
+      ProgressCallback threadProgress;
+      if (progressCallback) {
+        threadProgress = [&, i](ProgressType type, uint64_t current, uint64_t total) {
+          std::scoped_lock guard(callbackMutex);
+          if (type == ProgressType::ARCHIVE) {
+            archiveCompleted[i] = current;
+            archiveTotal[i]     = total;
+            progressCallback(type, sum(archiveCompleted), sum(archiveTotal));
+          } else {
+            extracted[i] = current;
+            progressCallback(type, sum(extracted), totalSize);
+          }
+        };
+      }
+
+      FileChangeCallback threadFileChange;
+      if (fileChangeCallback) {
+        threadFileChange = [&](FileChangeType type, std::wstring const& file) {
+          std::scoped_lock guard(callbackMutex);
+          fileChangeCallback(type, file);
+        };
+      }
+
+      ErrorCallback threadError;
+      if (errorCallback) {
+        threadError = [&](std::wstring const& message) {
+          std::scoped_lock guard(callbackMutex);
+          errorCallback(message);
+        };
+      }
+
+      m_ThreadCallbacks.emplace_back(new CArchiveExtractCallback(
+          threadProgress, threadFileChange, threadError, {}, m_LogCallback,
+          archives[i], outputDirectory, &m_FileList[0], m_FileList.size(),
+          rangeSizes[i], &passwords[i]));
+    }
+  }
+
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < archives.size(); ++i) {
+    threads.emplace_back([&, i]() {
+      results[i] = archives[i]->Extract(ranges[i].data(),
+                                        static_cast<UInt32>(ranges[i].size()), false,
+                                        m_ThreadCallbacks[i]);
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  {
+    std::scoped_lock lock(m_CancelMutex);
+    m_ThreadCallbacks.clear();
+  }
+
+  for (auto& archive : archives) {
+    archive->Close();
+  }
+
+  // a failing thread usually gets the others cancelled, so report its error rather
+  // than the cancellation
+  *result = S_OK;
+  for (HRESULT threadResult : results) {
+    if (threadResult != S_OK && (*result == S_OK || *result == E_ABORT)) {
+      *result = threadResult;
+    }
+  }
+
+  return true;
+}
+
 void ArchiveImpl::cancel()
 {
-  m_ExtractCallback->SetCanceled(true);
+  std::scoped_lock lock(m_CancelMutex);
+  if (m_ExtractCallback != nullptr) {
+    m_ExtractCallback->SetCanceled(true);
+  }
+  for (auto& callback : m_ThreadCallbacks) {
+    callback->SetCanceled(true);
+  }
 }
 
 std::unique_ptr<Archive> CreateArchive()
@@ -91,6 +91,10 @@ CArchiveExtractCallback::CArchiveExtractCallback(
 
 CArchiveExtractCallback::~CArchiveExtractCallback()
 {
+  if (!m_FileCloser.Wait()) {
+    m_LogCallback(Archive::LogLevel::Error, L"Failed to close some extracted files.");
+  }
+
 #ifdef INSTRUMENT_ARCHIVE
   m_LogCallback(Archive::LogLevel::Debug, m_Timers.GetStream.toString(L"GetStream"));
   m_LogCallback(Archive::LogLevel::Debug, m_Timers.SetOperationResult.SetMTime.toString(
@@ -231,13 +235,15 @@ STDMETHODIMP CArchiveExtractCallback::GetStream(UInt32 index,
         m_FullProcessedPaths.push_back(fullProcessedPath);
       }
 
-      m_OutputFileStream = new MultiOutputStream([this](UInt32 size, UInt64) {
-        m_ExtractedFileSize += size;
-        if (m_ProgressCallback) {
-          m_ProgressCallback(Archive::ProgressType::EXTRACTION, m_ExtractedFileSize,
-                             m_TotalFileSize);
-        }
-      });
+      m_OutputFileStream = new MultiOutputStream(
+          [this](UInt32 size, UInt64) {
+            m_ExtractedFileSize += size;
+            if (m_ProgressCallback) {
+              m_ProgressCallback(Archive::ProgressType::EXTRACTION,
+                                 m_ExtractedFileSize, m_TotalFileSize);
+            }
+          },
+          &m_FileCloser);
       CComPtr<MultiOutputStream> outStreamCom(m_OutputFileStream);
 
       if (!m_OutputFileStream->Open(m_FullProcessedPaths)) {
@@ -246,11 +252,11 @@ STDMETHODIMP CArchiveExtractCallback::GetStream(UInt32 index,
         return E_ABORT;
       }
 
-      UInt64 fileSize;
-      auto fileSizeFound = getOptionalProperty(index, kpidSize, &fileSize);
-      if (fileSizeFound && m_OutputFileStream->SetSize(fileSize) != S_OK) {
-        m_LogCallback(Archive::LogLevel::Error,
-                      std::format(L"SetSize() failed on {}.", m_FullProcessedPaths[0]));
+      // the size was read when the archive was opened, not all file systems can
+      // allocate ahead so this is not an error
+      if (!m_OutputFileStream->Reserve(m_FileData[index]->getSize())) {
+        m_LogCallback(Archive::LogLevel::Debug,
+                      std::format(L"Reserve() failed on {}.", m_FullProcessedPaths[0]));
       }
 
       // This is messy but I can't find another way of doing it. A simple
@@ -114,6 +114,9 @@ private:
   MultiOutputStream* m_OutputFileStream;
   CComPtr<MultiOutputStream> m_OutFileStreamCom;
 
+  // closes the extracted files while the next ones are written
+  FileCloser m_FileCloser;
+
   std::vector<std::filesystem::path> m_FullProcessedPaths;
 
   FileData* const* m_FileData;
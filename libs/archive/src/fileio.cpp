@@ -221,6 +221,14 @@ bool FileOut::SetEndOfFile() noexcept
   return BOOLToBool(::SetEndOfFile(m_Handle));
 }
 
+bool FileOut::Reserve(UInt64 length) noexcept
+{
+  FILE_ALLOCATION_INFO info;
+  info.AllocationSize.QuadPart = (LONGLONG)length;
+  return BOOLToBool(
+      ::SetFileInformationByHandle(m_Handle, FileAllocationInfo, &info, sizeof(info)));
+}
+
 bool FileOut::WritePart(const void* data, UInt32 size, UInt32& processedSize) noexcept
 {
   if (size > kChunkSizeMax)
@@ -431,6 +439,12 @@ bool FileOut::SetEndOfFile() noexcept
   return ftruncate(m_Fd, (off_t)pos) == 0;
 }
 
+bool FileOut::Reserve(UInt64 length) noexcept
+{
+  // not posix_fallocate(), which writes zeros when the file system can't allocate
+  return fallocate(m_Fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)length) == 0;
+}
+
 bool FileOut::WritePart(const void* data, UInt32 size, UInt32& processedSize) noexcept
 {
   if (size > kChunkSizeMax)
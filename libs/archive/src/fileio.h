@@ -275,6 +275,10 @@ public:  // Operations:
   bool SetLength(UInt64 length) noexcept;
   bool SetEndOfFile() noexcept;
 
+  // Allocate space for the given number of bytes without changing the length of the
+  // file, returns false if the file system does not support it.
+  bool Reserve(UInt64 length) noexcept;
+
 protected:  // Protected Operations:
   bool WritePart(const void* data, UInt32 size, UInt32& processedSize) noexcept;
 };
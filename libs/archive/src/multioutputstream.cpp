@@ -21,6 +21,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "multioutputstream.h"
 #include "compat.h"
 
+#include <algorithm>
+
 #ifdef _WIN32
 #include <fcntl.h>
 #include <io.h>
@@ -38,26 +40,149 @@ static inline HRESULT ConvertBoolToHRESULT(bool result)
   return HRESULT_FROM_WIN32(lastError);
 }
 
+//////////////////////////
+// FileCloser
+
+FileCloser::~FileCloser()
+{
+  Wait();
+
+  {
+    std::scoped_lock lock(m_Mutex);
+    m_Stopping = true;
+  }
+  m_Queued.notify_one();
+
+  if (m_Thread.joinable()) {
+    m_Thread.join();
+  }
+}
+
+void FileCloser::Close(std::vector<IO::FileOut>&& files)
+{
+  {
+    std::unique_lock lock(m_Mutex);
+    m_Closed.wait(lock, [this] {
+      return m_Pending < kMaxQueuedFiles;
+    });
+
+    for (auto& file : files) {
+      m_Files.push_back(std::move(file));
+    }
+    m_Pending += files.size();
+
+    if (!m_Thread.joinable()) {
+      m_Thread = std::thread(&FileCloser::Run, this);
+    }
+  }
+  files.clear();
+  m_Queued.notify_one();
+}
+
+bool FileCloser::Wait()
+{
+  std::unique_lock lock(m_Mutex);
+  m_Closed.wait(lock, [this] {
+    return m_Pending == 0;
+  });
+  return !m_Failed;
+}
+
+void FileCloser::Run()
+{
+  std::unique_lock lock(m_Mutex);
+  for (;;) {
+    m_Queued.wait(lock, [this] {
+      return m_Stopping || !m_Files.empty();
+    });
+    if (m_Files.empty()) {
+      return;
+    }
+
+    // close everything queued so far in one go
+    std::vector<IO::FileOut> files;
+    files.swap(m_Files);
+    lock.unlock();
+
+    bool ok = true;
+    for (auto& file : files) {
+      ok = file.Close() && ok;
+    }
+
+    lock.lock();
+    m_Failed = m_Failed || !ok;
+    m_Pending -= files.size();
+    m_Closed.notify_all();
+  }
+}
+
 //////////////////////////
 // MultiOutputStream
 
-MultiOutputStream::MultiOutputStream(WriteCallback callback) : m_WriteCallback(callback)
+MultiOutputStream::MultiOutputStream(WriteCallback callback, FileCloser* closer)
+    : m_WriteCallback(callback), m_Closer(closer), m_BufferCapacity(kBufferSize)
 {}
 
 MultiOutputStream::~MultiOutputStream() {}
 
 HRESULT MultiOutputStream::Close()
 {
+  bool result = Flush();
+  if (m_Closer != nullptr) {
+    m_Closer->Close(std::move(m_Files));
+    m_Files.clear();
+  } else {
+    for (auto& file : m_Files) {
+      result = file.Close() && result;
+    }
+  }
+  return ConvertBoolToHRESULT(result);
+}
+
+bool MultiOutputStream::Reserve(UInt64 size)
+{
+  m_BufferCapacity = static_cast<UInt32>(std::min<UInt64>(size, kBufferSize));
+
+  // smaller files are written at once from the buffer, allocating them first would
+  // only cost another call
+  if (size <= kBufferSize) {
+    return true;
+  }
+
+  bool result = true;
   for (auto& file : m_Files) {
-    file.Close();
+    result = file.Reserve(size) && result;
   }
-  return S_OK;
+  return result;
+}
+
+bool MultiOutputStream::Flush()
+{
+  if (m_Buffer.empty()) {
+    return true;
+  }
+  bool result = WriteFiles(m_Buffer.data(), static_cast<UInt32>(m_Buffer.size()));
+  m_Buffer.clear();
+  return result;
+}
+
+bool MultiOutputStream::WriteFiles(const void* data, UInt32 size)
+{
+  for (auto& file : m_Files) {
+    UInt32 realProcessedSize;
+    if (!file.Write(data, size, realProcessedSize) || realProcessedSize != size) {
+      return false;
+    }
+  }
+  return true;
 }
 
 bool MultiOutputStream::Open(std::vector<std::filesystem::path> const& filepaths)
 {
-  m_ProcessedSize = 0;
-  bool ok         = true;
+  m_ProcessedSize  = 0;
+  m_BufferCapacity = kBufferSize;
+  bool ok          = true;
+  m_Buffer.clear();
   m_Files.clear();
   for (auto& path : filepaths) {
     m_Files.emplace_back();
@@ -71,22 +196,33 @@ bool MultiOutputStream::Open(std::vector<std::filesystem::path> const& filepaths
 STDMETHODIMP MultiOutputStream::Write(const void* data, UInt32 size,
                                       UInt32* processedSize) throw()
 {
-  bool update_processed(true);
-  for (auto& file : m_Files) {
-    UInt32 realProcessedSize;
-    if (!file.Write(data, size, realProcessedSize)) {
+  if (processedSize != nullptr) {
+    *processedSize = 0;
+  }
+
+  if (m_Buffer.size() + size > m_BufferCapacity && !Flush()) {
+    return ConvertBoolToHRESULT(false);
+  }
+
+  if (size >= m_BufferCapacity) {
+    // nothing to gain from copying it
+    if (!WriteFiles(data, size)) {
       return ConvertBoolToHRESULT(false);
     }
-    if (update_processed) {
-      m_ProcessedSize += realProcessedSize;
-      if (m_WriteCallback) {
-        m_WriteCallback(realProcessedSize, m_ProcessedSize);
-      }
-      update_processed = false;
-    }
-    if (processedSize != nullptr) {
-      *processedSize = realProcessedSize;
+  } else {
+    if (m_Buffer.capacity() < m_BufferCapacity) {
+      m_Buffer.reserve(m_BufferCapacity);
     }
+    auto* bytes = static_cast<const unsigned char*>(data);
+    m_Buffer.insert(m_Buffer.end(), bytes, bytes + size);
+  }
+
+  m_ProcessedSize += size;
+  if (m_WriteCallback) {
+    m_WriteCallback(size, m_ProcessedSize);
+  }
+  if (processedSize != nullptr) {
+    *processedSize = size;
   }
   return S_OK;
 }
@@ -97,6 +233,10 @@ STDMETHODIMP MultiOutputStream::Seek(Int64 offset, UInt32 seekOrigin,
   if (seekOrigin >= 3)
     return STG_E_INVALIDFUNCTION;
 
+  if (!Flush()) {
+    return ConvertBoolToHRESULT(false);
+  }
+
   bool result = true;
   for (auto& file : m_Files) {
     UInt64 realNewPosition;
@@ -109,6 +249,10 @@ STDMETHODIMP MultiOutputStream::Seek(Int64 offset, UInt32 seekOrigin,
 
 STDMETHODIMP MultiOutputStream::SetSize(UInt64 newSize) throw()
 {
+  if (!Flush()) {
+    return E_FAIL;
+  }
+
   bool result = true;
   for (auto& file : m_Files) {
     UInt64 currentPos;
@@ -127,7 +271,7 @@ STDMETHODIMP MultiOutputStream::SetSize(UInt64 newSize) throw()
 
 HRESULT MultiOutputStream::GetSize(UInt64* size)
 {
-  if (m_Files.empty()) {
+  if (m_Files.empty() || !Flush()) {
     return ConvertBoolToHRESULT(false);
   }
   return ConvertBoolToHRESULT(m_Files[0].GetLength(*size));
@@ -135,6 +279,11 @@ HRESULT MultiOutputStream::GetSize(UInt64* size)
 
 bool MultiOutputStream::SetMTime(FILETIME const* mTime)
 {
+  // a later write would change the time again
+  if (!Flush()) {
+    return false;
+  }
+
   for (auto& file : m_Files) {
     file.SetMTime(mTime);
   }
@@ -21,9 +21,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef MULTIOUTPUTSTREAM_H
 #define MULTIOUTPUTSTREAM_H
 
+#include <condition_variable>
 #include <filesystem>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include <7zip/IStream.h>
@@ -31,11 +34,62 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "fileio.h"
 #include "unknown_impl.h"
 
+/** This class closes the files handed to it on a background thread, so the
+ * extraction does not wait for every close (which can be slow when something
+ * scans files as they're closed).
+ *
+ * The number of files waiting to be closed is bounded to stay away from the
+ * limit on open handles.
+ */
+class FileCloser
+{
+public:
+  FileCloser() = default;
+
+  /** Waits for all the files to be closed
+   */
+  ~FileCloser();
+
+  FileCloser(FileCloser const&)            = delete;
+  FileCloser& operator=(FileCloser const&) = delete;
+
+  /** Queue the given files to be closed, waits if too many files are queued
+   */
+  void Close(std::vector<IO::FileOut>&& files);
+
+  /** Waits for all the queued files to be closed
+   *
+   * @returns false if any of the files closed so far failed to close
+   */
+  bool Wait();
+
+private:
+  static constexpr std::size_t kMaxQueuedFiles = 128;
+
+  void Run();
+
+  std::mutex m_Mutex;
+  std::condition_variable m_Queued;
+  std::condition_variable m_Closed;
+
+  std::vector<IO::FileOut> m_Files;
+
+  // files queued or being closed
+  std::size_t m_Pending = 0;
+
+  bool m_Failed   = false;
+  bool m_Stopping = false;
+  std::thread m_Thread;
+};
+
 /** This class allows you to open and output to multiple file handles at a time.
  * It implements the ISequentalOutputStream interface and has some extra functions
  * which are used by the CArchiveExtractCallback class to basically open and
  * set the timestamp on all the files.
  *
+ * Writes are collected in a buffer and written out in large blocks, so the
+ * small writes done by some decoders are not each a call to the file system.
+ *
  * Note that the handling on errors could be better.
  */
 class MultiOutputStream : public IOutStream
@@ -49,7 +103,9 @@ public:
   // in total.
   using WriteCallback = std::function<void(UInt32, UInt64)>;
 
-  MultiOutputStream(WriteCallback callback = {});
+  /** @param closer If set, the files are closed by it instead of in Close()
+   */
+  MultiOutputStream(WriteCallback callback = {}, FileCloser* closer = nullptr);
 
   virtual ~MultiOutputStream();
 
@@ -65,6 +121,13 @@ public:
    */
   HRESULT Close();
 
+  /** Allocates space for the given size in the files and sizes the write buffer
+   * for it. This is only an hint, the files still end where the writes end.
+   *
+   * @returns true if the space was allocated in all files
+   */
+  bool Reserve(UInt64 size);
+
   /** Sets the modification time on the open files
    *
    * @returns true if all files had the time set succesfully, false otherwise
@@ -88,7 +151,21 @@ public:
   HRESULT GetSize(UInt64* size);
 
 private:
+  // Size of the write buffer, files smaller than this are written at once and
+  // larger files are allocated when reserved.
+  static constexpr UInt32 kBufferSize = 1 << 20;
+
+  // Write the buffered data to the files.
+  bool Flush();
+
+  // Write the given data to all the files.
+  bool WriteFiles(const void* data, UInt32 size);
+
   WriteCallback m_WriteCallback;
+  FileCloser* m_Closer;
+
+  std::vector<unsigned char> m_Buffer;
+  UInt32 m_BufferCapacity;
 
   /** This is the amount of data written to *any one* file.
    *
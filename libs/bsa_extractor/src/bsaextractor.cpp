@@ -16,6 +16,7 @@
 #include <QtPlugin>
 
 #include <functional>
+#include <future>
 
 using namespace MOBase;
 
@@ -103,12 +104,17 @@ void BsaExtractor::modInstalledHandler(IModInterface *mod)
                        QDialogButtonBox::Yes | QDialogButtonBox::No, QDialogButtonBox::No) == QDialogButtonBox::Yes);
     foreach (QFileInfo archiveInfo, archives) {
       BSA::Archive archive;
-      BSA::EErrorCode result = archive.read(archiveInfo.absoluteFilePath().toLocal8Bit().constData(), true);
+      BSA::EErrorCode result = archive.read(archiveInfo.absoluteFilePath().toLocal8Bit().constData(), false);
       if ((result != BSA::ERROR_NONE) && (result != BSA::ERROR_INVALIDHASHES)) {
         reportError(tr("failed to read %1: %2").arg(archiveInfo.fileName()).arg(result));
         return;
       }
 
+      // the names are checked while the files are extracted
+      auto hashes = std::async(std::launch::async, [&archive] {
+        return archive.verifyHashes();
+      });
+
       QProgressDialog progress(nullptr);
       progress.setMaximum(100);
       progress.setValue(0);
@@ -120,7 +126,8 @@ void BsaExtractor::modInstalledHandler(IModInterface *mod)
                          },
                          false);
 
-      if (result == BSA::ERROR_INVALIDHASHES) {
+      if ((result == BSA::ERROR_INVALIDHASHES) ||
+          (hashes.get() == BSA::ERROR_INVALIDHASHES)) {
         reportError(tr("This archive contains invalid hashes. Some files may be broken."));
       }
 
@@ -17,6 +17,11 @@ typedef struct {
 typedef void (*BsaProgressCallback)(uint32_t done, uint32_t total,
                                     const char *current_path);
 
+/* Receives the contents of one extracted file, return 0 to stop the extraction.
+ * Called from several threads at once, in no particular order. */
+typedef int (*BsaDataCallback)(void *user_data, const char *path,
+                               const uint8_t *data, size_t size);
+
 /* Returns list of paths in archive. On error, error is non-null and must be freed with
  * bsa_ffi_string_list_free(). */
 BsaFfiStringList bsa_ffi_list_files(const char *archive_path);
@@ -27,6 +32,32 @@ void bsa_ffi_string_list_free(BsaFfiStringList list);
 char *bsa_ffi_extract_all(const char *archive_path, const char *output_dir,
                           BsaProgressCallback progress_cb, const int *cancel_flag);
 
+/* Extracts the files at `paths` (as returned by bsa_ffi_list_files, case-insensitive)
+ * into output_dir in parallel. Paths that aren't in the archive are skipped,
+ * `extracted` (may be NULL) receives the number of files written.
+ * Returns NULL on success, else an allocated error string. */
+char *bsa_ffi_extract_files(const char *archive_path, const char *const *paths,
+                            size_t path_count, const char *output_dir,
+                            BsaProgressCallback progress_cb, const int *cancel_flag,
+                            size_t *extracted);
+
+/* Like bsa_ffi_extract_files(), but hands the contents of every file to data_cb
+ * instead of writing them. `data` is only valid during the call. */
+char *bsa_ffi_extract_files_cb(const char *archive_path, const char *const *paths,
+                               size_t path_count, BsaDataCallback data_cb,
+                               void *user_data, const int *cancel_flag,
+                               size_t *extracted);
+
+/* Extracts the texture at `path` without its mips larger than `mip` and hands it to
+ * data_cb as a DDS file, once, on the calling thread. BA2 textures are stored in
+ * chunks of mips and only the chunks from the one holding `mip` on are read;
+ * `first_mip` (may be NULL) receives which mip of the texture the largest one of
+ * the DDS file is. Cubemaps and files of other archives are extracted in full.
+ * Returns NULL on success, else an allocated error string. */
+char *bsa_ffi_extract_texture_mips(const char *archive_path, const char *path,
+                                   uint16_t mip, BsaDataCallback data_cb,
+                                   void *user_data, uint16_t *first_mip);
+
 /* game_id uses CLI ids from GameVersion::cli_name():
  * morrowind, oblivion, fo3, fonv, skyrimle, skyrimse,
  * fo4-fo76, fo4ng-v7, fo4ng-v8, starfield-v2, starfield-v3
@@ -45,6 +76,15 @@ char *bsa_ffi_pack_dir_filtered(const char *input_dir, const char *output_archiv
                                 BsaProgressCallback progress_cb,
                                 const int *cancel_flag);
 
+/* Like bsa_ffi_pack_dir_filtered(), but if output_archive already exists, its
+ * entries whose contents match the file in input_dir are copied over without
+ * compressing them again. An archive that was written for another game or
+ * format is ignored and everything is compressed. */
+char *bsa_ffi_repack_dir_filtered(const char *input_dir, const char *output_archive,
+                                  const char *game_id, int include_mode,
+                                  BsaProgressCallback progress_cb,
+                                  const int *cancel_flag);
+
 void bsa_ffi_string_free(char *s);
 
 #ifdef __cplusplus
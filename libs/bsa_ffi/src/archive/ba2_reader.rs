@@ -3,7 +3,7 @@
 //! Provides read support for FO4 format BA2 files (Fallout 4, Fallout 76, Starfield).
 
 use anyhow::{bail, Context, Result};
-use ba2::fo4::{Archive, File as Ba2File, FileWriteOptions};
+use ba2::fo4::{Archive, Chunk, DX10Header, File as Ba2File, FileHeader, FileWriteOptions};
 use ba2::prelude::*;
 use ba2::ByteSlice;
 use rayon::prelude::*;
@@ -36,14 +36,8 @@ pub fn list_files(ba2_path: &Path) -> Result<Vec<Ba2FileEntry>> {
     Ok(files)
 }
 
-/// Extract a single file from a BA2 archive
-#[allow(dead_code)]
-pub fn extract_file(ba2_path: &Path, file_path: &str) -> Result<Vec<u8>> {
-    let (archive, options): (Archive, _) = Archive::read(ba2_path)
-        .with_context(|| format!("Failed to open BA2: {}", ba2_path.display()))?;
-
-    let write_options: FileWriteOptions = options.into();
-
+/// Find `file_path` in a BA2 archive, with either slash convention and ignoring case
+fn find_file<'a, 'b>(archive: &'a Archive<'b>, file_path: &str) -> Result<&'a Ba2File<'b>> {
     // Normalize path for comparison (BA2 uses forward slashes typically)
     let normalized = file_path.replace('\\', "/").to_lowercase();
     let normalized_backslash = file_path.replace('/', "\\").to_lowercase();
@@ -57,12 +51,7 @@ pub fn extract_file(ba2_path: &Path, file_path: &str) -> Result<Vec<u8>> {
             || current_path.replace('\\', "/") == normalized
             || current_path.replace('/', "\\") == normalized_backslash
         {
-            // Write to memory buffer
-            let mut buffer = Cursor::new(Vec::new());
-            file.write(&mut buffer, &write_options)
-                .with_context(|| format!("Failed to extract file: {}", file_path))?;
-
-            return Ok(buffer.into_inner());
+            return Ok(file);
         }
     }
 
@@ -73,6 +62,89 @@ pub fn extract_file(ba2_path: &Path, file_path: &str) -> Result<Vec<u8>> {
     )
 }
 
+/// Extract a single file from a BA2 archive
+#[allow(dead_code)]
+pub fn extract_file(ba2_path: &Path, file_path: &str) -> Result<Vec<u8>> {
+    let (archive, options): (Archive, _) = Archive::read(ba2_path)
+        .with_context(|| format!("Failed to open BA2: {}", ba2_path.display()))?;
+
+    let write_options: FileWriteOptions = options.into();
+    let file = find_file(&archive, file_path)?;
+
+    // Write to memory buffer
+    let mut buffer = Cursor::new(Vec::new());
+    file.write(&mut buffer, &write_options)
+        .with_context(|| format!("Failed to extract file: {}", file_path))?;
+
+    Ok(buffer.into_inner())
+}
+
+/// Extract a texture from a BA2 archive without its mips larger than `mip`.
+/// Only the chunk holding `mip` and the ones after it are decompressed, the DDS
+/// header is adjusted so the first of them is the largest mip. Returns the data
+/// and which mip of the texture the first one is; cubemaps and files without mip
+/// ranges are extracted in full.
+pub fn extract_texture_mips(ba2_path: &Path, file_path: &str, mip: u16) -> Result<(Vec<u8>, u16)> {
+    let (archive, options): (Archive, _) = Archive::read(ba2_path)
+        .with_context(|| format!("Failed to open BA2: {}", ba2_path.display()))?;
+
+    let write_options: FileWriteOptions = options.into();
+    let file = find_file(&archive, file_path)?;
+
+    // faces of a cubemap are stored one after the other, a chunk doesn't hold a mip
+    // of all of them
+    let first = match &file.header {
+        FileHeader::DX10(dx10) if dx10.flags == 0 => file
+            .iter()
+            .position(|chunk| chunk.mips.as_ref().is_some_and(|mips| *mips.end() >= mip))
+            .unwrap_or(file.len().saturating_sub(1)),
+        _ => 0,
+    };
+
+    let first_mip = file
+        .iter()
+        .nth(first)
+        .and_then(|chunk| chunk.mips.as_ref())
+        .map_or(0, |mips| *mips.start());
+
+    let mut buffer = Cursor::new(Vec::new());
+    if first == 0 || first_mip == 0 {
+        file.write(&mut buffer, &write_options)
+            .with_context(|| format!("Failed to extract file: {}", file_path))?;
+        return Ok((buffer.into_inner(), 0));
+    }
+
+    let chunks = file.iter().skip(first).map(|chunk| {
+        let bytes = chunk.as_bytes();
+        let mut result = match chunk.decompressed_len() {
+            Some(len) => Chunk::from_compressed(bytes, len),
+            None => Chunk::from_decompressed(bytes),
+        };
+        result.mips = chunk
+            .mips
+            .as_ref()
+            .map(|mips| (mips.start() - first_mip)..=(mips.end() - first_mip));
+        result
+    });
+
+    let mut partial: Ba2File = chunks.collect();
+    partial.header = match &file.header {
+        FileHeader::DX10(dx10) => FileHeader::DX10(DX10Header {
+            width: (dx10.width >> first_mip).max(1),
+            height: (dx10.height >> first_mip).max(1),
+            mip_count: dx10.mip_count.saturating_sub(first_mip as u8).max(1),
+            ..*dx10
+        }),
+        header => header.clone(),
+    };
+
+    partial
+        .write(&mut buffer, &write_options)
+        .with_context(|| format!("Failed to extract file: {}", file_path))?;
+
+    Ok((buffer.into_inner(), first_mip))
+}
+
 /// Extract multiple files from a BA2 archive in parallel.
 /// Opens the archive once, collects matching entries, then decompresses
 /// and writes them in parallel using rayon.
@@ -5,18 +5,23 @@
 use anyhow::{bail, Context, Result};
 use ba2::fo4::{
     Archive, ArchiveKey, ArchiveOptionsBuilder, Chunk, ChunkCompressionOptions,
-    CompressionFormat as Ba2CrateCompression, CompressionLevel, File as Ba2File,
-    FileReadOptionsBuilder, Format, Version,
+    CompressionFormat as Ba2CrateCompression, CompressionLevel, File as Ba2File, FileHeader,
+    FileReadOptions, FileReadOptionsBuilder, FileWriteOptions, Format, Version,
 };
 use ba2::prelude::*;
 use ba2::{CompressionResult, Copied};
 use rayon::prelude::*;
+use std::borrow::Cow;
 use std::collections::HashMap;
 use std::fs;
-use std::io::BufWriter;
-use std::path::Path;
+use std::io::Cursor;
+use std::ops::RangeInclusive;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicUsize, Ordering};
 use tracing::info;
 
+use super::stream::{batches, write_replacing, PackSource, SpillFile, SpilledData};
+
 /// BA2 archive version
 #[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
 pub enum Ba2Version {
@@ -68,10 +73,22 @@ pub enum Ba2Format {
     DX10,
 }
 
+/// A chunk staged in the spill file
+struct StagedChunk {
+    data: SpilledData,
+    mips: Option<RangeInclusive<u16>>,
+}
+
+/// A file staged in the spill file, with the header of the file it was read as
+struct StagedFile {
+    header: FileHeader,
+    chunks: Vec<StagedChunk>,
+}
+
 /// Builder for creating BA2 archives
 pub struct Ba2Builder {
-    /// Files organized by path -> data
-    files: HashMap<String, Vec<u8>>,
+    /// Files organized by path -> source
+    files: HashMap<String, PackSource>,
     /// Archive format (General or DX10)
     format: Ba2Format,
     /// Compression format
@@ -80,6 +97,8 @@ pub struct Ba2Builder {
     strings: bool,
     /// Archive version
     version: Ba2Version,
+    /// Archive whose unchanged files are copied instead of compressed again
+    previous: Option<PathBuf>,
 }
 
 impl Ba2Builder {
@@ -90,6 +109,7 @@ impl Ba2Builder {
             compression: Ba2CompressionFormat::Zlib,
             strings: true,
             version: Ba2Version::default(),
+            previous: None,
         }
     }
 
@@ -123,6 +143,7 @@ impl Ba2Builder {
             compression,
             strings: true,
             version: Ba2Version::default(),
+            previous: None,
         }
     }
 
@@ -151,12 +172,30 @@ impl Ba2Builder {
         self
     }
 
+    /// Reuse the compressed chunks of files in `path` that are identical to the ones
+    /// being added, see `BsaBuilder::reuse_from()`
+    pub fn reuse_from(mut self, path: &Path) -> Self {
+        self.previous = Some(path.to_path_buf());
+        self
+    }
+
     /// Add a file to the archive
+    #[allow(dead_code)]
     pub fn add_file(&mut self, path: &str, data: Vec<u8>) {
+        self.add_source(path, PackSource::Memory(data));
+    }
+
+    /// Add a file on disk to the archive, it's only read while the archive is built
+    pub fn add_file_from_path(&mut self, path: &str, source: &Path) -> Result<()> {
+        self.add_source(path, PackSource::from_path(source)?);
+        Ok(())
+    }
+
+    fn add_source(&mut self, path: &str, source: PackSource) {
         // Normalize: forward slashes, strip leading slash
         let normalized = path.replace('\\', "/");
         let normalized = normalized.trim_start_matches('/').to_string();
-        self.files.insert(normalized, data);
+        self.files.insert(normalized, source);
     }
 
     /// Get number of files
@@ -169,17 +208,22 @@ impl Ba2Builder {
         self.files.is_empty()
     }
 
-    /// Build and write the BA2 to disk with progress callback
+    /// Build and write the BA2 to disk with progress callback, returning an error from
+    /// the callback stops the build.
+    ///
+    /// Like `BsaBuilder::build_with_progress()`, files are compressed one bounded batch
+    /// at a time and staged in a spill file, so memory use doesn't grow with the size
+    /// of the archive.
     pub fn build_with_progress<F>(self, output_path: &Path, progress: F) -> Result<()>
     where
-        F: Fn(usize, usize, &str) + Send + Sync,
+        F: Fn(usize, usize, &str) -> Result<()> + Send + Sync,
     {
         if self.is_empty() {
             bail!("Cannot create empty BA2 archive");
         }
 
         let file_count = self.file_count();
-        let total_size: u64 = self.files.values().map(|data| data.len() as u64).sum();
+        let total_size: u64 = self.files.values().map(PackSource::len).sum();
 
         info!(
             "Building BA2: {} ({} files, {} MB, format {:?}, compression {:?})",
@@ -190,87 +234,10 @@ impl Ba2Builder {
             self.compression
         );
 
-        // For DX10 (texture) archives, we need special handling
-        if self.format == Ba2Format::DX10 {
-            return self.build_dx10_with_progress(output_path, progress);
-        }
-
-        // Build archive entries in parallel
-        let entries: Vec<(String, Vec<u8>)> = self.files.into_iter().collect();
-        let total = entries.len();
-        let processed_count = std::sync::atomic::AtomicUsize::new(0);
-        let compression = self.compression;
-
-        let archive_entries: Result<Vec<(ArchiveKey<'static>, Ba2File<'static>)>> = entries
-            .par_iter()
-            .map(|(path, data)| {
-                // Create chunk from data
-                let chunk = Chunk::from_decompressed(data.clone().into_boxed_slice());
-
-                // Optionally compress the chunk
-                let chunk = if compression != Ba2CompressionFormat::None {
-                    let options = ChunkCompressionOptions::default();
-                    match chunk.compress(&options) {
-                        Ok(compressed) => compressed,
-                        Err(_) => chunk, // Fall back to uncompressed if compression fails
-                    }
-                } else {
-                    chunk
-                };
-
-                // Create file from chunk
-                let file: Ba2File = [chunk].into_iter().collect();
-
-                // Create key from path
-                let key: ArchiveKey = path.as_bytes().into();
-
-                let current =
-                    processed_count.fetch_add(1, std::sync::atomic::Ordering::Relaxed) + 1;
-                progress(current, total, path);
-
-                Ok((key, file))
-            })
-            .collect();
-
-        let archive_entries = archive_entries?;
-
-        // Build archive from entries
-        let archive: Archive = archive_entries.into_iter().collect();
-
-        let options = ArchiveOptionsBuilder::default()
-            .version(self.version.to_crate_version())
-            .strings(self.strings)
-            .build();
-
-        // Create parent directory
-        if let Some(parent) = output_path.parent() {
-            fs::create_dir_all(parent)?;
-        }
-
-        // Write archive
-        let file = fs::File::create(output_path)
-            .with_context(|| format!("Failed to create BA2: {}", output_path.display()))?;
-        let mut writer = BufWriter::new(file);
-
-        archive
-            .write(&mut writer, &options)
-            .with_context(|| format!("Failed to write BA2: {}", output_path.display()))?;
-
-        info!("Created BA2: {}", output_path.display());
-        Ok(())
-    }
-
-    /// Build a DX10 (texture) archive with progress callback
-    fn build_dx10_with_progress<F>(self, output_path: &Path, progress: F) -> Result<()>
-    where
-        F: Fn(usize, usize, &str) + Send + Sync,
-    {
         let compress = self.compression != Ba2CompressionFormat::None;
-        let entries: Vec<(String, Vec<u8>)> = self.files.into_iter().collect();
-        let total = entries.len();
-        let processed_count = std::sync::atomic::AtomicUsize::new(0);
+        let dx10 = self.format == Ba2Format::DX10;
 
-        // Build read options for DX10 format
+        // Build read options for DX10 format, textures are split into chunks by mip
         let read_options = FileReadOptionsBuilder::new()
             .format(Format::DX10)
             .compression_format(Ba2CrateCompression::Zip)
@@ -282,53 +249,244 @@ impl Ba2Builder {
             })
             .build();
 
-        let archive_entries: Result<Vec<(ArchiveKey<'static>, Ba2File<'static>)>> = entries
-            .par_iter()
-            .map(|(path, data)| {
-                let file = Ba2File::read(Copied(data), &read_options)
-                    .with_context(|| format!("Failed to parse DDS texture: {}", path))?;
-
-                let key: ArchiveKey = path.as_bytes().into();
+        let entries: Vec<(String, PackSource)> = self.files.into_iter().collect();
+        let total = entries.len();
 
-                let current =
-                    processed_count.fetch_add(1, std::sync::atomic::Ordering::Relaxed) + 1;
-                progress(current, total, path);
+        if let Some(parent) = output_path.parent() {
+            fs::create_dir_all(parent)?;
+        }
 
-                Ok((key, file))
+        let mut spill = SpillFile::create(output_path)?;
+        let mut staged: Vec<StagedFile> = Vec::with_capacity(total);
+
+        let format = if dx10 { Format::DX10 } else { Format::GNRL };
+        let previous = self
+            .previous
+            .as_deref()
+            .and_then(|path| open_previous(path, self.version.to_crate_version(), format));
+        let reusable: HashMap<String, &Ba2File> = previous
+            .iter()
+            .flat_map(|(archive, _)| archive.iter())
+            .map(|(key, file)| {
+                let path = String::from_utf8_lossy(key.name().as_bytes());
+                (entry_key(&path), file)
             })
             .collect();
+        let reused = AtomicUsize::new(0);
 
-        let archive_entries = archive_entries?;
-        let archive: Archive = archive_entries.into_iter().collect();
-
-        let options = ArchiveOptionsBuilder::default()
-            .version(self.version.to_crate_version())
+        // textures are compared after they went through the same parsing as new files
+        let compare_options = FileReadOptionsBuilder::new()
             .format(Format::DX10)
-            .compression_format(Ba2CrateCompression::Zip)
-            .strings(self.strings)
+            .compression_result(CompressionResult::Decompressed)
             .build();
 
-        if let Some(parent) = output_path.parent() {
-            fs::create_dir_all(parent)?;
+        for batch in batches(entries.iter().map(|(_, source)| source.len())) {
+            // Compress the batch in parallel, then append it in order
+            let files: Result<Vec<Cow<Ba2File>>> = entries[batch.clone()]
+                .par_iter()
+                .map(|(path, source)| {
+                    let data = source.load()?;
+
+                    if let (Some(file), Some((_, write_options))) =
+                        (reusable.get(&entry_key(path)), &previous)
+                    {
+                        let options = dx10.then_some(&compare_options);
+                        if unchanged(file, &data, compress, options, write_options) {
+                            reused.fetch_add(1, Ordering::Relaxed);
+                            return Ok(Cow::Borrowed(*file));
+                        }
+                    }
+
+                    if dx10 {
+                        return Ba2File::read(Copied(&data[..]), &read_options)
+                            .map(Cow::Owned)
+                            .with_context(|| format!("Failed to parse DDS texture: {}", path));
+                    }
+
+                    // Create chunk from data
+                    let chunk = Chunk::from_decompressed(data.into_owned().into_boxed_slice());
+
+                    // Optionally compress the chunk
+                    let chunk = if compress {
+                        let options = ChunkCompressionOptions::default();
+                        match chunk.compress(&options) {
+                            Ok(compressed) => compressed,
+                            Err(_) => chunk, // Fall back to uncompressed if compression fails
+                        }
+                    } else {
+                        chunk
+                    };
+
+                    // Create file from chunk
+                    Ok(Cow::Owned([chunk].into_iter().collect()))
+                })
+                .collect();
+
+            for ((path, _), file) in entries[batch].iter().zip(files?) {
+                let mut chunks = Vec::with_capacity(file.len());
+                for chunk in file.iter() {
+                    chunks.push(StagedChunk {
+                        data: spill.push(chunk.as_bytes(), chunk.decompressed_len())?,
+                        mips: chunk.mips.clone(),
+                    });
+                }
+
+                staged.push(StagedFile {
+                    header: file.header.clone(),
+                    chunks,
+                });
+                progress(staged.len(), total, path)?;
+            }
+        }
+
+        // the previous archive is usually the output, it has to be closed before it's
+        // overwritten
+        drop(reusable);
+        drop(previous);
+        if self.previous.is_some() {
+            info!(
+                "Reused {} of {} files from the previous archive",
+                reused.load(Ordering::Relaxed),
+                total
+            );
         }
 
-        let file = fs::File::create(output_path)
-            .with_context(|| format!("Failed to create BA2: {}", output_path.display()))?;
-        let mut writer = BufWriter::new(file);
+        // Build archive from entries, the chunk data borrows from the spill map
+        let map = spill.map()?;
+        let archive: Archive = entries
+            .iter()
+            .zip(&staged)
+            .map(|((path, _), file)| {
+                let chunks = file.chunks.iter().map(|chunk| {
+                    let bytes = map.get(&chunk.data);
+                    let mut result = match chunk.data.decompressed_len {
+                        Some(len) => Chunk::from_compressed(bytes, len),
+                        None => Chunk::from_decompressed(bytes),
+                    };
+                    result.mips = chunk.mips.clone();
+                    result
+                });
+
+                let mut result: Ba2File = chunks.collect();
+                result.header = file.header.clone();
+
+                // Create key from path
+                let key: ArchiveKey = path.as_bytes().into();
+                (key, result)
+            })
+            .collect();
+
+        let options = if dx10 {
+            ArchiveOptionsBuilder::default()
+                .version(self.version.to_crate_version())
+                .format(Format::DX10)
+                .compression_format(Ba2CrateCompression::Zip)
+                .strings(self.strings)
+                .build()
+        } else {
+            ArchiveOptionsBuilder::default()
+                .version(self.version.to_crate_version())
+                .strings(self.strings)
+                .build()
+        };
 
-        archive
-            .write(&mut writer, &options)
-            .with_context(|| format!("Failed to write BA2: {}", output_path.display()))?;
+        write_replacing(output_path, |writer| {
+            archive
+                .write(writer, &options)
+                .with_context(|| format!("Failed to write BA2: {}", output_path.display()))
+        })?;
 
         info!(
-            "Created DX10 BA2: {} ({} files)",
+            "Created BA2: {} ({} files, format {:?})",
             output_path.display(),
-            total
+            total,
+            self.format
         );
         Ok(())
     }
 }
 
+/// Key of a file for matching it against the previous archive
+fn entry_key(path: &str) -> String {
+    path.replace('\\', "/").to_lowercase()
+}
+
+/// Open the archive to reuse files from, only if it was written with the version and
+/// format of the new one. Chunks are always compressed with zlib.
+fn open_previous(
+    path: &Path,
+    version: Version,
+    format: Format,
+) -> Option<(Archive<'static>, FileWriteOptions)> {
+    if !path.is_file() {
+        return None;
+    }
+
+    match Archive::read(path) {
+        Ok((archive, options)) => {
+            if options.version() == version
+                && options.format() == format
+                && options.compression_format() == Ba2CrateCompression::Zip
+            {
+                Some((archive, options.into()))
+            } else {
+                info!(
+                    "Not reusing {}, it was written with other settings",
+                    path.display()
+                );
+                None
+            }
+        }
+        Err(e) => {
+            info!("Not reusing {}: {}", path.display(), e);
+            None
+        }
+    }
+}
+
+/// Whether `file` from the previous archive holds exactly `data`, with its chunks stored
+/// the way new ones would be. Textures are parsed with `dx10_options` so both sides are
+/// rebuilt into the same DDS layout before comparing.
+fn unchanged(
+    file: &Ba2File,
+    data: &[u8],
+    compressed: bool,
+    dx10_options: Option<&FileReadOptions>,
+    write_options: &FileWriteOptions,
+) -> bool {
+    if file
+        .iter()
+        .any(|chunk| chunk.is_decompressed() == compressed)
+    {
+        return false;
+    }
+
+    let expected: Cow<[u8]> = match dx10_options {
+        Some(options) => {
+            let mut buffer = Cursor::new(Vec::new());
+            match Ba2File::read(Copied(data), options) {
+                Ok(texture) if texture.write(&mut buffer, write_options).is_ok() => {
+                    Cow::Owned(buffer.into_inner())
+                }
+                _ => return false,
+            }
+        }
+        None => {
+            let len: usize = file
+                .iter()
+                .map(|chunk| chunk.decompressed_len().unwrap_or(chunk.as_bytes().len()))
+                .sum();
+            if len != data.len() {
+                return false;
+            }
+            Cow::Borrowed(data)
+        }
+    };
+
+    let mut buffer = Cursor::new(Vec::new());
+    file.write(&mut buffer, write_options).is_ok() && buffer.into_inner() == *expected
+}
+
 impl Default for Ba2Builder {
     fn default() -> Self {
         Self::new()
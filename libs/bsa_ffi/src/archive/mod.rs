@@ -8,6 +8,7 @@
 mod ba2_reader;
 mod ba2_writer;
 mod reader;
+mod stream;
 mod tes3_reader;
 mod writer;
 
@@ -25,7 +26,7 @@ pub use tes3_reader::{
 // BA2 support for Fallout 4/Starfield
 pub use ba2_reader::{
     extract_file as extract_ba2_file, extract_files_batch as extract_ba2_files_batch,
-    list_files as list_ba2_files,
+    extract_texture_mips as extract_ba2_texture_mips, list_files as list_ba2_files,
 };
 pub use ba2_writer::{Ba2Builder, Ba2CompressionFormat, Ba2Format, Ba2Version};
 
@@ -135,6 +136,20 @@ pub fn extract_archive_file(archive_path: &Path, file_path: &str) -> Result<Vec<
     }
 }
 
+/// Extract a texture from any Bethesda archive without its mips larger than `mip`,
+/// returns the data and which mip of the texture its largest one is. Only BA2
+/// archives store textures by mip, files of the others are extracted in full.
+pub fn extract_archive_texture_mips(
+    archive_path: &Path,
+    file_path: &str,
+    mip: u16,
+) -> Result<(Vec<u8>, u16)> {
+    match detect_format(archive_path) {
+        Some(ArchiveFormat::Ba2) => extract_ba2_texture_mips(archive_path, file_path, mip),
+        _ => Ok((extract_archive_file(archive_path, file_path)?, 0)),
+    }
+}
+
 /// Extract multiple files from any Bethesda archive in a single pass.
 /// Opens the archive once and calls the callback for each extracted file.
 /// `wanted_files` should contain the original paths (as returned by list_archive_files).
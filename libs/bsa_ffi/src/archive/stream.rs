@@ -0,0 +1,226 @@
+//! Bounded-memory staging for archive creation
+//!
+//! The ba2 crate needs every file of an archive before it can write it, so file data
+//! is read and compressed in batches of limited size and appended to a spill file next
+//! to the output. The archive is then built from a mapping of the spill file, which is
+//! backed by the page cache instead of the heap.
+
+use anyhow::{Context, Result};
+use memmap2::Mmap;
+use std::borrow::Cow;
+use std::fs;
+use std::io::{BufWriter, Write};
+use std::ops::{Deref, Range};
+use std::path::{Path, PathBuf};
+
+/// Upper bound for the uncompressed size of the files read at once
+const BATCH_BYTES: u64 = 256 * 1024 * 1024;
+
+/// Upper bound for the number of files read at once
+const BATCH_FILES: usize = 4096;
+
+/// Where the data of a file being packed comes from
+pub enum PackSource {
+    /// Contents already in memory
+    Memory(Vec<u8>),
+    /// A file on disk, only read while its batch is processed
+    Disk { path: PathBuf, size: u64 },
+}
+
+impl PackSource {
+    /// Record a file on disk with its current size
+    pub fn from_path(path: &Path) -> Result<Self> {
+        let size = fs::metadata(path)
+            .with_context(|| format!("Failed to stat: {}", path.display()))?
+            .len();
+        Ok(PackSource::Disk {
+            path: path.to_path_buf(),
+            size,
+        })
+    }
+
+    /// Uncompressed size in bytes
+    pub fn len(&self) -> u64 {
+        match self {
+            PackSource::Memory(data) => data.len() as u64,
+            PackSource::Disk { size, .. } => *size,
+        }
+    }
+
+    /// Contents of the file
+    pub fn load(&self) -> Result<Cow<'_, [u8]>> {
+        match self {
+            PackSource::Memory(data) => Ok(Cow::Borrowed(data)),
+            PackSource::Disk { path, .. } => fs::read(path)
+                .map(Cow::Owned)
+                .with_context(|| format!("Failed to read: {}", path.display())),
+        }
+    }
+}
+
+/// Split `sizes` into consecutive index ranges that stay within the batch limits.
+/// A single file larger than the limit gets a batch of its own.
+pub fn batches(sizes: impl IntoIterator<Item = u64>) -> Vec<Range<usize>> {
+    let mut result = Vec::new();
+    let mut start = 0;
+    let mut bytes = 0;
+    let mut end = 0;
+
+    for size in sizes {
+        if end > start && (bytes + size > BATCH_BYTES || end - start >= BATCH_FILES) {
+            result.push(start..end);
+            start = end;
+            bytes = 0;
+        }
+        bytes += size;
+        end += 1;
+    }
+
+    if end > start {
+        result.push(start..end);
+    }
+    result
+}
+
+/// Location of a staged blob inside the spill file
+#[derive(Debug, Clone)]
+pub struct SpilledData {
+    range: Range<usize>,
+    /// Size before compression, none if the blob is stored uncompressed
+    pub decompressed_len: Option<usize>,
+}
+
+/// Temporary file holding the compressed data until the archive is written,
+/// removed when dropped
+pub struct SpillFile {
+    path: PathBuf,
+    writer: Option<BufWriter<fs::File>>,
+    len: usize,
+}
+
+impl SpillFile {
+    /// Create the spill file next to `output_path`
+    pub fn create(output_path: &Path) -> Result<Self> {
+        let mut name = output_path
+            .file_name()
+            .map(|n| n.to_os_string())
+            .unwrap_or_default();
+        name.push(".spill");
+        let path = output_path.with_file_name(name);
+
+        // readable too, it's mapped once everything is written
+        let file = fs::OpenOptions::new()
+            .read(true)
+            .write(true)
+            .create(true)
+            .truncate(true)
+            .open(&path)
+            .with_context(|| format!("Failed to create spill file: {}", path.display()))?;
+
+        Ok(Self {
+            path,
+            writer: Some(BufWriter::new(file)),
+            len: 0,
+        })
+    }
+
+    /// Append a blob
+    pub fn push(&mut self, data: &[u8], decompressed_len: Option<usize>) -> Result<SpilledData> {
+        let writer = self.writer.as_mut().expect("spill file already mapped");
+        writer
+            .write_all(data)
+            .with_context(|| format!("Failed to write spill file: {}", self.path.display()))?;
+
+        let start = self.len;
+        self.len += data.len();
+        Ok(SpilledData {
+            range: start..self.len,
+            decompressed_len,
+        })
+    }
+
+    /// Stop writing and map everything pushed so far
+    pub fn map(&mut self) -> Result<SpillMap> {
+        let file = self
+            .writer
+            .take()
+            .expect("spill file already mapped")
+            .into_inner()
+            .map_err(|e| e.into_error())
+            .with_context(|| format!("Failed to write spill file: {}", self.path.display()))?;
+
+        if self.len == 0 {
+            return Ok(SpillMap(None));
+        }
+
+        // SAFETY: the spill file is private to this builder and isn't written to or
+        // truncated while mapped
+        let map = unsafe { Mmap::map(&file) }
+            .with_context(|| format!("Failed to map spill file: {}", self.path.display()))?;
+        Ok(SpillMap(Some(map)))
+    }
+}
+
+impl Drop for SpillFile {
+    fn drop(&mut self) {
+        self.writer = None;
+        let _ = fs::remove_file(&self.path);
+    }
+}
+
+/// Read-only view of a finished spill file
+pub struct SpillMap(Option<Mmap>);
+
+impl SpillMap {
+    /// Bytes of a blob pushed before mapping
+    pub fn get(&self, data: &SpilledData) -> &[u8] {
+        &self[data.range.clone()]
+    }
+}
+
+impl Deref for SpillMap {
+    type Target = [u8];
+
+    fn deref(&self) -> &[u8] {
+        self.0.as_deref().unwrap_or(&[])
+    }
+}
+
+/// Write an archive to a temporary file next to `output_path` and rename it over the
+/// archive once it's complete. The archive being replaced is never truncated, the VFS
+/// or a game may have it mapped.
+pub fn write_replacing(
+    output_path: &Path,
+    write: impl FnOnce(&mut BufWriter<fs::File>) -> Result<()>,
+) -> Result<()> {
+    let mut name = output_path
+        .file_name()
+        .map(|n| n.to_os_string())
+        .unwrap_or_default();
+    name.push(".tmp");
+    let tmp_path = output_path.with_file_name(name);
+
+    let written = (|| {
+        let file = fs::File::create(&tmp_path)
+            .with_context(|| format!("Failed to create {}", tmp_path.display()))?;
+        let mut writer = BufWriter::new(file);
+        write(&mut writer)?;
+        writer
+            .into_inner()
+            .map_err(|e| e.into_error())
+            .with_context(|| format!("Failed to write {}", tmp_path.display()))?;
+
+        fs::rename(&tmp_path, output_path).with_context(|| {
+            format!(
+                "Failed to replace {} with {}",
+                output_path.display(),
+                tmp_path.display()
+            )
+        })
+    })();
+
+    if written.is_err() {
+        let _ = fs::remove_file(&tmp_path);
+    }
+    written
+}
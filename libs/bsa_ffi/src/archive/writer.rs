@@ -7,49 +7,25 @@ use ba2::tes4::{
 };
 use ba2::CompressableFrom;
 use rayon::prelude::*;
+use std::borrow::Cow;
 use std::collections::HashMap;
 use std::fs;
-use std::io::BufWriter;
-use std::path::Path;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicUsize, Ordering};
 use tracing::info;
 
+use super::stream::{batches, write_replacing, PackSource, SpillFile, SpilledData};
 use super::{default_flags_fo3, default_flags_oblivion, detect_types, detect_version};
 
-/// Helper struct to hold file data with lifetime for BSA creation
-struct FileEntry {
-    dir_path: String,
-    file_name: String,
-    data: Vec<u8>,
-}
-
-impl FileEntry {
-    /// Create a BSA file, optionally compressing it
-    fn as_bsa_file(&self, version: Version, should_compress: bool) -> Result<BsaFile<'static>> {
-        // Create an uncompressed file from our raw data
-        let uncompressed = BsaFile::from_decompressed(self.data.clone().into_boxed_slice());
-
-        if should_compress {
-            // Compress the file using ba2's compress method
-            let compression_options = FileCompressionOptions::builder().version(version).build();
-
-            uncompressed
-                .compress(&compression_options)
-                .with_context(|| {
-                    format!("Failed to compress: {}/{}", self.dir_path, self.file_name)
-                })
-        } else {
-            Ok(uncompressed)
-        }
-    }
-}
-
 /// Builder for creating BSA archives
 pub struct BsaBuilder {
-    /// Files organized by directory -> filename -> data
-    files: HashMap<String, HashMap<String, Vec<u8>>>,
+    /// Files organized by directory -> filename -> source
+    files: HashMap<String, HashMap<String, PackSource>>,
     flags: ArchiveFlags,
     types: ArchiveTypes,
     version: Version,
+    /// Archive whose unchanged files are copied instead of compressed again
+    previous: Option<PathBuf>,
 }
 
 impl BsaBuilder {
@@ -59,6 +35,7 @@ impl BsaBuilder {
             flags: default_flags_fo3(),
             types: ArchiveTypes::empty(),
             version: Version::v104,
+            previous: None,
         }
     }
 
@@ -78,6 +55,7 @@ impl BsaBuilder {
             flags,
             types,
             version,
+            previous: None,
         }
     }
 
@@ -111,8 +89,27 @@ impl BsaBuilder {
         self
     }
 
+    /// Reuse the compressed data of files in `path` that are identical to the ones being
+    /// added. It's usually the archive being replaced, a missing file or one written
+    /// with other settings is ignored.
+    pub fn reuse_from(mut self, path: &Path) -> Self {
+        self.previous = Some(path.to_path_buf());
+        self
+    }
+
     /// Add a file to the archive
+    #[allow(dead_code)]
     pub fn add_file(&mut self, path: &str, data: Vec<u8>) {
+        self.add_source(path, PackSource::Memory(data));
+    }
+
+    /// Add a file on disk to the archive, it's only read while the archive is built
+    pub fn add_file_from_path(&mut self, path: &str, source: &Path) -> Result<()> {
+        self.add_source(path, PackSource::from_path(source)?);
+        Ok(())
+    }
+
+    fn add_source(&mut self, path: &str, source: PackSource) {
         // Normalize: forward slashes, strip leading slash
         let normalized = path.replace('\\', "/");
         let normalized = normalized.trim_start_matches('/');
@@ -129,7 +126,7 @@ impl BsaBuilder {
         self.files
             .entry(dir_path)
             .or_default()
-            .insert(file_name, data);
+            .insert(file_name, source);
     }
 
     /// Get number of files
@@ -142,10 +139,15 @@ impl BsaBuilder {
         self.file_count() == 0
     }
 
-    /// Build and write the BSA to disk with progress callback
+    /// Build and write the BSA to disk with progress callback, returning an error from
+    /// the callback stops the build.
+    ///
+    /// Files are read and compressed in parallel, one batch of bounded size at a time,
+    /// and staged in a spill file next to the output, so memory use doesn't grow with
+    /// the size of the archive.
     pub fn build_with_progress<F>(self, output_path: &Path, progress: F) -> Result<()>
     where
-        F: Fn(usize, usize, &str) + Send + Sync,
+        F: Fn(usize, usize, &str) -> Result<()> + Send + Sync,
     {
         if self.is_empty() {
             bail!("Cannot create empty BSA archive");
@@ -156,7 +158,7 @@ impl BsaBuilder {
             .files
             .values()
             .flat_map(|files| files.values())
-            .map(|data| data.len() as u64)
+            .map(PackSource::len)
             .sum();
 
         info!(
@@ -170,45 +172,105 @@ impl BsaBuilder {
 
         // Check if we should compress files
         let should_compress = self.flags.contains(ArchiveFlags::COMPRESSED);
+        let compression_options = FileCompressionOptions::builder()
+            .version(self.version)
+            .build();
 
-        // Flatten to FileEntry structs that own their data
-        let entries: Vec<FileEntry> = self
+        let entries: Vec<(String, String, PackSource)> = self
             .files
             .into_iter()
             .flat_map(|(dir_path, files)| {
-                files.into_iter().map(move |(file_name, data)| FileEntry {
-                    dir_path: dir_path.clone(),
-                    file_name,
-                    data,
-                })
+                files
+                    .into_iter()
+                    .map(move |(file_name, source)| (dir_path.clone(), file_name, source))
             })
             .collect();
 
+        if let Some(parent) = output_path.parent() {
+            fs::create_dir_all(parent)?;
+        }
+
         let total = entries.len();
-        let processed_count = std::sync::atomic::AtomicUsize::new(0);
-
-        // Process files in parallel - create and compress BsaFile entries
-        let version = self.version;
-        let processed: Result<Vec<(String, String, BsaFile)>> = entries
-            .par_iter()
-            .map(|entry| {
-                let file = entry.as_bsa_file(version, should_compress)?;
-                let current =
-                    processed_count.fetch_add(1, std::sync::atomic::Ordering::Relaxed) + 1;
-                progress(
-                    current,
-                    total,
-                    &format!("{}/{}", entry.dir_path, entry.file_name),
-                );
-                Ok((entry.dir_path.clone(), entry.file_name.clone(), file))
+        let mut spill = SpillFile::create(output_path)?;
+        let mut staged: Vec<SpilledData> = Vec::with_capacity(total);
+
+        let previous = self
+            .previous
+            .as_deref()
+            .and_then(|path| open_previous(path, self.version, should_compress));
+        let reusable: HashMap<String, &BsaFile> = previous
+            .iter()
+            .flat_map(|archive| archive.iter())
+            .flat_map(|(dir_key, folder)| {
+                let dir_name = String::from_utf8_lossy(dir_key.name().as_bytes()).into_owned();
+                folder.iter().map(move |(file_key, file)| {
+                    let file_name = String::from_utf8_lossy(file_key.name().as_bytes());
+                    (entry_key(&dir_name, &file_name), file)
+                })
             })
             .collect();
+        let reused = AtomicUsize::new(0);
+
+        for batch in batches(entries.iter().map(|(_, _, source)| source.len())) {
+            // Compress the batch in parallel, then append it in order
+            let compressed: Result<Vec<(Cow<[u8]>, Option<usize>)>> = entries[batch.clone()]
+                .par_iter()
+                .map(|(dir_path, file_name, source)| {
+                    let data = source.load()?;
+
+                    if let Some(file) = reusable.get(&entry_key(dir_path, file_name)) {
+                        if unchanged(file, &data, should_compress, &compression_options) {
+                            reused.fetch_add(1, Ordering::Relaxed);
+                            return Ok((Cow::Borrowed(file.as_bytes()), file.decompressed_len()));
+                        }
+                    }
+
+                    if !should_compress {
+                        return Ok((data, None));
+                    }
+
+                    let file = BsaFile::from_decompressed(&data[..])
+                        .compress(&compression_options)
+                        .with_context(|| {
+                            format!("Failed to compress: {}/{}", dir_path, file_name)
+                        })?;
+                    Ok((
+                        Cow::Owned(file.as_bytes().to_vec()),
+                        file.decompressed_len(),
+                    ))
+                })
+                .collect();
 
-        let processed = processed?;
+            for ((dir_path, file_name, _), (data, decompressed_len)) in
+                entries[batch].iter().zip(compressed?)
+            {
+                staged.push(spill.push(&data, decompressed_len)?);
+                progress(staged.len(), total, &format!("{}/{}", dir_path, file_name))?;
+            }
+        }
+
+        // the previous archive is usually the output, it has to be closed before it's
+        // overwritten
+        drop(reusable);
+        drop(previous);
+        if self.previous.is_some() {
+            info!(
+                "Reused {} of {} files from the previous archive",
+                reused.load(Ordering::Relaxed),
+                total
+            );
+        }
 
-        // Build archive
+        // Build archive, the file data borrows from the spill map
+        let map = spill.map()?;
         let mut archive = Archive::new();
-        for (dir_path, file_name, file) in processed {
+        for ((dir_path, file_name, _), data) in entries.iter().zip(&staged) {
+            let bytes = map.get(data);
+            let file = match data.decompressed_len {
+                Some(len) => BsaFile::from_compressed(bytes, len),
+                None => BsaFile::from_decompressed(bytes),
+            };
+
             let archive_key = ArchiveKey::from(dir_path.as_bytes());
             let directory_key = DirectoryKey::from(file_name.as_bytes());
 
@@ -230,25 +292,81 @@ impl BsaBuilder {
             .types(self.types)
             .build();
 
-        // Create parent directory
-        if let Some(parent) = output_path.parent() {
-            fs::create_dir_all(parent)?;
-        }
-
         // Write archive
-        let file = fs::File::create(output_path)
-            .with_context(|| format!("Failed to create BSA: {}", output_path.display()))?;
-        let mut writer = BufWriter::new(file);
-
-        archive
-            .write(&mut writer, &options)
-            .with_context(|| format!("Failed to write BSA: {}", output_path.display()))?;
+        write_replacing(output_path, |writer| {
+            archive
+                .write(writer, &options)
+                .with_context(|| format!("Failed to write BSA: {}", output_path.display()))
+        })?;
 
         info!("Created BSA: {}", output_path.display());
         Ok(())
     }
 }
 
+/// Key of a file for matching it against the previous archive, which uses backslashes
+fn entry_key(dir_path: &str, file_name: &str) -> String {
+    if dir_path.is_empty() || dir_path == "." {
+        file_name.to_lowercase()
+    } else {
+        format!("{}\\{}", dir_path.replace('/', "\\"), file_name).to_lowercase()
+    }
+}
+
+/// Open the archive to reuse files from, only if its files were compressed the same way
+/// the new ones are
+fn open_previous(path: &Path, version: Version, compressed: bool) -> Option<Archive<'static>> {
+    if !path.is_file() {
+        return None;
+    }
+
+    match Archive::read(path) {
+        Ok((archive, options)) => {
+            if options.version() == version
+                && options.flags().contains(ArchiveFlags::COMPRESSED) == compressed
+            {
+                Some(archive)
+            } else {
+                info!(
+                    "Not reusing {}, it was written with other settings",
+                    path.display()
+                );
+                None
+            }
+        }
+        Err(e) => {
+            info!("Not reusing {}: {}", path.display(), e);
+            None
+        }
+    }
+}
+
+/// Whether `file` from the previous archive holds exactly `data`, stored the way a new
+/// file would be
+fn unchanged(
+    file: &BsaFile,
+    data: &[u8],
+    compressed: bool,
+    options: &FileCompressionOptions,
+) -> bool {
+    if file.is_decompressed() == compressed {
+        return false;
+    }
+
+    let len = file.decompressed_len().unwrap_or(file.as_bytes().len());
+    if len != data.len() {
+        return false;
+    }
+
+    if !compressed {
+        return file.as_bytes() == data;
+    }
+
+    file.decompress(options)
+        .map(|decompressed| decompressed.as_bytes() == data)
+        .unwrap_or(false)
+}
+
 impl Default for BsaBuilder {
     fn default() -> Self {
         Self::new()
@@ -1,13 +1,13 @@
 mod archive;
 
-use std::ffi::{c_char, c_int, CStr, CString};
+use std::ffi::{c_char, c_int, c_void, CStr, CString};
 use std::fs;
 use std::path::{Path, PathBuf};
 use std::ptr;
 
 use archive::{
-    extract_archive_files_batch, list_archive_files, Ba2Builder, Ba2Format, BsaBuilder,
-    GameVersion,
+    extract_archive_files_batch, extract_archive_texture_mips, list_archive_files,
+    Ba2Builder, Ba2Format, BsaBuilder, GameVersion,
 };
 use walkdir::WalkDir;
 
@@ -21,6 +21,15 @@ pub struct BsaFfiStringList {
 pub type BsaProgressCallback =
     Option<unsafe extern "C" fn(done: u32, total: u32, current_path: *const c_char)>;
 
+pub type BsaDataCallback = Option<
+    unsafe extern "C" fn(
+        user_data: *mut c_void,
+        path: *const c_char,
+        data: *const u8,
+        size: usize,
+    ) -> c_int,
+>;
+
 fn to_cstring(s: &str) -> *mut c_char {
     CString::new(s).unwrap_or_default().into_raw()
 }
@@ -53,6 +62,43 @@ fn call_progress(progress_cb: BsaProgressCallback, done: usize, total: usize, pa
     }
 }
 
+fn check_cancel(cancel_addr: usize) -> anyhow::Result<()> {
+    let cancel_ptr = cancel_addr as *const c_int;
+    if !cancel_ptr.is_null() {
+        let cancelled = unsafe { *cancel_ptr } != 0;
+        if cancelled {
+            anyhow::bail!("cancelled");
+        }
+    }
+    Ok(())
+}
+
+fn write_extracted(output_dir: &Path, path: &str, data: &[u8]) -> anyhow::Result<()> {
+    let out_path = output_dir.join(path.replace('\\', "/"));
+    if let Some(parent) = out_path.parent() {
+        fs::create_dir_all(parent)?;
+    }
+    fs::write(&out_path, data)?;
+    Ok(())
+}
+
+unsafe fn from_cstr_array(
+    paths: *const *const c_char,
+    count: usize,
+) -> Result<Vec<String>, String> {
+    if count == 0 {
+        return Ok(Vec::new());
+    }
+    if paths.is_null() {
+        return Err("null pointer".to_string());
+    }
+
+    std::slice::from_raw_parts(paths, count)
+        .iter()
+        .map(|&p| from_cstr(p).map(str::to_string).map_err(str::to_string))
+        .collect()
+}
+
 fn path_to_rel(root: &Path, child: &Path) -> anyhow::Result<String> {
     let rel = child.strip_prefix(root)?;
     Ok(rel.to_string_lossy().replace('\\', "/"))
@@ -146,19 +192,71 @@ pub unsafe extern "C" fn bsa_ffi_extract_all(
     let cancel_addr = cancel_flag as usize;
 
     let res = extract_archive_files_batch(&archive_path, &wanted_files, |path, data| {
-        let cancel_ptr = cancel_addr as *const c_int;
-        if !cancel_ptr.is_null() {
-            let cancelled = unsafe { *cancel_ptr } != 0;
-            if cancelled {
-                anyhow::bail!("cancelled");
-            }
-        }
+        check_cancel(cancel_addr)?;
+        write_extracted(&output_dir, path, &data)?;
+
+        let done = progress_count.fetch_add(1, std::sync::atomic::Ordering::Relaxed) + 1;
+        call_progress(progress_cb, done, total, path);
+        Ok(())
+    });
+
+    match res {
+        Ok(_) => ptr::null_mut(),
+        Err(e) => to_cstring(&e.to_string()),
+    }
+}
 
-        let out_path = output_dir.join(path.replace('\\', "/"));
-        if let Some(parent) = out_path.parent() {
-            fs::create_dir_all(parent)?;
+fn set_extracted(extracted: *mut usize, count: usize) {
+    if !extracted.is_null() {
+        unsafe {
+            *extracted = count;
         }
-        fs::write(&out_path, &data)?;
+    }
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn bsa_ffi_extract_files(
+    archive_path: *const c_char,
+    paths: *const *const c_char,
+    path_count: usize,
+    output_dir: *const c_char,
+    progress_cb: BsaProgressCallback,
+    cancel_flag: *const c_int,
+    extracted: *mut usize,
+) -> *mut c_char {
+    set_extracted(extracted, 0);
+
+    let archive_path = match from_cstr(archive_path) {
+        Ok(v) => v,
+        Err(e) => return to_cstring(e),
+    };
+    let output_dir = match from_cstr(output_dir) {
+        Ok(v) => v,
+        Err(e) => return to_cstring(e),
+    };
+    let wanted_files = match from_cstr_array(paths, path_count) {
+        Ok(v) => v,
+        Err(e) => return to_cstring(&e),
+    };
+
+    if wanted_files.is_empty() {
+        return ptr::null_mut();
+    }
+
+    let archive_path = PathBuf::from(archive_path);
+    let output_dir = PathBuf::from(output_dir);
+
+    if let Err(e) = fs::create_dir_all(&output_dir) {
+        return to_cstring(&format!("failed to create output directory: {e}"));
+    }
+
+    let total = wanted_files.len();
+    let progress_count = std::sync::atomic::AtomicUsize::new(0);
+    let cancel_addr = cancel_flag as usize;
+
+    let res = extract_archive_files_batch(&archive_path, &wanted_files, |path, data| {
+        check_cancel(cancel_addr)?;
+        write_extracted(&output_dir, path, &data)?;
 
         let done = progress_count.fetch_add(1, std::sync::atomic::Ordering::Relaxed) + 1;
         call_progress(progress_cb, done, total, path);
@@ -166,11 +264,119 @@ pub unsafe extern "C" fn bsa_ffi_extract_all(
     });
 
     match res {
-        Ok(_) => ptr::null_mut(),
+        Ok(count) => {
+            set_extracted(extracted, count);
+            ptr::null_mut()
+        }
+        Err(e) => to_cstring(&e.to_string()),
+    }
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn bsa_ffi_extract_files_cb(
+    archive_path: *const c_char,
+    paths: *const *const c_char,
+    path_count: usize,
+    data_cb: BsaDataCallback,
+    user_data: *mut c_void,
+    cancel_flag: *const c_int,
+    extracted: *mut usize,
+) -> *mut c_char {
+    set_extracted(extracted, 0);
+
+    let archive_path = match from_cstr(archive_path) {
+        Ok(v) => v,
+        Err(e) => return to_cstring(e),
+    };
+    let wanted_files = match from_cstr_array(paths, path_count) {
+        Ok(v) => v,
+        Err(e) => return to_cstring(&e),
+    };
+    let data_cb = match data_cb {
+        Some(cb) => cb,
+        None => return to_cstring("null pointer"),
+    };
+
+    if wanted_files.is_empty() {
+        return ptr::null_mut();
+    }
+
+    let archive_path = PathBuf::from(archive_path);
+    let cancel_addr = cancel_flag as usize;
+    let user_addr = user_data as usize;
+
+    let res = extract_archive_files_batch(&archive_path, &wanted_files, |path, data| {
+        check_cancel(cancel_addr)?;
+
+        let c_path = CString::new(path)?;
+        let ok = unsafe {
+            data_cb(
+                user_addr as *mut c_void,
+                c_path.as_ptr(),
+                data.as_ptr(),
+                data.len(),
+            )
+        };
+        if ok == 0 {
+            anyhow::bail!("cancelled");
+        }
+        Ok(())
+    });
+
+    match res {
+        Ok(count) => {
+            set_extracted(extracted, count);
+            ptr::null_mut()
+        }
         Err(e) => to_cstring(&e.to_string()),
     }
 }
 
+#[no_mangle]
+pub unsafe extern "C" fn bsa_ffi_extract_texture_mips(
+    archive_path: *const c_char,
+    path: *const c_char,
+    mip: u16,
+    data_cb: BsaDataCallback,
+    user_data: *mut c_void,
+    first_mip: *mut u16,
+) -> *mut c_char {
+    if !first_mip.is_null() {
+        *first_mip = 0;
+    }
+
+    let archive_path = match from_cstr(archive_path) {
+        Ok(v) => v,
+        Err(e) => return to_cstring(e),
+    };
+    let file_path = match from_cstr(path) {
+        Ok(v) => v,
+        Err(e) => return to_cstring(e),
+    };
+    let data_cb = match data_cb {
+        Some(cb) => cb,
+        None => return to_cstring("null pointer"),
+    };
+
+    let archive_path = PathBuf::from(archive_path);
+    let (data, first) = match extract_archive_texture_mips(&archive_path, file_path, mip) {
+        Ok(v) => v,
+        Err(e) => return to_cstring(&e.to_string()),
+    };
+
+    if !first_mip.is_null() {
+        *first_mip = first;
+    }
+
+    let c_path = match CString::new(file_path) {
+        Ok(v) => v,
+        Err(e) => return to_cstring(&e.to_string()),
+    };
+    data_cb(user_data, c_path.as_ptr(), data.as_ptr(), data.len());
+
+    ptr::null_mut()
+}
+
 #[no_mangle]
 pub unsafe extern "C" fn bsa_ffi_pack_dir(
     input_dir: *const c_char,
@@ -197,6 +403,48 @@ pub unsafe extern "C" fn bsa_ffi_pack_dir_filtered(
     include_mode: c_int,
     progress_cb: BsaProgressCallback,
     cancel_flag: *const c_int,
+) -> *mut c_char {
+    pack_dir(
+        input_dir,
+        output_archive,
+        game_id,
+        include_mode,
+        progress_cb,
+        cancel_flag,
+        false,
+    )
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn bsa_ffi_repack_dir_filtered(
+    input_dir: *const c_char,
+    output_archive: *const c_char,
+    game_id: *const c_char,
+    include_mode: c_int,
+    progress_cb: BsaProgressCallback,
+    cancel_flag: *const c_int,
+) -> *mut c_char {
+    pack_dir(
+        input_dir,
+        output_archive,
+        game_id,
+        include_mode,
+        progress_cb,
+        cancel_flag,
+        true,
+    )
+}
+
+/// Pack `input_dir`, with `reuse` the files that didn't change since `output_archive`
+/// was last written are copied from it
+unsafe fn pack_dir(
+    input_dir: *const c_char,
+    output_archive: *const c_char,
+    game_id: *const c_char,
+    include_mode: c_int,
+    progress_cb: BsaProgressCallback,
+    cancel_flag: *const c_int,
+    reuse: bool,
 ) -> *mut c_char {
     let input_dir = match from_cstr(input_dir) {
         Ok(v) => v,
@@ -226,7 +474,9 @@ pub unsafe extern "C" fn bsa_ffi_pack_dir_filtered(
     let input_dir = PathBuf::from(input_dir);
     let output_archive = PathBuf::from(output_archive);
 
-    let mut files: Vec<(String, Vec<u8>)> = Vec::new();
+    // only paths and sizes are collected here, the builders read the files in
+    // bounded batches while they compress them
+    let mut files: Vec<(String, PathBuf)> = Vec::new();
     for entry in WalkDir::new(&input_dir).into_iter().filter_map(|e| e.ok()) {
         if !entry.file_type().is_file() {
             continue;
@@ -248,19 +498,19 @@ pub unsafe extern "C" fn bsa_ffi_pack_dir_filtered(
             continue;
         }
 
-        let data = match fs::read(entry.path()) {
-            Ok(v) => v,
-            Err(e) => return to_cstring(&format!("read error: {e}")),
-        };
-
-        files.push((rel, data));
+        files.push((rel, entry.into_path()));
     }
 
     if files.is_empty() {
         return to_cstring("no files found in input_dir");
     }
 
-    let total = files.len();
+    let cancel_addr = cancel_flag as usize;
+    let progress = |done: usize, total: usize, path: &str| -> anyhow::Result<()> {
+        check_cancel(cancel_addr)?;
+        call_progress(progress_cb, done, total, path);
+        Ok(())
+    };
 
     if game.is_ba2() {
         let ba2_version = game.ba2_version().unwrap_or_default();
@@ -280,19 +530,17 @@ pub unsafe extern "C" fn bsa_ffi_pack_dir_filtered(
             .with_version(ba2_version)
             .with_compression(compression)
             .with_format(format);
+        if reuse {
+            builder = builder.reuse_from(&output_archive);
+        }
 
-        for (idx, (rel, data)) in files.into_iter().enumerate() {
-            if !cancel_flag.is_null() {
-                let cancelled = unsafe { *cancel_flag } != 0;
-                if cancelled {
-                    return to_cstring("cancelled");
-                }
+        for (rel, path) in &files {
+            if let Err(e) = builder.add_file_from_path(rel, path) {
+                return to_cstring(&format!("read error: {e}"));
             }
-            builder.add_file(&rel, data);
-            call_progress(progress_cb, idx + 1, total, &rel);
         }
 
-        match builder.build_with_progress(&output_archive, |_, _, _| {}) {
+        match builder.build_with_progress(&output_archive, progress) {
             Ok(_) => ptr::null_mut(),
             Err(e) => to_cstring(&e.to_string()),
         }
@@ -305,19 +553,17 @@ pub unsafe extern "C" fn bsa_ffi_pack_dir_filtered(
         let compress = game.supports_compression();
 
         let mut builder = BsaBuilder::new().with_version(version).with_compression(compress);
+        if reuse {
+            builder = builder.reuse_from(&output_archive);
+        }
 
-        for (idx, (rel, data)) in files.into_iter().enumerate() {
-            if !cancel_flag.is_null() {
-                let cancelled = unsafe { *cancel_flag } != 0;
-                if cancelled {
-                    return to_cstring("cancelled");
-                }
+        for (rel, path) in &files {
+            if let Err(e) = builder.add_file_from_path(rel, path) {
+                return to_cstring(&format!("read error: {e}"));
             }
-            builder.add_file(&rel, data);
-            call_progress(progress_cb, idx + 1, total, &rel);
         }
 
-        match builder.build_with_progress(&output_archive, |_, _, _| {}) {
+        match builder.build_with_progress(&output_archive, progress) {
             Ok(_) => ptr::null_mut(),
             Err(e) => to_cstring(&e.to_string()),
         }
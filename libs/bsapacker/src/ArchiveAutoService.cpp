@@ -1,10 +1,15 @@
 #include <bsapacker/ArchiveAutoService.h>
 #include <uibase/utility.h>
 #include <QProgressDialog>
-#include <QtConcurrent>
+#include <QHash>
 #include <QLabel>
+#include <QThread>
+#include <QThreadPool>
 #include <QDebug>
 
+#include <algorithm>
+#include <atomic>
+
 #include "NexusId.h"
 
 #ifdef __linux__
@@ -41,62 +46,112 @@ namespace BsaPacker
 		}
 	}
 
+	const int ArchiveAutoService::MAX_CONCURRENT_ARCHIVES = 3;
+
 	bool ArchiveAutoService::CreateBSA(libbsarch::bs_archive_auto* archive,
 									   const QString& archiveName,
 									   const bsa_archive_type_e type,
 									   const QString& sourceDir,
 									   const int nexusId) const
 	{
-		const QString hostArchiveName = MOBase::normalizePathForHost(archiveName);
-		const QString hostSourceDir = MOBase::normalizePathForHost(sourceDir);
-		const char* gameId = gameIdFromNexusId(nexusId);
-		const int includeMode = includeModeFromArchiveType(type);
+		return this->CreateBSAs({ ArchiveJob{ archive, archiveName, type, sourceDir, nexusId } }).front();
+	}
+
+	std::vector<bool> ArchiveAutoService::CreateBSAs(const std::vector<ArchiveJob>& jobs) const
+	{
+		if (jobs.empty()) {
+			return {};
+		}
+
+		// archives split for size share their file name, those are written one after the other
+		std::vector<std::vector<size_t>> groups;
+		QHash<QString, size_t> groupIndices;
+		for (size_t i = 0; i < jobs.size(); ++i) {
+			const QString& key = MOBase::normalizePathForHost(jobs[i].archiveName);
+			auto itor = groupIndices.find(key);
+			if (itor == groupIndices.end()) {
+				itor = groupIndices.insert(key, groups.size());
+				groups.emplace_back();
+			}
+			groups[*itor].push_back(i);
+		}
 
 		QProgressDialog savingDialog;
 		savingDialog.setWindowFlags(savingDialog.windowFlags() & ~Qt::WindowCloseButtonHint);
 		savingDialog.setWindowTitle(QObject::tr("Writing Archive"));
 		savingDialog.setCancelButton(0);
 		QLabel text;
-		text.setText(QObject::tr("Writing %1").arg(hostArchiveName));
+		if (jobs.size() == 1) {
+			text.setText(QObject::tr("Writing %1").arg(MOBase::normalizePathForHost(jobs.front().archiveName)));
+			savingDialog.setRange(0, 0);
+		} else {
+			text.setText(QObject::tr("Writing %1 archives").arg(jobs.size()));
+			savingDialog.setRange(0, static_cast<int>(jobs.size()));
+		}
 		savingDialog.setLabel(&text);
-		savingDialog.setRange(0, 0);
 		savingDialog.show();
-		auto future = QtConcurrent::run([=]() -> bool {
-#ifdef __linux__
-			char* err = bsa_ffi_pack_dir_filtered(
-				hostSourceDir.toUtf8().constData(),
-				hostArchiveName.toUtf8().constData(),
-				gameId,
-				includeMode,
-				nullptr,
-				nullptr);
-			if (err == nullptr) {
-				qDebug() << "packed archive via bsa_ffi for" << hostArchiveName;
-				return true;
-			}
 
-			qWarning() << "bsa_ffi primary pack failed for" << hostArchiveName
-					   << ":" << QString::fromUtf8(err)
-					   << "- falling back to libbsarch";
-			bsa_ffi_string_free(err);
-#endif
-			try {
-				archive->save_to_disk(hostArchiveName.toStdString());
-			} catch (std::exception&) {
-				return false;
-			}
-			return true;
+		QThreadPool pool;
+		pool.setMaxThreadCount(std::min(MAX_CONCURRENT_ARCHIVES, QThread::idealThreadCount()));
+
+		// std::vector<bool> can't be written from several threads
+		std::vector<char> succeeded(jobs.size(), 0);
+		std::atomic<int> written = 0;
+		for (const auto& group : groups) {
+			pool.start([&jobs, &succeeded, &written, group]() {
+				for (const size_t i : group) {
+					succeeded[i] = ArchiveAutoService::WriteArchive(jobs[i]);
+					++written;
+				}
 			});
-		while (!future.isFinished())
-		{
+		}
+
+		while (!pool.waitForDone(50)) {
+			if (savingDialog.maximum() > 0) {
+				savingDialog.setValue(written);
+			}
 			QCoreApplication::processEvents();
 		}
 		savingDialog.hide();
 
-		if (future.result()) {
+		return std::vector<bool>(succeeded.begin(), succeeded.end());
+	}
+
+	bool ArchiveAutoService::WriteArchive(const ArchiveJob& job)
+	{
+		const QString hostArchiveName = MOBase::normalizePathForHost(job.archiveName);
+		const QString hostSourceDir = MOBase::normalizePathForHost(job.sourceDir);
+		const char* gameId = gameIdFromNexusId(job.nexusId);
+		const int includeMode = includeModeFromArchiveType(job.type);
+
+#ifdef __linux__
+		const auto pack = job.reuseUnchanged ? bsa_ffi_repack_dir_filtered : bsa_ffi_pack_dir_filtered;
+		char* err = pack(
+			hostSourceDir.toUtf8().constData(),
+			hostArchiveName.toUtf8().constData(),
+			gameId,
+			includeMode,
+			nullptr,
+			nullptr);
+		if (err == nullptr) {
+			qDebug() << "packed archive via bsa_ffi for" << hostArchiveName;
 			return true;
 		}
 
-		return false;
+		qWarning() << "bsa_ffi primary pack failed for" << hostArchiveName
+				   << ":" << QString::fromUtf8(err)
+				   << "- falling back to libbsarch";
+		bsa_ffi_string_free(err);
+#endif
+		if (job.archive == nullptr) {
+			// packed straight from the source directory, nothing to fall back to
+			return false;
+		}
+		try {
+			job.archive->save_to_disk(hostArchiveName.toStdString());
+		} catch (std::exception&) {
+			return false;
+		}
+		return true;
 	}
 } // namespace BsaPacker
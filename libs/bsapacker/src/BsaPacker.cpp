@@ -14,6 +14,7 @@
 #include "ModDto.h"
 #include "OverrideFileService.h"
 #include "PackerDialog.h"
+#include "ProfileOptimizer.h"
 #include "SettingsService.h"
 #include <bsapacker/ModDtoFactory.h>
 #include <QMessageBox>
@@ -94,6 +95,22 @@ namespace BsaPacker
 			&archiveNameService,
 			&overrideFileService);
 		worker.DoWork();
+
+		if (packerDialog.RequestedProfileAction() != PackerDialog::ProfileAction::None) {
+			ProfileOptimizer optimizer(
+				this->m_Organizer,
+				this->m_SettingsService.get(),
+				this->m_ModContext.get(),
+				&archiveBuilderFactory,
+				&archiveAutoService,
+				&archiveNameService,
+				&dummyPluginServiceFactory);
+			if (packerDialog.RequestedProfileAction() == PackerDialog::ProfileAction::Optimize) {
+				optimizer.Optimize();
+			} else {
+				optimizer.Revert();
+			}
+		}
 	}
 
 } // namespace BsaPacker
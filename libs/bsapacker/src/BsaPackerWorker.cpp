@@ -4,6 +4,7 @@
 
 #include <bsapacker/ArchiveBuildDirector.h>
 #include <bsapacker/ModDtoFactory.h>
+#include "SettingsService.h"
 
 namespace BsaPacker
 {
@@ -32,24 +33,33 @@ namespace BsaPacker
 		QStringList createdArchives;
 		const std::unique_ptr<IModDto> modDto = this->m_ModDtoFactory->Create(); // handles PackerDialog and validation, implements Null Object pattern
 		const std::vector<bsa_archive_type_e> types = this->m_ArchiveBuilderFactory->GetArchiveTypes(modDto.get());
+
+		// the file lists are built one type after the other since they report progress
+		// on this thread, the archives of all types are then written together
+		std::vector<std::unique_ptr<libbsarch::bs_archive_auto>> archives;
+		std::vector<ArchiveJob> jobs;
+		const bool reuseUnchanged = this->m_SettingsService->GetPluginSetting(SettingsService::SETTING_REUSE_UNCHANGED_FILES).toBool();
 		for (auto&& type : types) {
 			const std::unique_ptr<IArchiveBuilder> builder = this->m_ArchiveBuilderFactory->Create(type, modDto.get());
 			ArchiveBuildDirector director(this->m_SettingsService, builder.get());
 			director.Construct(); // must check if cancelled
-			const std::vector<std::unique_ptr<libbsarch::bs_archive_auto>> archives = builder->getArchives();
-			for (const auto& archive : archives) {
+			for (auto& archive : builder->getArchives()) {
 				if (archive) {
 					const QFileInfo fileInfo(this->m_ArchiveNameService->GetArchiveFullPath(type, modDto.get()));
-					bool res = this->m_ArchiveAutoService->CreateBSA(
-						archive.get(), fileInfo.absoluteFilePath(), type,
-						modDto->Directory(), modDto->NexusId());
-					if (res) {
-						createdArchives.append(fileInfo.completeBaseName());
-					}
+					jobs.push_back({ archive.get(), fileInfo.absoluteFilePath(), type,
+									 modDto->Directory(), modDto->NexusId(), reuseUnchanged });
+					archives.push_back(std::move(archive));
 				}
 			}
 		}
 
+		const std::vector<bool> results = this->m_ArchiveAutoService->CreateBSAs(jobs);
+		for (size_t i = 0; i < jobs.size(); ++i) {
+			if (results[i]) {
+				createdArchives.append(QFileInfo(jobs[i].archiveName).completeBaseName());
+			}
+		}
+
 		if (!createdArchives.isEmpty()) {
 			QMessageBox::information(nullptr, "",
         QObject::tr("Created archive(s):") + "\n" + createdArchives.join(modDto->ArchiveExtension() +",\n") + modDto->ArchiveExtension());
@@ -29,6 +29,13 @@ namespace BsaPacker
 
 		this->listArchiveNames.setMinimumHeight(LIST_MIN_HEIGHT);
 
+		this->buttonOptimizeProfile.setText(QObject::tr("Optimize Profile"));
+		this->buttonOptimizeProfile.setToolTip(QObject::tr("Pack the loose files of all enabled mods that no other mod overwrites."));
+		this->buttonRevertProfile.setText(QObject::tr("Revert Optimization"));
+		this->buttonRevertProfile.setToolTip(QObject::tr("Restore the loose files of all optimized mods."));
+
+		this->layoutHorizontal.addWidget(&buttonOptimizeProfile);
+		this->layoutHorizontal.addWidget(&buttonRevertProfile);
 		this->layoutHorizontal.addStretch(1);
 		this->layoutHorizontal.addWidget(&buttonsOkCancelMod);
 
@@ -44,6 +51,14 @@ namespace BsaPacker
 		QObject::connect(&listArchiveNames, qOverload<QListWidgetItem*>(&QListWidget::itemDoubleClicked), this, &QDialog::accept);
 		QObject::connect(&buttonsOkCancelMod, &QDialogButtonBox::accepted, this, &QDialog::accept);
 		QObject::connect(&buttonsOkCancelMod, &QDialogButtonBox::rejected, this, &QDialog::reject);
+		QObject::connect(&buttonOptimizeProfile, &QPushButton::clicked, this, [this]() {
+			this->m_ProfileAction = ProfileAction::Optimize;
+			this->reject();
+		});
+		QObject::connect(&buttonRevertProfile, &QPushButton::clicked, this, [this]() {
+			this->m_ProfileAction = ProfileAction::Revert;
+			this->reject();
+		});
 		QObject::connect(&comboModList, qOverload<const QString&>(&QComboBox::currentTextChanged), [this](auto&& text) { this->UpdateNameList(text); });
 	}
 
@@ -85,6 +100,11 @@ namespace BsaPacker
 	 	return QDialog::exec();
 	}
 
+	PackerDialog::ProfileAction PackerDialog::RequestedProfileAction() const
+	{
+		return this->m_ProfileAction;
+	}
+
 	void PackerDialog::RefreshSelectedName()
 	{
 		Q_EMIT this->comboModList.currentTextChanged(this->comboModList.currentText());
@@ -7,6 +7,7 @@
 #include <QComboBox>
 #include <QDialogButtonBox>
 #include <QLabel>
+#include <QPushButton>
 #include <QHBoxLayout>
 #include <QVBoxLayout>
 
@@ -29,11 +30,16 @@ namespace BsaPacker
 		void RefreshSelectedName() override;
 		int Exec() override;
 
+		// set by the profile wide buttons, which close the dialog like Cancel does
+		enum class ProfileAction { None, Optimize, Revert };
+		[[nodiscard]] ProfileAction RequestedProfileAction() const;
+
 	public Q_SLOTS:
 		void RefreshOkButton() override;
 
 	private:
 		const IModContext* m_ModContext = nullptr;
+		ProfileAction m_ProfileAction = ProfileAction::None;
 
 		QComboBox comboModList;
 		QLabel labelChooseMod;
@@ -42,6 +48,8 @@ namespace BsaPacker
 		QVBoxLayout layoutVertical;
 		QHBoxLayout layoutHorizontal;
 		QDialogButtonBox buttonsOkCancelMod;
+		QPushButton buttonOptimizeProfile;
+		QPushButton buttonRevertProfile;
 	};
 } // namespace BsaPacker
 
@@ -0,0 +1,428 @@
+#include "ProfileOptimizer.h"
+
+#include "ModDto.h"
+#include "SettingsService.h"
+#include <imodinterface.h>
+#include <imodlist.h>
+#include <ipluginlist.h>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMessageBox>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+
+namespace BsaPacker
+{
+	const QString& ProfileOptimizer::MANIFEST_NAME = QStringLiteral("bsapacker_optimized.json");
+	const QString& ProfileOptimizer::STAGING_NAME = QStringLiteral(".bsapacker_staging");
+	const qint64 ProfileOptimizer::MAX_PACKED_SIZE = qint64(2000) * 1024 * 1024;
+
+	namespace
+	{
+		const QString& HIDDEN_EXT = QStringLiteral(".mohidden");
+
+		// read straight from the data directory by script extenders and installers
+		const QStringList& LOOSE_ONLY_DIRECTORIES = {
+			"skse", "f4se", "obse", "nvse", "fose", "sfse", "mwse", "fomod" };
+
+		const QStringList& PLUGIN_EXTENSIONS = { ".esm", ".esp", ".esl" };
+
+		struct ModPlan
+		{
+			QString name;
+			QString directory;
+			QString archiveBase;
+			QStringList candidates;  // every file of the mod, relative to it
+			QStringList files;       // the ones that are packed
+			std::vector<size_t> jobs;
+		};
+
+		bool isTextureArchive(const bsa_archive_type_e type)
+		{
+			return type == bsa_archive_type_e::baFO4dds || type == bsa_archive_type_e::baSFdds;
+		}
+
+		bool isSplitArchive(const bsa_archive_type_e type)
+		{
+			return isTextureArchive(type) || type == bsa_archive_type_e::baFO4 || type == bsa_archive_type_e::baSF;
+		}
+
+		// whether an archive of `type` takes `file`, games with separate texture archives
+		// filter them by extension
+		bool takesFile(const bsa_archive_type_e type, const QString& file)
+		{
+			if (!isSplitArchive(type)) {
+				return true;
+			}
+			return file.endsWith(QStringLiteral(".dds"), Qt::CaseInsensitive) == isTextureArchive(type);
+		}
+
+		// moves the files at `files` below `from` to the same paths below `to`, with
+		// `fromSuffix` replaced by `toSuffix`; stops at the first failure and returns how
+		// many were moved
+		qsizetype moveFiles(const QString& from, const QString& to, const QStringList& files,
+							const QString& fromSuffix, const QString& toSuffix)
+		{
+			qsizetype moved = 0;
+			for (const QString& file : files) {
+				const QString source = from + '/' + file + fromSuffix;
+				const QString target = to + '/' + file + toSuffix;
+				if (!QDir().mkpath(QFileInfo(target).path()) || !QFile::rename(source, target)) {
+					qWarning() << "Failed to move" << source << "to" << target;
+					break;
+				}
+				++moved;
+			}
+			return moved;
+		}
+
+		QStringList existingPlugins(const QString& directory, const QString& base)
+		{
+			QStringList plugins;
+			for (const QString& extension : PLUGIN_EXTENSIONS) {
+				if (QFileInfo(directory + '/' + base + extension).isFile()) {
+					plugins.append(base + extension);
+				}
+			}
+			return plugins;
+		}
+
+		// undoes what the manifest of the mod at `directory` lists, logs whatever can't be
+		// restored
+		bool revertMod(const QString& directory, const QJsonObject& manifest)
+		{
+			bool result = true;
+
+			const QStringList files = manifest.value(QStringLiteral("files")).toVariant().toStringList();
+			for (const QString& file : files) {
+				if (moveFiles(directory, directory, { file }, HIDDEN_EXT, QString()) != 1) {
+					result = false;
+				}
+			}
+
+			for (const QString& key : { QStringLiteral("archives"), QStringLiteral("plugins") }) {
+				for (const QString& name : manifest.value(key).toVariant().toStringList()) {
+					const QString path = directory + '/' + name;
+					if (QFileInfo::exists(path) && !QFile::remove(path)) {
+						qWarning() << "Failed to remove" << path;
+						result = false;
+					}
+				}
+			}
+
+			return result;
+		}
+
+		bool writeManifest(const QString& directory, const QJsonObject& manifest)
+		{
+			QSaveFile file(directory + '/' + ProfileOptimizer::MANIFEST_NAME);
+			if (!file.open(QIODevice::WriteOnly)) {
+				return false;
+			}
+			file.write(QJsonDocument(manifest).toJson());
+			return file.commit();
+		}
+	}
+
+	ProfileOptimizer::ProfileOptimizer(
+		MOBase::IOrganizer* organizer,
+		const ISettingsService* settingsService,
+		const IModContext* modContext,
+		const IArchiveBuilderFactory* archiveBuilderFactory,
+		const IArchiveAutoService* archiveAutoService,
+		const IArchiveNameService* archiveNameService,
+		const IDummyPluginServiceFactory* dummyPluginServiceFactory) :
+		m_Organizer(organizer),
+		m_SettingsService(settingsService),
+		m_ModContext(modContext),
+		m_ArchiveBuilderFactory(archiveBuilderFactory),
+		m_ArchiveAutoService(archiveAutoService),
+		m_ArchiveNameService(archiveNameService),
+		m_DummyPluginServiceFactory(dummyPluginServiceFactory)
+	{
+	}
+
+	bool ProfileOptimizer::IsPackable(
+		const QString& relativePath,
+		const QStringList& origins,
+		const QString& modName,
+		const QStringList& blacklist)
+	{
+		const qsizetype slash = relativePath.indexOf('/');
+		if (slash < 0) {
+			// plugins, archives, ini files and the like at the top of the mod
+			return false;
+		}
+
+		const QString top = relativePath.left(slash);
+		if (top == STAGING_NAME || LOOSE_ONLY_DIRECTORIES.contains(top, Qt::CaseInsensitive)) {
+			return false;
+		}
+		if (relativePath.endsWith(HIDDEN_EXT, Qt::CaseInsensitive) ||
+			relativePath.contains(HIDDEN_EXT + '/', Qt::CaseInsensitive)) {
+			return false;
+		}
+
+		const QString extension = '.' + QFileInfo(relativePath).suffix();
+		for (const QString& blacklisted : blacklist) {
+			if (!blacklisted.isEmpty() && extension.compare(blacklisted.trimmed(), Qt::CaseInsensitive) == 0) {
+				return false;
+			}
+		}
+
+		return origins.size() == 1 && origins.front().compare(modName, Qt::CaseInsensitive) == 0;
+	}
+
+	int ProfileOptimizer::Optimize() const
+	{
+		const QString extension = this->m_ArchiveNameService->GetFileExtension();
+		if (extension.isEmpty()) {
+			QMessageBox::information(nullptr, QStringLiteral("BSA Packer"),
+				QObject::tr("Archives are not supported for this game."));
+			return 0;
+		}
+
+		if (QMessageBox::question(nullptr, QStringLiteral("BSA Packer"),
+				QObject::tr("Pack the loose files of all enabled mods that no other mod overwrites into archives? "
+							"The packed files are hidden and can be restored with \"Revert Optimization\"."),
+				QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes) {
+			return 0;
+		}
+
+		const int nexusId = this->m_ModContext->GetNexusId();
+		const bool createPlugins = this->m_SettingsService->GetPluginSetting(SettingsService::SETTING_CREATE_PLUGINS).toBool();
+		const QStringList blacklist = this->m_SettingsService->GetPluginSetting(SettingsService::SETTING_BLACKLISTED_FILES).toString().split(';');
+
+		const ModDto typesDto(nexusId, QString(), QString(), extension);
+		const std::vector<bsa_archive_type_e> types = this->m_ArchiveBuilderFactory->GetArchiveTypes(&typesDto);
+
+		const MOBase::IModList* const modList = this->m_Organizer->modList();
+		std::vector<ModPlan> plans;
+		for (const QString& name : modList->allModsByProfilePriority()) {
+			const MOBase::IModInterface* const mod = modList->getMod(name);
+			if (mod == nullptr || mod->isSeparator() || mod->isForeign() || mod->isBackup() || mod->isOverwrite() ||
+				!(modList->state(name) & MOBase::IModList::STATE_ACTIVE)) {
+				continue;
+			}
+
+			const QString directory = mod->absolutePath();
+			if (QFileInfo::exists(directory + '/' + MANIFEST_NAME)) {
+				continue;
+			}
+			if (QFileInfo::exists(directory + '/' + STAGING_NAME)) {
+				qWarning() << "Skipping" << name << "which has files left over from an optimization that did not finish";
+				continue;
+			}
+
+			plans.push_back({ name, directory });
+		}
+
+		// mods are listed in parallel, the lookups below need all their files anyway
+		QtConcurrent::blockingMap(plans, [](ModPlan& plan) {
+			const QDir root(plan.directory);
+			QDirIterator iterator(plan.directory, QDir::Files, QDirIterator::Subdirectories);
+			while (iterator.hasNext()) {
+				plan.candidates.append(root.relativeFilePath(iterator.next()));
+			}
+		});
+
+		QList<MOBase::IOrganizer::FileQuery> queries;
+		for (const ModPlan& plan : plans) {
+			for (const QString& file : plan.candidates) {
+				queries.append({ file, {} });
+			}
+		}
+		const QList<QList<MOBase::IOrganizer::FileInfo>> found = this->m_Organizer->queryFiles(queries);
+
+		std::vector<ArchiveJob> jobs;
+		qsizetype next = 0;
+		for (ModPlan& plan : plans) {
+			qint64 size = 0;
+			for (const QString& file : plan.candidates) {
+				const auto& infos = found[next++];
+				const QStringList origins = infos.isEmpty() ? QStringList() : infos.front().origins;
+				if (!IsPackable(file, origins, plan.name, blacklist)) {
+					continue;
+				}
+				size += QFileInfo(plan.directory + '/' + file).size();
+				if (size > MAX_PACKED_SIZE) {
+					break;
+				}
+				plan.files.append(file);
+			}
+
+			if (plan.files.isEmpty()) {
+				continue;
+			}
+
+			// archives load with the plugin they're named after
+			QStringList bases;
+			for (const QString& plugin : QDir(plan.directory).entryList({ "*.esm", "*.esp", "*.esl" }, QDir::Files)) {
+				bases.append(QFileInfo(plugin).completeBaseName());
+			}
+			if (createPlugins) {
+				QString base = plan.name;
+				base.replace(QRegularExpression(QStringLiteral("[<>:\"/\\\\|?*]")), QStringLiteral("_"));
+				bases.append(base.simplified());
+			}
+
+			for (const QString& base : bases) {
+				const bool free = std::none_of(types.begin(), types.end(), [&](const bsa_archive_type_e type) {
+					return QFileInfo::exists(plan.directory + '/' + base + this->m_ArchiveNameService->Infix(type) + extension);
+				});
+				if (free && !base.isEmpty()) {
+					plan.archiveBase = base;
+					break;
+				}
+			}
+
+			if (plan.archiveBase.isEmpty()) {
+				qDebug() << "No archive name left for" << plan.name;
+				plan.files.clear();
+				continue;
+			}
+
+			const QString staging = plan.directory + '/' + STAGING_NAME;
+			const qsizetype staged = moveFiles(plan.directory, staging, plan.files, QString(), QString());
+			if (staged != plan.files.size()) {
+				moveFiles(staging, plan.directory, plan.files.mid(0, staged), QString(), QString());
+				QDir(staging).removeRecursively();
+				plan.files.clear();
+				continue;
+			}
+
+			for (const bsa_archive_type_e type : types) {
+				const bool used = std::any_of(plan.files.begin(), plan.files.end(), [&](const QString& file) {
+					return takesFile(type, file);
+				});
+				if (used) {
+					plan.jobs.push_back(jobs.size());
+					jobs.push_back({ nullptr,
+									 plan.directory + '/' + plan.archiveBase + this->m_ArchiveNameService->Infix(type) + extension,
+									 type, staging, nexusId, false });
+				}
+			}
+		}
+
+		const std::vector<bool> results = this->m_ArchiveAutoService->CreateBSAs(jobs);
+
+		int optimized = 0;
+		QStringList createdPlugins;
+		for (const ModPlan& plan : plans) {
+			if (plan.files.isEmpty()) {
+				continue;
+			}
+
+			const QString staging = plan.directory + '/' + STAGING_NAME;
+			const bool packed = std::all_of(plan.jobs.begin(), plan.jobs.end(), [&](const size_t job) {
+				return results[job];
+			});
+
+			QStringList archives;
+			for (const size_t job : plan.jobs) {
+				if (results[job]) {
+					archives.append(QFileInfo(jobs[job].archiveName).fileName());
+				}
+			}
+
+			QJsonObject manifest;
+			manifest.insert(QStringLiteral("archives"), QJsonArray::fromStringList(archives));
+
+			if (!packed) {
+				revertMod(plan.directory, manifest);
+				moveFiles(staging, plan.directory, plan.files, QString(), QString());
+				QDir(staging).removeRecursively();
+				continue;
+			}
+
+			const qsizetype hidden = moveFiles(staging, plan.directory, plan.files, QString(), HIDDEN_EXT);
+			manifest.insert(QStringLiteral("files"), QJsonArray::fromStringList(plan.files.mid(0, hidden)));
+
+			const QStringList existing = existingPlugins(plan.directory, plan.archiveBase);
+			this->m_DummyPluginServiceFactory->Create()->CreatePlugin(plan.directory, plan.archiveBase);
+			QStringList plugins;
+			for (const QString& plugin : existingPlugins(plan.directory, plan.archiveBase)) {
+				if (!existing.contains(plugin)) {
+					plugins.append(plugin);
+				}
+			}
+			manifest.insert(QStringLiteral("plugins"), QJsonArray::fromStringList(plugins));
+
+			if (hidden != plan.files.size() || !writeManifest(plan.directory, manifest)) {
+				// nothing may be left behind that Revert() doesn't know about
+				qWarning() << "Failed to optimize" << plan.name << ", restoring it";
+				revertMod(plan.directory, manifest);
+				moveFiles(staging, plan.directory, plan.files.mid(hidden), QString(), QString());
+				QDir(staging).removeRecursively();
+				continue;
+			}
+
+			QDir(staging).removeRecursively();
+			createdPlugins.append(plugins);
+			++optimized;
+		}
+
+		if (!createdPlugins.isEmpty()) {
+			MOBase::IOrganizer* const organizer = this->m_Organizer;
+			this->m_Organizer->onNextRefresh([organizer, createdPlugins]() {
+				for (const QString& plugin : createdPlugins) {
+					organizer->pluginList()->setState(plugin, MOBase::IPluginList::STATE_ACTIVE);
+				}
+			}, false);
+		}
+
+		if (optimized > 0) {
+			this->m_Organizer->refresh();
+		}
+
+		QMessageBox::information(nullptr, QStringLiteral("BSA Packer"),
+			QObject::tr("Optimized %1 mod(s).").arg(optimized));
+		return optimized;
+	}
+
+	int ProfileOptimizer::Revert() const
+	{
+		const MOBase::IModList* const modList = this->m_Organizer->modList();
+
+		int reverted = 0;
+		for (const QString& name : modList->allMods()) {
+			const MOBase::IModInterface* const mod = modList->getMod(name);
+			if (mod == nullptr) {
+				continue;
+			}
+
+			const QString path = mod->absolutePath() + '/' + MANIFEST_NAME;
+			QFile file(path);
+			if (!file.open(QIODevice::ReadOnly)) {
+				continue;
+			}
+			const QJsonObject manifest = QJsonDocument::fromJson(file.readAll()).object();
+			file.close();
+
+			if (!revertMod(mod->absolutePath(), manifest)) {
+				// kept so the rest can be restored by hand
+				qWarning() << "Failed to fully restore" << name;
+				continue;
+			}
+
+			QFile::remove(path);
+			++reverted;
+		}
+
+		if (reverted > 0) {
+			this->m_Organizer->refresh();
+		}
+
+		QMessageBox::information(nullptr, QStringLiteral("BSA Packer"),
+			QObject::tr("Restored %1 mod(s).").arg(reverted));
+		return reverted;
+	}
+} // namespace BsaPacker
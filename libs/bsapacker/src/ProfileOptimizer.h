@@ -0,0 +1,68 @@
+#ifndef PROFILEOPTIMIZER_H
+#define PROFILEOPTIMIZER_H
+
+#include "bsapacker_global.h"
+#include <bsapacker/IArchiveAutoService.h>
+#include <bsapacker/IArchiveBuilderFactory.h>
+#include <bsapacker/IArchiveNameService.h>
+#include <bsapacker/IDummyPluginServiceFactory.h>
+#include <bsapacker/IModContext.h>
+#include <bsapacker/ISettingsService.h>
+#include <imoinfo.h>
+
+namespace BsaPacker
+{
+	// Packs the loose files of all the enabled mods of the profile into archives, so the game
+	// and the VFS have a handful of archives to deal with instead of thousands of files.
+	// Only files that no other mod, archive or the game itself provides are packed, the
+	// archives load after all loose files so anything with a conflict would change sides.
+	//
+	// The archives are named after a plugin of the mod, or get a dummy plugin if it has
+	// none and creating them is enabled. The packed files are hidden and every optimized mod
+	// gets a manifest listing what was done, which Revert() uses to restore the mod.
+	class BSAPACKER_EXPORT ProfileOptimizer
+	{
+	public:
+		ProfileOptimizer(
+			MOBase::IOrganizer* organizer,
+			const ISettingsService* settingsService,
+			const IModContext* modContext,
+			const IArchiveBuilderFactory* archiveBuilderFactory,
+			const IArchiveAutoService* archiveAutoService,
+			const IArchiveNameService* archiveNameService,
+			const IDummyPluginServiceFactory* dummyPluginServiceFactory);
+
+		// packs the enabled mods that weren't optimized yet, the archives are written in
+		// parallel; returns the number of mods that were optimized
+		int Optimize() const;
+
+		// restores all the mods with a manifest, returns how many there were
+		int Revert() const;
+
+		// whether the file at `relativePath` of `modName` may be packed: it's in a
+		// subdirectory that isn't loaded from loose files only, its extension isn't in
+		// `blacklist` and the mod is its only origin
+		[[nodiscard]] static bool IsPackable(
+			const QString& relativePath,
+			const QStringList& origins,
+			const QString& modName,
+			const QStringList& blacklist);
+
+		static const QString& MANIFEST_NAME;
+		static const QString& STAGING_NAME;
+
+		// packed files beyond this stay loose, archives of older games can't be larger
+		static const qint64 MAX_PACKED_SIZE;
+
+	private:
+		MOBase::IOrganizer* m_Organizer = nullptr;
+		const ISettingsService* m_SettingsService = nullptr;
+		const IModContext* m_ModContext = nullptr;
+		const IArchiveBuilderFactory* m_ArchiveBuilderFactory = nullptr;
+		const IArchiveAutoService* m_ArchiveAutoService = nullptr;
+		const IArchiveNameService* m_ArchiveNameService = nullptr;
+		const IDummyPluginServiceFactory* m_DummyPluginServiceFactory = nullptr;
+	};
+} // namespace BsaPacker
+
+#endif // PROFILEOPTIMIZER_H
@@ -6,13 +6,15 @@ namespace BsaPacker
 	const QString& SettingsService::SETTING_CREATE_PLUGINS = QStringLiteral("create_plugins");
 	const QString& SettingsService::SETTING_BLACKLISTED_FILES = QStringLiteral("blacklisted_files");
 	const QString& SettingsService::SETTING_COMPRESS_ARCHIVES = QStringLiteral("compress_archives");
+	const QString& SettingsService::SETTING_REUSE_UNCHANGED_FILES = QStringLiteral("reuse_unchanged_files");
 	//const QString& SettingsService::SETTING_SPLIT_ARCHIVES = "split_archives";
 
 	const QList<MOBase::PluginSetting>& SettingsService::PluginSettings = {
 		MOBase::PluginSetting(SettingsService::SETTING_HIDE_LOOSE_ASSETS, QObject::tr("After creating the archive, set loose assets to hidden."), false),
 		MOBase::PluginSetting(SettingsService::SETTING_CREATE_PLUGINS, QObject::tr("Create a dummy plugin to load the archive if one does not exist."), false),
 		MOBase::PluginSetting(SettingsService::SETTING_BLACKLISTED_FILES, QObject::tr("Specify a semi-colon separated list of file extensions to ignore when packing."), ".txt;.hkx;.xml;.ini;.bk2"),
-		MOBase::PluginSetting(SettingsService::SETTING_COMPRESS_ARCHIVES, QObject::tr("Compress archives if they do not contain incompressible files. Texture archives for Fallout 4 and Starfield will always be compressed. Morrowind archives will never be compressed."), true)
+		MOBase::PluginSetting(SettingsService::SETTING_COMPRESS_ARCHIVES, QObject::tr("Compress archives if they do not contain incompressible files. Texture archives for Fallout 4 and Starfield will always be compressed. Morrowind archives will never be compressed."), true),
+		MOBase::PluginSetting(SettingsService::SETTING_REUSE_UNCHANGED_FILES, QObject::tr("When replacing an archive, copy the files that did not change from it instead of compressing them again."), true)
 		//MOBase::PluginSetting(SettingsService::SETTING_SPLIT_ARCHIVES, QObject::tr("Automatically create multiple archives if they exceed the size limit."), false);
 	};
 
@@ -68,6 +68,11 @@
         <source>Compress archives if they do not contain incompressible files. Texture archives for Fallout 4 and Starfield will always be compressed. Morrowind archives will never be compressed.</source>
         <translation type="unfinished"></translation>
     </message>
+    <message>
+        <location filename="SettingsService.cpp" line="17"/>
+        <source>When replacing an archive, copy the files that did not change from it instead of compressing them again.</source>
+        <translation type="unfinished"></translation>
+    </message>
     <message>
         <location filename="ArchiveAutoService.cpp" line="12"/>
         <source>Writing Archive</source>
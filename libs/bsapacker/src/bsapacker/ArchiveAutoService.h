@@ -13,6 +13,15 @@ namespace BsaPacker
 		bool CreateBSA(libbsarch::bs_archive_auto* archive, const QString& archiveName,
 					   bsa_archive_type_e type, const QString& sourceDir,
 					   int nexusId) const override;
+		std::vector<bool> CreateBSAs(const std::vector<ArchiveJob>& jobs) const override;
+
+		// archives written at the same time. bsa_ffi compresses each of them on its
+		// shared thread pool already, this mostly overlaps reading one archive's
+		// files with compressing another's
+		static const int MAX_CONCURRENT_ARCHIVES;
+
+	private:
+		static bool WriteArchive(const ArchiveJob& job);
 	};
 } // namespace BsaPacker
 
@@ -3,15 +3,29 @@
 
 #include <libbsarch/bs_archive_auto.hpp>
 #include <bsapacker/IModDto.h>
+#include <vector>
 
 namespace BsaPacker
 {
+	struct ArchiveJob
+	{
+		libbsarch::bs_archive_auto* archive = nullptr;
+		QString archiveName;
+		bsa_archive_type_e type;
+		QString sourceDir;
+		int nexusId = 0;
+		// copy the files that didn't change from an existing archive at archiveName
+		bool reuseUnchanged = false;
+	};
+
 	class IArchiveAutoService
 	{
 	public:
 		virtual ~IArchiveAutoService() = default;
 		virtual bool CreateBSA(libbsarch::bs_archive_auto*, const QString&, bsa_archive_type_e,
 							   const QString& sourceDir, int nexusId) const = 0;
+		// writes all jobs, several at once, returns whether each one succeeded
+		virtual std::vector<bool> CreateBSAs(const std::vector<ArchiveJob>& jobs) const = 0;
 	};
 }
 
@@ -23,4 +23,10 @@ namespace BsaPackerTests
 			auto result = ArchiveAutoService();
 		);
 	}
+
+	TEST_F(ArchiveAutoServiceFacts, CreateBSAs_NoJobs_ReturnsNoResults)
+	{
+		const ArchiveAutoService service;
+		EXPECT_TRUE(service.CreateBSAs({}).empty());
+	}
 }
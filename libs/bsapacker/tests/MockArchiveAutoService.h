@@ -6,5 +6,6 @@ using namespace BsaPacker;
 class MockArchiveAutoService : public IArchiveAutoService
 {
 public:
-	MOCK_METHOD(bool, CreateBSA, (libbsarch::bs_archive_auto *, const QString &, bsa_archive_type_e), (const, override));
+	MOCK_METHOD(bool, CreateBSA, (libbsarch::bs_archive_auto *, const QString &, bsa_archive_type_e, const QString &, int), (const, override));
+	MOCK_METHOD(std::vector<bool>, CreateBSAs, (const std::vector<ArchiveJob> &), (const, override));
 };
@@ -33,6 +33,7 @@ public:
 	MOCK_METHOD(QStringList, findFiles, (const QString &path, const QStringList &filter), (const, override));
 	MOCK_METHOD(QStringList, getFileOrigins, (const QString &fileName) ,(const, override));
 	MOCK_METHOD(QList<FileInfo>, findFileInfos, (const QString &path, const std::function<bool(const FileInfo&)> &filter), (const, override));
+	MOCK_METHOD(QList<QList<FileInfo>>, queryFiles, (const QList<FileQuery> &queries), (const, override));
 	MOCK_METHOD(std::shared_ptr<const IFileTree>, virtualFileTree, (), (const, override));
 	MOCK_METHOD(MOBase::IDownloadManager*, downloadManager, (), (const, override));
 	MOCK_METHOD(MOBase::IPluginList*, pluginList, (), (const, override));
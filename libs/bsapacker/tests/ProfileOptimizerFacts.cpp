@@ -0,0 +1,101 @@
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "ProfileOptimizer.h"
+#include "MockArchiveAutoService.h"
+#include "MockArchiveBuilderFactory.h"
+#include "MockArchiveNameService.h"
+#include "MockDummyPluginServiceFactory.h"
+#include "MockModContext.h"
+#include "MockOrganizer.h"
+#include "MockSettingsService.h"
+
+using namespace BsaPacker;
+using ::testing::NaggyMock;
+
+namespace BsaPackerTests
+{
+	class ProfileOptimizerFacts : public ::testing::Test
+	{
+	protected:
+		void SetUp() override {
+			naggyMockOrganizer = new NaggyMock<MockOrganizer>();
+			naggyMockSettingsService = new NaggyMock<MockSettingsService>();
+			naggyMockModContext = new NaggyMock<MockModContext>();
+			naggyMockArchiveBuilderFactory = new NaggyMock<MockArchiveBuilderFactory>();
+			naggyMockArchiveAutoService = new NaggyMock<MockArchiveAutoService>();
+			naggyMockArchiveNameService = new NaggyMock<MockArchiveNameService>();
+			naggyMockDummyPluginServiceFactory = new NaggyMock<MockDummyPluginServiceFactory>();
+		}
+
+		void TearDown() override {
+			delete naggyMockOrganizer;
+			delete naggyMockSettingsService;
+			delete naggyMockModContext;
+			delete naggyMockArchiveBuilderFactory;
+			delete naggyMockArchiveAutoService;
+			delete naggyMockArchiveNameService;
+			delete naggyMockDummyPluginServiceFactory;
+		}
+
+		NaggyMock<MockOrganizer>* naggyMockOrganizer;
+		NaggyMock<MockSettingsService>* naggyMockSettingsService;
+		NaggyMock<MockModContext>* naggyMockModContext;
+		NaggyMock<MockArchiveBuilderFactory>* naggyMockArchiveBuilderFactory;
+		NaggyMock<MockArchiveAutoService>* naggyMockArchiveAutoService;
+		NaggyMock<MockArchiveNameService>* naggyMockArchiveNameService;
+		NaggyMock<MockDummyPluginServiceFactory>* naggyMockDummyPluginServiceFactory;
+
+		const QStringList blacklist = { ".txt", ".hkx" };
+	};
+
+	TEST_F(ProfileOptimizerFacts, Ctor_Always_Constructs)
+	{
+		EXPECT_NO_THROW(
+			auto result = ProfileOptimizer(
+				naggyMockOrganizer,
+				naggyMockSettingsService,
+				naggyMockModContext,
+				naggyMockArchiveBuilderFactory,
+				naggyMockArchiveAutoService,
+				naggyMockArchiveNameService,
+				naggyMockDummyPluginServiceFactory);
+		);
+	}
+
+	TEST_F(ProfileOptimizerFacts, IsPackable_OnlyOrigin_ReturnsTrue)
+	{
+		EXPECT_TRUE(ProfileOptimizer::IsPackable("textures/rock.dds", { "Rocks" }, "Rocks", blacklist));
+	}
+
+	TEST_F(ProfileOptimizerFacts, IsPackable_Overwritten_ReturnsFalse)
+	{
+		EXPECT_FALSE(ProfileOptimizer::IsPackable("textures/rock.dds", { "Better Rocks", "Rocks" }, "Rocks", blacklist));
+	}
+
+	TEST_F(ProfileOptimizerFacts, IsPackable_InGameArchive_ReturnsFalse)
+	{
+		EXPECT_FALSE(ProfileOptimizer::IsPackable("textures/rock.dds", { "Rocks", "data" }, "Rocks", blacklist));
+	}
+
+	TEST_F(ProfileOptimizerFacts, IsPackable_TopLevelFile_ReturnsFalse)
+	{
+		EXPECT_FALSE(ProfileOptimizer::IsPackable("Rocks.esp", { "Rocks" }, "Rocks", blacklist));
+	}
+
+	TEST_F(ProfileOptimizerFacts, IsPackable_ScriptExtenderPlugin_ReturnsFalse)
+	{
+		EXPECT_FALSE(ProfileOptimizer::IsPackable("SKSE/Plugins/rocks.dll", { "Rocks" }, "Rocks", blacklist));
+	}
+
+	TEST_F(ProfileOptimizerFacts, IsPackable_Blacklisted_ReturnsFalse)
+	{
+		EXPECT_FALSE(ProfileOptimizer::IsPackable("meshes/rock.HKX", { "Rocks" }, "Rocks", blacklist));
+	}
+
+	TEST_F(ProfileOptimizerFacts, IsPackable_Hidden_ReturnsFalse)
+	{
+		EXPECT_FALSE(ProfileOptimizer::IsPackable("textures/rock.dds.mohidden", { "Rocks" }, "Rocks", blacklist));
+		EXPECT_FALSE(ProfileOptimizer::IsPackable("textures.mohidden/rock.dds", { "Rocks" }, "Rocks", blacklist));
+	}
+}
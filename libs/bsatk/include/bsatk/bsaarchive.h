@@ -21,9 +21,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef BSA_ARCHIVE_H
 #define BSA_ARCHIVE_H
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <queue>
+#include <span>
 #include <vector>
 
 #include <dxgiformat.h>
@@ -46,6 +48,8 @@ namespace BSA
 {
 
 class File;
+class MappedFile;
+class DataReader;
 
 /**
  * @brief top level structure to represent a bsa file
@@ -73,13 +77,21 @@ public:
   Archive();
   ~Archive();
   /**
-   * read the archive from file
+   * read the archive from file. The file is mapped into memory and stays mapped
+   * until the archive is closed
    * @param fileName name of the file to read from
-   * @param testHashes if true, the hashes of file names will be checked to ensure the
-   * file is valid. This can be skipped for performance reasons
+   * @param testHashes if true, verifyHashes() is run before returning. This can be
+   * skipped for performance reasons and done later
    * @return ERROR_NONE on success or an error code
    */
   EErrorCode read(const char* fileName, bool testHashes);
+  /**
+   * check the names of all files against the hashes stored in the archive. Safe to
+   * call from another thread while the archive is read from, so opening an archive
+   * doesn't have to wait for it
+   * @return ERROR_NONE if all names match or ERROR_INVALIDHASHES
+   */
+  EErrorCode verifyHashes() const;
   /**
    * write the archive to disc
    * @param fileName name of the file to write to
@@ -103,15 +115,61 @@ public:
    * retrieve top-level folder
    * @return descriptor of the root folder
    */
-  Folder::Ptr getRoot() { return m_RootFolder; }
+  Folder::Ptr getRoot() const { return m_RootFolder; }
   /**
-   * extract a file from the archive
+   * extract a file from the archive. Safe to call from several threads at once
    * @param file descriptor of the file to extract
    * @param outputDirectory name of the directory to extract to.
    *                        may be absolute or relative
    * @return ERROR_NONE on success or an error code
    */
   EErrorCode extract(File::Ptr file, const char* outputDirectory) const;
+  /**
+   * read the content of a file into memory. Safe to call from several threads at
+   * once
+   * @param file descriptor of the file to read
+   * @param data receives the content of the file. For files stored uncompressed this
+   *             points straight into the mapped archive and stays valid until the
+   *             archive is closed, otherwise into buffer
+   * @param buffer receives the decompressed content, left empty if the file didn't
+   *               need decompressing
+   * @return ERROR_NONE on success or an error code
+   */
+  EErrorCode readFile(const File::Ptr& file, std::span<const unsigned char>& data,
+                      DataBuffer& buffer) const;
+  /**
+   * determine the size of the content readFile() produces for a file without
+   * decompressing it. Safe to call from several threads at once
+   * @param file descriptor of the file
+   * @param size receives the size of the content
+   * @return ERROR_NONE on success or an error code
+   */
+  EErrorCode getContentSize(const File::Ptr& file, BSAULong& size) const;
+  /**
+   * determine the size of a BA2 texture without reading it
+   * @param file descriptor of the texture
+   * @param width receives the width of the largest mip
+   * @param height receives the height of the largest mip
+   * @param mipCount receives the number of mips
+   * @return ERROR_NONE on success or ERROR_INVALIDDATA if the file isn't a texture
+   */
+  EErrorCode getTextureInfo(const File::Ptr& file, BSAUInt& width, BSAUInt& height,
+                            BSAUInt& mipCount) const;
+  /**
+   * read a BA2 texture without its mips larger than `mip`. Textures are stored in
+   * chunks of one or more mips, only the chunk holding `mip` and the ones after it
+   * are decompressed. Safe to call from several threads at once
+   * @param file descriptor of the texture
+   * @param mip the largest mip needed, 0 for the full texture
+   * @param buffer receives a dds file whose largest mip is the first one of the chunk
+   *               holding `mip`, or the last chunk if there are less mips
+   * @param firstMip receives which mip of the texture that is, cubemaps are always
+   *                 read in full
+   * @return ERROR_NONE on success, ERROR_INVALIDDATA if the file isn't a texture or
+   *         another error code
+   */
+  EErrorCode readTextureMips(const File::Ptr& file, unsigned int mip,
+                             DataBuffer& buffer, unsigned int& firstMip) const;
   /**
    * @return archive flags
    */
@@ -141,7 +199,8 @@ public:
    * added to a folder, use BSA::Folder::addFile for that
    * @param name name of the file to be used inside the archive
    * @param sourceName filename path to the file to add
-   * @param compressed true if the file should be compressed (not supported yet!)
+   * @param compressed true if the file should be compressed, with zlib or LZ4 for
+   *                   Skyrim SE. Files that don't get smaller are stored as they are
    * @return pointer to the new file
    */
   File::Ptr createFile(const std::string& name, const std::string& sourceName,
@@ -166,25 +225,38 @@ private:
   struct FileInfo
   {
     File::Ptr file;
-    DataBuffer data;
+    std::span<const unsigned char> data;
+    DataBuffer buffer;
+  };
+
+  // a new file as it will be stored in the archive
+  struct PackedFile
+  {
+    std::vector<unsigned char> data;
+    EErrorCode result = ERROR_NONE;
+    bool compressed   = false;
+    bool ready        = false;
   };
 
+  // files compressed ahead of the one being written at most
+  static const std::size_t WRITE_WINDOW = 64;
+
 private:
-  static Header readHeader(std::fstream& infile);
+  static Header readHeader(DataReader& reader);
 
   static ArchiveType typeFromID(BSAULong typeID);
 
-  static std::shared_ptr<unsigned char[]> decompress(unsigned char* inBuffer,
-                                                     BSAULong inSize,
-                                                     EErrorCode& result,
-                                                     BSAULong& outSize);
+  static EErrorCode inflateInto(const unsigned char* inBuffer, BSAULong inSize,
+                                unsigned char* outBuffer, BSAULong outSize);
 
   BSAULong typeToID(ArchiveType type);
 
-  Folder readFolderRecord(std::fstream& file);
-
-  //  EErrorCode extractDirect(const File &fileInfo, std::ofstream &outFile);
-  //  EErrorCode extractCompressed(const File &fileInfo, std::ofstream &outFile);
+  bool isBA2() const
+  {
+    return m_Type == TYPE_FALLOUT4 || m_Type == TYPE_STARFIELD ||
+           m_Type == TYPE_STARFIELD_LZ4_TEXTURE || m_Type == TYPE_FALLOUT4NG_7 ||
+           m_Type == TYPE_FALLOUT4NG_8;
+  }
 
   bool defaultCompressed() const { return m_ArchiveFlags & FLAG_DEFAULTCOMPRESSED; }
   // starting with FO3 the bsa may prefix the file name to the file blob if archive flag
@@ -205,22 +277,35 @@ private:
   void writeHeader(std::fstream& outfile, BSAULong fileFlags, BSAULong numFolders,
                    BSAULong folderNamesLength, BSAULong fileNamesLength);
 
-  DirectX::DDS_HEADER getDDSHeader(File::Ptr file,
+  // reads a new file from disk, with its name in front if the archive has them,
+  // and compresses it if it should be. Safe to call from several threads at once
+  EErrorCode packFile(const File::Ptr& file, PackedFile& packed) const;
+
+  // writes the data of `files`, in that order; new files are packed on every core
+  // while they're written out in order
+  EErrorCode writeFileData(std::fstream& outfile, const std::vector<File::Ptr>& files);
+
+  // header of the texture as if `firstMip` was its largest mip
+  DirectX::DDS_HEADER getDDSHeader(File::Ptr file, unsigned int firstMip,
                                    DirectX::DDS_HEADER_DXT10& DX10Header,
                                    bool& isDX10) const;
   void getDX10Header(DirectX::DDS_HEADER_DXT10& DX10Header, File::Ptr file,
                      DirectX::DDS_HEADER DDSHeader) const;
 
-  EErrorCode extractDirect(File::Ptr file, std::ofstream& outFile) const;
-  EErrorCode extractCompressed(File::Ptr file, std::ofstream& outFile) const;
+  // a dds file with the chunks of a texture from `firstChunk` on
+  EErrorCode readTexture(const File::Ptr& file, std::size_t firstChunk,
+                         DataBuffer& buffer) const;
+
+  // offset and size of the stored data of a non-texture file, past the name
+  // prefix if there is one
+  EErrorCode locateData(const File::Ptr& file, BSAHash& offset, BSAULong& size) const;
 
   void createFolders(const std::string& targetDirectory, Folder::Ptr folder);
 
   void readFiles(std::queue<FileInfo>& queue, boost::mutex& mutex,
                  boost::interprocess::interprocess_semaphore& bufferCount,
                  boost::interprocess::interprocess_semaphore& queueFree,
-                 std::vector<File::Ptr>::iterator begin,
-                 std::vector<File::Ptr>::iterator end);
+                 const std::vector<File::Ptr>& files, std::atomic<std::size_t>& next);
 
   void extractFiles(const std::string& targetDirectory, std::queue<FileInfo>& queue,
                     boost::mutex& mutex,
@@ -231,7 +316,7 @@ private:
   void cleanFolder(Folder::Ptr folder);
 
 private:
-  mutable std::fstream m_File;
+  std::unique_ptr<MappedFile> m_File;
 
   Folder::Ptr m_RootFolder;
 
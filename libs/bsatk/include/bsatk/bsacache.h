@@ -0,0 +1,103 @@
+/*
+Mod Organizer BSA handling
+
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef BSACACHE_H
+#define BSACACHE_H
+
+#include "bsaarchive.h"
+#include "errorcodes.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace BSA
+{
+
+/**
+ * archives opened for reading and kept open, so the same archive isn't parsed
+ * again for every preview, conflict lookup or directory refresh. entries are
+ * checked against the size and modification time of the file whenever they're
+ * handed out and the least recently used archives are closed once there are
+ * more than the capacity.
+ * bsatk is linked statically, so every module has its own instance().
+ * thread-safe
+ */
+class ArchiveCache
+{
+public:
+  static const std::size_t DEFAULT_CAPACITY = 8;
+
+  /**
+   * @return the cache shared by everything in this module
+   */
+  static ArchiveCache& instance();
+
+  explicit ArchiveCache(std::size_t capacity = DEFAULT_CAPACITY);
+
+  /**
+   * the archive at `fileName`, read without testing hashes if it's not cached
+   * or changed since it was
+   * @param fileName name of the archive
+   * @param error receives the result of reading the archive, may be null
+   * @return the archive or null if it can't be read
+   */
+  std::shared_ptr<const Archive> get(const std::string& fileName,
+                                     EErrorCode* error = nullptr);
+
+  /**
+   * forget the archive at `fileName`, it's closed as soon as nobody uses it
+   * anymore
+   */
+  void remove(const std::string& fileName);
+
+  /**
+   * forget all archives
+   */
+  void clear();
+
+  /**
+   * @param capacity number of archives kept open, least recently used ones are
+   *                 closed first when there are more
+   */
+  void setCapacity(std::size_t capacity);
+
+private:
+  struct Entry
+  {
+    std::string fileName;
+    uint64_t size     = 0;
+    int64_t writeTime = 0;
+    std::shared_ptr<const Archive> archive;
+  };
+
+  void trim();
+
+  std::mutex m_Mutex;
+  // most recently used first
+  std::list<Entry> m_Entries;
+  std::size_t m_Capacity;
+};
+
+}  // namespace BSA
+
+#endif  // BSACACHE_H
@@ -32,6 +32,8 @@ namespace BSA
 {
 
 class Folder;
+class DataReader;
+class MappedFile;
 
 class File
 {
@@ -73,11 +75,10 @@ private:
 
   /**
    * construct file from source archive
-   * @param file a file read from
+   * @param reader the archive to read from, placed at the file record
    * @param folder the folder to add the file to
-   * @param type the archive type we're parsing
    */
-  File(std::fstream& file, Folder* folder);
+  File(DataReader& reader, Folder* folder);
 
   /**
    * construct file from morrowind BSA or BA2
@@ -113,11 +114,10 @@ private:
    */
   BSAHash getDataOffset() const { return m_DataOffset; }
   void writeHeader(std::fstream& file) const;
-  EErrorCode writeData(std::fstream& sourceArchive, std::fstream& targetArchive) const;
 
   void setFileSize(BSAULong fileSize) { m_FileSize = fileSize; }
 
-  void readFileName(std::fstream& file, bool testHashes);
+  void readFileName(DataReader& reader);
 
 private:
   Folder* m_Folder;
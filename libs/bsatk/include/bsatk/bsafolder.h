@@ -26,12 +26,16 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "errorcodes.h"
 #include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 namespace BSA
 {
 
+class DataReader;
+class MappedFile;
+
 class Folder
 {
 
@@ -76,11 +80,22 @@ public:
    * @throw out_of_range this will throw an exception if the index is invalid
    */
   const File::Ptr getFile(unsigned int index) const;
+  /**
+   * look up a file by its path relative to this folder, ignoring case
+   * @param path path of the file, components may be separated by slashes or
+   *             backslashes
+   * @return a descriptor for the file or nullptr if there is no such file
+   */
+  File::Ptr findFile(const std::string& path) const;
   /**
    * adds a new file to the folder
    * @param file the new file to add
    */
-  void addFile(const File::Ptr& file) { m_Files.push_back(file); }
+  void addFile(const File::Ptr& file)
+  {
+    file->m_Folder = this;
+    m_Files.push_back(file);
+  }
   /**
    * add an empty folder as a subfolder to this one.
    * @param folderName name of the new folder
@@ -104,7 +119,7 @@ private:
   /**
    * factory function to read a folder object from disc. This also reads part of the
    * information about the files within
-   * @param file file stream to read from, already placed at the correct position
+   * @param reader archive to read from, already placed at the correct position
    * @param fileNamesLength length of the file names list. This is required to correctly
    * calculate offsets
    * @param endPos position inside file where the last folder header ends. This is
@@ -112,9 +127,9 @@ private:
    * folders are read
    * @return the new Folder object
    */
-  Folder::Ptr readFolder(std::fstream& file, BSAUInt fileNamesLength, BSAUInt& endPos);
+  Folder::Ptr readFolder(DataReader& reader, BSAUInt fileNamesLength, BSAUInt& endPos);
 
-  Folder::Ptr readFolderSE(std::fstream& file, BSAUInt fileNamesLength,
+  Folder::Ptr readFolderSE(DataReader& reader, BSAUInt fileNamesLength,
                            BSAUInt& endPos);
 
   /**
@@ -123,6 +138,11 @@ private:
    */
   void addFolderInt(Folder::Ptr folder);
 
+  /**
+   * recursive part of findFile(), path is lowercase and uses backslashes
+   */
+  File::Ptr findFileInt(std::string_view path) const;
+
   /**
    * recursive function that returns an existing folder match or generates the structure
    * for a new folder
@@ -135,18 +155,18 @@ private:
    * Add a new folder to the structure.
    * It will automatically be added to the correct sub-folder if applicable.
    */
-  Folder::Ptr addFolder(std::fstream& file, BSAUInt fileNamesLength, BSAUInt& endPos,
+  Folder::Ptr addFolder(DataReader& reader, BSAUInt fileNamesLength, BSAUInt& endPos,
                         ArchiveType type);
 
   Folder::Ptr addFolderFromFile(std::string filePath, BSAUInt size, BSAHash offset,
                                 BSAUInt uncompressedSize, FO4TextureHeader header,
                                 std::vector<FO4TextureChunk>& texChunks);
 
-  bool resolveFileNames(std::fstream& file, bool testHashes);
+  // false if any of the names can't be read
+  bool resolveFileNames(DataReader& reader);
 
-  void writeHeader(std::fstream& file) const;
+  void writeHeader(std::fstream& file, ArchiveType type) const;
   void writeData(std::fstream& file, BSAULong fileNamesLength) const;
-  EErrorCode writeFileData(std::fstream& sourceFile, std::fstream& targetFile) const;
   void collectFolders(std::vector<Folder::Ptr>& folderList) const;
   void collectFiles(std::vector<File::Ptr>& fileList) const;
   void collectFileNames(std::vector<std::string>& nameList) const;
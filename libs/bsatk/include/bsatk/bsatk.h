@@ -9,6 +9,7 @@
 #define BSATK_H
 
 #include "bsaarchive.h"
+#include "bsacache.h"
 #include "bsafile.h"
 #include "bsafolder.h"
 
@@ -21,10 +21,18 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef FILEHASH_H
 #define FILEHASH_H
 
-#include <string>
+#include <cstddef>
+#include <string_view>
 
 #include "bsatypes.h"
 
-BSAHash calculateBSAHash(const std::string& fileName);
+BSAHash calculateBSAHash(std::string_view fileName);
+
+/**
+ * hash `count` names into `hashes`, which is what checking the names of a whole
+ * archive comes down to. no name is copied, they're lowered as they're hashed
+ */
+void calculateBSAHashes(const std::string_view* fileNames, std::size_t count,
+                        BSAHash* hashes);
 
 #endif  // FILEHASH_H
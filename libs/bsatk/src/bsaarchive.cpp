@@ -22,7 +22,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "bsaexception.h"
 #include "bsafile.h"
 #include "bsafolder.h"
+#include "filehash.h"
+#include "mappedfile.h"
 #include <algorithm>
+#include <climits>
 #include <boost/interprocess/sync/interprocess_semaphore.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
 #include <boost/shared_array.hpp>
@@ -34,6 +37,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <lz4frame.h>
 #include <memory>
 #include <queue>
+#include <string_view>
 #include <sys/stat.h>
 #include <zlib.h>
 #ifdef _WIN32
@@ -49,15 +53,13 @@ namespace BSA
 {
 
 Archive::Archive()
-    : m_RootFolder(new Folder), m_ArchiveFlags(FLAG_HASDIRNAMES | FLAG_HASFILENAMES),
+    : m_File(std::make_unique<MappedFile>()), m_RootFolder(new Folder), m_ArchiveFlags(FLAG_HASDIRNAMES | FLAG_HASFILENAMES),
       m_Type(TYPE_SKYRIM)
 {}
 
 Archive::~Archive()
 {
-  if (m_File.is_open()) {
-    m_File.close();
-  }
+  m_File->close();
   std::vector<Folder::Ptr> folders;
   m_RootFolder->collectFolders(folders);
   cleanFolder(m_RootFolder);
@@ -116,41 +118,41 @@ BSAULong Archive::typeToID(ArchiveType type)
   }
 }
 
-Archive::Header Archive::readHeader(std::fstream& infile)
+Archive::Header Archive::readHeader(DataReader& reader)
 {
   Header result;
 
-  result.fileIdentifier = readType<uint32_t>(infile);
+  result.fileIdentifier = reader.read<uint32_t>();
   if (result.fileIdentifier != 0x00415342 && result.fileIdentifier != 0x58445442 &&
       result.fileIdentifier != 0x00000100) {
     throw data_invalid_exception(makeString("not a bsa or ba2 file"));
   }
 
   if (result.fileIdentifier != 0x00000100) {
-    ArchiveType type = typeFromID(readType<BSAUInt>(infile));
+    ArchiveType type = typeFromID(reader.read<BSAUInt>());
     if (type == TYPE_FALLOUT4 || type == TYPE_STARFIELD ||
         type == TYPE_STARFIELD_LZ4_TEXTURE || type == TYPE_FALLOUT4NG_7 ||
         type == TYPE_FALLOUT4NG_8) {
       result.type = type;
-      infile.read(result.archType, 4);
+      reader.read(result.archType, 4);
       result.archType[4]     = '\0';
-      result.fileCount       = readType<BSAUInt>(infile);
-      result.nameTableOffset = readType<BSAHash>(infile);
+      result.fileCount       = reader.read<BSAUInt>();
+      result.nameTableOffset = reader.read<BSAHash>();
       result.archiveFlags    = FLAG_HASDIRNAMES | FLAG_HASFILENAMES;
     } else {
       result.type             = type;
-      result.offset           = readType<BSAUInt>(infile);
-      result.archiveFlags     = readType<BSAUInt>(infile);
-      result.folderCount      = readType<BSAUInt>(infile);
-      result.fileCount        = readType<BSAUInt>(infile);
-      result.folderNameLength = readType<BSAUInt>(infile);
-      result.fileNameLength   = readType<BSAUInt>(infile);
-      result.fileFlags        = readType<BSAUInt>(infile);
+      result.offset           = reader.read<BSAUInt>();
+      result.archiveFlags     = reader.read<BSAUInt>();
+      result.folderCount      = reader.read<BSAUInt>();
+      result.fileCount        = reader.read<BSAUInt>();
+      result.folderNameLength = reader.read<BSAUInt>();
+      result.fileNameLength   = reader.read<BSAUInt>();
+      result.fileFlags        = reader.read<BSAUInt>();
     }
   } else {
     result.type         = TYPE_MORROWIND;
-    result.offset       = readType<BSAUInt>(infile);
-    result.fileCount    = readType<BSAUInt>(infile);
+    result.offset       = reader.read<BSAUInt>();
+    result.fileCount    = reader.read<BSAUInt>();
     result.archiveFlags = FLAG_HASDIRNAMES | FLAG_HASFILENAMES;
   }
 
@@ -159,153 +161,169 @@ Archive::Header Archive::readHeader(std::fstream& infile)
 
 EErrorCode Archive::read(const char* fileName, bool testHashes)
 {
-  m_File.open(fileName, fstream::in | fstream::binary);
-  if (!m_File.is_open()) {
+  if (!m_File->open(fileName)) {
     return ERROR_FILENOTFOUND;
   }
-  m_File.exceptions(std::ios_base::badbit);
-  try {
-    Header header;
-    try {
-      header = readHeader(m_File);
-    } catch (const data_invalid_exception& e) {
-      throw data_invalid_exception(makeString("%s (filename: %s)", e.what(), fileName));
-    }
-    m_ArchiveFlags = header.archiveFlags;
-    m_Type         = header.type;
-    if (m_Type == TYPE_FALLOUT4 || m_Type == TYPE_STARFIELD ||
-        m_Type == TYPE_STARFIELD_LZ4_TEXTURE || m_Type == TYPE_FALLOUT4NG_7 ||
-        m_Type == TYPE_FALLOUT4NG_8) {
 
-      m_File.seekg(header.nameTableOffset);
+  // every record is parsed straight from the mapped view
+  DataReader reader(*m_File);
 
-      std::vector<std::string> fileNames;
+  Header header;
+  try {
+    header = readHeader(reader);
+  } catch (const data_invalid_exception& e) {
+    throw data_invalid_exception(makeString("%s (filename: %s)", e.what(), fileName));
+  }
+  m_ArchiveFlags = header.archiveFlags;
+  m_Type         = header.type;
+  if (isBA2()) {
+    reader.seek(header.nameTableOffset);
+
+    std::vector<std::string> fileNames;
+    fileNames.reserve(header.fileCount);
+    for (unsigned int i = 0; i < header.fileCount; ++i) {
+      const BSAUShort length = reader.read<BSAUShort>();
+      fileNames.push_back(reader.readString(length));
+    }
+    std::size_t offset;
+    switch (m_Type) {
+    case TYPE_STARFIELD:
+      offset = 32;
+      break;
+    case TYPE_STARFIELD_LZ4_TEXTURE:
+      offset = 36;
+      break;
+    default:
+      offset = 24;
+    }
+    if (strcmp(header.archType, "GNRL") == 0) {
+      reader.seek(offset);
       for (unsigned int i = 0; i < header.fileCount; ++i) {
-        BSAUShort length = readType<BSAUShort>(m_File);
-
-        char* file = new char[length + 1];
-        m_File.read(file, length);
-        file[length] = '\0';
-
-        fileNames.push_back(file);
-        delete[] file;
-      }
-      std::streamoff offset;
-      switch (m_Type) {
-      case TYPE_STARFIELD:
-        offset = 32;
-        break;
-      case TYPE_STARFIELD_LZ4_TEXTURE:
-        offset = 36;
-        break;
-      default:
-        offset = 24;
+        // name hash, extension, directory hash and flags
+        reader.skip(16);
+        BSAHash dataOffset   = reader.read<BSAHash>();
+        BSAUInt packedSize   = reader.read<BSAUInt>();
+        BSAUInt unpackedSize = reader.read<BSAUInt>();
+        reader.skip(4);
+        std::vector<FO4TextureChunk> dummy;
+        m_RootFolder->addFolderFromFile(fileNames[i], packedSize, dataOffset,
+                                        unpackedSize, {}, dummy);
       }
-      if (strcmp(header.archType, "GNRL") == 0) {
-        m_File.seekg(offset, std::ios::beg);
-        for (unsigned int i = 0; i < header.fileCount; ++i) {
-          BSAUInt nameHash = readType<BSAUInt>(m_File);
-          char* extension  = new char[4];
-          m_File.read(extension, 4);
-          BSAUInt dirHash = readType<BSAUInt>(m_File);
-          m_File.seekg(4, std::ios::cur);
-          BSAHash offset       = readType<BSAHash>(m_File);
-          BSAUInt packedSize   = readType<BSAUInt>(m_File);
-          BSAUInt unpackedSize = readType<BSAUInt>(m_File);
-          m_File.seekg(4, std::ios::cur);
-          std::vector<FO4TextureChunk> dummy;
-          Folder::Ptr newDir = m_RootFolder->addFolderFromFile(
-              fileNames[i], packedSize, offset, unpackedSize, {}, dummy);
-          delete[] extension;
+    } else if (strcmp(header.archType, "DX10") == 0) {
+      reader.seek(offset);
+      for (unsigned int i = 0; i < header.fileCount; ++i) {
+        FO4TextureHeader texHeader;
+        texHeader.nameHash = reader.read<BSAUInt>();
+        reader.read(texHeader.extension, 4);
+        texHeader.dirHash         = reader.read<BSAUInt>();
+        texHeader.unknown1        = reader.read<BSAUChar>();
+        texHeader.chunkNumber     = reader.read<BSAUChar>();
+        texHeader.chunkHeaderSize = reader.read<BSAUShort>();
+        texHeader.height          = reader.read<BSAUShort>();
+        texHeader.width           = reader.read<BSAUShort>();
+        texHeader.mipCount        = reader.read<BSAUChar>();
+        texHeader.format          = static_cast<DXGI_FORMAT>(reader.read<BSAUChar>());
+        texHeader.isCubemap       = reader.read<BSAUChar>() != 0;
+        texHeader.unknown2        = reader.read<BSAUChar>();
+        std::vector<FO4TextureChunk> chunks;
+        for (unsigned int j = 0; j < texHeader.chunkNumber; ++j) {
+          FO4TextureChunk chunk;
+          chunk.offset       = reader.read<BSAHash>();
+          chunk.packedSize   = reader.read<BSAUInt>();
+          chunk.unpackedSize = reader.read<BSAUInt>();
+          chunk.startMip     = reader.read<BSAUShort>();
+          chunk.endMip       = reader.read<BSAUShort>();
+          chunk.unknown      = reader.read<BSAUInt>();
+          chunks.push_back(chunk);
         }
-      } else if (strcmp(header.archType, "DX10") == 0) {
-        m_File.seekg(offset, std::ios::beg);
-        for (unsigned int i = 0; i < header.fileCount; ++i) {
-          FO4TextureHeader texHeader;
-          texHeader.nameHash = readType<BSAUInt>(m_File);
-          m_File.read(texHeader.extension, 4);
-          texHeader.dirHash         = readType<BSAUInt>(m_File);
-          texHeader.unknown1        = readType<BSAUChar>(m_File);
-          texHeader.chunkNumber     = readType<BSAUChar>(m_File);
-          texHeader.chunkHeaderSize = readType<BSAUShort>(m_File);
-          texHeader.height          = readType<BSAUShort>(m_File);
-          texHeader.width           = readType<BSAUShort>(m_File);
-          texHeader.mipCount        = readType<BSAUChar>(m_File);
-          texHeader.format    = static_cast<DXGI_FORMAT>(readType<BSAUChar>(m_File));
-          texHeader.isCubemap = readType<bool>(m_File);
-          texHeader.unknown2  = readType<BSAUChar>(m_File);
-          std::vector<FO4TextureChunk> chunks;
-          for (unsigned int j = 0; j < texHeader.chunkNumber; ++j) {
-            FO4TextureChunk chunk;
-            chunk.offset       = readType<BSAHash>(m_File);
-            chunk.packedSize   = readType<BSAUInt>(m_File);
-            chunk.unpackedSize = readType<BSAUInt>(m_File);
-            chunk.startMip     = readType<BSAUShort>(m_File);
-            chunk.endMip       = readType<BSAUShort>(m_File);
-            chunk.unknown      = readType<BSAUInt>(m_File);
-            chunks.push_back(chunk);
-          }
-          Folder::Ptr newDir = m_RootFolder->addFolderFromFile(
-              fileNames[i], chunks[0].packedSize, chunks[0].offset,
-              chunks[0].unpackedSize, texHeader, chunks);
+        if (chunks.empty()) {
+          throw data_invalid_exception(
+              makeString("texture without chunks (filename: %s)", fileName));
         }
+        m_RootFolder->addFolderFromFile(fileNames[i], chunks[0].packedSize,
+                                        chunks[0].offset, chunks[0].unpackedSize,
+                                        texHeader, chunks);
       }
+    }
 
-      return ERROR_NONE;
-    } else if (m_Type == TYPE_MORROWIND) {
-      BSAUInt dataOffset = 12 + header.offset + header.fileCount * 8;
-
-      std::vector<MorrowindFileOffset> fileSizeOffset(header.fileCount);
-      m_File.read((char*)fileSizeOffset.data(),
-                  header.fileCount * sizeof(MorrowindFileOffset));
-      std::vector<BSAUInt> fileNameOffset(header.fileCount);
-      m_File.read((char*)fileNameOffset.data(), header.fileCount * sizeof(BSAUInt));
-      BSAUInt last = header.offset - 12 * header.fileCount;
-      for (uint32_t i = 0; i < header.fileCount; ++i) {
-        uint32_t index = 0;
-        if (i + 1 == header.fileCount)
-          index = last;
-        else
-          index = fileNameOffset[i + 1] - fileNameOffset[i];
-        char* filePath = new char[index + 1];
-        m_File.read(filePath, index);
-        filePath[index] = '\0';
+    return ERROR_NONE;
+  } else if (m_Type == TYPE_MORROWIND) {
+    BSAUInt dataOffset = 12 + header.offset + header.fileCount * 8;
+
+    std::vector<MorrowindFileOffset> fileSizeOffset(header.fileCount);
+    reader.read(fileSizeOffset.data(), header.fileCount * sizeof(MorrowindFileOffset));
+    std::vector<BSAUInt> fileNameOffset(header.fileCount);
+    reader.read(fileNameOffset.data(), header.fileCount * sizeof(BSAUInt));
+    BSAUInt last = header.offset - 12 * header.fileCount;
+    for (uint32_t i = 0; i < header.fileCount; ++i) {
+      uint32_t index = 0;
+      if (i + 1 == header.fileCount)
+        index = last;
+      else
+        index = fileNameOffset[i + 1] - fileNameOffset[i];
+
+      std::vector<FO4TextureChunk> dummy;
+      m_RootFolder->addFolderFromFile(reader.readString(index), fileSizeOffset[i].size,
+                                      dataOffset + fileSizeOffset[i].offset, 0, {},
+                                      dummy);
+    }
+    return ERROR_NONE;
+  } else {
+    // flat list of folders as they were stored in the archive
+    std::vector<Folder::Ptr> folders;
 
-        std::vector<FO4TextureChunk> dummy;
-        Folder::Ptr newDir = m_RootFolder->addFolderFromFile(
-            filePath, fileSizeOffset[i].size, dataOffset + fileSizeOffset[i].offset, 0,
-            {}, dummy);
-        delete[] filePath;
-      }
-      return ERROR_NONE;
-    } else {
-      // flat list of folders as they were stored in the archive
-      std::vector<Folder::Ptr> folders;
+    for (unsigned long i = 0; i < header.folderCount; ++i) {
+      folders.push_back(m_RootFolder->addFolder(reader, header.fileNameLength,
+                                                header.offset, header.type));
+    }
+
+    reader.seek(header.offset);
 
-      for (unsigned long i = 0; i < header.folderCount; ++i) {
-        folders.push_back(m_RootFolder->addFolder(m_File, header.fileNameLength,
-                                                  header.offset, header.type));
+    bool namesValid = true;
+    for (std::vector<Folder::Ptr>::iterator iter = folders.begin();
+         iter != folders.end(); ++iter) {
+      if (!(*iter)->resolveFileNames(reader)) {
+        namesValid = false;
       }
+    }
+    if (!namesValid) {
+      return ERROR_INVALIDHASHES;
+    }
+    return testHashes ? verifyHashes() : ERROR_NONE;
+  }
+}
 
-      m_File.seekg(header.offset);
+EErrorCode Archive::verifyHashes() const
+{
+  // only the names in tes4 archives are checked against their hashes
+  if (isBA2() || m_Type == TYPE_MORROWIND) {
+    return ERROR_NONE;
+  }
 
-      bool hashesValid = true;
-      for (std::vector<Folder::Ptr>::iterator iter = folders.begin();
-           iter != folders.end(); ++iter) {
-        if (!(*iter)->resolveFileNames(m_File, testHashes)) {
-          hashesValid = false;
-        }
-      }
-      return hashesValid ? ERROR_NONE : ERROR_INVALIDHASHES;
+  std::vector<File::Ptr> files;
+  m_RootFolder->collectFiles(files);
+
+  std::vector<std::string_view> names;
+  names.reserve(files.size());
+  for (const auto& file : files) {
+    names.push_back(file->m_Name);
+  }
+
+  std::vector<BSAHash> hashes(files.size());
+  calculateBSAHashes(names.data(), names.size(), hashes.data());
+
+  for (std::size_t i = 0; i < files.size(); ++i) {
+    if (hashes[i] != files[i]->m_NameHash) {
+      return ERROR_INVALIDHASHES;
     }
-  } catch (std::ios_base::failure&) {
-    return ERROR_INVALIDDATA;
   }
+
+  return ERROR_NONE;
 }
 
 void Archive::close()
 {
-  m_File.close();
+  m_File->close();
 }
 
 BSAULong Archive::countFiles() const
@@ -402,15 +420,16 @@ void Archive::writeHeader(std::fstream& outfile, BSAULong fileFlags,
                           BSAULong numFolders, BSAULong folderNamesLength,
                           BSAULong fileNamesLength)
 {
+  // the fields are 4 bytes everywhere, unsigned long isn't
   outfile.write("BSA\0", 4);
-  writeType<BSAULong>(outfile, typeToID(m_Type));
-  writeType<BSAULong>(outfile, 0x24);  // header size is static
-  writeType<BSAULong>(outfile, m_ArchiveFlags);
-  writeType<BSAULong>(outfile, numFolders);
-  writeType<BSAULong>(outfile, countFiles());
-  writeType<BSAULong>(outfile, folderNamesLength);
-  writeType<BSAULong>(outfile, fileNamesLength);
-  writeType<BSAULong>(outfile, fileFlags);
+  writeType<BSAUInt>(outfile, static_cast<BSAUInt>(typeToID(m_Type)));
+  writeType<BSAUInt>(outfile, 0x24);  // header size is static
+  writeType<BSAUInt>(outfile, static_cast<BSAUInt>(m_ArchiveFlags));
+  writeType<BSAUInt>(outfile, static_cast<BSAUInt>(numFolders));
+  writeType<BSAUInt>(outfile, static_cast<BSAUInt>(countFiles()));
+  writeType<BSAUInt>(outfile, static_cast<BSAUInt>(folderNamesLength));
+  writeType<BSAUInt>(outfile, static_cast<BSAUInt>(fileNamesLength));
+  writeType<BSAUInt>(outfile, static_cast<BSAUInt>(fileFlags));
 }
 
 EErrorCode Archive::write(const char* fileName)
@@ -451,7 +470,7 @@ EErrorCode Archive::write(const char* fileName)
     // prepare folder and file headers
     for (std::vector<Folder::Ptr>::const_iterator folderIter = folders.begin();
          folderIter != folders.end(); ++folderIter) {
-      (*folderIter)->writeHeader(outfile);
+      (*folderIter)->writeHeader(outfile, m_Type);
     }
 
     for (std::vector<Folder::Ptr>::const_iterator folderIter = folders.begin();
@@ -466,9 +485,17 @@ EErrorCode Archive::write(const char* fileName)
     }
 
     // write file data
-    for (std::vector<Folder::Ptr>::iterator folderIter = folders.begin();
+    std::vector<File::Ptr> files;
+    for (std::vector<Folder::Ptr>::const_iterator folderIter = folders.begin();
          folderIter != folders.end(); ++folderIter) {
-      (*folderIter)->writeFileData(m_File, outfile);
+      files.insert(files.end(), (*folderIter)->m_Files.begin(),
+                   (*folderIter)->m_Files.end());
+    }
+
+    const EErrorCode result = writeFileData(outfile, files);
+    if (result != ERROR_NONE) {
+      outfile.close();
+      return result;
     }
 
     outfile.seekp(0x24, fstream::beg);
@@ -477,7 +504,7 @@ EErrorCode Archive::write(const char* fileName)
     // offsets
     for (std::vector<Folder::Ptr>::const_iterator folderIter = folders.begin();
          folderIter != folders.end(); ++folderIter) {
-      (*folderIter)->writeHeader(outfile);
+      (*folderIter)->writeHeader(outfile, m_Type);
     }
 
     for (std::vector<Folder::Ptr>::const_iterator folderIter = folders.begin();
@@ -493,17 +520,226 @@ EErrorCode Archive::write(const char* fileName)
   }
 }
 
-DirectX::DDS_HEADER Archive::getDDSHeader(File::Ptr file,
+static bool readSourceFile(const std::string& fileName,
+                           std::vector<unsigned char>& data)
+{
+  std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  const std::streamoff size = file.tellg();
+  if (size < 0) {
+    return false;
+  }
+
+  data.resize(static_cast<std::size_t>(size));
+  file.seekg(0, std::ios::beg);
+  return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()),
+                                     static_cast<std::streamsize>(size)));
+}
+
+// appends `in` to `out` as a zlib stream
+static EErrorCode deflateAppend(const std::vector<unsigned char>& in,
+                                std::vector<unsigned char>& out)
+{
+  const std::size_t offset = out.size();
+  uLongf size              = compressBound(static_cast<uLong>(in.size()));
+  out.resize(offset + size);
+
+  if (compress2(out.data() + offset, &size, in.data(), static_cast<uLong>(in.size()),
+                Z_DEFAULT_COMPRESSION) != Z_OK) {
+    return ERROR_INVALIDDATA;
+  }
+
+  out.resize(offset + size);
+  return ERROR_NONE;
+}
+
+// appends `in` to `out` as a LZ4 frame, like Skyrim SE archives store them
+static EErrorCode lz4FrameAppend(const std::vector<unsigned char>& in,
+                                 std::vector<unsigned char>& out)
+{
+  const std::size_t offset = out.size();
+  const std::size_t bound  = LZ4F_compressFrameBound(in.size(), nullptr);
+  out.resize(offset + bound);
+
+  const std::size_t size =
+      LZ4F_compressFrame(out.data() + offset, bound, in.data(), in.size(), nullptr);
+  if (LZ4F_isError(size)) {
+    return ERROR_INVALIDDATA;
+  }
+
+  out.resize(offset + size);
+  return ERROR_NONE;
+}
+
+EErrorCode Archive::packFile(const File::Ptr& file, PackedFile& packed) const
+{
+  std::vector<unsigned char> content;
+  if (!readSourceFile(file->m_SourceFile, content)) {
+    return ERROR_SOURCEFILEMISSING;
+  }
+
+  std::vector<unsigned char>& out = packed.data;
+  out.clear();
+
+  if (namePrefixed()) {
+    // same as the name prefix locateData() skips
+    std::string path = file->m_Name;
+    if (file->m_Folder != nullptr && !file->m_Folder->getFullPath().empty()) {
+      path = file->m_Folder->getFullPath() + "\\" + path;
+    }
+    path.resize((std::min)(path.size(), std::size_t(UCHAR_MAX)));
+
+    out.push_back(static_cast<unsigned char>(path.size()));
+    out.insert(out.end(), path.begin(), path.end());
+  }
+  const std::size_t prefixSize = out.size();
+
+  packed.compressed = compressed(file) && !content.empty();
+  if (packed.compressed) {
+    // bsa files store the uncompressed size in front of the data
+    const BSAUInt size = static_cast<BSAUInt>(content.size());
+    out.resize(prefixSize + sizeof(size));
+    memcpy(out.data() + prefixSize, &size, sizeof(size));
+
+    const EErrorCode result = (m_Type == TYPE_SKYRIMSE) ? lz4FrameAppend(content, out)
+                                                        : deflateAppend(content, out);
+    if (result != ERROR_NONE) {
+      return result;
+    }
+
+    // data that doesn't get smaller is stored as it is
+    if (out.size() - prefixSize >= content.size()) {
+      packed.compressed = false;
+      out.resize(prefixSize);
+    }
+  }
+
+  if (!packed.compressed) {
+    out.insert(out.end(), content.begin(), content.end());
+  }
+
+  return ERROR_NONE;
+}
+
+EErrorCode Archive::writeFileData(std::fstream& outfile,
+                                  const std::vector<File::Ptr>& files)
+{
+  std::vector<PackedFile> packed(files.size());
+  boost::mutex mutex;
+  boost::condition_variable changed;
+  std::size_t written = 0;
+  bool stopped        = false;
+  std::atomic<std::size_t> nextFile(0);
+
+  // compression is what takes the time, so it gets every core while this thread
+  // writes the files out in order
+  const auto pack = [&] {
+    while (true) {
+      const std::size_t index = nextFile++;
+      if (index >= files.size()) {
+        break;
+      }
+
+      {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        changed.wait(lock, [&] { return stopped || index < written + WRITE_WINDOW; });
+        if (stopped) {
+          break;
+        }
+      }
+
+      // files from the source archive are copied as they are
+      PackedFile result;
+      if (files[index]->m_New) {
+        result.result = packFile(files[index], result);
+      }
+      result.ready = true;
+
+      {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        packed[index] = std::move(result);
+      }
+      changed.notify_all();
+    }
+  };
+
+  const unsigned int workerCount = (std::max)(1u, boost::thread::hardware_concurrency());
+  std::vector<std::unique_ptr<boost::thread>> packThreads;
+  for (unsigned int i = 0; i < workerCount; ++i) {
+    packThreads.push_back(std::make_unique<boost::thread>(pack));
+  }
+
+  EErrorCode result = ERROR_NONE;
+  for (std::size_t i = 0; i < files.size() && result == ERROR_NONE; ++i) {
+    PackedFile current;
+    {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      changed.wait(lock, [&] { return packed[i].ready; });
+      current = std::move(packed[i]);
+    }
+
+    const File::Ptr& file = files[i];
+
+    try {
+      file->m_DataOffsetWrite = static_cast<BSAULong>(outfile.tellp());
+
+      if (!file->m_New) {
+        const uint8_t* data = m_File->view(file->m_DataOffset, file->m_FileSize);
+        if (data == nullptr) {
+          result = ERROR_INVALIDDATA;
+        } else {
+          outfile.write(reinterpret_cast<const char*>(data), file->m_FileSize);
+        }
+      } else if (current.result != ERROR_NONE) {
+        result = current.result;
+      } else {
+        file->m_FileSize         = static_cast<BSAULong>(current.data.size());
+        file->m_ToggleCompressed = current.compressed != defaultCompressed();
+        outfile.write(reinterpret_cast<const char*>(current.data.data()),
+                      current.data.size());
+      }
+    } catch (const std::ios_base::failure&) {
+      result = ERROR_INVALIDDATA;
+    }
+
+    {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      ++written;
+    }
+    changed.notify_all();
+  }
+
+  {
+    boost::unique_lock<boost::mutex> lock(mutex);
+    stopped = true;
+  }
+  changed.notify_all();
+
+  for (auto& thread : packThreads) {
+    thread->join();
+  }
+
+  return result;
+}
+
+DirectX::DDS_HEADER Archive::getDDSHeader(File::Ptr file, unsigned int firstMip,
                                           DirectX::DDS_HEADER_DXT10& DX10Header,
                                           bool& isDX10) const
 {
+  // the texture as if `firstMip` was its largest mip
+  const BSAUInt width  = (std::max)(file->m_TextureHeader.width >> firstMip, 1);
+  const BSAUInt height = (std::max)(file->m_TextureHeader.height >> firstMip, 1);
+
   DirectX::DDS_HEADER DDSHeaderData = {};
   DDSHeaderData.size                = sizeof(DDSHeaderData);
   DDSHeaderData.flags =
       DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_LINEARSIZE | DDS_HEADER_FLAGS_MIPMAP;
-  DDSHeaderData.height      = file->m_TextureHeader.height;
-  DDSHeaderData.width       = file->m_TextureHeader.width;
-  DDSHeaderData.mipMapCount = file->m_TextureHeader.mipCount;
+  DDSHeaderData.height      = height;
+  DDSHeaderData.width       = width;
+  DDSHeaderData.mipMapCount = file->m_TextureHeader.mipCount - firstMip;
   DDSHeaderData.ddspf.size  = sizeof(DirectX::DDS_PIXELFORMAT);
   DDSHeaderData.caps        = DDS_SURFACE_FLAGS_TEXTURE | DDS_SURFACE_FLAGS_MIPMAP;
 
@@ -517,52 +753,52 @@ DirectX::DDS_HEADER Archive::getDDSHeader(File::Ptr file,
   case DXGI_FORMAT_BC1_UNORM_SRGB:
     DDSHeaderData.ddspf = DirectX::DDSPF_DXT1;
     DDSHeaderData.pitchOrLinearSize =
-        file->m_TextureHeader.width * file->m_TextureHeader.height / 2;
+        width * height / 2;
     break;
 
   case DXGI_FORMAT_BC2_UNORM:
   case DXGI_FORMAT_BC2_UNORM_SRGB:
     DDSHeaderData.ddspf = DirectX::DDSPF_DXT3;
     DDSHeaderData.pitchOrLinearSize =
-        file->m_TextureHeader.width * file->m_TextureHeader.height;
+        width * height;
     break;
 
   case DXGI_FORMAT_BC3_UNORM:
   case DXGI_FORMAT_BC3_UNORM_SRGB:
     DDSHeaderData.ddspf = DirectX::DDSPF_DXT5;
     DDSHeaderData.pitchOrLinearSize =
-        file->m_TextureHeader.width * file->m_TextureHeader.height;
+        width * height;
     break;
 
   case DXGI_FORMAT_BC4_UNORM:
     DDSHeaderData.ddspf = DirectX::DDSPF_BC4_UNORM;
     DDSHeaderData.pitchOrLinearSize =
-        file->m_TextureHeader.width * file->m_TextureHeader.height;
+        width * height;
     break;
 
   case DXGI_FORMAT_BC4_SNORM:
     DDSHeaderData.ddspf = DirectX::DDSPF_BC4_SNORM;
     DDSHeaderData.pitchOrLinearSize =
-        file->m_TextureHeader.width * file->m_TextureHeader.height;
+        width * height;
     break;
 
   case DXGI_FORMAT_BC5_UNORM:
     DDSHeaderData.ddspf = DirectX::DDSPF_BC5_UNORM;
     DDSHeaderData.pitchOrLinearSize =
-        file->m_TextureHeader.width * file->m_TextureHeader.height;
+        width * height;
     break;
 
   case DXGI_FORMAT_BC5_SNORM:
     DDSHeaderData.ddspf = DirectX::DDSPF_BC5_SNORM;
     DDSHeaderData.pitchOrLinearSize =
-        file->m_TextureHeader.width * file->m_TextureHeader.height;
+        width * height;
     break;
 
   case DXGI_FORMAT_BC7_UNORM:
   case DXGI_FORMAT_BC7_UNORM_SRGB:
     DDSHeaderData.ddspf = DirectX::DDSPF_DX10;
     DDSHeaderData.pitchOrLinearSize =
-        file->m_TextureHeader.width * file->m_TextureHeader.height;
+        width * height;
 
     isDX10                = true;
     DX10Header.dxgiFormat = file->m_TextureHeader.format;
@@ -571,13 +807,13 @@ DirectX::DDS_HEADER Archive::getDDSHeader(File::Ptr file,
   case DXGI_FORMAT_R8G8B8A8_UNORM:
     DDSHeaderData.ddspf = DirectX::DDSPF_A8B8G8R8;
     DDSHeaderData.pitchOrLinearSize =
-        file->m_TextureHeader.width * file->m_TextureHeader.height * 4;  // 32bpp
+        width * height * 4;  // 32bpp
     break;
 
   case DXGI_FORMAT_B8G8R8A8_UNORM:
     DDSHeaderData.ddspf = DirectX::DDSPF_A8R8G8B8;
     DDSHeaderData.pitchOrLinearSize =
-        file->m_TextureHeader.width * file->m_TextureHeader.height * 4;  // 32bpp
+        width * height * 4;  // 32bpp
     break;
 
   case DXGI_FORMAT_B8G8R8X8_UNORM:
@@ -587,19 +823,19 @@ DirectX::DDS_HEADER Archive::getDDSHeader(File::Ptr file,
   case DXGI_FORMAT_R8_UNORM:
     DDSHeaderData.ddspf = DirectX::DDSPF_L8;
     DDSHeaderData.pitchOrLinearSize =
-        file->m_TextureHeader.width * file->m_TextureHeader.height;  // 8bpp
+        width * height;  // 8bpp
     break;
 
   case DXGI_FORMAT_R16_UNORM:
     DDSHeaderData.ddspf = DirectX::DDSPF_L16;
     DDSHeaderData.pitchOrLinearSize =
-        file->m_TextureHeader.width * file->m_TextureHeader.height * 2;  // 16bpp
+        width * height * 2;  // 16bpp
     break;
 
   case DXGI_FORMAT_R8G8_UNORM:
     DDSHeaderData.ddspf = DirectX::DDSPF_A8L8;
     DDSHeaderData.pitchOrLinearSize =
-        file->m_TextureHeader.width * file->m_TextureHeader.height * 2;  // 16bpp
+        width * height * 2;  // 16bpp
     break;
 
   default:
@@ -619,247 +855,294 @@ void Archive::getDX10Header(DirectX::DDS_HEADER_DXT10& DX10Header, File::Ptr fil
   DX10Header.miscFlags2        = 0;
 }
 
-static const unsigned long CHUNK_SIZE = 128 * 1024;
+EErrorCode Archive::inflateInto(const unsigned char* inBuffer, BSAULong inSize,
+                                unsigned char* outBuffer, BSAULong outSize)
+{
+  z_stream stream = {};
+  stream.avail_in = inSize;
+  stream.next_in  = const_cast<Bytef*>(inBuffer);
+  if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+    return ERROR_ZLIBINITFAILED;
+  }
+
+  stream.avail_out  = outSize;
+  stream.next_out   = outBuffer;
+  const int zlibRet = inflate(&stream, Z_FINISH);
+  inflateEnd(&stream);
+
+  // a stream that doesn't exactly fill the recorded size isn't treated as broken
+  if ((zlibRet != Z_OK) && (zlibRet != Z_STREAM_END) && (zlibRet != Z_BUF_ERROR)) {
+    return ERROR_INVALIDDATA;
+  }
 
-EErrorCode Archive::extractDirect(File::Ptr file, std::ofstream& outFile) const
+  return ERROR_NONE;
+}
+
+EErrorCode Archive::readTexture(const File::Ptr& file, std::size_t firstChunk,
+                                DataBuffer& buffer) const
 {
-  EErrorCode result = ERROR_NONE;
-  if (file->m_FileSize == 0) {
-    // don't try to read empty file
-    return result;
+  const auto chunks =
+      std::span<const FO4TextureChunk>(file->m_TextureChunks).subspan(firstChunk);
+  const unsigned int firstMip = firstChunk > 0 ? chunks.front().startMip : 0;
+
+  bool isDX10                              = false;
+  DirectX::DDS_HEADER_DXT10 DX10HeaderData = {};
+  DirectX::DDS_HEADER DDSHeaderData =
+      getDDSHeader(file, firstMip, DX10HeaderData, isDX10);
+  if (isDX10) {
+    getDX10Header(DX10HeaderData, file, DDSHeaderData);
   }
 
-  m_File.clear();
-  m_File.seekg(static_cast<std::ifstream::pos_type>(file->m_DataOffset), std::ios::beg);
+  BSAULong size = 4 + sizeof(DDSHeaderData) + (isDX10 ? sizeof(DX10HeaderData) : 0);
+  const BSAULong headerSize = size;
+  for (const FO4TextureChunk& chunk : chunks) {
+    size += chunk.unpackedSize;
+  }
 
-  if (m_Type == TYPE_FALLOUT4 || m_Type == TYPE_STARFIELD ||
-      m_Type == TYPE_STARFIELD_LZ4_TEXTURE || m_Type == TYPE_FALLOUT4NG_7 ||
-      m_Type == TYPE_FALLOUT4NG_8) {
-    if (!file->m_TextureChunks.size()) {
-      BSAULong size = file->m_UncompressedFileSize;
-      std::unique_ptr<char[]> buffer(new char[size]);
-      m_File.read(buffer.get(), size);
-      outFile.write(buffer.get(), size);
-    } else {
-      bool isDX10                              = false;
-      DirectX::DDS_HEADER_DXT10 DX10HeaderData = {};
-      DirectX::DDS_HEADER DDSHeaderData = getDDSHeader(file, DX10HeaderData, isDX10);
-
-      outFile.write("DDS ", 4);
-      char* DDSHeader = new char[sizeof(DDSHeaderData)];
-      memcpy(DDSHeader, &DDSHeaderData, sizeof(DDSHeaderData));
-      outFile.write(DDSHeader, sizeof(DDSHeaderData));
-      delete[] DDSHeader;
-
-      if (isDX10) {
-        getDX10Header(DX10HeaderData, file, DDSHeaderData);
-        char* DX10Header = new char[sizeof(DX10HeaderData)];
-        memcpy(DX10Header, &DX10HeaderData, sizeof(DX10HeaderData));
-        outFile.write(DX10Header, sizeof(DX10HeaderData));
-        delete[] DX10Header;
+  buffer = std::make_pair(std::shared_ptr<unsigned char[]>(new unsigned char[size]), size);
+
+  unsigned char* out = buffer.first.get();
+  memcpy(out, "DDS ", 4);
+  memcpy(out + 4, &DDSHeaderData, sizeof(DDSHeaderData));
+  if (isDX10) {
+    memcpy(out + 4 + sizeof(DDSHeaderData), &DX10HeaderData, sizeof(DX10HeaderData));
+  }
+  out += headerSize;
+
+  for (const FO4TextureChunk& chunk : chunks) {
+    const BSAULong length = chunk.unpackedSize;
+
+    if (chunk.packedSize > 0) {
+      const uint8_t* in = m_File->view(chunk.offset, chunk.packedSize);
+      if (in == nullptr) {
+        return ERROR_INVALIDDATA;
       }
 
-      for (BSAUInt i = 0; i < file->m_TextureChunks.size(); ++i) {
-        BSAULong length = file->m_TextureChunks[i].unpackedSize;
-        std::unique_ptr<char[]> chunk(new char[length]);
-        m_File.read(chunk.get(), length);
-        outFile.write(chunk.get(), length);
+      if (m_Type == TYPE_STARFIELD_LZ4_TEXTURE) {
+        if (LZ4_decompress_safe(reinterpret_cast<const char*>(in),
+                                reinterpret_cast<char*>(out), chunk.packedSize,
+                                length) < 0) {
+          return ERROR_INVALIDDATA;
+        }
+      } else {
+        const EErrorCode result = inflateInto(in, chunk.packedSize, out, length);
+        if (result != ERROR_NONE) {
+          return result;
+        }
       }
-    }
-  } else {
-    BSAULong size = file->m_FileSize;
-    if (namePrefixed()) {
-      std::string fullName = readBString(m_File);
-      if (size <= fullName.length()) {
-        return result;
+    } else {
+      const uint8_t* in = m_File->view(chunk.offset, length);
+      if (in == nullptr) {
+        return ERROR_INVALIDDATA;
       }
-      size -= fullName.length() + 1;
+      memcpy(out, in, length);
     }
-    std::unique_ptr<unsigned char[]> buffer(new unsigned char[size]);
-    m_File.read(reinterpret_cast<char*>(buffer.get()), size);
-    if (result == ERROR_NONE)
-      outFile.write(reinterpret_cast<char*>(buffer.get()), size);
+
+    out += length;
   }
-  std::unique_ptr<char[]> inBuffer(new char[CHUNK_SIZE]);
 
-  try {
-    unsigned long sizeLeft = file->m_FileSize;
+  return ERROR_NONE;
+}
 
-    while (sizeLeft > 0) {
-      int chunkSize = (std::min)(sizeLeft, CHUNK_SIZE);
-      m_File.read(inBuffer.get(), chunkSize);
-      outFile.write(inBuffer.get(), chunkSize);
-      sizeLeft -= chunkSize;
+EErrorCode Archive::readFile(const File::Ptr& file, std::span<const unsigned char>& data,
+                             DataBuffer& buffer) const
+{
+  data   = {};
+  buffer = {};
+
+  if (isBA2() && !file->m_TextureChunks.empty()) {
+    const EErrorCode result = readTexture(file, 0, buffer);
+    if (result == ERROR_NONE) {
+      data = {buffer.first.get(), buffer.second};
     }
-  } catch (const std::exception&) {
-    result = ERROR_INVALIDDATA;
+    return result;
   }
-  return result;
-}
 
-std::shared_ptr<unsigned char[]> Archive::decompress(unsigned char* inBuffer,
-                                                     BSAULong inSize,
-                                                     EErrorCode& result,
-                                                     BSAULong& outSize)
-{
-  if (outSize == 0) {
-    memcpy(&outSize, inBuffer, sizeof(BSAULong));
-    inBuffer += sizeof(BSAULong);
-    inSize -= sizeof(BSAULong);
+  BSAHash offset           = 0;
+  BSAULong size            = 0;
+  const EErrorCode located = locateData(file, offset, size);
+  if (located != ERROR_NONE || size == 0) {
+    // don't try to read empty file
+    return located;
   }
 
-  if ((inSize == 0) || (outSize == 0)) {
-    return std::shared_ptr<unsigned char[]>();
+  const uint8_t* in = m_File->view(offset, size);
+  if (in == nullptr) {
+    return ERROR_INVALIDDATA;
   }
 
-  std::shared_ptr<unsigned char[]> outBuffer(new unsigned char[outSize]);
+  if (!compressed(file)) {
+    data = {in, size};
+    return ERROR_NONE;
+  }
 
-  z_stream stream;
-  try {
-    stream.zalloc   = Z_NULL;
-    stream.zfree    = Z_NULL;
-    stream.opaque   = Z_NULL;
-    stream.avail_in = inSize;
-    stream.next_in  = static_cast<Bytef*>(inBuffer);
-    int zlibRet     = inflateInit2(&stream, 15 + 32);
-    if (zlibRet != Z_OK) {
-      result = ERROR_ZLIBINITFAILED;
-      return std::shared_ptr<unsigned char[]>();
+  BSAULong outSize = file->m_UncompressedFileSize;
+  if (!isBA2()) {
+    // bsa files store the uncompressed size in front of the data
+    if (size < sizeof(BSAUInt)) {
+      return ERROR_INVALIDDATA;
     }
+    BSAUInt recorded;
+    memcpy(&recorded, in, sizeof(recorded));
+    outSize = recorded;
+    in += sizeof(BSAUInt);
+    size -= sizeof(BSAUInt);
+  }
 
-    do {
-      stream.avail_out = outSize;
-      stream.next_out  = reinterpret_cast<Bytef*>(outBuffer.get());
-      zlibRet          = inflate(&stream, Z_NO_FLUSH);
-      if ((zlibRet != Z_OK) && (zlibRet != Z_STREAM_END) && (zlibRet != Z_BUF_ERROR)) {
-        throw std::runtime_error("invalid data");
-      }
-    } while (stream.avail_out == 0);
-    inflateEnd(&stream);
-    return outBuffer;
-  } catch (const std::exception&) {
-    result = ERROR_INVALIDDATA;
-    inflateEnd(&stream);
-    return std::shared_ptr<unsigned char[]>();
+  if (outSize == 0) {
+    return ERROR_NONE;
+  }
+
+  buffer = std::make_pair(std::shared_ptr<unsigned char[]>(new unsigned char[outSize]),
+                          outSize);
+
+  if (m_Type == TYPE_SKYRIMSE) {
+    // Skyrim SE uses LZ4 Frame compression
+    LZ4F_decompressionContext_t dcContext = nullptr;
+    if (LZ4F_isError(LZ4F_createDecompressionContext(&dcContext, LZ4F_VERSION))) {
+      buffer = {};
+      return ERROR_INVALIDDATA;
+    }
+
+    size_t lzOutSize = outSize;
+    size_t lzInSize  = size;
+    const size_t ret =
+        LZ4F_decompress(dcContext, buffer.first.get(), &lzOutSize, in, &lzInSize, nullptr);
+    LZ4F_freeDecompressionContext(dcContext);
+
+    if (LZ4F_isError(ret)) {
+      buffer = {};
+      return ERROR_INVALIDDATA;
+    }
+  } else {
+    // everything else uses zlib
+    const EErrorCode result = inflateInto(in, size, buffer.first.get(), outSize);
+    if (result != ERROR_NONE) {
+      buffer = {};
+      return result;
+    }
   }
+
+  data = {buffer.first.get(), buffer.second};
+  return ERROR_NONE;
 }
 
-EErrorCode Archive::extractCompressed(File::Ptr file, std::ofstream& outFile) const
+EErrorCode Archive::getTextureInfo(const File::Ptr& file, BSAUInt& width,
+                                   BSAUInt& height, BSAUInt& mipCount) const
 {
-  EErrorCode result = ERROR_NONE;
-  if (file->m_FileSize == 0) {
-    // don't try to read empty file
-    return result;
+  if (!isBA2() || file->m_TextureChunks.empty()) {
+    return ERROR_INVALIDDATA;
   }
 
-  m_File.clear();
-  m_File.seekg(static_cast<std::ifstream::pos_type>(file->m_DataOffset), std::ios::beg);
-
-  if (m_Type == TYPE_FALLOUT4 || m_Type == TYPE_STARFIELD ||
-      m_Type == TYPE_STARFIELD_LZ4_TEXTURE || m_Type == TYPE_FALLOUT4NG_7 ||
-      m_Type == TYPE_FALLOUT4NG_8) {
-    if (!file->m_TextureChunks.size()) {
-      BSAULong inSize = file->m_FileSize;
-      std::unique_ptr<unsigned char[]> inBuffer(new unsigned char[inSize]);
-      m_File.read(reinterpret_cast<char*>(inBuffer.get()), inSize);
-      BSAULong length = file->m_UncompressedFileSize;
-      std::shared_ptr<unsigned char[]> buffer =
-          decompress(inBuffer.get(), inSize, result, length);
-      if (result == ERROR_NONE) {
-        outFile.write(reinterpret_cast<char*>(buffer.get()), length);
-      }
-    } else {
-      bool isDX10                              = false;
-      DirectX::DDS_HEADER_DXT10 DX10HeaderData = {};
-      DirectX::DDS_HEADER DDSHeaderData = getDDSHeader(file, DX10HeaderData, isDX10);
-
-      outFile.write("DDS ", 4);
-      char* DDSHeader = new char[sizeof(DDSHeaderData)];
-      memcpy(DDSHeader, &DDSHeaderData, sizeof(DDSHeaderData));
-      outFile.write(DDSHeader, sizeof(DDSHeaderData));
-      delete[] DDSHeader;
-
-      if (isDX10) {
-        getDX10Header(DX10HeaderData, file, DDSHeaderData);
-        char* DX10Header = new char[sizeof(DX10HeaderData)];
-        memcpy(DX10Header, &DX10HeaderData, sizeof(DX10HeaderData));
-        outFile.write(DX10Header, sizeof(DX10HeaderData));
-        delete[] DX10Header;
-      }
+  width    = file->m_TextureHeader.width;
+  height   = file->m_TextureHeader.height;
+  mipCount = file->m_TextureHeader.mipCount;
+  return ERROR_NONE;
+}
 
-      for (BSAUInt i = 0; i < file->m_TextureChunks.size(); ++i) {
-        BSAULong length = file->m_TextureChunks[i].unpackedSize;
-        if (file->m_TextureChunks[i].packedSize > 0) {
-          unsigned char* chunk = new unsigned char[file->m_TextureChunks[i].packedSize];
-          m_File.read(reinterpret_cast<char*>(chunk),
-                      file->m_TextureChunks[i].packedSize);
-          if (m_Type == TYPE_STARFIELD_LZ4_TEXTURE) {
-            char* unpackedChunk = new char[length];
-            LZ4_decompress_safe(reinterpret_cast<char*>(chunk), unpackedChunk,
-                                file->m_TextureChunks[i].packedSize, length);
-            outFile.write(unpackedChunk, length);
-            delete[] unpackedChunk;
-          } else {
-            std::shared_ptr<unsigned char[]> unpackedChunk =
-                decompress(chunk, file->m_TextureChunks[i].packedSize, result, length);
-            if (result == ERROR_NONE) {
-              outFile.write(reinterpret_cast<char*>(unpackedChunk.get()), length);
-            }
-          }
-          delete[] chunk;
-        } else {
-          char* chunk = new char[length];
-          m_File.read(chunk, length);
-          outFile.write(chunk, length);
-          delete[] chunk;
-        }
-      }
-    }
-  } else if (m_Type == TYPE_SKYRIMSE) {
-    BSAULong inSize = file->m_FileSize;
-    if (namePrefixed()) {
-      std::string fullName = readBString(m_File);
-      if (inSize <= fullName.length()) {
-        return result;
-      }
-      inSize -= fullName.length() + 1;
+EErrorCode Archive::readTextureMips(const File::Ptr& file, unsigned int mip,
+                                    DataBuffer& buffer, unsigned int& firstMip) const
+{
+  buffer   = {};
+  firstMip = 0;
+
+  if (!isBA2() || file->m_TextureChunks.empty()) {
+    return ERROR_INVALIDDATA;
+  }
+
+  // the faces of a cubemap are stored one after the other with all their mips, a
+  // chunk doesn't hold a mip of all of them
+  std::size_t firstChunk = 0;
+  if (!file->m_TextureHeader.isCubemap) {
+    while (firstChunk + 1 < file->m_TextureChunks.size() &&
+           file->m_TextureChunks[firstChunk].endMip < mip) {
+      ++firstChunk;
     }
-    BSAULong outSize = readType<BSAULong>(m_File);
-    inSize -= sizeof(BSAULong);
-    std::unique_ptr<unsigned char[]> inBuffer(new unsigned char[inSize]);
-    m_File.read(reinterpret_cast<char*>(inBuffer.get()), inSize);
+  }
 
-    LZ4F_decompressionContext_t dcContext = nullptr;
-    LZ4F_decompressOptions_t options      = {};
-    LZ4F_createDecompressionContext(&dcContext, LZ4F_VERSION);
-    size_t lzOutSize = outSize;
-    size_t lzInSize  = inSize;
+  const EErrorCode result = readTexture(file, firstChunk, buffer);
+  if (result != ERROR_NONE) {
+    buffer = {};
+    return result;
+  }
 
-    std::unique_ptr<unsigned char[]> outBuffer(new unsigned char[outSize]);
-    LZ4F_decompress(dcContext, outBuffer.get(), &lzOutSize, inBuffer.get(), &lzInSize,
-                    &options);
+  firstMip = firstChunk > 0 ? file->m_TextureChunks[firstChunk].startMip : 0;
+  return ERROR_NONE;
+}
 
-    outFile.write(reinterpret_cast<char*>(outBuffer.get()), outSize);
-  } else {
-    BSAULong inSize = file->m_FileSize;
-    if (namePrefixed()) {
-      std::string fullName = readBString(m_File);
-      if (inSize <= fullName.length()) {
-        return result;
-      }
-      inSize -= fullName.length() + 1;
-    }
-    std::unique_ptr<unsigned char[]> inBuffer(new unsigned char[inSize]);
-    m_File.read(reinterpret_cast<char*>(inBuffer.get()), inSize);
-    BSAULong length = 0UL;
-    std::shared_ptr<unsigned char[]> buffer =
-        decompress(inBuffer.get(), inSize, result, length);
-    if (result == ERROR_NONE) {
-      outFile.write(reinterpret_cast<char*>(buffer.get()), length);
+EErrorCode Archive::getContentSize(const File::Ptr& file, BSAULong& size) const
+{
+  size = 0;
+
+  if (isBA2() && !file->m_TextureChunks.empty()) {
+    // same layout readTexture() builds
+    bool isDX10                              = false;
+    DirectX::DDS_HEADER_DXT10 DX10HeaderData = {};
+    getDDSHeader(file, 0, DX10HeaderData, isDX10);
+
+    size = 4 + sizeof(DirectX::DDS_HEADER) + (isDX10 ? sizeof(DX10HeaderData) : 0);
+    for (const FO4TextureChunk& chunk : file->m_TextureChunks) {
+      size += chunk.unpackedSize;
     }
+    return ERROR_NONE;
   }
 
-  return result;
+  BSAHash offset           = 0;
+  BSAULong stored          = 0;
+  const EErrorCode located = locateData(file, offset, stored);
+  if (located != ERROR_NONE || stored == 0) {
+    return located;
+  }
+
+  if (!compressed(file)) {
+    size = stored;
+    return ERROR_NONE;
+  }
+
+  if (isBA2()) {
+    size = file->m_UncompressedFileSize;
+    return ERROR_NONE;
+  }
+
+  // bsa files store the uncompressed size in front of the data
+  const uint8_t* recorded = m_File->view(offset, sizeof(BSAUInt));
+  if (stored < sizeof(BSAUInt) || recorded == nullptr) {
+    return ERROR_INVALIDDATA;
+  }
+
+  BSAUInt outSize;
+  memcpy(&outSize, recorded, sizeof(outSize));
+  size = outSize;
+  return ERROR_NONE;
+}
+
+EErrorCode Archive::locateData(const File::Ptr& file, BSAHash& offset,
+                               BSAULong& size) const
+{
+  offset = file->m_DataOffset;
+  size   = file->m_FileSize;
+
+  if (isBA2() && !compressed(file) && size == 0) {
+    // uncompressed ba2 files only have the unpacked size
+    size = file->m_UncompressedFileSize;
+  }
+
+  if (size == 0 || isBA2() || !namePrefixed()) {
+    return ERROR_NONE;
+  }
+
+  const uint8_t* length = m_File->view(offset, 1);
+  if (length == nullptr) {
+    return ERROR_INVALIDDATA;
+  }
+  if (size <= *length) {
+    size = 0;
+    return ERROR_NONE;
+  }
+
+  offset += *length + 1;
+  size -= *length + 1;
+  return ERROR_NONE;
 }
 
 EErrorCode Archive::extract(File::Ptr file, const char* outputDirectory) const
@@ -871,11 +1154,12 @@ EErrorCode Archive::extract(File::Ptr file, const char* outputDirectory) const
     return ERROR_ACCESSFAILED;
   }
 
-  EErrorCode result = ERROR_NONE;
-  if (compressed(file)) {
-    result = extractCompressed(file, outputFile);
-  } else {
-    result = extractDirect(file, outputFile);
+  std::span<const unsigned char> data;
+  DataBuffer buffer;
+
+  const EErrorCode result = readFile(file, data, buffer);
+  if (result == ERROR_NONE) {
+    outputFile.write(reinterpret_cast<const char*>(data.data()), data.size());
   }
   outputFile.close();
   return result;
@@ -884,93 +1168,25 @@ EErrorCode Archive::extract(File::Ptr file, const char* outputDirectory) const
 void Archive::readFiles(std::queue<FileInfo>& queue, boost::mutex& mutex,
                         boost::interprocess::interprocess_semaphore& bufferCount,
                         boost::interprocess::interprocess_semaphore& queueFree,
-                        std::vector<File::Ptr>::iterator begin,
-                        std::vector<File::Ptr>::iterator end)
+                        const std::vector<File::Ptr>& files,
+                        std::atomic<std::size_t>& next)
 {
-  for (; begin != end && !boost::this_thread::interruption_requested(); ++begin) {
+  // several of these run at once, each taking the next file in archive order
+  while (!boost::this_thread::interruption_requested()) {
+    const std::size_t index = next++;
+    if (index >= files.size()) {
+      break;
+    }
+
     queueFree.wait();
 
+    // uncompressed files stay in the mapping, only the rest is decompressed here
     FileInfo fileInfo;
-    fileInfo.file = *begin;
-    size_t size   = static_cast<size_t>(fileInfo.file->m_FileSize);
-
-    m_File.seekg(fileInfo.file->m_DataOffset);
-    if (m_Type != TYPE_FALLOUT4 && m_Type != TYPE_STARFIELD &&
-        m_Type != TYPE_STARFIELD_LZ4_TEXTURE && m_Type != TYPE_FALLOUT4NG_7 &&
-        m_Type != TYPE_FALLOUT4NG_8) {
-      if (namePrefixed()) {
-        std::string fullName = readBString(m_File);
-        if (size <= fullName.length()) {
-          continue;
-        }
-        size -= fullName.length() + 1;
-      }
-      if (m_Type == TYPE_SKYRIMSE && compressed(fileInfo.file)) {
-        fileInfo.file->m_UncompressedFileSize = readType<BSAULong>(m_File);
-        size -= 4;
-      }
-      if (!fileInfo.file->m_TextureChunks.size()) {
-        fileInfo.data =
-            std::make_pair(std::shared_ptr<unsigned char[]>(new unsigned char[size]),
-                           static_cast<BSAULong>(size));
-        m_File.read(reinterpret_cast<char*>(fileInfo.data.first.get()), size);
-      }
-    } else {
-      if (!fileInfo.file->m_TextureChunks.size()) {
-        if (size == 0)
-          size = fileInfo.file->m_UncompressedFileSize;
-        fileInfo.data =
-            std::make_pair(std::shared_ptr<unsigned char[]>(new unsigned char[size]),
-                           static_cast<BSAULong>(size));
-        m_File.read(reinterpret_cast<char*>(fileInfo.data.first.get()), size);
-      } else {
-        fileInfo.file->m_UncompressedFileSize = 0L;
-        BSAULong totalSize                    = 0U;
-        for (BSAUInt i = 0; i < fileInfo.file->m_TextureChunks.size(); ++i) {
-          totalSize += fileInfo.file->m_TextureChunks[i].unpackedSize;
-        }
-        char* chunkData     = new char[totalSize];
-        BSAULong currentPos = 0U;
-        for (BSAUInt i = 0; i < fileInfo.file->m_TextureChunks.size(); ++i) {
-          BSAULong length = fileInfo.file->m_TextureChunks[i].unpackedSize;
-          if (fileInfo.file->m_TextureChunks[i].packedSize > 0) {
-            char* chunk = new char[fileInfo.file->m_TextureChunks[i].packedSize];
-            m_File.read(chunk, fileInfo.file->m_TextureChunks[i].packedSize);
-            if (m_Type == TYPE_FALLOUT4 || m_Type == TYPE_STARFIELD ||
-                m_Type == TYPE_FALLOUT4NG_7 || m_Type == TYPE_FALLOUT4NG_8) {
-              EErrorCode result = ERROR_NONE;
-              try {
-                std::shared_ptr<unsigned char[]> unpackedChunk = decompress(
-                    reinterpret_cast<unsigned char*>(chunk),
-                    fileInfo.file->m_TextureChunks[i].packedSize, result, length);
-                memcpy(chunkData + currentPos,
-                       reinterpret_cast<char*>(unpackedChunk.get()), length);
-                unpackedChunk.reset();
-              } catch (const std::exception&) {
-                continue;
-              }
-            } else {
-              char* unpackedChunk = new char[length];
-              LZ4_decompress_safe(chunk, unpackedChunk,
-                                  fileInfo.file->m_TextureChunks[i].packedSize, length);
-              memcpy(chunkData + currentPos, unpackedChunk, length);
-              delete[] unpackedChunk;
-            }
-            delete[] chunk;
-            fileInfo.file->m_UncompressedFileSize += length;
-          } else {
-            char* chunk = new char[length];
-            m_File.read(chunk, length);
-            memcpy(chunkData + currentPos, chunk, length);
-            delete[] chunk;
-          }
-          currentPos += length;
-        }
-        fileInfo.file->m_FileSize = 0;
-        fileInfo.data             = std::make_pair(std::shared_ptr<unsigned char[]>(
-                                           reinterpret_cast<unsigned char*>(chunkData)),
-                                                   static_cast<BSAULong>(totalSize));
-      }
+    fileInfo.file = files[index];
+    if (readFile(fileInfo.file, fileInfo.data, fileInfo.buffer) != ERROR_NONE) {
+      fileInfo.data   = {};
+      fileInfo.buffer = {};
+      fileInfo.file.reset();
     }
 
     {
@@ -1009,7 +1225,10 @@ void Archive::extractFiles(const std::string& targetDirectory,
     }
     queueFree.post();
 
-    DataBuffer dataBuffer = fileInfo.data;
+    if (!fileInfo.file) {
+      // couldn't be read
+      continue;
+    }
 
     std::string fileName = makeString("%s\\%s", targetDirectory.c_str(),
                                       fileInfo.file->getFilePath().c_str());
@@ -1025,99 +1244,8 @@ void Archive::extractFiles(const std::string& targetDirectory,
       // return ERROR_ACCESSFAILED;
     }
 
-    if (m_Type != TYPE_FALLOUT4 && m_Type != TYPE_STARFIELD &&
-        m_Type != TYPE_STARFIELD_LZ4_TEXTURE && m_Type != TYPE_FALLOUT4NG_7 &&
-        m_Type != TYPE_FALLOUT4NG_8) {
-      // BSA extraction
-      if (compressed(fileInfo.file)) {
-        // Decompress data
-        if (m_Type != TYPE_SKYRIMSE) {
-          // Oblivion - Skyrim LE use gzip compression
-          EErrorCode result = ERROR_NONE;
-          try {
-            BSAULong length = 0UL;
-            std::shared_ptr<unsigned char[]> buffer =
-                decompress(dataBuffer.first.get(), dataBuffer.second, result, length);
-            if (buffer.get() != nullptr) {
-              outputFile.write(reinterpret_cast<char*>(buffer.get()), length);
-              buffer.reset();
-            }
-          } catch (const std::exception&) {
-            dataBuffer.first.reset();
-            fileInfo.data.first.reset();
-            continue;
-          }
-        } else {
-          // Skyrim SE uses LZ4 Frame compression
-          if (!fileInfo.file->m_TextureChunks.size()) {
-            char* outBuffer = new char[fileInfo.file->m_UncompressedFileSize];
-
-            LZ4F_decompressionContext_t dcContext = nullptr;
-            LZ4F_decompressOptions_t options      = {};
-            LZ4F_createDecompressionContext(&dcContext, LZ4F_VERSION);
-            size_t outSize = fileInfo.file->m_UncompressedFileSize;
-            size_t inSize  = dataBuffer.second;
-
-            LZ4F_decompress(dcContext, outBuffer, &outSize, dataBuffer.first.get(),
-                            &inSize, &options);
-            outputFile.write(outBuffer, fileInfo.file->m_UncompressedFileSize);
-            LZ4F_freeDecompressionContext(dcContext);
-            delete[] outBuffer;
-          }
-        }
-      } else {
-        // No compression - just write the data.
-        outputFile.write(reinterpret_cast<char*>(dataBuffer.first.get()),
-                         dataBuffer.second);
-      }
-    } else {
-      // BA2 format
-      if (fileInfo.file->m_TextureChunks.size()) {
-        // Texture stream format - requires building the header data for the DDS file
-        bool isDX10                              = false;
-        DirectX::DDS_HEADER_DXT10 DX10HeaderData = {};
-        DirectX::DDS_HEADER DDSHeaderData =
-            getDDSHeader(fileInfo.file, DX10HeaderData, isDX10);
-
-        outputFile.write("DDS ", 4);
-        char* DDSHeader = new char[sizeof(DDSHeaderData)];
-        memcpy(DDSHeader, &DDSHeaderData, sizeof(DDSHeaderData));
-        outputFile.write(DDSHeader, sizeof(DDSHeaderData));
-        delete[] DDSHeader;
-
-        if (isDX10) {
-          // This format requires DX10 header info
-          getDX10Header(DX10HeaderData, fileInfo.file, DDSHeaderData);
-
-          char* DX10Header = new char[sizeof(DX10HeaderData)];
-          memcpy(DX10Header, &DX10HeaderData, sizeof(DX10HeaderData));
-          outputFile.write(DX10Header, sizeof(DX10HeaderData));
-          delete[] DX10Header;
-        }
-      }
-
-      EErrorCode result = ERROR_NONE;
-      try {
-        if (fileInfo.file->m_FileSize > 0 && !fileInfo.file->m_TextureChunks.size()) {
-          BSAULong length = fileInfo.file->m_UncompressedFileSize;
-          std::shared_ptr<unsigned char[]> buffer =
-              decompress(dataBuffer.first.get(), dataBuffer.second, result, length);
-          if (buffer.get() != nullptr) {
-            outputFile.write(reinterpret_cast<char*>(buffer.get()), length);
-            buffer.reset();
-          }
-        } else {
-          outputFile.write(reinterpret_cast<char*>(dataBuffer.first.get()),
-                           dataBuffer.second);
-        }
-      } catch (const std::exception&) {
-        dataBuffer.first.reset();
-        fileInfo.data.first.reset();
-        continue;
-      }
-    }
-    dataBuffer.first.reset();
-    fileInfo.data.first.reset();
+    outputFile.write(reinterpret_cast<const char*>(fileInfo.data.data()),
+                     fileInfo.data.size());
   }
 }
 
@@ -1144,8 +1272,13 @@ EErrorCode Archive::extractAll(
 
   std::vector<File::Ptr> fileList;
   m_RootFolder->collectFiles(fileList);
+  if (fileList.empty()) {
+    return ERROR_NONE;
+  }
+
+  // in the order they're stored, so the mapping is read front to back
   std::sort(fileList.begin(), fileList.end(), ByOffset);
-  m_File.seekg((*(fileList.begin()))->m_DataOffset);
+  m_File->adviseSequential();
 
   std::queue<FileInfo> buffers;
   boost::mutex queueMutex;
@@ -1153,10 +1286,33 @@ EErrorCode Archive::extractAll(
   boost::interprocess::interprocess_semaphore bufferCount(0);
   boost::interprocess::interprocess_semaphore queueFree(100);
 
-  boost::thread readerThread(boost::bind(&Archive::readFiles, this, boost::ref(buffers),
-                                         boost::ref(queueMutex),
-                                         boost::ref(bufferCount), boost::ref(queueFree),
-                                         fileList.begin(), fileList.end()));
+  // decompression is what takes the time, so it gets every core while a single
+  // thread writes the results out
+  const unsigned int workerCount = (std::max)(1u, boost::thread::hardware_concurrency());
+  std::atomic<std::size_t> nextFile(0);
+
+  std::vector<std::unique_ptr<boost::thread>> readerThreads;
+  for (unsigned int i = 0; i < workerCount; ++i) {
+    readerThreads.push_back(std::make_unique<boost::thread>(boost::bind(
+        &Archive::readFiles, this, boost::ref(buffers), boost::ref(queueMutex),
+        boost::ref(bufferCount), boost::ref(queueFree), boost::cref(fileList),
+        boost::ref(nextFile))));
+  }
+
+  const auto interruptReaders = [&readerThreads] {
+    for (auto& thread : readerThreads) {
+      thread->interrupt();
+    }
+  };
+
+  const auto joinReaders = [&readerThreads] {
+    for (auto& thread : readerThreads) {
+      if (thread->joinable() && !thread->timed_join(boost::posix_time::millisec(100))) {
+        return false;
+      }
+    }
+    return true;
+  };
 
   boost::thread extractThread(boost::bind(
       &Archive::extractFiles, this, outputDirectory, boost::ref(buffers),
@@ -1168,7 +1324,7 @@ EErrorCode Archive::extractAll(
   bool canceled    = false;
   while (!readerDone || !extractDone) {
     if (!readerDone) {
-      readerDone = readerThread.timed_join(boost::posix_time::millisec(100));
+      readerDone = joinReaders();
     }
     if (readerDone) {
       extractDone = extractThread.timed_join(boost::posix_time::millisec(100));
@@ -1184,7 +1340,7 @@ EErrorCode Archive::extractAll(
     if (!progress((filesDone * 100) / static_cast<int>(fileList.size()),
                   fileList[index]->getName()) &&
         !canceled) {
-      readerThread.interrupt();
+      interruptReaders();
       canceled = true;  // don't interrupt repeatedly
     }
   }
@@ -0,0 +1,148 @@
+/*
+Mod Organizer BSA handling
+
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "bsacache.h"
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace BSA
+{
+
+namespace
+{
+
+bool fileStamp(const std::string& fileName, uint64_t& size, int64_t& writeTime)
+{
+  std::error_code ec;
+
+  size = fs::file_size(fileName, ec);
+  if (ec) {
+    return false;
+  }
+
+  const auto lwt = fs::last_write_time(fileName, ec);
+  if (ec) {
+    return false;
+  }
+  writeTime = static_cast<int64_t>(lwt.time_since_epoch().count());
+
+  return true;
+}
+
+}  // namespace
+
+ArchiveCache& ArchiveCache::instance()
+{
+  static ArchiveCache cache;
+  return cache;
+}
+
+ArchiveCache::ArchiveCache(std::size_t capacity) : m_Capacity(capacity) {}
+
+std::shared_ptr<const Archive> ArchiveCache::get(const std::string& fileName,
+                                                 EErrorCode* error)
+{
+  uint64_t size      = 0;
+  int64_t writeTime  = 0;
+  const bool stamped = fileStamp(fileName, size, writeTime);
+
+  {
+    std::scoped_lock lock(m_Mutex);
+    for (auto itor = m_Entries.begin(); itor != m_Entries.end(); ++itor) {
+      if (itor->fileName != fileName) {
+        continue;
+      }
+
+      if (stamped && itor->size == size && itor->writeTime == writeTime) {
+        m_Entries.splice(m_Entries.begin(), m_Entries, itor);
+        if (error != nullptr) {
+          *error = ERROR_NONE;
+        }
+        return itor->archive;
+      }
+
+      m_Entries.erase(itor);
+      break;
+    }
+  }
+
+  // read without the lock, other archives can be handed out in the meantime
+  auto archive   = std::make_shared<Archive>();
+  EErrorCode res = ERROR_NONE;
+  try {
+    // read() can return an error, but it can also throw if the file is not a
+    // valid bsa
+    res = archive->read(fileName.c_str(), false);
+  } catch (const std::exception&) {
+    res = ERROR_INVALIDDATA;
+  }
+
+  if (error != nullptr) {
+    *error = res;
+  }
+
+  if (res != ERROR_NONE) {
+    return {};
+  }
+
+  // archives that can't be stamped are handed out but not kept, they couldn't
+  // be checked later
+  if (stamped) {
+    std::scoped_lock lock(m_Mutex);
+    std::erase_if(m_Entries, [&](const Entry& e) {
+      return e.fileName == fileName;
+    });
+    m_Entries.push_front({fileName, size, writeTime, archive});
+    trim();
+  }
+
+  return archive;
+}
+
+void ArchiveCache::remove(const std::string& fileName)
+{
+  std::scoped_lock lock(m_Mutex);
+  std::erase_if(m_Entries, [&](const Entry& e) {
+    return e.fileName == fileName;
+  });
+}
+
+void ArchiveCache::clear()
+{
+  std::scoped_lock lock(m_Mutex);
+  m_Entries.clear();
+}
+
+void ArchiveCache::setCapacity(std::size_t capacity)
+{
+  std::scoped_lock lock(m_Mutex);
+  m_Capacity = capacity;
+  trim();
+}
+
+void ArchiveCache::trim()
+{
+  while (m_Entries.size() > m_Capacity) {
+    m_Entries.pop_back();
+  }
+}
+
+}  // namespace BSA
@@ -29,6 +29,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "bsaexception.h"
 #include "bsafolder.h"
 #include "filehash.h"
+#include "mappedfile.h"
 
 using std::fstream;
 using std::ifstream;
@@ -42,15 +43,14 @@ bool ByOffset(const File::Ptr& LHS, const File::Ptr& RHS)
   return LHS->getDataOffset() < RHS->getDataOffset();
 }
 
-static const unsigned long CHUNK_SIZE = 128 * 1024;
-
-File::File(std::fstream& file, Folder* folder)
+File::File(DataReader& reader, Folder* folder)
     : m_Folder(folder), m_New(false), m_FileSize(0), m_UncompressedFileSize(0),
       m_ToggleCompressedWrite(false), m_DataOffsetWrite(0)
 {
-  m_NameHash         = readType<BSAHash>(file);
-  m_FileSize         = readType<BSAULong>(file);
-  m_DataOffset       = readType<BSAULong>(file);
+  // the record is 16 bytes everywhere, BSAULong isn't
+  m_NameHash         = reader.read<BSAHash>();
+  m_FileSize         = reader.read<BSAUInt>();
+  m_DataOffset       = reader.read<BSAUInt>();
   m_ToggleCompressed = m_FileSize & COMPRESSMASK;
   m_FileSize         = m_FileSize & SIZEMASK;
 }
@@ -86,68 +86,19 @@ std::string File::getFilePath() const
 
 void File::writeHeader(fstream& file) const
 {
+  // the record is 16 bytes everywhere, unsigned long isn't
   writeType<BSAHash>(file, m_NameHash);
-  BSAULong size = m_FileSize;
+  BSAUInt size = static_cast<BSAUInt>(m_FileSize);
   if (m_ToggleCompressed) {
     size |= (1 << 30);
   }
-  writeType<BSAULong>(file, size);
-  writeType<BSAULong>(file, m_DataOffsetWrite);
-}
-
-EErrorCode File::writeData(fstream& sourceArchive, fstream& targetArchive) const
-{
-  m_DataOffsetWrite = static_cast<BSAULong>(targetArchive.tellp());
-  EErrorCode result = ERROR_NONE;
-
-  std::unique_ptr<char[]> inBuffer(new char[CHUNK_SIZE]);
-
-  if (m_SourceFile.length() == 0) {
-    // copy from source archive
-    sourceArchive.seekg(m_DataOffset, fstream::beg);
-
-    try {
-      unsigned long sizeLeft = m_FileSize;
-      while (sizeLeft > 0) {
-        int chunkSize = (std::min)(sizeLeft, CHUNK_SIZE);
-        sourceArchive.read(inBuffer.get(), chunkSize);
-        targetArchive.write(inBuffer.get(), chunkSize);
-        sizeLeft -= chunkSize;
-      }
-    } catch (const std::exception&) {
-      result = ERROR_INVALIDDATA;
-    }
-  } else {
-    // copy from file on disc
-    fstream sourceFile;
-    sourceFile.open(m_SourceFile.c_str());
-    if (!sourceFile.is_open()) {
-      return ERROR_SOURCEFILEMISSING;
-    }
-    sourceFile.seekg(0, fstream::end);
-    m_FileSize             = static_cast<BSAULong>(sourceFile.tellg());
-    unsigned long sizeLeft = m_FileSize;
-    sourceFile.seekg(0, fstream::beg);
-    while (sizeLeft > 0) {
-      int chunkSize = (std::min)(sizeLeft, CHUNK_SIZE);
-      sourceFile.read(inBuffer.get(), chunkSize);
-      targetArchive.write(inBuffer.get(), chunkSize);
-      sizeLeft -= chunkSize;
-    }
-  }
-  return result;
+  writeType<BSAUInt>(file, size);
+  writeType<BSAUInt>(file, static_cast<BSAUInt>(m_DataOffsetWrite));
 }
 
-void File::readFileName(fstream& file, bool testHashes)
+void File::readFileName(DataReader& reader)
 {
-  m_Name = readZString(file);
-  if (testHashes) {
-    if (calculateBSAHash(m_Name) != m_NameHash) {
-      throw data_invalid_exception(
-          makeString("invalid name hash for \"%s\" (%lx vs %lx)", m_Name.c_str(),
-                     calculateBSAHash(m_Name), m_NameHash));
-    }
-  }
+  m_Name = reader.readZString();
 }
 
 }  // namespace BSA
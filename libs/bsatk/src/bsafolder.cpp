@@ -18,6 +18,8 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
+#include <algorithm>
+#include <cctype>
 #include <filesystem>
 #include <limits.h>
 
@@ -25,12 +27,35 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "bsaexception.h"
 #include "bsafile.h"
 #include "bsafolder.h"
+#include "mappedfile.h"
 
 using std::fstream;
 
 namespace BSA
 {
 
+namespace
+{
+
+char normalizePathChar(char c)
+{
+  if (c == '/') {
+    return '\\';
+  }
+  return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+// `path` is already normalized
+bool pathEquals(std::string_view path, const std::string& name)
+{
+  return path.size() == name.size() &&
+         std::equal(path.begin(), path.end(), name.begin(), [](char a, char b) {
+           return a == normalizePathChar(b);
+         });
+}
+
+}  // namespace
+
 Folder::Folder() : m_Parent(nullptr), m_Name()
 {
   m_NameHash  = calculateBSAHash(m_Name);
@@ -38,64 +63,71 @@ Folder::Folder() : m_Parent(nullptr), m_Name()
   m_Offset    = ULONG_MAX;
 }
 
-Folder::Ptr Folder::readFolder(std::fstream& file, BSAUInt fileNamesLength,
+Folder::Ptr Folder::readFolder(DataReader& reader, BSAUInt fileNamesLength,
                                BSAUInt& endPos)
 {
+  // the record is 16 bytes everywhere, unsigned long isn't
   Folder::Ptr result(new Folder());
-  result->m_NameHash  = readType<BSAHash>(file);
-  result->m_FileCount = readType<unsigned long>(file);
-  result->m_Offset    = readType<unsigned long>(file);
-  std::streamoff pos  = file.tellg();
+  result->m_NameHash  = reader.read<BSAHash>();
+  result->m_FileCount = reader.read<BSAUInt>();
+  result->m_Offset    = reader.read<BSAUInt>();
+  const auto pos      = reader.tell();
 
-  file.seekg(result->m_Offset - fileNamesLength, fstream::beg);
+  reader.seek(result->m_Offset - fileNamesLength);
 
-  result->m_Name = readBString(file);
+  result->m_Name = reader.readBString();
 
   for (unsigned long i = 0UL; i < result->m_FileCount; ++i) {
-    result->m_Files.push_back(File::Ptr(new File(file, result.get())));
+    result->m_Files.push_back(File::Ptr(new File(reader, result.get())));
   }
 
-  if (static_cast<unsigned long>(file.tellg()) > endPos) {
-    endPos = static_cast<BSAULong>(file.tellg());
+  if (reader.tell() > endPos) {
+    endPos = static_cast<BSAUInt>(reader.tell());
   }
 
-  file.seekg(pos);
+  reader.seek(pos);
 
   return result;
 }
 
-Folder::Ptr Folder::readFolderSE(std::fstream& file, BSAUInt fileNamesLength,
+Folder::Ptr Folder::readFolderSE(DataReader& reader, BSAUInt fileNamesLength,
                                  BSAUInt& endPos)
 {
   Folder::Ptr result(new Folder());
-  result->m_NameHash  = readType<BSAHash>(file);
-  result->m_FileCount = readType<BSAUInt>(file);
-  readType<BSAUInt>(file);
-  result->m_Offset   = readType<BSAHash>(file);
-  std::streamoff pos = file.tellg();
+  result->m_NameHash  = reader.read<BSAHash>();
+  result->m_FileCount = reader.read<BSAUInt>();
+  reader.skip(sizeof(BSAUInt));
+  result->m_Offset = reader.read<BSAHash>();
+  const auto pos   = reader.tell();
 
-  file.seekg(result->m_Offset - fileNamesLength, fstream::beg);
+  reader.seek(result->m_Offset - fileNamesLength);
 
-  result->m_Name = readBString(file);
+  result->m_Name = reader.readBString();
 
   for (unsigned long i = 0UL; i < result->m_FileCount; ++i) {
-    result->m_Files.push_back(File::Ptr(new File(file, result.get())));
+    result->m_Files.push_back(File::Ptr(new File(reader, result.get())));
   }
 
-  if (static_cast<unsigned long>(file.tellg()) > endPos) {
-    endPos = static_cast<BSAULong>(file.tellg());
+  if (reader.tell() > endPos) {
+    endPos = static_cast<BSAUInt>(reader.tell());
   }
 
-  file.seekg(pos);
+  reader.seek(pos);
 
   return result;
 }
 
-void Folder::writeHeader(std::fstream& file) const
+void Folder::writeHeader(std::fstream& file, ArchiveType type) const
 {
+  // same layouts readFolder() and readFolderSE() read
   writeType<BSAHash>(file, m_NameHash);
-  writeType<BSAULong>(file, static_cast<BSAULong>(m_Files.size()));
-  writeType<BSAULong>(file, m_OffsetWrite);
+  writeType<BSAUInt>(file, static_cast<BSAUInt>(m_Files.size()));
+  if (type == ArchiveType::TYPE_SKYRIMSE) {
+    writeType<BSAUInt>(file, 0);
+    writeType<BSAHash>(file, m_OffsetWrite);
+  } else {
+    writeType<BSAUInt>(file, static_cast<BSAUInt>(m_OffsetWrite));
+  }
 }
 
 void Folder::writeData(std::fstream& file, BSAULong fileNamesLength) const
@@ -108,19 +140,6 @@ void Folder::writeData(std::fstream& file, BSAULong fileNamesLength) const
   }
 }
 
-EErrorCode Folder::writeFileData(std::fstream& sourceFile,
-                                 std::fstream& targetFile) const
-{
-  for (std::vector<File::Ptr>::const_iterator iter = m_Files.begin();
-       iter != m_Files.end(); ++iter) {
-    EErrorCode error = (*iter)->writeData(sourceFile, targetFile);
-    if (error != ERROR_NONE) {
-      return error;
-    }
-  }
-  return ERROR_NONE;
-}
-
 std::string Folder::getFullPath() const
 {
   if (m_Parent != nullptr) {
@@ -211,14 +230,14 @@ Folder::Ptr Folder::addOrFindFolderInt(Folder* folder)
   }
 }
 
-Folder::Ptr Folder::addFolder(std::fstream& file, BSAUInt fileNamesLength,
+Folder::Ptr Folder::addFolder(DataReader& reader, BSAUInt fileNamesLength,
                               BSAUInt& endPos, ArchiveType type)
 {
   Folder::Ptr temp;
   if (type == ArchiveType::TYPE_SKYRIMSE)
-    temp = readFolderSE(file, fileNamesLength, endPos);
+    temp = readFolderSE(reader, fileNamesLength, endPos);
   else
-    temp = readFolder(file, fileNamesLength, endPos);
+    temp = readFolder(reader, fileNamesLength, endPos);
   addFolderInt(temp);
 
   return temp;
@@ -250,18 +269,55 @@ Folder::Ptr Folder::addFolderFromFile(std::string filePath, BSAUInt size,
   return result;
 }
 
-bool Folder::resolveFileNames(std::fstream& file, bool testHashes)
+bool Folder::resolveFileNames(DataReader& reader)
 {
-  bool hashesValid = true;
+  bool namesValid = true;
   for (std::vector<File::Ptr>::iterator iter = m_Files.begin(); iter != m_Files.end();
        ++iter) {
     try {
-      (*iter)->readFileName(file, testHashes);
+      (*iter)->readFileName(reader);
     } catch (const std::exception&) {
-      hashesValid = false;
+      namesValid = false;
     }
   }
-  return hashesValid;
+  return namesValid;
+}
+
+File::Ptr Folder::findFile(const std::string& path) const
+{
+  std::string normalized(path);
+  std::transform(normalized.begin(), normalized.end(), normalized.begin(),
+                 normalizePathChar);
+
+  std::string_view view(normalized);
+  while (!view.empty() && view.front() == '\\') {
+    view.remove_prefix(1);
+  }
+
+  return findFileInt(view);
+}
+
+File::Ptr Folder::findFileInt(std::string_view path) const
+{
+  for (const File::Ptr& file : m_Files) {
+    if (pathEquals(path, file->getName())) {
+      return file;
+    }
+  }
+
+  // a subfolder can be named after several path components, depending on how
+  // its name was split when the archive was read
+  for (const Folder::Ptr& folder : m_SubFolders) {
+    const std::size_t length = folder->m_Name.size();
+    if (path.size() > length && path[length] == '\\' &&
+        pathEquals(path.substr(0, length), folder->m_Name)) {
+      if (File::Ptr file = folder->findFileInt(path.substr(length + 1))) {
+        return file;
+      }
+    }
+  }
+
+  return {};
 }
 
 const Folder::Ptr Folder::getSubFolder(unsigned int index) const
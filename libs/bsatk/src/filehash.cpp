@@ -21,80 +21,100 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "filehash.h"
 
 #include <algorithm>
-#include <climits>
-#include <cstdlib>
-#include <cstring>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
 
-#ifndef MAX_PATH
-#define MAX_PATH PATH_MAX
-#endif  // MAX_PATH
+namespace
+{
+
+// character `i` of a name the way it's hashed, lower case with backslashes
+unsigned char hashChar(std::string_view name, std::size_t i)
+{
+  const auto c =
+      static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(name[i])));
+  return c == '/' ? '\\' : c;
+}
+
+bool extensionIs(std::string_view name, std::size_t dot, std::string_view ext)
+{
+  if (name.size() - dot - 1 != ext.size()) {
+    return false;
+  }
+
+  for (std::size_t i = 0; i < ext.size(); ++i) {
+    if (hashChar(name, dot + 1 + i) != static_cast<unsigned char>(ext[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
 
-static unsigned long genHashInt(const unsigned char* pos, const unsigned char* end)
+// only the low 32 bits are used, so this is the same with 32 and 64 bit longs
+uint32_t genHashInt(std::string_view name, std::size_t begin, std::size_t end)
 {
-  unsigned long hash = 0;
-  for (; pos < end; ++pos) {
+  uint32_t hash = 0;
+  for (std::size_t i = begin; i < end; ++i) {
     hash *= 0x1003f;
-    hash += *pos;
+    hash += hashChar(name, i);
   }
   return hash;
 }
 
+}  // namespace
+
 /**
  * @brief calculateBSAHash
  * @param fileName
  * @return
  * @note the hash calculated for folders seem to be wrong
  */
-BSAHash calculateBSAHash(const std::string& fileName)
+BSAHash calculateBSAHash(std::string_view fileName)
 {
-  char fileNameLower[FILENAME_MAX + 1];
-  int i = 0;
-  for (; i < FILENAME_MAX && fileName[i] != '\0'; ++i) {
-    fileNameLower[i] = tolower(fileName[i]);
-    if (fileNameLower[i] == '/') {
-      fileNameLower[i] = '\\';
-    }
-  }
-  fileNameLower[i] = '\0';
-
-  unsigned char* fileNameLowerU = reinterpret_cast<unsigned char*>(fileNameLower);
-
-  size_t length = strlen(fileNameLower);
-
-  char* ext = strrchr(fileNameLower, '.');
-  if (ext == nullptr) {
-    ext = fileNameLower + length;
-  }
-
-  size_t extLen = strlen(ext);
-  length -= extLen;
+  // the hash is defined on a c string of at most FILENAME_MAX characters
+  fileName =
+      fileName.substr(0, std::min<std::size_t>(fileName.find('\0'), FILENAME_MAX));
 
-  unsigned char* extU = reinterpret_cast<unsigned char*>(ext);
+  const std::size_t dot    = fileName.rfind('.');
+  const std::size_t length = dot == std::string_view::npos ? fileName.size() : dot;
+  const std::size_t extLen = fileName.size() - length;
 
   BSAHash hash1 = 0ULL;
 
   if (length > 0) {
-    hash1 = static_cast<BSAHash>(fileNameLowerU[length - 1] |
-                                 ((length > 2 ? fileNameLowerU[length - 2] : 0) << 8) |
-                                 (length << 16) | (fileNameLowerU[0] << 24));
+    hash1 = static_cast<BSAHash>(
+        hashChar(fileName, length - 1) |
+        ((length > 2 ? hashChar(fileName, length - 2) : 0) << 8) | (length << 16) |
+        (hashChar(fileName, 0) << 24));
   }
 
   if (extLen > 0) {
-    if (strcmp(ext + 1, "kf") == 0) {
+    if (extensionIs(fileName, length, "kf")) {
       hash1 |= 0x80;
-    } else if (strcmp(ext + 1, "nif") == 0) {
+    } else if (extensionIs(fileName, length, "nif")) {
       hash1 |= 0x8000;
-    } else if (strcmp(ext + 1, "dds") == 0) {
+    } else if (extensionIs(fileName, length, "dds")) {
       hash1 |= 0x8080;
-    } else if (strcmp(ext + 1, "wav") == 0) {
+    } else if (extensionIs(fileName, length, "wav")) {
       hash1 |= 0x80000000;
     }
 
-    BSAHash hash2 = static_cast<BSAHash>(genHashInt(fileNameLowerU + 1, extU - 2)) +
-                    static_cast<BSAHash>(genHashInt(extU, extU + strlen(ext)));
+    // the stem without its first and last two characters, then the extension
+    // including the dot
+    const uint32_t hash2 = genHashInt(fileName, 1, length > 2 ? length - 2 : 0) +
+                           genHashInt(fileName, length, fileName.size());
 
-    hash1 |= (hash2 & 0xFFFFFFFF) << 32;
+    hash1 |= static_cast<BSAHash>(hash2) << 32;
   }
 
   return hash1;
 }
+
+void calculateBSAHashes(const std::string_view* fileNames, std::size_t count,
+                        BSAHash* hashes)
+{
+  for (std::size_t i = 0; i < count; ++i) {
+    hashes[i] = calculateBSAHash(fileNames[i]);
+  }
+}
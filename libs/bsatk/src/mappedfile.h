@@ -0,0 +1,250 @@
+/*
+Mod Organizer BSA handling
+
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef BSAMAPPEDFILE_H
+#define BSAMAPPEDFILE_H
+
+#include "bsaexception.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace BSA
+{
+
+/**
+ * read-only view of a whole archive, pages are only read once they're touched.
+ * nothing in here changes after open(), so any number of threads can read from
+ * it at once
+ */
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+
+  MappedFile(const MappedFile&)            = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /**
+   * @param fileName name of the file to map
+   * @return false if the file can't be opened or mapped
+   */
+  bool open(const char* fileName)
+  {
+    close();
+
+#ifdef _WIN32
+    m_File = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_File == INVALID_HANDLE_VALUE) {
+      return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_File, &size)) {
+      close();
+      return false;
+    }
+    m_Size = static_cast<std::size_t>(size.QuadPart);
+
+    if (m_Size > 0) {
+      m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (m_Mapping != nullptr) {
+        m_Data = static_cast<const uint8_t*>(
+            MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+      }
+      if (m_Data == nullptr) {
+        close();
+        return false;
+      }
+    }
+#else
+    m_File = ::open(fileName, O_RDONLY | O_CLOEXEC);
+    if (m_File < 0) {
+      return false;
+    }
+
+    struct stat st;
+    if (::fstat(m_File, &st) != 0) {
+      close();
+      return false;
+    }
+    m_Size = static_cast<std::size_t>(st.st_size);
+
+    if (m_Size > 0) {
+      void* p = ::mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_File, 0);
+      if (p == MAP_FAILED) {
+        close();
+        return false;
+      }
+      m_Data = static_cast<const uint8_t*>(p);
+    }
+#endif
+
+    return true;
+  }
+
+  void close()
+  {
+#ifdef _WIN32
+    if (m_Data != nullptr) {
+      UnmapViewOfFile(m_Data);
+    }
+    if (m_Mapping != nullptr) {
+      CloseHandle(m_Mapping);
+    }
+    if (m_File != INVALID_HANDLE_VALUE) {
+      CloseHandle(m_File);
+    }
+    m_Mapping = nullptr;
+    m_File    = INVALID_HANDLE_VALUE;
+#else
+    if (m_Data != nullptr) {
+      ::munmap(const_cast<uint8_t*>(m_Data), m_Size);
+    }
+    if (m_File >= 0) {
+      ::close(m_File);
+    }
+    m_File = -1;
+#endif
+    m_Data = nullptr;
+    m_Size = 0;
+  }
+
+  const uint8_t* data() const { return m_Data; }
+  std::size_t size() const { return m_Size; }
+
+  /**
+   * hint that the whole file is about to be read front to back, so the system
+   * reads ahead in large blocks and drops pages behind the readers
+   */
+  void adviseSequential() const
+  {
+#ifndef _WIN32
+    if (m_Data != nullptr) {
+      ::madvise(const_cast<uint8_t*>(m_Data), m_Size, MADV_SEQUENTIAL);
+    }
+#endif
+  }
+
+  /**
+   * @return pointer to `size` bytes at `offset` or nullptr if they're not all
+   *         inside the file
+   */
+  const uint8_t* view(uint64_t offset, uint64_t size) const
+  {
+    if (offset > m_Size || size > m_Size - offset) {
+      return nullptr;
+    }
+    return m_Data + offset;
+  }
+
+private:
+#ifdef _WIN32
+  HANDLE m_File    = INVALID_HANDLE_VALUE;
+  HANDLE m_Mapping = nullptr;
+#else
+  int m_File = -1;
+#endif
+  const uint8_t* m_Data = nullptr;
+  std::size_t m_Size    = 0;
+};
+
+/**
+ * cursor over a mapped file, used to parse the archive structure. throws
+ * data_invalid_exception when reading past the end, like readType() does
+ */
+class DataReader
+{
+public:
+  explicit DataReader(const MappedFile& file) : m_File(file) {}
+
+  template <typename T>
+  T read()
+  {
+    T value;
+    memcpy(&value, take(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  void read(void* buffer, std::size_t size) { memcpy(buffer, take(size), size); }
+
+  /**
+   * @return `size` bytes as a string, cut at the first zero if there is one
+   */
+  std::string readString(std::size_t size)
+  {
+    const auto* data = reinterpret_cast<const char*>(take(size));
+    return std::string(data, strnlen(data, size));
+  }
+
+  std::string readBString() { return readString(read<uint8_t>()); }
+
+  std::string readZString()
+  {
+    if (m_Pos >= m_File.size()) {
+      throw data_invalid_exception("can't read from bsa");
+    }
+
+    const auto* begin = m_File.data() + m_Pos;
+    const auto* end =
+        static_cast<const uint8_t*>(memchr(begin, '\0', m_File.size() - m_Pos));
+    if (end == nullptr) {
+      throw data_invalid_exception("can't read from bsa");
+    }
+
+    m_Pos = static_cast<std::size_t>(end - m_File.data()) + 1;
+    return std::string(reinterpret_cast<const char*>(begin), end - begin);
+  }
+
+  std::size_t tell() const { return m_Pos; }
+  void seek(std::size_t pos) { m_Pos = pos; }
+  void skip(std::size_t size) { take(size); }
+
+private:
+  const uint8_t* take(std::size_t size)
+  {
+    const uint8_t* data = m_File.view(m_Pos, size);
+    if (data == nullptr) {
+      throw data_invalid_exception("can't read from bsa");
+    }
+    m_Pos += size;
+    return data;
+  }
+
+  const MappedFile& m_File;
+  std::size_t m_Pos = 0;
+};
+
+}  // namespace BSA
+
+#endif  // BSAMAPPEDFILE_H
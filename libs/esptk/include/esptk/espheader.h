@@ -0,0 +1,63 @@
+#ifndef ESPHEADER_H
+#define ESPHEADER_H
+
+#include "record.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <set>
+#include <string>
+
+namespace ESP
+{
+
+/**
+ * @brief the information of File that's in the main record, read from a
+ * memory-mapped view of the plugin
+ *
+ * Only the pages holding the main record are ever touched and its subrecords
+ * are parsed in place, without streams or a copy of the record, for Morrowind
+ * plugins as well as the newer ones.
+ */
+class PluginHeader
+{
+public:
+  PluginHeader(const std::string& fileName);
+  PluginHeader(const std::wstring& fileName);
+
+  bool isMaster() const;
+  bool isLight(bool overlaySupport = false) const;
+  bool isMedium() const;
+  bool isOverlay() const;
+  bool isBlueprint() const;
+  bool isDummy() const;
+  uint32_t flags() const { return m_Flags; }
+  uint16_t formVersion() const { return m_FormVersion; }
+  float headerVersion() const { return m_Version; }
+  const std::string& author() const { return m_Author; }
+  const std::string& description() const { return m_Description; }
+  const std::set<std::string>& masters() const { return m_Masters; }
+
+private:
+  void init(const std::filesystem::path& path);
+  void readTES3(const uint8_t* data, std::size_t size);
+  void readTES4(const uint8_t* data, std::size_t size);
+  void readSubRecords(const uint8_t* data, std::size_t size);
+
+  bool flagSet(Record::EFlag flag) const { return (m_Flags & flag) != 0; }
+
+private:
+  uint32_t m_Flags       = 0;
+  uint16_t m_FormVersion = 0;
+  float m_Version        = 0.0f;
+  int32_t m_NumRecords   = 0;
+
+  std::string m_Author;
+  std::string m_Description;
+
+  std::set<std::string> m_Masters;
+};
+
+}  // namespace ESP
+
+#endif  // ESPHEADER_H
@@ -0,0 +1,89 @@
+#ifndef ESPRECORDS_H
+#define ESPRECORDS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace ESP
+{
+
+/**
+ * @brief walks the headers of every record in a plugin, read from a
+ * memory-mapped view of it
+ *
+ * Groups are stepped into and record data is skipped without being looked at,
+ * so compressed records cost the same as any other and only the pages holding
+ * headers are read.  The main record is parsed for the masters.  Morrowind
+ * plugins have no form ids and aren't supported.
+ */
+class PluginRecords
+{
+public:
+  struct Header
+  {
+    // four characters, never "GRUP"
+    char type[4];
+    uint32_t flags;
+
+    // the top byte indexes masters(), anything past them is new in the plugin
+    uint32_t formId;
+  };
+
+  using Callback = std::function<void(const Header&)>;
+
+  /**
+   * @brief calls `callback` for every record but the main one, in file order
+   */
+  PluginRecords(const std::string& fileName, const Callback& callback);
+  PluginRecords(const std::wstring& fileName, const Callback& callback);
+
+  // in the order form ids refer to them
+  const std::vector<std::string>& masters() const { return m_Masters; }
+
+  // of the main record
+  uint32_t flags() const { return m_Flags; }
+  float headerVersion() const { return m_Version; }
+
+  // records reported to the callback
+  std::size_t recordCount() const { return m_RecordCount; }
+
+  // records with a form id past the masters, which the plugin adds instead of
+  // overriding; the object ids are the low 24 bits
+  std::size_t newRecordCount() const { return m_NewRecordCount; }
+  uint32_t minNewObjectId() const { return m_MinNewObjectId; }
+  uint32_t maxNewObjectId() const { return m_MaxNewObjectId; }
+
+  /**
+   * @brief whether all new records fit in the object ids of a light plugin,
+   * 0x800 to 0xfff or from 0 with a 1.71 header
+   */
+  bool fitsLight() const;
+
+  /**
+   * @brief whether all new records fit in the object ids of a medium plugin,
+   * up to 0xffff
+   */
+  bool fitsMedium() const;
+
+private:
+  void init(const std::filesystem::path& path, const Callback& callback);
+  void readMainRecord(const uint8_t* data, std::size_t size);
+
+private:
+  uint32_t m_Flags             = 0;
+  float m_Version              = 0.0f;
+  std::size_t m_RecordCount    = 0;
+  std::size_t m_NewRecordCount = 0;
+  uint32_t m_MinNewObjectId    = 0;
+  uint32_t m_MaxNewObjectId    = 0;
+
+  std::vector<std::string> m_Masters;
+};
+
+}  // namespace ESP
+
+#endif  // ESPRECORDS_H
@@ -0,0 +1,237 @@
+#include "espheader.h"
+#include "espexceptions.h"
+#include "mappedfile.h"
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+
+// subrecord strings are zero-terminated, but nothing guarantees the
+// terminator is within the subrecord
+//
+std::string readString(const uint8_t* data, std::size_t size)
+{
+  const auto* begin = reinterpret_cast<const char*>(data);
+  const auto* end   = static_cast<const char*>(memchr(begin, '\0', size));
+  return std::string(begin, end != nullptr ? end : begin + size);
+}
+
+}  // namespace
+
+ESP::PluginHeader::PluginHeader(const std::string& fileName)
+{
+  init(std::filesystem::path(fileName));
+}
+
+ESP::PluginHeader::PluginHeader(const std::wstring& fileName)
+{
+  init(std::filesystem::path(fileName));
+}
+
+void ESP::PluginHeader::init(const std::filesystem::path& path)
+{
+  const ESP::MappedFile file(path);
+
+  if (file.size() < 4) {
+    throw ESP::InvalidFileException("file incomplete");
+  }
+
+  if (memcmp(file.data(), "TES3", 4) == 0) {
+    readTES3(file.data(), file.size());
+  } else if (memcmp(file.data(), "TES4", 4) == 0) {
+    readTES4(file.data(), file.size());
+  } else {
+    throw ESP::InvalidFileException("invalid file type");
+  }
+}
+
+void ESP::PluginHeader::readTES3(const uint8_t* data, std::size_t size)
+{
+  // type, data size, an unused field and flags; morrowind has no form version
+  // and its masters are told apart by their extension, so neither is read
+  constexpr std::size_t HeaderSize = 16;
+
+  // type and 32-bit size
+  constexpr std::size_t SubHeaderSize = 8;
+
+  // version, an unused field, author, description and number of records
+  constexpr std::size_t HEDRSize    = 300;
+  constexpr std::size_t AuthorSize  = 32;
+  constexpr std::size_t CommentSize = 256;
+
+  if (size < HeaderSize) {
+    throw ESP::InvalidRecordException("record incomplete");
+  }
+
+  const auto dataSize = readAt<uint32_t>(data + 4);
+  if (dataSize > size - HeaderSize) {
+    throw ESP::InvalidRecordException("record incomplete");
+  }
+
+  // the masters are all in the main record, nothing after it is touched
+  const uint8_t* record = data + HeaderSize;
+  std::size_t offset    = 0;
+
+  while (offset < dataSize) {
+    if (dataSize - offset < SubHeaderSize) {
+      throw ESP::InvalidRecordException("sub-record incomplete (unknown type)");
+    }
+
+    const uint8_t* type = record + offset;
+    const auto subSize  = readAt<uint32_t>(record + offset + 4);
+    offset += SubHeaderSize;
+
+    if (subSize > dataSize - offset) {
+      throw ESP::InvalidRecordException(std::string("sub-record incomplete: ") +
+                                        std::string(type, type + 4));
+    }
+
+    const uint8_t* sub = record + offset;
+    offset += subSize;
+
+    if (memcmp(type, "HEDR", 4) == 0) {
+      if (subSize != HEDRSize) {
+        printf("invalid header size\n");
+        m_Version    = 0.0f;
+        m_NumRecords = 1;  // prevent this esp appear like a dummy
+      } else {
+        m_Version     = readAt<float>(sub);
+        m_Author      = readString(sub + 8, AuthorSize);
+        m_Description = readString(sub + 8 + AuthorSize, CommentSize);
+        m_NumRecords  = readAt<int32_t>(sub + 8 + AuthorSize + CommentSize);
+      }
+    } else if (subSize > 0 && memcmp(type, "MAST", 4) == 0) {
+      m_Masters.insert(readString(sub, subSize));
+    }
+  }
+}
+
+void ESP::PluginHeader::readTES4(const uint8_t* data, std::size_t size)
+{
+  // type, data size, flags, id and revision, followed by the form version and
+  // an unknown field in everything newer than oblivion
+  constexpr std::size_t OblivionHeaderSize = 20;
+  constexpr std::size_t HeaderSize         = 24;
+
+  if (size < OblivionHeaderSize + 4) {
+    throw ESP::InvalidRecordException("record incomplete");
+  }
+
+  const auto dataSize = readAt<uint32_t>(data + 4);
+  m_Flags             = readAt<uint32_t>(data + 8);
+
+  std::size_t offset = HeaderSize;
+  if (memcmp(data + OblivionHeaderSize, "HEDR", 4) == 0) {
+    // oblivion-style plugins don't have a form version
+    offset = OblivionHeaderSize;
+  } else {
+    m_FormVersion = readAt<uint16_t>(data + OblivionHeaderSize);
+  }
+
+  if (dataSize > size - offset) {
+    throw ESP::InvalidRecordException("record incomplete");
+  }
+  if (dataSize == 0) {
+    throw ESP::InvalidRecordException("record has no data");
+  }
+
+  readSubRecords(data + offset, dataSize);
+}
+
+void ESP::PluginHeader::readSubRecords(const uint8_t* data, std::size_t size)
+{
+  // type and 16-bit size
+  constexpr std::size_t SubHeaderSize = 6;
+
+  std::size_t offset    = 0;
+  uint32_t sizeOverride = 0;
+
+  while (offset < size) {
+    if (size - offset < SubHeaderSize) {
+      throw ESP::InvalidRecordException("sub-record incomplete (unknown type)");
+    }
+
+    const uint8_t* type = data + offset;
+    std::size_t subSize = readAt<uint16_t>(data + offset + 4);
+    offset += SubHeaderSize;
+
+    if (memcmp(type, "XXXX", 4) == 0) {
+      // the size of the next subrecord, which doesn't fit in 16 bits
+      if (subSize != 4 || size - offset < 4) {
+        throw ESP::InvalidRecordException(
+            "XXXX record is supposed to be 4 bytes in size");
+      }
+      sizeOverride = readAt<uint32_t>(data + offset);
+      offset += 4;
+      continue;
+    }
+
+    if (sizeOverride != 0) {
+      subSize      = sizeOverride;
+      sizeOverride = 0;
+    }
+
+    if (subSize > size - offset) {
+      throw ESP::InvalidRecordException(std::string("sub-record incomplete: ") +
+                                        std::string(type, type + 4));
+    }
+
+    const uint8_t* sub = data + offset;
+    offset += subSize;
+
+    if (memcmp(type, "HEDR", 4) == 0) {
+      // version, number of records and next object id
+      if (subSize != 12) {
+        printf("invalid header size\n");
+        m_Version    = 0.0f;
+        m_NumRecords = 1;  // prevent this esp appear like a dummy
+      } else {
+        m_Version    = readAt<float>(sub);
+        m_NumRecords = readAt<int32_t>(sub + 4);
+      }
+    } else if (subSize == 0) {
+      continue;
+    } else if (memcmp(type, "MAST", 4) == 0) {
+      m_Masters.insert(readString(sub, subSize));
+    } else if (memcmp(type, "CNAM", 4) == 0) {
+      m_Author = readString(sub, subSize);
+    } else if (memcmp(type, "SNAM", 4) == 0) {
+      m_Description = readString(sub, subSize);
+    }
+  }
+}
+
+bool ESP::PluginHeader::isMaster() const
+{
+  return flagSet(Record::FLAG_MASTER);
+}
+
+bool ESP::PluginHeader::isLight(bool overlaySupport) const
+{
+  if (overlaySupport) {
+    return flagSet(Record::FLAG_LIGHT_ALTERNATE);
+  } else {
+    return flagSet(Record::FLAG_LIGHT);
+  }
+}
+
+bool ESP::PluginHeader::isMedium() const
+{
+  return flagSet(Record::FLAG_MEDIUM);
+}
+
+bool ESP::PluginHeader::isOverlay() const
+{
+  return flagSet(Record::FLAG_OVERLAY);
+}
+
+bool ESP::PluginHeader::isBlueprint() const
+{
+  return flagSet(Record::FLAG_BLUEPRINT);
+}
+
+bool ESP::PluginHeader::isDummy() const
+{
+  return m_NumRecords == 0;
+}
@@ -0,0 +1,178 @@
+#include "esprecords.h"
+#include "espexceptions.h"
+#include "mappedfile.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+// type, data size, flags, id and revision, followed by the form version and
+// an unknown field in everything newer than oblivion; groups have the same
+// size
+constexpr std::size_t OblivionHeaderSize = 20;
+constexpr std::size_t HeaderSize         = 24;
+
+// type and 16-bit size
+constexpr std::size_t SubHeaderSize = 6;
+
+// light plugins with older headers can't use the first object ids
+constexpr uint32_t LightMinObjectId  = 0x800;
+constexpr uint32_t LightMaxObjectId  = 0xfff;
+constexpr float LightFullRangeHeader = 1.71f;
+constexpr uint32_t MediumMaxObjectId = 0xffff;
+
+}  // namespace
+
+ESP::PluginRecords::PluginRecords(const std::string& fileName,
+                                  const Callback& callback)
+{
+  init(std::filesystem::path(fileName), callback);
+}
+
+ESP::PluginRecords::PluginRecords(const std::wstring& fileName,
+                                  const Callback& callback)
+{
+  init(std::filesystem::path(fileName), callback);
+}
+
+void ESP::PluginRecords::init(const std::filesystem::path& path,
+                              const Callback& callback)
+{
+  const ESP::MappedFile file(path);
+  const uint8_t* data    = file.data();
+  const std::size_t size = file.size();
+
+  if (size < OblivionHeaderSize + 4) {
+    throw ESP::InvalidFileException("file incomplete");
+  }
+
+  if (memcmp(data, "TES4", 4) != 0) {
+    throw ESP::InvalidFileException("invalid file type");
+  }
+
+  const std::size_t headerSize =
+      memcmp(data + OblivionHeaderSize, "HEDR", 4) == 0 ? OblivionHeaderSize
+                                                        : HeaderSize;
+
+  const auto mainSize = readAt<uint32_t>(data + 4);
+  m_Flags             = readAt<uint32_t>(data + 8);
+
+  if (mainSize > size - headerSize) {
+    throw ESP::InvalidRecordException("record incomplete");
+  }
+
+  readMainRecord(data + headerSize, mainSize);
+
+  std::size_t offset = headerSize + mainSize;
+
+  // groups hold their records and subgroups right after their own header, so
+  // stepping into every group visits everything in file order
+  while (offset < size) {
+    if (size - offset < headerSize) {
+      throw ESP::InvalidRecordException("record incomplete");
+    }
+
+    const uint8_t* record = data + offset;
+    const auto recordSize = readAt<uint32_t>(record + 4);
+
+    if (memcmp(record, "GRUP", 4) == 0) {
+      // the group size includes its header
+      if (recordSize < headerSize || recordSize > size - offset) {
+        throw ESP::InvalidRecordException("group incomplete");
+      }
+      offset += headerSize;
+      continue;
+    }
+
+    if (recordSize > size - offset - headerSize) {
+      throw ESP::InvalidRecordException(std::string("record incomplete: ") +
+                                        std::string(record, record + 4));
+    }
+
+    Header header;
+    memcpy(header.type, record, 4);
+    header.flags  = readAt<uint32_t>(record + 8);
+    header.formId = readAt<uint32_t>(record + 12);
+
+    if ((header.formId >> 24) >= m_Masters.size()) {
+      const uint32_t objectId = header.formId & 0xffffff;
+      if (m_NewRecordCount == 0) {
+        m_MinNewObjectId = objectId;
+        m_MaxNewObjectId = objectId;
+      } else {
+        m_MinNewObjectId = std::min(m_MinNewObjectId, objectId);
+        m_MaxNewObjectId = std::max(m_MaxNewObjectId, objectId);
+      }
+      ++m_NewRecordCount;
+    }
+
+    callback(header);
+    ++m_RecordCount;
+
+    offset += headerSize + recordSize;
+  }
+}
+
+bool ESP::PluginRecords::fitsLight() const
+{
+  if (m_NewRecordCount == 0) {
+    return true;
+  }
+
+  const uint32_t min = m_Version >= LightFullRangeHeader ? 0 : LightMinObjectId;
+  return m_MinNewObjectId >= min && m_MaxNewObjectId <= LightMaxObjectId;
+}
+
+bool ESP::PluginRecords::fitsMedium() const
+{
+  return m_NewRecordCount == 0 || m_MaxNewObjectId <= MediumMaxObjectId;
+}
+
+void ESP::PluginRecords::readMainRecord(const uint8_t* data, std::size_t size)
+{
+  std::size_t offset    = 0;
+  uint32_t sizeOverride = 0;
+
+  while (offset < size) {
+    if (size - offset < SubHeaderSize) {
+      throw ESP::InvalidRecordException("sub-record incomplete (unknown type)");
+    }
+
+    const uint8_t* type = data + offset;
+    std::size_t subSize = readAt<uint16_t>(data + offset + 4);
+    offset += SubHeaderSize;
+
+    if (memcmp(type, "XXXX", 4) == 0) {
+      if (subSize != 4 || size - offset < 4) {
+        throw ESP::InvalidRecordException(
+            "XXXX record is supposed to be 4 bytes in size");
+      }
+      sizeOverride = readAt<uint32_t>(data + offset);
+      offset += 4;
+      continue;
+    }
+
+    if (sizeOverride != 0) {
+      subSize      = sizeOverride;
+      sizeOverride = 0;
+    }
+
+    if (subSize > size - offset) {
+      throw ESP::InvalidRecordException(std::string("sub-record incomplete: ") +
+                                        std::string(type, type + 4));
+    }
+
+    const uint8_t* sub = data + offset;
+    offset += subSize;
+
+    if (memcmp(type, "HEDR", 4) == 0 && subSize == 12) {
+      m_Version = readAt<float>(sub);
+    } else if (memcmp(type, "MAST", 4) == 0 && subSize > 0) {
+      // zero-terminated, but nothing guarantees it's within the subrecord
+      const auto* begin = reinterpret_cast<const char*>(sub);
+      const auto* end   = static_cast<const char*>(memchr(begin, '\0', subSize));
+      m_Masters.emplace_back(begin, end != nullptr ? end : begin + subSize);
+    }
+  }
+}
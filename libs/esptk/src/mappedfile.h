@@ -0,0 +1,123 @@
+#ifndef ESPMAPPEDFILE_H
+#define ESPMAPPEDFILE_H
+
+#include "espexceptions.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ESP
+{
+
+// read-only view of a whole file, pages are only read once they're touched
+//
+class MappedFile
+{
+public:
+  explicit MappedFile(const std::filesystem::path& path)
+  {
+#ifdef _WIN32
+    m_File = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_File == INVALID_HANDLE_VALUE) {
+      throw ESP::InvalidFileException("file not found");
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_File, &size)) {
+      throw ESP::InvalidFileException("file not readable");
+    }
+    m_Size = static_cast<std::size_t>(size.QuadPart);
+
+    if (m_Size > 0) {
+      m_Mapping = CreateFileMappingW(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (m_Mapping != nullptr) {
+        m_Data = static_cast<const uint8_t*>(
+            MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+      }
+      if (m_Data == nullptr) {
+        throw ESP::InvalidFileException("file not readable");
+      }
+    }
+#else
+    m_File = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_File < 0) {
+      throw ESP::InvalidFileException("file not found");
+    }
+
+    struct stat st;
+    if (::fstat(m_File, &st) != 0) {
+      throw ESP::InvalidFileException("file not readable");
+    }
+    m_Size = static_cast<std::size_t>(st.st_size);
+
+    if (m_Size > 0) {
+      void* p = ::mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_File, 0);
+      if (p == MAP_FAILED) {
+        throw ESP::InvalidFileException("file not readable");
+      }
+      m_Data = static_cast<const uint8_t*>(p);
+    }
+#endif
+  }
+
+  ~MappedFile()
+  {
+#ifdef _WIN32
+    if (m_Data != nullptr) {
+      UnmapViewOfFile(m_Data);
+    }
+    if (m_Mapping != nullptr) {
+      CloseHandle(m_Mapping);
+    }
+    if (m_File != INVALID_HANDLE_VALUE) {
+      CloseHandle(m_File);
+    }
+#else
+    if (m_Data != nullptr) {
+      ::munmap(const_cast<uint8_t*>(m_Data), m_Size);
+    }
+    if (m_File >= 0) {
+      ::close(m_File);
+    }
+#endif
+  }
+
+  MappedFile(const MappedFile&)            = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const uint8_t* data() const { return m_Data; }
+  std::size_t size() const { return m_Size; }
+
+private:
+#ifdef _WIN32
+  HANDLE m_File    = INVALID_HANDLE_VALUE;
+  HANDLE m_Mapping = nullptr;
+#else
+  int m_File = -1;
+#endif
+  const uint8_t* m_Data = nullptr;
+  std::size_t m_Size    = 0;
+};
+
+template <typename T>
+T readAt(const uint8_t* data)
+{
+  T value;
+  memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+}  // namespace ESP
+
+#endif  // ESPMAPPEDFILE_H
@@ -89,8 +89,8 @@ bool GamebryoBSAInvalidation::prepareProfile(MOBase::IProfile* profile)
       GameGamebryo::readIniValue(iniFilePath, "Archive", "bInvalidateOlderFiles", "0");
   if (setting.toLong() != 1) {
     dirty = true;
-    if (!MOBase::WriteRegistryValue("Archive", "bInvalidateOlderFiles", "1",
-                                    iniFilePath)) {
+    if (!GameGamebryo::writeIniValue(iniFilePath, "Archive", "bInvalidateOlderFiles",
+                                     "1")) {
       qWarning("failed to activate BSA invalidation in \"%s\"",
                qUtf8Printable(m_IniFileName));
     }
@@ -125,7 +125,8 @@ bool GamebryoBSAInvalidation::prepareProfile(MOBase::IProfile* profile)
         iniFilePath, "Archive", "SInvalidationFile", "ArchiveInvalidation.txt");
     if (sInvalidation != "") {
       dirty = true;
-      if (!MOBase::WriteRegistryValue("Archive", "SInvalidationFile", "", iniFilePath)) {
+      if (!GameGamebryo::writeIniValue(iniFilePath, "Archive", "SInvalidationFile",
+                                       "")) {
         qWarning("failed to activate BSA invalidation in \"%s\"",
                  qUtf8Printable(m_IniFileName));
       }
@@ -153,8 +154,8 @@ bool GamebryoBSAInvalidation::prepareProfile(MOBase::IProfile* profile)
         GameGamebryo::readIniValue(iniFilePath, "Archive", "SInvalidationFile", "");
     if (sInvalidation2 != "ArchiveInvalidation.txt") {
       dirty = true;
-      if (!MOBase::WriteRegistryValue("Archive", "SInvalidationFile",
-                                      "ArchiveInvalidation.txt", iniFilePath)) {
+      if (!GameGamebryo::writeIniValue(iniFilePath, "Archive", "SInvalidationFile",
+                                       "ArchiveInvalidation.txt")) {
         qWarning("failed to activate BSA invalidation in \"%s\"",
                  qUtf8Printable(m_IniFileName));
       }
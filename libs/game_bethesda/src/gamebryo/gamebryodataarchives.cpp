@@ -37,7 +37,8 @@ QStringList GamebryoDataArchives::getArchivesFromKey(const QString& iniFile,
 void GamebryoDataArchives::setArchivesToKey(const QString& iniFile, const QString& key,
                                             const QString& value)
 {
-  if (!MOBase::WriteRegistryValue("Archive", key, value, iniFile)) {
+  // only writes if the value changed, which it usually didn't on a refresh
+  if (!GameGamebryo::writeIniValue(iniFile, "Archive", key, value)) {
     qWarning("failed to set archives in \"%s\"", qUtf8Printable(iniFile));
   }
 }
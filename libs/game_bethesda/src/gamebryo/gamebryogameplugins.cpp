@@ -17,7 +17,7 @@
 using MOBase::IOrganizer;
 using MOBase::IPluginList;
 using MOBase::reportError;
-using MOBase::SafeWriteFile;
+using MOBase::writeFileIfDifferent;
 
 GamebryoGamePlugins::GamebryoGamePlugins(IOrganizer* organizer) : m_Organizer(organizer)
 {}
@@ -93,16 +93,14 @@ void GamebryoGamePlugins::writeLoadOrderList(const MOBase::IPluginList* pluginLi
 void GamebryoGamePlugins::writeList(const IPluginList* pluginList,
                                     const QString& filePath, bool loadOrder)
 {
-  SafeWriteFile file(filePath);
-
   QStringEncoder encoder = loadOrder
                                ? QStringEncoder(QStringConverter::Encoding::Utf8)
                                : QStringEncoder(QStringConverter::Encoding::System);
 
-  file->resize(0);
-
-  file->write(
-      encoder.encode("# This file was automatically generated by Mod Organizer.\r\n"));
+  // built in memory first, the file is only touched if this differs from what's
+  // there; plugins.txt and loadorder.txt are mapped into the vfs
+  QByteArray data =
+      encoder.encode("# This file was automatically generated by Mod Organizer.\r\n");
 
   bool invalidFileNames = false;
   int writtenCount      = 0;
@@ -120,9 +118,9 @@ void GamebryoGamePlugins::writeList(const IPluginList* pluginList,
         invalidFileNames = true;
         qCritical("invalid plugin name %s", qUtf8Printable(pluginName));
       } else {
-        file->write(result);
+        data.append(result);
       }
-      file->write("\r\n");
+      data.append("\r\n");
       ++writtenCount;
     }
   }
@@ -138,7 +136,7 @@ void GamebryoGamePlugins::writeList(const IPluginList* pluginList,
     qWarning("plugin list would be empty, this is almost certainly wrong. Not "
              "saving.");
   } else {
-    file->commit();
+    writeFileIfDifferent(filePath, data);
   }
 }
 
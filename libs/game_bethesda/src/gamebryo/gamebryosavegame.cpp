@@ -25,12 +25,32 @@
 
 #define CHUNK 16384
 
+namespace
+{
+
+// set while the plugin fields are fetched, FileWrapper picks it up when it's
+// created
+thread_local bool t_SkipImages = false;
+
+}  // namespace
+
 GamebryoSaveGame::GamebryoSaveGame(QString const& file, GameGamebryo const* game,
                                    bool const lightEnabled, bool const mediumEnabled)
     : m_FileName(file), m_CreationTime(QFileInfo(file).lastModified()), m_Game(game),
       m_MediumEnabled(mediumEnabled), m_LightEnabled(lightEnabled),
       m_DataFields([this]() {
         return fetchDataFields();
+      }),
+      m_PluginFields([this]() {
+        t_SkipImages = true;
+        try {
+          auto fields  = fetchDataFields();
+          t_SkipImages = false;
+          return fields;
+        } catch (...) {
+          t_SkipImages = false;
+          throw;
+        }
       })
 {}
 
@@ -76,6 +96,14 @@ QStringList GamebryoSaveGame::allFiles() const
   return res;
 }
 
+GamebryoSaveGame::DataFields const& GamebryoSaveGame::pluginFields() const
+{
+  if (m_DataFields.hasValue()) {
+    return *m_DataFields.value();
+  }
+  return *m_PluginFields.value();
+}
+
 bool GamebryoSaveGame::hasScriptExtenderFile() const
 {
   QFileInfo file(m_FileName);
@@ -98,7 +126,8 @@ GamebryoSaveGame::FileWrapper::FileWrapper(QString const& filepath,
                                            QString const& expected)
     : m_File(filepath), m_HasFieldMarkers(false),
       m_PluginString(StringType::TYPE_WSTRING),
-      m_PluginStringFormat(StringFormat::UTF8), m_NextChunk(0)
+      m_PluginStringFormat(StringFormat::UTF8), m_NextChunk(0),
+      m_SkipImages(t_SkipImages)
 {
   if (!m_File.open(QIODevice::ReadOnly)) {
     throw std::runtime_error(
@@ -270,15 +299,20 @@ QImage GamebryoSaveGame::FileWrapper::readImage(uint32_t width, uint32_t height,
                                                 bool alpha)
 {
   int bpp = alpha ? 4 : 3;
+  if (m_SkipImages) {
+    skip<unsigned char>(width * height * bpp);
+    return {};
+  }
+
   QScopedArrayPointer<unsigned char> buffer(new unsigned char[width * height * bpp]);
   read(buffer.data(), width * height * bpp);
   QImage image(buffer.data(), width, height,
                alpha ? QImage::Format_RGBA8888_Premultiplied : QImage::Format_RGB888);
 
   // We need to copy the image here because QImage does not make a copy of the
-  // buffer when constructed.
+  // buffer when constructed, scaling makes a copy already.
   if (scale != 0) {
-    return image.copy().scaledToWidth(scale);
+    return image.scaledToWidth(scale);
   } else {
     return image.copy();
   }
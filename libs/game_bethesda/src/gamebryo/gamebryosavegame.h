@@ -61,15 +61,11 @@ public:
   virtual QString getPCLocation() const { return m_PCLocation; }
   virtual uint32_t getSaveNumber() const { return m_SaveNumber; }
 
-  QStringList const& getPlugins() const { return m_DataFields.value()->Plugins; }
-  QStringList const& getMediumPlugins() const
-  {
-    return m_DataFields.value()->MediumPlugins;
-  }
-  QStringList const& getLightPlugins() const
-  {
-    return m_DataFields.value()->LightPlugins;
-  }
+  // the plugins don't need the screenshot, so it's only decoded once it's
+  // asked for
+  QStringList const& getPlugins() const { return pluginFields().Plugins; }
+  QStringList const& getMediumPlugins() const { return pluginFields().MediumPlugins; }
+  QStringList const& getLightPlugins() const { return pluginFields().LightPlugins; }
   QImage const& getScreenshot() const { return m_DataFields.value()->Screenshot; }
 
   bool isMediumEnabled() const { return m_MediumEnabled; }
@@ -117,6 +113,11 @@ protected:
      **/
     void setPluginStringFormat(StringFormat);
 
+    /** Whether images are skipped instead of read, readImage() then returns
+     * a null image; set while only the plugins are fetched
+     **/
+    bool skipsImages() const { return m_SkipImages; }
+
     template <typename T>
     void skip(int count = 1)
     {
@@ -201,6 +202,7 @@ protected:
     StringFormat m_PluginStringFormat;
     QDataStream* m_Data;
     uint16_t m_CompressionType = 0;
+    bool m_SkipImages;
 
   private:
     template <typename T>
@@ -245,8 +247,14 @@ protected:
   };
   MOBase::MemoizedLocked<std::unique_ptr<DataFields>> m_DataFields;
 
+  // The same fields fetched with the images skipped, for the plugins.
+  MOBase::MemoizedLocked<std::unique_ptr<DataFields>> m_PluginFields;
+
   // Fetch the field.
   virtual std::unique_ptr<DataFields> fetchDataFields() const = 0;
+
+  // m_DataFields if they've been fetched already, m_PluginFields otherwise
+  DataFields const& pluginFields() const;
 };
 
 // Explicit template specialization must be at namespace scope (GCC requirement)
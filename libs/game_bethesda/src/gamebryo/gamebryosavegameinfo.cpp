@@ -93,6 +93,15 @@ GamebryoSaveGameInfo::getMissingAssets(MOBase::ISaveGame const& save) const
   return missingAssets;
 }
 
+QStringList
+GamebryoSaveGameInfo::getRequiredPlugins(MOBase::ISaveGame const& save) const
+{
+  GamebryoSaveGame const& gamebryoSave = dynamic_cast<GamebryoSaveGame const&>(save);
+
+  return gamebryoSave.getPlugins() + gamebryoSave.getMediumPlugins() +
+         gamebryoSave.getLightPlugins();
+}
+
 MOBase::ISaveGameInfoWidget*
 GamebryoSaveGameInfo::getSaveGameWidget(QWidget* parent) const
 {
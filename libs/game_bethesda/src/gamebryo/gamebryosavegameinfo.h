@@ -13,6 +13,8 @@ public:
 
   virtual MissingAssets getMissingAssets(MOBase::ISaveGame const& save) const override;
 
+  virtual QStringList getRequiredPlugins(MOBase::ISaveGame const& save) const override;
+
   virtual MOBase::ISaveGameInfoWidget* getSaveGameWidget(QWidget*) const override;
 
 protected:
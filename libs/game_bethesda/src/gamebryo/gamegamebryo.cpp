@@ -16,10 +16,12 @@
 #include "utility.h"
 #include "vdf_parser.h"
 
+#include <QDateTime>
 #include <QDir>
 #include <QDirIterator>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
 #include <QIcon>
 #include <QJsonDocument>
 #include <QJsonValue>
@@ -42,6 +44,8 @@
 #include <nak_ffi.h>
 #endif
 
+#include <map>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <vector>
@@ -302,7 +306,7 @@ bool GameGamebryo::prepareIni(const QString&)
 
     QString setting = readIniValue(profileIni, "Launcher", "bEnableFileSelection", "0");
     if (setting.toLong() != 1) {
-      MOBase::WriteRegistryValue("Launcher", "bEnableFileSelection", "1", profileIni);
+      writeIniValue(profileIni, "Launcher", "bEnableFileSelection", "1");
     }
   }
 
@@ -389,45 +393,121 @@ void GameGamebryo::ensureIniFilesExist(const QString& basePath)
   }
 }
 
-QString GameGamebryo::readIniValue(const QString& iniFile, const QString& section,
-                                   const QString& key, const QString& defaultValue)
+namespace
+{
+
+// an INI file as readIniValue() sees it: the first section of every name and the
+// first value of every key in it, names and keys are case folded
+struct ParsedIni
+{
+  QDateTime modified;
+  qint64 size = 0;
+  QHash<QString, QHash<QString, QString>> sections;
+};
+
+std::mutex g_IniCacheMutex;
+std::map<QString, ParsedIni> g_IniCache;
+
+bool parseIni(const QString& iniFile, ParsedIni& ini)
 {
   // Read INI values directly without QSettings to avoid QSettings
   // misinterpreting backslashes as line continuations.
   QFile file(iniFile);
   if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-    return defaultValue;
+    return false;
   }
 
-  QString sectionHeader = "[" + section + "]";
   QTextStream in(&file);
-  bool inSection = false;
+  QHash<QString, QString>* current = nullptr;
 
   while (!in.atEnd()) {
     QString line = in.readLine().trimmed();
 
     if (line.startsWith('[') && line.endsWith(']')) {
-      if (inSection) {
-        break;  // Left the target section without finding key
-      }
-      if (line.compare(sectionHeader, Qt::CaseInsensitive) == 0) {
-        inSection = true;
-      }
+      const QString name = line.mid(1, line.size() - 2).toCaseFolded();
+      current = ini.sections.contains(name) ? nullptr : &ini.sections[name];
       continue;
     }
 
-    if (inSection && !line.isEmpty() && !line.startsWith(';') && !line.startsWith('#')) {
+    if (current && !line.isEmpty() && !line.startsWith(';') && !line.startsWith('#')) {
       int eqPos = line.indexOf('=');
       if (eqPos > 0) {
-        QString existingKey = line.left(eqPos).trimmed();
-        if (existingKey.compare(key, Qt::CaseInsensitive) == 0) {
-          return line.mid(eqPos + 1).trimmed();
+        const QString key = line.left(eqPos).trimmed().toCaseFolded();
+        if (!current->contains(key)) {
+          current->insert(key, line.mid(eqPos + 1).trimmed());
         }
       }
     }
   }
 
-  return defaultValue;
+  return true;
+}
+
+// the value of the key, nothing if the file or the key doesn't exist
+std::optional<QString> lookupIniValue(const QString& iniFile, const QString& section,
+                                      const QString& key)
+{
+  const QFileInfo info(iniFile);
+
+  std::scoped_lock lock(g_IniCacheMutex);
+
+  if (!info.exists()) {
+    g_IniCache.erase(iniFile);
+    return {};
+  }
+
+  auto it = g_IniCache.find(iniFile);
+  if (it == g_IniCache.end() || it->second.modified != info.lastModified() ||
+      it->second.size != info.size()) {
+    ParsedIni ini;
+    ini.modified = info.lastModified();
+    ini.size     = info.size();
+
+    if (!parseIni(iniFile, ini)) {
+      g_IniCache.erase(iniFile);
+      return {};
+    }
+
+    it = g_IniCache.insert_or_assign(iniFile, std::move(ini)).first;
+  }
+
+  const auto s = it->second.sections.constFind(section.toCaseFolded());
+  if (s == it->second.sections.constEnd()) {
+    return {};
+  }
+
+  const auto v = s->constFind(key.toCaseFolded());
+  if (v == s->constEnd()) {
+    return {};
+  }
+
+  return *v;
+}
+
+}  // namespace
+
+QString GameGamebryo::readIniValue(const QString& iniFile, const QString& section,
+                                   const QString& key, const QString& defaultValue)
+{
+  return lookupIniValue(iniFile, section, key).value_or(defaultValue);
+}
+
+bool GameGamebryo::writeIniValue(const QString& iniFile, const QString& section,
+                                 const QString& key, const QString& value)
+{
+  if (lookupIniValue(iniFile, section, key) == value) {
+    return true;
+  }
+
+  const bool written = MOBase::WriteRegistryValue(section, key, value, iniFile);
+
+  // the timestamp may not have changed if the file was read in the same instant
+  {
+    std::scoped_lock lock(g_IniCacheMutex);
+    g_IniCache.erase(iniFile);
+  }
+
+  return written;
 }
 
 QString GameGamebryo::selectedVariant() const
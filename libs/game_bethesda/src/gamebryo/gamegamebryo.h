@@ -148,10 +148,16 @@ protected:
   static QString parseSteamLocation(const QString& appid, const QString& directoryName);
 
 public:  // Cross-platform INI file utilities (used by game features)
-  // Read a value from a Bethesda-style INI file using QSettings
+  // Read a value from a Bethesda-style INI file; the parsed file is kept until it
+  // changes on disk, so refreshes reading the same keys don't parse it again
   static QString readIniValue(const QString& iniFile, const QString& section,
                               const QString& key, const QString& defaultValue = QString());
 
+  // Write a value to a Bethesda-style INI file unless it already has it, returns
+  // false if the write failed
+  static bool writeIniValue(const QString& iniFile, const QString& section,
+                            const QString& key, const QString& value);
+
 protected:
   void registerFeature(std::shared_ptr<MOBase::GameFeature> feature);
 
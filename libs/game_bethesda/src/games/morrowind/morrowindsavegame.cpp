@@ -115,8 +115,12 @@ std::unique_ptr<GamebryoSaveGame::DataFields> MorrowindSaveGame::fetchDataFields
   file.skip<unsigned char>(4);  // SCRS
   file.skip<uint32_t>();        // Size of screenshot always 65536 (128x128x4) RGBA8888
 
-  QImage image       = readImageBGRA(file, 128, 128, 0, 1);
-  fields->Screenshot = image.scaled(252, 192);
+  if (file.skipsImages()) {
+    file.skip<unsigned char>(128 * 128 * 4);
+  } else {
+    QImage image       = readImageBGRA(file, 128, 128, 0, 1);
+    fields->Screenshot = image.scaled(252, 192);
+  }
 
   // definitively have to use another method to access the player level
   // it is stored in the fifth byte of the NPDT subrecord of the first NPC_ record
@@ -160,20 +164,20 @@ QImage MorrowindSaveGame::readImageBGRA(GamebryoSaveGame::FileWrapper& file,
                                         unsigned long width, unsigned long height,
                                         int scale = 0, bool alpha = false) const
 {
+  // read in one go, a read per channel is very slow
+  std::vector<uint8_t> buffer(width * height * 4);
+  file.read(buffer.data(), buffer.size());
+
   QImage image(width, height, QImage::Format_RGBA8888);
-  for (unsigned long h = 0; h < width; h++) {
-    for (unsigned long w = 0; w < width; w++) {
-      uint8_t blue;
-      file.read(blue);
-      uint8_t green;
-      file.read(green);
-      uint8_t red;
-      file.read(red);
-      uint8_t alpha;
-      file.read(alpha);
-      alpha = 255 - alpha;
-      QColor color(red, green, blue, alpha);
-      image.setPixel(w, h, color.rgba());
+  for (unsigned long h = 0; h < height; h++) {
+    const uint8_t* pixel = buffer.data() + h * width * 4;
+    uchar* line          = image.scanLine(h);
+    for (unsigned long w = 0; w < width; w++, pixel += 4, line += 4) {
+      // stored as BGRA with an inverted alpha
+      line[0] = pixel[2];
+      line[1] = pixel[1];
+      line[2] = pixel[0];
+      line[3] = 255 - pixel[3];
     }
   }
   if (scale != 0)
@@ -20,6 +20,8 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QCompleter>
 
+#include <unordered_map>
+
 #include <uibase/textviewer.h>
 
 #include "baincomplexinstallerdialog.h"
@@ -60,13 +62,118 @@ BainComplexInstallerDialog::BainComplexInstallerDialog(
 
   ui->packageBtn->setEnabled(!packageTXT.isEmpty());
   ui->nameCombo->completer()->setCaseSensitivity(Qt::CaseSensitive);
+
+  startInspection(subpackages);
 }
 
 BainComplexInstallerDialog::~BainComplexInstallerDialog()
 {
+  stopInspection();
   delete ui;
 }
 
+void BainComplexInstallerDialog::startInspection(
+    const std::vector<std::shared_ptr<const FileTreeEntry>>& subpackages)
+{
+  std::vector<std::shared_ptr<const IFileTree>> trees;
+  for (const auto& subpackage : subpackages) {
+    trees.push_back(subpackage->astree());
+  }
+
+  m_InspectionCancelled = std::make_shared<std::atomic<bool>>(false);
+
+  // posted events are dropped with the dialog, and the destructor waits for the
+  // worker before that
+  m_Inspection = std::async(std::launch::async, [this, trees = std::move(trees),
+                                                 cancelled = m_InspectionCancelled] {
+    // packages providing each file, by lowercase path
+    std::unordered_map<QString, std::vector<int>> owners;
+
+    for (int i = 0; i < static_cast<int>(trees.size()); ++i) {
+      std::size_t files = 0;
+      trees[i]->walk([&](const QString& path,
+                         std::shared_ptr<const FileTreeEntry> entry) {
+        if (*cancelled) {
+          return IFileTree::WalkReturn::STOP;
+        }
+        if (entry->isFile()) {
+          owners[(path + entry->name()).toLower()].push_back(i);
+          ++files;
+        }
+        return IFileTree::WalkReturn::CONTINUE;
+      });
+
+      if (*cancelled) {
+        return;
+      }
+
+      QMetaObject::invokeMethod(
+          this, [this, i, files] { setPackageFiles(i, files); }, Qt::QueuedConnection);
+    }
+
+    // number of files each package shares with every other one
+    std::vector<std::map<int, std::size_t>> shared(trees.size());
+    for (const auto& [path, packages] : owners) {
+      for (int package : packages) {
+        for (int other : packages) {
+          if (other != package) {
+            ++shared[package][other];
+          }
+        }
+      }
+    }
+
+    for (int i = 0; i < static_cast<int>(trees.size()); ++i) {
+      if (shared[i].empty()) {
+        continue;
+      }
+
+      std::map<QString, std::size_t> conflicts;
+      for (const auto& [other, count] : shared[i]) {
+        conflicts[trees[other]->name()] = count;
+      }
+
+      QMetaObject::invokeMethod(
+          this,
+          [this, i, conflicts = std::move(conflicts)]() mutable {
+            setPackageConflicts(i, std::move(conflicts));
+          },
+          Qt::QueuedConnection);
+    }
+  });
+}
+
+void BainComplexInstallerDialog::stopInspection()
+{
+  if (m_Inspection.valid()) {
+    *m_InspectionCancelled = true;
+    m_Inspection.wait();
+  }
+}
+
+void BainComplexInstallerDialog::setPackageFiles(int index, std::size_t files)
+{
+  if (QListWidgetItem* item = ui->optionsList->item(index)) {
+    item->setToolTip(tr("%n file(s)", "", static_cast<int>(files)));
+  }
+}
+
+void BainComplexInstallerDialog::setPackageConflicts(
+    int index, std::map<QString, std::size_t> conflicts)
+{
+  QListWidgetItem* item = ui->optionsList->item(index);
+  if (item == nullptr) {
+    return;
+  }
+
+  QStringList lines;
+  for (const auto& [name, count] : conflicts) {
+    lines.append(tr("%n file(s) also in %1", "", static_cast<int>(count)).arg(name));
+  }
+
+  item->setToolTip(item->toolTip() + "\n" + lines.join("\n"));
+}
+
 QString BainComplexInstallerDialog::getName() const
 {
   return ui->nameCombo->currentText();
@@ -74,6 +181,9 @@ QString BainComplexInstallerDialog::getName() const
 
 QStringList BainComplexInstallerDialog::updateTree(std::shared_ptr<IFileTree>& tree)
 {
+  // The worker is still reading the trees otherwise:
+  stopInspection();
+
   // Retrieve the list of selected names:
   std::set<QString, FileNameComparator> selectedNames;
   for (int i = 0; i < ui->optionsList->count(); ++i) {
@@ -20,6 +20,12 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef BAINCOMPLEXINSTALLERDIALOG_H
 #define BAINCOMPLEXINSTALLERDIALOG_H
 
+#include <atomic>
+#include <future>
+#include <map>
+#include <memory>
+#include <vector>
+
 #include <uibase/guessedvalue.h>
 #include <uibase/ifiletree.h>
 #include <uibase/tutorabledialog.h>
@@ -85,10 +91,25 @@ private slots:
   void on_packageBtn_clicked();
 
 private:
+  // counts the files of the sub-packages and the files they share on a worker
+  // thread, the items are updated as results come in
+  void startInspection(
+      const std::vector<std::shared_ptr<const MOBase::FileTreeEntry>>& subpackages);
+
+  // stops the inspection and waits for the worker, the trees must not be used
+  // from the UI thread before this
+  void stopInspection();
+
+  void setPackageFiles(int index, std::size_t files);
+  void setPackageConflicts(int index, std::map<QString, std::size_t> conflicts);
+
   Ui::BainComplexInstallerDialog* ui;
 
   bool m_Manual;
   QString m_PackageTXT;
+
+  std::shared_ptr<std::atomic<bool>> m_InspectionCancelled;
+  std::future<void> m_Inspection;
 };
 
 #endif  // BAINCOMPLEXINSTALLERDIALOG_H
@@ -20,6 +20,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "fomodinstallerdialog.h"
 #include "ui_fomodinstallerdialog.h"
 
+#include <algorithm>
 #include <array>
 #include <sstream>
 #include <utility>
@@ -441,7 +442,13 @@ FomodInstallerDialog::testCondition(int, const FileCondition* condition) const
       {"Inactive", tr("Inactive")},
       {"Active", tr("Active")}};
 
-  QString result = toString(m_FileCheck(condition->m_File));
+  const QString key = condition->m_File.toLower();
+  auto itor          = m_FileStates.find(key);
+  if (itor == m_FileStates.end()) {
+    itor = m_FileStates.emplace(key, m_FileCheck(condition->m_File)).first;
+  }
+
+  QString result = toString(itor->second);
   if (result == condition->m_State)
     return std::make_pair<bool, QString>(
         true, tr("Success: The file '%1' was marked %2.")
@@ -908,6 +915,9 @@ FomodInstallerDialog::Plugin FomodInstallerDialog::readPlugin(XmlReader& reader)
       result.m_Description = reader.getText().trimmed();
     } else if (reader.name().toString() == "image") {
       result.m_ImagePath = reader.attributes().value("path").toString();
+      if (!result.m_ImagePath.isEmpty()) {
+        m_ImagePaths.append(result.m_ImagePath);
+      }
       reader.finishedElement();
     } else if (reader.name().toString() == "files") {
       readFileList(reader, result.m_Files);
@@ -1034,6 +1044,11 @@ void FomodInstallerDialog::readPluginList(XmlReader& reader, QString const& grou
     // We need somehow to check the 'toggled' signal. how do I do that
     // void QAbstractButton::clicked ( bool checked ) [signal]
     connect(newControl, SIGNAL(clicked()), this, SLOT(widgetButtonClicked()));
+    // choices are only toggled on the current page, either by the user or when
+    // it's displayed
+    connect(newControl, &QAbstractButton::toggled, this, [this] {
+      invalidateFlags(ui->stepsStack->currentIndex());
+    });
     controls.push_back(newControl);
   }
 
@@ -1362,6 +1377,19 @@ void FomodInstallerDialog::on_websiteLabel_linkActivated(const QString& link)
 #endif
 }
 
+void FomodInstallerDialog::reloadScreenshot()
+{
+  if (ui->stepsStack->currentWidget() == nullptr) {
+    return;
+  }
+
+  QList<QAbstractButton*> choices =
+      ui->stepsStack->currentWidget()->findChildren<QAbstractButton*>("choice");
+  if (choices.count() > 0) {
+    highlightControl(choices.at(0));
+  }
+}
+
 void FomodInstallerDialog::activateCurrentPage()
 {
   QList<QAbstractButton*> choices =
@@ -1369,6 +1397,7 @@ void FomodInstallerDialog::activateCurrentPage()
   if (choices.count() > 0) {
     highlightControl(choices.at(0));
   }
+  invalidateFlags(static_cast<int>(m_PageVisible.size()));
   m_PageVisible.push_back(true);
   updateNextbtnText();
 }
@@ -1377,43 +1406,68 @@ std::pair<bool, QString> FomodInstallerDialog::testCondition(int maxIndex,
                                                              const QString& flag,
                                                              const QString& value) const
 {
-  // FIXME Review this and see if we can store the visible and evaluated variables for
-  // each page and cache like that. This would make me happier (if no one else) about
-  // the results of doing 'previous' and changing a flag to 'unset'.
+  const auto& flags = flagsBefore(maxIndex);
+  if (auto itor = flags.find(flag); itor != flags.end()) {
+    if (itor->second == value)
+      return std::make_pair(
+          true, tr("The flag '%1' matched '%2'").arg(itor->first).arg(itor->second));
+    else
+      return std::make_pair(false, tr("The flag '%1' did not match '%2'")
+                                       .arg(itor->first)
+                                       .arg(itor->second));
+  }
+  if (value.isEmpty())
+    return std::make_pair(true, tr("The condition was not matched and is empty."));
+  return std::make_pair(false, tr("The value exists but was not matched."));
+}
 
-  // iterate through all enabled condition flags on all activated controls on
-  // all visible pages if one of them matches the condition, taking the most
-  // recent setting.
-  for (int i = maxIndex - 1; i >= 0; --i) {
-    if (testVisible(i)) {
-      QWidget* page                   = ui->stepsStack->widget(i);
-      QList<QAbstractButton*> choices = page->findChildren<QAbstractButton*>("choice");
-      for (QAbstractButton const* choice : choices) {
-        if (choice->isChecked()) {
-          QVariant temp = choice->property("conditionFlags");
-          if (temp.isValid()) {
-            QVariantList conditionFlags = temp.toList();
-            for (QVariant const& variant : conditionFlags) {
-              ConditionFlag condition = variant.value<ConditionFlag>();
-              if (condition.m_Name == flag) {
-                if (condition.m_Value == value)
-                  return std::make_pair(true, tr("The flag '%1' matched '%2'")
-                                                  .arg(condition.m_Name)
-                                                  .arg(condition.m_Value));
-                else
-                  return std::make_pair(false, tr("The flag '%1' did not match '%2'")
-                                                   .arg(condition.m_Name)
-                                                   .arg(condition.m_Value));
-              }
-            }
-          }
+const std::map<QString, QString>&
+FomodInstallerDialog::flagsBefore(int pageIndex) const
+{
+  pageIndex = std::clamp(pageIndex, 0, ui->stepsStack->count());
+
+  if (m_FlagsBefore.empty()) {
+    m_FlagsBefore.emplace_back();
+  }
+
+  // the entry of a page is the one of the page before it with the flags of that
+  // page on top, the most recent setting wins
+  while (static_cast<int>(m_FlagsBefore.size()) <= pageIndex) {
+    const int previous = static_cast<int>(m_FlagsBefore.size()) - 1;
+    auto flags         = m_FlagsBefore.back();
+
+    // only evaluates conditions on the pages before `previous`, which are cached
+    if (testVisible(previous)) {
+      std::map<QString, QString> pageFlags;
+      QWidget* page = ui->stepsStack->widget(previous);
+      for (QAbstractButton const* choice :
+           page->findChildren<QAbstractButton*>("choice")) {
+        if (!choice->isChecked()) {
+          continue;
         }
+        for (QVariant const& variant : choice->property("conditionFlags").toList()) {
+          ConditionFlag condition = variant.value<ConditionFlag>();
+          // the first choice setting a flag wins within a page
+          pageFlags.emplace(condition.m_Name, condition.m_Value);
+        }
+      }
+
+      for (auto& [name, value] : pageFlags) {
+        flags.insert_or_assign(name, std::move(value));
       }
     }
+
+    m_FlagsBefore.push_back(std::move(flags));
+  }
+
+  return m_FlagsBefore[pageIndex];
+}
+
+void FomodInstallerDialog::invalidateFlags(int pageIndex)
+{
+  if (pageIndex >= 0 && static_cast<int>(m_FlagsBefore.size()) > pageIndex + 1) {
+    m_FlagsBefore.resize(pageIndex + 1);
   }
-  if (value.isEmpty())
-    return std::make_pair(true, tr("The condition was not matched and is empty."));
-  return std::make_pair(false, tr("The value exists but was not matched."));
 }
 
 bool FomodInstallerDialog::testVisible(int pageIndex) const
@@ -1445,6 +1499,7 @@ bool FomodInstallerDialog::nextPage()
       ui->stepsStack->currentWidget()->setProperty("previous", oldIndex);
       return true;
     }
+    invalidateFlags(static_cast<int>(m_PageVisible.size()));
     m_PageVisible.push_back(false);
     ++index;
   }
@@ -1510,6 +1565,7 @@ void FomodInstallerDialog::updateNextbtnText()
 
   auto old_PageVisible = m_PageVisible;
   ON_BLOCK_EXIT([&]() {
+    invalidateFlags(static_cast<int>(old_PageVisible.size()));
     m_PageVisible = old_PageVisible;
   });
 
@@ -1519,6 +1575,7 @@ void FomodInstallerDialog::updateNextbtnText()
       isLast = false;
       break;
     }
+    invalidateFlags(static_cast<int>(m_PageVisible.size()));
     m_PageVisible.push_back(false);
   }
 
@@ -1667,6 +1724,7 @@ void FomodInstallerDialog::on_prevBtn_clicked()
       previousIndex = ui->stepsStack->currentIndex() - 1;
     }
     ui->stepsStack->setCurrentIndex(previousIndex);
+    invalidateFlags(previousIndex);
     m_PageVisible.resize(previousIndex);
     ui->nextBtn->setText(tr("Next"));
   }
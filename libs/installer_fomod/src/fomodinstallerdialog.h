@@ -26,6 +26,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QString>
 
 #include <functional>
+#include <map>
 #include <vector>
 
 #include <uibase/guessedvalue.h>
@@ -216,6 +217,18 @@ public:
 
   void initData(MOBase::IOrganizer* moInfo);
 
+  /**
+   * @return the paths of the images shown for the choices of the installer, relative
+   * to the fomod path, only filled once initData() has been called
+   **/
+  const QStringList& imagePaths() const { return m_ImagePaths; }
+
+  /**
+   * @brief Show the image of the current choice again, for when the images were
+   * extracted after initData().
+   **/
+  void reloadScreenshot();
+
   /**
    * @return bool true if the user requested the manual dialog
    **/
@@ -407,6 +420,15 @@ private:
   virtual std::pair<bool, QString>
   testCondition(int maxIndex, const VersionCondition* condition) const;
   bool testVisible(int pageIndex) const;
+
+  // the flags set by the checked choices of the visible pages before
+  // `pageIndex`, built on first use and reused until invalidateFlags()
+  const std::map<QString, QString>& flagsBefore(int pageIndex) const;
+
+  // drops the cached flags that depend on the choices or the visibility of
+  // `pageIndex`
+  void invalidateFlags(int pageIndex);
+
   bool nextPage();
   void activateCurrentPage();
 
@@ -462,6 +484,13 @@ private:
 
   std::function<MOBase::IPluginList::PluginStates(const QString&)> m_FileCheck;
 
+  // lazily filled, entry k holds flagsBefore(k)
+  mutable std::vector<std::map<QString, QString>> m_FlagsBefore;
+
+  // results of m_FileCheck by lowercase file name, plugin states don't change
+  // while the dialog is open
+  mutable std::map<QString, MOBase::IPluginList::PluginStates> m_FileStates;
+
   // Because NMM maintains the sequence from the xml when dealing with things with
   // the same priority, we have to as well. This is moderately hacky.
   int m_FileSystemItemSequence;
@@ -471,6 +500,9 @@ private:
 
   // The web page in the fomod (if supplied)
   QString m_URL;
+
+  // The images referenced by the plugins, so only those need to be extracted
+  QStringList m_ImagePaths;
 };
 
 Q_DECLARE_METATYPE(FomodInstallerDialog::GroupType)
@@ -121,19 +121,28 @@ bool InstallerFomod::isArchiveSupported(std::shared_ptr<const IFileTree> tree) c
   return false;
 }
 
-void InstallerFomod::appendImageFiles(
-    std::vector<std::shared_ptr<const FileTreeEntry>>& entries,
-    std::shared_ptr<const IFileTree> tree) const
+std::vector<std::shared_ptr<const FileTreeEntry>>
+InstallerFomod::findImageFiles(std::shared_ptr<const IFileTree> tree,
+                               QStringList const& paths) const
 {
-  static std::set<QString, FileNameComparator> imageSuffixes{"png", "jpg", "jpeg",
-                                                             "gif", "bmp"};
-  for (auto entry : *tree) {
-    if (entry->isDir()) {
-      appendImageFiles(entries, entry->astree());
-    } else if (imageSuffixes.count(entry->suffix()) > 0) {
+  std::vector<std::shared_ptr<const FileTreeEntry>> entries;
+  std::set<QString, FileNameComparator> seen;
+
+  for (auto const& path : paths) {
+    auto normalized = QString(path).replace('\\', '/');
+    if (!seen.insert(normalized).second) {
+      continue;
+    }
+
+    auto entry = tree->find(normalized, FileTreeEntry::FILE);
+    if (entry != nullptr) {
       entries.push_back(entry);
+    } else {
+      log::debug("image {} of the installer not found in the archive", path);
     }
   }
+
+  return entries;
 }
 
 std::vector<std::shared_ptr<const FileTreeEntry>>
@@ -145,13 +154,12 @@ InstallerFomod::buildFomodTree(std::shared_ptr<const IFileTree> tree) const
 
   for (auto entry : *fomodTree) {
     if (entry->isFile() &&
-        (entry->compare("info.xml") == 0 || entry->compare("ModuleConfig.xml") == 0)) {
+        (entry->compare("info.xml") == 0 || entry->compare("ModuleConfig.xml") == 0 ||
+         entry->compare("screenshot.png") == 0)) {
       entries.push_back(entry);
     }
   }
 
-  appendImageFiles(entries, tree);
-
   return entries;
 }
 
@@ -222,6 +230,15 @@ InstallerFomod::install(GuessedValue<QString>& modName,
           this, modName, fomodPath, fomodDirName,
           std::bind(&InstallerFomod::fileState, this, std::placeholders::_1));
       dialog.initData(m_MOInfo);
+
+      // The images are only known once ModuleConfig.xml has been parsed, so they are
+      // extracted now, all in a single pass over the archive, instead of extracting
+      // every image of the archive up front:
+      auto imageFiles = findImageFiles(fomodTree->parent(), dialog.imagePaths());
+      if (!imageFiles.empty()) {
+        manager()->extractFiles(imageFiles);
+        dialog.reloadScreenshot();
+      }
       if (!dialog.getVersion().isEmpty()) {
         version = dialog.getVersion();
       }
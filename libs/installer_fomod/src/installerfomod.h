@@ -61,9 +61,8 @@ private:
   findFomodDirectory(std::shared_ptr<const MOBase::IFileTree> tree) const;
 
   /**
-   * @brief Build a list of entries that should be extracted sincce the FOMOD installer
-   * may require access to (currently the .xml files in the FOMOD directory and the
-   * pictures in the archive).
+   * @brief Build a list of entries that the FOMOD installer needs before it can parse
+   * the installer (the .xml files and the screenshot in the FOMOD directory).
    *
    * @param tree Base tree of the archive.
    *
@@ -73,14 +72,16 @@ private:
   buildFomodTree(std::shared_ptr<const MOBase::IFileTree> tree) const;
 
   /**
-   * @brief Recurse through the given tree and add all the images to the given vector.
+   * @brief Find the images referenced by the installer in the given tree.
    *
-   * @param result Vector of entries to add the images.
-   * @param tree The tree to look files in.
+   * @param tree The tree the image paths are relative to.
+   * @param paths Paths of the images, as found in ModuleConfig.xml.
+   *
+   * @return the entries of the images that exist, without duplicates.
    */
-  void
-  appendImageFiles(std::vector<std::shared_ptr<const MOBase::FileTreeEntry>>& entries,
-                   std::shared_ptr<const MOBase::IFileTree> tree) const;
+  std::vector<std::shared_ptr<const MOBase::FileTreeEntry>>
+  findImageFiles(std::shared_ptr<const MOBase::IFileTree> tree,
+                 QStringList const& paths) const;
 
   MOBase::IPluginList::PluginStates fileState(const QString& fileName) const;
 
@@ -38,58 +38,116 @@ System::Reflection::Assembly^ currentDomain_AssemblyResolve(System::Object^, Sys
   return nullptr;
 }
 
-IPluginInstaller::EInstallResult executeScript(System::String^ script) {
+/**
+ * Compiles the scripts, the compiler and the compiled scripts are kept for as long as
+ * the plugin is loaded.
+ *
+ * Assemblies compiled in memory cannot be unloaded from the domain, so instead of
+ * loading another copy each time a mod is installed, a script that was already
+ * compiled (e.g. when reinstalling or updating a mod) reuses the assembly, by hash of
+ * its code.
+ */
+ref class ScriptHost abstract sealed
+{
+public:
+
+  static ScriptHost() {
+    using namespace System;
+    using namespace System::CodeDom::Compiler;
+    using namespace System::Collections::Generic;
+
+    AppDomain^ currentDomain = AppDomain::CurrentDomain;
+    currentDomain->AssemblyResolve += gcnew ResolveEventHandler(currentDomain_AssemblyResolve);
+
+    // From Nexus-Mods/fomod-installer:
+    Dictionary<String^, String^>^ dicOptions = gcnew Dictionary<String^, String^>(10);
+    dicOptions->Add("CompilerVersion", "v4.0");
+
+    s_provider = CodeDomProvider::CreateProvider("CSharp", dicOptions);
+    s_assemblies = gcnew Dictionary<String^, System::Reflection::Assembly^>();
+  }
+
+  /**
+   * @return the compiled script, or nullptr if it does not compile; errors are logged
+   *     each time.
+   */
+  static System::Reflection::Assembly^ compile(System::String^ script) {
+    using namespace System;
+    using namespace System::CodeDom::Compiler;
+
+    String^ key = hash(script);
 
-  using namespace System;
-  using namespace System::CodeDom;
-  using namespace System::CodeDom::Compiler;
-  using namespace System::Collections::Generic;
-
-  AppDomain^ currentDomain = AppDomain::CurrentDomain;
-  currentDomain->AssemblyResolve += gcnew ResolveEventHandler(currentDomain_AssemblyResolve);
-
-  // From Nexus-Mods/fomod-installer:
-  Dictionary<String^, String^>^ dicOptions = gcnew Dictionary<String^, String^>(10);
-  dicOptions->Add("CompilerVersion", "v4.0");
-
-  // List of assemblies (including BaseScript) - From Nexus-Mods/fomod-installer:
-  array<String^>^ referenceAssemblies = {
-    "System.dll",
-    "System.Runtime.dll",
-    "System.Drawing.dll",
-    "System.Windows.Forms.dll",
-    "System.Xml.dll",
-    System::Reflection::Assembly::GetAssembly(BaseScript::typeid)->Location
-  };
-
-  CompilerParameters^ cp = gcnew CompilerParameters(referenceAssemblies);
-  cp->GenerateExecutable = false;
-  cp->IncludeDebugInformation = false;
-  cp->GenerateInMemory = true;
-  cp->TreatWarningsAsErrors = false;
-  CodeDomProvider^ provider = CodeDomProvider::CreateProvider("CSharp", dicOptions);
-
-  // Compile the script
-  auto result = provider->CompileAssemblyFromSource(cp, script);
-
-  int errorCount = 0;
-  for each (CompilerError ^ error in result->Errors) {
-    if (error->IsWarning) {
-      log::warn("C# [{}]: {}", error->Line, CSharp::to_string(error->ErrorText));
+    System::Reflection::Assembly^ assembly;
+    if (s_assemblies->TryGetValue(key, assembly)) {
+      log::debug("C#: reusing compiled script {}", CSharp::to_string(key));
+      return assembly;
     }
-    else {
-      log::error("C# [{}]: {}", error->Line, CSharp::to_string(error->ErrorText));
-      ++errorCount;
+
+    // List of assemblies (including BaseScript) - From Nexus-Mods/fomod-installer:
+    array<String^>^ referenceAssemblies = {
+      "System.dll",
+      "System.Runtime.dll",
+      "System.Drawing.dll",
+      "System.Windows.Forms.dll",
+      "System.Xml.dll",
+      System::Reflection::Assembly::GetAssembly(BaseScript::typeid)->Location
+    };
+
+    CompilerParameters^ cp = gcnew CompilerParameters(referenceAssemblies);
+    cp->GenerateExecutable = false;
+    cp->IncludeDebugInformation = false;
+    cp->GenerateInMemory = true;
+    cp->TreatWarningsAsErrors = false;
+
+    // Compile the script
+    auto result = s_provider->CompileAssemblyFromSource(cp, script);
+
+    int errorCount = 0;
+    for each (CompilerError ^ error in result->Errors) {
+      if (error->IsWarning) {
+        log::warn("C# [{}]: {}", error->Line, CSharp::to_string(error->ErrorText));
+      }
+      else {
+        log::error("C# [{}]: {}", error->Line, CSharp::to_string(error->ErrorText));
+        ++errorCount;
+      }
+    }
+
+    if (errorCount > 0) {
+      return nullptr;
     }
+
+    s_assemblies->Add(key, result->CompiledAssembly);
+    return result->CompiledAssembly;
   }
 
-  if (errorCount > 0) {
+private:
+
+  static System::String^ hash(System::String^ script) {
+    using namespace System;
+    using namespace System::Security::Cryptography;
+
+    auto sha = SHA256::Create();
+    array<Byte>^ digest = sha->ComputeHash(System::Text::Encoding::UTF8->GetBytes(script));
+    delete sha;
+
+    return BitConverter::ToString(digest)->Replace("-", "");
+  }
+
+  static System::CodeDom::Compiler::CodeDomProvider^ s_provider;
+  static System::Collections::Generic::Dictionary<System::String^, System::Reflection::Assembly^>^ s_assemblies;
+};
+
+IPluginInstaller::EInstallResult executeScript(System::String^ script) {
+
+  auto assembly = ScriptHost::compile(script);
+  if (assembly == nullptr) {
     return IPluginInstaller::EInstallResult::RESULT_FAILED;
   }
 
   // Execute the script:
   try {
-    auto scriptClass = result->CompiledAssembly->GetType("Script");
+    auto scriptClass = assembly->GetType("Script");
     BaseScript^ scriptObject = (BaseScript^)System::Activator::CreateInstance(scriptClass);
     auto onActivateMethod = scriptObject->GetType()->GetMethod("OnActivate");
 
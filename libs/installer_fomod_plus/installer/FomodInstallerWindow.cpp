@@ -701,7 +701,7 @@ void FomodInstallerWindow::updateDisplayForActivePlugin() const
         const auto activeStep = mViewModel->getActiveStep();
         if (!activeStep || activeStep->getGroups().empty() || activeStep->getGroups().front()->getPlugins().empty()) {
             mDescriptionBox->setText(tr("Select a plugin to see its description."));
-            mImageLabel->clear();
+            mImageLabel->setScalableResource({});
             return;
         }
         // Fall back to the first plugin in the active step when no active plugin is set.
@@ -714,7 +714,7 @@ void FomodInstallerWindow::updateDisplayForActivePlugin() const
 
     const auto image     = mViewModel->getDisplayImage();
     if (image.empty()) {
-        mImageLabel->clear();
+        mImageLabel->setScalableResource({});
         return;
     }
 
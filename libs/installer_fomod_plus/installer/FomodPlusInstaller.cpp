@@ -16,11 +16,17 @@
 #include "ui/FomodViewModel.h"
 #include "lib/CrashHandler.h"
 
+#include <QCryptographicHash>
+#include <QFile>
 #include <QMessageBox>
 #include <QSettings>
 
 using namespace Qt::Literals::StringLiterals;
 
+namespace {
+constexpr size_t MAX_PARSED_CONFIGS = 32;
+}
+
 /*
 --------------------------------------------------------------------------------
                               Init
@@ -381,7 +387,16 @@ ParsedFilesTuple FomodPlusInstaller::parseFomodFiles(const std::shared_ptr<IFile
         FileTreeEntry::FILE
         );
 
-    // Extract files first.
+    const auto extract = [this](const vector<shared_ptr<const FileTreeEntry> >& entries) {
+        auto paths = manager()->extractFiles(entries);
+        // Normalize backslash separators from MO2's internal file tree to forward slashes for Linux
+        for (auto& p : paths) {
+            p.replace('\\', '/');
+        }
+        return paths;
+    };
+
+    // Only the xml files are extracted first, they tell which of the other files are needed.
     vector<std::shared_ptr<const FileTreeEntry> > toExtract = {};
     if (moduleConfig) {
         toExtract.push_back(moduleConfig);
@@ -392,21 +407,35 @@ ParsedFilesTuple FomodPlusInstaller::parseFomodFiles(const std::shared_ptr<IFile
     if (infoXML) {
         toExtract.push_back(infoXML);
     }
-    appendImageFiles(toExtract, tree);
-    appendPluginFiles(toExtract, tree); // For patch wizard data collection
-    auto paths = manager()->extractFiles(toExtract);
-    // Normalize backslash separators from MO2's internal file tree to forward slashes for Linux
-    for (auto& p : paths) {
-        p.replace('\\', '/');
-    }
+    auto paths = extract(toExtract);
 
-    auto moduleConfiguration = std::make_unique<ModuleConfiguration>();
-    try {
-        moduleConfiguration->deserialize(paths.at(0));
-    } catch (XmlParseException& e) {
-        logMessage(ERR, std::format("FomodPlusInstaller::install - error parsing moduleConfig.xml: {}", e.what()));
+    QFile moduleConfigFile(paths.at(0));
+    if (!moduleConfigFile.open(QIODevice::ReadOnly)) {
+        logMessage(ERR, std::format("FomodPlusInstaller::install - failed to open moduleConfig.xml: {}",
+            moduleConfigFile.errorString().toStdString()));
         return emptyResult;
     }
+    const QByteArray content = moduleConfigFile.readAll();
+    const QByteArray hash    = QCryptographicHash::hash(content, QCryptographicHash::Sha1);
+
+    std::unique_ptr<ModuleConfiguration> moduleConfiguration;
+    if (const auto itor = mParsedConfigs.find(hash); itor != mParsedConfigs.end()) {
+        logMessage(DEBUG, "FomodPlusInstaller::install - reusing parsed moduleConfig.xml");
+        moduleConfiguration = std::make_unique<ModuleConfiguration>(*itor->second);
+    } else {
+        moduleConfiguration = std::make_unique<ModuleConfiguration>();
+        try {
+            moduleConfiguration->deserialize(content);
+        } catch (XmlParseException& e) {
+            logMessage(ERR, std::format("FomodPlusInstaller::install - error parsing moduleConfig.xml: {}", e.what()));
+            return emptyResult;
+        }
+
+        if (mParsedConfigs.size() >= MAX_PARSED_CONFIGS) {
+            mParsedConfigs.clear();
+        }
+        mParsedConfigs.emplace(hash, std::make_shared<const ModuleConfiguration>(*moduleConfiguration));
+    }
 
     auto infoFile = std::make_unique<FomodInfoFile>();
     if (infoXML) {
@@ -417,34 +446,62 @@ ParsedFilesTuple FomodPlusInstaller::parseFomodFiles(const std::shared_ptr<IFile
         }
     }
 
+    // Then everything the installer references, in a single pass over the archive so solid
+    // archives are only decompressed once more.
+    vector<shared_ptr<const FileTreeEntry> > referenced = {};
+    appendImageFiles(referenced, fomodDir->parent(), *moduleConfiguration);
+    appendPluginFiles(referenced, fomodDir->parent(), *moduleConfiguration); // For patch wizard data collection
+    if (!referenced.empty()) {
+        paths.append(extract(referenced));
+    }
+
     return std::make_tuple(std::move(infoFile), std::move(moduleConfiguration), paths);
 }
 
-// Taken from https://github.com/ModOrganizer2/modorganizer-installer_fomod/blob/master/src/installerfomod.cpp#L123
+// Paths in ModuleConfig.xml are relative to the directory containing the fomod directory.
+void FomodPlusInstaller::appendReferencedFile(vector<shared_ptr<const FileTreeEntry> >& entries,
+    const shared_ptr<const IFileTree>& root, const std::string& path)
+{
+    if (path.empty()) {
+        return;
+    }
+    const auto entry = root->find(QString::fromStdString(path), FileTreeEntry::FILE);
+    if (entry != nullptr && std::ranges::find(entries, entry) == entries.end()) {
+        entries.push_back(entry);
+    }
+}
+
 void FomodPlusInstaller::appendImageFiles(vector<shared_ptr<const FileTreeEntry> >& entries,
-    const shared_ptr<const IFileTree>& tree)
+    const shared_ptr<const IFileTree>& root, const ModuleConfiguration& config)
 {
-    static std::set<QString, FileNameComparator> imageSuffixes{ "png", "jpg", "jpeg", "gif", "bmp" };
-    for (auto entry : *tree) {
-        if (entry->isDir()) {
-            appendImageFiles(entries, entry->astree());
-        } else if (imageSuffixes.contains(entry->suffix())) {
-            entries.push_back(entry);
+    appendReferencedFile(entries, root, config.moduleImage.path);
+    for (const auto& step : config.installSteps.installSteps) {
+        for (const auto& group : step.optionalFileGroups.groups) {
+            for (const auto& plugin : group.plugins.plugins) {
+                appendReferencedFile(entries, root, plugin.image.path);
+            }
         }
     }
 }
 
 void FomodPlusInstaller::appendPluginFiles(vector<shared_ptr<const FileTreeEntry> >& entries,
-    const shared_ptr<const IFileTree>& tree)
+    const shared_ptr<const IFileTree>& root, const ModuleConfiguration& config)
 {
     // Don't bother with this stuff if the user doesn't care about the wizard.
     // It may slightly bloat the temp file directory if not needed.
-    if (isWizardIntegrated()) {
-        for (auto entry : *tree) {
-            if (entry->isDir()) {
-                appendPluginFiles(entries, entry->astree());
-            } else if (isPluginFile(entry->suffix())) {
-                entries.push_back(entry);
+    if (!isWizardIntegrated()) {
+        return;
+    }
+
+    // Only the plugins of the options are read by FomodDB::getEntryFromFomod()
+    for (const auto& step : config.installSteps.installSteps) {
+        for (const auto& group : step.optionalFileGroups.groups) {
+            for (const auto& plugin : group.plugins.plugins) {
+                for (const auto& file : plugin.files.files) {
+                    if (!file.isFolder && isPluginFile(file.source)) {
+                        appendReferencedFile(entries, root, file.source);
+                    }
+                }
             }
         }
     }
@@ -16,6 +16,8 @@
 #include <integration/FomodDataContent.h>
 #include <FOMODData/FomodDB.h>
 
+#include <unordered_map>
+
 class FomodInstallerWindow;
 
 using namespace MOBase;
@@ -83,6 +85,9 @@ private:
     bool mInstallerUsed{ false };
     std::shared_ptr<FomodDataContent> mFomodContent{ nullptr };
     std::unique_ptr<FomodDB> mFomodDb;
+    // parsed ModuleConfig.xml files by the hash of their contents, reinstalling a mod doesn't parse
+    // its installer again; cleared when it grows too large
+    std::unordered_map<QByteArray, std::shared_ptr<const ModuleConfiguration> > mParsedConfigs;
 
     /**
    * @brief Retrieve the tree entry corresponding to the fomod directory.
@@ -98,10 +103,14 @@ private:
 
     [[nodiscard]] ParsedFilesTuple parseFomodFiles(const shared_ptr<IFileTree>& tree);
 
+    static void appendReferencedFile(vector<shared_ptr<const FileTreeEntry> >& entries,
+        const shared_ptr<const IFileTree>& root, const std::string& path);
+
     static void appendImageFiles(vector<shared_ptr<const FileTreeEntry> >& entries,
-        const shared_ptr<const IFileTree>& tree);
+        const shared_ptr<const IFileTree>& root, const ModuleConfiguration& config);
 
-    void appendPluginFiles(vector<shared_ptr<const FileTreeEntry> >& entries, const shared_ptr<const IFileTree>& tree);
+    void appendPluginFiles(vector<shared_ptr<const FileTreeEntry> >& entries,
+        const shared_ptr<const IFileTree>& root, const ModuleConfiguration& config);
 
     void setupUiInjection() const;
     void toggleFeature(bool enabled) const;
@@ -1,5 +1,6 @@
 ﻿#include "FileInstaller.h"
 
+#include <unordered_map>
 #include <utility>
 
 #include "ui/FomodViewModel.h"
@@ -35,24 +36,78 @@ std::shared_ptr<IFileTree> FileInstaller::install() const
     logMessage(INFO, "FlagMap");
     logMessage(INFO, mFlagMap->toString());
 
-    // update the file tree with the new files
+    const auto operations = resolveInstallOperations(filesToInstall);
+    logMessage(INFO, "Applying " + std::to_string(operations.size()) + " file operations");
+
+    // update the file tree with the new files, every path is only written once
     const std::shared_ptr<IFileTree> installTree = mFileTree->createOrphanTree();
+    for (const auto& [source, destination] : operations) {
+        installTree->copy(source, destination, IFileTree::InsertPolicy::MERGE);
+    }
 
-    for (const auto& file : filesToInstall) {
+    // This file will be written by the InstallationManager later.
+    const auto jsonFilePath = "fomod.json";
+    installTree->addFile(QString::fromStdString(jsonFilePath), true);
+    logMessage(DEBUG, "Added fomod.json placeholder file to install tree.");
 
+    logMessage(DEBUG, "FileInstaller::install completed.");
+    return installTree;
+}
+
+std::vector<InstallOperation> FileInstaller::resolveInstallOperations(const std::vector<File>& files) const
+{
+    std::vector<InstallOperation> operations;
+    // index of the operation writing a path, paths are case-insensitive like the tree
+    std::unordered_map<QString, std::size_t> byDestination;
+    // folders are often listed by several entries, they're only looked up once
+    std::unordered_map<QString, std::shared_ptr<const FileTreeEntry> > sources;
+
+    const auto add = [&](const std::shared_ptr<const FileTreeEntry>& source, const QString& destination) {
+        const auto key = destination.toLower();
+        if (const auto itor = byDestination.find(key); itor != byDestination.end()) {
+            // a later entry (or one with a higher priority) overwrites the file
+            operations[itor->second].source = nullptr;
+            itor->second                    = operations.size();
+        } else {
+            byDestination.emplace(key, operations.size());
+        }
+        operations.push_back({ source, destination });
+    };
+
+    const auto addTree = [&](const auto& self, const std::shared_ptr<const IFileTree>& tree,
+        const QString& destination) -> void {
+        for (const auto& entry : *tree) {
+            const auto path = destination.isEmpty() ? entry->name() : destination + "/" + entry->name();
+            if (!entry->isDir()) {
+                add(entry, path);
+            } else if (const auto subtree = entry->astree(); subtree->empty()) {
+                add(entry, path);
+            } else {
+                self(self, subtree, path);
+            }
+        }
+    };
+
+    for (const auto& file : files) {
         logMessage(DEBUG,
                    "Processing install entry source=" + file.source + ", destination=" +
                        (file.destination.has_value() ? file.destination.value() : "<default>") +
                        ", priority=" + std::to_string(file.priority));
-        const auto sourcePath = getQualifiedFilePath(file.source);
-        const auto sourceNode = mFileTree->find(QString::fromStdString(sourcePath));
+        const auto sourcePath = QString::fromStdString(getQualifiedFilePath(file.source));
+
+        auto itor = sources.find(sourcePath.toLower());
+        if (itor == sources.end()) {
+            itor = sources.emplace(sourcePath.toLower(), mFileTree->find(sourcePath)).first;
+        }
+
+        const auto& sourceNode = itor->second;
         if (sourceNode == nullptr) {
             logMessage(ERR, "Could not find source: " + file.source);
             continue;
         }
         const auto targetPath = file.destination.has_value()
             ? QString::fromStdString(file.destination.value())
-            : QString::fromStdString(sourcePath);
+            : sourcePath;
 
         // If it's a folder, copy the contents of the folder, not the folder itself.
         if (sourceNode->isDir()) {
@@ -60,29 +115,18 @@ std::shared_ptr<IFileTree> FileInstaller::install() const
                        "Copying directory '" + file.source + "' into target '" + targetPath.toStdString() +
                            "'");
             // TODO: Check if target path is literally undefined/null
-            const auto& tree = sourceNode->astree();
-            for (auto it = tree->begin(); it != tree->end(); ++it) {
-                const auto& entry = *it;
-                const auto path   = targetPath.isEmpty() ? entry->name() : targetPath + "/" + entry->name();
-                logMessage(DEBUG,
-                           "  Copying entry '" + entry->name().toStdString() + "' to '" +
-                               path.toStdString() + "'");
-                installTree->copy(entry, path, IFileTree::InsertPolicy::MERGE);
-            }
+            addTree(addTree, sourceNode->astree(), targetPath);
         } else {
             logMessage(DEBUG,
                        "Copying file '" + file.source + "' to '" + targetPath.toStdString() + "'");
-            installTree->copy(sourceNode, targetPath, IFileTree::InsertPolicy::MERGE);
+            add(sourceNode, targetPath);
         }
     }
 
-    // This file will be written by the InstallationManager later.
-    const auto jsonFilePath = "fomod.json";
-    installTree->addFile(QString::fromStdString(jsonFilePath), true);
-    logMessage(DEBUG, "Added fomod.json placeholder file to install tree.");
-
-    logMessage(DEBUG, "FileInstaller::install completed.");
-    return installTree;
+    std::erase_if(operations, [](const InstallOperation& operation) {
+        return operation.source == nullptr;
+    });
+    return operations;
 }
 
 nlohmann::json FileInstaller::generateFomodJson() const
@@ -260,7 +304,7 @@ std::vector<File> FileInstaller::collectFilesToInstall() const
     // Files will all have a default priority of 0 if not specified, so the order should also be informed by the
     // order they appear within XML. That's why we put conditionalFileInstalls after.
     logMessage(DEBUG, "Sorting " + std::to_string(allFiles.size()) + " files by priority.");
-    std::ranges::sort(allFiles, [](const auto& a, const auto& b) {
+    std::ranges::stable_sort(allFiles, [](const auto& a, const auto& b) {
         return a.priority < b.priority;
     });
 
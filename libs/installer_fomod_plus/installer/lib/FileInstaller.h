@@ -28,6 +28,13 @@ using namespace MOBase;
 using FileGlobalIndex = int;
 using FileDescriptor = std::pair<File, FileGlobalIndex>;
 
+// A single archive entry and its path in the install tree. Folders in the FOMOD are expanded into
+// one operation per file, or per empty directory, so overlapping folders can be resolved up front.
+struct InstallOperation {
+    std::shared_ptr<const FileTreeEntry> source;
+    QString destination;
+};
+
 class StepViewModel;
 
 class FileInstaller {
@@ -87,6 +94,10 @@ private:
 
     std::vector<File> collectFilesToInstall() const;
 
+    // the operations installing `files` in order of priority, where only the last one writing
+    // a path is kept
+    std::vector<InstallOperation> resolveInstallOperations(const std::vector<File>& files) const;
+
     void logMessage(LogLevel level, const std::string& message) const
     {
         log.logMessage(level, "[INSTALLER] " + message);
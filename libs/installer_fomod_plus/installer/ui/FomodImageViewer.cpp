@@ -149,14 +149,9 @@ QScrollArea* FomodImageViewer::createPreviewImages(QWidget* parent)
         layout->addWidget(imageLabel);
         mImagePanes.emplace_back(imageLabel);
 
-        // imageLabel->setScalableResource(mLabelsAndImages[i].second);
-        const auto imagePath = mLabelsAndImages[i].second;
-
-        QThreadPool::globalInstance()->start([imageLabel, imagePath]() {
-            QMetaObject::invokeMethod(imageLabel, [imageLabel, imagePath]() {
-                imageLabel->setScalableResource(imagePath);
-            }, Qt::QueuedConnection);
-        });
+        // decoded in the background, and only as large as the preview
+        imageLabel->setDecodeSize(imageLabel->size());
+        imageLabel->setScalableResource(mLabelsAndImages[i].second);
     }
 
     widget->setLayout(layout);
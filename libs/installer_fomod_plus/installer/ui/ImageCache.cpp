@@ -0,0 +1,85 @@
+#include "ImageCache.h"
+
+#include <QCoreApplication>
+#include <QImageReader>
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QThreadPool>
+
+#include <algorithm>
+
+namespace {
+constexpr qsizetype MAX_CACHE_KIB = 128 * 1024;
+
+// the receiver is checked on the main thread, it may be deleted while the image is decoded
+void deliver(const QPointer<QObject>& receiver, const std::function<void(const QImage&)>& callback,
+    const QImage& image)
+{
+    QMetaObject::invokeMethod(qApp, [receiver, callback, image] {
+        if (receiver) {
+            callback(image);
+        }
+    }, Qt::QueuedConnection);
+}
+}
+
+ImageCache& ImageCache::instance()
+{
+    static ImageCache cache;
+    return cache;
+}
+
+ImageCache::ImageCache() : mImages(MAX_CACHE_KIB) {}
+
+QString ImageCache::key(const QString& path, const QSize& maxSize)
+{
+    if (!maxSize.isValid()) {
+        return path;
+    }
+    return QString("%1|%2x%3").arg(path).arg(maxSize.width()).arg(maxSize.height());
+}
+
+QImage ImageCache::decode(const QString& path, const QSize& maxSize)
+{
+    QImageReader reader(path);
+    reader.setAutoTransform(true);
+
+    // scaling while decoding is much cheaper for the formats supporting it
+    if (maxSize.isValid()) {
+        if (const QSize size = reader.size(); size.isValid() &&
+            (size.width() > maxSize.width() || size.height() > maxSize.height())) {
+            reader.setScaledSize(size.scaled(maxSize, Qt::KeepAspectRatio));
+        }
+    }
+
+    const QImage image = reader.read();
+    if (image.isNull()) {
+        qWarning(">%s< is a null image: %s", qUtf8Printable(path), qUtf8Printable(reader.errorString()));
+    }
+    return image;
+}
+
+void ImageCache::load(const QString& path, const QSize& maxSize, QObject* receiver,
+    std::function<void(const QImage&)> callback)
+{
+    const QString cacheKey = key(path, maxSize);
+
+    {
+        QMutexLocker lock(&mMutex);
+        if (const QImage* image = mImages.object(cacheKey)) {
+            deliver(receiver, callback, *image);
+            return;
+        }
+    }
+
+    QThreadPool::globalInstance()->start([this, path, maxSize, cacheKey, receiver = QPointer(receiver),
+                                             callback = std::move(callback)] {
+        const QImage image = decode(path, maxSize);
+        if (!image.isNull()) {
+            QMutexLocker lock(&mMutex);
+            mImages.insert(cacheKey, new QImage(image), std::max<qsizetype>(1, image.sizeInBytes() / 1024));
+        }
+
+        deliver(receiver, callback, image);
+    });
+}
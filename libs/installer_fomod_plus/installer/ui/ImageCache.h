@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QPointer>
+#include <QSize>
+#include <QString>
+
+#include <functional>
+
+// Decoded installer images shared by all the labels showing them, so hovering back and forth
+// between options doesn't decode the same files again. Images are decoded on the global thread
+// pool and the cache is bounded by the memory they use.
+class ImageCache {
+public:
+    static ImageCache& instance();
+
+    // calls `callback` on the main thread with the image at `path`, scaled down to fit
+    // `maxSize` if it's valid; the image is null if the file can't be decoded and `callback` isn't
+    // called if `receiver` is gone by then
+    void load(const QString& path, const QSize& maxSize, QObject* receiver,
+        std::function<void(const QImage&)> callback);
+
+private:
+    ImageCache();
+
+    static QString key(const QString& path, const QSize& maxSize);
+    static QImage decode(const QString& path, const QSize& maxSize);
+
+    QMutex mMutex;
+    // cost is in KiB
+    QCache<QString, QImage> mImages;
+};
@@ -1,4 +1,5 @@
 ﻿#include "ScaleLabel.h"
+#include "ImageCache.h"
 #include <QResizeEvent>
 #include <iostream>
 
@@ -13,6 +14,9 @@ static bool isResourceMovie(const QString& path)
 
 void ScaleLabel::setScalableResource(const QString& path)
 {
+    ++mGeneration;
+    mHasResource = false;
+
     if (const auto m = movie()) {
         setMovie(nullptr);
         delete m;
@@ -72,13 +76,14 @@ void ScaleLabel::setScalableMovie(const QString& path)
 
 void ScaleLabel::setScalableImage(const QString& path)
 {
-    if (const QImage image(path); image.isNull()) {
-        qWarning(">%s< is a null image", qUtf8Printable(path));
-    } else {
+    ImageCache::instance().load(path, mDecodeSize, this, [this, generation = mGeneration](const QImage& image) {
+        if (generation != mGeneration || image.isNull()) {
+            return;
+        }
         mUnscaledImage = image;
         setPixmap(QPixmap::fromImage(image).scaled(size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
         mHasResource = true;
-    }
+    });
 }
 
 void ScaleLabel::resizeEvent(QResizeEvent* event)
@@ -17,6 +17,8 @@ public:
 
     void setScalableResource(const QString& path);
     void setStatic(bool isStatic);
+    // images are decoded to fit this size if it's valid, for labels that never show them larger
+    void setDecodeSize(const QSize& size) { mDecodeSize = size; }
     [[nodiscard]] bool hasResource() const { return mHasResource; }
 
 signals:
@@ -40,6 +42,9 @@ private:
 
     QImage mUnscaledImage;
     QSize mOriginalMovieSize;
+    QSize mDecodeSize;
+    // bumped for every resource, images decoded for an older one are dropped
+    quint64 mGeneration = 0;
     bool mHasResource = false;
     bool misStatic    = false;
 };
\ No newline at end of file
@@ -28,19 +28,21 @@ inline std::ostream& operator<<(std::ostream& os, const Archive::Error& error)
     return os;
 }
 
-inline bool hasFomodFiles(const std::vector<FileData*>& files)
+inline bool hasFomodFiles(const Archive& archive)
 {
     bool hasModuleXml = false;
     bool hasInfoXml   = false;
 
-    for (const auto* file : files) {
-        if (endsWithCaseInsensitive(file->getArchiveFilePath(), StringConstants::FomodFiles::W_MODULE_CONFIG.data())) {
+    // the listing stops as soon as both files are found
+    archive.forEachEntry([&](std::size_t, const std::wstring& path, bool) {
+        if (endsWithCaseInsensitive(path, StringConstants::FomodFiles::W_MODULE_CONFIG.data())) {
             hasModuleXml = true;
         }
-        if (endsWithCaseInsensitive(file->getArchiveFilePath(), StringConstants::FomodFiles::W_INFO_XML.data())) {
+        if (endsWithCaseInsensitive(path, StringConstants::FomodFiles::W_INFO_XML.data())) {
             hasInfoXml = true;
         }
-    }
+        return !(hasModuleXml && hasInfoXml);
+    });
     return hasModuleXml && hasInfoXml;
 }
 
@@ -82,7 +84,7 @@ public:
             return ScanResult::NO_ARCHIVE;
         }
 
-        if (hasFomodFiles(archive->getFileList())) {
+        if (hasFomodFiles(*archive)) {
             std::cout << "Found FOMOD files in " << qualifiedInstallerPath.toStdString() << std::endl;
             return ScanResult::HAS_FOMOD;
         }
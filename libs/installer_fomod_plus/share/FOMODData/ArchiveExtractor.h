@@ -148,13 +148,13 @@ public:
             return false;
         }
 
-        for (const auto* fileData : archive->getFileList()) {
-            const auto path = QString::fromStdWString(fileData->getArchiveFilePath());
-            if (path.toLower().endsWith("fomod/moduleconfig.xml") ||
-                path.toLower().endsWith("fomod\\moduleconfig.xml")) {
-                return true;
-            }
-        }
-        return false;
+        // stops at the first match, without reading the whole file list
+        bool found = false;
+        archive->forEachEntry([&found](std::size_t, const std::wstring& filePath, bool) {
+            const auto path = QString::fromStdWString(filePath).toLower();
+            found = path.endsWith("fomod/moduleconfig.xml") || path.endsWith("fomod\\moduleconfig.xml");
+            return !found;
+        });
+        return found;
     }
 };
@@ -320,6 +320,11 @@ bool ModuleConfiguration::deserialize(const QString& filePath)
     const QByteArray content = file.readAll();
     file.close();
 
+    return deserialize(content);
+}
+
+bool ModuleConfiguration::deserialize(const QByteArray& content)
+{
     pugi::xml_document doc;
     if (const pugi::xml_parse_result result = doc.load_buffer(content.constData(), content.size()); !result) {
         throw XmlParseException(std::format("XML parsed with errors: {}", result.description()));
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <optional>
 #include <pugixml.hpp>
+#include <qbytearray.h>
 #include <qstring.h>
 #include <string>
 #include <vector>
@@ -302,4 +303,5 @@ public:
     ConditionalFileInstall conditionalFileInstalls;
 
     bool deserialize(const QString& filePath);
+    bool deserialize(const QByteArray& content);
 };
\ No newline at end of file
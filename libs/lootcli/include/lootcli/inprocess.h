@@ -0,0 +1,35 @@
+#ifndef MODORGANIZER_LOOTCLI_INPROCESS_INCLUDED
+#define MODORGANIZER_LOOTCLI_INPROCESS_INCLUDED
+
+#include "lootcli.h"
+#include <functional>
+#include <string>
+
+namespace lootcli
+{
+
+// what lootcli takes on its command line
+struct Parameters
+{
+  std::string game;
+  std::string gamePath;
+  std::string pluginListPath;
+  std::string language;
+  LogLevels logLevel    = LogLevels::Info;
+  bool updateMasterlist = true;
+};
+
+// does what the lootcli executable does, but on the calling thread of this
+// process, only available when linking to lootcli-core; messages are given to
+// `onMessage` on that thread instead of being printed and the json report is
+// put in `report` instead of a file
+//
+// returns what lootcli would exit with
+//
+int runInProcess(const Parameters& parameters,
+                 const std::function<void(const Message&)>& onMessage,
+                 std::string& report);
+
+}  // namespace lootcli
+
+#endif  // MODORGANIZER_LOOTCLI_INPROCESS_INCLUDED
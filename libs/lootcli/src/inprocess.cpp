@@ -0,0 +1,36 @@
+#include "lootthread.h"
+#include <lootcli/inprocess.h>
+
+namespace lootcli
+{
+
+int runInProcess(const Parameters& parameters,
+                 const std::function<void(const Message&)>& onMessage,
+                 std::string& report)
+{
+  try {
+    LOOTWorker worker;
+
+    worker.setMessageCallback(onMessage);
+    worker.setKeepGame(true);
+    worker.setUpdateMasterlist(parameters.updateMasterlist);
+    worker.setGame(parameters.game);
+    worker.setGamePath(parameters.gamePath);
+    worker.setPluginListPath(parameters.pluginListPath);
+    worker.setLogLevel(toLootLogLevel(parameters.logLevel));
+
+    if (!parameters.language.empty()) {
+      worker.setLanguageCode(parameters.language);
+    }
+
+    const int r = worker.run();
+    report      = worker.report();
+
+    return r;
+  } catch (const std::exception& e) {
+    onMessage(Message::fromLog(LogLevels::Error, std::string("Error: ") + e.what()));
+    return 1;
+  }
+}
+
+}  // namespace lootcli
@@ -103,6 +103,21 @@ void LOOTWorker::setUpdateMasterlist(bool update)
   m_UpdateMasterlist = update;
 }
 
+void LOOTWorker::setMessageCallback(std::function<void(const lootcli::Message&)> f)
+{
+  m_MessageCallback = std::move(f);
+}
+
+void LOOTWorker::setKeepGame(bool keep)
+{
+  m_KeepGame = keep;
+}
+
+void LOOTWorker::setGlobalLocale(bool global)
+{
+  m_GlobalLocale = global;
+}
+
 void LOOTWorker::setPluginListPath(const std::string& pluginListPath)
 {
   m_PluginListPath = pluginListPath;
@@ -155,6 +170,11 @@ fs::path LOOTWorker::masterlistPath() const
   return gamePath() / "masterlist.yaml";
 }
 
+fs::path LOOTWorker::masterlistValidatorsPath() const
+{
+  return gamePath() / "masterlist.yaml.validators";
+}
+
 fs::path LOOTWorker::userlistPath() const
 {
   return gamePath() / "userlist.yaml";
@@ -556,23 +576,63 @@ std::string LOOTWorker::migrateMasterlistSource(const std::string& source)
   return source;
 }
 
+// validators are kept as two lines, the ETag and the Last-Modified date
+//
+static LOOTWorker::Validators readValidators(const fs::path& path)
+{
+  LOOTWorker::Validators v;
+
+  std::ifstream in(path);
+  std::getline(in, v.etag);
+  std::getline(in, v.lastModified);
+
+  return v;
+}
+
+static void writeValidators(const fs::path& path, const LOOTWorker::Validators& v)
+{
+  std::ofstream(path) << v.etag << "\n" << v.lastModified << "\n";
+}
+
 #ifdef _WIN32
-DWORD LOOTWorker::GetFile(const WCHAR* szUrl,      // Full URL
-                          const CHAR* szFileName)  // Local file name
+// the value of a header of the response, empty if it doesn't have one
+//
+static std::string queryHeader(HINTERNET hRequest, DWORD info)
+{
+  DWORD size = 0;
+  WinHttpQueryHeaders(hRequest, info, WINHTTP_HEADER_NAME_BY_INDEX,
+                      WINHTTP_NO_OUTPUT_BUFFER, &size, WINHTTP_NO_HEADER_INDEX);
+  if (GetLastError() != ERROR_INSUFFICIENT_BUFFER || size == 0) {
+    return {};
+  }
+
+  std::wstring value(size / sizeof(wchar_t), L'\0');
+  if (!WinHttpQueryHeaders(hRequest, info, WINHTTP_HEADER_NAME_BY_INDEX,
+                           value.data(), &size, WINHTTP_NO_HEADER_INDEX)) {
+    return {};
+  }
+  value.resize(size / sizeof(wchar_t));
+
+  std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+  return converter.to_bytes(value);
+}
+
+bool LOOTWorker::GetFile(const std::string& url, const fs::path& fileName,
+                         Validators& validators, bool& modified)
 {
-  BYTE szTemp[25];
   DWORD dwSize       = 0;
   DWORD dwDownloaded = 0;
   LPSTR pszOutBuffer;
   BOOL bResults      = FALSE;
   HINTERNET hSession = NULL, hConnect = NULL, hRequest = NULL;
-  FILE* pFile;
+  FILE* pFile        = NULL;
   std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
 
+  const std::wstring szUrl = converter.from_bytes(url);
   URL_COMPONENTS urlComp;
-  DWORD dwUrlLen = 0;
 
   DWORD result = ERROR_SUCCESS;
+  modified     = true;
 
   // Initialize the URL_COMPONENTS structure.
   ZeroMemory(&urlComp, sizeof(urlComp));
@@ -588,7 +648,7 @@ DWORD LOOTWorker::GetFile(const WCHAR* szUrl,      // Full URL
   urlComp.dwHostNameLength        = (DWORD)-1;
   urlComp.dwUrlPathLength         = (DWORD)-1;
   urlComp.dwExtraInfoLength       = (DWORD)-1;
-  if (WinHttpCrackUrl(szUrl, (DWORD)wcslen(szUrl), 0, &urlComp)) {
+  if (WinHttpCrackUrl(szUrl.c_str(), (DWORD)szUrl.size(), 0, &urlComp)) {
     // Use WinHttpOpen to obtain a session handle.
     hSession = WinHttpOpen(L"lootcli/1.5.0", WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
                            WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
@@ -603,22 +663,46 @@ DWORD LOOTWorker::GetFile(const WCHAR* szUrl,      // Full URL
           WinHttpOpenRequest(hConnect, L"GET", szURLPath, NULL, WINHTTP_NO_REFERER,
                              WINHTTP_DEFAULT_ACCEPT_TYPES, WINHTTP_FLAG_SECURE);
 
+    // Ask for the file only if it changed since the last download.
+    std::wstring headers;
+    if (!validators.etag.empty())
+      headers += L"If-None-Match: " + converter.from_bytes(validators.etag) + L"\r\n";
+    if (!validators.lastModified.empty())
+      headers += L"If-Modified-Since: " +
+                 converter.from_bytes(validators.lastModified) + L"\r\n";
+
     // Send a request.
     if (hRequest)
-      bResults = WinHttpSendRequest(hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0,
-                                    WINHTTP_NO_REQUEST_DATA, 0, 0, 0);
+      bResults = WinHttpSendRequest(
+          hRequest, headers.empty() ? WINHTTP_NO_ADDITIONAL_HEADERS : headers.c_str(),
+          headers.empty() ? 0 : (DWORD)-1L, WINHTTP_NO_REQUEST_DATA, 0, 0, 0);
 
     // End the request.
     if (bResults)
       bResults = WinHttpReceiveResponse(hRequest, NULL);
 
-    // Keep checking for data until there is nothing left.
-    if (bResults) {
-      if (!(pFile = fopen(szFileName, "wb"))) {
+    DWORD status     = 0;
+    DWORD statusSize = sizeof(status);
+    if (bResults)
+      bResults = WinHttpQueryHeaders(
+          hRequest, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
+          WINHTTP_HEADER_NAME_BY_INDEX, &status, &statusSize, WINHTTP_NO_HEADER_INDEX);
+
+    if (bResults && status == HTTP_STATUS_NOT_MODIFIED) {
+      modified = false;
+    } else if (bResults && status != HTTP_STATUS_OK) {
+      log(loot::LogLevel::debug, "HTTP status " + std::to_string(status));
+      result = ERROR_WINHTTP_INVALID_SERVER_RESPONSE;
+    } else if (bResults) {
+      // Keep checking for data until there is nothing left.
+      validators.etag         = queryHeader(hRequest, WINHTTP_QUERY_ETAG);
+      validators.lastModified = queryHeader(hRequest, WINHTTP_QUERY_LAST_MODIFIED);
+
+      if (!(pFile = _wfopen(fileName.c_str(), L"wb"))) {
         log(loot::LogLevel::debug, "File open failure");
         result = GetLastError();
       }
-      do {
+      while (pFile) {
         // Check for available data.
         dwSize = 0;
         if (!WinHttpQueryDataAvailable(hRequest, &dwSize)) {
@@ -629,17 +713,11 @@ DWORD LOOTWorker::GetFile(const WCHAR* szUrl,      // Full URL
 
         // No more available data.
         if (!dwSize) {
-          log(loot::LogLevel::debug, "No data");
-          result = GetLastError();
           break;
         }
 
         // Allocate space for the buffer.
         pszOutBuffer = new char[dwSize + 1];
-        if (!pszOutBuffer) {
-          log(loot::LogLevel::debug, "Bad buffer");
-          result = GetLastError();
-        }
 
         // Read the Data.
         ZeroMemory(pszOutBuffer, dwSize + 1);
@@ -648,7 +726,7 @@ DWORD LOOTWorker::GetFile(const WCHAR* szUrl,      // Full URL
           log(loot::LogLevel::debug, "Read data failure");
           result = GetLastError();
         } else {
-          fwrite(pszOutBuffer, sizeof(char), dwSize, pFile);
+          fwrite(pszOutBuffer, sizeof(char), dwDownloaded, pFile);
         }
 
         // Free the memory allocated to the buffer.
@@ -658,8 +736,7 @@ DWORD LOOTWorker::GetFile(const WCHAR* szUrl,      // Full URL
         // reported that there are bits to read.
         if (!dwDownloaded)
           break;
-
-      } while (dwSize > 0);
+      }
     } else {
       log(loot::LogLevel::debug, "Response failure");
       result = GetLastError();
@@ -672,13 +749,43 @@ DWORD LOOTWorker::GetFile(const WCHAR* szUrl,      // Full URL
       WinHttpCloseHandle(hConnect);
     if (hSession)
       WinHttpCloseHandle(hSession);
-    fflush(pFile);
-    fclose(pFile);
+    if (pFile) {
+      fflush(pFile);
+      fclose(pFile);
+    }
   } else {
-    log(loot::LogLevel::debug, "URL parse failure: " + converter.to_bytes(szUrl));
+    log(loot::LogLevel::debug, "URL parse failure: " + url);
     result = GetLastError();
   }
-  return result;
+
+  if (result != ERROR_SUCCESS) {
+    LPVOID lpMsgBuf;
+    LPVOID lpDisplayBuf;
+    LPCWSTR lpszFunction = TEXT("GetFile");
+    DWORD dw             = result;
+
+    FormatMessage(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM |
+                      FORMAT_MESSAGE_IGNORE_INSERTS,
+                  NULL, dw, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+                  (LPTSTR)&lpMsgBuf, 0, NULL);
+
+    lpDisplayBuf =
+        (LPVOID)LocalAlloc(LMEM_ZEROINIT, (lstrlen((LPCTSTR)lpMsgBuf) +
+                                           lstrlen((LPCTSTR)lpszFunction) + 40) *
+                                              sizeof(TCHAR));
+    StringCchPrintf((LPTSTR)lpDisplayBuf, LocalSize(lpDisplayBuf) / sizeof(TCHAR),
+                    TEXT("%s failed with error %d: %s"), lpszFunction, dw, lpMsgBuf);
+
+    std::wstring errorMessage = (LPTSTR)lpDisplayBuf;
+    LocalFree(lpMsgBuf);
+    LocalFree(lpDisplayBuf);
+
+    log(loot::LogLevel::error,
+        "Error downloading masterlist: " + converter.to_bytes(errorMessage));
+    return false;
+  }
+
+  return true;
 }
 #else
 // Linux implementation using libcurl
@@ -688,63 +795,225 @@ static size_t curlWriteCallback(void* contents, size_t size, size_t nmemb, void*
   return fwrite(contents, size, nmemb, fp);
 }
 
-int LOOTWorker::GetFile(const std::string& url, const std::string& fileName)
+// picks the validators out of the headers, redirects have their own headers so
+// they start over on every status line
+static size_t curlHeaderCallback(char* buffer, size_t size, size_t nitems, void* userp)
 {
+  auto* validators = static_cast<LOOTWorker::Validators*>(userp);
+  const std::string line(buffer, size * nitems);
+
+  if (line.starts_with("HTTP/")) {
+    *validators = {};
+  }
+
+  const auto colon = line.find(':');
+  if (colon != std::string::npos) {
+    const std::string name  = ToLower(line.substr(0, colon));
+    const std::string value = boost::trim_copy(line.substr(colon + 1));
+
+    if (name == "etag") {
+      validators->etag = value;
+    } else if (name == "last-modified") {
+      validators->lastModified = value;
+    }
+  }
+
+  return size * nitems;
+}
+
+bool LOOTWorker::GetFile(const std::string& url, const fs::path& fileName,
+                         Validators& validators, bool& modified)
+{
+  modified = true;
+
   CURL* curl = curl_easy_init();
   if (!curl) {
     log(loot::LogLevel::error, "Failed to initialize curl");
-    return 1;
+    return false;
   }
 
   FILE* fp = fopen(fileName.c_str(), "wb");
   if (!fp) {
-    log(loot::LogLevel::debug, "File open failure: " + fileName);
+    log(loot::LogLevel::debug, "File open failure: " + fileName.string());
     curl_easy_cleanup(curl);
-    return 1;
+    return false;
   }
 
+  // ask for the file only if it changed since the last download
+  curl_slist* headers = nullptr;
+  if (!validators.etag.empty()) {
+    headers = curl_slist_append(headers, ("If-None-Match: " + validators.etag).c_str());
+  }
+  if (!validators.lastModified.empty()) {
+    headers = curl_slist_append(
+        headers, ("If-Modified-Since: " + validators.lastModified).c_str());
+  }
+
+  Validators received;
+
   curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
   curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlWriteCallback);
   curl_easy_setopt(curl, CURLOPT_WRITEDATA, fp);
+  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, curlHeaderCallback);
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, &received);
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
   curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
   curl_easy_setopt(curl, CURLOPT_USERAGENT, "lootcli/" LOOTCLI_VERSION_STRING);
 
   CURLcode res = curl_easy_perform(curl);
 
+  long status = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+
   fflush(fp);
   fclose(fp);
+  curl_slist_free_all(headers);
   curl_easy_cleanup(curl);
 
   if (res != CURLE_OK) {
     log(loot::LogLevel::error,
         std::string("curl download failed: ") + curl_easy_strerror(res));
-    return 1;
+    return false;
   }
 
-  return 0;
+  if (status == 304) {
+    modified = false;
+    return true;
+  }
+
+  // 0 for anything that isn't http, like file:// urls
+  if (status != 200 && status != 0) {
+    log(loot::LogLevel::error,
+        "curl download failed: HTTP status " + std::to_string(status));
+    return false;
+  }
+
+  validators = std::move(received);
+  return true;
 }
 #endif
 
+bool LOOTWorker::updateMasterlist()
+{
+  const fs::path masterlist = masterlistPath();
+  const fs::path download   = masterlist.string() + ".download";
+  std::error_code ec;
+
+  // the server can only be asked whether the file changed if it's still there
+  Validators validators;
+  if (fs::exists(masterlist)) {
+    validators = readValidators(masterlistValidatorsPath());
+  }
+
+  log(loot::LogLevel::info, "Downloading latest masterlist file from " +
+                                m_GameSettings.MasterlistSource() + " to " +
+                                masterlist.string());
+
+  bool modified = true;
+  if (!GetFile(m_GameSettings.MasterlistSource(), download, validators, modified)) {
+    fs::remove(download, ec);
+    return false;
+  }
+
+  if (!modified) {
+    log(loot::LogLevel::info, "masterlist didn't change since the last download");
+    return true;
+  }
+
+  // the old masterlist stays if the download didn't make it
+  fs::rename(download, masterlist, ec);
+  if (ec) {
+    log(loot::LogLevel::error,
+        "failed to replace " + masterlist.string() + ": " + ec.message());
+    fs::remove(download, ec);
+    return false;
+  }
+
+  writeValidators(masterlistValidatorsPath(), validators);
+  return true;
+}
+
 std::string escape(const std::string& s)
 {
   return boost::replace_all_copy(s, "\"", "\\\"");
 }
 
+// size and modification time of a file, or nothing if it doesn't exist
+//
+struct FileStamp
+{
+  std::uintmax_t size = static_cast<std::uintmax_t>(-1);
+  fs::file_time_type time;
+
+  static FileStamp of(const fs::path& path)
+  {
+    std::error_code ec;
+    FileStamp s;
+
+    const auto size = fs::file_size(path, ec);
+    if (ec) {
+      return {};
+    }
+
+    const auto time = fs::last_write_time(path, ec);
+    if (ec) {
+      return {};
+    }
+
+    s.size = size;
+    s.time = time;
+    return s;
+  }
+
+  bool operator==(const FileStamp&) const = default;
+};
+
+// the masterlist is downloaded again on most runs, which changes its time but
+// rarely its contents
+//
+static std::size_t contentHash(const fs::path& path)
+{
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return 0;
+  }
+
+  const std::string contents((std::istreambuf_iterator<char>(in)),
+                             std::istreambuf_iterator<char>());
+  return std::hash<std::string>()(contents);
+}
+
+// the game handle of the last in-process run, see LOOTWorker::setKeepGame()
+//
+struct KeptGame
+{
+  loot::GameType type;
+  fs::path gamePath;
+  fs::path localPath;
+  std::unique_ptr<loot::GameInterface> handle;
+
+  std::size_t masterlist = 0;
+  FileStamp userlist;
+  std::map<std::string, FileStamp> plugins;
+};
+
+static std::mutex g_keptGameMutex;
+static std::unique_ptr<KeptGame> g_keptGame;
+
 int LOOTWorker::run()
 {
   m_startTime = std::chrono::high_resolution_clock::now();
 
+  // loot's logging callback is changed below, it may not outlive this run when
+  // it's not the whole process
+  struct Restore
   {
-    // Do some preliminary locale / UTF-8 support setup here, in case the settings file
-    // reading requires it.
-    // Boost.Locale initialisation: Specify location of language dictionaries.
-    boost::locale::generator gen;
-    gen.add_messages_path(l10nPath().string());
-    gen.add_messages_domain("loot");
-
-    // Boost.Locale initialisation: Generate and imbue locales.
-    std::locale::global(gen("en.UTF-8"));
-  }
+    ~Restore() { loot::SetLoggingCallback([](loot::LogLevel, std::string_view) {}); }
+  } restore;
+
+  // Do some preliminary locale / UTF-8 support setup here, in case the settings file
+  // reading requires it.
+  useLocale("en.UTF-8");
 
   loot::SetLoggingCallback([&](loot::LogLevel level, std::string_view message) {
     log(level, message);
@@ -763,8 +1032,34 @@ int LOOTWorker::run()
 
     m_GameSettings.SetGamePath(m_GamePath);
 
-    std::unique_ptr<loot::GameInterface> gameHandle = CreateGameHandle(
-        m_GameSettings.Type(), m_GameSettings.GamePath(), profile.string());
+    // only one run at a time may use the kept game, it's put back once the
+    // run succeeded
+    std::unique_lock keptLock(g_keptGameMutex, std::defer_lock);
+    std::unique_ptr<KeptGame> kept;
+
+    if (m_KeepGame) {
+      keptLock.lock();
+      kept = std::move(g_keptGame);
+
+      if (kept && (kept->type != m_GameSettings.Type() ||
+                   kept->gamePath != m_GameSettings.GamePath() ||
+                   kept->localPath != profile)) {
+        kept.reset();
+      }
+    }
+
+    if (!kept) {
+      kept            = std::make_unique<KeptGame>();
+      kept->type      = m_GameSettings.Type();
+      kept->gamePath  = m_GameSettings.GamePath();
+      kept->localPath = profile;
+      kept->handle    = CreateGameHandle(m_GameSettings.Type(),
+                                         m_GameSettings.GamePath(), profile.string());
+    } else {
+      log(loot::LogLevel::debug, "reusing the game handle of the last run");
+    }
+
+    auto& gameHandle = kept->handle;
 
     if (!GetLOOTAppData().empty()) {
       // Make sure that the LOOT game path exists.
@@ -808,9 +1103,7 @@ int LOOTWorker::run()
       log(loot::LogLevel::debug, "initialising language settings");
       log(loot::LogLevel::debug, "selected language: " + m_Language);
 
-      // Boost.Locale initialisation: Generate and imbue locales.
-      boost::locale::generator gen;
-      std::locale::global(gen(m_Language + ".UTF-8"));
+      useLocale(m_Language + ".UTF-8");
     }
 
     progress(Progress::CheckingMasterlistExistence);
@@ -823,73 +1116,76 @@ int LOOTWorker::run()
       fs::create_directories(masterlistPath().parent_path());
     }
 
+    // the download doesn't need the game handle, plugins are read while it's
+    // running
+    std::future<bool> masterlistUpdate;
     if (m_UpdateMasterlist) {
       progress(Progress::UpdatingMasterlist);
-
-#ifdef _WIN32
-      std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-      std::wstring masterlistSource =
-          converter.from_bytes(m_GameSettings.MasterlistSource());
-
-      log(loot::LogLevel::info, "Downloading latest masterlist file from " +
-                                    m_GameSettings.MasterlistSource() + " to " +
-                                    masterlistPath().string());
-      DWORD result =
-          GetFile(masterlistSource.c_str(), masterlistPath().string().c_str());
-      if (result != ERROR_SUCCESS) {
-        LPVOID lpMsgBuf;
-        LPVOID lpDisplayBuf;
-        LPCWSTR lpszFunction = TEXT("GetFile");
-        DWORD dw             = result;
-
-        FormatMessage(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM |
-                          FORMAT_MESSAGE_IGNORE_INSERTS,
-                      NULL, dw, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-                      (LPTSTR)&lpMsgBuf, 0, NULL);
-
-        lpDisplayBuf =
-            (LPVOID)LocalAlloc(LMEM_ZEROINIT, (lstrlen((LPCTSTR)lpMsgBuf) +
-                                               lstrlen((LPCTSTR)lpszFunction) + 40) *
-                                                  sizeof(TCHAR));
-        StringCchPrintf((LPTSTR)lpDisplayBuf, LocalSize(lpDisplayBuf) / sizeof(TCHAR),
-                        TEXT("%s failed with error %d: %s"), lpszFunction, dw,
-                        lpMsgBuf);
-
-        std::wstring errorMessage = (LPTSTR)lpDisplayBuf;
-
-        log(loot::LogLevel::error,
-            "Error downloading masterlist: " + converter.to_bytes(errorMessage));
-        return 0;  // was FALSE
-      }
-#else
-      log(loot::LogLevel::info, "Downloading latest masterlist file from " +
-                                    m_GameSettings.MasterlistSource() + " to " +
-                                    masterlistPath().string());
-      int result = GetFile(m_GameSettings.MasterlistSource(),
-                           masterlistPath().string());
-      if (result != 0) {
-        log(loot::LogLevel::error, "Error downloading masterlist");
-        return 0;
-      }
-#endif
+      masterlistUpdate =
+          std::async(std::launch::async, [this] { return updateMasterlist(); });
     }
 
-    progress(Progress::LoadingLists);
+    fs::path userlist       = userlistPath();
+    const auto userlistTime = FileStamp::of(userlist);
 
-    gameHandle->GetDatabase().LoadMasterlist(masterlistPath().string());
-    fs::path userlist = userlistPath();
-    if (fs::exists(userlist))
-      gameHandle->GetDatabase().LoadUserlist(userlist.string());
+    if (userlistTime == FileStamp() && kept->userlist != FileStamp()) {
+      // loading a userlist replaces the previous one, but there's no way to
+      // drop it once the file is gone, start over with a new handle
+      kept->handle  = CreateGameHandle(m_GameSettings.Type(),
+                                       m_GameSettings.GamePath(), profile.string());
+      kept->plugins.clear();
+      kept->masterlist = 0;
+    }
 
     progress(Progress::ReadingPlugins);
     gameHandle->LoadCurrentLoadOrderState();
     auto loadOrder = gameHandle->GetLoadOrder();
     std::vector<std::filesystem::path> pluginsList;
+    std::map<std::string, FileStamp> pluginTimes;
     for (auto plugin : gameHandle->GetLoadOrder()) {
       std::filesystem::path pluginPath(plugin);
-      pluginsList.push_back(pluginPath);
+      const auto time = FileStamp::of(dataPath() / pluginPath);
+
+      // plugins loaded by an earlier run stay loaded in the handle
+      auto itor = kept->plugins.find(plugin);
+      if (itor == kept->plugins.end() || itor->second != time ||
+          time == FileStamp()) {
+        pluginsList.push_back(pluginPath);
+      }
+
+      pluginTimes.emplace(plugin, time);
+    }
+
+    log(loot::LogLevel::debug, std::to_string(pluginsList.size()) + " of " +
+                                   std::to_string(loadOrder.size()) +
+                                   " plugins need loading");
+
+    if (!pluginsList.empty()) {
+      gameHandle->LoadPlugins(pluginsList, false);
+    }
+    kept->plugins = std::move(pluginTimes);
+
+    if (masterlistUpdate.valid() && !masterlistUpdate.get()) {
+      log(loot::LogLevel::error, "Error downloading masterlist");
+      return 0;  // was FALSE on Windows
+    }
+
+    progress(Progress::LoadingLists);
+
+    // unchanged if the server answered with a 304, it's not parsed again then
+    const auto masterlist = contentHash(masterlistPath());
+
+    if (masterlist == 0 || masterlist != kept->masterlist ||
+        userlistTime != kept->userlist) {
+      gameHandle->GetDatabase().LoadMasterlist(masterlistPath().string());
+      if (fs::exists(userlist))
+        gameHandle->GetDatabase().LoadUserlist(userlist.string());
+
+      kept->masterlist = masterlist;
+      kept->userlist   = userlistTime;
+    } else {
+      log(loot::LogLevel::debug, "masterlist and userlist unchanged, not reloaded");
     }
-    gameHandle->LoadPlugins(pluginsList, false);
 
     progress(Progress::SortingPlugins);
     std::vector<std::string> sortedPlugins = gameHandle->SortPlugins(loadOrder);
@@ -897,6 +1193,7 @@ int LOOTWorker::run()
     progress(Progress::WritingLoadorder);
 
     std::ofstream outf(m_PluginListPath);
+    outf.imbue(m_Locale);
     if (!outf) {
       log(loot::LogLevel::error,
           "failed to open " + m_PluginListPath + " to rewrite it");
@@ -909,7 +1206,17 @@ int LOOTWorker::run()
     outf.close();
 
     progress(Progress::ParsingLootMessages);
-    std::ofstream(m_OutputPath) << createJsonReport(*gameHandle, sortedPlugins);
+    if (m_OutputPath.empty()) {
+      m_Report = createJsonReport(*gameHandle, sortedPlugins);
+    } else {
+      std::ofstream out(m_OutputPath);
+      out.imbue(m_Locale);
+      out << createJsonReport(*gameHandle, sortedPlugins);
+    }
+
+    if (m_KeepGame) {
+      g_keptGame = std::move(kept);
+    }
   } catch (std::system_error& e) {
     log(loot::LogLevel::error, e.what());
     return 1;
@@ -1128,8 +1435,29 @@ QJsonValue LOOTWorker::createMissingMasters(loot::GameInterface& game,
   return array;
 }
 
+void LOOTWorker::useLocale(const std::string& name)
+{
+  // Boost.Locale initialisation: Specify location of language dictionaries.
+  boost::locale::generator gen;
+  gen.add_messages_path(l10nPath().string());
+  gen.add_messages_domain("loot");
+
+  m_Locale = gen(name);
+
+  // the global locale belongs to the host when running in-process, another
+  // thread of it may be formatting with it right now
+  if (m_GlobalLocale) {
+    std::locale::global(m_Locale);
+  }
+}
+
 void LOOTWorker::progress(Progress p)
 {
+  if (m_MessageCallback) {
+    m_MessageCallback(Message::fromProgress(p));
+    return;
+  }
+
   std::cout << "[progress] " << static_cast<int>(p) << "\n";
   std::cout.flush();
 }
@@ -1143,6 +1471,14 @@ void LOOTWorker::log(loot::LogLevel level, const std::string_view message) const
   const auto ll        = fromLootLogLevel(level);
   const auto levelName = logLevelToString(ll);
 
+  // the masterlist is downloaded on another thread
+  lock_guard<recursive_mutex> guard(mutex_);
+
+  if (m_MessageCallback) {
+    m_MessageCallback(Message::fromLog(ll, std::string(message)));
+    return;
+  }
+
   std::cout << "[" << levelName << "] " << message << "\n";
   std::cout.flush();
 }
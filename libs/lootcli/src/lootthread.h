@@ -19,6 +19,14 @@ lootcli::LogLevels fromLootLogLevel(loot::LogLevel level);
 class LOOTWorker
 {
 public:
+  // ETag and Last-Modified of the masterlist that was downloaded last, sent
+  // back so the server can answer with a 304 if it didn't change
+  struct Validators
+  {
+    std::string etag;
+    std::string lastModified;
+  };
+
   explicit LOOTWorker();
 
   void setGame(const std::string& gameName);
@@ -32,17 +40,41 @@ public:
 
   void setUpdateMasterlist(bool update);
 
+  // messages go to `f` instead of stdout, see runInProcess()
+  void setMessageCallback(std::function<void(const lootcli::Message&)> f);
+
+  // keeps the game handle with its masterlist and plugins loaded after the
+  // run, so the next run for the same game only reloads what changed; only
+  // useful when running in-process
+  void setKeepGame(bool keep);
+
+  // has run() make its locale the global one, only for the lootcli process;
+  // otherwise it's only imbued on the worker's own streams
+  void setGlobalLocale(bool global);
+
   int run();
 
+  // the json report if no output path was set
+  const std::string& report() const { return m_Report; }
+
 private:
   void progress(Progress p);
+
+  // generates the Boost.Locale locale `name` with loot's messages
+  void useLocale(const std::string& name);
+
   void log(loot::LogLevel level, const std::string_view message) const;
 
-#ifdef _WIN32
-  DWORD GetFile(const WCHAR* szUrl, const CHAR* szFileName);
-#else
-  int GetFile(const std::string& url, const std::string& fileName);
-#endif
+  // downloads `url` into `fileName`; `validators` are sent with the request
+  // and replaced by the ones of the response, `modified` is false if the
+  // server answered that the file didn't change, in which case nothing is
+  // written
+  bool GetFile(const std::string& url, const std::filesystem::path& fileName,
+               Validators& validators, bool& modified);
+
+  // replaces the masterlist with the latest one if it changed since it was
+  // last downloaded, false on errors
+  bool updateMasterlist();
   void getSettings(const std::filesystem::path& file);
   std::string getOldDefaultRepoUrl(loot::GameId gameType);
   std::optional<std::string> GetLocalFolder(const toml::table& table);
@@ -60,6 +92,7 @@ private:
 
   std::filesystem::path gamePath() const;
   std::filesystem::path masterlistPath() const;
+  std::filesystem::path masterlistValidatorsPath() const;
   std::filesystem::path settingsPath() const;
   std::filesystem::path userlistPath() const;
   std::filesystem::path l10nPath() const;
@@ -84,6 +117,11 @@ private:
   mutable std::recursive_mutex mutex_;
   loot::GameSettings m_GameSettings;
   std::chrono::high_resolution_clock::time_point m_startTime;
+  std::function<void(const lootcli::Message&)> m_MessageCallback;
+  std::string m_Report;
+  bool m_KeepGame = false;
+  bool m_GlobalLocale = false;
+  std::locale m_Locale;
 
   std::string createJsonReport(loot::GameInterface& game,
                                const std::vector<std::string>& sortedPlugins) const;
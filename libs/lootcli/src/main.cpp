@@ -88,6 +88,7 @@ int main(int argc, char* argv[])
     worker.setPluginListPath(getParameter<std::string>(arguments, "pluginListPath"));
     worker.setOutput(getParameter<std::string>(arguments, "out"));
     worker.setLogLevel(getLogLevel(arguments));
+    worker.setGlobalLocale(true);
 
     const auto lang = getOptionalParameter<std::string>(arguments, "language", "");
     if (!lang.empty()) {
@@ -162,18 +162,30 @@ impl GameScanResult {
 // ============================================================================
 
 /// Detect all installed games from all supported launchers
+///
+/// The launchers are scanned in parallel, the games are still listed in the
+/// same order: Steam, Heroic, then Bottles.
 pub fn detect_all_games() -> GameScanResult {
     let mut result = GameScanResult::default();
 
-    let steam_games = detect_steam_games();
+    let (steam_games, heroic_games, bottles_games) = std::thread::scope(|scope| {
+        let steam = scope.spawn(detect_steam_games);
+        let heroic = scope.spawn(detect_heroic_games);
+        let bottles = detect_bottles_games();
+
+        (
+            steam.join().unwrap_or_default(),
+            heroic.join().unwrap_or_default(),
+            bottles,
+        )
+    });
+
     result.steam_count = steam_games.len();
     result.games.extend(steam_games);
 
-    let heroic_games = detect_heroic_games();
     result.heroic_count = heroic_games.len();
     result.games.extend(heroic_games);
 
-    let bottles_games = detect_bottles_games();
     result.bottles_count = bottles_games.len();
     result.games.extend(bottles_games);
 
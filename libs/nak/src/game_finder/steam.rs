@@ -3,8 +3,12 @@
 //! Detects games installed via Steam by parsing appmanifest_*.acf files.
 //! Supports native, Flatpak, and Snap Steam installations.
 
+use std::collections::HashMap;
 use std::fs;
 use std::path::{Path, PathBuf};
+use std::sync::{LazyLock, Mutex};
+use std::thread;
+use std::time::SystemTime;
 
 use super::known_games::{find_by_steam_id, KnownGame};
 use super::vdf::{parse_library_folders, AppManifest};
@@ -22,6 +26,10 @@ const STEAM_PATHS: &[&str] = &[
 ];
 
 /// Detect all Steam games across all installations
+///
+/// Libraries are scanned in parallel, since they're often on different drives.
+/// A library that didn't change since the last scan isn't parsed again, see
+/// `LibraryStamp`.
 pub fn detect_steam_games() -> Vec<Game> {
     let mut games = Vec::new();
     let home = match std::env::var("HOME") {
@@ -29,40 +37,130 @@ pub fn detect_steam_games() -> Vec<Game> {
         Err(_) => return games,
     };
 
-    // Find all Steam installations
-    for steam_info in find_steam_installations(&home) {
-        let libraries = get_library_folders(&steam_info.path);
-
-        for library_path in libraries {
+    // Find all Steam installations and their libraries
+    let mut libraries: Vec<(PathBuf, &SteamInstallation)> = Vec::new();
+    let installations = find_steam_installations(&home);
+    for steam_info in &installations {
+        for library_path in get_library_folders(&steam_info.path) {
             let steamapps = library_path.join("steamapps");
-            if !steamapps.exists() {
-                continue;
+            if steamapps.exists() && !libraries.iter().any(|(p, _)| *p == steamapps) {
+                libraries.push((steamapps, steam_info));
             }
+        }
+    }
+
+    thread::scope(|scope| {
+        let scans: Vec<_> = libraries
+            .iter()
+            .map(|(steamapps, steam_info)| {
+                scope.spawn(move || scan_library(steamapps, steam_info))
+            })
+            .collect();
+
+        for scan in scans {
+            games.extend(scan.join().unwrap_or_default());
+        }
+    });
+
+    log_info(&format!("Steam: Found {} installed games", games.len()));
+    games
+}
 
-            // Scan for appmanifest_*.acf files
-            let Ok(entries) = fs::read_dir(&steamapps) else {
+/// Modification times of a library, it's scanned again when they change
+///
+/// Steam adds and removes the appmanifest files in `steamapps` and updates
+/// them when the state of a game changes, which is how installs, uninstalls
+/// and finished downloads show up. `common` changes when a game directory is
+/// moved or deleted by hand.
+#[derive(Clone, PartialEq)]
+struct LibraryStamp {
+    common: Option<SystemTime>,
+    manifests: Vec<(PathBuf, Option<SystemTime>)>,
+}
+
+impl LibraryStamp {
+    fn read(steamapps: &Path) -> Option<Self> {
+        let mut manifests = Vec::new();
+        for entry in fs::read_dir(steamapps).ok()?.flatten() {
+            let path = entry.path();
+            let Some(name) = path.file_name().and_then(|n| n.to_str()) else {
                 continue;
             };
 
-            for entry in entries.flatten() {
-                let path = entry.path();
-                let Some(name) = path.file_name().and_then(|n| n.to_str()) else {
-                    continue;
-                };
+            if name.starts_with("appmanifest_") && name.ends_with(".acf") {
+                let modified = entry.metadata().and_then(|m| m.modified()).ok();
+                manifests.push((path, modified));
+            }
+        }
+        manifests.sort_by(|a, b| a.0.cmp(&b.0));
 
-                if name.starts_with("appmanifest_") && name.ends_with(".acf") {
-                    if let Some(game) = parse_appmanifest(&path, &steamapps, &steam_info) {
-                        games.push(game);
-                    }
-                }
+        let common = fs::metadata(steamapps.join("common"))
+            .and_then(|m| m.modified())
+            .ok();
+
+        Some(Self { common, manifests })
+    }
+}
+
+struct CachedLibrary {
+    stamp: LibraryStamp,
+    games: Vec<Game>,
+}
+
+/// Games of every library scanned so far, by `steamapps` path
+static LIBRARY_CACHE: LazyLock<Mutex<HashMap<PathBuf, CachedLibrary>>> =
+    LazyLock::new(|| Mutex::new(HashMap::new()));
+
+/// Scan a `steamapps` directory for installed games, or take them from the
+/// cache if the library didn't change
+fn scan_library(steamapps: &Path, steam_info: &SteamInstallation) -> Vec<Game> {
+    let Some(stamp) = LibraryStamp::read(steamapps) else {
+        return Vec::new();
+    };
+
+    let cached = LIBRARY_CACHE.lock().ok().and_then(|cache| {
+        cache
+            .get(steamapps)
+            .filter(|c| c.stamp == stamp)
+            .map(|c| c.games.clone())
+    });
+
+    if let Some(mut games) = cached {
+        // Proton creates the prefix on the first launch, inside its compatdata
+        // directory, which the stamp doesn't cover
+        for game in &mut games {
+            if game.prefix_path.is_none() {
+                game.prefix_path = find_prefix(steamapps, &game.app_id);
             }
         }
+        return games;
+    }
+
+    let games: Vec<Game> = stamp
+        .manifests
+        .iter()
+        .filter_map(|(path, _)| parse_appmanifest(path, steamapps, steam_info))
+        .collect();
+
+    if let Ok(mut cache) = LIBRARY_CACHE.lock() {
+        cache.insert(
+            steamapps.to_path_buf(),
+            CachedLibrary {
+                stamp,
+                games: games.clone(),
+            },
+        );
     }
 
-    log_info(&format!("Steam: Found {} installed games", games.len()));
     games
 }
 
+/// The Wine prefix of a game in a library, if it has one
+fn find_prefix(steamapps_path: &Path, app_id: &str) -> Option<PathBuf> {
+    let prefix_path = steamapps_path.join("compatdata").join(app_id).join("pfx");
+    prefix_path.exists().then_some(prefix_path)
+}
+
 /// Information about a Steam installation
 struct SteamInstallation {
     path: PathBuf,
@@ -160,16 +258,7 @@ fn parse_appmanifest(
     }
 
     // Build the prefix path
-    let prefix_path = steamapps_path
-        .join("compatdata")
-        .join(&manifest.app_id)
-        .join("pfx");
-
-    let prefix_path = if prefix_path.exists() {
-        Some(prefix_path)
-    } else {
-        None
-    };
+    let prefix_path = find_prefix(steamapps_path, &manifest.app_id);
 
     // Look up known game info
     let known_game = find_by_steam_id(&manifest.app_id);
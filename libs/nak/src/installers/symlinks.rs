@@ -15,7 +15,11 @@
 #![allow(dead_code)]
 
 use std::fs;
-use std::path::Path;
+use std::path::{Path, PathBuf};
+use std::thread;
+use std::time::SystemTime;
+
+use serde::{Deserialize, Serialize};
 
 use crate::game_finder::{detect_all_games, Game, GameScanResult};
 use crate::logging::{log_info, log_warning};
@@ -34,6 +38,9 @@ use crate::logging::{log_info, log_warning};
 ///
 /// Data stays in the game prefix (preserving Steam Cloud sync), while NaK
 /// provides unified access through symlinks.
+///
+/// The links are recorded in the NaK prefix. Later calls only list the game
+/// prefix folders that changed, and remove the links to folders that are gone.
 pub fn create_game_symlinks(nak_prefix: &Path, games: &[Game]) {
     let users_dir = nak_prefix.join("drive_c/users");
     let username = find_prefix_username(&users_dir);
@@ -49,57 +56,91 @@ pub fn create_game_symlinks(nak_prefix: &Path, games: &[Game]) {
     let _ = fs::create_dir_all(&appdata_local);
     let _ = fs::create_dir_all(&appdata_roaming);
 
-    let mut linked_count = 0;
-
-    for game in games {
-        // Skip games without prefixes
-        let Some(game_prefix) = &game.prefix_path else {
-            continue;
-        };
-
-        // Discover the game prefix's user directory
-        let game_users_dir = game_prefix.join("drive_c/users");
-        let game_username = find_prefix_username(&game_users_dir);
-        let game_user_dir = game_users_dir.join(&game_username);
-
-        // Scan and symlink ALL folders in the game prefix's Documents/My Games/
-        linked_count += scan_and_link_all(
-            &my_games,
-            &game_user_dir.join("Documents/My Games"),
-            "Documents/My Games",
-            &game.name,
-            game_prefix,
-        );
-
-        // Also link the Documents folder itself for non-My Games entries
-        // (some games put saves directly in Documents/<GameName>)
-        linked_count += scan_and_link_all(
-            &documents,
-            &game_user_dir.join("Documents"),
-            "Documents",
-            &game.name,
-            game_prefix,
-        );
-
-        // Scan and symlink ALL folders in AppData/Local/
-        linked_count += scan_and_link_all(
-            &appdata_local,
-            &game_user_dir.join("AppData/Local"),
-            "AppData/Local",
-            &game.name,
-            game_prefix,
-        );
-
-        // Scan and symlink ALL folders in AppData/Roaming/
-        linked_count += scan_and_link_all(
-            &appdata_roaming,
-            &game_user_dir.join("AppData/Roaming"),
-            "AppData/Roaming",
-            &game.name,
-            game_prefix,
-        );
+    // Documents itself is scanned too for saves that go directly in
+    // Documents/<GameName>
+    let bases: [(&Path, &str); 4] = [
+        (&my_games, "Documents/My Games"),
+        (&documents, "Documents"),
+        (&appdata_local, "AppData/Local"),
+        (&appdata_roaming, "AppData/Roaming"),
+    ];
+
+    let manifest_path = nak_prefix.join(LINK_MANIFEST);
+    let previous = LinkManifest::load(&manifest_path);
+
+    let linked_games: Vec<(&Game, &PathBuf)> = games
+        .iter()
+        .filter_map(|game| game.prefix_path.as_ref().map(|prefix| (game, prefix)))
+        .collect();
+
+    // Listing the folders of the game prefixes is what takes time, the games
+    // are scanned in parallel and unchanged folders aren't listed again
+    let scans: Vec<Vec<LinkedSource>> = thread::scope(|scope| {
+        let handles: Vec<_> = linked_games
+            .iter()
+            .map(|(_, game_prefix)| {
+                let previous = &previous;
+                scope.spawn(move || {
+                    let game_users_dir = game_prefix.join("drive_c/users");
+                    let game_username = find_prefix_username(&game_users_dir);
+                    let game_user_dir = game_users_dir.join(&game_username);
+
+                    bases
+                        .iter()
+                        .map(|(nak_base, label)| {
+                            scan_source(nak_base, &game_user_dir.join(label), label, previous)
+                        })
+                        .collect()
+                })
+            })
+            .collect();
+
+        handles
+            .into_iter()
+            .map(|handle| handle.join().unwrap_or_default())
+            .collect()
+    });
+
+    // Links to folders that are gone go first, so another game can take them
+    let removed_count = remove_stale_links(&previous, &scans);
+    if removed_count > 0 {
+        log_info(&format!(
+            "Removed {} symlinks to folders that are gone from game prefixes",
+            removed_count
+        ));
     }
 
+    // Each base folder is linked on its own thread; within one, the games go
+    // in order so the first game with a folder gets the link
+    let linked: Vec<Vec<LinkedSource>> = thread::scope(|scope| {
+        let handles: Vec<_> = (0..bases.len())
+            .map(|i| {
+                let (scans, linked_games) = (&scans, &linked_games);
+                scope.spawn(move || {
+                    scans
+                        .iter()
+                        .zip(linked_games)
+                        .map(|(sources, (game, _))| {
+                            link_source(&sources[i], bases[i].1, &game.name)
+                        })
+                        .collect::<Vec<_>>()
+                })
+            })
+            .collect();
+
+        handles
+            .into_iter()
+            .map(|handle| handle.join().unwrap_or_default())
+            .collect()
+    });
+
+    let manifest = LinkManifest {
+        sources: linked.into_iter().flatten().collect(),
+    };
+
+    let linked_count: usize = manifest.sources.iter().map(|s| s.linked.len()).sum();
+    manifest.save(&manifest_path);
+
     if linked_count > 0 {
         log_info(&format!(
             "Created {} symlinks to game prefixes",
@@ -202,26 +243,86 @@ const SKIP_DIRS: &[&str] = &[
     "Contacts", "3D Objects",
 ];
 
-/// Scan all subdirectories in a game prefix folder and create symlinks
-/// for each one in the corresponding NaK prefix folder.
-///
-/// Returns the number of symlinks created.
-fn scan_and_link_all(
+/// NaK prefix file listing the links `create_game_symlinks` made, so the next
+/// call only adds and removes what changed
+const LINK_MANIFEST: &str = ".nak_game_links.json";
+
+/// The folders of a game prefix folder, and which of them are linked
+#[derive(Serialize, Deserialize, Clone, Default)]
+struct LinkedSource {
+    /// Folder of the game prefix the links point into
+    source: PathBuf,
+    /// Folder of the NaK prefix the links are in
+    target: PathBuf,
+    /// Modification time of `source` when `folders` were listed
+    modified: Option<SystemTime>,
+    /// Folders of `source` to link
+    folders: Vec<String>,
+    /// Folders that are linked, the others were taken by something else
+    linked: Vec<String>,
+}
+
+#[derive(Serialize, Deserialize, Default)]
+struct LinkManifest {
+    sources: Vec<LinkedSource>,
+}
+
+impl LinkManifest {
+    fn load(path: &Path) -> Self {
+        fs::read_to_string(path)
+            .ok()
+            .and_then(|content| serde_json::from_str(&content).ok())
+            .unwrap_or_default()
+    }
+
+    fn save(&self, path: &Path) {
+        if let Ok(json) = serde_json::to_string_pretty(self) {
+            if let Err(e) = fs::write(path, json) {
+                log_warning(&format!("Failed to save {}: {}", path.display(), e));
+            }
+        }
+    }
+
+    fn find(&self, source: &Path, target: &Path) -> Option<&LinkedSource> {
+        self.sources
+            .iter()
+            .find(|s| s.source == source && s.target == target)
+    }
+}
+
+/// List the subdirectories of a game prefix folder that should be linked in
+/// the corresponding NaK prefix folder. The previous listing is reused if the
+/// folder didn't change since.
+fn scan_source(
     nak_base: &Path,
     game_base: &Path,
     label: &str,
-    game_name: &str,
-    _game_prefix: &Path,
-) -> usize {
+    previous: &LinkManifest,
+) -> LinkedSource {
+    let modified = fs::metadata(game_base).and_then(|m| m.modified()).ok();
+
+    let mut source = LinkedSource {
+        source: game_base.to_path_buf(),
+        target: nak_base.to_path_buf(),
+        modified,
+        ..Default::default()
+    };
+
+    if let Some(old) = previous.find(game_base, nak_base) {
+        if modified.is_some() && old.modified == modified {
+            source.folders = old.folders.clone();
+            return source;
+        }
+    }
+
     if !game_base.is_dir() {
-        return 0;
+        return source;
     }
 
     let Ok(entries) = fs::read_dir(game_base) else {
-        return 0;
+        return source;
     };
 
-    let mut count = 0;
     for entry in entries.flatten() {
         // Only symlink directories (game folders), not loose files
         if !entry.path().is_dir() {
@@ -240,11 +341,60 @@ fn scan_and_link_all(
             continue;
         }
 
-        let nak_path = nak_base.join(&folder_name);
-        let source_path = entry.path();
+        source.folders.push(folder_name);
+    }
+
+    source.folders.sort();
+    source
+}
 
-        if create_symlink_if_needed(&nak_path, &source_path, game_name, label, &folder_name) {
-            count += 1;
+/// Create the symlinks for the folders of a scanned game prefix folder.
+///
+/// Returns the source with the folders that are linked.
+fn link_source(source: &LinkedSource, label: &str, game_name: &str) -> LinkedSource {
+    let mut result = LinkedSource {
+        linked: Vec::new(),
+        ..source.clone()
+    };
+
+    for folder_name in &source.folders {
+        let nak_path = source.target.join(folder_name);
+        let source_path = source.source.join(folder_name);
+
+        if create_symlink_if_needed(&nak_path, &source_path, game_name, label, folder_name) {
+            result.linked.push(folder_name.clone());
+        }
+    }
+
+    result
+}
+
+/// Remove the links of the previous manifest to folders that aren't listed by
+/// the current scans any more, as long as they still point where they were
+/// created to.
+///
+/// Returns the number of symlinks removed.
+fn remove_stale_links(previous: &LinkManifest, scans: &[Vec<LinkedSource>]) -> usize {
+    let mut count = 0;
+
+    for old in &previous.sources {
+        let kept = scans
+            .iter()
+            .flatten()
+            .find(|s| s.source == old.source && s.target == old.target);
+
+        for folder_name in &old.linked {
+            if kept.is_some_and(|s| s.folders.contains(folder_name)) {
+                continue;
+            }
+
+            let nak_path = old.target.join(folder_name);
+            let is_ours = fs::read_link(&nak_path)
+                .is_ok_and(|target| target == old.source.join(folder_name));
+
+            if is_ours && fs::remove_file(&nak_path).is_ok() {
+                count += 1;
+            }
         }
     }
 
@@ -41,6 +41,11 @@ NakGameList nak_detect_all_games(void);
 /** Free a NakGameList returned by nak_detect_all_games */
 void nak_game_list_free(NakGameList list);
 
+/** Detect the games again, e.g. after one was installed; the next
+ *  nak_detect_all_games returns the new list. Only the Steam libraries that
+ *  changed since the last scan are parsed again. */
+void nak_refresh_games(void);
+
 /** A known game definition (static data, do NOT free) */
 typedef struct {
     const char *name;
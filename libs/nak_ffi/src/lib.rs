@@ -143,6 +143,14 @@ fn detect_games_cached() -> CachedGameList {
     cached
 }
 
+/// Detect the installed games again, the next `nak_detect_all_games` returns
+/// the new list. Only the Steam libraries that changed are parsed again.
+#[no_mangle]
+pub extern "C" fn nak_refresh_games() {
+    DETECTED_GAMES_CACHE.lock().unwrap().take();
+    detect_games_cached();
+}
+
 /// Detect all installed games across all launchers
 #[no_mangle]
 pub extern "C" fn nak_detect_all_games() -> NakGameList {
@@ -37,6 +37,10 @@ namespace mo2::python {
 
     using namespace pybind11::literals;
 
+    // for the bindings of calls that can take a while, other Python threads run until
+    // they return and Python callbacks they make take the GIL back
+    using release_gil = py::call_guard<py::gil_scoped_release>;
+
     void add_versioninfo_classes(py::module_ m)
     {
         // Version
@@ -444,6 +448,9 @@ namespace mo2::python {
             .def("headerVersion", &IPluginList::headerVersion, "name"_a)
             .def("author", &IPluginList::author, "name"_a)
             .def("description", &IPluginList::description, "name"_a)
+            .def("newRecordCount", &IPluginList::newRecordCount, "name"_a)
+            .def("isLightEligible", &IPluginList::isLightEligible, "name"_a)
+            .def("isMediumEligible", &IPluginList::isMediumEligible, "name"_a)
 
             // Kept but deprecated for backward compatibility:
             .def(
@@ -478,7 +485,8 @@ namespace mo2::python {
                  "callback"_a)
             .def("pluginNames", &MOBase::IPluginList::pluginNames)
             .def("setState", &MOBase::IPluginList::setState, "name"_a, "state"_a)
-            .def("setLoadOrder", &MOBase::IPluginList::setLoadOrder, "loadorder"_a);
+            .def("setLoadOrder", &MOBase::IPluginList::setLoadOrder, "loadorder"_a,
+                 release_gil());
     }
 
     void add_imodlist_classes(py::module_ m)
@@ -508,15 +516,15 @@ namespace mo2::python {
                  "profile"_a = static_cast<IProfile*>(nullptr))
             .def("getMod", &MOBase::IModList::getMod,
                  py::return_value_policy::reference, "name"_a)
-            .def("removeMod", &MOBase::IModList::removeMod, "mod"_a)
+            .def("removeMod", &MOBase::IModList::removeMod, "mod"_a, release_gil())
             .def("renameMod", &MOBase::IModList::renameMod,
-                 py::return_value_policy::reference, "mod"_a, "name"_a)
+                 py::return_value_policy::reference, "mod"_a, "name"_a, release_gil())
 
             .def("state", &MOBase::IModList::state, "name"_a)
             .def("setActive",
                  py::overload_cast<QStringList const&, bool>(
                      &MOBase::IModList::setActive),
-                 "names"_a, "active"_a)
+                 "names"_a, "active"_a, release_gil())
             .def("setActive",
                  py::overload_cast<QString const&, bool>(&MOBase::IModList::setActive),
                  "name"_a, "active"_a)
@@ -560,6 +568,14 @@ namespace mo2::python {
             .def_readwrite("archive", &IOrganizer::FileInfo::archive)
             .def_readwrite("origins", &IOrganizer::FileInfo::origins);
 
+        py::class_<IOrganizer::FileQuery>(m, "FileQuery")
+            .def(py::init([](DirectoryWrapper const& path, QStringList const& filters) {
+                     return IOrganizer::FileQuery{path, filters};
+                 }),
+                 "path"_a, "filters"_a = QStringList())
+            .def_readwrite("path", &IOrganizer::FileQuery::path)
+            .def_readwrite("filters", &IOrganizer::FileQuery::filters);
+
         py::class_<IOrganizer>(m, "IOrganizer")
             .def("createNexusBridge", &IOrganizer::createNexusBridge,
                  py::return_value_policy::reference)
@@ -600,7 +616,7 @@ namespace mo2::python {
             .def("pluginDataPath", &IOrganizer::pluginDataPath)
             .def("installMod", wrap_for_filepath<1>(&IOrganizer::installMod),
                  py::return_value_policy::reference, "filename"_a,
-                 "name_suggestion"_a = "")
+                 "name_suggestion"_a = "", release_gil())
             .def("resolvePath", wrap_for_filepath(&IOrganizer::resolvePath),
                  "filename"_a)
             .def("listDirectories", &IOrganizer::listDirectories, "directory"_a)
@@ -612,7 +628,7 @@ namespace mo2::python {
                    std::function<bool(QString const&)> const& f) {
                     return o->findFiles(p, f);
                 },
-                "path"_a, "filter"_a)
+                "path"_a, "filter"_a, release_gil())
 
             // in C++, it is possible to create a QStringList implicitly from
             // a single QString, in Python is not possible with the current
@@ -629,17 +645,18 @@ namespace mo2::python {
                    const QStringList& gf) {
                     return o->findFiles(p, gf);
                 },
-                "path"_a, "patterns"_a)
+                "path"_a, "patterns"_a, release_gil())
             .def(
                 "findFiles",
                 [](const IOrganizer* o, DirectoryWrapper const& p, const QString& f) {
                     return o->findFiles(p, QStringList{f});
                 },
-                "path"_a, "pattern"_a)
+                "path"_a, "pattern"_a, release_gil())
 
             .def("getFileOrigins", &IOrganizer::getFileOrigins, "filename"_a)
             .def("findFileInfos", wrap_for_directory(&IOrganizer::findFileInfos),
-                 "path"_a, "filter"_a)
+                 "path"_a, "filter"_a, release_gil())
+            .def("queryFiles", &IOrganizer::queryFiles, "queries"_a, release_gil())
 
             .def("virtualFileTree", &IOrganizer::virtualFileTree)
 
@@ -674,7 +691,7 @@ namespace mo2::python {
                 },
                 "executable"_a, "args"_a = QStringList(), "cwd"_a = "",
                 "profile"_a = "", "forcedCustomOverwrite"_a = "",
-                "ignoreCustomOverwrite"_a = false)
+                "ignoreCustomOverwrite"_a = false, release_gil())
             .def(
                 "waitForApplication",
                 [](IOrganizer* o, std::uintptr_t handle, bool refresh) {
@@ -687,9 +704,9 @@ namespace mo2::python {
                     return std::make_tuple(
                         result, static_cast<std::make_signed_t<DWORD>>(returnCode));
                 },
-                "handle"_a, "refresh"_a = true)
+                "handle"_a, "refresh"_a = true, release_gil())
 
-            .def("refresh", &IOrganizer::refresh, "save_changes"_a = true)
+            .def("refresh", &IOrganizer::refresh, "save_changes"_a = true, release_gil())
             .def("managedGame", &IOrganizer::managedGame,
                  py::return_value_policy::reference)
 
@@ -197,6 +197,25 @@ namespace mo2::python {
             return make_generator(walk(tree));
         });
 
+        // every entry in one call and without a Python object per entry: the
+        // paths in walk() order, and bytes with 1 for directories and 0 for files at
+        // the same indices, which numpy.frombuffer() reads as is
+        iFileTreeClass.def(
+            "flatten",
+            [](std::shared_ptr<const IFileTree> tree, QString sep) {
+                QStringList paths;
+                std::string dirs;
+                tree->walk(
+                    [&](QString const& path, std::shared_ptr<const FileTreeEntry> entry) {
+                        paths.append(path + entry->name());
+                        dirs.push_back(entry->isDir() ? 1 : 0);
+                        return IFileTree::WalkReturn::CONTINUE;
+                    },
+                    sep);
+                return py::make_tuple(paths, py::bytes(dirs));
+            },
+            py::arg("sep") = "\\");
+
         iFileTreeClass.def(
             "glob",
             [](std::shared_ptr<const IFileTree> tree, QString pattern,
@@ -16,6 +16,7 @@
 #include <QCoreApplication>
 #include <QDir>
 #include <QFile>
+#include <QStandardPaths>
 
 #include "pybind11_qt/pybind11_qt.h"
 #include <pybind11/embed.h>
@@ -165,6 +166,22 @@ namespace mo2::python {
             config.site_import        = 1;
             config.optimization_level = 2;
 
+            // plugins usually live next to a read-only executable (AppImage, Flatpak,
+            // Program Files), where Python can't write their bytecode and compiles
+            // every module again on each start; keep it in the user cache instead
+            if (std::getenv("PYTHONPYCACHEPREFIX") == nullptr) {
+                const QString cache =
+                    QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+                    "/pycache";
+                if (QDir().mkpath(cache)) {
+                    const std::wstring prefix =
+                        QDir::toNativeSeparators(cache).toStdWString();
+                    PyConfig_SetString(&config, &config.pycache_prefix, prefix.c_str());
+                }
+            }
+
+            TimeThis initTime(QStringLiteral("python initialize"));
+
             py::initialize_interpreter(&config, 1, &argv0, true);
 
             // Restore process environment after interpreter startup so
@@ -202,6 +219,7 @@ namespace mo2::python {
             // release, trying to acquire it on a different thread will deadlock
             PyEval_SaveThread();
 
+            initTime.stop();
             return true;
         }
         catch (const py::error_already_set& ex) {
@@ -264,6 +282,10 @@ namespace mo2::python {
             // dictionary that will contain createPlugin() or createPlugins().
             py::dict moduleDict;
 
+            // importing and creating the plugins are timed apart, both show up in
+            // the startup trace
+            TimeThis importTime(QStringLiteral("python import %1").arg(baseName));
+
             if (identifier.endsWith(".py")) {
                 py::object mainModule = py::module_::import("__main__");
 
@@ -294,11 +316,15 @@ namespace mo2::python {
                 }
             }
 
+            importTime.stop();
+
             if (py::len(moduleDict) == 0) {
                 MOBase::log::error("No plugins found in {}.", identifier);
                 return {};
             }
 
+            TimeThis createTime(QStringLiteral("python create %1").arg(baseName));
+
             // Create the plugins:
             std::vector<py::object> plugins;
 
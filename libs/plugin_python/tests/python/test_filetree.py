@@ -74,6 +74,22 @@ def test_walk():
     assert {"a", "b", "b/u", "b/v"} == set(entries)
 
 
+def test_flatten():
+    tree = make_tree([("a", []), ("b", ["u", "v"]), "c.x", ("e", [("q", ["c.t"])])])
+
+    paths, dirs = tree.flatten("/")
+    assert sorted(paths) == sorted(e.path("/") for e in tree.walk())
+    assert {p: d for p, d in zip(paths, dirs)} == {
+        "a": 1,
+        "b": 1,
+        "b/u": 0,
+        "b/v": 0,
+        "c.x": 0,
+        "e": 1,
+        "e/q": 1,
+        "e/q/c.t": 0,
+    }
+
 def test_glob():
     tree = make_tree(
         [("a", []), ("b", ["u", "v"]), "c.x", "d.y", ("e", [("q", ["c.t", ("p", [])])])]
@@ -41,6 +41,18 @@ PYBIND11_MODULE(organizer, m)
                 }
             });
 
+        // one file per query, named after the query
+        ON_CALL(*mock, queryFiles)
+            .WillByDefault([](const QList<IOrganizer::FileQuery>& queries) {
+                QList<QList<IOrganizer::FileInfo>> results;
+                for (const auto& query : queries) {
+                    IOrganizer::FileInfo info;
+                    info.filePath = query.path + "|" + query.filters.join(",");
+                    results.append({info});
+                }
+                return results;
+            });
+
         return mock;
     });
 }
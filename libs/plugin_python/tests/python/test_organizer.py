@@ -12,3 +12,14 @@ def test_getters():
     assert o.startApplication("invalid.exe") == mobase.INVALID_HANDLE_VALUE
     assert o.waitForApplication(42) == (False, -1)
     assert o.waitForApplication(4654) == (True, 0)
+
+
+def test_query_files():
+    o: mobase.IOrganizer = m.organizer()
+    results = o.queryFiles(
+        [mobase.FileQuery("textures"), mobase.FileQuery("meshes", ["*.nif", "*.tri"])]
+    )
+    assert [[f.filePath for f in files] for files in results] == [
+        ["textures|"],
+        ["meshes|*.nif,*.tri"],
+    ]
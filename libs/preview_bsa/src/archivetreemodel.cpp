@@ -0,0 +1,262 @@
+
+/*
+    archivetreemodel.cpp
+
+    Provides a lazily populated tree model for the folders and files of an archive
+*/
+
+#include "archivetreemodel.h"
+
+#include <QFileIconProvider>
+
+ArchiveTreeModel::ArchiveTreeModel(BSA::Folder::Ptr root, QObject* parent)
+    : QAbstractItemModel(parent), m_Root(std::move(root))
+{
+  QFileIconProvider* provider = new QFileIconProvider();
+  m_FolderIcon                = provider->icon(QFileIconProvider::Folder);
+  m_FileIcon                  = provider->icon(QFileIconProvider::File);
+  delete provider;
+
+  m_RootNode.folder           = m_Root.get();
+  m_FolderNodes[m_Root.get()] = &m_RootNode;
+  fetch(&m_RootNode, false);
+
+  m_Index = std::async(std::launch::async, &ArchiveTreeModel::buildIndex, m_Root);
+
+  connect(&m_FilterWidget, &FilterWidget::changed, this,
+          [this](const QString&, const QString& filter) {
+            onFilterChanged(filter);
+          });
+}
+
+std::shared_ptr<const ArchiveTreeModel::FilterIndex>
+ArchiveTreeModel::buildIndex(BSA::Folder::Ptr root)
+{
+  auto index = std::make_shared<FilterIndex>();
+
+  std::vector<const BSA::Folder*> pending = {root.get()};
+  while (!pending.empty()) {
+    const BSA::Folder* folder = pending.back();
+    pending.pop_back();
+
+    for (unsigned int i = 0; i < folder->getNumSubFolders(); ++i) {
+      const BSA::Folder* sub = folder->getSubFolder(i).get();
+      index->entries.push_back({QString::fromStdString(sub->getName()), folder});
+      index->parents.emplace(sub, folder);
+      pending.push_back(sub);
+    }
+
+    for (unsigned int i = 0; i < folder->getNumFiles(); ++i) {
+      index->entries.push_back(
+          {QString::fromStdString(folder->getFile(i)->getName()), folder});
+    }
+  }
+
+  return index;
+}
+
+ArchiveTreeModel::Node* ArchiveTreeModel::nodeFromIndex(const QModelIndex& index) const
+{
+  if (!index.isValid()) {
+    return const_cast<Node*>(&m_RootNode);
+  }
+  return static_cast<Node*>(index.internalPointer());
+}
+
+void ArchiveTreeModel::fetch(Node* node, bool notify)
+{
+  if (node->fetched || node->folder == nullptr) {
+    return;
+  }
+  node->fetched = true;
+
+  const BSA::Folder* folder = node->folder;
+
+  const int count =
+      static_cast<int>(folder->getNumSubFolders() + folder->getNumFiles());
+  if (count == 0) {
+    return;
+  }
+
+  if (notify) {
+    const QModelIndex parent =
+        node == &m_RootNode ? QModelIndex() : createIndex(node->row, 0, node);
+    beginInsertRows(parent, 0, count - 1);
+  }
+
+  node->children.reserve(count);
+
+  for (unsigned int i = 0; i < folder->getNumSubFolders(); ++i) {
+    auto child    = std::make_unique<Node>();
+    child->parent = node;
+    child->row    = static_cast<int>(node->children.size());
+    child->folder = folder->getSubFolder(i).get();
+    child->name   = QString::fromStdString(child->folder->getName());
+
+    m_FolderNodes[child->folder] = child.get();
+    node->children.push_back(std::move(child));
+  }
+
+  for (unsigned int i = 0; i < folder->getNumFiles(); ++i) {
+    auto child    = std::make_unique<Node>();
+    child->parent = node;
+    child->row    = static_cast<int>(node->children.size());
+    child->name   = QString::fromStdString(folder->getFile(i)->getName());
+
+    node->children.push_back(std::move(child));
+  }
+
+  if (notify) {
+    endInsertRows();
+  }
+}
+
+void ArchiveTreeModel::fetchFolder(const BSA::Folder* folder, const FilterIndex& index)
+{
+  auto itor = m_FolderNodes.find(folder);
+  if (itor == m_FolderNodes.end()) {
+    // the node only exists once its parent is fetched
+    auto parent = index.parents.find(folder);
+    if (parent == index.parents.end()) {
+      return;
+    }
+
+    fetchFolder(parent->second, index);
+
+    itor = m_FolderNodes.find(folder);
+    if (itor == m_FolderNodes.end()) {
+      return;
+    }
+  }
+
+  fetch(itor->second, true);
+}
+
+void ArchiveTreeModel::onFilterChanged(const QString& filter)
+{
+  if (filter.isEmpty()) {
+    return;
+  }
+
+  // waits if the index isn't done yet, which only happens if the filter is used
+  // right after opening a large archive
+  const auto index = m_Index.get();
+
+  bool fetched = false;
+  for (const auto& entry : index->entries) {
+    auto itor = m_FolderNodes.find(entry.container);
+    if (itor != m_FolderNodes.end() && itor->second->fetched) {
+      continue;
+    }
+
+    if (m_FilterWidget.matches(entry.name)) {
+      fetchFolder(entry.container, *index);
+      fetched = true;
+    }
+  }
+
+  if (fetched && m_FilterWidget.proxyModel() != nullptr) {
+    // the parents of the new rows were rejected before their children existed
+    m_FilterWidget.proxyModel()->refreshFilter();
+  }
+}
+
+int ArchiveTreeModel::columnCount(const QModelIndex&) const
+{
+  return m_ColumnCount;
+}
+
+QVariant ArchiveTreeModel::data(const QModelIndex& index, int role) const
+{
+  if (!index.isValid())
+    return QVariant();
+
+  const Node* node = nodeFromIndex(index);
+
+  if (role == Qt::DecorationRole) {
+    if (node->folder != nullptr) {
+      return m_FolderIcon;
+    } else {
+      return m_FileIcon;
+    }
+  }
+
+  if (role != Qt::DisplayRole || index.column() != 0)
+    return QVariant();
+
+  return node->name;
+}
+
+Qt::ItemFlags ArchiveTreeModel::flags(const QModelIndex& index) const
+{
+  if (!index.isValid())
+    return Qt::NoItemFlags;
+
+  return QAbstractItemModel::flags(index);
+}
+
+QVariant ArchiveTreeModel::headerData(int section, Qt::Orientation orientation,
+                                      int role) const
+{
+  if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section == 0)
+    return tr("File Name");
+
+  return QVariant();
+}
+
+QModelIndex ArchiveTreeModel::index(int row, int column,
+                                    const QModelIndex& parent) const
+{
+  if (!hasIndex(row, column, parent))
+    return QModelIndex();
+
+  const Node* parentNode = nodeFromIndex(parent);
+  return createIndex(row, column, parentNode->children[row].get());
+}
+
+QModelIndex ArchiveTreeModel::parent(const QModelIndex& index) const
+{
+  if (!index.isValid())
+    return QModelIndex();
+
+  const Node* parentNode = nodeFromIndex(index)->parent;
+
+  if (parentNode == &m_RootNode)
+    return QModelIndex();
+
+  return createIndex(parentNode->row, 0, parentNode);
+}
+
+int ArchiveTreeModel::rowCount(const QModelIndex& parent) const
+{
+  if (parent.column() > 0)
+    return 0;
+
+  return static_cast<int>(nodeFromIndex(parent)->children.size());
+}
+
+bool ArchiveTreeModel::hasChildren(const QModelIndex& parent) const
+{
+  if (parent.column() > 0)
+    return false;
+
+  const Node* node = nodeFromIndex(parent);
+  if (node->fetched) {
+    return !node->children.empty();
+  }
+
+  // unfetched folders show an expander as long as they have anything in them
+  return node->folder != nullptr &&
+         (node->folder->getNumSubFolders() + node->folder->getNumFiles()) > 0;
+}
+
+bool ArchiveTreeModel::canFetchMore(const QModelIndex& parent) const
+{
+  const Node* node = nodeFromIndex(parent);
+  return node->folder != nullptr && !node->fetched;
+}
+
+void ArchiveTreeModel::fetchMore(const QModelIndex& parent)
+{
+  fetch(nodeFromIndex(parent), true);
+}
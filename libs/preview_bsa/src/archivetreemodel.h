@@ -0,0 +1,104 @@
+#ifndef ARCHIVETREEMODEL_H
+#define ARCHIVETREEMODEL_H
+
+#include <QAbstractItemModel>
+#include <QIcon>
+#include <QLineEdit>
+#include <QModelIndex>
+#include <QVariant>
+
+#include <future>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <bsatk/bsatk.h>
+#include <uibase/filterwidget.h>
+
+using namespace MOBase;
+
+// Tree of the folders and files of an archive, backed directly by the folder
+// records of bsatk. The children of a folder are only created when the view
+// first expands it, so opening an archive with 100k+ files costs as much as
+// showing its top level.
+//
+// Filtering only ever sees the rows that exist, so the names of all entries are
+// indexed in the background once the model is created. When the filter
+// changes, the folders holding matching entries are fetched from that index
+// before the view is filtered.
+class ArchiveTreeModel : public QAbstractItemModel
+{
+  Q_OBJECT
+
+public:
+  // the folders below `root` must not change while the model exists, they're
+  // read from a background thread
+  explicit ArchiveTreeModel(BSA::Folder::Ptr root, QObject* parent = nullptr);
+
+  void setFilterWidgetList(QAbstractItemView* list) { m_FilterWidget.setList(list); }
+  void setFilterWidgetEdit(QLineEdit* edit) { m_FilterWidget.setEdit(edit); }
+
+  QVariant data(const QModelIndex& index, int role) const override;
+  Qt::ItemFlags flags(const QModelIndex& index) const override;
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role = Qt::DisplayRole) const override;
+  QModelIndex index(int row, int column,
+                    const QModelIndex& parent = QModelIndex()) const override;
+  QModelIndex parent(const QModelIndex& index) const override;
+  int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+  bool hasChildren(const QModelIndex& parent = QModelIndex()) const override;
+  bool canFetchMore(const QModelIndex& parent) const override;
+  void fetchMore(const QModelIndex& parent) override;
+
+private:
+  struct Node
+  {
+    Node* parent = nullptr;
+    int row      = 0;
+    QString name;
+
+    // null for files
+    const BSA::Folder* folder = nullptr;
+
+    bool fetched = false;
+    std::vector<std::unique_ptr<Node>> children;
+  };
+
+  // every folder and file name below the root and the folder it's in, so the
+  // folders with matches can be fetched without walking the whole tree
+  struct FilterIndex
+  {
+    struct Entry
+    {
+      QString name;
+      const BSA::Folder* container;
+    };
+
+    std::vector<Entry> entries;
+    std::unordered_map<const BSA::Folder*, const BSA::Folder*> parents;
+  };
+
+  static std::shared_ptr<const FilterIndex> buildIndex(BSA::Folder::Ptr root);
+
+  Node* nodeFromIndex(const QModelIndex& index) const;
+
+  // creates the children of `node`, emitting the insertion if `notify` is set
+  void fetch(Node* node, bool notify);
+
+  // fetches `folder` and all the folders above it
+  void fetchFolder(const BSA::Folder* folder, const FilterIndex& index);
+
+  void onFilterChanged(const QString& filter);
+
+  const int m_ColumnCount = 1;
+  BSA::Folder::Ptr m_Root;
+  Node m_RootNode;
+  std::unordered_map<const BSA::Folder*, Node*> m_FolderNodes;
+  std::shared_future<std::shared_ptr<const FilterIndex>> m_Index;
+  FilterWidget m_FilterWidget;
+  QIcon m_FileIcon;
+  QIcon m_FolderIcon;
+};
+
+#endif  // ARCHIVETREEMODEL_H
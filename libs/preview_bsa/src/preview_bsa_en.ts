@@ -35,9 +35,9 @@
     </message>
 </context>
 <context>
-    <name>SimpleFileTreeModel</name>
+    <name>ArchiveTreeModel</name>
     <message>
-        <location filename="simplefiletreemodel.cpp" line="22"/>
+        <location filename="archivetreemodel.cpp" line="202"/>
         <source>File Name</source>
         <translation type="unfinished"></translation>
     </message>
@@ -23,9 +23,11 @@ along with Bsa Preview plugin.  If not, see <http://www.gnu.org/licenses/>.
 #include <QImageReader>
 #include <QLabel>
 #include <QLineEdit>
+#include <QPointer>
 #include <QScreen>
 #include <QStandardItemModel>
 #include <QTextEdit>
+#include <QThreadPool>
 #include <QTreeView>
 #include <QTreeWidget>
 #include <QVBoxLayout>
@@ -35,7 +37,7 @@ along with Bsa Preview plugin.  If not, see <http://www.gnu.org/licenses/>.
 #include <uibase/log.h>
 #include <uibase/utility.h>
 
-#include "simplefiletreemodel.h"
+#include "archivetreemodel.h"
 
 using namespace MOBase;
 
@@ -107,42 +109,26 @@ QWidget* PreviewBsa::genFilePreview(const QString& fileName, const QSize& maxSiz
   }
 }
 
-void PreviewBsa::readFiles(const BSA::Folder::Ptr archiveFolder)
-{
-  const auto fileCount = archiveFolder->getNumFiles();
-  for (unsigned int i = 0; i < fileCount; ++i) {
-    const BSA::File::Ptr file = archiveFolder->getFile(i);
-
-    m_Files << QString::fromStdString(file->getFilePath());
-  }
-
-  // recurse into subdirectories
-  const auto dirCount = archiveFolder->getNumSubFolders();
-  for (unsigned int i = 0; i < dirCount; ++i) {
-    const BSA::Folder::Ptr folder = archiveFolder->getSubFolder(i);
-
-    readFiles(folder);
-  }
-}
-
 QWidget* PreviewBsa::genBsaPreview(const QString& fileName, const QSize&)
 {
-  m_Files.clear();
   QWidget* wrapper    = new QWidget();
   QVBoxLayout* layout = new QVBoxLayout();
 
   QLabel* infoLabel = new QLabel();
-  BSA::Archive arch;  // bs_archive_auto is easier to use, but is less performant when
-                      // working with memory
-  BSA::EErrorCode res = arch.read(fileName.toLocal8Bit().constData(), true);
-  if ((res != BSA::ERROR_NONE) && (res != BSA::ERROR_INVALIDHASHES)) {
+  // bs_archive_auto is easier to use, but is less performant when working with
+  // memory. the archive stays cached, previewing it again doesn't parse it again
+  BSA::EErrorCode res = BSA::ERROR_NONE;
+  const auto archive =
+      BSA::ArchiveCache::instance().get(fileName.toLocal8Bit().constData(), &res);
+  if (archive == nullptr) {
     log::error("invalid bsa '{}', error {}", fileName, res);
     infoLabel->setText("Unable to parse archive. Unrecognized format.");
-    arch.close();
     return wrapper;
   }
+  const BSA::Archive& arch = *archive;
+  // the folder records outlive the archive, the model reads them as folders are
+  // expanded
   const BSA::Folder::Ptr archiveDir = arch.getRoot();
-  readFiles(archiveDir);
   QString infoString =
       tr("Archive Format: %1 , Compression: %2 , File count: %3 , Version: %4 , "
          "Archive type: %5 , Archive flags: %6");
@@ -150,7 +136,7 @@ QWidget* PreviewBsa::genBsaPreview(const QString& fileName, const QSize&)
   //    "Archive type: %5 , Archive flags: %6 , Contents flags: %7");
   infoString = infoString.arg(getFormat(arch.getType()))
                    .arg((arch.getFlags() & 0x00000004) ? tr("yes") : tr("no"))
-                   .arg(m_Files.size())
+                   .arg(archiveDir->countFiles())
                    .arg(getVersion(arch.getType()))
                    .arg(arch.getType())
                    .arg("0x" + QString::number(arch.getFlags(), 16));
@@ -158,8 +144,28 @@ QWidget* PreviewBsa::genBsaPreview(const QString& fileName, const QSize&)
   infoLabel->setText(infoString);
   layout->addWidget(infoLabel);
 
-  QTreeView* view            = new QTreeView();
-  SimpleFileTreeModel* model = new SimpleFileTreeModel(m_Files, view);
+  // the names are checked against their hashes in the background, problems are
+  // added to the label once that's done
+  const QString hashWarning =
+      tr("Some file names don't match their hashes, the archive may be broken.");
+  QThreadPool::globalInstance()->start(
+      [archive, hashWarning, label = QPointer<QLabel>(infoLabel)] {
+        if (archive->verifyHashes() != BSA::ERROR_INVALIDHASHES) {
+          return;
+        }
+
+        QMetaObject::invokeMethod(
+            qApp,
+            [hashWarning, label] {
+              if (label) {
+                label->setText(label->text() + "\n" + hashWarning);
+              }
+            },
+            Qt::QueuedConnection);
+      });
+
+  QTreeView* view         = new QTreeView();
+  ArchiveTreeModel* model = new ArchiveTreeModel(archiveDir, view);
 
   view->setModel(model);
   layout->addWidget(view);
@@ -174,7 +180,6 @@ QWidget* PreviewBsa::genBsaPreview(const QString& fileName, const QSize&)
   view->sortByColumn(0, Qt::SortOrder::AscendingOrder);
 
   wrapper->setLayout(layout);
-  arch.close();
   return wrapper;
 }
 
@@ -52,7 +52,6 @@ public:
   virtual QWidget* genFilePreview(const QString& fileName, const QSize& maxSize) const;
 
 private:
-  void readFiles(const BSA::Folder::Ptr folder);
   QWidget* genBsaPreview(const QString& fileName, const QSize& maxSize);
   QString getFormat(ArchiveType type) const;
   BSAULong getVersion(ArchiveType type) const;
@@ -63,7 +62,6 @@ private:
 
 private:
   const MOBase::IOrganizer* m_MOInfo;
-  QStringList m_Files;
 };
 
 #endif  // PREVIEWBSA_H
@@ -1,6 +1,6 @@
 import io
 
-from PyQt6.QtCore import QCoreApplication, qCritical, QFile, QIODeviceBase
+from PyQt6.QtCore import QCoreApplication, qCritical, QFile, QIODeviceBase, QSize
 from PyQt6.QtOpenGL import QOpenGLTexture
 
 from . import DDSDefinitions
@@ -30,6 +30,10 @@ class DDSFile:
         self.fileData = fileData
         self.data = None
         self.isCubemap = None
+        # the levels larger than the preview are skipped, these describe the largest one that was loaded
+        self.firstMipLevel = 0
+        self.width = 0
+        self.height = 0
 
     @classmethod
     def fromFile(cls, fileName: str):
@@ -40,7 +44,7 @@ class DDSFile:
             raise DDSReadException()
         return cls(fileData.data(), fileName)
 
-    def load(self):
+    def load(self, maxSize: QSize = None):
         with io.BytesIO(self.fileData) as file:
             magicNumber = file.read(4)
             if magicNumber != DDSDefinitions.DDS_MAGIC_NUMBER:
@@ -72,10 +76,22 @@ class DDSFile:
             else:
                 self.isCubemap = False
 
+            mipCount = self.mipLevels()
+            self.firstMipLevel = 0
+            self.width = self.header.dwWidth
+            self.height = self.header.dwHeight
+            if maxSize is not None and maxSize.isValid():
+                # the GPU decodes whatever is uploaded, uploading a 4K level only to draw it in a small widget wastes
+                # most of the time
+                while self.firstMipLevel < mipCount - 1 and (
+                        self.width > maxSize.width() or self.height > maxSize.height()):
+                    self.firstMipLevel += 1
+                    self.width = max(self.width // 2, 1)
+                    self.height = max(self.height // 2, 1)
+
             for layer in range(layerCount):
                 nextWidth = self.header.dwWidth
                 nextHeight = self.header.dwHeight
-                mipCount = self.mipLevels()
                 for level in range(mipCount):
                     if self.header.ddspf.dwFlags & (
                         DDSDefinitions.DDS_PIXELFORMAT.Flags.DDPF_ALPHA | DDSDefinitions.DDS_PIXELFORMAT.Flags.DDPF_RGB | DDSDefinitions.DDS_PIXELFORMAT.Flags.DDPF_YUV | DDSDefinitions.DDS_PIXELFORMAT.Flags.DDPF_LUMINANCE):
@@ -86,7 +102,10 @@ class DDSFile:
                         else:
                             dxgiFormat = DDSDefinitions.fourCCToDXGI(fourCC)
                         size = DDSDefinitions.sizeFromFormat(dxgiFormat, nextWidth, nextHeight)
-                    self.data.append(file.read(size))
+                    if level < self.firstMipLevel:
+                        file.seek(size, io.SEEK_CUR)
+                    else:
+                        self.data.append(file.read(size))
                     nextWidth = max(nextWidth // 2, 1)
                     nextHeight = max(nextHeight // 2, 1)
 
@@ -133,6 +152,9 @@ class DDSFile:
         else:
             return 1
 
+    def loadedMipLevels(self):
+        return self.mipLevels() - self.firstMipLevel
+
     def asQOpenGLTexture(self, gl, context):
         if not self.data:
             return
@@ -160,11 +182,11 @@ class DDSFile:
             texture = QOpenGLTexture(QOpenGLTexture.Target.Target2D)
         # Assume single layer for now
         # self.texture.setLayers(1)
-        mipCount = self.mipLevels()
+        mipCount = self.loadedMipLevels()
         texture.setAutoMipMapGenerationEnabled(False)
         texture.setMipLevels(mipCount)
         texture.setMipLevelRange(0, mipCount - 1)
-        texture.setSize(self.header.dwWidth, self.header.dwHeight)
+        texture.setSize(self.width, self.height)
         texture.setFormat(QOpenGLTexture.TextureFormat(self.glFormat.internalFormat))
         texture.allocateStorage()
 
@@ -188,8 +210,8 @@ class DDSFile:
                                                           self.data[faceIndex * mipCount + i])
                             else:
                                 gl.glCompressedTexSubImage2D(ddsCubemapFaces[face], i, 0, 0,
-                                                             max(self.header.dwWidth // 2 ** i, 1),
-                                                             max(self.header.dwHeight // 2 ** i, 1),
+                                                             max(self.width // 2 ** i, 1),
+                                                             max(self.height // 2 ** i, 1),
                                                              self.glFormat.internalFormat,
                                                              len(self.data[faceIndex * mipCount + i]),
                                                              self.data[faceIndex * mipCount + i])
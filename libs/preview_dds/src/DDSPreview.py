@@ -454,13 +454,13 @@ class DDSPreview(mobase.IPluginPreview):
         return True
 
     def genFilePreview(self, fileName: str, maxSize: QSize) -> QWidget:
-        return self.previewFromDDSFile(DDSFile.fromFile(fileName))
+        return self.previewFromDDSFile(DDSFile.fromFile(fileName), maxSize)
 
     def genDataPreview(self, fileData: bytes, fileName: str, maxSize: QSize) -> QWidget:
-        return self.previewFromDDSFile(DDSFile(fileData, fileName))
+        return self.previewFromDDSFile(DDSFile(fileData, fileName), maxSize)
 
-    def previewFromDDSFile(self, ddsFile: DDSFile) -> QWidget:
-        ddsFile.load()
+    def previewFromDDSFile(self, ddsFile: DDSFile, maxSize: QSize = None) -> QWidget:
+        ddsFile.load(maxSize)
         layout = QGridLayout()
         # Image grows before label and button
         layout.setRowStretch(0, 1)
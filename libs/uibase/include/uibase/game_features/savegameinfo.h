@@ -35,6 +35,22 @@ public:
    */
   virtual MissingAssets getMissingAssets(MOBase::ISaveGame const& save) const = 0;
 
+  /**
+   * @brief Get the plugins a save needs.
+   *
+   * @param save The save to retrieve the plugins of.
+   *
+   * @returns the names of the plugins, empty if the game doesn't keep track of
+   * them.
+   *
+   * This is called from worker threads for many saves at once, so it must only
+   * read the save and not the current state of the organizer.
+   */
+  virtual QStringList getRequiredPlugins(MOBase::ISaveGame const& save) const
+  {
+    return {};
+  }
+
   /**
    * @brief Get a widget to display over the save game list.
    *
@@ -294,7 +294,7 @@ public:  // Methods
   std::shared_ptr<const IFileTree> parent() const { return m_Parent.lock(); }
 
 public:  // Destructor:
-  virtual ~FileTreeEntry() {}
+  virtual ~FileTreeEntry();
 
 protected:  // Constructors:
   /**
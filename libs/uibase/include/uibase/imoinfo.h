@@ -82,6 +82,16 @@ public:
                           /// highest priority one
   };
 
+  /**
+   * @brief a query for queryFiles()
+   */
+  struct FileQuery
+  {
+    QString path;         /// path relative to the data directory
+    QStringList filters;  /// glob filters of the files to find in the directory
+                          /// `path`; if empty, `path` is the file to look up
+  };
+
 public:
   virtual ~IOrganizer() {}
 
@@ -315,6 +325,18 @@ public:
   findFileInfos(const QString& path,
                 const std::function<bool(const FileInfo&)>& filter) const = 0;
 
+  /**
+   * @brief runs many file lookups at once, against the same state of the virtual
+   * directory
+   * @param queries the files to look up or directories and filters to search
+   * @return for every query, the files it found with their origins; a lookup finds
+   * one file at most
+   * @note this replaces a loop of resolvePath(), getFileOrigins() or findFiles()
+   * calls, directories named by more than one query are only looked up once
+   */
+  virtual QList<QList<FileInfo>>
+  queryFiles(const QList<FileQuery>& queries) const = 0;
+
   /**
    * @return a IFileTree representing the virtual file tree.
    */
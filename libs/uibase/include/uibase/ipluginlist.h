@@ -261,6 +261,35 @@ public:
    * exist
    */
   virtual QString description(const QString& name) const = 0;
+
+  /**
+   * @brief retrieve the number of records a plugin adds rather than overrides
+   * @param name filename of the plugin (without path but with file extension)
+   * @return the number of new records or -1 if the plugin doesn't exist or hasn't
+   * been scanned yet
+   * @note plugins are scanned in the background after the list is refreshed
+   */
+  virtual int newRecordCount(const QString& name) const = 0;
+
+  /**
+   * @brief determine if a plugin could be flagged as light without renumbering
+   * its records
+   * @param name filename of the plugin (without path but with file extension)
+   * @return true if the form ids of all new records are in the range of a light
+   * plugin, false if they're not, if the plugin doesn't exist or if it hasn't been
+   * scanned yet
+   */
+  virtual bool isLightEligible(const QString& name) const = 0;
+
+  /**
+   * @brief determine if a plugin could be flagged as medium without renumbering
+   * its records
+   * @param name filename of the plugin (without path but with file extension)
+   * @return true if the form ids of all new records are in the range of a medium
+   * plugin, false if they're not, if the plugin doesn't exist or if it hasn't been
+   * scanned yet
+   */
+  virtual bool isMediumEligible(const QString& name) const = 0;
 };
 
 }  // namespace MOBase
@@ -8,7 +8,9 @@
 #include <QSize>
 #include <QString>
 #include <QStringView>
+#include <cstdint>
 #include <filesystem>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -26,6 +28,10 @@ namespace spdlog::sinks
 {
 class sink;
 }
+namespace spdlog::details
+{
+class thread_pool;
+}
 
 namespace MOBase::log
 {
@@ -63,11 +69,19 @@ concept RuntimeFormatString = requires(F&& f, Args&&... args) {
 
 void QDLLEXPORT doLogImpl(spdlog::logger& lg, Levels lv, const std::string& s) noexcept;
 
+// whether messages of the given level are logged at all, checked before
+// anything is formatted
+bool QDLLEXPORT shouldLog(const spdlog::logger& lg, Levels lv) noexcept;
+
 template <class... Args>
 void doLog(spdlog::logger& logger, Levels lv,
-           const std::vector<MOBase::log::BlacklistEntry> bl,
+           const std::vector<MOBase::log::BlacklistEntry>& bl,
            std::format_string<Args...> format, Args&&... args) noexcept
 {
+  if (!shouldLog(logger, lv)) {
+    return;
+  }
+
   // format errors are logged without much information to avoid throwing again
 
   std::string s;
@@ -94,9 +108,13 @@ void doLog(spdlog::logger& logger, Levels lv,
 
 template <class F, class... Args>
 void doLog(spdlog::logger& logger, Levels lv,
-           const std::vector<MOBase::log::BlacklistEntry> bl, F&& format,
+           const std::vector<MOBase::log::BlacklistEntry>& bl, F&& format,
            Args&&... args) noexcept
 {
+  if (!shouldLog(logger, lv)) {
+    return;
+  }
+
   std::string s;
 
   // format errors are logged without much information to avoid throwing again
@@ -191,6 +209,11 @@ public:
   void setFile(const File& f);
   void setCallback(Callback* f);
 
+  // messages are written to the sinks by a background thread, this waits until
+  // the ones logged so far have been written and the sinks flushed, or for
+  // about a second; errors are flushed like this as soon as they're logged
+  void flush();
+
   void addToBlacklist(const std::string& filter, const std::string& replacement);
   void removeFromBlacklist(const std::string& filter);
   void resetBlacklist();
@@ -253,6 +276,7 @@ public:
   {
     details::doLog(*m_logger, lv, m_conf.blacklist, std::forward<F>(format),
                    std::forward<Args>(args)...);
+    flushErrors(lv);
   }
 
   template <class... Args>
@@ -260,14 +284,39 @@ public:
   {
     details::doLog(*m_logger, lv, m_conf.blacklist, format,
                    std::forward<Args>(args)...);
+    flushErrors(lv);
   }
 
 private:
   LoggerConfiguration m_conf;
-  std::unique_ptr<spdlog::logger> m_logger;
+
+  // declared before the logger so it's destroyed after it, which writes the
+  // messages still in its queue
+  std::shared_ptr<spdlog::details::thread_pool> m_pool;
+  std::shared_ptr<spdlog::logger> m_logger;
   std::shared_ptr<spdlog::sinks::sink> m_sinks;
   std::shared_ptr<spdlog::sinks::sink> m_console, m_callback, m_file;
 
+  // a logger on the same pool whose only sink notes the messages reaching it,
+  // see flush()
+  std::shared_ptr<spdlog::logger> m_barrier;
+  std::shared_ptr<spdlog::sinks::sink> m_barrierSink;
+  std::timed_mutex m_barrierMutex;
+  std::uint64_t m_barriers = 0;
+
+  // an error may be the last thing logged before the process dies, it's not
+  // left in the queue
+  void flushErrors(Levels lv) noexcept
+  {
+    if (lv >= Error) {
+      try {
+        flush();
+      } catch (...) {
+        // still written, just later
+      }
+    }
+  }
+
   void createLogger(const std::string& name);
   void addSink(std::shared_ptr<spdlog::sinks::sink> sink);
 };
@@ -275,6 +324,9 @@ private:
 QDLLEXPORT void createDefault(LoggerConfiguration conf);
 QDLLEXPORT Logger& getDefault();
 
+// whether createDefault() was called yet
+QDLLEXPORT bool hasDefault();
+
 template <class F, class... Args>
   requires(details::RuntimeFormatString<F, Args...>)
 void debug(F&& format, Args&&... args) noexcept
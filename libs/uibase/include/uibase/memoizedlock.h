@@ -48,6 +48,9 @@ public:
 
   void invalidate() { m_NeedUpdating = true; }
 
+  // whether the value is up-to-date, so value() wouldn't compute it
+  bool hasValue() const { return !m_NeedUpdating; }
+
 private:
   mutable std::mutex m_Mutex;
   mutable std::atomic<bool> m_NeedUpdating{true};
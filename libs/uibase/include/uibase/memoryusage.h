@@ -0,0 +1,140 @@
+#ifndef UIBASE_MEMORYUSAGE_H
+#define UIBASE_MEMORYUSAGE_H
+
+#include <QString>
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "dllimport.h"
+
+// Estimated memory held by the big structures of the application, so a session
+// that uses a lot of it can be attributed to the mod list, the directory
+// structure, the file trees, etc.
+//
+// Structures that are built as a whole report() their usage once they're
+// built, which also records a "memory: <subsystem>" counter in the trace;
+// those that change an item at a time keep a Counter up to date instead.  Both
+// show up in usages().
+//
+// The numbers are estimates from the size of the objects and what their
+// containers allocate: allocator overhead isn't counted and implicitly shared
+// data is counted by every owner.
+//
+// All functions are thread-safe.
+namespace MOBase::memory
+{
+
+struct Usage
+{
+  QString subsystem;
+  qint64 bytes = 0;
+  qint64 items = 0;
+};
+
+// replaces the usage of `subsystem`
+//
+QDLLEXPORT void report(const QString& subsystem, qint64 bytes, qint64 items);
+
+// usage of a subsystem that's updated from hot paths, which is only a couple of
+// relaxed atomics; counters register themselves and are meant to be statics
+//
+class QDLLEXPORT Counter
+{
+public:
+  explicit Counter(QString subsystem);
+  ~Counter();
+
+  Counter(const Counter&)            = delete;
+  Counter& operator=(const Counter&) = delete;
+
+  // negative to remove
+  void add(qint64 bytes, qint64 items)
+  {
+    m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    m_items.fetch_add(items, std::memory_order_relaxed);
+  }
+
+  void set(qint64 bytes, qint64 items)
+  {
+    m_bytes.store(bytes, std::memory_order_relaxed);
+    m_items.store(items, std::memory_order_relaxed);
+  }
+
+  Usage usage() const;
+
+private:
+  const QString m_subsystem;
+  std::atomic<qint64> m_bytes{0};
+  std::atomic<qint64> m_items{0};
+};
+
+// the usage of every subsystem, sorted by name
+//
+QDLLEXPORT std::vector<Usage> usages();
+
+// records the current usage of every subsystem as counters in the trace,
+// report() only does it when a structure is built and Counter never does
+//
+QDLLEXPORT void trace();
+
+// bytes a node of std::map or std::set takes besides its value, and the same
+// for the nodes of the unordered containers
+//
+constexpr std::size_t TreeNodeOverhead = 4 * sizeof(void*);
+constexpr std::size_t HashNodeOverhead = 2 * sizeof(void*);
+
+// characters of `s` that don't fit in the object itself
+//
+template <class C>
+std::size_t heapBytes(const std::basic_string<C>& s)
+{
+  const auto* data = reinterpret_cast<const char*>(s.data());
+  const auto* self = reinterpret_cast<const char*>(&s);
+
+  if (data >= self && data < self + sizeof(s)) {
+    return 0;
+  }
+
+  return (s.capacity() + 1) * sizeof(C);
+}
+
+// characters of `s` and the header of its data, nothing for literals
+//
+inline std::size_t heapBytes(const QString& s)
+{
+  if (s.capacity() == 0) {
+    return 0;
+  }
+
+  return 2 * sizeof(void*) + (s.capacity() + 1) * sizeof(QChar);
+}
+
+template <class T, class A>
+std::size_t heapBytes(const std::vector<T, A>& v)
+{
+  return v.capacity() * sizeof(T);
+}
+
+// nodes of a std::map or std::set, not what their values allocate
+//
+template <class C>
+std::size_t treeBytes(const C& c)
+{
+  return c.size() * (TreeNodeOverhead + sizeof(typename C::value_type));
+}
+
+// nodes and buckets of an unordered container, not what their values allocate
+//
+template <class C>
+std::size_t hashBytes(const C& c)
+{
+  return c.size() * (HashNodeOverhead + sizeof(typename C::value_type)) +
+         c.bucket_count() * sizeof(void*);
+}
+
+}  // namespace MOBase::memory
+
+#endif  // UIBASE_MEMORYUSAGE_H
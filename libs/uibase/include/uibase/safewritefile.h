@@ -67,6 +67,15 @@ private:
 #endif
 };
 
+/**
+ * @brief writes `data` to `fileName` through a SafeWriteFile, unless the file
+ * already holds exactly that; unchanged files keep their modification time, so
+ * whatever watches or maps them isn't disturbed for nothing
+ * @return true if the file was written
+ * @throws Exception if the file could not be opened for writing
+ */
+QDLLEXPORT bool writeFileIfDifferent(const QString& fileName, const QByteArray& data);
+
 }  // namespace MOBase
 
 #endif  // SAFEWRITEFILE_H
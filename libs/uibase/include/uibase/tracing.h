@@ -0,0 +1,45 @@
+#ifndef UIBASE_TRACING_H
+#define UIBASE_TRACING_H
+
+#include <QByteArray>
+#include <QString>
+
+#include <chrono>
+
+#include "dllimport.h"
+
+// Process-wide recorder for timed spans and counters, exported in the trace
+// event format of Chrome so a whole startup can be looked at with
+// chrome://tracing, Perfetto or speedscope.  Spans of a thread nest by time, so
+// a TimeThis inside another one shows up below it.
+//
+// Recording is cheap and always on; the recorder keeps the first events only,
+// up to a fixed number, which a whole session of normal use stays well within.
+//
+// All functions are thread-safe.
+namespace MOBase::tracing
+{
+
+using Clock = std::chrono::steady_clock;
+
+// records a span of `name` on the calling thread; TimeThis records one for
+// every scope it times
+//
+QDLLEXPORT void span(const QString& name, Clock::time_point start,
+                     Clock::time_point end);
+
+// records the value of counter `name` at this point
+//
+QDLLEXPORT void counter(const QString& name, qint64 value);
+
+// everything recorded so far as a Chrome trace JSON document
+//
+QDLLEXPORT QByteArray chromeTrace();
+
+// forgets everything recorded so far
+//
+QDLLEXPORT void clear();
+
+}  // namespace MOBase::tracing
+
+#endif  // UIBASE_TRACING_H
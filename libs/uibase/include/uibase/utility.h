@@ -376,7 +376,7 @@ public:
   void stop();
 
 private:
-  using Clock = std::chrono::high_resolution_clock;
+  using Clock = std::chrono::steady_clock;
 
   QString m_what;
   Clock::time_point m_start;
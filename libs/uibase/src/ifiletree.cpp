@@ -1,4 +1,5 @@
 #include <uibase/ifiletree.h>
+#include <uibase/memoryusage.h>
 
 #include <algorithm>
 #include <ranges>
@@ -10,9 +11,36 @@
 // FileTreeEntry:
 namespace MOBase
 {
+namespace
+{
+// every entry of every tree along with its name, trees outlive statics
+memory::Counter& entriesUsage()
+{
+  static auto* counter = new memory::Counter("file trees");
+  return *counter;
+}
+
+void setEntryName(QString& name, QString value)
+{
+  entriesUsage().add(static_cast<qint64>(memory::heapBytes(value)) -
+                         static_cast<qint64>(memory::heapBytes(name)),
+                     0);
+  name = std::move(value);
+}
+}  // namespace
+
 FileTreeEntry::FileTreeEntry(std::shared_ptr<const IFileTree> parent, QString name)
     : m_Parent(parent), m_Name(name)
-{}
+{
+  entriesUsage().add(sizeof(FileTreeEntry) + memory::heapBytes(m_Name), 1);
+}
+
+FileTreeEntry::~FileTreeEntry()
+{
+  entriesUsage().add(-static_cast<qint64>(sizeof(FileTreeEntry) +
+                                          memory::heapBytes(m_Name)),
+                     -1);
+}
 
 QString FileTreeEntry::suffix() const
 {
@@ -99,32 +127,47 @@ struct FileEntryComparator
 };
 
 /**
- * @brief Comparator that can be used to find entry matching the given name and
- *     file type.
+ * @brief Find the entry matching the given name and file type.
+ *
+ * The entries of a tree are sorted using FileEntryComparator, so this is a binary
+ * search among the directories and then among the files.
+ *
+ * @param entries Entries of a tree.
+ * @param name Name of the entry.
+ * @param matchTypes Types of entry to look for.
+ *
+ * @return an iterator to the entry, or the end of the entries if there is none.
  */
-struct MatchEntryComparator
+static std::vector<std::shared_ptr<FileTreeEntry>>::const_iterator
+findEntry(std::vector<std::shared_ptr<FileTreeEntry>> const& entries,
+          QString const& name, FileTreeEntry::FileTypes matchTypes)
 {
-
-  MatchEntryComparator(QString const& name, FileTreeEntry::FileTypes matchTypes)
-      : m_Name(name), m_MatchTypes(matchTypes)
-  {}
-
-  bool operator()(const std::shared_ptr<const FileTreeEntry>& fileEntry) const
-  {
-    return m_MatchTypes.testFlag(fileEntry->fileType()) &&
-           fileEntry->compare(m_Name) == 0;
+  const auto lessThanName = [](std::shared_ptr<FileTreeEntry> const& entry,
+                               QString const& value) {
+    return entry->compare(value) < 0;
+  };
+
+  const auto files = std::partition_point(entries.begin(), entries.end(),
+                                          [](auto const& entry) {
+                                            return entry->isDir();
+                                          });
+
+  if (matchTypes.testFlag(FileTreeEntry::DIRECTORY)) {
+    auto it = std::lower_bound(entries.begin(), files, name, lessThanName);
+    if (it != files && (*it)->compare(name) == 0) {
+      return it;
+    }
   }
 
-  bool operator()(const std::shared_ptr<FileTreeEntry>& fileEntry) const
-  {
-    return m_MatchTypes.testFlag(fileEntry->fileType()) &&
-           fileEntry->compare(m_Name) == 0;
+  if (matchTypes.testFlag(FileTreeEntry::FILE)) {
+    auto it = std::lower_bound(files, entries.end(), name, lessThanName);
+    if (it != entries.end() && (*it)->compare(name) == 0) {
+      return it;
+    }
   }
 
-private:
-  QString const& m_Name;
-  FileTreeEntry::FileTypes m_MatchTypes;
-};
+  return entries.end();
+}
 
 /**
  *
@@ -261,8 +304,7 @@ IFileTree::iterator IFileTree::insert(std::shared_ptr<FileTreeEntry> entry,
   }
 
   // Check if there exists an entry with the same name:
-  auto existingIt = std::find_if(
-      begin(), end(), MatchEntryComparator{entry->name(), FILE_OR_DIRECTORY});
+  auto existingIt = findEntry(entries(), entry->name(), FILE_OR_DIRECTORY);
 
   // Already in the tree?
   if (existingIt != end() && *existingIt == entry) {
@@ -348,11 +390,27 @@ bool IFileTree::move(std::shared_ptr<FileTreeEntry> entry, QString path,
   // Retrieve the path:
   QStringList parts = splitPath(path);
 
+  // A renamed entry has to move to its new place in its current parent, since
+  // entries are looked up using binary searches. It goes after the entry with the
+  // same name, if any, so that lookups find the one it conflicts with:
+  const auto resort = [&entry]() {
+    if (auto entryParent = entry->parent()) {
+      auto& parentEntries = entryParent->entries();
+      parentEntries.erase(
+          std::find(parentEntries.begin(), parentEntries.end(), entry));
+      parentEntries.insert(std::upper_bound(parentEntries.begin(),
+                                            parentEntries.end(), entry,
+                                            FileEntryComparator{}),
+                           entry);
+    }
+  };
+
   // Backup the entry name (in case the insertion fails), and update the
   // name:
   QString entryName = entry->m_Name;
   if (!insertFolder) {
-    entry->m_Name = parts.takeLast();
+    setEntryName(entry->m_Name, parts.takeLast());
+    resort();
   }
 
   // Find or create the tree:
@@ -376,7 +434,10 @@ bool IFileTree::move(std::shared_ptr<FileTreeEntry> entry, QString path,
   // We try to insert, and if it fails we need to reset the name:
   auto it = tree->insert(entry, insertPolicy);
   if (it == tree->end()) {
-    entry->m_Name = entryName;
+    if (entry->m_Name != entryName) {
+      setEntryName(entry->m_Name, entryName);
+      resort();
+    }
     return false;
   }
 
@@ -445,9 +506,7 @@ IFileTree::iterator IFileTree::erase(std::shared_ptr<FileTreeEntry> entry)
 std::pair<IFileTree::iterator, std::shared_ptr<FileTreeEntry>>
 IFileTree::erase(QString name)
 {
-  auto it = std::find_if(begin(), end(), [&name](const auto& entry) {
-    return entry->compare(name) == 0;
-  });
+  auto it = findEntry(entries(), name, FILE_OR_DIRECTORY);
 
   if (it == end()) {
     return {it, nullptr};
@@ -560,8 +619,6 @@ std::size_t IFileTree::mergeTree(std::shared_ptr<IFileTree> destination,
   // cannot be assigned to.
   auto &dstEntries = destination->entries(), &srcEntries = source->entries();
 
-  // Note: Since entries are not sorted by name but by type (file/directory)
-  // then name, there is no fast way to check for conflict.
   for (auto& srcEntry : srcEntries) {
 
     // Try to find an exact match (name and type) - This iterator also
@@ -600,12 +657,11 @@ std::size_t IFileTree::mergeTree(std::shared_ptr<IFileTree> destination,
         return MERGE_FAILED;
       }
     } else {
-      // If we did not find a match, the only way to check is to look
-      // through the vector:
-      auto conflictIt = std::find_if(dstEntries.begin(), dstEntries.end(),
-                                     [name = srcEntry->name()](auto const& dstEntry) {
-                                       return dstEntry->compare(name) == 0;
-                                     });
+      // If we did not find a match, there can still be an entry of the other
+      // type with the same name:
+      auto conflictIt =
+          findEntry(dstEntries, srcEntry->name(),
+                    srcEntry->isDir() ? IFileTree::FILE : IFileTree::DIRECTORY);
 
       // Conflict (note that here both entries are of different types, so no need to
       // check if we replace or merge):
@@ -619,7 +675,7 @@ std::size_t IFileTree::mergeTree(std::shared_ptr<IFileTree> destination,
 
         // We need to store the index because the insert() will mess up the
         // iterators:
-        deleteIndex = static_cast<int>(conflictIt - std::begin(dstEntries));
+        deleteIndex = static_cast<int>(conflictIt - std::cbegin(dstEntries));
         if (dstIt < conflictIt) {
           deleteIndex += 1;
         }
@@ -701,11 +757,10 @@ std::shared_ptr<const FileTreeEntry> IFileTree::fetchEntry(QStringList const& pa
       tree = tree->parent().get();
     } else {
       // Find the entry at the current level:
-      auto entryIt = std::find_if(tree->begin(), tree->end(),
-                                  MatchEntryComparator{*it, IFileTree::DIRECTORY});
+      auto entryIt = findEntry(tree->entries(), *it, IFileTree::DIRECTORY);
 
       // Early exists if the entry does not exist or is not a directory:
-      if (entryIt == tree->end()) {
+      if (entryIt == tree->entries().end()) {
         tree = nullptr;
       } else {
         tree = (*entryIt)->astree().get();
@@ -718,10 +773,8 @@ std::shared_ptr<const FileTreeEntry> IFileTree::fetchEntry(QStringList const& pa
   }
 
   // We have the final tree:
-  auto entryIt =
-      std::find_if(tree->begin(), tree->end(), MatchEntryComparator{*it, matchTypes});
-  auto bIt = tree->end();
-  return entryIt == bIt ? nullptr : *entryIt;
+  auto entryIt = findEntry(tree->entries(), *it, matchTypes);
+  return entryIt == tree->entries().end() ? nullptr : *entryIt;
 }
 
 /**
@@ -785,9 +838,7 @@ std::shared_ptr<IFileTree> IFileTree::createTree(QStringList::const_iterator beg
 
       // Check if the entry exists (looking for both files and directories
       // because we don't want to override a file):
-      auto entryIt =
-          std::find_if(tree->begin(), tree->end(),
-                       MatchEntryComparator{*it, IFileTree::FILE_OR_DIRECTORY});
+      auto entryIt = findEntry(tree->entries(), *it, IFileTree::FILE_OR_DIRECTORY);
 
       // Create if it does not:
       if (entryIt == tree->end()) {
@@ -845,7 +896,11 @@ void IFileTree::populate() const
   // Need to check m_Populated again here since the tree can be populated without
   // a call to entries() (e.g., on copy/orphanTree):
   if (!m_Populated) {
-    if (!doPopulate(astree(), m_Entries)) {
+    // Lookups are binary searches, so the entries are checked even if the
+    // implementation claims they are sorted:
+    if (!doPopulate(astree(), m_Entries) ||
+        !std::is_sorted(std::begin(m_Entries), std::end(m_Entries),
+                        FileEntryComparator{})) {
       std::sort(std::begin(m_Entries), std::end(m_Entries), FileEntryComparator{});
     }
     m_Populated = true;
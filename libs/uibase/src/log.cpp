@@ -4,7 +4,10 @@
 #include <iostream>
 
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <locale>
+#include <thread>
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -15,6 +18,8 @@
 #define SPDLOG_WCHAR_FILENAMES 1
 #endif
 
+#include <spdlog/async.h>
+#include <spdlog/async_logger.h>
 #include <spdlog/logger.h>
 #include <spdlog/sinks/base_sink.h>
 #include <spdlog/sinks/basic_file_sink.h>
@@ -133,6 +138,47 @@ private:
   std::atomic<Callback*> m_f;
 };
 
+// only sink of the barrier logger, see Logger::flush(); the pool has a single
+// thread, so once a barrier reaches it everything queued before was written
+class BarrierSink : public spdlog::sinks::sink
+{
+public:
+  void log(const spdlog::details::log_msg&) override
+  {
+    {
+      std::scoped_lock lock(m_mutex);
+      ++m_reached;
+      m_thread = std::this_thread::get_id();
+    }
+    m_cv.notify_all();
+  }
+
+  void flush() override {}
+  void set_pattern(const std::string&) override {}
+  void set_formatter(std::unique_ptr<spdlog::formatter>) override {}
+
+  // whether this is the pool's thread, which would wait for itself
+  bool onPoolThread()
+  {
+    std::scoped_lock lock(m_mutex);
+    return m_thread == std::this_thread::get_id();
+  }
+
+  void wait(std::uint64_t barrier, std::chrono::milliseconds timeout)
+  {
+    std::unique_lock lock(m_mutex);
+    m_cv.wait_for(lock, timeout, [&] {
+      return m_reached >= barrier;
+    });
+  }
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::uint64_t m_reached = 0;
+  std::thread::id m_thread;
+};
+
 File::File() : type(None), maxSize(0), maxFiles(0), dailyHour(0), dailyMinute(0) {}
 
 File File::daily(fs::path file, int hour, int minute)
@@ -197,8 +243,15 @@ spdlog::sink_ptr createFileSink(const File& f)
   }
 }
 
+// messages waiting for the background thread; logging only blocks when this
+// many are pending
+constexpr std::size_t QueueSize = 32768;
+
 Logger::Logger(LoggerConfiguration conf_moved) : m_conf(std::move(conf_moved))
 {
+  // a single thread keeps the messages in order
+  m_pool = std::make_shared<spdlog::details::thread_pool>(QueueSize, 1);
+
   createLogger(m_conf.name);
 
   const auto timeType =
@@ -206,6 +259,7 @@ Logger::Logger(LoggerConfiguration conf_moved) : m_conf(std::move(conf_moved))
 
   m_logger->set_level(toSpdlog(m_conf.maxLevel));
   m_logger->set_pattern(m_conf.pattern, timeType);
+  // sinks are flushed after every message, but on the background thread
   m_logger->flush_on(spdlog::level::trace);
 }
 
@@ -227,10 +281,40 @@ void Logger::setPattern(const std::string& s)
   m_logger->set_pattern(s);
 }
 
+void Logger::flush()
+{
+  auto* barrier = static_cast<BarrierSink*>(m_barrierSink.get());
+
+  // a sink logging an error can't wait for the messages after its own
+  if (barrier->onPoolThread()) {
+    return;
+  }
+
+  // an empty queue doesn't mean written, the last message may still be in a
+  // sink; the flush and the barrier are queued behind the pending messages
+  m_logger->flush();
+
+  std::uint64_t token = 0;
+  {
+    // bounded too, this is also called by the crash handler
+    std::unique_lock lock(m_barrierMutex, std::chrono::seconds(1));
+    if (!lock) {
+      return;
+    }
+    token = ++m_barriers;
+    m_barrier->log(spdlog::level::critical, "");
+  }
+
+  barrier->wait(token, std::chrono::seconds(1));
+}
+
 void Logger::setFile(const File& f)
 {
 
   if (m_file) {
+    // messages still in the queue belong in the old file
+    flush();
+
     auto* ds = static_cast<spdlog::sinks::dist_sink<std::mutex>*>(m_sinks.get());
     ds->remove_sink(m_file);
     m_file = {};
@@ -325,7 +409,13 @@ void Logger::createLogger(const std::string& name)
   addSink(m_console);
 #endif
 
-  m_logger.reset(new spdlog::logger(name, m_sinks));
+  m_logger = std::make_shared<spdlog::async_logger>(
+      name, m_sinks, m_pool, spdlog::async_overflow_policy::block);
+
+  m_barrierSink = std::make_shared<BarrierSink>();
+  m_barrier     = std::make_shared<spdlog::async_logger>(
+      name + ".barrier", m_barrierSink, m_pool, spdlog::async_overflow_policy::block);
+  m_barrier->set_level(spdlog::level::trace);
 }
 
 void Logger::addSink(std::shared_ptr<spdlog::sinks::sink> sink)
@@ -377,11 +467,21 @@ Logger& getDefault()
   return *g_default;
 }
 
+bool hasDefault()
+{
+  return g_default != nullptr;
+}
+
 }  // namespace MOBase::log
 
 namespace MOBase::log::details
 {
 
+bool shouldLog(const spdlog::logger& lg, Levels lv) noexcept
+{
+  return lg.should_log(toSpdlog(lv));
+}
+
 void doLogImpl(spdlog::logger& lg, Levels lv, const std::string& s) noexcept
 {
   try {
@@ -0,0 +1,98 @@
+#include <uibase/memoryusage.h>
+#include <uibase/tracing.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+namespace MOBase::memory
+{
+
+namespace
+{
+
+struct Registry
+{
+  std::mutex mutex;
+  std::map<QString, Usage> reported;
+  std::vector<const Counter*> counters;
+};
+
+Registry& registry()
+{
+  // never destroyed, counters are statics of other libraries that can be torn
+  // down after this one
+  static Registry* r = new Registry;
+  return *r;
+}
+
+QString traceName(const QString& subsystem)
+{
+  return QString("memory: %1").arg(subsystem);
+}
+
+}  // namespace
+
+void report(const QString& subsystem, qint64 bytes, qint64 items)
+{
+  {
+    auto& r = registry();
+    std::scoped_lock lock(r.mutex);
+    r.reported[subsystem] = {subsystem, bytes, items};
+  }
+
+  tracing::counter(traceName(subsystem), bytes);
+}
+
+Counter::Counter(QString subsystem) : m_subsystem(std::move(subsystem))
+{
+  auto& r = registry();
+  std::scoped_lock lock(r.mutex);
+  r.counters.push_back(this);
+}
+
+Counter::~Counter()
+{
+  auto& r = registry();
+  std::scoped_lock lock(r.mutex);
+  std::erase(r.counters, this);
+}
+
+Usage Counter::usage() const
+{
+  return {m_subsystem, m_bytes.load(std::memory_order_relaxed),
+          m_items.load(std::memory_order_relaxed)};
+}
+
+std::vector<Usage> usages()
+{
+  std::vector<Usage> v;
+
+  {
+    auto& r = registry();
+    std::scoped_lock lock(r.mutex);
+
+    for (const auto& [subsystem, usage] : r.reported) {
+      v.push_back(usage);
+    }
+
+    for (const auto* counter : r.counters) {
+      v.push_back(counter->usage());
+    }
+  }
+
+  std::sort(v.begin(), v.end(), [](const Usage& a, const Usage& b) {
+    return a.subsystem < b.subsystem;
+  });
+
+  return v;
+}
+
+void trace()
+{
+  for (const auto& u : usages()) {
+    tracing::counter(traceName(u.subsystem), u.bytes);
+  }
+}
+
+}  // namespace MOBase::memory
@@ -81,4 +81,25 @@ DirectWriteFile* SafeWriteFile::operator->()
 
 #endif
 
+bool writeFileIfDifferent(const QString& fileName, const QByteArray& data)
+{
+  {
+    QFile existing(fileName);
+    if (existing.exists() && existing.size() == data.size() &&
+        existing.open(QIODeviceBase::ReadOnly) && existing.readAll() == data) {
+      return false;
+    }
+  }
+
+  SafeWriteFile file(fileName);
+
+  if (file->write(data) != data.size() || !file->commit()) {
+    log::error("failed to write '{}', error {} ('{}')", fileName, file->error(),
+               file->errorString());
+    return false;
+  }
+
+  return true;
+}
+
 }  // namespace MOBase
@@ -0,0 +1,175 @@
+#include <uibase/tracing.h>
+
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace MOBase::tracing
+{
+
+namespace
+{
+
+constexpr std::size_t MaxEvents = 500'000;
+
+// times are relative to when the library was loaded, which is before main()
+const Clock::time_point Origin = Clock::now();
+
+struct Event
+{
+  // 'X' for spans, 'C' for counters, as in the trace format
+  char phase;
+  QString name;
+  int thread;
+  qint64 start;
+
+  // duration of spans in microseconds, value of counters
+  qint64 value;
+};
+
+struct Recorder
+{
+  std::mutex mutex;
+  std::vector<Event> events;
+  std::map<int, QString> threads;
+  std::size_t dropped = 0;
+};
+
+Recorder& recorder()
+{
+  // never destroyed, spans can end while statics are torn down
+  static Recorder* r = new Recorder;
+  return *r;
+}
+
+qint64 microseconds(Clock::time_point t)
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(t - Origin).count();
+}
+
+// small numbers are easier to read in the viewers than native thread ids
+//
+int currentThread()
+{
+  static std::atomic<int> next = 1;
+  thread_local const int number = next++;
+  return number;
+}
+
+QString currentThreadName(int number)
+{
+  QThread* thread = QThread::currentThread();
+
+  if (auto* app = QCoreApplication::instance(); app && app->thread() == thread) {
+    return "main";
+  }
+
+  if (thread && !thread->objectName().isEmpty()) {
+    return thread->objectName();
+  }
+
+  return QString("thread %1").arg(number);
+}
+
+void add(Event e)
+{
+  thread_local bool named = false;
+
+  auto& r = recorder();
+  std::scoped_lock lock(r.mutex);
+
+  if (!named) {
+    r.threads.emplace(e.thread, currentThreadName(e.thread));
+    named = true;
+  }
+
+  if (r.events.size() >= MaxEvents) {
+    ++r.dropped;
+    return;
+  }
+
+  r.events.push_back(std::move(e));
+}
+
+}  // namespace
+
+void span(const QString& name, Clock::time_point start, Clock::time_point end)
+{
+  const qint64 s = microseconds(start);
+  add({'X', name, currentThread(), s, microseconds(end) - s});
+}
+
+void counter(const QString& name, qint64 value)
+{
+  add({'C', name, currentThread(), microseconds(Clock::now()), value});
+}
+
+QByteArray chromeTrace()
+{
+  const qint64 pid = QCoreApplication::applicationPid();
+
+  std::vector<Event> events;
+  std::map<int, QString> threads;
+  std::size_t dropped = 0;
+
+  {
+    auto& r = recorder();
+    std::scoped_lock lock(r.mutex);
+    events  = r.events;
+    threads = r.threads;
+    dropped = r.dropped;
+  }
+
+  QJsonArray traceEvents;
+
+  for (const auto& [number, name] : threads) {
+    traceEvents.append(QJsonObject{{"ph", "M"},
+                                   {"name", "thread_name"},
+                                   {"pid", pid},
+                                   {"tid", number},
+                                   {"args", QJsonObject{{"name", name}}}});
+  }
+
+  for (const auto& e : events) {
+    QJsonObject o{{"ph", QString(QChar(e.phase))},
+                  {"name", e.name},
+                  {"pid", pid},
+                  {"tid", e.thread},
+                  {"ts", e.start}};
+
+    if (e.phase == 'X') {
+      o["dur"] = e.value;
+    } else {
+      o["args"] = QJsonObject{{"value", e.value}};
+    }
+
+    traceEvents.append(o);
+  }
+
+  QJsonObject root{{"traceEvents", traceEvents}, {"displayTimeUnit", "ms"}};
+
+  if (dropped > 0) {
+    root["otherData"] =
+        QJsonObject{{"droppedEvents", static_cast<qint64>(dropped)}};
+  }
+
+  return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+void clear()
+{
+  auto& r = recorder();
+  std::scoped_lock lock(r.mutex);
+
+  r.events.clear();
+  r.dropped = 0;
+}
+
+}  // namespace MOBase::tracing
@@ -21,6 +21,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <uibase/utility.h>
 #include <uibase/log.h>
 #include <uibase/report.h>
+#include <uibase/tracing.h>
 #include <QApplication>
 #include <QBuffer>
 #include <QCollator>
@@ -1268,6 +1269,8 @@ void TimeThis::stop()
     log::debug("timing: {} {} ms", m_what, d);
   }
 
+  tracing::span(m_what.isEmpty() ? QStringLiteral("TimeThis") : m_what, m_start, end);
+
   m_running = false;
 }
 
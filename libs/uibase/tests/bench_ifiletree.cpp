@@ -0,0 +1,218 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <vector>
+
+#include <uibase/ifiletree.h>
+
+using namespace MOBase;
+
+/**
+ * Tree that only contains what is added to it, the way installers build up
+ * the trees they hand to each other (e.g. with createOrphanTree()).
+ */
+struct MemoryTree : public IFileTree
+{
+  static std::shared_ptr<IFileTree> makeTree()
+  {
+    return std::shared_ptr<MemoryTree>(new MemoryTree(nullptr, ""));
+  }
+
+protected:
+  MemoryTree(std::shared_ptr<const IFileTree> parent, QString name)
+      : FileTreeEntry(parent, name), IFileTree()
+  {}
+
+  std::shared_ptr<IFileTree> makeDirectory(std::shared_ptr<const IFileTree> parent,
+                                           QString name) const override
+  {
+    return std::shared_ptr<MemoryTree>(new MemoryTree(parent, name));
+  }
+
+  bool doPopulate(std::shared_ptr<const IFileTree>,
+                  std::vector<std::shared_ptr<FileTreeEntry>>&) const override
+  {
+    return true;
+  }
+
+  std::shared_ptr<IFileTree> doClone() const override
+  {
+    return std::shared_ptr<MemoryTree>(new MemoryTree(nullptr, name()));
+  }
+};
+
+/**
+ * @brief Create the paths of a mod with the given number of files.
+ *
+ * Files are spread over the usual top-level directories with three levels of
+ * eight subdirectories below them, so directories hold a few hundred entries
+ * at most like in actual mods.
+ *
+ * @param count Number of files.
+ * @param prefix Prefix of every path, e.g. "Data/".
+ * @param offset Index of the first file, paths of different offsets only overlap
+ *     where the indices do.
+ */
+static std::vector<QString> makePaths(std::size_t count, QString const& prefix = "",
+                                      std::size_t offset = 0)
+{
+  static const std::array<QString, 5> tops{"meshes", "textures", "sound", "scripts",
+                                           "interface"};
+  static const std::array<QString, 4> extensions{"nif", "dds", "wav", "pex"};
+
+  std::vector<QString> paths;
+  paths.reserve(count);
+
+  for (std::size_t i = offset; i < offset + count; ++i) {
+    const auto top = i % tops.size();
+    paths.push_back(QString("%1%2/d%3/d%4/d%5/file%6.%7")
+                        .arg(prefix)
+                        .arg(tops[top])
+                        .arg((i / 5) % 8)
+                        .arg((i / 40) % 8)
+                        .arg((i / 320) % 8)
+                        .arg(i)
+                        .arg(extensions[top % extensions.size()]));
+  }
+
+  return paths;
+}
+
+static std::shared_ptr<IFileTree> makeTree(std::vector<QString> const& paths)
+{
+  auto tree = MemoryTree::makeTree();
+  for (auto& path : paths) {
+    tree->addFile(path);
+  }
+  return tree;
+}
+
+static void BM_IFileTree_addFile(benchmark::State& state)
+{
+  const auto paths = makePaths(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(makeTree(paths));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_IFileTree_find(benchmark::State& state)
+{
+  const auto paths = makePaths(state.range(0));
+  const auto tree  = makeTree(paths);
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(tree->find(paths[i++ % paths.size()]));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_IFileTree_findMissing(benchmark::State& state)
+{
+  const auto tree  = makeTree(makePaths(state.range(0)));
+  const auto paths = makePaths(state.range(0), "", state.range(0));
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(tree->find(paths[i++ % paths.size()]));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_IFileTree_walk(benchmark::State& state)
+{
+  const auto tree = makeTree(makePaths(state.range(0)));
+
+  for (auto _ : state) {
+    std::size_t count = 0;
+    tree->walk([&count](QString const&, std::shared_ptr<const FileTreeEntry>) {
+      ++count;
+      return IFileTree::WalkReturn::CONTINUE;
+    });
+    benchmark::DoNotOptimize(count);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// merges a tree of which half the files overlap with the destination
+static void BM_IFileTree_merge(benchmark::State& state)
+{
+  const auto count       = static_cast<std::size_t>(state.range(0));
+  const auto destination = makePaths(count);
+  const auto source      = makePaths(count, "", count / 2);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto tree  = makeTree(destination);
+    auto other = makeTree(source);
+    IFileTree::OverwritesType overwrites;
+    state.ResumeTiming();
+
+    benchmark::DoNotOptimize(tree->merge(other, &overwrites));
+
+    state.PauseTiming();
+    tree.reset();
+    other.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// moves the content of a "Data" directory to the root, like the installers do
+// for archives with an extra level
+static void BM_IFileTree_move(benchmark::State& state)
+{
+  const auto paths = makePaths(state.range(0), "Data/");
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto tree = makeTree(paths);
+    auto data = tree->findDirectory("Data");
+    std::vector<std::shared_ptr<FileTreeEntry>> entries(data->begin(), data->end());
+    state.ResumeTiming();
+
+    for (auto& entry : entries) {
+      tree->move(entry, "", IFileTree::InsertPolicy::MERGE);
+    }
+    benchmark::DoNotOptimize(tree);
+
+    state.PauseTiming();
+    tree.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// moves the meshes and textures into an orphan tree; like the other benchmarks
+// that modify a tree, building and destroying the trees isn't timed
+static void BM_IFileTree_createOrphanTree(benchmark::State& state)
+{
+  const auto paths = makePaths(state.range(0));
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto tree = makeTree(paths);
+    state.ResumeTiming();
+
+    auto orphan = tree->createOrphanTree();
+    for (auto name : {"meshes", "textures"}) {
+      orphan->move(tree->find(name), "", IFileTree::InsertPolicy::MERGE);
+    }
+    benchmark::DoNotOptimize(orphan);
+
+    state.PauseTiming();
+    tree.reset();
+    orphan.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_IFileTree_addFile)->RangeMultiplier(10)->Range(1000, 100000);
+BENCHMARK(BM_IFileTree_find)->RangeMultiplier(10)->Range(1000, 100000);
+BENCHMARK(BM_IFileTree_findMissing)->RangeMultiplier(10)->Range(1000, 100000);
+BENCHMARK(BM_IFileTree_walk)->RangeMultiplier(10)->Range(1000, 100000);
+BENCHMARK(BM_IFileTree_merge)->RangeMultiplier(10)->Range(1000, 100000);
+BENCHMARK(BM_IFileTree_move)->RangeMultiplier(10)->Range(1000, 100000);
+BENCHMARK(BM_IFileTree_createOrphanTree)->RangeMultiplier(10)->Range(1000, 100000);
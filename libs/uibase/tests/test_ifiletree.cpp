@@ -689,6 +689,33 @@ TEST(IFileTreeTest, TreeMoveAndCopyOperations)
           << "Entry '" << (a1 + p) << "' and '" << (a2 + p) << "' should be different.";
     }
   }
+
+  {
+    // Renaming in place must keep the entries sorted, lookups depend on it:
+    auto tree1 = FileListTree::makeTree({{"a/b.txt", false},
+                                         {"a/d.txt", false},
+                                         {"a/f.txt", false},
+                                         {"a/h.txt", false}});
+    auto a     = tree1->findDirectory("a");
+
+    EXPECT_TRUE(a->move(a->find("b.txt"), "z.txt"));
+    EXPECT_TRUE(a->move(a->find("h.txt"), "A.txt"));
+    EXPECT_FALSE(a->move(a->find("d.txt"), "f.txt"));
+    EXPECT_TRUE(a->move(a->find("d.txt"), "f.txt", IFileTree::InsertPolicy::REPLACE));
+
+    assertTreeEquals(tree1, {
+                                {"a", true},
+                                {"a/a.txt", false},
+                                {"a/f.txt", false},
+                                {"a/z.txt", false},
+                            });
+
+    std::vector<QString> names;
+    for (auto entry : *a) {
+      names.push_back(entry->name());
+    }
+    EXPECT_EQ(names, (std::vector<QString>{"A.txt", "f.txt", "z.txt"}));
+  }
 }
 
 TEST(IFileTreeTest, TreeMergeOperations)
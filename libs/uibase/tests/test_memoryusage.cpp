@@ -0,0 +1,92 @@
+#pragma warning(push)
+#pragma warning(disable : 4668)
+#include <gtest/gtest.h>
+#pragma warning(pop)
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <map>
+#include <optional>
+
+#include <uibase/memoryusage.h>
+#include <uibase/tracing.h>
+
+using namespace MOBase;
+
+namespace
+{
+std::optional<memory::Usage> find(const QString& subsystem)
+{
+  for (const auto& u : memory::usages()) {
+    if (u.subsystem == subsystem) {
+      return u;
+    }
+  }
+
+  return {};
+}
+}  // namespace
+
+TEST(MemoryUsageTest, ReportReplaces)
+{
+  tracing::clear();
+
+  memory::report("test report", 100, 2);
+  memory::report("test report", 300, 5);
+
+  const auto u = find("test report");
+  ASSERT_TRUE(u.has_value());
+  EXPECT_EQ(300, u->bytes);
+  EXPECT_EQ(5, u->items);
+
+  // every report is a counter in the trace
+  const auto doc = QJsonDocument::fromJson(tracing::chromeTrace());
+  int counters   = 0;
+  for (const auto& v : doc.object()["traceEvents"].toArray()) {
+    const auto e = v.toObject();
+    if (e["ph"].toString() == "C" && e["name"].toString() == "memory: test report") {
+      ++counters;
+    }
+  }
+  EXPECT_EQ(2, counters);
+}
+
+TEST(MemoryUsageTest, CountersRegister)
+{
+  {
+    memory::Counter counter("test counter");
+    counter.add(64, 1);
+    counter.add(64, 1);
+    counter.add(-32, 0);
+
+    const auto u = find("test counter");
+    ASSERT_TRUE(u.has_value());
+    EXPECT_EQ(96, u->bytes);
+    EXPECT_EQ(2, u->items);
+
+    counter.set(10, 1);
+    EXPECT_EQ(10, find("test counter")->bytes);
+  }
+
+  EXPECT_FALSE(find("test counter").has_value());
+}
+
+TEST(MemoryUsageTest, Estimates)
+{
+  EXPECT_EQ(0u, memory::heapBytes(std::string("short")));
+  EXPECT_GE(memory::heapBytes(std::string(100, 'a')), 101u);
+  EXPECT_GE(memory::heapBytes(std::wstring(100, L'a')), 101 * sizeof(wchar_t));
+
+  EXPECT_EQ(0u, memory::heapBytes(QString()));
+  EXPECT_GE(memory::heapBytes(QString(10, 'a')), 11 * sizeof(QChar));
+
+  std::vector<int> v;
+  v.reserve(10);
+  EXPECT_EQ(10 * sizeof(int), memory::heapBytes(v));
+
+  const std::map<int, int> m{{1, 1}, {2, 2}};
+  EXPECT_EQ(2 * (memory::TreeNodeOverhead + sizeof(std::pair<const int, int>)),
+            memory::treeBytes(m));
+}
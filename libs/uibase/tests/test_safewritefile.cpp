@@ -0,0 +1,48 @@
+#pragma warning(push)
+#pragma warning(disable : 4668)
+#include <gtest/gtest.h>
+#pragma warning(pop)
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include <uibase/safewritefile.h>
+
+using namespace MOBase;
+
+namespace
+{
+QByteArray readFile(const QString& path)
+{
+  QFile file(path);
+  if (!file.open(QIODeviceBase::ReadOnly)) {
+    return {};
+  }
+  return file.readAll();
+}
+}  // namespace
+
+TEST(SafeWriteFileTest, WriteFileIfDifferent)
+{
+  QTemporaryDir dir;
+  ASSERT_TRUE(dir.isValid());
+
+  const QString path = dir.filePath("plugins.txt");
+
+  // no file yet
+  ASSERT_TRUE(writeFileIfDifferent(path, "a.esp\r\nb.esp\r\n"));
+  ASSERT_EQ("a.esp\r\nb.esp\r\n", readFile(path));
+
+  // same content, left alone
+  ASSERT_FALSE(writeFileIfDifferent(path, "a.esp\r\nb.esp\r\n"));
+  ASSERT_EQ("a.esp\r\nb.esp\r\n", readFile(path));
+
+  // same size, different content
+  ASSERT_TRUE(writeFileIfDifferent(path, "b.esp\r\na.esp\r\n"));
+  ASSERT_EQ("b.esp\r\na.esp\r\n", readFile(path));
+
+  // shorter
+  ASSERT_TRUE(writeFileIfDifferent(path, "b.esp\r\n"));
+  ASSERT_EQ("b.esp\r\n", readFile(path));
+}
@@ -0,0 +1,95 @@
+#pragma warning(push)
+#pragma warning(disable : 4668)
+#include <gtest/gtest.h>
+#pragma warning(pop)
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <thread>
+
+#include <uibase/tracing.h>
+#include <uibase/utility.h>
+
+using namespace MOBase;
+
+namespace
+{
+// the events that aren't thread names
+std::vector<QJsonObject> recordedEvents()
+{
+  const auto doc = QJsonDocument::fromJson(tracing::chromeTrace());
+
+  std::vector<QJsonObject> events;
+  for (const auto& v : doc.object()["traceEvents"].toArray()) {
+    if (v.toObject()["ph"].toString() != "M") {
+      events.push_back(v.toObject());
+    }
+  }
+
+  return events;
+}
+}  // namespace
+
+TEST(TracingTest, SpansAndCounters)
+{
+  tracing::clear();
+
+  const auto start = tracing::Clock::now();
+  tracing::span("outer", start, start + std::chrono::milliseconds(5));
+  tracing::counter("mods", 42);
+
+  const auto events = recordedEvents();
+  ASSERT_EQ(2u, events.size());
+
+  EXPECT_EQ("X", events[0]["ph"].toString());
+  EXPECT_EQ("outer", events[0]["name"].toString());
+  EXPECT_EQ(5000, events[0]["dur"].toInteger());
+
+  EXPECT_EQ("C", events[1]["ph"].toString());
+  EXPECT_EQ("mods", events[1]["name"].toString());
+  EXPECT_EQ(42, events[1]["args"].toObject()["value"].toInteger());
+}
+
+TEST(TracingTest, TimeThisNests)
+{
+  tracing::clear();
+
+  {
+    TimeThis outer("outer");
+    TimeThis inner("inner");
+  }
+
+  // inner ends first
+  const auto events = recordedEvents();
+  ASSERT_EQ(2u, events.size());
+  EXPECT_EQ("inner", events[0]["name"].toString());
+  EXPECT_EQ("outer", events[1]["name"].toString());
+
+  const auto begins = [](const QJsonObject& e) {
+    return e["ts"].toInteger();
+  };
+  const auto ends = [&](const QJsonObject& e) {
+    return begins(e) + e["dur"].toInteger();
+  };
+
+  EXPECT_LE(begins(events[1]), begins(events[0]));
+  EXPECT_GE(ends(events[1]), ends(events[0]));
+}
+
+TEST(TracingTest, ThreadsAreSeparate)
+{
+  tracing::clear();
+
+  const auto now = tracing::Clock::now();
+  tracing::span("here", now, now);
+
+  std::thread([&] {
+    tracing::span("there", now, now);
+  }).join();
+
+  const auto events = recordedEvents();
+  ASSERT_EQ(2u, events.size());
+  EXPECT_NE(events[0]["tid"].toInteger(), events[1]["tid"].toInteger());
+}
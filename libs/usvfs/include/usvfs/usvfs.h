@@ -85,6 +85,28 @@ extern "C"
                                                         LPCWSTR destination,
                                                         unsigned int flags);
 
+  /**
+   * a link for usvfsVirtualLinkMany(), linked like usvfsVirtualLinkDirectoryStatic()
+   * if `directory` is set and like usvfsVirtualLinkFile() otherwise
+   */
+  struct usvfsVirtualLink
+  {
+    LPCWSTR source;
+    LPCWSTR destination;
+    unsigned int flags;
+    BOOL directory;
+  };
+
+  /**
+   * link all the given files and directories, in order. Everything is listed before
+   * the virtual file system is changed, so the shared memory grows once and the
+   * parameters are only read and updated once instead of for every file.
+   * @return FALSE if any of the links failed, GetLastError() is the error of the
+   * last one that did
+   */
+  DLLEXPORT BOOL WINAPI usvfsVirtualLinkMany(const usvfsVirtualLink* links,
+                                             size_t count);
+
   /**
    * connect to a virtual filesystem as a controller, without hooking the calling
    * process. Please note that you can only be connected to one vfs, so this will
@@ -52,6 +52,13 @@ namespace usvfs::shared
 // names until one exists that is not outdated; if it can't find the block
 // (shouldn't happen), it will just create a new one
 //
+//
+// every change to the tree made through the container increases a generation
+// counter kept next to the tree in shared memory, which lets processes cache
+// what they looked up in the tree for as long as the generation stays the same;
+// a new block starts one above the generation of the block it was copied from,
+// so the generation never goes back for processes following the blocks
+//
 template <typename TreeT>
 class TreeContainer
 {
@@ -147,7 +154,27 @@ public:
    */
   std::string shmName() const { return m_SHMName; }
 
-  void clear() { m_TreeMeta->tree->clear(); }
+  void clear()
+  {
+    get()->clear();
+    touch();
+  }
+
+  /**
+   * @return generation of the tree, which changes every time the tree does in any
+   * process
+   */
+  std::uint64_t generation() const
+  {
+    get();
+    return m_TreeMeta->generation.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief increases the generation of the tree, must be called after changing nodes
+   * of the tree directly instead of through the container (e.g. removeFromTree())
+   */
+  void touch() const { m_TreeMeta->generation.fetch_add(1, std::memory_order_acq_rel); }
 
   /**
    * @brief add a new file to the tree
@@ -167,7 +194,10 @@ public:
       DecomposablePath dp(name.string());
 
       try {
-        return addNode(m_TreeMeta->tree.get(), dp, data, overwrite, flags, allocator());
+        auto node =
+            addNode(m_TreeMeta->tree.get(), dp, data, overwrite, flags, allocator());
+        touch();
+        return node;
       } catch (const bi::bad_alloc&) {
       }
 
@@ -193,8 +223,10 @@ public:
       DecomposablePath dp(name.string());
 
       try {
-        return addNode(m_TreeMeta->tree.get(), dp, data, overwrite,
-                       flags | FLAG_DIRECTORY, allocator());
+        auto node = addNode(m_TreeMeta->tree.get(), dp, data, overwrite,
+                            flags | FLAG_DIRECTORY, allocator());
+        touch();
+        return node;
       } catch (const bi::bad_alloc&) {
       }
 
@@ -202,6 +234,28 @@ public:
     }
   }
 
+  /**
+   * @brief makes sure the shared memory has room for at least `bytes` more, so adding
+   * a lot of nodes at once moves the tree to a larger block once instead of going
+   * through a series of blocks, copying the tree every time
+   */
+  void reserve(size_t bytes)
+  {
+    get();
+
+    if (m_SHM->get_free_memory() >= bytes) {
+      return;
+    }
+
+    const size_t used = m_SHM->get_size() - m_SHM->get_free_memory();
+    spdlog::get("usvfs")->info("reserving {0} in tree {1}", byte_string(bytes),
+                               m_SHMName);
+
+    std::vector<std::string> deadSHMNames;
+    createNewBlock(deadSHMNames, used + bytes);
+    destroyBlocks(deadSHMNames);
+  }
+
   void getBuffer(void*& buffer, size_t& bufferSize) const
   {
     buffer     = m_SHM->get_address();
@@ -215,13 +269,17 @@ private:
         : tree(segmentManager->construct<TreeT>(bi::anonymous_instance)(
               "", true, TreeT::NodePtrT(), data, VoidAllocatorT(segmentManager))),
           referenceCount(0),  // reference count only set on top level node
-          outdated(false)
+          outdated(false), generation(0)
     {}
 
     OffsetPtrT<TreeT> tree;
     long referenceCount;
     bool outdated;
     bi::interprocess_mutex mutex;
+
+    // shared between processes, so it has to work without a lock
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+    std::atomic<std::uint64_t> generation;
   };
 
   std::string m_SHMName;
@@ -411,6 +469,7 @@ private:
       }
       if (m_TreeMeta != nullptr) {
         copyTree(res.first->tree.get(), m_TreeMeta->tree.get());
+        res.first->generation = m_TreeMeta->generation + 1;
       }
     }
 
@@ -506,9 +565,15 @@ private:
     // just create a new one
 
     createNewBlock(deadSHMNames);
+    destroyBlocks(deadSHMNames);
+  }
 
-    // remove the old shared memory blocks; this can be recursive and call
-    // reassign() again, but it's safe at this point
+  // removes the old shared memory blocks; this can be recursive and call
+  // reassign() again, so it must only be called once `m_TreeMeta` points to a
+  // valid block
+  //
+  void destroyBlocks(const std::vector<std::string>& deadSHMNames)
+  {
     for (const std::string& name : deadSHMNames) {
       spdlog::get("usvfs")->info("destroying {0}", name);
       bi::shared_memory_object::remove(name.c_str());
@@ -587,9 +652,10 @@ private:
     return false;
   }
 
-  // creates a new block and activates it, throws on failure
+  // creates a new block and activates it, throws on failure; the block is
+  // twice the size of the current one, or more if needed to hold `minimumSize`
   //
-  void createNewBlock(std::vector<std::string>& deadSHMNames)
+  void createNewBlock(std::vector<std::string>& deadSHMNames, size_t minimumSize = 0)
   {
     // the current block is now considered stale, so make sure other processes
     // are aware of it and try to find the new block
@@ -603,7 +669,12 @@ private:
     const std::string nextName = followupName(m_SHMName);
     spdlog::get("usvfs")->info("creating {0}", nextName);
 
-    SharedMemoryT* shm = createSHM(nextName, m_SHM->get_size() * 2);
+    size_t size = m_SHM->get_size() * 2;
+    while (size < minimumSize) {
+      size *= 2;
+    }
+
+    SharedMemoryT* shm = createSHM(nextName, size);
 
     if (!shm) {
       // this shouldn't happen
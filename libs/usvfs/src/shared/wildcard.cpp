@@ -24,34 +24,41 @@ along with usvfs. If not, see <http://www.gnu.org/licenses/>.
 
 static bool IsInnerMatch(LPCWSTR pszString, LPCWSTR pszMatch)
 {
-  while (*pszMatch != L'\0') {
-    if ((*pszMatch == L'?') || (*pszMatch == L'>')) {
-      if (!*pszString) {
-        // ? must match exactly one character
-        return false;
-      }
+  // this runs for every entry of every directory listing that has a mask, so
+  // it doesn't recurse: when a character doesn't match, only the last * seen
+  // needs to eat one more character, what came before it already matched
+  LPCWSTR starMatch  = nullptr;
+  LPCWSTR starString = nullptr;
 
+  while (*pszString != L'\0') {
+    if ((*pszMatch == L'?') || (*pszMatch == L'>')) {
+      // ? must match exactly one character
       ++pszString;
       ++pszMatch;
     } else if ((*pszMatch == L'*') || (*pszMatch == L'<')) {
-      if (IsInnerMatch(pszString, pszMatch + 1)) {
-        // * may match empty string or we may have matched something already
-        return true;
-      }
-
-      return *pszString && IsInnerMatch(pszString + 1, pszMatch);
-
-      // the rest of the string can't be matched
+      // * may match empty string first
+      starMatch  = ++pszMatch;
+      starString = pszString;
+    } else if ((*pszMatch != L'\0') &&
+               (CharUpperW(MAKEINTRESOURCEW(MAKELONG(*pszString, 0))) ==
+                CharUpperW(MAKEINTRESOURCEW(MAKELONG(*pszMatch, 0))))) {
+      // regular chars compare
+      ++pszString;
+      ++pszMatch;
+    } else if (starMatch != nullptr) {
+      pszMatch  = starMatch;
+      pszString = ++starString;
     } else {
-      if (CharUpperW(MAKEINTRESOURCEW(MAKELONG(*pszString++, 0))) !=
-          CharUpperW(MAKEINTRESOURCEW(MAKELONG(*pszMatch++, 0)))) {
-        // regular chars compare
-        return false;
-      }
+      // the rest of the string can't be matched
+      return false;
     }
   }
 
-  return !*pszString && !*pszMatch;
+  while ((*pszMatch == L'*') || (*pszMatch == L'<')) {
+    ++pszMatch;
+  }
+
+  return !*pszMatch;
 }
 
 static LPCSTR InnerMatch(LPCSTR pszString, LPCSTR pszMatch)
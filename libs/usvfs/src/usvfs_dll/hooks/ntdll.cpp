@@ -1,6 +1,7 @@
 #include "ntdll.h"
 
 #include <mutex>
+#include <optional>
 #include <queue>
 #include <set>
 
@@ -119,6 +120,55 @@ private:
 
 HandleTracker ntdllHandleTracker;
 
+// results of applyReroute() for the paths the hooks are called with, so the
+// redirection tree in shared memory isn't walked again every time a game opens
+// or queries the same file; they're only valid for the generation of the tree
+// they were looked up in, any change to the tree in any process drops them
+class RerouteCache
+{
+public:
+  // the reroute path, empty if the path isn't redirected
+  using info_type = std::optional<std::wstring>;
+
+  // the cache starts over past this, games going through a lot of different
+  // paths shouldn't grow it forever
+  static constexpr std::size_t MaxEntries = 64 * 1024;
+
+  bool lookup(const std::wstring& path, std::uint64_t generation,
+              info_type& target) const
+  {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    if (generation != m_generation) {
+      return false;
+    }
+
+    auto find = m_map.find(path);
+    if (find == m_map.end()) {
+      return false;
+    }
+
+    target = find->second;
+    return true;
+  }
+
+  void insert(const std::wstring& path, std::uint64_t generation, info_type target)
+  {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    if (generation != m_generation || m_map.size() >= MaxEntries) {
+      m_map.clear();
+      m_generation = generation;
+    }
+    m_map[path] = std::move(target);
+  }
+
+private:
+  mutable std::shared_mutex m_mutex;
+  std::uint64_t m_generation = 0;
+  std::unordered_map<std::wstring, info_type> m_map;
+};
+
+RerouteCache ntdllRerouteCache;
+
 UnicodeString CreateUnicodeString(const OBJECT_ATTRIBUTES* objectAttributes)
 {
   UnicodeString result = ntdllHandleTracker.lookup(objectAttributes->RootDirectory);
@@ -160,9 +210,23 @@ RedirectionInfo applyReroute(const usvfs::HookContext::ConstPtr& context,
   result.redirected = false;
 
   if (callContext.active()) {
+    // the generation is read before the lookup, a change to the tree while
+    // looking up only drops the result later
+    const std::wstring cachePath(static_cast<LPCWSTR>(result.path) + 4);
+    const auto generation = context->redirectionTable().generation();
+
+    RerouteCache::info_type cached;
+    if (ntdllRerouteCache.lookup(cachePath, generation, cached)) {
+      if (cached) {
+        result.path       = *cached;
+        result.redirected = true;
+      }
+      return result;
+    }
+
     // see if the file exists in the redirection tree
-    std::string lookupPath = ush::string_cast<std::string>(
-        static_cast<LPCWSTR>(result.path) + 4, ush::CodePage::UTF8);
+    std::string lookupPath =
+        ush::string_cast<std::string>(cachePath.c_str(), ush::CodePage::UTF8);
     auto node = context->redirectionTable()->findNode(lookupPath.c_str());
     // if so, replace the file name with the path to the mapped file
     if ((node.get() != nullptr) &&
@@ -185,6 +249,12 @@ RedirectionInfo applyReroute(const usvfs::HookContext::ConstPtr& context,
       result.path       = LR"(\??\)" + reroutePath;
       result.redirected = true;
     }
+
+    RerouteCache::info_type target;
+    if (result.redirected) {
+      target = static_cast<LPCWSTR>(result.path);
+    }
+    ntdllRerouteCache.insert(cachePath, generation, std::move(target));
   }
   return result;
 }
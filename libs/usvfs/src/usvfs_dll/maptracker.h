@@ -186,9 +186,10 @@ public:
       addToDelete = true;
 
     if (wasRerouted()) {
-      if (m_FileNode.get())
+      if (m_FileNode.get()) {
         m_FileNode->removeFromTree();
-      else
+        readContext->redirectionTable().touch();
+      } else
         spdlog::get("usvfs")->warn("Node not removed: {}",
                                    shared::string_cast<std::string>(m_FileName));
 
@@ -570,8 +570,8 @@ BOOL WINAPI usvfsGetVFSProcessList2(size_t* count, DWORD** buffer)
 
 void WINAPI usvfsClearVirtualMappings()
 {
-  context->redirectionTable()->clear();
-  context->inverseTable()->clear();
+  context->redirectionTable().clear();
+  context->inverseTable().clear();
 }
 
 /// ensure the specified path exists. If a physical path of the same name
@@ -649,50 +649,252 @@ static bool fileNameInSkipDirectories(const std::string& directoryNameUtf8,
   return false;
 }
 
-BOOL WINAPI usvfsVirtualLinkFile(LPCWSTR source, LPCWSTR destination,
-                                 unsigned int flags)
+/**
+ * @brief extract the flags relevant to redirection
+ */
+static usvfs::shared::TreeFlags convertRedirectionFlags(unsigned int flags)
 {
-  // TODO difference between winapi and ntdll api regarding system32 vs syswow64
-  // (and other windows links?)
-  try {
-    if (!assertPathExists(context->redirectionTable(), destination)) {
-      SetLastError(ERROR_PATH_NOT_FOUND);
-      return FALSE;
+  usvfs::shared::TreeFlags result = 0;
+  if (flags & LINKFLAG_CREATETARGET) {
+    result |= usvfs::shared::FLAG_CREATETARGET;
+  }
+  return result;
+}
+
+namespace
+{
+
+// a node to add to the redirection tree; links are listed in process memory
+// first and added to the tree afterwards, so the shared memory is grown once
+// for all of them instead of doubling and copying the tree over and over
+struct PendingLink
+{
+  // links given by the caller check that their parent directory exists when
+  // they're added, the content of a linked directory is below a directory that
+  // was just added
+  bool topLevel = false;
+
+  bool directory = false;
+  bfs::path destination;
+  std::string sourceU8;
+  usvfs::shared::TreeFlags flags = 0;
+  bool overwrite                 = true;
+
+  // files that also go in the inverse tree
+  bool inverse = false;
+  bfs::path inverseSource;
+  std::string inverseDestinationU8;
+};
+
+// the skip lists of the shared parameters, read once for all the links
+struct LinkFilters
+{
+  std::vector<std::string> skipFileSuffixes;
+  std::vector<std::string> skipDirectories;
+};
+
+}  // namespace
+
+static LinkFilters linkFilters()
+{
+  return {context->skipFileSuffixes(), context->skipDirectories()};
+}
+
+static BOOL listFileLink(LPCWSTR source, LPCWSTR destination, unsigned int flags,
+                         const LinkFilters& filters, std::vector<PendingLink>& links)
+{
+  std::string sourceU8 = ush::string_cast<std::string>(source, ush::CodePage::UTF8);
+
+  // Check if the file should be skipped
+  if (fileNameInSkipSuffixes(sourceU8, filters.skipFileSuffixes)) {
+    // return false when we want to fail when the file is skipped
+    return (flags & LINKFLAG_FAILIFSKIPPED) ? FALSE : TRUE;
+  }
+
+  PendingLink link;
+  link.topLevel    = true;
+  link.destination = bfs::path(destination);
+  link.overwrite   = !(flags & LINKFLAG_FAILIFEXISTS);
+
+  if (shouldAddToInverseTree(sourceU8)) {
+    link.inverse       = true;
+    link.inverseSource = bfs::path(source);
+    link.inverseDestinationU8 =
+        ush::string_cast<std::string>(destination, ush::CodePage::UTF8);
+  }
+
+  link.sourceU8 = std::move(sourceU8);
+  links.push_back(std::move(link));
+
+  return TRUE;
+}
+
+static BOOL listDirectoryLinks(LPCWSTR source, LPCWSTR destination, unsigned int flags,
+                               bool topLevel, const LinkFilters& filters,
+                               std::vector<PendingLink>& links)
+{
+  if ((flags & LINKFLAG_FAILIFEXISTS) && winapi::ex::wide::fileExists(destination)) {
+    SetLastError(ERROR_FILE_EXISTS);
+    return FALSE;
+  }
+
+  std::string sourceU8 =
+      ush::string_cast<std::string>(source, ush::CodePage::UTF8) + "\\";
+
+  PendingLink link;
+  link.topLevel    = topLevel;
+  link.directory   = true;
+  link.destination = bfs::path(destination);
+  link.sourceU8    = sourceU8;
+  link.flags       = usvfs::shared::FLAG_DIRECTORY | convertRedirectionFlags(flags);
+  link.overwrite   = (flags & LINKFLAG_CREATETARGET) != 0;
+  links.push_back(std::move(link));
+
+  if ((flags & LINKFLAG_RECURSIVE) != 0) {
+    std::wstring sourceP(source);
+    std::wstring sourceW      = sourceP + L"\\";
+    std::wstring destinationW = std::wstring(destination) + L"\\";
+    if (sourceP.length() >= MAX_PATH && !ush::startswith(sourceP.c_str(), LR"(\\?\)"))
+      sourceP = LR"(\\?\)" + sourceP;
+
+    for (winapi::ex::wide::FileResult file :
+         winapi::ex::wide::quickFindFiles(sourceP.c_str(), L"*")) {
+      if (file.attributes & FILE_ATTRIBUTE_DIRECTORY) {
+        if ((file.fileName != L".") && (file.fileName != L"..")) {
+
+          const auto nameU8 = ush::string_cast<std::string>(file.fileName.c_str(),
+                                                            ush::CodePage::UTF8);
+          // Check if the directory should be skipped
+          if (fileNameInSkipDirectories(nameU8, filters.skipDirectories)) {
+            // Fail if we desire to fail when a dir/file is skipped
+            if (flags & LINKFLAG_FAILIFSKIPPED) {
+              spdlog::get("usvfs")->debug(
+                  "directory '{}' skipped, failing as defined by link flags", nameU8);
+              return FALSE;
+            }
+
+            continue;
+          }
+
+          listDirectoryLinks((sourceW + file.fileName).c_str(),
+                             (destinationW + file.fileName).c_str(), flags, false,
+                             filters, links);
+        }
+      } else {
+        const auto nameU8 =
+            ush::string_cast<std::string>(file.fileName.c_str(), ush::CodePage::UTF8);
+
+        // Check if the file should be skipped
+        if (fileNameInSkipSuffixes(nameU8, filters.skipFileSuffixes)) {
+          // Fail if we desire to fail when a dir/file is skipped
+          if (flags & LINKFLAG_FAILIFSKIPPED) {
+            spdlog::get("usvfs")->debug(
+                "file '{}' skipped, failing as defined by link flags", nameU8);
+            return FALSE;
+          }
+
+          continue;
+        }
+
+        // TODO could save memory here by storing only the file name for the
+        // source and constructing the full name using the parent directory
+        PendingLink fileLink;
+        fileLink.destination = bfs::path(destination) / nameU8;
+        fileLink.sourceU8    = sourceU8 + nameU8;
+
+        if (shouldAddToInverseTree(nameU8)) {
+          fileLink.inverse       = true;
+          fileLink.inverseSource = bfs::path(source) / nameU8;
+          fileLink.inverseDestinationU8 =
+              ush::string_cast<std::string>(destination, ush::CodePage::UTF8) + "\\" +
+              nameU8;
+        }
+
+        links.push_back(std::move(fileLink));
+      }
     }
+  }
+
+  return TRUE;
+}
+
+// adds the listed links to the trees in order, after making room for all of
+// them in the shared memory; a top-level link that fails is skipped with
+// everything below it and makes this return FALSE with the error of that link
+static BOOL addLinks(const std::vector<PendingLink>& links)
+{
+  // rough size of the nodes in shared memory, the names and targets plus the
+  // node itself, its map and pointers
+  constexpr std::size_t NodeOverhead = 256;
+
+  std::size_t bytes = 0;
+  for (const auto& link : links) {
+    bytes += link.destination.filename().native().size() + link.sourceU8.size() +
+             NodeOverhead;
+  }
+  context->redirectionTable().reserve(bytes);
 
-    const auto skipFileSuffixes = context->skipFileSuffixes();
+  BOOL result   = TRUE;
+  bool skipping = false;
 
-    std::string sourceU8 = ush::string_cast<std::string>(source, ush::CodePage::UTF8);
+  for (const auto& link : links) {
+    if (link.topLevel) {
+      skipping = false;
 
-    // Check if the file should be skipped
-    if (fileNameInSkipSuffixes(sourceU8, skipFileSuffixes)) {
-      // return false when we want to fail when the file is skipped
-      return (flags & LINKFLAG_FAILIFSKIPPED) ? FALSE : TRUE;
+      if (!assertPathExists(context->redirectionTable(), link.destination.c_str())) {
+        SetLastError(ERROR_PATH_NOT_FOUND);
+        result   = FALSE;
+        skipping = true;
+      }
     }
 
-    auto res = context->redirectionTable().addFile(
-        bfs::path(destination), usvfs::RedirectionDataLocal(sourceU8),
-        !(flags & LINKFLAG_FAILIFEXISTS));
+    if (skipping) {
+      continue;
+    }
 
-    if (shouldAddToInverseTree(sourceU8)) {
-      std::string destinationU8 =
-          ush::string_cast<std::string>(destination, ush::CodePage::UTF8);
+    if (link.directory) {
+      context->redirectionTable().addDirectory(
+          link.destination, usvfs::RedirectionDataLocal(link.sourceU8), link.flags,
+          link.overwrite);
+    } else {
+      auto res = context->redirectionTable().addFile(
+          link.destination, usvfs::RedirectionDataLocal(link.sourceU8),
+          link.overwrite);
+
+      if (res.get() == nullptr) {
+        // the tree structure currently doesn't provide useful error codes but
+        // this is currently the only reason
+        // we would return a nullptr.
+        SetLastError(ERROR_FILE_EXISTS);
+        result = FALSE;
+      }
+    }
 
-      context->inverseTable().addFile(bfs::path(source),
-                                      usvfs::RedirectionDataLocal(destinationU8), true);
+    if (link.inverse) {
+      context->inverseTable().addFile(
+          link.inverseSource, usvfs::RedirectionDataLocal(link.inverseDestinationU8),
+          0, true);
     }
+  }
+
+  context->updateParameters();
 
-    context->updateParameters();
+  return result;
+}
 
-    if (res.get() == nullptr) {
-      // the tree structure currently doesn't provide useful error codes but
-      // this is currently the only reason
-      // we would return a nullptr.
-      SetLastError(ERROR_FILE_EXISTS);
+BOOL WINAPI usvfsVirtualLinkFile(LPCWSTR source, LPCWSTR destination,
+                                 unsigned int flags)
+{
+  // TODO difference between winapi and ntdll api regarding system32 vs syswow64
+  // (and other windows links?)
+  try {
+    std::vector<PendingLink> links;
+    if (!listFileLink(source, destination, flags, linkFilters(), links)) {
       return FALSE;
-    } else {
-      return TRUE;
     }
+
+    // nothing to add if the file was skipped
+    return links.empty() ? TRUE : addLinks(links);
   } catch (const std::exception& e) {
     spdlog::get("usvfs")->error("failed to copy file {}", e.what());
     // TODO: no clue what's wrong
@@ -701,114 +903,56 @@ BOOL WINAPI usvfsVirtualLinkFile(LPCWSTR source, LPCWSTR destination,
   }
 }
 
-/**
- * @brief extract the flags relevant to redirection
- */
-static usvfs::shared::TreeFlags convertRedirectionFlags(unsigned int flags)
-{
-  usvfs::shared::TreeFlags result = 0;
-  if (flags & LINKFLAG_CREATETARGET) {
-    result |= usvfs::shared::FLAG_CREATETARGET;
-  }
-  return result;
-}
-
 BOOL WINAPI usvfsVirtualLinkDirectoryStatic(LPCWSTR source, LPCWSTR destination,
                                             unsigned int flags)
 {
   // TODO change notification not yet implemented
   try {
-    if ((flags & LINKFLAG_FAILIFEXISTS) && winapi::ex::wide::fileExists(destination)) {
-      SetLastError(ERROR_FILE_EXISTS);
-      return FALSE;
-    }
+    std::vector<PendingLink> links;
+    const BOOL listed =
+        listDirectoryLinks(source, destination, flags, true, linkFilters(), links);
 
-    if (!assertPathExists(context->redirectionTable(), destination)) {
-      SetLastError(ERROR_PATH_NOT_FOUND);
+    // what was listed before a skipped entry failed the link is still added
+    if (!links.empty() && !addLinks(links)) {
       return FALSE;
     }
 
-    std::string sourceU8 =
-        ush::string_cast<std::string>(source, ush::CodePage::UTF8) + "\\";
-
-    context->redirectionTable().addDirectory(
-        destination, usvfs::RedirectionDataLocal(sourceU8),
-        usvfs::shared::FLAG_DIRECTORY | convertRedirectionFlags(flags),
-        (flags & LINKFLAG_CREATETARGET) != 0);
-
-    const auto skipDirectories  = context->skipDirectories();
-    const auto skipFileSuffixes = context->skipFileSuffixes();
-
-    if ((flags & LINKFLAG_RECURSIVE) != 0) {
-      std::wstring sourceP(source);
-      std::wstring sourceW      = sourceP + L"\\";
-      std::wstring destinationW = std::wstring(destination) + L"\\";
-      if (sourceP.length() >= MAX_PATH && !ush::startswith(sourceP.c_str(), LR"(\\?\)"))
-        sourceP = LR"(\\?\)" + sourceP;
-
-      for (winapi::ex::wide::FileResult file :
-           winapi::ex::wide::quickFindFiles(sourceP.c_str(), L"*")) {
-        if (file.attributes & FILE_ATTRIBUTE_DIRECTORY) {
-          if ((file.fileName != L".") && (file.fileName != L"..")) {
-
-            const auto nameU8 = ush::string_cast<std::string>(file.fileName.c_str(),
-                                                              ush::CodePage::UTF8);
-            // Check if the directory should be skipped
-            if (fileNameInSkipDirectories(nameU8, skipDirectories)) {
-              // Fail if we desire to fail when a dir/file is skipped
-              if (flags & LINKFLAG_FAILIFSKIPPED) {
-                spdlog::get("usvfs")->debug(
-                    "directory '{}' skipped, failing as defined by link flags", nameU8);
-                return FALSE;
-              }
-
-              continue;
-            }
-
-            usvfsVirtualLinkDirectoryStatic((sourceW + file.fileName).c_str(),
-                                            (destinationW + file.fileName).c_str(),
-                                            flags);
-          }
-        } else {
-          const auto nameU8 =
-              ush::string_cast<std::string>(file.fileName.c_str(), ush::CodePage::UTF8);
-
-          // Check if the file should be skipped
-          if (fileNameInSkipSuffixes(nameU8, skipFileSuffixes)) {
-            // Fail if we desire to fail when a dir/file is skipped
-            if (flags & LINKFLAG_FAILIFSKIPPED) {
-              spdlog::get("usvfs")->debug(
-                  "file '{}' skipped, failing as defined by link flags", nameU8);
-              return FALSE;
-            }
-
-            continue;
-          }
-
-          // TODO could save memory here by storing only the file name for the
-          // source and constructing the full name using the parent directory
-          context->redirectionTable().addFile(
-              bfs::path(destination) / nameU8,
-              usvfs::RedirectionDataLocal(sourceU8 + nameU8), true);
-
-          if (shouldAddToInverseTree(nameU8)) {
-            std::string destinationU8 =
-                ush::string_cast<std::string>(destination, ush::CodePage::UTF8) + "\\";
+    return listed;
+  } catch (const std::exception& e) {
+    spdlog::get("usvfs")->error("failed to copy file {}", e.what());
+    // TODO: no clue what's wrong
+    SetLastError(ERROR_INVALID_DATA);
+    return FALSE;
+  }
+}
 
-            context->inverseTable().addFile(
-                bfs::path(source) / nameU8,
-                usvfs::RedirectionDataLocal(destinationU8 + nameU8), true);
-          }
-        }
+BOOL WINAPI usvfsVirtualLinkMany(const usvfsVirtualLink* links, size_t count)
+{
+  try {
+    const auto filters = linkFilters();
+
+    std::vector<PendingLink> pending;
+    BOOL result = TRUE;
+
+    for (size_t i = 0; i < count; ++i) {
+      const auto& link = links[i];
+      const BOOL listed =
+          link.directory ? listDirectoryLinks(link.source, link.destination,
+                                              link.flags, true, filters, pending)
+                         : listFileLink(link.source, link.destination, link.flags,
+                                        filters, pending);
+      if (!listed) {
+        result = FALSE;
       }
     }
 
-    context->updateParameters();
+    if (!pending.empty() && !addLinks(pending)) {
+      result = FALSE;
+    }
 
-    return TRUE;
+    return result;
   } catch (const std::exception& e) {
-    spdlog::get("usvfs")->error("failed to copy file {}", e.what());
-    // TODO: no clue what's wrong
+    spdlog::get("usvfs")->error("failed to link {} entries: {}", count, e.what());
     SetLastError(ERROR_INVALID_DATA);
     return FALSE;
   }
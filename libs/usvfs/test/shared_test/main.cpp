@@ -91,6 +91,14 @@ TEST(WildcardTest, MatchWildcard)
   EXPECT_EQ('\0', *wildcard::PartialMatch("abc.def", "*"));
 
   EXPECT_FALSE(wildcard::Match(TEXT("abc"), TEXT("b*")));
+
+  // a * that matched too little must be able to eat more after a mismatch
+  EXPECT_TRUE(wildcard::Match(TEXT("abcbcd"), TEXT("a*bcd")));
+  EXPECT_TRUE(wildcard::Match(TEXT("aXbYb"), TEXT("a*b*b")));
+  EXPECT_FALSE(wildcard::Match(TEXT("abcbc"), TEXT("a*bcd")));
+  EXPECT_FALSE(wildcard::Match(TEXT("ab"), TEXT("a?*?")));
+  EXPECT_TRUE(wildcard::Match(TEXT("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"),
+                              TEXT("*a*a*a*a*a*a*a*a*a*a*a*a*a*a*a*a*a*a*a*a")));
 }
 
 TEST(DirectoryTreeTest, SimpleTreeInit)
@@ -191,6 +199,33 @@ TEST(DirectoryTreeTest, SHMAllocation)
   });
 }
 
+TEST(DirectoryTreeTest, SHMGeneration)
+{
+  EXPECT_NO_THROW({
+    ContainerType tree(g_SHMName, 4096);
+    ContainerType access(g_SHMName, 4096);
+
+    const auto initial = tree.generation();
+    tree.addFile(R"(C:\temp\abc)", 1, false);
+    EXPECT_LT(initial, access.generation());
+
+    // growing the tree to new blocks must never make the generation go back, other
+    // processes would keep results looked up in an older tree
+    auto last = access.generation();
+    for (char i = 'a'; i <= 'z'; ++i) {
+      for (char j = 'a'; j <= 'z'; ++j) {
+        tree.addFile(std::string(R"(C:\temp\)") + i + j, 1, false);
+        EXPECT_LT(last, access.generation());
+        last = access.generation();
+      }
+    }
+
+    access->node("C:")->node("temp")->node("aa", MissingThrow)->removeFromTree();
+    access.touch();
+    EXPECT_LT(last, tree.generation());
+  });
+}
+
 TEST(DirectoryTreeTest, SHMAllocationError)
 {
   EXPECT_NO_THROW({
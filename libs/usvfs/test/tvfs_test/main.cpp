@@ -562,6 +562,27 @@ TEST_F(USVFSTestAuto, CanCreateMultipleLinks)
                      FILE_ATTRIBUTE_DIRECTORY);
 }
 
+TEST_F(USVFSTestAuto, CanCreateMultipleLinksAtOnce)
+{
+  static LPCWSTR outFile = LR"(C:\np.exe)";
+  static LPCWSTR outDir  = LR"(C:\logs)";
+
+  const usvfsVirtualLink links[] = {
+      {REAL_FILEW, outFile, 0, FALSE},
+      {REAL_DIRW, outDir, 0, TRUE},
+      {REAL_FILEW, L"c:/this_directory_shouldnt_exist/np.exe", 0, FALSE},
+  };
+
+  // the last link fails, the others must still be there
+  ASSERT_EQ(FALSE, usvfsVirtualLinkMany(links, std::size(links)));
+  ASSERT_EQ(ERROR_PATH_NOT_FOUND, GetLastError());
+
+  ASSERT_NE(INVALID_FILE_ATTRIBUTES, usvfs::hook_GetFileAttributesW(outFile));
+  ASSERT_NE(INVALID_FILE_ATTRIBUTES, usvfs::hook_GetFileAttributesW(outDir));
+  ASSERT_EQ(0UL, usvfs::hook_GetFileAttributesW(outFile) & FILE_ATTRIBUTE_DIRECTORY);
+  ASSERT_NE(0UL, usvfs::hook_GetFileAttributesW(outDir) & FILE_ATTRIBUTE_DIRECTORY);
+}
+
 int main(int argc, char** argv)
 {
   using namespace test;
@@ -0,0 +1,498 @@
+// Benchmarks of archive and plugin parsing, comparing bsatk with bsa_ffi.
+//
+// Archives are generated once per format and file count below a temporary
+// directory by packing loose files with bsa_ffi, the only writer that handles
+// all of them:
+//
+//   zlib   Skyrim LE BSA (v104)
+//   lz4    Skyrim SE BSA (v105)
+//   ba2    Fallout 4 general BA2
+//   dx10   Fallout 4 texture BA2, DXT1 textures with full mip chains
+//
+// Loose files are pseudo-random text over a small alphabet, which compresses
+// to about half.  Plugins get a TES4 header with the given number of masters
+// followed by a group padding them to --plugin-size.
+//
+// Besides the usual --benchmark_* flags:
+//
+//   --formats=zlib,lz4,ba2,dx10   archive formats
+//   --files=100,1000              files per archive
+//   --file-size=64                KiB per loose file
+//   --masters=0,16,254            masters per plugin
+//   --plugin-size=1               MiB per plugin
+//   --dir=PATH                    where to generate everything, kept afterwards
+
+#include <bsa_ffi.h>
+#include <bsatk/bsaarchive.h>
+#include <esptk/espfile.h>
+
+#include <DDS.h>
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+struct Format
+{
+  std::string name;
+  const char* game;
+  const char* archive;  // the name picks general or texture BA2s
+  int include_mode;     // see bsa_ffi_pack_dir_filtered()
+  bool textures;
+};
+
+const std::vector<Format>& allFormats()
+{
+  static const std::vector<Format> formats = {
+      {"zlib", "skyrimle", "bench.bsa", 0, false},
+      {"lz4", "skyrimse", "bench.bsa", 0, false},
+      {"ba2", "fo4-fo76", "bench - Main.ba2", 0, false},
+      {"dx10", "fo4-fo76", "bench - Textures.ba2", 2, true}};
+  return formats;
+}
+
+struct Options
+{
+  std::vector<std::string> formats = {"zlib", "lz4", "ba2", "dx10"};
+  std::vector<int> files           = {100, 1000};
+  int file_size                    = 64 * 1024;
+  std::vector<int> masters         = {0, 16, 254};
+  int plugin_size                  = 1024 * 1024;
+  std::string dir;
+};
+
+Options g_options;
+fs::path g_root;
+
+// a generated archive along with the files it was packed from
+struct Generated
+{
+  fs::path loose;
+  fs::path archive;
+  int64_t bytes = 0;  // uncompressed size of all the files
+};
+
+std::vector<std::string> split(const std::string& s)
+{
+  std::vector<std::string> parts;
+  std::string::size_type start = 0;
+  while (start <= s.size()) {
+    const auto end = std::min(s.find(',', start), s.size());
+    if (end > start) {
+      parts.push_back(s.substr(start, end - start));
+    }
+    start = end + 1;
+  }
+  return parts;
+}
+
+void writeFile(const fs::path& path, const std::string& content)
+{
+  fs::create_directories(path.parent_path());
+  std::ofstream out(path, std::ios::binary);
+  out.write(content.data(), static_cast<std::streamsize>(content.size()));
+  if (!out) {
+    throw std::runtime_error("failed to write " + path.string());
+  }
+}
+
+std::string compressible(std::mt19937& random, size_t size)
+{
+  std::string data(size, '\0');
+  for (auto& c : data) {
+    c = static_cast<char>('a' + random() % 16);
+  }
+  return data;
+}
+
+// a DXT1 texture with a full mip chain, about `size` bytes
+std::string texture(std::mt19937& random, size_t size)
+{
+  // half a byte per pixel
+  uint32_t width = 4;
+  while (static_cast<size_t>(width) * 2 * width * 2 / 2 <= size) {
+    width *= 2;
+  }
+
+  // every mip takes at least one 8 byte block of 4x4 pixels
+  uint32_t mips = 0;
+  size_t data   = 0;
+  for (uint32_t w = width; w > 0; w /= 2) {
+    const size_t blocks = std::max<uint32_t>(w / 4, 1);
+    data += blocks * blocks * 8;
+    ++mips;
+  }
+
+  DirectX::DDS_HEADER header{};
+  header.size              = sizeof(header);
+  header.flags             = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_MIPMAP |
+                 DDS_HEADER_FLAGS_LINEARSIZE;
+  header.height            = width;
+  header.width             = width;
+  header.pitchOrLinearSize = width * width / 2;
+  header.mipMapCount       = mips;
+  header.ddspf             = DirectX::DDSPF_DXT1;
+  header.caps              = DDS_SURFACE_FLAGS_TEXTURE | DDS_SURFACE_FLAGS_MIPMAP;
+
+  std::string out(4 + sizeof(header) + data, '\0');
+  std::memcpy(out.data(), &DirectX::DDS_MAGIC, 4);
+  std::memcpy(out.data() + 4, &header, sizeof(header));
+  for (size_t i = 4 + sizeof(header); i < out.size(); ++i) {
+    out[i] = static_cast<char>(random());
+  }
+  return out;
+}
+
+const Generated& generated(const Format& format, int files)
+{
+  static std::map<std::string, Generated> cache;
+
+  const std::string key = format.name + "-" + std::to_string(files);
+  if (auto it = cache.find(key); it != cache.end()) {
+    return it->second;
+  }
+
+  Generated g;
+  g.loose   = g_root / ("loose-" + key);
+  g.archive = g_root / ("archive-" + key) / format.archive;
+
+  std::mt19937 random(static_cast<unsigned>(files));
+  const auto size = static_cast<size_t>(g_options.file_size);
+  for (int i = 0; i < files; ++i) {
+    const fs::path dir  = "dir" + std::to_string(i % 16);
+    const std::string n = std::to_string(i);
+    const std::string content =
+        format.textures ? texture(random, size) : compressible(random, size);
+    const fs::path path = format.textures
+                              ? g.loose / "textures" / dir / ("tex" + n + ".dds")
+                              : g.loose / "meshes" / dir / ("file" + n + ".nif");
+    writeFile(path, content);
+    g.bytes += static_cast<int64_t>(content.size());
+  }
+
+  fs::create_directories(g.archive.parent_path());
+  char* error =
+      bsa_ffi_pack_dir_filtered(g.loose.c_str(), g.archive.c_str(), format.game,
+                                format.include_mode, nullptr, nullptr);
+  if (error != nullptr) {
+    const std::string message = error;
+    bsa_ffi_string_free(error);
+    throw std::runtime_error("failed to pack " + key + ": " + message);
+  }
+
+  return cache.emplace(key, std::move(g)).first->second;
+}
+
+// a plugin with `masters` masters, padded to the configured size
+fs::path plugin(int masters)
+{
+  const fs::path path = g_root / ("plugin-" + std::to_string(masters) + ".esp");
+  if (fs::exists(path)) {
+    return path;
+  }
+
+  std::string data;
+  const auto sub = [&](const char* type, const std::string& content) {
+    const auto size = static_cast<uint16_t>(content.size());
+    data.append(type, 4);
+    data.append(reinterpret_cast<const char*>(&size), 2);
+    data.append(content);
+  };
+
+  struct
+  {
+    float version;
+    int32_t numRecords;
+    uint32_t nextObjectId;
+  } hedr{1.7f, 1, 0x800};
+  sub("HEDR", std::string(reinterpret_cast<const char*>(&hedr), sizeof(hedr)));
+  sub("CNAM", std::string("benchmark") + '\0');
+  sub("SNAM", std::string(200, 'd') + '\0');
+  for (int i = 0; i < masters; ++i) {
+    sub("MAST", "Master" + std::to_string(i) + ".esm" + '\0');
+    sub("DATA", std::string(8, '\0'));
+  }
+
+  // TES4 record: type, size, flags, form id, revision, form version, unknown
+  std::string file    = "TES4";
+  const auto dataSize = static_cast<uint32_t>(data.size());
+  file.append(reinterpret_cast<const char*>(&dataSize), 4);
+  file.append(12, '\0');
+  const uint16_t formVersion = 44;
+  file.append(reinterpret_cast<const char*>(&formVersion), 2);
+  file.append(2, '\0');
+  file += data;
+
+  // one group of filler, only the header is parsed
+  if (static_cast<int>(file.size()) + 24 < g_options.plugin_size) {
+    const auto groupSize = static_cast<uint32_t>(g_options.plugin_size - file.size());
+    file += "GRUP";
+    file.append(reinterpret_cast<const char*>(&groupSize), 4);
+    file += "NONE";
+    file.append(12, '\0');
+    file.append(groupSize - 24, '\0');
+  }
+
+  writeFile(path, file);
+  return path;
+}
+
+void BsatkRead(benchmark::State& state, const Format& format)
+{
+  const auto& g = generated(format, static_cast<int>(state.range(0)));
+
+  for (auto _ : state) {
+    BSA::Archive archive;
+    if (archive.read(g.archive.c_str(), false) != BSA::ERROR_NONE) {
+      state.SkipWithError("failed to read the archive");
+      return;
+    }
+    archive.close();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BsatkExtractAll(benchmark::State& state, const Format& format)
+{
+  const auto& g      = generated(format, static_cast<int>(state.range(0)));
+  const fs::path out = g_root / "out-bsatk";
+
+  BSA::Archive archive;
+  if (archive.read(g.archive.c_str(), false) != BSA::ERROR_NONE) {
+    state.SkipWithError("failed to read the archive");
+    return;
+  }
+
+  for (auto _ : state) {
+    const auto result = archive.extractAll(
+        out.c_str(),
+        [](int, std::string) {
+          return true;
+        },
+        true);
+    if (result != BSA::ERROR_NONE) {
+      state.SkipWithError("failed to extract the archive");
+      return;
+    }
+  }
+
+  archive.close();
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * g.bytes);
+}
+
+void FfiListFiles(benchmark::State& state, const Format& format)
+{
+  const auto& g = generated(format, static_cast<int>(state.range(0)));
+
+  for (auto _ : state) {
+    BsaFfiStringList list = bsa_ffi_list_files(g.archive.c_str());
+    const bool failed     = list.error != nullptr;
+    benchmark::DoNotOptimize(list.count);
+    bsa_ffi_string_list_free(list);
+    if (failed) {
+      state.SkipWithError("failed to list the archive");
+      return;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void FfiExtractAll(benchmark::State& state, const Format& format)
+{
+  const auto& g      = generated(format, static_cast<int>(state.range(0)));
+  const fs::path out = g_root / "out-ffi";
+
+  for (auto _ : state) {
+    char* error = bsa_ffi_extract_all(g.archive.c_str(), out.c_str(), nullptr, nullptr);
+    if (error != nullptr) {
+      bsa_ffi_string_free(error);
+      state.SkipWithError("failed to extract the archive");
+      return;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * g.bytes);
+}
+
+void FfiPackDir(benchmark::State& state, const Format& format)
+{
+  const auto& g         = generated(format, static_cast<int>(state.range(0)));
+  const fs::path target = g_root / "pack" / format.archive;
+  fs::create_directories(target.parent_path());
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    fs::remove(target);
+    state.ResumeTiming();
+
+    char* error =
+        bsa_ffi_pack_dir_filtered(g.loose.c_str(), target.c_str(), format.game,
+                                  format.include_mode, nullptr, nullptr);
+    if (error != nullptr) {
+      bsa_ffi_string_free(error);
+      state.SkipWithError("failed to pack the archive");
+      return;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * g.bytes);
+}
+
+void EspHeader(benchmark::State& state)
+{
+  const fs::path path = plugin(static_cast<int>(state.range(0)));
+
+  for (auto _ : state) {
+    ESP::File file(path.string());
+    benchmark::DoNotOptimize(file.masters());
+  }
+}
+
+bool parseOptions(int& argc, char** argv)
+{
+  int kept = 1;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg   = argv[i];
+    const auto eq           = arg.find('=');
+    const std::string key   = arg.substr(0, eq);
+    const std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+    const auto numbers = [&](std::vector<int>& target, int scale) {
+      target.clear();
+      for (const auto& part : split(value)) {
+        const int n = std::atoi(part.c_str());
+        if (n <= 0 && part != "0") {
+          std::cerr << "invalid value for " << key << ": '" << part << "'\n";
+          return false;
+        }
+        target.push_back(n * scale);
+      }
+      return !target.empty();
+    };
+
+    bool ok = true;
+    std::vector<int> single;
+    if (key == "--formats") {
+      g_options.formats = split(value);
+    } else if (key == "--files") {
+      ok = numbers(g_options.files, 1);
+    } else if (key == "--file-size") {
+      ok = numbers(single, 1024);
+      g_options.file_size = ok ? single.front() : 0;
+    } else if (key == "--masters") {
+      ok = numbers(g_options.masters, 1);
+    } else if (key == "--plugin-size") {
+      ok = numbers(single, 1024 * 1024);
+      g_options.plugin_size = ok ? single.front() : 0;
+    } else if (key == "--dir") {
+      g_options.dir = value;
+    } else {
+      // left for benchmark::Initialize()
+      argv[kept++] = argv[i];
+      continue;
+    }
+
+    if (!ok) {
+      return false;
+    }
+  }
+
+  argc = kept;
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  if (!parseOptions(argc, argv)) {
+    return 2;
+  }
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 2;
+  }
+
+  if (g_options.dir.empty()) {
+    std::string pattern =
+        (fs::temp_directory_path() / "mo2-archive-bench-XXXXXX").string();
+    if (::mkdtemp(pattern.data()) == nullptr) {
+      std::cerr << "failed to create a temporary directory\n";
+      return 1;
+    }
+    g_root = pattern;
+  } else {
+    g_root = g_options.dir;
+    fs::create_directories(g_root);
+  }
+
+  for (const auto& name : g_options.formats) {
+    const auto& formats = allFormats();
+    const auto it       = std::find_if(formats.begin(), formats.end(), [&](auto&& f) {
+      return f.name == name;
+    });
+    if (it == formats.end()) {
+      std::cerr << "unknown format '" << name << "'\n";
+      return 2;
+    }
+
+    const Format& format = *it;
+    const auto add = [&](const std::string& what, auto function) {
+      auto* b = benchmark::RegisterBenchmark((what + "/" + format.name).c_str(),
+                                             function, format);
+      for (const int files : g_options.files) {
+        b->Arg(files);
+      }
+      b->Unit(benchmark::kMillisecond)->UseRealTime();
+    };
+
+    add("bsatk_read", BsatkRead);
+    add("bsatk_extractAll", BsatkExtractAll);
+    add("bsa_ffi_list_files", FfiListFiles);
+    add("bsa_ffi_extract_all", FfiExtractAll);
+    add("bsa_ffi_pack_dir", FfiPackDir);
+  }
+
+  auto* esp = benchmark::RegisterBenchmark("esptk_header", EspHeader);
+  for (const int masters : g_options.masters) {
+    esp->Arg(masters);
+  }
+  esp->Unit(benchmark::kMicrosecond);
+
+  int result = 0;
+  try {
+    benchmark::RunSpecifiedBenchmarks();
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    result = 1;
+  }
+  benchmark::Shutdown();
+
+  if (g_options.dir.empty()) {
+    std::error_code ec;
+    fs::remove_all(g_root, ec);
+  }
+
+  return result;
+}
@@ -19,6 +19,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 // For QObject::tr:
 #include <QObject>
+#include <QSet>
 
 #include "archivefiletree.h"
 
@@ -59,12 +60,37 @@ class ArchiveFileTreeImpl : public virtual ArchiveFileTree,
                             public virtual ArchiveFileEntry
 {
 public:
-  using File = std::tuple<QStringList, bool, int>;
+  /**
+   * An entry of the archive, with its path split in components.
+   */
+  struct File
+  {
+    QStringList path;
+    bool isDir;
+    int index;
+  };
+
+  /**
+   * All the entries of the archive, sorted component by component, so the entries
+   * under any directory are a contiguous range. The listing is shared by all the
+   * trees created from the archive and never modified.
+   */
+  using Listing = std::vector<File>;
+
+  // the range of `listing` that is in a tree at `depth`, all the entries in it have
+  // more than `depth` components and the same first `depth` ones
+  struct Range
+  {
+    std::shared_ptr<const Listing> listing;
+    std::size_t begin = 0;
+    std::size_t end   = 0;
+    qsizetype depth   = 0;
+  };
 
 public
     :  // Public for make_shared (but not accessible by other since not exposed in .h):
   ArchiveFileTreeImpl(std::shared_ptr<const IFileTree> parent, QString name, int index,
-                      std::vector<File> files)
+                      Range files)
       : FileTreeEntry(parent, name), ArchiveFileEntry(parent, name, index), IFileTree(),
         m_Files(std::move(files))
   {}
@@ -138,7 +164,7 @@ protected:
   virtual std::shared_ptr<IFileTree>
   makeDirectory(std::shared_ptr<const IFileTree> parent, QString name) const override
   {
-    return std::make_shared<ArchiveFileTreeImpl>(parent, name, -1, std::vector<File>{});
+    return std::make_shared<ArchiveFileTreeImpl>(parent, name, -1, Range{});
   }
 
   virtual std::shared_ptr<FileTreeEntry>
@@ -151,68 +177,57 @@ protected:
   doPopulate(std::shared_ptr<const IFileTree> parent,
              std::vector<std::shared_ptr<FileTreeEntry>>& entries) const override
   {
+    if (m_Files.begin == m_Files.end) {
+      return true;
+    }
 
-    // Sort by name:
-    std::sort(std::begin(m_Files), std::end(m_Files), [](const auto& a, const auto& b) {
-      return std::get<0>(a)[0].compare(std::get<0>(b)[0], Qt::CaseInsensitive) < 0;
-    });
-
-    // We know that the files are sorted:
-    QString currentName = "";
-    int currentIndex    = -1;
-    std::vector<File> currentFiles;
-    for (auto& p : m_Files) {
-
-      // At the start or if we have reset, just retrieve the current name:
-      if (currentName == "") {
-        currentName = std::get<0>(p)[0];
+    const Listing& listing = *m_Files.listing;
+    const qsizetype depth  = m_Files.depth;
+
+    // The listing is sorted, so the entries named the same at this depth follow each
+    // other, the ones that end here first, and the names come in the order of the
+    // tree; directories and files only have to be kept apart:
+    std::vector<std::shared_ptr<FileTreeEntry>> files;
+
+    std::size_t i = m_Files.begin;
+    while (i < m_Files.end) {
+      const QString& name = listing[i].path[depth];
+
+      // We may or may not have an index for the directory, it depends on the type of
+      // archive (some archives list intermediate non-empty folders, some don't):
+      int directoryIndex = -1;
+      bool isDirectory   = false;
+
+      for (; i < m_Files.end && listing[i].path.size() == depth + 1 &&
+             FileNameComparator::compare(listing[i].path[depth], name) == 0;
+           ++i) {
+        if (listing[i].isDir) {
+          directoryIndex = listing[i].index;
+          isDirectory    = true;
+        } else {
+          files.push_back(std::make_shared<ArchiveFileEntry>(
+              parent, listing[i].path[depth], listing[i].index));
+        }
       }
 
-      // If the name is different, we need to create a directory from what we have
-      // accumulated:
-      if (currentName != std::get<0>(p)[0]) {
-
-        // We may or may not have an index here, it depends on the type of archive (some
-        // archives list intermediate non-empty folders, some don't):
-        entries.push_back(std::make_shared<ArchiveFileTreeImpl>(
-            parent, currentName, currentIndex, std::move(currentFiles)));
-
-        currentFiles.clear();  // Back to a valid state.
-
-        // Reset the index:
-        currentIndex = -1;
+      const std::size_t children = i;
+      while (i < m_Files.end &&
+             FileNameComparator::compare(listing[i].path[depth], name) == 0) {
+        ++i;
       }
 
-      // We can always override the current name:
-      currentName = std::get<0>(p)[0];
-
-      // If the current path contains only one components:
-      if (std::get<0>(p).size() == 1) {
-
-        // If it is not a directory, then it is a file in directly under this tree:
-        if (!std::get<1>(p)) {
-          entries.push_back(
-              std::make_shared<ArchiveFileEntry>(parent, currentName, std::get<2>(p)));
-          currentName = "";
-        } else {
-          // Otherwize, it is the actual "file" corresponding to the directory we are
-          // listing, so we can retrieve the index here:
-          currentIndex = std::get<2>(p);
-        }
-      } else {
-        currentFiles.push_back(
-            {QStringList(std::get<0>(p).begin() + 1, std::get<0>(p).end()),
-             std::get<1>(p), std::get<2>(p)});
+      if (isDirectory || children != i) {
+        entries.push_back(std::make_shared<ArchiveFileTreeImpl>(
+            parent, name, directoryIndex,
+            Range{m_Files.listing, children, i, depth + 1}));
       }
     }
 
-    if (currentName != "") {
-      entries.push_back(std::make_shared<ArchiveFileTreeImpl>(
-          parent, currentName, currentIndex, std::move(currentFiles)));
-    }
+    entries.insert(entries.end(), std::make_move_iterator(files.begin()),
+                   std::make_move_iterator(files.end()));
 
-    // Let the parent class sort the entries:
-    return false;
+    // Directories then files, both sorted by name:
+    return true;
   }
 
   virtual std::shared_ptr<IFileTree> doClone() const override
@@ -221,32 +236,57 @@ protected:
   }
 
 private:
-  mutable std::vector<File> m_Files;
+  const Range m_Files;
 };
 
 std::shared_ptr<ArchiveFileTree> ArchiveFileTree::makeTree(Archive const& archive)
 {
-  auto const& data = archive.getFileList();
+  auto files = std::make_shared<ArchiveFileTreeImpl::Listing>();
 
-  std::vector<ArchiveFileTreeImpl::File> files;
-  files.reserve(data.size());
+  // Archives repeat the same few directory names over and over, so components are
+  // interned and every entry shares the same string for them:
+  QSet<QString> components;
 
-  for (size_t i = 0; i < data.size(); ++i) {
+  // Only the paths are needed here, so the entries are listed directly instead of
+  // building the full file list of the archive (that only happens if the archive is
+  // actually installed):
+  archive.forEachEntry([&](std::size_t i, std::wstring const& path, bool isDir) {
     // Ignore "." and ".." as they're useless and muck things up
-    if (data[i]->getArchiveFilePath().compare(L".") == 0 ||
-        data[i]->getArchiveFilePath().compare(L"..") == 0) {
-      continue;
+    if (path.compare(L".") == 0 || path.compare(L"..") == 0) {
+      return true;
     }
 
-    files.push_back(
-        std::make_tuple(QString::fromStdWString(data[i]->getArchiveFilePath())
+    QStringList parts = QString::fromStdWString(path)
                             .replace("\\", "/")
-                            .split("/", Qt::SkipEmptyParts),
-                        data[i]->isDirectory(), (int)i));
-  }
+                            .split("/", Qt::SkipEmptyParts);
+    if (parts.isEmpty()) {
+      return true;
+    }
+
+    for (auto& part : parts) {
+      part = *components.insert(part);
+    }
+
+    files->push_back({std::move(parts), isDir, (int)i});
+    return true;
+  });
+
+  // A single sort of the whole archive, trees are then populated by walking their
+  // range of it. Components are compared like the names in the tree, and an entry
+  // comes before the ones under it:
+  std::stable_sort(files->begin(), files->end(), [](const auto& a, const auto& b) {
+    const qsizetype n = std::min(a.path.size(), b.path.size());
+    for (qsizetype k = 0; k < n; ++k) {
+      if (const int c = FileNameComparator::compare(a.path[k], b.path[k]); c != 0) {
+        return c < 0;
+      }
+    }
+    return a.path.size() < b.path.size();
+  });
 
-  auto tree = std::make_shared<ArchiveFileTreeImpl>(nullptr, "", -1, std::move(files));
-  return tree;
+  const std::size_t count = files->size();
+  return std::make_shared<ArchiveFileTreeImpl>(
+      nullptr, "", -1, ArchiveFileTreeImpl::Range{std::move(files), 0, count, 0});
 }
 
 /**
@@ -0,0 +1,261 @@
+#include "batchscript.h"
+#include "loot.h"
+#include "modinfo.h"
+#include "organizercore.h"
+#include "processrunner.h"
+#include "profile.h"
+
+#include <log.h>
+
+#include <QEventLoop>
+#include <QFile>
+#include <QProcess>
+
+#include <optional>
+
+using namespace MOBase;
+
+namespace
+{
+
+// lines of the script along with their line number, without comments and
+// empty lines
+using Script = std::vector<std::pair<int, QString>>;
+
+bool readScript(const QString& path, Script& script, QString& error)
+{
+  QFile file;
+  bool opened = false;
+
+  if (path == "-") {
+    opened = file.open(stdin, QIODevice::ReadOnly);
+  } else {
+    file.setFileName(path);
+    opened = file.open(QIODevice::ReadOnly);
+  }
+
+  if (!opened) {
+    error = QObject::tr("failed to open %1: %2").arg(path, file.errorString());
+    return false;
+  }
+
+  int number = 0;
+  while (!file.atEnd()) {
+    const QString line = QString::fromUtf8(file.readLine()).trimmed();
+    ++number;
+
+    if (!line.isEmpty() && !line.startsWith('#')) {
+      script.emplace_back(number, line);
+    }
+  }
+
+  return true;
+}
+
+// blocks until a refresh of the directory structure that's running is done,
+// same as OrganizerCore::beforeRun()
+//
+void waitForRefresh(OrganizerCore& core)
+{
+  if (core.directoryUpdating()) {
+    QEventLoop loop;
+    QObject::connect(&core, &OrganizerCore::directoryStructureReady, &loop,
+                     &QEventLoop::quit, Qt::QueuedConnection);
+    loop.exec();
+  }
+}
+
+bool install(OrganizerCore& core, const QStringList& args, QString& error)
+{
+  if (args.size() < 1 || args.size() > 2) {
+    error = QObject::tr("usage: install ARCHIVE [NAME]");
+    return false;
+  }
+
+  const QString name = args.size() > 1 ? args[1] : QString();
+  if (core.installArchive(args[0], -1, false, nullptr, name) == nullptr) {
+    error = QObject::tr("failed to install %1").arg(args[0]);
+    return false;
+  }
+
+  return true;
+}
+
+bool setEnabled(OrganizerCore& core, const QStringList& mods, bool enabled,
+                QString& error)
+{
+  if (mods.isEmpty()) {
+    error = enabled ? QObject::tr("usage: enable MOD...")
+                    : QObject::tr("usage: disable MOD...");
+    return false;
+  }
+
+  QList<unsigned int> indices;
+  for (const auto& name : mods) {
+    const auto index = ModInfo::getIndex(name);
+    if (index == UINT_MAX) {
+      error = QObject::tr("mod '%1' not found").arg(name);
+      return false;
+    }
+    indices.push_back(index);
+  }
+
+  if (enabled) {
+    core.currentProfile()->setModsEnabled(indices, {});
+  } else {
+    core.currentProfile()->setModsEnabled({}, indices);
+  }
+
+  return true;
+}
+
+// same as PluginListView::onSortButtonClicked(), without the dialog; the
+// report is only logged
+//
+bool sort(OrganizerCore& core, QTextStream& out, QString& error)
+{
+  core.savePluginList();
+
+  Loot loot(core);
+  QEventLoop loop;
+
+  QObject::connect(&loot, &Loot::finished, &loop, &QEventLoop::quit,
+                   Qt::QueuedConnection);
+
+  QObject::connect(&loot, &Loot::log, &loop, [](log::Levels lv, const QString& s) {
+    if (lv >= log::Levels::Warning) {
+      log::log(lv, "{}", s);
+    }
+  });
+
+  if (!loot.start(nullptr, false)) {
+    error = QObject::tr("failed to start loot");
+    return false;
+  }
+
+  loop.exec();
+
+  for (const auto& w : loot.warnings()) {
+    out << "loot: " << w << "\n";
+  }
+
+  if (!loot.result()) {
+    error = loot.errors().empty()
+                ? QObject::tr("loot failed")
+                : QObject::tr("loot failed: %1").arg(loot.errors()[0]);
+    return false;
+  }
+
+  core.refreshESPList(false);
+  core.savePluginList();
+
+  return true;
+}
+
+bool run(OrganizerCore& core, const QStringList& args, QTextStream& out,
+         QString& error)
+{
+  if (args.isEmpty()) {
+    error = QObject::tr("usage: run NAME [ARG...]");
+    return false;
+  }
+
+  auto p = core.processRunner();
+
+  p.setFromFileOrExecutable(args[0], args.mid(1));
+  p.setWaitForCompletion(ProcessRunner::ForCommandLine, UILocker::PreventExit);
+
+  if (p.run() != ProcessRunner::Completed) {
+    error = QObject::tr("failed to run '%1', the logs might have more information")
+                .arg(args[0]);
+    return false;
+  }
+
+  out << args[0] << " exited with " << p.exitCode() << "\n";
+
+  if (p.exitCode() != 0) {
+    error = QObject::tr("'%1' exited with %2").arg(args[0]).arg(p.exitCode());
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace
+
+bool runBatchScript(OrganizerCore& core, const QString& path, QTextStream& out,
+                    QString& error)
+{
+  Script script;
+  if (!readScript(path, script, error)) {
+    return false;
+  }
+
+  // the refresh at startup must be done before mods can be looked up
+  waitForRefresh(core);
+
+  // open while consecutive steps only change mods
+  std::optional<OrganizerCore::RefreshTransaction> transaction;
+
+  for (const auto& [number, line] : script) {
+    QStringList args = QProcess::splitCommand(line);
+    if (args.isEmpty()) {
+      continue;
+    }
+
+    const QString step = args.takeFirst().toLower();
+
+    out << path << ":" << number << ": " << line << "\n";
+    out.flush();
+
+    const bool changesMods =
+        (step == "install" || step == "enable" || step == "disable");
+
+    if (changesMods) {
+      if (!transaction) {
+        transaction.emplace(core);
+      }
+    } else {
+      transaction.reset();
+      waitForRefresh(core);
+    }
+
+    QString stepError;
+    bool ok = false;
+
+    try {
+      if (step == "install") {
+        ok = install(core, args, stepError);
+      } else if (step == "enable" || step == "disable") {
+        ok = setEnabled(core, args, step == "enable", stepError);
+      } else if (step == "sort") {
+        ok = sort(core, out, stepError);
+      } else if (step == "refresh") {
+        core.refresh();
+        waitForRefresh(core);
+        ok = true;
+      } else if (step == "run") {
+        ok = run(core, args, out, stepError);
+      } else {
+        stepError = QObject::tr("unknown step '%1'").arg(step);
+      }
+    } catch (const std::exception& e) {
+      stepError = e.what();
+    }
+
+    if (!ok) {
+      error = QString("%1:%2: %3").arg(path).arg(number).arg(stepError);
+      transaction.reset();
+      waitForRefresh(core);
+      return false;
+    }
+  }
+
+  transaction.reset();
+  waitForRefresh(core);
+
+  core.currentProfile()->writeModlistNow(true);
+  core.savePluginList();
+
+  return true;
+}
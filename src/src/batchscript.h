@@ -0,0 +1,33 @@
+#ifndef BATCHSCRIPT_H
+#define BATCHSCRIPT_H
+
+#include <QString>
+#include <QTextStream>
+
+class OrganizerCore;
+
+// Runs a script of steps against an instance without ever creating the main
+// window, used by the `batch` command to drive instances from automation.
+//
+// A script is one step per line, arguments are split like a shell would and
+// can be quoted; empty lines and lines starting with '#' are ignored:
+//
+//   install ARCHIVE [NAME]   installs an archive as a mod, named NAME if given
+//   enable MOD...            enables the given mods in the current profile
+//   disable MOD...           disables the given mods in the current profile
+//   sort                     sorts the plugins with LOOT
+//   refresh                  refreshes the directory structure
+//   run NAME [ARG...]        runs a configured executable or a binary on disk
+//                            with the VFS mounted and waits for it
+//
+// Consecutive install, enable and disable steps share one refresh, which is
+// done before the first step that needs an up to date directory structure.
+//
+// Steps run in order and the script stops at the first one that fails.
+//
+// returns false with `error` set to the line that failed and why
+//
+bool runBatchScript(OrganizerCore& core, const QString& path, QTextStream& out,
+                    QString& error);
+
+#endif  // BATCHSCRIPT_H
@@ -1,10 +1,12 @@
 #include "commandline.h"
+#include "batchscript.h"
 #include "env.h"
 #include "instancemanager.h"
 #include "loglist.h"
 #include "messagedialog.h"
 #include "multiprocess.h"
 #include "organizercore.h"
+#include "refreshbenchmark.h"
 #include "shared/appconfig.h"
 #include "shared/util.h"
 #include <log.h>
@@ -55,8 +57,8 @@ CommandLine::CommandLine() : m_command(nullptr)
   createOptions();
 
   add<RunCommand, ReloadPluginCommand, DownloadFileCommand, RefreshCommand,
-      CrashDumpCommand, LaunchCommand, CreatePortableCommand,
-      ListInstancesCommand, InfoCommand>();
+      BenchmarkRefreshCommand, BatchCommand, CrashDumpCommand, LaunchCommand,
+      CreatePortableCommand, ListInstancesCommand, InfoCommand>();
 }
 
 std::optional<int> CommandLine::process(const std::wstring& line)
@@ -923,6 +925,134 @@ std::optional<int> RefreshCommand::runPostOrganizer(OrganizerCore& core)
   return {};
 }
 
+Command::Meta BenchmarkRefreshCommand::meta() const
+{
+  return {"benchmark-refresh", "times refreshes of a recorded file listing",
+          "[options] LISTING",
+          "Recreates the files of a listing written with \"Write To File\" in the\n"
+          "data tab as empty mods and times refreshing them with the given\n"
+          "thread counts, starting from a cold scan cache every time."};
+}
+
+po::options_description BenchmarkRefreshCommand::getVisibleOptions() const
+{
+  po::options_description d;
+
+  d.add_options()
+      ("threads", po::value<std::string>()->default_value("1,2,4,8"),
+       "comma-separated thread counts")
+      ("runs", po::value<int>()->default_value(3), "warm runs per thread count")
+      ("target", po::value<std::string>(),
+       "directory to recreate the files in and keep them, a temporary one if not "
+       "given")
+      ("keep", "keep the temporary directory");
+
+  return d;
+}
+
+po::options_description BenchmarkRefreshCommand::getInternalOptions() const
+{
+  po::options_description d;
+
+  d.add_options()("LISTING", po::value<std::string>()->required(), "file listing");
+
+  return d;
+}
+
+po::positional_options_description BenchmarkRefreshCommand::getPositional() const
+{
+  po::positional_options_description d;
+
+  d.add("LISTING", 1);
+
+  return d;
+}
+
+std::optional<int> BenchmarkRefreshCommand::runPostOrganizer(OrganizerCore& core)
+{
+  env::Console console;
+
+  RefreshBenchmarkOptions options;
+  options.dump = QString::fromStdString(vm()["LISTING"].as<std::string>());
+  options.runs = std::max(vm()["runs"].as<int>(), 0);
+  options.keep = vm().count("keep") > 0;
+
+  if (vm().count("target")) {
+    options.target = QString::fromStdString(vm()["target"].as<std::string>());
+  }
+
+  options.threads.clear();
+  const auto threads = QString::fromStdString(vm()["threads"].as<std::string>());
+  for (const auto& s : threads.split(',', Qt::SkipEmptyParts)) {
+    bool ok     = false;
+    const int n = s.trimmed().toInt(&ok);
+    if (!ok || n < 1) {
+      std::cerr << "invalid thread count '" << s.toStdString() << "'\n";
+      return 1;
+    }
+    options.threads.push_back(static_cast<std::size_t>(n));
+  }
+
+  QTextStream out(stdout);
+  QString error;
+  if (!runRefreshBenchmark(core, options, out, error)) {
+    std::cerr << error.toStdString() << "\n";
+    return 1;
+  }
+
+  return 0;
+}
+
+Command::Meta BatchCommand::meta() const
+{
+  return {"batch", "runs a script of steps and exits", "SCRIPT",
+          "Runs the steps in SCRIPT, one per line, against the instance without\n"
+          "showing the main window, then exits; \"-\" reads them from stdin.\n"
+          "Steps are:\n"
+          "  install ARCHIVE [NAME]  installs an archive\n"
+          "  enable MOD...           enables mods in the profile\n"
+          "  disable MOD...          disables mods in the profile\n"
+          "  sort                    sorts the plugins with LOOT\n"
+          "  refresh                 refreshes the directory structure\n"
+          "  run NAME [ARG...]       runs an executable or a binary with the VFS\n"
+          "The exit code is 1 if a step failed, the remaining steps are skipped."};
+}
+
+po::options_description BatchCommand::getInternalOptions() const
+{
+  po::options_description d;
+
+  d.add_options()("SCRIPT", po::value<std::string>()->required(), "script file");
+
+  return d;
+}
+
+po::positional_options_description BatchCommand::getPositional() const
+{
+  po::positional_options_description d;
+
+  d.add("SCRIPT", 1);
+
+  return d;
+}
+
+std::optional<int> BatchCommand::runPostOrganizer(OrganizerCore& core)
+{
+  env::Console console;
+
+  const auto script = QString::fromStdString(vm()["SCRIPT"].as<std::string>());
+
+  QTextStream out(stdout);
+  QString error;
+  if (!runBatchScript(core, script, out, error)) {
+    out.flush();
+    std::cerr << error.toStdString() << "\n";
+    return 1;
+  }
+
+  return 0;
+}
+
 Command::Meta CreatePortableCommand::meta() const
 {
   return {"create-portable", "creates a portable MO2 instance", "[options]",
@@ -231,6 +231,34 @@ protected:
   std::optional<int> runPostOrganizer(OrganizerCore& core) override;
 };
 
+// replays a file listing through the directory refresher, see
+// refreshbenchmark.h
+//
+class BenchmarkRefreshCommand : public Command
+{
+protected:
+  Meta meta() const override;
+
+  po::options_description getVisibleOptions() const override;
+  po::options_description getInternalOptions() const override;
+  po::positional_options_description getPositional() const override;
+
+  std::optional<int> runPostOrganizer(OrganizerCore& core) override;
+};
+
+// runs a script of steps without the main window, see batchscript.h
+//
+class BatchCommand : public Command
+{
+protected:
+  Meta meta() const override;
+
+  po::options_description getInternalOptions() const override;
+  po::positional_options_description getPositional() const override;
+
+  std::optional<int> runPostOrganizer(OrganizerCore& core) override;
+};
+
 // creates a portable MO2 instance with directory structure and config
 //
 class CreatePortableCommand : public Command
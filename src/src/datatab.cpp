@@ -38,8 +38,10 @@ DataTab::DataTab(OrganizerCore& core, PluginContainer& pc, QWidget* parent,
     m->setDynamicSortFilter(false);
   }
 
-  connect(&m_filter, &FilterWidget::aboutToChange, [&] {
-    ensureFullyLoaded();
+  connect(&m_filter, &FilterWidget::changed, [&] {
+    if (!m_filter.empty()) {
+      loadForFilter();
+    }
   });
 
   connect(ui.refresh, &QPushButton::clicked, [&] {
@@ -72,8 +74,6 @@ DataTab::DataTab(OrganizerCore& core, PluginContainer& pc, QWidget* parent,
   connect(m_filetree.get(), &FileTree::executablesChanged, this,
           &DataTab::executablesChanged);
 
-  connect(m_filetree.get(), &FileTree::originModified, this, &DataTab::originModified);
-
   connect(m_filetree.get(), &FileTree::displayModInformation, this,
           &DataTab::displayModInformation);
 }
@@ -138,22 +138,25 @@ void DataTab::doUpdateTree()
   m_filetree->refresh();
 
   if (!m_filter.empty()) {
-    ensureFullyLoaded();
-
-    if (auto* m = m_filter.proxyModel()) {
-      m->invalidate();
-    }
+    loadForFilter();
   }
 
   m_needUpdate = false;
 }
 
-void DataTab::ensureFullyLoaded()
+void DataTab::loadForFilter()
 {
-  if (!m_filetree->fullyLoaded()) {
-    m_filter.setFilteringEnabled(false);
-    m_filetree->ensureFullyLoaded();
-    m_filter.setFilteringEnabled(true);
+  // only the directories with matches are loaded instead of the whole tree;
+  // the filter has already been applied to the items that were there, it's
+  // applied again once the new ones are in
+  m_filter.setFilteringEnabled(false);
+  m_filetree->ensureLoadedForSearch([&](const QString& name) {
+    return m_filter.matches(name);
+  });
+  m_filter.setFilteringEnabled(true);
+
+  if (auto* m = m_filter.proxyModel()) {
+    m->invalidate();
   }
 }
 
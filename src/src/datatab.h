@@ -42,7 +42,6 @@ public:
 
 signals:
   void executablesChanged();
-  void originModified(int originID);
   void displayModInformation(ModInfo::Ptr m, unsigned int i, ModInfoTabIDs tab);
 
 private:
@@ -72,7 +71,7 @@ private:
   void onArchives();
   void onHiddenFiles();
   void updateOptions();
-  void ensureFullyLoaded();
+  void loadForFilter();
   bool isActive() const;
   void doUpdateTree();
 };
@@ -0,0 +1,114 @@
+#include "dircopy.h"
+#include "vfs/fileclone.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrent/QtConcurrentMap>
+#include <log.h>
+
+bool cloneFile(const QString& source, const QString& destination)
+{
+  const QByteArray destinationName = QFile::encodeName(destination);
+
+  const int src = open(QFile::encodeName(source).constData(), O_RDONLY | O_CLOEXEC);
+  if (src < 0) {
+    MOBase::log::warn("Failed to open '{}': {}", source, strerror(errno));
+    return false;
+  }
+
+  struct stat st;
+  const mode_t mode = fstat(src, &st) == 0 ? (st.st_mode & 07777) : 0644;
+
+  const int dst = open(destinationName.constData(),
+                       O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, mode);
+  if (dst < 0) {
+    MOBase::log::warn("Failed to create '{}': {}", destination, strerror(errno));
+    close(src);
+    return false;
+  }
+
+  int err = cloneFileContents(src, dst);
+  if (err == 0) {
+    const timespec times[2] = {st.st_atim, st.st_mtim};
+    if (futimens(dst, times) != 0) {
+      err = errno;
+    }
+  }
+  if (close(dst) != 0 && err == 0) {
+    err = errno;
+  }
+  close(src);
+
+  if (err != 0) {
+    MOBase::log::warn("Failed copying '{}' to '{}': {}", source, destination,
+                      strerror(err));
+    unlink(destinationName.constData());
+    return false;
+  }
+
+  return true;
+}
+
+bool copyDirectory(const QString& source, const QString& destination, bool merge)
+{
+  if (!QFileInfo(source).isDir()) {
+    return false;
+  }
+
+  if (QFileInfo::exists(destination) && !merge) {
+    return false;
+  }
+
+  if (!QDir().mkpath(destination)) {
+    MOBase::log::warn("Failed to create '{}'", destination);
+    return false;
+  }
+
+  const QDir sourceDir(source);
+  std::vector<std::pair<QString, QString>> files;
+  bool ok = true;
+
+  // the iterator doesn't follow symlinked directories, they're skipped below
+  // so they aren't created as empty directories either
+  QDirIterator it(source, QDir::AllEntries | QDir::Hidden | QDir::System |
+                              QDir::NoDotAndDotDot,
+                  QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    it.next();
+    const QFileInfo info = it.fileInfo();
+    const QString target =
+        destination + "/" + sourceDir.relativeFilePath(info.filePath());
+
+    if (info.isDir()) {
+      if (!info.isSymLink() && !QDir().mkpath(target)) {
+        MOBase::log::warn("Failed to create '{}'", target);
+        ok = false;
+      }
+    } else if (!merge || !QFileInfo::exists(target)) {
+      files.emplace_back(info.absoluteFilePath(), target);
+    }
+  }
+
+  // cloning is mostly waiting for the filesystem, which takes requests for
+  // different files at the same time
+  std::atomic<bool> copied = true;
+  QtConcurrent::blockingMap(files, [&](const std::pair<QString, QString>& file) {
+    if (!cloneFile(file.first, file.second)) {
+      copied = false;
+    }
+  });
+
+  return ok && copied;
+}
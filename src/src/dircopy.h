@@ -0,0 +1,23 @@
+#ifndef DIRCOPY_H
+#define DIRCOPY_H
+
+#include <QString>
+
+// Copies `source` to the new file `destination` with its permissions and
+// times, through cloneFileContents() so it's a reflink where the filesystem
+// supports it.  Fails if `destination` exists; a partially written copy is
+// removed again.
+//
+bool cloneFile(const QString& source, const QString& destination);
+
+// Copies the tree below `source` to `destination` like MOBase::copyDir():
+// symlinked directories are left out and `destination` must not exist unless
+// `merge` is set, files that already exist there are kept.  The directories
+// are created first, the files are then cloned in parallel; on btrfs or XFS a
+// backup of a large mod only shares extents instead of duplicating them.
+//
+// Returns false if any file couldn't be copied, the others are still copied.
+//
+bool copyDirectory(const QString& source, const QString& destination, bool merge);
+
+#endif  // DIRCOPY_H
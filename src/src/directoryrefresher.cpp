@@ -22,8 +22,12 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "shared/filesorigin.h"
 
 #include "envfs.h"
+#ifndef _WIN32
+#include "fuseconnector.h"
+#endif
 #include "game_features.h"
 #include "iplugingame.h"
+#include "modimage.h"
 #include "modinfo.h"
 #include "modinfodialogfwd.h"
 #include "organizercore.h"
@@ -31,13 +35,19 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "settings.h"
 #include "shared/util.h"
 #include "utility.h"
+#include "vfs/layercache.h"
+#include "vfs/taskpool.h"
 
 #include <gameplugins.h>
+#include <memoryusage.h>
 
 #include <QApplication>
 #include <QDir>
+#include <QFileInfo>
 #include <QString>
+#include <QTextStream>
 
+#include <filesystem>
 #include <fstream>
 
 using namespace MOBase;
@@ -161,10 +171,89 @@ void dumpStats(std::vector<DirectoryStats>& stats)
   ++run;
 }
 
+namespace
+{
+std::mutex g_lastReportMutex;
+RefreshReport g_lastReport;
+
+// directories kept in the report, per mod and overall
+constexpr std::size_t ReportedDirectories = 20;
+
+// number of files in `d` and below; directories with files are added to `out`
+std::size_t countFiles(const env::Directory& d, const std::wstring& path,
+                       std::vector<std::pair<std::size_t, std::wstring>>& out)
+{
+  std::size_t count = d.files.size();
+
+  if (!d.files.empty()) {
+    out.emplace_back(d.files.size(), path);
+  }
+
+  for (const auto& sd : d.dirs) {
+    count += countFiles(sd, path.empty() ? sd.name : path + L"\\" + sd.name, out);
+  }
+
+  return count;
+}
+
+void keepBiggest(std::vector<RefreshReport::Directory>& dirs)
+{
+  const auto n = std::min(dirs.size(), ReportedDirectories);
+
+  std::partial_sort(dirs.begin(), dirs.begin() + n, dirs.end(), [](auto&& a, auto&& b) {
+    return a.files > b.files;
+  });
+
+  dirs.resize(n);
+}
+}  // namespace
+
+QString RefreshReport::toText() const
+{
+  const auto ms = [](Duration d) {
+    return QString::number(d.count() / 1000.0 / 1000.0, 'f', 1);
+  };
+
+  auto sorted = mods;
+  std::sort(sorted.begin(), sorted.end(), [](auto&& a, auto&& b) {
+    return a.total() > b.total();
+  });
+
+  QString s;
+  QTextStream out(&s);
+
+  out << "refresh of " << sorted.size() << " mods took " << ms(total) << " ms, "
+      << finished.toString(Qt::ISODate) << "\n\n";
+
+  out << "mod\ttotal ms\twalk ms\tarchives ms\tmerge ms\tqueued ms\tfiles\t"
+         "archives\n";
+
+  for (const auto& m : sorted) {
+    out << m.name << "\t" << ms(m.total()) << "\t" << ms(m.walk) << "\t"
+        << ms(m.archives) << "\t" << ms(m.merge) << "\t" << ms(m.queued) << "\t"
+        << m.files << "\t" << m.archiveCount << "\n";
+  }
+
+  out << "\ndirectory\tmod\tfiles\n";
+
+  for (const auto& d : directories) {
+    out << d.path << "\t" << d.mod << "\t" << d.files << "\n";
+  }
+
+  out.flush();
+  return s;
+}
+
 DirectoryRefresher::DirectoryRefresher(OrganizerCore* core, std::size_t threadCount)
     : m_Core(*core), m_threadCount(threadCount), m_lastFileCount(0)
 {}
 
+RefreshReport DirectoryRefresher::lastReport()
+{
+  std::scoped_lock lock(g_lastReportMutex);
+  return g_lastReport;
+}
+
 DirectoryEntry* DirectoryRefresher::stealDirectoryStructure()
 {
   QMutexLocker locker(&m_RefreshLock);
@@ -173,10 +262,12 @@ DirectoryEntry* DirectoryRefresher::stealDirectoryStructure()
 
 void DirectoryRefresher::setMods(
     const std::vector<std::tuple<QString, QString, int>>& mods,
-    const std::set<QString>& managedArchives)
+    const std::set<QString>& managedArchives, LayerCheck check)
 {
   QMutexLocker locker(&m_RefreshLock);
 
+  m_LayerCheck = check;
+
   m_Mods.clear();
   for (auto mod = mods.begin(); mod != mods.end(); ++mod) {
     QString name       = std::get<0>(*mod);
@@ -204,6 +295,14 @@ void DirectoryRefresher::cleanStructure(DirectoryEntry* structure)
   }
 }
 
+// archive indices are kept next to the scan cache of the instance
+std::shared_ptr<ArchiveIndexCache> archiveIndexCache()
+{
+  const std::filesystem::path scanCache =
+      layerCachePath(Settings::instance().paths().overwrite().toStdString());
+  return sharedArchiveIndexCache(scanCache.parent_path().wstring());
+}
+
 void DirectoryRefresher::addModBSAToStructure(DirectoryEntry* root,
                                               const QString& modName, int priority,
                                               const QString& directory,
@@ -232,10 +331,12 @@ void DirectoryRefresher::addModBSAToStructure(DirectoryEntry* root,
   }
 
   DirectoryStats dummy;
+  const auto cache = archiveIndexCache();
 
   root->addFromAllBSAs(modName.toStdWString(),
                        QDir::toNativeSeparators(directory).toStdWString(), priority,
-                       archivesW, enabledArchives, lo, dummy);
+                       archivesW, enabledArchives, lo, dummy, cache.get());
+  cache->save();
 }
 
 void DirectoryRefresher::stealModFilesIntoStructure(DirectoryEntry* directoryStructure,
@@ -321,59 +422,156 @@ void DirectoryRefresher::addModToStructure(DirectoryEntry* directoryStructure,
   }
 }
 
-struct ModThread
+// FILETIME counts 100ns intervals since 1601-01-01
+FILETIME toFileTime(std::chrono::system_clock::time_point t)
+{
+  constexpr uint64_t EPOCH_DIFF = 116444736000000000ULL;
+  const auto ticks = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         t.time_since_epoch())
+                         .count() /
+                     100;
+  const uint64_t winTime = static_cast<uint64_t>(ticks) + EPOCH_DIFF;
+
+  FILETIME ft;
+  ft.dwLowDateTime  = static_cast<DWORD>(winTime & 0xFFFFFFFF);
+  ft.dwHighDateTime = static_cast<DWORD>(winTime >> 32);
+  return ft;
+}
+
+// rebuilds the walker's view of a mod from a scanned layer; entries are in
+// depth-first order, so every parent comes right before its contents
+env::Directory directoryFromLayer(const VfsLayer& layer)
+{
+  env::Directory root;
+  std::vector<std::pair<std::string_view, env::Directory*>> stack{{{}, &root}};
+
+  for (const auto& cf : layer.entries) {
+    const std::string_view rel  = cf.relative_path;
+    const size_t slash          = rel.rfind('/');
+    const std::string_view dir  = slash == std::string_view::npos ? std::string_view{}
+                                                                 : rel.substr(0, slash);
+    const std::string_view name = rel.substr(slash == std::string_view::npos ? 0 : slash + 1);
+
+    while (stack.size() > 1 && stack.back().first != dir) {
+      stack.pop_back();
+    }
+    if (stack.back().first != dir) {
+      continue;
+    }
+
+    const std::wstring wname =
+        QString::fromUtf8(name.data(), static_cast<qsizetype>(name.size())).toStdWString();
+    env::Directory* current = stack.back().second;
+
+    if (cf.is_dir) {
+      current->dirs.emplace_back(wname);
+      stack.emplace_back(rel, &current->dirs.back());
+    } else {
+      current->files.emplace_back(wname, toFileTime(cf.mtime), cf.size);
+    }
+  }
+
+  return root;
+}
+
+// reads one mod into its own staging area without touching the shared
+// structure, merge() adds it in afterwards; only the merges are sequential
+struct ModTask
 {
-  GameFeatures* gameFeatures;
   DirectoryRefreshProgress* progress = nullptr;
-  DirectoryEntry* ds                 = nullptr;
   std::wstring modName;
   std::wstring path;
   int prio = -1;
   std::vector<std::wstring> archives;
-  std::set<std::wstring> enabledArchives;
-  std::vector<std::wstring>* loadOrder = nullptr;
-  DirectoryStats* stats                = nullptr;
-  env::DirectoryWalker walker;
+  const std::set<std::wstring>* enabledArchives = nullptr;
+  const std::vector<std::wstring>* loadOrder    = nullptr;
+  VfsLayerCache* layerCache                     = nullptr;
+  LayerCheck layerCheck                         = LayerCheck::Quick;
+  ArchiveIndexCache* archiveCache               = nullptr;
+
+  env::Directory files;
+  std::vector<DirectoryEntry::StagedArchive> stagedArchives;
 
-  std::condition_variable cv;
-  std::mutex mutex;
-  bool ready = false;
+  // filled in by run() when the refresh is reported on
+  RefreshReport::Mod* report = nullptr;
+  std::chrono::steady_clock::time_point submitted;
+  std::vector<RefreshReport::Directory> biggest;
 
-  void wakeup()
+  void run()
   {
-    {
-      std::scoped_lock lock(mutex);
-      ready = true;
+    using Clock        = std::chrono::steady_clock;
+    const auto started = Clock::now();
+    auto walked        = started;
+
+    try {
+      if (layerCache != nullptr) {
+        // the walk itself splits into subtree tasks on the refresher pool
+        const QString qpath = QString::fromStdWString(path);
+        const auto layer    = layerCache->scan(QFileInfo(qpath).fileName().toStdString(),
+                                               qpath.toStdString(), layerCheck);
+        files = directoryFromLayer(*layer);
+      } else if (QDir(QString::fromStdWString(path)).exists()) {
+        thread_local env::DirectoryWalker walker;
+        files = env::getFilesAndDirs(walker, path);
+      }
+
+      walked = Clock::now();
+
+      if (Settings::instance().archiveParsing()) {
+        stagedArchives = DirectoryEntry::loadBSAs(archives, *enabledArchives,
+                                                  *loadOrder, archiveCache);
+      }
+    } catch (const std::exception& e) {
+      log::error("failed to read mod '{}': {}", QString::fromStdWString(modName),
+                 e.what());
     }
 
-    cv.notify_one();
-  }
+    if (report) {
+      const auto indexed = Clock::now();
 
-  void run()
-  {
-    std::unique_lock lock(mutex);
-    cv.wait(lock, [&] {
-      return ready;
-    });
+      report->queued       = started - submitted;
+      report->walk         = walked - started;
+      report->archives     = indexed - walked;
+      report->archiveCount = stagedArchives.size();
 
-    SetThisThreadName(QString::fromStdWString(modName + L" refresher"));
-    ds->addFromOrigin(walker, modName, path, prio, *stats);
+      std::vector<std::pair<std::size_t, std::wstring>> dirs;
+      report->files = countFiles(files, {}, dirs);
 
-    if (Settings::instance().archiveParsing()) {
-      ds->addFromAllBSAs(modName, path, prio, archives, enabledArchives, *loadOrder,
-                         *stats);
+      for (auto&& [count, dir] : dirs) {
+        biggest.push_back({report->name, QString::fromStdWString(dir), count});
+      }
+      keepBiggest(biggest);
     }
 
     if (progress) {
       progress->addDone();
     }
+  }
+
+  void merge(DirectoryEntry* ds, DirectoryStats& stats)
+  {
+    ds->addFromStaged(modName, path, files, stagedArchives, prio, stats);
 
-    SetThisThreadName(QString::fromStdWString(L"idle refresher"));
-    ready = false;
+    files          = {};
+    stagedArchives = {};
   }
 };
 
-env::ThreadPool<ModThread> g_threads;
+// shared by every refresh, recreated when the configured thread count
+// changes; a refresh still running keeps the old pool alive
+std::shared_ptr<VfsTaskPool> refresherPool(std::size_t threadCount)
+{
+  static std::mutex mutex;
+  static std::shared_ptr<VfsTaskPool> pool;
+
+  threadCount = std::max<std::size_t>(threadCount, 1);
+
+  std::scoped_lock lock(mutex);
+  if (pool == nullptr || pool->threadCount() != threadCount) {
+    pool = std::make_shared<VfsTaskPool>(threadCount);
+  }
+  return pool;
+}
 
 void DirectoryRefresher::updateProgress(const DirectoryRefreshProgress* p)
 {
@@ -381,18 +579,42 @@ void DirectoryRefresher::updateProgress(const DirectoryRefreshProgress* p)
   emit progress(p);
 }
 
+void DirectoryRefresher::setLayerCache(std::shared_ptr<VfsLayerCache> cache)
+{
+  m_layerCache = std::move(cache);
+}
+
 void DirectoryRefresher::addMultipleModsFilesToStructure(
     MOShared::DirectoryEntry* directoryStructure, const std::vector<EntryInfo>& entries,
-    DirectoryRefreshProgress* progress)
+    DirectoryRefreshProgress* progress, RefreshReport* report, LayerCheck check)
 {
   std::vector<DirectoryStats> stats(entries.size());
 
+  if (report) {
+    report->mods.resize(entries.size());
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+      report->mods[i].name = entries[i].modName;
+    }
+  }
+
   if (progress) {
     progress->start(entries.size());
   }
 
   log::debug("refresher: using {} threads", m_threadCount);
-  g_threads.setMax(m_threadCount);
+  const auto pool = refresherPool(m_threadCount);
+  VfsTaskPool::Group group;
+  std::vector<ModTask> tasks(entries.size());
+
+  // mods are listed from the persisted scan cache, only directories that
+  // changed since the last run are walked again
+  auto layerCache =
+      m_layerCache != nullptr
+          ? m_layerCache
+          : sharedLayerCache(Settings::instance().paths().overwrite().toStdString());
+
+  // and archives from the index cache, only the ones that changed are read
+  const auto archiveCache = archiveIndexCache();
 
   std::vector<std::wstring> loadOrder;
   if (Settings::instance().archiveParsing()) {
@@ -406,14 +628,61 @@ void DirectoryRefresher::addMultipleModsFilesToStructure(
     }
   }
 
+  std::set<std::wstring> enabledArchives;
+  for (auto&& a : m_EnabledArchives) {
+    enabledArchives.insert(a.toStdWString());
+  }
+
   for (std::size_t i = 0; i < entries.size(); ++i) {
-    const auto& e  = entries[i];
-    const int prio = e.priority + 1;
+    const auto& e = entries[i];
 
-    if constexpr (DirectoryStats::EnableInstrumentation) {
-      stats[i].mod = entries[i].modName.toStdString();
+    if (e.stealFiles.length() > 0) {
+      // only moves existing files, done in order with the merges below
+      continue;
     }
 
+    // packed mods are read from their mounted image
+    const QString path = modFilesPath(e.absolutePath);
+
+    auto& mt = tasks[i];
+
+    mt.progress = progress;
+    mt.modName  = e.modName.toStdWString();
+    mt.path     = QDir::toNativeSeparators(path).toStdWString();
+    mt.prio     = e.priority + 1;
+
+    for (auto&& a : e.archives) {
+      mt.archives.push_back(a.toStdWString());
+    }
+
+    mt.enabledArchives = &enabledArchives;
+    mt.loadOrder       = &loadOrder;
+    mt.layerCache      = layerCache.get();
+    mt.layerCheck      = check;
+    mt.archiveCache    = archiveCache.get();
+
+    if (report) {
+      mt.report    = &report->mods[i];
+      mt.submitted = std::chrono::steady_clock::now();
+    }
+
+    pool->submit(group, [&mt] {
+      mt.run();
+    });
+  }
+
+  // the refresher thread runs tasks too while it waits
+  pool->wait(group);
+  layerCache->save();
+  archiveCache->save();
+
+  // entries are sorted by priority, so every mod is merged over the ones it
+  // overrides, without any locking
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    const auto& e      = entries[i];
+    const int prio     = e.priority + 1;
+    const auto started = std::chrono::steady_clock::now();
+
     try {
       if (e.stealFiles.length() > 0) {
         stealModFilesIntoStructure(directoryStructure, e.modName, prio, e.absolutePath,
@@ -423,36 +692,25 @@ void DirectoryRefresher::addMultipleModsFilesToStructure(
           progress->addDone();
         }
       } else {
-        auto& mt = g_threads.request();
-
-        mt.gameFeatures = &m_Core.gameFeatures();
-        mt.progress     = progress;
-        mt.ds           = directoryStructure;
-        mt.modName      = e.modName.toStdWString();
-        mt.path         = QDir::toNativeSeparators(e.absolutePath).toStdWString();
-        mt.prio         = prio;
-
-        mt.archives.clear();
-        for (auto&& a : e.archives) {
-          mt.archives.push_back(a.toStdWString());
-        }
-
-        mt.enabledArchives.clear();
-        for (auto&& a : m_EnabledArchives) {
-          mt.enabledArchives.insert(a.toStdWString());
-        }
-
-        mt.loadOrder = &loadOrder;
-        mt.stats     = &stats[i];
-
-        mt.wakeup();
+        tasks[i].merge(directoryStructure, stats[i]);
       }
     } catch (const std::exception& ex) {
       emit error(tr("failed to read mod (%1): %2").arg(e.modName, ex.what()));
     }
-  }
 
-  g_threads.waitForAll();
+    if (report) {
+      report->mods[i].merge = std::chrono::steady_clock::now() - started;
+
+      auto& biggest = tasks[i].biggest;
+      report->directories.insert(report->directories.end(), biggest.begin(),
+                                 biggest.end());
+      keepBiggest(report->directories);
+    }
+
+    if constexpr (DirectoryStats::EnableInstrumentation) {
+      stats[i].mod = e.modName.toStdString();
+    }
+  }
 
   if constexpr (DirectoryStats::EnableInstrumentation) {
     dumpStats(stats);
@@ -465,6 +723,9 @@ void DirectoryRefresher::refresh()
   TimeThis tt("DirectoryRefresher::refresh()");
   auto* p = new DirectoryRefreshProgress(this);
 
+  const auto started = std::chrono::steady_clock::now();
+  RefreshReport report;
+
   {
     QMutexLocker locker(&m_RefreshLock);
 
@@ -482,7 +743,20 @@ void DirectoryRefresher::refresh()
 
     {
       DirectoryStats dummy;
+#ifndef _WIN32
+      // a vfs kept mounted after a launch hides the real files, they're read
+      // from below the mount instead
+      if (const QString backing = FuseConnector::backingDirectory(dataPath);
+          !backing.isEmpty()) {
+        log::debug("refresher: reading data directory from '{}'", backing);
+        env::Directory files = env::getFilesAndDirs(backing.toStdWString());
+        m_Root->addFromList(L"data", dataDirectory, files, 0, dummy);
+      } else {
+        m_Root->addFromOrigin(L"data", dataDirectory, 0, dummy);
+      }
+#else
       m_Root->addFromOrigin(L"data", dataDirectory, 0, dummy);
+#endif
     }
 
     for (auto directory : game->secondaryDataDirectories().toStdMap()) {
@@ -497,7 +771,7 @@ void DirectoryRefresher::refresh()
       return lhs.priority < rhs.priority;
     });
 
-    addMultipleModsFilesToStructure(m_Root.get(), m_Mods, p);
+    addMultipleModsFilesToStructure(m_Root.get(), m_Mods, p, &report, m_LayerCheck);
 
     m_Root->getFileRegister()->sortOrigins();
 
@@ -505,6 +779,22 @@ void DirectoryRefresher::refresh()
 
     m_lastFileCount = m_Root->getFileRegister()->highestCount();
     log::debug("refresher saw {} files", m_lastFileCount);
+
+    std::size_t directories = 0;
+    const std::size_t bytes = m_Root->memoryUsage(directories);
+    memory::report("directory structure", static_cast<qint64>(bytes),
+                   static_cast<qint64>(directories));
+    memory::report("file register",
+                   static_cast<qint64>(m_Root->getFileRegister()->memoryUsage()),
+                   static_cast<qint64>(m_lastFileCount));
+  }
+
+  report.total    = std::chrono::steady_clock::now() - started;
+  report.finished = QDateTime::currentDateTime();
+
+  {
+    std::scoped_lock lock(g_lastReportMutex);
+    g_lastReport = std::move(report);
   }
 
   p->finish();
@@ -23,14 +23,70 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "profile.h"
 #include "shared/directoryentry.h"
 #include "shared/fileregisterfwd.h"
+#include "vfs/vfstree.h"
+#include <QDateTime>
 #include <QMutex>
 #include <QObject>
 #include <QStringList>
+#include <chrono>
+#include <memory>
 #include <set>
 #include <tuple>
 #include <vector>
 
 class OrganizerCore;
+class VfsLayerCache;
+
+/**
+ * @brief where the time of a refresh went, mod by mod
+ **/
+struct RefreshReport
+{
+  using Duration = std::chrono::nanoseconds;
+
+  struct Mod
+  {
+    QString name;
+
+    // waiting for a thread of the pool after the refresh started
+    Duration queued{};
+
+    // listing the loose files, from the scan cache when possible
+    Duration walk{};
+
+    // indexing the enabled archives, from the archive cache when possible
+    Duration archives{};
+
+    // adding everything to the structure, done one mod at a time
+    Duration merge{};
+
+    // loose files only, archives are counted as one each
+    std::size_t files        = 0;
+    std::size_t archiveCount = 0;
+
+    Duration total() const { return walk + archives + merge; }
+  };
+
+  struct Directory
+  {
+    QString mod;
+    QString path;
+    std::size_t files = 0;
+  };
+
+  Duration total{};
+  QDateTime finished;
+
+  std::vector<Mod> mods;
+
+  // the directories with the most files directly in them, most first
+  std::vector<Directory> directories;
+
+  bool empty() const { return mods.empty(); }
+
+  // plain text with the slowest mods and biggest directories first
+  QString toText() const;
+};
 
 /**
  * @brief used to asynchronously generate the virtual view of the combined data
@@ -72,9 +128,12 @@ public:
    * @brief sets up the mods to be included in the directory structure
    *
    * @param mods list of the mods to include
+   * @param check how closely the next refresh checks cached scans of the mods
+   *        against the disk, see layerIsCurrent()
    **/
   void setMods(const std::vector<std::tuple<QString, QString, int>>& mods,
-               const std::set<QString>& managedArchives);
+               const std::set<QString>& managedArchives,
+               LayerCheck check = LayerCheck::Quick);
 
   /**
    * @brief sets up the directory where mods are stored
@@ -130,10 +189,24 @@ public:
 
   void addMultipleModsFilesToStructure(MOShared::DirectoryEntry* directoryStructure,
                                        const std::vector<EntryInfo>& entries,
-                                       DirectoryRefreshProgress* progress = nullptr);
+                                       DirectoryRefreshProgress* progress = nullptr,
+                                       RefreshReport* report              = nullptr,
+                                       LayerCheck check = LayerCheck::Quick);
+
+  /**
+   * @brief the report of the last refresh that finished, empty if none did;
+   * can be called from any thread
+   **/
+  static RefreshReport lastReport();
 
   void updateProgress(const DirectoryRefreshProgress* p);
 
+  /**
+   * @brief sets the scan cache mods are listed from, the one of the instance
+   * is used if none was set
+   **/
+  void setLayerCache(std::shared_ptr<VfsLayerCache> cache);
+
 public slots:
 
   /**
@@ -152,10 +225,12 @@ private:
 
   std::vector<EntryInfo> m_Mods;
   std::set<QString> m_EnabledArchives;
+  LayerCheck m_LayerCheck = LayerCheck::Quick;
   std::unique_ptr<MOShared::DirectoryEntry> m_Root;
   QMutex m_RefreshLock;
   std::size_t m_threadCount;
   std::size_t m_lastFileCount;
+  std::shared_ptr<VfsLayerCache> m_layerCache;
 
   void stealModFilesIntoStructure(MOShared::DirectoryEntry* directoryStructure,
                                   const QString& modName, int priority,
@@ -37,6 +37,11 @@ DownloadList::DownloadList(OrganizerCore& core, QObject* parent)
 {
   connect(&m_manager, SIGNAL(update(int)), this, SLOT(update(int)));
   connect(&m_manager, SIGNAL(aboutToUpdate()), this, SLOT(aboutToUpdate()));
+  connect(&m_manager, SIGNAL(aboutToInsert(int)), this, SLOT(aboutToInsert(int)));
+  connect(&m_manager, SIGNAL(inserted()), this, SLOT(inserted()));
+  connect(&m_manager, SIGNAL(aboutToRemove(int)), this, SLOT(aboutToRemove(int)));
+  connect(&m_manager, SIGNAL(removed()), this, SLOT(removed()));
+  connect(&m_manager, SIGNAL(progressChanged(int)), this, SLOT(progressChanged(int)));
 }
 
 int DownloadList::rowCount(const QModelIndex& parent) const
@@ -256,6 +261,34 @@ void DownloadList::update(int row)
     log::error("invalid row {} in download list, update failed", row);
 }
 
+void DownloadList::aboutToInsert(int row)
+{
+  beginInsertRows(QModelIndex(), row, row);
+}
+
+void DownloadList::inserted()
+{
+  endInsertRows();
+}
+
+void DownloadList::aboutToRemove(int row)
+{
+  beginRemoveRows(QModelIndex(), row, row);
+}
+
+void DownloadList::removed()
+{
+  endRemoveRows();
+}
+
+void DownloadList::progressChanged(int row)
+{
+  if (row < rowCount()) {
+    emit dataChanged(index(row, COL_STATUS, QModelIndex()),
+                     index(row, COL_SIZE, QModelIndex()));
+  }
+}
+
 bool DownloadList::lessThanPredicate(const QModelIndex& left, const QModelIndex& right)
 {
   int leftIndex  = left.row();
@@ -94,6 +94,16 @@ public slots:
 
   void aboutToUpdate();
 
+  void aboutToInsert(int row);
+  void inserted();
+  void aboutToRemove(int row);
+  void removed();
+
+  /**
+   * @brief only repaints the progress and size of the row that changed
+   **/
+  void progressChanged(int row);
+
 private:
   DownloadManager& m_manager;
   Settings& m_settings;
@@ -359,9 +359,29 @@ void DownloadListView::keyPressEvent(QKeyEvent* event)
   QTreeView::keyPressEvent(event);
 }
 
+QList<int> DownloadListView::selectedInstallableRows() const
+{
+  auto* proxy = qobject_cast<QSortFilterProxyModel*>(model());
+
+  QList<int> rows;
+  for (const QModelIndex& index : selectionModel()->selectedRows()) {
+    const int row = proxy->mapToSource(index).row();
+    if (m_Manager->getState(row) >= DownloadManager::STATE_READY) {
+      rows.append(row);
+    }
+  }
+  return rows;
+}
+
 void DownloadListView::issueInstall(int index)
 {
-  emit installDownload(index);
+  // installing one of several selected downloads installs all of them
+  const QList<int> rows = selectedInstallableRows();
+  if (rows.size() > 1 && rows.contains(index)) {
+    emit installDownloads(rows);
+  } else {
+    emit installDownload(index);
+  }
 }
 
 void DownloadListView::issueQueryInfo(int index)
@@ -79,6 +79,7 @@ public:
 
 signals:
   void installDownload(int index);
+  void installDownloads(const QList<int>& indices);
   void queryInfo(int index);
   void queryInfoMd5(int index);
   void removeDownload(int index, bool deleteFile);
@@ -126,6 +127,9 @@ private:
   DownloadManager* m_Manager;
   DownloadList* m_SourceModel = 0;
 
+  // source rows of the selected downloads that can be installed
+  QList<int> selectedInstallableRows() const;
+
   void resizeEvent(QResizeEvent* event);
 };
 
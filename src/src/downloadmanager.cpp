@@ -20,6 +20,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "downloadmanager.h"
 
 #include "bbcode.h"
+#include "downloadwriter.h"
 #include "envfs.h"
 #include "filesystemutilities.h"
 #include "iplugingame.h"
@@ -30,6 +31,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "selectiondialog.h"
 #include "shared/util.h"
 #include "utility.h"
+#include <memoryusage.h>
 #include <nxmurl.h>
 #include <report.h>
 #include <taskprogressmanager.h>
@@ -45,7 +47,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QTextDocument>
 #include <QTimer>
 
-#include <boost/bind/bind.hpp>
+#include <algorithm>
 #include <regex>
 
 using namespace MOBase;
@@ -56,7 +58,22 @@ using namespace MOBase;
 static const char UNFINISHED[] = ".unfinished";
 
 unsigned int DownloadManager::DownloadInfo::s_NextDownloadID = 1U;
-int DownloadManager::m_DirWatcherDisabler                    = 0;
+
+// writes the data of all the downloads so the user interface doesn't wait on the
+// disk
+//
+static DownloadWriter& downloadWriter()
+{
+  static DownloadWriter writer;
+  return writer;
+}
+
+DownloadManager::DownloadInfo::~DownloadInfo()
+{
+  // the writer may still be using the file and the hasher
+  downloadWriter().forget(&m_Output);
+  delete m_FileInfo;
+}
 
 DownloadManager::DownloadInfo*
 DownloadManager::DownloadInfo::createNew(const ModRepositoryFileInfo* fileInfo,
@@ -82,7 +99,8 @@ DownloadManager::DownloadInfo::createNew(const ModRepositoryFileInfo* fileInfo,
 DownloadManager::DownloadInfo*
 DownloadManager::DownloadInfo::createFromMeta(const QString& filePath, bool showHidden,
                                               const QString outputDirectory,
-                                              std::optional<uint64_t> fileSize)
+                                              std::optional<uint64_t> fileSize,
+                                              const QVariantMap* meta)
 {
   DownloadInfo* info = new DownloadInfo;
 
@@ -92,7 +110,7 @@ DownloadManager::DownloadInfo::createFromMeta(const QString& filePath, bool show
           .compare(QDir::fromNativeSeparators(outputDirectory), Qt::CaseInsensitive) !=
       0)
     return nullptr;
-  QSettings metaFile(metaFileName, QSettings::IniFormat);
+  const QVariantMap metaFile = meta != nullptr ? *meta : readMeta(metaFileName);
   if (!showHidden && metaFile.value("removed", false).toBool()) {
     return nullptr;
   } else {
@@ -153,36 +171,187 @@ DownloadManager::DownloadInfo::createFromMeta(const QString& filePath, bool show
   info->m_FileInfo->uploaderUrl  = metaFile.value("uploaderUrl", "").toString();
   info->m_Reply                  = nullptr;
 
+  // stored once the download finished, see createMetaFile()
+  info->m_Hash = QByteArray::fromHex(metaFile.value("md5", "").toString().toLatin1());
+
+  if (fileName.endsWith(UNFINISHED)) {
+    info->setSegments(metaFile.value("segments", "").toString());
+  }
+
   return info;
 }
 
-ScopedDisableDirWatcher::ScopedDisableDirWatcher(DownloadManager* downloadManager)
+QVariantMap DownloadManager::DownloadInfo::readMeta(const QString& metaFileName)
+{
+  QSettings metaFile(metaFileName, QSettings::IniFormat);
+
+  QVariantMap values;
+  for (const QString& key : metaFile.allKeys()) {
+    values[key] = metaFile.value(key);
+  }
+
+  return values;
+}
+
+qint64 DownloadManager::DownloadInfo::write(const QByteArray& data)
+{
+  if (isSegmented()) {
+    Segment* segment = segmentOf(m_Reply);
+    if (segment == nullptr) {
+      // this part is done, the rest of the file comes from the other segments
+      return data.size();
+    }
+
+    if (writeSegment(*segment, data) < 0) {
+      return -1;
+    }
+
+    if (segment->complete()) {
+      segment->reply = nullptr;
+      QMetaObject::invokeMethod(m_Reply, &QNetworkReply::abort, Qt::QueuedConnection);
+    }
+    return data.size();
+  }
+
+  if (!downloadWriter().write(&m_Output, -1, data, m_Hasher.get(), &m_HashedBytes)) {
+    downloadWriter().wait(&m_Output);
+    m_Hasher.reset();
+    return -1;
+  }
+  return data.size();
+}
+
+qint64 DownloadManager::DownloadInfo::outputSize() const
 {
-  m_downloadManager = downloadManager;
-  m_downloadManager->startDisableDirWatcher();
-  log::debug("Scoped Disable DirWatcher: Started");
+  downloadWriter().wait(&m_Output);
+  return m_Output.size();
 }
 
-ScopedDisableDirWatcher::~ScopedDisableDirWatcher()
+bool DownloadManager::DownloadInfo::closeOutput()
 {
-  m_downloadManager->endDisableDirWatcher();
-  m_downloadManager = nullptr;
-  log::debug("Scoped Disable DirWatcher: Stopped");
+  const bool written = downloadWriter().wait(&m_Output);
+
+  // the file starts over from what's on disk when it's resumed
+  downloadWriter().forget(&m_Output);
+  m_Output.close();
+
+  return written;
 }
 
-void DownloadManager::startDisableDirWatcher()
+void DownloadManager::DownloadInfo::preallocate(qint64 size)
 {
-  DownloadManager::m_DirWatcherDisabler++;
+  if (m_Output.isOpen() && (size > 0)) {
+    downloadWriter().preallocate(&m_Output, size);
+  }
 }
 
-void DownloadManager::endDisableDirWatcher()
+void DownloadManager::DownloadInfo::startHash(bool resume)
 {
-  if (DownloadManager::m_DirWatcherDisabler > 0) {
-    if (DownloadManager::m_DirWatcherDisabler == 1)
-      QCoreApplication::processEvents();
-    DownloadManager::m_DirWatcherDisabler--;
+  const qint64 size = outputSize();
+  if (resume && (m_Hasher != nullptr) && (m_HashedBytes == size)) {
+    return;
+  }
+
+  m_HashedBytes = 0;
+  if (size == 0) {
+    m_Hasher = std::make_unique<QCryptographicHash>(QCryptographicHash::Md5);
   } else {
-    DownloadManager::m_DirWatcherDisabler = 0;
+    m_Hasher.reset();
+  }
+}
+
+void DownloadManager::DownloadInfo::finishHash()
+{
+  if ((m_Hasher != nullptr) && (m_HashedBytes == outputSize())) {
+    m_Hash = m_Hasher->result();
+  }
+  m_Hasher.reset();
+}
+
+bool DownloadManager::DownloadInfo::segmentsComplete() const
+{
+  return std::all_of(m_Segments.begin(), m_Segments.end(), [](const Segment& segment) {
+    return segment.complete();
+  });
+}
+
+qint64 DownloadManager::DownloadInfo::downloadedSize() const
+{
+  if (!isSegmented()) {
+    return outputSize();
+  }
+
+  qint64 missing = 0;
+  for (const Segment& segment : m_Segments) {
+    missing += std::max<qint64>(0, segment.end - segment.pos);
+  }
+  return m_TotalSize - missing;
+}
+
+DownloadManager::DownloadInfo::Segment*
+DownloadManager::DownloadInfo::segmentOf(const QNetworkReply* reply)
+{
+  if (reply == nullptr) {
+    return nullptr;
+  }
+
+  for (Segment& segment : m_Segments) {
+    if (segment.reply == reply) {
+      return &segment;
+    }
+  }
+  return nullptr;
+}
+
+qint64 DownloadManager::DownloadInfo::writeSegment(Segment& segment,
+                                                   const QByteArray& data)
+{
+  const qint64 size = std::min<qint64>(data.size(), segment.end - segment.pos);
+  if (size <= 0) {
+    return 0;
+  }
+
+  if (!downloadWriter().write(&m_Output, segment.pos,
+                              size == data.size() ? data : data.first(size))) {
+    return -1;
+  }
+
+  segment.pos += size;
+  return size;
+}
+
+QString DownloadManager::DownloadInfo::segmentsString() const
+{
+  QStringList result;
+  for (const Segment& segment : m_Segments) {
+    result.append(QString("%1-%2").arg(segment.pos).arg(segment.end));
+  }
+  return result.join(",");
+}
+
+void DownloadManager::DownloadInfo::setSegments(const QString& segments)
+{
+  m_Segments.clear();
+  for (const QString& segment : segments.split(",", Qt::SkipEmptyParts)) {
+    const QStringList bounds = segment.split("-");
+    bool posOk = false, endOk = false;
+    if (bounds.size() == 2) {
+      const qint64 pos = bounds[0].toLongLong(&posOk);
+      const qint64 end = bounds[1].toLongLong(&endOk);
+      if (posOk && endOk) {
+        m_Segments.push_back({pos, end});
+        continue;
+      }
+    }
+
+    log::warn("invalid download segments '{}' for {}", segments, m_FileName);
+    m_Segments.clear();
+    return;
+  }
+
+  // the file is already complete, it only has to be renamed
+  if (segmentsComplete()) {
+    m_Segments.clear();
   }
 }
 
@@ -197,6 +366,7 @@ void DownloadManager::DownloadInfo::setName(QString newName, bool renameFile)
     oldMetaFileName = QString("%1%2.meta").arg(m_FileName).arg(UNFINISHED);
   }
   if (renameFile) {
+    downloadWriter().wait(&m_Output);
     if ((newName != m_Output.fileName()) && !m_Output.rename(newName)) {
       reportError(tr("failed to rename \"%1\" to \"%2\"")
                       .arg(m_Output.fileName())
@@ -225,20 +395,33 @@ QString DownloadManager::DownloadInfo::currentURL()
 }
 
 DownloadManager::DownloadManager(NexusInterface* nexusInterface, QObject* parent)
-    : m_NexusInterface(nexusInterface), m_DirWatcher(), m_ShowHidden(false),
+    : m_NexusInterface(nexusInterface), m_DirWatcher(), m_Listed(false),
+      m_ShowHidden(false),
       m_ParentWidget(nullptr)
 {
   m_OrganizerCore = dynamic_cast<OrganizerCore*>(parent);
-  connect(&m_DirWatcher, SIGNAL(directoryChanged(QString)), this,
-          SLOT(directoryChanged(QString)));
+  connect(&m_DirWatcher, &ModDirectoryWatcher::changed, this,
+          &DownloadManager::directoryChanged);
+  connect(&m_DirWatcher, &ModDirectoryWatcher::overflowed, this,
+          &DownloadManager::refreshList);
   m_TimeoutTimer.setSingleShot(false);
   connect(&m_TimeoutTimer, &QTimer::timeout, this,
           &DownloadManager::checkDownloadTimeout);
   m_TimeoutTimer.start(5 * 1000);
-}
+
+  m_ProgressTimer.setSingleShot(true);
+  m_ProgressTimer.setInterval(1000 / PROGRESS_FPS);
+  connect(&m_ProgressTimer, &QTimer::timeout, this, &DownloadManager::progressTimeout);
+
+  m_HashPool.setMaxThreadCount(HASH_THREADS);
+}
 
 DownloadManager::~DownloadManager()
 {
+  // hashes that weren't started aren't needed anymore
+  m_HashPool.clear();
+  m_HashPool.waitForDone();
+
   for (QVector<DownloadInfo*>::iterator iter = m_ActiveDownloads.begin();
        iter != m_ActiveDownloads.end(); ++iter) {
     delete *iter;
@@ -309,21 +492,20 @@ void DownloadManager::pauseAll()
 void DownloadManager::setOutputDirectory(const QString& outputDirectory,
                                          const bool refresh)
 {
-  QStringList directories = m_DirWatcher.directories();
-  if (directories.length() != 0) {
-    m_DirWatcher.removePaths(directories);
-  }
+  m_DirWatcher.stop();
   m_OutputDirectory = QDir::fromNativeSeparators(outputDirectory);
   if (refresh) {
     refreshList();
   }
-  m_DirWatcher.addPath(m_OutputDirectory);
+  m_DirWatcher.watch({{QString(), m_OutputDirectory}});
 }
 
 void DownloadManager::setShowHidden(bool showHidden)
 {
   m_ShowHidden = showHidden;
-  refreshList();
+  if (m_Listed) {
+    refreshList();
+  }
 }
 
 void DownloadManager::setPluginContainer(PluginContainer* pluginContainer)
@@ -331,14 +513,21 @@ void DownloadManager::setPluginContainer(PluginContainer* pluginContainer)
   m_NexusInterface->setPluginContainer(pluginContainer);
 }
 
+void DownloadManager::ensureListed()
+{
+  if (!m_Listed) {
+    refreshList();
+  }
+}
+
 void DownloadManager::refreshList()
 {
   TimeThis tt("DownloadManager::refreshList()");
 
+  m_Listed = true;
+
   try {
     emit aboutToUpdate();
-    // avoid triggering other refreshes
-    ScopedDisableDirWatcher scopedDirWatcher(this);
 
     int downloadsBefore = m_ActiveDownloads.size();
 
@@ -365,14 +554,35 @@ void DownloadManager::refreshList()
 
     QDir dir(QDir::fromNativeSeparators(m_OutputDirectory));
 
+    // the directory is only listed once, the orphaned meta files and the downloads
+    // are both found from this
+    struct DirEntry
+    {
+      uint64_t size;
+      uint64_t lastModified;
+    };
+
+    std::map<QString, DirEntry> files;
+
+    env::forEachEntry(
+        QDir::toNativeSeparators(m_OutputDirectory).toStdWString(), &files, nullptr,
+        nullptr, [](void* data, std::wstring_view f, FILETIME ft, uint64_t size) {
+          auto& files = *static_cast<std::map<QString, DirEntry>*>(data);
+
+          const uint64_t lastModified =
+              (static_cast<uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+
+          files.emplace(QString::fromWCharArray(f.data(), f.size()),
+                        DirEntry{size, lastModified});
+        });
+
     // find orphaned meta files and delete them (sounds cruel but it's better for
     // everyone)
     QStringList orphans;
-    QStringList metaFiles = dir.entryList(QStringList() << "*.meta");
-    foreach (const QString& metaFile, metaFiles) {
-      QString baseFile = metaFile.left(metaFile.length() - 5);
-      if (!QFile::exists(dir.absoluteFilePath(baseFile))) {
-        orphans.append(dir.absoluteFilePath(metaFile));
+    for (const auto& [name, entry] : files) {
+      if (name.endsWith(".meta", Qt::CaseInsensitive) &&
+          !files.contains(name.left(name.length() - 5))) {
+        orphans.append(dir.absoluteFilePath(name));
       }
     }
     if (orphans.size() > 0) {
@@ -382,61 +592,75 @@ void DownloadManager::refreshList()
 
     std::set<std::wstring> seen;
 
-    struct Context
-    {
-      DownloadManager& self;
-      std::set<std::wstring>& seen;
-      std::vector<std::wstring>& extensions;
-    };
-
-    Context cx = {*this, seen, nameFilters};
-
     for (auto&& d : m_ActiveDownloads) {
-      cx.seen.insert(d->m_FileName.toLower().toStdWString());
-      cx.seen.insert(
+      seen.insert(d->m_FileName.toLower().toStdWString());
+      seen.insert(
           QFileInfo(d->m_Output.fileName()).fileName().toLower().toStdWString());
     }
 
-    env::forEachEntry(
-        QDir::toNativeSeparators(m_OutputDirectory).toStdWString(), &cx, nullptr,
-        nullptr, [](void* data, std::wstring_view f, FILETIME, uint64_t size) {
-          auto& cx = *static_cast<Context*>(data);
-
-          std::wstring lc = MOShared::ToLowerCopy(f);
-
-          bool interestingExt = false;
-          for (auto&& ext : cx.extensions) {
-            if (lc.ends_with(ext)) {
-              interestingExt = true;
-              break;
-            }
-          }
-
-          if (!interestingExt) {
-            return;
-          }
-
-          if (cx.seen.contains(lc)) {
-            return;
-          }
-
-          QString fileName = QDir::fromNativeSeparators(cx.self.m_OutputDirectory) +
-                             "/" + QString::fromWCharArray(f.data(), f.size());
-
-          DownloadInfo* info = DownloadInfo::createFromMeta(
-              fileName, cx.self.m_ShowHidden, cx.self.m_OutputDirectory, size);
-
-          if (info == nullptr) {
-            return;
-          }
-
-          cx.self.m_ActiveDownloads.push_front(info);
-          cx.seen.insert(std::move(lc));
-          cx.seen.insert(
-              QFileInfo(info->m_Output.fileName()).fileName().toLower().toStdWString());
-        });
+    std::map<QString, MetaIndexEntry> metaIndex;
+    std::size_t metaRead = 0;
+
+    for (const auto& [name, entry] : files) {
+      std::wstring lc = name.toLower().toStdWString();
+
+      bool interestingExt = false;
+      for (auto&& ext : nameFilters) {
+        if (lc.ends_with(ext)) {
+          interestingExt = true;
+          break;
+        }
+      }
+
+      if (!interestingExt || seen.contains(lc)) {
+        continue;
+      }
+
+      // the values of the meta file are reused from the last refresh unless it has
+      // been changed since
+      const QString metaName = name + ".meta";
+      QVariantMap meta;
+
+      auto metaFile = files.find(metaName);
+      if (metaFile != files.end()) {
+        auto indexed = m_MetaIndex.find(metaName);
+        if ((indexed != m_MetaIndex.end()) &&
+            (indexed->second.size == metaFile->second.size) &&
+            (indexed->second.lastModified == metaFile->second.lastModified)) {
+          meta = indexed->second.values;
+        } else {
+          meta = DownloadInfo::readMeta(dir.absoluteFilePath(metaName));
+          ++metaRead;
+        }
+
+        metaIndex.emplace(metaName, MetaIndexEntry{metaFile->second.size,
+                                                   metaFile->second.lastModified,
+                                                   meta});
+      }
+
+      const QString fileName =
+          QDir::fromNativeSeparators(m_OutputDirectory) + "/" + name;
+
+      DownloadInfo* info = DownloadInfo::createFromMeta(
+          fileName, m_ShowHidden, m_OutputDirectory, entry.size, &meta);
+
+      if (info == nullptr) {
+        continue;
+      }
+
+      m_ActiveDownloads.push_front(info);
+      seen.insert(std::move(lc));
+      seen.insert(
+          QFileInfo(info->m_Output.fileName()).fileName().toLower().toStdWString());
+    }
+
+    // entries of files that are gone are dropped
+    m_MetaIndex = std::move(metaIndex);
+
+    log::debug("read {} of {} meta files", metaRead, m_MetaIndex.size());
 
     log::debug("saw {} downloads", m_ActiveDownloads.size());
+    reportMemoryUsage();
 
     emit update(-1);
 
@@ -445,6 +669,45 @@ void DownloadManager::refreshList()
   }
 }
 
+void DownloadManager::reportMemoryUsage() const
+{
+  using namespace MOBase::memory;
+
+  // entries of a variant map, the values themselves aren't followed
+  const auto mapBytes = [](const QVariantMap& map) {
+    qint64 bytes = 0;
+    for (auto it = map.begin(); it != map.end(); ++it) {
+      bytes += TreeNodeOverhead + sizeof(QString) + sizeof(QVariant) +
+               heapBytes(it.key());
+    }
+    return bytes;
+  };
+
+  qint64 bytes = m_ActiveDownloads.capacity() * sizeof(DownloadInfo*);
+
+  for (const DownloadInfo* info : m_ActiveDownloads) {
+    bytes += sizeof(DownloadInfo) + heapBytes(info->m_FileName) +
+             heapBytes(info->m_RemoteFileName);
+
+    for (const auto& url : info->m_Urls) {
+      bytes += sizeof(QString) + heapBytes(url);
+    }
+
+    if (const auto* fi = info->m_FileInfo) {
+      bytes += sizeof(*fi) + heapBytes(fi->name) + heapBytes(fi->description) +
+               heapBytes(fi->modName) + heapBytes(fi->fileName) +
+               mapBytes(fi->userData);
+    }
+  }
+
+  for (const auto& [name, entry] : m_MetaIndex) {
+    bytes += TreeNodeOverhead + sizeof(name) + sizeof(entry) + heapBytes(name) +
+             mapBytes(entry.values);
+  }
+
+  report("downloads", bytes, m_ActiveDownloads.size());
+}
+
 void DownloadManager::queryDownloadListInfo()
 {
   int incompleteCount = 0;
@@ -459,19 +722,18 @@ void DownloadManager::queryDownloadListInfo()
           m_ParentWidget, tr("Query Metadata"),
           tr("There are %1 downloads with incomplete metadata.\n\n"
              "Do you want to fetch all incomplete metadata?\n"
-             "API requests will be consumed, and Mod Organizer may stutter.")
+             "API requests will be consumed, files without a known hash are "
+             "hashed in the background.")
               .arg(incompleteCount),
           QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes) {
     TimeThis tt("DownloadManager::queryDownloadListInfo()");
     log::info("Querying metadata for every download with incomplete info...");
-    startDisableDirWatcher();
     for (size_t i = 0; i < m_ActiveDownloads.size(); i++) {
       if (isInfoIncomplete(i)) {
         queryInfoMd5(i, false);
       }
     }
-    endDisableDirWatcher();
-    log::info("Metadata has been retrieved successfully!");
+    log::info("Metadata of {} downloads is being queried", incompleteCount);
   }
 }
 
@@ -533,6 +795,9 @@ bool DownloadManager::addDownload(QNetworkReply* reply, const QStringList& URLs,
                                   const QString& fileName, QString gameName, int modID,
                                   int fileID, const ModRepositoryFileInfo* fileInfo)
 {
+  // the new download goes after the ones already in the directory
+  ensureListed();
+
   // download invoked from an already open network reply (i.e. download link in the
   // browser)
   DownloadInfo* newDownload = DownloadInfo::createNew(fileInfo, URLs);
@@ -554,9 +819,7 @@ bool DownloadManager::addDownload(QNetworkReply* reply, const QStringList& URLs,
     baseName.truncate(queryIndex);
   }
 
-  startDisableDirWatcher();
   newDownload->setName(getDownloadFileName(baseName), false);
-  endDisableDirWatcher();
 
   startDownload(reply, newDownload, false);
   //  emit update(-1);
@@ -576,15 +839,17 @@ void DownloadManager::removePending(QString gameName, int modID, int fileID)
       break;
     }
   }
-  emit aboutToUpdate();
-  for (auto iter : m_PendingDownloads) {
-    if (gameShortName.compare(std::get<0>(iter), Qt::CaseInsensitive) == 0 &&
-        (std::get<1>(iter) == modID) && (std::get<2>(iter) == fileID)) {
-      m_PendingDownloads.removeAt(m_PendingDownloads.indexOf(iter));
+  for (int i = 0; i < m_PendingDownloads.size(); ++i) {
+    const auto& pending = m_PendingDownloads[i];
+    if (gameShortName.compare(std::get<0>(pending), Qt::CaseInsensitive) == 0 &&
+        (std::get<1>(pending) == modID) && (std::get<2>(pending) == fileID)) {
+      // pending downloads are listed after all the others
+      emit aboutToRemove(m_ActiveDownloads.size() + i);
+      m_PendingDownloads.removeAt(i);
+      emit removed();
       break;
     }
   }
-  emit update(-1);
 }
 
 void DownloadManager::startDownload(QNetworkReply* reply, DownloadInfo* newDownload,
@@ -599,7 +864,10 @@ void DownloadManager::startDownload(QNetworkReply* reply, DownloadInfo* newDownl
   }
 
   QIODevice::OpenMode mode = QIODevice::WriteOnly;
-  if (resume) {
+  if (resume && newDownload->isSegmented()) {
+    // the segments are written in place, the file must not be truncated
+    mode = QIODevice::ReadWrite;
+  } else if (resume) {
     mode |= QIODevice::Append;
   }
 
@@ -613,6 +881,10 @@ void DownloadManager::startDownload(QNetworkReply* reply, DownloadInfo* newDownl
     return;
   }
 
+  // the hash is computed while the data arrives so the file never has to be read
+  // again for Nexus lookups
+  newDownload->startHash(resume);
+
   connect(newDownload->m_Reply, SIGNAL(downloadProgress(qint64, qint64)), this,
           SLOT(downloadProgress(qint64, qint64)));
   connect(newDownload->m_Reply, SIGNAL(errorOccurred(QNetworkReply::NetworkError)),
@@ -626,10 +898,10 @@ void DownloadManager::startDownload(QNetworkReply* reply, DownloadInfo* newDownl
     removePending(newDownload->m_FileInfo->gameName, newDownload->m_FileInfo->modID,
                   newDownload->m_FileInfo->fileID);
 
-    emit aboutToUpdate();
+    emit aboutToInsert(m_ActiveDownloads.size());
     m_ActiveDownloads.append(newDownload);
+    emit inserted();
 
-    emit update(-1);
     emit downloadAdded();
 
     if (QFile::exists(m_OutputDirectory + "/" + newDownload->m_FileName)) {
@@ -647,9 +919,7 @@ void DownloadManager::startDownload(QNetworkReply* reply, DownloadInfo* newDownl
         else
           setState(newDownload, STATE_CANCELING);
       } else {
-        startDisableDirWatcher();
         newDownload->setName(getDownloadFileName(newDownload->m_FileName, true), true);
-        endDisableDirWatcher();
         if (newDownload->m_State == STATE_PAUSED)
           resumeDownload(indexByInfo(newDownload));
         else
@@ -673,7 +943,7 @@ void DownloadManager::startDownload(QNetworkReply* reply, DownloadInfo* newDownl
     connect(newDownload->m_Reply, SIGNAL(finished()), this, SLOT(downloadFinished()));
 }
 
-void DownloadManager::addNXMDownload(const QString& url)
+void DownloadManager::addNXMDownload(const QString& url, int priority)
 {
   NXMUrl nxmInfo(url);
 
@@ -782,12 +1052,11 @@ void DownloadManager::addNXMDownload(const QString& url)
     }
   }
 
-  emit aboutToUpdate();
-
+  emit aboutToInsert(m_ActiveDownloads.size() + m_PendingDownloads.size());
   m_PendingDownloads.append(
       std::make_tuple(foundGame->gameShortName(), nxmInfo.modId(), nxmInfo.fileId()));
+  emit inserted();
 
-  emit update(-1);
   emit downloadAdded();
   ModRepositoryFileInfo* info = new ModRepositoryFileInfo();
 
@@ -795,6 +1064,8 @@ void DownloadManager::addNXMDownload(const QString& url)
   info->nexusExpires      = nxmInfo.expires();
   info->nexusDownloadUser = nxmInfo.userId();
 
+  info->userData["priority"] = priority;
+
   QObject* test = info;
   m_RequestIDs.insert(m_NexusInterface->requestFileInfo(
       foundGame->gameShortName(), nxmInfo.modId(), nxmInfo.fileId(), this,
@@ -803,9 +1074,6 @@ void DownloadManager::addNXMDownload(const QString& url)
 
 void DownloadManager::removeFile(int index, bool deleteFile)
 {
-  // Avoid triggering refreshes from DirWatcher
-  ScopedDisableDirWatcher scopedDirWatcher(this);
-
   if (index >= m_ActiveDownloads.size()) {
     throw MyException(tr("remove: invalid download index %1").arg(index));
   }
@@ -899,12 +1167,8 @@ void DownloadManager::restoreDownload(int index)
 
       QString filePath = m_OutputDirectory + "/" + download->m_FileName;
 
-      // avoid dirWatcher triggering refreshes
-      startDisableDirWatcher();
       QSettings metaSettings(filePath.append(".meta"), QSettings::IniFormat);
       metaSettings.setValue("removed", false);
-
-      endDisableDirWatcher();
     }
   }
 }
@@ -912,9 +1176,6 @@ void DownloadManager::restoreDownload(int index)
 void DownloadManager::removeDownload(int index, bool deleteFile)
 {
   try {
-    // avoid dirWatcher triggering refreshes
-    ScopedDisableDirWatcher scopedDirWatcher(this);
-
     emit aboutToUpdate();
 
     if (index < 0) {
@@ -1009,7 +1270,7 @@ void DownloadManager::resumeDownloadInt(int index)
   DownloadInfo* info = m_ActiveDownloads[index];
 
   // Check for finished download;
-  if (info->m_TotalSize <= info->m_Output.size() && info->m_Reply != nullptr &&
+  if (info->m_TotalSize <= info->downloadedSize() && info->m_Reply != nullptr &&
       info->m_Reply->isFinished() && info->m_State != STATE_ERROR) {
     setState(info, STATE_DOWNLOADING);
     downloadFinished(index);
@@ -1038,12 +1299,33 @@ void DownloadManager::resumeDownloadInt(int index)
     QNetworkRequest request(QUrl::fromEncoded(info->currentURL().toLocal8Bit()));
     request.setHeader(QNetworkRequest::UserAgentHeader,
                       m_NexusInterface->getAccessManager()->userAgent());
-    if (info->m_State != STATE_ERROR) {
-      info->m_ResumePos      = info->m_Output.size();
+
+    // the main request continues the first unfinished segment of a segmented
+    // download, the other segments get requests of their own below
+    DownloadInfo::Segment* segment = nullptr;
+    if (info->isSegmented()) {
+      auto iter = std::find_if(info->m_Segments.begin(), info->m_Segments.end(),
+                               [](const DownloadInfo::Segment& s) {
+                                 return !s.complete();
+                               });
+      if (iter != info->m_Segments.end()) {
+        segment = &*iter;
+      } else {
+        info->m_Segments.clear();
+      }
+    }
+
+    if (segment != nullptr) {
+      info->m_ResumePos      = segment->pos;
+      QByteArray rangeHeader = "bytes=" + QByteArray::number(segment->pos) + "-" +
+                               QByteArray::number(segment->end - 1);
+      request.setRawHeader("Range", rangeHeader);
+    } else if (info->m_State != STATE_ERROR) {
+      info->m_ResumePos      = info->outputSize();
       QByteArray rangeHeader = "bytes=" + QByteArray::number(info->m_ResumePos) + "-";
       request.setRawHeader("Range", rangeHeader);
     }
-    info->m_DownloadLast     = 0;
+    info->m_DownloadLast     = info->isSegmented() ? info->downloadedSize() : 0;
     info->m_DownloadTimeLast = 0;
     info->m_DownloadAcc      = accumulator_set<qint64, stats<tag::rolling_mean>>(
         tag::rolling_window::window_size = 200);
@@ -1051,6 +1333,15 @@ void DownloadManager::resumeDownloadInt(int index)
         tag::rolling_window::window_size = 200);
     log::debug("resume at {} bytes", info->m_ResumePos);
     startDownload(m_NexusInterface->getAccessManager()->get(request), info, true);
+
+    if ((segment != nullptr) && info->m_Output.isOpen()) {
+      segment->reply = info->m_Reply;
+      for (auto& other : info->m_Segments) {
+        if (!other.complete() && (other.reply == nullptr)) {
+          startSegment(info, other);
+        }
+      }
+    }
   }
   emit update(index);
 }
@@ -1154,45 +1445,75 @@ void DownloadManager::queryInfoMd5(int index, bool askIfNotFound)
   info->m_GamesToQuery << m_ManagedGame->gameShortName();
   info->m_GamesToQuery << m_ManagedGame->validShortNames();
 
-  QFile downloadFile(info->m_FileName);
-  if (!downloadFile.exists()) {
-    downloadFile.setFileName(m_OrganizerCore->downloadsPath() + "/" +
-                             info->m_FileName);
-  }
-  if (!downloadFile.exists()) {
-    log::error("Can't find download file '{}'", info->m_FileName);
+  // downloads hashed while they were transferred don't have to be read again
+  if (!info->m_Hash.isEmpty()) {
+    info->m_ReQueried     = true;
+    info->m_AskIfNotFound = askIfNotFound;
+    setState(info, STATE_FETCHINGMODINFO_MD5);
     return;
   }
-  if (!downloadFile.open(QIODevice::ReadOnly)) {
-    log::error("Can't open download file '{}'", info->m_FileName);
+
+  QString path = info->m_FileName;
+  if (!QFile::exists(path)) {
+    path = m_OrganizerCore->downloadsPath() + "/" + info->m_FileName;
+  }
+  if (!QFile::exists(path)) {
+    log::error("Can't find download file '{}'", info->m_FileName);
     return;
   }
 
-  QCryptographicHash hash(QCryptographicHash::Md5);
-  const qint64 progressStep = 10 * 1024 * 1024;
-  QProgressDialog progress(tr("Hashing download file '%1'").arg(info->m_FileName),
-                           tr("Cancel"), 0, downloadFile.size() / progressStep);
-  progress.setWindowModality(Qt::WindowModal);
-  progress.setMinimumDuration(1000);
+  info->m_ReQueried     = true;
+  info->m_AskIfNotFound = askIfNotFound;
+
+  // shown as fetching while it waits for the hash, the request is sent after
+  const DownloadState previous = info->m_State;
+  info->m_State                = STATE_FETCHINGMODINFO_MD5;
+  emit update(index);
 
-  for (qint64 i = 0; i < downloadFile.size(); i += progressStep) {
-    progress.setValue(progress.value() + 1);
-    if (progress.wasCanceled()) {
-      break;
+  const unsigned int id = info->m_DownloadID;
+  m_HashPool.start([this, id, path, previous] {
+    QByteArray hash;
+
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly)) {
+      QCryptographicHash hasher(QCryptographicHash::Md5);
+      const qint64 chunkSize = 1024 * 1024;
+      QByteArray chunk;
+      while (!(chunk = file.read(chunkSize)).isEmpty()) {
+        hasher.addData(chunk);
+      }
+      if (file.error() == QFileDevice::NoError) {
+        hash = hasher.result();
+      }
     }
-    hash.addData(downloadFile.read(progressStep));
-  }
-  if (progress.wasCanceled()) {
-    downloadFile.close();
+
+    QMetaObject::invokeMethod(
+        this,
+        [this, id, hash, previous] {
+          md5Hashed(id, hash, previous);
+        },
+        Qt::QueuedConnection);
+  });
+}
+
+void DownloadManager::md5Hashed(unsigned int id, const QByteArray& hash,
+                                DownloadState previous)
+{
+  DownloadInfo* info = downloadInfoByID(id);
+  if (info == nullptr || info->m_State != STATE_FETCHINGMODINFO_MD5) {
+    // removed or changed while it was hashed
     return;
   }
 
-  progress.close();
-  downloadFile.close();
+  if (hash.isEmpty()) {
+    log::error("Can't read download file '{}'", info->m_FileName);
+    info->m_State = previous;
+    emit update(m_ActiveDownloads.indexOf(info));
+    return;
+  }
 
-  info->m_Hash          = hash.result();
-  info->m_ReQueried     = true;
-  info->m_AskIfNotFound = askIfNotFound;
+  // kept in the meta file once the lookup is done, so it's only hashed once
+  info->m_Hash = hash;
   setState(info, STATE_FETCHINGMODINFO_MD5);
 }
 
@@ -1503,9 +1824,6 @@ void DownloadManager::markInstalled(int index)
     throw MyException(tr("mark installed: invalid download index %1").arg(index));
   }
 
-  // Avoid triggering refreshes from DirWatcher
-  ScopedDisableDirWatcher scopedDirWatcher(this);
-
   DownloadInfo* info = m_ActiveDownloads.at(index);
   QSettings metaFile(info->m_Output.fileName() + ".meta", QSettings::IniFormat);
   metaFile.setValue("installed", true);
@@ -1522,9 +1840,6 @@ void DownloadManager::markInstalled(QString fileName)
   } else {
     DownloadInfo* info = getDownloadInfo(fileName);
     if (info != nullptr) {
-      // Avoid triggering refreshes from DirWatcher
-      ScopedDisableDirWatcher scopedDirWatcher(this);
-
       QSettings metaFile(info->m_Output.fileName() + ".meta", QSettings::IniFormat);
       metaFile.setValue("installed", true);
       metaFile.setValue("uninstalled", false);
@@ -1544,9 +1859,6 @@ void DownloadManager::markUninstalled(int index)
     throw MyException(tr("mark uninstalled: invalid download index %1").arg(index));
   }
 
-  // Avoid triggering refreshes from DirWatcher
-  ScopedDisableDirWatcher scopedDirWatcher(this);
-
   DownloadInfo* info = m_ActiveDownloads.at(index);
   QSettings metaFile(info->m_Output.fileName() + ".meta", QSettings::IniFormat);
   metaFile.setValue("uninstalled", true);
@@ -1564,9 +1876,6 @@ void DownloadManager::markUninstalled(QString fileName)
     DownloadInfo* info = getDownloadInfo(filePath);
     if (info != nullptr) {
 
-      // Avoid triggering refreshes from DirWatcher
-      ScopedDisableDirWatcher scopedDirWatcher(this);
-
       QSettings metaFile(info->m_Output.fileName() + ".meta", QSettings::IniFormat);
       metaFile.setValue("uninstalled", true);
       delete info;
@@ -1617,22 +1926,30 @@ void DownloadManager::setState(DownloadManager::DownloadInfo* info,
   info->m_State = state;
   switch (state) {
   case STATE_CANCELING: {
+    abortSegments(info);
     // Force termination so the download transitions through finished().
     if (info->m_Reply != nullptr && info->m_Reply->isRunning()) {
       info->m_Reply->abort();
     }
   } break;
   case STATE_PAUSED: {
+    abortSegments(info);
     info->m_Reply->abort();
-    info->m_Output.close();
+    info->closeOutput();
+    if (info->isSegmented()) {
+      // remember how far each segment got
+      createMetaFile(info);
+    }
     m_DownloadPaused(row);
   } break;
   case STATE_ERROR: {
+    abortSegments(info);
     info->m_Reply->abort();
-    info->m_Output.close();
+    info->closeOutput();
     m_DownloadFailed(row);
   } break;
   case STATE_CANCELED: {
+    abortSegments(info);
     info->m_Reply->abort();
     m_DownloadFailed(row);
   } break;
@@ -1659,6 +1976,13 @@ void DownloadManager::setState(DownloadManager::DownloadInfo* info,
   default: /* NOP */
     break;
   }
+
+  if ((state >= STATE_CANCELED) && !m_DownloadQueue.empty()) {
+    // the download no longer takes a slot, deferred since it may be retried right
+    // away
+    QTimer::singleShot(0, this, &DownloadManager::startQueuedDownloads);
+  }
+
   emit stateChanged(row, state);
 }
 
@@ -1667,7 +1991,9 @@ DownloadManager::DownloadInfo* DownloadManager::findDownload(QObject* reply,
 {
   // reverse search as newer, thus more relevant, downloads are at the end
   for (int i = m_ActiveDownloads.size() - 1; i >= 0; --i) {
-    if (m_ActiveDownloads[i]->m_Reply == reply) {
+    if ((m_ActiveDownloads[i]->m_Reply == reply) ||
+        (m_ActiveDownloads[i]->segmentOf(qobject_cast<QNetworkReply*>(reply)) !=
+         nullptr)) {
       if (index != nullptr) {
         *index = i;
       }
@@ -1692,12 +2018,18 @@ void DownloadManager::downloadProgress(qint64 bytesReceived, qint64 bytesTotal)
       } else if (info->m_State == STATE_PAUSING) {
         setState(info, STATE_PAUSED);
       } else {
-        if (bytesTotal > info->m_TotalSize) {
+        qint64 resumePos = info->m_ResumePos;
+        if (info->isSegmented()) {
+          // the progress of all the segments together, whichever reports it
+          bytesReceived = info->downloadedSize();
+          bytesTotal    = info->m_TotalSize;
+          resumePos     = 0;
+        } else if (bytesTotal > info->m_TotalSize) {
           info->m_TotalSize = bytesTotal;
         }
         int oldProgress        = info->m_Progress.first;
-        info->m_Progress.first = ((info->m_ResumePos + bytesReceived) * 100) /
-                                 (info->m_ResumePos + bytesTotal);
+        info->m_Progress.first = ((resumePos + bytesReceived) * 100) /
+                                 (resumePos + bytesTotal);
 
         qint64 elapsed = info->m_StartTime.elapsed();
         info->m_DownloadAcc(bytesReceived - info->m_DownloadLast);
@@ -1719,7 +2051,12 @@ void DownloadManager::downloadProgress(qint64 bytesReceived, qint64 bytesTotal)
 
         TaskProgressManager::instance().updateProgress(info->m_TaskProgressId,
                                                        bytesReceived, bytesTotal);
-        emit update(index);
+
+        // progress events arrive far more often than the view can show them
+        m_ProgressChanged.insert(info->m_DownloadID);
+        if (!m_ProgressTimer.isActive()) {
+          m_ProgressTimer.start();
+        }
       }
     }
   } catch (const std::bad_alloc&) {
@@ -1738,9 +2075,6 @@ void DownloadManager::downloadReadyRead()
 
 void DownloadManager::createMetaFile(DownloadInfo* info)
 {
-  // Avoid triggering refreshes from DirWatcher
-  ScopedDisableDirWatcher scopedDirWatcher(this);
-
   QSettings metaFile(QString("%1.meta").arg(info->m_Output.fileName()),
                      QSettings::IniFormat);
   metaFile.setValue("gameName", info->m_FileInfo->gameName);
@@ -1765,6 +2099,14 @@ void DownloadManager::createMetaFile(DownloadInfo* info)
   metaFile.setValue("paused", (info->m_State == DownloadManager::STATE_PAUSED) ||
                                   (info->m_State == DownloadManager::STATE_ERROR));
   metaFile.setValue("removed", info->m_Hidden);
+  if (info->isSegmented()) {
+    metaFile.setValue("segments", info->segmentsString());
+  } else {
+    metaFile.remove("segments");
+  }
+  if (!info->m_Hash.isEmpty()) {
+    metaFile.setValue("md5", QString(info->m_Hash.toHex()));
+  }
 
   // slightly hackish...
   for (int i = 0; i < m_ActiveDownloads.size(); ++i) {
@@ -1942,10 +2284,7 @@ void DownloadManager::nxmFileInfoAvailable(QString gameName, int modID, int file
   info->modID  = modID;
   info->fileID = fileID;
 
-  QObject* test = info;
-  m_RequestIDs.insert(
-      m_NexusInterface->requestDownloadURL(info->gameName, info->modID, info->fileID,
-                                           this, QVariant::fromValue(test), QString()));
+  queueDownload(info);
 }
 
 static int evaluateFileInfoMap(const QVariantMap& map,
@@ -1970,18 +2309,10 @@ static int evaluateFileInfoMap(const QVariantMap& map,
   return 100 + preference * 20;
 }
 
-// sort function to sort by best download server
-//
-bool ServerByPreference(const ServerList::container& preferredServers,
-                        const QVariant& LHS, const QVariant& RHS)
-{
-  const auto a = evaluateFileInfoMap(LHS.toMap(), preferredServers);
-  const auto b = evaluateFileInfoMap(RHS.toMap(), preferredServers);
-  return (a > b);
-}
-
 int DownloadManager::startDownloadURLs(const QStringList& urls)
 {
+  ensureListed();
+
   ModRepositoryFileInfo info;
   addDownload(urls, "", -1, -1, &info);
   return m_ActiveDownloads.size() - 1;
@@ -1990,14 +2321,19 @@ int DownloadManager::startDownloadURLs(const QStringList& urls)
 int DownloadManager::startDownloadNexusFile(const QString& gameName, int modID,
                                             int fileID)
 {
+  ensureListed();
+
   int newID = m_ActiveDownloads.size();
   addNXMDownload(
-      QString("nxm://%1/mods/%2/files/%3").arg(gameName).arg(modID).arg(fileID));
+      QString("nxm://%1/mods/%2/files/%3").arg(gameName).arg(modID).arg(fileID),
+      PLUGIN_PRIORITY);
   return newID;
 }
 
 QString DownloadManager::downloadPath(int id)
 {
+  ensureListed();
+
   return getFilePath(id);
 }
 
@@ -2049,8 +2385,6 @@ void DownloadManager::nxmDownloadURLsAvailable(QString gameName, int modID, int
                                                QVariant userData, QVariant resultData,
                                                int requestID)
 {
-  using namespace boost::placeholders;
-
   std::set<int>::iterator idIter = m_RequestIDs.find(requestID);
   if (idIter == m_RequestIDs.end()) {
     return;
@@ -2058,6 +2392,10 @@ void DownloadManager::nxmDownloadURLsAvailable(QString gameName, int modID, int
     m_RequestIDs.erase(idIter);
   }
 
+  // the slot is taken by the download started below, if any
+  m_URLRequestIDs.erase(requestID);
+  QTimer::singleShot(0, this, &DownloadManager::startQueuedDownloads);
+
   ModRepositoryFileInfo* info =
       qobject_cast<ModRepositoryFileInfo*>(qvariant_cast<QObject*>(userData));
   QVariantList resultList = resultData.toList();
@@ -2067,10 +2405,7 @@ void DownloadManager::nxmDownloadURLsAvailable(QString gameName, int modID, int
     return;
   }
 
-  const auto servers = m_OrganizerCore->settings().network().servers();
-
-  std::sort(resultList.begin(), resultList.end(),
-            boost::bind(&ServerByPreference, servers.getPreferred(), _1, _2));
+  sortServers(resultList);
 
   info->userData["downloadMap"] = resultList;
 
@@ -2199,6 +2534,10 @@ void DownloadManager::nxmRequestFailed(QString gameName, int modID, int fileID,
     m_RequestIDs.erase(idIter);
   }
 
+  if (m_URLRequestIDs.erase(requestID) > 0) {
+    QTimer::singleShot(0, this, &DownloadManager::startQueuedDownloads);
+  }
+
   DownloadInfo* userDataInfo = downloadInfoByID(userData.toInt());
 
   int index = 0;
@@ -2230,12 +2569,14 @@ void DownloadManager::nxmRequestFailed(QString gameName, int modID, int fileID,
 
     if (info->m_FileInfo->modID == modID) {
       if (info->m_State < STATE_FETCHINGMODINFO) {
+        emit aboutToRemove(index);
         m_ActiveDownloads.erase(iter);
         delete info;
+        emit removed();
       } else {
         setState(info, STATE_READY);
+        emit update(index);
       }
-      emit update(index);
       break;
     }
   }
@@ -2261,9 +2602,17 @@ void DownloadManager::downloadFinished(int index)
     QByteArray data;
     if (reply->isOpen() && info->m_HasData) {
       data = reply->readAll();
-      info->m_Output.write(data);
+      info->write(data);
     }
-    info->m_Output.close();
+
+    // this part of a segmented download is done but others are still being
+    // transferred, the last one to finish completes the download
+    if (info->isSegmented() && (info->m_State == STATE_DOWNLOADING) &&
+        !info->segmentsComplete() && (info->segmentOf(reply) == nullptr)) {
+      return;
+    }
+
+    const bool written = info->closeOutput();
     TaskProgressManager::instance().forgetMe(info->m_TaskProgressId);
 
     bool error = false;
@@ -2275,7 +2624,8 @@ void DownloadManager::downloadFinished(int index)
         emit showMessage(
             tr("Warning: Content type is: %1")
                 .arg(reply->header(QNetworkRequest::ContentTypeHeader).toString()));
-      if ((info->m_Output.size() == 0) ||
+      if (!written || (info->m_Output.size() == 0) ||
+          (info->isSegmented() && !info->segmentsComplete()) ||
           ((reply->error() != QNetworkReply::NoError) &&
            (reply->error() != QNetworkReply::OperationCanceledError))) {
         if (reply->error() == QNetworkReply::UnknownContentError)
@@ -2297,44 +2647,36 @@ void DownloadManager::downloadFinished(int index)
       setState(info, STATE_CANCELED);
     } else if (info->m_State == STATE_PAUSING) {
       if (info->m_Output.isOpen() && info->m_HasData) {
-        info->m_Output.write(info->m_Reply->readAll());
+        info->write(info->m_Reply->readAll());
       }
       setState(info, STATE_PAUSED);
     }
 
     if (info->m_State == STATE_CANCELED || (info->m_Tries == 0 && error)) {
-      emit aboutToUpdate();
+      emit aboutToRemove(index);
       info->m_Output.remove();
       delete info;
       m_ActiveDownloads.erase(m_ActiveDownloads.begin() + index);
+      emit removed();
       if (error)
         emit showMessage(
             tr("We were unable to download the file due to errors after four retries. "
                "There may be an issue with the Nexus servers."));
-      emit update(-1);
     } else if (info->isPausedState() || info->m_State == STATE_PAUSING) {
-      emit aboutToUpdate();
-      info->m_Output.close();
+      info->closeOutput();
       createMetaFile(info);
       emit update(index);
     } else {
-      emit aboutToUpdate();
-      QString url = info->m_Urls[info->m_CurrentUrl];
-      if (info->m_FileInfo->userData.contains("downloadMap")) {
-        foreach (const QVariant& server,
-                 info->m_FileInfo->userData["downloadMap"].toList()) {
-          QVariantMap serverMap = server.toMap();
-          if (serverMap["URI"].toString() == url) {
-            int deltaTime = info->m_StartTime.elapsed() / 1000;
-            if (deltaTime > 5) {
-              emit downloadSpeed(serverMap["short_name"].toString(),
-                                 (info->m_TotalSize - info->m_PreResumeSize) /
-                                     deltaTime);
-            }  // no division by zero please! Also, if the download is shorter than a
-               // few seconds, the result is way to inprecise
-            break;
-          }
-        }
+      info->finishHash();
+      info->m_Segments.clear();
+      const QString server = serverName(info);
+      if (!server.isEmpty()) {
+        int deltaTime = info->m_StartTime.elapsed() / 1000;
+        if (deltaTime > 5) {
+          emit downloadSpeed(server,
+                             (info->m_TotalSize - info->m_PreResumeSize) / deltaTime);
+        }  // no division by zero please! Also, if the download is shorter than a
+           // few seconds, the result is way to inprecise
       }
 
       bool isNexus = info->m_FileInfo->repository == "Nexus";
@@ -2349,14 +2691,12 @@ void DownloadManager::downloadFinished(int index)
       QString newName = getFileNameFromNetworkReply(reply);
       QString oldName = QFileInfo(info->m_Output).fileName();
 
-      startDisableDirWatcher();
       if (!newName.isEmpty() && (oldName.isEmpty())) {
         info->setName(getDownloadFileName(newName), true);
       } else {
         info->setName(m_OutputDirectory + "/" + info->m_FileName,
                       true);  // don't rename but remove the ".unfinished" extension
       }
-      endDisableDirWatcher();
 
       if (!isNexus) {
         setState(info, STATE_READY);
@@ -2394,9 +2734,7 @@ void DownloadManager::metaDataChanged()
   if (info != nullptr) {
     QString newName = getFileNameFromNetworkReply(info->m_Reply);
     if (!newName.isEmpty() && (info->m_FileName.isEmpty())) {
-      startDisableDirWatcher();
       info->setName(getDownloadFileName(newName), true);
-      endDisableDirWatcher();
       refreshAlphabeticalTranslation();
       if (!info->m_Output.isOpen() &&
           !info->m_Output.open(QIODevice::WriteOnly | QIODevice::Append)) {
@@ -2404,15 +2742,92 @@ void DownloadManager::metaDataChanged()
         setState(info, STATE_CANCELING);
       }
     }
+
+    startSegments(info);
+
+    // segmented downloads allocate the whole file already
+    if (!info->isSegmented()) {
+      const qint64 length =
+          info->m_Reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+      info->preallocate(info->m_ResumePos + length);
+    }
   } else {
     log::warn("meta data event for unknown download");
   }
 }
 
-void DownloadManager::directoryChanged(const QString&)
+void DownloadManager::directoryChanged(
+    const std::vector<ModDirectoryWatcher::Change>& changes)
 {
-  if (DownloadManager::m_DirWatcherDisabler == 0)
-    refreshList();
+  // the first listing picks them up
+  if (!m_Listed) {
+    return;
+  }
+
+  // the events also cover what the download manager does itself, those files are
+  // already in the list and are skipped below
+  const QStringList supportedExtensions =
+      m_OrganizerCore->installationManager()->getSupportedExtensions();
+
+  auto isDownload = [&](const QString& name) {
+    if (name.endsWith(UNFINISHED, Qt::CaseInsensitive)) {
+      return true;
+    }
+    for (const auto& extension : supportedExtensions) {
+      if (name.endsWith("." + extension, Qt::CaseInsensitive)) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  auto find = [&](const QString& name) {
+    for (int i = 0; i < m_ActiveDownloads.size(); ++i) {
+      const DownloadInfo* info = m_ActiveDownloads[i];
+      if ((info->m_FileName.compare(name, Qt::CaseInsensitive) == 0) ||
+          (QFileInfo(info->m_Output.fileName())
+               .fileName()
+               .compare(name, Qt::CaseInsensitive) == 0)) {
+        return i;
+      }
+    }
+    return -1;
+  };
+
+  for (const auto& change : changes) {
+    // only the files directly in the output directory are listed
+    if ((change.type == ModDirectoryWatcher::Change::Type::DirectoryChanged) ||
+        change.path.contains('/') || !isDownload(change.path)) {
+      continue;
+    }
+
+    const int index = find(change.path);
+
+    if (change.type == ModDirectoryWatcher::Change::Type::FileRemoved) {
+      // downloads in progress or paused keep their row, like in refreshList()
+      if ((index < 0) || (m_ActiveDownloads[index]->m_State < STATE_READY) ||
+          QFile::exists(m_ActiveDownloads[index]->m_Output.fileName())) {
+        continue;
+      }
+
+      emit aboutToRemove(index);
+      delete m_ActiveDownloads[index];
+      m_ActiveDownloads.erase(m_ActiveDownloads.begin() + index);
+      emit removed();
+    } else if (index < 0) {
+      const QString fileName = m_OutputDirectory + "/" + change.path;
+
+      DownloadInfo* info =
+          DownloadInfo::createFromMeta(fileName, m_ShowHidden, m_OutputDirectory);
+      if (info == nullptr) {
+        continue;
+      }
+
+      emit aboutToInsert(0);
+      m_ActiveDownloads.push_front(info);
+      emit inserted();
+    }
+  }
 }
 
 void DownloadManager::managedGameChanged(MOBase::IPluginGame const* managedGame)
@@ -2461,7 +2876,18 @@ void DownloadManager::checkDownloadTimeout()
 void DownloadManager::writeData(DownloadInfo* info)
 {
   if (info != nullptr) {
-    qint64 ret = info->m_Output.write(info->m_Reply->readAll());
+    if (info->isSegmented() && (info->m_ResumePos > 0) &&
+        (info->m_Reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() !=
+         206)) {
+      // the data doesn't start where the segment does, writing it would corrupt the
+      // file
+      log::error("server ignored the range request for \"{}\"", info->m_FileName);
+      info->m_Reply->readAll();
+      setState(info, STATE_ERROR);
+      return;
+    }
+
+    qint64 ret = info->write(info->m_Reply->readAll());
     if (ret < info->m_Reply->size()) {
       QString fileName =
           info->m_FileName;  // m_FileName may be destroyed after setState
@@ -2478,3 +2904,291 @@ void DownloadManager::writeData(DownloadInfo* info)
     }
   }
 }
+
+void DownloadManager::startSegments(DownloadInfo* info)
+{
+  QNetworkReply* reply = info->m_Reply;
+  const int connections =
+      std::min(m_OrganizerCore->settings().network().downloadConnections(), 16);
+  const qint64 size = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+
+  if (info->isSegmented() || (connections < 2) || (info->m_ResumePos != 0) ||
+      (info->m_State != STATE_DOWNLOADING) || !info->m_Output.isOpen() ||
+      info->m_Output.openMode().testFlag(QIODevice::Append) ||
+      (size < MIN_SEGMENTED_SIZE) ||
+      (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200) ||
+      (reply->rawHeader("Accept-Ranges").trimmed().toLower() != "bytes")) {
+    return;
+  }
+
+  // whatever arrived before the headers were handled is already in the file
+  const qint64 written = info->outputSize();
+  if (!info->m_Output.resize(size) || !info->m_Output.seek(written)) {
+    log::warn("can't preallocate \"{}\", downloading it in a single request",
+              info->m_FileName);
+    info->m_Output.resize(written);
+    info->m_Output.seek(written);
+    return;
+  }
+
+  const qint64 segmentSize = size / connections;
+  for (int i = 0; i < connections; ++i) {
+    const qint64 begin = i * segmentSize;
+    const qint64 end   = (i == connections - 1) ? size : begin + segmentSize;
+    info->m_Segments.push_back({i == 0 ? written : begin, end});
+  }
+  info->m_Segments[0].reply = reply;
+  info->m_TotalSize         = size;
+  info->preallocate(size);
+
+  // the data arrives out of order, the hash is computed from the file instead
+  info->m_Hasher.reset();
+
+  log::debug("downloading \"{}\" in {} segments", info->m_FileName, connections);
+
+  for (std::size_t i = 1; i < info->m_Segments.size(); ++i) {
+    startSegment(info, info->m_Segments[i]);
+  }
+
+  createMetaFile(info);
+}
+
+void DownloadManager::startSegment(DownloadInfo* info, DownloadInfo::Segment& segment)
+{
+  QNetworkRequest request(QUrl::fromEncoded(info->currentURL().toLocal8Bit()));
+  request.setHeader(QNetworkRequest::UserAgentHeader,
+                    m_NexusInterface->getAccessManager()->userAgent());
+  request.setRawHeader("Range", "bytes=" + QByteArray::number(segment.pos) + "-" +
+                                    QByteArray::number(segment.end - 1));
+
+  segment.reply = m_NexusInterface->getAccessManager()->get(request);
+  segment.reply->setReadBufferSize(1024 * 1024);
+
+  connect(segment.reply, SIGNAL(downloadProgress(qint64, qint64)), this,
+          SLOT(downloadProgress(qint64, qint64)));
+  connect(segment.reply, SIGNAL(errorOccurred(QNetworkReply::NetworkError)), this,
+          SLOT(downloadError(QNetworkReply::NetworkError)));
+  connect(segment.reply, SIGNAL(readyRead()), this, SLOT(segmentReadyRead()));
+  connect(segment.reply, SIGNAL(finished()), this, SLOT(segmentFinished()));
+}
+
+void DownloadManager::abortSegments(DownloadInfo* info)
+{
+  for (auto& segment : info->m_Segments) {
+    if (segment.reply == nullptr) {
+      continue;
+    }
+
+    QNetworkReply* reply = segment.reply;
+    segment.reply        = nullptr;
+
+    // m_Reply is handled by the caller
+    if (reply == info->m_Reply) {
+      continue;
+    }
+
+    disconnect(reply, nullptr, this, nullptr);
+    if (info->m_Output.isOpen()) {
+      info->writeSegment(segment, reply->readAll());
+    }
+    reply->abort();
+    reply->deleteLater();
+  }
+}
+
+void DownloadManager::segmentReadyRead()
+{
+  QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+  DownloadInfo* info   = findDownload(reply);
+  if (info == nullptr) {
+    return;
+  }
+
+  DownloadInfo::Segment* segment = info->segmentOf(reply);
+  if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206) {
+    // the data doesn't start where the segment does
+    log::error("server ignored the range request for \"{}\"", info->m_FileName);
+    reply->abort();
+    return;
+  }
+
+  if (info->writeSegment(*segment, reply->readAll()) < 0) {
+    log::error("Unable to write download \"{}\" to drive", info->m_FileName);
+    reply->abort();
+  }
+}
+
+void DownloadManager::segmentFinished()
+{
+  QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+  reply->deleteLater();
+
+  int index          = 0;
+  DownloadInfo* info = findDownload(reply, &index);
+  if (info == nullptr) {
+    return;
+  }
+
+  DownloadInfo::Segment* segment = info->segmentOf(reply);
+  if ((reply->error() == QNetworkReply::NoError) && info->m_Output.isOpen()) {
+    info->writeSegment(*segment, reply->readAll());
+  }
+  segment->reply = nullptr;
+
+  if (info->m_State != STATE_DOWNLOADING) {
+    // pausing or canceling is handled through m_Reply
+    return;
+  }
+
+  if (!segment->complete()) {
+    if (info->m_Tries > 0) {
+      --info->m_Tries;
+      log::warn("segment of \"{}\" failed, retrying ({} retries left)",
+                info->m_FileName, info->m_Tries);
+      startSegment(info, *segment);
+      return;
+    }
+
+    emit showMessage(tr("Download failed: %1 (%2)")
+                         .arg(reply->errorString())
+                         .arg(reply->error()));
+    setState(info, STATE_ERROR);
+    createMetaFile(info);
+    emit update(index);
+    return;
+  }
+
+  // m_Reply is done too, so nothing else will complete the download
+  if (info->segmentsComplete() && info->m_Reply->isFinished()) {
+    downloadFinished(index);
+  }
+}
+
+void DownloadManager::queueDownload(ModRepositoryFileInfo* info)
+{
+  const int priority = info->userData.value("priority").toInt();
+
+  // behind everything of the same or a higher priority
+  auto itor = std::find_if(m_DownloadQueue.begin(), m_DownloadQueue.end(),
+                           [&](const QueuedDownload& queued) {
+                             return queued.priority < priority;
+                           });
+  m_DownloadQueue.insert(itor, QueuedDownload{info, priority});
+
+  startQueuedDownloads();
+}
+
+void DownloadManager::startQueuedDownloads()
+{
+  const int limit = m_OrganizerCore->settings().network().maxConcurrentDownloads();
+
+  while (!m_DownloadQueue.empty() && ((limit <= 0) || (activeTransfers() < limit))) {
+    ModRepositoryFileInfo* info = m_DownloadQueue.front().info;
+    m_DownloadQueue.erase(m_DownloadQueue.begin());
+
+    log::debug("requesting download urls for mod {} file {}, {} downloads queued",
+               info->modID, info->fileID, m_DownloadQueue.size());
+
+    QObject* test       = info;
+    const int requestID = m_NexusInterface->requestDownloadURL(
+        info->gameName, info->modID, info->fileID, this, QVariant::fromValue(test),
+        QString());
+    m_RequestIDs.insert(requestID);
+    m_URLRequestIDs.insert(requestID);
+  }
+}
+
+int DownloadManager::activeTransfers() const
+{
+  int count = static_cast<int>(m_URLRequestIDs.size());
+
+  for (const DownloadInfo* info : m_ActiveDownloads) {
+    // pausing and canceling downloads still hold their connection
+    if (info->m_State < STATE_CANCELED) {
+      ++count;
+    }
+  }
+
+  return count;
+}
+
+QString DownloadManager::serverName(const DownloadInfo* info)
+{
+  if ((info->m_CurrentUrl < 0) || (info->m_CurrentUrl >= info->m_Urls.size())) {
+    return {};
+  }
+
+  const QString& url = info->m_Urls[info->m_CurrentUrl];
+  for (const QVariant& server :
+       info->m_FileInfo->userData.value("downloadMap").toList()) {
+    const QVariantMap serverMap = server.toMap();
+    if (serverMap["URI"].toString() == url) {
+      return serverMap["short_name"].toString();
+    }
+  }
+
+  return {};
+}
+
+void DownloadManager::sortServers(QVariantList& servers) const
+{
+  const auto known     = m_OrganizerCore->settings().network().servers();
+  const auto preferred = known.getPreferred();
+
+  std::map<QString, int> load;
+  for (const DownloadInfo* info : m_ActiveDownloads) {
+    if (info->m_State == STATE_DOWNLOADING) {
+      ++load[serverName(info)];
+    }
+  }
+
+  struct Ranked
+  {
+    int preference;
+    qint64 speed;
+    QVariant server;
+  };
+
+  std::vector<Ranked> ranked;
+  for (const QVariant& server : servers) {
+    const QVariantMap serverMap = server.toMap();
+    const QString name          = serverMap["short_name"].toString();
+
+    // servers that haven't been measured yet keep the order nexus gave them in
+    qint64 speed = 0;
+    for (const auto& info : known) {
+      if (info.name() == name) {
+        auto itor = load.find(name);
+        speed     = info.averageSpeed() / ((itor != load.end() ? itor->second : 0) + 1);
+        break;
+      }
+    }
+
+    ranked.push_back({evaluateFileInfoMap(serverMap, preferred), speed, server});
+  }
+
+  std::stable_sort(ranked.begin(), ranked.end(), [](auto&& a, auto&& b) {
+    if (a.preference != b.preference) {
+      return a.preference > b.preference;
+    }
+    return a.speed > b.speed;
+  });
+
+  servers.clear();
+  for (const auto& r : ranked) {
+    servers.append(r.server);
+  }
+}
+
+void DownloadManager::progressTimeout()
+{
+  for (unsigned int id : m_ProgressChanged) {
+    // the download may have been removed since
+    const int index = indexByInfo(downloadInfoByID(id));
+    if (index >= 0) {
+      emit progressChanged(index);
+    }
+  }
+
+  m_ProgressChanged.clear();
+}
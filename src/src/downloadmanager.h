@@ -20,10 +20,11 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef DOWNLOADMANAGER_H
 #define DOWNLOADMANAGER_H
 
+#include "moddirectorywatcher.h"
 #include "serverinfo.h"
+#include <QCryptographicHash>
 #include <QElapsedTimer>
 #include <QFile>
-#include <QFileSystemWatcher>
 #include <QMap>
 #include <QNetworkReply>
 #include <QObject>
@@ -31,6 +32,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QSettings>
 #include <QStringList>
 #include <QTime>
+#include <QThreadPool>
 #include <QTimer>
 #include <QUrl>
 #include <QVector>
@@ -40,7 +42,9 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <boost/signals2.hpp>
 #include <idownloadmanager.h>
 #include <modrepositoryfileinfo.h>
+#include <memory>
 #include <set>
+#include <vector>
 using namespace boost::accumulators;
 
 namespace MOBase
@@ -82,7 +86,7 @@ public:
 private:
   struct DownloadInfo
   {
-    ~DownloadInfo() { delete m_FileInfo; }
+    ~DownloadInfo();
     accumulator_set<qint64, stats<tag::rolling_mean>> m_DownloadAcc;
     accumulator_set<qint64, stats<tag::rolling_mean>> m_DownloadTimeAcc;
     qint64 m_DownloadLast;
@@ -103,6 +107,27 @@ private:
     QDateTime m_Created;  // used as a cache in DownloadManager::getFileTime, may not be
                           // valid elsewhere
     QByteArray m_Hash;
+
+    // md5 of the data written so far, dropped if it can't cover the whole file (a
+    // download resumed after a restart or a failed write)
+    std::unique_ptr<QCryptographicHash> m_Hasher;
+    qint64 m_HashedBytes{0};
+
+    // a part of a segmented download, covering [pos, end) of the file that is still
+    // missing; reply is null while the part isn't being transferred
+    struct Segment
+    {
+      qint64 pos;
+      qint64 end;
+      QNetworkReply* reply{nullptr};
+
+      bool complete() const { return pos >= end; }
+    };
+
+    // empty unless the download was split into several range requests, in which case
+    // the file is preallocated and m_Reply serves one of the segments
+    std::vector<Segment> m_Segments;
+
     QStringList m_GamesToQuery;
     QString m_RemoteFileName;
 
@@ -118,9 +143,15 @@ private:
 
     static DownloadInfo* createNew(const MOBase::ModRepositoryFileInfo* fileInfo,
                                    const QStringList& URLs);
+    // `meta` holds the values of the meta file if they're already known, the file
+    // is read otherwise
     static DownloadInfo* createFromMeta(const QString& filePath, bool showHidden,
                                         const QString outputDirectory,
-                                        std::optional<uint64_t> fileSize = {});
+                                        std::optional<uint64_t> fileSize = {},
+                                        const QVariantMap* meta = nullptr);
+
+    // all the values of the given meta file, empty if it doesn't exist
+    static QVariantMap readMeta(const QString& metaFileName);
 
     /**
      * @brief rename the file
@@ -132,6 +163,67 @@ private:
      **/
     void setName(QString newName, bool renameFile);
 
+    /**
+     * @brief queue received data to be written to the output file and added to the
+     * hash, see DownloadWriter
+     * @return the size of the data, -1 if a write to the file failed
+     **/
+    qint64 write(const QByteArray& data);
+
+    /**
+     * @return the size of the output file once the queued data is written
+     **/
+    qint64 outputSize() const;
+
+    /**
+     * @brief wait for the queued data to be written and close the output file
+     * @return false if a write failed
+     **/
+    bool closeOutput();
+
+    /**
+     * @brief queue the allocation of the disk space for the whole file
+     **/
+    void preallocate(qint64 size);
+
+    /**
+     * @brief start hashing the data of this download, must be called once the output
+     * file is open
+     * @param resume true if the data is appended to what was already downloaded, in
+     * which case the current hash is kept if it covers the whole file
+     **/
+    void startHash(bool resume);
+
+    /**
+     * @brief set m_Hash from the data written if all of it could be hashed
+     **/
+    void finishHash();
+
+    bool isSegmented() const { return !m_Segments.empty(); }
+    bool segmentsComplete() const;
+
+    /**
+     * @return the number of bytes received so far, which isn't the size of the file
+     * for segmented downloads since it is preallocated
+     **/
+    qint64 downloadedSize() const;
+
+    /**
+     * @return the segment the given reply transfers, null if there is none
+     **/
+    Segment* segmentOf(const QNetworkReply* reply);
+
+    /**
+     * @brief write data received for a segment at its position in the file, anything
+     * past the end of the segment is dropped
+     * @return the number of bytes queued, -1 if a write to the file failed
+     **/
+    qint64 writeSegment(Segment& segment, const QByteArray& data);
+
+    // the segments as stored in the meta file, "pos-end" separated by commas
+    QString segmentsString() const;
+    void setSegments(const QString& segments);
+
     unsigned int downloadID() { return m_DownloadID; }
 
     bool isPausedState();
@@ -191,19 +283,6 @@ public:
    **/
   void setOutputDirectory(const QString& outputDirectory, const bool refresh = true);
 
-  /**
-   * @brief disables feedback from the downlods fileSystemWhatcher untill
-   *disableDownloadsWatcherEnd() is called
-   *
-   **/
-  static void startDisableDirWatcher();
-
-  /**
-   * @brief re-enables feedback from the downlods fileSystemWhatcher after
-   *disableDownloadsWatcherStart() was called
-   **/
-  static void endDisableDirWatcher();
-
   /**
    * @return current download directory
    **/
@@ -247,10 +326,12 @@ public:
    * starts a download using a nxm-link. The download manager will first query the nexus
    * page for file information.
    * @param url a nxm link looking like this: nxm://skyrim/mods/1234/files/4711
+   * @param priority downloads with a higher priority leave the queue first, those of
+   *the same priority in the order they were requested
    * @todo the game name encoded into the link is currently ignored, all downloads are
    *incorrectly assumed to be for the identified game
    **/
-  void addNXMDownload(const QString& url);
+  void addNXMDownload(const QString& url, int priority = 0);
 
   /**
    * @brief retrieve the total number of downloads, both finished and unfinished
@@ -403,6 +484,11 @@ public:
    */
   void refreshList();
 
+  /**
+   * @brief lists the downloads if the list hasn't been refreshed yet
+   */
+  void ensureListed();
+
   /**
    * @brief Query infos for every download in the list
    */
@@ -443,6 +529,30 @@ Q_SIGNALS:
    **/
   void update(int row);
 
+  /**
+   * @brief signals that a single row is about to be inserted, followed by inserted()
+   *
+   * @param row the row the new download or pending download will have
+   **/
+  void aboutToInsert(int row);
+  void inserted();
+
+  /**
+   * @brief signals that a single row is about to be removed, followed by removed()
+   *
+   * @param row the row that is removed
+   **/
+  void aboutToRemove(int row);
+  void removed();
+
+  /**
+   * @brief signals that only the progress of the specified download has changed,
+   *emitted at most PROGRESS_FPS times per second for all downloads together
+   *
+   * @param row the row that changed
+   **/
+  void progressChanged(int row);
+
   /**
    * @brief signals the ui that a message should be displayed
    *
@@ -538,7 +648,10 @@ private slots:
   void downloadFinished(int index = 0);
   void downloadError(QNetworkReply::NetworkError error);
   void metaDataChanged();
-  void directoryChanged(const QString& dirctory);
+  void segmentReadyRead();
+  void segmentFinished();
+  void progressTimeout();
+  void directoryChanged(const std::vector<ModDirectoryWatcher::Change>& changes);
   void checkDownloadTimeout();
 
 private:
@@ -588,15 +701,64 @@ private:
 
   DownloadInfo* downloadInfoByID(unsigned int id);
 
+  // sends the md5 lookup of the download once its file was hashed in the
+  // background, `previous` is the state it goes back to if that failed
+  void md5Hashed(unsigned int id, const QByteArray& hash, DownloadState previous);
+
   void removePending(QString gameName, int modID, int fileID);
 
   static QString getFileTypeString(int fileType);
 
   void writeData(DownloadInfo* info);
 
+  // splits a new download into several range requests once the server reported its
+  // size and range support, does nothing if it doesn't qualify
+  void startSegments(DownloadInfo* info);
+
+  // starts the request for the missing bytes of the given segment
+  void startSegment(DownloadInfo* info, DownloadInfo::Segment& segment);
+
+  // stops the requests of all the segments not served by m_Reply, keeping the data
+  // they have received
+  void abortSegments(DownloadInfo* info);
+
+  // queues the nexus download once its file info is known, the download urls are
+  // only requested when it gets its turn since they expire
+  void queueDownload(MOBase::ModRepositoryFileInfo* info);
+
+  // requests the urls of queued downloads as long as there are free slots
+  void startQueuedDownloads();
+
+  // number of downloads transferring data or waiting for their urls
+  int activeTransfers() const;
+
+  // name of the server the download is transferred from, empty if unknown
+  static QString serverName(const DownloadInfo* info);
+
+  // orders the servers nexus offers for a download: the ones the user ranked come
+  // first, the others by the speed they showed in recent downloads, shared between
+  // the downloads currently using them
+  void sortServers(QVariantList& servers) const;
+
+  // reports the estimated memory of the download list and the meta index
+  void reportMemoryUsage() const;
+
 private:
   static const int AUTOMATIC_RETRIES = 3;
 
+  // priority of the downloads started through the plugin interface, so the ones
+  // requested by the user don't wait behind a whole collection
+  static const int PLUGIN_PRIORITY = -1;
+
+  // how often the progress of running downloads is reported per second
+  static const int PROGRESS_FPS = 10;
+
+  // downloads smaller than this are never split
+  static const qint64 MIN_SEGMENTED_SIZE = 64LL * 1024 * 1024;
+
+  // files hashed at the same time for md5 lookups, more only compete for the disk
+  static const int HASH_THREADS = 2;
+
 private:
   NexusInterface* m_NexusInterface;
 
@@ -607,41 +769,62 @@ private:
 
   QVector<DownloadInfo*> m_ActiveDownloads;
 
+  struct QueuedDownload
+  {
+    MOBase::ModRepositoryFileInfo* info;
+    int priority;
+  };
+
+  // nexus downloads waiting for a free slot, highest priority first
+  std::vector<QueuedDownload> m_DownloadQueue;
+
+  // requests for download urls that haven't been answered yet
+  std::set<int> m_URLRequestIDs;
+
   QString m_OutputDirectory;
   std::set<int> m_RequestIDs;
   QVector<int> m_AlphabeticalTranslation;
 
-  QFileSystemWatcher m_DirWatcher;
+  // files appearing in or leaving the output directory are applied to the list one
+  // by one, reading the directory again is only needed if events were lost
+  ModDirectoryWatcher m_DirWatcher;
 
   SignalDownloadCallback m_DownloadComplete;
   SignalDownloadCallback m_DownloadPaused;
   SignalDownloadCallback m_DownloadFailed;
   SignalDownloadCallback m_DownloadRemoved;
 
-  // The dirWatcher is actually triggering off normal Mo operations such as deleting
-  // downloads or editing .meta files so it needs to be disabled during operations that
-  // are known to cause the creation or deletion of files in the Downloads folder.
-  // Notably using QSettings to edit a file creates a temporarily .lock file that causes
-  // the Watcher to trigger multiple listRefreshes freezing the ui.
-  static int m_DirWatcherDisabler;
-
   std::map<QString, int> m_DownloadFails;
 
+  // values of a meta file as they were when refreshList() last read it
+  struct MetaIndexEntry
+  {
+    uint64_t size;
+    uint64_t lastModified;
+    QVariantMap values;
+  };
+
+  // meta files of the output directory by file name, only the ones whose size or
+  // time changed are parsed again
+  std::map<QString, MetaIndexEntry> m_MetaIndex;
+
+  // the output directory is only listed once something needs the list, the
+  // downloads tab or a download being added
+  bool m_Listed;
+
   bool m_ShowHidden;
 
   MOBase::IPluginGame const* m_ManagedGame;
 
   QTimer m_TimeoutTimer;
-};
 
-class ScopedDisableDirWatcher
-{
-public:
-  ScopedDisableDirWatcher(DownloadManager* downloadManager);
-  ~ScopedDisableDirWatcher();
+  // downloads whose progress changed since it was last reported, by id
+  std::set<unsigned int> m_ProgressChanged;
+  QTimer m_ProgressTimer;
 
-private:
-  DownloadManager* m_downloadManager;
+  // hashes the files of downloads queried by md5 that weren't hashed yet, a bulk
+  // query of the whole list is worked off here without blocking the ui
+  QThreadPool m_HashPool;
 };
 
 #endif  // DOWNLOADMANAGER_H
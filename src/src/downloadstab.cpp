@@ -7,7 +7,8 @@
 DownloadsTab::DownloadsTab(OrganizerCore& core, Ui::MainWindow* mwui)
     : m_core(core),
       ui{mwui->btnRefreshDownloads, mwui->btnQueryDownloadsInfo, mwui->downloadView,
-         mwui->showHiddenBox, mwui->downloadFilterEdit}
+         mwui->showHiddenBox, mwui->downloadFilterEdit},
+      m_needRefresh(true)
 {
   DownloadList* sourceModel = new DownloadList(m_core, ui.list);
 
@@ -31,6 +32,8 @@ DownloadsTab::DownloadsTab(OrganizerCore& core, Ui::MainWindow* mwui)
     queryInfos();
   });
   connect(ui.list, SIGNAL(installDownload(int)), &m_core, SLOT(installDownload(int)));
+  connect(ui.list, &DownloadListView::installDownloads, &m_core,
+          &OrganizerCore::installDownloads);
   connect(ui.list, SIGNAL(queryInfo(int)), m_core.downloadManager(),
           SLOT(queryInfo(int)));
   connect(ui.list, SIGNAL(queryInfoMd5(int)), m_core.downloadManager(),
@@ -78,7 +81,18 @@ void DownloadsTab::update()
   ui.list->style()->polish(ui.list);
   qobject_cast<DownloadListHeader*>(ui.list->header())->customResizeSections();
 
-  m_core.downloadManager()->refreshList();
+  // the directory is listed once the tab is shown
+  if (!m_needRefresh) {
+    m_core.downloadManager()->refreshList();
+  }
+}
+
+void DownloadsTab::activated()
+{
+  if (m_needRefresh) {
+    m_needRefresh = false;
+    m_core.downloadManager()->ensureListed();
+  }
 }
 
 void DownloadsTab::refresh()
@@ -19,6 +19,10 @@ public:
 
   void update();
 
+  // called when the tab is shown, lists the downloads the first time
+  //
+  void activated();
+
 private:
   struct DownloadsTabUi
   {
@@ -33,6 +37,9 @@ private:
   DownloadsTabUi ui;
   MOBase::FilterWidget m_filter;
 
+  // the downloads haven't been listed for the tab yet
+  bool m_needRefresh;
+
   void refresh();
 
   /**
@@ -0,0 +1,248 @@
+#include "downloadwriter.h"
+#include "thread_utils.h"
+#include <uibase/log.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#endif
+
+using namespace MOBase;
+
+namespace
+{
+
+// best effort, a file system that can't preallocate gets written the same
+//
+bool preallocateFile(QFile& file, qint64 size)
+{
+#ifdef _WIN32
+  FILE_ALLOCATION_INFO info;
+  info.AllocationSize.QuadPart = size;
+
+  const auto handle = reinterpret_cast<HANDLE>(_get_osfhandle(file.handle()));
+  return SetFileInformationByHandle(handle, FileAllocationInfo, &info,
+                                    sizeof(info));
+#else
+  return ::fallocate(file.handle(), FALLOC_FL_KEEP_SIZE, 0, size) == 0;
+#endif
+}
+
+}  // namespace
+
+DownloadWriter::DownloadWriter()
+{
+  m_buffer.reserve(BufferSize);
+
+  m_thread = MOShared::startSafeThread([&] {
+    threadFun();
+  });
+}
+
+DownloadWriter::~DownloadWriter()
+{
+  {
+    std::scoped_lock lock(m_mutex);
+    m_stop = true;
+  }
+
+  // everything that's queued is still written
+  m_queued.notify_one();
+  m_thread.join();
+}
+
+bool DownloadWriter::write(QFile* file, qint64 pos, QByteArray data,
+                           QCryptographicHash* hash, qint64* hashed)
+{
+  std::unique_lock lock(m_mutex);
+
+  m_written.wait(lock, [&] {
+    return m_queuedBytes < MaxQueued || m_failed.contains(file);
+  });
+
+  if (m_failed.contains(file)) {
+    return false;
+  }
+
+  m_queuedBytes += data.size();
+  ++m_pending[file];
+  m_queue.push_back({file, pos, std::move(data), hash, hashed});
+
+  lock.unlock();
+  m_queued.notify_one();
+
+  return true;
+}
+
+void DownloadWriter::preallocate(QFile* file, qint64 size)
+{
+  {
+    std::scoped_lock lock(m_mutex);
+    ++m_pending[file];
+    m_queue.push_back({file, -1, {}, nullptr, nullptr, size});
+  }
+
+  m_queued.notify_one();
+}
+
+bool DownloadWriter::wait(const QFile* file)
+{
+  std::unique_lock lock(m_mutex);
+
+  m_written.wait(lock, [&] {
+    return !m_pending.contains(file);
+  });
+
+  return !m_failed.contains(file);
+}
+
+void DownloadWriter::forget(const QFile* file)
+{
+  std::unique_lock lock(m_mutex);
+
+  m_written.wait(lock, [&] {
+    return !m_pending.contains(file);
+  });
+
+  m_failed.erase(file);
+}
+
+void DownloadWriter::threadFun()
+{
+  std::vector<Job> jobs;
+
+  for (;;) {
+    bool failed = false;
+
+    {
+      std::unique_lock lock(m_mutex);
+
+      m_queued.wait(lock, [&] {
+        return m_stop || !m_queue.empty();
+      });
+
+      if (m_queue.empty()) {
+        return;
+      }
+
+      // takes the first job along with the ones that continue it, as long as
+      // they fit in the buffer
+      jobs.push_back(std::move(m_queue.front()));
+      m_queue.pop_front();
+
+      qint64 size = jobs.back().data.size();
+
+      while (!m_queue.empty() && continues(jobs.back(), m_queue.front()) &&
+             size + m_queue.front().data.size() <= BufferSize) {
+        size += m_queue.front().data.size();
+        jobs.push_back(std::move(m_queue.front()));
+        m_queue.pop_front();
+      }
+
+      failed = m_failed.contains(jobs.front().file);
+    }
+
+    finishJobs(jobs, !failed && writeJobs(jobs));
+    jobs.clear();
+  }
+}
+
+bool DownloadWriter::writeJobs(const std::vector<Job>& jobs)
+{
+  const Job& first = jobs.front();
+  QFile& file      = *first.file;
+
+  if (first.preallocate >= 0) {
+    if (!preallocateFile(file, first.preallocate)) {
+      log::debug("can't preallocate {} bytes for '{}'", first.preallocate,
+                 file.fileName());
+    }
+
+    return true;
+  }
+
+  const QByteArray* data = &first.data;
+
+  if (jobs.size() > 1) {
+    m_buffer.clear();
+    for (const auto& job : jobs) {
+      m_buffer.append(job.data);
+    }
+
+    data = &m_buffer;
+  }
+
+  if (first.pos >= 0 && !file.seek(first.pos)) {
+    log::error("failed to seek to {} in '{}': {}", first.pos, file.fileName(),
+               file.errorString());
+    return false;
+  }
+
+  // flushed right away so the size of the file is right once wait() returns
+  if (file.write(*data) != data->size() || !file.flush()) {
+    log::error("failed to write to '{}': {}", file.fileName(), file.errorString());
+    return false;
+  }
+
+  for (const auto& job : jobs) {
+    if (job.hash) {
+      job.hash->addData(job.data);
+      *job.hashed += job.data.size();
+    }
+  }
+
+  return true;
+}
+
+void DownloadWriter::finishJobs(const std::vector<Job>& jobs, bool success)
+{
+  const QFile* file = jobs.front().file;
+
+  {
+    std::scoped_lock lock(m_mutex);
+
+    int done = static_cast<int>(jobs.size());
+    for (const auto& job : jobs) {
+      m_queuedBytes -= job.data.size();
+    }
+
+    if (!success) {
+      m_failed.insert(file);
+
+      // nothing else is written to a file after a failure
+      std::erase_if(m_queue, [&](const Job& job) {
+        if (job.file != file) {
+          return false;
+        }
+
+        m_queuedBytes -= job.data.size();
+        ++done;
+        return true;
+      });
+    }
+
+    auto itor = m_pending.find(file);
+    itor->second -= done;
+    if (itor->second == 0) {
+      m_pending.erase(itor);
+    }
+  }
+
+  m_written.notify_all();
+}
+
+bool DownloadWriter::continues(const Job& last, const Job& next)
+{
+  if (next.file != last.file || next.hash != last.hash || last.preallocate >= 0 ||
+      next.preallocate >= 0) {
+    return false;
+  }
+
+  if (last.pos < 0 || next.pos < 0) {
+    return last.pos < 0 && next.pos < 0;
+  }
+
+  return next.pos == last.pos + last.data.size();
+}
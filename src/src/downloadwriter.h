@@ -0,0 +1,98 @@
+#ifndef MODORGANIZER_DOWNLOADWRITER_INCLUDED
+#define MODORGANIZER_DOWNLOADWRITER_INCLUDED
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QFile>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// writes the data of downloads on a thread of its own so the thread receiving
+// it only has to queue it; consecutive chunks of a file are gathered in a large
+// buffer and written at once, and the hash of a file can be computed along
+// the way
+//
+// the writer uses the files from its thread: nothing but fileName(), isOpen()
+// and openMode() may be called on a file that has writes queued, wait() must be
+// called before anything else
+//
+// a failed write drops everything else queued for its file, write() and wait()
+// return false for it until forget() is called
+//
+class DownloadWriter
+{
+public:
+  // size of the buffer consecutive chunks are gathered in
+  static constexpr qint64 BufferSize = 8 * 1024 * 1024;
+
+  // write() blocks while more than this is queued
+  static constexpr qint64 MaxQueued = 64 * 1024 * 1024;
+
+  DownloadWriter();
+  ~DownloadWriter();
+
+  // queues `data` to be written at `pos` in `file`, or at its current position
+  // if `pos` is negative; once written, it's added to `hash` and its size to
+  // `hashed` if they're not null
+  //
+  // returns false if a write to the file failed
+  //
+  bool write(QFile* file, qint64 pos, QByteArray data,
+             QCryptographicHash* hash = nullptr, qint64* hashed = nullptr);
+
+  // queues the allocation of `size` bytes of disk space for `file`, without
+  // changing its size, so it doesn't get fragmented while it's written
+  //
+  void preallocate(QFile* file, qint64 size);
+
+  // blocks until everything queued for `file` is written, returns false if a
+  // write failed
+  //
+  bool wait(const QFile* file);
+
+  // waits for `file` and forgets about its failed writes
+  //
+  void forget(const QFile* file);
+
+private:
+  struct Job
+  {
+    QFile* file;
+    qint64 pos;
+    QByteArray data;
+    QCryptographicHash* hash;
+    qint64* hashed;
+
+    // size to allocate, the job writes nothing when this is set
+    qint64 preallocate = -1;
+  };
+
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_queued;
+  std::condition_variable m_written;
+  bool m_stop = false;
+
+  std::deque<Job> m_queue;
+  qint64 m_queuedBytes = 0;
+
+  // number of jobs queued or being written by file
+  std::unordered_map<const QFile*, int> m_pending;
+  std::unordered_set<const QFile*> m_failed;
+
+  // only used by the thread
+  QByteArray m_buffer;
+
+  void threadFun();
+  bool writeJobs(const std::vector<Job>& jobs);
+  void finishJobs(const std::vector<Job>& jobs, bool success);
+
+  // whether `next` can be written in the same call as `last`
+  static bool continues(const Job& last, const Job& next);
+};
+
+#endif  // MODORGANIZER_DOWNLOADWRITER_INCLUDED
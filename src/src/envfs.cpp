@@ -363,6 +363,12 @@ void forEachEntry(const std::wstring& path, void* cx, DirStartF* dirStartF,
 }
 
 Directory getFilesAndDirs(const std::wstring& path)
+{
+  DirectoryWalker walker;
+  return getFilesAndDirs(walker, path);
+}
+
+Directory getFilesAndDirs(DirectoryWalker& walker, const std::wstring& path)
 {
   struct Context
   {
@@ -374,7 +380,7 @@ Directory getFilesAndDirs(const std::wstring& path)
   Context cx;
   cx.current.push(&root);
 
-  env::forEachEntry(
+  walker.forEachEntry(
       path, &cx,
       [](void* pcx, std::wstring_view path) {
         Context* cx = (Context*)pcx;
@@ -444,9 +450,12 @@ Directory getFilesAndDirsWithFind(const std::wstring& path)
 #else // Linux
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <QDir>
 #include <QProcess>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #include <cstring>
 #include <cctype>
 #include <stack>
@@ -603,56 +612,200 @@ void setHandleCloserThreadCount(std::size_t n)
   g_handleClosers.setMax(n);
 }
 
-// Recursive directory walker using POSIX opendir/readdir
-static void forEachEntryImpl(const std::string& dirPath, void* cx,
-                             DirStartF* dirStartF, DirEndF* dirEndF, FileF* fileF)
-{
-  DIR* dir = opendir(dirPath.c_str());
-  if (!dir && errno == ENOTCONN) {
-    if (tryRecoverStaleMount(dirPath)) {
-      dir = opendir(dirPath.c_str());
-    }
-  }
-  if (!dir) {
-    log::error("failed to open directory '{}': {}",
-               QString::fromStdString(dirPath), strerror(errno));
-    return;
-  }
+// Decodes a UTF-8 file name into `out`, reusing its storage.  Names that
+// aren't valid UTF-8 go through QString like before so they come out the same.
+static void decodeName(std::string_view name, std::wstring& out)
+{
+  out.clear();
 
-  struct dirent* entry;
-  while ((entry = readdir(dir)) != nullptr) {
-    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+  for (size_t i = 0; i < name.size();) {
+    const auto c = static_cast<unsigned char>(name[i]);
+    if (c < 0x80) {
+      out.push_back(static_cast<wchar_t>(c));
+      ++i;
       continue;
     }
 
-    std::string fullPath = dirPath + "/" + entry->d_name;
-    std::wstring wname = toWide(entry->d_name);
+    const size_t length = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC2 ? 2 : 0;
+    if (length == 0 || c > 0xF4 || i + length > name.size()) {
+      out = toWide(std::string(name));
+      return;
+    }
 
-    struct stat st;
-    if (lstat(fullPath.c_str(), &st) != 0) {
-      continue;
+    char32_t cp = c & (0x7F >> length);
+    for (size_t k = 1; k < length; ++k) {
+      const auto cc = static_cast<unsigned char>(name[i + k]);
+      if ((cc & 0xC0) != 0x80) {
+        out = toWide(std::string(name));
+        return;
+      }
+      cp = (cp << 6) | (cc & 0x3F);
+    }
+
+    // overlong forms, surrogates and anything past U+10FFFF
+    if ((length == 3 && cp < 0x800) || (length == 4 && cp < 0x10000) ||
+        (cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF) {
+      out = toWide(std::string(name));
+      return;
+    }
+
+    out.push_back(static_cast<wchar_t>(cp));
+    i += length;
+  }
+}
+
+// Size and mtime of an entry relative to `dirFd`, without following symlinks.
+// statx only asks for those fields (and the type if `isDir` is given), which
+// network filesystems can answer without fetching every attribute.
+static bool statEntry(int dirFd, const char* name, uint64_t& size, FILETIME& ft,
+                      bool* isDir = nullptr)
+{
+  struct statx stx;
+  const unsigned mask = STATX_SIZE | STATX_MTIME | (isDir ? STATX_TYPE : 0);
+
+  if (statx(dirFd, name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, mask, &stx) == 0) {
+    struct timespec ts;
+    ts.tv_sec  = stx.stx_mtime.tv_sec;
+    ts.tv_nsec = stx.stx_mtime.tv_nsec;
+    size       = stx.stx_size;
+    ft         = timespecToFiletime(ts);
+    if (isDir) {
+      *isDir = S_ISDIR(stx.stx_mode);
+    }
+    return true;
+  }
+
+  if (errno != ENOSYS) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstatat(dirFd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+    return false;
+  }
+  size = static_cast<uint64_t>(st.st_size);
+  ft   = timespecToFiletime(st.st_mtim);
+  if (isDir) {
+    *isDir = S_ISDIR(st.st_mode);
+  }
+  return true;
+}
+
+struct LinuxDirent64
+{
+  ino64_t d_ino;
+  off64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+constexpr std::size_t DirentBufferSize = 64 * 1024;
+
+// Recursive directory walker reading entries with getdents64 into one buffer
+// per depth.  Subdirectories are opened relative to their parent and told
+// apart by d_type, so only files (and entries the filesystem doesn't type)
+// are stat'ed.  `dirPath` is only kept for error messages.
+static void forEachEntryImpl(int dirFd, std::string& dirPath, void* cx,
+                             std::vector<std::unique_ptr<unsigned char[]>>& buffers,
+                             std::size_t depth, DirStartF* dirStartF,
+                             DirEndF* dirEndF, FileF* fileF)
+{
+  if (buffers.size() <= depth) {
+    buffers.resize(depth + 1);
+  }
+  if (!buffers[depth]) {
+    buffers[depth] = std::make_unique<unsigned char[]>(DirentBufferSize);
+  }
+  unsigned char* buffer = buffers[depth].get();
+
+  std::wstring wname;
+
+  for (;;) {
+    const long n = syscall(SYS_getdents64, dirFd, buffer, DirentBufferSize);
+    if (n < 0) {
+      log::error("failed to read directory '{}': {}", QString::fromStdString(dirPath),
+                 strerror(errno));
+      return;
     }
+    if (n == 0) {
+      return;
+    }
+
+    for (long offset = 0; offset < n;) {
+      const auto* entry = reinterpret_cast<const LinuxDirent64*>(buffer + offset);
+      offset += entry->d_reclen;
+
+      const char* name = entry->d_name;
+      if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+        continue;
+      }
+
+      uint64_t size = 0;
+      FILETIME ft   = {};
+      bool isDir    = entry->d_type == DT_DIR;
+
+      if (entry->d_type == DT_UNKNOWN) {
+        if (!statEntry(dirFd, name, size, ft, &isDir)) {
+          continue;
+        }
+      } else if (!isDir && !statEntry(dirFd, name, size, ft)) {
+        continue;
+      }
+
+      decodeName(name, wname);
+
+      if (!isDir) {
+        fileF(cx, std::wstring_view(wname), ft, size);
+        continue;
+      }
+
+      if (!dirStartF || !dirEndF) {
+        continue;
+      }
+
+      const size_t parentLength = dirPath.size();
+      dirPath.push_back('/');
+      dirPath.append(name);
 
-    if (S_ISDIR(st.st_mode)) {
-      if (dirStartF && dirEndF) {
-        std::wstring_view nameView(wname);
+      const int childFd =
+          openat(dirFd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+      if (childFd < 0) {
+        log::error("failed to open directory '{}': {}", QString::fromStdString(dirPath),
+                   strerror(errno));
+      } else {
+        const std::wstring_view nameView(wname);
         dirStartF(cx, nameView);
-        forEachEntryImpl(fullPath, cx, dirStartF, dirEndF, fileF);
+        forEachEntryImpl(childFd, dirPath, cx, buffers, depth + 1, dirStartF, dirEndF,
+                         fileF);
         dirEndF(cx, nameView);
+        close(childFd);
       }
-    } else {
-      FILETIME ft = timespecToFiletime(st.st_mtim);
-      fileF(cx, std::wstring_view(wname), ft, static_cast<uint64_t>(st.st_size));
+
+      dirPath.resize(parentLength);
     }
   }
-
-  closedir(dir);
 }
 
 void DirectoryWalker::forEachEntry(const std::wstring& path, void* cx,
                                    DirStartF* dirStartF, DirEndF* dirEndF, FileF* fileF)
 {
-  forEachEntryImpl(toNarrow(path), cx, dirStartF, dirEndF, fileF);
+  std::string dirPath = toNarrow(path);
+
+  int fd = open(dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0 && errno == ENOTCONN) {
+    if (tryRecoverStaleMount(dirPath)) {
+      fd = open(dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+  }
+  if (fd < 0) {
+    log::error("failed to open directory '{}': {}", QString::fromStdString(dirPath),
+               strerror(errno));
+    return;
+  }
+
+  forEachEntryImpl(fd, dirPath, cx, m_buffers, 0, dirStartF, dirEndF, fileF);
+  close(fd);
 }
 
 void forEachEntry(const std::wstring& path, void* cx, DirStartF* dirStartF,
@@ -662,6 +815,12 @@ void forEachEntry(const std::wstring& path, void* cx, DirStartF* dirStartF,
 }
 
 Directory getFilesAndDirs(const std::wstring& path)
+{
+  DirectoryWalker walker;
+  return getFilesAndDirs(walker, path);
+}
+
+Directory getFilesAndDirs(DirectoryWalker& walker, const std::wstring& path)
 {
   struct Context
   {
@@ -673,7 +832,7 @@ Directory getFilesAndDirs(const std::wstring& path)
   Context cx;
   cx.current.push(&root);
 
-  env::forEachEntry(
+  walker.forEachEntry(
       path, &cx,
       [](void* pcx, std::wstring_view path) {
         Context* cx = (Context*)pcx;
@@ -709,8 +868,8 @@ namespace env
 {
 
 File::File(std::wstring_view n, FILETIME ft, uint64_t s)
-    : name(n.begin(), n.end()), lcname(MOShared::ToLowerCopy(name)), lastModified(ft),
-      size(s)
+    : name(n.begin(), n.end()), lcname(name),
+      lchash(MOShared::ToLowerHashedInPlace(lcname)), lastModified(ft), size(s)
 {}
 
 Directory::Directory() {}
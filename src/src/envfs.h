@@ -2,6 +2,8 @@
 #define ENV_ENVFS_H
 
 #include "thread_utils.h"
+#include <condition_variable>
+#include <mutex>
 #include <thread>
 
 namespace env
@@ -11,6 +13,10 @@ struct File
 {
   std::wstring name;
   std::wstring lcname;
+
+  // DirectoryEntryFileKey::getHash() of lcname, computed along with it
+  std::size_t lchash;
+
   FILETIME lastModified;
   uint64_t size;
 
@@ -29,6 +35,9 @@ struct Directory
   Directory(std::wstring_view name);
 };
 
+// Fixed set of threads, each owning one T whose run() is called when the
+// thread is handed out by request().  Threads report back when they're done
+// through a condition variable, so neither request() nor waitForAll() polls.
 template <class T>
 class ThreadPool
 {
@@ -37,7 +46,15 @@ public:
 
   ~ThreadPool() { stopAndJoin(); }
 
-  void setMax(std::size_t n) { m_threads.resize(n); }
+  void setMax(std::size_t n)
+  {
+    while (m_threads.size() > n) {
+      m_threads.pop_back();
+    }
+    while (m_threads.size() < n) {
+      m_threads.emplace_back(*this);
+    }
+  }
 
   void stopAndJoin()
   {
@@ -55,22 +72,15 @@ public:
 
   void waitForAll()
   {
-    for (;;) {
-      bool done = true;
-
+    std::unique_lock lock(m_mutex);
+    m_idle.wait(lock, [&] {
       for (auto& ti : m_threads) {
         if (ti.busy) {
-          done = false;
-          break;
+          return false;
         }
       }
-
-      if (done) {
-        break;
-      }
-
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
-    }
+      return true;
+    });
   }
 
   T& request()
@@ -79,17 +89,19 @@ public:
       std::terminate();
     }
 
+    std::unique_lock lock(m_mutex);
     for (;;) {
       for (auto& ti : m_threads) {
         bool expected = false;
 
         if (ti.busy.compare_exchange_strong(expected, true)) {
+          lock.unlock();
           ti.wakeup();
           return ti.o;
         }
       }
 
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      m_idle.wait(lock);
     }
   }
 
@@ -104,6 +116,7 @@ public:
 private:
   struct ThreadInfo
   {
+    ThreadPool& pool;
     std::thread thread;
     std::atomic<bool> busy;
     T o;
@@ -114,7 +127,7 @@ private:
 
     std::atomic<bool> stop;
 
-    ThreadInfo() : busy(true), ready(false), stop(false)
+    explicit ThreadInfo(ThreadPool& p) : pool(p), busy(true), ready(false), stop(false)
     {
       thread = MOShared::startSafeThread([&] {
         run();
@@ -140,9 +153,19 @@ private:
       cv.notify_one();
     }
 
+    void idle()
+    {
+      {
+        std::scoped_lock lock(pool.m_mutex);
+        busy = false;
+      }
+
+      pool.m_idle.notify_all();
+    }
+
     void run()
     {
-      busy = false;
+      idle();
 
       while (!stop) {
         std::unique_lock lock(mutex);
@@ -157,11 +180,16 @@ private:
         o.run();
 
         ready = false;
-        busy  = false;
+        lock.unlock();
+        idle();
       }
     }
   };
 
+  // guards busy going back to false, see ThreadInfo::idle()
+  std::mutex m_mutex;
+  std::condition_variable m_idle;
+
   std::list<ThreadInfo> m_threads;
 };
 
@@ -185,6 +213,7 @@ void forEachEntry(const std::wstring& path, void* cx, DirStartF* dirStartF,
                   DirEndF* dirEndF, FileF* fileF);
 
 Directory getFilesAndDirs(const std::wstring& path);
+Directory getFilesAndDirs(DirectoryWalker& walker, const std::wstring& path);
 Directory getFilesAndDirsWithFind(const std::wstring& path);
 
 }  // namespace env
@@ -30,8 +30,7 @@ bool canOpenFile(const FileEntry& file)
 
 bool isHidden(const FileEntry& file)
 {
-  return (QString::fromStdWString(file.getName())
-              .endsWith(ModInfo::s_HiddenExt, Qt::CaseInsensitive));
+  return isHiddenName(file.getName());
 }
 
 bool canExploreFile(const FileEntry& file);
@@ -167,6 +166,11 @@ void FileTree::ensureFullyLoaded()
   m_model->ensureFullyLoaded();
 }
 
+void FileTree::ensureLoadedForSearch(const std::function<bool(const QString&)>& pred)
+{
+  m_model->ensureLoadedForSearch(pred);
+}
+
 FileTreeItem* FileTree::singleSelection()
 {
   const auto sel = m_tree->selectionModel()->selectedRows();
@@ -396,7 +400,7 @@ void FileTree::toggleVisibility(bool visible, FileTreeItem* item)
                       (visible ? FileRenamer::UNHIDE : FileRenamer::HIDE));
 
   if (renamer.rename(currentName, newName) == FileRenamer::RESULT_OK) {
-    emit originModified(item->originID());
+    m_core.applyModRenames(item->originID(), {{currentName, newName}});
     refresh();
   }
 }
@@ -27,6 +27,7 @@ public:
 
   bool fullyLoaded() const;
   void ensureFullyLoaded();
+  void ensureLoadedForSearch(const std::function<bool(const QString&)>& pred);
 
   void expandAll();
   void collapseAll();
@@ -47,7 +48,6 @@ public:
 
 signals:
   void executablesChanged();
-  void originModified(int originID);
   void displayModInformation(ModInfo::Ptr m, unsigned int i, ModInfoTabIDs tab);
 
 private:
@@ -184,7 +184,16 @@ void* makeInternalPointer(FileTreeItem* item)
 FileTreeModel::FileTreeModel(OrganizerCore& core, QObject* parent)
     : QAbstractItemModel(parent), m_core(core), m_enabled(true),
       m_root(FileTreeItem::createDirectory(this, nullptr, L"", L"")),
-      m_flags(HiddenFiles), m_fullyLoaded(false), m_sortingEnabled(true)
+      m_flags(HiddenFiles), m_iconFetcher([this] {
+        // called from the fetcher's thread
+        QMetaObject::invokeMethod(
+            this,
+            [this] {
+              updatePendingIcons();
+            },
+            Qt::QueuedConnection);
+      }),
+      m_fullyLoaded(false), m_sortingEnabled(true)
 {
   m_root->setExpanded(true);
   m_sortTimer.setSingleShot(true);
@@ -195,9 +204,6 @@ FileTreeModel::FileTreeModel(OrganizerCore& core, QObject* parent)
   connect(&m_sortTimer, &QTimer::timeout, [&] {
     sortItems();
   });
-  connect(&m_iconPendingTimer, &QTimer::timeout, [&] {
-    updatePendingIcons();
-  });
 }
 
 void FileTreeModel::refresh()
@@ -205,6 +211,9 @@ void FileTreeModel::refresh()
   TimeThis tt("FileTreeModel::refresh()");
 
   m_fullyLoaded = false;
+  m_searchDirectories.clear();
+  m_searchNames.clear();
+
   update(*m_root, *m_core.directoryStructure(), L"", false);
   sortItem(*m_root, false);
 }
@@ -212,6 +221,8 @@ void FileTreeModel::refresh()
 void FileTreeModel::clear()
 {
   m_fullyLoaded = false;
+  m_searchDirectories.clear();
+  m_searchNames.clear();
 
   beginResetModel();
   m_root->clear();
@@ -239,6 +250,90 @@ void FileTreeModel::ensureFullyLoaded()
   }
 }
 
+void FileTreeModel::ensureLoadedForSearch(
+    const std::function<bool(const QString&)>& pred)
+{
+  if (m_fullyLoaded) {
+    return;
+  }
+
+  TimeThis tt("FileTreeModel::ensureLoadedForSearch()");
+
+  if (m_searchDirectories.empty()) {
+    buildSearchIndex();
+  }
+
+  // marks the directories containing a match along with all their parents
+  std::vector<char> needed(m_searchDirectories.size(), 0);
+
+  for (const auto& e : m_searchNames) {
+    if (needed[e.parent] || !pred(e.name)) {
+      continue;
+    }
+
+    for (int d = e.parent; d != -1 && !needed[d]; d = m_searchDirectories[d].parent) {
+      needed[d] = 1;
+    }
+  }
+
+  // parents come first, so the item of a directory's parent is always loaded
+  // by the time the directory is looked up in it
+  std::vector<FileTreeItem*> items(m_searchDirectories.size(), nullptr);
+  items[0] = m_root.get();
+
+  for (std::size_t i = 0; i < m_searchDirectories.size(); ++i) {
+    if (!needed[i]) {
+      continue;
+    }
+
+    if (i > 0) {
+      const auto& dir = m_searchDirectories[i];
+      if (auto* parentItem = items[dir.parent]) {
+        for (const auto& child : parentItem->children()) {
+          if (child->isDirectory() && child->filename() == dir.name) {
+            items[i] = child.get();
+            break;
+          }
+        }
+      }
+    }
+
+    // directories that aren't shown have no item, neither do their children
+    if (auto* item = items[i]; item && !item->isLoaded()) {
+      doFetchMore(indexFromItem(*item), false, false);
+    }
+  }
+
+  sortItem(*m_root, false);
+}
+
+void FileTreeModel::buildSearchIndex()
+{
+  m_searchDirectories.push_back({-1, {}});
+  addToSearchIndex(*m_core.directoryStructure(), 0);
+
+  log::debug("file tree search index has {} directories and {} names",
+             m_searchDirectories.size(), m_searchNames.size());
+}
+
+void FileTreeModel::addToSearchIndex(const DirectoryEntry& dir, int parent)
+{
+  dir.forEachFile([&](auto&& f) {
+    m_searchNames.push_back({parent, QString::fromStdWString(f.getName())});
+    return true;
+  });
+
+  for (auto* subdir : dir.getSubDirectories()) {
+    const int index = static_cast<int>(m_searchDirectories.size());
+    auto name       = QString::fromStdWString(subdir->getName());
+
+    m_searchNames.push_back({parent, name});
+    m_searchDirectories.push_back({parent, std::move(name)});
+
+    addToSearchIndex(*subdir, index);
+  }
+}
+
 bool FileTreeModel::enabled() const
 {
   return m_enabled;
@@ -971,9 +1066,7 @@ void FileTreeModel::updateFileItem(FileTreeItem& item, const MOShared::FileEntry
 bool FileTreeModel::shouldShowFile(const FileEntry& file) const
 {
   if (showConflictsOnly() &&
-      ((file.getAlternatives().size() == 0) ||
-       QString::fromStdWString(file.getName())
-           .endsWith(ModInfo::s_HiddenExt, Qt::CaseInsensitive))) {
+      ((file.getAlternatives().size() == 0) || isHiddenName(file.getName()))) {
     // only conflicts should be shown, but this file is hidden or not conflicted
     return false;
   }
@@ -983,8 +1076,7 @@ bool FileTreeModel::shouldShowFile(const FileEntry& file) const
     return false;
   }
 
-  if (!showHiddenFiles() && QString::fromStdWString(file.getName())
-                                .endsWith(ModInfo::s_HiddenExt, Qt::CaseInsensitive)) {
+  if (!showHiddenFiles() && isHiddenName(file.getName())) {
     // hidden files shouldn't be shown, but this file is hidden
     return false;
   }
@@ -995,9 +1087,7 @@ bool FileTreeModel::shouldShowFile(const FileEntry& file) const
 bool FileTreeModel::shouldShowFolder(const DirectoryEntry& dir,
                                      const FileTreeItem* item) const
 {
-  if ((!showHiddenFiles() || showConflictsOnly()) &&
-      QString::fromStdWString(dir.getName())
-          .endsWith(ModInfo::s_HiddenExt, Qt::CaseInsensitive)) {
+  if ((!showHiddenFiles() || showConflictsOnly()) && dir.isHidden()) {
     return false;
   }
 
@@ -1166,7 +1256,7 @@ QString FileTreeModel::makeTooltip(const FileTreeItem& item) const
       item.dataRelativeFilePath().toStdWString(), nullptr);
 
   if (file) {
-    const auto alternatives = file->getAlternatives();
+    const auto& alternatives = file->getAlternatives();
     QStringList list;
 
     for (auto&& alt : alternatives) {
@@ -1202,8 +1292,8 @@ QVariant FileTreeModel::makeIcon(const FileTreeItem& item,
     return v;
   }
 
+  // refreshed once the fetcher has the icon
   m_iconPending.push_back(index);
-  m_iconPendingTimer.start(std::chrono::milliseconds(1));
 
   return m_iconFetcher.genericFileIcon();
 }
@@ -1216,10 +1306,6 @@ void FileTreeModel::updatePendingIcons()
   for (auto&& index : v) {
     emit dataChanged(index, index, {Qt::DecorationRole});
   }
-
-  if (m_iconPending.empty()) {
-    m_iconPendingTimer.stop();
-  }
 }
 
 void FileTreeModel::removePendingIcons(const QModelIndex& parent, int first, int last)
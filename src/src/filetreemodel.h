@@ -4,6 +4,7 @@
 #include "filetreeitem.h"
 #include "iconfetcher.h"
 #include "shared/fileregisterfwd.h"
+#include <functional>
 #include <unordered_set>
 
 class OrganizerCore;
@@ -52,6 +53,13 @@ public:
 
   void ensureFullyLoaded();
 
+  // loads only the directories leading to a file or directory whose name
+  // matches `pred`, which is all a recursive filter on the names needs to find
+  // every match; the names are looked up in an index of the directory structure
+  // built on first use instead of in the items
+  //
+  void ensureLoadedForSearch(const std::function<bool(const QString&)>& pred);
+
   bool enabled() const;
   void setEnabled(bool b);
 
@@ -82,17 +90,32 @@ private:
 
   using DirectoryIterator = std::vector<MOShared::DirectoryEntry*>::const_iterator;
 
+  // a file or directory in the search index
+  //
+  struct SearchEntry
+  {
+    // directory containing the entry, index in m_searchDirectories
+    int parent;
+    QString name;
+  };
+
   OrganizerCore& m_core;
   bool m_enabled;
   mutable FileTreeItem::Ptr m_root;
   Flags m_flags;
   mutable IconFetcher m_iconFetcher;
   mutable std::vector<QModelIndex> m_iconPending;
-  mutable QTimer m_iconPendingTimer;
   SortInfo m_sort;
   bool m_fullyLoaded;
   bool m_sortingEnabled;
 
+  // see ensureLoadedForSearch(); every directory of the structure with the
+  // parents before their children, the first one is the root
+  std::vector<SearchEntry> m_searchDirectories;
+
+  // the files and directories in all the directories above
+  std::vector<SearchEntry> m_searchNames;
+
   // see top of filetreemodel.cpp
   std::vector<FileTreeItem*> m_removeItems;
   std::vector<FileTreeItem*> m_sortItems;
@@ -170,6 +193,9 @@ private:
 
   QModelIndex indexFromItem(FileTreeItem& item, int col = 0) const;
   void recursiveFetchMore(const QModelIndex& m);
+
+  void buildSearchIndex();
+  void addToSearchIndex(const MOShared::DirectoryEntry& dir, int parent);
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(FileTreeModel::Flags);
@@ -1,26 +1,37 @@
 #include "fuseconnector.h"
 
 #include "settings.h"
+#include "vfs/indexer.h"
+#include "vfs/layercache.h"
 #include "vfs/vfstree.h"
 
 #include <QCoreApplication>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QList>
 #include <QProcess>
+#include <QSaveFile>
+#include <QSettings>
 #include <QStandardPaths>
-#include <QTextStream>
 #include <QVariant>
+#include <QtConcurrent/QtConcurrentRun>
 
 #include <iplugingame.h>
+#include <memoryusage.h>
+#include <utility.h>
 
 #include <algorithm>
+#include <array>
 #include <cerrno>
 #include <cstring>
 #include <fcntl.h>
 #include <filesystem>
 #include <fstream>
+#include <mutex>
+#include <poll.h>
 #include <set>
+#include <sys/eventfd.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -54,7 +65,93 @@ bool isFlatpak()
   return result;
 }
 
-bool waitForHelperLine(QProcess* proc, const char* expected, int timeoutMs)
+bool spliceReadsEnabled()
+{
+  return QSettings().value("fluorine/vfs_splice_reads", true).toBool();
+}
+
+bool passthroughEnabled()
+{
+  return QSettings().value("fluorine/vfs_passthrough", false).toBool();
+}
+
+bool writebackCacheEnabled()
+{
+  return QSettings().value("fluorine/vfs_writeback_cache", false).toBool();
+}
+
+bool serveArchivesEnabled()
+{
+  return QSettings().value("fluorine/vfs_serve_archives", false).toBool();
+}
+
+bool lazyCopyUpEnabled()
+{
+  return QSettings().value("fluorine/vfs_lazy_copy_up", true).toBool();
+}
+
+bool prefetchEnabled()
+{
+  return QSettings().value("fluorine/vfs_prefetch", true).toBool();
+}
+
+bool accessTraceEnabled()
+{
+  return QSettings().value("fluorine/vfs_access_trace", true).toBool();
+}
+
+bool persistentMountEnabled()
+{
+  return QSettings().value("fluorine/vfs_keep_mounted", false).toBool();
+}
+
+bool indexerEnabled()
+{
+  return QSettings().value("fluorine/vfs_indexer", false).toBool();
+}
+
+int negativeLookupTtl()
+{
+  return QSettings().value("fluorine/vfs_negative_ttl", 30).toInt();
+}
+
+FuseLoopOptions fuseLoopOptions()
+{
+  const QSettings settings;
+
+  FuseLoopOptions options;
+  options.max_threads      = settings.value("fluorine/vfs_max_threads", 0).toUInt();
+  options.max_idle_threads = settings.value("fluorine/vfs_max_idle_threads", 0).toUInt();
+  options.clone_fd         = settings.value("fluorine/vfs_clone_fd", true).toBool();
+  return options;
+}
+
+// installed with the Flatpak, see mountViaHelper()
+QString helperBinary()
+{
+  const QString dataDir =
+      QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation);
+  return QDir(dataDir).filePath("fluorine/bin/mo2-vfs-helper");
+}
+
+FuseConnector* g_instance = nullptr;
+
+// the data directory of the native mount and the path of its backing fd in
+// /proc, which still leads to the directory under the mount
+std::mutex g_backingMutex;
+std::string g_backingDataDir;
+std::string g_backingPath;
+
+void setBackingDirectory(const std::string& dataDir, int fd)
+{
+  std::scoped_lock lock(g_backingMutex);
+  g_backingDataDir = dataDir;
+  g_backingPath    = (fd >= 0 ? "/proc/self/fd/" + std::to_string(fd) : "");
+}
+
+// waits for `expected`, collecting the lines before it in `output` if given
+bool waitForHelperLine(QProcess* proc, const char* expected, int timeoutMs,
+                       QList<QByteArray>* output = nullptr)
 {
   const QByteArray target(expected);
   const auto deadline =
@@ -70,6 +167,9 @@ bool waitForHelperLine(QProcess* proc, const char* expected, int timeoutMs)
         log::error("VFS helper: {}", QString::fromUtf8(line));
         return false;
       }
+      if (output != nullptr) {
+        output->append(line);
+      }
       continue;
     }
 
@@ -85,14 +185,28 @@ bool waitForHelperLine(QProcess* proc, const char* expected, int timeoutMs)
   return false;
 }
 
-bool sendHelperCommand(QProcess* proc, const char* command, int timeoutMs)
+bool writeHelperMessage(QProcess* proc, HelperMessage type,
+                        std::string_view payload = {})
 {
-  proc->write(command);
-  proc->write("\n");
-  if (!proc->waitForBytesWritten(1000)) {
+  const std::string message = frameHelperMessage(type, payload);
+  if (proc->write(message.data(), static_cast<qint64>(message.size())) !=
+      static_cast<qint64>(message.size())) {
     return false;
   }
-  return waitForHelperLine(proc, "ok", timeoutMs);
+  while (proc->bytesToWrite() > 0) {
+    if (!proc->waitForBytesWritten(5000)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool sendHelperMessage(QProcess* proc, HelperMessage type, int timeoutMs,
+                       std::string_view payload = {},
+                       QList<QByteArray>* output = nullptr)
+{
+  return writeHelperMessage(proc, type, payload) &&
+         waitForHelperLine(proc, "ok", timeoutMs, output);
 }
 
 std::string decodeProcMountField(const std::string& in)
@@ -212,30 +326,106 @@ buildModsFromMapping(const MappingType& mapping, const QString& dataDir,
 void setupFuseOps(struct fuse_lowlevel_ops* ops)
 {
   std::memset(ops, 0, sizeof(struct fuse_lowlevel_ops));
-  ops->lookup  = mo2_lookup;
-  ops->getattr = mo2_getattr;
-  ops->readdir = mo2_readdir;
-  ops->open    = mo2_open;
-  ops->read    = mo2_read;
-  ops->write   = mo2_write;
-  ops->create  = mo2_create;
-  ops->rename  = mo2_rename;
-  ops->setattr = mo2_setattr;
-  ops->unlink  = mo2_unlink;
-  ops->mkdir   = mo2_mkdir;
-  ops->release = mo2_release;
+  ops->init        = mo2_init;
+  ops->lookup      = mo2_lookup;
+  ops->getattr     = mo2_getattr;
+  ops->opendir     = mo2_opendir;
+  ops->readdir     = mo2_readdir;
+  ops->readdirplus = mo2_readdirplus;
+  ops->releasedir  = mo2_releasedir;
+  ops->open        = mo2_open;
+  ops->read        = mo2_read;
+  ops->write       = mo2_write;
+  ops->create      = mo2_create;
+  ops->rename      = mo2_rename;
+  ops->setattr     = mo2_setattr;
+  ops->unlink      = mo2_unlink;
+  ops->mkdir       = mo2_mkdir;
+  ops->flush       = mo2_flush;
+  ops->fsync       = mo2_fsync;
+  ops->release     = mo2_release;
+}
+
+// lists the external symlinks deployed for the instance owning `overwrite_dir`
+std::string externalManifestPath(const std::string& overwrite_dir)
+{
+  return (fs::path(layerCachePath(overwrite_dir)).parent_path() / "external_links.txt")
+      .string();
 }
 
 }  // namespace
 
 FuseConnector::FuseConnector(QObject* parent) : QObject(parent)
 {
+  g_instance = this;
   log::debug("FUSE connector initialized");
 }
 
 FuseConnector::~FuseConnector()
 {
   unmount();
+  cleanupExternalMappings();
+  if (g_instance == this) {
+    g_instance = nullptr;
+  }
+}
+
+FuseConnector* FuseConnector::instance()
+{
+  return g_instance;
+}
+
+QString FuseConnector::backingDirectory(const QString& dataDir)
+{
+  std::scoped_lock lock(g_backingMutex);
+  if (g_backingPath.empty() ||
+      fs::path(dataDir.toStdString()).lexically_normal() !=
+          fs::path(g_backingDataDir).lexically_normal()) {
+    return {};
+  }
+
+  return QString::fromStdString(g_backingPath);
+}
+
+QByteArray FuseConnector::metricsJson()
+{
+  if (!m_mounted) {
+    return {};
+  }
+
+  if (m_helperStatus != nullptr) {
+    return QByteArray::fromStdString(m_helperStatus->metrics.toJson());
+  }
+
+  if (m_helperProcess) {
+    QList<QByteArray> output;
+    if (!sendHelperMessage(m_helperProcess, HelperMessage::Metrics, 5000, {}, &output) ||
+        output.isEmpty()) {
+      return {};
+    }
+    return output.last();
+  }
+
+  if (m_context == nullptr) {
+    return {};
+  }
+  return QByteArray::fromStdString(m_context->metrics->toJson());
+}
+
+void FuseConnector::resetMetrics()
+{
+  if (!m_mounted) {
+    return;
+  }
+
+  if (m_helperStatus != nullptr) {
+    m_helperStatus->metrics.reset();
+    m_helperStatus->flushed_bytes.store(0, std::memory_order_relaxed);
+  } else if (m_helperProcess) {
+    sendHelperMessage(m_helperProcess, HelperMessage::MetricsReset, 5000);
+  } else if (m_context != nullptr) {
+    m_context->metrics->reset();
+  }
 }
 
 bool FuseConnector::mount(
@@ -243,6 +433,8 @@ bool FuseConnector::mount(
     const QString& data_dir_name,
     const std::vector<std::pair<std::string, std::string>>& mods)
 {
+  TimeThis tt("FuseConnector::mount()");
+
   if (m_mounted) {
     unmount();
   }
@@ -282,10 +474,14 @@ bool FuseConnector::mount(
   // Reuse the cache across mount/unmount cycles since base game files don't
   // change between runs — this avoids a full recursive directory walk on
   // every launch.
+  // The on-disk layer cache covers the first mount of a run as well, the base
+  // layer is only re-walked when one of its directories changed.
+  auto layerCache = sharedLayerCache(m_overwriteDir);
+
   if (m_baseFileCache.empty() || m_dataDirPath != m_cachedDataDirPath) {
-    m_baseFileCache    = scanDataDir(m_dataDirPath);
+    m_baseFileCache     = layerCache->scan("_base_game", m_dataDirPath)->entries;
     m_cachedDataDirPath = m_dataDirPath;
-    log::debug("Scanned {} base game entries from {}", m_baseFileCache.size(),
+    log::debug("Loaded {} base game entries for {}", m_baseFileCache.size(),
                QString::fromStdString(m_dataDirPath));
   } else {
     log::debug("Reusing cached {} base game entries for {}",
@@ -300,20 +496,28 @@ bool FuseConnector::mount(
             .arg(QString::fromStdString(m_dataDirPath)));
   }
 
-  // Build tree using cached base files + mods + overwrite
-  auto tree = std::make_shared<VfsTree>(
-      buildDataDirVfs(m_baseFileCache, m_dataDirPath, mods, m_overwriteDir));
-
-  // Inject file-level data-dir mappings (e.g. plugins.txt, loadorder.txt)
-  injectExtraFiles(*tree, m_extraVfsFiles);
-
-  m_context                 = std::make_shared<Mo2FsContext>();
-  m_context->tree           = tree;
-  m_context->inodes         = std::make_unique<InodeTable>();
-  m_context->overwrite      = std::make_unique<OverwriteManager>(m_stagingDir, m_overwriteDir);
-  m_context->backing_dir_fd = m_backingFd;
-  m_context->uid            = ::getuid();
-  m_context->gid            = ::getgid();
+  m_context                   = std::make_shared<Mo2FsContext>();
+  m_context->inodes           = std::make_unique<InodeTable>();
+  m_context->overwrite        = std::make_unique<OverwriteManager>(m_stagingDir, m_overwriteDir);
+  m_context->backing_dir_fd   = m_backingFd;
+  m_context->uid              = ::getuid();
+  m_context->gid              = ::getgid();
+  m_context->splice_reads     = spliceReadsEnabled();
+  m_context->passthrough      = passthroughEnabled();
+  m_context->writeback_cache  = writebackCacheEnabled();
+  m_context->serve_archives   = serveArchivesEnabled();
+  m_context->negative_timeout = negativeLookupTtl();
+  m_context->lazy_copy_up     = lazyCopyUpEnabled();
+  m_context->prefetch         = prefetchEnabled();
+
+  // Build tree using cached base files + mods + overwrite, with file-level
+  // data-dir mappings (e.g. plugins.txt, loadorder.txt) injected on top
+  auto layers = scanLayers(makeBaseLayer(m_baseFileCache), mods, m_overwriteDir,
+                           layerCache->layers());
+  layerCache->update(layers);
+  m_context->updateLayers(std::move(layers), m_extraVfsFiles, false);
+  layerCache->save();
+  reportMemoryUsage();
 
   // NOTE: Do NOT include mount_point here — low-level API passes it
   // separately to fuse_session_mount(). Including it here causes
@@ -350,24 +554,30 @@ bool FuseConnector::mount(
             .arg(QString::fromStdString(m_mountPoint)));
   }
 
-  m_fuseThread = std::thread([this]() {
-    fuse_session_loop_mt(m_session, nullptr);
+  m_context->session = m_session;
+
+  m_fuseThread = std::thread([this, options = fuseLoopOptions()]() {
+    runFuseLoop(m_session, options);
   });
 
   m_mounted = true;
   setFuseMountPointForCrashCleanup(m_mountPoint.c_str());
+  setBackingDirectory(m_dataDirPath, m_backingFd);
   log::debug("FUSE mounted on data dir {}", QString::fromStdString(m_mountPoint));
   return true;
 }
 
 void FuseConnector::unmount()
 {
+  waitForStagingFlush();
+
   if (!m_mounted) {
     return;
   }
 
   if (m_helperProcess) {
-    sendHelperCommand(m_helperProcess, "quit", 10000);
+    // the helper writes its trace itself once it quits
+    sendToHelper(HelperMessage::Quit, 10000);
     m_helperProcess->waitForFinished(5000);
     if (m_helperProcess->state() != QProcess::NotRunning) {
       m_helperProcess->kill();
@@ -375,14 +585,19 @@ void FuseConnector::unmount()
     }
     delete m_helperProcess;
     m_helperProcess = nullptr;
+    closeHelperStatus();
     m_mounted       = false;
     setFuseMountPointForCrashCleanup(nullptr);
-    cleanupExternalMappings();
     log::debug("VFS helper stopped, FUSE unmounted from {}",
                QString::fromStdString(m_mountPoint));
     return;
   }
 
+  stopAccessReplay();
+  if (m_context != nullptr && !m_context->access_trace.stop()) {
+    log::warn("failed to write the VFS access trace");
+  }
+
   if (m_session != nullptr) {
     fuse_session_exit(m_session);
     fuse_session_unmount(m_session);
@@ -393,12 +608,14 @@ void FuseConnector::unmount()
   }
 
   if (m_session != nullptr) {
+    m_context->session = nullptr;
     fuse_session_destroy(m_session);
     m_session = nullptr;
   }
 
   flushStaging();
 
+  setBackingDirectory({}, -1);
   if (m_backingFd >= 0) {
     close(m_backingFd);
     m_backingFd = -1;
@@ -408,9 +625,6 @@ void FuseConnector::unmount()
   m_mounted = false;
   setFuseMountPointForCrashCleanup(nullptr);
 
-  // Clean up symlinks created for non-data-dir mappings.
-  cleanupExternalMappings();
-
   log::debug("FUSE unmounted from {}", QString::fromStdString(m_mountPoint));
 }
 
@@ -423,6 +637,8 @@ void FuseConnector::rebuild(
     const std::vector<std::pair<std::string, std::string>>& mods,
     const QString& overwrite_dir, const QString& data_dir_name)
 {
+  waitForStagingFlush();
+
   if (!m_mounted) {
     return;
   }
@@ -432,13 +648,34 @@ void FuseConnector::rebuild(
   m_lastMods     = mods;
 
   if (m_helperProcess) {
-    const QString dataDir =
-        QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation);
-    const QString configPath = QDir(dataDir).filePath("fluorine/vfs.cfg");
-    writeVfsConfig(configPath, QString::fromStdString(m_mountPoint),
-                   overwrite_dir, QString::fromStdString(m_gameDir),
-                   data_dir_name, mods);
-    sendHelperCommand(m_helperProcess, "rebuild", 10000);
+    // only the range of the mod list that changed goes over the pipe, the
+    // helper then patches its tree just like the native path below
+    HelperUpdate update;
+    update.overwrite_dir = m_overwriteDir;
+    update.data_dir_name = m_dataDirName;
+    update.mods          = diffModList(m_helperMods, mods);
+    update.extra_files   = m_extraVfsFiles;
+    update.access_trace  = m_accessTrace;
+
+    // layers of the mods that changed, scanned here where the directory
+    // refresher keeps them current anyway
+    auto layerCache = sharedLayerCache(m_overwriteDir);
+    auto layers     = scanLayers(nullptr, update.mods.middle, m_overwriteDir,
+                                 layerCache->layers());
+    layerCache->update(layers);
+    layerCache->save();
+    update.layers = encodeLayerImage(layers);
+    if (update.layers.size() > HelperMaxPayload / 2) {
+      update.layers.clear();
+    }
+
+    if (sendToHelper(HelperMessage::Update, 30000, encodeHelperUpdate(update))) {
+      m_helperMods = mods;
+    } else {
+      // the helper may or may not have applied it, resend everything next time
+      log::error("VFS helper failed to rebuild");
+      m_helperMods.clear();
+    }
     return;
   }
 
@@ -446,15 +683,51 @@ void FuseConnector::rebuild(
     return;
   }
 
-  // Use cached base files - can't re-scan the data dir since it's behind our mount
-  auto newTree = std::make_shared<VfsTree>(
-      buildDataDirVfs(m_baseFileCache, m_dataDirPath, mods, m_overwriteDir));
+  // Reuse the scanned layers of mods that didn't change (the base game layer
+  // always is, it can't be re-scanned since it's behind our mount) and only
+  // re-resolve the paths provided by mods that were added, removed or moved.
+  const auto start = std::chrono::steady_clock::now();
+  auto layers = scanLayers(m_context->layers.front(), mods, m_overwriteDir,
+                           m_context->layers);
+  auto layerCache = sharedLayerCache(m_overwriteDir);
+  layerCache->update(layers);
+  const bool patched = m_context->updateLayers(std::move(layers), m_extraVfsFiles);
+  layerCache->save();
+  reportMemoryUsage();
+
+  log::debug("VFS {} in {} ms", patched ? "patched" : "rebuilt",
+             std::chrono::duration_cast<std::chrono::milliseconds>(
+                 std::chrono::steady_clock::now() - start)
+                 .count());
+}
 
-  // Inject file-level data-dir mappings (e.g. plugins.txt, loadorder.txt)
-  injectExtraFiles(*newTree, m_extraVfsFiles);
+void FuseConnector::reportMemoryUsage()
+{
+  using namespace MOBase::memory;
 
-  std::unique_lock lock(m_context->tree_mutex);
-  m_context->tree.swap(newTree);
+  {
+    std::shared_lock lock(m_context->tree_mutex);
+    if (m_context->tree != nullptr) {
+      report("vfs tree", static_cast<qint64>(m_context->tree->memoryUsage()),
+             static_cast<qint64>(m_context->tree->nodeCount()));
+    }
+  }
+
+  std::size_t inodes      = 0;
+  const std::size_t bytes = m_context->inodes->memoryUsage(inodes);
+  report("vfs inodes", static_cast<qint64>(bytes), static_cast<qint64>(inodes));
+
+  std::size_t layerBytes = 0;
+  std::size_t entries    = 0;
+  for (const auto& layer : m_context->layers) {
+    layerBytes += sizeof(VfsLayer) + heapBytes(layer->origin) + heapBytes(layer->root) +
+                  heapBytes(layer->entries);
+    for (const auto& e : layer->entries) {
+      layerBytes += heapBytes(e.relative_path);
+    }
+    entries += layer->entries.size();
+  }
+  report("vfs layers", static_cast<qint64>(layerBytes), static_cast<qint64>(entries));
 }
 
 void FuseConnector::updateMapping(const MappingType& mapping)
@@ -473,24 +746,64 @@ void FuseConnector::updateMapping(const MappingType& mapping)
 
   // Deploy non-data-dir mappings as real symlinks and collect file-level
   // data-dir mappings for VFS tree injection.
-  deployExternalMappings(mapping, dataDirPath);
+  deployExternalMappings(mapping, dataDirPath, overwriteDir);
 
   if (!m_mounted) {
     mount(dataDirPath, overwriteDir, gameDir, dataDirName, mods);
   } else {
     rebuild(mods, overwriteDir, dataDirName);
   }
+
+  // the helper got the trace along with the mapping
+  if (!m_accessTrace.empty() && m_helperProcess == nullptr && m_context != nullptr) {
+    startAccessTrace();
+  }
+  m_accessTrace.clear();
+}
+
+void FuseConnector::setAccessTrace(const QString& path)
+{
+  m_accessTrace = accessTraceEnabled() ? path.toStdString() : std::string();
+}
+
+void FuseConnector::startAccessTrace()
+{
+  // the trace of the previous launch is written out before the new one starts
+  stopAccessReplay();
+  m_context->access_trace.start(m_accessTrace);
+
+  // reads ahead while the prefix starts, the game then finds its files in the
+  // page cache; the backing fd stays open until the replay is stopped
+  m_accessReplay = std::thread([context = m_context] {
+    context->access_trace.replay(context->backing_dir_fd);
+  });
+}
+
+void FuseConnector::stopAccessReplay()
+{
+  if (m_context != nullptr) {
+    m_context->access_trace.cancel();
+  }
+  if (m_accessReplay.joinable()) {
+    m_accessReplay.join();
+  }
 }
 
 void FuseConnector::deployExternalMappings(const MappingType& mapping,
-                                            const QString& dataDir)
+                                            const QString& dataDir,
+                                            const QString& overwriteDir)
 {
-  cleanupExternalMappings();
+  loadExternalManifest(externalManifestPath(overwriteDir.toStdString()));
   m_extraVfsFiles.clear();
 
   const QString cleanDataDir = QDir::cleanPath(dataDir);
   const QString dataPrefix   = cleanDataDir + QStringLiteral("/");
 
+  // the links the mapping asks for by path with their target, and the
+  // directories they go in
+  std::map<std::string, std::string> wanted;
+  std::set<std::string> directories;
+
   for (const auto& map : mapping) {
     const QString src =
         QDir::cleanPath(QDir::fromNativeSeparators(map.source));
@@ -535,50 +848,83 @@ void FuseConnector::deployExternalMappings(const MappingType& mapping,
 
         const fs::path destPath = fs::path(dst.toStdString()) / rel;
         if (entry.is_directory(ec)) {
-          fs::create_directories(destPath, ec);
+          directories.insert(destPath.string());
         } else if (entry.is_regular_file(ec) || entry.is_symlink(ec)) {
-          fs::create_directories(destPath.parent_path(), ec);
-          if (fs::exists(destPath, ec) && !fs::is_symlink(destPath, ec)) {
-            // Never overwrite real game files — only replace our own symlinks.
-            continue;
-          }
-          if (fs::is_symlink(destPath, ec)) {
-            fs::remove(destPath, ec);
-          }
-          fs::create_symlink(entry.path(), destPath, ec);
-          if (!ec) {
-            m_externalSymlinks.push_back(destPath.string());
-          } else {
-            log::warn("Failed to symlink {} -> {}: {}",
-                      QString::fromStdString(destPath.string()),
-                      QString::fromStdString(entry.path().string()),
-                      QString::fromStdString(ec.message()));
-          }
+          directories.insert(destPath.parent_path().string());
+          wanted.insert_or_assign(destPath.string(), entry.path().string());
         }
       }
     } else {
       // Single file symlink.
       const fs::path destPath(dst.toStdString());
-      fs::create_directories(destPath.parent_path(), ec);
-      if (fs::exists(destPath, ec) && !fs::is_symlink(destPath, ec)) {
+      directories.insert(destPath.parent_path().string());
+      wanted.insert_or_assign(destPath.string(), src.toStdString());
+    }
+  }
+
+  std::error_code ec;
+  std::size_t removed = 0;
+  std::size_t created = 0;
+
+  // links of the last launch that aren't wanted anymore or moved
+  for (auto itor = m_externalSymlinks.begin(); itor != m_externalSymlinks.end();) {
+    const auto w = wanted.find(itor->first);
+    if (w != wanted.end() && w->second == itor->second) {
+      ++itor;
+      continue;
+    }
+
+    if (fs::is_symlink(itor->first, ec)) {
+      fs::remove(itor->first, ec);
+      ++removed;
+    }
+    itor = m_externalSymlinks.erase(itor);
+  }
+
+  for (const auto& dir : directories) {
+    if (!fs::is_directory(dir, ec)) {
+      fs::create_directories(dir, ec);
+    }
+  }
+
+  for (const auto& [dest, target] : wanted) {
+    if (auto itor = m_externalSymlinks.find(dest); itor != m_externalSymlinks.end()) {
+      // deployed by the last launch, it only needs checking that it's still
+      // there
+      const fs::path current = fs::read_symlink(dest, ec);
+      if (!ec && current == fs::path(target)) {
         continue;
       }
-      if (fs::is_symlink(destPath, ec)) {
-        fs::remove(destPath, ec);
-      }
-      fs::create_symlink(fs::path(src.toStdString()), destPath, ec);
-      if (!ec) {
-        m_externalSymlinks.push_back(destPath.string());
-      } else {
-        log::warn("Failed to symlink {} -> {}: {}", dst, src,
-                  QString::fromStdString(ec.message()));
+      m_externalSymlinks.erase(itor);
+    }
+
+    const auto status = fs::symlink_status(dest, ec);
+    if (fs::exists(status)) {
+      if (!fs::is_symlink(status)) {
+        // Never overwrite real game files — only replace our own symlinks.
+        continue;
       }
+      fs::remove(dest, ec);
     }
+
+    fs::create_symlink(fs::path(target), fs::path(dest), ec);
+    if (!ec) {
+      m_externalSymlinks.emplace(dest, target);
+      ++created;
+    } else {
+      log::warn("Failed to symlink {} -> {}: {}", QString::fromStdString(dest),
+                QString::fromStdString(target), QString::fromStdString(ec.message()));
+    }
+  }
+
+  if (removed > 0 || created > 0) {
+    saveExternalManifest();
   }
 
-  if (!m_externalSymlinks.empty()) {
-    log::debug("Deployed {} external symlinks for non-data-dir mappings",
-               m_externalSymlinks.size());
+  if (!m_externalSymlinks.empty() || removed > 0) {
+    log::debug("External symlinks for non-data-dir mappings: {} deployed, {} "
+               "created, {} removed",
+               m_externalSymlinks.size(), created, removed);
   }
   if (!m_extraVfsFiles.empty()) {
     log::debug("Collected {} extra file mappings for VFS injection",
@@ -593,14 +939,69 @@ void FuseConnector::cleanupExternalMappings()
   }
 
   std::error_code ec;
-  for (const auto& path : m_externalSymlinks) {
-    if (fs::is_symlink(path, ec)) {
-      fs::remove(path, ec);
+  for (const auto& link : m_externalSymlinks) {
+    if (fs::is_symlink(link.first, ec)) {
+      fs::remove(link.first, ec);
     }
   }
 
   log::debug("Cleaned up {} external symlinks", m_externalSymlinks.size());
   m_externalSymlinks.clear();
+  saveExternalManifest();
+}
+
+void FuseConnector::loadExternalManifest(const std::string& path)
+{
+  if (path == m_externalManifest) {
+    return;
+  }
+
+  // links of another instance
+  cleanupExternalMappings();
+
+  m_externalManifest = path;
+
+  QFile file(QString::fromStdString(path));
+  if (!file.open(QIODevice::ReadOnly)) {
+    return;
+  }
+
+  // a "path\ttarget" line per link
+  for (const auto& line : file.readAll().split('\n')) {
+    const auto tab = line.indexOf('\t');
+    if (tab > 0) {
+      m_externalSymlinks.insert_or_assign(line.left(tab).toStdString(),
+                                          line.mid(tab + 1).toStdString());
+    }
+  }
+}
+
+void FuseConnector::saveExternalManifest() const
+{
+  if (m_externalManifest.empty()) {
+    return;
+  }
+
+  const QString path = QString::fromStdString(m_externalManifest);
+  if (m_externalSymlinks.empty()) {
+    QFile::remove(path);
+    return;
+  }
+
+  QByteArray data;
+  for (const auto& [link, target] : m_externalSymlinks) {
+    data.append(link.data(), link.size());
+    data.append('\t');
+    data.append(target.data(), target.size());
+    data.append('\n');
+  }
+
+  QSaveFile file(path);
+  if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() ||
+      !file.commit()) {
+    log::warn("failed to write external symlinks to '{}': {}", path,
+              file.errorString());
+  }
 }
 
 void FuseConnector::updateParams(MOBase::log::Levels /*logLevel*/,
@@ -622,54 +1023,56 @@ void FuseConnector::flushStaging()
     return;
   }
 
-  const fs::path staging(m_stagingDir);
-  const fs::path overwrite(m_overwriteDir);
-  if (!fs::exists(staging)) {
-    return;
+  // replays what the session staged, see OverwriteManager
+  if (m_context != nullptr && m_context->overwrite != nullptr) {
+    m_context->overwrite->flush();
+  } else {
+    OverwriteManager(m_stagingDir, m_overwriteDir).flush();
   }
+}
 
-  std::error_code ec;
-  for (auto it = fs::recursive_directory_iterator(
-           staging, fs::directory_options::skip_permission_denied);
-       it != fs::recursive_directory_iterator(); ++it) {
-    const auto& entry = *it;
-    const fs::path rel = fs::relative(entry.path(), staging, ec);
-    if (ec || rel.empty()) {
-      continue;
-    }
+void FuseConnector::flushStagingLive()
+{
+  waitForStagingFlush();
+  flushStagingLiveNow();
+}
 
-    const fs::path dest = overwrite / rel;
-    if (entry.is_directory(ec)) {
-      fs::create_directories(dest, ec);
-      continue;
-    }
+bool FuseConnector::keepsMountedAfterRun() const
+{
+  // the directory refresher can't see the data directory behind the helper's
+  // mount, see backingDirectory()
+  return m_mounted && m_helperProcess == nullptr && m_context != nullptr &&
+         persistentMountEnabled();
+}
 
-    if (!entry.is_regular_file(ec)) {
-      continue;
-    }
+void FuseConnector::flushStagingInBackground()
+{
+  waitForStagingFlush();
 
-    fs::create_directories(dest.parent_path(), ec);
-    fs::rename(entry.path(), dest, ec);
-    if (ec) {
-      ec.clear();
-      fs::copy_file(entry.path(), dest, fs::copy_options::overwrite_existing, ec);
-      if (!ec) {
-        fs::remove(entry.path(), ec);
-      }
-    }
-  }
+  m_stagingFlush = QtConcurrent::run([this] {
+    TimeThis tt("FuseConnector::flushStagingInBackground()");
+    flushStagingLiveNow();
+    emit stagingFlushed();
+  });
+}
 
-  fs::remove_all(staging, ec);
+void FuseConnector::waitForStagingFlush()
+{
+  m_stagingFlush.waitForFinished();
 }
 
-void FuseConnector::flushStagingLive()
+void FuseConnector::flushStagingLiveNow()
 {
   if (!m_mounted) {
     return;
   }
 
   if (m_helperProcess) {
-    sendHelperCommand(m_helperProcess, "flush", 30000);
+    if (m_helperStatus != nullptr) {
+      log::debug("flushing {} bytes staged by the VFS helper",
+                 pendingStagingBytes(*m_helperStatus));
+    }
+    sendToHelper(HelperMessage::Flush, 30000);
     return;
   }
 
@@ -684,14 +1087,15 @@ void FuseConnector::flushStagingLive()
   std::error_code ec;
   fs::create_directories(m_stagingDir, ec);
 
-  // Rebuild the VFS tree to pick up new overwrite files
-  auto newTree = std::make_shared<VfsTree>(
-      buildDataDirVfs(m_baseFileCache, m_dataDirPath, m_lastMods, m_overwriteDir));
-
-  {
-    std::unique_lock lock(m_context->tree_mutex);
-    m_context->tree.swap(newTree);
-  }
+  // Rebuild the VFS tree to pick up new overwrite files.  Staged entries in
+  // the live tree now point at moved files, so this is always a full rebuild.
+  auto layers = scanLayers(m_context->layers.front(), m_lastMods, m_overwriteDir,
+                           m_context->layers);
+  auto layerCache = sharedLayerCache(m_overwriteDir);
+  layerCache->update(layers);
+  m_context->updateLayers(std::move(layers), m_extraVfsFiles, false);
+  layerCache->save();
+  reportMemoryUsage();
 
   // Re-create OverwriteManager with fresh staging dir
   m_context->overwrite = std::make_unique<OverwriteManager>(m_stagingDir, m_overwriteDir);
@@ -742,6 +1146,45 @@ static void doUnmount(const QString& path)
   }
 }
 
+void FuseConnector::updateIndexer(const QString& modsDir, const QString& overwriteDir)
+{
+  const auto link    = IndexerLink::open(overwriteDir.toStdString());
+  const bool running = (link != nullptr && link->running());
+
+  if (!indexerEnabled()) {
+    if (running) {
+      log::debug("stopping the background indexer");
+      link->stop();
+    }
+    return;
+  }
+
+  if (running) {
+    return;
+  }
+
+  const QString helperBin = helperBinary();
+  if (!QFile::exists(helperBin)) {
+    log::warn("background indexer not started, VFS helper not found: {}", helperBin);
+    return;
+  }
+
+  // it detaches itself and keeps running once Mod Organizer exits
+  QString program  = helperBin;
+  QStringList args = {QStringLiteral("--indexer"), modsDir, overwriteDir};
+  if (isFlatpak()) {
+    args.prepend(helperBin);
+    args.prepend(QStringLiteral("--host"));
+    program = QStringLiteral("flatpak-spawn");
+  }
+
+  if (QProcess::startDetached(program, args)) {
+    log::debug("started the background indexer for '{}'", modsDir);
+  } else {
+    log::warn("failed to start the background indexer '{}'", helperBin);
+  }
+}
+
 void FuseConnector::tryCleanupStaleMount(const QString& path)
 {
   if (!isStaleOrMounted(path)) {
@@ -757,34 +1200,103 @@ bool FuseConnector::mountViaHelper(
     const QString& data_dir_name,
     const std::vector<std::pair<std::string, std::string>>& mods)
 {
-  const QString dataDir =
-      QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation);
-  const QString configPath = QDir(dataDir).filePath("fluorine/vfs.cfg");
-  const QString helperBin =
-      QDir(dataDir).filePath("fluorine/bin/mo2-vfs-helper");
+  const QString helperBin = helperBinary();
 
   if (!QFile::exists(helperBin)) {
     throw FuseConnectorException(
         QObject::tr("VFS helper not found: %1").arg(helperBin));
   }
 
-  writeVfsConfig(configPath, QString::fromStdString(m_mountPoint), overwrite_dir,
-                 game_dir, data_dir_name, mods);
+  HelperConfig config;
+  config.mount_point   = m_mountPoint;
+  config.game_dir      = game_dir.toStdString();
+  config.data_dir_name = data_dir_name.toStdString();
+  config.overwrite_dir = overwrite_dir.toStdString();
+  config.splice_reads  = spliceReadsEnabled();
+  config.passthrough   = passthroughEnabled();
+  config.writeback     = writebackCacheEnabled();
+  config.archives      = serveArchivesEnabled();
+  config.lazy_copy_up  = lazyCopyUpEnabled();
+  config.prefetch      = prefetchEnabled();
+  config.negative_ttl  = negativeLookupTtl();
+  config.loop          = fuseLoopOptions();
+  config.mods          = mods;
+  config.extra_files   = m_extraVfsFiles;
+  config.access_trace  = m_accessTrace;
+
+  // The directory refresher already scanned the mods into the layer cache,
+  // hand those layers over in a memfd instead of having the helper walk them
+  // again.  flatpak-spawn forwards the fd to the host under the same number.
+  {
+    auto layerCache = sharedLayerCache(m_overwriteDir);
+    auto layers     = scanLayers(nullptr, mods, m_overwriteDir, layerCache->layers());
+    layerCache->update(layers);
+    layerCache->save();
+    config.layers_fd = createLayerImageFd(layers);
+  }
+
+  // the helper reports back through memory shared with it, falling back to
+  // text lines on its stdout if that can't be set up
+  m_helperStatusFd = createHelperStatusFd(m_helperStatus);
+  if (m_helperStatusFd >= 0) {
+    m_helperEventFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_helperEventFd < 0) {
+      closeHelperStatus();
+    }
+  }
+  config.status_fd = m_helperStatusFd;
+  config.event_fd  = m_helperEventFd;
+
+  QStringList args = {QStringLiteral("--host")};
+  for (int fd : {config.layers_fd, config.status_fd, config.event_fd}) {
+    if (fd >= 0) {
+      args << QStringLiteral("--forward-fd=%1").arg(fd);
+    }
+  }
+  args << helperBin;
+
+  const int layersFd = config.layers_fd;
+  const auto closeLayersFd = [layersFd] {
+    if (layersFd >= 0) {
+      close(layersFd);
+    }
+  };
 
   m_helperProcess = new QProcess(this);
   m_helperProcess->setProcessChannelMode(QProcess::SeparateChannels);
-  m_helperProcess->start(QStringLiteral("flatpak-spawn"),
-                         {QStringLiteral("--host"), helperBin, configPath});
+  const std::array inherited = {config.layers_fd, config.status_fd, config.event_fd};
+  m_helperProcess->setChildProcessModifier([inherited] {
+    // the fds are close-on-exec so nothing else we spawn inherits them
+    for (int fd : inherited) {
+      if (fd >= 0) {
+        ::fcntl(fd, F_SETFD, 0);
+      }
+    }
+  });
+  m_helperProcess->start(QStringLiteral("flatpak-spawn"), args);
 
   if (!m_helperProcess->waitForStarted(5000)) {
     const QString err = QString::fromUtf8(m_helperProcess->readAllStandardError());
     delete m_helperProcess;
     m_helperProcess = nullptr;
+    closeLayersFd();
+    closeHelperStatus();
     throw FuseConnectorException(
         QObject::tr("Failed to start VFS helper process. %1").arg(err));
   }
 
-  if (!waitForHelperLine(m_helperProcess, "mounted", 10000)) {
+  bool mounted = writeHelperMessage(m_helperProcess, HelperMessage::Config,
+                                    encodeHelperConfig(config));
+  if (m_helperStatus != nullptr) {
+    mounted = mounted && waitForHelper(1, 10000) &&
+              m_helperStatus->state.load(std::memory_order_relaxed) ==
+                  static_cast<uint32_t>(HelperState::Mounted);
+  } else {
+    mounted = mounted && waitForHelperLine(m_helperProcess, "mounted", 10000);
+  }
+  closeLayersFd();
+
+  if (!mounted) {
     const QString err = QString::fromUtf8(m_helperProcess->readAllStandardError());
     const QString out = QString::fromUtf8(m_helperProcess->readAllStandardOutput());
     log::error("VFS helper stderr: {}", err);
@@ -793,44 +1305,74 @@ bool FuseConnector::mountViaHelper(
     m_helperProcess->waitForFinished(2000);
     delete m_helperProcess;
     m_helperProcess = nullptr;
+    closeHelperStatus();
     throw FuseConnectorException(
         QObject::tr("VFS helper failed to mount FUSE. %1").arg(err));
   }
 
-  m_mounted = true;
+  m_helperMods = mods;
+  m_mounted    = true;
   setFuseMountPointForCrashCleanup(m_mountPoint.c_str());
   log::debug("FUSE mounted via helper on {}",
              QString::fromStdString(m_mountPoint));
   return true;
 }
 
-void FuseConnector::writeVfsConfig(
-    const QString& configPath, const QString& mount_point,
-    const QString& overwrite_dir, const QString& game_dir,
-    const QString& data_dir_name,
-    const std::vector<std::pair<std::string, std::string>>& mods)
+bool FuseConnector::sendToHelper(HelperMessage type, int timeoutMs,
+                                 std::string_view payload)
 {
-  QDir().mkpath(QFileInfo(configPath).absolutePath());
-
-  QFile file(configPath);
-  if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-    throw FuseConnectorException(
-        QObject::tr("Failed to write VFS config: %1").arg(configPath));
+  if (m_helperStatus == nullptr) {
+    return sendHelperMessage(m_helperProcess, type, timeoutMs, payload);
   }
 
-  QTextStream out(&file);
-  out << "mount_point=" << mount_point << "\n";
-  out << "game_dir=" << game_dir << "\n";
-  out << "data_dir_name=" << data_dir_name << "\n";
-  out << "overwrite_dir=" << overwrite_dir << "\n";
+  const uint64_t count = m_helperStatus->completed.load(std::memory_order_acquire) + 1;
+  return writeHelperMessage(m_helperProcess, type, payload) &&
+         waitForHelper(count, timeoutMs);
+}
+
+bool FuseConnector::waitForHelper(uint64_t count, int timeoutMs)
+{
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
 
-  for (const auto& [name, path] : mods) {
-    out << "mod=" << QString::fromStdString(name) << "|"
-        << QString::fromStdString(path) << "\n";
+  while (m_helperStatus->completed.load(std::memory_order_acquire) < count) {
+    const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                               deadline - std::chrono::steady_clock::now())
+                               .count();
+    if (remaining <= 0) {
+      log::error("VFS helper didn't answer in time");
+      return false;
+    }
+
+    // the helper signals after every message, the timeout only catches it
+    // exiting without doing so
+    pollfd pfd = {m_helperEventFd, POLLIN, 0};
+    if (::poll(&pfd, 1, static_cast<int>(std::min<long long>(remaining, 250))) > 0) {
+      eventfd_t value = 0;
+      ::eventfd_read(m_helperEventFd, &value);
+    } else if (m_helperProcess->waitForFinished(0) ||
+               m_helperProcess->state() == QProcess::NotRunning) {
+      return m_helperStatus->completed.load(std::memory_order_acquire) >= count;
+    }
+  }
+
+  if (m_helperStatus->last_ok.load(std::memory_order_relaxed) == 0) {
+    log::error("VFS helper: {}", m_helperStatus->last_error);
+    return false;
   }
 
-  for (const auto& [relPath, realPath] : m_extraVfsFiles) {
-    out << "extra_file=" << QString::fromStdString(relPath) << "|"
-        << QString::fromStdString(realPath) << "\n";
+  return true;
+}
+
+void FuseConnector::closeHelperStatus()
+{
+  unmapHelperStatus(m_helperStatus);
+  m_helperStatus = nullptr;
+
+  for (int* fd : {&m_helperStatusFd, &m_helperEventFd}) {
+    if (*fd >= 0) {
+      ::close(*fd);
+      *fd = -1;
+    }
   }
 }
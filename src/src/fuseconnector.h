@@ -2,14 +2,17 @@
 #define FUSECONNECTOR_H
 
 #include "envdump.h"
+#include "vfs/helperprotocol.h"
 #include "vfs/mo2filesystem.h"
 
+#include <QFuture>
 #include <QObject>
 #include <QString>
 
 class QProcess;
 
 #include <exception>
+#include <map>
 #include <memory>
 #include <thread>
 #include <uibase/executableinfo.h>
@@ -49,6 +52,19 @@ public:
 
   void flushStagingLive();
 
+  // whether the vfs should stay mounted once a program exits, so the next
+  // launch only remaps it; only for a mount made by this process
+  bool keepsMountedAfterRun() const;
+
+  // flushStagingLive() on a worker thread, stagingFlushed() is emitted when
+  // it's done; anything else touching the mount waits for it first
+  void flushStagingInBackground();
+
+  // has the next updateMapping() trace the files the launch reads into
+  // `path` and read ahead what the previous launch traced there, see
+  // VfsAccessTrace; does nothing if tracing is disabled
+  void setAccessTrace(const QString& path);
+
   void updateMapping(const MappingType& mapping);
   void updateParams(MOBase::log::Levels logLevel, env::CoreDumpTypes coreDumpType,
                     const QString& crashDumpsPath, std::chrono::seconds spawnDelay,
@@ -57,12 +73,42 @@ public:
   void updateForcedLibraries(
       const QList<MOBase::ExecutableForcedLoadSetting>& forced);
 
+  // operation counters of the mounted VFS as the JSON object described in
+  // VfsMetrics::toJson(); empty when nothing is mounted
+  QByteArray metricsJson();
+  void resetMetrics();
+
   static void tryCleanupStaleMount(const QString& path);
 
+  // starts the background indexer of the instance if it's enabled and not
+  // running yet, or stops it if it's been disabled, see vfs/indexer.h
+  static void updateIndexer(const QString& modsDir, const QString& overwriteDir);
+
+  // the connector of the running instance, null if there is none
+  static FuseConnector* instance();
+
+  // where the real contents of `dataDir` can be read while the vfs is mounted
+  // over it, empty if it isn't
+  static QString backingDirectory(const QString& dataDir);
+
+signals:
+  void stagingFlushed();
+
 private:
   void flushStaging();
-  void deployExternalMappings(const MappingType& mapping, const QString& dataDir);
+  void flushStagingLiveNow();
+  void waitForStagingFlush();
+  void deployExternalMappings(const MappingType& mapping, const QString& dataDir,
+                              const QString& overwriteDir);
   void cleanupExternalMappings();
+  void loadExternalManifest(const std::string& path);
+  void saveExternalManifest() const;
+  void startAccessTrace();
+  void stopAccessReplay();
+
+  // reports the memory taken by the tree, inodes and layers of an in-process
+  // mount, see MOBase::memory; the helper's are in its own process
+  void reportMemoryUsage();
 
   std::string m_mountPoint;
   std::string m_stagingDir;
@@ -76,26 +122,50 @@ private:
 
   std::vector<std::pair<std::string, std::string>> m_lastMods;
 
-  // Symlinks created for non-data-dir mappings (e.g. Paks, OBSE, UE4SS).
-  std::vector<std::string> m_externalSymlinks;
+  // Symlinks created for non-data-dir mappings (e.g. Paks, OBSE, UE4SS), by
+  // path with their target.  They stay deployed until the connector is
+  // destroyed so launching again only touches the mappings that changed, and
+  // are listed in a manifest next to the instance so the links of a session
+  // that crashed are found again.
+  std::map<std::string, std::string> m_externalSymlinks;
+  std::string m_externalManifest;
   // File-level mappings targeting the data directory (e.g. plugins.txt).
   // Injected into the VFS tree after building.  (relPath, absRealPath)
   std::vector<std::pair<std::string, std::string>> m_extraVfsFiles;
 
   std::shared_ptr<Mo2FsContext> m_context;
 
+  // trace of the next updateMapping(), and the thread reading ahead the
+  // previous one on the native mount
+  std::string m_accessTrace;
+  std::thread m_accessReplay;
+
   struct fuse_session* m_session = nullptr;
   std::thread m_fuseThread;
   bool m_mounted = false;
+  QFuture<void> m_stagingFlush;
 
   QProcess* m_helperProcess = nullptr;
+  // the mod list the helper has, rebuilds send the difference to it
+  std::vector<std::pair<std::string, std::string>> m_helperMods;
+  // shared with the helper, null if it answers on stdout instead
+  HelperStatus* m_helperStatus = nullptr;
+  int m_helperStatusFd         = -1;
+  int m_helperEventFd          = -1;
+
+  // sends `type` and waits until the helper is done with it
+  //
+  bool sendToHelper(HelperMessage type, int timeoutMs, std::string_view payload = {});
+
+  // waits until the helper completed `count` messages, false if it failed the
+  // last one, exited or timed out
+  //
+  bool waitForHelper(uint64_t count, int timeoutMs);
+
+  void closeHelperStatus();
   bool mountViaHelper(const QString& overwrite_dir, const QString& game_dir,
                       const QString& data_dir_name,
                       const std::vector<std::pair<std::string, std::string>>& mods);
-  void writeVfsConfig(const QString& configPath, const QString& mount_point,
-                      const QString& overwrite_dir, const QString& game_dir,
-                      const QString& data_dir_name,
-                      const std::vector<std::pair<std::string, std::string>>& mods);
 };
 
 #endif
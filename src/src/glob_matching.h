@@ -8,6 +8,7 @@
 
 #include <QString>
 #include <cctype>
+#include <cstddef>
 #include <string_view>
 
 namespace MOShared
@@ -68,6 +69,11 @@ namespace details
  * Advantage of this over the above methods:
  *  - It is fast. Quick testing show that this is faster than PatchMatchSpecW.
  *  - It can be used on most string types (QString, std::string, std::wstring, etc.).
+ *
+ * The shape of the pattern is looked at once on construction: plain names and
+ * patterns made of literal characters around a leading, a trailing or a single
+ * inner '*' (e.g. `*.esp`, `textures*`, `*_alt*`) are matched by comparing the
+ * literal parts directly, everything else goes through the full matcher.
  */
 template <class CharT, class Traits = std::char_traits<CharT>,
           class Allocator = std::allocator<CharT>>
@@ -89,12 +95,38 @@ public:
   };
 
 public:
-  GlobPattern(string_view_type const& s) : v{s} {}
+  GlobPattern(string_view_type const& s) : v{s} { compile(); }
 
   const string_type& native() const { return v; }
 
   constexpr bool match(string_view_type const& str, bool case_sensitive = false)
   {
+    const auto size = static_cast<std::ptrdiff_t>(str.size());
+
+    switch (m_shape) {
+    case Shape::Any:
+      return true;
+
+    case Shape::Exact:
+      return size == m_prefix && equals(str, 0, 0, m_prefix, case_sensitive);
+
+    case Shape::Affixes:
+      return size >= m_prefix + m_suffix &&
+             equals(str, 0, 0, m_prefix, case_sensitive) &&
+             equals(str, size - m_suffix, m_prefix + 1, m_suffix, case_sensitive);
+
+    case Shape::Contains:
+      for (std::ptrdiff_t i = 0; i + m_prefix <= size; ++i) {
+        if (equals(str, i, 1, m_prefix, case_sensitive)) {
+          return true;
+        }
+      }
+      return false;
+
+    case Shape::Generic:
+      break;
+    }
+
     // Empty pattern can only match with empty sting
     if (traits::empty(v))
       return traits::empty(str);
@@ -168,7 +200,84 @@ public:
   }
 
 private:
+  enum class Shape
+  {
+    // goes through the full matcher
+    Generic,
+
+    // '*', matches everything
+    Any,
+
+    // no wildcards, m_prefix is the size of the pattern
+    Exact,
+
+    // m_prefix literal characters, a '*', then m_suffix literal characters;
+    // either can be empty
+    Affixes,
+
+    // '*', m_prefix literal characters, then '*'
+    Contains
+  };
+
+  void compile()
+  {
+    const auto size = static_cast<std::ptrdiff_t>(v.size());
+    std::ptrdiff_t stars = 0, firstStar = -1, lastStar = -1;
+
+    for (std::ptrdiff_t i = 0; i < size; ++i) {
+      const CharT c = v[i];
+      if (c == card::any || c == card::set_begin || c == card::set_end) {
+        return;
+      }
+      if (c == card::any_repeat) {
+        ++stars;
+        lastStar = i;
+        if (firstStar < 0) {
+          firstStar = i;
+        }
+      }
+    }
+
+    if (size == 0) {
+      // left to the full matcher, which only matches empty strings
+    } else if (stars == 0) {
+      m_shape  = Shape::Exact;
+      m_prefix = size;
+    } else if (stars == size) {
+      m_shape = Shape::Any;
+    } else if (stars == 1) {
+      m_shape  = Shape::Affixes;
+      m_prefix = firstStar;
+      m_suffix = size - firstStar - 1;
+    } else if (stars == 2 && firstStar == 0 && lastStar == size - 1) {
+      m_shape  = Shape::Contains;
+      m_prefix = size - 2;
+    }
+  }
+
+  // whether the `count` characters of `str` at `strPos` are the ones of the
+  // pattern at `patPos`
+  //
+  constexpr bool equals(string_view_type const& str, std::ptrdiff_t strPos,
+                        std::ptrdiff_t patPos, std::ptrdiff_t count,
+                        bool case_sensitive) const
+  {
+    for (std::ptrdiff_t i = 0; i < count; ++i) {
+      const CharT a = str[strPos + i];
+      const CharT b = v[patPos + i];
+
+      if (case_sensitive ? a != b : traits::tolower(a) != traits::tolower(b)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
   string_type v;
+  Shape m_shape           = Shape::Generic;
+  std::ptrdiff_t m_prefix = 0;
+  std::ptrdiff_t m_suffix = 0;
 };
 
 template <class CharT, class Traits, class Allocator>
@@ -44,15 +44,48 @@ IconDelegate::IconDelegate(QTreeView* view, int column, int compactSize)
 void IconDelegate::paintIcons(QPainter* painter, const QStyleOptionViewItem& option,
                               const QModelIndex& index, const QList<QString>& icons)
 {
-  int x = 4;
-  painter->save();
+  if (icons.isEmpty() || option.rect.height() <= 0) {
+    return;
+  }
 
-  int iconWidth = icons.size() > 0 ? ((option.rect.width() / icons.size()) - 4) : 16;
+  int iconWidth = ((option.rect.width() / icons.size()) - 4);
   iconWidth     = std::min(16, iconWidth);
+  if (iconWidth <= 0) {
+    return;
+  }
+
+  const qreal ratio = painter->device() ? painter->device()->devicePixelRatioF() : 1.0;
 
-  const int margin = (option.rect.height() - iconWidth) / 2;
+  // rows with the same icons share the strip, so painting a cell is a single
+  // blit; empty ids are gaps and are part of the key
+  const QString stripId = QString("strip_%1_%2_%3_%4")
+                              .arg(iconWidth)
+                              .arg(option.rect.height())
+                              .arg(ratio)
+                              .arg(icons.join('|'));
 
-  painter->translate(option.rect.topLeft());
+  QPixmap strip;
+  if (!QPixmapCache::find(stripId, &strip)) {
+    strip = createIconStrip(icons, iconWidth, option.rect.height(), ratio);
+    QPixmapCache::insert(stripId, strip);
+  }
+
+  painter->drawPixmap(option.rect.topLeft(), strip);
+}
+
+QPixmap IconDelegate::createIconStrip(const QList<QString>& icons, int iconWidth,
+                                      int height, qreal ratio)
+{
+  const int width  = 4 + static_cast<int>(icons.size()) * (iconWidth + 4);
+  const int margin = (height - iconWidth) / 2;
+
+  QPixmap strip(QSize(width, height) * ratio);
+  strip.setDevicePixelRatio(ratio);
+  strip.fill(Qt::transparent);
+
+  QPainter painter(&strip);
+
+  int x = 4;
   for (const QString& iconId : icons) {
     if (iconId.isEmpty()) {
       x += iconWidth + 4;
@@ -67,11 +100,11 @@ void IconDelegate::paintIcons(QPainter* painter, const QStyleOptionViewItem& opt
       }
       QPixmapCache::insert(fullIconId, icon);
     }
-    painter->drawPixmap(x, margin, iconWidth, iconWidth, icon);
+    painter.drawPixmap(x, margin, iconWidth, iconWidth, icon);
     x += iconWidth + 4;
   }
 
-  painter->restore();
+  return strip;
 }
 
 void IconDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option,
@@ -39,6 +39,9 @@ protected:
   //
   bool compact() const { return m_compact; }
 
+  // paints the icons from the top left of the cell, the strip of icons is
+  // composed once for every set of icons and size, and cached
+  //
   static void paintIcons(QPainter* painter, const QStyleOptionViewItem& option,
                          const QModelIndex& index, const QList<QString>& icons);
 
@@ -46,6 +49,9 @@ protected:
   virtual size_t getNumIcons(const QModelIndex& index) const      = 0;
 
 private:
+  static QPixmap createIconStrip(const QList<QString>& icons, int iconWidth,
+                                 int height, qreal ratio);
+
   int m_column;
   int m_compactSize;
   bool m_compact;
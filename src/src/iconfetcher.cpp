@@ -1,6 +1,22 @@
 #include "iconfetcher.h"
 #include "shared/util.h"
 #include "thread_utils.h"
+#include <uibase/log.h>
+
+#include <QDataStream>
+#include <QDir>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+using namespace MOBase;
+
+namespace
+{
+
+constexpr quint32 CacheMagic   = 0x4d4f3249;  // "MO2I"
+constexpr quint32 CacheVersion = 1;
+
+}  // namespace
 
 void IconFetcher::Waiter::wait()
 {
@@ -22,9 +38,14 @@ void IconFetcher::Waiter::wakeUp()
 }
 
 #ifdef _WIN32
-IconFetcher::IconFetcher() : m_iconSize(GetSystemMetrics(SM_CXSMICON)), m_stop(false)
+IconFetcher::IconFetcher(std::function<void()> ready)
+    : m_iconSize(GetSystemMetrics(SM_CXSMICON)),
+      m_cacheKey(QString::number(m_iconSize)), m_ready(std::move(ready)), m_stop(false)
 #else
-IconFetcher::IconFetcher() : m_iconSize(16), m_stop(false)
+IconFetcher::IconFetcher(std::function<void()> ready)
+    : m_iconSize(16),
+      m_cacheKey(QIcon::themeName() + "/" + QString::number(m_iconSize)),
+      m_ready(std::move(ready)), m_stop(false)
 #endif
 {
   m_quickCache.file      = getPixmapIcon(QFileIconProvider::File);
@@ -39,6 +60,8 @@ IconFetcher::~IconFetcher()
 {
   stop();
   m_thread.join();
+
+  saveExtensionCache();
 }
 
 void IconFetcher::stop()
@@ -54,12 +77,12 @@ QVariant IconFetcher::icon(const QString& path) const
   } else {
     const auto dot = path.lastIndexOf(".");
 
-    if (dot == -1) {
+    if (dot == -1 || path.indexOf('/', dot) != -1 || path.indexOf('\\', dot) != -1) {
       // no extension
       return m_quickCache.file;
     }
 
-    return extensionIcon(QStringView{path}.mid(dot));
+    return extensionIcon(path.mid(dot).toLower());
   }
 }
 
@@ -75,6 +98,7 @@ QPixmap IconFetcher::genericDirectoryIcon() const
 
 bool IconFetcher::hasOwnIcon(const QString& path) const
 {
+#ifdef _WIN32
   static const QString exe = ".exe";
   static const QString lnk = ".lnk";
   static const QString ico = ".ico";
@@ -82,24 +106,35 @@ bool IconFetcher::hasOwnIcon(const QString& path) const
   return path.endsWith(exe, Qt::CaseInsensitive) ||
          path.endsWith(lnk, Qt::CaseInsensitive) ||
          path.endsWith(ico, Qt::CaseInsensitive);
+#else
+  // the icon provider only goes by the mime type of files elsewhere
+  (void)path;
+  return false;
+#endif
 }
 
 void IconFetcher::threadFun()
 {
   MOShared::SetThisThreadName("IconFetcher");
 
+  loadExtensionCache();
+
   while (!m_stop) {
     m_waiter.wait();
     if (m_stop) {
       break;
     }
 
-    checkCache(m_extensionCache);
-    checkCache(m_fileCache);
+    const bool extensions = checkCache(m_extensionCache);
+    const bool files      = checkCache(m_fileCache);
+
+    if ((extensions || files) && m_ready) {
+      m_ready();
+    }
   }
 }
 
-void IconFetcher::checkCache(Cache& cache)
+bool IconFetcher::checkCache(Cache& cache)
 {
   std::set<QString> queue;
 
@@ -110,7 +145,7 @@ void IconFetcher::checkCache(Cache& cache)
   }
 
   if (queue.empty()) {
-    return;
+    return false;
   }
 
   std::map<QString, QPixmap> map;
@@ -123,7 +158,10 @@ void IconFetcher::checkCache(Cache& cache)
     for (auto&& p : map) {
       cache.map.insert(std::move(p));
     }
+    cache.modified = true;
   }
+
+  return true;
 }
 
 void IconFetcher::queue(Cache& cache, QString path) const
@@ -163,3 +201,76 @@ QVariant IconFetcher::extensionIcon(const QStringView& ext) const
   queue(m_extensionCache, ext.toString());
   return {};
 }
+
+QString IconFetcher::cachePath() const
+{
+  return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+         "/extension-icons.bin";
+}
+
+void IconFetcher::loadExtensionCache()
+{
+  QFile file(cachePath());
+  if (!file.open(QIODevice::ReadOnly)) {
+    return;
+  }
+
+  QDataStream in(&file);
+  quint32 magic = 0, version = 0;
+  QString key;
+  in >> magic >> version >> key;
+  if (magic != CacheMagic || version != CacheVersion || key != m_cacheKey) {
+    // another icon theme or size, fetched again
+    return;
+  }
+
+  QMap<QString, QPixmap> icons;
+  in >> icons;
+  if (in.status() != QDataStream::Ok) {
+    log::warn("icon cache '{}' is corrupt, ignoring", file.fileName());
+    return;
+  }
+
+  {
+    std::scoped_lock lock(m_extensionCache.mapMutex);
+    for (auto&& [ext, pixmap] : icons.asKeyValueRange()) {
+      // icons fetched in the meantime are kept
+      m_extensionCache.map.emplace(ext, pixmap);
+    }
+  }
+
+  if (!icons.isEmpty() && m_ready) {
+    m_ready();
+  }
+}
+
+void IconFetcher::saveExtensionCache() const
+{
+  QMap<QString, QPixmap> icons;
+
+  {
+    std::scoped_lock lock(m_extensionCache.mapMutex);
+    if (!m_extensionCache.modified) {
+      return;
+    }
+
+    for (auto&& [ext, pixmap] : m_extensionCache.map) {
+      icons.insert(ext, pixmap);
+    }
+  }
+
+  const QString path = cachePath();
+  QDir().mkpath(QFileInfo(path).path());
+
+  QSaveFile file(path);
+  if (!file.open(QIODevice::WriteOnly)) {
+    log::warn("failed to write icon cache '{}'", path);
+    return;
+  }
+
+  QDataStream out(&file);
+  out << CacheMagic << CacheVersion << m_cacheKey << icons;
+  if (!file.commit()) {
+    log::warn("failed to write icon cache '{}'", path);
+  }
+}
@@ -2,13 +2,22 @@
 #define MODORGANIZER_ICONFETCHER_INCLUDED
 #include <QFileIconProvider>
 #include <QStringView>
+#include <functional>
 #include <mutex>
 #include <set>
 
+// fetches icons on a thread, icon() never blocks and returns an empty variant
+// until the icon is available; `ready` is called from the thread every time a
+// batch of icons was fetched
+//
+// icons are looked up by extension except for files that have their own, the
+// extension icons are saved in the cache directory and reused by later sessions
+// as long as the icon theme stays the same
+//
 class IconFetcher
 {
 public:
-  IconFetcher();
+  explicit IconFetcher(std::function<void()> ready = {});
   ~IconFetcher();
 
   void stop();
@@ -31,6 +40,9 @@ private:
 
     std::set<QString> queue;
     std::mutex queueMutex;
+
+    // whether icons were added since the cache was loaded
+    bool modified = false;
   };
 
   class Waiter
@@ -46,6 +58,8 @@ private:
   };
 
   const int m_iconSize;
+  const QString m_cacheKey;
+  std::function<void()> m_ready;
   QFileIconProvider m_provider;
   std::thread m_thread;
   std::atomic<bool> m_stop;
@@ -65,11 +79,16 @@ private:
 
   void threadFun();
 
-  void checkCache(Cache& cache);
+  // whether any icon was added
+  bool checkCache(Cache& cache);
   void queue(Cache& cache, QString path) const;
 
   QVariant fileIcon(const QString& path) const;
   QVariant extensionIcon(const QStringView& ext) const;
+
+  QString cachePath() const;
+  void loadExtensionCache();
+  void saveExtensionCache() const;
 };
 
 #endif  // MODORGANIZER_ICONFETCHER_INCLUDED
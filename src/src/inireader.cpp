@@ -0,0 +1,418 @@
+#include "inireader.h"
+
+#include <QByteArrayView>
+#include <QFile>
+#include <QSettings>
+#include <QStringList>
+
+namespace
+{
+
+bool isHexDigit(char ch)
+{
+  return (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'f') ||
+         (ch >= 'A' && ch <= 'F');
+}
+
+int hexValue(char ch)
+{
+  if (ch >= '0' && ch <= '9') {
+    return ch - '0';
+  } else if (ch >= 'a' && ch <= 'f') {
+    return ch - 'a' + 10;
+  } else {
+    return ch - 'A' + 10;
+  }
+}
+
+QByteArrayView trimmed(QByteArrayView s)
+{
+  while (!s.isEmpty() && (s.front() == ' ' || s.front() == '\t')) {
+    s = s.sliced(1);
+  }
+  while (!s.isEmpty() && (s.back() == ' ' || s.back() == '\t')) {
+    s.chop(1);
+  }
+  return s;
+}
+
+// calls `f(line, equals)` for every line of `data` that isn't blank or a
+// comment, with the position of the first '=' in the line or -1
+//
+// like QSettings, a line continues after an escaped line break or inside
+// quotes and a ';' outside of quotes starts a comment
+//
+template <class F>
+void forEachIniLine(QByteArrayView data, F&& f)
+{
+  const qsizetype size = data.size();
+  qsizetype i          = 0;
+
+  const auto skipComment = [&] {
+    while (i < size && data[i] != '\n' && data[i] != '\r') {
+      ++i;
+    }
+  };
+
+  while (i < size) {
+    const char first = data[i];
+    if (first == ' ' || first == '\t' || first == '\n' || first == '\r') {
+      ++i;
+      continue;
+    }
+
+    if (first == ';') {
+      skipComment();
+      continue;
+    }
+
+    const qsizetype start = i;
+    qsizetype end         = size;
+    qsizetype equals      = -1;
+    bool inQuotes         = false;
+
+    for (; i < size; ++i) {
+      const char ch = data[i];
+
+      if (ch == '=') {
+        if (equals == -1) {
+          equals = i - start;
+        }
+      } else if (ch == '\\') {
+        ++i;
+        if (i + 1 < size && ((data[i] == '\n' && data[i + 1] == '\r') ||
+                             (data[i] == '\r' && data[i + 1] == '\n'))) {
+          ++i;
+        }
+      } else if (ch == '"') {
+        inQuotes = !inQuotes;
+      } else if (!inQuotes && (ch == '\n' || ch == '\r' || ch == ';')) {
+        end = i;
+        break;
+      }
+    }
+
+    f(data.sliced(start, end - start), equals);
+
+    if (i < size && data[i] == ';') {
+      skipComment();
+    }
+  }
+}
+
+// section and key names, see QSettings' iniEscapedKey()
+//
+QString unescapeKey(QByteArrayView key)
+{
+  QString result;
+  result.reserve(key.size());
+
+  qsizetype i = 0;
+  while (i < key.size()) {
+    const char ch = key[i];
+
+    if (ch == '\\') {
+      result += u'/';
+      ++i;
+      continue;
+    }
+
+    if (ch == '%' && i + 1 < key.size()) {
+      qsizetype digits     = 2;
+      qsizetype firstDigit = i + 1;
+      if (key[i + 1] == 'U') {
+        ++firstDigit;
+        digits = 4;
+      }
+
+      bool ok        = firstDigit + digits <= key.size();
+      char16_t value = 0;
+      for (qsizetype d = firstDigit; ok && d < firstDigit + digits; ++d) {
+        ok    = isHexDigit(key[d]);
+        value = static_cast<char16_t>((value << 4) | (ok ? hexValue(key[d]) : 0));
+      }
+
+      if (ok) {
+        result += QChar(value);
+        i = firstDigit + digits;
+        continue;
+      }
+    }
+
+    qsizetype j = i + 1;
+    while (j < key.size() && key[j] != '\\' && key[j] != '%') {
+      ++j;
+    }
+    result += QString::fromUtf8(key.sliced(i, j - i));
+    i = j;
+  }
+
+  return result;
+}
+
+// a value or a list of values, see QSettings' iniUnescapedStringList()
+//
+QVariant unescapeValue(QByteArrayView value)
+{
+  QStringList list;
+  QString current;
+  bool isList          = false;
+  bool currentIsQuoted = false;
+  bool inQuotes        = false;
+
+  // trailing blanks of an unquoted value are dropped, but not escaped ones
+  qsizetype chopLimit = 0;
+  const auto chopTrailingSpaces = [&] {
+    qsizetype n = current.size();
+    while (n > chopLimit && (current[n - 1] == u' ' || current[n - 1] == u'\t')) {
+      --n;
+    }
+    current.truncate(n);
+  };
+
+  const qsizetype size = value.size();
+  qsizetype i          = 0;
+
+  const auto skipSpaces = [&] {
+    while (i < size && (value[i] == ' ' || value[i] == '\t')) {
+      ++i;
+    }
+    chopLimit = current.size();
+  };
+
+  skipSpaces();
+
+  while (i < size) {
+    const char ch = value[i];
+
+    if (ch == '\\') {
+      ++i;
+      if (i >= size) {
+        break;
+      }
+
+      const char escaped = value[i++];
+      switch (escaped) {
+      case 'a':
+        current += u'\a';
+        break;
+      case 'b':
+        current += u'\b';
+        break;
+      case 'f':
+        current += u'\f';
+        break;
+      case 'n':
+        current += u'\n';
+        break;
+      case 'r':
+        current += u'\r';
+        break;
+      case 't':
+        current += u'\t';
+        break;
+      case 'v':
+        current += u'\v';
+        break;
+      case '"':
+      case '?':
+      case '\'':
+      case '\\':
+        current += QChar(escaped);
+        break;
+      case 'x':
+      case '0':
+      case '1':
+      case '2':
+      case '3':
+      case '4':
+      case '5':
+      case '6':
+      case '7': {
+        const bool hex = (escaped == 'x');
+        if (hex && (i >= size || !isHexDigit(value[i]))) {
+          break;
+        }
+
+        char32_t code = hex ? 0 : static_cast<char32_t>(escaped - '0');
+        while (i < size) {
+          if (hex && isHexDigit(value[i])) {
+            code = (code << 4) + hexValue(value[i]);
+          } else if (!hex && value[i] >= '0' && value[i] <= '7') {
+            code = (code << 3) + (value[i] - '0');
+          } else {
+            break;
+          }
+          ++i;
+        }
+
+        // surrogates are written one by one, they only make a valid character
+        // together
+        if (code <= 0xffff) {
+          current += QChar(static_cast<char16_t>(code));
+        } else {
+          current += QString::fromUcs4(&code, 1);
+        }
+        break;
+      }
+      case '\n':
+      case '\r':
+        // escaped line break, the line continues
+        if (i < size && (value[i] == '\n' || value[i] == '\r') && value[i] != escaped) {
+          ++i;
+        }
+        break;
+      default:
+        // unknown escapes are dropped
+        break;
+      }
+
+      chopLimit = current.size();
+    } else if (ch == '"') {
+      ++i;
+      currentIsQuoted = true;
+      inQuotes        = !inQuotes;
+      if (!inQuotes) {
+        skipSpaces();
+      }
+    } else if (ch == ',' && !inQuotes) {
+      if (!currentIsQuoted) {
+        chopTrailingSpaces();
+      }
+
+      isList = true;
+      list.append(current);
+      current.clear();
+      currentIsQuoted = false;
+
+      ++i;
+      skipSpaces();
+    } else {
+      qsizetype j = i + 1;
+      while (j < size && value[j] != '\\' && value[j] != '"' && value[j] != ',') {
+        ++j;
+      }
+      current += QString::fromUtf8(value.sliced(i, j - i));
+      i = j;
+    }
+  }
+
+  if (!currentIsQuoted) {
+    chopTrailingSpaces();
+  }
+
+  if (isList) {
+    list.append(current);
+    return list;
+  }
+
+  return current;
+}
+
+// "@@" escapes a leading '@', anything else starting with '@' is a typed value
+// that needs QSettings
+//
+bool unescapeTyped(QString& s)
+{
+  if (!s.startsWith(u'@')) {
+    return true;
+  }
+
+  if (s.size() >= 2 && s[1] == u'@') {
+    s.remove(0, 1);
+    return true;
+  }
+
+  return false;
+}
+
+}  // namespace
+
+bool readIniFile(const QString& path, QVariantMap& values)
+{
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    // QSettings doesn't complain either, everything has its default value
+    return true;
+  }
+
+  const QByteArray bytes = file.readAll();
+  QByteArrayView data(bytes);
+  if (data.startsWith("\xef\xbb\xbf")) {
+    data = data.sliced(3);
+  }
+
+  bool ok = true;
+  QString section;
+
+  forEachIniLine(data, [&](QByteArrayView line, qsizetype equals) {
+    if (!ok) {
+      return;
+    }
+
+    if (line.front() == '[') {
+      const qsizetype close = line.indexOf(']');
+      if (close == -1) {
+        ok = false;
+        return;
+      }
+
+      section = unescapeKey(line.sliced(1, close - 1));
+      if (section.compare("general", Qt::CaseInsensitive) == 0) {
+        section.clear();
+      } else {
+        if (section == "%General") {
+          section = "General";
+        }
+        section += u'/';
+      }
+
+      return;
+    }
+
+    if (equals <= 0) {
+      // QSettings ignores lines without a key as well
+      return;
+    }
+
+    const QString key = unescapeKey(trimmed(line.first(equals)));
+    if (key.isEmpty()) {
+      return;
+    }
+
+    QVariant value = unescapeValue(line.sliced(equals + 1));
+
+    if (value.typeId() == QMetaType::QStringList) {
+      QStringList list = value.toStringList();
+      for (auto& item : list) {
+        ok = ok && unescapeTyped(item);
+      }
+      value = list;
+    } else {
+      QString s = value.toString();
+      ok        = unescapeTyped(s);
+      value     = s;
+    }
+
+    values[section + key] = value;
+  });
+
+  return ok;
+}
+
+QVariantMap readIniValues(const QString& path)
+{
+  QVariantMap values;
+  if (readIniFile(path, values)) {
+    return values;
+  }
+
+  values.clear();
+
+  QSettings settings(path, QSettings::IniFormat);
+  for (const auto& key : settings.allKeys()) {
+    values[key] = settings.value(key);
+  }
+
+  return values;
+}
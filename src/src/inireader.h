@@ -0,0 +1,26 @@
+#ifndef INIREADER_H
+#define INIREADER_H
+
+#include <QString>
+#include <QVariantMap>
+
+// reads an ini file written with QSettings::IniFormat without going through
+// QSettings, which has a lot of overhead for every file it opens and goes
+// through a process-wide cache, so the files of many mods can be read at once
+// from worker threads
+//
+// keys are named like QSettings::allKeys() does, "group/key", with the keys of
+// the [General] section at the top; a list of values is a QStringList;
+// missing files give no values, like QSettings
+//
+// returns false if `values` would differ from what QSettings reads, which is
+// the case for typed values (@Variant, @Rect, etc.) and malformed sections
+//
+bool readIniFile(const QString& path, QVariantMap& values);
+
+// values of the ini file at `path`, read with readIniFile() or QSettings if
+// the file uses something readIniFile() doesn't handle
+//
+QVariantMap readIniValues(const QString& path);
+
+#endif  // INIREADER_H
@@ -22,10 +22,12 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "installationmanager.h"
 
 #include "categories.h"
+#include "dircopy.h"
 #include "filesystemutilities.h"
 #include "iplugininstallercustom.h"
 #include "iplugininstallersimple.h"
 #include "messagedialog.h"
+#include "moddedup.h"
 #include "modinfo.h"
 #include "nexusinterface.h"
 #include "queryoverwritedialog.h"
@@ -48,6 +50,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QPushButton>
 #include <QSettings>
 #include <QTextDocument>
+#include <QThreadPool>
 #include <QtConcurrent/QtConcurrentRun>
 
 #ifdef _WIN32
@@ -76,6 +79,19 @@ QString storeMetaPath(const QString& value)
 
   return QDir::fromNativeSeparators(value);
 }
+
+// installed mods are deduplicated one after another, a second dedupeMod()
+// while one runs would do nothing; left to the process' end, an interrupted
+// link is only a temporary file that's skipped
+QThreadPool& dedupPool()
+{
+  static QThreadPool* pool = [] {
+    auto* p = new QThreadPool;
+    p->setMaxThreadCount(1);
+    return p;
+  }();
+  return *pool;
+}
 }  // namespace
 
 InstallationResult::InstallationResult(IPluginInstaller::EInstallResult result)
@@ -157,6 +173,8 @@ bool InstallationManager::extractFiles(QString extractPath, QString title,
     errorMessage = QString::fromStdWString(message);
   };
 
+  m_ArchiveHandler->setExtractThreadCount(Settings::instance().extractThreadCount());
+
   // The future that will hold the result:
   QFuture<bool> future;
 
@@ -294,6 +312,16 @@ QStringList InstallationManager::extractFiles(
   // Update the archive:
   ArchiveFileTree::mapToArchive(*m_ArchiveHandler, files);
 
+  // Remember where the entries end up, the extraction clears the output paths:
+  const auto& fileList = m_ArchiveHandler->getFileList();
+  for (std::size_t i = 0; i < fileList.size(); ++i) {
+    const auto& paths = fileList[i]->getOutputFilePaths();
+    if (!paths.empty()) {
+      m_ExtractedFiles[i] =
+          QDir::tempPath().append("/").append(QString::fromStdWString(paths.front()));
+    }
+  }
+
   // Retrieve the file path:
   QStringList result;
 
@@ -310,6 +338,51 @@ QStringList InstallationManager::extractFiles(
   return result;
 }
 
+void InstallationManager::moveExtractedFiles(QString extractPath)
+{
+  const auto& fileList = m_ArchiveHandler->getFileList();
+  for (auto& [index, tempPath] : m_ExtractedFiles) {
+    FileData* fileData = fileList[index];
+    const auto paths   = fileData->getOutputFilePaths();
+    if (paths.empty()) {
+      continue;
+    }
+
+    // The installer could have changed the file:
+    QFileInfo tempInfo(tempPath);
+    if (!tempInfo.isFile() ||
+        static_cast<uint64_t>(tempInfo.size()) != fileData->getSize()) {
+      continue;
+    }
+
+    std::vector<QString> destPaths;
+    for (auto& path : paths) {
+      destPaths.push_back(QDir::cleanPath(extractPath + QDir::separator() +
+                                          QString::fromStdWString(path)));
+    }
+
+    bool moved = true;
+    for (std::size_t i = 0; i < destPaths.size() && moved; ++i) {
+      if (QFile::exists(destPaths[i])) {
+        QFile::remove(destPaths[i]);
+      }
+      QFileInfo(destPaths[i]).absoluteDir().mkpath(".");
+
+      // Copy to all but the last path so the temporary file can be moved there:
+      if (i + 1 < destPaths.size()) {
+        moved = QFile::copy(tempPath, destPaths[i]);
+      } else {
+        moved = QFile::rename(tempPath, destPaths[i]);
+      }
+    }
+
+    if (moved) {
+      log::debug("Moved {} to {}.", tempPath, destPaths.back());
+      fileData->clearOutputFilePaths();
+    }
+  }
+}
+
 QString
 InstallationManager::createFile(std::shared_ptr<const MOBase::FileTreeEntry> entry)
 {
@@ -412,7 +485,7 @@ InstallationResult InstallationManager::testOverwrite(GuessedValue<QString>& mod
 
       if (overwriteDialog.backup()) {
         QString backupDirectory = generateBackupName(targetDirectory);
-        if (!copyDir(targetDirectory, backupDirectory, false)) {
+        if (!copyDirectory(targetDirectory, backupDirectory, false)) {
           reportError(tr("Failed to create backup"));
           return {IPluginInstaller::RESULT_FAILED};
         }
@@ -526,6 +599,10 @@ InstallationResult InstallationManager::doInstall(GuessedValue<QString>& modName
   QString targetDirectoryNative = QDir::toNativeSeparators(targetDirectory);
 
   log::debug("installing to \"{}\"", targetDirectoryNative);
+
+  // Skip extracting the files the installer already had extracted:
+  moveExtractedFiles(targetDirectory);
+
   if (!extractFiles(targetDirectory, "", true, false)) {
     return {IPluginInstaller::RESULT_CANCELED};
   }
@@ -546,7 +623,10 @@ InstallationResult InstallationManager::doInstall(GuessedValue<QString>& modName
       dir.mkpath(".");
     }
 
-    QFile::copy(p.second, destPath);
+    // The created files are temporary, move them instead of copying:
+    if (!QFile::rename(p.second, destPath)) {
+      QFile::copy(p.second, destPath);
+    }
   }
 
   QSettings settingsFile(targetDirectory + "/meta.ini", QSettings::IniFormat);
@@ -585,6 +665,16 @@ InstallationResult InstallationManager::doInstall(GuessedValue<QString>& modName
     settingsFile.endGroup();
   }
 
+  if (dedupOnInstallEnabled()) {
+    // hashing the mod can take a while, the files are only replaced by links
+    // to identical ones so the mod can be used meanwhile
+    dedupPool().start([dedup     = sharedModDedup(m_ModsDirectory),
+                       directory = targetDirectory,
+                       hardlinks = dedupHardlinksEnabled()] {
+      dedup->dedupeMod(directory, hardlinks);
+    });
+  }
+
   return result;
 }
 
@@ -602,6 +692,7 @@ void InstallationManager::postInstallCleanup()
 {
   // Clear the list of created files:
   m_CreatedFiles.clear();
+  m_ExtractedFiles.clear();
 
   // Close the archive:
   m_ArchiveHandler->close();
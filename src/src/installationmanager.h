@@ -332,6 +332,17 @@ private:
   bool extractFiles(QString extractPath, QString title, bool showFilenames,
                     bool silent);
 
+  /**
+   * @brief Move the entries that were already extracted to the temporary folder for
+   *     the installer into their place in the given path, and remove them from the
+   *     files that still have to be extracted.
+   *
+   * Entries that can't be moved are left alone and are extracted again.
+   *
+   * @param extractPath Path (on the disk) were the extracted files should be put.
+   */
+  void moveExtractedFiles(QString extractPath);
+
 private:
   // The plugin container, mostly to check if installer are enabled or not.
   const PluginContainer* m_PluginContainer;
@@ -352,6 +363,10 @@ private:
   // paths to temporary files.
   std::map<std::shared_ptr<const MOBase::FileTreeEntry>, QString> m_CreatedFiles;
   std::set<QString> m_TempFilesToDelete;
+
+  // Map from indices in the archive to the temporary files they were extracted to
+  // for the installer.
+  std::map<std::size_t, QString> m_ExtractedFiles;
 };
 
 #endif  // INSTALLATIONMANAGER_H
@@ -22,6 +22,8 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "env.h"
 #include "fluorinepaths.h"
 #include "organizercore.h"
+#include <algorithm>
+#include <memoryusage.h>
 #include <cstdlib>
 
 using namespace MOBase;
@@ -33,7 +35,13 @@ static std::unique_ptr<env::Console> m_console;
 static bool m_stdout = false;
 static std::mutex m_stdoutMutex;
 
-LogModel::LogModel() {}
+static std::size_t entryBytes(const log::Entry& e)
+{
+  return memory::heapBytes(e.message) + memory::heapBytes(e.formattedMessage);
+}
+
+LogModel::LogModel() : m_rows(MaxLines), m_first(0), m_count(0), m_entryBytes(0)
+{}
 
 void LogModel::create()
 {
@@ -47,55 +55,117 @@ LogModel& LogModel::instance()
 
 void LogModel::add(MOBase::log::Entry e)
 {
-  QMetaObject::invokeMethod(
-      this,
-      [this, e] {
-        onEntryAdded(std::move(e));
-      },
-      Qt::QueuedConnection);
+  bool first = false;
+
+  {
+    std::scoped_lock lock(m_pendingMutex);
+
+    first = m_pending.empty();
+    m_pending.emplace_back(std::move(e));
+
+    // older ones would be pushed out of the model by the same flush
+    if (m_pending.size() > MaxLines) {
+      m_pending.pop_front();
+    }
+  }
+
+  // one flush for everything logged until the gui thread gets to it, instead of
+  // inserting rows one by one
+  if (first) {
+    QMetaObject::invokeMethod(
+        this,
+        [this] {
+          flush();
+        },
+        Qt::QueuedConnection);
+  }
 }
 
-QString LogModel::formattedMessage(const QModelIndex& index) const
+void LogModel::flush()
 {
-  if (!index.isValid()) {
-    return "";
+  std::deque<MOBase::log::Entry> pending;
+
+  {
+    std::scoped_lock lock(m_pendingMutex);
+    pending.swap(m_pending);
+  }
+
+  if (pending.empty()) {
+    return;
+  }
+
+  // make room by dropping the oldest rows, there are at most MaxLines pending
+  const std::size_t total = m_count + pending.size();
+  if (total > MaxLines) {
+    const std::size_t overflow = total - MaxLines;
+
+    beginRemoveRows(QModelIndex(), 0, static_cast<int>(overflow) - 1);
+    m_first = (m_first + overflow) % MaxLines;
+    m_count -= overflow;
+    endRemoveRows();
+  }
+
+  beginInsertRows(QModelIndex(), static_cast<int>(m_count),
+                  static_cast<int>(m_count + pending.size()) - 1);
+
+  for (auto& e : pending) {
+    Row& r = m_rows[(m_first + m_count) % MaxLines];
+
+    m_entryBytes -= entryBytes(r.entry);
+    r = Row{std::move(e)};
+    m_entryBytes += entryBytes(r.entry);
+
+    ++m_count;
   }
-  return QString::fromStdString(m_entries[index.row()].formattedMessage);
+
+  endInsertRows();
+
+  reportMemoryUsage();
 }
 
-void LogModel::clear()
+void LogModel::reportMemoryUsage() const
 {
-  beginResetModel();
-  m_entries.clear();
-  endResetModel();
+  // the display strings are left out, they only exist for rows that were shown
+  static memory::Counter counter("log");
+  counter.set(sizeof(Row) * MaxLines + m_entryBytes, m_count);
 }
 
-const std::deque<MOBase::log::Entry>& LogModel::entries() const
+const LogModel::Row& LogModel::row(std::size_t i) const
 {
-  return m_entries;
+  return m_rows[(m_first + i) % MaxLines];
 }
 
-void LogModel::onEntryAdded(MOBase::log::Entry e)
+QString LogModel::formattedMessage(const QModelIndex& index) const
 {
-  bool full = false;
-  if (m_entries.size() > MaxLines) {
-    m_entries.pop_front();
-    full = true;
+  if (!index.isValid() || static_cast<std::size_t>(index.row()) >= m_count) {
+    return "";
   }
+  const auto& e = row(static_cast<std::size_t>(index.row())).entry;
+  return QString::fromStdString(e.formattedMessage);
+}
 
-  const int row = static_cast<int>(m_entries.size());
+void LogModel::clear()
+{
+  beginResetModel();
+  std::fill(m_rows.begin(), m_rows.end(), Row{});
+  m_first      = 0;
+  m_count      = 0;
+  m_entryBytes = 0;
+  endResetModel();
 
-  if (!full) {
-    beginInsertRows(QModelIndex(), row, row + 1);
-  }
+  reportMemoryUsage();
+}
 
-  m_entries.emplace_back(std::move(e));
+std::vector<MOBase::log::Entry> LogModel::entries() const
+{
+  std::vector<MOBase::log::Entry> v;
+  v.reserve(m_count);
 
-  if (!full) {
-    endInsertRows();
-  } else {
-    emit dataChanged(createIndex(row, 0), createIndex(row + 1, columnCount({})));
+  for (std::size_t i = 0; i < m_count; ++i) {
+    v.push_back(row(i).entry);
   }
+
+  return v;
 }
 
 QModelIndex LogModel::index(int row, int column, const QModelIndex&) const
@@ -113,7 +183,7 @@ int LogModel::rowCount(const QModelIndex& parent) const
   if (parent.isValid())
     return 0;
   else
-    return static_cast<int>(m_entries.size());
+    return static_cast<int>(m_count);
 }
 
 int LogModel::columnCount(const QModelIndex&) const
@@ -125,41 +195,53 @@ QVariant LogModel::data(const QModelIndex& index, int role) const
 {
   using namespace std::chrono;
 
-  const auto row = static_cast<std::size_t>(index.row());
-  if (row >= m_entries.size()) {
+  const auto i = static_cast<std::size_t>(index.row());
+  if (i >= m_count) {
     return {};
   }
 
-  const auto& e = m_entries[row];
+  const auto& r = row(i);
+  const auto& e = r.entry;
 
   if (role == Qt::DisplayRole) {
     if (index.column() == 0) {
-      const auto ms = duration_cast<milliseconds>(e.time.time_since_epoch());
-      const auto s  = duration_cast<seconds>(ms);
+      if (r.time.isEmpty()) {
+        const auto ms = duration_cast<milliseconds>(e.time.time_since_epoch());
+        const auto s  = duration_cast<seconds>(ms);
 
-      const std::time_t tt = s.count();
-      const int frac       = static_cast<int>(ms.count() % 1000);
+        const std::time_t tt = s.count();
+        const int frac       = static_cast<int>(ms.count() % 1000);
 
-      const auto time = QDateTime::fromSecsSinceEpoch(tt).time().addMSecs(frac);
-      return time.toString("hh:mm:ss.zzz");
+        const auto time = QDateTime::fromSecsSinceEpoch(tt).time().addMSecs(frac);
+        r.time          = time.toString("hh:mm:ss.zzz");
+      }
+      return r.time;
     } else if (index.column() == 2) {
-      return QString::fromStdString(e.message);
+      if (r.message.isNull()) {
+        r.message = QString::fromStdString(e.message);
+      }
+      return r.message;
     }
   }
 
   if (role == Qt::DecorationRole) {
     if (index.column() == 1) {
+      static const QIcon warning(":/MO/gui/warning");
+      static const QIcon problem(":/MO/gui/problem");
+      static const QIcon debug(":/MO/gui/debug");
+      static const QIcon information(":/MO/gui/information");
+
       switch (e.level) {
       case log::Warning:
-        return QIcon(":/MO/gui/warning");
+        return warning;
 
       case log::Error:
-        return QIcon(":/MO/gui/problem");
+        return problem;
 
       case log::Debug:
-        return QIcon(":/MO/gui/debug");
+        return debug;
       case log::Info:
-        return QIcon(":/MO/gui/information");
+        return information;
       default:
         return {};
       }
@@ -342,6 +424,11 @@ void qtLogCallback(QtMsgType type, const QMessageLogContext& context,
     log::log(convertQtLevel(type), "[{}:{}] {}", file, context.line,
              message.toStdString());
   }
+
+  if (type == QtFatalMsg) {
+    // Qt aborts right after this returns
+    log::getDefault().flush();
+  }
 }
 
 void logToStdout(bool b)
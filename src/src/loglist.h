@@ -25,6 +25,8 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QTreeView>
 #include <deque>
 #include <log.h>
+#include <mutex>
+#include <vector>
 
 class OrganizerCore;
 
@@ -36,10 +38,13 @@ public:
   static void create();
   static LogModel& instance();
 
+  // can be called from any thread, the entries are added to the model in batches
+  // on the gui thread
   void add(MOBase::log::Entry e);
   void clear();
 
-  const std::deque<MOBase::log::Entry>& entries() const;
+  // copy of the entries in the model, oldest first
+  std::vector<MOBase::log::Entry> entries() const;
 
   QString formattedMessage(const QModelIndex& index) const;
 
@@ -54,10 +59,31 @@ protected:
                       int role = Qt::DisplayRole) const override;
 
 private:
-  std::deque<MOBase::log::Entry> m_entries;
+  struct Row
+  {
+    MOBase::log::Entry entry;
+
+    // display strings, formatted the first time the row is shown
+    mutable QString time;
+    mutable QString message;
+  };
+
+  // ring buffer of the last MaxLines entries, m_count rows starting at m_first
+  std::vector<Row> m_rows;
+  std::size_t m_first;
+  std::size_t m_count;
+
+  // heap used by the messages of the rows, for the memory report
+  std::size_t m_entryBytes;
+
+  // entries waiting for the next flush(), at most MaxLines of them
+  std::mutex m_pendingMutex;
+  std::deque<MOBase::log::Entry> m_pending;
 
   LogModel();
-  void onEntryAdded(MOBase::log::Entry e);
+  const Row& row(std::size_t i) const;
+  void flush();
+  void reportMemoryUsage() const;
 };
 
 class LogList : public QTreeView
@@ -441,6 +441,30 @@ bool Loot::start(QWidget* parent, bool didUpdateMasterList)
 
   log::debug("starting loot");
 
+#ifdef MO2_INPROCESS_LOOT
+  Q_UNUSED(parent);
+
+  // vfs, libloot reads the data directory like lootcli would
+  m_core.prepareVFS();
+
+  lootcli::Parameters parameters;
+  parameters.game     = m_core.managedGame()->lootGameName().toStdString();
+  parameters.gamePath =
+      m_core.managedGame()->gameDirectory().absolutePath().toStdString();
+  parameters.pluginListPath =
+      QString("%1/loadorder.txt").arg(m_core.profilePath()).toStdString();
+  parameters.logLevel         = m_core.settings().diagnostics().lootLogLevel();
+  parameters.language         = m_core.settings().interface().language().toStdString();
+  parameters.updateMasterlist = !didUpdateMasterList;
+
+  log::debug("starting in-process loot thread");
+  m_thread.reset(QThread::create([this, parameters] {
+    inProcessThread(parameters);
+  }));
+  m_thread->start();
+
+  return true;
+#else
   m_pipe.reset(new AsyncPipe);
 
   env::HandlePtr stdoutHandle = m_pipe->create();
@@ -464,6 +488,7 @@ bool Loot::start(QWidget* parent, bool didUpdateMasterList)
   m_thread->start();
 
   return true;
+#endif
 }
 
 bool Loot::spawnLootcli(QWidget* parent, bool didUpdateMasterList,
@@ -570,6 +595,61 @@ void Loot::lootThread()
   emit finished();
 }
 
+#ifdef MO2_INPROCESS_LOOT
+void Loot::inProcessThread(const lootcli::Parameters& parameters)
+{
+  // thrown from the progress callback, which is only called by lootcli between
+  // steps, never from within libloot
+  struct Cancelled
+  {};
+
+  try {
+    m_result = false;
+
+    std::string json;
+    int exitCode = 0;
+
+    try {
+      exitCode = lootcli::runInProcess(
+          parameters,
+          [&](const lootcli::Message& m) {
+            if (m_cancel && m.type == lootcli::MessageType::Progress) {
+              throw Cancelled();
+            }
+
+            processMessage(m);
+          },
+          json);
+    } catch (Cancelled&) {
+      log::debug("in-process loot cancelled");
+    }
+
+    if (!m_cancel) {
+      if (exitCode != 0) {
+        emit log(log::Levels::Error,
+                 tr("Loot failed. Exit code was: 0x%1").arg(exitCode, 0, 16));
+      } else {
+        m_reportJson = QByteArray::fromStdString(json);
+        m_result     = true;
+
+        // only kept for the "open report" button of the dialog
+        QFile reportFile(LootReportPath);
+        if (reportFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+          reportFile.write(m_reportJson);
+        }
+      }
+    }
+
+    m_report = createReport();
+  } catch (...) {
+    log::error("unhandled exception in loot thread");
+  }
+
+  log::debug("finishing loot thread");
+  emit finished();
+}
+#endif
+
 bool Loot::waitForCompletion()
 {
 #ifdef _WIN32
@@ -719,6 +799,11 @@ void Loot::deleteReportFile()
 
 void Loot::processOutputFile(Report& r) const
 {
+  if (!m_reportJson.isEmpty()) {
+    processReportJson(m_reportJson, r);
+    return;
+  }
+
   log::debug("parsing json output file at '{}'", LootReportPath);
 
   QFile outFile(LootReportPath);
@@ -730,8 +815,13 @@ void Loot::processOutputFile(Report& r) const
     return;
   }
 
+  processReportJson(outFile.readAll(), r);
+}
+
+void Loot::processReportJson(const QByteArray& json, Report& r) const
+{
   QJsonParseError e;
-  const QJsonDocument doc = QJsonDocument::fromJson(outFile.readAll(), &e);
+  const QJsonDocument doc = QJsonDocument::fromJson(json, &e);
   if (doc.isNull()) {
     emit log(MOBase::log::Error,
              QString("invalid json, %1 (error %2)").arg(e.errorString()).arg(e.error));
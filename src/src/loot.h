@@ -5,6 +5,9 @@
 #include <QWidget>
 #include <log.h>
 #include <lootcli/lootcli.h>
+#ifdef MO2_INPROCESS_LOOT
+#include <lootcli/inprocess.h>
+#endif
 #ifdef _WIN32
 #include <windows.h>
 #endif
@@ -115,10 +118,16 @@ private:
   std::vector<QString> m_errors, m_warnings;
   Report m_report;
 
+  // the report when sorting in-process, never written to parse it back
+  QByteArray m_reportJson;
+
   bool spawnLootcli(QWidget* parent, bool didUpdateMasterList,
                     env::HandlePtr stdoutHandle);
 
   void lootThread();
+#ifdef MO2_INPROCESS_LOOT
+  void inProcessThread(const lootcli::Parameters& parameters);
+#endif
   bool waitForCompletion();
 
   void processStdout(const std::string& lootOut);
@@ -126,6 +135,7 @@ private:
 
   Report createReport() const;
   void processOutputFile(Report& r) const;
+  void processReportJson(const QByteArray& json, Report& r) const;
   void deleteReportFile();
 
   Message reportMessage(const QJsonObject& message) const;
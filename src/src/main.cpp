@@ -329,6 +329,12 @@ static void linuxCrashHandler(int sig)
   backtrace_symbols_fd(frames, count, STDERR_FILENO);
   fprintf(stderr, "=== END BACKTRACE ===\n");
 
+  // best effort as well, whatever is still queued for the log file is written
+  // unless the crash is on the logging thread
+  if (log::hasDefault()) {
+    log::getDefault().flush();
+  }
+
   // Re-raise for core dump
   raise(sig);
 }
@@ -49,6 +49,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "listdialog.h"
 #include "localsavegames.h"
 #include "messagedialog.h"
+#include "metasavequeue.h"
 #include "modlist.h"
 #include "modlistcontextmenu.h"
 #include "modlistviewactions.h"
@@ -178,6 +179,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <exception>
 #include <functional>
+#include <future>
 #include <limits.h>
 #include <map>
 #include <regex>
@@ -333,10 +335,6 @@ MainWindow::MainWindow(Settings& settings, OrganizerCore& organizerCore,
     refreshExecutablesList();
   });
 
-  connect(m_DataTab.get(), &DataTab::originModified, [&](int id) {
-    originModified(id);
-  });
-
   connect(m_DataTab.get(), &DataTab::displayModInformation,
           [&](auto&& m, auto&& i, auto&& tab) {
             displayModInformation(m, i, tab);
@@ -395,6 +393,8 @@ MainWindow::MainWindow(Settings& settings, OrganizerCore& organizerCore,
 
   connect(&m_OrganizerCore, &OrganizerCore::directoryStructureReady, this,
           &MainWindow::onDirectoryStructureChanged);
+  connect(&m_OrganizerCore, &OrganizerCore::directoryStructureChanged, this,
+          &MainWindow::onDirectoryStructureChanged);
   connect(m_OrganizerCore.directoryRefresher(),
           SIGNAL(progress(const DirectoryRefreshProgress*)), this,
           SLOT(refresherProgress(const DirectoryRefreshProgress*)));
@@ -480,6 +480,12 @@ MainWindow::MainWindow(Settings& settings, OrganizerCore& organizerCore,
   connect(this, &MainWindow::checkForProblemsDone, this,
           &MainWindow::updateProblemsButton, Qt::ConnectionType::QueuedConnection);
 
+  // responses to an update check arrive one mod at a time
+  m_UpdateResultsTimer.setSingleShot(true);
+  m_UpdateResultsTimer.setInterval(250);
+  connect(&m_UpdateResultsTimer, &QTimer::timeout, this,
+          &MainWindow::applyUpdateResults);
+
   m_SaveMetaTimer.setSingleShot(false);
   connect(&m_SaveMetaTimer, SIGNAL(timeout()), this, SLOT(saveModMetas()));
   m_SaveMetaTimer.start(5000);
@@ -1034,9 +1040,10 @@ bool MainWindow::errorReported(QString& logFile)
 
 QFuture<void> MainWindow::checkForProblemsAsync()
 {
-  return QtConcurrent::run([this]() {
+  m_ProblemsCheck = QtConcurrent::run([this]() {
     checkForProblemsImpl();
   });
+  return m_ProblemsCheck;
 }
 
 void MainWindow::checkForProblemsImpl()
@@ -1050,13 +1057,8 @@ void MainWindow::checkForProblemsImpl()
     m_ProblemsCheckRequired = false;
     TimeThis tt("MainWindow::checkForProblemsImpl()");
     size_t numProblems = 0;
-    for (QObject* pluginObj : m_PluginContainer.plugins<QObject>()) {
-      IPlugin* plugin = qobject_cast<IPlugin*>(pluginObj);
-      if (plugin == nullptr || m_PluginContainer.isEnabled(plugin)) {
-        IPluginDiagnose* diagnose = qobject_cast<IPluginDiagnose*>(pluginObj);
-        if (diagnose != nullptr)
-          numProblems += diagnose->activeProblems().size();
-      }
+    for (const auto& [diagnose, keys] : m_PluginContainer.checkProblems()) {
+      numProblems += keys.size();
     }
     m_NumberOfProblems = numProblems;
     emit checkForProblemsDone();
@@ -1496,7 +1498,8 @@ void MainWindow::cleanup()
 #endif
 
   m_SaveMetaTimer.stop();
-  m_MetaSave.waitForFinished();
+  saveModMetas();
+  MetaSaveQueue::instance().wait();
 }
 
 bool MainWindow::eventFilter(QObject* object, QEvent* event)
@@ -1524,6 +1527,9 @@ void MainWindow::registerPluginTool(IPluginTool* tool, QString name, QMenu* menu
   connect(
       action, &QAction::triggered, this,
       [this, tool]() {
+        // scripts often change many mods and refresh after each of them
+        OrganizerCore::RefreshTransaction refreshTransaction(m_OrganizerCore);
+
         try {
           tool->display();
         } catch (const std::exception& e) {
@@ -2108,14 +2114,13 @@ void MainWindow::checkBSAList()
 
 void MainWindow::saveModMetas()
 {
-  if (m_MetaSave.isFinished()) {
-    m_MetaSave = QtConcurrent::run([this]() {
-      for (unsigned int i = 0; i < ModInfo::getNumMods(); ++i) {
-        ModInfo::Ptr modInfo = ModInfo::getByIndex(i);
-        modInfo->saveMeta();
-      }
-    });
+  // most changes queue their mod already, this picks up the ones that only
+  // flag it as changed
+  for (unsigned int i = 0; i < ModInfo::getNumMods(); ++i) {
+    ModInfo::getByIndex(i)->saveMetaLater();
   }
+
+  MetaSaveQueue::instance().flush();
 }
 
 void MainWindow::fixCategories()
@@ -2293,6 +2298,8 @@ void MainWindow::on_tabWidget_currentChanged(int index)
     m_DataTab->activated();
   } else if (currentWidget == ui->savesTab) {
     m_SavesTab->refreshSaveList();
+  } else if (currentWidget == ui->downloadTab) {
+    m_DownloadsTab->activated();
   }
 }
 
@@ -2454,11 +2461,11 @@ void MainWindow::on_actionModify_Executables_triggered()
 
 void MainWindow::refresherProgress(const DirectoryRefreshProgress* p)
 {
+  // the window stays usable, it shows the previous structure until the new one
+  // is swapped in
   if (p->finished()) {
-    setEnabled(true);
     ui->statusBar->setProgress(100);
   } else {
-    setEnabled(false);
     ui->statusBar->setProgress(p->percentDone());
   }
 }
@@ -2516,6 +2523,7 @@ void MainWindow::modRenamed(const QString& oldName, const QString& newName)
   // also fix the directory structure
   try {
     if (m_OrganizerCore.directoryStructure()->originExists(ToWString(oldName))) {
+      OrganizerCore::DirectoryStructurePatch patch(m_OrganizerCore);
       FilesOrigin& origin =
           m_OrganizerCore.directoryStructure()->getOriginByName(ToWString(oldName));
       origin.setName(ToWString(newName));
@@ -2533,6 +2541,9 @@ void MainWindow::fileMoved(const QString& filePath, const QString& oldOriginName
       m_OrganizerCore.directoryStructure()->findFile(ToWString(filePath));
   if (filePtr.get() != nullptr) {
     try {
+      // released before the error is reported
+      OrganizerCore::DirectoryStructurePatch patch(m_OrganizerCore);
+
       if (m_OrganizerCore.directoryStructure()->originExists(
               ToWString(newOriginName))) {
         FilesOrigin& newOrigin = m_OrganizerCore.directoryStructure()->getOriginByName(
@@ -2607,7 +2618,7 @@ void MainWindow::setWindowEnabled(bool enabled)
 
 void MainWindow::refreshProfile_activated()
 {
-  m_OrganizerCore.refresh();
+  m_OrganizerCore.refreshFromDisk();
 }
 
 void MainWindow::saveArchiveList()
@@ -2976,6 +2987,7 @@ void MainWindow::languageChange(const QString& newLanguage)
 
 void MainWindow::originModified(int originID)
 {
+  OrganizerCore::DirectoryStructurePatch patch(m_OrganizerCore);
   FilesOrigin& origin = m_OrganizerCore.directoryStructure()->getOriginByID(originID);
   origin.enable(false);
 
@@ -3231,148 +3243,195 @@ void MainWindow::finishUpdateInfo(const NxmUpdateInfoData& data)
   }
 }
 
-void MainWindow::nxmUpdatesAvailable(QString gameName, int modID, QVariant userData,
-                                     QVariant resultData, int requestID)
+// whether a file of this status is still offered for download
+//
+static bool isActiveFileStatus(int status)
 {
-  QVariantMap resultInfo = resultData.toMap();
-  QList files            = resultInfo["files"].toList();
-  QList fileUpdates      = resultInfo["file_updates"].toList();
-  QString gameNameReal;
+  return status != NexusInterface::FileStatus::OLD_VERSION &&
+         status != NexusInterface::FileStatus::REMOVED &&
+         status != NexusInterface::FileStatus::ARCHIVED;
+}
 
-  for (IPluginGame* game : m_PluginContainer.plugins<IPluginGame>()) {
-    if (game->gameNexusName() == gameName) {
-      gameNameReal = game->gameShortName();
-      break;
-    }
+MainWindow::NxmUpdateDiff MainWindow::diffModUpdate(const QString& installedFile,
+                                                    const QVariantList& files,
+                                                    const QVariantList& fileUpdates)
+{
+  NxmUpdateDiff diff;
+
+  if (installedFile.isEmpty()) {
+    // No installedFile means we don't know what to look at for a version so
+    // just get the global mod version
+    diff.requiresInfo = true;
+    return diff;
   }
 
-  std::vector<ModInfo::Ptr> modsList = ModInfo::getByModID(gameNameReal, modID);
+  QVariantMap foundFileData;
 
-  bool requiresInfo = false;
+  // update the file status
+  for (auto& file : files) {
+    QVariantMap fileData = file.toMap();
 
-  for (auto mod : modsList) {
-    QString validNewVersion;
-    int newModStatus      = -1;
-    QString installedFile = QFileInfo(mod->installationFile()).fileName();
+    if (fileData["file_name"].toString().compare(installedFile, Qt::CaseInsensitive) ==
+        0) {
+      foundFileData   = fileData;
+      diff.fileStatus = foundFileData["category_id"].toInt();
 
-    if (!installedFile.isEmpty()) {
-      QVariantMap foundFileData;
+      if (isActiveFileStatus(diff.fileStatus)) {
+        // since the file is still active if there are no updates for it, use this
+        // as current version
+        diff.newestVersion = foundFileData["version"].toString();
+      }
+      break;
+    }
+  }
 
-      // update the file status
-      for (auto& file : files) {
-        QVariantMap fileData = file.toMap();
+  if (foundFileData.isEmpty()) {
+    // The file was not listed, the file is likely archived and archived files are
+    // being hidden on the mod
+    diff.fileStatus = NexusInterface::FileStatus::ARCHIVED_HIDDEN;
+  }
 
-        if (fileData["file_name"].toString().compare(installedFile,
-                                                     Qt::CaseInsensitive) == 0) {
-          foundFileData = fileData;
-          newModStatus  = foundFileData["category_id"].toInt();
+  // the file that replaced a file and the status and version of every file, by id
+  std::map<int, int> nextFile;
+  std::map<int, std::pair<int, QString>> fileInfos;
 
-          if (newModStatus != NexusInterface::FileStatus::OLD_VERSION &&
-              newModStatus != NexusInterface::FileStatus::REMOVED &&
-              newModStatus != NexusInterface::FileStatus::ARCHIVED) {
+  for (auto& updateEntry : fileUpdates) {
+    const QVariantMap& updateData = updateEntry.toMap();
+    nextFile.emplace(updateData["old_file_id"].toInt(),
+                     updateData["new_file_id"].toInt());
+  }
 
-            // since the file is still active if there are no updates for it, use this
-            // as current version
-            validNewVersion = foundFileData["version"].toString();
-          }
-          break;
-        }
-      }
+  for (auto& file : files) {
+    const QVariantMap& fileData = file.toMap();
+    fileInfos.emplace(fileData["file_id"].toInt(),
+                      std::make_pair(fileData["category_id"].toInt(),
+                                     fileData["version"].toString()));
+  }
 
-      if (foundFileData.isEmpty()) {
-        // The file was not listed, the file is likely archived and archived files are
-        // being hidden on the mod
-        newModStatus = NexusInterface::FileStatus::ARCHIVED_HIDDEN;
-      }
+  // look for updates of the file
+  int currentUpdateId = -1;
 
-      // look for updates of the file
-      int currentUpdateId = -1;
+  // find installed file ID from the updates list since old filenames are not
+  // guaranteed to be unique
+  for (auto& updateEntry : fileUpdates) {
+    const QVariantMap& updateData = updateEntry.toMap();
 
-      // find installed file ID from the updates list since old filenames are not
-      // guaranteed to be unique
-      for (auto& updateEntry : fileUpdates) {
-        const QVariantMap& updateData = updateEntry.toMap();
+    if (installedFile.compare(updateData["old_file_name"].toString(),
+                              Qt::CaseInsensitive) == 0) {
+      currentUpdateId = updateData["old_file_id"].toInt();
+      break;
+    }
+  }
 
-        if (installedFile.compare(updateData["old_file_name"].toString(),
-                                  Qt::CaseInsensitive) == 0) {
-          currentUpdateId = updateData["old_file_id"].toInt();
-          break;
-        }
-      }
+  bool foundActiveUpdate = false;
 
-      bool foundActiveUpdate = false;
+  // follow the update chain until there are no more updates, a chain going in
+  // circles is the end as well
+  std::set<int> seen;
+  for (auto next = nextFile.find(currentUpdateId);
+       currentUpdateId > 0 && next != nextFile.end() && seen.insert(next->first).second;
+       next = nextFile.find(currentUpdateId)) {
+    currentUpdateId = next->second;
 
-      // there is at least one update
-      if (currentUpdateId > 0) {
-        bool lookForMoreUpdates = true;
+    // check if the new file is still active
+    auto info = fileInfos.find(currentUpdateId);
+    if (info != fileInfos.end() && isActiveFileStatus(info->second.first)) {
+      // new version is active, so record it
+      diff.newestVersion = info->second.second;
+      foundActiveUpdate  = true;
+    }
+  }
 
-        // follow the update chain until there are no more updates
-        while (lookForMoreUpdates) {
-          lookForMoreUpdates = false;
+  // if there were no active direct file updates for the installedFile
+  if (!foundActiveUpdate) {
+    // get the global mod version in case the file isn't an optional
+    if (diff.fileStatus != NexusInterface::FileStatus::OPTIONAL_FILE &&
+        diff.fileStatus != NexusInterface::FileStatus::MISCELLANEOUS) {
+      diff.requiresInfo = true;
+    }
+  }
 
-          for (auto& updateEntry : fileUpdates) {
-            const QVariantMap& updateData = updateEntry.toMap();
+  return diff;
+}
 
-            if (currentUpdateId == updateData["old_file_id"].toInt()) {
-              currentUpdateId = updateData["new_file_id"].toInt();
+void MainWindow::nxmUpdatesAvailable(QString gameName, int modID, QVariant userData,
+                                     QVariant resultData, int requestID)
+{
+  QString gameNameReal;
 
-              // check if the new file is still active
-              for (auto& file : files) {
-                const QVariantMap& fileData = file.toMap();
+  for (IPluginGame* game : m_PluginContainer.plugins<IPluginGame>()) {
+    if (game->gameNexusName() == gameName) {
+      gameNameReal = game->gameShortName();
+      break;
+    }
+  }
 
-                if (currentUpdateId == fileData["file_id"].toInt()) {
-                  int updateStatus = fileData["category_id"].toInt();
+  std::vector<ModInfo::Ptr> modsList = ModInfo::getByModID(gameNameReal, modID);
 
-                  if (updateStatus != NexusInterface::FileStatus::OLD_VERSION &&
-                      updateStatus != NexusInterface::FileStatus::REMOVED &&
-                      updateStatus != NexusInterface::FileStatus::ARCHIVED) {
+  QStringList installedFiles;
+  for (const auto& mod : modsList) {
+    installedFiles.append(QFileInfo(mod->installationFile()).fileName());
+  }
 
-                    // new version is active, so record it
-                    validNewVersion   = fileData["version"].toString();
-                    foundActiveUpdate = true;
-                  }
-                  break;
-                }
-              }
+  // the lists can be long for mods with many files, they're compared on a worker
+  // and the results applied along with the ones of other mods
+  auto* watcher = new QFutureWatcher<std::vector<NxmUpdateDiff>>();
+  QObject::connect(
+      watcher, &QFutureWatcher<std::vector<NxmUpdateDiff>>::finished, this,
+      [this, watcher, gameNameReal, modID, modsList = std::move(modsList)]() {
+        const auto diffs  = watcher->result();
+        bool requiresInfo  = false;
 
-              lookForMoreUpdates = true;
-              break;
-            }
-          }
+        for (std::size_t i = 0; i < diffs.size(); ++i) {
+          m_PendingUpdates.emplace_back(modsList[i], diffs[i]);
+          requiresInfo = requiresInfo || diffs[i].requiresInfo;
         }
-      }
 
-      // if there were no active direct file updates for the installedFile
-      if (!foundActiveUpdate) {
-        // get the global mod version in case the file isn't an optional
-        if (newModStatus != NexusInterface::FileStatus::OPTIONAL_FILE &&
-            newModStatus != NexusInterface::FileStatus::MISCELLANEOUS) {
-          requiresInfo = true;
+        if (!m_UpdateResultsTimer.isActive()) {
+          m_UpdateResultsTimer.start();
         }
-      }
-    } else {
-      // No installedFile means we don't know what to look at for a version so
-      // just get the global mod version
-      requiresInfo = true;
+
+        if (requiresInfo) {
+          NexusInterface::instance().requestModInfo(gameNameReal, modID, this,
+                                                    QVariant(), QString());
+        }
+
+        watcher->deleteLater();
+      });
+
+  watcher->setFuture(QtConcurrent::run([installedFiles, resultData]() {
+    const QVariantMap resultInfo   = resultData.toMap();
+    const QVariantList files       = resultInfo["files"].toList();
+    const QVariantList fileUpdates = resultInfo["file_updates"].toList();
+
+    std::vector<NxmUpdateDiff> diffs;
+    for (const auto& installedFile : installedFiles) {
+      diffs.push_back(diffModUpdate(installedFile, files, fileUpdates));
     }
+    return diffs;
+  }));
+}
+
+void MainWindow::applyUpdateResults()
+{
+  const auto updates = std::move(m_PendingUpdates);
+  m_PendingUpdates.clear();
 
-    if (newModStatus > 0) {
-      mod->setNexusFileStatus(newModStatus);
+  const QDateTime now = QDateTime::currentDateTimeUtc();
+  for (const auto& [mod, diff] : updates) {
+    // the setters only queue the meta files, which are written in one batch
+    if (diff.fileStatus > 0) {
+      mod->setNexusFileStatus(diff.fileStatus);
     }
 
-    if (!validNewVersion.isEmpty()) {
-      mod->setNewestVersion(validNewVersion);
-      mod->setLastNexusUpdate(QDateTime::currentDateTimeUtc());
+    if (!diff.newestVersion.isEmpty()) {
+      mod->setNewestVersion(diff.newestVersion);
+      mod->setLastNexusUpdate(now);
     }
   }
 
   // invalidate the filter to display mods with an update
   ui->modList->invalidateFilter();
-
-  if (requiresInfo) {
-    NexusInterface::instance().requestModInfo(gameNameReal, modID, this, QVariant(),
-                                              QString());
-  }
 }
 
 void MainWindow::nxmModInfoAvailable(QString gameName, int modID, QVariant userData,
@@ -3438,9 +3497,9 @@ void MainWindow::nxmModInfoAvailable(QString gameName, int modID, QVariant userD
     m_OrganizerCore.modList()->notifyChange(ModInfo::getIndex(mod->name()));
   }
 
-  if (foundUpdate) {
-    // invalidate the filter to display mods with an update
-    ui->modList->invalidateFilter();
+  if (foundUpdate && !m_UpdateResultsTimer.isActive()) {
+    // the filter is invalidated once for the mods answered meanwhile
+    m_UpdateResultsTimer.start();
   }
 }
 
@@ -3512,7 +3571,7 @@ void MainWindow::nxmTrackedModsAvailable(QVariant userData, QVariant resultData,
     }
 
     modInfo->setIsTracked(found);
-    modInfo->saveMeta();
+    modInfo->saveMetaLater();
   }
 }
 
@@ -3679,12 +3738,17 @@ void MainWindow::extractBSATriggered(QTreeWidgetItem* item)
       BSA::Archive archive;
       QString archivePath = QDir(origin).filePath(archiveName);
       BSA::EErrorCode result =
-          archive.read(archivePath.toLocal8Bit().constData(), true);
+          archive.read(archivePath.toLocal8Bit().constData(), false);
       if ((result != BSA::ERROR_NONE) && (result != BSA::ERROR_INVALIDHASHES)) {
         reportError(tr("failed to read %1: %2").arg(archivePath).arg(result));
         return;
       }
 
+      // the names are checked while the files are extracted
+      auto hashes = std::async(std::launch::async, [&archive] {
+        return archive.verifyHashes();
+      });
+
       QProgressDialog progress(this);
       progress.setMaximum(100);
       progress.setValue(0);
@@ -3693,7 +3757,8 @@ void MainWindow::extractBSATriggered(QTreeWidgetItem* item)
           QDir::toNativeSeparators(targetFolder).toLocal8Bit().constData(),
           boost::bind(&MainWindow::extractProgress, this, boost::ref(progress), _1,
                       _2));
-      if (result == BSA::ERROR_INVALIDHASHES) {
+      if ((result == BSA::ERROR_INVALIDHASHES) ||
+          (hashes.get() == BSA::ERROR_INVALIDHASHES)) {
         reportError(
             tr("This archive contains invalid hashes. Some files may be broken."));
       }
@@ -3720,9 +3785,14 @@ void MainWindow::on_bsaList_itemChanged(QTreeWidgetItem*, int)
 
 void MainWindow::on_actionNotifications_triggered()
 {
-  auto future = checkForProblemsAsync();
+  // the dialog shows the problems found by the last check, which is only stale
+  // if another one is due
+  if (m_UpdateProblemsTimer.isActive()) {
+    m_UpdateProblemsTimer.stop();
+    checkForProblemsAsync();
+  }
 
-  future.waitForFinished();
+  m_ProblemsCheck.waitForFinished();
 
   ProblemsDialog problems(m_PluginContainer, this);
   problems.exec();
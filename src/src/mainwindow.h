@@ -259,6 +259,26 @@ private:
   };
   void finishUpdateInfo(const NxmUpdateInfoData& data);
 
+  // what the file lists of a mod tell about one of its installed copies
+  struct NxmUpdateDiff
+  {
+    int fileStatus = -1;
+    QString newestVersion;
+
+    // the version has to come from the mod info instead
+    bool requiresInfo = false;
+  };
+
+  // compares the installed file of a mod with the files and updates nexus lists
+  // for the mod; only uses the response so it can run on any thread
+  static NxmUpdateDiff diffModUpdate(const QString& installedFile,
+                                     const QVariantList& files,
+                                     const QVariantList& fileUpdates);
+
+  // applies the update check results that arrived since the timer started, so
+  // the mod list is filtered again once instead of per mod
+  void applyUpdateResults();
+
 private:
   static const char* PATTERN_BACKUP_GLOB;
   static const char* PATTERN_BACKUP_REGEX;
@@ -296,8 +316,9 @@ private:
   QTimer m_CheckBSATimer;
   QTimer m_SaveMetaTimer;
   QTimer m_UpdateProblemsTimer;
+  QTimer m_UpdateResultsTimer;
 
-  QFuture<void> m_MetaSave;
+  std::vector<std::pair<ModInfo::Ptr, NxmUpdateDiff>> m_PendingUpdates;
 
   QTime m_StartTime;
 
@@ -326,6 +347,8 @@ private:
   std::atomic<std::size_t> m_NumberOfProblems;
   std::atomic<bool> m_ProblemsCheckRequired;
   std::mutex m_CheckForProblemsMutex;
+  // the last check started, the problems dialog waits for it
+  QFuture<void> m_ProblemsCheck;
 
   QVersionNumber m_LastVersion;
 
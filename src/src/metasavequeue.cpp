@@ -0,0 +1,97 @@
+#include "metasavequeue.h"
+#include "modinforegular.h"
+
+#include <log.h>
+
+#include <QSettings>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <utility>
+#include <vector>
+
+using namespace MOBase;
+
+bool writeMetaFile(const MetaFileWrite& write)
+{
+  QSettings metaFile(write.path, QSettings::IniFormat);
+  if (metaFile.status() != QSettings::NoError) {
+    log::error("failed to write {}: error {}", write.path, metaFile.status());
+    return false;
+  }
+
+  for (const auto& group : write.replacedGroups) {
+    metaFile.remove(group);
+  }
+
+  for (auto itor = write.values.begin(); itor != write.values.end(); ++itor) {
+    metaFile.setValue(itor.key(), itor.value());
+  }
+
+  metaFile.sync();  // sync needs to be called to ensure the file is created
+
+  if (metaFile.status() != QSettings::NoError) {
+    log::error("failed to write {}: error {}", write.path, metaFile.status());
+    return false;
+  }
+
+  return true;
+}
+
+MetaSaveQueue& MetaSaveQueue::instance()
+{
+  // never destroyed, mods still save their meta file while the static
+  // collection of mods is torn down
+  static MetaSaveQueue* queue = new MetaSaveQueue;
+  return *queue;
+}
+
+void MetaSaveQueue::add(ModInfoRegular* mod)
+{
+  std::scoped_lock lock(m_Mutex);
+  m_Mods[mod] = mod;
+}
+
+void MetaSaveQueue::flush()
+{
+  decltype(m_Mods) mods;
+  {
+    std::scoped_lock lock(m_Mutex);
+    mods = std::exchange(m_Mods, {});
+  }
+
+  std::vector<MetaFileWrite> batch;
+  for (const auto& entry : mods) {
+    // deleted mods saved themselves when they went
+    if (const auto& mod = entry.second) {
+      if (auto write = mod->takeMetaWrite()) {
+        batch.push_back(std::move(*write));
+      }
+    }
+  }
+
+  if (batch.empty()) {
+    return;
+  }
+
+  std::scoped_lock lock(m_Mutex);
+
+  // the previous batch may hold older values of the same files
+  m_Writes.waitForFinished();
+
+  m_Writes = QtConcurrent::run([batch = std::move(batch)] {
+    for (const auto& write : batch) {
+      writeMetaFile(write);
+    }
+  });
+}
+
+void MetaSaveQueue::wait()
+{
+  QFuture<void> writes;
+  {
+    std::scoped_lock lock(m_Mutex);
+    writes = m_Writes;
+  }
+
+  writes.waitForFinished();
+}
@@ -0,0 +1,67 @@
+#ifndef METASAVEQUEUE_H
+#define METASAVEQUEUE_H
+
+#include <QFuture>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+
+#include <map>
+#include <mutex>
+
+class ModInfoRegular;
+
+// values to store in a meta.ini, keyed like QSettings::allKeys(); the groups in
+// `replacedGroups` are removed first so entries that are gone don't linger
+//
+struct MetaFileWrite
+{
+  QString path;
+  QVariantMap values;
+  QStringList replacedGroups;
+};
+
+// writes `write` with QSettings, which replaces the file atomically; logs and
+// returns false on errors
+//
+bool writeMetaFile(const MetaFileWrite& write);
+
+// Write-behind queue for the meta files of mods.  Changes to a mod only mark
+// it here and all the marked mods are written together by flush(), which takes
+// a snapshot of their values on the calling thread and writes them on a worker
+// thread, so a mod changed many times in a row is written once.
+//
+// Batches are written in order, and ModInfoRegular::saveMeta() waits for the
+// ones in flight so an older snapshot never replaces a newer file.
+//
+// All members are thread-safe, flush() must be called from the thread owning
+// the mods.
+class MetaSaveQueue
+{
+public:
+  static MetaSaveQueue& instance();
+
+  // `mod` has changes, they're written with the next batch
+  //
+  void add(ModInfoRegular* mod);
+
+  // writes the changes of all the mods added since the last flush on a worker
+  // thread; a write that fails is only logged, the mod is written again the
+  // next time it changes
+  //
+  void flush();
+
+  // waits until the batches started by flush() are written
+  //
+  void wait();
+
+private:
+  MetaSaveQueue() = default;
+
+  std::mutex m_Mutex;
+  std::map<ModInfoRegular*, QPointer<ModInfoRegular>> m_Mods;
+  QFuture<void> m_Writes;
+};
+
+#endif  // METASAVEQUEUE_H
@@ -50,6 +50,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QStyleOption>
 #include <iplugingame.h>
 #include <log.h>
+#include <memoryusage.h>
 #include <report.h>
 #include <scopeguard.h>
 #include <utility.h>
@@ -502,6 +503,13 @@ int MOApplication::run(MOMultiProcess& multiProcess)
 
     tt.stop();
 
+    // what the startup built, in the log and as counters of the trace
+    for (const auto& u : memory::usages()) {
+      log::debug("memory: {} uses {} for {} items", u.subsystem,
+                 localizedByteSize(static_cast<unsigned long long>(u.bytes)), u.items);
+    }
+    memory::trace();
+
     res = exec();
     mainWindow.close();
 
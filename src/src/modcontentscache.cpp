@@ -0,0 +1,223 @@
+#include "modcontentscache.h"
+#include "moddatacontent.h"
+#include "vfs/layercache.h"
+
+#include <uibase/log.h>
+
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <QSaveFile>
+
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+using namespace MOBase;
+namespace fs = std::filesystem;
+
+namespace
+{
+
+constexpr char Magic[8]      = {'M', 'O', '2', 'C', 'O', 'N', 'T', 'C'};
+constexpr quint32 Version    = 1;
+constexpr const char* Name   = "mod_contents_cache.bin";
+constexpr auto StreamVersion = QDataStream::Qt_6_0;
+
+// FNV-1a, the stamps are persisted so they can't depend on the process
+//
+class Fingerprint
+{
+public:
+  void add(const void* data, std::size_t size)
+  {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; ++i) {
+      m_hash = (m_hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+  }
+
+  template <class T>
+  void add(const T& value)
+  {
+    add(&value, sizeof(value));
+  }
+
+  void add(const QString& s) { add(s.constData(), s.size() * sizeof(QChar)); }
+
+  void add(const std::string& s)
+  {
+    add(s.size());
+    add(s.data(), s.size());
+  }
+
+  quint64 value() const { return m_hash; }
+
+private:
+  quint64 m_hash = 0xcbf29ce484222325ull;
+};
+
+quint64 stampOf(const VfsLayer& layer, const ModDataContent& feature)
+{
+  Fingerprint f;
+
+  f.add(layer.root_mtime.time_since_epoch().count());
+  for (const auto& e : layer.entries) {
+    f.add(e.relative_path);
+    f.add(e.size);
+    f.add(e.mtime.time_since_epoch().count());
+    f.add(e.is_dir);
+  }
+
+  for (const auto& content : feature.getAllContents()) {
+    f.add(content.id());
+    f.add(content.name());
+  }
+
+  return f.value();
+}
+
+}  // namespace
+
+ModContentsCache::ModContentsCache(QString path, std::shared_ptr<VfsLayerCache> layers)
+    : m_path(std::move(path)), m_layers(std::move(layers))
+{
+  load();
+}
+
+void ModContentsCache::load()
+{
+  QFile file(m_path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return;
+  }
+
+  QDataStream in(&file);
+  in.setVersion(StreamVersion);
+
+  char magic[sizeof(Magic)] = {};
+  quint32 version           = 0;
+  quint32 count             = 0;
+
+  if (in.readRawData(magic, sizeof(magic)) != sizeof(magic) ||
+      std::memcmp(magic, Magic, sizeof(Magic)) != 0) {
+    return;
+  }
+
+  in >> version >> count;
+  if (in.status() != QDataStream::Ok || version != Version) {
+    return;
+  }
+
+  for (quint32 i = 0; i < count; ++i) {
+    QString path;
+    Entry entry;
+    QList<int> contents;
+
+    in >> path >> entry.stamp >> contents;
+    if (in.status() != QDataStream::Ok) {
+      // keeps what was read so far, the rest is classified again
+      return;
+    }
+
+    entry.contents = std::set<int>(contents.begin(), contents.end());
+    m_entries.insert_or_assign(std::move(path), std::move(entry));
+  }
+}
+
+std::set<int> ModContentsCache::get(const QString& directory,
+                                    const ModDataContent& feature,
+                                    const std::function<std::set<int>()>& compute)
+{
+  // scanned with the same origin as the directory refresher so both share the
+  // layer
+  const auto layer = m_layers->scan(QFileInfo(directory).fileName().toStdString(),
+                                    directory.toStdString());
+  const quint64 stamp = stampOf(*layer, feature);
+
+  {
+    std::scoped_lock lock(m_mutex);
+    m_used.insert(directory);
+
+    if (auto itor = m_entries.find(directory);
+        itor != m_entries.end() && itor->second.stamp == stamp) {
+      return itor->second.contents;
+    }
+  }
+
+  std::set<int> contents = compute();
+
+  std::scoped_lock lock(m_mutex);
+  m_entries.insert_or_assign(directory, Entry{stamp, contents});
+  m_dirty = true;
+
+  return contents;
+}
+
+bool ModContentsCache::save()
+{
+  std::vector<std::pair<QString, Entry>> entries;
+  {
+    std::scoped_lock lock(m_mutex);
+    if (!m_dirty) {
+      return true;
+    }
+    // mods nobody asked for in this run were removed
+    for (const auto& [path, entry] : m_entries) {
+      if (m_used.contains(path)) {
+        entries.emplace_back(path, entry);
+      }
+    }
+    m_dirty = false;
+  }
+
+  const auto failed = [this] {
+    std::scoped_lock lock(m_mutex);
+    m_dirty = true;
+    return false;
+  };
+
+  QSaveFile file(m_path);
+  if (!file.open(QIODevice::WriteOnly)) {
+    return failed();
+  }
+
+  QDataStream out(&file);
+  out.setVersion(StreamVersion);
+
+  out.writeRawData(Magic, sizeof(Magic));
+  out << Version << static_cast<quint32>(entries.size());
+
+  for (const auto& [path, entry] : entries) {
+    out << path << entry.stamp
+        << QList<int>(entry.contents.begin(), entry.contents.end());
+  }
+
+  if (out.status() != QDataStream::Ok || !file.commit()) {
+    log::warn("failed to write mod contents cache '{}', {}", m_path,
+              file.errorString());
+    return failed();
+  }
+
+  return true;
+}
+
+std::shared_ptr<ModContentsCache> sharedModContentsCache(const QString& overwriteDir)
+{
+  static std::mutex mutex;
+  static std::shared_ptr<ModContentsCache> cache;
+  static QString cachePath;
+
+  const fs::path layerCache = layerCachePath(overwriteDir.toStdString());
+  const QString path =
+      QString::fromStdWString((layerCache.parent_path() / Name).wstring());
+
+  std::scoped_lock lock(mutex);
+  if (cache == nullptr || cachePath != path) {
+    cache = std::make_shared<ModContentsCache>(
+        path, sharedLayerCache(overwriteDir.toStdString()));
+    cachePath = path;
+  }
+  return cache;
+}
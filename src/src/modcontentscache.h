@@ -0,0 +1,67 @@
+#ifndef MODCONTENTSCACHE_H
+#define MODCONTENTSCACHE_H
+
+#include <QString>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace MOBase
+{
+class ModDataContent;
+}
+
+class VfsLayerCache;
+
+// The contents of every mod as classified by the game's ModDataContent
+// feature, persisted next to the instance so a cold start doesn't list and
+// classify every mod again.  Entries are checked against a fingerprint of the
+// mod's layer in the VFS layer cache, which changes whenever a directory of the
+// mod is modified, so an unchanged mod costs a stat() per directory.
+//
+// All members are thread-safe.
+class ModContentsCache
+{
+public:
+  ModContentsCache(QString path, std::shared_ptr<VfsLayerCache> layers);
+
+  // the cached contents of the mod in `directory` if it hasn't changed,
+  // calling `compute` and caching the result otherwise; everything is
+  // computed again when the content types of `feature` change
+  //
+  std::set<int> get(const QString& directory, const MOBase::ModDataContent& feature,
+                    const std::function<std::set<int>()>& compute);
+
+  // writes the contents used by this process if anything changed since the
+  // file was loaded or last saved
+  //
+  bool save();
+
+private:
+  struct Entry
+  {
+    // of the mod's layer and the content types, see get()
+    quint64 stamp = 0;
+    std::set<int> contents;
+  };
+
+  void load();
+
+  QString m_path;
+  std::shared_ptr<VfsLayerCache> m_layers;
+  mutable std::mutex m_mutex;
+  std::unordered_map<QString, Entry> m_entries;
+  std::unordered_set<QString> m_used;
+  bool m_dirty = false;
+};
+
+// process-wide cache for the instance owning `overwriteDir`, loaded on first
+// use
+//
+std::shared_ptr<ModContentsCache> sharedModContentsCache(const QString& overwriteDir);
+
+#endif  // MODCONTENTSCACHE_H
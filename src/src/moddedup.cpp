@@ -0,0 +1,478 @@
+#include "moddedup.h"
+
+#include <uibase/log.h>
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSettings>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <unordered_set>
+
+using namespace MOBase;
+
+namespace
+{
+
+constexpr char Magic[8]      = {'M', 'O', '2', 'D', 'E', 'D', 'U', 'P'};
+constexpr quint32 Version    = 1;
+constexpr const char* Name   = "mod_dedup_index.bin";
+constexpr auto StreamVersion = QDataStream::Qt_6_0;
+constexpr auto Algorithm     = QCryptographicHash::Blake2b_256;
+
+// a file is linked here first and renamed over the copy it replaces
+constexpr const char* TempSuffix = ".mo2dedup";
+
+enum class Link
+{
+  None,
+  Reflink,
+  Hardlink
+};
+
+QByteArray hashFile(const QString& path)
+{
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return {};
+  }
+
+  QCryptographicHash hash(Algorithm);
+  if (!hash.addData(&file)) {
+    return {};
+  }
+  return hash.result();
+}
+
+bool sameContents(const QString& a, const QString& b)
+{
+  constexpr qint64 ChunkSize = 1024 * 1024;
+
+  QFile fa(a);
+  QFile fb(b);
+  if (!fa.open(QIODevice::ReadOnly) || !fb.open(QIODevice::ReadOnly) ||
+      fa.size() != fb.size()) {
+    return false;
+  }
+
+  std::vector<char> ba(ChunkSize);
+  std::vector<char> bb(ChunkSize);
+  for (;;) {
+    const qint64 na = fa.read(ba.data(), ChunkSize);
+    const qint64 nb = fb.read(bb.data(), ChunkSize);
+    if (na < 0 || na != nb) {
+      return false;
+    }
+    if (na == 0) {
+      return true;
+    }
+    if (std::memcmp(ba.data(), bb.data(), na) != 0) {
+      return false;
+    }
+  }
+}
+
+// replaces `copy` with a reflink of `original`, or with a hard link if
+// reflinks aren't supported and `hardlinks` is set; a reflink keeps the
+// permissions and times of `copy`
+//
+Link replaceWithLink(const QString& original, const QString& copy, bool hardlinks)
+{
+  const QByteArray source = QFile::encodeName(original);
+  const QByteArray target = QFile::encodeName(copy);
+  const QByteArray temp   = target + TempSuffix;
+
+  struct ::stat st;
+  if (::stat(target.constData(), &st) != 0) {
+    return Link::None;
+  }
+
+  // left behind by a pass that didn't finish
+  ::unlink(temp.constData());
+
+  const int in = ::open(source.constData(), O_RDONLY | O_CLOEXEC);
+  if (in < 0) {
+    return Link::None;
+  }
+
+  const int out = ::open(temp.constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                         st.st_mode & 07777);
+  if (out < 0) {
+    ::close(in);
+    return Link::None;
+  }
+
+  const bool cloned = ::ioctl(out, FICLONE, in) == 0;
+  if (cloned) {
+    const timespec times[2] = {st.st_atim, st.st_mtim};
+    ::futimens(out, times);
+  }
+  ::close(out);
+  ::close(in);
+
+  if (!cloned) {
+    ::unlink(temp.constData());
+    if (!hardlinks || ::link(source.constData(), temp.constData()) != 0) {
+      return Link::None;
+    }
+  }
+
+  if (::rename(temp.constData(), target.constData()) != 0) {
+    log::warn("failed to replace '{}' with a link, {}", copy, std::strerror(errno));
+    ::unlink(temp.constData());
+    return Link::None;
+  }
+
+  return cloned ? Link::Reflink : Link::Hardlink;
+}
+
+}  // namespace
+
+ModDedup::ModDedup(const QString& modsDirectory)
+{
+  const QDir mods(modsDirectory);
+  m_modsDirectory = mods.canonicalPath();
+  if (m_modsDirectory.isEmpty()) {
+    m_modsDirectory = mods.absolutePath();
+  }
+  m_path = QFileInfo(m_modsDirectory).dir().filePath(Name);
+
+  load();
+}
+
+void ModDedup::load()
+{
+  QFile file(m_path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return;
+  }
+
+  QDataStream in(&file);
+  in.setVersion(StreamVersion);
+
+  char magic[sizeof(Magic)] = {};
+  quint32 version           = 0;
+  quint32 count             = 0;
+
+  if (in.readRawData(magic, sizeof(magic)) != sizeof(magic) ||
+      std::memcmp(magic, Magic, sizeof(Magic)) != 0) {
+    return;
+  }
+
+  in >> version >> count;
+  if (in.status() != QDataStream::Ok || version != Version) {
+    return;
+  }
+
+  for (quint32 i = 0; i < count; ++i) {
+    QString path;
+    Entry entry;
+
+    in >> path >> entry.size >> entry.writeTime >> entry.hash >> entry.shared;
+    if (in.status() != QDataStream::Ok) {
+      // keeps what was read so far, the rest is hashed again
+      return;
+    }
+
+    m_entries.insert_or_assign(std::move(path), std::move(entry));
+  }
+}
+
+bool ModDedup::save()
+{
+  QSaveFile file(m_path);
+  if (!file.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+
+  QDataStream out(&file);
+  out.setVersion(StreamVersion);
+
+  out.writeRawData(Magic, sizeof(Magic));
+  out << Version << static_cast<quint32>(m_entries.size());
+
+  for (const auto& [path, entry] : m_entries) {
+    out << path << entry.size << entry.writeTime << entry.hash << entry.shared;
+  }
+
+  if (out.status() != QDataStream::Ok || !file.commit()) {
+    log::warn("failed to write mod dedup index '{}', {}", m_path, file.errorString());
+    return false;
+  }
+
+  return true;
+}
+
+bool ModDedup::statFile(const QString& relative, File& out) const
+{
+  const QByteArray path = QFile::encodeName(m_modsDirectory + "/" + relative);
+
+  struct ::stat st;
+  if (::lstat(path.constData(), &st) != 0 || !S_ISREG(st.st_mode)) {
+    return false;
+  }
+
+  out.relative        = relative;
+  out.entry.size      = st.st_size;
+  out.entry.writeTime = qint64(st.st_mtim.tv_sec) * 1'000'000'000 + st.st_mtim.tv_nsec;
+  out.device          = st.st_dev;
+  out.inode           = st.st_ino;
+
+  if (auto it = m_entries.find(relative); it != m_entries.end()) {
+    if (it->second.size == out.entry.size &&
+        it->second.writeTime == out.entry.writeTime) {
+      out.entry.hash   = it->second.hash;
+      out.entry.shared = it->second.shared;
+    }
+  }
+
+  return true;
+}
+
+ModDedup::Result ModDedup::dedupeAll(bool hardlinks, Progress* progress)
+{
+  std::scoped_lock lock(m_mutex);
+
+  const QDir base(m_modsDirectory);
+  std::vector<File> files;
+
+  QDirIterator it(m_modsDirectory, QDir::Files | QDir::Hidden | QDir::NoSymLinks,
+                  QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    const QString path = it.next();
+    if (path.endsWith(TempSuffix)) {
+      continue;
+    }
+
+    File file;
+    if (statFile(base.relativeFilePath(path), file) && file.entry.size >= MinSize) {
+      files.push_back(std::move(file));
+    }
+  }
+
+  const Result result = dedupe(files, hardlinks, progress);
+
+  // files that are gone drop out here
+  m_entries.clear();
+  for (auto& file : files) {
+    m_entries.emplace(std::move(file.relative), std::move(file.entry));
+  }
+  save();
+
+  log::info("deduplicated {} mod files, {} bytes freed", result.files, result.bytes);
+  return result;
+}
+
+ModDedup::Result ModDedup::dedupeMod(const QString& modDirectory, bool hardlinks)
+{
+  std::unique_lock lock(m_mutex, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    return {};
+  }
+
+  const QDir base(m_modsDirectory);
+  const QString prefix =
+      base.relativeFilePath(QDir(modDirectory).canonicalPath()) + "/";
+
+  std::vector<File> files;
+  std::unordered_set<qint64> sizes;
+
+  QDirIterator it(modDirectory, QDir::Files | QDir::Hidden | QDir::NoSymLinks,
+                  QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    const QString path = it.next();
+    if (path.endsWith(TempSuffix)) {
+      continue;
+    }
+
+    File file;
+    if (statFile(base.relativeFilePath(QFileInfo(path).canonicalFilePath()), file) &&
+        file.entry.size >= MinSize) {
+      sizes.insert(file.entry.size);
+      files.push_back(std::move(file));
+    }
+  }
+
+  if (files.empty()) {
+    return {};
+  }
+
+  for (auto entry = m_entries.begin(); entry != m_entries.end();) {
+    if (entry->first.startsWith(prefix)) {
+      // listed again above, a reinstall may have removed some of them
+      entry = m_entries.erase(entry);
+      continue;
+    }
+
+    if (sizes.contains(entry->second.size)) {
+      File file;
+      if (!statFile(entry->first, file)) {
+        entry = m_entries.erase(entry);
+        continue;
+      }
+      file.keep = true;
+      files.push_back(std::move(file));
+    }
+
+    ++entry;
+  }
+
+  const Result result = dedupe(files, hardlinks, nullptr);
+
+  for (auto& file : files) {
+    m_entries.insert_or_assign(std::move(file.relative), std::move(file.entry));
+  }
+  save();
+
+  log::debug("deduplicated {} files of '{}', {} bytes freed", result.files,
+             modDirectory, result.bytes);
+  return result;
+}
+
+ModDedup::Result ModDedup::dedupe(std::vector<File>& files, bool hardlinks,
+                                  Progress* progress)
+{
+  const auto cancelled = [progress] {
+    return progress != nullptr && progress->cancelled;
+  };
+  const auto pathOf = [this](const File& file) {
+    return m_modsDirectory + "/" + file.relative;
+  };
+
+  std::map<qint64, std::vector<size_t>> bySize;
+  for (size_t i = 0; i < files.size(); ++i) {
+    bySize[files[i].entry.size].push_back(i);
+  }
+
+  std::vector<size_t> pending;
+  qint64 total = 0;
+  for (const auto& [size, group] : bySize) {
+    if (group.size() < 2) {
+      continue;
+    }
+    for (size_t i : group) {
+      if (files[i].entry.hash.isEmpty()) {
+        pending.push_back(i);
+        total += size;
+      }
+    }
+  }
+
+  if (progress != nullptr) {
+    progress->total = total;
+  }
+
+  // every index is in there once, so each file is only touched by one thread
+  QtConcurrent::blockingMap(pending, [&](size_t i) {
+    File& file = files[i];
+    if (!cancelled()) {
+      file.entry.hash = hashFile(pathOf(file));
+    }
+    if (progress != nullptr) {
+      progress->done += file.entry.size;
+    }
+  });
+
+  Result result;
+
+  for (const auto& [size, group] : bySize) {
+    if (group.size() < 2) {
+      continue;
+    }
+
+    std::map<QByteArray, std::vector<size_t>> byHash;
+    for (size_t i : group) {
+      if (!files[i].entry.hash.isEmpty()) {
+        byHash[files[i].entry.hash].push_back(i);
+      }
+    }
+
+    for (auto& [hash, same] : byHash) {
+      if (same.size() < 2) {
+        continue;
+      }
+
+      std::sort(same.begin(), same.end(), [&](size_t a, size_t b) {
+        if (files[a].keep != files[b].keep) {
+          return files[a].keep;
+        }
+        return files[a].relative < files[b].relative;
+      });
+
+      File& original = files[same.front()];
+
+      for (auto i = std::next(same.begin()); i != same.end() && !cancelled(); ++i) {
+        File& copy = files[*i];
+
+        if (copy.device != original.device) {
+          // neither kind of link crosses file systems
+          continue;
+        }
+        if (copy.inode == original.inode) {
+          copy.entry.shared = original.entry.shared = true;
+          continue;
+        }
+        if (copy.entry.shared && original.entry.shared) {
+          continue;
+        }
+        if (!sameContents(pathOf(original), pathOf(copy))) {
+          continue;
+        }
+
+        const Link link = replaceWithLink(pathOf(original), pathOf(copy), hardlinks);
+        if (link == Link::None) {
+          continue;
+        }
+
+        if (link == Link::Hardlink) {
+          copy.inode           = original.inode;
+          copy.entry.writeTime = original.entry.writeTime;
+        }
+        copy.entry.shared = original.entry.shared = true;
+
+        ++result.files;
+        result.bytes += size;
+      }
+    }
+  }
+
+  return result;
+}
+
+std::shared_ptr<ModDedup> sharedModDedup(const QString& modsDirectory)
+{
+  static std::mutex mutex;
+  static std::shared_ptr<ModDedup> dedup;
+  static QString dedupPath;
+
+  std::scoped_lock lock(mutex);
+  if (dedup == nullptr || dedupPath != modsDirectory) {
+    dedup     = std::make_shared<ModDedup>(modsDirectory);
+    dedupPath = modsDirectory;
+  }
+  return dedup;
+}
+
+bool dedupOnInstallEnabled()
+{
+  return QSettings().value("fluorine/dedup_on_install", false).toBool();
+}
+
+bool dedupHardlinksEnabled()
+{
+  return QSettings().value("fluorine/dedup_hardlinks", false).toBool();
+}
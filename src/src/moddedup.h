@@ -0,0 +1,107 @@
+#ifndef MODDEDUP_H
+#define MODDEDUP_H
+
+#include <QByteArray>
+#include <QString>
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Content-addressed deduplication of the files in a mods directory.  Files
+// with the same contents are replaced by reflinks to one of them, so they
+// share their data on disk but stay separate files: writing to one copies the
+// blocks it touches.  Hard links are used instead where reflinks aren't
+// supported if the caller allows it.
+//
+// Only files whose size matches another file's are hashed, and hashes are
+// persisted next to the instance along with the size and modification time
+// of their file, so a pass only reads the files that changed since the last
+// one.  Contents are compared byte for byte before a file is replaced.
+//
+// All members are thread-safe, a pass runs at most once at a time.
+class ModDedup
+{
+public:
+  // files smaller than this aren't worth a link
+  static constexpr qint64 MinSize = 64 * 1024;
+
+  struct Result
+  {
+    qint64 files = 0;  // replaced by links
+    qint64 bytes = 0;  // no longer stored twice
+  };
+
+  // updated while a pass runs, `cancelled` stops it before the next file
+  struct Progress
+  {
+    std::atomic<qint64> done{0};
+    std::atomic<qint64> total{0};
+    std::atomic<bool> cancelled{false};
+  };
+
+  explicit ModDedup(const QString& modsDirectory);
+
+  // deduplicates all the files of all mods, blocks until done
+  //
+  Result dedupeAll(bool hardlinks, Progress* progress = nullptr);
+
+  // deduplicates the files of the mod at `modDirectory` against the files of
+  // the other mods in the index, preferring to keep the copies of the other
+  // mods; the index only knows the mods seen by a pass over all mods and the
+  // ones deduplicated since.  Returns nothing if a pass over all mods is
+  // running, that one picks the mod up as well
+  //
+  Result dedupeMod(const QString& modDirectory, bool hardlinks);
+
+private:
+  struct Entry
+  {
+    qint64 size      = 0;
+    qint64 writeTime = 0;
+    QByteArray hash;  // empty if no other file had the same size
+    bool shared = false;  // already linked to the others with this hash
+  };
+
+  struct File
+  {
+    QString relative;
+    Entry entry;
+    dev_t device = 0;
+    ino_t inode  = 0;
+    bool keep    = false;  // preferred as the copy the others link to
+  };
+
+  void load();
+  bool save();
+
+  // stats the file at `relative`, reusing the hash of its entry if the file
+  // didn't change since
+  //
+  bool statFile(const QString& relative, File& out) const;
+
+  Result dedupe(std::vector<File>& files, bool hardlinks, Progress* progress);
+
+  QString m_modsDirectory;
+  QString m_path;
+  std::mutex m_mutex;
+  std::unordered_map<QString, Entry> m_entries;
+};
+
+// process-wide instance for the mods in `modsDirectory`, loaded on first use
+//
+std::shared_ptr<ModDedup> sharedModDedup(const QString& modsDirectory);
+
+// whether new mods are deduplicated after they're installed
+//
+bool dedupOnInstallEnabled();
+
+// whether deduplication falls back to hard links
+//
+bool dedupHardlinksEnabled();
+
+#endif  // MODDEDUP_H
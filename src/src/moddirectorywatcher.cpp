@@ -0,0 +1,277 @@
+#include "moddirectorywatcher.h"
+
+#include <uibase/log.h>
+
+#include <QDirIterator>
+#include <QFile>
+#include <QSocketNotifier>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <set>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+using namespace MOBase;
+
+namespace
+{
+constexpr uint32_t WatchMask = IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM |
+                               IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF |
+                               IN_ONLYDIR | IN_DONTFOLLOW | IN_EXCL_UNLINK;
+
+// editors and installers write in bursts, this collects one
+constexpr int SettleDelayMs = 500;
+}  // namespace
+
+ModDirectoryWatcher::ModDirectoryWatcher(QObject* parent) : QObject(parent)
+{
+  m_timer.setSingleShot(true);
+  m_timer.setInterval(SettleDelayMs);
+  connect(&m_timer, &QTimer::timeout, this, &ModDirectoryWatcher::flush);
+}
+
+ModDirectoryWatcher::~ModDirectoryWatcher()
+{
+  stop();
+}
+
+bool ModDirectoryWatcher::start()
+{
+  if (m_fd >= 0) {
+    return true;
+  }
+
+  m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (m_fd < 0) {
+    log::warn("mod watcher: inotify_init1 failed, {}", std::strerror(errno));
+    return false;
+  }
+
+  m_notifier = std::make_unique<QSocketNotifier>(m_fd, QSocketNotifier::Read);
+  connect(m_notifier.get(), &QSocketNotifier::activated, this,
+          &ModDirectoryWatcher::onReadable);
+
+  return true;
+}
+
+void ModDirectoryWatcher::stop()
+{
+  m_timer.stop();
+  m_notifier.reset();
+
+  if (m_fd >= 0) {
+    // closing drops every watch at once
+    ::close(m_fd);
+    m_fd = -1;
+  }
+
+  m_watches.clear();
+  m_roots.clear();
+  m_pending.clear();
+  m_overflow = false;
+}
+
+void ModDirectoryWatcher::watch(const std::vector<std::pair<QString, QString>>& mods)
+{
+  stop();
+
+  if (!start()) {
+    return;
+  }
+
+  for (auto&& [mod, path] : mods) {
+    if (!addTree(mod, path, {})) {
+      return;
+    }
+  }
+
+  log::debug("mod watcher: {} directories watched for {} mods", m_watches.size(),
+             mods.size());
+}
+
+void ModDirectoryWatcher::addMod(const QString& mod, const QString& path)
+{
+  if (!isWatching()) {
+    return;
+  }
+
+  removeMod(mod);
+  addTree(mod, path, {});
+}
+
+void ModDirectoryWatcher::removeMod(const QString& mod)
+{
+  for (auto itor = m_watches.begin(); itor != m_watches.end();) {
+    if (itor->second.mod == mod) {
+      inotify_rm_watch(m_fd, itor->first);
+      itor = m_watches.erase(itor);
+    } else {
+      ++itor;
+    }
+  }
+
+  m_roots.erase(mod);
+}
+
+bool ModDirectoryWatcher::addTree(const QString& mod, const QString& root,
+                                  const QString& relative)
+{
+  const QString top = relative.isEmpty() ? root : root + "/" + relative;
+
+  auto add = [&](const QString& dir, const QString& rel) {
+    const int wd =
+        inotify_add_watch(m_fd, QFile::encodeName(dir).constData(), WatchMask);
+
+    if (wd >= 0) {
+      m_watches[wd] = {mod, rel};
+      return true;
+    }
+
+    if (errno == ENOSPC) {
+      log::warn("mod watcher: out of inotify watches after {} directories, changes "
+                "on disk need a manual refresh; raise fs.inotify.max_user_watches "
+                "to enable it",
+                m_watches.size());
+      stop();
+      return false;
+    }
+
+    // gone already or unreadable, nothing to report either way
+    return true;
+  };
+
+  if (relative.isEmpty()) {
+    m_roots[mod] = root;
+  }
+
+  if (!add(top, relative)) {
+    return false;
+  }
+
+  QDirIterator it(top,
+                  QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden | QDir::NoSymLinks,
+                  QDirIterator::Subdirectories);
+
+  while (it.hasNext()) {
+    const QString dir = it.next();
+    const QString rel = dir.mid(root.size() + 1);
+
+    if (!add(dir, rel)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void ModDirectoryWatcher::onReadable()
+{
+  alignas(inotify_event) char buffer[64 * 1024];
+
+  for (;;) {
+    const ssize_t n = ::read(m_fd, buffer, sizeof(buffer));
+    if (n <= 0) {
+      break;
+    }
+
+    for (ssize_t offset = 0; offset < n;) {
+      const auto* e = reinterpret_cast<const inotify_event*>(buffer + offset);
+      offset += sizeof(inotify_event) + e->len;
+
+      if (e->mask & IN_Q_OVERFLOW) {
+        m_overflow = true;
+        continue;
+      }
+
+      auto itor = m_watches.find(e->wd);
+      if (itor == m_watches.end()) {
+        continue;
+      }
+
+      if (e->mask & IN_IGNORED) {
+        m_watches.erase(itor);
+        continue;
+      }
+
+      const Watch w = itor->second;
+
+      if (e->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+        // subdirectories are reported by their parent, the mod directory
+        // itself has none being watched
+        if (w.relative.isEmpty()) {
+          m_overflow = true;
+        }
+        continue;
+      }
+
+      if (e->len == 0) {
+        continue;
+      }
+
+      const QString name = QFile::decodeName(e->name);
+      const QString path = w.relative.isEmpty() ? name : w.relative + "/" + name;
+
+      if (e->mask & IN_ISDIR) {
+        // whatever was put in before the watch is added is picked up by the
+        // rescan
+        if ((e->mask & (IN_CREATE | IN_MOVED_TO)) &&
+            !addTree(w.mod, m_roots[w.mod], path)) {
+          return;
+        }
+
+        m_pending.push_back({Change::Type::DirectoryChanged, w.mod, path});
+      } else if (e->mask & (IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO)) {
+        m_pending.push_back({Change::Type::FileChanged, w.mod, path});
+      } else if (e->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        m_pending.push_back({Change::Type::FileRemoved, w.mod, path});
+      }
+    }
+  }
+
+  if ((m_overflow || !m_pending.empty()) && !m_timer.isActive()) {
+    m_timer.start();
+  }
+}
+
+void ModDirectoryWatcher::flush()
+{
+  if (m_overflow) {
+    m_pending.clear();
+    m_overflow = false;
+
+    log::debug("mod watcher: events were lost, full refresh needed");
+    emit overflowed();
+    return;
+  }
+
+  // a directory change rescans the whole mod, its file changes are moot; for
+  // the rest only the last event of a file counts
+  std::set<QString> rescanned;
+  for (const auto& c : m_pending) {
+    if (c.type == Change::Type::DirectoryChanged) {
+      rescanned.insert(c.mod);
+    }
+  }
+
+  std::vector<Change> changes;
+  std::set<std::pair<QString, QString>> seen;
+
+  for (auto itor = m_pending.rbegin(); itor != m_pending.rend(); ++itor) {
+    if (rescanned.contains(itor->mod)) {
+      if (itor->type == Change::Type::DirectoryChanged &&
+          seen.insert({itor->mod, {}}).second) {
+        changes.push_back(*itor);
+      }
+    } else if (seen.insert({itor->mod, itor->path}).second) {
+      changes.push_back(*itor);
+    }
+  }
+
+  m_pending.clear();
+  std::reverse(changes.begin(), changes.end());
+
+  emit changed(changes);
+}
@@ -0,0 +1,91 @@
+#ifndef MODDIRECTORYWATCHER_H
+#define MODDIRECTORYWATCHER_H
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class QSocketNotifier;
+
+// Watches the data directories of the active mods with inotify and reports
+// what changed on disk, so the directory structure can be patched instead of
+// rebuilt.  Events are collected for a moment and reported together.
+//
+// Anything inotify can't describe precisely, a dropped event queue or a mod
+// directory itself going away, is reported as overflowed() and needs a full
+// refresh.  If the watch limit is hit, watching stops and nothing is reported,
+// like before.
+//
+// The download manager watches its output directory the same way, as a single
+// mod with an empty name.
+//
+class ModDirectoryWatcher : public QObject
+{
+  Q_OBJECT
+
+public:
+  struct Change
+  {
+    enum class Type
+    {
+      FileChanged,
+      FileRemoved,
+
+      // something happened to a whole directory, the mod needs a rescan
+      DirectoryChanged
+    };
+
+    Type type;
+    QString mod;
+
+    // relative to the mod's data directory, '/' separated
+    QString path;
+  };
+
+  explicit ModDirectoryWatcher(QObject* parent = nullptr);
+  ~ModDirectoryWatcher() override;
+
+  // replaces all watches, `mods` are pairs of mod name and data directory
+  //
+  void watch(const std::vector<std::pair<QString, QString>>& mods);
+
+  // watches one more mod, replacing any previous watch of it
+  //
+  void addMod(const QString& mod, const QString& path);
+
+  void stop();
+
+  bool isWatching() const { return m_fd >= 0; }
+
+signals:
+  void changed(const std::vector<ModDirectoryWatcher::Change>& changes);
+  void overflowed();
+
+private:
+  struct Watch
+  {
+    QString mod;
+    QString relative;
+  };
+
+  int m_fd = -1;
+  std::unique_ptr<QSocketNotifier> m_notifier;
+  std::map<int, Watch> m_watches;
+  std::map<QString, QString> m_roots;
+  std::vector<Change> m_pending;
+  bool m_overflow = false;
+  QTimer m_timer;
+
+  bool start();
+  bool addTree(const QString& mod, const QString& root, const QString& relative);
+  void removeMod(const QString& mod);
+  void onReadable();
+  void flush();
+};
+
+#endif  // MODDIRECTORYWATCHER_H
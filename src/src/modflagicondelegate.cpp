@@ -1,6 +1,7 @@
 #include "modflagicondelegate.h"
 #include "modlist.h"
 #include "modlistview.h"
+#include "organizercore.h"
 #include <QList>
 #include <log.h>
 
@@ -76,9 +77,7 @@ size_t ModFlagIconDelegate::getNumIcons(const QModelIndex& index) const
 {
   unsigned int modIdx = index.data(ModList::IndexRole).toInt();
   if (modIdx < ModInfo::getNumMods()) {
-    ModInfo::Ptr info                 = ModInfo::getByIndex(modIdx);
-    std::vector<ModInfo::EFlag> flags = info->getFlags();
-    return flags.size();
+    return m_view->m_core->modList()->modFlags(modIdx).size();
   } else {
     return 0;
   }
@@ -0,0 +1,429 @@
+#include "modimage.h"
+
+#include <uibase/log.h>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QObject>
+#include <QProcess>
+#include <QStandardPaths>
+
+#include <sys/stat.h>
+
+#include <map>
+#include <mutex>
+#include <set>
+
+using namespace MOBase;
+
+namespace
+{
+
+constexpr const char* ErofsName    = ".mod.erofs";
+constexpr const char* SquashfsName = ".mod.sqsh";
+constexpr const char* MetaName     = "meta.ini";
+
+struct ImageTools
+{
+  QString build;
+  QString mount;
+  const char* name = nullptr;
+};
+
+ImageTools erofsTools()
+{
+  return {QStandardPaths::findExecutable("mkfs.erofs"),
+          QStandardPaths::findExecutable("erofsfuse"), ErofsName};
+}
+
+ImageTools squashfsTools()
+{
+  return {QStandardPaths::findExecutable("mksquashfs"),
+          QStandardPaths::findExecutable("squashfuse"), SquashfsName};
+}
+
+bool isFlatpak()
+{
+  static const bool result = QFile::exists(QStringLiteral("/.flatpak-info"));
+  return result;
+}
+
+bool isMounted(const QString& path)
+{
+  struct ::stat dir;
+  struct ::stat parent;
+  return ::stat(QFile::encodeName(path).constData(), &dir) == 0 &&
+         ::stat(QFile::encodeName(path + "/..").constData(), &parent) == 0 &&
+         dir.st_dev != parent.st_dev;
+}
+
+bool run(const QString& program, const QStringList& args, QString& error)
+{
+  QProcess p;
+  p.setProcessChannelMode(QProcess::MergedChannels);
+  p.start(program, args);
+
+  if (!p.waitForStarted() || !p.waitForFinished(-1)) {
+    error = QObject::tr("failed to run %1: %2").arg(program, p.errorString());
+    return false;
+  }
+
+  if (p.exitStatus() != QProcess::NormalExit || p.exitCode() != 0) {
+    const QString output = QString::fromLocal8Bit(p.readAll()).trimmed();
+    error = QObject::tr("%1 failed: %2").arg(QFileInfo(program).fileName(), output);
+    return false;
+  }
+
+  return true;
+}
+
+void unmount(const QString& path)
+{
+  QString ignored;
+  if (!run("fusermount3", {"-u", path}, ignored) &&
+      !run("fusermount", {"-u", path}, ignored)) {
+    // still in use, e.g. by the VFS, goes away once it's released
+    run("fusermount3", {"-uz", path}, ignored);
+  }
+}
+
+// relative path and size of every file below `root`, directories are listed
+// with a size of -1; meta.ini and images at the top are left out
+//
+std::map<QString, qint64> listFiles(const QString& root)
+{
+  std::map<QString, qint64> files;
+  const QDir base(root);
+
+  QDirIterator it(root, QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden |
+                            QDir::System,
+                  QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    it.next();
+    const QFileInfo info   = it.fileInfo();
+    const QString relative = base.relativeFilePath(info.filePath());
+
+    if (relative == MetaName || relative == ErofsName || relative == SquashfsName) {
+      continue;
+    }
+
+    files.emplace(relative, info.isDir() && !info.isSymLink() ? -1 : info.size());
+  }
+
+  return files;
+}
+
+// mounts `image` at `mountPoint`, replacing whatever is mounted there
+//
+bool mountImage(const QString& image, const QString& mountPoint, QString& error)
+{
+  const bool erofs       = image.endsWith(ErofsName) || image.endsWith(".erofs.tmp");
+  const ImageTools tools = erofs ? erofsTools() : squashfsTools();
+  if (tools.mount.isEmpty()) {
+    error = QObject::tr("%1 is not installed").arg(erofs ? "erofsfuse" : "squashfuse");
+    return false;
+  }
+
+  if (isMounted(mountPoint)) {
+    // left behind by a previous run, the image may have changed since
+    unmount(mountPoint);
+  }
+
+  if (!QDir().mkpath(mountPoint)) {
+    error = QObject::tr("failed to create %1").arg(mountPoint);
+    return false;
+  }
+
+  if (!run(tools.mount, {image, mountPoint}, error)) {
+    return false;
+  }
+
+  if (!isMounted(mountPoint)) {
+    error = QObject::tr("%1 did not mount %2").arg(tools.mount, image);
+    return false;
+  }
+
+  return true;
+}
+
+QString mountRoot()
+{
+  QString runtime = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+  if (runtime.isEmpty()) {
+    runtime = QDir::tempPath();
+  }
+  return runtime + "/fluorine-images";
+}
+
+// mounted images by path, see unmountModImages()
+class MountedImages
+{
+public:
+  // the mount point of `image`, mounting it if needed; empty on errors
+  //
+  QString get(const QString& modDirectory, const QString& image)
+  {
+    std::scoped_lock lock(m_mutex);
+
+    if (isFlatpak()) {
+      if (m_sandboxed.insert(image).second) {
+        log::warn("'{}' is packed into an image, which can't be mounted in the "
+                  "Flatpak sandbox; its files are missing until it's unpacked "
+                  "outside of it",
+                  modDirectory);
+      }
+      return {};
+    }
+
+    if (auto it = m_mounts.find(image); it != m_mounts.end()) {
+      if (isMounted(it->second)) {
+        return it->second;
+      }
+      m_mounts.erase(it);
+    }
+
+    // named after the mod, the VFS takes the names of mods from their roots
+    const QString key = QString::fromLatin1(
+        QCryptographicHash::hash(image.toUtf8(), QCryptographicHash::Md5)
+            .toHex()
+            .left(16));
+    const QString mountPoint =
+        mountRoot() + "/" + key + "/" + QFileInfo(modDirectory).fileName();
+
+    QString error;
+    if (!mountImage(image, mountPoint, error)) {
+      log::error("failed to mount the image of '{}', {}", modDirectory, error);
+      return {};
+    }
+
+    log::debug("mounted '{}' at '{}'", image, mountPoint);
+    m_mounts.emplace(image, mountPoint);
+    return mountPoint;
+  }
+
+  void release(const QString& image)
+  {
+    std::scoped_lock lock(m_mutex);
+    if (auto it = m_mounts.find(image); it != m_mounts.end()) {
+      unmount(it->second);
+      m_mounts.erase(it);
+    }
+  }
+
+  void releaseAll()
+  {
+    std::scoped_lock lock(m_mutex);
+    for (const auto& [image, mountPoint] : m_mounts) {
+      unmount(mountPoint);
+    }
+    m_mounts.clear();
+  }
+
+private:
+  std::mutex m_mutex;
+  std::map<QString, QString> m_mounts;
+
+  // images already warned about in the sandbox
+  std::set<QString> m_sandboxed;
+};
+
+MountedImages& mountedImages()
+{
+  static MountedImages images;
+  return images;
+}
+
+}  // namespace
+
+bool modImagesSupported()
+{
+  if (isFlatpak()) {
+    return false;
+  }
+
+  const auto usable = [](const ImageTools& tools) {
+    return !tools.build.isEmpty() && !tools.mount.isEmpty();
+  };
+  return usable(erofsTools()) || usable(squashfsTools());
+}
+
+bool modImagesSandboxed()
+{
+  return isFlatpak();
+}
+
+QString modImagePath(const QString& modDirectory)
+{
+  for (const char* name : {ErofsName, SquashfsName}) {
+    QString path = modDirectory + "/" + name;
+    if (QFileInfo(path).isFile()) {
+      return path;
+    }
+  }
+  return {};
+}
+
+QString modFilesPath(const QString& path)
+{
+  if (const QString image = modImagePath(path); !image.isEmpty()) {
+    const QString mountPoint = mountedImages().get(path, image);
+    return mountPoint.isEmpty() ? path : mountPoint;
+  }
+
+  // the data directory of games that keep it in a subdirectory of mods
+  const QFileInfo info(path);
+  const QString modDirectory = info.path();
+  if (const QString image = modImagePath(modDirectory); !image.isEmpty()) {
+    const QString mountPoint = mountedImages().get(modDirectory, image);
+    return mountPoint.isEmpty() ? path : mountPoint + "/" + info.fileName();
+  }
+
+  return path;
+}
+
+bool packMod(const QString& modDirectory, QString& error)
+{
+  if (isFlatpak()) {
+    error = QObject::tr("mod images can't be mounted in the Flatpak sandbox");
+    return false;
+  }
+
+  if (!modImagePath(modDirectory).isEmpty()) {
+    error = QObject::tr("the mod is already packed");
+    return false;
+  }
+
+  ImageTools tools = erofsTools();
+  if (tools.build.isEmpty() || tools.mount.isEmpty()) {
+    tools = squashfsTools();
+  }
+  if (tools.build.isEmpty() || tools.mount.isEmpty()) {
+    error = QObject::tr("neither erofs-utils nor squashfs-tools and squashfuse are "
+                        "installed");
+    return false;
+  }
+
+  const auto files = listFiles(modDirectory);
+  if (files.empty()) {
+    error = QObject::tr("the mod has no files");
+    return false;
+  }
+
+  // built next to the mod so it isn't part of the image itself
+  const QFileInfo mod(modDirectory);
+  const bool erofs = tools.name == ErofsName;
+  const QString temp =
+      mod.dir().filePath("." + mod.fileName() + (erofs ? ".erofs.tmp" : ".sqsh.tmp"));
+  QFile::remove(temp);
+
+  QStringList args;
+  if (erofs) {
+    args = {"-zlz4hc", QString("--exclude-path=") + MetaName, temp, modDirectory};
+  } else {
+    args = {modDirectory, temp,     "-comp", "lz4", "-Xhc", "-noappend",
+            "-no-progress", "-quiet", "-e",  MetaName};
+  }
+
+  log::info("packing '{}' with {}", modDirectory, tools.build);
+  if (!run(tools.build, args, error)) {
+    QFile::remove(temp);
+    return false;
+  }
+
+  // the loose files are only removed once the image is known to have all of
+  // them
+  const QString check = mountRoot() + "/check-" + mod.fileName();
+  if (!mountImage(temp, check, error)) {
+    QFile::remove(temp);
+    return false;
+  }
+  const bool complete = listFiles(check) == files;
+  unmount(check);
+  QDir().rmdir(check);
+
+  if (!complete) {
+    error = QObject::tr("the image does not match the files of the mod");
+    QFile::remove(temp);
+    return false;
+  }
+
+  if (!QFile::rename(temp, modDirectory + "/" + tools.name)) {
+    error = QObject::tr("failed to move the image into the mod");
+    QFile::remove(temp);
+    return false;
+  }
+
+  const QDir dir(modDirectory);
+  for (const QFileInfo& info :
+       dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden |
+                         QDir::System)) {
+    const QString name = info.fileName();
+    if (name == MetaName || name == tools.name) {
+      continue;
+    }
+
+    const bool removed = info.isDir() && !info.isSymLink()
+                             ? QDir(info.filePath()).removeRecursively()
+                             : QFile::remove(info.filePath());
+    if (!removed) {
+      // the image still shadows whatever is left
+      log::warn("failed to remove '{}' after packing", info.filePath());
+    }
+  }
+
+  return true;
+}
+
+bool unpackMod(const QString& modDirectory, QString& error)
+{
+  const QString image = modImagePath(modDirectory);
+  if (image.isEmpty()) {
+    error = QObject::tr("the mod is not packed");
+    return false;
+  }
+
+  if (isFlatpak()) {
+    error = QObject::tr("mod images can't be mounted in the Flatpak sandbox");
+    return false;
+  }
+
+  const QString mountPoint = mountedImages().get(modDirectory, image);
+  if (mountPoint.isEmpty()) {
+    error = QObject::tr("failed to mount the image");
+    return false;
+  }
+
+  const auto files = listFiles(mountPoint);
+  const QDir from(mountPoint);
+
+  for (const auto& [relative, size] : files) {
+    const QString target = modDirectory + "/" + relative;
+    const bool copied    = size < 0 ? QDir().mkpath(target)
+                                    : QFile::copy(from.filePath(relative), target);
+    if (!copied) {
+      error = QObject::tr("failed to extract %1").arg(relative);
+      return false;
+    }
+  }
+
+  if (listFiles(modDirectory) != files) {
+    error = QObject::tr("the extracted files do not match the image");
+    return false;
+  }
+
+  mountedImages().release(image);
+  if (!QFile::remove(image)) {
+    error = QObject::tr("failed to remove the image");
+    return false;
+  }
+
+  return true;
+}
+
+void unmountModImages()
+{
+  mountedImages().releaseAll();
+}
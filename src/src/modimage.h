@@ -0,0 +1,55 @@
+#ifndef MODIMAGE_H
+#define MODIMAGE_H
+
+#include <QString>
+
+// Read-only compressed images of mods that never change.  A packed mod keeps
+// its meta.ini next to an image holding all of its other files, which is
+// mounted with a FUSE driver on first use; the directory structure and the
+// VFS read the files of the mod from the mount point instead of its
+// directory, so to them it's just another mod root.
+//
+// Images are EROFS if mkfs.erofs and erofsfuse are installed, SquashFS if
+// mksquashfs and squashfuse are, compressed with LZ4HC either way.  They're
+// unmounted with unmountModImages() when Mod Organizer shuts down.
+//
+// Inside the Flatpak sandbox FUSE can't be mounted, images are neither built
+// nor mounted there and the files of packed mods are missing.
+//
+// All functions are thread-safe.
+
+// whether images can be built and mounted on this system
+//
+bool modImagesSupported();
+
+// whether images are unavailable only because this runs in the Flatpak sandbox
+//
+bool modImagesSandboxed();
+
+// the image of the mod at `modDirectory`, empty if the mod isn't packed
+//
+QString modImagePath(const QString& modDirectory);
+
+// where the files at `path` are read from: the same path in the mounted image
+// if `path` is the directory of a packed mod or a directory right inside it,
+// `path` itself otherwise or if the image can't be mounted
+//
+QString modFilesPath(const QString& path);
+
+// replaces all the files of the mod at `modDirectory` but its meta.ini by an
+// image; the files are only removed once the image was checked to hold all of
+// them, the mod is left as it was if this returns false
+//
+bool packMod(const QString& modDirectory, QString& error);
+
+// extracts the image of the mod at `modDirectory` back into its directory and
+// removes the image
+//
+bool unpackMod(const QString& modDirectory, QString& error);
+
+// unmounts every image mounted so far; only once nothing reads from them
+// anymore, the VFS included
+//
+void unmountModImages();
+
+#endif  // MODIMAGE_H
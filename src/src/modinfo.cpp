@@ -26,8 +26,10 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "modinfoseparator.h"
 
 #include "categories.h"
+#include "modcontentscache.h"
 #include "modinfodialog.h"
 #include "modlist.h"
+#include "modmetacache.h"
 #include "organizercore.h"
 #include "overwriteinfodialog.h"
 #include "thread_utils.h"
@@ -38,6 +40,8 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <log.h>
 #include <report.h>
 #include <scriptextender.h>
+#include <memoryusage.h>
+#include <tracing.h>
 #include <unmanagedmods.h>
 #include <versioninfo.h>
 
@@ -52,7 +56,8 @@ using namespace MOShared;
 const std::set<unsigned int> ModInfo::s_EmptySet;
 std::vector<ModInfo::Ptr> ModInfo::s_Collection;
 ModInfo::Ptr ModInfo::s_Overwrite;
-std::map<QString, unsigned int, MOBase::FileNameComparator> ModInfo::s_ModsByName;
+std::unordered_map<QString, unsigned int, ModInfo::NameHash, ModInfo::NameEqual>
+    ModInfo::s_ModsByName;
 std::map<std::pair<QString, int>, std::vector<unsigned int>> ModInfo::s_ModsByModID;
 int ModInfo::s_NextID;
 QRecursiveMutex ModInfo::s_Mutex;
@@ -83,17 +88,18 @@ bool ModInfo::isRegularName(const QString& name)
   return !isSeparatorName(name) && !isBackupName(name);
 }
 
-ModInfo::Ptr ModInfo::createFrom(const QDir& dir, OrganizerCore& core)
+ModInfo::Ptr ModInfo::createFrom(const QDir& dir, OrganizerCore& core,
+                                 const QVariantMap* meta)
 {
   QMutexLocker locker(&s_Mutex);
   ModInfo::Ptr result;
 
   if (isBackupName(dir.dirName())) {
-    result = ModInfo::Ptr(new ModInfoBackup(dir, core));
+    result = ModInfo::Ptr(new ModInfoBackup(dir, core, meta));
   } else if (isSeparatorName(dir.dirName())) {
-    result = Ptr(new ModInfoSeparator(dir, core));
+    result = Ptr(new ModInfoSeparator(dir, core, meta));
   } else {
-    result = ModInfo::Ptr(new ModInfoRegular(dir, core));
+    result = ModInfo::Ptr(new ModInfoRegular(dir, core, meta));
   }
   result->m_Index = s_Collection.size();
   s_Collection.push_back(result);
@@ -213,7 +219,7 @@ unsigned int ModInfo::getIndex(const QString& name)
 {
   QMutexLocker locker(&s_Mutex);
 
-  std::map<QString, unsigned int>::iterator iter = s_ModsByName.find(name);
+  auto iter = s_ModsByName.find(name);
   if (iter == s_ModsByName.end()) {
     return UINT_MAX;
   }
@@ -249,10 +255,25 @@ void ModInfo::updateFromDisc(const QString& modsDirectory, OrganizerCore& core,
     }
     mods.setFilter(QDir::Dirs | QDir::NoDotAndDotDot);
     QDirIterator modIter(mods);
-    std::size_t managedCount = 0;
+    std::vector<std::pair<QString, QVariantMap>> modDirs;
     while (modIter.hasNext()) {
-      createFrom(QDir(modIter.next()), core);
-      ++managedCount;
+      modDirs.emplace_back(modIter.next(), QVariantMap());
+    }
+
+    // the meta files are parsed in parallel, but the mods are QObjects talking
+    // to the nexus interface so they're still created on this thread
+    const auto metaCache = sharedModMetaCache(core.settings().paths().overwrite());
+    parallelMap(
+        std::begin(modDirs), std::end(modDirs),
+        [&metaCache](auto& mod) {
+          mod.second = metaCache->get(mod.first + "/meta.ini");
+        },
+        refreshThreadCount);
+    metaCache->save();
+
+    const std::size_t managedCount = modDirs.size();
+    for (const auto& [path, meta] : modDirs) {
+      createFrom(QDir(path), core, &meta);
     }
     log::info("found {} managed mod directories in '{}'", managedCount, cleanModsDir);
     if (managedCount == 0 && mods.exists()) {
@@ -287,8 +308,25 @@ void ModInfo::updateFromDisc(const QString& modsDirectory, OrganizerCore& core,
 
   parallelMap(std::begin(s_Collection), std::end(s_Collection), &ModInfo::prefetch,
               refreshThreadCount);
+  sharedModContentsCache(core.settings().paths().overwrite())->save();
 
   updateIndices();
+  tracing::counter("mods", static_cast<qint64>(s_Collection.size()));
+  reportMemoryUsage();
+}
+
+void ModInfo::reportMemoryUsage()
+{
+  QMutexLocker locker(&s_Mutex);
+
+  std::size_t bytes =
+      memory::hashBytes(s_ModsByName) + memory::treeBytes(s_ModsByModID);
+  for (const auto& mod : s_Collection) {
+    bytes += mod->memoryUsage();
+  }
+
+  memory::report("mods", static_cast<qint64>(bytes),
+                 static_cast<qint64>(s_Collection.size()));
 }
 
 void ModInfo::updateIndices()
@@ -308,6 +346,11 @@ void ModInfo::updateIndices()
 
 ModInfo::ModInfo(OrganizerCore& core) : m_PrimaryCategory(-1), m_Core(core) {}
 
+std::size_t ModInfo::memoryUsage() const
+{
+  return sizeof(ModInfo) + memory::treeBytes(m_Categories);
+}
+
 bool ModInfo::checkAllForUpdate(PluginContainer* pluginContainer, QObject* receiver)
 {
   bool updatesAvailable = true;
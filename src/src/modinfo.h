@@ -34,11 +34,13 @@ class QDateTime;
 #include <QSharedPointer>
 #include <QString>
 #include <QStringList>
+#include <QVariantMap>
 
 #include <boost/function.hpp>
 
 #include <map>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 namespace MOBase
@@ -112,6 +114,31 @@ public:  // Type definitions:
     MOD_CC
   };
 
+  /**
+   * @brief What the conflict checks of all mods share, read once on the calling
+   *     thread so the checks running in parallel take no lock for it.
+   */
+  struct ConflictContext
+  {
+    // origins of the game's data directories, a file last provided by one of
+    // them doesn't conflict
+    std::vector<int> dataOrigins;
+
+    // index of the mod of every origin that is one
+    std::unordered_map<int, unsigned int> modsByOrigin;
+
+    /**
+     * @brief Read from the current directory structure, mods and game plugin; only on
+     *     the thread that owns them.
+     */
+    explicit ConflictContext(OrganizerCore& core);
+
+    /**
+     * @return the index of the mod of the given origin, UINT_MAX if it's none.
+     */
+    unsigned int modIndex(int originID) const;
+  };
+
 public:  // Static functions:
   /**
    * @brief Read the mod directory and Mod ModInfo objects for all subdirectories.
@@ -133,6 +160,11 @@ public:  // Static functions:
    */
   static unsigned int getNumMods();
 
+  /**
+   * @brief Report the estimated memory taken by all the mods, see MOBase::memory.
+   */
+  static void reportMemoryUsage();
+
   /**
    * @brief Retrieve a ModInfo object based on its index.
    *
@@ -640,6 +672,23 @@ public:  // Methods after this do not come from IModInterface:
    */
   virtual void clearCaches() {}
 
+  /**
+   * @brief Compute the conflicts of this mod with the current directory structure
+   *     if they're not known yet.
+   *
+   * Called for all the mods at once on multiple threads after a refresh, so the
+   * mod list doesn't compute them one by one while painting.
+   *
+   * @param context Shared by all the mods, read before.
+   */
+  virtual void prefetchConflicts(const ConflictContext& context) {}
+
+  /**
+   * @brief Estimate the memory taken by this mod and what it caches, other than its
+   *     file tree which is counted with all the file trees.
+   */
+  virtual std::size_t memoryUsage() const;
+
   /**
    * @brief Retrieve the internal name of the mod. This is usually the same as the
    * regular name, but with special mod types it might be used to distinguish between
@@ -825,6 +874,12 @@ public:  // Methods after this do not come from IModInterface:
    */
   virtual void saveMeta() {}
 
+  /**
+   * @brief Stores meta information back to disk with the next batch of the
+   *     MetaSaveQueue, on a worker thread.
+   */
+  virtual void saveMetaLater() {}
+
   /**
    * @brief Sets whether this mod uses a custom url.
    */
@@ -1026,10 +1081,13 @@ protected:
    * @brief Create a new mod from the specified directory and add it to the collection.
    *
    * @param dir Directory to create from.
+   * @param meta Values of the meta.ini of the mod if they were already read with
+   *     readIniValues(), the file is read otherwise.
    *
    * @return pointer to the info-structure of the newly created/added mod.
    */
-  static ModInfo::Ptr createFrom(const QDir& dir, OrganizerCore& core);
+  static ModInfo::Ptr createFrom(const QDir& dir, OrganizerCore& core,
+                                 const QVariantMap* meta = nullptr);
 
   /**
    * @brief Create a new "foreign-managed" mod from a tuple of plugin and archives.
@@ -1053,7 +1111,25 @@ protected:
   static QRecursiveMutex s_Mutex;
   static std::vector<ModInfo::Ptr> s_Collection;
   static ModInfo::Ptr s_Overwrite;
-  static std::map<QString, unsigned int, MOBase::FileNameComparator> s_ModsByName;
+  // names are looked up for every line of a mod list, so they're hashed;
+  // case-insensitive like MOBase::FileNameComparator
+  struct NameHash
+  {
+    std::size_t operator()(const QString& name) const
+    {
+      return qHash(name.toCaseFolded());
+    }
+  };
+
+  struct NameEqual
+  {
+    bool operator()(const QString& lhs, const QString& rhs) const
+    {
+      return lhs.compare(rhs, Qt::CaseInsensitive) == 0;
+    }
+  };
+
+  static std::unordered_map<QString, unsigned int, NameHash, NameEqual> s_ModsByName;
   static std::map<std::pair<QString, int>, std::vector<unsigned int>> s_ModsByModID;
   static int s_NextID;
 };
@@ -51,7 +51,7 @@ public:
   virtual void addInstalledFile(int, int) override {}
 
 private:
-  ModInfoBackup(const QDir& path, OrganizerCore& core);
+  ModInfoBackup(const QDir& path, OrganizerCore& core, const QVariantMap* meta);
 };
 
 #endif  // MODINFOBACKUP_H
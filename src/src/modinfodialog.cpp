@@ -32,6 +32,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "shared/filesorigin.h"
 #include "ui_modinfodialog.h"
 #include <filesystem>
+#include <set>
 
 using namespace MOBase;
 using namespace MOShared;
@@ -155,6 +156,56 @@ FileRenamer::RenameResults restoreHiddenFilesRecursive(FileRenamer& renamer,
   return results;
 }
 
+FileRenamer::RenameResults
+restoreHiddenFiles(FileRenamer& renamer, const FilesOrigin& origin,
+                   std::vector<std::pair<QString, QString>>& renamed)
+{
+  const QString root = QString::fromStdWString(origin.getPath());
+
+  // hidden files and the hidden directories the others are in
+  std::set<QString> paths;
+
+  for (const auto& file : origin.getHiddenFiles()) {
+    const QString relative =
+        QDir::fromNativeSeparators(QString::fromStdWString(file->getRelativePath()));
+
+    QString path = root;
+    for (const auto& part : relative.split('/', Qt::SkipEmptyParts)) {
+      path += "/" + part;
+      if (part.endsWith(ModInfo::s_HiddenExt, Qt::CaseInsensitive)) {
+        paths.insert(path);
+      }
+    }
+  }
+
+  // deepest first, so the paths that are left stay valid
+  std::vector<QString> sorted(paths.begin(), paths.end());
+  std::stable_sort(sorted.begin(), sorted.end(), [](auto&& a, auto&& b) {
+    return a.length() > b.length();
+  });
+
+  FileRenamer::RenameResults results = FileRenamer::RESULT_OK;
+
+  for (const auto& oldName : sorted) {
+    const QString newName =
+        oldName.left(oldName.length() - ModInfo::s_HiddenExt.length());
+
+    const auto partialResult = renamer.rename(oldName, newName);
+
+    if (partialResult == FileRenamer::RESULT_CANCEL) {
+      return FileRenamer::RESULT_CANCEL;
+    }
+
+    if (partialResult == FileRenamer::RESULT_SKIP) {
+      results = FileRenamer::RESULT_SKIP;
+    } else {
+      renamed.emplace_back(oldName, newName);
+    }
+  }
+
+  return results;
+}
+
 ModInfoDialog::TabInfo::TabInfo(std::unique_ptr<ModInfoDialogTab> tab)
     : tab(std::move(tab)), realPos(-1), widget(nullptr)
 {}
@@ -256,6 +307,11 @@ void ModInfoDialog::createTabs()
       onOriginModified(originID);
     });
 
+    // the structure is up to date already, only the tabs need it
+    connect(tabInfo.tab.get(), &ModInfoDialogTab::originRenamed, [this](int) {
+      updateTabs(true);
+    });
+
     connect(tabInfo.tab.get(), &ModInfoDialogTab::modOpen, [&](const QString& name) {
       setMod(name);
       update();
@@ -8,6 +8,8 @@
 #include "shared/filesorigin.h"
 #include "ui_modinfodialog.h"
 #include "utility.h"
+#include <QtConcurrent/QtConcurrentRun>
+#include <optional>
 
 using namespace MOShared;
 using namespace MOBase;
@@ -64,6 +66,139 @@ void forEachInSelection(QTreeView* tree, F&& f)
   }
 }
 
+const QString& ConflictSnapshot::nameOf(int id) const
+{
+  static const QString empty;
+
+  auto itor = originNames.find(id);
+  return (itor == originNames.end() ? empty : itor->second);
+}
+
+namespace
+{
+
+void appendName(QString& list, const QString& name)
+{
+  if (!list.isEmpty()) {
+    list += ", ";
+  }
+
+  list += name;
+}
+
+ConflictItem createOverwriteItem(const ConflictSnapshot& snapshot,
+                                 const ConflictSnapshot::File& file, QString fileName,
+                                 QString relativeName)
+{
+  QString altString;
+
+  for (const auto& alt : file.alternatives) {
+    appendName(altString, snapshot.nameOf(alt.origin));
+  }
+
+  auto origin = snapshot.nameOf(file.alternatives.back().origin);
+
+  return ConflictItem(std::move(altString), std::move(relativeName), QString(),
+                      file.index, std::move(fileName), true, std::move(origin),
+                      file.archive);
+}
+
+std::optional<ConflictItem> createAdvancedItem(const ConflictSnapshot& snapshot,
+                                               const ConflictSnapshot::File& file,
+                                               bool showAllAlts, bool showNoConflict)
+{
+  QString relativeName = QDir::fromNativeSeparators(ToQString(file.relativePath));
+  QString fileName     = snapshot.rootPath + relativeName;
+
+  const auto& alternatives = file.alternatives;
+
+  QString before, after;
+  bool isCurrOrigArchive = file.archive;
+
+  if (!alternatives.empty()) {
+    if (snapshot.origin == file.origin) {
+      // current origin is the active winner, all alternatives go in 'before'
+
+      if (showAllAlts) {
+        for (const auto& alt : alternatives) {
+          appendName(before, snapshot.nameOf(alt.origin));
+        }
+      } else {
+        // only add nearest, which is the last element of alternatives
+        before += snapshot.nameOf(alternatives.back().origin);
+      }
+
+    } else {
+      // current mod is one of the alternatives, find its position
+
+      auto currModIter = std::find_if(alternatives.begin(), alternatives.end(),
+                                      [&](auto const& alt) {
+                                        return snapshot.origin == alt.origin;
+                                      });
+
+      if (currModIter == alternatives.end()) {
+        log::error("Mod {} not found in the list of origins for file {}",
+                   snapshot.originName, fileName);
+        return {};
+      }
+
+      isCurrOrigArchive = currModIter->archive;
+
+      if (showAllAlts) {
+        // fills 'before' and 'after' with all the alternatives that come
+        // before and after the current mod, trusting the alternatives vector to be
+        // already sorted correctly
+
+        for (auto iter = alternatives.begin(); iter != alternatives.end(); iter++) {
+          if (iter < currModIter) {
+            // mod comes before current
+            appendName(before, snapshot.nameOf(iter->origin));
+          } else if (iter > currModIter) {
+            // mod comes after current
+            appendName(after, snapshot.nameOf(iter->origin));
+          }
+        }
+
+        // also add the active winner origin (the one outside alternatives) to 'after'
+        appendName(after, snapshot.nameOf(file.origin));
+
+      } else {
+        // only show nearest origins
+
+        // before
+        if (currModIter > alternatives.begin()) {
+          before += snapshot.nameOf((currModIter - 1)->origin);
+        }
+
+        // after
+        if (currModIter < (alternatives.end() - 1)) {
+          after += snapshot.nameOf((currModIter + 1)->origin);
+        } else {
+          // current mod is last of alternatives, so closest to the active winner
+
+          after += snapshot.nameOf(file.origin);
+        }
+      }
+    }
+  }
+
+  const bool hasAlts = !before.isEmpty() || !after.isEmpty();
+
+  if (!hasAlts) {
+    // if both before and after are empty, it means this file has no conflicts
+    // at all, only display it if the user wants it
+    if (!showNoConflict) {
+      return {};
+    }
+  }
+
+  return ConflictItem(std::move(before), std::move(relativeName), std::move(after),
+                      file.index, std::move(fileName), hasAlts, QString(),
+                      isCurrOrigArchive);
+}
+
+}  // namespace
+
 ConflictsTab::ConflictsTab(ModInfoDialogTabContext cx)
     : ModInfoDialogTab(cx),  // don't move, cx is used again
       m_general(this, cx.ui, cx.core), m_advanced(this, cx.ui, cx.core)
@@ -75,18 +210,71 @@ ConflictsTab::ConflictsTab(ModInfoDialogTabContext cx)
   connect(&m_advanced, &AdvancedConflictsTab::modOpen, [&](const QString& name) {
     emitModOpen(name);
   });
+
+  connect(&m_general, &GeneralConflictsTab::updated, [&](bool hasConflicts) {
+    setHasData(hasConflicts);
+  });
 }
 
 void ConflictsTab::update()
 {
-  setHasData(m_general.update());
+  updateSnapshot();
+  setHasData(false);
+  m_general.update();
   m_advanced.update();
 }
 
+void ConflictsTab::updateSnapshot()
+{
+  m_snapshot.reset();
+
+  if (origin() == nullptr) {
+    return;
+  }
+
+  const auto& ds = *core().directoryStructure();
+
+  auto snapshot        = std::make_shared<ConflictSnapshot>();
+  snapshot->origin     = origin()->getID();
+  snapshot->originName = ToQString(origin()->getName());
+  snapshot->rootPath   = mod().absolutePath();
+
+  const auto addName = [&](int id) {
+    if (!snapshot->originNames.contains(id)) {
+      snapshot->originNames.emplace(id, ToQString(ds.getOriginByID(id).getName()));
+    }
+  };
+
+  // hidden files don't conflict
+  const auto files = origin()->getVisibleFiles();
+  snapshot->files.reserve(files.size());
+
+  for (const auto& file : files) {
+    ConflictSnapshot::File f;
+    f.index        = file->getIndex();
+    f.relativePath = file->getRelativePath();
+    f.origin       = file->getOrigin(f.archive);
+    addName(f.origin);
+
+    const auto& alternatives = file->getAlternatives();
+    f.alternatives.reserve(alternatives.size());
+
+    for (const auto& alt : alternatives) {
+      f.alternatives.push_back({alt.originID(), alt.isFromArchive()});
+      addName(alt.originID());
+    }
+
+    snapshot->files.push_back(std::move(f));
+  }
+
+  m_snapshot = std::move(snapshot);
+}
+
 void ConflictsTab::clear()
 {
   m_general.clear();
   m_advanced.clear();
+  m_snapshot.reset();
   setHasData(false);
 }
 
@@ -113,8 +301,8 @@ bool ConflictsTab::canHandleUnmanaged() const
 
 void ConflictsTab::hideItems(QTreeView* tree)
 {
-  bool changed = false;
-  bool stop    = false;
+  std::vector<std::pair<QString, QString>> renames;
+  bool stop = false;
 
   const auto n = smallSelectionSize(tree);
 
@@ -165,8 +353,8 @@ void ConflictsTab::hideItems(QTreeView* tree)
 
     switch (result) {
     case FileRenamer::RESULT_OK: {
-      // will trigger a refresh at the end
-      changed = true;
+      // applied to the directory structure at the end
+      renames.emplace_back(item->fileName(), item->fileName() + ModInfo::s_HiddenExt);
       break;
     }
 
@@ -187,13 +375,8 @@ void ConflictsTab::hideItems(QTreeView* tree)
 
   log::debug("hiding conflict files done");
 
-  if (changed) {
-    log::debug("triggering refresh");
-
-    if (origin()) {
-      emitOriginModified();
-    }
-
+  if (!renames.empty()) {
+    emitOriginRenamed(renames);
     update();
   }
 }
@@ -557,10 +740,15 @@ GeneralConflictsTab::GeneralConflictsTab(ConflictsTab* tab, Ui::ModInfoDialog* p
                    [&](const QPoint& p) {
                      m_tab->showContextMenu(p, ui->noConflictTree);
                    });
+
+  QObject::connect(&m_watcher, &QFutureWatcherBase::finished, [&] {
+    onListsBuilt();
+  });
 }
 
 void GeneralConflictsTab::clear()
 {
+  ++m_generation;
   m_counts.clear();
 
   m_overwriteModel->clear();
@@ -592,165 +780,129 @@ void GeneralConflictsTab::restoreState(const Settings& s)
   s.geometry().restoreState(ui->overwrittenTree->header());
 }
 
-bool GeneralConflictsTab::update()
+struct GeneralConflictsTab::Lists
+{
+  int generation;
+  std::vector<ConflictItem> overwrite, overwritten, noConflict;
+  ConflictListModel::Sorting overwriteSorting, overwrittenSorting, noConflictSorting;
+  GeneralConflictNumbers counts;
+};
+
+void GeneralConflictsTab::update()
 {
   clear();
 
-  if (m_tab->origin() != nullptr) {
-    const auto rootPath = m_tab->mod().absolutePath();
-    std::set<const DirectoryEntry*> checkedDirs;
+  const auto snapshot = m_tab->snapshot();
+  if (!snapshot) {
+    updateUICounters();
+    emit updated(false);
+    return;
+  }
 
-    for (const auto& file : m_tab->origin()->getFiles()) {
-      if (QString::fromStdWString(file->getName())
-              .endsWith(ModInfo::s_HiddenExt, Qt::CaseInsensitive)) {
-        // skip hidden file conflicts
-        continue;
-      } else {
-        const DirectoryEntry* parent = file->getParent();
-        auto hidden                  = false;
-        // iterate on all parent directory entries to check for .mohiddden
-        while (parent != nullptr) {
-          auto insertResult = checkedDirs.insert(parent);
-
-          if (insertResult.second == false) {
-            // if already present break as we can assume to have checked the parents as
-            // well
-            break;
-          } else {
-            if (QString::fromStdWString(parent->getName())
-                    .endsWith(ModInfo::s_HiddenExt, Qt::CaseInsensitive)) {
-              hidden = true;
-              break;
-            }
-            parent = parent->getParent();
-          }
-        }
-        if (hidden) {
-          // skip hidden file conflicts
-          continue;
-        }
-      }
+  auto lists                = std::make_shared<Lists>();
+  lists->generation         = m_generation;
+  lists->overwriteSorting   = m_overwriteModel->sorting();
+  lists->overwrittenSorting = m_overwrittenModel->sorting();
+  lists->noConflictSorting  = m_noConflictModel->sorting();
 
-      // careful: these two strings are moved into createXItem() below
-      QString relativeName =
-          QDir::fromNativeSeparators(ToQString(file->getRelativePath()));
-      QString fileName = rootPath + relativeName;
+  // only copies go to the thread, so it can outlive the dialog
+  m_watcher.setFuture(QtConcurrent::run([snapshot, lists] {
+    TimeThis tt("GeneralConflictsTab::update()");
+    auto& counts = lists->counts;
 
-      bool archive         = false;
-      const int fileOrigin = file->getOrigin(archive);
+    for (const auto& file : snapshot->files) {
+      QString relativeName = QDir::fromNativeSeparators(ToQString(file.relativePath));
+      QString fileName     = snapshot->rootPath + relativeName;
 
-      ++m_counts.numTotalFiles;
+      ++counts.numTotalFiles;
 
-      const auto& alternatives = file->getAlternatives();
+      const auto& alternatives = file.alternatives;
 
-      if (fileOrigin == m_tab->origin()->getID()) {
+      if (file.origin == snapshot->origin) {
         // current mod is primary origin, the winner
-        (archive) ? ++m_counts.numTotalArchive : ++m_counts.numTotalLoose;
+        (file.archive) ? ++counts.numTotalArchive : ++counts.numTotalLoose;
 
         if (!alternatives.empty()) {
-          m_overwriteModel->add(
-              createOverwriteItem(file->getIndex(), archive, std::move(fileName),
-                                  std::move(relativeName), alternatives));
+          lists->overwrite.push_back(
+              createOverwriteItem(*snapshot, file, std::move(fileName),
+                                  std::move(relativeName)));
 
-          ++m_counts.numOverwrite;
-          if (archive) {
-            ++m_counts.numOverwriteArchive;
+          ++counts.numOverwrite;
+          if (file.archive) {
+            ++counts.numOverwriteArchive;
           } else {
-            ++m_counts.numOverwriteLoose;
+            ++counts.numOverwriteLoose;
           }
         } else {
           // otherwise, put the file in the noconflict tree
-          m_noConflictModel->add(createNoConflictItem(
-              file->getIndex(), archive, std::move(fileName), std::move(relativeName)));
+          lists->noConflict.push_back(ConflictItem(
+              QString(), std::move(relativeName), QString(), file.index,
+              std::move(fileName), false, QString(), file.archive));
 
-          ++m_counts.numNonConflicting;
-          if (archive) {
-            ++m_counts.numNonConflictingArchive;
+          ++counts.numNonConflicting;
+          if (file.archive) {
+            ++counts.numNonConflictingArchive;
           } else {
-            ++m_counts.numNonConflictingLoose;
+            ++counts.numNonConflictingLoose;
           }
         }
       } else {
-        auto currId     = m_tab->origin()->getID();
         auto currModAlt = std::find_if(alternatives.begin(), alternatives.end(),
-                                       [&currId](auto const& alt) {
-                                         return currId == alt.originID();
+                                       [&](auto const& alt) {
+                                         return snapshot->origin == alt.origin;
                                        });
 
         if (currModAlt == alternatives.end()) {
           log::error("Mod {} not found in the list of origins for file {}",
-                     m_tab->origin()->getName(), fileName);
+                     snapshot->originName, fileName);
           continue;
         }
 
-        bool currModFileArchive = currModAlt->isFromArchive();
+        const bool currModFileArchive = currModAlt->archive;
+
+        QString after     = snapshot->nameOf(file.origin);
+        QString altOrigin = after;
 
-        m_overwrittenModel->add(createOverwrittenItem(file->getIndex(), fileOrigin,
-                                                      archive, std::move(fileName),
-                                                      std::move(relativeName)));
+        lists->overwritten.push_back(ConflictItem(
+            QString(), std::move(relativeName), std::move(after), file.index,
+            std::move(fileName), true, std::move(altOrigin), file.archive));
 
-        ++m_counts.numOverwritten;
+        ++counts.numOverwritten;
         if (currModFileArchive) {
-          ++m_counts.numOverwrittenArchive;
-          ++m_counts.numTotalArchive;
+          ++counts.numOverwrittenArchive;
+          ++counts.numTotalArchive;
         } else {
-          ++m_counts.numOverwrittenLoose;
-          ++m_counts.numTotalLoose;
+          ++counts.numOverwrittenLoose;
+          ++counts.numTotalLoose;
         }
       }
     }
 
-    m_overwriteModel->finished();
-    m_overwrittenModel->finished();
-    m_noConflictModel->finished();
-  }
+    lists->overwriteSorting.sort(lists->overwrite);
+    lists->overwrittenSorting.sort(lists->overwritten);
+    lists->noConflictSorting.sort(lists->noConflict);
 
-  updateUICounters();
-
-  return (m_counts.numOverwrite > 0 || m_counts.numOverwritten > 0);
+    return lists;
+  }));
 }
 
-ConflictItem GeneralConflictsTab::createOverwriteItem(
-    FileIndex index, bool archive, QString fileName, QString relativeName,
-    const MOShared::AlternativesVector& alternatives)
+void GeneralConflictsTab::onListsBuilt()
 {
-  const auto& ds = *m_core.directoryStructure();
-  std::wstring altString;
-
-  for (const auto& alt : alternatives) {
-    if (!altString.empty()) {
-      altString += L", ";
-    }
-
-    altString += ds.getOriginByID(alt.originID()).getName();
+  const auto lists = m_watcher.result();
+  if (!lists || lists->generation != m_generation) {
+    return;
   }
 
-  auto origin = ToQString(ds.getOriginByID(alternatives.back().originID()).getName());
-
-  return ConflictItem(ToQString(altString), std::move(relativeName), QString(), index,
-                      std::move(fileName), true, std::move(origin), archive);
-}
-
-ConflictItem GeneralConflictsTab::createNoConflictItem(FileIndex index, bool archive,
-                                                       QString fileName,
-                                                       QString relativeName)
-{
-  return ConflictItem(QString(), std::move(relativeName), QString(), index,
-                      std::move(fileName), false, QString(), archive);
-}
+  m_counts = lists->counts;
 
-ConflictItem GeneralConflictsTab::createOverwrittenItem(FileIndex index, int fileOrigin,
-                                                        bool archive, QString fileName,
-                                                        QString relativeName)
-{
-  const auto& ds                = *m_core.directoryStructure();
-  const FilesOrigin& realOrigin = ds.getOriginByID(fileOrigin);
+  m_overwriteModel->setItems(std::move(lists->overwrite), lists->overwriteSorting);
+  m_overwrittenModel->setItems(std::move(lists->overwritten),
+                               lists->overwrittenSorting);
+  m_noConflictModel->setItems(std::move(lists->noConflict), lists->noConflictSorting);
 
-  QString after     = ToQString(realOrigin.getName());
-  QString altOrigin = after;
+  updateUICounters();
 
-  return ConflictItem(QString(), std::move(relativeName), std::move(after), index,
-                      std::move(fileName), true, std::move(altOrigin), archive);
+  emit updated(m_counts.numOverwrite > 0 || m_counts.numOverwritten > 0);
 }
 
 QString percent(int a, int b)
@@ -918,10 +1070,15 @@ AdvancedConflictsTab::AdvancedConflictsTab(ConflictsTab* tab, Ui::ModInfoDialog*
                    [&](const QPoint& p) {
                      m_tab->showContextMenu(p, ui->conflictsAdvancedList);
                    });
+
+  QObject::connect(&m_watcher, &QFutureWatcherBase::finished, [&] {
+    onItemsBuilt();
+  });
 }
 
 void AdvancedConflictsTab::clear()
 {
+  ++m_generation;
   m_model->clear();
 }
 
@@ -941,190 +1098,53 @@ void AdvancedConflictsTab::restoreState(const Settings& s)
   s.widgets().restoreChecked(ui->conflictsAdvancedShowNearest);
 }
 
+struct AdvancedConflictsTab::Items
+{
+  int generation;
+  std::vector<ConflictItem> items;
+  ConflictListModel::Sorting sorting;
+};
+
 void AdvancedConflictsTab::update()
 {
   clear();
 
-  if (m_tab->origin() != nullptr) {
-    const auto rootPath = m_tab->mod().absolutePath();
+  const auto snapshot = m_tab->snapshot();
+  if (!snapshot) {
+    return;
+  }
 
-    const auto& files = m_tab->origin()->getFiles();
-    m_model->reserve(files.size());
-    std::set<const DirectoryEntry*> checkedDirs;
+  auto items        = std::make_shared<Items>();
+  items->generation = m_generation;
+  items->sorting    = m_model->sorting();
 
-    for (const auto& file : files) {
-      if (QString::fromStdWString(file->getName())
-              .endsWith(ModInfo::s_HiddenExt, Qt::CaseInsensitive)) {
-        // skip hidden file conflicts
-        continue;
-      } else {
-        const DirectoryEntry* parent = file->getParent();
-        auto hidden                  = false;
-        // iterate on all parent directory entries to check for .mohiddden
-        while (parent != nullptr) {
-          auto insertResult = checkedDirs.insert(parent);
-
-          if (insertResult.second == false) {
-            // if already present break as we can assume to have checked the parents as
-            // well
-            break;
-          } else {
-            if (QString::fromStdWString(parent->getName())
-                    .endsWith(ModInfo::s_HiddenExt, Qt::CaseInsensitive)) {
-              hidden = true;
-              break;
-            }
-            parent = parent->getParent();
-          }
-        }
-        if (hidden) {
-          // skip hidden file conflicts
-          continue;
-        }
-      }
-      // careful: these two strings are moved into createItem() below
-      QString relativeName =
-          QDir::fromNativeSeparators(ToQString(file->getRelativePath()));
-      QString fileName = rootPath + relativeName;
+  const bool showAll        = ui->conflictsAdvancedShowAll->isChecked();
+  const bool showNoConflict = ui->conflictsAdvancedShowNoConflict->isChecked();
 
-      bool archive             = false;
-      const int fileOrigin     = file->getOrigin(archive);
-      const auto& alternatives = file->getAlternatives();
+  // only copies go to the thread, so it can outlive the dialog
+  m_watcher.setFuture(QtConcurrent::run([snapshot, items, showAll, showNoConflict] {
+    TimeThis tt("AdvancedConflictsTab::update()");
+    items->items.reserve(snapshot->files.size());
 
-      auto item = createItem(file->getIndex(), fileOrigin, archive, std::move(fileName),
-                             std::move(relativeName), alternatives);
+    for (const auto& file : snapshot->files) {
+      auto item = createAdvancedItem(*snapshot, file, showAll, showNoConflict);
 
       if (item) {
-        m_model->add(std::move(*item));
+        items->items.push_back(std::move(*item));
       }
     }
 
-    m_model->finished();
-  }
+    items->sorting.sort(items->items);
+    return items;
+  }));
 }
 
-std::optional<ConflictItem>
-AdvancedConflictsTab::createItem(FileIndex index, int fileOrigin, bool archive,
-                                 QString fileName, QString relativeName,
-                                 const MOShared::AlternativesVector& alternatives)
+void AdvancedConflictsTab::onItemsBuilt()
 {
-  const auto& ds = *m_core.directoryStructure();
-
-  std::wstring before, after;
-
-  auto currOrigin        = m_tab->origin();
-  bool isCurrOrigArchive = archive;
-
-  if (!alternatives.empty()) {
-    const bool showAllAlts = ui->conflictsAdvancedShowAll->isChecked();
-
-    if (currOrigin->getID() == fileOrigin) {
-      // current origin is the active winner, all alternatives go in 'before'
-
-      if (showAllAlts) {
-        for (const auto& alt : alternatives) {
-          const auto& altOrigin = ds.getOriginByID(alt.originID());
-          if (!before.empty()) {
-            before += L", ";
-          }
-
-          before += altOrigin.getName();
-        }
-      } else {
-        // only add nearest, which is the last element of alternatives
-        const auto& altOrigin = ds.getOriginByID(alternatives.back().originID());
-
-        before += altOrigin.getName();
-      }
-
-    } else {
-      // current mod is one of the alternatives, find its position
-
-      auto currOrgId = currOrigin->getID();
-
-      auto currModIter = std::find_if(alternatives.begin(), alternatives.end(),
-                                      [&currOrgId](auto const& alt) {
-                                        return currOrgId == alt.originID();
-                                      });
-
-      if (currModIter == alternatives.end()) {
-        log::error("Mod {} not found in the list of origins for file {}",
-                   currOrigin->getName(), fileName);
-        return {};
-      }
-
-      isCurrOrigArchive = currModIter->isFromArchive();
-
-      if (showAllAlts) {
-        // fills 'before' and 'after' with all the alternatives that come
-        // before and after the current mod, trusting the alternatives vector to be
-        // already sorted correctly
-
-        for (auto iter = alternatives.begin(); iter != alternatives.end(); iter++) {
-
-          const auto& altOrigin = ds.getOriginByID(iter->originID());
-
-          if (iter < currModIter) {
-            // mod comes before current
-
-            if (!before.empty()) {
-              before += L", ";
-            }
-
-            before += altOrigin.getName();
-          } else if (iter > currModIter) {
-            // mod comes after current
-
-            if (!after.empty()) {
-              after += L", ";
-            }
-
-            after += altOrigin.getName();
-          }
-        }
-
-        // also add the active winner origin (the one outside alternatives) to 'after'
-        if (!after.empty()) {
-          after += L", ";
-        }
-        after += ds.getOriginByID(fileOrigin).getName();
-
-      } else {
-        // only show nearest origins
-
-        // before
-        if (currModIter > alternatives.begin()) {
-          auto previousOrigId = (currModIter - 1)->originID();
-          before += ds.getOriginByID(previousOrigId).getName();
-        }
-
-        // after
-        if (currModIter < (alternatives.end() - 1)) {
-          auto followingOrigId = (currModIter + 1)->originID();
-          after += ds.getOriginByID(followingOrigId).getName();
-        } else {
-          // current mod is last of alternatives, so closest to the active winner
-
-          after += ds.getOriginByID(fileOrigin).getName();
-        }
-      }
-    }
-  }
-
-  const bool hasAlts = !before.empty() || !after.empty();
-
-  if (!hasAlts) {
-    // if both before and after are empty, it means this file has no conflicts
-    // at all, only display it if the user wants it
-    if (!ui->conflictsAdvancedShowNoConflict->isChecked()) {
-      return {};
-    }
+  const auto items = m_watcher.result();
+  if (!items || items->generation != m_generation) {
+    return;
   }
 
-  auto beforeQS = QString::fromStdWString(before);
-  auto afterQS  = QString::fromStdWString(after);
-
-  return ConflictItem(std::move(beforeQS), std::move(relativeName), std::move(afterQS),
-                      index, std::move(fileName), hasAlts, QString(),
-                      isCurrOrigArchive);
+  m_model->setItems(std::move(items->items), items->sorting);
 }
@@ -5,8 +5,11 @@
 #include "filterwidget.h"
 #include "modinfodialogtab.h"
 #include "shared/fileregisterfwd.h"
+#include <QFutureWatcher>
 #include <QTreeWidget>
-#include <optional>
+#include <map>
+#include <memory>
+#include <vector>
 
 using namespace MOBase;
 
@@ -15,6 +18,39 @@ class OrganizerCore;
 class ConflictItem;
 class ConflictListModel;
 
+// the files of a mod and where they come from, copied from the directory
+// structure so the conflict lists can be built on a thread
+//
+struct ConflictSnapshot
+{
+  struct Alternative
+  {
+    int origin;
+    bool archive;
+  };
+
+  struct File
+  {
+    MOShared::FileIndex index;
+    std::wstring relativePath;
+    int origin;
+    bool archive;
+    std::vector<Alternative> alternatives;
+  };
+
+  // the mod
+  int origin = -1;
+  QString originName;
+  QString rootPath;
+
+  std::vector<File> files;
+
+  // names of all the origins of the files and their alternatives
+  std::map<int, QString> originNames;
+
+  const QString& nameOf(int id) const;
+};
+
 class GeneralConflictsTab : public QObject
 {
   Q_OBJECT;
@@ -26,12 +62,17 @@ public:
   void saveState(Settings& s);
   void restoreState(const Settings& s);
 
-  bool update();
+  // builds the lists on a thread, emits updated() when they're shown
+  //
+  void update();
 
 signals:
   void modOpen(QString name);
+  void updated(bool hasConflicts);
 
 private:
+  struct Lists;
+
   struct Expanders
   {
     MOBase::ExpanderWidget overwrite, overwritten, nonconflict;
@@ -70,17 +111,12 @@ private:
 
   GeneralConflictNumbers m_counts;
 
-  ConflictItem createOverwriteItem(MOShared::FileIndex index, bool archive,
-                                   QString fileName, QString relativeName,
-                                   const MOShared::AlternativesVector& alternatives);
-
-  ConflictItem createNoConflictItem(MOShared::FileIndex index, bool archive,
-                                    QString fileName, QString relativeName);
-
-  ConflictItem createOverwrittenItem(MOShared::FileIndex index, int fileOrigin,
-                                     bool archive, QString fileName,
-                                     QString relativeName);
+  // results of an update() that was superseded by clear() or another update()
+  // are dropped
+  int m_generation = 0;
+  QFutureWatcher<std::shared_ptr<Lists>> m_watcher;
 
+  void onListsBuilt();
   void updateUICounters();
 
   void onOverwriteActivated(const QModelIndex& index);
@@ -98,21 +134,27 @@ public:
   void saveState(Settings& s);
   void restoreState(const Settings& s);
 
+  // builds the list on a thread from the current snapshot, which is also done
+  // when the options change
+  //
   void update();
 
 signals:
   void modOpen(QString name);
 
 private:
+  struct Items;
+
   ConflictsTab* m_tab;
   Ui::ModInfoDialog* ui;
   OrganizerCore& m_core;
   FilterWidget m_filter;
   ConflictListModel* m_model;
 
-  std::optional<ConflictItem>
-  createItem(MOShared::FileIndex index, int fileOrigin, bool archive, QString fileName,
-             QString relativeName, const MOShared::AlternativesVector& alternatives);
+  int m_generation = 0;
+  QFutureWatcher<std::shared_ptr<Items>> m_watcher;
+
+  void onItemsBuilt();
 };
 
 class ConflictsTab : public ModInfoDialogTab
@@ -139,6 +181,10 @@ public:
 
   void showContextMenu(const QPoint& pos, QTreeView* tree);
 
+  // files of the mod that aren't hidden, collected once per update() for both
+  // tabs; null if there's no origin
+  std::shared_ptr<const ConflictSnapshot> snapshot() const { return m_snapshot; }
+
 private:
   struct Actions
   {
@@ -154,6 +200,9 @@ private:
 
   GeneralConflictsTab m_general;
   AdvancedConflictsTab m_advanced;
+  std::shared_ptr<const ConflictSnapshot> m_snapshot;
+
+  void updateSnapshot();
 
   Actions createMenuActions(QTreeView* tree);
   std::vector<QAction*> createGotoActions(const ConflictItem* item);
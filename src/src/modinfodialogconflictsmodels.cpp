@@ -2,7 +2,7 @@
 #include "modinfodialog.h"
 #include <utility.h>
 
-using MOBase::naturalCompare;
+#include <QCollator>
 
 ConflictItem::ConflictItem(QString before, QString relativeName, QString after,
                            MOShared::FileIndex index, QString fileName,
@@ -97,11 +97,6 @@ void ConflictListModel::clear()
   endResetModel();
 }
 
-void ConflictListModel::reserve(std::size_t s)
-{
-  m_items.reserve(s);
-}
-
 QModelIndex ConflictListModel::index(int row, int col, const QModelIndex&) const
 {
   return createIndex(row, col);
@@ -235,17 +230,33 @@ void ConflictListModel::sort(int colIndex, Qt::SortOrder order)
   emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
 }
 
-void ConflictListModel::add(ConflictItem item)
+ConflictListModel::Sorting ConflictListModel::sorting() const
 {
-  m_items.emplace_back(std::move(item));
+  Sorting s;
+  s.order = m_sortOrder;
+
+  if (m_sortColumn >= 0) {
+    const auto c = static_cast<std::size_t>(m_sortColumn);
+    if (c < m_columns.size()) {
+      s.column  = m_sortColumn;
+      s.getText = m_columns[c].getText;
+    }
+  }
+
+  return s;
 }
 
-void ConflictListModel::finished()
+void ConflictListModel::setItems(std::vector<ConflictItem> items, const Sorting& s)
 {
   beginResetModel();
+  m_items = std::move(items);
   endResetModel();
 
-  sort(m_sortColumn, m_sortOrder);
+  const auto current = sorting();
+  if (current.column != s.column || current.order != s.order) {
+    // the header was clicked while the items were being built
+    sort(m_sortColumn, m_sortOrder);
+  }
 }
 
 const ConflictItem* ConflictListModel::getItem(std::size_t row) const
@@ -259,35 +270,51 @@ const ConflictItem* ConflictListModel::getItem(std::size_t row) const
 
 void ConflictListModel::doSort()
 {
-  if (m_items.empty()) {
-    return;
-  }
+  sorting().sort(m_items);
+}
 
-  if (m_sortColumn < 0) {
+void ConflictListModel::Sorting::sort(std::vector<ConflictItem>& items) const
+{
+  if (items.empty() || getText == nullptr) {
     return;
   }
 
-  const auto c = static_cast<std::size_t>(m_sortColumn);
-  if (c >= m_columns.size()) {
-    return;
-  }
+  // same as naturalCompare(), but the collator is local so this can run on
+  // any thread, and sort keys are much cheaper to compare than the strings
+  QCollator collator;
+  collator.setNumericMode(true);
+  collator.setCaseSensitivity(Qt::CaseInsensitive);
 
-  const auto& col = m_columns[c];
+  std::vector<std::pair<QCollatorSortKey, std::size_t>> keys;
+  keys.reserve(items.size());
+
+  for (std::size_t i = 0; i < items.size(); ++i) {
+    keys.emplace_back(collator.sortKey((items[i].*getText)()), i);
+  }
 
   // avoids branching on sort order while sorting
   auto sortAsc = [&](const auto& a, const auto& b) {
-    return (naturalCompare((a.*col.getText)(), (b.*col.getText)()) < 0);
+    return (a.first.compare(b.first) < 0);
   };
 
   auto sortDesc = [&](const auto& a, const auto& b) {
-    return (naturalCompare((a.*col.getText)(), (b.*col.getText)()) > 0);
+    return (a.first.compare(b.first) > 0);
   };
 
-  if (m_sortOrder == Qt::AscendingOrder) {
-    std::sort(m_items.begin(), m_items.end(), sortAsc);
+  if (order == Qt::AscendingOrder) {
+    std::sort(keys.begin(), keys.end(), sortAsc);
   } else {
-    std::sort(m_items.begin(), m_items.end(), sortDesc);
+    std::sort(keys.begin(), keys.end(), sortDesc);
   }
+
+  std::vector<ConflictItem> sorted;
+  sorted.reserve(items.size());
+
+  for (const auto& key : keys) {
+    sorted.push_back(std::move(items[key.second]));
+  }
+
+  items = std::move(sorted);
 }
 
 OverwriteConflictListModel::OverwriteConflictListModel(QTreeView* tree)
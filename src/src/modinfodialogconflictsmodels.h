@@ -50,10 +50,21 @@ public:
     const QString& (ConflictItem::*getText)() const;
   };
 
+  // how the items are sorted; copied so items can be sorted on a thread before
+  // they're handed to setItems()
+  //
+  struct Sorting
+  {
+    int column = -1;
+    const QString& (ConflictItem::*getText)() const = nullptr;
+    Qt::SortOrder order = Qt::AscendingOrder;
+
+    void sort(std::vector<ConflictItem>& items) const;
+  };
+
   ConflictListModel(QTreeView* tree, std::vector<Column> columns);
 
   void clear();
-  void reserve(std::size_t s);
 
   QModelIndex index(int row, int col, const QModelIndex& = {}) const override;
   QModelIndex parent(const QModelIndex&) const override;
@@ -63,9 +74,13 @@ public:
   QVariant headerData(int col, Qt::Orientation, int role) const;
 
   void sort(int colIndex, Qt::SortOrder order = Qt::AscendingOrder);
-  void add(ConflictItem item);
 
-  void finished();
+  Sorting sorting() const;
+
+  // replaces all the items, which were sorted with `s`; they're sorted again if
+  // the sort order of the model changed since
+  //
+  void setItems(std::vector<ConflictItem> items, const Sorting& s);
 
   const ConflictItem* getItem(std::size_t row) const;
 
@@ -341,8 +341,8 @@ void FileTreeTab::changeVisibility(bool visible)
 {
   const auto selection = ui->filetree->selectionModel()->selectedRows();
 
-  bool changed = false;
-  bool stop    = false;
+  std::vector<std::pair<QString, QString>> renames;
+  bool stop = false;
 
   log::debug("{} {} filetree files", (visible ? "unhiding" : "hiding"),
              selection.size());
@@ -380,8 +380,10 @@ void FileTreeTab::changeVisibility(bool visible)
 
     switch (result) {
     case FileRenamer::RESULT_OK: {
-      // will trigger a refresh at the end
-      changed = true;
+      // applied to the directory structure at the end
+      renames.emplace_back(
+          path, visible ? path.left(path.length() - ModInfo::s_HiddenExt.length())
+                        : path + ModInfo::s_HiddenExt);
       break;
     }
 
@@ -400,10 +402,8 @@ void FileTreeTab::changeVisibility(bool visible)
 
   log::debug("{} filetree files done", (visible ? "unhiding" : "hiding"));
 
-  if (changed) {
-    if (origin()) {
-      emitOriginModified();
-    }
+  if (!renames.empty()) {
+    emitOriginRenamed(renames);
   }
 }
 
@@ -4,6 +4,14 @@
 #include "filerenamer.h"
 #include <QStyledItemDelegate>
 
+#include <utility>
+#include <vector>
+
+namespace MOShared
+{
+class FilesOrigin;
+}
+
 class ModInfo;
 using ModInfoPtr = QSharedPointer<ModInfo>;
 
@@ -36,6 +44,15 @@ FileRenamer::RenameResults unhideFile(FileRenamer& renamer, const QString& oldNa
 FileRenamer::RenameResults restoreHiddenFilesRecursive(FileRenamer& renamer,
                                                        const QString& targetDir);
 
+// same as restoreHiddenFilesRecursive() for the directory of `origin`, but the
+// hidden files are taken from the directory structure instead of listing it;
+// the renames that were done are added to `renamed`, see
+// OrganizerCore::applyModRenames()
+//
+FileRenamer::RenameResults
+restoreHiddenFiles(FileRenamer& renamer, const MOShared::FilesOrigin& origin,
+                   std::vector<std::pair<QString, QString>>& renamed);
+
 class ElideLeftDelegate : public QStyledItemDelegate
 {
 public:
@@ -4,6 +4,10 @@
 #include "utility.h"
 #include <log.h>
 
+#include <QCryptographicHash>
+#include <QSaveFile>
+#include <QStandardPaths>
+
 using namespace MOBase;
 using namespace ImagesTabHelpers;
 
@@ -33,7 +37,10 @@ QString dimensionString(const QSize& s)
 
 ImagesTab::ImagesTab(ModInfoDialogTabContext cx)
     : ModInfoDialogTab(std::move(cx)), m_image(new ScalableImage),
-      m_ddsAvailable(false), m_ddsEnabled(false)
+      m_ddsAvailable(false), m_ddsEnabled(false),
+      m_thumbnails(this, [this](ThumbnailLoader::Result r) {
+        onThumbnailLoaded(std::move(r));
+      })
 {
   getSupportedFormats();
 
@@ -103,6 +110,7 @@ ImagesTab::ImagesTab(ModInfoDialogTabContext cx)
 
 void ImagesTab::clear()
 {
+  m_thumbnails.reset();
   m_files.clear();
   ui->imagesScrollerVBar->setValue(0);
   select(BadIndex);
@@ -419,6 +427,17 @@ void ImagesTab::paintThumbnailsArea(QPaintEvent* e)
 
     paintThumbnail(cx);
   }
+
+  // the next page is loaded ahead so scrolling down doesn't show empty
+  // thumbnails
+  for (std::size_t i = 0; i < visible; ++i) {
+    auto* file = m_files.get(first + visible + i);
+    if (!file) {
+      break;
+    }
+
+    requestThumbnail(*file, cx.geo, 0, 0);
+  }
 }
 
 void ImagesTab::paintThumbnail(const PaintContext& cx)
@@ -452,12 +471,13 @@ void ImagesTab::paintThumbnailBorder(const PaintContext& cx)
 
 void ImagesTab::paintThumbnailImage(const PaintContext& cx)
 {
-  if (cx.file->failed()) {
+  requestThumbnail(*cx.file, cx.geo, cx.thumbIndex, 1);
+
+  if (cx.file->thumbnail().isNull()) {
+    // still loading
     return;
   }
 
-  cx.file->loadIfNeeded(cx.geo);
-
   const auto imageRect       = cx.geo.imageRect(cx.thumbIndex);
   const auto scaledThumbRect = centeredRect(imageRect, cx.file->thumbnail().size());
 
@@ -465,6 +485,52 @@ void ImagesTab::paintThumbnailImage(const PaintContext& cx)
   cx.painter.drawImage(scaledThumbRect, cx.file->thumbnail());
 }
 
+void ImagesTab::requestThumbnail(File& f, const Geometry& geo, std::size_t thumbIndex,
+                                 int priority)
+{
+  if (!f.needsThumbnail(geo)) {
+    return;
+  }
+
+  const auto& all = m_files.allFiles();
+  f.setPending();
+  m_thumbnails.request(static_cast<std::size_t>(&f - all.data()), f.path(),
+                       geo.imageRect(thumbIndex).size(), priority);
+}
+
+void ImagesTab::onThumbnailLoaded(ThumbnailLoader::Result r)
+{
+  auto& all = m_files.allFiles();
+  if (r.index >= all.size()) {
+    return;
+  }
+
+  auto& f = all[r.index];
+
+  if (r.failed) {
+    const QImage warning(":/MO/gui/warning");
+    const auto scaledSize = resizeWithAspectRatio(warning.size(), r.box);
+
+    f.setFailed(
+        warning.scaled(scaledSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+  } else {
+    f.setThumbnail(std::move(r.thumbnail), r.originalSize);
+  }
+
+  ui->imagesThumbnails->update();
+}
+
+void ImagesTab::resetThumbnailRequests()
+{
+  // whatever was queued for the thumbnails that scrolled away is dropped, the
+  // visible ones are requested again when painting
+  m_thumbnails.reset();
+
+  for (auto& f : m_files.allFiles()) {
+    f.resetPending();
+  }
+}
+
 void ImagesTab::paintThumbnailText(const PaintContext& cx)
 {
   const auto tr = cx.geo.textRect(cx.thumbIndex);
@@ -555,6 +621,7 @@ bool ImagesTab::thumbnailAreaKeyPressEvent(QKeyEvent* e)
 
 void ImagesTab::onScrolled()
 {
+  resetThumbnailRequests();
   ui->imagesThumbnails->update();
 }
 
@@ -569,7 +636,7 @@ void ImagesTab::showTooltip(QHelpEvent* e)
 
   const auto s = QString("%1 (%2)")
                      .arg(QDir::toNativeSeparators(f->path()))
-                     .arg(dimensionString(f->original().size()));
+                     .arg(dimensionString(f->originalSize()));
 
   QToolTip::showText(e->globalPos(), s, ui->imagesThumbnails);
 }
@@ -882,7 +949,127 @@ QSize Geometry::scaledImageSize(const QSize& originalSize) const
   return resizeWithAspectRatio(originalSize, availableSize);
 }
 
-File::File(QString path) : m_path(std::move(path)), m_failed(false) {}
+ThumbnailLoader::ThumbnailLoader(QObject* receiver, Callback callback)
+    : m_receiver(receiver), m_callback(std::move(callback)), m_generation(0)
+{}
+
+ThumbnailLoader::~ThumbnailLoader()
+{
+  m_pool.clear();
+  m_pool.waitForDone();
+}
+
+void ThumbnailLoader::reset()
+{
+  ++m_generation;
+  m_pool.clear();
+}
+
+void ThumbnailLoader::request(std::size_t index, const QString& path, const QSize& box,
+                              int priority)
+{
+  const int generation = m_generation;
+
+  m_pool.start(
+      [this, index, path, box, generation] {
+        if (generation != m_generation) {
+          return;
+        }
+
+        Result r = load(path, box);
+        r.index  = index;
+
+        QMetaObject::invokeMethod(
+            m_receiver,
+            [this, generation, r = std::move(r)]() mutable {
+              // the files may have changed since
+              if (generation == m_generation) {
+                m_callback(std::move(r));
+              }
+            },
+            Qt::QueuedConnection);
+      },
+      priority);
+}
+
+ThumbnailLoader::Result ThumbnailLoader::load(const QString& path, const QSize& box)
+{
+  Result r;
+  r.box = box;
+
+  const QFileInfo fi(path);
+  const QString cache = cachePath(fi, box);
+
+  QImage cached;
+  if (cached.load(cache, "PNG")) {
+    const auto size = cached.text("OriginalSize").split('x');
+    if (size.size() == 2) {
+      r.originalSize = QSize(size[0].toInt(), size[1].toInt());
+      r.thumbnail    = std::move(cached);
+      return r;
+    }
+  }
+
+  QImageReader reader(path);
+  const QSize size = reader.size();
+
+  // formats that can decode at a lower resolution, like jpeg, skip most of the
+  // work
+  if (size.isValid() && reader.supportsOption(QImageIOHandler::ScaledSize)) {
+    reader.setScaledSize(resizeWithAspectRatio(size, box));
+  }
+
+  QImage image;
+  if (!reader.read(&image)) {
+    log::error("failed to load '{}'\n{} (error {})", path, reader.errorString(),
+               static_cast<int>(reader.error()));
+
+    r.failed = true;
+    return r;
+  }
+
+  r.originalSize        = size.isValid() ? size : image.size();
+  const auto scaledSize = resizeWithAspectRatio(r.originalSize, box);
+
+  r.thumbnail = image.size() == scaledSize
+                    ? std::move(image)
+                    : image.scaled(scaledSize, Qt::IgnoreAspectRatio,
+                                   Qt::SmoothTransformation);
+
+  r.thumbnail.setText("OriginalSize", QString("%1x%2")
+                                          .arg(r.originalSize.width())
+                                          .arg(r.originalSize.height()));
+
+  QDir().mkpath(QFileInfo(cache).path());
+
+  QSaveFile file(cache);
+  if (!file.open(QIODevice::WriteOnly) || !r.thumbnail.save(&file, "PNG") ||
+      !file.commit()) {
+    log::debug("failed to cache the thumbnail of '{}' in '{}'", path, cache);
+  }
+
+  return r;
+}
+
+QString ThumbnailLoader::cachePath(const QFileInfo& fi, const QSize& box)
+{
+  const QString key = QString("%1|%2|%3|%4x%5")
+                          .arg(fi.absoluteFilePath())
+                          .arg(fi.size())
+                          .arg(fi.lastModified().toMSecsSinceEpoch())
+                          .arg(box.width())
+                          .arg(box.height());
+
+  const auto hash =
+      QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+
+  return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+         "/thumbnails/" + QString::fromLatin1(hash.left(2)) + "/" +
+         QString::fromLatin1(hash) + ".png";
+}
+
+File::File(QString path) : m_path(std::move(path)), m_failed(false), m_pending(false)
+{}
 
 void File::ensureOriginalLoaded()
 {
@@ -898,6 +1085,8 @@ void File::ensureOriginalLoaded()
                static_cast<int>(reader.error()));
 
     m_failed = true;
+  } else {
+    m_originalSize = m_original.size();
   }
 }
 
@@ -930,44 +1119,47 @@ bool File::failed() const
   return m_failed;
 }
 
-void File::loadIfNeeded(const Geometry& geo)
+QSize File::originalSize() const
 {
-  if (needsLoad(geo)) {
-    load(geo);
-  }
+  return m_originalSize;
 }
 
-bool File::needsLoad(const Geometry& geo) const
+bool File::needsThumbnail(const Geometry& geo) const
 {
-  if (m_failed) {
+  if (m_failed || m_pending) {
     return false;
   }
 
-  if (m_original.isNull() || m_thumbnail.isNull()) {
+  if (m_thumbnail.isNull()) {
     return true;
   }
 
-  const auto scaledSize = geo.scaledImageSize(m_original.size());
-  return (m_thumbnail.size() != scaledSize);
+  // the thumbnail area was resized
+  return (m_thumbnail.size() != geo.scaledImageSize(m_originalSize));
 }
 
-void File::load(const Geometry& geo)
+void File::setPending()
 {
-  m_failed = false;
-  ensureOriginalLoaded();
+  m_pending = true;
+}
 
-  if (m_failed) {
-    QImage warning(":/MO/gui/warning");
-    const auto scaledSize = geo.scaledImageSize(warning.size());
+void File::resetPending()
+{
+  m_pending = false;
+}
 
-    m_thumbnail =
-        warning.scaled(scaledSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-  } else {
-    const auto scaledSize = geo.scaledImageSize(m_original.size());
+void File::setThumbnail(QImage thumbnail, QSize originalSize)
+{
+  m_thumbnail    = std::move(thumbnail);
+  m_originalSize = originalSize;
+  m_pending      = false;
+}
 
-    m_thumbnail =
-        m_original.scaled(scaledSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-  }
+void File::setFailed(QImage warning)
+{
+  m_thumbnail = std::move(warning);
+  m_failed    = true;
+  m_pending   = false;
 }
 
 Files::Files() : m_selection(BadIndex), m_filtered(false) {}
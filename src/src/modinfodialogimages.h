@@ -6,6 +6,9 @@
 #include "organizercore.h"
 #include "plugincontainer.h"
 #include <QScrollBar>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
 
 using namespace MOBase;
 
@@ -227,6 +230,56 @@ private:
   QRect calcTopRect() const;
 };
 
+// decodes and scales thumbnails on a thread pool; thumbnails are kept in the
+// cache directory keyed by the path, size and modification time of the image
+// and the size they were scaled to, so showing the tab again is instant
+//
+class ThumbnailLoader
+{
+public:
+  struct Result
+  {
+    // index of the file in Files::allFiles()
+    std::size_t index;
+
+    // the box the thumbnail was scaled to fit in
+    QSize box;
+
+    QImage thumbnail;
+    QSize originalSize;
+    bool failed = false;
+  };
+
+  using Callback = std::function<void(Result)>;
+
+  // `callback` is called on the thread of `receiver`
+  //
+  ThumbnailLoader(QObject* receiver, Callback callback);
+
+  // waits for the running requests
+  //
+  ~ThumbnailLoader();
+
+  // drops all the queued requests, results of the running ones are discarded
+  //
+  void reset();
+
+  // queues loading the image at `path` scaled to fit in `box`; requests with a
+  // higher priority are handled first
+  //
+  void request(std::size_t index, const QString& path, const QSize& box,
+               int priority);
+
+private:
+  QObject* m_receiver;
+  Callback m_callback;
+  QThreadPool m_pool;
+  std::atomic<int> m_generation;
+
+  static Result load(const QString& path, const QSize& box);
+  static QString cachePath(const QFileInfo& fi, const QSize& box);
+};
+
 class File
 {
 public:
@@ -240,16 +293,32 @@ public:
   const QImage& thumbnail() const;
   bool failed() const;
 
-  void loadIfNeeded(const Geometry& geo);
+  // size of the image, invalid until either the original or the thumbnail
+  // was loaded
+  //
+  QSize originalSize() const;
+
+  // whether the thumbnail is missing or doesn't fit the geometry and isn't
+  // being loaded already
+  //
+  bool needsThumbnail(const Geometry& geo) const;
+
+  // marks the thumbnail as being loaded, needsThumbnail() returns false until
+  // setThumbnail() or resetPending() is called
+  //
+  void setPending();
+  void resetPending();
+
+  void setThumbnail(QImage thumbnail, QSize originalSize);
+  void setFailed(QImage warning);
 
 private:
   QString m_path;
   mutable QString m_filename;
   QImage m_original, m_thumbnail;
+  QSize m_originalSize;
   bool m_failed;
-
-  bool needsLoad(const Geometry& geo) const;
-  void load(const Geometry& geo);
+  bool m_pending;
 };
 
 class Files
@@ -324,13 +393,14 @@ private:
     Partial
   };
 
-  using ScalableImage = ImagesTabHelpers::ScalableImage;
-  using Files         = ImagesTabHelpers::Files;
-  using File          = ImagesTabHelpers::File;
-  using Theme         = ImagesTabHelpers::Theme;
-  using Metrics       = ImagesTabHelpers::Metrics;
-  using PaintContext  = ImagesTabHelpers::PaintContext;
-  using Geometry      = ImagesTabHelpers::Geometry;
+  using ScalableImage   = ImagesTabHelpers::ScalableImage;
+  using Files           = ImagesTabHelpers::Files;
+  using File            = ImagesTabHelpers::File;
+  using Theme           = ImagesTabHelpers::Theme;
+  using Metrics         = ImagesTabHelpers::Metrics;
+  using PaintContext    = ImagesTabHelpers::PaintContext;
+  using Geometry        = ImagesTabHelpers::Geometry;
+  using ThumbnailLoader = ImagesTabHelpers::ThumbnailLoader;
 
   ScalableImage* m_image;
   std::vector<QString> m_supportedFormats;
@@ -340,6 +410,9 @@ private:
   Theme m_theme;
   Metrics m_metrics;
 
+  // last so it's destroyed first, before anything a result would touch
+  ThumbnailLoader m_thumbnails;
+
   void getSupportedFormats();
   void enableDDS(bool b);
 
@@ -371,6 +444,11 @@ private:
   void paintThumbnailImage(const PaintContext& cx);
   void paintThumbnailText(const PaintContext& cx);
 
+  void requestThumbnail(File& f, const Geometry& geo, std::size_t thumbIndex,
+                        int priority);
+  void onThumbnailLoaded(ThumbnailLoader::Result r);
+  void resetThumbnailRequests();
+
   void checkFiltering();
   void switchToAll();
   void switchToFiltered();
@@ -1,5 +1,6 @@
 #include "modinfodialogtab.h"
 #include "modinfo.h"
+#include "organizercore.h"
 #include "shared/filesorigin.h"
 #include "texteditor.h"
 #include "ui_modinfodialog.h"
@@ -129,6 +130,15 @@ void ModInfoDialogTab::emitOriginModified()
   }
 }
 
+void ModInfoDialogTab::emitOriginRenamed(
+    const std::vector<std::pair<QString, QString>>& renames)
+{
+  if (m_origin) {
+    core().applyModRenames(m_origin->getID(), renames);
+    emit originRenamed(m_origin->getID());
+  }
+}
+
 void ModInfoDialogTab::emitModOpen(QString name)
 {
   emit modOpen(name);
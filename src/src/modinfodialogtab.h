@@ -3,6 +3,8 @@
 
 #include "modinfodialogfwd.h"
 #include <QObject>
+#include <utility>
+#include <vector>
 
 namespace MOShared
 {
@@ -209,6 +211,11 @@ signals:
   //
   void originModified(int originID);
 
+  // emitted when a tab renamed files in a mod and the directory structure was
+  // already updated, see emitOriginRenamed()
+  //
+  void originRenamed(int originID);
+
   // emitted when a tab wants to open a mod by name
   //
   void modOpen(QString name);
@@ -234,6 +241,11 @@ protected:
   //
   void emitOriginModified();
 
+  // applies files renamed in the origin to the directory structure, see
+  // OrganizerCore::applyModRenames(), and emits originRenamed
+  //
+  void emitOriginRenamed(const std::vector<std::pair<QString, QString>>& renames);
+
   // emits modOpen
   //
   void emitModOpen(QString name);
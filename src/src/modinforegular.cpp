@@ -1,13 +1,17 @@
 #include "modinforegular.h"
 
 #include "categories.h"
+#include "inireader.h"
 #include "messagedialog.h"
+#include "modcontentscache.h"
 #include "moddatacontent.h"
+#include "modimage.h"
 #include "organizercore.h"
 #include "plugincontainer.h"
 #include "report.h"
 #include "settings.h"
 #include <iplugingame.h>
+#include <memoryusage.h>
 #include <utility.h>
 
 #include <QApplication>
@@ -56,7 +60,8 @@ QString storeMetaPath(const QString& value)
 }
 }  // namespace
 
-ModInfoRegular::ModInfoRegular(const QDir& path, OrganizerCore& core)
+ModInfoRegular::ModInfoRegular(const QDir& path, OrganizerCore& core,
+                               const QVariantMap* meta)
     : ModInfoWithConflictInfo(core), m_Name(path.dirName()),
       m_Path(path.absolutePath()), m_Repository(),
       m_GameName(core.managedGame()->gameShortName()), m_IsAlternate(false),
@@ -67,7 +72,11 @@ ModInfoRegular::ModInfoRegular(const QDir& path, OrganizerCore& core)
 {
   m_CreationTime = QFileInfo(path.absolutePath()).birthTime();
   // read out the meta-file for information
-  readMeta();
+  if (meta != nullptr) {
+    readMeta(*meta);
+  } else {
+    readMeta();
+  }
   if (m_GameName.compare(core.managedGame()->gameShortName(), Qt::CaseInsensitive) != 0)
     if (!core.managedGame()->primarySources().contains(m_GameName, Qt::CaseInsensitive))
       m_IsAlternate = true;
@@ -112,7 +121,11 @@ bool ModInfoRegular::isEmpty() const
 
 void ModInfoRegular::readMeta()
 {
-  QSettings metaFile(m_Path + "/meta.ini", QSettings::IniFormat);
+  readMeta(readIniValues(m_Path + "/meta.ini"));
+}
+
+void ModInfoRegular::readMeta(const QVariantMap& metaFile)
+{
   m_Comments           = metaFile.value("comments", "").toString();
   m_Notes              = metaFile.value("notes", "").toString();
   QString tempGameName = metaFile.value("gameName", m_GameName).toString();
@@ -253,107 +266,115 @@ void ModInfoRegular::readMeta()
     }
   }
 
-  int numFiles = metaFile.beginReadArray("installedFiles");
-  for (int i = 0; i < numFiles; ++i) {
-    metaFile.setArrayIndex(i);
-    m_InstalledFileIDs.insert(std::make_pair(metaFile.value("modid").toInt(),
-                                             metaFile.value("fileid").toInt()));
+  // arrays are stored as "installedFiles/size" and "installedFiles/1/modid", etc.
+  int numFiles = metaFile.value("installedFiles/size").toInt();
+  for (int i = 1; i <= numFiles; ++i) {
+    const QString prefix = QString("installedFiles/%1/").arg(i);
+    m_InstalledFileIDs.insert(
+        std::make_pair(metaFile.value(prefix + "modid").toInt(),
+                       metaFile.value(prefix + "fileid").toInt()));
   }
-  metaFile.endArray();
 
-  // Plugin settings:
-  metaFile.beginGroup("Plugins");
-  for (auto pluginName : metaFile.childGroups()) {
-    metaFile.beginGroup(pluginName);
-    for (auto settingKey : metaFile.childKeys()) {
-      m_PluginSettings[pluginName][settingKey] = metaFile.value(settingKey);
+  // Plugin settings, stored as "Plugins/<plugin>/<setting>":
+  const QString pluginsGroup = "Plugins/";
+  for (auto itor = metaFile.lowerBound(pluginsGroup);
+       itor != metaFile.end() && itor.key().startsWith(pluginsGroup); ++itor) {
+    const QStringList names = itor.key().mid(pluginsGroup.size()).split('/');
+    if (names.size() == 2) {
+      m_PluginSettings[names[0]][names[1]] = itor.value();
     }
-    metaFile.endGroup();
   }
-  metaFile.endGroup();
 
   m_MetaInfoChanged = false;
 }
 
 void ModInfoRegular::saveMeta()
+{
+  // a batch still being written may hold older values
+  MetaSaveQueue::instance().wait();
+
+  if (auto write = takeMetaWrite()) {
+    if (!writeMetaFile(*write)) {
+      m_MetaInfoChanged = true;
+    }
+  }
+}
+
+void ModInfoRegular::saveMetaLater()
+{
+  if (m_MetaInfoChanged) {
+    MetaSaveQueue::instance().add(this);
+  }
+}
+
+std::optional<MetaFileWrite> ModInfoRegular::takeMetaWrite()
 {
   // only write meta data if the mod directory exists
-  if (m_MetaInfoChanged && QFile::exists(absolutePath())) {
-    QSettings metaFile(absolutePath().append("/meta.ini"), QSettings::IniFormat);
-    if (metaFile.status() == QSettings::NoError) {
-      std::set<int> temp = m_Categories;
-      temp.erase(m_PrimaryCategory);
-      metaFile.setValue("category", QString("%1").arg(m_PrimaryCategory) + "," +
-                                        SetJoin(temp, ","));
-      metaFile.setValue("newestVersion", m_NewestVersion.canonicalString());
-      metaFile.setValue("ignoredVersion", m_IgnoredVersion.canonicalString());
-      metaFile.setValue("version", m_Version.canonicalString());
-      metaFile.setValue("installationFile", storeMetaPath(m_InstallationFile));
-      metaFile.setValue("repository", m_Repository);
-      metaFile.setValue("gameName", m_GameName);
-      metaFile.setValue("modid", m_NexusID);
-      metaFile.setValue("comments", m_Comments);
-      metaFile.setValue("notes", m_Notes);
-      metaFile.setValue("nexusDescription", m_NexusDescription);
-      metaFile.setValue("url", m_CustomURL);
-      metaFile.setValue("hasCustomURL", m_HasCustomURL);
-      metaFile.setValue("nexusFileStatus", m_NexusFileStatus);
-      metaFile.setValue("lastNexusQuery", m_LastNexusQuery.toString(Qt::ISODate));
-      metaFile.setValue("lastNexusUpdate", m_LastNexusUpdate.toString(Qt::ISODate));
-      metaFile.setValue("nexusLastModified", m_NexusLastModified.toString(Qt::ISODate));
-      metaFile.setValue("nexusCategory", m_NexusCategory);
-      metaFile.setValue("author", m_Author);
-      metaFile.setValue("uploader", m_Uploader);
-      metaFile.setValue("uploaderUrl", m_UploaderUrl);
-      metaFile.setValue("converted", m_Converted);
-      metaFile.setValue("validated", m_Validated);
-      metaFile.setValue("color", m_Color);
-      if (m_EndorsedState != EndorsedState::ENDORSED_UNKNOWN) {
-        metaFile.setValue(
-            "endorsed",
-            static_cast<std::underlying_type_t<EndorsedState>>(m_EndorsedState));
-      }
-      if (m_TrackedState != TrackedState::TRACKED_UNKNOWN) {
-        metaFile.setValue("tracked", static_cast<std::underlying_type_t<TrackedState>>(
-                                         m_TrackedState));
-      }
+  if (!m_MetaInfoChanged || !QFile::exists(absolutePath())) {
+    return {};
+  }
 
-      metaFile.remove("installedFiles");
-      metaFile.beginWriteArray("installedFiles");
-      int idx = 0;
-      for (auto iter = m_InstalledFileIDs.begin(); iter != m_InstalledFileIDs.end();
-           ++iter) {
-        metaFile.setArrayIndex(idx++);
-        metaFile.setValue("modid", iter->first);
-        metaFile.setValue("fileid", iter->second);
-      }
-      metaFile.endArray();
-
-      // Plugin settings:
-      metaFile.remove("Plugins");
-      metaFile.beginGroup("Plugins");
-      for (const auto& [pluginName, pluginSettings] : m_PluginSettings) {
-        metaFile.beginGroup(pluginName);
-        for (const auto& [settingName, settingValue] : pluginSettings) {
-          metaFile.setValue(settingName, settingValue);
-        }
-        metaFile.endGroup();
-      }
-      metaFile.endGroup();
+  MetaFileWrite write;
+  write.path = absolutePath().append("/meta.ini");
+  auto& values = write.values;
+
+  std::set<int> temp = m_Categories;
+  temp.erase(m_PrimaryCategory);
+  values["category"] = QString("%1").arg(m_PrimaryCategory) + "," + SetJoin(temp, ",");
+
+  values["newestVersion"]     = m_NewestVersion.canonicalString();
+  values["ignoredVersion"]    = m_IgnoredVersion.canonicalString();
+  values["version"]           = m_Version.canonicalString();
+  values["installationFile"]  = storeMetaPath(m_InstallationFile);
+  values["repository"]        = m_Repository;
+  values["gameName"]          = m_GameName;
+  values["modid"]             = m_NexusID;
+  values["comments"]          = m_Comments;
+  values["notes"]             = m_Notes;
+  values["nexusDescription"]  = m_NexusDescription;
+  values["url"]               = m_CustomURL;
+  values["hasCustomURL"]      = m_HasCustomURL;
+  values["nexusFileStatus"]   = m_NexusFileStatus;
+  values["lastNexusQuery"]    = m_LastNexusQuery.toString(Qt::ISODate);
+  values["lastNexusUpdate"]   = m_LastNexusUpdate.toString(Qt::ISODate);
+  values["nexusLastModified"] = m_NexusLastModified.toString(Qt::ISODate);
+  values["nexusCategory"]     = m_NexusCategory;
+  values["author"]            = m_Author;
+  values["uploader"]          = m_Uploader;
+  values["uploaderUrl"]       = m_UploaderUrl;
+  values["converted"]         = m_Converted;
+  values["validated"]         = m_Validated;
+  values["color"]             = m_Color;
+  if (m_EndorsedState != EndorsedState::ENDORSED_UNKNOWN) {
+    values["endorsed"] =
+        static_cast<std::underlying_type_t<EndorsedState>>(m_EndorsedState);
+  }
+  if (m_TrackedState != TrackedState::TRACKED_UNKNOWN) {
+    values["tracked"] =
+        static_cast<std::underlying_type_t<TrackedState>>(m_TrackedState);
+  }
 
-      metaFile.sync();  // sync needs to be called to ensure the file is created
+  // same keys as QSettings::beginWriteArray()
+  write.replacedGroups.append("installedFiles");
+  int idx = 0;
+  for (auto iter = m_InstalledFileIDs.begin(); iter != m_InstalledFileIDs.end();
+       ++iter) {
+    const QString prefix = QString("installedFiles/%1/").arg(++idx);
+    values[prefix + "modid"]  = iter->first;
+    values[prefix + "fileid"] = iter->second;
+  }
+  values["installedFiles/size"] = idx;
 
-      if (metaFile.status() == QSettings::NoError) {
-        m_MetaInfoChanged = false;
-      } else {
-        log::error("failed to write {}/meta.ini: error {}", absolutePath(),
-                   metaFile.status());
-      }
-    } else {
-      log::error("failed to write {}/meta.ini: error {}", absolutePath(),
-                 metaFile.status());
+  // Plugin settings:
+  write.replacedGroups.append("Plugins");
+  for (const auto& [pluginName, pluginSettings] : m_PluginSettings) {
+    for (const auto& [settingName, settingValue] : pluginSettings) {
+      values["Plugins/" + pluginName + "/" + settingName] = settingValue;
     }
   }
+
+  m_MetaInfoChanged = false;
+  return write;
 }
 
 bool ModInfoRegular::updateAvailable() const
@@ -396,7 +417,7 @@ void ModInfoRegular::nxmDescriptionAvailable(QString, int, QVariant,
   m_NexusLastModified =
       QDateTime::fromSecsSinceEpoch(result["updated_timestamp"].toInt(), QTimeZone::UTC);
   m_MetaInfoChanged = true;
-  saveMeta();
+  saveMetaLater();
   disconnect(sender(), SIGNAL(descriptionAvailable(QString, int, QVariant, QVariant)));
   emit modDetailsUpdated(true);
 }
@@ -415,7 +436,7 @@ void ModInfoRegular::nxmEndorsementToggled(QString, int, QVariant, QVariant resu
       } else {
         mod->setIsEndorsed(false);
       }
-      mod->saveMeta();
+      mod->saveMetaLater();
     }
   }
   emit modDetailsUpdated(true);
@@ -428,7 +449,7 @@ void ModInfoRegular::nxmTrackingToggled(QString, int, QVariant, bool tracked)
     if (mod->gameName().compare(m_GameName, Qt::CaseInsensitive) == 0 &&
         mod->nexusId() == m_NexusID) {
       mod->setIsTracked(tracked);
-      mod->saveMeta();
+      mod->saveMetaLater();
     }
   }
   emit modDetailsUpdated(true);
@@ -528,7 +549,7 @@ bool ModInfoRegular::setName(const QString& name)
     }
   }
 
-  std::map<QString, unsigned int>::iterator nameIter = s_ModsByName.find(m_Name);
+  auto nameIter = s_ModsByName.find(m_Name);
   if (nameIter != s_ModsByName.end()) {
     QMutexLocker locker(&s_Mutex);
 
@@ -674,7 +695,7 @@ void ModInfoRegular::markConverted(bool converted)
 {
   m_Converted       = converted;
   m_MetaInfoChanged = true;
-  saveMeta();
+  saveMetaLater();
   emit modDetailsUpdated(true);
 }
 
@@ -682,7 +703,7 @@ void ModInfoRegular::markValidated(bool validated)
 {
   m_Validated       = validated;
   m_MetaInfoChanged = true;
-  saveMeta();
+  saveMetaLater();
   emit modDetailsUpdated(true);
 }
 
@@ -747,13 +768,51 @@ std::set<int> ModInfoRegular::doGetContents() const
       m_Core.pluginContainer().gameFeatures().gameFeature<ModDataContent>();
 
   if (contentFeature) {
-    auto result = contentFeature->getContentsFor(fileTree());
-    return std::set<int>(std::begin(result), std::end(result));
+    const auto cache = sharedModContentsCache(m_Core.settings().paths().overwrite());
+    return cache->get(absolutePath(), *contentFeature, [&] {
+      auto result = contentFeature->getContentsFor(fileTree());
+      return std::set<int>(std::begin(result), std::end(result));
+    });
   }
 
   return {};
 }
 
+std::size_t ModInfoRegular::memoryUsage() const
+{
+  std::size_t bytes = ModInfoWithConflictInfo::memoryUsage() + sizeof(ModInfoRegular) -
+                      sizeof(ModInfoWithConflictInfo);
+
+  for (const auto* s :
+       {&m_Name, &m_Path, &m_InstallationFile, &m_Comments, &m_Notes,
+        &m_NexusDescription, &m_Repository, &m_CustomURL, &m_GameName, &m_Author,
+        &m_Uploader, &m_UploaderUrl}) {
+    bytes += memory::heapBytes(*s);
+  }
+
+  bytes += m_Archives.capacity() * sizeof(QString);
+  for (const auto& archive : m_Archives) {
+    bytes += memory::heapBytes(archive);
+  }
+
+  bytes += memory::treeBytes(m_InstalledFileIDs) + memory::treeBytes(m_PluginSettings);
+  for (const auto& [plugin, settings] : m_PluginSettings) {
+    bytes += memory::heapBytes(plugin) + memory::treeBytes(settings);
+  }
+
+  return bytes;
+}
+
+void ModInfoRegular::prefetch()
+{
+  ModInfoWithConflictInfo::prefetch();
+
+  // this runs on the worker threads of updateFromDisc(), the content column
+  // and filters would classify the mod on the gui thread otherwise
+  getContents();
+  isValid();
+}
+
 int ModInfoRegular::getHighlight() const
 {
   if (!isValid() && !m_Validated)
@@ -800,7 +859,7 @@ void ModInfoRegular::setNexusFileStatus(int status)
 {
   m_NexusFileStatus = status;
   m_MetaInfoChanged = true;
-  saveMeta();
+  saveMetaLater();
   emit modDetailsUpdated(true);
 }
 
@@ -848,7 +907,7 @@ void ModInfoRegular::setLastNexusUpdate(QDateTime time)
 {
   m_LastNexusUpdate = time;
   m_MetaInfoChanged = true;
-  saveMeta();
+  saveMetaLater();
   emit modDetailsUpdated(true);
 }
 
@@ -861,7 +920,7 @@ void ModInfoRegular::setLastNexusQuery(QDateTime time)
 {
   m_LastNexusQuery  = time;
   m_MetaInfoChanged = true;
-  saveMeta();
+  saveMetaLater();
   emit modDetailsUpdated(true);
 }
 
@@ -874,7 +933,7 @@ void ModInfoRegular::setNexusLastModified(QDateTime time)
 {
   m_NexusLastModified = time;
   m_MetaInfoChanged   = true;
-  saveMeta();
+  saveMetaLater();
   emit modDetailsUpdated(true);
 }
 
@@ -887,7 +946,7 @@ void ModInfoRegular::setNexusCategory(int category)
 {
   m_NexusCategory   = category;
   m_MetaInfoChanged = true;
-  saveMeta();
+  saveMetaLater();
 }
 
 QString ModInfoRegular::author() const
@@ -899,7 +958,7 @@ void ModInfoRegular::setAuthor(const QString& author)
 {
   m_Author          = author;
   m_MetaInfoChanged = true;
-  saveMeta();
+  saveMetaLater();
   emit modDetailsUpdated(true);
 }
 
@@ -912,7 +971,7 @@ void ModInfoRegular::setUploader(const QString& uploader)
 {
   m_Uploader        = uploader;
   m_MetaInfoChanged = true;
-  saveMeta();
+  saveMetaLater();
   emit modDetailsUpdated(true);
 }
 
@@ -925,7 +984,7 @@ void ModInfoRegular::setUploaderUrl(const QString& uploaderUrl)
 {
   m_UploaderUrl     = uploaderUrl;
   m_MetaInfoChanged = true;
-  saveMeta();
+  saveMetaLater();
   emit modDetailsUpdated(true);
 }
 
@@ -955,10 +1014,11 @@ QStringList ModInfoRegular::archives(bool checkOnDisk)
 {
   if (checkOnDisk) {
     QStringList result;
-    QDir dir(this->absolutePath());
+    const QString path  = modFilesPath(this->absolutePath());
+    QDir dir(path);
     QStringList bsaList = dir.entryList(QStringList({"*.bsa", "*.ba2"}));
     for (const QString& archive : bsaList) {
-      result.append(this->absolutePath() + "/" + archive);
+      result.append(path + "/" + archive);
     }
     m_Archives = result;
   }
@@ -1026,7 +1086,7 @@ bool ModInfoRegular::setPluginSetting(const QString& pluginName, const QString&
 {
   m_PluginSettings[pluginName][key] = value;
   m_MetaInfoChanged                 = true;
-  saveMeta();
+  saveMetaLater();
   return true;
 }
 
@@ -1039,6 +1099,6 @@ ModInfoRegular::clearPluginSettings(const QString& pluginName)
   }
   auto settings = itp->second;
   m_PluginSettings.erase(itp);
-  saveMeta();
+  saveMetaLater();
   return settings;
 }
@@ -2,7 +2,9 @@
 #define MODINFOREGULAR_H
 
 #include <limits>
+#include <optional>
 
+#include "metasavequeue.h"
 #include "modinfowithconflictinfo.h"
 #include "nexusinterface.h"
 
@@ -432,8 +434,21 @@ public:
    */
   virtual void saveMeta() override;
 
+  virtual void saveMetaLater() override;
+
+  /**
+   * @brief the meta information to write to disk if it changed since it was
+   *     last written, which is then considered written
+   */
+  std::optional<MetaFileWrite> takeMetaWrite();
+
   void readMeta() override;
 
+  /**
+   * @brief reads meta information from the values of a meta.ini
+   */
+  void readMeta(const QVariantMap& meta);
+
   virtual void setHasCustomURL(bool b) override;
   virtual bool hasCustomURL() const override;
   virtual void setCustomURL(QString const&) override;
@@ -448,6 +463,8 @@ public:
     return m_InstalledFileIDs;
   }
 
+  std::size_t memoryUsage() const override;
+
 public:  // Plugin operations:
   virtual QVariant pluginSetting(const QString& pluginName, const QString& key,
                                  const QVariant& defaultValue) const override;
@@ -473,8 +490,10 @@ private slots:
 
 protected:
   virtual std::set<int> doGetContents() const override;
+  void prefetch() override;
 
-  ModInfoRegular(const QDir& path, OrganizerCore& core);
+  ModInfoRegular(const QDir& path, OrganizerCore& core,
+                 const QVariantMap* meta = nullptr);
 
 private:
   QString m_Name;
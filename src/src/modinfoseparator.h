@@ -62,7 +62,7 @@ protected:
   virtual bool doIsValid() const override { return true; }
 
 private:
-  ModInfoSeparator(const QDir& path, OrganizerCore& core);
+  ModInfoSeparator(const QDir& path, OrganizerCore& core, const QVariantMap* meta);
 };
 
 #endif
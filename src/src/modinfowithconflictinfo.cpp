@@ -9,6 +9,7 @@
 #include "moddatachecker.h"
 #include "organizercore.h"
 #include "qdirfiletree.h"
+#include <memoryusage.h>
 
 using namespace MOBase;
 using namespace MOShared;
@@ -24,9 +25,7 @@ ModInfoWithConflictInfo::ModInfoWithConflictInfo(OrganizerCore& core)
       m_Contents([this]() {
         return doGetContents();
       }),
-      m_Conflicts([this]() {
-        return doConflictCheck();
-      })
+      m_Conflicts(ConflictCheck{this})
 {}
 
 void ModInfoWithConflictInfo::clearCaches()
@@ -34,6 +33,34 @@ void ModInfoWithConflictInfo::clearCaches()
   m_Conflicts.invalidate();
 }
 
+void ModInfoWithConflictInfo::prefetchConflicts(const ConflictContext& context)
+{
+  m_Conflicts.value(context);
+}
+
+std::size_t ModInfoWithConflictInfo::memoryUsage() const
+{
+  std::size_t bytes =
+      ModInfo::memoryUsage() + sizeof(ModInfoWithConflictInfo) - sizeof(ModInfo);
+
+  // only what was computed already, this doesn't compute anything
+  if (m_Conflicts.hasValue()) {
+    const Conflicts& c = m_Conflicts.value();
+    for (const auto* list :
+         {&c.m_OverwriteList, &c.m_OverwrittenList, &c.m_ArchiveOverwriteList,
+          &c.m_ArchiveOverwrittenList, &c.m_ArchiveLooseOverwriteList,
+          &c.m_ArchiveLooseOverwrittenList}) {
+      bytes += memory::treeBytes(*list);
+    }
+  }
+
+  if (m_Contents.hasValue()) {
+    bytes += memory::treeBytes(m_Contents.value());
+  }
+
+  return bytes;
+}
+
 std::vector<ModInfo::EFlag> ModInfoWithConflictInfo::getFlags() const
 {
   std::vector<ModInfo::EFlag> result = std::vector<ModInfo::EFlag>();
@@ -92,68 +119,59 @@ std::vector<ModInfo::EConflictFlag> ModInfoWithConflictInfo::getConflictFlags()
   return result;
 }
 
-ModInfoWithConflictInfo::Conflicts ModInfoWithConflictInfo::doConflictCheck() const
+ModInfo::ConflictContext::ConflictContext(OrganizerCore& core)
+{
+  auto* structure = core.directoryStructure();
+
+  if (structure->originExists(L"data")) {
+    dataOrigins.push_back(structure->getOriginByName(L"data").getID());
+  }
+  for (const auto& origin : core.managedGame()->secondaryDataDirectories().keys()) {
+    if (structure->originExists(origin.toStdWString())) {
+      dataOrigins.push_back(structure->getOriginByName(origin.toStdWString()).getID());
+    }
+  }
+
+  // origins are named after their mods
+  const unsigned int count = ModInfo::getNumMods();
+  modsByOrigin.reserve(count);
+  for (unsigned int i = 0; i < count; ++i) {
+    const std::wstring name = ToWString(ModInfo::getByIndex(i)->name());
+    if (structure->originExists(name)) {
+      modsByOrigin.emplace(structure->getOriginByName(name).getID(), i);
+    }
+  }
+}
+
+unsigned int ModInfo::ConflictContext::modIndex(int originID) const
+{
+  const auto it = modsByOrigin.find(originID);
+  return it != modsByOrigin.end() ? it->second : UINT_MAX;
+}
+
+ModInfoWithConflictInfo::Conflicts
+ModInfoWithConflictInfo::doConflictCheck(const ConflictContext& context) const
 {
   Conflicts conflicts;
 
   bool providesAnything = false;
-  bool hasHiddenFiles   = false;
   bool hasVisibleFiles  = false;
 
-  std::vector<int> dataIDs;
-  if (m_Core.directoryStructure()->originExists(L"data")) {
-    dataIDs.push_back(m_Core.directoryStructure()->getOriginByName(L"data").getID());
-  }
-  for (const auto& origin : m_Core.managedGame()->secondaryDataDirectories().keys()) {
-    if (m_Core.directoryStructure()->originExists(origin.toStdWString())) {
-      dataIDs.push_back(
-          m_Core.directoryStructure()->getOriginByName(origin.toStdWString()).getID());
-    }
-  }
+  const std::vector<int>& dataIDs = context.dataOrigins;
 
   std::wstring name = ToWString(this->name());
 
   if (m_Core.directoryStructure()->originExists(name)) {
     FilesOrigin& origin = m_Core.directoryStructure()->getOriginByName(name);
-    std::vector<FileEntryPtr> files = origin.getFiles();
-    std::set<const DirectoryEntry*> checkedDirs;
-
-    // for all files in this origin
-    for (FileEntryPtr file : files) {
-      if (QString::fromStdWString(file->getName())
-              .endsWith(ModInfo::s_HiddenExt, Qt::CaseInsensitive)) {
-        hasHiddenFiles = true;
-        // skip hidden file conflicts
-        continue;
-      } else {
-        const DirectoryEntry* parent = file->getParent();
-        auto hidden                  = false;
-
-        // iterate on all parent directory entries to check for .mohiddden
-        while (parent != nullptr) {
-          auto insertResult = checkedDirs.insert(parent);
 
-          if (insertResult.second == false) {
-            // if already present break as we can assume to have checked the parents as
-            // well
-            break;
-          } else {
-            if (QString::fromStdWString(parent->getName())
-                    .endsWith(ModInfo::s_HiddenExt, Qt::CaseInsensitive)) {
-              hasHiddenFiles = hidden = true;
-              break;
-            }
-            parent = parent->getParent();
-          }
-        }
-        if (hidden) {
-          // skip hidden file conflicts
-          continue;
-        }
-      }
+    // hidden files don't conflict, the origin knows which ones they are
+    std::vector<FileEntryPtr> files = origin.getVisibleFiles();
+    const bool hasHiddenFiles       = origin.hasHiddenFiles();
 
+    // for all visible files in this origin
+    for (FileEntryPtr file : files) {
       hasVisibleFiles   = true;
-      auto alternatives = file->getAlternatives();
+      const auto& alternatives = file->getAlternatives();
       if ((alternatives.size() == 0) ||
           std::find(dataIDs.begin(), dataIDs.end(), alternatives.back().originID()) !=
               dataIDs.end()) {
@@ -175,9 +193,7 @@ ModInfoWithConflictInfo::Conflicts ModInfoWithConflictInfo::doConflictCheck() co
 
         // If this is not the origin then determine the correct overwrite
         if (file->getOrigin() != origin.getID()) {
-          FilesOrigin& altOrigin =
-              m_Core.directoryStructure()->getOriginByID(file->getOrigin());
-          unsigned int altIndex = ModInfo::getIndex(ToQString(altOrigin.getName()));
+          unsigned int altIndex = context.modIndex(file->getOrigin());
           if (!file->isFromArchive()) {
             if (!archiveData.isValid())
               conflicts.m_OverwrittenList.insert(altIndex);
@@ -197,8 +213,7 @@ ModInfoWithConflictInfo::Conflicts ModInfoWithConflictInfo::doConflictCheck() co
               (altInfo.originID() != origin.getID())) {
             FilesOrigin& altOrigin =
                 m_Core.directoryStructure()->getOriginByID(altInfo.originID());
-            QString altOriginName = ToQString(altOrigin.getName());
-            unsigned int altIndex = ModInfo::getIndex(altOriginName);
+            unsigned int altIndex = context.modIndex(altInfo.originID());
             if (!altInfo.isFromArchive()) {
               if (!archiveData.isValid()) {
                 if (origin.getPriority() > altOrigin.getPriority()) {
@@ -225,7 +240,7 @@ ModInfoWithConflictInfo::Conflicts ModInfoWithConflictInfo::doConflictCheck() co
       }
     }
 
-    if (files.size() != 0) {
+    if (files.size() != 0 || hasHiddenFiles) {
       if (hasVisibleFiles && !providesAnything)
         conflicts.m_CurrentConflictState = CONFLICT_REDUNDANT;
       else if (!conflicts.m_OverwriteList.empty() &&
@@ -53,6 +53,10 @@ public:
    */
   void clearCaches() override;
 
+  void prefetchConflicts(const ConflictContext& context) override;
+
+  std::size_t memoryUsage() const override;
+
   const std::set<unsigned int>& getModOverwrite() const override
   {
     return m_Conflicts.value().m_OverwriteList;
@@ -166,12 +170,28 @@ private:
                                         // this mod's archive files
   };
 
-  Conflicts doConflictCheck() const;
+  Conflicts doConflictCheck(const ConflictContext& context) const;
+
+  // checks with the context of prefetchConflicts(), or reads one on demand
+  struct ConflictCheck
+  {
+    const ModInfoWithConflictInfo* mod;
+
+    Conflicts operator()() const
+    {
+      return mod->doConflictCheck(ConflictContext(mod->m_Core));
+    }
+
+    Conflicts operator()(const ConflictContext& context) const
+    {
+      return mod->doConflictCheck(context);
+    }
+  };
 
   MOBase::MemoizedLocked<std::shared_ptr<const MOBase::IFileTree>> m_FileTree;
   MOBase::MemoizedLocked<bool> m_Valid;
   MOBase::MemoizedLocked<std::set<int>> m_Contents;
-  MOBase::MemoizedLocked<Conflicts> m_Conflicts;
+  MOBase::MemoizedLocked<Conflicts, ConflictCheck> m_Conflicts;
 };
 
 #endif  // MODINFOWITHCONFLICTINFO_H
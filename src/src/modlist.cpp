@@ -52,6 +52,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QSortFilterProxyModel>
 #include <QStandardItemModel>
 #include <QStringList>
+#include <QTimer>
 #include <QWidgetAction>
 
 #include <algorithm>
@@ -66,6 +67,18 @@ ModList::ModList(PluginContainer* pluginContainer, OrganizerCore* organizer)
       m_FontMetrics(QFont()), m_PluginContainer(pluginContainer)
 {
   m_LastCheck.start();
+
+  // connected before any view so the rows are recomputed when the views
+  // react to these
+  connect(this, &QAbstractItemModel::dataChanged, this,
+          [this](const QModelIndex& topLeft, const QModelIndex& bottomRight) {
+            for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+              m_RowCache.erase(static_cast<unsigned int>(row));
+            }
+          });
+  connect(this, &QAbstractItemModel::modelReset, this, &ModList::clearRowCache);
+  connect(this, &QAbstractItemModel::rowsRemoved, this, &ModList::clearRowCache);
+  connect(this, &QAbstractItemModel::rowsInserted, this, &ModList::clearRowCache);
 }
 
 ModList::~ModList()
@@ -274,7 +287,7 @@ QVariant ModList::data(const QModelIndex& modelIndex, int role) const
     }
   } else if (role == Qt::TextAlignmentRole) {
     if (column == COL_NAME) {
-      if (modInfo->getHighlight() & ModInfo::HIGHLIGHT_CENTER) {
+      if (modHighlight(modIndex) & ModInfo::HIGHLIGHT_CENTER) {
         return QVariant(Qt::AlignCenter | Qt::AlignVCenter);
       } else {
         return QVariant(Qt::AlignLeft | Qt::AlignVCenter);
@@ -328,7 +341,7 @@ QVariant ModList::data(const QModelIndex& modelIndex, int role) const
       if (modInfo->isSeparator()) {
         result.setItalic(true);
         result.setBold(true);
-      } else if (modInfo->getHighlight() & ModInfo::HIGHLIGHT_INVALID) {
+      } else if (modHighlight(modIndex) & ModInfo::HIGHLIGHT_INVALID) {
         result.setItalic(true);
       }
     } else if (column == COL_CATEGORY && modInfo->isForeign()) {
@@ -355,7 +368,7 @@ QVariant ModList::data(const QModelIndex& modelIndex, int role) const
     return QVariant();
   } else if (role == Qt::ForegroundRole) {
     if (column == COL_NAME) {
-      int highlight = modInfo->getHighlight();
+      int highlight = modHighlight(modIndex);
       if (highlight & ModInfo::HIGHLIGHT_IMPORTANT) {
         return QBrush(Qt::darkRed);
       } else if (highlight & ModInfo::HIGHLIGHT_INVALID) {
@@ -385,7 +398,7 @@ QVariant ModList::data(const QModelIndex& modelIndex, int role) const
     if (column == COL_FLAGS) {
       QString result;
 
-      for (ModInfo::EFlag flag : modInfo->getFlags()) {
+      for (ModInfo::EFlag flag : modFlags(modIndex)) {
         if (result.length() != 0)
           result += "<br>";
         result += getFlagText(flag, modInfo);
@@ -395,7 +408,7 @@ QVariant ModList::data(const QModelIndex& modelIndex, int role) const
     } else if (column == COL_CONFLICTFLAGS) {
       QString result;
 
-      for (ModInfo::EConflictFlag flag : modInfo->getConflictFlags()) {
+      for (ModInfo::EConflictFlag flag : modConflictFlags(modIndex)) {
         if (result.length() != 0)
           result += "<br>";
         result += getConflictFlagText(flag, modInfo);
@@ -681,7 +694,7 @@ void ModList::changeModPriority(std::vector<int> sourceIndices, int newPriority)
     return;
   }
 
-  emit layoutAboutToBeChanged();
+  const auto before = m_Profile->getAllIndexesByPriority();
 
   // sort the moving mods by ascending priorities
   std::sort(sourceIndices.begin(), sourceIndices.end(),
@@ -725,7 +738,7 @@ void ModList::changeModPriority(std::vector<int> sourceIndices, int newPriority)
     }
   }
 
-  emit layoutChanged();
+  notifyPriorityChanges(before);
 
   QModelIndexList indices;
   for (auto& idx : sourceIndices) {
@@ -739,11 +752,10 @@ void ModList::changeModPriority(int sourceIndex, int newPriority)
 {
   if (m_Profile == nullptr)
     return;
-  emit layoutAboutToBeChanged();
 
+  const auto before = m_Profile->getAllIndexesByPriority();
   m_Profile->setModPriority(sourceIndex, newPriority);
-
-  emit layoutChanged();
+  notifyPriorityChanges(before);
   emit modPrioritiesChanged({index(sourceIndex, 0)});
 }
 
@@ -774,7 +786,7 @@ void ModList::modInfoChanged(ModInfo::Ptr info)
     int row = ModInfo::getIndex(info->name());
     info->diskContentModified();
     emit aboutToChangeData();
-    emit dataChanged(index(row, 0), index(row, columnCount()));
+    emit dataChanged(index(row, 0), index(row, columnCount() - 1));
     emit postDataChanged();
   } else {
     log::error("modInfoChanged not called after modInfoAboutToChange");
@@ -1313,6 +1325,72 @@ void ModList::notifyChange(int rowStart, int rowEnd)
   }
 }
 
+const ModList::CachedRow& ModList::cachedRow(unsigned int index) const
+{
+  auto itor = m_RowCache.find(index);
+  if (itor != m_RowCache.end()) {
+    return itor->second;
+  }
+
+  if (!m_RowCacheClearQueued) {
+    // the flags also depend on things that don't go through the model, such as
+    // conflicts or the selected plugins, so the cache only lives until the
+    // current repaint is done
+    m_RowCacheClearQueued = true;
+    QTimer::singleShot(0, this, [this] {
+      m_RowCache.clear();
+      m_RowCacheClearQueued = false;
+    });
+  }
+
+  ModInfo::Ptr modInfo = ModInfo::getByIndex(index);
+  return m_RowCache
+      .emplace(index, CachedRow{modInfo->getFlags(), modInfo->getConflictFlags(),
+                                modInfo->getHighlight()})
+      .first->second;
+}
+
+void ModList::clearRowCache()
+{
+  m_RowCache.clear();
+}
+
+const std::vector<ModInfo::EFlag>& ModList::modFlags(unsigned int index) const
+{
+  return cachedRow(index).flags;
+}
+
+const std::vector<ModInfo::EConflictFlag>&
+ModList::modConflictFlags(unsigned int index) const
+{
+  return cachedRow(index).conflictFlags;
+}
+
+int ModList::modHighlight(unsigned int index) const
+{
+  return cachedRow(index).highlight;
+}
+
+void ModList::notifyPriorityChanges(const std::map<int, unsigned int>& before)
+{
+  int first = -1;
+  int last  = -1;
+
+  for (const auto& [priority, modIndex] : before) {
+    if (m_Profile->getModPriority(modIndex) != priority) {
+      const int row = static_cast<int>(modIndex);
+      first         = (first == -1) ? row : std::min(first, row);
+      last          = std::max(last, row);
+    }
+  }
+
+  if (first == -1) {
+    return;
+  }
+
+  emit dataChanged(this->index(first, COL_PRIORITY), this->index(last, COL_PRIORITY));
+}
+
 QModelIndex ModList::index(int row, int column, const QModelIndex&) const
 {
   if ((row < 0) || (row >= rowCount()) || (column < 0) || (column >= columnCount())) {
@@ -1432,7 +1510,7 @@ void ModList::shiftModsPriority(const QModelIndexList& indices, int offset)
     return offset > 0 ? !cmp : cmp;
   });
 
-  emit layoutAboutToBeChanged();
+  const auto before = m_Profile->getAllIndexesByPriority();
 
   std::vector<int> notify;
   for (auto index : allIndex) {
@@ -1442,7 +1520,7 @@ void ModList::shiftModsPriority(const QModelIndexList& indices, int offset)
     }
   }
 
-  emit layoutChanged();
+  notifyPriorityChanges(before);
 
   for (auto index : notify) {
     notifyChange(index);
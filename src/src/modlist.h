@@ -37,7 +37,9 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <boost/signals2.hpp>
 #endif
 #include <QVector>
+#include <map>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 class QSortFilterProxyModel;
@@ -135,6 +137,14 @@ public:
   void notifyChange(int rowStart, int rowEnd = -1);
   static QString getColumnName(int column);
 
+  // flags, conflict flags and highlight of the mod at the given index; they're
+  // computed once and kept until the model signals a change or control returns
+  // to the event loop, so painting a row only asks the mod for them once
+  //
+  const std::vector<ModInfo::EFlag>& modFlags(unsigned int index) const;
+  const std::vector<ModInfo::EConflictFlag>& modConflictFlags(unsigned int index) const;
+  int modHighlight(unsigned int index) const;
+
   void changeModPriority(int sourceIndex, int newPriority);
   void changeModPriority(std::vector<int> sourceIndices, int newPriority);
 
@@ -374,6 +384,13 @@ private:
   //
   int dropPriority(int row, const QModelIndex& parent) const;
 
+  // emits dataChanged() on the priority column for the mods whose priority
+  // differs from the given snapshot of the profile; rows are mod indices and
+  // never move, so the proxies only have to re-sort the mods that changed
+  // instead of the whole list after a layout change
+  //
+  void notifyPriorityChanges(const std::map<int, unsigned int>& before);
+
 private:
   struct TModInfo
   {
@@ -394,6 +411,16 @@ private:
     QFlags<MOBase::IModList::ModState> state;
   };
 
+  struct CachedRow
+  {
+    std::vector<ModInfo::EFlag> flags;
+    std::vector<ModInfo::EConflictFlag> conflictFlags;
+    int highlight;
+  };
+
+  const CachedRow& cachedRow(unsigned int index) const;
+  void clearRowCache();
+
 private:
   OrganizerCore* m_Organizer;
   Profile* m_Profile;
@@ -409,6 +436,9 @@ private:
 
   TModInfoChange m_ChangeInfo;
 
+  mutable std::unordered_map<unsigned int, CachedRow> m_RowCache;
+  mutable bool m_RowCacheClearQueued = false;
+
   SignalModInstalled m_ModInstalled;
   SignalModMoved m_ModMoved;
   SignalModRemoved m_ModRemoved;
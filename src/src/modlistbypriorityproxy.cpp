@@ -79,6 +79,7 @@ void ModListByPriorityProxy::buildTree()
     auto& [priority, index] = p;
     ModInfo::Ptr modInfo    = ModInfo::getByIndex(index);
     TreeItem* item          = m_IndexToItem[index].get();
+    item->priority          = priority;
 
     if (modInfo->isSeparator()) {
       item->parent = &m_Root;
@@ -112,6 +113,16 @@ void ModListByPriorityProxy::buildTree()
                            std::make_move_iterator(backups.begin()),
                            std::make_move_iterator(backups.end()));
   }
+
+  // every mapping needs the row of an item, so remember them instead of
+  // searching the children each time
+  for (std::size_t i = 0; i < m_Root.children.size(); ++i) {
+    TreeItem* item = m_Root.children[i];
+    item->row      = i;
+    for (std::size_t j = 0; j < item->children.size(); ++j) {
+      item->children[j]->row = j;
+    }
+  }
 }
 
 void ModListByPriorityProxy::onModelRowsRemoved(const QModelIndex& parent, int first,
@@ -151,16 +162,62 @@ void ModListByPriorityProxy::onModelDataChanged(const QModelIndex& topLeft,
                                                 const QModelIndex& bottomRight,
                                                 const QVector<int>& roles)
 {
-  QModelIndex proxyTopLeft = mapFromSource(topLeft);
-  if (!proxyTopLeft.isValid()) {
+  if (!topLeft.isValid()) {
     return;
   }
 
+  if (topLeft.column() <= ModList::COL_PRIORITY &&
+      bottomRight.column() >= ModList::COL_PRIORITY) {
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+      auto itor = m_IndexToItem.find(row);
+      if (itor != m_IndexToItem.end() &&
+          itor->second->priority != m_profile->getModPriority(row)) {
+        // the mod moved, possibly under another separator, the layout change
+        // refreshes all the rows anyway
+        onModelLayoutChanged({}, QAbstractItemModel::VerticalSortHint);
+        return;
+      }
+    }
+  }
+
+  forwardDataChanged(topLeft, bottomRight, roles);
+}
+
+void ModListByPriorityProxy::forwardDataChanged(const QModelIndex& topLeft,
+                                                const QModelIndex& bottomRight,
+                                                const QVector<int>& roles)
+{
   if (topLeft == bottomRight) {
-    emit dataChanged(proxyTopLeft, proxyTopLeft);
-  } else {
-    QModelIndex proxyBottomRight = mapFromSource(bottomRight);
-    emit dataChanged(proxyTopLeft, proxyBottomRight);
+    QModelIndex proxyIndex = mapFromSource(topLeft);
+    emit dataChanged(proxyIndex, proxyIndex, roles);
+    return;
+  }
+
+  // first and last row under each parent
+  std::map<TreeItem*, std::pair<std::size_t, std::size_t>> ranges;
+  for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+    auto itor = m_IndexToItem.find(row);
+    if (itor == m_IndexToItem.end()) {
+      continue;
+    }
+
+    TreeItem* item = itor->second.get();
+    auto range     = ranges.find(item->parent);
+    if (range == ranges.end()) {
+      ranges.emplace(item->parent, std::make_pair(item->row, item->row));
+    } else {
+      range->second.first  = std::min(range->second.first, item->row);
+      range->second.second = std::max(range->second.second, item->row);
+    }
+  }
+
+  for (auto& [parent, range] : ranges) {
+    const QModelIndex proxyParent =
+        parent == &m_Root ? QModelIndex() : createIndex(parent->row, 0, parent);
+    emit dataChanged(
+        index(static_cast<int>(range.first), topLeft.column(), proxyParent),
+        index(static_cast<int>(range.second), bottomRight.column(), proxyParent),
+        roles);
   }
 }
 
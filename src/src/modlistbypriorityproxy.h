@@ -78,6 +78,12 @@ private:
   //
   void buildTree();
 
+  // forwards a change of the source rows, one signal per parent since the
+  // rows can be spread over several separators
+  //
+  void forwardDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight,
+                          const QVector<int>& roles);
+
   struct TreeItem
   {
     ModInfo::Ptr mod;
@@ -85,15 +91,12 @@ private:
     std::vector<TreeItem*> children;
     TreeItem* parent;
 
-    std::size_t childIndex(TreeItem* child) const
-    {
-      for (std::size_t i = 0; i < children.size(); ++i) {
-        if (children[i] == child) {
-          return i;
-        }
-      }
-      return -1;
-    }
+    // position in the children of the parent and priority of the mod, both set
+    // by buildTree()
+    std::size_t row = 0;
+    int priority    = -1;
+
+    std::size_t childIndex(TreeItem* child) const { return child->row; }
 
     TreeItem() : TreeItem(nullptr, -1) {}
     TreeItem(ModInfo::Ptr mod, unsigned int index, TreeItem* parent = nullptr)
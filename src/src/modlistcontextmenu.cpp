@@ -2,6 +2,7 @@
 
 #include <report.h>
 
+#include "modimage.h"
 #include "modlist.h"
 #include "modlistview.h"
 #include "modlistviewactions.h"
@@ -520,6 +521,24 @@ void ModListContextMenu::addRegularActions(ModInfo::Ptr mod)
     m_actions.createBackup(m_index);
   });
 
+  if (!modImagePath(mod->absolutePath()).isEmpty()) {
+    if (modImagesSandboxed()) {
+      // the image can't be mounted, so can't be unpacked either
+      QAction* action =
+          new QAction(tr("Packed into an image, not available in Flatpak"), this);
+      action->setEnabled(false);
+      addAction(action);
+    } else {
+      addAction(tr("Unpack Image"), [=, this]() {
+        m_actions.setPacked(m_selected, false);
+      });
+    }
+  } else if (modImagesSupported()) {
+    addAction(tr("Pack into Image"), [=, this]() {
+      m_actions.setPacked(m_selected, true);
+    });
+  }
+
   if (std::find(flags.begin(), flags.end(), ModInfo::FLAG_HIDDEN_FILES) !=
       flags.end()) {
     addAction(tr("Restore hidden files"), [=, this]() {
@@ -35,12 +35,14 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QWidgetAction>
 #include <log.h>
 
+#include <algorithm>
+
 using namespace MOBase;
 
 ModListSortProxy::ModListSortProxy(Profile* profile, OrganizerCore* organizer)
     : QSortFilterProxyModel(organizer), m_Organizer(organizer), m_Profile(profile),
       m_FilterActive(false), m_FilterMode(FilterAnd),
-      m_FilterSeparators(SeparatorFilter)
+      m_FilterSeparators(SeparatorFilter), m_FilterGeneration(1)
 {
   setDynamicSortFilter(true);  // this seems to work without dynamicsortfilter
                                // but I don't know why. This should be necessary
@@ -136,8 +138,8 @@ bool ModListSortProxy::lessThan(const QModelIndex& left, const QModelIndex& righ
 
   switch (left.column()) {
   case ModList::COL_FLAGS: {
-    std::vector<ModInfo::EFlag> leftFlags  = leftMod->getFlags();
-    std::vector<ModInfo::EFlag> rightFlags = rightMod->getFlags();
+    const auto& leftFlags  = m_Organizer->modList()->modFlags(leftIndex);
+    const auto& rightFlags = m_Organizer->modList()->modFlags(rightIndex);
     if (leftFlags.size() != rightFlags.size()) {
       lt = leftFlags.size() < rightFlags.size();
     } else {
@@ -145,8 +147,8 @@ bool ModListSortProxy::lessThan(const QModelIndex& left, const QModelIndex& righ
     }
   } break;
   case ModList::COL_CONFLICTFLAGS: {
-    std::vector<ModInfo::EConflictFlag> leftFlags  = leftMod->getConflictFlags();
-    std::vector<ModInfo::EConflictFlag> rightFlags = rightMod->getConflictFlags();
+    const auto& leftFlags  = m_Organizer->modList()->modConflictFlags(leftIndex);
+    const auto& rightFlags = m_Organizer->modList()->modConflictFlags(rightIndex);
     if (leftFlags.size() != rightFlags.size()) {
       lt = leftFlags.size() < rightFlags.size();
     } else {
@@ -266,10 +268,171 @@ bool ModListSortProxy::lessThan(const QModelIndex& left, const QModelIndex& righ
 
 void ModListSortProxy::updateFilter(const QString& filter)
 {
-  m_Filter = filter;
+  // typing more of a word or another word only removes matches, unless the
+  // filter has alternatives or numbers, which also match nexus ids by prefix
+  const auto hasAlternatives = [](const QString& s) {
+    return s.contains('|') || s.contains(';') || s.contains("OR");
+  };
+
+  auto segments = parseFilter(filter);
+
+  bool narrows = !m_Filter.isEmpty() && filter.startsWith(m_Filter) &&
+                 !hasAlternatives(filter);
+
+  for (const auto& segment : segments) {
+    for (const auto& keyword : segment) {
+      narrows = narrows && !keyword.isId;
+    }
+  }
+
+  if (!narrows) {
+    ++m_FilterGeneration;
+  }
+
+  m_Filter         = filter;
+  m_FilterSegments = std::move(segments);
   updateFilterActive();
   refreshFilter();
   emit filterInvalidated();
+}
+
+ModListSortProxy::FilterSegments ModListSortProxy::parseFilter(const QString& filter)
+{
+  QString filterCopy = QString(filter);
+  filterCopy.replace("||", ";").replace("OR", ";").replace("|", ";");
+
+  // split in ORSegments that internally use AND logic
+  FilterSegments segments;
+  for (auto& ORSegment : filterCopy.split(";", Qt::SkipEmptyParts)) {
+    std::vector<FilterKeyword> keywords;
+    for (auto& word : ORSegment.split(" ", Qt::SkipEmptyParts)) {
+      FilterKeyword keyword;
+      keyword.text = word.toCaseFolded();
+      keyword.id   = word.toInt(&keyword.isId);
+      keywords.push_back(std::move(keyword));
+    }
+    segments.push_back(std::move(keywords));
+  }
+
+  return segments;
+}
+
+ModListSortProxy::SearchEntry&
+ModListSortProxy::searchEntry(const ModInfo::Ptr& info) const
+{
+  auto itor = m_SearchIndex.find(info.get());
+  if (itor != m_SearchIndex.end()) {
+    // a new mod can reuse the address of a deleted one
+    if (!itor->second.mod.isNull()) {
+      return itor->second;
+    }
+    m_SearchIndex.erase(itor);
+  }
+
+  SearchEntry entry;
+  entry.mod      = info;
+  entry.name     = info->name().toCaseFolded();
+  entry.author   = info->author().toCaseFolded();
+  entry.uploader = info->uploader().toCaseFolded();
+  entry.notes    = (info->notes() + "\n" + info->comments()).toCaseFolded();
+  entry.nexusId  = info->nexusId();
+
+  for (const auto& category : info->categories()) {
+    entry.categoryNames.append(category.toCaseFolded());
+  }
+
+  // walks up to the top level category, stopping at ids that were already seen
+  // through another category or that don't exist
+  const auto& factory = CategoryFactory::instance();
+  for (int id : info->getCategories()) {
+    while (id != 0 && entry.categories.insert(id).second &&
+           factory.categoryExists(id)) {
+      id = factory.getParentID(factory.getCategoryIndex(id));
+    }
+  }
+
+  return m_SearchIndex.emplace(info.get(), std::move(entry)).first->second;
+}
+
+bool ModListSortProxy::textMatchesMod(const SearchEntry& entry) const
+{
+  // each word in the segment needs to be matched but it doesn't matter where,
+  // any matching segment is enough
+  for (const auto& segment : m_FilterSegments) {
+    const bool segmentGood = std::all_of(segment.begin(), segment.end(),
+                                         [&](const FilterKeyword& keyword) {
+                                           return keywordMatchesMod(entry, keyword);
+                                         });
+
+    if (segmentGood) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool ModListSortProxy::keywordMatchesMod(const SearchEntry& entry,
+                                         const FilterKeyword& keyword) const
+{
+  if (m_EnabledColumns[ModList::COL_NAME] && entry.name.contains(keyword.text)) {
+    return true;
+  }
+
+  if (m_EnabledColumns[ModList::COL_AUTHOR] && entry.author.contains(keyword.text)) {
+    return true;
+  }
+
+  if (m_EnabledColumns[ModList::COL_UPLOADER] &&
+      entry.uploader.contains(keyword.text)) {
+    return true;
+  }
+
+  if (m_EnabledColumns[ModList::COL_NOTES] && entry.notes.contains(keyword.text)) {
+    return true;
+  }
+
+  if (m_EnabledColumns[ModList::COL_CATEGORY]) {
+    for (const auto& category : entry.categoryNames) {
+      if (category.contains(keyword.text)) {
+        return true;
+      }
+    }
+  }
+
+  // the keyword matches if it's the start of the nexus id
+  if (m_EnabledColumns[ModList::COL_MODID] && keyword.isId) {
+    int modID = entry.nexusId;
+    while (modID > 0) {
+      if (modID == keyword.id) {
+        return true;
+      }
+      modID = (int)(modID / 10);
+    }
+  }
+
+  return false;
+}
+
+void ModListSortProxy::onSourceDataChanged(const QModelIndex& topLeft,
+                                           const QModelIndex& bottomRight)
+{
+  // priorities aren't searched
+  if (topLeft.column() == ModList::COL_PRIORITY &&
+      bottomRight.column() == ModList::COL_PRIORITY) {
+    return;
+  }
+
+  for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+    if (row >= 0 && static_cast<unsigned int>(row) < ModInfo::getNumMods()) {
+      m_SearchIndex.erase(ModInfo::getByIndex(row).get());
+    }
+  }
+}
+
+void ModListSortProxy::clearSearchIndex()
+{
+  m_SearchIndex.clear();
 }
 
 bool ModListSortProxy::hasConflictFlag(
@@ -422,7 +585,7 @@ bool ModListSortProxy::categoryMatchesMod(ModInfo::Ptr info, bool enabled,
   }
 
   default: {
-    b = (info->categorySet(category));
+    b = searchEntry(info).categories.count(category) != 0;
     break;
   }
   }
@@ -464,97 +627,18 @@ bool ModListSortProxy::filterMatchesMod(ModInfo::Ptr info, bool enabled) const
   }
 
   if (!m_Filter.isEmpty()) {
-    bool display       = false;
-    QString filterCopy = QString(m_Filter);
-    filterCopy.replace("||", ";").replace("OR", ";").replace("|", ";");
-    QStringList ORList = filterCopy.split(";", Qt::SkipEmptyParts);
-
-    bool segmentGood = true;
-
-    // split in ORSegments that internally use AND logic
-    for (auto& ORSegment : ORList) {
-      QStringList ANDKeywords = ORSegment.split(" ", Qt::SkipEmptyParts);
-      segmentGood             = true;
-      bool foundKeyword       = false;
-
-      // check each word in the segment for match, each word needs to be matched but
-      // it doesn't matter where.
-      for (auto& currentKeyword : ANDKeywords) {
-        foundKeyword = false;
-
-        // search keyword in name
-        if (m_EnabledColumns[ModList::COL_NAME] &&
-            info->name().contains(currentKeyword, Qt::CaseInsensitive)) {
-          foundKeyword = true;
-        }
-
-        // Search by author
-        if (!foundKeyword && m_EnabledColumns[ModList::COL_AUTHOR] &&
-            info->author().contains(currentKeyword, Qt::CaseInsensitive)) {
-          foundKeyword = true;
-        }
-
-        // Search by uploader
-        if (!foundKeyword && m_EnabledColumns[ModList::COL_UPLOADER] &&
-            info->uploader().contains(currentKeyword, Qt::CaseInsensitive)) {
-          foundKeyword = true;
-        }
-
-        // Search by notes
-        if (!foundKeyword && m_EnabledColumns[ModList::COL_NOTES] &&
-            (info->notes().contains(currentKeyword, Qt::CaseInsensitive) ||
-             info->comments().contains(currentKeyword, Qt::CaseInsensitive))) {
-          foundKeyword = true;
-        }
+    SearchEntry& entry = searchEntry(info);
 
-        // Search by categories
-        if (!foundKeyword && m_EnabledColumns[ModList::COL_CATEGORY]) {
-          for (auto category : info->categories()) {
-            if (category.contains(currentKeyword, Qt::CaseInsensitive)) {
-              foundKeyword = true;
-              break;
-            }
-          }
-        }
-
-        // Search by Nexus ID
-        if (!foundKeyword && m_EnabledColumns[ModList::COL_MODID]) {
-          bool ok;
-          int filterID = currentKeyword.toInt(&ok);
-          if (ok) {
-            int modID = info->nexusId();
-            while (modID > 0) {
-              if (modID == filterID) {
-                foundKeyword = true;
-                break;
-              }
-              modID = (int)(modID / 10);
-            }
-          }
-        }
-
-        if (!foundKeyword) {
-          // currentKeword is missing from everything, AND fails and we need to check
-          // next ORsegment
-          segmentGood = false;
-          break;
-        }
-
-      }  // for ANDKeywords loop
-
-      if (segmentGood) {
-        // the last AND loop didn't break so the ORSegments is true so mod matches
-        // filter
-        display = true;
-        break;
-      }
-
-    }  // for ORList loop
+    // a mod rejected by a filter that this one only narrows down can't match
+    if (entry.rejectedGeneration == m_FilterGeneration) {
+      return false;
+    }
 
-    if (!display) {
+    if (!textMatchesMod(entry)) {
+      entry.rejectedGeneration = m_FilterGeneration;
       return false;
     }
-  }  // if (!m_CurrentFilter.isEmpty())
+  }
 
   if (m_FilterMode == FilterAnd) {
     return filterMatchesModAnd(info, enabled);
@@ -566,6 +650,9 @@ bool ModListSortProxy::filterMatchesMod(ModInfo::Ptr info, bool enabled) const
 void ModListSortProxy::setColumnVisible(int column, bool visible)
 {
   m_EnabledColumns[column] = visible;
+
+  // searching a new column can match rejected mods
+  ++m_FilterGeneration;
 }
 
 void ModListSortProxy::setOptions(ModListSortProxy::FilterMode mode,
@@ -701,6 +788,16 @@ void ModListSortProxy::setSourceModel(QAbstractItemModel* sourceModel)
             Qt::UniqueConnection);
     connect(sourceModel, SIGNAL(postDataChanged()), this, SLOT(postDataChanged()),
             Qt::UniqueConnection);
+
+    // rows of the mod list are mod indexes
+    connect(sourceModel, &QAbstractItemModel::dataChanged, this,
+            &ModListSortProxy::onSourceDataChanged, Qt::UniqueConnection);
+    connect(sourceModel, &QAbstractItemModel::modelReset, this,
+            &ModListSortProxy::clearSearchIndex, Qt::UniqueConnection);
+    connect(sourceModel, &QAbstractItemModel::rowsInserted, this,
+            &ModListSortProxy::clearSearchIndex, Qt::UniqueConnection);
+    connect(sourceModel, &QAbstractItemModel::rowsRemoved, this,
+            &ModListSortProxy::clearSearchIndex, Qt::UniqueConnection);
   }
 }
 
@@ -23,6 +23,9 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "modlist.h"
 #include <QSortFilterProxyModel>
 #include <bitset>
+#include <set>
+#include <unordered_map>
+#include <vector>
 
 class Profile;
 class OrganizerCore;
@@ -128,6 +131,45 @@ protected:
   virtual bool filterAcceptsRow(int row, const QModelIndex& parent) const;
 
 private:
+  // a word of the text filter, numbers also match the nexus id
+  struct FilterKeyword
+  {
+    QString text;
+    bool isId = false;
+    int id    = 0;
+  };
+
+  // the text filter split at its alternatives, each one holding the keywords that
+  // must all be found
+  using FilterSegments = std::vector<std::vector<FilterKeyword>>;
+
+  // case folded text of a mod and its categories with all their parents, built
+  // the first time the mod is filtered and kept until the mod changes
+  struct SearchEntry
+  {
+    // doesn't keep deleted mods alive, they save their meta file when they go
+    QWeakPointer<ModInfo> mod;
+    QString name;
+    QString author;
+    QString uploader;
+    QString notes;
+    QStringList categoryNames;
+    std::set<int> categories;
+    int nexusId = 0;
+
+    // generation of the text filter that last rejected this mod
+    unsigned int rejectedGeneration = 0;
+  };
+
+  static FilterSegments parseFilter(const QString& filter);
+
+  SearchEntry& searchEntry(const ModInfo::Ptr& info) const;
+  bool textMatchesMod(const SearchEntry& entry) const;
+  bool keywordMatchesMod(const SearchEntry& entry, const FilterKeyword& keyword) const;
+
+  void onSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight);
+  void clearSearchIndex();
+
   void refreshFilter();
   unsigned long flagsId(const std::vector<ModInfo::EFlag>& flags) const;
   unsigned long conflictFlagsId(const std::vector<ModInfo::EConflictFlag>& flags) const;
@@ -151,6 +193,7 @@ private:
   Profile* m_Profile;
   std::vector<Criteria> m_Criteria;
   QString m_Filter;
+  FilterSegments m_FilterSegments;
   std::bitset<ModList::COL_LASTCOLUMN + 1> m_EnabledColumns;
 
   bool m_FilterActive;
@@ -159,6 +202,11 @@ private:
 
   std::vector<Criteria> m_PreChangeCriteria;
 
+  // bumped whenever the text filter could match mods it rejected before, as long
+  // as it doesn't change the rejected mods are skipped
+  unsigned int m_FilterGeneration;
+  mutable std::unordered_map<const ModInfo*, SearchEntry> m_SearchIndex;
+
   bool optionsMatchMod(ModInfo::Ptr info, bool enabled) const;
   bool criteriaMatchMod(ModInfo::Ptr info, bool enabled, const Criteria& c) const;
   bool categoryMatchesMod(ModInfo::Ptr info, bool enabled, int category) const;
@@ -11,6 +11,7 @@
 #include "ui_mainwindow.h"
 
 #include "copyeventfilter.h"
+#include "dircopy.h"
 #include "filterlist.h"
 #include "genericicondelegate.h"
 #include "log.h"
@@ -608,9 +609,9 @@ void ModListView::onExternalFolderDropped(const QUrl& url, int priority)
     return;
   }
 
-  // TODO: this is currently a silent copy, which can take some time, but there is
-  // no clean method to do this in uibase
-  if (!copyDir(fileInfo.absoluteFilePath(), newMod->absolutePath(), true)) {
+  // TODO: this is currently a silent copy, which is quick where the files can be
+  // cloned but can take some time otherwise
+  if (!copyDirectory(fileInfo.absoluteFilePath(), newMod->absolutePath(), true)) {
     return;
   }
 
@@ -1059,6 +1060,7 @@ void ModListView::clearOverwriteMarkers()
   m_markers.archiveOverwritten.clear();
   m_markers.archiveLooseOverwrite.clear();
   m_markers.archiveLooseOverwritten.clear();
+  m_scrollbar->invalidateMarkers();
 }
 
 void ModListView::setOverwriteMarkers(const QModelIndexList& indexes)
@@ -1122,6 +1124,7 @@ void ModListView::setHighlightedMods(const std::set<QString>& modNames)
   dataChanged(model()->index(0, 0),
               model()->index(model()->rowCount() ? model()->rowCount() - 1 : 0,
                              model()->columnCount() ? model()->columnCount() - 1 : 0));
+  m_scrollbar->invalidateMarkers();
   verticalScrollBar()->repaint();
 }
 
@@ -1189,9 +1192,10 @@ QColor ModListView::markerColor(const QModelIndex& index) const
 std::vector<ModInfo::EFlag> ModListView::modFlags(const QModelIndex& index,
                                                   bool* forceCompact) const
 {
-  ModInfo::Ptr info = ModInfo::getByIndex(index.data(ModList::IndexRole).toInt());
+  const unsigned int modIndex = index.data(ModList::IndexRole).toInt();
+  ModInfo::Ptr info           = ModInfo::getByIndex(modIndex);
 
-  auto flags   = info->getFlags();
+  auto flags   = m_core->modList()->modFlags(modIndex);
   bool compact = false;
   if (info->isSeparator() && hasCollapsibleSeparators() &&
       m_core->settings().interface().collapsibleSeparatorsIcons(ModList::COL_FLAGS) &&
@@ -1202,7 +1206,7 @@ std::vector<ModInfo::EFlag> ModListView::modFlags(const QModelIndex& index,
     for (int i = 0; i < model()->rowCount(index); ++i) {
       auto cIndex =
           model()->index(i, index.column(), index).data(ModList::IndexRole).toInt();
-      auto cFlags = ModInfo::getByIndex(cIndex)->getFlags();
+      const auto& cFlags = m_core->modList()->modFlags(cIndex);
       eFlags.insert(cFlags.begin(), cFlags.end());
     }
     flags = {eFlags.begin(), eFlags.end()};
@@ -1221,9 +1225,10 @@ std::vector<ModInfo::EFlag> ModListView::modFlags(const QModelIndex& index,
 std::vector<ModInfo::EConflictFlag> ModListView::conflictFlags(const QModelIndex& index,
                                                                bool* forceCompact) const
 {
-  ModInfo::Ptr info = ModInfo::getByIndex(index.data(ModList::IndexRole).toInt());
+  const unsigned int modIndex = index.data(ModList::IndexRole).toInt();
+  ModInfo::Ptr info           = ModInfo::getByIndex(modIndex);
 
-  auto flags   = info->getConflictFlags();
+  auto flags   = m_core->modList()->modConflictFlags(modIndex);
   bool compact = false;
   if (info->isSeparator() && hasCollapsibleSeparators() &&
       m_core->settings().interface().collapsibleSeparatorsIcons(
@@ -1235,7 +1240,7 @@ std::vector<ModInfo::EConflictFlag> ModListView::conflictFlags(const QModelIndex
     for (int i = 0; i < model()->rowCount(index); ++i) {
       auto cIndex =
           model()->index(i, index.column(), index).data(ModList::IndexRole).toInt();
-      auto cFlags = ModInfo::getByIndex(cIndex)->getConflictFlags();
+      const auto& cFlags = m_core->modList()->modConflictFlags(cIndex);
       eFlags.insert(cFlags.begin(), cFlags.end());
     }
     flags = {eFlags.begin(), eFlags.end()};
@@ -1,9 +1,12 @@
 #include "modlistviewactions.h"
 
+#include <QFutureWatcher>
 #include <QGridLayout>
 #include <QGroupBox>
 #include <QInputDialog>
 #include <QLabel>
+#include <QProgressDialog>
+#include <QtConcurrent/QtConcurrentRun>
 
 #include "filesystemutilities.h"
 #include <log.h>
@@ -11,6 +14,7 @@
 
 #include "categories.h"
 #include "csvbuilder.h"
+#include "dircopy.h"
 #include "directoryrefresher.h"
 #include "downloadmanager.h"
 #include "filedialogmemory.h"
@@ -18,6 +22,7 @@
 #include "listdialog.h"
 #include "messagedialog.h"
 #include "modelutils.h"
+#include "modimage.h"
 #include "modinfodialog.h"
 #include "modlist.h"
 #include "modlistview.h"
@@ -611,24 +616,35 @@ void ModListViewActions::displayModInformation(ModInfo::Ptr modInfo,
     emit modInfoDisplayed();
   }
 
-  if (m_core.currentProfile()->modEnabled(modIndex) && !modInfo->isForeign()) {
-    FilesOrigin& origin =
-        m_core.directoryStructure()->getOriginByName(ToWString(modInfo->name()));
-    origin.enable(false);
-
-    if (m_core.directoryStructure()->originExists(ToWString(modInfo->name()))) {
+  if (m_core.directoryUpdating()) {
+    // the running refresh may have read the mod before it was edited
+    m_core.refreshDirectoryStructure();
+  } else if (m_core.currentProfile()->modEnabled(modIndex) && !modInfo->isForeign()) {
+    bool readded = false;
+    {
+      OrganizerCore::DirectoryStructurePatch patch(m_core);
       FilesOrigin& origin =
           m_core.directoryStructure()->getOriginByName(ToWString(modInfo->name()));
       origin.enable(false);
-      QString path       = modInfo->absolutePath();
-      QString modDataDir = m_core.managedGame()->modDataDirectory();
-      path               = modDataDir.isEmpty() ? path : path + "/" + modDataDir;
-      m_core.directoryRefresher()->addModToStructure(
-          m_core.directoryStructure(), modInfo->name(),
-          m_core.currentProfile()->getModPriority(modIndex), path,
-          modInfo->stealFiles(), modInfo->archives());
-      DirectoryRefresher::cleanStructure(m_core.directoryStructure());
-      m_core.directoryStructure()->getFileRegister()->sortOrigins();
+
+      if (m_core.directoryStructure()->originExists(ToWString(modInfo->name()))) {
+        FilesOrigin& origin =
+            m_core.directoryStructure()->getOriginByName(ToWString(modInfo->name()));
+        origin.enable(false);
+        QString path       = modInfo->absolutePath();
+        QString modDataDir = m_core.managedGame()->modDataDirectory();
+        path               = modDataDir.isEmpty() ? path : path + "/" + modDataDir;
+        m_core.directoryRefresher()->addModToStructure(
+            m_core.directoryStructure(), modInfo->name(),
+            m_core.currentProfile()->getModPriority(modIndex), path,
+            modInfo->stealFiles(), modInfo->archives());
+        DirectoryRefresher::cleanStructure(m_core.directoryStructure());
+        m_core.directoryStructure()->getFileRegister()->sortOrigins();
+        readded = true;
+      }
+    }
+
+    if (readded) {
       m_core.refreshLists();
     }
   }
@@ -818,11 +834,10 @@ void ModListViewActions::removeMods(const QModelIndexList& indices) const
               QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes) {
         // use mod names instead of indexes because those become invalid during the
         // removal
-        DownloadManager::startDisableDirWatcher();
+        OrganizerCore::RefreshTransaction refreshTransaction(m_core);
         for (QString name : modNames) {
           m_core.modList()->removeRowForce(ModInfo::getIndex(name), QModelIndex());
         }
-        DownloadManager::endDisableDirWatcher();
       }
     } else if (!indices.isEmpty()) {
       m_core.modList()->removeRow(indices[0].data(ModList::IndexRole).toInt(),
@@ -1039,7 +1054,7 @@ void ModListViewActions::createBackup(const QModelIndex& index) const
   ModInfo::Ptr modInfo = ModInfo::getByIndex(index.data(ModList::IndexRole).toInt());
   QString backupDirectory =
       m_core.installationManager()->generateBackupName(modInfo->absolutePath());
-  if (!copyDir(modInfo->absolutePath(), backupDirectory, false)) {
+  if (!copyDirectory(modInfo->absolutePath(), backupDirectory, false)) {
     QMessageBox::information(m_parent, tr("Failed"), tr("Failed to create backup."));
   }
   m_core.refresh();
@@ -1057,6 +1072,32 @@ void ModListViewActions::restoreHiddenFiles(const QModelIndexList& indices) cons
 
   FileRenamer::RenameResults result = FileRenamer::RESULT_OK;
 
+  // the hidden files of active mods are known from the directory structure,
+  // which is patched with the renames; other mods are listed and read again
+  const auto restore = [&](ModInfo::Ptr modInfo) {
+    auto* ds        = m_core.directoryStructure();
+    const auto name = ToWString(modInfo->internalName());
+
+    if (!ds->originExists(name)) {
+      return restoreHiddenFilesRecursive(renamer, modInfo->absolutePath());
+    }
+
+    FilesOrigin& origin = ds->getOriginByName(name);
+
+    // files outside of the mod data directory aren't in the structure
+    if (origin.isDisabled() || !m_core.managedGame()->modDataDirectory().isEmpty()) {
+      const auto r = restoreHiddenFilesRecursive(renamer, modInfo->absolutePath());
+      emit originModified(origin.getID());
+      return r;
+    }
+
+    std::vector<std::pair<QString, QString>> renamed;
+    const auto r = restoreHiddenFiles(renamer, origin, renamed);
+    m_core.applyModRenames(origin.getID(), renamed);
+
+    return r;
+  };
+
   // multi selection
   if (indices.size() > 1) {
 
@@ -1094,17 +1135,12 @@ void ModListViewActions::restoreHiddenFiles(const QModelIndexList& indices) cons
         const auto flags = modInfo->getFlags();
         if (std::find(flags.begin(), flags.end(), ModInfo::FLAG_HIDDEN_FILES) !=
             flags.end()) {
-          const QString modDir = modInfo->absolutePath();
-
-          auto partialResult = restoreHiddenFilesRecursive(renamer, modDir);
+          auto partialResult = restore(modInfo);
 
           if (partialResult == FileRenamer::RESULT_CANCEL) {
             result = FileRenamer::RESULT_CANCEL;
             break;
           }
-          emit originModified((m_core.directoryStructure()->getOriginByName(
-                                   ToWString(modInfo->internalName())))
-                                  .getID());
         }
       }
     }
@@ -1112,18 +1148,13 @@ void ModListViewActions::restoreHiddenFiles(const QModelIndexList& indices) cons
     // single selection
     ModInfo::Ptr modInfo =
         ModInfo::getByIndex(indices[0].data(ModList::IndexRole).toInt());
-    const QString modDir = modInfo->absolutePath();
 
     if (QMessageBox::question(
             m_parent, tr("Are you sure?"),
             tr("About to restore all hidden files in:\n") + modInfo->name(),
             QMessageBox::Ok | QMessageBox::Cancel) == QMessageBox::Ok) {
 
-      result = restoreHiddenFilesRecursive(renamer, modDir);
-
-      emit originModified((m_core.directoryStructure()->getOriginByName(
-                               ToWString(modInfo->internalName())))
-                              .getID());
+      result = restore(modInfo);
     }
   }
 
@@ -1134,6 +1165,63 @@ void ModListViewActions::restoreHiddenFiles(const QModelIndexList& indices) cons
   }
 }
 
+void ModListViewActions::setPacked(const QModelIndexList& indices, bool packed) const
+{
+  QStringList paths;
+  for (auto& idx : indices) {
+    ModInfo::Ptr modInfo = ModInfo::getByIndex(idx.data(ModList::IndexRole).toInt());
+    if (modInfo->isRegular() &&
+        modImagePath(modInfo->absolutePath()).isEmpty() == packed) {
+      paths.append(modInfo->absolutePath());
+    }
+  }
+
+  if (paths.isEmpty()) {
+    return;
+  }
+
+  if (packed && QMessageBox::question(
+                    m_parent, tr("Pack into Image"),
+                    tr("Replace the files of %n mod(s) by a compressed read-only "
+                       "image? The files can't be changed until the mod is "
+                       "unpacked again.",
+                       "", paths.size()),
+                    QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes) {
+    return;
+  }
+
+  QProgressDialog dialog(packed ? tr("Packing mods...") : tr("Unpacking mods..."),
+                         QString(), 0, 0, m_parent);
+  dialog.setWindowModality(Qt::WindowModal);
+  dialog.setMinimumDuration(0);
+
+  QFutureWatcher<QStringList> watcher;
+  connect(&watcher, &QFutureWatcherBase::finished, &dialog, &QProgressDialog::accept);
+
+  watcher.setFuture(QtConcurrent::run([paths, packed] {
+    QStringList errors;
+    for (const QString& path : paths) {
+      QString error;
+      if (!(packed ? packMod(path, error) : unpackMod(path, error))) {
+        log::error("failed to {} '{}', {}", packed ? "pack" : "unpack", path, error);
+        errors.append(QFileInfo(path).fileName() + ": " + error);
+      }
+    }
+    return errors;
+  }));
+
+  if (!watcher.isFinished()) {
+    dialog.exec();
+  }
+  watcher.waitForFinished();
+
+  if (const QStringList errors = watcher.result(); !errors.isEmpty()) {
+    QMessageBox::warning(m_parent, tr("Failed"), errors.join("\n"));
+  }
+
+  m_core.refresh();
+}
+
 void ModListViewActions::setTracked(const QModelIndexList& indices, bool tracked) const
 {
   m_core.loggedInAction(m_parent, [=, this] {
@@ -96,6 +96,11 @@ public:
   void reinstallMod(const QModelIndex& index) const;
   void createBackup(const QModelIndex& index) const;
   void restoreHiddenFiles(const QModelIndexList& indices) const;
+
+  // packs the mods into compressed images or extracts them again, see
+  // modimage.h
+  //
+  void setPacked(const QModelIndexList& indices, bool packed) const;
   void setTracked(const QModelIndexList& indices, bool tracked) const;
   void setEndorsed(const QModelIndexList& indices, bool endorsed) const;
   void willNotEndorsed(const QModelIndexList& indices) const;
@@ -0,0 +1,181 @@
+#include "modmetacache.h"
+#include "inireader.h"
+#include "vfs/layercache.h"
+
+#include <uibase/log.h>
+
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTimeZone>
+
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+using namespace MOBase;
+namespace fs = std::filesystem;
+
+namespace
+{
+
+constexpr char Magic[8]      = {'M', 'O', '2', 'M', 'E', 'T', 'A', 'C'};
+constexpr quint32 Version    = 1;
+constexpr const char* Name   = "mod_meta_cache.bin";
+constexpr auto StreamVersion = QDataStream::Qt_6_0;
+
+// size and modification time of the meta.ini, false if it doesn't exist
+//
+bool metaStamp(const QString& path, qint64& size, qint64& writeTime)
+{
+  const QFileInfo info(path);
+  if (!info.exists()) {
+    return false;
+  }
+
+  size      = info.size();
+  writeTime = info.lastModified(QTimeZone::UTC).toMSecsSinceEpoch();
+  return true;
+}
+
+}  // namespace
+
+ModMetaCache::ModMetaCache(QString path) : m_path(std::move(path))
+{
+  load();
+}
+
+void ModMetaCache::load()
+{
+  QFile file(m_path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return;
+  }
+
+  QDataStream in(&file);
+  in.setVersion(StreamVersion);
+
+  char magic[sizeof(Magic)] = {};
+  quint32 version           = 0;
+  quint32 count             = 0;
+
+  if (in.readRawData(magic, sizeof(magic)) != sizeof(magic) ||
+      std::memcmp(magic, Magic, sizeof(Magic)) != 0) {
+    return;
+  }
+
+  in >> version >> count;
+  if (in.status() != QDataStream::Ok || version != Version) {
+    return;
+  }
+
+  for (quint32 i = 0; i < count; ++i) {
+    QString path;
+    Entry entry;
+
+    in >> path >> entry.fileSize >> entry.writeTime >> entry.values;
+    if (in.status() != QDataStream::Ok) {
+      // keeps what was read so far, the rest is parsed again
+      return;
+    }
+
+    m_entries.insert_or_assign(std::move(path), std::move(entry));
+  }
+}
+
+QVariantMap ModMetaCache::get(const QString& path)
+{
+  qint64 size      = 0;
+  qint64 writeTime = 0;
+
+  const bool exists = metaStamp(path, size, writeTime);
+
+  {
+    std::scoped_lock lock(m_mutex);
+    m_used.insert(path);
+
+    if (auto itor = m_entries.find(path); itor != m_entries.end()) {
+      if (exists && itor->second.fileSize == size &&
+          itor->second.writeTime == writeTime) {
+        return itor->second.values;
+      }
+    }
+  }
+
+  QVariantMap values = readIniValues(path);
+
+  std::scoped_lock lock(m_mutex);
+  if (exists) {
+    m_entries.insert_or_assign(path, Entry{size, writeTime, values});
+    m_dirty = true;
+  } else if (m_entries.erase(path) > 0) {
+    m_dirty = true;
+  }
+
+  return values;
+}
+
+bool ModMetaCache::save()
+{
+  std::vector<std::pair<QString, Entry>> entries;
+  {
+    std::scoped_lock lock(m_mutex);
+    if (!m_dirty) {
+      return true;
+    }
+    // mods nobody asked for in this run were removed
+    for (const auto& [path, entry] : m_entries) {
+      if (m_used.contains(path)) {
+        entries.emplace_back(path, entry);
+      }
+    }
+    m_dirty = false;
+  }
+
+  const auto failed = [this] {
+    std::scoped_lock lock(m_mutex);
+    m_dirty = true;
+    return false;
+  };
+
+  QSaveFile file(m_path);
+  if (!file.open(QIODevice::WriteOnly)) {
+    return failed();
+  }
+
+  QDataStream out(&file);
+  out.setVersion(StreamVersion);
+
+  out.writeRawData(Magic, sizeof(Magic));
+  out << Version << static_cast<quint32>(entries.size());
+
+  for (const auto& [path, entry] : entries) {
+    out << path << entry.fileSize << entry.writeTime << entry.values;
+  }
+
+  if (out.status() != QDataStream::Ok || !file.commit()) {
+    log::warn("failed to write mod meta cache '{}', {}", m_path, file.errorString());
+    return failed();
+  }
+
+  return true;
+}
+
+std::shared_ptr<ModMetaCache> sharedModMetaCache(const QString& overwriteDir)
+{
+  static std::mutex mutex;
+  static std::shared_ptr<ModMetaCache> cache;
+  static QString cachePath;
+
+  const fs::path layerCache = layerCachePath(overwriteDir.toStdString());
+  const QString path =
+      QString::fromStdWString((layerCache.parent_path() / Name).wstring());
+
+  std::scoped_lock lock(mutex);
+  if (cache == nullptr || cachePath != path) {
+    cache     = std::make_shared<ModMetaCache>(path);
+    cachePath = path;
+  }
+  return cache;
+}
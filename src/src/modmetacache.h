@@ -0,0 +1,56 @@
+#ifndef MODMETACACHE_H
+#define MODMETACACHE_H
+
+#include <QString>
+#include <QVariantMap>
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+// The values of the meta.ini of every mod persisted next to the instance, so
+// a cold start only parses the files that changed since the last run.  Entries
+// are checked against the size and modification time of the file whenever
+// they're handed out.
+//
+// All members are thread-safe.
+class ModMetaCache
+{
+public:
+  explicit ModMetaCache(QString path);
+
+  // the cached values of the meta.ini at `path` if they're still current,
+  // reading the file with readIniValues() and caching the result otherwise
+  //
+  QVariantMap get(const QString& path);
+
+  // writes the values used by this process if anything changed since the
+  // file was loaded or last saved
+  //
+  bool save();
+
+private:
+  struct Entry
+  {
+    // of the meta.ini itself, the values are stale once either changes
+    qint64 fileSize  = 0;
+    qint64 writeTime = 0;
+    QVariantMap values;
+  };
+
+  void load();
+
+  QString m_path;
+  mutable std::mutex m_mutex;
+  std::unordered_map<QString, Entry> m_entries;
+  std::unordered_set<QString> m_used;
+  bool m_dirty = false;
+};
+
+// process-wide cache for the instance owning `overwriteDir`, loaded on first
+// use
+//
+std::shared_ptr<ModMetaCache> sharedModMetaCache(const QString& overwriteDir);
+
+#endif  // MODMETACACHE_H
@@ -34,6 +34,8 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QNetworkCookieJar>
 #include <QRegularExpression>
 
+#include <algorithm>
+#include <memory>
 #include <regex>
 
 using namespace MOBase;
@@ -271,7 +273,8 @@ NexusInterface::parseLimits(const QList<QNetworkReply::RawHeaderPair>& headers)
 
 static NexusInterface* g_instance = nullptr;
 
-NexusInterface::NexusInterface(Settings* s) : m_PluginContainer(nullptr)
+NexusInterface::NexusInterface(Settings* s)
+    : m_Settings(s), m_Window(MAX_ACTIVE_REQUESTS), m_PluginContainer(nullptr)
 {
   MO_ASSERT(!g_instance);
   g_instance = this;
@@ -470,7 +473,7 @@ int NexusInterface::requestDescription(QString gameName, int modID, QObject* rec
 {
   NXMRequestInfo requestInfo(modID, NXMRequestInfo::TYPE_DESCRIPTION, userData,
                              subModule, game);
-  m_RequestQueue.enqueue(requestInfo);
+  queueRequest(requestInfo);
 
   connect(this, SIGNAL(nxmDescriptionAvailable(QString, int, QVariant, QVariant, int)),
           receiver,
@@ -497,7 +500,7 @@ int NexusInterface::requestModInfo(QString gameName, int modID, QObject* receive
 
   NXMRequestInfo requestInfo(modID, NXMRequestInfo::TYPE_MODINFO, userData, subModule,
                              game);
-  m_RequestQueue.enqueue(requestInfo);
+  queueRequest(requestInfo);
 
   connect(this, SIGNAL(nxmModInfoAvailable(QString, int, QVariant, QVariant, int)),
           receiver, SLOT(nxmModInfoAvailable(QString, int, QVariant, QVariant, int)),
@@ -525,7 +528,7 @@ int NexusInterface::requestUpdateInfo(QString gameName,
 
   NXMRequestInfo requestInfo(period, NXMRequestInfo::TYPE_CHECKUPDATES, userData,
                              subModule, game);
-  m_RequestQueue.enqueue(requestInfo);
+  queueRequest(requestInfo);
 
   connect(this, SIGNAL(nxmUpdateInfoAvailable(QString, QVariant, QVariant, int)),
           receiver, SLOT(nxmUpdateInfoAvailable(QString, QVariant, QVariant, int)),
@@ -557,7 +560,7 @@ int NexusInterface::requestUpdates(const int& modID, QObject* receiver,
 
   NXMRequestInfo requestInfo(modID, NXMRequestInfo::TYPE_GETUPDATES, userData,
                              subModule, game);
-  m_RequestQueue.enqueue(requestInfo);
+  queueRequest(requestInfo);
 
   connect(this, SIGNAL(nxmUpdatesAvailable(QString, int, QVariant, QVariant, int)),
           receiver, SLOT(nxmUpdatesAvailable(QString, int, QVariant, QVariant, int)),
@@ -599,7 +602,7 @@ int NexusInterface::requestFiles(QString gameName, int modID, QObject* receiver,
 {
   NXMRequestInfo requestInfo(modID, NXMRequestInfo::TYPE_FILES, userData, subModule,
                              game);
-  m_RequestQueue.enqueue(requestInfo);
+  queueRequest(requestInfo);
   connect(this, SIGNAL(nxmFilesAvailable(QString, int, QVariant, QVariant, int)),
           receiver, SLOT(nxmFilesAvailable(QString, int, QVariant, QVariant, int)),
           Qt::UniqueConnection);
@@ -625,7 +628,7 @@ int NexusInterface::requestFileInfo(QString gameName, int modID, int fileID,
 
   NXMRequestInfo requestInfo(modID, fileID, NXMRequestInfo::TYPE_FILEINFO, userData,
                              subModule, gamePlugin);
-  m_RequestQueue.enqueue(requestInfo);
+  queueRequest(requestInfo);
 
   connect(
       this, SIGNAL(nxmFileInfoAvailable(QString, int, int, QVariant, QVariant, int)),
@@ -648,7 +651,7 @@ int NexusInterface::requestDownloadURL(QString gameName, int modID, int fileID,
 {
   NXMRequestInfo requestInfo(modID, fileID, NXMRequestInfo::TYPE_DOWNLOADURL, userData,
                              subModule, game);
-  m_RequestQueue.enqueue(requestInfo);
+  queueRequest(requestInfo);
 
   connect(this,
           SIGNAL(nxmDownloadURLsAvailable(QString, int, int, QVariant, QVariant, int)),
@@ -669,7 +672,7 @@ int NexusInterface::requestEndorsementInfo(QObject* receiver, QVariant userData,
                                            const QString& subModule)
 {
   NXMRequestInfo requestInfo(NXMRequestInfo::TYPE_ENDORSEMENTS, userData, subModule);
-  m_RequestQueue.enqueue(requestInfo);
+  queueRequest(requestInfo);
 
   connect(this, SIGNAL(nxmEndorsementsAvailable(QVariant, QVariant, int)), receiver,
           SLOT(nxmEndorsementsAvailable(QVariant, QVariant, int)),
@@ -698,7 +701,7 @@ int NexusInterface::requestToggleEndorsement(QString gameName, int modID,
   NXMRequestInfo requestInfo(modID, modVersion, NXMRequestInfo::TYPE_TOGGLEENDORSEMENT,
                              userData, subModule, game);
   requestInfo.m_Endorse = endorse;
-  m_RequestQueue.enqueue(requestInfo);
+  queueRequest(requestInfo);
 
   connect(this, SIGNAL(nxmEndorsementToggled(QString, int, QVariant, QVariant, int)),
           receiver, SLOT(nxmEndorsementToggled(QString, int, QVariant, QVariant, int)),
@@ -717,7 +720,7 @@ int NexusInterface::requestTrackingInfo(QObject* receiver, QVariant userData,
                                         const QString& subModule)
 {
   NXMRequestInfo requestInfo(NXMRequestInfo::TYPE_TRACKEDMODS, userData, subModule);
-  m_RequestQueue.enqueue(requestInfo);
+  queueRequest(requestInfo);
 
   connect(this, SIGNAL(nxmTrackedModsAvailable(QVariant, QVariant, int)), receiver,
           SLOT(nxmTrackedModsAvailable(QVariant, QVariant, int)), Qt::UniqueConnection);
@@ -744,7 +747,7 @@ int NexusInterface::requestToggleTracking(QString gameName, int modID, bool trac
   NXMRequestInfo requestInfo(modID, NXMRequestInfo::TYPE_TOGGLETRACKING, userData,
                              subModule, game);
   requestInfo.m_Track = track;
-  m_RequestQueue.enqueue(requestInfo);
+  queueRequest(requestInfo);
 
   connect(this, SIGNAL(nxmTrackingToggled(QString, int, QVariant, bool, int)), receiver,
           SLOT(nxmTrackingToggled(QString, int, QVariant, bool, int)),
@@ -769,7 +772,7 @@ int NexusInterface::requestGameInfo(QString gameName, QObject* receiver,
   }
 
   NXMRequestInfo requestInfo(NXMRequestInfo::TYPE_GAMEINFO, userData, subModule, game);
-  m_RequestQueue.enqueue(requestInfo);
+  queueRequest(requestInfo);
 
   connect(this, SIGNAL(nxmGameInfoAvailable(QString, QVariant, QVariant, int)),
           receiver, SLOT(nxmGameInfoAvailable(QString, QVariant, QVariant, int)),
@@ -795,7 +798,7 @@ int NexusInterface::requestInfoFromMd5(QString gameName, QByteArray& hash,
   requestInfo.m_AllowedErrors[QNetworkReply::NetworkError::ContentNotFoundError].append(
       404);
   requestInfo.m_IgnoreGenericErrorHandler = true;
-  m_RequestQueue.enqueue(requestInfo);
+  queueRequest(requestInfo);
 
   connect(this, SIGNAL(nxmFileInfoFromMd5Available(QString, QVariant, QVariant, int)),
           receiver, SLOT(nxmFileInfoFromMd5Available(QString, QVariant, QVariant, int)),
@@ -836,18 +839,61 @@ void NexusInterface::clearCache()
   m_AccessManager->clearCookies();
 }
 
+int NexusInterface::maxActiveRequests() const
+{
+  const int configured = m_Settings ? m_Settings->network().maxActiveAPIRequests()
+                                    : MAX_ACTIVE_REQUESTS;
+
+  return std::clamp(configured, 1, MAX_ACTIVE_REQUESTS_LIMIT);
+}
+
+int NexusInterface::requestWindow() const
+{
+  if (m_User.shouldThrottle()) {
+    // close to the limit, don't let a burst of requests go over it
+    return 1;
+  }
+
+  return std::clamp(m_Window, 1, maxActiveRequests());
+}
+
+bool NexusInterface::isBackground(const NXMRequestInfo& info)
+{
+  // sent in bulk by the update checks, nobody is waiting for them
+  return info.m_Type == NXMRequestInfo::TYPE_CHECKUPDATES ||
+         info.m_Type == NXMRequestInfo::TYPE_GETUPDATES;
+}
+
+void NexusInterface::queueRequest(const NXMRequestInfo& info)
+{
+  if (isBackground(info)) {
+    m_BackgroundQueue.enqueue(info);
+  } else {
+    m_RequestQueue.enqueue(info);
+  }
+}
+
 void NexusInterface::nextRequest()
 {
-  if ((m_ActiveRequest.size() >= MAX_ACTIVE_DOWNLOADS) || m_RequestQueue.isEmpty()) {
-    return;
+  while (static_cast<int>(m_ActiveRequest.size()) < requestWindow()) {
+    if (!startNextRequest()) {
+      break;
+    }
+  }
+}
+
+bool NexusInterface::startNextRequest()
+{
+  if (m_RequestQueue.isEmpty() && m_BackgroundQueue.isEmpty()) {
+    return false;
   }
 
   if (!getAccessManager()->validated()) {
     if (!getAccessManager()->validateAttempted()) {
       emit needLogin();
-      return;
+      return false;
     } else if (getAccessManager()->validateWaiting()) {
-      return;
+      return false;
     } else {
       log::error(
           "{}",
@@ -857,6 +903,7 @@ void NexusInterface::nextRequest()
 
   if (m_User.exhausted()) {
     m_RequestQueue.clear();
+    m_BackgroundQueue.clear();
     QTime time = QTime::currentTime();
     QTime targetTime;
     targetTime.setHMS((time.hour() + 1) % 23, 5, 0);
@@ -868,10 +915,12 @@ void NexusInterface::nextRequest()
                           .arg(time.secsTo(targetTime) % 60);
 
     log::warn("{}", warning);
-    return;
+    return false;
   }
 
-  NXMRequestInfo info = m_RequestQueue.dequeue();
+  // interactive requests go first, the background ones only fill the window
+  NXMRequestInfo info = !m_RequestQueue.isEmpty() ? m_RequestQueue.dequeue()
+                                                  : m_BackgroundQueue.dequeue();
   info.m_Timeout      = new QTimer(this);
   info.m_Timeout->setInterval(60000);
 
@@ -999,6 +1048,10 @@ void NexusInterface::nextRequest()
   request.setRawHeader("Application-Version",
                        QApplication::applicationVersion().toUtf8());
 
+  if (isCacheable(info)) {
+    addCacheValidators(request);
+  }
+
   if (postData.object().isEmpty()) {
     if (!requestIsDelete) {
       info.m_Reply = m_AccessManager->get(request);
@@ -1021,6 +1074,8 @@ void NexusInterface::nextRequest()
   connect(info.m_Timeout, SIGNAL(timeout()), this, SLOT(requestTimeout()));
   info.m_Timeout->start();
   m_ActiveRequest.push_back(info);
+
+  return true;
 }
 
 void NexusInterface::downloadRequestedNXM(const QString& url)
@@ -1044,6 +1099,10 @@ void NexusInterface::requestFinished(std::list<NXMRequestInfo>::iterator iter)
     } else if (statusCode == 429) {
       m_User.limits(parseLimits(reply));
 
+      // too many requests at once, halve the window and grow it again one
+      // request at a time as they succeed
+      m_Window = std::max(1, requestWindow() / 2);
+
       if (!m_User.exhausted()) {
         log::warn("You appear to be making requests to the Nexus API too quickly and "
                   "are being throttled. Please inform the MO2 team.");
@@ -1074,11 +1133,24 @@ void NexusInterface::requestFinished(std::list<NXMRequestInfo>::iterator iter)
       iter->m_URL =
           reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toString();
       iter->m_Reroute = true;
-      m_RequestQueue.enqueue(*iter);
+      queueRequest(*iter);
       // nextRequest();
       return;
     }
-    QByteArray data = reply->readAll();
+    QByteArray data;
+    if (statusCode == 304) {
+      // not modified since the cached response, so the body wasn't sent again
+      data = cachedResponse(reply);
+      if (data.isEmpty()) {
+        // the cache entry was evicted in the meantime, ask again without the
+        // validators
+        m_DiskCache->remove(reply->request().url());
+        queueRequest(*iter);
+        return;
+      }
+    } else {
+      data = reply->readAll();
+    }
     if (data.isNull() || data.isEmpty() || (strcmp(data.constData(), "null") == 0)) {
       QString nexusError(reply->rawHeader("NexusErrorInfo"));
       if (nexusError.length() == 0) {
@@ -1157,7 +1229,12 @@ void NexusInterface::requestFinished(std::list<NXMRequestInfo>::iterator iter)
         } break;
         }
 
+        if (statusCode == 200 && isCacheable(*iter)) {
+          cacheResponse(reply, data);
+        }
+
         m_User.limits(parseLimits(reply));
+        m_Window = std::min(m_Window + 1, maxActiveRequests());
         emit requestsChanged(getAPIStats(), m_User);
       } else {
         emit nxmRequestFailed(iter->m_GameName, iter->m_ModID, iter->m_FileID,
@@ -1168,6 +1245,82 @@ void NexusInterface::requestFinished(std::list<NXMRequestInfo>::iterator iter)
   }
 }
 
+bool NexusInterface::isCacheable(const NXMRequestInfo& info)
+{
+  switch (info.m_Type) {
+  case NXMRequestInfo::TYPE_DESCRIPTION:
+  case NXMRequestInfo::TYPE_MODINFO:
+  case NXMRequestInfo::TYPE_CHECKUPDATES:
+  case NXMRequestInfo::TYPE_FILES:
+  case NXMRequestInfo::TYPE_GETUPDATES:
+  case NXMRequestInfo::TYPE_FILEINFO:
+  case NXMRequestInfo::TYPE_FILEINFO_MD5:
+  case NXMRequestInfo::TYPE_GAMEINFO:
+    return true;
+
+  default:
+    // download links expire and the rest are either user specific or change
+    // something on the server
+    return false;
+  }
+}
+
+void NexusInterface::addCacheValidators(QNetworkRequest& request) const
+{
+  const QNetworkCacheMetaData meta = m_DiskCache->metaData(request.url());
+  if (!meta.isValid()) {
+    return;
+  }
+
+  for (const auto& header : meta.rawHeaders()) {
+    if (header.first.compare("ETag", Qt::CaseInsensitive) == 0) {
+      request.setRawHeader("If-None-Match", header.second);
+    } else if (header.first.compare("Last-Modified", Qt::CaseInsensitive) == 0) {
+      request.setRawHeader("If-Modified-Since", header.second);
+    }
+  }
+}
+
+QByteArray NexusInterface::cachedResponse(QNetworkReply* reply) const
+{
+  std::unique_ptr<QIODevice> device(m_DiskCache->data(reply->request().url()));
+  if (!device) {
+    return {};
+  }
+
+  return device->readAll();
+}
+
+void NexusInterface::cacheResponse(QNetworkReply* reply, const QByteArray& data)
+{
+  QNetworkCacheMetaData::RawHeaderList validators;
+  for (const auto& header : reply->rawHeaderPairs()) {
+    if (header.first.compare("ETag", Qt::CaseInsensitive) == 0 ||
+        header.first.compare("Last-Modified", Qt::CaseInsensitive) == 0) {
+      validators.append(header);
+    }
+  }
+
+  if (validators.isEmpty()) {
+    // can't be revalidated, so there's no point in keeping it
+    return;
+  }
+
+  QNetworkCacheMetaData meta;
+  meta.setUrl(reply->request().url());
+  meta.setRawHeaders(validators);
+  meta.setSaveToDisk(true);
+
+  // null if the cache directory isn't set yet
+  QIODevice* device = m_DiskCache->prepare(meta);
+  if (device == nullptr) {
+    return;
+  }
+
+  device->write(data);
+  m_DiskCache->insert(device);
+}
+
 void NexusInterface::requestFinished()
 {
   QNetworkReply* reply = static_cast<QNetworkReply*>(sender());
@@ -1222,7 +1375,7 @@ APIUserAccount NexusInterface::getAPIUserAccount() const
 APIStats NexusInterface::getAPIStats() const
 {
   APIStats stats;
-  stats.requestsQueued = m_RequestQueue.size();
+  stats.requestsQueued = m_RequestQueue.size() + m_BackgroundQueue.size();
 
   return stats;
 }
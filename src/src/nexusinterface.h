@@ -668,19 +668,55 @@ private:
     static QAtomicInt s_NextID;
   };
 
-  static const int MAX_ACTIVE_DOWNLOADS = 6;
+  // default number of requests sent at the same time and the most that can be
+  // configured
+  static const int MAX_ACTIVE_REQUESTS       = 6;
+  static const int MAX_ACTIVE_REQUESTS_LIMIT = 8;
 
 private:
+  // starts queued requests until the window is full
   void nextRequest();
+
+  // starts the first queued request, returns false if nothing was started
+  bool startNextRequest();
+
+  // configured maximum number of requests in flight
+  int maxActiveRequests() const;
+
+  // number of requests that may be in flight right now, smaller than the
+  // maximum after the server throttled us or when few requests are left
+  int requestWindow() const;
+
+  // background requests are only sent when no other request is waiting
+  static bool isBackground(const NXMRequestInfo& info);
+  void queueRequest(const NXMRequestInfo& info);
+
   void requestFinished(std::list<NXMRequestInfo>::iterator iter);
+
+  // whether the response of the request can be kept in the disk cache and
+  // revalidated with its ETag or Last-Modified header the next time
+  static bool isCacheable(const NXMRequestInfo& info);
+
+  // adds If-None-Match and If-Modified-Since if a response for the url is cached
+  void addCacheValidators(QNetworkRequest& request) const;
+
+  // body of the cached response for the url of a reply, empty if there is none
+  QByteArray cachedResponse(QNetworkReply* reply) const;
+
+  // stores the body of a reply if it came with a validator
+  void cacheResponse(QNetworkReply* reply, const QByteArray& data);
+
   MOBase::IPluginGame* getGame(QString gameName) const;
   QString getOldModsURL(QString gameName) const;
 
 private:
+  Settings* m_Settings;
+  int m_Window;
   QNetworkDiskCache* m_DiskCache;
   NXMAccessManager* m_AccessManager;
   std::list<NXMRequestInfo> m_ActiveRequest;
   QQueue<NXMRequestInfo> m_RequestQueue;
+  QQueue<NXMRequestInfo> m_BackgroundQueue;
   PluginContainer* m_PluginContainer;
   APIUserAccount m_User;
 };
@@ -36,6 +36,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QNetworkProxy>
 #include <QNetworkRequest>
 #include <QPushButton>
+#include <QSslConfiguration>
 #include <QThread>
 #include <QUrlQuery>
 
@@ -43,6 +44,10 @@ using namespace MOBase;
 using namespace std::chrono_literals;
 
 const QString NexusBaseUrl("https://api.nexusmods.com/v1");
+
+// how long an idle connection to the api is kept open, update checks, file
+// lists and md5 queries come in bursts that are often minutes apart
+constexpr int ApiConnectionExpirySeconds = 300;
 const QString NexusSSO("wss://sso.nexusmods.com");
 const QString
     NexusSSOPage("https://www.nexusmods.com/sso?id=%1&application=modorganizer2");
@@ -793,12 +798,45 @@ void NXMAccessManager::setTopLevelWidget(QWidget* w)
   }
 }
 
+bool NXMAccessManager::isApiRequest(const QUrl& url)
+{
+  static const QString host = QUrl(NexusBaseUrl).host();
+  return url.scheme() == "https" && url.host() == host;
+}
+
+void NXMAccessManager::warmUpApiConnection()
+{
+  // the first request of a burst would otherwise pay for the handshake, and
+  // the requests sent before it's done would each open a connection of their
+  // own; once h2 is negotiated they all share this one
+  const QUrl url(NexusBaseUrl);
+
+  auto ssl = QSslConfiguration::defaultConfiguration();
+  ssl.setAllowedNextProtocols(
+      {QSslConfiguration::ALPNProtocolHTTP2, QSslConfiguration::NextProtocolHttp1_1});
+
+  connectToHostEncrypted(url.host(), static_cast<quint16>(url.port(443)), ssl);
+}
+
 QNetworkReply*
 NXMAccessManager::createRequest(QNetworkAccessManager::Operation operation,
                                 const QNetworkRequest& request, QIODevice* device)
 {
   if (request.url().scheme() != "nxm") {
-    return QNetworkAccessManager::createRequest(operation, request, device);
+    if (!isApiRequest(request.url())) {
+      return QNetworkAccessManager::createRequest(operation, request, device);
+    }
+
+    // api requests are small and come in bursts, they're multiplexed over one
+    // http/2 connection that's kept open between bursts; downloads from the
+    // cdn are left alone, they're better off with connections of their own
+    QNetworkRequest apiRequest(request);
+    apiRequest.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+    apiRequest.setAttribute(
+        QNetworkRequest::ConnectionCacheExpiryTimeoutSecondsAttribute,
+        ApiConnectionExpirySeconds);
+
+    return QNetworkAccessManager::createRequest(operation, apiRequest, device);
   }
   if (operation == GetOperation) {
     emit requestNXMDownload(request.url().toString());
@@ -925,6 +963,9 @@ void NXMAccessManager::apiCheck(const QString& apiKey, bool force)
     return;
   }
 
+  // requests to the api usually follow
+  warmUpApiConnection();
+
   if (force) {
     m_validationState = NotChecked;
   }
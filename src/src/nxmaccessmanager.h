@@ -273,6 +273,12 @@ private:
 
   void startValidationCheck(const QString& key);
 
+  // whether `url` is for the nexus api, see createRequest()
+  static bool isApiRequest(const QUrl& url);
+
+  // opens the connection to the api ahead of the requests, negotiating http/2
+  void warmUpApiConnection();
+
   void onValidatorFinished(ValidationAttempt::Result r, const QString& message,
                            std::optional<APIUserAccount>);
 
@@ -7,6 +7,7 @@
 #include "envfs.h"
 #include "envmodule.h"
 #include "filedialogmemory.h"
+#include "glob_matching.h"
 #include "guessedvalue.h"
 #include "imodinterface.h"
 #include "imoinfo.h"
@@ -14,6 +15,7 @@
 #include "iplugingame.h"
 #include "iuserinterface.h"
 #include "messagedialog.h"
+#include "modimage.h"
 #include "modlistsortproxy.h"
 #include "modrepositoryfileinfo.h"
 #include "nexusinterface.h"
@@ -28,6 +30,7 @@
 #include "shared/util.h"
 #include "spawn.h"
 #include "syncoverwritedialog.h"
+#include "thread_utils.h"
 #include "virtualfiletree.h"
 #include <ipluginmodpage.h>
 #include <questionboxmemory.h>
@@ -55,6 +58,7 @@
 #include <QNetworkInterface>
 #include <QProcess>
 #include <QTextStream>
+#include <QThreadPool>
 #include <QTimer>
 #include <QUrl>
 #include <QWidget>
@@ -77,13 +81,16 @@
 #include <exception>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <set>
+#include <span>
 #include <string>  //for wstring
 #include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
-#include <libbsarch/bs_archive.h>
+#include <bsatk/bsatk.h>
 
 #include "organizerproxy.h"
 
@@ -102,6 +109,87 @@ QStringList toStringList(InputIterator current, InputIterator end)
   return result;
 }
 
+// the first mip of a texture that's still at least as large as the texture is
+// once fit into `maxSize`, 0 if it's smaller than that already
+//
+unsigned int previewMip(BSAUInt width, BSAUInt height, BSAUInt mipCount,
+                        const QSize& maxSize)
+{
+  const QSize full(static_cast<int>(width), static_cast<int>(height));
+  const QSize shown = full.boundedTo(full.scaled(maxSize, Qt::KeepAspectRatio));
+
+  unsigned int mip = 0;
+  while (mip + 1 < mipCount && static_cast<int>(width >> (mip + 1)) >= shown.width() &&
+         static_cast<int>(height >> (mip + 1)) >= shown.height()) {
+    ++mip;
+  }
+
+  return mip;
+}
+
+// the content of `fileName` inside the archive at `archivePath`, read through a
+// mapping of the archive so nothing is extracted to disk; nothing if the file
+// can't be read
+//
+// textures of BA2 archives are only read from the first mip that's needed to
+// show them at `maxSize`, if it's valid
+//
+std::optional<QByteArray> readArchivedFile(const std::wstring& archivePath,
+                                           const QString& fileName,
+                                           const QSize& maxSize = {})
+{
+  // usually still open from the last refresh or preview
+  BSA::EErrorCode res = BSA::ERROR_NONE;
+  const auto archive =
+      BSA::ArchiveCache::instance().get(ToString(archivePath, false), &res);
+  if (archive == nullptr) {
+    log::error("invalid bsa '{}', error {}", archivePath, res);
+    return {};
+  }
+
+  try {
+    const BSA::File::Ptr file = archive->getRoot()->findFile(fileName.toStdString());
+    if (file == nullptr) {
+      log::error("'{}' not found in '{}'", fileName, archivePath);
+      return {};
+    }
+
+    BSAUInt width = 0, height = 0, mipCount = 0;
+    if (maxSize.isValid() &&
+        archive->getTextureInfo(file, width, height, mipCount) == BSA::ERROR_NONE) {
+      BSA::Archive::DataBuffer buffer;
+      unsigned int firstMip = 0;
+      const BSA::EErrorCode readRes = archive->readTextureMips(
+          file, previewMip(width, height, mipCount, maxSize), buffer, firstMip);
+      if (readRes != BSA::ERROR_NONE) {
+        log::error("failed to read '{}' from '{}', error {}", fileName, archivePath,
+                   readRes);
+        return {};
+      }
+
+      return QByteArray(reinterpret_cast<const char*>(buffer.first.get()),
+                        static_cast<qsizetype>(buffer.second));
+    }
+
+    std::span<const unsigned char> data;
+    BSA::Archive::DataBuffer buffer;
+    const BSA::EErrorCode readRes = archive->readFile(file, data, buffer);
+    if (readRes != BSA::ERROR_NONE) {
+      log::error("failed to read '{}' from '{}', error {}", fileName, archivePath,
+                 readRes);
+      return {};
+    }
+
+    // deep copy, uncompressed data points into the mapping which goes away once
+    // the archive leaves the cache
+    return QByteArray(reinterpret_cast<const char*>(data.data()),
+                      static_cast<qsizetype>(data.size()));
+  } catch (std::exception& e) {
+    log::error("invalid bsa '{}', error {}", archivePath, e.what());
+    return {};
+  }
+}
+
 #ifndef _WIN32
 QString resolveWinePrefixPath(const Settings& settings,
                               const IPluginGame* managedGame)
@@ -191,12 +279,25 @@ OrganizerCore::OrganizerCore(Settings& settings)
       m_Updater(&NexusInterface::instance()), m_ModList(m_PluginContainer, this),
       m_PluginList(*this),
       m_DirectoryRefresher(new DirectoryRefresher(this, settings.refreshThreadCount())),
-      m_DirectoryStructure(new DirectoryEntry(L"data", nullptr, 0)),
-      m_VirtualFileTree([this]() {
-        return VirtualFileTree::makeTree(m_DirectoryStructure);
+      m_DirectoryStructure(std::make_shared<DirectoryEntry>(L"data", nullptr, 0)),
+      m_VirtualFileTree([this]() -> std::shared_ptr<const IFileTree> {
+        // the tree points into the structure it was made from, whoever holds
+        // the tree keeps that structure alive across refreshes; it stops
+        // populating once that structure is patched in place
+        const auto reader = readDirectoryStructure();
+        auto structure    = reader.shared();
+        auto tree         = VirtualFileTree::makeTree(
+            structure.get(),
+            {&m_DirectoryStructureAccess, &m_DirectoryStructurePatches,
+             m_DirectoryStructurePatches.load(std::memory_order_acquire)});
+        return std::shared_ptr<const IFileTree>(
+            tree.get(), [tree, structure](const IFileTree*) {});
       }),
       m_DownloadManager(&NexusInterface::instance(), this), m_DirectoryUpdate(false),
-      m_ArchivesInit(false),
+      m_DirectoryRefreshQueued(false), m_DirectoryRefreshChecksFiles(false),
+      m_ArchivesInit(false), m_InstallQueueRunning(false), m_RefreshTransactions(0),
+      m_DirectoryRefreshDeferred(false), m_ListsRefreshDeferred(false),
+      m_PluginListSaveQueued(false),
       m_PluginListsWriter(std::bind(&OrganizerCore::savePluginList, this))
 {
   env::setHandleCloserThreadCount(settings.refreshThreadCount());
@@ -211,6 +312,21 @@ OrganizerCore::OrganizerCore(Settings& settings)
           SLOT(downloadSpeed(QString, int)));
   connect(m_DirectoryRefresher.get(), &DirectoryRefresher::refreshed, this,
           &OrganizerCore::onDirectoryRefreshed);
+#ifndef _WIN32
+  connect(&m_ModWatcher, &ModDirectoryWatcher::changed, this,
+          &OrganizerCore::onModFilesChanged);
+  connect(&m_ModWatcher, &ModDirectoryWatcher::overflowed, this,
+          &OrganizerCore::refreshDirectoryStructure);
+  // files a program created are in overwrite once the vfs kept mounted after
+  // it has flushed them
+  connect(&m_USVFS, &FuseConnector::stagingFlushed, this,
+          &OrganizerCore::refreshAfterRun, Qt::QueuedConnection);
+
+  // an indexer left running by an earlier session spares the first refresh
+  // checking every mod against the disk
+  FuseConnector::updateIndexer(m_Settings.paths().mods(),
+                               m_Settings.paths().overwrite());
+#endif
 
   connect(&m_ModList, SIGNAL(removeOrigin(QString)), this, SLOT(removeOrigin(QString)));
   connect(&m_ModList, &ModList::modStatesChanged, [=, this] {
@@ -255,6 +371,12 @@ OrganizerCore::~OrganizerCore()
     m_StructureDeleter.join();
   }
 
+#ifndef _WIN32
+  // the vfs reads packed mods from their images, it goes first
+  m_USVFS.unmount();
+  unmountModImages();
+#endif
+
   saveCurrentProfile();
 
   // profile has to be cleaned up before the modinfo-buffer is cleared
@@ -264,7 +386,7 @@ OrganizerCore::~OrganizerCore()
   m_ModList.setProfile(nullptr);
   //  NexusInterface::instance()->cleanup();
 
-  delete m_DirectoryStructure;
+  m_DirectoryStructure.reset();
 }
 
 void OrganizerCore::storeSettings()
@@ -470,6 +592,7 @@ void OrganizerCore::removeOrigin(const QString& name)
 {
   const auto wname = ToWString(name);
   if (m_DirectoryStructure->originExists(wname)) {
+    DirectoryStructurePatch patch(*this);
     FilesOrigin& origin = m_DirectoryStructure->getOriginByName(wname);
     origin.enable(false);
   }
@@ -521,6 +644,8 @@ bool OrganizerCore::checkPathSymlinks()
 
 bool OrganizerCore::bootstrap()
 {
+  TimeThis tt("OrganizerCore::bootstrap()");
+
   const auto dirs = {m_Settings.paths().profiles(), m_Settings.paths().mods(),
                      m_Settings.paths().downloads(), m_Settings.paths().overwrite(),
                      QString::fromStdWString(getGlobalCoreDumpPath())};
@@ -687,6 +812,7 @@ void OrganizerCore::setCurrentProfile(const QString& profileName)
 
   m_CurrentProfile =
       std::make_unique<Profile>(QDir(profileDir), managedGame(), gameFeatures());
+  m_CurrentModMappings.reset();
 
   m_ModList.setProfile(m_CurrentProfile.get());
 
@@ -706,7 +832,10 @@ void OrganizerCore::setCurrentProfile(const QString& profileName)
           [this](auto&& indexes) {
             modStatusChanged(indexes);
           });
-  refreshDirectoryStructure();
+
+  if (oldProfile == nullptr || !switchDirectoryStructure(*oldProfile)) {
+    refreshDirectoryStructure();
+  }
 
   m_CurrentProfile->debugDump();
 
@@ -973,8 +1102,6 @@ OrganizerCore::doInstall(const QString& archivePath, GuessedValue<QString> modNa
 
 ModInfo::Ptr OrganizerCore::installDownload(int index, int priority)
 {
-  ScopedDisableDirWatcher scopedDirwatcher(&m_DownloadManager);
-
   try {
     QString fileName        = m_DownloadManager.getFilePath(index);
     QString gameName        = m_DownloadManager.getGameName(index);
@@ -1018,6 +1145,87 @@ ModInfo::Ptr OrganizerCore::installDownload(int index, int priority)
   return nullptr;
 }
 
+void OrganizerCore::installDownloads(const QList<int>& downloadIndices)
+{
+  // indices change when installed downloads are hidden, so queue the names
+  for (int index : downloadIndices) {
+    if (m_DownloadManager.getState(index) >= DownloadManager::STATE_READY) {
+      m_InstallQueue.append(m_DownloadManager.getFileName(index));
+    }
+  }
+
+  if (!m_InstallQueueRunning) {
+    processInstallQueue();
+  }
+}
+
+void OrganizerCore::processInstallQueue()
+{
+  TimeThis tt("OrganizerCore::processInstallQueue()");
+
+  // every mod of the batch would start a refresh, do one at the end
+  RefreshTransaction refreshTransaction(*this);
+  m_InstallQueueRunning = true;
+
+  while (!m_InstallQueue.isEmpty()) {
+    const QString fileName = m_InstallQueue.takeFirst();
+    const int index        = m_DownloadManager.indexByName(fileName);
+    if (index == -1) {
+      log::warn("download '{}' is gone, not installing it", fileName);
+      continue;
+    }
+
+    // the next archive is read while this one waits on the installer dialogs
+    // and its extraction
+    if (!m_InstallQueue.isEmpty()) {
+      const int next = m_DownloadManager.indexByName(m_InstallQueue.first());
+      if (next != -1) {
+        prefetchArchive(m_DownloadManager.getFilePath(next));
+      }
+    }
+
+    installDownload(index);
+  }
+
+  if (m_PrefetchCancel) {
+    *m_PrefetchCancel = true;
+    m_PrefetchCancel.reset();
+  }
+
+  m_InstallQueueRunning = false;
+}
+
+void OrganizerCore::prefetchArchive(const QString& path)
+{
+  // larger archives would only push the one being installed out of the cache
+  static constexpr qint64 PrefetchLimit = 1024ll * 1024 * 1024;
+  static constexpr qint64 ChunkSize     = 4 * 1024 * 1024;
+
+  if (m_PrefetchCancel) {
+    *m_PrefetchCancel = true;
+  }
+
+  auto cancel      = std::make_shared<std::atomic<bool>>(false);
+  m_PrefetchCancel = cancel;
+
+  QThreadPool::globalInstance()->start([path, cancel] {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+      return;
+    }
+
+    std::vector<char> buffer(ChunkSize);
+    qint64 total = 0;
+    while (!*cancel && total < PrefetchLimit) {
+      const qint64 read = file.read(buffer.data(), ChunkSize);
+      if (read <= 0) {
+        break;
+      }
+      total += read;
+    }
+  });
+}
+
 ModInfo::Ptr OrganizerCore::installArchive(const QString& archivePath, int priority,
                                            bool reinstallation, ModInfo::Ptr currentMod,
                                            const QString& initModName)
@@ -1044,13 +1252,38 @@ ModInfo::Ptr OrganizerCore::installArchive(const QString& archivePath, int prior
   return modInfo;
 }
 
+OrganizerCore::DirectoryStructureReader OrganizerCore::readDirectoryStructure() const
+{
+  std::shared_ptr<DirectoryEntry> structure;
+  {
+    std::scoped_lock lock(m_DirectoryStructureMutex);
+    structure = m_DirectoryStructure;
+  }
+
+  // a refresh swapping in another structure meanwhile doesn't matter, this one
+  // is kept alive
+  return DirectoryStructureReader(m_DirectoryStructureAccess, std::move(structure));
+}
+
+OrganizerCore::DirectoryStructurePatch::DirectoryStructurePatch(OrganizerCore& core)
+    : m_Core(core), m_Lock(core.m_DirectoryStructureAccess)
+{
+  m_Core.m_DirectoryStructurePatches.fetch_add(1, std::memory_order_acq_rel);
+}
+
+OrganizerCore::DirectoryStructurePatch::~DirectoryStructurePatch()
+{
+  m_Lock.unlock();
+  m_Core.m_VirtualFileTree.invalidate();
+}
+
 QString OrganizerCore::resolvePath(const QString& fileName) const
 {
-  if (m_DirectoryStructure == nullptr) {
+  const auto structure = readDirectoryStructure();
+  if (structure.get() == nullptr) {
     return QString();
   }
-  const FileEntryPtr file =
-      m_DirectoryStructure->searchFile(ToWString(fileName), nullptr);
+  const FileEntryPtr file = structure->findFileByPath(ToWString(fileName));
   if (file.get() != nullptr) {
     return ToQString(file->getFullPath());
   } else {
@@ -1061,9 +1294,10 @@ QString OrganizerCore::resolvePath(const QString& fileName) const
 QStringList OrganizerCore::listDirectories(const QString& directoryName) const
 {
   QStringList result;
-  DirectoryEntry* dir = m_DirectoryStructure;
+  const auto structure = readDirectoryStructure();
+  DirectoryEntry* dir  = structure.get();
   if (!directoryName.isEmpty())
-    dir = dir->findSubDirectoryRecursive(ToWString(directoryName));
+    dir = dir->findDirectoryByPath(ToWString(directoryName));
   if (dir != nullptr) {
     for (const auto& d : dir->getSubDirectories()) {
       result.append(ToQString(d->getName()));
@@ -1076,34 +1310,137 @@ QStringList
 OrganizerCore::findFiles(const QString& path,
                          const std::function<bool(const QString&)>& filter) const
 {
+  // the filter runs once the structure is released, it may call back into the
+  // organizer
+  std::vector<std::pair<QString, QString>> files;
+  {
+    const auto structure = readDirectoryStructure();
+    DirectoryEntry* dir  = structure.get();
+    if (!path.isEmpty() && path != ".")
+      dir = dir->findDirectoryByPath(ToWString(path));
+    if (dir != nullptr) {
+      for (const FileEntryPtr& file : dir->getFiles()) {
+        files.emplace_back(ToQString(file->getName()), ToQString(file->getFullPath()));
+      }
+    }
+  }
+
   QStringList result;
-  DirectoryEntry* dir = m_DirectoryStructure;
-  if (!path.isEmpty() && path != ".")
-    dir = dir->findSubDirectoryRecursive(ToWString(path));
-  if (dir != nullptr) {
-    std::vector<FileEntryPtr> files = dir->getFiles();
-    for (FileEntryPtr& file : files) {
-      QString fullPath = ToQString(file->getFullPath());
-      if (filter(ToQString(file->getName()))) {
-        result.append(fullPath);
+  for (const auto& [name, fullPath] : files) {
+    if (filter(name)) {
+      result.append(fullPath);
+    }
+  }
+  return result;
+}
+
+// calls `f` with the files in `dir` matching any of `globFilters`, sorted by
+// name
+//
+template <class F>
+static void forEachGlobMatch(DirectoryEntry& dir, const QStringList& globFilters,
+                             F&& f)
+{
+  QList<GlobPattern<QChar>> patterns;
+  std::vector<std::wstring> prefixes;
+  bool scanAll = false;
+
+  for (auto& gfilter : globFilters) {
+    patterns.append(GlobPattern(gfilter));
+
+    // the literal part before the first wildcard, only names starting with it
+    // can match
+    qsizetype literal = 0;
+    while (literal < gfilter.size() &&
+           !QStringLiteral("*?[]").contains(gfilter[literal])) {
+      ++literal;
+    }
+
+    if (literal == 0) {
+      scanAll = true;
+    } else {
+      prefixes.push_back(ToLowerCopy(ToWString(gfilter.left(literal))));
+    }
+  }
+
+  auto add = [&](const FileEntry& file) {
+    const QString name = ToQString(file.getName());
+    for (auto& p : patterns) {
+      if (p.match(name)) {
+        f(file);
+        break;
       }
     }
+    return true;
+  };
+
+  if (scanAll) {
+    dir.forEachFile(add);
+    return;
+  }
+
+  // files are sorted by lowercase name, so once prefixes covered by a shorter
+  // one are dropped, walking the ranges in order keeps the result sorted and
+  // visits every file at most once
+  std::sort(prefixes.begin(), prefixes.end());
+  std::wstring_view previous;
+
+  for (const auto& prefix : prefixes) {
+    if (!previous.empty() && prefix.starts_with(previous)) {
+      continue;
+    }
+
+    dir.forEachFileWithPrefix(prefix, add);
+    previous = prefix;
   }
+}
+
+// `file` with its origins, highest priority first
+//
+static IOrganizer::FileInfo fileInfo(const DirectoryEntry& structure,
+                                     const FileEntry& file)
+{
+  IOrganizer::FileInfo info;
+  info.filePath    = ToQString(file.getFullPath());
+  bool fromArchive = false;
+  info.origins.append(
+      ToQString(structure.getOriginByID(file.getOrigin(fromArchive)).getName()));
+  info.archive = fromArchive ? ToQString(file.getArchive().name()) : "";
+  for (const auto& idx : file.getAlternatives()) {
+    info.origins.append(ToQString(structure.getOriginByID(idx.originID()).getName()));
+  }
+  return info;
+}
+
+QStringList OrganizerCore::findFiles(const QString& path,
+                                     const QStringList& globFilters) const
+{
+  QStringList result;
+  const auto structure = readDirectoryStructure();
+  DirectoryEntry* dir  = structure.get();
+  if (!path.isEmpty() && path != ".")
+    dir = dir->findDirectoryByPath(ToWString(path));
+  if (dir == nullptr) {
+    return result;
+  }
+
+  forEachGlobMatch(*dir, globFilters, [&](const FileEntry& file) {
+    result.append(ToQString(file.getFullPath()));
+  });
+
   return result;
 }
 
 QStringList OrganizerCore::getFileOrigins(const QString& fileName) const
 {
   QStringList result;
-  const FileEntryPtr file =
-      m_DirectoryStructure->searchFile(ToWString(fileName), nullptr);
+  const auto structure    = readDirectoryStructure();
+  const FileEntryPtr file = structure->findFileByPath(ToWString(fileName));
 
   if (file.get() != nullptr) {
-    result.append(
-        ToQString(m_DirectoryStructure->getOriginByID(file->getOrigin()).getName()));
+    result.append(ToQString(structure->getOriginByID(file->getOrigin()).getName()));
     foreach (const auto& i, file->getAlternatives()) {
-      result.append(
-          ToQString(m_DirectoryStructure->getOriginByID(i.originID()).getName()));
+      result.append(ToQString(structure->getOriginByID(i.originID()).getName()));
     }
   }
   return result;
@@ -1113,32 +1450,74 @@ QList<MOBase::IOrganizer::FileInfo> OrganizerCore::findFileInfos(
     const QString& path,
     const std::function<bool(const MOBase::IOrganizer::FileInfo&)>& filter) const
 {
-  QList<IOrganizer::FileInfo> result;
-  DirectoryEntry* dir = m_DirectoryStructure;
-  if (!path.isEmpty() && path != ".")
-    dir = dir->findSubDirectoryRecursive(ToWString(path));
-  if (dir != nullptr) {
-    std::vector<FileEntryPtr> files = dir->getFiles();
-    for (FileEntryPtr file : files) {
-      IOrganizer::FileInfo info;
-      info.filePath    = ToQString(file->getFullPath());
-      bool fromArchive = false;
-      info.origins.append(ToQString(
-          m_DirectoryStructure->getOriginByID(file->getOrigin(fromArchive)).getName()));
-      info.archive = fromArchive ? ToQString(file->getArchive().name()) : "";
-      for (const auto& idx : file->getAlternatives()) {
-        info.origins.append(
-            ToQString(m_DirectoryStructure->getOriginByID(idx.originID()).getName()));
+  // like findFiles(), the filter runs once the structure is released
+  QList<IOrganizer::FileInfo> infos;
+  {
+    const auto structure = readDirectoryStructure();
+    DirectoryEntry* dir  = structure.get();
+    if (!path.isEmpty() && path != ".")
+      dir = dir->findDirectoryByPath(ToWString(path));
+    if (dir != nullptr) {
+      for (const FileEntryPtr& file : dir->getFiles()) {
+        infos.append(fileInfo(*structure, *file));
       }
+    }
+  }
 
-      if (filter(info)) {
-        result.append(info);
-      }
+  QList<IOrganizer::FileInfo> result;
+  for (const auto& info : infos) {
+    if (filter(info)) {
+      result.append(info);
     }
   }
   return result;
 }
 
+QList<QList<MOBase::IOrganizer::FileInfo>>
+OrganizerCore::queryFiles(const QList<MOBase::IOrganizer::FileQuery>& queries) const
+{
+  QList<QList<IOrganizer::FileInfo>> results(queries.size());
+  const auto structure = readDirectoryStructure();
+  if (structure.get() == nullptr) {
+    return results;
+  }
+
+  // paths are case-insensitive, queries for the same directory share the lookup
+  std::unordered_map<std::wstring, DirectoryEntry*> directories;
+  const auto directory = [&](const QString& path) -> DirectoryEntry* {
+    if (path.isEmpty() || path == ".") {
+      return structure.get();
+    }
+
+    std::wstring key = ToLowerCopy(ToWString(QDir::fromNativeSeparators(path)));
+    auto [itor, inserted] = directories.try_emplace(std::move(key), nullptr);
+    if (inserted) {
+      itor->second = structure->findDirectoryByPath(ToWString(path));
+    }
+    return itor->second;
+  };
+
+  for (qsizetype i = 0; i < queries.size(); ++i) {
+    const auto& query = queries[i];
+    auto& result      = results[i];
+
+    if (query.filters.isEmpty()) {
+      if (const FileEntryPtr file = structure->findFileByPath(ToWString(query.path))) {
+        result.append(fileInfo(*structure, *file));
+      }
+      continue;
+    }
+
+    if (DirectoryEntry* dir = directory(query.path)) {
+      forEachGlobMatch(*dir, query.filters, [&](const FileEntry& file) {
+        result.append(fileInfo(*structure, file));
+      });
+    }
+  }
+
+  return results;
+}
+
 DownloadManager* OrganizerCore::downloadManager()
 {
   return &m_DownloadManager;
@@ -1193,7 +1572,7 @@ bool OrganizerCore::previewFileWithAlternatives(QWidget* parent, QString fileNam
   // set up preview dialog
   PreviewDialog preview(fileName, parent);
 
-  auto addFunc = [&](int originId, std::wstring archiveName = L"") {
+  auto addFunc = [&](int originId, const std::wstring& archiveName) {
     FilesOrigin& origin = directoryStructure()->getOriginByID(originId);
     QString filePath =
         QDir::fromNativeSeparators(ToQString(origin.getPath())) + "/" + fileName;
@@ -1206,23 +1585,22 @@ bool OrganizerCore::previewFileWithAlternatives(QWidget* parent, QString fileNam
       } else {
         preview.addVariant(ToQString(origin.getName()), wid);
       }
-    } else if (archiveName != L"") {
+    } else if (!archiveName.empty()) {
+      // the file only exists inside an archive, hand its content to the previews
+      // that support it without extracting anything
       auto archiveFile = directoryStructure()->searchFile(archiveName);
       if (archiveFile.get() != nullptr) {
-        try {
-          libbsarch::bs_archive archiveLoader;
-          archiveLoader.load_from_disk(archiveFile->getFullPath());
-          libbsarch::memory_blob fileData =
-              archiveLoader.extract_to_memory(fileName.toStdWString());
-          QByteArray convertedFileData((char*)(fileData.data), fileData.size);
+        const auto fileData =
+            readArchivedFile(archiveFile->getFullPath(), fileName,
+                             m_PluginContainer->previewGenerator().maxSize());
+        if (fileData) {
           QWidget* wid = m_PluginContainer->previewGenerator().genArchivePreview(
-              convertedFileData, filePath);
+              *fileData, filePath);
           if (wid == nullptr) {
             reportError(tr("failed to generate preview for %1").arg(filePath));
           } else {
             preview.addVariant(ToQString(origin.getName()), wid);
           }
-        } catch (std::exception& e) {
         }
       }
     }
@@ -1235,24 +1613,29 @@ bool OrganizerCore::previewFileWithAlternatives(QWidget* parent, QString fileNam
       addFunc(alt.originID(), alt.isFromArchive() ? alt.archive().name() : L"");
     }
   } else {
-    std::vector<int> origins;
+    // origin ids and the archive the file is in for that origin, if any
+    std::vector<std::pair<int, std::wstring>> origins;
 
     // start with the primary origin
-    origins.push_back(file->getOrigin());
+    origins.emplace_back(file->getOrigin(),
+                         file->isFromArchive() ? file->getArchive().name() : L"");
 
     // add other origins, push to front if it's the selected one
     for (const auto& alt : file->getAlternatives()) {
+      std::pair<int, std::wstring> origin(
+          alt.originID(), alt.isFromArchive() ? alt.archive().name() : L"");
+
       if (alt.originID() == selectedOrigin) {
-        origins.insert(origins.begin(), alt.originID());
+        origins.insert(origins.begin(), std::move(origin));
       } else {
-        origins.push_back(alt.originID());
+        origins.push_back(std::move(origin));
       }
     }
 
     // can't be empty; either the primary origin was the selected one, or it
     // was one of the alternatives, which got inserted in front
 
-    if (origins[0] != selectedOrigin) {
+    if (origins[0].first != selectedOrigin) {
       // sanity check, this shouldn't happen unless the caller passed an
       // incorrect id
 
@@ -1260,8 +1643,8 @@ bool OrganizerCore::previewFileWithAlternatives(QWidget* parent, QString fileNam
                 selectedOrigin);
     }
 
-    for (int id : origins) {
-      addFunc(id);
+    for (const auto& [id, archiveName] : origins) {
+      addFunc(id, archiveName);
     }
   }
 
@@ -1270,8 +1653,8 @@ bool OrganizerCore::previewFileWithAlternatives(QWidget* parent, QString fileNam
     return true;
   } else {
     QMessageBox::information(parent, tr("Sorry"),
-                             tr("Sorry, can't preview anything. This function "
-                                "currently does not support extracting from bsas."));
+                             tr("Sorry, can't preview anything. None of the installed "
+                                "preview plugins supports this file."));
 
     return false;
   }
@@ -1364,7 +1747,9 @@ boost::signals2::connection
 OrganizerCore::onNextRefresh(std::function<void()> const& func,
                              RefreshCallbackGroup group, RefreshCallbackMode mode)
 {
-  if (m_DirectoryUpdate || mode == RefreshCallbackMode::FORCE_WAIT_FOR_REFRESH) {
+  // a refresh deferred by a transaction is as good as running
+  if (m_DirectoryUpdate || m_DirectoryRefreshDeferred ||
+      mode == RefreshCallbackMode::FORCE_WAIT_FOR_REFRESH) {
     return m_OnNextRefreshCallbacks.connect(static_cast<int>(group), func);
   } else {
     func();
@@ -1389,6 +1774,12 @@ void OrganizerCore::refresh(bool saveChanges)
   emit refreshTriggered();
 }
 
+void OrganizerCore::refreshFromDisk()
+{
+  m_DirectoryRefreshChecksFiles = true;
+  refresh();
+}
+
 void OrganizerCore::refreshESPList(bool force)
 {
   onNextRefresh(
@@ -1443,8 +1834,39 @@ void OrganizerCore::refreshBSAList()
   }
 }
 
+OrganizerCore::RefreshTransaction::RefreshTransaction(OrganizerCore& core)
+    : m_Core(core)
+{
+  ++m_Core.m_RefreshTransactions;
+}
+
+OrganizerCore::RefreshTransaction::~RefreshTransaction()
+{
+  if (--m_Core.m_RefreshTransactions == 0) {
+    m_Core.endRefreshTransaction();
+  }
+}
+
+void OrganizerCore::endRefreshTransaction()
+{
+  const bool directory = std::exchange(m_DirectoryRefreshDeferred, false);
+  const bool lists     = std::exchange(m_ListsRefreshDeferred, false);
+
+  // the lists are refreshed again once the structure is done
+  if (directory) {
+    refreshDirectoryStructure();
+  } else if (lists) {
+    refreshLists();
+  }
+}
+
 void OrganizerCore::refreshLists()
 {
+  if (m_RefreshTransactions > 0) {
+    m_ListsRefreshDeferred = true;
+    return;
+  }
+
   if ((m_CurrentProfile != nullptr) && m_DirectoryStructure->isPopulated()) {
     refreshESPList(true);
     refreshBSAList();
@@ -1544,9 +1966,19 @@ void OrganizerCore::updateModsInDirectoryStructure(
                        m_CurrentProfile->getModPriority(idx)});
   }
 
-  m_DirectoryRefresher->addMultipleModsFilesToStructure(m_DirectoryStructure, entries);
+  {
+    DirectoryStructurePatch patch(*this);
+    m_DirectoryRefresher->addMultipleModsFilesToStructure(m_DirectoryStructure.get(),
+                                                          entries);
+    DirectoryRefresher::cleanStructure(m_DirectoryStructure.get());
+  }
+
+#ifndef _WIN32
+  for (const auto& e : entries) {
+    m_ModWatcher.addMod(e.modName, e.absolutePath);
+  }
+#endif
 
-  DirectoryRefresher::cleanStructure(m_DirectoryStructure);
   // need to refresh plugin list now so we can activate esps
   refreshESPList(true);
   // activate all esps of the specified mod so the bsas get activated along with
@@ -1566,12 +1998,13 @@ void OrganizerCore::updateModsInDirectoryStructure(
                                 std::set<QString>(archives.begin(), archives.end()));
 
   // finally also add files from bsas to the directory structure
+  DirectoryStructurePatch patch(*this);
   for (auto idx : modInfo.keys()) {
     QString path       = modInfo[idx]->absolutePath();
     QString modDataDir = managedGame()->modDataDirectory();
     path               = modDataDir.isEmpty() ? path : path + "/" + modDataDir;
     m_DirectoryRefresher->addModBSAToStructure(
-        m_DirectoryStructure, modInfo[idx]->name(),
+        m_DirectoryStructure.get(), modInfo[idx]->name(),
         m_CurrentProfile->getModPriority(idx), path, modInfo[idx]->archives());
   }
 }
@@ -1682,8 +2115,15 @@ std::vector<QString> OrganizerCore::enabledArchives()
 
 void OrganizerCore::refreshDirectoryStructure()
 {
+  if (m_RefreshTransactions > 0) {
+    m_DirectoryRefreshDeferred = true;
+    return;
+  }
+
   if (m_DirectoryUpdate) {
-    log::debug("can't refresh, already in progress");
+    // the running refresh may have read the mods before they changed
+    log::debug("refresh already in progress, another one will follow");
+    m_DirectoryRefreshQueued = true;
     return;
   }
 
@@ -1694,8 +2134,12 @@ void OrganizerCore::refreshDirectoryStructure()
   const auto activeModList = m_CurrentProfile->getActiveMods();
   const auto archives      = enabledArchives();
 
+  const auto check = std::exchange(m_DirectoryRefreshChecksFiles, false)
+                         ? LayerCheck::Files
+                         : LayerCheck::Quick;
   m_DirectoryRefresher->setMods(activeModList,
-                                std::set<QString>(archives.begin(), archives.end()));
+                                std::set<QString>(archives.begin(), archives.end()),
+                                check);
 
   // runs refresh() in a thread
   QTimer::singleShot(0, m_DirectoryRefresher.get(), &DirectoryRefresher::refresh);
@@ -1706,7 +2150,8 @@ void OrganizerCore::onDirectoryRefreshed()
   log::debug("directory refreshed, finishing up");
   TimeThis tt("OrganizerCore::onDirectoryRefreshed()");
 
-  DirectoryEntry* newStructure = m_DirectoryRefresher->stealDirectoryStructure();
+  std::shared_ptr<DirectoryEntry> newStructure(
+      m_DirectoryRefresher->stealDirectoryStructure());
   Q_ASSERT(newStructure != m_DirectoryStructure);
 
   if (newStructure == nullptr) {
@@ -1715,24 +2160,34 @@ void OrganizerCore::onDirectoryRefreshed()
     return;
   }
 
-  std::swap(m_DirectoryStructure, newStructure);
+  {
+    // readers still holding the old structure keep using it, it is freed
+    // when the last of them lets go
+    std::scoped_lock lock(m_DirectoryStructureMutex);
+    std::swap(m_DirectoryStructure, newStructure);
+  }
   m_VirtualFileTree.invalidate();
 
+  // mods may have been installed, removed or gained a mapped directory
+  m_CurrentModMappings.reset();
+
+#ifndef _WIN32
+  // watched from here on, edits made during the refresh are already in
+  m_ModWatcher.watch(activeModDataDirectories());
+#endif
+
   if (m_StructureDeleter.joinable()) {
     m_StructureDeleter.join();
   }
 
-  m_StructureDeleter = MOShared::startSafeThread([=] {
-    log::debug("structure deleter thread start");
-    delete newStructure;
-    log::debug("structure deleter thread done");
-  });
+  m_StructureDeleter =
+      MOShared::startSafeThread([old = std::move(newStructure)]() mutable {
+        log::debug("structure deleter thread start");
+        old.reset();
+        log::debug("structure deleter thread done");
+      });
 
-  log::debug("clearing caches");
-  for (int i = 0; i < m_ModList.rowCount(); ++i) {
-    ModInfo::Ptr modInfo = ModInfo::getByIndex(i);
-    modInfo->clearCaches();
-  }
+  refreshModCaches();
 
   // needs to be done before post refresh tasks
   m_DirectoryUpdate = false;
@@ -1749,81 +2204,601 @@ void OrganizerCore::onDirectoryRefreshed()
   emit directoryStructureReady();
 
   log::debug("refresh done");
+
+  if (m_DirectoryRefreshQueued) {
+    m_DirectoryRefreshQueued = false;
+    refreshDirectoryStructure();
+  }
 }
 
-void OrganizerCore::clearCaches(std::vector<unsigned int> const& indices) const
+// whether a change to the file at `path` affects the plugin or archive lists
+//
+static bool changesLists(const QString& path)
 {
-  const auto insert = [](auto& dest, const auto& from) {
-    dest.insert(from.begin(), from.end());
-  };
-  std::set<unsigned int> allIndices;
-  for (const auto index : indices) {
-    ModInfo::Ptr modInfo = ModInfo::getByIndex(index);
+  const QString suffix = QFileInfo(path).suffix().toLower();
+  return suffix == "esp" || suffix == "esm" || suffix == "esl" || suffix == "bsa" ||
+         suffix == "ba2";
+}
 
-    if (m_CurrentProfile->modEnabled(index)) {
-      // if the mod is enabled, we need to first clear its cache so that
-      // getModOverwrite(), ..., returns the newly conflicting mods (in case
-      // the mod just got enabled)
-      modInfo->clearCaches();
-      insert(allIndices, modInfo->getModOverwrite());
-      insert(allIndices, modInfo->getModOverwritten());
-      insert(allIndices, modInfo->getModArchiveOverwrite());
-      insert(allIndices, modInfo->getModArchiveOverwritten());
-      insert(allIndices, modInfo->getModArchiveLooseOverwrite());
-      insert(allIndices, modInfo->getModArchiveLooseOverwritten());
-    } else {
-      // if the mod is disabled, we need to first fetch the conflicting
-      // mods, and then clear the cache
-      insert(allIndices, modInfo->getModOverwrite());
-      insert(allIndices, modInfo->getModOverwritten());
-      insert(allIndices, modInfo->getModArchiveOverwrite());
-      insert(allIndices, modInfo->getModArchiveOverwritten());
-      insert(allIndices, modInfo->getModArchiveLooseOverwrite());
-      insert(allIndices, modInfo->getModArchiveLooseOverwritten());
-      modInfo->clearCaches();
-    }
+#ifndef _WIN32
+std::vector<std::pair<QString, QString>> OrganizerCore::activeModDataDirectories() const
+{
+  std::vector<std::pair<QString, QString>> result;
+
+  if (m_CurrentProfile == nullptr) {
+    return result;
   }
 
-  for (auto& index : allIndices) {
-    ModInfo::getByIndex(index)->clearCaches();
+  const QString modDataDir = managedGame()->modDataDirectory();
+
+  for (auto&& [name, path, priority] : m_CurrentProfile->getActiveMods()) {
+    result.emplace_back(name, modDataDir.isEmpty() ? path : path + "/" + modDataDir);
   }
+
+  return result;
 }
 
-void OrganizerCore::modPrioritiesChanged(const QModelIndexList& indices)
+void OrganizerCore::onModFilesChanged(
+    const std::vector<ModDirectoryWatcher::Change>& changes)
 {
-  for (unsigned int i = 0; i < currentProfile()->numMods(); ++i) {
-    int priority = currentProfile()->getModPriority(i);
-    if (currentProfile()->modEnabled(i)) {
-      ModInfo::Ptr modInfo = ModInfo::getByIndex(i);
-      const auto name = MOBase::ToWString(modInfo->internalName());
-      // priorities in the directory structure are one higher because data is 0
-      if (directoryStructure()->originExists(name)) {
-        directoryStructure()->getOriginByName(name).setPriority(priority + 1);
-      }
-    }
+  if (m_DirectoryUpdate) {
+    // the refresh running now rescans everything and rewatches when done
+    return;
   }
-  refreshBSAList();
-  currentProfile()->writeModlist();
-  directoryStructure()->getFileRegister()->sortOrigins();
 
-  std::vector<unsigned int> vindices;
+  TimeThis tt("OrganizerCore::onModFilesChanged()");
 
-  for (auto& idx : indices) {
-    vindices.push_back(idx.data(ModList::IndexRole).toInt());
-  }
+  std::set<QString> mods;
+  bool listsChanged = false;
+  DirectoryStats dummy;
 
-  clearCaches(vindices);
-}
+  {
+    DirectoryStructurePatch patch(*this);
 
-void OrganizerCore::modStatusChanged(unsigned int index)
-{
-  try {
-    ModInfo::Ptr modInfo = ModInfo::getByIndex(index);
-    if (m_CurrentProfile->modEnabled(index)) {
+    for (const auto& c : changes) {
+      const std::wstring originName = c.mod.toStdWString();
+
+      if (!m_DirectoryStructure->originExists(originName)) {
+        continue;
+      }
+
+      FilesOrigin& origin = m_DirectoryStructure->getOriginByName(originName);
+      if (origin.isDisabled()) {
+        continue;
+      }
+
+      if (c.type == ModDirectoryWatcher::Change::Type::DirectoryChanged) {
+        // same as what the file tree does when an origin was modified
+        origin.enable(false, dummy);
+        m_DirectoryStructure->addFromOrigin(origin.getName(), origin.getPath(),
+                                            origin.getPriority(), dummy);
+        listsChanged = true;
+      } else {
+        const QString absolute =
+            QString::fromStdWString(origin.getPath()) + "/" + c.path;
+        const std::wstring relative = c.path.toStdWString();
+
+        std::error_code ec;
+        const auto lwt = std::filesystem::last_write_time(absolute.toStdString(), ec);
+
+        if (c.type == ModDirectoryWatcher::Change::Type::FileChanged && !ec) {
+          m_DirectoryStructure->addLooseFile(origin, relative, ToFILETIME(lwt), dummy);
+        } else {
+          // also when a changed file is already gone again
+          m_DirectoryStructure->removeFileFromOrigin(origin, relative);
+        }
+
+        if (changesLists(c.path)) {
+          listsChanged = true;
+        }
+      }
+
+      mods.insert(c.mod);
+    }
+
+    if (!mods.empty()) {
+      DirectoryRefresher::cleanStructure(m_DirectoryStructure.get());
+    }
+  }
+
+  if (mods.empty()) {
+    return;
+  }
+
+  log::debug("applied {} changes on disk to {} mods", changes.size(), mods.size());
+
+  for (const auto& mod : mods) {
+    const unsigned int index = ModInfo::getIndex(mod);
+    if (index != UINT_MAX) {
+      ModInfo::getByIndex(index)->clearCaches();
+    }
+  }
+
+  if (listsChanged) {
+    refreshLists();
+  }
+
+  emit directoryStructureChanged();
+}
+
+void OrganizerCore::refreshAfterRun()
+{
+  bool plugins = (pluginListsStamp() != m_RunPluginListsStamp);
+  bool archives = false;
+
+  if (!refreshOverwriteOrigin(archives)) {
+    refreshDirectoryStructure();
+    plugins = true;
+  }
+
+  if (plugins || archives) {
+    refreshESPList(true);
+    savePluginList();
+  }
+
+  if (archives) {
+    refreshBSAList();
+  }
+}
+
+bool OrganizerCore::refreshOverwriteOrigin(bool& listsChanged)
+{
+  // without the watcher, changes to the mods themselves may have been missed
+  if (!m_ModWatcher.isWatching() || m_DirectoryUpdate ||
+      !m_DirectoryStructure->isPopulated() || ModInfo::getOverwrite() == nullptr) {
+    return false;
+  }
+
+  const ModInfo::Ptr overwrite = ModInfo::getOverwrite();
+  const std::wstring originName = ToWString(overwrite->internalName());
+  if (!m_DirectoryStructure->originExists(originName)) {
+    return false;
+  }
+
+  TimeThis tt("OrganizerCore::refreshOverwriteOrigin()");
+
+  const auto listedFiles = [&] {
+    std::set<std::pair<std::wstring, std::uint64_t>> files;
+    const FilesOrigin& origin = m_DirectoryStructure->getOriginByName(originName);
+    for (const auto& file : origin.getFiles()) {
+      if (changesLists(QString::fromStdWString(file->getName()))) {
+        const FILETIME time = file->getFileTime();
+        files.emplace(file->getRelativePath(),
+                      (std::uint64_t(time.dwHighDateTime) << 32) | time.dwLowDateTime);
+      }
+    }
+    return files;
+  };
+
+  const auto before = listedFiles();
+
+  {
+    // same as onModFilesChanged() does for a directory it can't follow
+    DirectoryStructurePatch patch(*this);
+    DirectoryStats dummy;
+    FilesOrigin& origin = m_DirectoryStructure->getOriginByName(originName);
+    origin.enable(false, dummy);
+    m_DirectoryStructure->addFromOrigin(origin.getName(), origin.getPath(),
+                                        origin.getPriority(), dummy);
+
+    DirectoryRefresher::cleanStructure(m_DirectoryStructure.get());
+  }
+  overwrite->clearCaches();
+
+  listsChanged = (listedFiles() != before);
+
+  emit directoryStructureChanged();
+  return true;
+}
+
+QString OrganizerCore::pluginListsStamp() const
+{
+  if (m_CurrentProfile == nullptr) {
+    return {};
+  }
+
+  QStringList stamp;
+  for (const QString& path : {m_CurrentProfile->getPluginsFileName(),
+                              m_CurrentProfile->getLoadOrderFileName()}) {
+    const QFileInfo info(path);
+    stamp.append(info.exists() ? QString("%1:%2").arg(info.size()).arg(
+                                     info.lastModified().toMSecsSinceEpoch())
+                               : QString("-"));
+  }
+
+  return stamp.join('|');
+}
+#endif
+
+void OrganizerCore::applyModRenames(
+    int originID, const std::vector<std::pair<QString, QString>>& renames)
+{
+  if (renames.empty() || m_DirectoryUpdate) {
+    // the refresh running now lists the mods with the new names
+    return;
+  }
+
+  const FilesOrigin* found = m_DirectoryStructure->findOriginByID(originID);
+  if (found == nullptr || found->isDisabled()) {
+    return;
+  }
+
+  TimeThis tt("OrganizerCore::applyModRenames()");
+
+  FilesOrigin& origin = m_DirectoryStructure->getOriginByID(originID);
+  const QString root  = QString::fromStdWString(origin.getPath());
+  const QDir rootDir(root);
+
+  const auto provides = [&](const FileEntry& file) {
+    const auto& alternatives = file.getAlternatives();
+    return file.getOrigin() == originID ||
+           std::any_of(alternatives.begin(), alternatives.end(), [&](auto&& a) {
+             return a.originID() == originID;
+           });
+  };
+
+  bool listsChanged = false;
+  bool reread       = false;
+  std::size_t moved = 0;
+
+  {
+    DirectoryStructurePatch patch(*this);
+    DirectoryStats dummy;
+
+    for (const auto& [from, to] : renames) {
+      const QString fromPath = rootDir.relativeFilePath(from);
+      const QString toPath   = rootDir.relativeFilePath(to);
+
+      if (fromPath.startsWith("..") || toPath.startsWith("..")) {
+        // outside of the mod's data directory, not in the structure
+        continue;
+      }
+
+      // paths of the files that were renamed, relative to `from`; empty for a
+      // file, everything the origin has under it for a directory
+      std::vector<QString> files;
+
+      const auto fromW = fromPath.toStdWString();
+
+      if (auto file = m_DirectoryStructure->findFileByPath(fromW);
+          file && provides(*file)) {
+        files.emplace_back();
+      } else if (auto* dir = m_DirectoryStructure->findDirectoryByPath(fromW)) {
+        const auto collect = [&](const DirectoryEntry& d, const QString& prefix,
+                                 auto&& self) -> void {
+          d.forEachFile([&](const FileEntry& f) {
+            if (provides(f)) {
+              files.push_back(prefix + "/" + QString::fromStdWString(f.getName()));
+            }
+            return true;
+          });
+
+          d.forEachDirectory([&](const DirectoryEntry& sub) {
+            self(sub, prefix + "/" + QString::fromStdWString(sub.getName()), self);
+            return true;
+          });
+        };
+
+        collect(*dir, "", collect);
+      }
+
+      for (const auto& file : files) {
+        const QString oldPath = fromPath + file;
+        const QString newPath = toPath + file;
+
+        m_DirectoryStructure->removeFileFromOrigin(origin, oldPath.toStdWString());
+
+        // a later rename of the list may have moved the file again; the entry
+        // only has the time of the winning origin, which may not be this one,
+        // so the origin is read again instead
+        std::error_code ec;
+        const auto lwt =
+            std::filesystem::last_write_time((root + "/" + newPath).toStdString(), ec);
+
+        if (ec) {
+          reread = true;
+        } else {
+          m_DirectoryStructure->addLooseFile(origin, newPath.toStdWString(),
+                                             ToFILETIME(lwt), dummy);
+        }
+
+        if (changesLists(oldPath) || changesLists(newPath)) {
+          listsChanged = true;
+        }
+
+        ++moved;
+      }
+    }
+
+    if (reread) {
+      // same as onModFilesChanged() does for a directory it can't follow
+      log::debug("reading '{}' again, a renamed file is gone",
+                 QString::fromStdWString(origin.getName()));
+      origin.enable(false, dummy);
+      m_DirectoryStructure->addFromOrigin(origin.getName(), origin.getPath(),
+                                          origin.getPriority(), dummy);
+      listsChanged = true;
+    }
+
+    if (moved != 0) {
+      DirectoryRefresher::cleanStructure(m_DirectoryStructure.get());
+    }
+  }
+
+  const QString name = QString::fromStdWString(origin.getName());
+  log::debug("applied {} renamed files to '{}'", moved, name);
+
+  if (moved == 0) {
+    return;
+  }
+
+  const unsigned int index = ModInfo::getIndex(name);
+  if (index != UINT_MAX) {
+    ModInfo::getByIndex(index)->clearCaches();
+  }
+
+  if (listsChanged) {
+    refreshLists();
+  }
+
+  emit directoryStructureChanged();
+}
+
+bool OrganizerCore::switchDirectoryStructure(const Profile& oldProfile)
+{
+  if (m_RefreshTransactions > 0 || m_DirectoryUpdate ||
+      !m_DirectoryStructure->isPopulated() ||
+      oldProfile.numMods() != m_CurrentProfile->numMods()) {
+    return false;
+  }
+
+  if (settings().archiveParsing()) {
+    // the files of archives are only in the structure for the archives enabled in
+    // the profile, ordered by its load order
+    const auto sameContents = [](const QString& lhs, const QString& rhs) {
+      QFile lhsFile(lhs);
+      QFile rhsFile(rhs);
+      const bool lhsOpen = lhsFile.open(QIODevice::ReadOnly);
+      const bool rhsOpen = rhsFile.open(QIODevice::ReadOnly);
+      return lhsOpen == rhsOpen && lhsFile.readAll() == rhsFile.readAll();
+    };
+
+    if (!sameContents(oldProfile.getArchivesFileName(),
+                      m_CurrentProfile->getArchivesFileName()) ||
+        !sameContents(oldProfile.getPluginsFileName(),
+                      m_CurrentProfile->getPluginsFileName()) ||
+        !sameContents(oldProfile.getLoadOrderFileName(),
+                      m_CurrentProfile->getLoadOrderFileName())) {
+      return false;
+    }
+  }
+
+  TimeThis tt("OrganizerCore::switchDirectoryStructure()");
+
+  const QString modDataDir = managedGame()->modDataDirectory();
+  std::vector<DirectoryRefresher::EntryInfo> entries;
+  std::vector<unsigned int> enabled;
+  std::size_t disabled = 0;
+
+  try {
+    {
+      DirectoryStructurePatch patch(*this);
+
+      for (unsigned int i = 0; i < m_CurrentProfile->numMods(); ++i) {
+        const bool active = m_CurrentProfile->modEnabled(i);
+        if (active == oldProfile.modEnabled(i)) {
+          continue;
+        }
+
+        ModInfo::Ptr modInfo = ModInfo::getByIndex(i);
+
+        if (active) {
+          QString path = modInfo->absolutePath();
+          path         = modDataDir.isEmpty() ? path : path + "/" + modDataDir;
+          entries.push_back({modInfo->name(),
+                             path,
+                             modInfo->stealFiles(),
+                             {},
+                             m_CurrentProfile->getModPriority(i)});
+          enabled.push_back(i);
+        } else {
+          if (m_DirectoryStructure->originExists(ToWString(modInfo->name()))) {
+            m_DirectoryStructure->getOriginByName(ToWString(modInfo->name()))
+                .enable(false);
+          }
+          ++disabled;
+        }
+      }
+
+      log::debug("switching profile in place, {} mods enabled and {} disabled",
+                 entries.size(), disabled);
+
+      if (!entries.empty()) {
+        m_DirectoryRefresher->addMultipleModsFilesToStructure(
+            m_DirectoryStructure.get(), entries);
+        DirectoryRefresher::cleanStructure(m_DirectoryStructure.get());
+      }
+    }
+
+    // the plugins of the new profile give the load order of the archives
+    refreshESPList(true);
+
+    const auto archives = enabledArchives();
+    m_DirectoryRefresher->setMods(m_CurrentProfile->getActiveMods(),
+                                  std::set<QString>(archives.begin(), archives.end()));
+
+    DirectoryStructurePatch patch(*this);
+
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+      const ModInfo::Ptr modInfo = ModInfo::getByIndex(enabled[i]);
+      m_DirectoryRefresher->addModBSAToStructure(
+          m_DirectoryStructure.get(), entries[i].modName, entries[i].priority,
+          entries[i].absolutePath, modInfo->archives());
+    }
+
+    // the profiles may order the mods differently
+    for (unsigned int i = 0; i < m_CurrentProfile->numMods(); ++i) {
+      ModInfo::Ptr modInfo = ModInfo::getByIndex(i);
+      if (m_DirectoryStructure->originExists(ToWString(modInfo->name()))) {
+        // priorities in the directory structure are one higher because data is
+        // 0
+        m_DirectoryStructure->getOriginByName(ToWString(modInfo->name()))
+            .setPriority(m_CurrentProfile->getModPriority(i) + 1);
+      }
+    }
+    m_DirectoryStructure->getFileRegister()->sortOrigins();
+  } catch (const std::exception& e) {
+    // the structure may be half updated, a refresh builds it again from scratch
+    log::error("failed to switch the profile in place, refreshing: {}", e.what());
+    return false;
+  }
+
+#ifndef _WIN32
+  m_ModWatcher.watch(activeModDataDirectories());
+#endif
+
+  refreshModCaches();
+  refreshBSAList();
+
+  emit directoryStructureChanged();
+
+  return true;
+}
+
+void OrganizerCore::refreshModCaches()
+{
+  log::debug("clearing caches");
+  std::vector<ModInfo::Ptr> mods;
+  mods.reserve(m_ModList.rowCount());
+  for (int i = 0; i < m_ModList.rowCount(); ++i) {
+    ModInfo::Ptr modInfo = ModInfo::getByIndex(i);
+    modInfo->clearCaches();
+    mods.push_back(modInfo);
+  }
+
+  // the conflicts of every mod are needed to paint the mod list, computing them
+  // all here in parallel is much faster than one by one on demand; nothing
+  // changes the structure while this runs and the views only see the results
+  // once they're all in; what the checks share is read here, the workers neither
+  // take the mod list lock nor call into the game plugin
+  log::debug("computing conflicts");
+  const ModInfo::ConflictContext context(*this);
+  MOShared::parallelMap(
+      mods.begin(), mods.end(),
+      [&context](const ModInfo::Ptr& mod) {
+        mod->prefetchConflicts(context);
+      },
+      m_Settings.refreshThreadCount());
+
+  ModInfo::reportMemoryUsage();
+}
+
+void OrganizerCore::clearCaches(std::vector<unsigned int> const& indices) const
+{
+  const auto insert = [](auto& dest, const auto& from) {
+    dest.insert(from.begin(), from.end());
+  };
+  std::set<unsigned int> allIndices;
+  for (const auto index : indices) {
+    ModInfo::Ptr modInfo = ModInfo::getByIndex(index);
+
+    if (m_CurrentProfile->modEnabled(index)) {
+      // if the mod is enabled, we need to first clear its cache so that
+      // getModOverwrite(), ..., returns the newly conflicting mods (in case
+      // the mod just got enabled)
+      modInfo->clearCaches();
+      insert(allIndices, modInfo->getModOverwrite());
+      insert(allIndices, modInfo->getModOverwritten());
+      insert(allIndices, modInfo->getModArchiveOverwrite());
+      insert(allIndices, modInfo->getModArchiveOverwritten());
+      insert(allIndices, modInfo->getModArchiveLooseOverwrite());
+      insert(allIndices, modInfo->getModArchiveLooseOverwritten());
+    } else {
+      // if the mod is disabled, we need to first fetch the conflicting
+      // mods, and then clear the cache
+      insert(allIndices, modInfo->getModOverwrite());
+      insert(allIndices, modInfo->getModOverwritten());
+      insert(allIndices, modInfo->getModArchiveOverwrite());
+      insert(allIndices, modInfo->getModArchiveOverwritten());
+      insert(allIndices, modInfo->getModArchiveLooseOverwrite());
+      insert(allIndices, modInfo->getModArchiveLooseOverwritten());
+      modInfo->clearCaches();
+    }
+  }
+
+  for (auto& index : allIndices) {
+    ModInfo::getByIndex(index)->clearCaches();
+  }
+}
+
+void OrganizerCore::modPrioritiesChanged(const QModelIndexList& indices)
+{
+  m_CurrentModMappings.reset();
+
+  if (m_DirectoryUpdate) {
+    // the running refresh was started with the old priorities, they're applied to the
+    // structure it builds once it's done
+    onNextRefresh(
+        [this, indices] {
+          modPrioritiesChanged(indices);
+        },
+        RefreshCallbackGroup::CORE, RefreshCallbackMode::RUN_NOW_IF_POSSIBLE);
+    return;
+  }
+
+  {
+    DirectoryStructurePatch patch(*this);
+    for (unsigned int i = 0; i < currentProfile()->numMods(); ++i) {
+      int priority = currentProfile()->getModPriority(i);
+      if (currentProfile()->modEnabled(i)) {
+        ModInfo::Ptr modInfo = ModInfo::getByIndex(i);
+        const auto name      = MOBase::ToWString(modInfo->internalName());
+        // priorities in the directory structure are one higher because data is 0
+        if (directoryStructure()->originExists(name)) {
+          directoryStructure()->getOriginByName(name).setPriority(priority + 1);
+        }
+      }
+    }
+  }
+  refreshBSAList();
+  currentProfile()->writeModlist();
+  {
+    DirectoryStructurePatch patch(*this);
+    directoryStructure()->getFileRegister()->sortOrigins();
+  }
+
+  std::vector<unsigned int> vindices;
+
+  for (auto& idx : indices) {
+    vindices.push_back(idx.data(ModList::IndexRole).toInt());
+  }
+
+  clearCaches(vindices);
+}
+
+void OrganizerCore::modStatusChanged(unsigned int index)
+{
+  m_CurrentModMappings.reset();
+
+  if (m_DirectoryUpdate) {
+    // the running refresh was started with the old states, they're applied to the
+    // structure it builds once it's done
+    onNextRefresh(
+        [this, index] {
+          modStatusChanged(index);
+        },
+        RefreshCallbackGroup::CORE, RefreshCallbackMode::RUN_NOW_IF_POSSIBLE);
+    return;
+  }
+
+  try {
+    ModInfo::Ptr modInfo = ModInfo::getByIndex(index);
+    if (m_CurrentProfile->modEnabled(index)) {
       updateModInDirectoryStructure(index, modInfo);
     } else {
       updateModActiveState(index, false);
       if (m_DirectoryStructure->originExists(ToWString(modInfo->name()))) {
+        DirectoryStructurePatch patch(*this);
         FilesOrigin& origin =
             m_DirectoryStructure->getOriginByName(ToWString(modInfo->name()));
         origin.enable(false);
@@ -1833,17 +2808,20 @@ void OrganizerCore::modStatusChanged(unsigned int index)
       }
     }
 
-    for (unsigned int i = 0; i < m_CurrentProfile->numMods(); ++i) {
-      ModInfo::Ptr modInfo = ModInfo::getByIndex(i);
-      int priority         = m_CurrentProfile->getModPriority(i);
-      if (m_DirectoryStructure->originExists(ToWString(modInfo->name()))) {
-        // priorities in the directory structure are one higher because data is
-        // 0
-        m_DirectoryStructure->getOriginByName(ToWString(modInfo->name()))
-            .setPriority(priority + 1);
+    {
+      DirectoryStructurePatch patch(*this);
+      for (unsigned int i = 0; i < m_CurrentProfile->numMods(); ++i) {
+        ModInfo::Ptr modInfo = ModInfo::getByIndex(i);
+        int priority         = m_CurrentProfile->getModPriority(i);
+        if (m_DirectoryStructure->originExists(ToWString(modInfo->name()))) {
+          // priorities in the directory structure are one higher because data is
+          // 0
+          m_DirectoryStructure->getOriginByName(ToWString(modInfo->name()))
+              .setPriority(priority + 1);
+        }
       }
+      m_DirectoryStructure->getFileRegister()->sortOrigins();
     }
-    m_DirectoryStructure->getFileRegister()->sortOrigins();
 
     refreshLists();
     clearCaches({index});
@@ -1856,6 +2834,19 @@ void OrganizerCore::modStatusChanged(unsigned int index)
 
 void OrganizerCore::modStatusChanged(QList<unsigned int> index)
 {
+  m_CurrentModMappings.reset();
+
+  if (m_DirectoryUpdate) {
+    // the running refresh was started with the old states, they're applied to the
+    // structure it builds once it's done
+    onNextRefresh(
+        [this, index] {
+          modStatusChanged(index);
+        },
+        RefreshCallbackGroup::CORE, RefreshCallbackMode::RUN_NOW_IF_POSSIBLE);
+    return;
+  }
+
   try {
     QMap<unsigned int, ModInfo::Ptr> modsToEnable;
     QMap<unsigned int, ModInfo::Ptr> modsToDisable;
@@ -1875,6 +2866,7 @@ void OrganizerCore::modStatusChanged(QList<unsigned int> index)
       updateModsActiveState(modsToDisable.keys(), false);
       for (auto idx : modsToDisable.keys()) {
         if (m_DirectoryStructure->originExists(ToWString(modsToDisable[idx]->name()))) {
+          DirectoryStructurePatch patch(*this);
           FilesOrigin& origin = m_DirectoryStructure->getOriginByName(
               ToWString(modsToDisable[idx]->name()));
           origin.enable(false);
@@ -1885,17 +2877,20 @@ void OrganizerCore::modStatusChanged(QList<unsigned int> index)
       }
     }
 
-    for (unsigned int i = 0; i < m_CurrentProfile->numMods(); ++i) {
-      ModInfo::Ptr modInfo = ModInfo::getByIndex(i);
-      int priority         = m_CurrentProfile->getModPriority(i);
-      if (m_DirectoryStructure->originExists(ToWString(modInfo->name()))) {
-        // priorities in the directory structure are one higher because data is
-        // 0
-        m_DirectoryStructure->getOriginByName(ToWString(modInfo->name()))
-            .setPriority(priority + 1);
+    {
+      DirectoryStructurePatch patch(*this);
+      for (unsigned int i = 0; i < m_CurrentProfile->numMods(); ++i) {
+        ModInfo::Ptr modInfo = ModInfo::getByIndex(i);
+        int priority         = m_CurrentProfile->getModPriority(i);
+        if (m_DirectoryStructure->originExists(ToWString(modInfo->name()))) {
+          // priorities in the directory structure are one higher because data is
+          // 0
+          m_DirectoryStructure->getOriginByName(ToWString(modInfo->name()))
+              .setPriority(priority + 1);
+        }
       }
+      m_DirectoryStructure->getFileRegister()->sortOrigins();
     }
-    m_DirectoryStructure->getFileRegister()->sortOrigins();
 
     refreshLists();
     clearCaches(vindices);
@@ -1969,12 +2964,24 @@ void OrganizerCore::loginFailedUpdate(const QString& message)
 void OrganizerCore::syncOverwrite()
 {
   ModInfo::Ptr modInfo = ModInfo::getOverwrite();
-  SyncOverwriteDialog syncDialog(modInfo->absolutePath(), m_DirectoryStructure,
+  SyncOverwriteDialog syncDialog(modInfo->absolutePath(), m_DirectoryStructure.get(),
                                  qApp->activeWindow());
   if (syncDialog.exec() == QDialog::Accepted) {
-    syncDialog.apply(QDir::fromNativeSeparators(m_Settings.paths().mods()));
+    const auto synced =
+        syncDialog.apply(QDir::fromNativeSeparators(m_Settings.paths().mods()));
     modInfo->diskContentModified();
-    refreshDirectoryStructure();
+
+    // the moved files only change origins, which is patched into the structure
+    // like changes the watcher reports
+    std::vector<ModDirectoryWatcher::Change> changes;
+    changes.reserve(synced.size() * 2);
+    for (const auto& file : synced) {
+      changes.push_back(
+          {ModDirectoryWatcher::Change::Type::FileChanged, file.mod, file.path});
+      changes.push_back(
+          {ModDirectoryWatcher::Change::Type::FileRemoved, modInfo->name(), file.path});
+    }
+    onModFilesChanged(changes);
   }
 }
 
@@ -2067,8 +3074,21 @@ bool OrganizerCore::saveCurrentLists()
 
 void OrganizerCore::savePluginList()
 {
+  // this writes the current lists, anything scheduled would only write them
+  // again
+  m_PluginListsWriter.cancel();
+
+  if (m_PluginListSaveQueued) {
+    // the queued save runs after the update and will see every change up to
+    // then
+    return;
+  }
+
+  m_PluginListSaveQueued = true;
+
   onNextRefresh(
       [this]() {
+        m_PluginListSaveQueued = false;
         m_PluginList.saveTo(m_CurrentProfile->getLockedOrderFileName());
         m_PluginList.saveLoadOrder(*m_DirectoryStructure);
       },
@@ -2117,6 +3137,19 @@ bool OrganizerCore::beforeRun(
     return false;
   }
 
+#ifndef _WIN32
+  m_RunPluginListsStamp = pluginListsStamp();
+#endif
+
+#ifndef _WIN32
+  // Steam and the wineserver don't need the vfs, they start while it's mounted
+  spawn::prewarmLaunch();
+
+  // the files this launch reads are read ahead on the next one of the profile
+  m_USVFS.setAccessTrace(
+      QDir(m_Settings.paths().profiles()).filePath(profileName + "/vfs_access.trace"));
+#endif
+
   try {
     m_USVFS.updateMapping(fileMapping(profileName, customOverwrite));
     m_USVFS.updateForcedLibraries(forcedLibraries);
@@ -2240,7 +3273,16 @@ void OrganizerCore::afterRun(const QFileInfo& binary, DWORD exitCode)
   // flushes the staging directory (moves new/changed files to overwrite)
   // and tears down the FUSE session.  This mirrors Windows behaviour where
   // USVFS is only active while a hooked process is running.
-  m_USVFS.unmount();
+  //
+  // When it's kept mounted, the next launch only remaps it and the staging
+  // directory is flushed in the background; the directory structure is
+  // refreshed once that's done, see stagingFlushed()
+  const bool keepMounted = m_USVFS.keepsMountedAfterRun();
+  if (keepMounted) {
+    m_USVFS.flushStagingInBackground();
+  } else {
+    m_USVFS.unmount();
+  }
 
   if (m_CurrentProfile != nullptr) {
     const QString prefixPathStr = resolveWinePrefixPath(m_Settings, managedGame());
@@ -2290,10 +3332,16 @@ void OrganizerCore::afterRun(const QFileInfo& binary, DWORD exitCode)
   // Refresh directory structure after VFS is unmounted so the refresher
   // reads the real (vanilla) data directory plus individual mod directories,
   // matching Windows USVFS behaviour.
+#ifndef _WIN32
+  if (!keepMounted) {
+    refreshAfterRun();
+  }
+#else
   refreshDirectoryStructure();
 
   refreshESPList(true);
   savePluginList();
+#endif
   cycleDiagnostics();
 
   // These callbacks should not fiddle with directory structure and ESPs.
@@ -2322,8 +3370,23 @@ std::vector<Mapping> OrganizerCore::fileMapping(const QString& profileName,
   }
 
   IPluginGame* game = qApp->property("managed_game").value<IPluginGame*>();
-  Profile profile(QDir(m_Settings.paths().profiles() + "/" + profileName), game,
-                  gameFeatures());
+
+  // the current profile has the same state as on disk, launches write it first, and
+  // its mappings only change along with the mods
+  std::vector<ModMappings> otherMods;
+  const std::vector<ModMappings>* mods = nullptr;
+
+  if (m_CurrentProfile != nullptr && m_CurrentProfile->name() == profileName) {
+    if (!m_CurrentModMappings) {
+      m_CurrentModMappings = modMappings(*m_CurrentProfile);
+    }
+    mods = &*m_CurrentModMappings;
+  } else {
+    Profile profile(QDir(m_Settings.paths().profiles() + "/" + profileName), game,
+                    gameFeatures());
+    otherMods = modMappings(profile);
+    mods      = &otherMods;
+  }
 
   MappingType result;
 
@@ -2331,29 +3394,12 @@ std::vector<Mapping> OrganizerCore::fileMapping(const QString& profileName,
 
   bool overwriteActive = false;
 
-  for (const auto& mod : profile.getActiveMods()) {
-    if (std::get<0>(mod).compare("overwrite", Qt::CaseInsensitive) == 0) {
-      continue;
-    }
-
-    unsigned int modIndex = ModInfo::getIndex(std::get<0>(mod));
-    ModInfo::Ptr modPtr   = ModInfo::getByIndex(modIndex);
-
-    bool createTarget = customOverwrite == std::get<0>(mod);
-    QDir modDir       = QDir(std::get<1>(mod));
-
+  for (const auto& mod : *mods) {
+    bool createTarget = customOverwrite == mod.name;
     overwriteActive |= createTarget;
 
-    if (modPtr->isRegular()) {
-      for (auto dataMap : dataMaps.asKeyValueRange()) {
-        auto mapDir = QDir(modDir.absoluteFilePath(dataMap.first));
-        if (mapDir.exists()) {
-          for (auto dir : dataMap.second) {
-            result.insert(result.end(),
-                          {mapDir.absolutePath(), dir, true, createTarget});
-          }
-        }
-      }
+    for (const auto& map : mod.mappings) {
+      result.push_back({map.source, map.destination, map.isDirectory, createTarget});
     }
   }
 
@@ -2398,6 +3444,41 @@ std::vector<Mapping> OrganizerCore::fileMapping(const QString& profileName,
   return result;
 }
 
+std::vector<OrganizerCore::ModMappings>
+OrganizerCore::modMappings(Profile& profile) const
+{
+  const auto dataMaps = managedGame()->getModMappings();
+
+  std::vector<ModMappings> result;
+
+  for (const auto& mod : profile.getActiveMods()) {
+    if (std::get<0>(mod).compare("overwrite", Qt::CaseInsensitive) == 0) {
+      continue;
+    }
+
+    unsigned int modIndex = ModInfo::getIndex(std::get<0>(mod));
+    ModInfo::Ptr modPtr   = ModInfo::getByIndex(modIndex);
+
+    QDir modDir = QDir(modFilesPath(std::get<1>(mod)));
+
+    ModMappings& current = result.emplace_back();
+    current.name         = std::get<0>(mod);
+
+    if (modPtr->isRegular()) {
+      for (auto dataMap : dataMaps.asKeyValueRange()) {
+        auto mapDir = QDir(modDir.absoluteFilePath(dataMap.first));
+        if (mapDir.exists()) {
+          for (auto dir : dataMap.second) {
+            current.mappings.push_back({mapDir.absolutePath(), dir, true, false});
+          }
+        }
+      }
+    }
+  }
+
+  return result;
+}
+
 std::vector<Mapping> OrganizerCore::fileMapping(const QString& dataPath,
                                                 const QString& relPath,
                                                 const DirectoryEntry* base,
@@ -39,6 +39,7 @@
 #include "usvfsconnector.h"
 #else
 #include "fuseconnector.h"
+#include "moddirectorywatcher.h"
 #endif
 
 class ModListSortProxy;
@@ -49,7 +50,12 @@ class GameFeatures;
 class PluginContainer;
 class DirectoryRefresher;
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <vector>
 
 namespace MOBase
@@ -247,6 +253,26 @@ public:
     EXTERNAL = 2
   };
 
+  // while one of these exists, the directory structure and the plugin and
+  // archive lists are not refreshed, the refreshes requested in the meantime are
+  // done once when the last transaction ends
+  //
+  // refresh() still updates the mod list right away, code changing the mods in
+  // bulk usually needs it to find the mods it just changed
+  //
+  class RefreshTransaction
+  {
+  public:
+    explicit RefreshTransaction(OrganizerCore& core);
+    ~RefreshTransaction();
+
+    RefreshTransaction(const RefreshTransaction&)            = delete;
+    RefreshTransaction& operator=(const RefreshTransaction&) = delete;
+
+  private:
+    OrganizerCore& m_Core;
+  };
+
 public:
   OrganizerCore(Settings& settings);
 
@@ -266,7 +292,69 @@ public:
   Settings& settings();
   SelfUpdater* updater() { return &m_Updater; }
   InstallationManager* installationManager();
-  MOShared::DirectoryEntry* directoryStructure() { return m_DirectoryStructure; }
+  // the structure shown in the ui, only valid on the main thread; a refresh
+  // builds a new one and swaps it in when done, this keeps returning the
+  // previous one until then
+  //
+  MOShared::DirectoryEntry* directoryStructure() { return m_DirectoryStructure.get(); }
+
+  // the current structure for readers that may run on other threads
+  //
+  // a refresh swapping in a new structure doesn't wait for the reader, the old
+  // one stays alive until the reader is gone; but the main thread also patches
+  // the structure in place between refreshes, and those patches wait until no
+  // reader is left, so a reader must only be kept for the duration of a read,
+  // and nothing that may call back into the organizer may run while it is
+  //
+  class DirectoryStructureReader
+  {
+  public:
+    DirectoryStructureReader(std::shared_mutex& access,
+                             std::shared_ptr<MOShared::DirectoryEntry> structure)
+        : m_Lock(access), m_Structure(std::move(structure))
+    {}
+
+    MOShared::DirectoryEntry* get() const { return m_Structure.get(); }
+    MOShared::DirectoryEntry* operator->() const { return m_Structure.get(); }
+    MOShared::DirectoryEntry& operator*() const { return *m_Structure; }
+
+    // keeps the structure alive past the reader, but it may be patched once the
+    // reader is gone
+    const std::shared_ptr<MOShared::DirectoryEntry>& shared() const
+    {
+      return m_Structure;
+    }
+
+  private:
+    // released after the pointer is dropped
+    std::shared_lock<std::shared_mutex> m_Lock;
+    std::shared_ptr<MOShared::DirectoryEntry> m_Structure;
+  };
+
+  DirectoryStructureReader readDirectoryStructure() const;
+
+  // held while the live structure is changed in place on the main thread, waits
+  // for the readers on other threads to be done and drops the virtual file tree
+  // once released; nothing that may read the structure through the organizer
+  // may run while it's held
+  //
+  class DirectoryStructurePatch
+  {
+  public:
+    explicit DirectoryStructurePatch(OrganizerCore& core);
+    ~DirectoryStructurePatch();
+
+    DirectoryStructurePatch(const DirectoryStructurePatch&)            = delete;
+    DirectoryStructurePatch& operator=(const DirectoryStructurePatch&) = delete;
+
+  private:
+    OrganizerCore& m_Core;
+    std::unique_lock<std::shared_mutex> m_Lock;
+  };
+
+  // whether a refresh is building a new structure right now
+  //
+  bool directoryUpdating() const { return m_DirectoryUpdate; }
   DirectoryRefresher* directoryRefresher() { return m_DirectoryRefresher.get(); }
   ExecutablesList* executablesList() { return &m_ExecutablesList; }
   void setExecutablesList(const ExecutablesList& executablesList)
@@ -328,6 +416,14 @@ public:
   void updateModInDirectoryStructure(unsigned int index, ModInfo::Ptr modInfo);
   void updateModsInDirectoryStructure(QMap<unsigned int, ModInfo::Ptr> modInfos);
 
+  // applies files or directories of the origin `originID` that were renamed by
+  // MO itself, such as when hiding or unhiding them, to the directory structure
+  // without listing the mod again, unless a renamed file is gone by then; paths
+  // are absolute
+  //
+  void applyModRenames(int originID,
+                       const std::vector<std::pair<QString, QString>>& renames);
+
   void doAfterLogin(const std::function<void()>& function)
   {
     m_PostLoginTasks.append(function);
@@ -392,15 +488,23 @@ public:
   QStringList listDirectories(const QString& directoryName) const;
   QStringList findFiles(const QString& path,
                         const std::function<bool(const QString&)>& filter) const;
+  QStringList findFiles(const QString& path, const QStringList& globFilters) const;
   QStringList getFileOrigins(const QString& fileName) const;
   QList<MOBase::IOrganizer::FileInfo> findFileInfos(
       const QString& path,
       const std::function<bool(const MOBase::IOrganizer::FileInfo&)>& filter) const;
+  QList<QList<MOBase::IOrganizer::FileInfo>>
+  queryFiles(const QList<MOBase::IOrganizer::FileQuery>& queries) const;
   DownloadManager* downloadManager();
   PluginList* pluginList();
   ModList* modList();
   void refresh(bool saveChanges = true);
 
+  // refresh() for when the user asked for it: every file of the mods is
+  // checked against the disk instead of trusting scans whose directories
+  // didn't change, so files rewritten in place are picked up
+  void refreshFromDisk();
+
   boost::signals2::connection onAboutToRun(
       const std::function<bool(const QString&, const QDir&, const QString&)>& func);
   boost::signals2::connection
@@ -449,6 +553,15 @@ public slots:
   void refreshLists();
 
   ModInfo::Ptr installDownload(int downloadIndex, int priority = -1);
+
+  // installs the given downloads one after the other, the directory structure
+  // is only refreshed once all of them are installed
+  //
+  // can be called while a batch is being installed, the downloads are then
+  // added to it
+  //
+  void installDownloads(const QList<int>& downloadIndices);
+
   ModInfo::Ptr installArchive(const QString& archivePath, int priority = -1,
                               bool reinstallation     = false,
                               ModInfo::Ptr currentMod = nullptr,
@@ -490,21 +603,64 @@ signals:
   // Use queued connections
   void directoryStructureReady();
 
+  // the directory structure was patched in place after files of mods changed
+  // on disk, without a refresh
+  void directoryStructureChanged();
+
   // Notify of a general UI refresh
   void refreshTriggered();
 
 private:
+#ifndef _WIN32
+  // data directory of every active mod, as given to the refresher
+  std::vector<std::pair<QString, QString>> activeModDataDirectories() const;
+
+  // refreshes what a program that ran through the vfs may have changed: its
+  // writes end up in overwrite and edits to the mods on disk were already
+  // applied by the watcher, so only overwrite is read again, and the plugin
+  // list only when it may have changed
+  void refreshAfterRun();
+
+  // reads the overwrite origin again, false if the structure can't be patched
+  // and needs a full refresh; `listsChanged` tells whether plugins or archives
+  // in overwrite changed
+  bool refreshOverwriteOrigin(bool& listsChanged);
+
+  // sizes and times of the plugin lists of the current profile
+  QString pluginListsStamp() const;
+#endif
+
   std::pair<unsigned int, ModInfo::Ptr> doInstall(const QString& archivePath,
                                                   MOBase::GuessedValue<QString> modName,
                                                   ModInfo::Ptr currentMod, int priority,
                                                   bool reinstallation);
 
+  // installs the downloads in m_InstallQueue until it's empty
+  void processInstallQueue();
+
+  // does the refreshes requested during the transactions that just ended
+  void endRefreshTransaction();
+
+  // reads the start of the given archive in the background so it's cached by the
+  // time its installation starts, stops the previous prefetch
+  void prefetchArchive(const QString& path);
+
   void saveCurrentProfile();
   void storeSettings();
 
   void updateModActiveState(int index, bool active);
   void updateModsActiveState(const QList<unsigned int>& modIndices, bool active);
 
+  // brings the directory structure built for `oldProfile` up to date with the
+  // current profile by only adding or disabling the mods whose state differs;
+  // returns false without changing anything if a full refresh is needed instead
+  //
+  bool switchDirectoryStructure(const Profile& oldProfile);
+
+  // clears the caches of every mod and computes their conflicts again
+  //
+  void refreshModCaches();
+
   // clear the conflict caches of all the given mods, and the mods in conflict
   // with the given mods
   //
@@ -525,9 +681,22 @@ private:
                                    const MOShared::DirectoryEntry* directoryEntry,
                                    int createDestination);
 
+  // mappings of the data directories of an active mod, `createTarget` isn't set
+  struct ModMappings
+  {
+    QString name;
+    MappingType mappings;
+  };
+
+  // mappings of the active mods in `profile`, by priority
+  std::vector<ModMappings> modMappings(Profile& profile) const;
+
 private slots:
 
   void onDirectoryRefreshed();
+#ifndef _WIN32
+  void onModFilesChanged(const std::vector<ModDirectoryWatcher::Change>& changes);
+#endif
   void downloadRequested(QNetworkReply* reply, QString gameName, int modID,
                          const QString& fileName);
   void removeOrigin(const QString& name);
@@ -575,7 +744,15 @@ private:
   QStringList m_ActiveArchives;
 
   std::unique_ptr<DirectoryRefresher> m_DirectoryRefresher;
-  MOShared::DirectoryEntry* m_DirectoryStructure;
+  // only replaced on the main thread, the mutex guards the pointer against
+  // readers on other threads
+  std::shared_ptr<MOShared::DirectoryEntry> m_DirectoryStructure;
+  mutable std::mutex m_DirectoryStructureMutex;
+  // held exclusively while the main thread patches the structure in place,
+  // shared by readers, see readDirectoryStructure()
+  mutable std::shared_mutex m_DirectoryStructureAccess;
+  // bumped by every patch, virtual file trees made before it stop populating
+  std::atomic<std::uint64_t> m_DirectoryStructurePatches{0};
   MOBase::MemoizedLocked<std::shared_ptr<const MOBase::IFileTree>> m_VirtualFileTree;
 
   DownloadManager m_DownloadManager;
@@ -586,13 +763,45 @@ private:
   std::thread m_StructureDeleter;
 
   std::atomic<bool> m_DirectoryUpdate;
+
+  // something changed while a refresh was running that it may not have seen,
+  // another one starts when it's done
+  bool m_DirectoryRefreshQueued;
+
+  // the next refresh checks every file, see refreshFromDisk()
+  bool m_DirectoryRefreshChecksFiles;
   bool m_ArchivesInit;
 
+  // file names of the downloads waiting to be installed by processInstallQueue()
+  QStringList m_InstallQueue;
+  bool m_InstallQueueRunning;
+
+  // number of RefreshTransaction alive and the refreshes requested meanwhile
+  int m_RefreshTransactions;
+  bool m_DirectoryRefreshDeferred;
+  bool m_ListsRefreshDeferred;
+
+  // set to stop the running prefetch
+  std::shared_ptr<std::atomic<bool>> m_PrefetchCancel;
+
+  // a save of the plugin lists is waiting for the directory update
+  bool m_PluginListSaveQueued;
+
+  // modMappings() of the current profile for launches, reset when a mod is enabled,
+  // disabled or moved, when the profile changes and after every refresh
+  std::optional<std::vector<ModMappings>> m_CurrentModMappings;
+
   MOBase::DelayedFileWriter m_PluginListsWriter;
 #ifdef _WIN32
   UsvfsConnector m_USVFS;
 #else
   FuseConnector m_USVFS;
+
+  // keeps the structure in sync with edits on disk between refreshes
+  ModDirectoryWatcher m_ModWatcher;
+
+  // pluginListsStamp() when the last program was started
+  QString m_RunPluginListsStamp;
 #endif
 
   UILocker m_UILocker;
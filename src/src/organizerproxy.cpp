@@ -3,7 +3,6 @@
 #include "downloadmanagerproxy.h"
 #include "executableslistproxy.h"
 #include "gamefeaturesproxy.h"
-#include "glob_matching.h"
 #include "instancemanager.h"
 #include "modlistproxy.h"
 #include "organizercore.h"
@@ -331,18 +330,7 @@ OrganizerProxy::findFiles(const QString& path,
 QStringList OrganizerProxy::findFiles(const QString& path,
                                       const QStringList& globFilters) const
 {
-  QList<GlobPattern<QChar>> patterns;
-  for (auto& gfilter : globFilters) {
-    patterns.append(GlobPattern(gfilter));
-  }
-  return findFiles(path, [&patterns](const QString& filename) {
-    for (auto& p : patterns) {
-      if (p.match(filename)) {
-        return true;
-      }
-    }
-    return false;
-  });
+  return m_Proxied->findFiles(path, globFilters);
 }
 
 QStringList OrganizerProxy::getFileOrigins(const QString& fileName) const
@@ -357,6 +345,12 @@ QList<MOBase::IOrganizer::FileInfo> OrganizerProxy::findFileInfos(
   return m_Proxied->findFileInfos(path, filter);
 }
 
+QList<QList<MOBase::IOrganizer::FileInfo>>
+OrganizerProxy::queryFiles(const QList<FileQuery>& queries) const
+{
+  return m_Proxied->queryFiles(queries);
+}
+
 std::shared_ptr<const MOBase::IFileTree> OrganizerProxy::virtualFileTree() const
 {
   return m_Proxied->m_VirtualFileTree.value();
@@ -61,6 +61,7 @@ public:  // IOrganizer interface
   QList<FileInfo>
   findFileInfos(const QString& path,
                 const std::function<bool(const FileInfo&)>& filter) const override;
+  QList<QList<FileInfo>> queryFiles(const QList<FileQuery>& queries) const override;
   std::shared_ptr<const MOBase::IFileTree> virtualFileTree() const override;
 
   MOBase::IDownloadManager* downloadManager() const override;
@@ -66,6 +66,7 @@
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/assign.hpp>
 #include <boost/bind/bind.hpp>
+#include <boost/container/small_vector.hpp>
 #include <boost/function.hpp>
 #include <boost/fusion/algorithm/iteration/for_each.hpp>
 #include <boost/fusion/container.hpp>
@@ -0,0 +1,113 @@
+#include "pidwatcher.h"
+
+#include <log.h>
+
+#include <QSocketNotifier>
+
+#include <cerrno>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace MOBase;
+
+namespace
+{
+
+int openPidfd(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+  return static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+// reaps `pid` if it's a child that exited, false if it isn't one or still
+// runs
+//
+bool reap(pid_t pid, int& exitCode)
+{
+  int status = 0;
+  if (::waitpid(pid, &status, WNOHANG) != pid) {
+    return false;
+  }
+
+  if (WIFEXITED(status)) {
+    exitCode = WEXITSTATUS(status);
+  } else if (WIFSIGNALED(status)) {
+    exitCode = 128 + WTERMSIG(status);
+  }
+
+  return true;
+}
+
+}  // namespace
+
+PidWatcher::PidWatcher(pid_t pid, QObject* parent) : QObject(parent), m_pid(pid)
+{
+  m_pidfd = openPidfd(pid);
+
+  if (m_pidfd >= 0) {
+    m_notifier = new QSocketNotifier(m_pidfd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &PidWatcher::onExited);
+    return;
+  }
+
+  if (errno == ESRCH) {
+    // queued, so the caller can connect to exited() first
+    QTimer::singleShot(0, this, &PidWatcher::onExited);
+    return;
+  }
+
+  log::debug("pidfd_open() failed for {}, errno={}; polling instead", pid, errno);
+
+  m_poll.setInterval(500);
+  connect(&m_poll, &QTimer::timeout, this, &PidWatcher::onPoll);
+  m_poll.start();
+}
+
+PidWatcher::~PidWatcher()
+{
+  delete m_notifier;
+
+  if (m_pidfd >= 0) {
+    ::close(m_pidfd);
+  }
+}
+
+void PidWatcher::onPoll()
+{
+  int exitCode = 0;
+  if (reap(m_pid, exitCode)) {
+    m_exited = true;
+    m_poll.stop();
+    emit exited(exitCode);
+    return;
+  }
+
+  // EPERM means it exists but belongs to someone else
+  if (::kill(m_pid, 0) != 0 && errno == ESRCH) {
+    onExited();
+  }
+}
+
+void PidWatcher::onExited()
+{
+  if (m_exited) {
+    return;
+  }
+
+  m_exited = true;
+  m_poll.stop();
+  if (m_notifier != nullptr) {
+    m_notifier->setEnabled(false);
+  }
+
+  int exitCode = 0;
+  reap(m_pid, exitCode);
+
+  emit exited(exitCode);
+}
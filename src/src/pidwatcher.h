@@ -0,0 +1,44 @@
+#ifndef PIDWATCHER_H
+#define PIDWATCHER_H
+
+#include <QObject>
+#include <QTimer>
+
+#include <sys/types.h>
+
+class QSocketNotifier;
+
+// Notifies when a process exits, it doesn't have to be a child of this one.
+// A pidfd of the process becomes readable when it terminates, which the event
+// loop picks up through a QSocketNotifier without a thread blocking on it.
+// Kernels without pidfd_open() (before 5.3) check the pid every half second
+// instead.
+//
+// The exit code is only known for children, it's 0 otherwise.
+class PidWatcher : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit PidWatcher(pid_t pid, QObject* parent = nullptr);
+  ~PidWatcher() override;
+
+  pid_t pid() const { return m_pid; }
+  bool hasExited() const { return m_exited; }
+
+signals:
+  // emitted once, also when the process was already gone on construction
+  void exited(int exitCode);
+
+private:
+  pid_t m_pid;
+  int m_pidfd                 = -1;
+  QSocketNotifier* m_notifier = nullptr;
+  QTimer m_poll;
+  bool m_exited = false;
+
+  void onExited();
+  void onPoll();
+};
+
+#endif  // PIDWATCHER_H
@@ -4,17 +4,24 @@
 #include "organizerproxy.h"
 #include "report.h"
 #include "shared/appconfig.h"
+#include "thread_utils.h"
 #include <QAction>
 #include <QCoreApplication>
 #include <QDirIterator>
+#include <QElapsedTimer>
+#include <QLibrary>
 #include <QMessageBox>
+#include <QThread>
 #include <QToolButton>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
 #include <boost/fusion/algorithm/iteration/for_each.hpp>
 #include <boost/fusion/include/at_key.hpp>
 #include <boost/fusion/include/for_each.hpp>
 #include <boost/fusion/sequence/intrinsic/at_key.hpp>
 #include <idownloadmanager.h>
 #include <ipluginproxy.h>
+#include <tracing.h>
 
 using namespace MOBase;
 using namespace MOShared;
@@ -896,6 +903,9 @@ std::vector<QObject*> PluginContainer::loadProxied(const QString& filepath,
 
 QObject* PluginContainer::loadQtPlugin(const QString& filepath)
 {
+  QElapsedTimer timer;
+  timer.start();
+
   std::unique_ptr<QPluginLoader> pluginLoader(new QPluginLoader(filepath, this));
   if (pluginLoader->instance() == nullptr) {
     m_FailedPlugins.push_back(filepath);
@@ -903,9 +913,9 @@ QObject* PluginContainer::loadQtPlugin(const QString& filepath)
   } else {
     QObject* object = pluginLoader->instance();
     if (IPlugin* plugin = registerPlugin(object, filepath, nullptr); plugin) {
-      log::debug("loaded plugin '{}@{}' from '{}' - [{}]", plugin->name(),
+      log::debug("loaded plugin '{}@{}' from '{}' in {}ms - [{}]", plugin->name(),
                  plugin->version().canonicalString(), QFileInfo(filepath).fileName(),
-                 implementedInterfaces(plugin).join(", "));
+                 timer.elapsed(), implementedInterfaces(plugin).join(", "));
       m_PluginLoaders.push_back(pluginLoader.release());
       return object;
     } else {
@@ -1120,6 +1130,7 @@ void PluginContainer::loadPlugins()
 
   QFile loadCheck;
   QString skipPlugin;
+  bool lastLoadFailed = false;
 
   if (m_Organizer) {
     loadCheck.setFileName(qApp->property("dataPath").toString() +
@@ -1128,6 +1139,7 @@ void PluginContainer::loadPlugins()
     if (loadCheck.exists() && loadCheck.open(QIODevice::ReadOnly)) {
       // oh, there was a failed plugin load last time. Find out which plugin was loaded
       // last
+      lastLoadFailed = true;
       QString fileName;
       while (!loadCheck.atEnd()) {
         fileName = QString::fromUtf8(loadCheck.readLine().constData()).trimmed();
@@ -1219,6 +1231,17 @@ void PluginContainer::loadPlugins()
     }
   }
 
+  struct Candidate
+  {
+    QString fileName;
+    QString filePath;
+
+    // the library to load, empty if the entry isn't a plugin
+    QString library;
+  };
+
+  std::vector<Candidate> candidates;
+
   QDirIterator iter(pluginPath, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
 
   while (iter.hasNext()) {
@@ -1236,17 +1259,63 @@ void PluginContainer::loadPlugins()
       }
     }
 
+    candidates.push_back({iter.fileName(), iter.filePath(), {}});
+  }
+
+  // finding the libraries in plugin folders reads their metadata, and mapping
+  // the libraries with their dependencies is most of the loading time, so both
+  // are done for all the plugins in parallel; the plugins are still created and
+  // registered here one by one, in order
+  //
+  // after a plugin crashed the last time, the libraries aren't mapped ahead so
+  // the load check file names the right one if it crashes again
+  const bool preload = !lastLoadFailed;
+
+  {
+    TimeThis ttPreload("PluginContainer::loadPlugins() preloading");
+
+    parallelMap(
+        candidates.begin(), candidates.end(),
+        [this, preload](Candidate& c) {
+          if (QLibrary::isLibrary(c.filePath)) {
+            c.library = c.filePath;
+          } else if (auto p = isQtPluginFolder(c.filePath)) {
+            c.library = *p;
+          } else {
+            return;
+          }
+
+          if (!preload) {
+            return;
+          }
+
+          QElapsedTimer timer;
+          timer.start();
+
+          // shared with the QPluginLoader created later for the same file, which
+          // finds the library already loaded
+          QLibrary library(c.library);
+          library.setLoadHints(QLibrary::PreventUnloadHint);
+
+          if (library.load()) {
+            log::debug("mapped plugin library '{}' in {}ms", c.fileName,
+                       timer.elapsed());
+          }
+
+          // failures are reported by loadQtPlugin()
+        },
+        static_cast<std::size_t>(std::max(1, QThread::idealThreadCount())));
+  }
+
+  for (const auto& c : candidates) {
     if (loadCheck.isOpen()) {
-      loadCheck.write(iter.fileName().toUtf8());
+      loadCheck.write(c.fileName.toUtf8());
       loadCheck.write("\n");
       loadCheck.flush();
     }
 
-    QString filepath = iter.filePath();
-    if (QLibrary::isLibrary(filepath)) {
-      loadQtPlugin(filepath);
-    } else if (auto p = isQtPluginFolder(filepath)) {
-      loadQtPlugin(*p);
+    if (!c.library.isEmpty()) {
+      loadQtPlugin(c.library);
     }
   }
 
@@ -1272,6 +1341,8 @@ void PluginContainer::loadPlugins()
     }
   }
 
+  tracing::counter("plugins", static_cast<qint64>(m_PluginLoaders.size()));
+
   bf::at_key<IPluginDiagnose>(m_Plugins).push_back(this);
 
   if (m_Organizer) {
@@ -1280,6 +1351,39 @@ void PluginContainer::loadPlugins()
   }
 }
 
+PluginContainer::DiagnoseProblems PluginContainer::checkProblems() const
+{
+  std::vector<IPluginDiagnose*> diagnoses;
+  for (IPluginDiagnose* diagnose : plugins<IPluginDiagnose>()) {
+    // the container and the organizer diagnose without being plugins
+    IPlugin* p = plugin(diagnose);
+    if (p == nullptr || isEnabled(p)) {
+      diagnoses.push_back(diagnose);
+    }
+  }
+
+  auto problems = QtConcurrent::blockingMapped<DiagnoseProblems>(
+      diagnoses, [](IPluginDiagnose* diagnose) {
+        DiagnoseProblems::value_type result{diagnose, {}};
+        try {
+          result.second = diagnose->activeProblems();
+        } catch (const std::exception& e) {
+          log::error("failed to check for problems: {}", e.what());
+        }
+        return result;
+      });
+
+  std::scoped_lock lock(m_ProblemsMutex);
+  m_Problems = problems;
+  return problems;
+}
+
+PluginContainer::DiagnoseProblems PluginContainer::cachedProblems() const
+{
+  std::scoped_lock lock(m_ProblemsMutex);
+  return m_Problems;
+}
+
 std::vector<unsigned int> PluginContainer::activeProblems() const
 {
   std::vector<unsigned int> problems;
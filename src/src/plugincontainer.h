@@ -22,6 +22,8 @@ class IUserInterface;
 #include <boost/mp11.hpp>
 #endif  // Q_MOC_RUN
 #include <memory>
+#include <mutex>
+#include <utility>
 #include <vector>
 
 #include "game_features.h"
@@ -354,6 +356,25 @@ public:
    */
   QStringList pluginFileNames() const;
 
+  // keys of the active problems of every enabled diagnose plugin, in the
+  // order of plugins<IPluginDiagnose>()
+  using DiagnoseProblems =
+      std::vector<std::pair<MOBase::IPluginDiagnose*, std::vector<unsigned int>>>;
+
+  /**
+   * @brief Evaluates the active problems of every enabled diagnose plugin,
+   *     each plugin in its own task on the global thread pool, and caches them.
+   *
+   * Can be called from any thread, the checks already walk directories or read
+   * files and shouldn't run on the GUI thread.
+   */
+  DiagnoseProblems checkProblems() const;
+
+  /**
+   * @return the problems found by the last checkProblems().
+   */
+  DiagnoseProblems cachedProblems() const;
+
 public:  // IPluginDiagnose interface
   virtual std::vector<unsigned int> activeProblems() const;
   virtual QString shortDescription(unsigned int key) const;
@@ -497,6 +518,9 @@ private:
   QStringList m_FailedPlugins;
   std::vector<QPluginLoader*> m_PluginLoaders;
 
+  mutable std::mutex m_ProblemsMutex;
+  mutable DiagnoseProblems m_Problems;
+
   PreviewGenerator m_PreviewGenerator;
 
   QFile m_PluginsCheck;
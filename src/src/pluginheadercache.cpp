@@ -0,0 +1,313 @@
+#include "pluginheadercache.h"
+#include "shared/util.h"
+#include "vfs/layercache.h"
+
+#include <esptk/espheader.h>
+#include <esptk/record.h>
+#include <uibase/log.h>
+
+#include <QString>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace MOBase;
+using namespace MOShared;
+namespace fs = std::filesystem;
+
+namespace
+{
+
+constexpr char Magic[8]          = {'M', 'O', '2', 'E', 'S', 'P', 'H', 'C'};
+constexpr uint32_t Version       = 1;
+constexpr const wchar_t* Name    = L"plugin_header_cache.bin";
+constexpr uint32_t MaxStringSize = 1u << 16;
+
+// size and modification time of the plugin, false if it can't be read
+//
+bool pluginStamp(const std::wstring& path, uint64_t& size, int64_t& writeTime)
+{
+  std::error_code ec;
+
+  size = fs::file_size(path, ec);
+  if (ec) {
+    return false;
+  }
+
+  const auto lwt = fs::last_write_time(path, ec);
+  if (ec) {
+    return false;
+  }
+
+  writeTime = static_cast<int64_t>(lwt.time_since_epoch().count());
+  return true;
+}
+
+class Writer
+{
+public:
+  explicit Writer(std::ofstream& out) : m_out(out) {}
+
+  template <class T>
+  void put(T value)
+  {
+    m_out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  void putString(const std::string& s)
+  {
+    put(static_cast<uint32_t>(s.size()));
+    m_out.write(s.data(), static_cast<std::streamsize>(s.size()));
+  }
+
+private:
+  std::ofstream& m_out;
+};
+
+class Reader
+{
+public:
+  explicit Reader(std::ifstream& in) : m_in(in) {}
+
+  template <class T>
+  bool get(T& value)
+  {
+    return static_cast<bool>(m_in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+  }
+
+  bool getString(std::string& s)
+  {
+    uint32_t size = 0;
+    if (!get(size) || size > MaxStringSize) {
+      return false;
+    }
+    s.resize(size);
+    return static_cast<bool>(m_in.read(s.data(), size));
+  }
+
+private:
+  std::ifstream& m_in;
+};
+
+}  // namespace
+
+bool PluginHeaderInfo::isMaster() const
+{
+  return (flags & ESP::Record::FLAG_MASTER) != 0;
+}
+
+bool PluginHeaderInfo::isLight(bool overlaySupport) const
+{
+  if (overlaySupport) {
+    return (flags & ESP::Record::FLAG_LIGHT_ALTERNATE) != 0;
+  } else {
+    return (flags & ESP::Record::FLAG_LIGHT) != 0;
+  }
+}
+
+bool PluginHeaderInfo::isMedium() const
+{
+  return (flags & ESP::Record::FLAG_MEDIUM) != 0;
+}
+
+bool PluginHeaderInfo::isBlueprint() const
+{
+  return (flags & ESP::Record::FLAG_BLUEPRINT) != 0;
+}
+
+std::shared_ptr<const PluginHeaderInfo> readPluginHeader(const std::wstring& path)
+{
+  auto info = std::make_shared<PluginHeaderInfo>();
+
+  if (!pluginStamp(path, info->fileSize, info->writeTime)) {
+    log::warn("failed to get size and last modified date for '{}'", path);
+  }
+
+  const ESP::PluginHeader header(path);
+
+  info->flags         = header.flags();
+  info->formVersion   = header.formVersion();
+  info->headerVersion = header.headerVersion();
+  info->dummy         = header.isDummy();
+  info->author        = header.author();
+  info->description   = header.description();
+  info->masters.assign(header.masters().begin(), header.masters().end());
+
+  return info;
+}
+
+PluginHeaderCache::PluginHeaderCache(std::wstring path) : m_path(std::move(path))
+{
+  load();
+}
+
+void PluginHeaderCache::load()
+{
+  std::ifstream in(fs::path(m_path), std::ios::binary);
+  if (!in) {
+    return;
+  }
+
+  char magic[sizeof(Magic)] = {};
+  uint32_t version          = 0;
+  uint32_t count            = 0;
+  Reader r(in);
+
+  if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, Magic, sizeof(Magic)) != 0 ||
+      !r.get(version) || version != Version || !r.get(count)) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < count; ++i) {
+    auto info = std::make_shared<PluginHeaderInfo>();
+    std::string path;
+    uint32_t masters = 0;
+
+    if (!r.getString(path) || !r.get(info->fileSize) || !r.get(info->writeTime) ||
+        !r.get(info->flags) || !r.get(info->formVersion) ||
+        !r.get(info->headerVersion) || !r.get(info->dummy) ||
+        !r.getString(info->author) || !r.getString(info->description) ||
+        !r.get(masters) || masters > MaxStringSize) {
+      return;
+    }
+
+    info->masters.resize(masters);
+
+    for (auto& master : info->masters) {
+      if (!r.getString(master)) {
+        return;
+      }
+    }
+
+    m_headers.insert_or_assign(ToWString(path, true), std::move(info));
+  }
+}
+
+std::shared_ptr<const PluginHeaderInfo> PluginHeaderCache::get(const std::wstring& path)
+{
+  std::shared_ptr<const PluginHeaderInfo> cached;
+  {
+    std::scoped_lock lock(m_mutex);
+    m_used.insert(path);
+    if (auto itor = m_headers.find(path); itor != m_headers.end()) {
+      cached = itor->second;
+    }
+  }
+
+  if (cached) {
+    uint64_t size     = 0;
+    int64_t writeTime = 0;
+
+    if (pluginStamp(path, size, writeTime) && size == cached->fileSize &&
+        writeTime == cached->writeTime) {
+      return cached;
+    }
+  }
+
+  std::shared_ptr<const PluginHeaderInfo> info;
+  try {
+    info = readPluginHeader(path);
+  } catch (...) {
+    std::scoped_lock lock(m_mutex);
+    if (m_headers.erase(path) > 0) {
+      m_dirty = true;
+    }
+    throw;
+  }
+
+  std::scoped_lock lock(m_mutex);
+  m_headers.insert_or_assign(path, info);
+  m_dirty = true;
+
+  return info;
+}
+
+bool PluginHeaderCache::save()
+{
+  std::vector<std::pair<std::wstring, std::shared_ptr<const PluginHeaderInfo>>> headers;
+  {
+    std::scoped_lock lock(m_mutex);
+    if (!m_dirty) {
+      return true;
+    }
+    // plugins nobody asked for in this run were removed or disabled
+    for (const auto& [path, info] : m_headers) {
+      if (m_used.contains(path)) {
+        headers.emplace_back(path, info);
+      }
+    }
+    m_dirty = false;
+  }
+
+  const auto failed = [this] {
+    std::scoped_lock lock(m_mutex);
+    m_dirty = true;
+    return false;
+  };
+
+  const fs::path target(m_path);
+  const fs::path tmpPath(m_path + L".tmp");
+  {
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return failed();
+    }
+
+    Writer w(out);
+    out.write(Magic, sizeof(Magic));
+    w.put(Version);
+    w.put(static_cast<uint32_t>(headers.size()));
+
+    for (const auto& [path, info] : headers) {
+      w.putString(ToString(path, true));
+      w.put(info->fileSize);
+      w.put(info->writeTime);
+      w.put(info->flags);
+      w.put(info->formVersion);
+      w.put(info->headerVersion);
+      w.put(info->dummy);
+      w.putString(info->author);
+      w.putString(info->description);
+      w.put(static_cast<uint32_t>(info->masters.size()));
+
+      for (const auto& master : info->masters) {
+        w.putString(master);
+      }
+    }
+
+    if (!out.flush()) {
+      out.close();
+      std::error_code ec;
+      fs::remove(tmpPath, ec);
+      return failed();
+    }
+  }
+
+  std::error_code ec;
+  fs::rename(tmpPath, target, ec);
+  if (ec) {
+    log::warn("failed to write plugin header cache '{}', {}", m_path, ec.message());
+    fs::remove(tmpPath, ec);
+    return failed();
+  }
+
+  return true;
+}
+
+std::shared_ptr<PluginHeaderCache> sharedPluginHeaderCache(const QString& overwriteDir)
+{
+  static std::mutex mutex;
+  static std::shared_ptr<PluginHeaderCache> cache;
+  static std::wstring cachePath;
+
+  const fs::path layerCache = layerCachePath(overwriteDir.toStdString());
+  const std::wstring path   = (layerCache.parent_path() / Name).wstring();
+
+  std::scoped_lock lock(mutex);
+  if (cache == nullptr || cachePath != path) {
+    cache     = std::make_shared<PluginHeaderCache>(path);
+    cachePath = path;
+  }
+  return cache;
+}
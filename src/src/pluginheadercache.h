@@ -0,0 +1,79 @@
+#ifndef PLUGINHEADERCACHE_H
+#define PLUGINHEADERCACHE_H
+
+#include <QString>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// what the plugin list reads from the header of a plugin, see
+// ESP::PluginHeader
+//
+struct PluginHeaderInfo
+{
+  // of the plugin file itself, the info is stale once either changes
+  uint64_t fileSize = 0;
+  int64_t writeTime = 0;
+
+  uint32_t flags       = 0;
+  uint16_t formVersion = 0;
+  float headerVersion  = 0.0f;
+  bool dummy           = false;
+  std::string author;
+  std::string description;
+  std::vector<std::string> masters;
+
+  bool isMaster() const;
+  bool isLight(bool overlaySupport) const;
+  bool isMedium() const;
+  bool isBlueprint() const;
+};
+
+// parses the header of the plugin at `path`, throws the ESP exceptions if it
+// isn't valid
+//
+std::shared_ptr<const PluginHeaderInfo> readPluginHeader(const std::wstring& path);
+
+// Plugin headers persisted next to the instance, so a plugin that didn't
+// change is never opened again, not even across restarts.  Entries are checked
+// against the size and modification time of the plugin whenever they're handed
+// out.
+//
+// All members are thread-safe.
+class PluginHeaderCache
+{
+public:
+  explicit PluginHeaderCache(std::wstring path);
+
+  // the cached header of the plugin at `path` if it's still current, parsing
+  // the plugin and caching the result otherwise; throws like
+  // readPluginHeader()
+  //
+  std::shared_ptr<const PluginHeaderInfo> get(const std::wstring& path);
+
+  // writes the headers used by this process if anything changed since the
+  // file was loaded or last saved
+  //
+  bool save();
+
+private:
+  void load();
+
+  std::wstring m_path;
+  mutable std::mutex m_mutex;
+  std::unordered_map<std::wstring, std::shared_ptr<const PluginHeaderInfo>> m_headers;
+  std::unordered_set<std::wstring> m_used;
+  bool m_dirty = false;
+};
+
+// process-wide cache for the instance owning `overwriteDir`, loaded on first
+// use
+//
+std::shared_ptr<PluginHeaderCache> sharedPluginHeaderCache(const QString& overwriteDir);
+
+#endif  // PLUGINHEADERCACHE_H
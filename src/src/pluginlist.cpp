@@ -20,7 +20,10 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <algorithm>
 #include <ctime>
+#include <mutex>
+#include <optional>
 #include <stdexcept>
+#include <unordered_map>
 
 #include <QApplication>
 #include <QCoreApplication>
@@ -35,10 +38,11 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QRegularExpression>
 #include <QSortFilterProxyModel>
 #include <QString>
+#include <QtConcurrent/QtConcurrentRun>
 #include <QtDebug>
 
-#include <esptk/espfile.h>
 #include <uibase/iplugingame.h>
+#include <uibase/memoryusage.h>
 #include <uibase/report.h>
 #include <uibase/safewritefile.h>
 #include <uibase/scopeguard.h>
@@ -48,11 +52,14 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "modinfo.h"
 #include "modlist.h"
 #include "organizercore.h"
+#include "pluginheadercache.h"
+#include "pluginrecordindex.h"
 #include "settings.h"
 #include "shared/directoryentry.h"
 #include "shared/fileentry.h"
 #include "shared/filesorigin.h"
 #include "shared/windows_error.h"
+#include "vfs/taskpool.h"
 #include "viewmarkingscrollbar.h"
 
 #ifndef _WIN32
@@ -75,15 +82,78 @@ static QString TruncateString(const QString& text)
   return new_text;
 }
 
+#ifndef _WIN32
+namespace
+{
+
+// finds the on-disk casing of plugin paths that don't exist verbatim; each
+// directory is listed at most once per refresh, however many of its plugins
+// are mismatched
+//
+class PluginPathResolver
+{
+public:
+  QString resolve(const QString& path)
+  {
+    if (QFileInfo::exists(path)) {
+      return path;
+    }
+
+    const QFileInfo fi(path);
+    const QString dirPath = fi.path();
+
+    std::scoped_lock lock(m_mutex);
+
+    auto itor = m_directories.find(dirPath);
+    if (itor == m_directories.end()) {
+      std::unordered_map<QString, QString> names;
+
+      const QDir dir(dirPath);
+      if (dir.exists()) {
+        for (auto&& name : dir.entryList(QDir::Files | QDir::Readable)) {
+          names.emplace(name.toLower(), name);
+        }
+      }
+
+      itor = m_directories.emplace(dirPath, std::move(names)).first;
+    }
+
+    const auto name = itor->second.find(fi.fileName().toLower());
+    if (name == itor->second.end()) {
+      return path;
+    }
+
+    const QString resolved = QDir(dirPath).filePath(name->second);
+    log::warn("plugin path case mismatch, resolved '{}' -> '{}'", path, resolved);
+
+    return resolved;
+  }
+
+private:
+  std::mutex m_mutex;
+  std::unordered_map<QString, std::unordered_map<QString, QString>> m_directories;
+};
+
+}  // namespace
+#endif
+
 PluginList::PluginList(OrganizerCore& organizer)
     : QAbstractItemModel(&organizer), m_Organizer(organizer), m_FontMetrics(QFont())
 {
   connect(this, SIGNAL(writePluginsList()), this, SLOT(generatePluginIndexes()));
+  connect(this, &PluginList::writePluginsList, this, &PluginList::updateConflictIndex);
+  connect(&m_ConflictWatcher,
+          &QFutureWatcher<std::shared_ptr<const PluginConflictIndex>>::finished, this,
+          &PluginList::onConflictIndexBuilt);
   m_LastCheck.start();
 }
 
 PluginList::~PluginList()
 {
+  if (m_ConflictCancel) {
+    *m_ConflictCancel = true;
+  }
+
   m_Refreshed.disconnect_all_slots();
   m_PluginMoved.disconnect_all_slots();
   m_PluginStateChanged.disconnect_all_slots();
@@ -148,38 +218,36 @@ void PluginList::highlightPlugins(const std::vector<unsigned int>& modIndices,
     esp.modSelected = false;
   }
 
+  std::set<int> origins;
   for (auto& modIndex : modIndices) {
     ModInfo::Ptr selectedMod = ModInfo::getByIndex(modIndex);
     if (!selectedMod.isNull() && profile->modEnabled(modIndex)) {
-      QString modDataPath = selectedMod->absolutePath();
-      modDataPath =
-          m_Organizer.managedGame()->modDataDirectory().isEmpty()
-              ? modDataPath
-              : modDataPath + "/" + m_Organizer.managedGame()->modDataDirectory();
-      QDir dir(modDataPath);
-      QStringList plugins;
-      if (dir.exists()) {
-        plugins = dir.entryList(QStringList() << "*.esp"
-                                              << "*.esm"
-                                              << "*.esl");
+      const auto name = selectedMod->internalName().toStdWString();
+      if (directoryEntry.originExists(name)) {
+        origins.insert(directoryEntry.getOriginByName(name).getID());
       }
-      const MOShared::FilesOrigin& origin =
-          directoryEntry.getOriginByName(selectedMod->internalName().toStdWString());
-      if (plugins.size() > 0) {
-        for (auto plugin : plugins) {
-          MOShared::FileEntryPtr file = directoryEntry.findFile(plugin.toStdWString());
-          if (file && file->getOrigin() != origin.getID()) {
-            const auto alternatives = file->getAlternatives();
-            if (std::find_if(alternatives.begin(), alternatives.end(),
-                             [&](const FileAlternative& element) {
-                               return element.originID() == origin.getID();
-                             }) == alternatives.end())
-              continue;
-          }
-          std::map<QString, int>::iterator iter = m_ESPsByName.find(plugin);
-          if (iter != m_ESPsByName.end()) {
-            m_ESPs[iter->second].modSelected = true;
-          }
+    }
+  }
+
+  // a plugin belongs to a selected mod if the mod provides it, whether it wins
+  // or not; the structure already knows that, so the folders of the selected
+  // mods don't have to be listed on every selection change
+  if (!origins.empty()) {
+    for (auto& esp : m_ESPs) {
+      MOShared::FileEntryPtr file = directoryEntry.findFile(esp.name.toStdWString());
+      if (!file) {
+        continue;
+      }
+
+      if (origins.count(file->getOrigin()) > 0) {
+        esp.modSelected = true;
+        continue;
+      }
+
+      for (const auto& alt : file->getAlternatives()) {
+        if (origins.count(alt.originID()) > 0) {
+          esp.modSelected = true;
+          break;
         }
       }
     }
@@ -192,7 +260,9 @@ void PluginList::highlightPlugins(const std::vector<unsigned int>& modIndices,
 void PluginList::highlightMasters(const QModelIndexList& selectedPluginIndices)
 {
   for (auto& esp : m_ESPs) {
-    esp.isMasterOfSelectedPlugin = false;
+    esp.isMasterOfSelectedPlugin     = false;
+    esp.isOverridingSelectedPlugin   = false;
+    esp.isOverriddenBySelectedPlugin = false;
   }
 
   for (const auto& pluginIndex : selectedPluginIndices) {
@@ -203,6 +273,27 @@ void PluginList::highlightMasters(const QModelIndexList& selectedPluginIndices)
         m_ESPs[iter->second].isMasterOfSelectedPlugin = true;
       }
     }
+
+    if (!m_ConflictIndex) {
+      continue;
+    }
+
+    QStringList overridden, overriding;
+    m_ConflictIndex->conflicts(plugin.name, overridden, overriding);
+
+    for (const auto& name : overridden) {
+      const auto iter = m_ESPsByName.find(name);
+      if (iter != m_ESPsByName.end()) {
+        m_ESPs[iter->second].isOverriddenBySelectedPlugin = true;
+      }
+    }
+
+    for (const auto& name : overriding) {
+      const auto iter = m_ESPsByName.find(name);
+      if (iter != m_ESPsByName.end()) {
+        m_ESPs[iter->second].isOverridingSelectedPlugin = true;
+      }
+    }
   }
 }
 
@@ -253,6 +344,22 @@ void PluginList::refresh(const QString& profileName,
     }
   }
 
+  // everything ESPInfo needs besides the plugin file itself, gathered here
+  // because the origin and mod lookups aren't thread-safe
+  struct NewPlugin
+  {
+    QString name;
+    bool forceLoaded;
+    bool forceEnabled;
+    bool forceDisabled;
+    QString originName;
+    QString fullPath;
+    bool hasIni;
+    std::set<QString> archives;
+  };
+
+  std::vector<NewPlugin> newPlugins;
+
   for (const auto& [filename, current] : availablePlugins) {
     if (m_ESPsByName.contains(filename)) {
       continue;
@@ -289,11 +396,9 @@ void PluginList::refresh(const QString& profileName,
         originName           = modInfo->name();
       }
 
-      m_ESPs.emplace_back(filename, forceLoaded, forceEnabled, forceDisabled,
-                          originName, ToQString(current->getFullPath()), hasIni,
-                          loadedArchives, lightPluginsAreSupported,
-                          mediumPluginsAreSupported, blueprintPluginsAreSupported);
-      m_ESPs.rbegin()->priority = -1;
+      newPlugins.push_back({filename, forceLoaded, forceEnabled, forceDisabled,
+                            originName, ToQString(current->getFullPath()), hasIni,
+                            std::move(loadedArchives)});
     } catch (const std::exception& e) {
       reportError(tr("failed to update esp info for file %1 (source id: %2), error: %3")
                       .arg(filename)
@@ -302,6 +407,35 @@ void PluginList::refresh(const QString& profileName,
     }
   }
 
+  // each ESPInfo opens and parses its plugin, which is what takes time on
+  // large load orders, so they're built concurrently and only added to the
+  // list on this thread
+  std::vector<std::optional<ESPInfo>> parsed(newPlugins.size());
+  const auto headerCache =
+      sharedPluginHeaderCache(m_Organizer.settings().paths().overwrite());
+#ifndef _WIN32
+  PluginPathResolver pathResolver;
+#endif
+
+  parallelFor(newPlugins.size(), [&](std::size_t i) {
+    auto& p = newPlugins[i];
+#ifndef _WIN32
+    p.fullPath = pathResolver.resolve(p.fullPath);
+#endif
+    parsed[i].emplace(p.name, p.forceLoaded, p.forceEnabled, p.forceDisabled,
+                      p.originName, p.fullPath, p.hasIni, std::move(p.archives),
+                      lightPluginsAreSupported, mediumPluginsAreSupported,
+                      blueprintPluginsAreSupported, headerCache.get());
+  });
+
+  headerCache->save();
+
+  m_ESPs.reserve(m_ESPs.size() + parsed.size());
+  for (auto& info : parsed) {
+    m_ESPs.push_back(std::move(*info));
+    m_ESPs.rbegin()->priority = -1;
+  }
+
   for (const auto& espName : m_ESPsByName) {
     if (!availablePlugins.contains(espName.first)) {
       m_ESPs[espName.second].name = "";
@@ -335,10 +469,13 @@ void PluginList::refresh(const QString& profileName,
 
   layoutChange.finish();
 
+  updateConflictIndex();
+
   refreshLoadOrder();
   emit dataChanged(this->index(0, 0),
                    this->index(static_cast<int>(m_ESPs.size()), columnCount()));
 
+  reportMemoryUsage();
   m_Refreshed();
 }
 
@@ -394,7 +531,7 @@ void PluginList::fixPluginRelationships()
   int standardCount        = 0;
   int masterCount          = 0;
   int blueprintMasterCount = 0;
-  for (auto plugin : m_ESPs) {
+  for (const auto& plugin : m_ESPs) {
     if (plugin.hasLightExtension || plugin.hasMasterExtension ||
         plugin.isMasterFlagged) {
       if (plugin.isBlueprintFlagged) {
@@ -498,11 +635,92 @@ void PluginList::enableESP(const QString& name, bool enable)
   }
 }
 
+void PluginList::updateConflictIndex()
+{
+  if (m_ConflictWatcher.isRunning()) {
+    // restarted with the current plugins once it's given up
+    *m_ConflictCancel       = true;
+    m_ConflictIndexOutdated = true;
+    return;
+  }
+
+  m_ConflictIndexOutdated = false;
+
+  // disabled plugins are read too, for their new records
+  std::vector<PluginConflictIndex::Plugin> plugins;
+  for (int row : m_ESPsByPriority) {
+    if (row < static_cast<int>(m_ESPs.size())) {
+      plugins.push_back({m_ESPs[row].name, ToWString(m_ESPs[row].fullPath),
+                         m_ESPs[row].enabled});
+    }
+  }
+
+  auto cache = sharedPluginRecordCache(m_Organizer.settings().paths().overwrite());
+  m_ConflictCancel = std::make_shared<std::atomic<bool>>(false);
+
+  // only copies go to the thread, so it can outlive the list
+  m_ConflictWatcher.setFuture(QtConcurrent::run(
+      [plugins = std::move(plugins), cache, cancel = m_ConflictCancel] {
+        TimeThis tt("PluginConflictIndex::build()");
+        auto index = PluginConflictIndex::build(plugins, *cache, *cancel);
+        cache->save();
+        return index;
+      }));
+}
+
+void PluginList::onConflictIndexBuilt()
+{
+  if (m_ConflictIndexOutdated) {
+    updateConflictIndex();
+    return;
+  }
+
+  if (auto index = m_ConflictWatcher.result()) {
+    m_ConflictIndex = std::move(index);
+    MOBase::memory::report("plugin conflicts",
+                           static_cast<qint64>(m_ConflictIndex->memoryUsage()),
+                           static_cast<qint64>(m_ESPs.size()));
+    emit dataChanged(this->index(0, 0),
+                     this->index(static_cast<int>(m_ESPs.size()) - 1, columnCount() - 1));
+  }
+}
+
+void PluginList::reportMemoryUsage() const
+{
+  using namespace MOBase::memory;
+
+  // the keys of the maps share their data with the names of the plugins
+  std::size_t bytes = heapBytes(m_ESPs) + treeBytes(m_ESPsByName) +
+                      heapBytes(m_ESPsByPriority) + treeBytes(m_ESPsByMaster);
+
+  for (const auto& esp : m_ESPs) {
+    for (const auto* s : {&esp.name, &esp.fullPath, &esp.index, &esp.originName,
+                          &esp.author, &esp.description}) {
+      bytes += heapBytes(*s);
+    }
+
+    for (const auto* names : {&esp.archives, &esp.masters, &esp.masterUnset}) {
+      bytes += treeBytes(*names);
+      for (const auto& name : *names) {
+        bytes += heapBytes(name);
+      }
+    }
+  }
+
+  for (const auto& [master, rows] : m_ESPsByMaster) {
+    bytes += heapBytes(rows);
+  }
+
+  report("plugin list", static_cast<qint64>(bytes),
+         static_cast<qint64>(m_ESPs.size()));
+}
+
 int PluginList::findPluginByPriority(int priority)
 {
-  for (int i = 0; i < m_ESPs.size(); i++) {
-    if (m_ESPs[i].priority == priority) {
-      return i;
+  if (priority >= 0 && priority < static_cast<int>(m_ESPsByPriority.size())) {
+    const int row = m_ESPsByPriority[priority];
+    if (m_ESPs[row].priority == priority) {
+      return row;
     }
   }
   log::error("No plugin with priority {}", priority);
@@ -579,6 +797,7 @@ void PluginList::shiftPluginsPriority(const QModelIndexList& indices, int offset
     }
   }
 
+  generatePluginIndexes();
   refreshLoadOrder();
 }
 
@@ -662,10 +881,10 @@ void PluginList::readLockedOrderFrom(const QString& fileName)
     return;
   }
 
-  if (!file.open(QIODevice::ReadOnly)) {
-    log::error("failed to open locked order file '{}': {}", fileName, file.errorString());
-    return;
-  }
+  if (!file.open(QIODevice::ReadOnly)) {
+    log::error("failed to open locked order file '{}': {}", fileName, file.errorString());
+    return;
+  }
   int lineNumber = 0;
   while (!file.atEnd()) {
     QByteArray line = file.readLine();
@@ -749,15 +968,13 @@ void PluginList::readLockedOrderFrom(const QString& fileName)
 
 void PluginList::writeLockedOrder(const QString& fileName) const
 {
-  SafeWriteFile file(fileName);
-
-  file->resize(0);
-  file->write(QString("# This file was automatically generated by Mod Organizer.\r\n")
-                  .toUtf8());
+  QByteArray data =
+      QString("# This file was automatically generated by Mod Organizer.\r\n").toUtf8();
   for (auto iter = m_LockedOrder.begin(); iter != m_LockedOrder.end(); ++iter) {
-    file->write(QString("%1|%2\r\n").arg(iter->first).arg(iter->second).toUtf8());
+    data.append(QString("%1|%2\r\n").arg(iter->first).arg(iter->second).toUtf8());
   }
-  file->commit();
+
+  writeFileIfDifferent(fileName, data);
 }
 
 void PluginList::saveTo(const QString& lockedOrderFileName) const
@@ -791,6 +1008,21 @@ bool PluginList::saveLoadOrder(DirectoryEntry& directoryStructure)
                          directoryStructure.getOriginByID(originid).getPath()))
                      .filePath(esp.name);
 
+      ULONGLONG temp = 0;
+      temp           = (145731ULL + esp.priority) * 24 * 60 * 60 * 10000000ULL;
+
+      FILETIME newWriteTime;
+      newWriteTime.dwLowDateTime  = (DWORD)(temp & 0xFFFFFFFF);
+      newWriteTime.dwHighDateTime = (DWORD)(temp >> 32);
+
+      const FILETIME oldWriteTime = fileEntry->getFileTime();
+      if (oldWriteTime.dwLowDateTime == newWriteTime.dwLowDateTime &&
+          oldWriteTime.dwHighDateTime == newWriteTime.dwHighDateTime) {
+        // already in place, most plugins don't move between saves
+        esp.time = newWriteTime;
+        continue;
+      }
+
 #ifdef _WIN32
       HANDLE file =
           ::CreateFile(ToWString(fileName).c_str(), GENERIC_READ | GENERIC_WRITE, 0,
@@ -805,14 +1037,7 @@ bool PluginList::saveLoadOrder(DirectoryEntry& directoryStructure)
         }
       }
 
-      ULONGLONG temp = 0;
-      temp           = (145731ULL + esp.priority) * 24 * 60 * 60 * 10000000ULL;
-
-      FILETIME newWriteTime;
-
-      newWriteTime.dwLowDateTime  = (DWORD)(temp & 0xFFFFFFFF);
-      newWriteTime.dwHighDateTime = (DWORD)(temp >> 32);
-      esp.time                    = newWriteTime;
+      esp.time = newWriteTime;
       fileEntry->setFileTime(newWriteTime);
       if (!::SetFileTime(file, nullptr, nullptr, &newWriteTime)) {
         throw windows_error(QObject::tr("failed to set file time %1")
@@ -824,13 +1049,7 @@ bool PluginList::saveLoadOrder(DirectoryEntry& directoryStructure)
       CloseHandle(file);
 #else
       // On Linux, use utimensat to set file modification time
-      ULONGLONG temp = 0;
-      temp           = (145731ULL + esp.priority) * 24 * 60 * 60 * 10000000ULL;
-
-      FILETIME newWriteTime;
-      newWriteTime.dwLowDateTime  = (DWORD)(temp & 0xFFFFFFFF);
-      newWriteTime.dwHighDateTime = (DWORD)(temp >> 32);
-      esp.time                    = newWriteTime;
+      esp.time = newWriteTime;
       fileEntry->setFileTime(newWriteTime);
 
       // Convert FILETIME to timespec and set the file modification time
@@ -1197,6 +1416,24 @@ QString PluginList::description(const QString& name) const
   }
 }
 
+int PluginList::newRecordCount(const QString& name) const
+{
+  const auto records = m_ConflictIndex ? m_ConflictIndex->records(name) : nullptr;
+  return records ? static_cast<int>(records->newRecords) : -1;
+}
+
+bool PluginList::isLightEligible(const QString& name) const
+{
+  const auto records = m_ConflictIndex ? m_ConflictIndex->records(name) : nullptr;
+  return records && records->fitsLight;
+}
+
+bool PluginList::isMediumEligible(const QString& name) const
+{
+  const auto records = m_ConflictIndex ? m_ConflictIndex->records(name) : nullptr;
+  return records && records->fitsMedium;
+}
+
 boost::signals2::connection PluginList::onPluginStateChanged(
     const std::function<void(const std::map<QString, PluginStates>&)>& func)
 {
@@ -1233,7 +1470,15 @@ void PluginList::updateIndices()
   m_ESPsByName.clear();
   m_ESPsByPriority.clear();
   m_ESPsByPriority.resize(m_ESPs.size());
+  m_ESPsByMaster.clear();
+  m_BlueprintStart = 0;
   for (unsigned int i = 0; i < m_ESPs.size(); ++i) {
+    if (!m_ESPs[i].isBlueprintFlagged) {
+      ++m_BlueprintStart;
+    }
+    for (const auto& master : m_ESPs[i].masters) {
+      m_ESPsByMaster[master].push_back(i);
+    }
     if (m_ESPs[i].priority < 0) {
       continue;
     }
@@ -1330,6 +1575,38 @@ void PluginList::testMasters()
   }
 }
 
+void PluginList::testMasters(int row)
+{
+  const auto isEnabled = [this](const QString& name) {
+    auto iter = m_ESPsByName.find(name);
+    return iter != m_ESPsByName.end() && m_ESPs[iter->second].enabled;
+  };
+
+  ESPInfo& plugin = m_ESPs[row];
+  plugin.masterUnset.clear();
+  if (plugin.enabled) {
+    for (const auto& master : plugin.masters) {
+      if (!isEnabled(master)) {
+        plugin.masterUnset.insert(master);
+      }
+    }
+  }
+
+  auto children = m_ESPsByMaster.find(plugin.name);
+  if (children == m_ESPsByMaster.end()) {
+    return;
+  }
+
+  for (int child : children->second) {
+    ESPInfo& info = m_ESPs[child];
+    if (info.enabled && !plugin.enabled) {
+      info.masterUnset.insert(plugin.name);
+    } else {
+      info.masterUnset.erase(plugin.name);
+    }
+  }
+}
+
 QVariant PluginList::data(const QModelIndex& modelIndex, int role) const
 {
   int index = modelIndex.row();
@@ -1423,6 +1700,10 @@ QVariant PluginList::backgroundData(const QModelIndex& modelIndex) const
     return Settings::instance().colors().pluginListContained();
   } else if (plugin.isMasterOfSelectedPlugin) {
     return Settings::instance().colors().pluginListMaster();
+  } else if (plugin.isOverridingSelectedPlugin) {
+    return Settings::instance().colors().modlistOverwritingLoose();
+  } else if (plugin.isOverriddenBySelectedPlugin) {
+    return Settings::instance().colors().modlistOverwrittenLoose();
   }
 
   return {};
@@ -1529,6 +1810,33 @@ QVariant PluginList::tooltipData(const QModelIndex& modelIndex) const
                   "the plugin)");
   }
 
+  if (m_ConflictIndex) {
+    const auto counts = m_ConflictIndex->counts(esp.name);
+    if (counts && (counts->overriding > 0 || counts->overridden > 0)) {
+      toolTip += "<br><b>" + tr("Record Conflicts") + "</b>: " +
+                 tr("overrides %1 records of earlier plugins, %2 of its records are "
+                    "overridden by later plugins")
+                     .arg(counts->overriding)
+                     .arg(counts->overridden);
+    }
+
+    // only worth pointing out for plugins that take a full slot
+    const auto records     = m_ConflictIndex->records(esp.name);
+    const auto gamePlugins = m_Organizer.gameFeatures().gameFeature<GamePlugins>();
+    if (records && gamePlugins && !esp.isLightFlagged && !esp.hasLightExtension &&
+        !esp.isMediumFlagged && !esp.hasNoRecords) {
+      const bool light  = records->fitsLight && gamePlugins->lightPluginsAreSupported();
+      const bool medium = records->fitsMedium && gamePlugins->mediumPluginsAreSupported();
+
+      if (light || medium) {
+        toolTip += "<br><b>" + tr("New Records") + "</b>: " +
+                   tr("%1, they would fit in a %2 plugin")
+                       .arg(records->newRecords)
+                       .arg(light ? tr("light") : tr("medium"));
+      }
+    }
+  }
+
   if (esp.hasIni) {
     toolTip += "<br><b>" + tr("Loads INI settings") +
                "</b>: "
@@ -1788,7 +2096,7 @@ bool PluginList::setData(const QModelIndex& modIndex, const QVariant& value, int
   if (oldState != newState) {
     try {
       pluginStatesChanged({modName}, newState);
-      testMasters();
+      testMasters(modIndex.row());
       emit dataChanged(this->index(0, 0),
                        this->index(static_cast<int>(m_ESPs.size()), columnCount()));
     } catch (const std::exception& e) {
@@ -1845,12 +2153,7 @@ void PluginList::setPluginPriority(int row, int& newPriority, bool isForced)
   else if (newPriorityTemp >= static_cast<int>(m_ESPsByPriority.size()))
     newPriorityTemp = static_cast<int>(m_ESPsByPriority.size()) - 1;
 
-  int blueprintStartPos = 0;
-  for (auto esp : m_ESPs) {
-    if (!esp.isBlueprintFlagged) {
-      blueprintStartPos++;
-    }
-  }
+  const int blueprintStartPos = m_BlueprintStart;
 
   bool isBlueprint = m_ESPs[row].isBlueprintFlagged;
   int lowerLimit   = 0;
@@ -1909,18 +2212,14 @@ void PluginList::setPluginPriority(int row, int& newPriority, bool isForced)
     }
   } else if (newPriorityTemp > oldPriority) {  // moving down
     // don't allow masters to be moved below their children
-    for (int i = oldPriority + 1; i <= newPriorityTemp; i++) {
-      PluginList::ESPInfo* otherInfo = &m_ESPs.at(m_ESPsByPriority[i]);
-      for (auto master : otherInfo->masters) {
-        auto iter = m_ESPsByName.find(master);
-        if (iter != m_ESPsByName.end()) {
-          if (m_ESPs[iter->second].isBlueprintFlagged ==
-              otherInfo->isBlueprintFlagged) {
-            if (master.compare(m_ESPs[row].name, Qt::CaseInsensitive) == 0) {
-              newPriorityTemp = otherInfo->priority - 1;
-              break;
-            }
-          }
+    auto children = m_ESPsByMaster.find(m_ESPs[row].name);
+    if (children != m_ESPsByMaster.end()) {
+      const int limit = newPriorityTemp;
+      for (int child : children->second) {
+        const ESPInfo& otherInfo = m_ESPs[child];
+        if (otherInfo.isBlueprintFlagged == m_ESPs[row].isBlueprintFlagged &&
+            otherInfo.priority > oldPriority && otherInfo.priority <= limit) {
+          newPriorityTemp = std::min(newPriorityTemp, otherInfo.priority - 1);
         }
       }
     }
@@ -1945,14 +2244,26 @@ void PluginList::setPluginPriority(int row, int& newPriority, bool isForced)
       }
 
       m_ESPs.at(row).priority = newPriorityTemp;
+
+      // only the moved range changed order, the names and masters didn't
+      // change at all; indexes are generated by the caller once it's done
+      // moving
+      auto first = m_ESPsByPriority.begin();
+      if (newPriorityTemp > oldPriority) {
+        std::rotate(first + oldPriority, first + oldPriority + 1,
+                    first + newPriorityTemp + 1);
+      } else {
+        std::rotate(first + newPriorityTemp, first + oldPriority,
+                    first + oldPriority + 1);
+      }
+
       emit dataChanged(index(row, 0), index(row, columnCount()));
       m_PluginMoved(m_ESPs[row].name, oldPriority, newPriorityTemp);
     }
   } catch (const std::out_of_range&) {
     reportError(tr("failed to restore load order for %1").arg(m_ESPs[row].name));
+    updateIndices();
   }
-
-  updateIndices();
 }
 
 void PluginList::changePluginPriority(std::vector<int> rows, int newPriority)
@@ -2039,54 +2350,35 @@ PluginList::ESPInfo::ESPInfo(const QString& name, bool forceLoaded, bool forceEn
                              bool forceDisabled, const QString& originName,
                              const QString& fullPath, bool hasIni,
                              std::set<QString> archives, bool lightSupported,
-                             bool mediumSupported, bool blueprintSupported)
+                             bool mediumSupported, bool blueprintSupported,
+                             PluginHeaderCache* headerCache)
     : name(name), fullPath(fullPath), enabled(forceLoaded), forceLoaded(forceLoaded),
       forceEnabled(forceEnabled), forceDisabled(forceDisabled), priority(0),
       loadOrder(-1), originName(originName), hasIni(hasIni),
       archives(archives.begin(), archives.end()), modSelected(false),
-      isMasterOfSelectedPlugin(false)
+      isMasterOfSelectedPlugin(false), isOverridingSelectedPlugin(false),
+      isOverriddenBySelectedPlugin(false)
 {
-  QString parsePath = fullPath;
-#ifndef _WIN32
-  if (!QFileInfo::exists(parsePath)) {
-    const QFileInfo fi(parsePath);
-    const QDir dir(fi.path());
-    if (dir.exists()) {
-      const auto candidates = dir.entryList(QDir::Files | QDir::Readable);
-      const auto targetName = fi.fileName();
-      const auto it = std::find_if(candidates.begin(), candidates.end(),
-                                   [&](const QString& candidate) {
-                                     return candidate.compare(targetName,
-                                                              Qt::CaseInsensitive) == 0;
-                                   });
-      if (it != candidates.end()) {
-        parsePath     = dir.filePath(*it);
-        this->fullPath = parsePath;
-        log::warn("plugin path case mismatch, resolved '{}' -> '{}'", fullPath, parsePath);
-      }
-    }
-  }
-#endif
-
   try {
-    ESP::File file(ToWString(parsePath));
+    const auto file    = headerCache ? headerCache->get(ToWString(fullPath))
+                                     : readPluginHeader(ToWString(fullPath));
     auto extension     = name.right(3).toLower();
     hasMasterExtension = (extension == "esm");
     hasLightExtension  = (extension == "esl");
-    isMasterFlagged    = file.isMaster();
-    isLightFlagged     = lightSupported && file.isLight(mediumSupported);
-    isMediumFlagged    = mediumSupported && file.isMedium();
+    isMasterFlagged    = file->isMaster();
+    isLightFlagged     = lightSupported && file->isLight(mediumSupported);
+    isMediumFlagged    = mediumSupported && file->isMedium();
     isBlueprintFlagged = blueprintSupported &&
                          (isMasterFlagged || hasMasterExtension || hasLightExtension) &&
-                         file.isBlueprint();
-    hasNoRecords = file.isDummy();
+                         file->isBlueprint();
+    hasNoRecords = file->dummy;
 
-    formVersion   = file.formVersion();
-    headerVersion = file.headerVersion();
-    author        = QString::fromLatin1(file.author().c_str());
-    description   = QString::fromLatin1(file.description().c_str());
+    formVersion   = file->formVersion;
+    headerVersion = file->headerVersion;
+    author        = QString::fromLatin1(file->author.c_str());
+    description   = QString::fromLatin1(file->description.c_str());
 
-    for (auto&& m : file.masters()) {
+    for (auto&& m : file->masters) {
       masters.insert(QString::fromStdString(m));
     }
   } catch (const std::exception& e) {
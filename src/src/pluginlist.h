@@ -31,6 +31,7 @@ class IPluginGame;
 }
 
 #include <QElapsedTimer>
+#include <QFutureWatcher>
 #include <QListWidget>
 #include <QString>
 #include <QTemporaryFile>
@@ -44,10 +45,14 @@ class IPluginGame;
 #include <boost/signals2.hpp>
 #endif
 
+#include <atomic>
 #include <map>
+#include <memory>
 #include <vector>
 
 class OrganizerCore;
+class PluginConflictIndex;
+class PluginHeaderCache;
 
 template <class C>
 class ChangeBracket
@@ -228,6 +233,9 @@ public:
   void highlightPlugins(const std::vector<unsigned int>& modIndices,
                         const MOShared::DirectoryEntry& directoryEntry);
 
+  // highlights the masters of the selected plugins and the plugins changing
+  // the same records as them
+  //
   void highlightMasters(const QModelIndexList& selectedPluginIndices);
 
   void refreshLoadOrder();
@@ -257,6 +265,9 @@ public:
   float headerVersion(const QString& name) const;
   QString author(const QString& name) const;
   QString description(const QString& name) const;
+  int newRecordCount(const QString& name) const;
+  bool isLightEligible(const QString& name) const;
+  bool isMediumEligible(const QString& name) const;
 
   boost::signals2::connection onRefreshed(const std::function<void()>& callback);
   boost::signals2::connection
@@ -331,7 +342,8 @@ private:
     ESPInfo(const QString& name, bool forceLoaded, bool forceEnabled,
             bool forceDisabled, const QString& originName, const QString& fullPath,
             bool hasIni, std::set<QString> archives, bool lightSupported,
-            bool mediumSupported, bool blueprintSupported);
+            bool mediumSupported, bool blueprintSupported,
+            PluginHeaderCache* headerCache = nullptr);
 
     QString name;
     QString fullPath;
@@ -353,6 +365,8 @@ private:
     bool hasNoRecords;
     bool modSelected;
     bool isMasterOfSelectedPlugin;
+    bool isOverridingSelectedPlugin;
+    bool isOverriddenBySelectedPlugin;
     int formVersion;
     float headerVersion;
     QString author;
@@ -383,12 +397,27 @@ private:
 
   void testMasters();
 
+  // updates the missing masters of the plugin at `row` and of the plugins
+  // that have it as a master, after it was enabled or disabled
+  //
+  void testMasters(int row);
+
   void fixPrimaryPlugins();
   void fixPriorities();
   void fixPluginRelationships();
 
   int findPluginByPriority(int priority);
 
+  // rebuilds the record conflicts of the enabled plugins in the background,
+  // cancelling a build that's still running
+  //
+  void updateConflictIndex();
+  void onConflictIndexBuilt();
+
+  // reports the estimated memory taken by the plugins, see MOBase::memory
+  //
+  void reportMemoryUsage() const;
+
   /**
    * @brief Notify MO2 plugins that the states of the given plugins have changed to the
    * given state.
@@ -408,6 +437,20 @@ private:
   std::map<QString, int, MOBase::FileNameComparator> m_ESPsByName;
   std::vector<int> m_ESPsByPriority;
 
+  // rows of the plugins that have the key as a master, rows only change on
+  // refresh so moves and toggles don't have to touch this
+  std::map<QString, std::vector<int>, MOBase::FileNameComparator> m_ESPsByMaster;
+
+  // number of plugins that aren't blueprints, which are sorted after them
+  int m_BlueprintStart = 0;
+
+  // record conflicts between the enabled plugins, null until the first build
+  // is done
+  std::shared_ptr<const PluginConflictIndex> m_ConflictIndex;
+  QFutureWatcher<std::shared_ptr<const PluginConflictIndex>> m_ConflictWatcher;
+  std::shared_ptr<std::atomic<bool>> m_ConflictCancel;
+  bool m_ConflictIndexOutdated = false;
+
   std::map<QString, int, MOBase::FileNameComparator> m_LockedOrder;
 
   std::map<QString, AdditionalInfo, MOBase::FileNameComparator>
@@ -153,3 +153,18 @@ QString PluginListProxy::description(const QString& name) const
 {
   return m_Proxied->description(name);
 }
+
+int PluginListProxy::newRecordCount(const QString& name) const
+{
+  return m_Proxied->newRecordCount(name);
+}
+
+bool PluginListProxy::isLightEligible(const QString& name) const
+{
+  return m_Proxied->isLightEligible(name);
+}
+
+bool PluginListProxy::isMediumEligible(const QString& name) const
+{
+  return m_Proxied->isMediumEligible(name);
+}
@@ -41,6 +41,9 @@ public:
   float headerVersion(const QString& name) const override;
   QString author(const QString& name) const override;
   QString description(const QString& name) const override;
+  int newRecordCount(const QString& name) const override;
+  bool isLightEligible(const QString& name) const override;
+  bool isMediumEligible(const QString& name) const override;
 
 private:
   friend class OrganizerProxy;
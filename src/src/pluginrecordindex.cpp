@@ -0,0 +1,530 @@
+#include "pluginrecordindex.h"
+#include "shared/util.h"
+#include "vfs/layercache.h"
+#include "vfs/taskpool.h"
+
+#include <esptk/esprecords.h>
+#include <uibase/log.h>
+#include <uibase/memoryusage.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <set>
+
+using namespace MOBase;
+using namespace MOShared;
+namespace fs = std::filesystem;
+
+namespace
+{
+
+constexpr char Magic[8]          = {'M', 'O', '2', 'E', 'S', 'P', 'R', 'C'};
+constexpr uint32_t Version       = 2;
+constexpr const wchar_t* Name    = L"plugin_record_cache.bin";
+constexpr uint32_t MaxStringSize = 1u << 16;
+constexpr uint32_t MaxRecords    = 1u << 26;
+
+// plugins are stored in 16 bits in the index, far more than any game loads
+constexpr std::size_t MaxPlugins = 0xffff;
+
+// size and modification time of the plugin, false if it can't be read
+//
+bool pluginStamp(const std::wstring& path, uint64_t& size, int64_t& writeTime)
+{
+  std::error_code ec;
+
+  size = fs::file_size(path, ec);
+  if (ec) {
+    return false;
+  }
+
+  const auto lwt = fs::last_write_time(path, ec);
+  if (ec) {
+    return false;
+  }
+
+  writeTime = static_cast<int64_t>(lwt.time_since_epoch().count());
+  return true;
+}
+
+class Writer
+{
+public:
+  explicit Writer(std::ofstream& out) : m_out(out) {}
+
+  template <class T>
+  void put(T value)
+  {
+    m_out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  void putString(const std::string& s)
+  {
+    put(static_cast<uint32_t>(s.size()));
+    m_out.write(s.data(), static_cast<std::streamsize>(s.size()));
+  }
+
+  void putIds(const std::vector<uint32_t>& ids)
+  {
+    put(static_cast<uint32_t>(ids.size()));
+    m_out.write(reinterpret_cast<const char*>(ids.data()),
+                static_cast<std::streamsize>(ids.size() * sizeof(uint32_t)));
+  }
+
+private:
+  std::ofstream& m_out;
+};
+
+class Reader
+{
+public:
+  explicit Reader(std::ifstream& in) : m_in(in) {}
+
+  template <class T>
+  bool get(T& value)
+  {
+    return static_cast<bool>(m_in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+  }
+
+  bool getString(std::string& s)
+  {
+    uint32_t size = 0;
+    if (!get(size) || size > MaxStringSize) {
+      return false;
+    }
+    s.resize(size);
+    return static_cast<bool>(m_in.read(s.data(), size));
+  }
+
+  bool getIds(std::vector<uint32_t>& ids)
+  {
+    uint32_t size = 0;
+    if (!get(size) || size > MaxRecords) {
+      return false;
+    }
+    ids.resize(size);
+    return static_cast<bool>(m_in.read(reinterpret_cast<char*>(ids.data()),
+                                       size * sizeof(uint32_t)));
+  }
+
+private:
+  std::ifstream& m_in;
+};
+
+std::string lowerName(const QString& name)
+{
+  return name.toLower().toStdString();
+}
+
+}  // namespace
+
+std::shared_ptr<const PluginRecordList> readPluginRecords(const std::wstring& path)
+{
+  auto list = std::make_shared<PluginRecordList>();
+
+  if (!pluginStamp(path, list->fileSize, list->writeTime)) {
+    log::warn("failed to get size and last modified date for '{}'", path);
+  }
+
+  const ESP::PluginRecords records(path, [&](const ESP::PluginRecords::Header& h) {
+    list->formIds.push_back(h.formId);
+  });
+
+  list->masters    = records.masters();
+  list->newRecords = static_cast<uint32_t>(records.newRecordCount());
+  list->fitsLight  = records.fitsLight();
+  list->fitsMedium = records.fitsMedium();
+
+  std::sort(list->formIds.begin(), list->formIds.end());
+  list->formIds.erase(std::unique(list->formIds.begin(), list->formIds.end()),
+                      list->formIds.end());
+  list->formIds.shrink_to_fit();
+
+  return list;
+}
+
+PluginRecordCache::PluginRecordCache(std::wstring path) : m_path(std::move(path))
+{
+  load();
+}
+
+void PluginRecordCache::load()
+{
+  std::ifstream in(fs::path(m_path), std::ios::binary);
+  if (!in) {
+    return;
+  }
+
+  char magic[sizeof(Magic)] = {};
+  uint32_t version          = 0;
+  uint32_t count            = 0;
+  Reader r(in);
+
+  if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, Magic, sizeof(Magic)) != 0 ||
+      !r.get(version) || version != Version || !r.get(count)) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < count; ++i) {
+    auto list = std::make_shared<PluginRecordList>();
+    std::string path;
+    uint32_t masters = 0;
+
+    if (!r.getString(path) || !r.get(list->fileSize) || !r.get(list->writeTime) ||
+        !r.get(masters) || masters > MaxStringSize) {
+      return;
+    }
+
+    list->masters.resize(masters);
+
+    for (auto& master : list->masters) {
+      if (!r.getString(master)) {
+        return;
+      }
+    }
+
+    if (!r.getIds(list->formIds) || !r.get(list->newRecords) ||
+        !r.get(list->fitsLight) || !r.get(list->fitsMedium)) {
+      return;
+    }
+
+    m_lists.insert_or_assign(ToWString(path, true), std::move(list));
+  }
+}
+
+std::shared_ptr<const PluginRecordList> PluginRecordCache::get(const std::wstring& path)
+{
+  std::shared_ptr<const PluginRecordList> cached;
+  {
+    std::scoped_lock lock(m_mutex);
+    m_used.insert(path);
+    if (auto itor = m_lists.find(path); itor != m_lists.end()) {
+      cached = itor->second;
+    }
+  }
+
+  if (cached) {
+    uint64_t size     = 0;
+    int64_t writeTime = 0;
+
+    if (pluginStamp(path, size, writeTime) && size == cached->fileSize &&
+        writeTime == cached->writeTime) {
+      return cached;
+    }
+  }
+
+  std::shared_ptr<const PluginRecordList> list;
+  try {
+    list = readPluginRecords(path);
+  } catch (...) {
+    std::scoped_lock lock(m_mutex);
+    if (m_lists.erase(path) > 0) {
+      m_dirty = true;
+    }
+    throw;
+  }
+
+  std::scoped_lock lock(m_mutex);
+  m_lists.insert_or_assign(path, list);
+  m_dirty = true;
+
+  return list;
+}
+
+bool PluginRecordCache::save()
+{
+  std::vector<std::pair<std::wstring, std::shared_ptr<const PluginRecordList>>> lists;
+  {
+    std::scoped_lock lock(m_mutex);
+    if (!m_dirty) {
+      return true;
+    }
+    // plugins nobody asked for in this run were removed or disabled
+    for (const auto& [path, list] : m_lists) {
+      if (m_used.contains(path)) {
+        lists.emplace_back(path, list);
+      }
+    }
+    m_dirty = false;
+  }
+
+  const auto failed = [this] {
+    std::scoped_lock lock(m_mutex);
+    m_dirty = true;
+    return false;
+  };
+
+  const fs::path target(m_path);
+  const fs::path tmpPath(m_path + L".tmp");
+  {
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return failed();
+    }
+
+    Writer w(out);
+    out.write(Magic, sizeof(Magic));
+    w.put(Version);
+    w.put(static_cast<uint32_t>(lists.size()));
+
+    for (const auto& [path, list] : lists) {
+      w.putString(ToString(path, true));
+      w.put(list->fileSize);
+      w.put(list->writeTime);
+      w.put(static_cast<uint32_t>(list->masters.size()));
+
+      for (const auto& master : list->masters) {
+        w.putString(master);
+      }
+
+      w.putIds(list->formIds);
+      w.put(list->newRecords);
+      w.put(list->fitsLight);
+      w.put(list->fitsMedium);
+    }
+
+    if (!out.flush()) {
+      out.close();
+      std::error_code ec;
+      fs::remove(tmpPath, ec);
+      return failed();
+    }
+  }
+
+  std::error_code ec;
+  fs::rename(tmpPath, target, ec);
+  if (ec) {
+    log::warn("failed to write plugin record cache '{}', {}", m_path, ec.message());
+    fs::remove(tmpPath, ec);
+    return failed();
+  }
+
+  return true;
+}
+
+std::shared_ptr<PluginRecordCache> sharedPluginRecordCache(const QString& overwriteDir)
+{
+  static std::mutex mutex;
+  static std::shared_ptr<PluginRecordCache> cache;
+  static std::wstring cachePath;
+
+  const fs::path layerCache = layerCachePath(overwriteDir.toStdString());
+  const std::wstring path   = (layerCache.parent_path() / Name).wstring();
+
+  std::scoped_lock lock(mutex);
+  if (cache == nullptr || cachePath != path) {
+    cache     = std::make_shared<PluginRecordCache>(path);
+    cachePath = path;
+  }
+  return cache;
+}
+
+std::shared_ptr<const PluginConflictIndex>
+PluginConflictIndex::build(const std::vector<Plugin>& plugins, PluginRecordCache& cache,
+                           const std::atomic<bool>& cancel)
+{
+  std::vector<std::shared_ptr<const PluginRecordList>> all(plugins.size());
+
+  parallelFor(plugins.size(), [&](std::size_t i) {
+    if (cancel) {
+      return;
+    }
+
+    try {
+      all[i] = cache.get(plugins[i].path);
+    } catch (const std::exception& e) {
+      log::debug("no records for '{}', {}", plugins[i].name, e.what());
+    }
+  });
+
+  if (cancel) {
+    return {};
+  }
+
+  auto index = std::make_shared<PluginConflictIndex>();
+
+  // from here on only the enabled plugins count, `i` is their position among
+  // them
+  std::vector<const Plugin*> enabled;
+  std::vector<std::shared_ptr<const PluginRecordList>> lists;
+
+  for (std::size_t i = 0; i < plugins.size(); ++i) {
+    if (all[i]) {
+      index->m_records.emplace(plugins[i].name, all[i]);
+    }
+    if (plugins[i].enabled) {
+      enabled.push_back(&plugins[i]);
+      lists.push_back(all[i]);
+    }
+  }
+
+  const std::size_t count = std::min(enabled.size(), MaxPlugins);
+  if (count < enabled.size()) {
+    log::warn("only the first {} of {} plugins are checked for record conflicts",
+              count, enabled.size());
+  }
+
+  // every record is known by the plugin that added it; masters that aren't
+  // loaded get ids past the load order so their records still match up
+  std::unordered_map<std::string, uint32_t> owners;
+  for (std::size_t i = 0; i < count; ++i) {
+    owners.emplace(lowerName(enabled[i]->name), static_cast<uint32_t>(i));
+  }
+
+  std::size_t total = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    total += lists[i] ? lists[i]->formIds.size() : 0;
+  }
+
+  // owner, object id and plugin packed so that sorting groups every record
+  // with the plugins that have it, in load order
+  std::vector<uint64_t> entries;
+  entries.reserve(total);
+
+  for (std::size_t i = 0; i < count; ++i) {
+    if (!lists[i]) {
+      continue;
+    }
+
+    std::vector<uint64_t> masterIds;
+    masterIds.reserve(lists[i]->masters.size());
+
+    for (const auto& master : lists[i]->masters) {
+      const auto next = static_cast<uint32_t>(owners.size());
+      masterIds.push_back(
+          owners.emplace(lowerName(QString::fromStdString(master)), next).first->second);
+    }
+
+    for (uint32_t formId : lists[i]->formIds) {
+      const std::size_t master = formId >> 24;
+      const uint64_t owner     = master < masterIds.size() ? masterIds[master] : i;
+
+      entries.push_back((owner << 40) | (uint64_t(formId & 0xffffff) << 16) | i);
+    }
+  }
+
+  std::sort(entries.begin(), entries.end());
+  entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+  if (cancel) {
+    return {};
+  }
+
+  index->m_counts.resize(count);
+  index->m_pluginRecords.resize(count);
+  index->m_names.reserve(count);
+
+  for (std::size_t i = 0; i < count; ++i) {
+    index->m_names.push_back(enabled[i]->name);
+    index->m_indices.emplace(enabled[i]->name, static_cast<int>(i));
+  }
+
+  for (std::size_t first = 0; first < entries.size();) {
+    const uint64_t record = entries[first] >> 16;
+
+    std::size_t last = first + 1;
+    while (last < entries.size() && (entries[last] >> 16) == record) {
+      ++last;
+    }
+
+    if (last - first > 1) {
+      const auto id = static_cast<uint32_t>(index->m_recordOffsets.size());
+      index->m_recordOffsets.push_back(
+          static_cast<uint32_t>(index->m_recordPlugins.size()));
+
+      for (std::size_t e = first; e < last; ++e) {
+        const auto plugin = static_cast<uint16_t>(entries[e] & 0xffff);
+
+        index->m_recordPlugins.push_back(plugin);
+        index->m_pluginRecords[plugin].push_back(id);
+
+        if (e != first) {
+          ++index->m_counts[plugin].overriding;
+        }
+        if (e + 1 != last) {
+          ++index->m_counts[plugin].overridden;
+        }
+      }
+    }
+
+    first = last;
+  }
+
+  index->m_recordOffsets.push_back(static_cast<uint32_t>(index->m_recordPlugins.size()));
+
+  return index;
+}
+
+std::shared_ptr<const PluginRecordList>
+PluginConflictIndex::records(const QString& name) const
+{
+  auto itor = m_records.find(name);
+  if (itor == m_records.end()) {
+    return {};
+  }
+
+  return itor->second;
+}
+
+std::optional<PluginConflictIndex::Counts>
+PluginConflictIndex::counts(const QString& name) const
+{
+  auto itor = m_indices.find(name);
+  if (itor == m_indices.end()) {
+    return {};
+  }
+
+  return m_counts[itor->second];
+}
+
+std::size_t PluginConflictIndex::memoryUsage() const
+{
+  using namespace MOBase::memory;
+
+  std::size_t bytes = sizeof(PluginConflictIndex) + treeBytes(m_records) +
+                      heapBytes(m_names) + treeBytes(m_indices) + heapBytes(m_counts) +
+                      heapBytes(m_recordOffsets) + heapBytes(m_recordPlugins) +
+                      heapBytes(m_pluginRecords);
+
+  for (const auto& [name, list] : m_records) {
+    if (list) {
+      bytes += sizeof(PluginRecordList) + heapBytes(list->masters) +
+               heapBytes(list->formIds);
+      for (const auto& master : list->masters) {
+        bytes += heapBytes(master);
+      }
+    }
+  }
+
+  for (const auto& records : m_pluginRecords) {
+    bytes += heapBytes(records);
+  }
+
+  return bytes;
+}
+
+void PluginConflictIndex::conflicts(const QString& name, QStringList& before,
+                                    QStringList& after) const
+{
+  auto itor = m_indices.find(name);
+  if (itor == m_indices.end()) {
+    return;
+  }
+
+  const int self = itor->second;
+  std::set<uint16_t> others;
+
+  for (uint32_t record : m_pluginRecords[self]) {
+    for (uint32_t i = m_recordOffsets[record]; i < m_recordOffsets[record + 1]; ++i) {
+      if (m_recordPlugins[i] != self) {
+        others.insert(m_recordPlugins[i]);
+      }
+    }
+  }
+
+  for (uint16_t other : others) {
+    (other < self ? before : after).append(m_names[other]);
+  }
+}
@@ -0,0 +1,154 @@
+#ifndef PLUGINRECORDINDEX_H
+#define PLUGINRECORDINDEX_H
+
+#include <uibase/ifiletree.h>
+
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// the form ids of every record in a plugin as stored in the file, see
+// ESP::PluginRecords
+//
+struct PluginRecordList
+{
+  // of the plugin file itself, the list is stale once either changes
+  uint64_t fileSize = 0;
+  int64_t writeTime = 0;
+
+  // in the order the top byte of the form ids refers to them
+  std::vector<std::string> masters;
+
+  // sorted, without duplicates
+  std::vector<uint32_t> formIds;
+
+  // records the plugin adds rather than overrides, and whether their object ids
+  // would still be valid with the plugin flagged as light or medium
+  uint32_t newRecords = 0;
+  bool fitsLight      = false;
+  bool fitsMedium     = false;
+};
+
+// walks the records of the plugin at `path`, throws the ESP exceptions if it
+// isn't valid
+//
+std::shared_ptr<const PluginRecordList> readPluginRecords(const std::wstring& path);
+
+// Record lists persisted next to the instance, so a plugin that didn't change
+// is never walked again, not even across restarts.  Entries are checked
+// against the size and modification time of the plugin whenever they're handed
+// out.
+//
+// All members are thread-safe.
+class PluginRecordCache
+{
+public:
+  explicit PluginRecordCache(std::wstring path);
+
+  // the cached records of the plugin at `path` if they're still current,
+  // walking the plugin and caching the result otherwise; throws like
+  // readPluginRecords()
+  //
+  std::shared_ptr<const PluginRecordList> get(const std::wstring& path);
+
+  // writes the lists used by this process if anything changed since the file
+  // was loaded or last saved
+  //
+  bool save();
+
+private:
+  void load();
+
+  std::wstring m_path;
+  mutable std::mutex m_mutex;
+  std::unordered_map<std::wstring, std::shared_ptr<const PluginRecordList>> m_lists;
+  std::unordered_set<std::wstring> m_used;
+  bool m_dirty = false;
+};
+
+// process-wide cache for the instance owning `overwriteDir`, loaded on first
+// use
+//
+std::shared_ptr<PluginRecordCache> sharedPluginRecordCache(const QString& overwriteDir);
+
+// The record lists of every plugin and which of the enabled ones change the
+// same records.  A record is known by the plugin that added it, resolved
+// through the masters of every plugin that has it, and the id within that
+// plugin.
+//
+// Built once for a load order and immutable after that.
+class PluginConflictIndex
+{
+public:
+  struct Plugin
+  {
+    QString name;
+    std::wstring path;
+
+    // only enabled plugins can conflict
+    bool enabled = true;
+  };
+
+  struct Counts
+  {
+    // records already in an earlier plugin that this one changes
+    int overriding = 0;
+
+    // records of this plugin that a later plugin changes again
+    int overridden = 0;
+  };
+
+  // reads the records of `plugins`, in load order, in parallel through `cache`;
+  // plugins that can't be read take no part, returns null once `cancel` is set
+  //
+  static std::shared_ptr<const PluginConflictIndex>
+  build(const std::vector<Plugin>& plugins, PluginRecordCache& cache,
+        const std::atomic<bool>& cancel);
+
+  // null if the plugin couldn't be read
+  //
+  std::shared_ptr<const PluginRecordList> records(const QString& name) const;
+
+  // nothing if the plugin wasn't indexed
+  //
+  std::optional<Counts> counts(const QString& name) const;
+
+  // the plugins sharing at least one record with `name`, split by whether
+  // they load before or after it
+  //
+  void conflicts(const QString& name, QStringList& before, QStringList& after) const;
+
+  // estimated bytes taken by the index and the record lists, see MOBase::memory
+  //
+  std::size_t memoryUsage() const;
+
+private:
+  std::map<QString, std::shared_ptr<const PluginRecordList>,
+           MOBase::FileNameComparator>
+      m_records;
+
+  // of the enabled plugins only
+  std::vector<QString> m_names;
+  std::map<QString, int, MOBase::FileNameComparator> m_indices;
+  std::vector<Counts> m_counts;
+
+  // plugins of every record in more than one plugin, flattened; record `i`
+  // spans m_recordPlugins[m_recordOffsets[i]] until the next offset
+  std::vector<std::uint32_t> m_recordOffsets;
+  std::vector<std::uint16_t> m_recordPlugins;
+
+  // the shared records of every plugin
+  std::vector<std::vector<std::uint32_t>> m_pluginRecords;
+};
+
+#endif  // PLUGINRECORDINDEX_H
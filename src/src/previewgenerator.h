@@ -39,6 +39,9 @@ public:
 
   QWidget* genArchivePreview(const QByteArray& fileData, const QString& fileName) const;
 
+  // size previews are fit into
+  QSize maxSize() const { return m_MaxSize; }
+
 private:
   const PluginContainer& m_PluginContainer;
   QSize m_MaxSize;
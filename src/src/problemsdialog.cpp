@@ -20,7 +20,7 @@ ProblemsDialog::ProblemsDialog(const PluginContainer& pluginContainer, QWidget*
   ui->setupUi(this);
   ui->problemsWidget->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
 
-  runDiagnosis();
+  showProblems(m_PluginContainer.cachedProblems());
 
   connect(ui->problemsWidget, SIGNAL(itemSelectionChanged()), this,
           SLOT(selectionChanged()));
@@ -39,18 +39,13 @@ int ProblemsDialog::exec()
   return QDialog::exec();
 }
 
-void ProblemsDialog::runDiagnosis()
+void ProblemsDialog::showProblems(const PluginContainer::DiagnoseProblems& problems)
 {
   m_hasProblems = false;
   ui->problemsWidget->clear();
 
-  for (IPluginDiagnose* diagnose : m_PluginContainer.plugins<IPluginDiagnose>()) {
-    if (!m_PluginContainer.isEnabled(diagnose)) {
-      continue;
-    }
-
-    std::vector<unsigned int> activeProblems = diagnose->activeProblems();
-    foreach (unsigned int key, activeProblems) {
+  for (const auto& [diagnose, activeProblems] : problems) {
+    for (unsigned int key : activeProblems) {
       QTreeWidgetItem* newItem = new QTreeWidgetItem();
       newItem->setText(0, diagnose->shortDescription(key));
       newItem->setData(0, Qt::UserRole, diagnose->fullDescription(key));
@@ -109,7 +104,7 @@ void ProblemsDialog::startFix()
   IPluginDiagnose* plugin =
       reinterpret_cast<IPluginDiagnose*>(fixButton->property("fix").value<void*>());
   plugin->startGuidedFix(fixButton->property("key").toUInt());
-  runDiagnosis();
+  showProblems(m_PluginContainer.checkProblems());
 }
 
 void ProblemsDialog::urlClicked(const QUrl& url)
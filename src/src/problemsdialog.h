@@ -5,18 +5,20 @@
 #include <QUrl>
 #include <iplugindiagnose.h>
 
+#include "plugincontainer.h"
+
 namespace Ui
 {
 class ProblemsDialog;
 }
 
-class PluginContainer;
-
 class ProblemsDialog : public QDialog
 {
   Q_OBJECT
 
 public:
+  // shows the problems found by the last PluginContainer::checkProblems()
+  //
   explicit ProblemsDialog(PluginContainer const& pluginContainer, QWidget* parent = 0);
   ~ProblemsDialog();
 
@@ -27,7 +29,7 @@ public:
   bool hasProblems() const;
 
 private:
-  void runDiagnosis();
+  void showProblems(const PluginContainer::DiagnoseProblems& problems);
 
 private slots:
   void selectionChanged();
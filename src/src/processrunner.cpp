@@ -9,22 +9,21 @@
 #include <report.h>
 #include <uibase/utility.h>
 #ifndef _WIN32
+#include "pidwatcher.h"
 #include <QCoreApplication>
 #include <QEventLoop>
 #include <QFile>
 #include <QFileInfo>
-#include <QMetaObject>
-#include <QPointer>
 #include <QProcess>
-#include <QThread>
+#include <QTimer>
 #include <cerrno>
 #include <deque>
 #include <dirent.h>
 #include <fstream>
+#include <memory>
 #include <signal.h>
 #include <unordered_map>
 #include <unordered_set>
-#include <sys/wait.h>
 #endif
 
 using namespace MOBase;
@@ -640,19 +639,6 @@ pid_t findTrackedProcess(pid_t rootPid, const QStringList& expected,
   return best;
 }
 
-DWORD exitCodeFromWaitStatus(int status)
-{
-  if (WIFEXITED(status)) {
-    return static_cast<DWORD>(WEXITSTATUS(status));
-  }
-
-  if (WIFSIGNALED(status)) {
-    return static_cast<DWORD>(128 + WTERMSIG(status));
-  }
-
-  return 0;
-}
-
 ProcessRunner::Results waitForPid(pid_t pid, LPDWORD exitCode, UILocker::Session* ls,
                                   const QStringList& expected)
 {
@@ -660,119 +646,109 @@ ProcessRunner::Results waitForPid(pid_t pid, LPDWORD exitCode, UILocker::Session
     return ProcessRunner::Error;
   }
 
-  // startDetached() creates a non-child process, so waitpid() will fail with
-  // ECHILD. Detect this on the first call and switch to kill(pid, 0) polling
-  // which works for any process owned by the same user.
-  bool useKillPoll = false;
-  {
-    int status        = 0;
-    const pid_t probe = ::waitpid(pid, &status, WNOHANG);
-    if (probe == pid) {
-      // Already exited before we even started waiting
-      if (exitCode != nullptr) {
-        *exitCode = exitCodeFromWaitStatus(status);
-      }
-      log::debug("process {} completed immediately", pid);
-      return ProcessRunner::Completed;
-    }
-    if (probe < 0 && errno == ECHILD) {
-      // Not a child process (detached via startDetached), use kill(0) polling
-      useKillPoll = true;
-      log::debug("process {} is detached, using kill(0) polling", pid);
+  // the wait ends when the root process exits or, once it's been found, the
+  // executable that was started; launchers like proton or umu-run run it in a
+  // process of their own
+  PidWatcher root(pid);
+  std::unique_ptr<PidWatcher> tracked;
+
+  QEventLoop loop;
+  auto result = ProcessRunner::Running;
+  DWORD code  = 0;
+
+  const auto finish = [&](ProcessRunner::Results r) {
+    if (result == ProcessRunner::Running) {
+      result = r;
+      loop.quit();
     }
+  };
+
+  QObject::connect(&root, &PidWatcher::exited, &loop, [&](int rootCode) {
+    log::debug("process {} completed", pid);
+    code = static_cast<DWORD>(rootCode);
+    finish(ProcessRunner::Completed);
+  });
+
+  if (ls != nullptr) {
+    ls->setInfo(static_cast<DWORD>(pid), readProcComm(pid));
   }
 
-  bool seenTrackedProcess = false;
+  // descendants can't be watched without a cgroup of their own, so /proc is
+  // scanned until the tracked executable shows up and its pid is watched
+  // from then on
+  QTimer scan;
+  scan.setInterval(1000);
 
-  while (true) {
+  const auto findTracked = [&] {
     QString trackedName;
-    pid_t displayPid      = pid;
-    QString displayName   = readProcComm(pid);
-    const pid_t tracked   = findTrackedProcess(pid, expected, &trackedName);
-    if (tracked > 0) {
-      seenTrackedProcess = true;
-      displayPid         = tracked;
-      displayName        = trackedName;
-    } else if (seenTrackedProcess) {
-      if (exitCode != nullptr) {
-        *exitCode = 0;
-      }
-      log::debug("tracked child process for root {} exited", pid);
-      return ProcessRunner::Completed;
+    const pid_t found = findTrackedProcess(pid, expected, &trackedName);
+    if (found <= 0) {
+      return;
     }
 
+    scan.stop();
+
     if (ls != nullptr) {
-      ls->setInfo(static_cast<DWORD>(std::max<pid_t>(0, displayPid)), displayName);
+      ls->setInfo(static_cast<DWORD>(found), trackedName);
     }
 
-    if (useKillPoll) {
-      // Poll for process existence via kill(pid, 0)
-      if (::kill(pid, 0) != 0) {
-        if (errno == ESRCH) {
-          if (exitCode != nullptr) {
-            *exitCode = 0;
-          }
-          log::debug("process {} completed", pid);
-          return ProcessRunner::Completed;
-        }
-        // EPERM means the process exists but we can't signal it; keep waiting
-        if (errno != EPERM) {
-          log::error("failed checking process {}, errno={}", pid, errno);
-          return ProcessRunner::Error;
-        }
-      }
-    } else {
-      int status             = 0;
-      const pid_t waitResult = ::waitpid(pid, &status, WNOHANG);
+    tracked = std::make_unique<PidWatcher>(found);
+    QObject::connect(tracked.get(), &PidWatcher::exited, &loop, [&] {
+      log::debug("tracked child process for root {} exited", pid);
+      code = 0;
+      finish(ProcessRunner::Completed);
+    });
+  };
 
-      if (waitResult == pid) {
-        if (exitCode != nullptr) {
-          *exitCode = exitCodeFromWaitStatus(status);
-        }
-        log::debug("process {} completed", pid);
-        return ProcessRunner::Completed;
-      }
+  if (!expected.isEmpty()) {
+    QObject::connect(&scan, &QTimer::timeout, &loop, findTracked);
+    scan.start();
+    findTracked();
+  }
 
-      if (waitResult < 0) {
-        if (errno == EINTR) {
-          continue;
-        }
-        if (errno == ECHILD) {
-          // Process was reparented, switch to kill polling
-          useKillPoll = true;
-          continue;
-        }
-        log::error("failed waiting for {}, errno={}", pid, errno);
-        return ProcessRunner::Error;
-      }
-    }
+  // the lock widget only has a result to poll
+  QTimer lockCheck;
+  if (ls != nullptr) {
+    lockCheck.setInterval(100);
+    QObject::connect(&lockCheck, &QTimer::timeout, &loop, [&] {
+      const pid_t displayPid = (tracked ? tracked->pid() : pid);
 
-    if (ls != nullptr) {
       switch (ls->result()) {
       case UILocker::StillLocked:
         break;
 
       case UILocker::ForceUnlocked:
         log::debug("waiting for {} force unlocked by user", pid);
-        return ProcessRunner::ForceUnlocked;
+        finish(ProcessRunner::ForceUnlocked);
+        break;
 
       case UILocker::Cancelled:
         log::debug("waiting for {} cancelled by user, terminating", displayPid);
         if (::kill(displayPid, SIGTERM) != 0 && errno != ESRCH) {
           log::warn("failed to terminate {}, errno={}", displayPid, errno);
         }
-        return ProcessRunner::Cancelled;
+        finish(ProcessRunner::Cancelled);
+        break;
 
       case UILocker::NoResult:
       default:
         log::debug("unexpected lock result while waiting for {}", pid);
-        return ProcessRunner::Error;
+        finish(ProcessRunner::Error);
+        break;
       }
-    }
+    });
+    lockCheck.start();
+  }
+
+  if (result == ProcessRunner::Running) {
+    loop.exec();
+  }
 
-    QCoreApplication::processEvents(QEventLoop::AllEvents, 20);
-    QThread::msleep(50);
+  if (exitCode != nullptr && result == ProcessRunner::Completed) {
+    *exitCode = code;
   }
+
+  return result;
 }
 
 ProcessRunner::Results waitForProcess(HANDLE initialProcess, LPDWORD exitCode,
@@ -1262,39 +1238,14 @@ ProcessRunner::Results ProcessRunner::postRun()
       if (m_waitFlags.testFlag(TriggerRefresh)) {
         const pid_t pid = static_cast<pid_t>(reinterpret_cast<intptr_t>(m_handle.get()));
         const QFileInfo binary = m_sp.binary;
-        QPointer<OrganizerCore> core = &m_core;
-
-        std::thread([core, binary, pid]() {
-          int status = 0;
-          pid_t waited = -1;
-          do {
-            waited = ::waitpid(pid, &status, 0);
-          } while (waited == -1 && errno == EINTR);
-
-          DWORD exitCode = 0;
-          if (waited == pid) {
-            if (WIFEXITED(status)) {
-              exitCode = static_cast<DWORD>(WEXITSTATUS(status));
-            } else if (WIFSIGNALED(status)) {
-              exitCode = static_cast<DWORD>(128 + WTERMSIG(status));
-            }
-          } else {
-            MOBase::log::warn("process runner: waitpid failed for pid {}: {}", pid,
-                              errno);
-          }
-
-          if (!core) {
-            return;
-          }
-
-          QMetaObject::invokeMethod(
-              core, [core, binary, exitCode]() {
-                if (core) {
-                  core->afterRun(binary, exitCode);
-                }
-              },
-              Qt::QueuedConnection);
-        }).detach();
+
+        // owned by the core, nothing runs after it's gone
+        auto* watcher = new PidWatcher(pid, &m_core);
+        QObject::connect(watcher, &PidWatcher::exited, &m_core,
+                         [core = &m_core, binary, watcher](int exitCode) {
+                           watcher->deleteLater();
+                           core->afterRun(binary, static_cast<DWORD>(exitCode));
+                         });
 
         log::debug("process runner: scheduled async post-run refresh for pid {}", pid);
       }
@@ -1342,7 +1293,8 @@ ProcessRunner::Results ProcessRunner::postRun()
 
     m_core.afterRun(m_sp.binary, m_exitCode);
 
-    if (wait) {
+    // afterRun() may have patched the structure without a full refresh
+    if (wait && m_core.directoryUpdating()) {
       log::debug("process runner: waiting until refresh finishes");
       loop.exec();
       log::debug("process runner: refresh is done");
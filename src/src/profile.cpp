@@ -36,13 +36,18 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QApplication>
 #include <QBuffer>
+#include <QDateTime>
 #include <QDirIterator>
 #include <QFile>      // for QFile
+#include <QFileInfo>
 #include <QFlags>     // for operator|, QFlags
+#include <QHash>
 #include <QIODevice>  // for QIODevice, etc
 #include <QMessageBox>
 #include <QScopedArrayPointer>
+#include <QSet>
 #include <QStringList>  // for QStringList
+#include <QTextStream>
 #include <QtGlobal>     // for qUtf8Printable
 
 #ifdef _WIN32
@@ -57,6 +62,9 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <algorithm>  // for max, min
 #include <exception>  // for exception
 #include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <set>  // for set
 #include <stdexcept>
 #include <utility>  // for find
@@ -66,6 +74,144 @@ using namespace MOShared;
 
 // MOBase::resolveFileCaseInsensitive moved to MOBase::resolveFileCaseInsensitive
 
+namespace
+{
+
+// sections and keys of an ini file in the order they first appear; names are case
+// insensitive like they are for the games, the first spelling is kept
+struct IniFile
+{
+  struct Section
+  {
+    QString name;
+    std::vector<std::pair<QString, QString>> values;
+    QHash<QString, std::size_t> keys;
+  };
+
+  std::vector<Section> sections;
+  QHash<QString, std::size_t> index;
+
+  void set(const QString& section, const QString& key, const QString& value)
+  {
+    const QString sectionFolded = section.toCaseFolded();
+
+    auto s = index.constFind(sectionFolded);
+    if (s == index.constEnd()) {
+      s = index.insert(sectionFolded, sections.size());
+      sections.push_back({section, {}, {}});
+    }
+
+    Section& current        = sections[*s];
+    const QString keyFolded = key.toCaseFolded();
+
+    auto k = current.keys.constFind(keyFolded);
+    if (k == current.keys.constEnd()) {
+      current.keys.insert(keyFolded, current.values.size());
+      current.values.emplace_back(key, value);
+    } else {
+      current.values[*k].second = value;
+    }
+  }
+
+  void merge(const IniFile& other)
+  {
+    for (const auto& section : other.sections) {
+      for (const auto& [key, value] : section.values) {
+        set(section.name, key, value);
+      }
+    }
+  }
+
+  QByteArray toByteArray() const
+  {
+    QByteArray data;
+
+    for (const auto& section : sections) {
+      data += "[" + section.name.toUtf8() + "]\r\n";
+      for (const auto& [key, value] : section.values) {
+        data += key.toUtf8() + "=" + value.toUtf8() + "\r\n";
+      }
+      data += "\r\n";
+    }
+
+    return data;
+  }
+};
+
+// values are taken as they are, like the game reads them; QSettings would unescape
+// backslashes and drop the [General] section
+bool readIniFile(const QString& path, IniFile& ini)
+{
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    return false;
+  }
+
+  QTextStream in(&file);
+  QString section;
+
+  while (!in.atEnd()) {
+    const QString line = in.readLine().trimmed();
+
+    if (line.isEmpty() || line.startsWith(';') || line.startsWith('#')) {
+      continue;
+    }
+
+    if (line.startsWith('[') && line.endsWith(']')) {
+      section = line.mid(1, line.size() - 2).trimmed();
+      continue;
+    }
+
+    const auto eq = line.indexOf('=');
+    if (!section.isEmpty() && eq > 0) {
+      ini.set(section, line.left(eq).trimmed(), line.mid(eq + 1).trimmed());
+    }
+  }
+
+  return true;
+}
+
+struct CachedTweak
+{
+  QDateTime modified;
+  qint64 size = 0;
+  std::shared_ptr<const IniFile> ini;
+};
+
+std::mutex g_TweaksMutex;
+std::map<QString, CachedTweak> g_Tweaks;
+
+// the tweak file at `path`, parsed again only when it changed; null if it doesn't
+// exist
+std::shared_ptr<const IniFile> parsedTweak(const QString& path)
+{
+  const QFileInfo info(path);
+
+  std::scoped_lock lock(g_TweaksMutex);
+
+  if (!info.exists()) {
+    g_Tweaks.erase(path);
+    return {};
+  }
+
+  auto it = g_Tweaks.find(path);
+  if (it != g_Tweaks.end() && it->second.modified == info.lastModified() &&
+      it->second.size == info.size()) {
+    return it->second.ini;
+  }
+
+  auto ini = std::make_shared<IniFile>();
+  if (!readIniFile(path, *ini)) {
+    g_Tweaks.erase(path);
+    return {};
+  }
+
+  g_Tweaks.insert_or_assign(path, CachedTweak{info.lastModified(), info.size(), ini});
+  return ini;
+}
+
+}  // namespace
+
 void Profile::touchFile(QString fileName)
 {
   QFile modList(m_Directory.filePath(fileName));
@@ -251,10 +397,10 @@ void Profile::doWriteModlist()
 
   try {
     QString fileName = getModlistFileName();
-    SafeWriteFile file(fileName);
 
-    file->write(QString("# This file was automatically generated by Mod Organizer.\r\n")
-                    .toUtf8());
+    QByteArray contents =
+        QString("# This file was automatically generated by Mod Organizer.\r\n")
+            .toUtf8();
     if (m_ModStatus.empty()) {
       return;
     }
@@ -266,18 +412,19 @@ void Profile::doWriteModlist()
       ModInfo::Ptr modInfo = ModInfo::getByIndex(index);
       if (!modInfo->hasAutomaticPriority()) {
         if (modInfo->isForeign()) {
-          file->write("*");
+          contents += '*';
         } else if (m_ModStatus[index].m_Enabled) {
-          file->write("+");
+          contents += '+';
         } else {
-          file->write("-");
+          contents += '-';
         }
-        file->write(modInfo->name().toUtf8());
-        file->write("\r\n");
+        contents += modInfo->name().toUtf8();
+        contents += "\r\n";
       }
     }
 
-    file->commit();
+    // the list is written again after every refresh even if nothing changed
+    writeFileIfDifferent(fileName, contents);
   } catch (const std::exception& e) {
     reportError(tr("failed to write mod list: %1").arg(e.what()));
     return;
@@ -286,42 +433,46 @@ void Profile::doWriteModlist()
 
 void Profile::createTweakedIniFile()
 {
-  QString tweakedIni = m_Directory.absoluteFilePath("initweaks.ini");
-
-  if (QFile::exists(tweakedIni) && !shellDeleteQuiet(tweakedIni)) {
-    const auto e = GetLastError();
-    reportError(tr("failed to update tweaked ini file, wrong settings may be used: %1")
-                    .arg(QString::fromStdWString(formatSystemMessage(e))));
-    return;
-  }
+  const QString tweakedIni = m_Directory.absoluteFilePath("initweaks.ini");
 
+  std::vector<QString> tweaks;
   for (const auto& [priority, index] : m_ModIndexByPriority) {
     if (m_ModStatus[index].m_Enabled) {
       ModInfo::Ptr modInfo = ModInfo::getByIndex(index);
-      mergeTweaks(modInfo, tweakedIni);
+      const auto modTweaks = modInfo->getIniTweaks();
+      tweaks.insert(tweaks.end(), modTweaks.begin(), modTweaks.end());
     }
   }
+  tweaks.push_back(getProfileTweaks());
+
+  // the merged file only changes with the tweaks, their order or their contents
+  QString stamp;
+  for (const auto& tweak : tweaks) {
+    const QFileInfo info(tweak);
+    stamp += tweak + "|" +
+             (info.exists() ? QString::number(info.lastModified().toMSecsSinceEpoch()) +
+                                  "|" + QString::number(info.size())
+                            : QString("-")) +
+             "\n";
+  }
 
-  mergeTweak(getProfileTweaks(), tweakedIni);
-
-  bool error = false;
-#ifdef _WIN32
-  if (!MOBase::WriteRegistryValue(L"Archive", L"bInvalidateOlderFiles", L"1",
-                                  ToWString(tweakedIni).c_str())) {
-    error = true;
+  if (stamp == m_TweakedIniStamp && QFile::exists(tweakedIni)) {
+    return;
   }
-#else
-  if (!MOBase::WriteRegistryValue(
-          QStringLiteral("Archive"), QStringLiteral("bInvalidateOlderFiles"),
-          QStringLiteral("1"), tweakedIni)) {
-    error = true;
+
+  IniFile merged;
+  for (const auto& tweak : tweaks) {
+    if (auto ini = parsedTweak(tweak)) {
+      merged.merge(*ini);
+    }
   }
-#endif
+  merged.set("Archive", "bInvalidateOlderFiles", "1");
 
-  if (error) {
-    const auto e = ::GetLastError();
-    reportError(tr("failed to create tweaked ini: %1")
-                    .arg(QString::fromStdWString(formatSystemMessage(e))));
+  try {
+    writeFileIfDifferent(tweakedIni, merged.toByteArray());
+    m_TweakedIniStamp = stamp;
+  } catch (const std::exception& e) {
+    reportError(tr("failed to create tweaked ini: %1").arg(e.what()));
   }
 }
 
@@ -441,20 +592,32 @@ void Profile::refreshModStatus()
         tr("\"%1\" is missing or inaccessible").arg(getModlistFileName()));
   }
 
+  // read at once and split in place, the file has a line for every mod
+  const QByteArray modlist = file.readAll();
+  file.close();
+
   bool modStatusModified = false;
   m_ModStatus.clear();
   m_ModStatus.resize(ModInfo::getNumMods());
   log::debug("refreshModStatus: ModInfo has {} entries", ModInfo::getNumMods());
 
-  std::set<QString> namesRead;
+  QSet<QString> namesRead;
+  namesRead.reserve(static_cast<qsizetype>(ModInfo::getNumMods()));
 
   bool warnAboutOverwrite = false;
   unsigned int modsNotFound = 0;
 
   // load mods from file and update enabled state and priority for them
   int index = 0;
-  while (!file.atEnd()) {
-    QByteArray line = file.readLine().trimmed();
+  const QByteArrayView contents(modlist);
+  for (qsizetype start = 0; start < contents.size();) {
+    qsizetype end = contents.indexOf('\n', start);
+    if (end == -1) {
+      end = contents.size();
+    }
+
+    const QByteArrayView line = contents.sliced(start, end - start).trimmed();
+    start                     = end + 1;
 
     // find the mod name and the enabled status
     bool enabled = true;
@@ -467,11 +630,11 @@ void Profile::refreshModStatus()
       continue;
     } else if (line.at(0) == '-') {
       enabled = false;
-      modName = QString::fromUtf8(line.mid(1).trimmed().constData());
+      modName = QString::fromUtf8(line.sliced(1).trimmed());
     } else if (line.at(0) == '+' || line.at(0) == '*') {
-      modName = QString::fromUtf8(line.mid(1).trimmed().constData());
+      modName = QString::fromUtf8(line.sliced(1).trimmed());
     } else {
-      modName = QString::fromUtf8(line.trimmed().constData());
+      modName = QString::fromUtf8(line);
     }
 
     if (modName.isEmpty()) {
@@ -483,7 +646,7 @@ void Profile::refreshModStatus()
     }
 
     // check if the name was already read
-    if (namesRead.find(modName) != namesRead.end()) {
+    if (namesRead.contains(modName)) {
       continue;
     }
     namesRead.insert(modName);
@@ -516,9 +679,7 @@ void Profile::refreshModStatus()
       modStatusModified = true;
     }
 
-  }  // while (!file.atEnd())
-
-  file.close();
+  }  // for each line
 
   if (modsNotFound > 0) {
     log::error("refreshModStatus: {} mods from modlist.txt were not found in "
@@ -764,94 +925,6 @@ void Profile::copyFilesTo(QString& target) const
   copyDir(m_Directory.absolutePath(), target, false);
 }
 
-std::vector<std::wstring> Profile::splitDZString(const wchar_t* buffer) const
-{
-  std::vector<std::wstring> result;
-  const wchar_t* pos = buffer;
-  size_t length      = wcslen(pos);
-  while (length != 0U) {
-    result.push_back(pos);
-    pos += length + 1;
-    length = wcslen(pos);
-  }
-  return result;
-}
-
-void Profile::mergeTweak(const QString& tweakName, const QString& tweakedIni) const
-{
-#ifdef _WIN32
-  static const int bufferSize = 32768;
-
-  std::wstring tweakNameW  = ToWString(tweakName);
-  std::wstring tweakedIniW = ToWString(tweakedIni);
-  QScopedArrayPointer<wchar_t> buffer(new wchar_t[bufferSize]);
-
-  // retrieve a list of sections
-  DWORD size =
-      ::GetPrivateProfileSectionNamesW(buffer.data(), bufferSize, tweakNameW.c_str());
-
-  if (size == bufferSize - 2) {
-    // unfortunately there is no good way to find the required size
-    // of the buffer
-    throw MyException(QString("Buffer too small. Please report this as a bug. "
-                              "For now you might want to split up %1")
-                          .arg(tweakName));
-  }
-
-  std::vector<std::wstring> sections = splitDZString(buffer.data());
-
-  // now iterate over all sections and retrieve a list of keys in each
-  for (std::vector<std::wstring>::iterator iter = sections.begin();
-       iter != sections.end(); ++iter) {
-    // retrieve the names of all keys
-    size = ::GetPrivateProfileStringW(iter->c_str(), nullptr, nullptr, buffer.data(),
-                                      bufferSize, tweakNameW.c_str());
-    if (size == bufferSize - 2) {
-      throw MyException(QString("Buffer too small. Please report this as a bug. "
-                                "For now you might want to split up %1")
-                            .arg(tweakName));
-    }
-
-    std::vector<std::wstring> keys = splitDZString(buffer.data());
-
-    for (std::vector<std::wstring>::iterator keyIter = keys.begin();
-         keyIter != keys.end(); ++keyIter) {
-      // TODO this treats everything as strings but how could I differentiate the type?
-      ::GetPrivateProfileStringW(iter->c_str(), keyIter->c_str(), nullptr,
-                                 buffer.data(), bufferSize,
-                                 ToWString(tweakName).c_str());
-      MOBase::WriteRegistryValue(iter->c_str(), keyIter->c_str(), buffer.data(),
-                                 tweakedIniW.c_str());
-    }
-  }
-#else
-  // On Linux, use QSettings to read/merge INI tweaks
-  QSettings source(tweakName, QSettings::IniFormat);
-  QSettings dest(tweakedIni, QSettings::IniFormat);
-
-  for (const QString& group : source.childGroups()) {
-    source.beginGroup(group);
-    dest.beginGroup(group);
-
-    for (const QString& key : source.childKeys()) {
-      dest.setValue(key, source.value(key));
-    }
-
-    source.endGroup();
-    dest.endGroup();
-  }
-#endif
-}
-
-void Profile::mergeTweaks(ModInfo::Ptr modInfo, const QString& tweakedIni) const
-{
-  std::vector<QString> iniTweaks = modInfo->getIniTweaks();
-  for (std::vector<QString>::iterator iter = iniTweaks.begin(); iter != iniTweaks.end();
-       ++iter) {
-    mergeTweak(*iter, tweakedIni);
-  }
-}
-
 bool Profile::invalidationActive(bool* supported) const
 {
   auto invalidation = m_GameFeatures.gameFeature<BSAInvalidation>();
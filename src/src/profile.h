@@ -388,9 +388,6 @@ private:
 
   void copyFilesTo(QString& target) const;
 
-  std::vector<std::wstring> splitDZString(const wchar_t* buffer) const;
-  void mergeTweak(const QString& tweakName, const QString& tweakedIni) const;
-  void mergeTweaks(ModInfo::Ptr modInfo, const QString& tweakedIni) const;
   void touchFile(QString fileName);
 
   static void renameModInList(QFile& modList, const QString& oldName,
@@ -412,6 +409,9 @@ private:
   std::size_t m_NumRegularMods;
 
   MOBase::DelayedFileWriter m_ModListWriter;
+
+  // the tweak files initweaks.ini was last merged from with their timestamps
+  QString m_TweakedIniStamp;
 };
 
 #endif  // PROFILE_H
@@ -8,8 +8,12 @@
 #include <QProcess>
 #include <QProcessEnvironment>
 #include <QStandardPaths>
+#include <QtConcurrent/QtConcurrentRun>
 #include <log.h>
 
+#include <chrono>
+#include <mutex>
+
 namespace
 {
 QString compatDataPathFromPrefix(const QString& prefixPath)
@@ -52,6 +56,19 @@ QString detectSteamPath()
   return {};
 }
 
+QString detectDxvkConf()
+{
+  if (char* dxvkPath = nak_get_dxvk_conf_path(); dxvkPath != nullptr) {
+    const QString dxvkConf = QString::fromUtf8(dxvkPath);
+    nak_string_free(dxvkPath);
+    if (QFileInfo::exists(dxvkConf)) {
+      return dxvkConf;
+    }
+  }
+
+  return {};
+}
+
 bool startDetachedWithEnv(const QString& program, const QStringList& arguments,
                           const QString& workingDir,
                           const QProcessEnvironment& environment, qint64& pid)
@@ -175,8 +192,123 @@ bool parseEnvAssignment(const QString& token, QString& keyOut, QString& valueOut
   valueOut = token.mid(eq + 1);
   return true;
 }
+
+// the parts of a launch that don't depend on the executable, looked up ahead
+// by ProtonLauncher::prewarm()
+struct PreparedLaunch
+{
+  QString steamPath;
+  QString dxvkConf;
+  bool steamRunning = false;
+  std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now();
+};
+
+// Steam may have been closed since, older results are looked up again
+constexpr std::chrono::seconds PreparedLaunchLifetime(60);
+
+std::mutex g_preparedMutex;
+QFuture<PreparedLaunch> g_prepared;
+
+// waits for the last prewarm() and returns its result if it's still recent,
+// looks things up now otherwise; whether Steam runs is left to the caller
+//
+PreparedLaunch preparedLaunch()
+{
+  QFuture<PreparedLaunch> future;
+  {
+    std::scoped_lock lock(g_preparedMutex);
+    future = g_prepared;
+  }
+
+  future.waitForFinished();
+  if (future.resultCount() > 0) {
+    PreparedLaunch prepared = future.result();
+    if (std::chrono::steady_clock::now() - prepared.time < PreparedLaunchLifetime) {
+      return prepared;
+    }
+  }
+
+  PreparedLaunch prepared;
+  prepared.steamPath = detectSteamPath();
+  prepared.dxvkConf  = detectDxvkConf();
+  return prepared;
+}
+
+// the wineserver Proton starts for the prefix, it's left running for a minute
+// so the launch connects to it instead of waiting for a new one
+//
+void startWineserver(const QString& protonPath, const QString& prefixPath,
+                     bool useSteamRun)
+{
+  const QString compatDataPath = compatDataPathFromPrefix(prefixPath);
+  if (compatDataPath.isEmpty()) {
+    return;
+  }
+
+  // proton always runs the game in the pfx directory of the compat data
+  const QString pfx = QDir(compatDataPath).filePath("pfx");
+  if (!QFileInfo::exists(QDir(pfx).filePath("drive_c"))) {
+    // a new prefix, proton creates it first
+    return;
+  }
+
+  const QDir protonDir(QFileInfo(protonPath).isDir() ? protonPath
+                                                     : QFileInfo(protonPath).path());
+
+  QString program;
+  for (const char* candidate : {"files/bin/wineserver", "dist/bin/wineserver"}) {
+    const QString path = protonDir.filePath(QString::fromLatin1(candidate));
+    if (QFileInfo(path).isExecutable()) {
+      program = path;
+      break;
+    }
+  }
+
+  if (program.isEmpty()) {
+    return;
+  }
+
+  QStringList arguments = {QStringLiteral("-p60")};
+  maybeWrapWithSteamRun(useSteamRun, program, arguments);
+
+  QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+  env.remove("PYTHONHOME");
+  env.insert("WINEPREFIX", pfx);
+
+  maybeWrapForFlatpak(program, arguments, env);
+
+  qint64 pid = -1;
+  if (!startDetachedWithEnv(program, arguments, {}, env, pid)) {
+    MOBase::log::debug("failed to start wineserver '{}' ahead of the launch",
+                       program);
+  }
+}
 }  // namespace
 
+void ProtonLauncher::prewarm(const QString& protonPath, const QString& prefixPath,
+                             bool useUmu, bool useSteamRun)
+{
+  std::scoped_lock lock(g_preparedMutex);
+  if (g_prepared.isRunning()) {
+    return;
+  }
+
+  g_prepared = QtConcurrent::run([=] {
+    PreparedLaunch prepared;
+    prepared.steamRunning = ensureSteamRunning();
+    prepared.steamPath    = detectSteamPath();
+    prepared.dxvkConf     = detectDxvkConf();
+
+    // umu-run sets up its container before anything runs in the prefix
+    if (!useUmu && !protonPath.isEmpty()) {
+      startWineserver(protonPath, prefixPath, useSteamRun);
+    }
+
+    prepared.time = std::chrono::steady_clock::now();
+    return prepared;
+  });
+}
+
 ProtonLauncher::ProtonLauncher()
     : m_steamAppId(0), m_useUmu(false), m_preferSystemUmu(false),
       m_useSteamRun(false)
@@ -291,7 +423,10 @@ bool ProtonLauncher::launchWithProton(qint64& pid) const
     return false;
   }
 
-  ensureSteamRunning();
+  const PreparedLaunch prepared = preparedLaunch();
+  if (!prepared.steamRunning) {
+    ensureSteamRunning();
+  }
 
   QString protonScript = m_protonPath;
   if (QFileInfo(protonScript).isDir()) {
@@ -318,7 +453,7 @@ bool ProtonLauncher::launchWithProton(qint64& pid) const
     env.insert("STEAM_COMPAT_DATA_PATH", compatDataPath);
   }
 
-  const QString steamPath = detectSteamPath();
+  const QString& steamPath = prepared.steamPath;
   if (!steamPath.isEmpty()) {
     env.insert("STEAM_COMPAT_CLIENT_INSTALL_PATH", steamPath);
   }
@@ -341,12 +476,8 @@ bool ProtonLauncher::launchWithProton(qint64& pid) const
   }
 
   // Set DXVK config if available
-  if (char* dxvkPath = nak_get_dxvk_conf_path(); dxvkPath != nullptr) {
-    const QString dxvkConf = QString::fromUtf8(dxvkPath);
-    nak_string_free(dxvkPath);
-    if (QFileInfo::exists(dxvkConf)) {
-      env.insert("DXVK_CONFIG_FILE", dxvkConf);
-    }
+  if (const QString& dxvkConf = prepared.dxvkConf; !dxvkConf.isEmpty()) {
+    env.insert("DXVK_CONFIG_FILE", dxvkConf);
   }
 
   maybeWrapForFlatpak(program, arguments, env);
@@ -363,7 +494,10 @@ bool ProtonLauncher::launchWithUmu(qint64& pid) const
 
   // Steam must be running for games with Steamworks DRM (Application Load
   // Error 5:0000065434 occurs otherwise).
-  ensureSteamRunning();
+  const PreparedLaunch prepared = preparedLaunch();
+  if (!prepared.steamRunning) {
+    ensureSteamRunning();
+  }
 
   // Resolve umu-run according to user preference (bundled vs system).
   // In Flatpak, umu-run must run on the host (it needs Steam Runtime).
@@ -445,7 +579,7 @@ bool ProtonLauncher::launchWithUmu(qint64& pid) const
   // umu-run sets STEAM_COMPAT_DATA_PATH internally from WINEPREFIX, so we
   // do NOT set it here.  However, the game's Steamworks DRM still needs
   // STEAM_COMPAT_CLIENT_INSTALL_PATH to locate the Steam client libraries.
-  const QString steamPath = detectSteamPath();
+  const QString& steamPath = prepared.steamPath;
   if (!steamPath.isEmpty()) {
     env.insert("STEAM_COMPAT_CLIENT_INSTALL_PATH", steamPath);
   }
@@ -477,12 +611,8 @@ bool ProtonLauncher::launchWithUmu(qint64& pid) const
   }
 
   // Set DXVK config if available
-  if (char* dxvkPath = nak_get_dxvk_conf_path(); dxvkPath != nullptr) {
-    const QString dxvkConf = QString::fromUtf8(dxvkPath);
-    nak_string_free(dxvkPath);
-    if (QFileInfo::exists(dxvkConf)) {
-      env.insert("DXVK_CONFIG_FILE", dxvkConf);
-    }
+  if (const QString& dxvkConf = prepared.dxvkConf; !dxvkConf.isEmpty()) {
+    env.insert("DXVK_CONFIG_FILE", dxvkConf);
   }
 
   maybeWrapForFlatpak(program, arguments, env);
@@ -27,6 +27,12 @@ public:
   // Launch dispatch: UMU -> Proton -> Direct
   std::pair<bool, qint64> launch() const;
 
+  // checks that Steam runs and looks up its paths on a worker thread, and
+  // starts the wineserver of the prefix for a Proton launch; the next launch()
+  // waits for it and uses the results instead of doing the same work again
+  static void prewarm(const QString& protonPath, const QString& prefixPath,
+                      bool useUmu, bool useSteamRun);
+
 private:
   bool launchWithProton(qint64& pid) const;
   bool launchWithUmu(qint64& pid) const;
@@ -1,14 +1,44 @@
 #include "qdirfiletree.h"
 
-#include <QDirIterator>
+#include <QSet>
+
+#include <filesystem>
+#include <mutex>
+#include <system_error>
 
 using namespace MOBase;
+namespace fs = std::filesystem;
+
+namespace
+{
+
+// names shared by all the entries of a tree; mods repeat the same names in
+// many directories (installer options, texture sets, ...) and every copy would
+// be its own allocation otherwise
+//
+class NamePool
+{
+public:
+  QString intern(QString name)
+  {
+    std::scoped_lock lock(m_mutex);
+    return *m_names.insert(std::move(name));
+  }
+
+private:
+  std::mutex m_mutex;
+  QSet<QString> m_names;
+};
+
+}  // namespace
 
 class QDirFileTreeImpl : public QDirFileTree
 {
 public:
-  QDirFileTreeImpl(std::shared_ptr<const IFileTree> parent, QDir dir)
-      : FileTreeEntry(parent, dir.dirName()), QDirFileTree(), qDir(dir)
+  QDirFileTreeImpl(std::shared_ptr<const IFileTree> parent, QString name, QString path,
+                   std::shared_ptr<NamePool> names, bool ignoreMeta)
+      : FileTreeEntry(parent, std::move(name)), QDirFileTree(), m_Path(std::move(path)),
+        m_Names(std::move(names)), m_IgnoreMeta(ignoreMeta)
   {}
 
 protected:
@@ -39,66 +69,58 @@ protected:
     return nullptr;
   }
 
+  // reads the directory in one pass without a QFileInfo per entry; the type
+  // of an entry usually comes with the listing, so only links are stat()'ed
+  //
   bool doPopulate(std::shared_ptr<const IFileTree> parent,
                   std::vector<std::shared_ptr<FileTreeEntry>>& entries) const override
   {
-    auto infoList = qDir.entryInfoList(qDir.filter() | QDir::NoDotAndDotDot,
-                                       QDir::Name | QDir::DirsFirst | QDir::IgnoreCase);
-    for (auto& info : infoList) {
-      if (info.isDir()) {
-        entries.push_back(
-            std::make_shared<QDirFileTreeImpl>(parent, QDir(info.absoluteFilePath())));
-      } else {
-        entries.push_back(createFileEntry(parent, info.fileName()));
-      }
-    }
+    std::error_code ec;
+    fs::directory_iterator itor(fs::path(m_Path.toStdU16String()),
+                                fs::directory_options::skip_permission_denied, ec);
 
-    // Vector is already sorted:
-    return true;
-  }
+    for (; !ec && itor != fs::directory_iterator(); itor.increment(ec)) {
+      QString name = QString::fromStdU16String(itor->path().filename().u16string());
 
-  std::shared_ptr<IFileTree> doClone() const override
-  {
-    return std::make_shared<QDirFileTreeImpl>(nullptr, qDir);
-  }
-
-protected:
-  QDir qDir;
-};
-
-// subclass of QDirFileTreeImpl that ignores meta.ini
-//
-// only used for the root folder, subdirectories are actually QDirFileTreeImpl
-class QDirRootFileTreeImpl : public QDirFileTreeImpl
-{
-public:
-  QDirRootFileTreeImpl(QDir dir)
-      : FileTreeEntry(nullptr, dir.dirName()), QDirFileTreeImpl(nullptr, dir)
-  {}
+#ifndef _WIN32
+      // QDir skips hidden files by default
+      if (name.startsWith(u'.')) {
+        continue;
+      }
+#endif
 
-protected:
-  bool doPopulate(std::shared_ptr<const IFileTree> parent,
-                  std::vector<std::shared_ptr<FileTreeEntry>>& entries) const override
-  {
-    auto infoList = qDir.entryInfoList(qDir.filter() | QDir::NoDotAndDotDot,
-                                       QDir::Name | QDir::DirsFirst | QDir::IgnoreCase);
-    for (auto& info : infoList) {
-      if (info.isDir()) {
-        entries.push_back(
-            std::make_shared<QDirFileTreeImpl>(parent, QDir(info.absoluteFilePath())));
-      } else if (info.fileName().compare("meta.ini", Qt::CaseInsensitive) != 0) {
-        entries.push_back(createFileEntry(parent, info.fileName()));
+      std::error_code typeEc;
+      if (itor->is_directory(typeEc)) {
+        QString path = m_Path + u'/' + name;
+        entries.push_back(std::make_shared<QDirFileTreeImpl>(
+            parent, m_Names->intern(std::move(name)), std::move(path), m_Names,
+            false));
+      } else if (itor->is_regular_file(typeEc)) {
+        // like QDir, broken links and special files are skipped
+        if (m_IgnoreMeta && name.compare("meta.ini", Qt::CaseInsensitive) == 0) {
+          continue;
+        }
+        entries.push_back(createFileEntry(parent, m_Names->intern(std::move(name))));
       }
     }
 
-    // Vector is already sorted:
-    return true;
+    // the order of the listing is unspecified
+    return false;
   }
 
   std::shared_ptr<IFileTree> doClone() const override
   {
-    return std::make_shared<QDirRootFileTreeImpl>(qDir);
+    return std::make_shared<QDirFileTreeImpl>(nullptr, name(), m_Path, m_Names,
+                                              m_IgnoreMeta);
   }
+
+private:
+  // absolute path of the directory, the nodes don't keep a QDir around
+  QString m_Path;
+  std::shared_ptr<NamePool> m_Names;
+
+  // only for the root, the meta.ini in there belongs to MO
+  bool m_IgnoreMeta;
 };
 
 /**
@@ -107,9 +129,7 @@ protected:
 std::shared_ptr<const QDirFileTree> QDirFileTree::makeTree(QDir directory,
                                                            bool ignoreRootMeta)
 {
-  if (ignoreRootMeta) {
-    return std::make_shared<QDirRootFileTreeImpl>(directory);
-  } else {
-    return std::make_shared<QDirFileTreeImpl>(nullptr, directory);
-  }
+  return std::make_shared<QDirFileTreeImpl>(
+      nullptr, directory.dirName(), directory.absolutePath(),
+      std::make_shared<NamePool>(), ignoreRootMeta);
 }
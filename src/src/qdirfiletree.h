@@ -29,7 +29,8 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
  * `MOBase::IFileTree`.
  *
  * The tree is lazily populated: each subtree is only populated (from the disk) when
- * needed, as specified by IFileTree.
+ * needed, as specified by IFileTree. Directories only keep their path until then,
+ * and the names of all entries are shared within a tree.
  *
  * This class does not expose mutable operations, so any mutable operations will
  * fail.
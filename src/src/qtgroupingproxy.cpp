@@ -153,17 +153,25 @@ void QtGroupingProxy::buildTree()
   beginResetModel();
 
   m_groupMap.clear();
+  m_sourceRows.clear();
   // don't clear the data maps since most of it will probably be needed again.
   m_parentCreateList.clear();
+  m_parentCreateIndex.clear();
 
   int max = sourceModel()->rowCount(m_rootNode);
+  m_sourceRows.resize(max);
 
-  // WARNING: these have to be added in order because the addToGroups function is
-  // optimized for modelRowsInserted(). Failure to do so will result in wrong data shown
-  // in the view at best.
+  // rows are added in order, so they're appended to the groups and nothing has to
+  // be shifted like in modelRowsInserted()
   for (int row = 0; row < max; row++) {
-    QModelIndex idx = sourceModel()->index(row, m_groupedColumn, m_rootNode);
-    addSourceRow(idx);
+    QModelIndex idx   = sourceModel()->index(row, m_groupedColumn, m_rootNode);
+    SourceRow& source = m_sourceRows[row];
+    source.value      = sourceModel()->data(idx, m_groupedRole);
+    source.groups     = resolveGroups(idx, false);
+
+    for (quint32 key : source.groups) {
+      m_groupMap[key].append(row);
+    }
   }
   // dumpGroups();
 
@@ -172,29 +180,39 @@ void QtGroupingProxy::buildTree()
 
     int currentKey     = 0;
     quint32 quint32max = std::numeric_limits<quint32>::max();
-    std::vector<int> rmgroups;
 
     QMap<quint32, QList<int>> temp;
+    QList<RowData> keptGroups;
 
     for (auto iter = m_groupMap.begin(); iter != m_groupMap.end(); ++iter) {
       if ((iter.key() == quint32max) || (iter->count() < 2)) {
         temp[quint32max].append(iter.value());
-        if (iter.key() != quint32max) {
-          rmgroups.push_back(iter.key());
-        }
       } else {
+        keptGroups << m_groupMaps[iter.key()];
         temp[currentKey++] = *iter;
       }
     }
-    m_groupMap = temp;
 
-    // second loop is necessary because qt containers can't be iterated from end to
-    // front and removing by index from begin to end is ugly
-    std::sort(rmgroups.begin(), rmgroups.end(), [](int lhs, int rhs) {
-      return rhs < lhs;
-    });
-    for (auto iter = rmgroups.begin(); iter != rmgroups.end(); ++iter) {
-      m_groupMaps.removeAt(*iter);
+    // the groups keep their order, keys are their index in m_groupMaps again
+    m_groupMap  = temp;
+    m_groupMaps = keptGroups;
+
+    if (m_groupMap.contains(quint32max)) {
+      QList<int>& ungrouped = m_groupMap[quint32max];
+      std::sort(ungrouped.begin(), ungrouped.end());
+      ungrouped.erase(std::unique(ungrouped.begin(), ungrouped.end()),
+                      ungrouped.end());
+    }
+
+    rebuildGroupIndex();
+
+    for (auto& source : m_sourceRows) {
+      source.groups.clear();
+    }
+    for (auto iter = m_groupMap.constBegin(); iter != m_groupMap.constEnd(); ++iter) {
+      for (int row : iter.value()) {
+        m_sourceRows[row].groups << iter.key();
+      }
     }
   }
 
@@ -203,68 +221,156 @@ void QtGroupingProxy::buildTree()
 
 QList<int> QtGroupingProxy::addSourceRow(const QModelIndex& idx)
 {
+  const int row = idx.row();
+
+  shiftSourceRows(row, 1);
+
+  SourceRow source;
+  source.value  = sourceModel()->data(idx, m_groupedRole);
+  source.groups = resolveGroups(idx, false);
+  m_sourceRows.insert(m_sourceRows.begin() + row, source);
+
   QList<int> updatedGroups;
+  for (quint32 key : source.groups) {
+    QList<int>& groupList = m_groupMap[key];
+    groupList.insert(std::lower_bound(groupList.begin(), groupList.end(), row), row);
+    updatedGroups << static_cast<int>(key);
+  }
+
+  return updatedGroups;
+}
+
+QList<quint32> QtGroupingProxy::resolveGroups(const QModelIndex& idx, bool notify)
+{
+  QList<quint32> keys;
   QList<RowData> groupData = belongsTo(idx);
 
   // an empty list here means it's supposed to go in root.
   if (groupData.isEmpty()) {
-    updatedGroups << -1;
-    if (!m_groupMap.keys().contains(std::numeric_limits<quint32>::max()))
-      m_groupMap.insert(std::numeric_limits<quint32>::max(),
-                        QList<int>());  // add an empty placeholder
+    keys << std::numeric_limits<quint32>::max();
   }
 
   // an item can be in multiple groups
-  foreach (RowData data, groupData) {
-    int updatedGroup = -1;
+  for (const RowData& data : groupData) {
+    quint32 key = std::numeric_limits<quint32>::max();
     if (!data.isEmpty()) {
-      foreach (const RowData& cachedData, m_groupMaps) {
-        // when this matches the index belongs to an existing group
-        if (data[0][Qt::DisplayRole] == cachedData[0][Qt::DisplayRole]) {
-          data = cachedData;
-          break;
-        }
-      }
-
-      updatedGroup = m_groupMaps.indexOf(data);
+      int group = findGroup(data);
       //-1 means not found
-      if (updatedGroup == -1) {
-        // new groups are added to the end of the existing list
+      if (group == -1) {
+        // new groups are added to the end of the existing list, above the
+        // non-grouped items
+        group = m_groupMaps.count();
+        if (notify) {
+          beginInsertRows(QModelIndex(), group, group);
+        }
         m_groupMaps << data;
-        updatedGroup = m_groupMaps.count() - 1;
+        m_groupIndex.insert(data.value(0).value(Qt::DisplayRole).toString(), group);
+        if (notify) {
+          endInsertRows();
+        }
       }
+      key = static_cast<quint32>(group);
+    }
 
-      if (!m_groupMap.keys().contains(updatedGroup))
-        m_groupMap.insert(updatedGroup, QList<int>());  // add an empty placeholder
+    if (!keys.contains(key))
+      keys << key;
+  }
+
+  std::sort(keys.begin(), keys.end());
+  return keys;
+}
+
+int QtGroupingProxy::findGroup(const RowData& data) const
+{
+  // when the names match the index belongs to an existing group, the first one
+  const QVariant name = data.value(0).value(Qt::DisplayRole);
+  int found           = -1;
+
+  for (auto iter = m_groupIndex.constFind(name.toString());
+       iter != m_groupIndex.constEnd() && iter.key() == name.toString(); ++iter) {
+    if ((found == -1 || iter.value() < found) &&
+        m_groupMaps[iter.value()].value(0).value(Qt::DisplayRole) == name) {
+      found = iter.value();
     }
+  }
 
-    if (!updatedGroups.contains(updatedGroup))
-      updatedGroups << updatedGroup;
+  return found;
+}
+
+void QtGroupingProxy::rebuildGroupIndex()
+{
+  m_groupIndex.clear();
+  for (int i = 0; i < m_groupMaps.count(); ++i) {
+    m_groupIndex.insert(m_groupMaps[i].value(0).value(Qt::DisplayRole).toString(), i);
   }
+}
 
-  // update m_groupMap to the new source-model layout (one row added)
-  QMutableMapIterator<quint32, QList<int>> i(m_groupMap);
-  while (i.hasNext()) {
-    i.next();
-    QList<int>& groupList = i.value();
-    int insertedProxyRow  = groupList.count();
-    for (; insertedProxyRow > 0; insertedProxyRow--) {
-      int& rowValue = groupList[insertedProxyRow - 1];
-      if (idx.row() <= rowValue) {
-        // increment the rows that come after the new row since they moved one place up.
-        rowValue++;
-      } else {
-        break;
-      }
+void QtGroupingProxy::insertIntoGroups(int sourceRow)
+{
+  for (quint32 key : m_sourceRows[sourceRow].groups) {
+    QList<int>& groupList = m_groupMap[key];
+    const int indexInGroup =
+        std::lower_bound(groupList.cbegin(), groupList.cend(), sourceRow) -
+        groupList.cbegin();
+    const int row = proxyRow(key, indexInGroup);
+
+    beginInsertRows(groupParent(key), row, row);
+    groupList.insert(indexInGroup, sourceRow);
+    endInsertRows();
+  }
+}
+
+void QtGroupingProxy::removeFromGroups(int sourceRow)
+{
+  for (quint32 key : m_sourceRows[sourceRow].groups) {
+    auto iter = m_groupMap.find(key);
+    if (iter == m_groupMap.end()) {
+      continue;
     }
 
-    if (updatedGroups.contains(i.key())) {
-      // the row needs to be added to this group
-      groupList.insert(insertedProxyRow, idx.row());
+    QList<int>& groupList = iter.value();
+    const auto pos = std::lower_bound(groupList.cbegin(), groupList.cend(), sourceRow);
+    if (pos == groupList.cend() || *pos != sourceRow) {
+      continue;
     }
+
+    const int indexInGroup = pos - groupList.cbegin();
+    const int row          = proxyRow(key, indexInGroup);
+
+    beginRemoveRows(groupParent(key), row, row);
+    groupList.removeAt(indexInGroup);
+    endRemoveRows();
   }
+}
 
-  return updatedGroups;
+void QtGroupingProxy::shiftSourceRows(int from, int delta)
+{
+  // the lists are sorted, only their ends have to be looked at
+  for (auto iter = m_groupMap.begin(); iter != m_groupMap.end(); ++iter) {
+    QList<int>& groupList = iter.value();
+    for (int i = groupList.count() - 1; i >= 0 && groupList.at(i) >= from; --i) {
+      groupList[i] += delta;
+    }
+  }
+}
+
+QModelIndex QtGroupingProxy::groupParent(quint32 key) const
+{
+  if (key == std::numeric_limits<quint32>::max()) {
+    return QModelIndex();
+  }
+
+  return index(static_cast<int>(key), 0, QModelIndex());
+}
+
+int QtGroupingProxy::proxyRow(quint32 key, int indexInGroup) const
+{
+  // if the proxy item is not in a group it will be below the groups.
+  if (key == std::numeric_limits<quint32>::max()) {
+    return m_groupMaps.count() + indexInGroup;
+  }
+
+  return indexInGroup;
 }
 
 /** Each ModelIndex has in it's internalId a position in the parentCreateList.
@@ -277,16 +383,20 @@ int QtGroupingProxy::indexOfParentCreate(const QModelIndex& parent) const
   if (!parent.isValid())
     return -1;
 
-  struct ParentCreate pc;
-  for (int i = 0; i < m_parentCreateList.size(); i++) {
-    pc = m_parentCreateList[i];
-    if (pc.parentCreateIndex == parent.internalId() && pc.row == parent.row())
-      return i;
-  }
+  const quint64 key = (static_cast<quint64>(static_cast<quint32>(parent.internalId()))
+                       << 32) |
+                      static_cast<quint32>(parent.row());
+
+  auto iter = m_parentCreateIndex.constFind(key);
+  if (iter != m_parentCreateIndex.constEnd())
+    return iter.value();
+
   // there is no parentCreate yet for this index, so let's create one.
+  struct ParentCreate pc;
   pc.parentCreateIndex = parent.internalId();
   pc.row               = parent.row();
   m_parentCreateList << pc;
+  m_parentCreateIndex.insert(key, m_parentCreateList.size() - 1);
 
   return m_parentCreateList.size() - 1;
 }
@@ -535,6 +645,7 @@ bool QtGroupingProxy::setData(const QModelIndex& idx, const QVariant& value, int
 
     // and make sure it's stored in the map
     m_groupMaps[idx.row()].insert(idx.column(), columnData);
+    rebuildGroupIndex();
 
     int columnToChange = idx.column() ? idx.column() : m_groupedColumn;
     foreach (int originalRow, m_groupMap.value(idx.row())) {
@@ -614,29 +725,24 @@ QModelIndex QtGroupingProxy::mapFromSource(const QModelIndex& idx) const
     // idx is a child of one of the items in the source model
     proxyParent = mapFromSource(sourceParent);
   } else {
-    // idx is an item in the top level of the source model (child of the rootnode)
-    int groupRow = -1;
-    QMapIterator<quint32, QList<int>> iterator(m_groupMap);
-    while (iterator.hasNext()) {
-      iterator.next();
-      if (iterator.value().contains(sourceRow)) {
-        groupRow = iterator.key();
-        break;
-      }
-    }
+    // idx is an item in the top level of the source model (child of the rootnode),
+    // it's shown in the first of its groups, non-grouped items come last
+    if (sourceRow < 0 || sourceRow >= static_cast<int>(m_sourceRows.size()) ||
+        m_sourceRows[sourceRow].groups.isEmpty())
+      return QModelIndex();
 
-    if (groupRow != -1)  // it's in a group, let's find the correct row.
-    {
-      proxyParent = this->index(groupRow, 0, QModelIndex());
-      proxyRow    = m_groupMap.value(groupRow).indexOf(sourceRow);
-    } else {
-      proxyParent = QModelIndex();
-      // if the proxy item is not in a group it will be below the groups.
-      int groupLength = m_groupMaps.count();
-      int i = m_groupMap.value(std::numeric_limits<quint32>::max()).indexOf(sourceRow);
+    const quint32 key = m_sourceRows[sourceRow].groups.first();
+    auto iter         = m_groupMap.constFind(key);
+    if (iter == m_groupMap.constEnd())
+      return QModelIndex();
 
-      proxyRow = groupLength + i;
-    }
+    const QList<int>& groupList = iter.value();
+    const auto pos = std::lower_bound(groupList.cbegin(), groupList.cend(), sourceRow);
+    if (pos == groupList.cend() || *pos != sourceRow)
+      return QModelIndex();
+
+    proxyParent = groupParent(key);
+    proxyRow    = this->proxyRow(key, pos - groupList.cbegin());
   }
 
   return this->index(proxyRow, idx.column(), proxyParent);
@@ -744,6 +850,7 @@ QModelIndex QtGroupingProxy::addEmptyGroup(const RowData& data)
   int newRow = m_groupMaps.count();
   beginInsertRows(QModelIndex(), newRow, newRow);
   m_groupMaps << data;
+  m_groupIndex.insert(data.value(0).value(Qt::DisplayRole).toString(), newRow);
   endInsertRows();
   return index(newRow, 0, QModelIndex());
 }
@@ -754,6 +861,16 @@ bool QtGroupingProxy::removeGroup(const QModelIndex& idx)
   m_groupMap.remove(idx.row());
   m_groupMaps.removeAt(idx.row());
   m_parentCreateList.removeAt(idx.internalId());
+  rebuildGroupIndex();
+
+  m_parentCreateIndex.clear();
+  for (int i = 0; i < m_parentCreateList.size(); ++i) {
+    const ParentCreate& pc = m_parentCreateList[i];
+    m_parentCreateIndex.insert(
+        (static_cast<quint64>(static_cast<quint32>(pc.parentCreateIndex)) << 32) |
+            static_cast<quint32>(pc.row),
+        i);
+  }
   endRemoveRows();
 
   // TODO: only true if all data could be unset.
@@ -807,9 +924,24 @@ void QtGroupingProxy::modelRowsAboutToBeInserted(const QModelIndex& parent, int
 void QtGroupingProxy::modelRowsInserted(const QModelIndex& parent, int start, int end)
 {
   if (parent == m_rootNode) {
-    // top level of the model changed, these new rows need to be put in groups
+    if (m_flags & FLAG_NOSINGLE) {
+      // a new row can turn a single item into a group
+      buildTree();
+      return;
+    }
+
+    // top level of the model changed, these new rows need to be put in groups;
+    // the rows after them only move down in the source model
+    const int count = end - start + 1;
+    shiftSourceRows(start, count);
+    m_sourceRows.insert(m_sourceRows.begin() + start, count, SourceRow());
+
     for (int modelRow = start; modelRow <= end; modelRow++) {
-      addSourceRow(sourceModel()->index(modelRow, m_groupedColumn, m_rootNode));
+      QModelIndex idx   = sourceModel()->index(modelRow, m_groupedColumn, m_rootNode);
+      SourceRow& source = m_sourceRows[modelRow];
+      source.value      = sourceModel()->data(idx, m_groupedRole);
+      source.groups     = resolveGroups(idx, true);
+      insertIntoGroups(modelRow);
     }
   } else {
     // an item was added to an original index, remap and pass it on
@@ -829,23 +961,16 @@ void QtGroupingProxy::modelRowsAboutToBeRemoved(const QModelIndex& parent, int s
                                                 int end)
 {
   if (parent == m_rootNode) {
-    QMap<quint32, QList<int>>::const_iterator i;
-    // HACK, we are going to call beginRemoveRows() multiple times without
-    // endRemoveRows() if a source index is in multiple groups.
-    // This can be a problem for some views/proxies, but Q*Views can handle it.
-    // TODO: investigate a queue for applying proxy model changes in the correct order
-    for (i = m_groupMap.constBegin(); i != m_groupMap.constEnd(); ++i) {
-      int groupIndex              = i.key();
-      const QList<int>& groupList = i.value();
-      QModelIndex proxyParent     = index(groupIndex, 0);
-      foreach (int originalRow, groupList) {
-        if (originalRow >= start && originalRow <= end) {
-          int proxyRow = groupList.indexOf(originalRow);
-          if (groupIndex == -1)  // adjust for non-grouped (root level) original items
-            proxyRow += m_groupMaps.count();
-          // TODO: optimize for continues original rows in the same group
-          beginRemoveRows(proxyParent, proxyRow, proxyRow);
-        }
+    if (m_flags & FLAG_NOSINGLE) {
+      // rebuilt once they're gone
+      return;
+    }
+
+    // the rows are taken out of their groups while the source still has them, the
+    // rows after them are only renumbered in modelRowsRemoved()
+    for (int modelRow = end; modelRow >= start; modelRow--) {
+      if (modelRow < static_cast<int>(m_sourceRows.size())) {
+        removeFromGroups(modelRow);
       }
     }
   } else {
@@ -858,37 +983,18 @@ void QtGroupingProxy::modelRowsAboutToBeRemoved(const QModelIndex& parent, int s
 void QtGroupingProxy::modelRowsRemoved(const QModelIndex& parent, int start, int end)
 {
   if (parent == m_rootNode) {
-    // TODO: can be optimised by iterating over m_groupMap and checking start <= r < end
-
-    // rather than increasing i we change the stored sourceRows in-place and reuse
-    // argument start X-times (where X = end - start).
-    for (int i = start; i <= end; i++) {
-      // HACK: we are going to iterate the hash in reverse so calls to endRemoveRows()
-      // are matched up with the beginRemoveRows() in modelRowsAboutToBeRemoved()
-      // NOTE: easier to do reverse with java style iterator
-      QMutableMapIterator<quint32, QList<int>> iter(m_groupMap);
-      iter.toBack();
-      while (iter.hasPrevious()) {
-        iter.previous();
-        int groupIndex = iter.key();
-        // has to be a modifiable reference for remove and replace operations
-        QList<int>& groupList = iter.value();
-        int rowIndex          = groupList.indexOf(start);
-        if (rowIndex != -1) {
-          QModelIndex proxyParent = index(groupIndex, 0);
-          groupList.removeAt(rowIndex);
-        }
-        // Now decrement all source rows that are after the removed row
-        for (int j = 0; j < groupList.count(); j++) {
-          int sourceRow = groupList.at(j);
-          if (sourceRow > start)
-            groupList.replace(j, sourceRow - 1);
-        }
-        if (rowIndex != -1)
-          endRemoveRows();  // end remove operation only after group was updated.
-      }
+    if (m_flags & FLAG_NOSINGLE) {
+      buildTree();
+      return;
     }
 
+    const int count = end - start + 1;
+    const int last  = std::min(end + 1, static_cast<int>(m_sourceRows.size()));
+    if (start < last) {
+      m_sourceRows.erase(m_sourceRows.begin() + start, m_sourceRows.begin() + last);
+    }
+    shiftSourceRows(end + 1, -count);
+
     return;
   }
 
@@ -904,17 +1010,82 @@ void QtGroupingProxy::resetModel()
 void QtGroupingProxy::modelDataChanged(const QModelIndex& topLeft,
                                        const QModelIndex& bottomRight)
 {
-  // TODO: need to look in the groupedColumn and see if it changed and changed grouping
-  // accordingly
+  QModelIndex sourceParent = topLeft.parent();
+
+  // rows whose grouped value changed move to their new groups, the others stay
+  // where they are
+  if (!(sourceParent.isValid() && (sourceParent != m_rootNode)) &&
+      topLeft.column() <= m_groupedColumn && m_groupedColumn <= bottomRight.column()) {
+    const int last =
+        std::min(bottomRight.row(), static_cast<int>(m_sourceRows.size()) - 1);
+
+    for (int row = topLeft.row(); row <= last; ++row) {
+      QModelIndex idx = sourceModel()->index(row, m_groupedColumn, m_rootNode);
+      QVariant value  = sourceModel()->data(idx, m_groupedRole);
+      if (value == m_sourceRows[row].value) {
+        continue;
+      }
+
+      if (m_flags & FLAG_NOSINGLE) {
+        // groups may appear or be flattened, the reset updates all the rows
+        buildTree();
+        return;
+      }
+
+      m_sourceRows[row].value     = value;
+      const QList<quint32> groups = resolveGroups(idx, true);
+      if (groups == m_sourceRows[row].groups) {
+        continue;
+      }
+
+      removeFromGroups(row);
+      m_sourceRows[row].groups = groups;
+      insertIntoGroups(row);
+    }
+  }
+
   QModelIndex proxyTopLeft = mapFromSource(topLeft);
   if (!proxyTopLeft.isValid())
     return;
 
-  if (topLeft == bottomRight) {
-    emit dataChanged(proxyTopLeft, proxyTopLeft);
-  } else {
+  if (topLeft == bottomRight ||
+      (sourceParent.isValid() && (sourceParent != m_rootNode))) {
     QModelIndex proxyBottomRight = mapFromSource(bottomRight);
     emit dataChanged(proxyTopLeft, proxyBottomRight);
+    return;
+  }
+
+  // the rows can be spread over several groups but both ends of dataChanged()
+  // must have the same parent, so emit it once per group with the first and
+  // last row of the range in it
+  for (auto iter = m_groupMap.constBegin(); iter != m_groupMap.constEnd(); ++iter) {
+    int first = -1;
+    int last  = -1;
+    for (int i = 0; i < iter.value().count(); ++i) {
+      const int sourceRow = iter.value().at(i);
+      if (sourceRow >= topLeft.row() && sourceRow <= bottomRight.row()) {
+        if (first == -1) {
+          first = i;
+        }
+        last = i;
+      }
+    }
+
+    if (first == -1) {
+      continue;
+    }
+
+    QModelIndex proxyParent;
+    int offset = 0;
+    if (iter.key() == std::numeric_limits<quint32>::max()) {
+      // ungrouped items are below the groups
+      offset = m_groupMaps.count();
+    } else {
+      proxyParent = this->index(iter.key(), 0, QModelIndex());
+    }
+
+    emit dataChanged(this->index(offset + first, topLeft.column(), proxyParent),
+                     this->index(offset + last, bottomRight.column(), proxyParent));
   }
 }
 
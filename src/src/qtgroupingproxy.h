@@ -26,6 +26,8 @@
 #include <QSet>
 #include <QStringList>
 
+#include <vector>
+
 typedef QMap<int, QVariant> ItemData;
 typedef QMap<int, ItemData> RowData;
 
@@ -107,6 +109,30 @@ protected:
    */
   QList<int> addSourceRow(const QModelIndex& idx);
 
+  /** Keys in m_groupMap of the groups the index belongs to, sorted, creating the
+   * groups that don't exist yet; with `notify`, the new groups are announced as
+   * inserted rows.
+   */
+  QList<quint32> resolveGroups(const QModelIndex& idx, bool notify);
+
+  /** @returns the index in m_groupMaps of the group with the same name as `data`,
+   * -1 if there is none
+   */
+  int findGroup(const RowData& data) const;
+  void rebuildGroupIndex();
+
+  /** Adds or removes the source row to or from the groups in m_sourceRows, the
+   * views are told about every row.
+   */
+  void insertIntoGroups(int sourceRow);
+  void removeFromGroups(int sourceRow);
+
+  /** Adds `delta` to every source row in m_groupMap that's at least `from`. */
+  void shiftSourceRows(int from, int delta);
+
+  QModelIndex groupParent(quint32 key) const;
+  int proxyRow(quint32 key, int indexInGroup) const;
+
   bool isGroup(const QModelIndex& index) const;
   bool isAGroupSelected(const QModelIndexList& list) const;
 
@@ -121,6 +147,20 @@ protected:
    */
   QList<RowData> m_groupMaps;
 
+  /** Indices in m_groupMaps by the display text of the group. */
+  QMultiHash<QString, int> m_groupIndex;
+
+  /** What every row of the source model was grouped by and the keys in m_groupMap it
+   * was put in, by source row; the lists in m_groupMap are sorted, so a row is found
+   * in its groups without searching all of them.
+   */
+  struct SourceRow
+  {
+    QVariant value;
+    QList<quint32> groups;
+  };
+  std::vector<SourceRow> m_sourceRows;
+
   /** "instuctions" how to create an item in the tree.
    * This is used by parent( QModelIndex )
    */
@@ -130,6 +170,9 @@ protected:
     int row;
   };
   mutable QList<struct ParentCreate> m_parentCreateList;
+
+  /** Positions in m_parentCreateList by parent internal id and row. */
+  mutable QHash<quint64, int> m_parentCreateIndex;
   /** @returns index of the "instructions" to recreate the parent. Will create new if it
    * doesn't exist yet.
    */
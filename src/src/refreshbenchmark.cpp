@@ -0,0 +1,239 @@
+#include "refreshbenchmark.h"
+#include "directoryrefresher.h"
+#include "shared/directoryentry.h"
+#include "shared/fileregister.h"
+#include "vfs/layercache.h"
+
+#include <log.h>
+
+#include <QDir>
+#include <QFile>
+#include <QSet>
+#include <QTemporaryDir>
+
+#include <chrono>
+#include <map>
+#include <memory>
+
+using namespace MOBase;
+using namespace MOShared;
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+// files of every origin in the listing, in the order origins first appear
+struct Listing
+{
+  std::vector<QString> origins;
+  std::map<QString, std::vector<QString>> files;
+  std::size_t count = 0;
+};
+
+// lines are "Data\path\to\file\t(origin)", with the separators of the system
+// that wrote them
+bool readListing(const QString& path, Listing& listing, QString& error)
+{
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    error = QObject::tr("failed to open %1: %2").arg(path, file.errorString());
+    return false;
+  }
+
+  while (!file.atEnd()) {
+    const QString line = QString::fromUtf8(file.readLine()).trimmed();
+    const auto tab     = line.lastIndexOf('\t');
+    if (tab < 0) {
+      continue;
+    }
+
+    QString relative = line.left(tab);
+    relative.replace('\\', '/');
+    if (relative.startsWith("data/", Qt::CaseInsensitive)) {
+      relative.remove(0, 5);
+    }
+
+    QString origin = line.mid(tab + 1);
+    if (origin.startsWith('(') && origin.endsWith(')')) {
+      origin = origin.mid(1, origin.size() - 2);
+    }
+
+    if (relative.isEmpty() || origin.isEmpty()) {
+      continue;
+    }
+
+    auto [it, added] = listing.files.try_emplace(origin);
+    if (added) {
+      listing.origins.push_back(origin);
+    }
+    it->second.push_back(relative);
+    ++listing.count;
+  }
+
+  if (listing.count == 0) {
+    error = QObject::tr("%1 doesn't list any files").arg(path);
+    return false;
+  }
+
+  return true;
+}
+
+// recreates every origin as a mod of empty files below `root`, files that
+// already exist are left alone
+bool createMods(const Listing& listing, const QString& root,
+                std::vector<DirectoryRefresher::EntryInfo>& mods, QString& error)
+{
+  QSet<QString> directories;
+
+  for (const auto& origin : listing.origins) {
+    QString name = origin;
+    name.replace('/', '_').replace('\\', '_');
+    const QString modPath = root + "/mods/" + name;
+
+    for (const auto& relative : listing.files.at(origin)) {
+      const QString path = modPath + "/" + relative;
+      const QString dir  = path.left(path.lastIndexOf('/'));
+
+      if (!directories.contains(dir)) {
+        if (!QDir().mkpath(dir)) {
+          error = QObject::tr("failed to create %1").arg(dir);
+          return false;
+        }
+        directories.insert(dir);
+      }
+
+      QFile file(path);
+      if (!file.exists() && !file.open(QIODevice::WriteOnly)) {
+        error = QObject::tr("failed to create %1: %2").arg(path, file.errorString());
+        return false;
+      }
+    }
+
+    mods.emplace_back(origin, modPath, QStringList(), QStringList(),
+                      static_cast<int>(mods.size()));
+  }
+
+  return true;
+}
+
+// resident memory of the process in KiB, `field` is VmRSS or VmHWM; 0 if the
+// system doesn't have /proc
+qint64 memoryKiB(const char* field)
+{
+  QFile status("/proc/self/status");
+  if (!status.open(QIODevice::ReadOnly)) {
+    return 0;
+  }
+
+  const QByteArray prefix = QByteArray(field) + ":";
+  while (!status.atEnd()) {
+    const QByteArray line = status.readLine();
+    if (line.startsWith(prefix)) {
+      return line.mid(prefix.size()).trimmed().split(' ').front().toLongLong();
+    }
+  }
+
+  return 0;
+}
+
+// makes VmHWM start over from the current usage
+void resetPeakMemory()
+{
+  QFile refs("/proc/self/clear_refs");
+  if (refs.open(QIODevice::WriteOnly)) {
+    refs.write("5");
+  }
+}
+
+double ms(std::chrono::nanoseconds d)
+{
+  return static_cast<double>(d.count()) / 1000.0 / 1000.0;
+}
+
+}  // namespace
+
+bool runRefreshBenchmark(OrganizerCore& core, const RefreshBenchmarkOptions& options,
+                         QTextStream& out, QString& error)
+{
+  Listing listing;
+  if (!readListing(options.dump, listing, error)) {
+    return false;
+  }
+
+  std::unique_ptr<QTemporaryDir> temp;
+  QString root = options.target;
+  if (root.isEmpty()) {
+    temp = std::make_unique<QTemporaryDir>(QDir::tempPath() + "/mo2-refresh-XXXXXX");
+    temp->setAutoRemove(!options.keep);
+    if (!temp->isValid()) {
+      error = QObject::tr("failed to create a temporary directory: %1")
+                  .arg(temp->errorString());
+      return false;
+    }
+    root = temp->path();
+  }
+
+  out << "replaying " << listing.count << " files of " << listing.origins.size()
+      << " origins in " << root << "\n";
+  out.flush();
+
+  const auto created = Clock::now();
+  std::vector<DirectoryRefresher::EntryInfo> mods;
+  if (!createMods(listing, root, mods, error)) {
+    return false;
+  }
+  out << "created the mods in " << QString::number(ms(Clock::now() - created), 'f', 1)
+      << " ms\n\n";
+
+  // walk, merge and queued are summed over all the mods; merges are
+  // sequential and queued is the time mods waited for a thread of the pool
+  out << "threads\trun\ttotal ms\twalk ms\tmerge ms\tqueued ms\tfiles\tpeak KiB\t"
+         "rss KiB\n";
+
+  const QString cachePath = root + "/layers.cache";
+
+  for (const auto threads : options.threads) {
+    QFile::remove(cachePath);
+    const auto cache = std::make_shared<VfsLayerCache>(cachePath.toStdString());
+
+    for (int run = 0; run <= options.runs; ++run) {
+      DirectoryRefresher refresher(&core, threads);
+      refresher.setLayerCache(cache);
+
+      auto structure = std::make_unique<DirectoryEntry>(L"data", nullptr, 0);
+      RefreshReport report;
+
+      resetPeakMemory();
+      const auto started = Clock::now();
+
+      refresher.addMultipleModsFilesToStructure(structure.get(), mods, nullptr,
+                                                &report);
+      structure->getFileRegister()->sortOrigins();
+
+      const auto total = Clock::now() - started;
+
+      RefreshReport::Duration walk{}, merge{}, queued{};
+      for (const auto& m : report.mods) {
+        walk += m.walk;
+        merge += m.merge;
+        queued += m.queued;
+      }
+
+      out << threads << "\t" << (run == 0 ? QString("cold") : QString::number(run))
+          << "\t" << QString::number(ms(total), 'f', 1) << "\t"
+          << QString::number(ms(walk), 'f', 1) << "\t"
+          << QString::number(ms(merge), 'f', 1) << "\t"
+          << QString::number(ms(queued), 'f', 1) << "\t"
+          << structure->getFileRegister()->highestCount() << "\t"
+          << memoryKiB("VmHWM") << "\t" << memoryKiB("VmRSS") << "\n";
+      out.flush();
+    }
+  }
+
+  if (temp != nullptr && options.keep) {
+    log::info("refresh benchmark: the mods were kept in '{}'", root);
+  }
+
+  return true;
+}
@@ -0,0 +1,46 @@
+#ifndef REFRESHBENCHMARK_H
+#define REFRESHBENCHMARK_H
+
+#include <QString>
+#include <QTextStream>
+
+#include <vector>
+
+class OrganizerCore;
+
+// Replays the file listing of an instance through the directory refresher, so
+// refresh times can be compared across machines and changes without sharing
+// the mods themselves.
+//
+// The listing is the one written by DirectoryEntry::dump(), "Write To File" in
+// the data tab: every file of the data directory along with the origin it's
+// taken from.  Each origin is recreated as a mod of empty files below the
+// target directory, a tmpfs keeps the disk out of it.  Since the listing only
+// has the winning origin of every file, the recreated mods don't conflict.
+//
+// Every thread count starts with a cold scan cache followed by warm runs, which
+// only validate the cached listings like a refresh after startup does.
+//
+struct RefreshBenchmarkOptions
+{
+  // the listing to replay
+  QString dump;
+
+  // where the mods are recreated and left for the next run, a temporary
+  // directory if empty which is removed afterwards unless `keep` is set
+  QString target;
+  bool keep = false;
+
+  std::vector<std::size_t> threads = {1, 2, 4, 8};
+
+  // warm runs per thread count
+  int runs = 3;
+};
+
+// runs the benchmark and writes a table of the results to `out`; returns false
+// with `error` set if the listing can't be replayed
+//
+bool runRefreshBenchmark(OrganizerCore& core, const RefreshBenchmarkOptions& options,
+                         QTextStream& out, QString& error);
+
+#endif  // REFRESHBENCHMARK_H
@@ -1,58 +1,82 @@
 #include "savestab.h"
 #include "activatemodsdialog.h"
 #include "organizercore.h"
-#include "ui_mainwindow.h"
-#include <iplugingame.h>
-#include <isavegameinfowidget.h>
-#include <localsavegames.h>
-#include <new>
-#include <report.h>
-
-using namespace MOBase;
-
-namespace
-{
-bool g_disableSaveTooltipsAfterOOM = false;
-
-QString sanitizeText(QString in, int maxLen = 200)
-{
-  for (int i = 0; i < in.size(); ++i) {
-    const QChar c = in.at(i);
-    // Replace control chars except common whitespace.
-    if (c.unicode() < 0x20 && c != QChar('\n') && c != QChar('\r') && c != QChar('\t')) {
-      in[i] = QChar('?');
-    }
-  }
-
-  if (in.size() > maxLen) {
-    in.truncate(maxLen);
-    in += "...";
-  }
-
-  return in;
-}
-
-bool isLikelyCorruptSaveText(QString const& in)
-{
-  if (in.trimmed().isEmpty()) {
-    return true;
-  }
-
-  int suspicious = 0;
-  for (const QChar c : in) {
-    if (c.unicode() == 0xFFFD || c.isNull() ||
-        (!c.isPrint() && !c.isSpace())) {
-      ++suspicious;
-    }
-  }
-
-  return suspicious > (in.size() / 8);
-}
-}  // namespace
-
-SavesTab::SavesTab(QWidget* window, OrganizerCore& core, Ui::MainWindow* mwui)
+#include "pluginlist.h"
+#include "ui_mainwindow.h"
+#include <iplugingame.h>
+#include <isavegameinfowidget.h>
+#include <localsavegames.h>
+#include <new>
+#include <report.h>
+
+#include <QTimeZone>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <unordered_set>
+
+using namespace MOBase;
+
+namespace
+{
+bool g_disableSaveTooltipsAfterOOM = false;
+
+QString sanitizeText(QString in, int maxLen = 200)
+{
+  for (int i = 0; i < in.size(); ++i) {
+    const QChar c = in.at(i);
+    // Replace control chars except common whitespace.
+    if (c.unicode() < 0x20 && c != QChar('\n') && c != QChar('\r') && c != QChar('\t')) {
+      in[i] = QChar('?');
+    }
+  }
+
+  if (in.size() > maxLen) {
+    in.truncate(maxLen);
+    in += "...";
+  }
+
+  return in;
+}
+
+bool isLikelyCorruptSaveText(QString const& in)
+{
+  if (in.trimmed().isEmpty()) {
+    return true;
+  }
+
+  int suspicious = 0;
+  for (const QChar c : in) {
+    if (c.unicode() == 0xFFFD || c.isNull() ||
+        (!c.isPrint() && !c.isSpace())) {
+      ++suspicious;
+    }
+  }
+
+  return suspicious > (in.size() / 8);
+}
+
+qint64 writeTime(const QFileInfo& info)
+{
+  return info.lastModified(QTimeZone::UTC).toMSecsSinceEpoch();
+}
+
+QTreeWidgetItem* createSaveItem(const ISaveGame& save, const QDir& savesDir)
+{
+  auto relpath       = savesDir.relativeFilePath(save.getFilepath());
+  const auto rawName = save.getName();
+  auto display       = sanitizeText(rawName, 300);
+  if (display.trimmed().isEmpty() || isLikelyCorruptSaveText(rawName)) {
+    display = sanitizeText(QFileInfo(save.getFilepath()).completeBaseName(), 300);
+  }
+  return new QTreeWidgetItem({display, relpath});
+}
+}  // namespace
+
+SavesTab::SavesTab(QWidget* window, OrganizerCore& core, Ui::MainWindow* mwui)
     : m_window(window), m_core(core), m_CurrentSaveView(nullptr),
-      ui{mwui->tabWidget, mwui->savesTab, mwui->savegameList}
+      ui{mwui->tabWidget, mwui->savesTab, mwui->savegameList},
+      m_SavesRefreshPending(false)
 {
   m_SavesWatcherTimer.setSingleShot(true);
   m_SavesWatcherTimer.setInterval(500);
@@ -68,6 +92,18 @@ SavesTab::SavesTab(QWidget* window, OrganizerCore& core, Ui::MainWindow* mwui)
     refreshSavesIfOpen();
   });
 
+  connect(&m_SavesListing, &QFutureWatcherBase::finished, [&] {
+    onSavesListed();
+  });
+
+  connect(&m_PluginsListing, &QFutureWatcherBase::finished, [&] {
+    onRequiredPluginsListed();
+  });
+
+  connect(core.pluginList(), &PluginList::esplist_changed, this, [&] {
+    flagMissingPlugins();
+  });
+
   connect(ui.list, &QWidget::customContextMenuRequested, [&](auto pos) {
     onContextMenu(pos);
   });
@@ -77,6 +113,14 @@ SavesTab::SavesTab(QWidget* window, OrganizerCore& core, Ui::MainWindow* mwui)
   });
 }
 
+SavesTab::~SavesTab()
+{
+  // the workers use the game plugin
+  m_PluginsListing.cancel();
+  m_SavesListing.waitForFinished();
+  m_PluginsListing.waitForFinished();
+}
+
 bool SavesTab::eventFilter(QObject* object, QEvent* e)
 {
   if (object == ui.list) {
@@ -93,13 +137,13 @@ bool SavesTab::eventFilter(QObject* object, QEvent* e)
   return false;
 }
 
-void SavesTab::displaySaveGameInfo(QTreeWidgetItem* newItem)
-{
-  if (g_disableSaveTooltipsAfterOOM) {
-    return;
-  }
-
-  // don't display the widget if the main window doesn't have focus
+void SavesTab::displaySaveGameInfo(QTreeWidgetItem* newItem)
+{
+  if (g_disableSaveTooltipsAfterOOM) {
+    return;
+  }
+
+  // don't display the widget if the main window doesn't have focus
   //
   // this goes against the standard behaviour for tooltips, which are displayed
   // on hover regardless of focus, but this widget is so large and busy that
@@ -108,33 +152,33 @@ void SavesTab::displaySaveGameInfo(QTreeWidgetItem* newItem)
     return;
   }
 
-  if (m_CurrentSaveView == nullptr) {
-    auto info = m_core.gameFeatures().gameFeature<SaveGameInfo>();
+  if (m_CurrentSaveView == nullptr) {
+    auto info = m_core.gameFeatures().gameFeature<SaveGameInfo>();
 
     if (info != nullptr) {
       m_CurrentSaveView = info->getSaveGameWidget(m_window);
     }
 
-    if (m_CurrentSaveView == nullptr) {
-      return;
-    }
-  }
-
-  try {
-    m_CurrentSaveView->setSave(*m_SaveGames[ui.list->indexOfTopLevelItem(newItem)]);
-  } catch (const std::bad_alloc&) {
-    g_disableSaveTooltipsAfterOOM = true;
-    log::error("insufficient memory while rendering save tooltip for '{}'",
-               sanitizeText(newItem ? newItem->text(0) : QString()));
-    reportError(QObject::tr("Save tooltip rendering was disabled for this session due "
-                            "to low memory while parsing save metadata."));
-    hideSaveGameInfo();
-    return;
-  } catch (const std::exception& e) {
-    log::error("failed to render save tooltip: {}", e.what());
-    hideSaveGameInfo();
-    return;
-  }
+    if (m_CurrentSaveView == nullptr) {
+      return;
+    }
+  }
+
+  try {
+    m_CurrentSaveView->setSave(*m_SaveGames[ui.list->indexOfTopLevelItem(newItem)]);
+  } catch (const std::bad_alloc&) {
+    g_disableSaveTooltipsAfterOOM = true;
+    log::error("insufficient memory while rendering save tooltip for '{}'",
+               sanitizeText(newItem ? newItem->text(0) : QString()));
+    reportError(QObject::tr("Save tooltip rendering was disabled for this session due "
+                            "to low memory while parsing save metadata."));
+    hideSaveGameInfo();
+    return;
+  } catch (const std::exception& e) {
+    log::error("failed to render save tooltip: {}", e.what());
+    hideSaveGameInfo();
+    return;
+  }
 
   QWindow* window = m_CurrentSaveView->window()->windowHandle();
   QRect screenRect;
@@ -245,32 +289,249 @@ void SavesTab::stopMonitorSaves()
 
 void SavesTab::refreshSaveList()
 {
-  TimeThis tt("MainWindow::refreshSaveList()");
+  // MainWindow lists them again when the tab is shown, nothing is watched or
+  // parsed until then
+  if (ui.mainTabs->currentWidget() != ui.tab) {
+    stopMonitorSaves();
+    return;
+  }
 
   startMonitorSaves();  // re-starts monitoring
 
+  if (m_SavesListing.isRunning()) {
+    // the directory may have changed after the worker read it
+    m_SavesRefreshPending = true;
+    return;
+  }
+
+  const QDir savesDir = currentSavesDir();
+  MOBase::log::debug("reading save games from {}", savesDir.absolutePath());
+
+  QStringList previousStamp;
+  if (savesDir.absolutePath() == m_SavesDirectory) {
+    previousStamp = m_SavesStamp;
+  }
+
+  m_SavesListing.setFuture(QtConcurrent::run(&SavesTab::listSaves, m_core.managedGame(),
+                                             savesDir, previousStamp));
+}
+
+SavesTab::SaveListing SavesTab::listSaves(const IPluginGame* game, QDir savesDir,
+                                          QStringList previousStamp)
+{
+  TimeThis tt("SavesTab::listSaves()");
+
+  SaveListing listing;
+  listing.directory = savesDir.absolutePath();
+
+  // saves may be directories or come with extra files, so everything counts
+  const auto entries = savesDir.entryInfoList(
+      QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden, QDir::Name);
+
+  for (const auto& info : entries) {
+    listing.stamp.append(
+        QString("%1|%2|%3").arg(info.fileName()).arg(info.size()).arg(writeTime(info)));
+  }
+
+  if (!previousStamp.isEmpty() && listing.stamp == previousStamp) {
+    listing.unchanged = true;
+    return listing;
+  }
+
   try {
-    QDir savesDir = currentSavesDir();
-    MOBase::log::debug("reading save games from {}", savesDir.absolutePath());
-    m_SaveGames = m_core.managedGame()->listSaves(savesDir);
-    std::sort(m_SaveGames.begin(), m_SaveGames.end(),
-              [](auto const& lhs, auto const& rhs) {
-                return lhs->getCreationTime() > rhs->getCreationTime();
-              });
-
-    ui.list->clear();
-    for (auto& save : m_SaveGames) {
-      auto relpath = savesDir.relativeFilePath(save->getFilepath());
-      const auto rawName = save->getName();
-      auto display       = sanitizeText(rawName, 300);
-      if (display.trimmed().isEmpty() || isLikelyCorruptSaveText(rawName)) {
-        display = sanitizeText(QFileInfo(save->getFilepath()).completeBaseName(), 300);
-      }
-      ui.list->addTopLevelItem(new QTreeWidgetItem(ui.list, {display, relpath}));
-    }
-  } catch (std::exception& e) {
+    for (auto& save : game->listSaves(savesDir)) {
+      const QFileInfo info(save->getFilepath());
+      listing.saves.push_back({info.size(), writeTime(info), std::move(save)});
+    }
+  } catch (std::exception& e) {
     // listSaves() can throw
-    log::error("{}", e.what());
+    listing.error = e.what();
+  }
+
+  return listing;
+}
+
+void SavesTab::onSavesListed()
+{
+  SaveListing listing = m_SavesListing.result();
+
+  if (!listing.error.isEmpty()) {
+    log::error("{}", listing.error);
+  } else if (!listing.unchanged) {
+    std::map<QString, ListedSave> cache;
+    std::vector<std::shared_ptr<const ISaveGame>> saves;
+
+    for (auto& listed : listing.saves) {
+      const QString path = listed.save->getFilepath();
+
+      auto itor = m_SaveCache.find(path);
+      if (itor != m_SaveCache.end() && itor->second.size == listed.size &&
+          itor->second.writeTime == listed.writeTime) {
+        listed.save = itor->second.save;
+      }
+
+      saves.push_back(listed.save);
+      cache.insert_or_assign(path, std::move(listed));
+    }
+
+    m_SaveCache      = std::move(cache);
+    m_SavesDirectory = listing.directory;
+    m_SavesStamp     = std::move(listing.stamp);
+
+    updateSaveList(std::move(saves), QDir(listing.directory));
+  }
+
+  if (m_SavesRefreshPending) {
+    m_SavesRefreshPending = false;
+    refreshSaveList();
+  }
+}
+
+void SavesTab::updateSaveList(std::vector<std::shared_ptr<const ISaveGame>> saves,
+                              const QDir& savesDir)
+{
+  TimeThis tt("SavesTab::updateSaveList()");
+
+  std::sort(saves.begin(), saves.end(), [](auto const& lhs, auto const& rhs) {
+    return lhs->getCreationTime() > rhs->getCreationTime();
+  });
+
+  // items of saves that are still there are kept along with their selection,
+  // m_SaveGames stays in the order of the items
+  std::unordered_set<const ISaveGame*> listed;
+  for (const auto& save : saves) {
+    listed.insert(save.get());
+  }
+
+  for (int i = static_cast<int>(m_SaveGames.size()) - 1; i >= 0; --i) {
+    if (!listed.contains(m_SaveGames[i].get())) {
+      delete ui.list->takeTopLevelItem(i);
+      m_SaveGames.erase(m_SaveGames.begin() + i);
+    }
+  }
+
+  for (std::size_t i = 0; i < saves.size(); ++i) {
+    if (i < m_SaveGames.size() && m_SaveGames[i] == saves[i]) {
+      continue;
+    }
+
+    QTreeWidgetItem* item = nullptr;
+
+    auto itor = std::find(m_SaveGames.begin() + i, m_SaveGames.end(), saves[i]);
+    if (itor != m_SaveGames.end()) {
+      item = ui.list->takeTopLevelItem(static_cast<int>(itor - m_SaveGames.begin()));
+      m_SaveGames.erase(itor);
+    } else {
+      item = createSaveItem(*saves[i], savesDir);
+    }
+
+    ui.list->insertTopLevelItem(static_cast<int>(i), item);
+    m_SaveGames.insert(m_SaveGames.begin() + i, saves[i]);
+  }
+
+  std::erase_if(m_RequiredPlugins, [&](auto&& entry) {
+    return !listed.contains(entry.first);
+  });
+
+  listRequiredPlugins();
+  flagMissingPlugins();
+}
+
+void SavesTab::listRequiredPlugins()
+{
+  if (m_PluginsListing.isRunning()) {
+    // the saves added in the meantime are listed once it's done
+    return;
+  }
+
+  auto info = m_core.gameFeatures().gameFeature<SaveGameInfo>();
+  if (info == nullptr) {
+    return;
+  }
+
+  m_PluginsListedSaves.clear();
+  for (const auto& save : m_SaveGames) {
+    if (!m_RequiredPlugins.contains(save.get())) {
+      m_PluginsListedSaves.push_back(save);
+    }
+  }
+
+  if (m_PluginsListedSaves.empty()) {
+    return;
+  }
+
+  m_PluginsListing.setFuture(QtConcurrent::mapped(
+      m_PluginsListedSaves,
+      [info](const std::shared_ptr<const ISaveGame>& save) -> QStringList {
+        try {
+          return info->getRequiredPlugins(*save);
+        } catch (std::exception& e) {
+          log::warn("failed to read the plugins of '{}': {}", save->getFilepath(),
+                    e.what());
+          return {};
+        }
+      }));
+}
+
+void SavesTab::onRequiredPluginsListed()
+{
+  const auto future = m_PluginsListing.future();
+
+  if (!future.isCanceled()) {
+    // saves may have been removed while the worker was running
+    std::unordered_set<const ISaveGame*> listed;
+    for (const auto& save : m_SaveGames) {
+      listed.insert(save.get());
+    }
+
+    const int count =
+        std::min(future.resultCount(), static_cast<int>(m_PluginsListedSaves.size()));
+
+    for (int i = 0; i < count; ++i) {
+      const auto* save = m_PluginsListedSaves[i].get();
+      if (listed.contains(save)) {
+        m_RequiredPlugins[save] = future.resultAt(i);
+      }
+    }
+  }
+
+  m_PluginsListedSaves.clear();
+
+  listRequiredPlugins();
+  flagMissingPlugins();
+}
+
+void SavesTab::flagMissingPlugins()
+{
+  if (m_RequiredPlugins.empty()) {
+    return;
+  }
+
+  // lowercase names of the active plugins, looked up for every plugin of every
+  // save
+  QSet<QString> active;
+  auto* pluginList = m_core.pluginList();
+  for (const auto& name : pluginList->pluginNames()) {
+    if (pluginList->state(name) == IPluginList::STATE_ACTIVE) {
+      active.insert(name.toLower());
+    }
+  }
+
+  for (int i = 0; i < ui.list->topLevelItemCount(); ++i) {
+    QTreeWidgetItem* item = ui.list->topLevelItem(i);
+
+    bool missing = false;
+    auto itor    = m_RequiredPlugins.find(m_SaveGames[i].get());
+    if (itor != m_RequiredPlugins.end()) {
+      for (const auto& plugin : itor->second) {
+        if (!active.contains(plugin.toLower())) {
+          missing = true;
+          break;
+        }
+      }
+    }
+
+    item->setIcon(0, missing ? QIcon(":/MO/gui/warning") : QIcon());
   }
 }
 
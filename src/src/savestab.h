@@ -4,6 +4,11 @@
 #include "savegameinfo.h"
 #include <filterwidget.h>
 
+#include <QFutureWatcher>
+
+#include <map>
+#include <unordered_map>
+
 namespace Ui
 {
 class MainWindow;
@@ -11,6 +16,7 @@ class MainWindow;
 
 namespace MOBase
 {
+class IPluginGame;
 class ISaveGame;
 class ISaveGameInfoWidget;
 }  // namespace MOBase
@@ -24,7 +30,11 @@ class SavesTab : public QObject
 
 public:
   SavesTab(QWidget* window, OrganizerCore& core, Ui::MainWindow* ui);
+  ~SavesTab();
 
+  // lists the saves on a worker thread, the list is updated once it's done;
+  // does nothing while the tab isn't shown
+  //
   void refreshSaveList();
   void displaySaveGameInfo(QTreeWidgetItem* newItem);
 
@@ -45,6 +55,30 @@ private:
     QTreeWidget* list;
   };
 
+  // a save along with the size and modification time of its file when it was
+  // parsed
+  struct ListedSave
+  {
+    qint64 size      = 0;
+    qint64 writeTime = 0;
+    std::shared_ptr<const MOBase::ISaveGame> save;
+  };
+
+  // result of listing a saves directory on a worker thread
+  struct SaveListing
+  {
+    QString directory;
+
+    // names, sizes and modification times of the files in the directory
+    QStringList stamp;
+
+    // the directory hasn't changed since the last listing, `saves` is empty
+    bool unchanged = false;
+
+    std::vector<ListedSave> saves;
+    QString error;
+  };
+
   QWidget* m_window;
   OrganizerCore& m_core;
   SavesTabUi ui;
@@ -55,6 +89,31 @@ private:
   QTimer m_SavesWatcherTimer;
   QFileSystemWatcher m_SavesWatcher;
 
+  // saves of the last listing by path, they're kept as long as their file
+  // doesn't change so the data they parse on demand, such as the screenshot,
+  // isn't parsed again
+  std::map<QString, ListedSave> m_SaveCache;
+  QString m_SavesDirectory;
+  QStringList m_SavesStamp;
+
+  QFutureWatcher<SaveListing> m_SavesListing;
+  bool m_SavesRefreshPending;
+
+  // plugins needed by the saves in the list, by save; they're read on worker
+  // threads so the list can flag saves with missing plugins
+  std::unordered_map<const MOBase::ISaveGame*, QStringList> m_RequiredPlugins;
+  std::vector<std::shared_ptr<const MOBase::ISaveGame>> m_PluginsListedSaves;
+  QFutureWatcher<QStringList> m_PluginsListing;
+
+  static SaveListing listSaves(const MOBase::IPluginGame* game, QDir savesDir,
+                               QStringList previousStamp);
+  void onSavesListed();
+  void updateSaveList(std::vector<std::shared_ptr<const MOBase::ISaveGame>> saves,
+                      const QDir& savesDir);
+  void listRequiredPlugins();
+  void onRequiredPluginsListed();
+  void flagMissingPlugins();
+
   void onContextMenu(const QPoint& pos);
   void deleteSavegame();
   void saveSelectionChanged(QTreeWidgetItem* newItem);
@@ -295,6 +295,16 @@ void Settings::setRefreshThreadCount(std::size_t n) const
   return set(m_Settings, "Settings", "refresh_thread_count", n);
 }
 
+std::size_t Settings::extractThreadCount() const
+{
+  return get<std::size_t>(m_Settings, "Settings", "extract_thread_count", 4);
+}
+
+void Settings::setExtractThreadCount(std::size_t n) const
+{
+  return set(m_Settings, "Settings", "extract_thread_count", n);
+}
+
 std::optional<QVersionNumber> Settings::version() const
 {
   if (auto v = getOptional<QString>(m_Settings, "General", "version")) {
@@ -1809,6 +1819,36 @@ void NetworkSettings::setUseProxy(bool b)
   set(m_Settings, "Settings", "use_proxy", b);
 }
 
+int NetworkSettings::downloadConnections() const
+{
+  return get<int>(m_Settings, "Settings", "download_connections", 4);
+}
+
+void NetworkSettings::setDownloadConnections(int n)
+{
+  set(m_Settings, "Settings", "download_connections", n);
+}
+
+int NetworkSettings::maxConcurrentDownloads() const
+{
+  return get<int>(m_Settings, "Settings", "max_concurrent_downloads", 4);
+}
+
+void NetworkSettings::setMaxConcurrentDownloads(int n)
+{
+  set(m_Settings, "Settings", "max_concurrent_downloads", n);
+}
+
+int NetworkSettings::maxActiveAPIRequests() const
+{
+  return get<int>(m_Settings, "Settings", "max_active_api_requests", 6);
+}
+
+void NetworkSettings::setMaxActiveAPIRequests(int n)
+{
+  set(m_Settings, "Settings", "max_active_api_requests", n);
+}
+
 void NetworkSettings::setDownloadSpeed(const QString& name, int bytesPerSecond)
 {
   auto current = servers();
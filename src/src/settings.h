@@ -447,6 +447,24 @@ public:
   bool useProxy() const;
   void setUseProxy(bool b);
 
+  // number of range requests large downloads are split into when the server
+  // supports them, 1 downloads everything in a single request
+  //
+  int downloadConnections() const;
+  void setDownloadConnections(int n);
+
+  // number of downloads transferred at the same time, the others wait in a
+  // queue; 0 starts every download right away
+  //
+  int maxConcurrentDownloads() const;
+  void setMaxConcurrentDownloads(int n);
+
+  // number of Nexus API requests sent at the same time, fewer are sent while
+  // the API is throttling
+  //
+  int maxActiveAPIRequests() const;
+  void setMaxActiveAPIRequests(int n);
+
   // add a new download speed to the list for the given server; each server
   // remembers the last couple of download speeds and displays the average in
   // the network settings
@@ -851,6 +869,11 @@ public:
   std::size_t refreshThreadCount() const;
   void setRefreshThreadCount(std::size_t n) const;
 
+  // number of threads to use when extracting archives that are not solid
+  //
+  std::size_t extractThreadCount() const;
+  void setExtractThreadCount(std::size_t n) const;
+
   GameSettings& game();
   const GameSettings& game() const;
 
@@ -1,11 +1,78 @@
 #include "settingsdialogdiagnostics.h"
+#include "directoryrefresher.h"
 #include "organizercore.h"
 #include "shared/appconfig.h"
 #include "ui_settingsdialog.h"
 #include <log.h>
+#include <memoryusage.h>
+#include <report.h>
+#include <tracing.h>
+#include <utility.h>
+
+#ifndef _WIN32
+#include "fuseconnector.h"
+#endif
+
+#include <QApplication>
+#include <QClipboard>
+#include <QFileDialog>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTreeWidgetItem>
 
 using namespace MOBase;
 
+namespace
+{
+// upper bound of the histogram bucket that holds the call at `fraction`, see
+// VfsMetrics
+double percentileUs(const QJsonArray& histogram, qint64 count, double fraction)
+{
+  const qint64 target = std::max<qint64>(1, static_cast<qint64>(count * fraction));
+  qint64 seen         = 0;
+
+  for (int i = 0; i < histogram.size(); ++i) {
+    seen += histogram[i].toInteger();
+    if (seen >= target) {
+      return static_cast<double>(qint64(1) << (i + 1));
+    }
+  }
+
+  return 0;
+}
+
+QString formatDuration(double us)
+{
+  if (us < 1000) {
+    return QObject::tr("%1 us").arg(us, 0, 'f', 0);
+  } else if (us < 1000 * 1000) {
+    return QObject::tr("%1 ms").arg(us / 1000, 0, 'f', 1);
+  } else {
+    return QObject::tr("%1 s").arg(us / (1000 * 1000), 0, 'f', 2);
+  }
+}
+
+// sorts numeric columns by the value in Qt::UserRole instead of the text
+class NumericItem : public QTreeWidgetItem
+{
+public:
+  using QTreeWidgetItem::QTreeWidgetItem;
+
+  bool operator<(const QTreeWidgetItem& other) const override
+  {
+    const int column = treeWidget() ? treeWidget()->sortColumn() : 0;
+    const QVariant a = data(column, Qt::UserRole);
+
+    if (!a.isValid()) {
+      return QTreeWidgetItem::operator<(other);
+    }
+
+    return a.toDouble() < other.data(column, Qt::UserRole).toDouble();
+  }
+};
+}  // namespace
+
 DiagnosticsSettingsTab::DiagnosticsSettingsTab(Settings& s, SettingsDialog& d)
     : SettingsTab(s, d)
 {
@@ -28,6 +95,240 @@ DiagnosticsSettingsTab::DiagnosticsSettingsTab(Settings& s, SettingsDialog& d)
                        QString::fromStdWString(OrganizerCore::getGlobalCoreDumpPath()))
                        .toString())
           .replace("DUMPS_DIR", QString::fromStdWString(AppConfig::dumpsDir())));
+
+  QObject::connect(ui->refreshReportRefreshButton, &QPushButton::clicked, [&] {
+    refreshRefreshReport();
+  });
+
+  QObject::connect(ui->refreshReportCopyButton, &QPushButton::clicked, [&] {
+    QApplication::clipboard()->setText(DirectoryRefresher::lastReport().toText());
+  });
+
+  QObject::connect(ui->traceSaveButton, &QPushButton::clicked, [&] {
+    saveTrace();
+  });
+
+  ui->refreshReportTree->sortByColumn(1, Qt::DescendingOrder);
+  refreshRefreshReport();
+
+  QObject::connect(ui->memoryUsageRefreshButton, &QPushButton::clicked, [&] {
+    refreshMemoryUsage();
+  });
+
+  QObject::connect(ui->memoryUsageCopyButton, &QPushButton::clicked, [&] {
+    QString text = "subsystem\tbytes\titems\n";
+    for (const auto& u : memory::usages()) {
+      text += QString("%1\t%2\t%3\n").arg(u.subsystem).arg(u.bytes).arg(u.items);
+    }
+    QApplication::clipboard()->setText(text);
+  });
+
+  ui->memoryUsageTree->sortByColumn(1, Qt::DescendingOrder);
+  refreshMemoryUsage();
+
+#ifdef _WIN32
+  ui->groupBox_66->setVisible(false);
+#else
+  QObject::connect(ui->vfsMetricsRefreshButton, &QPushButton::clicked, [&] {
+    refreshVfsMetrics();
+  });
+
+  QObject::connect(ui->vfsMetricsResetButton, &QPushButton::clicked, [&] {
+    if (auto* vfs = FuseConnector::instance()) {
+      vfs->resetMetrics();
+    }
+    refreshVfsMetrics();
+  });
+
+  QObject::connect(ui->vfsMetricsCopyButton, &QPushButton::clicked, [&] {
+    if (auto* vfs = FuseConnector::instance()) {
+      QApplication::clipboard()->setText(QString::fromUtf8(vfs->metricsJson()));
+    }
+  });
+
+  refreshVfsMetrics();
+#endif
+}
+
+void DiagnosticsSettingsTab::refreshVfsMetrics()
+{
+#ifndef _WIN32
+  ui->vfsMetricsTree->clear();
+
+  auto* vfs = FuseConnector::instance();
+  const QByteArray json = vfs != nullptr ? vfs->metricsJson() : QByteArray();
+  const QJsonObject metrics = QJsonDocument::fromJson(json).object();
+
+  if (metrics.isEmpty()) {
+    ui->vfsMetricsSummaryLabel->setText(QObject::tr("The VFS is not mounted."));
+    return;
+  }
+
+  const QJsonObject ops = metrics.value("ops").toObject();
+  for (auto it = ops.begin(); it != ops.end(); ++it) {
+    const QJsonObject op    = it.value().toObject();
+    const qint64 count      = op.value("count").toInteger();
+    const QJsonArray buckets = op.value("histogram").toArray();
+    if (count == 0) {
+      continue;
+    }
+
+    auto* item = new QTreeWidgetItem(ui->vfsMetricsTree);
+    item->setText(0, it.key());
+    item->setText(1, QString::number(count));
+    item->setText(2, formatDuration(op.value("total_us").toDouble() / count));
+    item->setText(3, formatDuration(percentileUs(buckets, count, 0.5)));
+    item->setText(4, formatDuration(percentileUs(buckets, count, 0.99)));
+    item->setText(5, formatDuration(op.value("max_us").toDouble()));
+    for (int c = 1; c < 6; ++c) {
+      item->setTextAlignment(c, Qt::AlignRight | Qt::AlignVCenter);
+    }
+  }
+
+  for (int c = 0; c < ui->vfsMetricsTree->columnCount(); ++c) {
+    ui->vfsMetricsTree->resizeColumnToContents(c);
+  }
+
+  const auto mib = [&](const char* key) {
+    return QString::number(metrics.value(key).toDouble() / (1024 * 1024), 'f', 1);
+  };
+
+  ui->vfsMetricsSummaryLabel->setText(
+      QObject::tr("Read %1 MiB, wrote %2 MiB, copied %3 files (%4 MiB) to overwrite.")
+          .arg(mib("read_bytes"))
+          .arg(mib("write_bytes"))
+          .arg(metrics.value("copy_ups").toInteger())
+          .arg(mib("copy_up_bytes")));
+#endif
+}
+
+void DiagnosticsSettingsTab::refreshRefreshReport()
+{
+  ui->refreshReportTree->clear();
+
+  const auto report = DirectoryRefresher::lastReport();
+  if (report.empty()) {
+    ui->refreshReportSummaryLabel->setText(QObject::tr("No refresh has finished yet."));
+    ui->refreshReportCopyButton->setEnabled(false);
+    return;
+  }
+
+  const auto us = [](RefreshReport::Duration d) {
+    return d.count() / 1000.0;
+  };
+
+  // sorting while adding would move every item around
+  ui->refreshReportTree->setSortingEnabled(false);
+
+  for (const auto& m : report.mods) {
+    auto* item = new NumericItem(ui->refreshReportTree);
+    item->setText(0, m.name);
+
+    const std::pair<int, RefreshReport::Duration> durations[] = {
+        {1, m.total()}, {2, m.walk}, {3, m.archives}, {4, m.merge}, {5, m.queued}};
+
+    for (auto&& [column, d] : durations) {
+      item->setText(column, formatDuration(us(d)));
+      item->setData(column, Qt::UserRole, us(d));
+    }
+
+    item->setText(6, QString::number(m.files));
+    item->setData(6, Qt::UserRole, static_cast<double>(m.files));
+    item->setText(7, QString::number(m.archiveCount));
+    item->setData(7, Qt::UserRole, static_cast<double>(m.archiveCount));
+
+    for (int c = 1; c < 8; ++c) {
+      item->setTextAlignment(c, Qt::AlignRight | Qt::AlignVCenter);
+    }
+  }
+
+  ui->refreshReportTree->setSortingEnabled(true);
+
+  for (int c = 0; c < ui->refreshReportTree->columnCount(); ++c) {
+    ui->refreshReportTree->resizeColumnToContents(c);
+  }
+
+  QString biggest;
+  if (!report.directories.empty()) {
+    const auto& d = report.directories.front();
+
+    biggest = QObject::tr(" The biggest directory is '%1' in '%2' with %3 files.")
+                  .arg(d.path)
+                  .arg(d.mod)
+                  .arg(d.files);
+  }
+
+  ui->refreshReportSummaryLabel->setText(
+      QObject::tr("The last refresh took %1 for %2 mods, at %3.%4")
+          .arg(formatDuration(us(report.total)))
+          .arg(report.mods.size())
+          .arg(QLocale().toString(report.finished.time(), QLocale::ShortFormat))
+          .arg(biggest));
+
+  ui->refreshReportCopyButton->setEnabled(true);
+}
+
+void DiagnosticsSettingsTab::refreshMemoryUsage()
+{
+  ui->memoryUsageTree->clear();
+
+  const auto usages = memory::usages();
+  if (usages.empty()) {
+    ui->memoryUsageSummaryLabel->setText(
+        QObject::tr("Nothing has been measured yet."));
+    ui->memoryUsageCopyButton->setEnabled(false);
+    return;
+  }
+
+  ui->memoryUsageTree->setSortingEnabled(false);
+
+  qint64 total = 0;
+
+  for (const auto& u : usages) {
+    auto* item = new NumericItem(ui->memoryUsageTree);
+    item->setText(0, u.subsystem);
+
+    item->setText(1, localizedByteSize(static_cast<unsigned long long>(u.bytes)));
+    item->setData(1, Qt::UserRole, static_cast<double>(u.bytes));
+    item->setText(2, QString::number(u.items));
+    item->setData(2, Qt::UserRole, static_cast<double>(u.items));
+
+    for (int c = 1; c < 3; ++c) {
+      item->setTextAlignment(c, Qt::AlignRight | Qt::AlignVCenter);
+    }
+
+    total += u.bytes;
+  }
+
+  ui->memoryUsageTree->setSortingEnabled(true);
+
+  for (int c = 0; c < ui->memoryUsageTree->columnCount(); ++c) {
+    ui->memoryUsageTree->resizeColumnToContents(c);
+  }
+
+  ui->memoryUsageSummaryLabel->setText(
+      QObject::tr("About %1 in %2 subsystems, these are estimates.")
+          .arg(localizedByteSize(static_cast<unsigned long long>(total)))
+          .arg(usages.size()));
+
+  ui->memoryUsageCopyButton->setEnabled(true);
+}
+
+void DiagnosticsSettingsTab::saveTrace()
+{
+  const QString path = QFileDialog::getSaveFileName(
+      parentWidget(), QObject::tr("Save Trace"), "mo2_trace.json",
+      QObject::tr("Chrome trace (*.json)"));
+
+  if (path.isEmpty()) {
+    return;
+  }
+
+  QFile file(path);
+  if (!file.open(QIODevice::WriteOnly) || file.write(tracing::chromeTrace()) < 0) {
+    reportError(QObject::tr("Failed to save the trace to '%1': %2")
+                    .arg(path, file.errorString()));
+  }
 }
 
 void DiagnosticsSettingsTab::setLogLevel()
@@ -15,6 +15,10 @@ private:
   void setLogLevel();
   void setLootLogLevel();
   void setCrashDumpTypesBox();
+  void refreshVfsMetrics();
+  void refreshRefreshReport();
+  void refreshMemoryUsage();
+  void saveTrace();
 };
 
 #endif  // SETTINGSDIALOGDIAGNOSTICS_H
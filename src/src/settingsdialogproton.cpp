@@ -2,10 +2,12 @@
 
 #include "fluorineconfig.h"
 #include "fluorinepaths.h"
+#include "moddedup.h"
 #include "ui_settingsdialog.h"
 
 #include <QtConcurrent/QtConcurrentRun>
 #include <log.h>
+#include <utility.h>
 #include <nak_ffi.h>
 #include <atomic>
 #include <QComboBox>
@@ -23,9 +25,11 @@
 #include <QPushButton>
 #include <QMetaObject>
 #include <QProcess>
+#include <QProgressDialog>
 #include <QSettings>
 #include <QScopeGuard>
 #include <QStandardPaths>
+#include <QTimer>
 #include <QVBoxLayout>
 
 namespace
@@ -49,6 +53,32 @@ ProtonSettingsTab::ProtonSettingsTab(Settings& s, SettingsDialog& d)
   ui->launchWrapperEdit->setPlaceholderText("mangohud --dlsym");
   ui->launchWrapperEdit->setText(QSettings().value("fluorine/launch_wrapper").toString());
 
+  ui->vfsSpliceReadsCheckBox->setChecked(
+      QSettings().value("fluorine/vfs_splice_reads", true).toBool());
+  ui->vfsPassthroughCheckBox->setChecked(
+      QSettings().value("fluorine/vfs_passthrough", false).toBool());
+  ui->vfsWritebackCacheCheckBox->setChecked(
+      QSettings().value("fluorine/vfs_writeback_cache", false).toBool());
+  ui->vfsServeArchivesCheckBox->setChecked(
+      QSettings().value("fluorine/vfs_serve_archives", false).toBool());
+  ui->vfsLazyCopyUpCheckBox->setChecked(
+      QSettings().value("fluorine/vfs_lazy_copy_up", true).toBool());
+  ui->vfsCloneFdCheckBox->setChecked(
+      QSettings().value("fluorine/vfs_clone_fd", true).toBool());
+  ui->vfsMaxThreadsSpin->setValue(QSettings().value("fluorine/vfs_max_threads", 0).toInt());
+  ui->vfsMaxIdleThreadsSpin->setValue(
+      QSettings().value("fluorine/vfs_max_idle_threads", 0).toInt());
+  ui->vfsNegativeTtlSpin->setValue(QSettings().value("fluorine/vfs_negative_ttl", 30).toInt());
+  ui->vfsPrefetchCheckBox->setChecked(
+      QSettings().value("fluorine/vfs_prefetch", true).toBool());
+  ui->vfsKeepMountedCheckBox->setChecked(
+      QSettings().value("fluorine/vfs_keep_mounted", false).toBool());
+  ui->vfsIndexerCheckBox->setChecked(
+      QSettings().value("fluorine/vfs_indexer", false).toBool());
+
+  ui->dedupOnInstallCheckBox->setChecked(dedupOnInstallEnabled());
+  ui->dedupHardlinksCheckBox->setChecked(dedupHardlinksEnabled());
+
   populateProtons();
 
   QObject::connect(ui->protonVersionCombo, &QComboBox::currentIndexChanged, this,
@@ -86,6 +116,8 @@ ProtonSettingsTab::ProtonSettingsTab(Settings& s, SettingsDialog& d)
                    &ProtonSettingsTab::onWinetricks);
   QObject::connect(ui->prefixLocationBrowseButton, &QPushButton::clicked, this,
                    &ProtonSettingsTab::onBrowsePrefixLocation);
+  QObject::connect(ui->dedupModsButton, &QPushButton::clicked, this,
+                   &ProtonSettingsTab::onDedupMods);
 
   QObject::connect(&m_installWatcher, &QFutureWatcher<InstallResult>::finished, this,
                    &ProtonSettingsTab::onInstallFinished);
@@ -101,6 +133,31 @@ void ProtonSettingsTab::update()
   QSettings().setValue("fluorine/use_steam_run",
                        ui->steamRunCheckBox->isChecked());
   QSettings().setValue("fluorine/launch_wrapper", ui->launchWrapperEdit->text());
+
+  QSettings().setValue("fluorine/vfs_splice_reads",
+                       ui->vfsSpliceReadsCheckBox->isChecked());
+  QSettings().setValue("fluorine/vfs_passthrough",
+                       ui->vfsPassthroughCheckBox->isChecked());
+  QSettings().setValue("fluorine/vfs_writeback_cache",
+                       ui->vfsWritebackCacheCheckBox->isChecked());
+  QSettings().setValue("fluorine/vfs_serve_archives",
+                       ui->vfsServeArchivesCheckBox->isChecked());
+  QSettings().setValue("fluorine/vfs_lazy_copy_up",
+                       ui->vfsLazyCopyUpCheckBox->isChecked());
+  QSettings().setValue("fluorine/vfs_clone_fd", ui->vfsCloneFdCheckBox->isChecked());
+  QSettings().setValue("fluorine/vfs_max_threads", ui->vfsMaxThreadsSpin->value());
+  QSettings().setValue("fluorine/vfs_max_idle_threads",
+                       ui->vfsMaxIdleThreadsSpin->value());
+  QSettings().setValue("fluorine/vfs_negative_ttl", ui->vfsNegativeTtlSpin->value());
+  QSettings().setValue("fluorine/vfs_prefetch", ui->vfsPrefetchCheckBox->isChecked());
+  QSettings().setValue("fluorine/vfs_keep_mounted",
+                       ui->vfsKeepMountedCheckBox->isChecked());
+  QSettings().setValue("fluorine/vfs_indexer", ui->vfsIndexerCheckBox->isChecked());
+
+  QSettings().setValue("fluorine/dedup_on_install",
+                       ui->dedupOnInstallCheckBox->isChecked());
+  QSettings().setValue("fluorine/dedup_hardlinks",
+                       ui->dedupHardlinksCheckBox->isChecked());
 }
 
 void ProtonSettingsTab::populateProtons()
@@ -287,6 +344,54 @@ void ProtonSettingsTab::onBrowsePrefixLocation()
   }
 }
 
+void ProtonSettingsTab::onDedupMods()
+{
+  const QString mods   = settings().paths().mods();
+  const bool hardlinks = ui->dedupHardlinksCheckBox->isChecked();
+  auto progress        = std::make_shared<ModDedup::Progress>();
+
+  QProgressDialog dialog(tr("Deduplicating mod files..."), tr("Cancel"), 0, 1000,
+                         parentWidget());
+  dialog.setWindowModality(Qt::WindowModal);
+  dialog.setAutoReset(false);
+  dialog.setAutoClose(false);
+  dialog.setMinimumDuration(0);
+
+  QObject::connect(&dialog, &QProgressDialog::canceled, &dialog, [progress] {
+    progress->cancelled = true;
+  });
+
+  QTimer timer;
+  QObject::connect(&timer, &QTimer::timeout, &dialog, [&dialog, progress] {
+    if (const qint64 total = progress->total; total > 0) {
+      dialog.setValue(static_cast<int>(progress->done * 1000 / total));
+    }
+  });
+
+  QFutureWatcher<ModDedup::Result> watcher;
+  QObject::connect(&watcher, &QFutureWatcherBase::finished, &dialog,
+                   &QProgressDialog::accept);
+
+  watcher.setFuture(QtConcurrent::run([mods, hardlinks, progress] {
+    return sharedModDedup(mods)->dedupeAll(hardlinks, progress.get());
+  }));
+  timer.start(100);
+
+  if (!watcher.isFinished()) {
+    dialog.exec();
+  }
+
+  // a cancelled pass stops after the file it's on
+  watcher.waitForFinished();
+
+  const ModDedup::Result result = watcher.result();
+  QMessageBox::information(
+      parentWidget(), tr("Deduplicate Mods"),
+      tr("Replaced %1 files with links, %2 freed.")
+          .arg(result.files)
+          .arg(MOBase::localizedByteSize(result.bytes)));
+}
+
 QString ProtonSettingsTab::ensureWinetricks()
 {
   const QString nakWinetricks = fluorineDataDir() + "/bin/winetricks";
@@ -490,6 +595,9 @@ void ProtonSettingsTab::showGameRegistryDialog()
     }
   });
 
+  // games may have been installed since the last detection
+  nak_refresh_games();
+
   // Try to auto-detect path when game selection changes
   auto autoDetect = [pathEdit, gameCombo]() {
     const QString gameName = gameCombo->currentText();
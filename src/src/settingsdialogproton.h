@@ -33,6 +33,7 @@ private:
   void onFixGameRegistries();
   void onWinetricks();
   void onBrowsePrefixLocation();
+  void onDedupMods();
 
   void showGameRegistryDialog();
   QString ensureWinetricks();
@@ -0,0 +1,319 @@
+#include "archiveindex.h"
+#include "util.h"
+#include <bsatk/bsatk.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <log.h>
+
+namespace MOShared
+{
+
+using namespace MOBase;
+namespace fs = std::filesystem;
+
+namespace
+{
+
+constexpr char Magic[8]          = {'M', 'O', '2', 'B', 'S', 'A', 'I', 'X'};
+constexpr uint32_t Version       = 1;
+constexpr const wchar_t* Name    = L"archive_index_cache.bin";
+constexpr uint32_t MaxStringSize = 1u << 16;
+
+// size and modification time of the archive, false if it can't be read
+//
+bool archiveStamp(const std::wstring& path, uint64_t& size, int64_t& writeTime,
+                  FILETIME& fileTime)
+{
+  std::error_code ec;
+
+  size = fs::file_size(path, ec);
+  if (ec) {
+    return false;
+  }
+
+  const auto lwt = fs::last_write_time(path, ec);
+  if (ec) {
+    return false;
+  }
+
+  writeTime = static_cast<int64_t>(lwt.time_since_epoch().count());
+  fileTime  = ToFILETIME(lwt);
+
+  return true;
+}
+
+void flatten(const BSA::Folder::Ptr& folder, const std::string& path,
+             std::vector<ArchiveIndex::Folder>& out)
+{
+  const auto fileCount = folder->getNumFiles();
+
+  if (fileCount > 0) {
+    ArchiveIndex::Folder f;
+    f.path = path;
+    f.files.reserve(fileCount);
+
+    for (unsigned int i = 0; i < fileCount; ++i) {
+      const BSA::File::Ptr file = folder->getFile(i);
+      f.files.push_back(
+          {file->getName(), file->getFileSize(), file->getUncompressedFileSize()});
+    }
+
+    out.push_back(std::move(f));
+  }
+
+  const auto dirCount = folder->getNumSubFolders();
+  for (unsigned int i = 0; i < dirCount; ++i) {
+    const BSA::Folder::Ptr sub = folder->getSubFolder(i);
+    flatten(sub, path.empty() ? sub->getName() : path + "\\" + sub->getName(), out);
+  }
+}
+
+class Writer
+{
+public:
+  explicit Writer(std::ofstream& out) : m_out(out) {}
+
+  template <class T>
+  void put(T value)
+  {
+    m_out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  void putString(const std::string& s)
+  {
+    put(static_cast<uint32_t>(s.size()));
+    m_out.write(s.data(), static_cast<std::streamsize>(s.size()));
+  }
+
+private:
+  std::ofstream& m_out;
+};
+
+class Reader
+{
+public:
+  explicit Reader(std::ifstream& in) : m_in(in) {}
+
+  template <class T>
+  bool get(T& value)
+  {
+    return static_cast<bool>(m_in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+  }
+
+  bool getString(std::string& s)
+  {
+    uint32_t size = 0;
+    if (!get(size) || size > MaxStringSize) {
+      return false;
+    }
+    s.resize(size);
+    return static_cast<bool>(m_in.read(s.data(), size));
+  }
+
+private:
+  std::ifstream& m_in;
+};
+
+}  // namespace
+
+std::shared_ptr<const ArchiveIndex> readArchiveIndex(const std::wstring& path)
+{
+  auto index = std::make_shared<ArchiveIndex>();
+
+  if (!archiveStamp(path, index->archiveSize, index->writeTime, index->fileTime)) {
+    log::warn("failed to get size and last modified date for '{}'", path);
+  }
+
+  // the archive stays open for previews of its files
+  BSA::EErrorCode res = BSA::ERROR_NONE;
+  const auto archive  = BSA::ArchiveCache::instance().get(ToString(path, false), &res);
+  if (archive == nullptr) {
+    log::error("invalid bsa '{}', error {}", path, res);
+    return {};
+  }
+
+  flatten(archive->getRoot(), {}, index->folders);
+
+  return index;
+}
+
+ArchiveIndexCache::ArchiveIndexCache(std::wstring path) : m_path(std::move(path))
+{
+  load();
+}
+
+void ArchiveIndexCache::load()
+{
+  std::ifstream in(fs::path(m_path), std::ios::binary);
+  if (!in) {
+    return;
+  }
+
+  char magic[sizeof(Magic)] = {};
+  uint32_t version          = 0;
+  uint32_t count            = 0;
+  Reader r(in);
+
+  if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, Magic, sizeof(Magic)) != 0 ||
+      !r.get(version) || version != Version || !r.get(count)) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < count; ++i) {
+    auto index = std::make_shared<ArchiveIndex>();
+    std::string path;
+    uint32_t folders = 0;
+
+    if (!r.getString(path) || !r.get(index->archiveSize) || !r.get(index->writeTime) ||
+        !r.get(index->fileTime) || !r.get(folders)) {
+      return;
+    }
+
+    index->folders.resize(folders);
+
+    for (auto& folder : index->folders) {
+      uint32_t files = 0;
+      if (!r.getString(folder.path) || !r.get(files)) {
+        return;
+      }
+
+      folder.files.resize(files);
+
+      for (auto& file : folder.files) {
+        if (!r.getString(file.name) || !r.get(file.size) || !r.get(file.uncompressed)) {
+          return;
+        }
+      }
+    }
+
+    m_indices.insert_or_assign(ToWString(path, true), std::move(index));
+  }
+}
+
+std::shared_ptr<const ArchiveIndex> ArchiveIndexCache::get(const std::wstring& path)
+{
+  std::shared_ptr<const ArchiveIndex> cached;
+  {
+    std::scoped_lock lock(m_mutex);
+    m_used.insert(path);
+    if (auto itor = m_indices.find(path); itor != m_indices.end()) {
+      cached = itor->second;
+    }
+  }
+
+  if (cached) {
+    uint64_t size     = 0;
+    int64_t writeTime = 0;
+    FILETIME fileTime = {};
+
+    if (archiveStamp(path, size, writeTime, fileTime) && size == cached->archiveSize &&
+        writeTime == cached->writeTime) {
+      return cached;
+    }
+  }
+
+  auto index = readArchiveIndex(path);
+
+  std::scoped_lock lock(m_mutex);
+  if (index) {
+    m_indices.insert_or_assign(path, index);
+  } else {
+    m_indices.erase(path);
+  }
+  m_dirty = true;
+
+  return index;
+}
+
+bool ArchiveIndexCache::save()
+{
+  std::vector<std::pair<std::wstring, std::shared_ptr<const ArchiveIndex>>> indices;
+  {
+    std::scoped_lock lock(m_mutex);
+    if (!m_dirty) {
+      return true;
+    }
+    // archives nobody asked for in this run were removed or disabled
+    for (const auto& [path, index] : m_indices) {
+      if (m_used.contains(path)) {
+        indices.emplace_back(path, index);
+      }
+    }
+    m_dirty = false;
+  }
+
+  const auto failed = [this] {
+    std::scoped_lock lock(m_mutex);
+    m_dirty = true;
+    return false;
+  };
+
+  const fs::path target(m_path);
+  const fs::path tmpPath(m_path + L".tmp");
+  {
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return failed();
+    }
+
+    Writer w(out);
+    out.write(Magic, sizeof(Magic));
+    w.put(Version);
+    w.put(static_cast<uint32_t>(indices.size()));
+
+    for (const auto& [path, index] : indices) {
+      w.putString(ToString(path, true));
+      w.put(index->archiveSize);
+      w.put(index->writeTime);
+      w.put(index->fileTime);
+      w.put(static_cast<uint32_t>(index->folders.size()));
+
+      for (const auto& folder : index->folders) {
+        w.putString(folder.path);
+        w.put(static_cast<uint32_t>(folder.files.size()));
+
+        for (const auto& file : folder.files) {
+          w.putString(file.name);
+          w.put(file.size);
+          w.put(file.uncompressed);
+        }
+      }
+    }
+
+    if (!out.flush()) {
+      out.close();
+      std::error_code ec;
+      fs::remove(tmpPath, ec);
+      return failed();
+    }
+  }
+
+  std::error_code ec;
+  fs::rename(tmpPath, target, ec);
+  if (ec) {
+    log::warn("failed to write archive index cache '{}', {}", m_path, ec.message());
+    fs::remove(tmpPath, ec);
+    return failed();
+  }
+
+  return true;
+}
+
+std::shared_ptr<ArchiveIndexCache> sharedArchiveIndexCache(const std::wstring& directory)
+{
+  static std::mutex mutex;
+  static std::shared_ptr<ArchiveIndexCache> cache;
+  static std::wstring cachePath;
+
+  const std::wstring path = (fs::path(directory) / Name).wstring();
+
+  std::scoped_lock lock(mutex);
+  if (cache == nullptr || cachePath != path) {
+    cache     = std::make_shared<ArchiveIndexCache>(path);
+    cachePath = path;
+  }
+  return cache;
+}
+
+}  // namespace MOShared
@@ -0,0 +1,84 @@
+#ifndef MO_REGISTER_ARCHIVEINDEX_INCLUDED
+#define MO_REGISTER_ARCHIVEINDEX_INCLUDED
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace MOShared
+{
+
+// the file list of a bsa or ba2, which is all the directory structure needs
+// from it
+//
+struct ArchiveIndex
+{
+  struct File
+  {
+    // as stored in the archive
+    std::string name;
+    uint64_t size         = 0;
+    uint64_t uncompressed = 0;
+  };
+
+  struct Folder
+  {
+    // relative to the archive root, empty for the root itself
+    std::string path;
+    std::vector<File> files;
+  };
+
+  // of the archive file itself, the index is stale once either changes
+  uint64_t archiveSize = 0;
+  int64_t writeTime    = 0;
+  FILETIME fileTime    = {};
+
+  std::vector<Folder> folders;
+};
+
+// reads the index of the archive at `path`, null if it's not a valid archive
+//
+std::shared_ptr<const ArchiveIndex> readArchiveIndex(const std::wstring& path);
+
+// Archive indices persisted next to the instance, so an archive that didn't
+// change is never parsed again, not even across restarts.  Entries are checked
+// against the size and modification time of the archive whenever they're
+// handed out.
+//
+// All members are thread-safe.
+class ArchiveIndexCache
+{
+public:
+  explicit ArchiveIndexCache(std::wstring path);
+
+  // the cached index of the archive at `path` if it's still current, reading
+  // the archive and caching the result otherwise; null if it's not valid
+  //
+  std::shared_ptr<const ArchiveIndex> get(const std::wstring& path);
+
+  // writes the indices used by this process if anything changed since the
+  // file was loaded or last saved
+  //
+  bool save();
+
+private:
+  void load();
+
+  std::wstring m_path;
+  mutable std::mutex m_mutex;
+  std::unordered_map<std::wstring, std::shared_ptr<const ArchiveIndex>> m_indices;
+  std::unordered_set<std::wstring> m_used;
+  bool m_dirty = false;
+};
+
+// process-wide cache kept in `directory`, loaded on first use
+//
+std::shared_ptr<ArchiveIndexCache> sharedArchiveIndexCache(const std::wstring& directory);
+
+}  // namespace MOShared
+
+#endif  // MO_REGISTER_ARCHIVEINDEX_INCLUDED
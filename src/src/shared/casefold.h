@@ -0,0 +1,163 @@
+#ifndef MO_SHARED_CASEFOLD_H
+#define MO_SHARED_CASEFOLD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cwctype>
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Case folding of file names for lookups. Names are nearly always ASCII, so
+// blocks of ASCII characters are folded with SSE2 where it's available and
+// anything else goes through towlower(), giving the same result as folding one
+// character after the other.
+//
+// This is header only so the VFS helper, which doesn't have the rest of
+// shared/, can use it as well.
+
+namespace MOShared
+{
+
+namespace detail
+{
+  constexpr std::uint64_t FnvOffset = 14695981039346656037ULL;
+  constexpr std::uint64_t FnvPrime  = 1099511628211ULL;
+
+  inline std::uint64_t hashUnit(std::uint64_t h, wchar_t c)
+  {
+    return (h ^ static_cast<std::uint32_t>(c)) * FnvPrime;
+  }
+
+  inline wchar_t foldChar(wchar_t c)
+  {
+    if (c < 0x80) {
+      return (c >= L'A' && c <= L'Z') ? static_cast<wchar_t>(c + (L'a' - L'A')) : c;
+    }
+
+    return static_cast<wchar_t>(std::towlower(static_cast<std::wint_t>(c)));
+  }
+
+  // folds `s` in place, hashing it along the way if `Hash` is set
+  template <bool Hash>
+  std::size_t foldWide(wchar_t* s, std::size_t size);
+}  // namespace detail
+
+// lowercases the ASCII letters of `s`; other bytes are left alone, as
+// std::tolower() does for the bytes of UTF-8 strings
+//
+inline void foldAsciiInPlace(char* s, std::size_t size)
+{
+  std::size_t i = 0;
+
+#if defined(__SSE2__)
+  const __m128i beforeA = _mm_set1_epi8('A' - 1);
+  const __m128i afterZ  = _mm_set1_epi8('Z' + 1);
+  const __m128i caseBit = _mm_set1_epi8(0x20);
+
+  for (; i + 16 <= size; i += 16) {
+    auto* p   = reinterpret_cast<__m128i*>(s + i);
+    __m128i v = _mm_loadu_si128(p);
+
+    // signed compares, bytes above 0x7f are negative and never in range
+    const __m128i upper =
+        _mm_and_si128(_mm_cmpgt_epi8(v, beforeA), _mm_cmplt_epi8(v, afterZ));
+
+    _mm_storeu_si128(p, _mm_or_si128(v, _mm_and_si128(upper, caseBit)));
+  }
+#endif
+
+  for (; i < size; ++i) {
+    if (s[i] >= 'A' && s[i] <= 'Z') {
+      s[i] = static_cast<char>(s[i] + ('a' - 'A'));
+    }
+  }
+}
+
+// hash of an already folded name, what DirectoryEntryFileKey uses
+//
+inline std::size_t hashFolded(std::wstring_view s)
+{
+  std::uint64_t h = detail::FnvOffset;
+  for (const wchar_t c : s) {
+    h = detail::hashUnit(h, c);
+  }
+
+  return static_cast<std::size_t>(h);
+}
+
+// lowercases `s`
+//
+inline void foldInPlace(wchar_t* s, std::size_t size)
+{
+  detail::foldWide<false>(s, size);
+}
+
+// lowercases `s` and returns hashFolded() of the result in the same pass
+//
+inline std::size_t foldAndHashInPlace(wchar_t* s, std::size_t size)
+{
+  return detail::foldWide<true>(s, size);
+}
+
+template <bool Hash>
+std::size_t detail::foldWide(wchar_t* s, std::size_t size)
+{
+  std::uint64_t h = detail::FnvOffset;
+  std::size_t i   = 0;
+
+#if defined(__SSE2__)
+  static_assert(sizeof(wchar_t) == 2 || sizeof(wchar_t) == 4);
+  constexpr std::size_t lanes = 16 / sizeof(wchar_t);
+
+  const bool wide = sizeof(wchar_t) == 4;
+
+  // anything but the low 7 bits of a character
+  const __m128i nonAsciiBits =
+      wide ? _mm_set1_epi32(~0x7f) : _mm_set1_epi16(static_cast<short>(~0x7f));
+  const __m128i beforeA = wide ? _mm_set1_epi32('A' - 1) : _mm_set1_epi16('A' - 1);
+  const __m128i afterZ  = wide ? _mm_set1_epi32('Z' + 1) : _mm_set1_epi16('Z' + 1);
+  const __m128i caseBit = wide ? _mm_set1_epi32(0x20) : _mm_set1_epi16(0x20);
+  const __m128i zero    = _mm_setzero_si128();
+
+  for (; i + lanes <= size; i += lanes) {
+    auto* p   = reinterpret_cast<__m128i*>(s + i);
+    __m128i v = _mm_loadu_si128(p);
+
+    const __m128i high = _mm_and_si128(v, nonAsciiBits);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(high, zero)) == 0xffff) {
+      const __m128i upper =
+          wide ? _mm_and_si128(_mm_cmpgt_epi32(v, beforeA), _mm_cmplt_epi32(v, afterZ))
+               : _mm_and_si128(_mm_cmpgt_epi16(v, beforeA), _mm_cmplt_epi16(v, afterZ));
+
+      _mm_storeu_si128(p, _mm_or_si128(v, _mm_and_si128(upper, caseBit)));
+    } else {
+      for (std::size_t j = i; j < i + lanes; ++j) {
+        s[j] = detail::foldChar(s[j]);
+      }
+    }
+
+    if constexpr (Hash) {
+      // still in cache from the store
+      for (std::size_t j = i; j < i + lanes; ++j) {
+        h = detail::hashUnit(h, s[j]);
+      }
+    }
+  }
+#endif
+
+  for (; i < size; ++i) {
+    s[i] = detail::foldChar(s[i]);
+    if constexpr (Hash) {
+      h = detail::hashUnit(h, s[i]);
+    }
+  }
+
+  return static_cast<std::size_t>(h);
+}
+
+}  // namespace MOShared
+
+#endif  // MO_SHARED_CASEFOLD_H
@@ -19,13 +19,16 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "directoryentry.h"
 #include "../envfs.h"
+#include "../vfs/taskpool.h"
 #include "fileentry.h"
 #include "filesorigin.h"
 #include "originconnection.h"
 #include "util.h"
 #include "windows_error.h"
+#include <cwctype>
 #include <filesystem>
 #include <log.h>
+#include <memoryusage.h>
 #include <utility.h>
 
 namespace MOShared
@@ -77,6 +80,21 @@ static bool SupportOptimizedFind()
 }
 #endif
 
+bool isHiddenName(std::wstring_view name)
+{
+  static constexpr std::wstring_view ext = L".mohidden";
+
+  if (name.size() < ext.size()) {
+    return false;
+  }
+
+  const auto tail = name.substr(name.size() - ext.size());
+
+  return std::equal(tail.begin(), tail.end(), ext.begin(), [](wchar_t a, wchar_t b) {
+    return std::towlower(a) == b;
+  });
+}
+
 bool DirCompareByName::operator()(const DirectoryEntry* lhs,
                                   const DirectoryEntry* rhs) const
 {
@@ -87,9 +105,49 @@ bool DirCompareByName::operator()(const DirectoryEntry* lhs,
 #endif
 }
 
+// every directory of a structure by its path relative to the root, lowercase
+// and '\\' separated
+//
+struct DirectoryEntry::PathIndex
+{
+  std::mutex mutex;
+  bool built             = false;
+  std::uint64_t revision = 0;
+  std::unordered_map<std::wstring, DirectoryEntry*> directories;
+};
+
+namespace
+{
+
+// the key findDirectoryByPath() looks up; false for paths with empty
+// components, like a leading or trailing separator, which the recursive
+// lookups have their own rules for
+//
+bool pathIndexKey(std::wstring_view path, std::wstring& key)
+{
+  key.assign(path);
+
+  for (auto& c : key) {
+    if (c == L'/') {
+      c = L'\\';
+    }
+  }
+
+  if (key.empty() || key.front() == L'\\' || key.back() == L'\\' ||
+      key.find(L"\\\\") != std::wstring::npos) {
+    return false;
+  }
+
+  ToLowerInPlace(key);
+  return true;
+}
+
+}  // namespace
+
 DirectoryEntry::DirectoryEntry(std::wstring name, DirectoryEntry* parent, int originID)
     : m_OriginConnection(new OriginConnection), m_Name(std::move(name)),
-      m_Parent(parent), m_Populated(false), m_TopLevel(true)
+      m_Parent(parent), m_Populated(false), m_TopLevel(true), m_Hidden(false),
+      m_PathIndex(std::make_unique<PathIndex>())
 {
   m_FileRegister.reset(new FileRegister(m_OriginConnection));
   m_Origins.insert(originID);
@@ -99,7 +157,8 @@ DirectoryEntry::DirectoryEntry(std::wstring name, DirectoryEntry* parent, int or
                                boost::shared_ptr<FileRegister> fileRegister,
                                boost::shared_ptr<OriginConnection> originConnection)
     : m_FileRegister(fileRegister), m_OriginConnection(originConnection),
-      m_Name(std::move(name)), m_Parent(parent), m_Populated(false), m_TopLevel(false)
+      m_Name(std::move(name)), m_Parent(parent), m_Populated(false), m_TopLevel(false),
+      m_Hidden((parent != nullptr && parent->m_Hidden) || isHiddenName(m_Name))
 {
   m_Origins.insert(originID);
 }
@@ -115,10 +174,11 @@ void DirectoryEntry::clear()
     delete *itor;
   }
 
-  m_Files.clear();
   m_FilesLookup.clear();
+  m_Files.clear();
   m_SubDirectories.clear();
   m_SubDirectoriesLookup.clear();
+  m_FileRegister->directoriesChanged();
 }
 
 void DirectoryEntry::addFromOrigin(const std::wstring& originName,
@@ -153,6 +213,26 @@ void DirectoryEntry::addFromList(const std::wstring& originName,
   addDir(origin, root, stats);
 }
 
+void DirectoryEntry::addFromStaged(const std::wstring& originName,
+                                   const std::wstring& directory, env::Directory& root,
+                                   std::vector<StagedArchive>& archives, int priority,
+                                   DirectoryStats& stats)
+{
+  FilesOrigin& origin = createOrigin(originName, directory, priority, stats);
+  addDir(origin, root, stats);
+
+  for (auto& a : archives) {
+    if (!a.index || containsArchive(a.name)) {
+      continue;
+    }
+
+    addFiles(origin, *a.index, a.name, a.order, stats);
+    a.index.reset();
+  }
+
+  m_Populated = true;
+}
+
 void DirectoryEntry::addDir(FilesOrigin& origin, env::Directory& d,
                             DirectoryStats& stats)
 {
@@ -172,40 +252,90 @@ void DirectoryEntry::addDir(FilesOrigin& origin, env::Directory& d,
   m_Populated = true;
 }
 
+// position of the plugin loading an archive in the load order, -1 if none
+//
+static int archiveOrder(const std::wstring& filename,
+                        const std::vector<std::wstring>& loadOrder)
+{
+  const auto filenameLc = ToLowerCopy(filename);
+
+  int order = -1;
+
+  for (auto plugin : loadOrder) {
+    const auto pluginNameLc =
+        ToLowerCopy(std::filesystem::path(plugin).stem().wstring());
+
+    if (filenameLc.starts_with(pluginNameLc + L" - ") ||
+        filenameLc.starts_with(pluginNameLc + L".")) {
+      auto itor = std::find(loadOrder.begin(), loadOrder.end(), plugin);
+      if (itor != loadOrder.end()) {
+        order = std::distance(loadOrder.begin(), itor);
+      }
+    }
+  }
+
+  return order;
+}
+
 void DirectoryEntry::addFromAllBSAs(const std::wstring& originName,
                                     const std::wstring& directory, int priority,
                                     const std::vector<std::wstring>& archives,
                                     const std::set<std::wstring>& enabledArchives,
                                     const std::vector<std::wstring>& loadOrder,
-                                    DirectoryStats& stats)
+                                    DirectoryStats& stats, ArchiveIndexCache* cache)
 {
+  auto staged = loadBSAs(archives, enabledArchives, loadOrder, cache);
+  if (staged.empty()) {
+    return;
+  }
+
+  FilesOrigin& origin = createOrigin(originName, directory, priority, stats);
+
+  for (auto& a : staged) {
+    if (!containsArchive(a.name)) {
+      addFiles(origin, *a.index, a.name, a.order, stats);
+    }
+  }
+
+  m_Populated = true;
+}
+
+std::vector<DirectoryEntry::StagedArchive>
+DirectoryEntry::loadBSAs(const std::vector<std::wstring>& archives,
+                         const std::set<std::wstring>& enabledArchives,
+                         const std::vector<std::wstring>& loadOrder,
+                         ArchiveIndexCache* cache)
+{
+  std::vector<std::wstring> paths;
+  std::vector<StagedArchive> staged;
+
   for (const auto& archive : archives) {
     const std::filesystem::path archivePath(archive);
-    const auto filename = archivePath.filename().wstring();
+    auto filename = archivePath.filename().wstring();
 
     if (!enabledArchives.contains(filename)) {
       continue;
     }
 
-    const auto filenameLc = ToLowerCopy(filename);
+    StagedArchive a;
+    a.order = archiveOrder(filename, loadOrder);
+    a.name  = std::move(filename);
 
-    int order = -1;
+    paths.push_back(archivePath.wstring());
+    staged.push_back(std::move(a));
+  }
 
-    for (auto plugin : loadOrder) {
-      const auto pluginNameLc =
-          ToLowerCopy(std::filesystem::path(plugin).stem().wstring());
+  // mods with many archives are dominated by reading them, each one goes to
+  // its own task
+  parallelFor(staged.size(), [&](std::size_t i) {
+    staged[i].index = cache ? cache->get(paths[i]) : readArchiveIndex(paths[i]);
+  });
 
-      if (filenameLc.starts_with(pluginNameLc + L" - ") ||
-          filenameLc.starts_with(pluginNameLc + L".")) {
-        auto itor = std::find(loadOrder.begin(), loadOrder.end(), plugin);
-        if (itor != loadOrder.end()) {
-          order = std::distance(loadOrder.begin(), itor);
-        }
-      }
-    }
+  std::erase_if(staged, [](auto&& a) {
+    return !a.index;
+  });
 
-    addFromBSA(originName, directory, archivePath.wstring(), priority, order, stats);
-  }
+  return staged;
 }
 
 void DirectoryEntry::addFromBSA(const std::wstring& originName,
@@ -220,45 +350,19 @@ void DirectoryEntry::addFromBSA(const std::wstring& originName,
     return;
   }
 
-  BSA::Archive archive;
-  BSA::EErrorCode res = BSA::ERROR_NONE;
-
-  try {
-    // read() can return an error, but it can also throw if the file is not a
-    // valid bsa
-    res = archive.read(ToString(archivePath, false).c_str(), false);
-  } catch (std::exception& e) {
-    log::error("invalid bsa '{}', error {}", archivePath, e.what());
+  const auto index = readArchiveIndex(archivePath);
+  if (!index) {
     return;
   }
 
-  if ((res != BSA::ERROR_NONE) && (res != BSA::ERROR_INVALIDHASHES)) {
-    log::error("invalid bsa '{}', error {}", archivePath, res);
-    return;
-  }
-
-  std::error_code ec;
-  const auto lwt = std::filesystem::last_write_time(archivePath, ec);
-  FILETIME ft    = {};
-
-  if (ec) {
-    log::warn("failed to get last modified date for '{}', {}", archivePath,
-              ec.message());
-  } else {
-    ft = ToFILETIME(lwt);
-  }
-
-  addFiles(origin, archive.getRoot(), ft, archiveName, order, stats);
+  addFiles(origin, *index, archiveName, order, stats);
 
   m_Populated = true;
 }
 
 void DirectoryEntry::propagateOrigin(int origin)
 {
-  {
-    std::scoped_lock lock(m_OriginsMutex);
-    m_Origins.insert(origin);
-  }
+  m_Origins.insert(origin);
 
   if (m_Parent != nullptr) {
     m_Parent->propagateOrigin(origin);
@@ -344,15 +448,93 @@ DirectoryEntry* DirectoryEntry::findSubDirectoryRecursive(const std::wstring& pa
   return getSubDirectoryRecursive(path, false, dummy, InvalidOriginID);
 }
 
+DirectoryEntry* DirectoryEntry::findDirectoryByPath(std::wstring_view path)
+{
+  if (path.empty()) {
+    return this;
+  }
+
+  std::wstring key;
+  if (m_PathIndex == nullptr || !pathIndexKey(path, key)) {
+    return findSubDirectoryRecursive(std::wstring(path));
+  }
+
+  return indexedDirectory(key);
+}
+
+FileEntryPtr DirectoryEntry::findFileByPath(std::wstring_view path) const
+{
+  std::wstring key;
+  if (m_PathIndex == nullptr || !pathIndexKey(path, key)) {
+    return searchFile(std::wstring(path), nullptr);
+  }
+
+  const auto sep = key.rfind(L'\\');
+  if (sep == std::wstring::npos) {
+    return findFile(key, true);
+  }
+
+  const DirectoryEntry* dir = indexedDirectory(key.substr(0, sep));
+  if (dir == nullptr) {
+    return {};
+  }
+
+  return dir->findFile(key.substr(sep + 1), true);
+}
+
+DirectoryEntry* DirectoryEntry::indexedDirectory(const std::wstring& pathLc) const
+{
+  std::scoped_lock lock(m_PathIndex->mutex);
+
+  // pointers in the index may be dangling once directories were removed, so
+  // it's never used with a different revision
+  const auto revision = m_FileRegister->directoriesRevision();
+  if (!m_PathIndex->built || m_PathIndex->revision != revision) {
+    m_PathIndex->directories.clear();
+
+    std::wstring path;
+    indexDirectories(path, *m_PathIndex);
+
+    m_PathIndex->built    = true;
+    m_PathIndex->revision = revision;
+  }
+
+  auto itor = m_PathIndex->directories.find(pathLc);
+  if (itor == m_PathIndex->directories.end()) {
+    return nullptr;
+  }
+
+  return itor->second;
+}
+
+void DirectoryEntry::indexDirectories(std::wstring& pathLc, PathIndex& index) const
+{
+  const auto size = pathLc.size();
+
+  for (auto&& [nameLc, entry] : m_SubDirectoriesLookup) {
+    if (size > 0) {
+      pathLc += L'\\';
+    }
+    pathLc += nameLc;
+
+    index.directories.emplace(pathLc, entry);
+    entry->indexDirectories(pathLc, index);
+
+    pathLc.resize(size);
+  }
+}
+
 const FileEntryPtr DirectoryEntry::findFile(const std::wstring& name,
                                             bool alreadyLowerCase) const
 {
   FilesLookup::const_iterator iter;
 
   if (alreadyLowerCase) {
-    iter = m_FilesLookup.find(DirectoryEntryFileKey(name));
+    iter = m_FilesLookup.find({name, DirectoryEntryFileKey::getHash(name)});
   } else {
-    iter = m_FilesLookup.find(DirectoryEntryFileKey(ToLowerCopy(name)));
+    std::wstring nameLc(name);
+    const std::size_t hash = ToLowerHashedInPlace(nameLc);
+    iter                   = m_FilesLookup.find({nameLc, hash});
   }
 
   if (iter != m_FilesLookup.end()) {
@@ -364,7 +546,7 @@ const FileEntryPtr DirectoryEntry::findFile(const std::wstring& name,
 
 const FileEntryPtr DirectoryEntry::findFile(const DirectoryEntryFileKey& key) const
 {
-  auto iter = m_FilesLookup.find(key);
+  auto iter = m_FilesLookup.find({key.value, key.hash});
 
   if (iter != m_FilesLookup.end()) {
     return m_FileRegister->getFile(iter->second);
@@ -464,6 +646,67 @@ bool DirectoryEntry::removeFile(const std::wstring& filePath, int* origin)
   }
 }
 
+void DirectoryEntry::addLooseFile(FilesOrigin& origin, const std::wstring& filePath,
+                                  FILETIME fileTime, DirectoryStats& stats)
+{
+  const size_t pos = filePath.find_last_of(L"\\/");
+
+  DirectoryEntry* entry = this;
+  if (pos != std::string::npos) {
+    entry = getSubDirectoryRecursive(filePath.substr(0, pos), true, stats,
+                                     origin.getID());
+  }
+
+  const auto name = std::wstring_view(filePath).substr(pos + 1);
+  if (name.empty()) {
+    return;
+  }
+
+  auto file = entry->insert(name, origin, fileTime, L"", -1, stats);
+
+  if (file->getOrigin() == origin.getID()) {
+    // insert() leaves the time alone when the origin already had the file
+    file->setFileTime(fileTime);
+  }
+
+  file->sortOrigins();
+}
+
+bool DirectoryEntry::removeFileFromOrigin(FilesOrigin& origin,
+                                          const std::wstring& filePath)
+{
+  const size_t pos = filePath.find_last_of(L"\\/");
+
+  const DirectoryEntry* entry = this;
+  if (pos != std::string::npos) {
+    DirectoryStats dummy;
+    entry = getSubDirectoryRecursive(filePath.substr(0, pos), false, dummy);
+  }
+
+  if (entry == nullptr) {
+    return false;
+  }
+
+  const auto file = entry->findFile(filePath.substr(pos + 1));
+  if (!file) {
+    return false;
+  }
+
+  const auto& alternatives = file->getAlternatives();
+  if (file->getOrigin() != origin.getID() &&
+      std::none_of(alternatives.begin(), alternatives.end(), [&](auto&& a) {
+        return a.originID() == origin.getID();
+      })) {
+    return false;
+  }
+
+  // drops the file from its directory too if no other origin has it
+  origin.removeFile(file->getIndex());
+  m_FileRegister->removeOriginMulti({file->getIndex()}, origin.getID());
+
+  return true;
+}
+
 void DirectoryEntry::removeDir(const std::wstring& path)
 {
   size_t pos = path.find_first_of(L"\\/");
@@ -535,44 +778,65 @@ FilesOrigin& DirectoryEntry::createOrigin(const std::wstring& originName,
   return r.first;
 }
 
-void DirectoryEntry::removeFiles(const std::set<FileIndex>& indices)
+void DirectoryEntry::removeFiles(const std::vector<FileEntryPtr>& files)
 {
-  removeFilesFromList(indices);
+  // a few files out of a big directory are found by name, more than that and
+  // a single pass over the lists is cheaper
+  if (files.size() * 16 >= m_Files.size()) {
+    std::vector<FileIndex> indices;
+    indices.reserve(files.size());
+    for (const auto& file : files) {
+      indices.push_back(file->getIndex());
+    }
+    std::sort(indices.begin(), indices.end());
+
+    removeFilesFromList(indices);
+    return;
+  }
+
+  for (const auto& file : files) {
+    std::wstring nameLc    = file->getName();
+    const std::size_t hash = ToLowerHashedInPlace(nameLc);
+
+    auto iter = m_Files.find(nameLc);
+    if (iter == m_Files.end() || iter->second != file->getIndex()) {
+      continue;
+    }
+
+    // the lookup views the name in m_Files, so it goes first
+    m_FilesLookup.erase(FileKeyView{iter->first, hash});
+    m_Files.erase(iter);
+  }
 }
 
 FileEntryPtr DirectoryEntry::insert(std::wstring_view fileName, FilesOrigin& origin,
                                     FILETIME fileTime, std::wstring_view archive,
                                     int order, DirectoryStats& stats)
 {
-  std::wstring fileNameLower = ToLowerCopy(fileName);
+  std::wstring fileNameLower(fileName);
+  const std::size_t hash = ToLowerHashedInPlace(fileNameLower);
+  const bool hidden      = m_Hidden || isHiddenName(fileNameLower);
   FileEntryPtr fe;
 
-  DirectoryEntryFileKey key(std::move(fileNameLower));
+  FilesLookup::iterator itor;
 
-  {
-    std::unique_lock lock(m_FilesMutex);
+  elapsed(stats.filesLookupTimes, [&] {
+    itor = m_FilesLookup.find({fileNameLower, hash});
+  });
 
-    FilesLookup::iterator itor;
+  if (itor != m_FilesLookup.end()) {
+    ++stats.fileExists;
+    fe = m_FileRegister->getFile(itor->second);
+  } else {
+    ++stats.fileCreate;
+    fe = m_FileRegister->createFile(std::wstring(fileName.begin(), fileName.end()),
+                                    this, stats);
 
-    elapsed(stats.filesLookupTimes, [&] {
-      itor = m_FilesLookup.find(key);
+    elapsed(stats.addFileTimes, [&] {
+      addFileToList(std::move(fileNameLower), hash, fe->getIndex());
     });
 
-    if (itor != m_FilesLookup.end()) {
-      lock.unlock();
-      ++stats.fileExists;
-      fe = m_FileRegister->getFile(itor->second);
-    } else {
-      ++stats.fileCreate;
-      fe = m_FileRegister->createFile(std::wstring(fileName.begin(), fileName.end()),
-                                      this, stats);
-
-      elapsed(stats.addFileTimes, [&] {
-        addFileToList(std::move(key.value), fe->getIndex());
-      });
-
-      // fileNameLower has moved from this point
-    }
+    // fileNameLower has moved from this point
   }
 
   elapsed(stats.addOriginToFileTimes, [&] {
@@ -580,7 +844,7 @@ FileEntryPtr DirectoryEntry::insert(std::wstring_view fileName, FilesOrigin& ori
   });
 
   elapsed(stats.addFileToOriginTimes, [&] {
-    origin.addFile(fe->getIndex());
+    origin.addFile(fe->getIndex(), hidden);
   });
 
   return fe;
@@ -590,32 +854,29 @@ FileEntryPtr DirectoryEntry::insert(env::File& file, FilesOrigin& origin,
                                     std::wstring_view archive, int order,
                                     DirectoryStats& stats)
 {
+  const std::size_t hash = file.lchash;
+  const bool hidden      = m_Hidden || isHiddenName(file.lcname);
   FileEntryPtr fe;
 
-  {
-    std::unique_lock lock(m_FilesMutex);
-
-    FilesMap::iterator itor;
+  FilesLookup::iterator itor;
 
-    elapsed(stats.filesLookupTimes, [&] {
-      itor = m_Files.find(file.lcname);
-    });
+  elapsed(stats.filesLookupTimes, [&] {
+    itor = m_FilesLookup.find({file.lcname, hash});
+  });
 
-    if (itor != m_Files.end()) {
-      lock.unlock();
-      ++stats.fileExists;
-      fe = m_FileRegister->getFile(itor->second);
-    } else {
-      ++stats.fileCreate;
-      fe = m_FileRegister->createFile(std::move(file.name), this, stats);
-      // file.name has been moved from this point
+  if (itor != m_FilesLookup.end()) {
+    ++stats.fileExists;
+    fe = m_FileRegister->getFile(itor->second);
+  } else {
+    ++stats.fileCreate;
+    fe = m_FileRegister->createFile(std::move(file.name), this, stats);
+    // file.name has been moved from this point
 
-      elapsed(stats.addFileTimes, [&] {
-        addFileToList(std::move(file.lcname), fe->getIndex());
-      });
+    elapsed(stats.addFileTimes, [&] {
+      addFileToList(std::move(file.lcname), hash, fe->getIndex());
+    });
 
-      // file.lcname has been moved from this point
-    }
+    // file.lcname has been moved from this point
   }
 
   elapsed(stats.addOriginToFileTimes, [&] {
@@ -623,7 +884,7 @@ FileEntryPtr DirectoryEntry::insert(env::File& file, FilesOrigin& origin,
   });
 
   elapsed(stats.addFileToOriginTimes, [&] {
-    origin.addFile(fe->getIndex());
+    origin.addFile(fe->getIndex(), hidden);
   });
 
   return fe;
@@ -692,37 +953,27 @@ void DirectoryEntry::onFile(Context* cx, std::wstring_view path, FILETIME ft)
   });
 }
 
-void DirectoryEntry::addFiles(FilesOrigin& origin, const BSA::Folder::Ptr archiveFolder,
-                              FILETIME fileTime, const std::wstring& archiveName,
-                              int order, DirectoryStats& stats)
+void DirectoryEntry::addFiles(FilesOrigin& origin, const ArchiveIndex& index,
+                              const std::wstring& archiveName, int order,
+                              DirectoryStats& stats)
 {
-  // add files
-  const auto fileCount = archiveFolder->getNumFiles();
-  for (unsigned int i = 0; i < fileCount; ++i) {
-    const BSA::File::Ptr file = archiveFolder->getFile(i);
+  for (const auto& folder : index.folders) {
+    DirectoryEntry* folderEntry = getSubDirectoryRecursive(
+        ToWString(folder.path, true), true, stats, origin.getID());
 
-    auto f = insert(ToWString(file->getName(), true), origin, fileTime, archiveName,
-                    order, stats);
+    for (const auto& file : folder.files) {
+      auto f = folderEntry->insert(ToWString(file.name, true), origin, index.fileTime,
+                                   archiveName, order, stats);
 
-    if (f) {
-      if (file->getUncompressedFileSize() > 0) {
-        f->setFileSize(file->getFileSize(), file->getUncompressedFileSize());
-      } else {
-        f->setFileSize(file->getFileSize(), FileEntry::NoFileSize);
+      if (f) {
+        if (file.uncompressed > 0) {
+          f->setFileSize(file.size, file.uncompressed);
+        } else {
+          f->setFileSize(file.size, FileEntry::NoFileSize);
+        }
       }
     }
   }
-
-  // recurse into subdirectories
-  const auto dirCount = archiveFolder->getNumSubFolders();
-  for (unsigned int i = 0; i < dirCount; ++i) {
-    const BSA::Folder::Ptr folder = archiveFolder->getSubFolder(i);
-
-    DirectoryEntry* folderEntry = getSubDirectoryRecursive(
-        ToWString(folder->getName(), true), true, stats, origin.getID());
-
-    folderEntry->addFiles(origin, folder, fileTime, archiveName, order, stats);
-  }
 }
 
 DirectoryEntry* DirectoryEntry::getSubDirectory(std::wstring_view name, bool create,
@@ -730,8 +981,6 @@ DirectoryEntry* DirectoryEntry::getSubDirectory(std::wstring_view name, bool cre
 {
   std::wstring nameLc = ToLowerCopy(name);
 
-  std::scoped_lock lock(m_SubDirMutex);
-
   SubDirectoriesLookup::iterator itor;
   elapsed(stats.subdirLookupTimes, [&] {
     itor = m_SubDirectoriesLookup.find(nameLc);
@@ -764,8 +1013,6 @@ DirectoryEntry* DirectoryEntry::getSubDirectory(env::Directory& dir, bool create
 {
   SubDirectoriesLookup::iterator itor;
 
-  std::scoped_lock lock(m_SubDirMutex);
-
   elapsed(stats.subdirLookupTimes, [&] {
     itor = m_SubDirectoriesLookup.find(dir.lcname);
   });
@@ -836,12 +1083,14 @@ void DirectoryEntry::removeDirRecursive()
 
   m_SubDirectories.clear();
   m_SubDirectoriesLookup.clear();
+  m_FileRegister->directoriesChanged();
 }
 
 void DirectoryEntry::addDirectoryToList(DirectoryEntry* e, std::wstring nameLc)
 {
   m_SubDirectories.insert(e);
   m_SubDirectoriesLookup.emplace(std::move(nameLc), e);
+  m_FileRegister->directoriesChanged();
 }
 
 void DirectoryEntry::removeDirectoryFromList(SubDirectories::iterator itor)
@@ -862,6 +1111,7 @@ void DirectoryEntry::removeDirectoryFromList(SubDirectories::iterator itor)
   }
 
   m_SubDirectories.erase(itor);
+  m_FileRegister->directoriesChanged();
 }
 
 void DirectoryEntry::removeFileFromList(FileIndex index)
@@ -891,30 +1141,39 @@ void DirectoryEntry::removeFileFromList(FileIndex index)
   removeFrom(m_Files);
 }
 
-void DirectoryEntry::removeFilesFromList(const std::set<FileIndex>& indices)
+void DirectoryEntry::removeFilesFromList(const std::vector<FileIndex>& sortedIndices)
 {
-  for (auto iter = m_Files.begin(); iter != m_Files.end();) {
-    if (indices.find(iter->second) != indices.end()) {
-      iter = m_Files.erase(iter);
+  const auto removed = [&](FileIndex index) {
+    return std::binary_search(sortedIndices.begin(), sortedIndices.end(), index);
+  };
+
+  // the lookup views the names in m_Files, so it goes first
+  for (auto iter = m_FilesLookup.begin(); iter != m_FilesLookup.end();) {
+    if (removed(iter->second)) {
+      iter = m_FilesLookup.erase(iter);
     } else {
       ++iter;
     }
   }
 
-  for (auto iter = m_FilesLookup.begin(); iter != m_FilesLookup.end();) {
-    if (indices.find(iter->second) != indices.end()) {
-      iter = m_FilesLookup.erase(iter);
+  for (auto iter = m_Files.begin(); iter != m_Files.end();) {
+    if (removed(iter->second)) {
+      iter = m_Files.erase(iter);
     } else {
       ++iter;
     }
   }
 }
 
-void DirectoryEntry::addFileToList(std::wstring fileNameLower, FileIndex index)
+void DirectoryEntry::addFileToList(std::wstring fileNameLower, std::size_t hash,
+                                   FileIndex index)
 {
-  m_FilesLookup.emplace(fileNameLower, index);
-  m_Files.emplace(std::move(fileNameLower), index);
+  const auto r = m_Files.emplace(std::move(fileNameLower), index);
   // fileNameLower has been moved from this point
+
+  if (r.second) {
+    m_FilesLookup.emplace(FileKeyView{r.first->first, hash}, index);
+  }
 }
 
 struct DumpFailed : public std::runtime_error
@@ -952,41 +1211,69 @@ void DirectoryEntry::dump(const std::wstring& file) const
   }
 }
 
-void DirectoryEntry::dump(std::FILE* f, const std::wstring& parentPath) const
+std::size_t DirectoryEntry::memoryUsage(std::size_t& directories) const
 {
-  {
-    std::scoped_lock lock(m_FilesMutex);
+  using namespace MOBase::memory;
 
-    for (auto&& index : m_Files) {
-      const auto file = m_FileRegister->getFile(index.second);
-      if (!file) {
-        continue;
-      }
+  ++directories;
 
-      if (file->isFromArchive()) {
-        // TODO: don't list files from archives. maybe make this an option?
-        continue;
-      }
+  std::size_t bytes = sizeof(DirectoryEntry) + heapBytes(m_Name);
+
+  bytes += treeBytes(m_Files) + hashBytes(m_FilesLookup);
+  for (auto&& [name, index] : m_Files) {
+    bytes += heapBytes(name);
+  }
 
-      const auto& o   = m_OriginConnection->getByID(file->getOrigin());
-      const auto path = parentPath + NativeWPathSep + file->getName();
-      const auto line = path + L"\t(" + o.getName() + L")\r\n";
+  bytes += treeBytes(m_SubDirectories) + hashBytes(m_SubDirectoriesLookup);
+  for (auto&& [name, d] : m_SubDirectoriesLookup) {
+    bytes += heapBytes(name);
+  }
 
-      const auto lineu8 = MOShared::ToString(line, true);
+  bytes += treeBytes(m_Origins);
 
-      if (std::fwrite(lineu8.data(), lineu8.size(), 1, f) != 1) {
-        const auto e = errno;
-        throw DumpFailed(std::format("failed to write, {} ({})", std::strerror(e), e));
-      }
+  if (m_PathIndex) {
+    std::scoped_lock lock(m_PathIndex->mutex);
+    bytes += sizeof(PathIndex) + hashBytes(m_PathIndex->directories);
+    for (auto&& [path, d] : m_PathIndex->directories) {
+      bytes += heapBytes(path);
     }
   }
 
-  {
-    std::scoped_lock lock(m_SubDirMutex);
-    for (auto&& d : m_SubDirectories) {
-      const auto path = parentPath + NativeWPathSep + d->m_Name;
-      d->dump(f, path);
+  for (auto&& d : m_SubDirectories) {
+    bytes += d->memoryUsage(directories);
+  }
+
+  return bytes;
+}
+
+void DirectoryEntry::dump(std::FILE* f, const std::wstring& parentPath) const
+{
+  for (auto&& index : m_Files) {
+    const auto file = m_FileRegister->getFile(index.second);
+    if (!file) {
+      continue;
+    }
+
+    if (file->isFromArchive()) {
+      // TODO: don't list files from archives. maybe make this an option?
+      continue;
     }
+
+    const auto& o   = m_OriginConnection->getByID(file->getOrigin());
+    const auto path = parentPath + NativeWPathSep + file->getName();
+    const auto line = path + L"\t(" + o.getName() + L")\r\n";
+
+    const auto lineu8 = MOShared::ToString(line, true);
+
+    if (std::fwrite(lineu8.data(), lineu8.size(), 1, f) != 1) {
+      const auto e = errno;
+      throw DumpFailed(std::format("failed to write, {} ({})", std::strerror(e), e));
+    }
+  }
+
+  for (auto&& d : m_SubDirectories) {
+    const auto path = parentPath + NativeWPathSep + d->m_Name;
+    d->dump(f, path);
   }
 }
 
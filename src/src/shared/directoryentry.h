@@ -20,8 +20,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef MO_REGISTER_DIRECTORYENTRY_INCLUDED
 #define MO_REGISTER_DIRECTORYENTRY_INCLUDED
 
-#include <bsatk/bsatk.h>
-
+#include "archiveindex.h"
 #include "fileregister.h"
 
 namespace env
@@ -51,11 +50,29 @@ struct DirCompareByName
   bool operator()(const DirectoryEntry* a, const DirectoryEntry* b) const;
 };
 
+// whether `name` ends with ModInfo::s_HiddenExt, ignoring case; files with it and
+// everything in directories with it are hidden
+//
+bool isHiddenName(std::wstring_view name);
+
+// the structure is only ever modified by one thread at a time; the refresher
+// reads mods in parallel but stages them off to the side (see loadBSAs() and
+// addFromStaged()) and merges them in priority order afterwards
+//
 class DirectoryEntry
 {
 public:
   using SubDirectories = std::set<DirectoryEntry*, DirCompareByName>;
 
+  // an archive read by loadBSAs() that is not part of any structure yet
+  //
+  struct StagedArchive
+  {
+    std::wstring name;
+    int order = -1;
+    std::shared_ptr<const ArchiveIndex> index;
+  };
+
   DirectoryEntry(std::wstring name, DirectoryEntry* parent, OriginID originID);
 
   DirectoryEntry(std::wstring name, DirectoryEntry* parent, OriginID originID,
@@ -78,8 +95,13 @@ public:
 
   bool hasFiles() const { return !m_Files.empty(); }
 
+  std::size_t fileCount() const { return m_Files.size(); }
+
   const DirectoryEntry* getParent() const { return m_Parent; }
 
+  // whether this directory or one of its parents is hidden, see isHiddenName()
+  bool isHidden() const { return m_Hidden; }
+
   // add files to this directory (and subdirectories) from the specified origin.
   // That origin may exist or not
   void addFromOrigin(const std::wstring& originName, const std::wstring& directory,
@@ -93,7 +115,7 @@ public:
                       int priority, const std::vector<std::wstring>& archives,
                       const std::set<std::wstring>& enabledArchives,
                       const std::vector<std::wstring>& loadOrder,
-                      DirectoryStats& stats);
+                      DirectoryStats& stats, ArchiveIndexCache* cache = nullptr);
 
   void addFromBSA(const std::wstring& originName, const std::wstring& directory,
                   const std::wstring& archivePath, int priority, int order,
@@ -102,6 +124,21 @@ public:
   void addFromList(const std::wstring& originName, const std::wstring& directory,
                    env::Directory& root, int priority, DirectoryStats& stats);
 
+  // reads the archives addFromAllBSAs() would add without touching any
+  // structure, so it can run on any thread; archives are indexed in parallel
+  // and taken from `cache` if they didn't change
+  static std::vector<StagedArchive>
+  loadBSAs(const std::vector<std::wstring>& archives,
+           const std::set<std::wstring>& enabledArchives,
+           const std::vector<std::wstring>& loadOrder,
+           ArchiveIndexCache* cache = nullptr);
+
+  // adds an origin from files gathered beforehand by env::getFilesAndDirs()
+  // and loadBSAs(); indices are released once their files are in
+  void addFromStaged(const std::wstring& originName, const std::wstring& directory,
+                     env::Directory& root, std::vector<StagedArchive>& archives,
+                     int priority, DirectoryStats& stats);
+
   void propagateOrigin(OriginID origin);
 
   const std::wstring& getName() const { return m_Name; }
@@ -141,6 +178,21 @@ public:
     }
   }
 
+  // like forEachFile(), but only for the files whose lowercase name starts
+  // with `prefixLc`, which is a range of the sorted file map
+  template <class F>
+  void forEachFileWithPrefix(const std::wstring& prefixLc, F&& f) const
+  {
+    for (auto itor = m_Files.lower_bound(prefixLc);
+         itor != m_Files.end() && itor->first.starts_with(prefixLc); ++itor) {
+      if (auto file = m_FileRegister->getFile(itor->second)) {
+        if (!f(*file)) {
+          break;
+        }
+      }
+    }
+  }
+
   template <class F>
   void forEachFileIndex(F&& f) const
   {
@@ -161,6 +213,14 @@ public:
 
   DirectoryEntry* findSubDirectoryRecursive(const std::wstring& path);
 
+  // same as findSubDirectoryRecursive() and searchFile(), but the root keeps
+  // a flat index of every directory by its lowercase path, so a lookup is a
+  // single hash instead of one per component; the index is rebuilt on the
+  // first lookup after directories were added or removed
+  //
+  DirectoryEntry* findDirectoryByPath(std::wstring_view path);
+  FileEntryPtr findFileByPath(std::wstring_view path) const;
+
   /** retrieve a file in this directory by name.
    * @param name name of the file
    * @return fileentry object for the file or nullptr if no file matches
@@ -187,6 +247,15 @@ public:
   // file in a subdirectory
   bool removeFile(const std::wstring& filePath, OriginID* origin = nullptr);
 
+  // adds a single loose file of `origin`, or updates its time if the origin
+  // already provides it; `filePath` is relative to this directory
+  void addLooseFile(FilesOrigin& origin, const std::wstring& filePath,
+                    FILETIME fileTime, DirectoryStats& stats);
+
+  // removes a single file of `origin`; the file stays in the tree if other
+  // origins provide it too
+  bool removeFileFromOrigin(FilesOrigin& origin, const std::wstring& filePath);
+
   /**
    * @brief remove the specified directory
    * @param path directory to remove
@@ -201,13 +270,37 @@ public:
                             const std::wstring& directory, int priority,
                             DirectoryStats& stats);
 
-  void removeFiles(const std::set<FileIndex>& indices);
+  // drops `files` from this directory only, they must have been removed from
+  // the register already
+  void removeFiles(const std::vector<FileEntryPtr>& files);
 
   void dump(const std::wstring& file) const;
 
+  // estimated bytes taken by this directory and its subdirectories, not their
+  // files, which are in the register; `directories` is incremented for each of
+  // them, see MOBase::memory
+  std::size_t memoryUsage(std::size_t& directories) const;
+
 private:
+  struct PathIndex;
+
+  // key of m_FilesLookup, views the key of the same file in m_Files (whose
+  // nodes never move) so each lowercase name is only stored once
+  struct FileKeyView
+  {
+    std::wstring_view value;
+    std::size_t hash;
+
+    bool operator==(const FileKeyView& o) const { return (value == o.value); }
+  };
+
+  struct FileKeyViewHash
+  {
+    std::size_t operator()(const FileKeyView& key) const { return key.hash; }
+  };
+
   using FilesMap             = std::map<std::wstring, FileIndex>;
-  using FilesLookup          = std::unordered_map<DirectoryEntryFileKey, FileIndex>;
+  using FilesLookup          = std::unordered_map<FileKeyView, FileIndex, FileKeyViewHash>;
   using SubDirectoriesLookup = std::unordered_map<std::wstring, DirectoryEntry*>;
 
   boost::shared_ptr<FileRegister> m_FileRegister;
@@ -223,9 +316,10 @@ private:
   std::set<OriginID> m_Origins;
   bool m_Populated;
   bool m_TopLevel;
-  mutable std::mutex m_SubDirMutex;
-  mutable std::mutex m_FilesMutex;
-  mutable std::mutex m_OriginsMutex;
+  bool m_Hidden;
+
+  // only set on the root
+  std::unique_ptr<PathIndex> m_PathIndex;
 
   FileEntryPtr insert(std::wstring_view fileName, FilesOrigin& origin,
                       FILETIME fileTime, std::wstring_view archive, int order,
@@ -237,7 +331,7 @@ private:
   void addFiles(env::DirectoryWalker& walker, FilesOrigin& origin,
                 const std::wstring& path, DirectoryStats& stats);
 
-  void addFiles(FilesOrigin& origin, BSA::Folder::Ptr archiveFolder, FILETIME fileTime,
+  void addFiles(FilesOrigin& origin, const ArchiveIndex& index,
                 const std::wstring& archiveName, int order, DirectoryStats& stats);
 
   void addDir(FilesOrigin& origin, env::Directory& d, DirectoryStats& stats);
@@ -256,12 +350,15 @@ private:
 
   void removeDirRecursive();
 
+  DirectoryEntry* indexedDirectory(const std::wstring& pathLc) const;
+  void indexDirectories(std::wstring& pathLc, PathIndex& index) const;
+
   void addDirectoryToList(DirectoryEntry* e, std::wstring nameLc);
   void removeDirectoryFromList(SubDirectories::iterator itor);
 
-  void addFileToList(std::wstring fileNameLower, FileIndex index);
+  void addFileToList(std::wstring fileNameLower, std::size_t hash, FileIndex index);
   void removeFileFromList(FileIndex index);
-  void removeFilesFromList(const std::set<FileIndex>& indices);
+  void removeFilesFromList(const std::vector<FileIndex>& sortedIndices);
 
   struct Context;
   static void onDirectoryStart(Context* cx, std::wstring_view path);
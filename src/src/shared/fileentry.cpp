@@ -2,25 +2,38 @@
 #include "directoryentry.h"
 #include "filesorigin.h"
 #include "util.h"
+#include <memoryusage.h>
 
 namespace MOShared
 {
 
+const std::wstring* internArchiveName(std::wstring_view name)
+{
+  if (name.empty()) {
+    return &NoArchiveName;
+  }
+
+  // nodes of an unordered_set never move
+  static std::mutex mutex;
+  static std::unordered_set<std::wstring> names;
+
+  std::scoped_lock lock(mutex);
+  return &*names.emplace(name).first;
+}
+
 FileEntry::FileEntry()
     : m_Index(InvalidFileIndex), m_Name(), m_Origin(-1), m_Parent(nullptr),
       m_FileSize(NoFileSize), m_CompressedFileSize(NoFileSize)
 {}
 
 FileEntry::FileEntry(FileIndex index, std::wstring name, DirectoryEntry* parent)
-    : m_Index(index), m_Name(std::move(name)), m_Origin(-1), m_Archive(L"", -1),
-      m_Parent(parent), m_FileSize(NoFileSize), m_CompressedFileSize(NoFileSize)
+    : m_Index(index), m_Name(std::move(name)), m_Origin(-1), m_Parent(parent),
+      m_FileSize(NoFileSize), m_CompressedFileSize(NoFileSize)
 {}
 
 void FileEntry::addOrigin(OriginID origin, FILETIME fileTime, std::wstring_view archive,
                           int order)
 {
-  std::scoped_lock lock(m_OriginsMutex);
-
   if (m_Parent != nullptr) {
     m_Parent->propagateOrigin(origin);
   }
@@ -30,7 +43,7 @@ void FileEntry::addOrigin(OriginID origin, FILETIME fileTime, std::wstring_view
     // alternatives
     m_Origin   = origin;
     m_FileTime = fileTime;
-    m_Archive  = DataArchiveOrigin(std::wstring(archive.begin(), archive.end()), order);
+    m_Archive  = DataArchiveOrigin(archive, order);
   } else if ((m_Parent != nullptr) &&
              ((m_Parent->getOriginByID(origin).getPriority() >
                m_Parent->getOriginByID(m_Origin).getPriority()) ||
@@ -50,7 +63,7 @@ void FileEntry::addOrigin(OriginID origin, FILETIME fileTime, std::wstring_view
 
     m_Origin   = origin;
     m_FileTime = fileTime;
-    m_Archive  = DataArchiveOrigin(std::wstring(archive.begin(), archive.end()), order);
+    m_Archive  = DataArchiveOrigin(archive, order);
   } else {
     // This mod is just an alternative
     bool found = false;
@@ -69,24 +82,20 @@ void FileEntry::addOrigin(OriginID origin, FILETIME fileTime, std::wstring_view
       if ((m_Parent != nullptr) &&
           (m_Parent->getOriginByID(iter->originID()).getPriority() <
            m_Parent->getOriginByID(origin).getPriority())) {
-        m_Alternatives.insert(
-            iter, {origin, {std::wstring(archive.begin(), archive.end()), order}});
+        m_Alternatives.insert(iter, {origin, {archive, order}});
         found = true;
         break;
       }
     }
 
     if (!found) {
-      m_Alternatives.push_back(
-          {origin, {std::wstring(archive.begin(), archive.end()), order}});
+      m_Alternatives.push_back({origin, {archive, order}});
     }
   }
 }
 
 bool FileEntry::removeOrigin(OriginID origin)
 {
-  std::scoped_lock lock(m_OriginsMutex);
-
   if (m_Origin == origin) {
     if (!m_Alternatives.empty()) {
       // find alternative with the highest priority
@@ -123,7 +132,7 @@ bool FileEntry::removeOrigin(OriginID origin)
       m_Origin = currentID;
     } else {
       m_Origin  = -1;
-      m_Archive = DataArchiveOrigin(L"", -1);
+      m_Archive = DataArchiveOrigin();
       return true;
     }
   } else {
@@ -141,8 +150,6 @@ bool FileEntry::removeOrigin(OriginID origin)
 
 void FileEntry::sortOrigins()
 {
-  std::scoped_lock lock(m_OriginsMutex);
-
   m_Alternatives.push_back({m_Origin, m_Archive});
 
   std::sort(m_Alternatives.begin(), m_Alternatives.end(), [&](auto&& LHS, auto&& RHS) {
@@ -187,8 +194,6 @@ void FileEntry::sortOrigins()
 
 bool FileEntry::isFromArchive(std::wstring archiveName) const
 {
-  std::scoped_lock lock(m_OriginsMutex);
-
   if (archiveName.length() == 0) {
     return m_Archive.isValid();
   }
@@ -208,8 +213,6 @@ bool FileEntry::isFromArchive(std::wstring archiveName) const
 
 std::wstring FileEntry::getFullPath(OriginID originID) const
 {
-  std::scoped_lock lock(m_OriginsMutex);
-
   if (originID == InvalidOriginID) {
     bool ignore = false;
     originID    = getOrigin(ignore);
@@ -239,6 +242,22 @@ std::wstring FileEntry::getRelativePath() const
   return result + NativeWPathSep + m_Name;
 }
 
+std::size_t FileEntry::memoryUsage() const
+{
+  // the entry and the control block of its shared_ptr
+  std::size_t bytes = sizeof(FileEntry) + 3 * sizeof(void*);
+  bytes += MOBase::memory::heapBytes(m_Name);
+
+  // only allocated once there are more alternatives than fit in the vector
+  const auto* data = reinterpret_cast<const char*>(m_Alternatives.data());
+  const auto* self = reinterpret_cast<const char*>(&m_Alternatives);
+  if (data < self || data >= self + sizeof(m_Alternatives)) {
+    bytes += m_Alternatives.capacity() * sizeof(FileAlternative);
+  }
+
+  return bytes;
+}
+
 bool FileEntry::recurseParents(std::wstring& path, const DirectoryEntry* parent) const
 {
   if (parent == nullptr) {
@@ -56,6 +56,9 @@ public:
 
   std::wstring getRelativePath() const;
 
+  // estimated bytes taken by this entry, see MOBase::memory
+  std::size_t memoryUsage() const;
+
   DirectoryEntry* getParent() { return m_Parent; }
 
   void setFileTime(FILETIME fileTime) const { m_FileTime = fileTime; }
@@ -81,7 +84,6 @@ private:
   DirectoryEntry* m_Parent;
   mutable FILETIME m_FileTime;
   uint64_t m_FileSize, m_CompressedFileSize;
-  mutable std::mutex m_OriginsMutex;
 
   bool recurseParents(std::wstring& path, const DirectoryEntry* parent) const;
 };
@@ -4,6 +4,7 @@
 #include "filesorigin.h"
 #include "originconnection.h"
 #include <log.h>
+#include <unordered_map>
 
 namespace MOShared
 {
@@ -11,12 +12,12 @@ namespace MOShared
 using namespace MOBase;
 
 FileRegister::FileRegister(boost::shared_ptr<OriginConnection> originConnection)
-    : m_OriginConnection(originConnection), m_NextIndex(0)
+    : m_OriginConnection(originConnection), m_NextIndex(0), m_DirectoriesRevision(0)
 {}
 
 bool FileRegister::indexValid(FileIndex index) const
 {
-  std::scoped_lock lock(m_Mutex);
+  std::shared_lock lock(m_Mutex);
 
   if (index < m_Files.size()) {
     return (m_Files[index].get() != nullptr);
@@ -32,7 +33,7 @@ FileEntryPtr FileRegister::createFile(std::wstring name, DirectoryEntry* parent,
   auto p           = FileEntryPtr(new FileEntry(index, std::move(name), parent));
 
   {
-    std::scoped_lock lock(m_Mutex);
+    std::unique_lock lock(m_Mutex);
 
     if (index >= m_Files.size()) {
       m_Files.resize(index + 1);
@@ -51,7 +52,7 @@ FileIndex FileRegister::generateIndex()
 
 FileEntryPtr FileRegister::getFile(FileIndex index) const
 {
-  std::scoped_lock lock(m_Mutex);
+  std::shared_lock lock(m_Mutex);
 
   if (index < m_Files.size()) {
     return m_Files[index];
@@ -60,9 +61,26 @@ FileEntryPtr FileRegister::getFile(FileIndex index) const
   }
 }
 
+std::vector<FileEntryPtr>
+FileRegister::getFiles(const std::vector<FileIndex>& indices) const
+{
+  std::vector<FileEntryPtr> result;
+  result.reserve(indices.size());
+
+  std::shared_lock lock(m_Mutex);
+
+  for (const auto index : indices) {
+    if (index < m_Files.size() && m_Files[index]) {
+      result.push_back(m_Files[index]);
+    }
+  }
+
+  return result;
+}
+
 bool FileRegister::removeFile(FileIndex index)
 {
-  std::scoped_lock lock(m_Mutex);
+  std::unique_lock lock(m_Mutex);
 
   if (index < m_Files.size()) {
     FileEntryPtr p;
@@ -83,7 +101,8 @@ void FileRegister::removeOrigin(FileIndex index, OriginID originID)
   std::unique_lock lock(m_Mutex);
 
   if (index < m_Files.size()) {
-    FileEntryPtr& p = m_Files[index];
+    // copied, the slot is cleared before the file is unregistered
+    FileEntryPtr p = m_Files[index];
 
     if (p) {
       if (p->removeOrigin(originID)) {
@@ -99,60 +118,48 @@ void FileRegister::removeOrigin(FileIndex index, OriginID originID)
              index);
 }
 
-void FileRegister::removeOriginMulti(std::set<FileIndex> indices, OriginID originID)
+void FileRegister::removeOriginMulti(const std::vector<FileIndex>& indices,
+                                     OriginID originID)
 {
-  std::vector<FileEntryPtr> removedFiles;
+  // removed files grouped by the directory they have to be removed from
+  std::unordered_map<DirectoryEntry*, std::vector<FileEntryPtr>> parents;
 
   {
-    std::scoped_lock lock(m_Mutex);
+    std::unique_lock lock(m_Mutex);
+
+    for (const auto index : indices) {
+      if (index >= m_Files.size()) {
+        continue;
+      }
 
-    for (auto iter = indices.begin(); iter != indices.end();) {
-      const auto index = *iter;
+      FileEntryPtr& p = m_Files[index];
 
-      if (index < m_Files.size()) {
-        const auto& p = m_Files[index];
+      if (p && p->removeOrigin(originID)) {
+        DirectoryEntry* parent = p->getParent();
+        FileEntryPtr removed;
+        removed.swap(p);
 
-        if (p && p->removeOrigin(originID)) {
-          removedFiles.push_back(p);
-          m_Files[index] = {};
-          ++iter;
-          continue;
+        if (parent != nullptr) {
+          parents[parent].push_back(std::move(removed));
         }
       }
-
-      iter = indices.erase(iter);
     }
   }
 
   // optimization: this is only called when disabling an origin and in this case
   // we don't have to remove the file from the origin
 
-  // need to remove files from their parent directories. multiple ways to go
-  // about this:
-  //   a) for each file, search its parents file-list (preferably by name) and
-  //      remove what is found
-  //   b) gather the parent directories, go through the file list for each once
-  //      and remove all files that have been removed
-  //
-  // the latter should be faster when there are many files in few directories.
-  // since this is called only when disabling an origin that is probably
-  // frequently the case
-
-  std::set<DirectoryEntry*> parents;
-  for (const FileEntryPtr& file : removedFiles) {
-    if (file->getParent() != nullptr) {
-      parents.insert(file->getParent());
-    }
-  }
-
-  for (DirectoryEntry* parent : parents) {
-    parent->removeFiles(indices);
+  // each directory gets only its own files, which it removes by name or with a
+  // single pass over its list, whichever is cheaper; see
+  // DirectoryEntry::removeFiles()
+  for (const auto& [parent, files] : parents) {
+    parent->removeFiles(files);
   }
 }
 
 void FileRegister::sortOrigins()
 {
-  std::scoped_lock lock(m_Mutex);
+  std::unique_lock lock(m_Mutex);
 
   for (auto&& p : m_Files) {
     if (p) {
@@ -161,6 +168,21 @@ void FileRegister::sortOrigins()
   }
 }
 
+std::size_t FileRegister::memoryUsage() const
+{
+  std::shared_lock lock(m_Mutex);
+
+  std::size_t bytes = sizeof(FileRegister) + m_Files.size() * sizeof(FileEntryPtr);
+
+  for (auto&& p : m_Files) {
+    if (p) {
+      bytes += p->memoryUsage();
+    }
+  }
+
+  return bytes;
+}
+
 void FileRegister::unregisterFile(FileEntryPtr file)
 {
   bool ignore;
@@ -4,6 +4,7 @@
 #include "fileregisterfwd.h"
 #include <boost/shared_ptr.hpp>
 #include <mutex>
+#include <shared_mutex>
 
 namespace MOShared
 {
@@ -24,25 +25,48 @@ public:
 
   FileEntryPtr getFile(FileIndex index) const;
 
+  // the files that still exist among `indices`, in the same order
+  std::vector<FileEntryPtr> getFiles(const std::vector<FileIndex>& indices) const;
+
   size_t highestCount() const
   {
-    std::scoped_lock lock(m_Mutex);
+    std::shared_lock lock(m_Mutex);
     return m_Files.size();
   }
 
   bool removeFile(FileIndex index);
   void removeOrigin(FileIndex index, OriginID originID);
-  void removeOriginMulti(std::set<FileIndex> indices, OriginID originID);
+
+  // removes the origin from all the files in `indices`, files left without an
+  // origin are dropped from the register and their directories
+  void removeOriginMulti(const std::vector<FileIndex>& indices, OriginID originID);
+
+  // bumped whenever a directory is added to or removed from the structure
+  // using this register, see DirectoryEntry::findDirectoryByPath()
+  std::uint64_t directoriesRevision() const
+  {
+    return m_DirectoriesRevision.load(std::memory_order_acquire);
+  }
+
+  void directoriesChanged()
+  {
+    m_DirectoriesRevision.fetch_add(1, std::memory_order_acq_rel);
+  }
 
   void sortOrigins();
 
+  // estimated bytes taken by the register and its files, see MOBase::memory
+  std::size_t memoryUsage() const;
+
 private:
   using FileMap = std::deque<FileEntryPtr>;
 
-  mutable std::mutex m_Mutex;
+  // lookups only need the shared lock, they run in parallel during refreshes
+  mutable std::shared_mutex m_Mutex;
   FileMap m_Files;
   boost::shared_ptr<OriginConnection> m_OriginConnection;
   std::atomic<FileIndex> m_NextIndex;
+  std::atomic<std::uint64_t> m_DirectoriesRevision;
 
   void unregisterFile(FileEntryPtr file);
   FileIndex generateIndex();
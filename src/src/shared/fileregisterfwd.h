@@ -1,6 +1,8 @@
 #ifndef MO_REGISTER_FILEREGISTERFWD_INCLUDED
 #define MO_REGISTER_FILEREGISTERFWD_INCLUDED
 
+#include "casefold.h"
+
 class DirectoryRefreshProgress;
 
 namespace MOShared
@@ -12,10 +14,8 @@ struct DirectoryEntryFileKey
 
   bool operator==(const DirectoryEntryFileKey& o) const { return (value == o.value); }
 
-  static std::size_t getHash(const std::wstring& value)
-  {
-    return std::hash<std::wstring>()(value);
-  }
+  // `value` is lowercase already; ToLowerHashedInPlace() gives the same hash
+  static std::size_t getHash(const std::wstring& value) { return hashFolded(value); }
 
   std::wstring value;
   const std::size_t hash;
@@ -35,23 +35,30 @@ using OriginID     = int;
 constexpr FileIndex InvalidFileIndex = UINT_MAX;
 constexpr OriginID InvalidOriginID   = -1;
 
+// archive names are shared by every file of an archive, so they are kept once
+// and referred to by pointer; the returned string lives until exit and is the
+// same for equal names, empty names give NoArchiveName
+//
+inline const std::wstring NoArchiveName;
+const std::wstring* internArchiveName(std::wstring_view name);
+
 // if a file is in an archive, name is the name of the bsa and order
 // is the order of the associated plugin in the plugins list
 // is a file is not in an archive, archiveName is empty and order is usually
 // -1
 class DataArchiveOrigin
 {
-  std::wstring name_ = L"";
-  int order_         = -1;
+  const std::wstring* name_ = &NoArchiveName;
+  int order_                = -1;
 
 public:
   int order() const { return order_; }
-  const std::wstring& name() const { return name_; }
+  const std::wstring& name() const { return *name_; }
 
-  bool isValid() const { return name_.size() > 0; }
+  bool isValid() const { return !name_->empty(); }
 
-  DataArchiveOrigin(std::wstring name, int order)
-      : name_(std::move(name)), order_(order)
+  DataArchiveOrigin(std::wstring_view name, int order)
+      : name_(internArchiveName(name)), order_(order)
   {}
 
   DataArchiveOrigin() = default;
@@ -75,7 +82,8 @@ public:
   {}
 };
 
-using AlternativesVector = std::vector<FileAlternative>;
+// most files come from one to three origins, those need no allocation
+using AlternativesVector = boost::container::small_vector<FileAlternative, 3>;
 
 struct DirectoryStats
 {
@@ -3,6 +3,9 @@
 #include "fileregister.h"
 #include "originconnection.h"
 
+#include <algorithm>
+#include <iterator>
+
 namespace MOShared
 {
 
@@ -46,19 +49,14 @@ void FilesOrigin::setName(const std::wstring& name)
 
 std::vector<FileEntryPtr> FilesOrigin::getFiles() const
 {
-  std::vector<FileEntryPtr> result;
+  std::vector<FileIndex> indices;
 
   {
     std::scoped_lock lock(m_Mutex);
-
-    for (FileIndex fileIdx : m_Files) {
-      if (FileEntryPtr p = m_FileRegister.lock()->getFile(fileIdx)) {
-        result.push_back(p);
-      }
-    }
+    indices = m_Files;
   }
 
-  return result;
+  return m_FileRegister.lock()->getFiles(indices);
 }
 
 FileEntryPtr FilesOrigin::findFile(FileIndex index) const
@@ -66,6 +64,43 @@ FileEntryPtr FilesOrigin::findFile(FileIndex index) const
   return m_FileRegister.lock()->getFile(index);
 }
 
+std::vector<FileEntryPtr> FilesOrigin::getHiddenFiles() const
+{
+  std::vector<FileIndex> indices;
+
+  {
+    std::scoped_lock lock(m_Mutex);
+    indices = m_HiddenFiles;
+  }
+
+  return m_FileRegister.lock()->getFiles(indices);
+}
+
+std::vector<FileEntryPtr> FilesOrigin::getVisibleFiles() const
+{
+  std::vector<FileIndex> indices;
+
+  {
+    std::scoped_lock lock(m_Mutex);
+
+    if (m_HiddenFiles.empty()) {
+      indices = m_Files;
+    } else {
+      indices.reserve(m_Files.size() - m_HiddenFiles.size());
+      std::set_difference(m_Files.begin(), m_Files.end(), m_HiddenFiles.begin(),
+                          m_HiddenFiles.end(), std::back_inserter(indices));
+    }
+  }
+
+  return m_FileRegister.lock()->getFiles(indices);
+}
+
+bool FilesOrigin::hasHiddenFiles() const
+{
+  std::scoped_lock lock(m_Mutex);
+  return !m_HiddenFiles.empty();
+}
+
 void FilesOrigin::enable(bool enabled)
 {
   DirectoryStats dummy;
@@ -77,40 +112,71 @@ void FilesOrigin::enable(bool enabled, DirectoryStats& stats)
   if (!enabled) {
     ++stats.originsNeededEnabled;
 
-    std::set<FileIndex> copy;
+    std::vector<FileIndex> files;
 
     {
       std::scoped_lock lock(m_Mutex);
-      copy = m_Files;
-      m_Files.clear();
+      files.swap(m_Files);
+      m_HiddenFiles.clear();
     }
 
-    m_FileRegister.lock()->removeOriginMulti(copy, m_ID);
+    m_FileRegister.lock()->removeOriginMulti(files, m_ID);
   }
 
   m_Disabled = !enabled;
 }
 
-void FilesOrigin::removeFile(FileIndex index)
+// adds `index` to the sorted `indices` if it's not there yet
+static void insertSorted(std::vector<FileIndex>& indices, FileIndex index)
+{
+  if (indices.empty() || indices.back() < index) {
+    indices.push_back(index);
+    return;
+  }
+
+  auto iter = std::lower_bound(indices.begin(), indices.end(), index);
+
+  if (iter == indices.end() || *iter != index) {
+    indices.insert(iter, index);
+  }
+}
+
+static void eraseSorted(std::vector<FileIndex>& indices, FileIndex index)
+{
+  auto iter = std::lower_bound(indices.begin(), indices.end(), index);
+
+  if (iter != indices.end() && *iter == index) {
+    indices.erase(iter);
+  }
+}
+
+void FilesOrigin::addFile(FileIndex index, bool hidden)
 {
   std::scoped_lock lock(m_Mutex);
 
-  auto iter = m_Files.find(index);
+  insertSorted(m_Files, index);
 
-  if (iter != m_Files.end()) {
-    m_Files.erase(iter);
+  if (hidden) {
+    insertSorted(m_HiddenFiles, index);
   }
 }
 
-bool FilesOrigin::containsArchive(std::wstring archiveName)
+void FilesOrigin::removeFile(FileIndex index)
 {
   std::scoped_lock lock(m_Mutex);
 
-  for (FileIndex fileIdx : m_Files) {
-    if (FileEntryPtr p = m_FileRegister.lock()->getFile(fileIdx)) {
-      if (p->isFromArchive(archiveName)) {
-        return true;
-      }
+  eraseSorted(m_Files, index);
+
+  if (!m_HiddenFiles.empty()) {
+    eraseSorted(m_HiddenFiles, index);
+  }
+}
+
+bool FilesOrigin::containsArchive(std::wstring archiveName)
+{
+  for (const FileEntryPtr& p : getFiles()) {
+    if (p->isFromArchive(archiveName)) {
+      return true;
     }
   }
 
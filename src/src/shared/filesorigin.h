@@ -36,16 +36,18 @@ public:
   std::vector<FileEntryPtr> getFiles() const;
   FileEntryPtr findFile(FileIndex index) const;
 
+  // the files that are hidden or in a hidden directory, see isHiddenName(), and
+  // the others; both only look at the index kept by addFile()
+  std::vector<FileEntryPtr> getHiddenFiles() const;
+  std::vector<FileEntryPtr> getVisibleFiles() const;
+  bool hasHiddenFiles() const;
+
   void enable(bool enabled, DirectoryStats& stats);
   void enable(bool enabled);
 
   bool isDisabled() const { return m_Disabled; }
 
-  void addFile(FileIndex index)
-  {
-    std::scoped_lock lock(m_Mutex);
-    m_Files.insert(index);
-  }
+  void addFile(FileIndex index, bool hidden = false);
 
   void removeFile(FileIndex index);
 
@@ -54,7 +56,13 @@ public:
 private:
   OriginID m_ID;
   bool m_Disabled;
-  std::set<FileIndex> m_Files;
+
+  // sorted; indices are handed out in increasing order, so adding a file is
+  // nearly always an append
+  std::vector<FileIndex> m_Files;
+
+  // sorted subset of m_Files
+  std::vector<FileIndex> m_HiddenFiles;
   std::wstring m_Name;
   std::wstring m_Path;
   int m_Priority;
@@ -169,9 +169,7 @@ std::wstring ToLowerCopy(const std::wstring& text)
 #else
 std::string& ToLowerInPlace(std::string& text)
 {
-  std::transform(text.begin(), text.end(), text.begin(), [](char c) {
-    return std::tolower(static_cast<unsigned char>(c));
-  });
+  foldAsciiInPlace(text.data(), text.size());
   return text;
 }
 
@@ -183,9 +181,7 @@ std::string ToLowerCopy(const std::string& text)
 
 std::wstring& ToLowerInPlace(std::wstring& text)
 {
-  std::transform(text.begin(), text.end(), text.begin(), [](wchar_t c) {
-    return std::towlower(c);
-  });
+  foldInPlace(text.data(), text.size());
   return text;
 }
 
@@ -203,6 +199,17 @@ std::wstring ToLowerCopy(std::wstring_view text)
   return result;
 }
 
+std::size_t ToLowerHashedInPlace(std::wstring& text)
+{
+#ifdef _WIN32
+  // CharLowerBuffW() folds some characters towlower() doesn't
+  ToLowerInPlace(text);
+  return hashFolded(text);
+#else
+  return foldAndHashInPlace(text.data(), text.size());
+#endif
+}
+
 bool CaseInsenstiveComparePred(wchar_t lhs, wchar_t rhs)
 {
   return std::tolower(lhs, loc) == std::tolower(rhs, loc);
@@ -53,6 +53,10 @@ std::wstring& ToLowerInPlace(std::wstring& text);
 std::wstring ToLowerCopy(const std::wstring& text);
 std::wstring ToLowerCopy(std::wstring_view text);
 
+// lowercases `text` and returns DirectoryEntryFileKey::getHash() of the result,
+// in one pass where possible
+std::size_t ToLowerHashedInPlace(std::wstring& text);
+
 bool CaseInsensitiveEqual(const std::wstring& lhs, const std::wstring& rhs);
 
 MOBase::Version createVersionInfo();
@@ -1008,6 +1008,13 @@ pid_t startBinary(QWidget* parent, const SpawnParameters& sp)
 
   return pid;
 }
+
+void prewarmLaunch()
+{
+  ProtonLauncher::prewarm(resolveProtonPath(), resolvePrefixPath(),
+                          QSettings().value("fluorine/use_umu", true).toBool(),
+                          QSettings().value("fluorine/use_steam_run", false).toBool());
+}
 #endif
 
 #ifdef _WIN32
@@ -78,6 +78,12 @@ bool checkBlacklist(QWidget* parent, const SpawnParameters& sp, Settings& settin
 HANDLE startBinary(QWidget* parent, const SpawnParameters& sp);
 #else
 pid_t startBinary(QWidget* parent, const SpawnParameters& sp);
+
+/**
+ * @brief starts the parts of a launch that don't need the vfs on a worker thread,
+ * so they run while the vfs is mounted; the next startBinary() waits for them
+ **/
+void prewarmLaunch();
 #endif
 
 enum class FileExecutionTypes
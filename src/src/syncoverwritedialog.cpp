@@ -18,6 +18,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "syncoverwritedialog.h"
+#include "dircopy.h"
 #include "shared/directoryentry.h"
 #include "shared/fileentry.h"
 #include "shared/filesorigin.h"
@@ -30,7 +31,15 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QComboBox>
 #include <QDir>
 #include <QDirIterator>
+#include <QSet>
 #include <QStringList>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <unistd.h>
 
 using namespace MOBase;
 using namespace MOShared;
@@ -131,7 +140,8 @@ void SyncOverwriteDialog::refresh(const QString& path)
 }
 
 void SyncOverwriteDialog::applyTo(QTreeWidgetItem* item, const QString& path,
-                                  const QString& modDirectory)
+                                  const QString& modDirectory, std::vector<Move>& moves,
+                                  QStringList& directories)
 {
   for (int i = 0; i < item->childCount(); ++i) {
     QTreeWidgetItem* child = item->child(i);
@@ -142,7 +152,7 @@ void SyncOverwriteDialog::applyTo(QTreeWidgetItem* item, const QString& path,
       filePath = child->text(0);
     }
     if (child->childCount() != 0) {
-      applyTo(child, filePath, modDirectory);
+      applyTo(child, filePath, modDirectory, moves, directories);
     } else {
       QComboBox* comboBox =
           qobject_cast<QComboBox*>(ui->syncTree->itemWidget(child, 1));
@@ -151,26 +161,95 @@ void SyncOverwriteDialog::applyTo(QTreeWidgetItem* item, const QString& path,
             comboBox->itemData(comboBox->currentIndex(), Qt::UserRole).toInt();
         if (originID != -1) {
           FilesOrigin& origin = m_DirectoryStructure->getOriginByID(originID);
-          QString source      = m_SourcePath + "/" + filePath;
-          QString destination =
-              modDirectory + "/" + ToQString(origin.getName()) + "/" + filePath;
-          if (!QFile::remove(destination)) {
-            reportError(tr("failed to remove %1").arg(destination));
-          } else if (!QFile::rename(source, destination)) {
-            reportError(tr("failed to move %1 to %2").arg(source).arg(destination));
-          }
+          const QString mod   = ToQString(origin.getName());
+          moves.push_back({m_SourcePath + "/" + filePath,
+                           modDirectory + "/" + mod + "/" + filePath,
+                           {mod, filePath}});
         }
       }
     }
   }
 
-  QDir dir(m_SourcePath + "/" + path);
-  if ((path.length() > 0) && (dir.count() == 2)) {
-    dir.rmpath(".");
+  if (path.length() > 0) {
+    directories.append(m_SourcePath + "/" + path);
+  }
+}
+
+// puts `source` in place of `destination`: a rename replaces it in one step if
+// both are on the same filesystem, otherwise the file is cloned and removed;
+// returns an error message or an empty string
+//
+static QString moveFile(const QString& source, const QString& destination)
+{
+  const QByteArray src = QFile::encodeName(source);
+  const QByteArray dst = QFile::encodeName(destination);
+
+  if (std::rename(src.constData(), dst.constData()) == 0) {
+    return {};
+  }
+
+  if (errno != EXDEV) {
+    return SyncOverwriteDialog::tr("failed to move %1 to %2: %3")
+        .arg(source, destination, QString::fromLocal8Bit(strerror(errno)));
+  }
+
+  if (unlink(dst.constData()) != 0 && errno != ENOENT) {
+    return SyncOverwriteDialog::tr("failed to remove %1").arg(destination);
+  }
+
+  if (!cloneFile(source, destination)) {
+    return SyncOverwriteDialog::tr("failed to move %1 to %2").arg(source, destination);
+  }
+
+  if (unlink(src.constData()) != 0) {
+    return SyncOverwriteDialog::tr("failed to remove %1").arg(source);
   }
+
+  return {};
 }
 
-void SyncOverwriteDialog::apply(const QString& modDirectory)
+std::vector<SyncOverwriteDialog::SyncedFile>
+SyncOverwriteDialog::apply(const QString& modDirectory)
 {
-  applyTo(ui->syncTree->topLevelItem(0), "", modDirectory);
+  std::vector<Move> moves;
+  QStringList directories;
+  applyTo(ui->syncTree->topLevelItem(0), "", modDirectory, moves, directories);
+
+  // the files of a directory usually go to the same mod, so this is only a
+  // handful of directories instead of one check per file
+  QSet<QString> parents;
+  for (const auto& move : moves) {
+    parents.insert(QFileInfo(move.destination).path());
+  }
+  for (const auto& parent : parents) {
+    if (!QDir().mkpath(parent)) {
+      log::error("failed to create {}", parent);
+    }
+  }
+
+  std::mutex mutex;
+  std::vector<SyncedFile> moved;
+  QStringList errors;
+
+  QtConcurrent::blockingMap(moves, [&](const Move& move) {
+    const QString error = moveFile(move.source, move.destination);
+
+    std::scoped_lock lock(mutex);
+    if (error.isEmpty()) {
+      moved.push_back(move.file);
+    } else {
+      errors.append(error);
+    }
+  });
+
+  for (const auto& error : errors) {
+    reportError(error);
+  }
+
+  // only removes the ones that are empty now
+  for (const auto& directory : directories) {
+    QDir().rmdir(directory);
+  }
+
+  return moved;
 }
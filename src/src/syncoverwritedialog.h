@@ -23,6 +23,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "shared/fileregisterfwd.h"
 #include "tutorabledialog.h"
 #include <QTreeWidgetItem>
+#include <vector>
 
 namespace Ui
 {
@@ -40,13 +41,34 @@ public:
 
   ~SyncOverwriteDialog();
 
-  void apply(const QString& modDirectory);
+  // a file of overwrite that replaced the one of `mod`, `path` is relative to
+  // both
+  struct SyncedFile
+  {
+    QString mod;
+    QString path;
+  };
+
+  // moves the files as selected, in parallel; returns the ones that were moved
+  //
+  std::vector<SyncedFile> apply(const QString& modDirectory);
 
 private:
+  struct Move
+  {
+    QString source;
+    QString destination;
+    SyncedFile file;
+  };
+
   void refresh(const QString& path);
   void readTree(const QString& path, MOShared::DirectoryEntry* directoryStructure,
                 QTreeWidgetItem* subTree);
-  void applyTo(QTreeWidgetItem* item, const QString& path, const QString& modDirectory);
+
+  // collects the selected moves below `item` and the directories of overwrite,
+  // subdirectories before their parents
+  void applyTo(QTreeWidgetItem* item, const QString& path, const QString& modDirectory,
+               std::vector<Move>& moves, QStringList& directories);
 
 private:
   Ui::SyncOverwriteDialog* ui;
@@ -1,13 +1,17 @@
 #include "texteditor.h"
 #include "utility.h"
+#include <QFileInfo>
+#include <QScrollBar>
 #include <QSplitter>
+#include <QTextCursor>
 #include <log.h>
 
 using namespace MOBase;
 
 TextEditor::TextEditor(QWidget* parent)
     : QPlainTextEdit(parent), m_toolbar(nullptr), m_lineNumbers(nullptr),
-      m_highlighter(nullptr), m_dirty(false), m_loading(false)
+      m_highlighter(nullptr), m_dirty(false), m_loading(false), m_pagedData(nullptr),
+      m_pagedOffset(0)
 {
   m_toolbar     = new TextEditorToolbar(*this);
   m_lineNumbers = new TextEditorLineNumbers(*this);
@@ -25,6 +29,13 @@ TextEditor::TextEditor(QWidget* parent)
   connect(this, &QPlainTextEdit::cursorPositionChanged, [&] {
     highlightCurrentLine();
   });
+
+  connect(verticalScrollBar(), &QScrollBar::valueChanged, [&](int value) {
+    const auto* bar = verticalScrollBar();
+    if (m_pagedFile && value >= bar->maximum() - bar->pageStep()) {
+      appendPage();
+    }
+  });
 }
 
 void TextEditor::setDefaultStyle()
@@ -63,6 +74,8 @@ void TextEditor::clear()
 {
   QScopedValueRollback loading(m_loading, true);
 
+  endPaging();
+
   m_filename.clear();
   m_encoding.clear();
   m_needsBOM = false;
@@ -81,6 +94,11 @@ bool TextEditor::load(const QString& filename)
 
   m_filename = filename;
 
+  if (QFileInfo(filename).size() > LargeFileSize && loadPaged()) {
+    emit loaded(m_filename);
+    return true;
+  }
+
   const QString s = MOBase::readFileText(filename, &m_encoding, &m_needsBOM);
 
   setPlainText(s);
@@ -97,11 +115,96 @@ bool TextEditor::load(const QString& filename)
   return true;
 }
 
+bool TextEditor::loadPaged()
+{
+  auto file = std::make_unique<QFile>(m_filename);
+  if (!file->open(QIODevice::ReadOnly)) {
+    return false;
+  }
+
+  const uchar* data = file->map(0, file->size());
+  if (data == nullptr) {
+    return false;
+  }
+
+  // the encoding is guessed from the first page, cut after a line so a character
+  // split by the page doesn't throw the guess off
+  const auto* chars = reinterpret_cast<const char*>(data);
+  const auto newline =
+      QByteArrayView(chars, std::min(PageSize, file->size())).lastIndexOf('\n');
+  decodeTextData(QByteArray::fromRawData(chars, newline > 0 ? newline + 1 : PageSize),
+                 &m_encoding, &m_needsBOM);
+
+  const auto encoding = QStringConverter::encodingForName(m_encoding.toUtf8());
+  if (!encoding.has_value()) {
+    return false;
+  }
+
+  m_pagedFile = std::move(file);
+  m_pagedDecoder.emplace(*encoding, QStringConverter::Flag::ConvertInitialBom);
+  m_pagedData   = data;
+  m_pagedOffset = 0;
+
+  // appending pages must not be undone
+  document()->setUndoRedoEnabled(false);
+  setReadOnly(true);
+
+  appendPage();
+
+  return true;
+}
+
+void TextEditor::appendPage()
+{
+  if (!m_pagedFile) {
+    return;
+  }
+
+  QScopedValueRollback loading(m_loading, true);
+
+  const qint64 size   = m_pagedFile->size();
+  const qint64 length = std::min(PageSize, size - m_pagedOffset);
+
+  // the decoder keeps the state of a character split between pages
+  QString text = m_pagedDecoder->decode(
+      QByteArrayView(m_pagedData + m_pagedOffset, static_cast<qsizetype>(length)));
+  if (m_pagedOffset == 0 && text.startsWith(QChar::ByteOrderMark)) {
+    text.remove(0, 1);
+  }
+  m_pagedOffset += length;
+
+  QTextCursor cursor(document());
+  cursor.movePosition(QTextCursor::End);
+  cursor.insertText(text);
+  document()->setModified(false);
+
+  if (m_pagedOffset >= size) {
+    endPaging();
+  }
+}
+
+void TextEditor::endPaging()
+{
+  if (!m_pagedFile) {
+    return;
+  }
+
+  // closing the file unmaps it
+  m_pagedFile.reset();
+  m_pagedDecoder.reset();
+  m_pagedData   = nullptr;
+  m_pagedOffset = 0;
+
+  document()->setUndoRedoEnabled(true);
+  setReadOnly(false);
+}
+
 bool TextEditor::save()
 {
-  if (m_filename.isEmpty() || m_encoding.isEmpty()) {
-    return false;
-  }
+  // only part of the file is shown
+  if (m_filename.isEmpty() || m_encoding.isEmpty() || m_pagedFile) {
+    return false;
+  }
 
   QFile file(m_filename);
   if (!file.open(QIODevice::WriteOnly)) {
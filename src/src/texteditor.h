@@ -1,7 +1,11 @@
 #ifndef MO_TEXTEDITOR_H
 #define MO_TEXTEDITOR_H
 
+#include <QFile>
 #include <QPlainTextEdit>
+#include <QStringDecoder>
+#include <memory>
+#include <optional>
 
 class TextEditor;
 
@@ -124,6 +128,10 @@ protected:
   void resizeEvent(QResizeEvent* e) override;
 
 private:
+  // files larger than this are shown a page at a time
+  static constexpr qint64 LargeFileSize = 4 * 1024 * 1024;
+  static constexpr qint64 PageSize      = 1024 * 1024;
+
   TextEditorToolbar* m_toolbar;
   TextEditorLineNumbers* m_lineNumbers;
   TextEditorHighlighter* m_highlighter;
@@ -134,6 +142,17 @@ private:
   bool m_dirty;
   bool m_loading;
 
+  // a large file is mapped and decoded one page after the other as the view is
+  // scrolled to the end of what's shown; it's read-only until all of it is
+  std::unique_ptr<QFile> m_pagedFile;
+  std::optional<QStringDecoder> m_pagedDecoder;
+  const uchar* m_pagedData;
+  qint64 m_pagedOffset;
+
+  bool loadPaged();
+  void appendPage();
+  void endPaging();
+
   void setDefaultStyle();
   void onModified(bool b);
   void dirty(bool b);
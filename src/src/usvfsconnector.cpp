@@ -210,9 +210,15 @@ void UsvfsConnector::updateMapping(const MappingType& mapping)
 
   usvfsClearVirtualMappings();
 
-  for (auto map : mapping) {
+  // the links point into these strings, reserving keeps them from moving
+  std::vector<std::wstring> paths;
+  paths.reserve(mapping.size() * 2);
+
+  std::vector<usvfsVirtualLink> links;
+  links.reserve(mapping.size());
+
+  for (const auto& map : mapping) {
     if (progress.wasCanceled()) {
-      usvfsClearVirtualMappings();
       throw UsvfsConnectorException("VFS mapping canceled by user");
     }
     progress.setValue(value++);
@@ -220,18 +226,30 @@ void UsvfsConnector::updateMapping(const MappingType& mapping)
       QCoreApplication::processEvents();
     }
 
+    const auto& source      = paths.emplace_back(map.source.toStdWString());
+    const auto& destination = paths.emplace_back(map.destination.toStdWString());
+
     if (map.isDirectory) {
-      usvfsVirtualLinkDirectoryStatic(
-          map.source.toStdWString().c_str(), map.destination.toStdWString().c_str(),
-          (map.createTarget ? LINKFLAG_CREATETARGET : 0) | LINKFLAG_RECURSIVE);
+      links.push_back(
+          {source.c_str(), destination.c_str(),
+           (map.createTarget ? LINKFLAG_CREATETARGET : 0) | LINKFLAG_RECURSIVE, TRUE});
       ++dirs;
     } else {
-      usvfsVirtualLinkFile(map.source.toStdWString().c_str(),
-                           map.destination.toStdWString().c_str(), 0);
+      links.push_back({source.c_str(), destination.c_str(), 0, FALSE});
       ++files;
     }
   }
 
+  // everything is linked in one call, the dialog can't show progress anymore
+  progress.setLabelText(tr("Linking files"));
+  progress.setMaximum(0);
+  QCoreApplication::processEvents();
+
+  if (!usvfsVirtualLinkMany(links.data(), links.size())) {
+    const auto e = GetLastError();
+    log::debug("some VFS mappings failed, last error: {}", formatSystemMessage(e));
+  }
+
   const auto end  = std::chrono::high_resolution_clock::now();
   const auto time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 
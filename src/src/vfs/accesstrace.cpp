@@ -0,0 +1,242 @@
+#include "accesstrace.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+namespace fs = std::filesystem;
+
+constexpr char Magic[8]    = {'M', 'O', '2', 'V', 'F', 'S', 'A', 'T'};
+constexpr uint32_t Version = 1;
+
+template <class T>
+void put(std::ofstream& out, T value)
+{
+  out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <class T>
+bool get(std::ifstream& in, T& value)
+{
+  return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+}  // namespace
+
+void VfsAccessTrace::start(std::string path)
+{
+  stop();
+
+  Trace previous;
+  if (!load(path, previous)) {
+    previous = {};
+  }
+
+  std::scoped_lock lock(m_mutex);
+  m_path     = std::move(path);
+  m_previous = std::move(previous);
+  m_deadline = std::chrono::steady_clock::now() + RecordWindow;
+  m_cancelled.store(false, std::memory_order_relaxed);
+  m_recording.store(true, std::memory_order_relaxed);
+}
+
+bool VfsAccessTrace::stop()
+{
+  Trace recorded;
+  std::string path;
+  {
+    std::scoped_lock lock(m_mutex);
+    m_recording.store(false, std::memory_order_relaxed);
+    recorded   = std::move(m_recorded);
+    path       = m_path;
+    m_recorded = {};
+    m_fileIds.clear();
+    m_seen.clear();
+  }
+
+  // a launch that didn't read anything keeps the trace of the one before
+  if (path.empty() || recorded.chunks.empty()) {
+    return true;
+  }
+
+  return save(path, recorded);
+}
+
+void VfsAccessTrace::record(const std::string& realPath, bool isBacking,
+                            int64_t offset)
+{
+  if (!m_recording.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  const auto index = static_cast<uint32_t>(std::max<int64_t>(offset, 0) / ChunkSize);
+
+  std::scoped_lock lock(m_mutex);
+  if (!m_recording.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  if (m_recorded.chunks.size() >= MaxChunks ||
+      std::chrono::steady_clock::now() > m_deadline) {
+    m_recording.store(false, std::memory_order_relaxed);
+    return;
+  }
+
+  std::string key;
+  key.reserve(realPath.size() + 1);
+  key += isBacking ? 'b' : 'r';
+  key += realPath;
+
+  const auto [it, added] = m_fileIds.try_emplace(
+      std::move(key), static_cast<uint32_t>(m_recorded.files.size()));
+  if (added) {
+    m_recorded.files.push_back({realPath, isBacking});
+  }
+
+  if (m_seen.insert((static_cast<uint64_t>(it->second) << 32) | index).second) {
+    m_recorded.chunks.push_back({it->second, index});
+  }
+}
+
+void VfsAccessTrace::replay(int backingDirFd)
+{
+  Trace trace;
+  {
+    std::scoped_lock lock(m_mutex);
+    trace      = std::move(m_previous);
+    m_previous = {};
+  }
+
+  uint64_t budget = ReplayBudget;
+  size_t i        = 0;
+
+  while (i < trace.chunks.size() && budget > 0 &&
+         !m_cancelled.load(std::memory_order_relaxed)) {
+    // runs of consecutive chunks of a file go out as one range, files are
+    // opened per range so a long trace doesn't pile up descriptors
+    const Chunk first = trace.chunks[i];
+    size_t count      = 1;
+    while (i + count < trace.chunks.size() &&
+           trace.chunks[i + count].file == first.file &&
+           trace.chunks[i + count].index == first.index + count) {
+      ++count;
+    }
+    i += count;
+
+    const File& file = trace.files[first.file];
+    int fd           = -1;
+    if (!file.is_backing) {
+      fd = open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+    } else if (backingDirFd >= 0) {
+      fd = openat(backingDirFd, file.path.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    if (fd < 0) {
+      continue;
+    }
+
+    const uint64_t length = std::min<uint64_t>(uint64_t(count) * ChunkSize, budget);
+    readahead(fd, static_cast<off64_t>(first.index) * ChunkSize, length);
+    close(fd);
+
+    budget -= length;
+  }
+}
+
+void VfsAccessTrace::cancel()
+{
+  m_cancelled.store(true, std::memory_order_relaxed);
+}
+
+bool VfsAccessTrace::load(const std::string& path, Trace& trace)
+{
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+
+  char magic[sizeof(Magic)] = {};
+  uint32_t version          = 0;
+  uint32_t fileCount        = 0;
+
+  if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, Magic, sizeof(Magic)) != 0 ||
+      !get(in, version) || version != Version || !get(in, fileCount) ||
+      fileCount > MaxChunks) {
+    return false;
+  }
+
+  trace.files.resize(fileCount);
+  for (auto& file : trace.files) {
+    uint8_t isBacking = 0;
+    uint32_t size     = 0;
+    if (!get(in, isBacking) || !get(in, size) || size > 4096) {
+      return false;
+    }
+    file.is_backing = isBacking != 0;
+    file.path.resize(size);
+    if (!in.read(file.path.data(), size)) {
+      return false;
+    }
+  }
+
+  uint32_t chunkCount = 0;
+  if (!get(in, chunkCount) || chunkCount > MaxChunks) {
+    return false;
+  }
+
+  trace.chunks.resize(chunkCount);
+  for (auto& chunk : trace.chunks) {
+    if (!get(in, chunk.file) || !get(in, chunk.index) || chunk.file >= fileCount) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool VfsAccessTrace::save(const std::string& path, const Trace& trace)
+{
+  const std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return false;
+    }
+
+    out.write(Magic, sizeof(Magic));
+    put(out, Version);
+
+    put(out, static_cast<uint32_t>(trace.files.size()));
+    for (const auto& file : trace.files) {
+      put(out, static_cast<uint8_t>(file.is_backing ? 1 : 0));
+      put(out, static_cast<uint32_t>(file.path.size()));
+      out.write(file.path.data(), static_cast<std::streamsize>(file.path.size()));
+    }
+
+    put(out, static_cast<uint32_t>(trace.chunks.size()));
+    for (const auto& chunk : trace.chunks) {
+      put(out, chunk.file);
+      put(out, chunk.index);
+    }
+
+    if (!out.flush()) {
+      std::remove(tmpPath.c_str());
+      return false;
+    }
+  }
+
+  std::error_code ec;
+  fs::rename(tmpPath, path, ec);
+  if (ec) {
+    fs::remove(tmpPath, ec);
+    return false;
+  }
+
+  return true;
+}
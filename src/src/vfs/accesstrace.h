@@ -0,0 +1,96 @@
+#ifndef VFS_ACCESSTRACE_H
+#define VFS_ACCESSTRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Order in which a launch read its files, recorded per profile so the next
+// launch can have them in the page cache before the game asks for them.
+//
+// Recording starts with start() and covers the first RecordWindow of the
+// launch: every open and read of a file outside of archives adds the chunk it
+// touches, once, in the order they came in.  replay() issues readahead() for
+// what the previous launch of the profile recorded, in that order, while the
+// prefix and the game start up.
+//
+// record() is called from the FUSE workers and is a single atomic load when
+// nothing is recorded; everything else is thread-safe as well.
+//
+class VfsAccessTrace
+{
+public:
+  static constexpr uint32_t ChunkSize = 1024 * 1024;
+  static constexpr size_t MaxChunks   = 64 * 1024;
+  static constexpr std::chrono::seconds RecordWindow{180};
+
+  // page cache a replay may fill at most, the rest is left to the game
+  static constexpr uint64_t ReplayBudget = 4ull * 1024 * 1024 * 1024;
+
+  // writes the current recording if there is one, then records into `path`;
+  // what was recorded there the last time is kept for replay()
+  //
+  void start(std::string path);
+
+  // stops recording and writes what was recorded; false if it can't be
+  // written
+  //
+  bool stop();
+
+  // the chunk at `offset` of `realPath` was read; backing files are relative
+  // to the data directory, see Mo2FsContext::OpenFile
+  //
+  void record(const std::string& realPath, bool isBacking, int64_t offset);
+
+  // reads ahead the previous recording of the current path, returns once
+  // it's done or cancel() was called; backing files are opened through
+  // `backingDirFd`
+  //
+  void replay(int backingDirFd);
+  void cancel();
+
+  bool recording() const { return m_recording.load(std::memory_order_relaxed); }
+
+private:
+  struct File
+  {
+    std::string path;
+    bool is_backing = false;
+  };
+
+  struct Chunk
+  {
+    uint32_t file  = 0;
+    uint32_t index = 0;
+  };
+
+  struct Trace
+  {
+    std::vector<File> files;
+    std::vector<Chunk> chunks;
+  };
+
+  static bool load(const std::string& path, Trace& trace);
+  static bool save(const std::string& path, const Trace& trace);
+
+  std::atomic<bool> m_recording{false};
+  std::atomic<bool> m_cancelled{false};
+
+  mutable std::mutex m_mutex;
+  std::string m_path;
+  std::chrono::steady_clock::time_point m_deadline;
+  Trace m_recorded;
+  Trace m_previous;
+
+  // index in m_recorded.files by path, prefixed with 'b' for backing files
+  // and 'r' for the others
+  std::unordered_map<std::string, uint32_t> m_fileIds;
+  std::unordered_set<uint64_t> m_seen;
+};
+
+#endif
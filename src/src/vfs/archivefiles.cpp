@@ -0,0 +1,276 @@
+#include "archivefiles.h"
+#include "taskpool.h"
+
+#include <bsatk/bsatk.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <unordered_set>
+#include <utility>
+
+namespace
+{
+namespace fs = std::filesystem;
+
+bool isArchiveName(std::string_view name)
+{
+  const auto dot = name.rfind('.');
+  if (dot == std::string_view::npos) {
+    return false;
+  }
+  const std::string ext = normalizeForLookup(name.substr(dot + 1));
+  return ext == "bsa" || ext == "ba2";
+}
+
+std::chrono::system_clock::time_point archiveMtime(const std::string& path)
+{
+  std::error_code ec;
+  const auto mtime = fs::last_write_time(path, ec);
+  if (ec) {
+    return {};
+  }
+  return std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+      std::chrono::file_clock::to_sys(mtime));
+}
+
+// Lists the files of `folder` and everything below it into `out`, preceded by
+// an entry for every directory they need that isn't listed yet.  Files whose
+// size can't be worked out are left out, reading them would fail as well.
+void listFolder(const BSA::Archive& archive, const BSA::Folder::Ptr& folder,
+                const std::string& path, std::chrono::system_clock::time_point mtime,
+                std::unordered_set<std::string>& dirs, std::vector<CachedBaseFile>& out)
+{
+  const auto fileCount = folder->getNumFiles();
+
+  if (fileCount > 0 && !path.empty()) {
+    for (size_t sep = path.find('/'); ; sep = path.find('/', sep + 1)) {
+      std::string dir = path.substr(0, sep);
+      if (dirs.insert(normalizeForLookup(dir)).second) {
+        CachedBaseFile cf;
+        cf.relative_path = std::move(dir);
+        cf.mtime         = mtime;
+        cf.is_dir        = true;
+        out.push_back(std::move(cf));
+      }
+      if (sep == std::string::npos) {
+        break;
+      }
+    }
+  }
+
+  for (unsigned int i = 0; i < fileCount; ++i) {
+    const BSA::File::Ptr file = folder->getFile(i);
+
+    BSAULong size = 0;
+    if (archive.getContentSize(file, size) != BSA::ERROR_NONE) {
+      continue;
+    }
+
+    CachedBaseFile cf;
+    cf.relative_path = path.empty() ? file->getName() : path + "/" + file->getName();
+    cf.size          = size;
+    cf.mtime         = mtime;
+    out.push_back(std::move(cf));
+  }
+
+  const auto dirCount = folder->getNumSubFolders();
+  for (unsigned int i = 0; i < dirCount; ++i) {
+    const BSA::Folder::Ptr sub = folder->getSubFolder(i);
+    std::string name           = sub->getName();
+    std::replace(name.begin(), name.end(), '\\', '/');
+    listFolder(archive, sub, path.empty() ? name : path + "/" + name, mtime, dirs,
+               out);
+  }
+}
+
+// an archive of a mod and the layer listing it
+struct ArchiveLayer
+{
+  size_t owner = 0;  // index of the mod's layer
+  std::string origin;
+  std::string path;
+  std::shared_ptr<const VfsLayer> layer;
+  std::shared_ptr<const BSA::Archive> archive;
+};
+
+void scanArchive(ArchiveLayer& out)
+{
+  const auto mtime = archiveMtime(out.path);
+
+  auto archive = std::make_shared<BSA::Archive>();
+  if (archive->read(out.path.c_str(), false) != BSA::ERROR_NONE) {
+    return;
+  }
+
+  auto layer          = std::make_shared<VfsLayer>();
+  layer->origin       = out.origin;
+  layer->root         = out.path;
+  layer->from_archive = true;
+  layer->root_mtime   = mtime;
+
+  std::unordered_set<std::string> dirs;
+  listFolder(*archive, archive->getRoot(), {}, mtime, dirs, layer->entries);
+
+  out.layer   = std::move(layer);
+  out.archive = std::move(archive);
+}
+
+}  // namespace
+
+VfsLayerList ArchiveFiles::addLayers(const VfsLayerList& layers,
+                                     const VfsLayerList& previous)
+{
+  std::unordered_map<std::string, std::shared_ptr<const VfsLayer>> reusable;
+  for (const auto& layer : previous) {
+    if (layer != nullptr && layer->from_archive) {
+      reusable.emplace(layer->root, layer);
+    }
+  }
+
+  std::vector<ArchiveLayer> archives;
+  for (size_t i = 0; i < layers.size(); ++i) {
+    const auto& layer = layers[i];
+    if (layer == nullptr || layer->is_backing || layer->from_archive) {
+      continue;
+    }
+
+    std::vector<std::string> names;
+    for (const auto& cf : layer->entries) {
+      if (!cf.is_dir && cf.relative_path.find('/') == std::string::npos &&
+          isArchiveName(cf.relative_path)) {
+        names.push_back(cf.relative_path);
+      }
+    }
+    std::sort(names.begin(), names.end());
+
+    for (const auto& name : names) {
+      archives.push_back({i, layer->origin, layer->root + "/" + name, {}, {}});
+    }
+  }
+
+  {
+    std::scoped_lock lock(m_mutex);
+    for (auto& a : archives) {
+      auto it = m_archives.find(a.path);
+      if (it != m_archives.end()) {
+        a.archive = it->second;
+      }
+    }
+  }
+
+  parallelFor(archives.size(), [&](size_t i) {
+    ArchiveLayer& a = archives[i];
+
+    auto it = reusable.find(a.path);
+    if (a.archive == nullptr || it == reusable.end() || !layerIsCurrent(*it->second)) {
+      a.archive = nullptr;
+      scanArchive(a);
+    } else if (it->second->origin != a.origin) {
+      // same archive under another name, copying beats listing it again
+      auto renamed    = std::make_shared<VfsLayer>(*it->second);
+      renamed->origin = a.origin;
+      a.layer         = std::move(renamed);
+    } else {
+      a.layer = it->second;
+    }
+  });
+
+  VfsLayerList out;
+  out.reserve(layers.size() + archives.size());
+
+  std::unordered_map<std::string, std::shared_ptr<const BSA::Archive>> opened;
+  auto next = archives.begin();
+  for (size_t i = 0; i < layers.size(); ++i) {
+    for (; next != archives.end() && next->owner == i; ++next) {
+      if (next->layer != nullptr) {
+        out.push_back(next->layer);
+        opened.insert_or_assign(next->path, next->archive);
+      }
+    }
+    out.push_back(layers[i]);
+  }
+
+  std::scoped_lock lock(m_mutex);
+
+  const bool kept =
+      std::all_of(m_archives.begin(), m_archives.end(), [&](const auto& a) {
+        auto it = opened.find(a.first);
+        return it != opened.end() && it->second == a.second;
+      });
+  if (!kept) {
+    // cached contents may belong to archives that were replaced
+    m_cache.clear();
+    m_cacheIndex.clear();
+    m_cacheSize = 0;
+  }
+  m_archives = std::move(opened);
+
+  return out;
+}
+
+std::shared_ptr<const ArchiveFiles::Content>
+ArchiveFiles::read(const std::string& archive, const std::string& entry)
+{
+  std::string key = archive;
+  key.push_back('\0');
+  key.append(normalizeForLookup(entry));
+
+  std::shared_ptr<const BSA::Archive> opened;
+  {
+    std::scoped_lock lock(m_mutex);
+    if (auto it = m_cacheIndex.find(key); it != m_cacheIndex.end()) {
+      m_cache.splice(m_cache.begin(), m_cache, it->second);
+      return it->second->content;
+    }
+
+    auto it = m_archives.find(archive);
+    if (it == m_archives.end()) {
+      return nullptr;
+    }
+    opened = it->second;
+  }
+
+  // decompressed without the lock, two readers of the same file may both do
+  // it but only one result is cached
+  const BSA::File::Ptr file = opened->getRoot()->findFile(entry);
+  if (file == nullptr) {
+    return nullptr;
+  }
+
+  auto content     = std::make_shared<Content>();
+  content->archive = opened;
+
+  BSA::Archive::DataBuffer buffer;
+  if (opened->readFile(file, content->data, buffer) != BSA::ERROR_NONE) {
+    return nullptr;
+  }
+  content->buffer = std::move(buffer.first);
+
+  if (content->buffer == nullptr) {
+    // points into the mapping, nothing worth caching
+    return content;
+  }
+
+  std::scoped_lock lock(m_mutex);
+  if (auto it = m_cacheIndex.find(key); it != m_cacheIndex.end()) {
+    return it->second->content;
+  }
+  const auto current = m_archives.find(archive);
+  if (current == m_archives.end() || current->second != opened) {
+    // the archive went away while this was read, don't keep it alive
+    return content;
+  }
+
+  m_cache.push_front({key, content});
+  m_cacheIndex.emplace(std::move(key), m_cache.begin());
+  m_cacheSize += content->data.size();
+
+  while (m_cacheSize > CacheCapacity && m_cache.size() > 1) {
+    const Cached& last = m_cache.back();
+    m_cacheSize -= last.content->data.size();
+    m_cacheIndex.erase(last.key);
+    m_cache.pop_back();
+  }
+
+  return content;
+}
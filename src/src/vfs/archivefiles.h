@@ -0,0 +1,72 @@
+#ifndef VFS_ARCHIVEFILES_H
+#define VFS_ARCHIVEFILES_H
+
+#include "vfstree.h"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+
+namespace BSA
+{
+class Archive;
+}
+
+// Serves the files in the BSA/BA2 archives of mods as loose files, see
+// Mo2FsContext::serve_archives.  Every archive at the root of a mod gets a
+// layer of its own right below the mod's, so its files win over the mods with
+// a lower priority and lose against the mod's own loose files.  Archives of
+// one mod are stacked by name, later names win.
+//
+// Archives stay mapped while they're part of the layer stack.  Files are
+// decompressed on first read and the result is kept in a cache of at most
+// CacheCapacity bytes, files stored uncompressed are served straight from the
+// mapping.
+//
+// All members are thread-safe.
+class ArchiveFiles
+{
+public:
+  static constexpr uint64_t CacheCapacity = 256 * 1024 * 1024;
+
+  // the contents of one file, keeps the archive it points into mapped
+  struct Content
+  {
+    std::shared_ptr<const BSA::Archive> archive;
+    std::span<const unsigned char> data;
+    std::shared_ptr<unsigned char[]> buffer;  // null if `data` is in the mapping
+  };
+
+  // `layers` with the archive layers of every mod inserted, reusing the
+  // archive layers in `previous` whose archive didn't change; layers of
+  // archives that are gone are released along with their mappings
+  //
+  VfsLayerList addLayers(const VfsLayerList& layers, const VfsLayerList& previous);
+
+  // the contents of `entry` in the archive at `archive`, null if the archive
+  // isn't part of the layer stack or the file can't be read
+  //
+  std::shared_ptr<const Content> read(const std::string& archive,
+                                      const std::string& entry);
+
+private:
+  struct Cached
+  {
+    std::string key;
+    std::shared_ptr<const Content> content;
+  };
+
+  std::mutex m_mutex;
+  std::unordered_map<std::string, std::shared_ptr<const BSA::Archive>> m_archives;
+
+  // most recently used first
+  std::list<Cached> m_cache;
+  std::unordered_map<std::string, std::list<Cached>::iterator> m_cacheIndex;
+  uint64_t m_cacheSize = 0;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#include "fileclone.h"
+
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+int cloneFileContents(int src, int dst)
+{
+  if (ioctl(dst, FICLONE, src) == 0) {
+    return 0;
+  }
+
+  bool useCopyRange = true;
+  for (;;) {
+    ssize_t n = -1;
+
+    if (useCopyRange) {
+      n = copy_file_range(src, nullptr, dst, nullptr, 1 << 30, 0);
+      if (n < 0 && (errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP ||
+                    errno == EINVAL)) {
+        // not supported between these files, the fds are still at the
+        // position the last successful call left them
+        useCopyRange = false;
+        continue;
+      }
+    } else {
+      char buf[65536];
+      n = read(src, buf, sizeof(buf));
+      for (ssize_t done = 0; n > 0 && done < n;) {
+        const ssize_t w = write(dst, buf + done, static_cast<size_t>(n - done));
+        if (w < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          return errno;
+        }
+        done += w;
+      }
+    }
+
+    if (n == 0) {
+      return 0;
+    }
+    if (n < 0 && errno != EINTR) {
+      return errno;
+    }
+  }
+}
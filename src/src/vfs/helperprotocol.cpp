@@ -0,0 +1,568 @@
+#include "helperprotocol.h"
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+namespace
+{
+constexpr char Magic[4]    = {'M', 'O', '2', 'H'};
+constexpr uint32_t Version = 7;
+
+constexpr char ImageMagic[8]    = {'M', 'O', '2', 'V', 'F', 'S', 'L', 'I'};
+constexpr uint32_t ImageVersion = 1;
+
+struct ImageString
+{
+  uint32_t offset;
+  uint32_t size;
+};
+
+struct ImageHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t layer_count;
+  uint64_t entry_count;
+  uint64_t strings_size;
+};
+
+struct ImageLayer
+{
+  ImageString origin;
+  ImageString root;
+  int64_t root_mtime;
+  uint64_t first_entry;
+  uint64_t entry_count;
+};
+
+struct ImageEntry
+{
+  ImageString path;
+  uint64_t size;
+  int64_t mtime;
+  uint8_t is_dir;
+  uint8_t padding[7];
+};
+
+static_assert(sizeof(ImageHeader) == 32 && sizeof(ImageLayer) == 40 &&
+              sizeof(ImageEntry) == 32);
+
+// records are copied out rather than cast, a payload inside a message
+// has no alignment guarantee
+template <class T>
+T readRecord(std::string_view image, size_t offset)
+{
+  T value;
+  std::memcpy(&value, image.data() + offset, sizeof(T));
+  return value;
+}
+
+bool writeAll(int fd, std::string_view data)
+{
+  while (!data.empty()) {
+    const ssize_t n = ::write(fd, data.data(), data.size());
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data.remove_prefix(static_cast<size_t>(n));
+  }
+  return true;
+}
+
+class Writer
+{
+public:
+  template <class T>
+  void put(T value)
+  {
+    m_out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  void putString(std::string_view s)
+  {
+    put(static_cast<uint32_t>(s.size()));
+    m_out.append(s);
+  }
+
+  void putMods(const HelperModList& mods)
+  {
+    put(static_cast<uint32_t>(mods.size()));
+    for (const auto& [name, path] : mods) {
+      putString(name);
+      putString(path);
+    }
+  }
+
+  std::string take() { return std::move(m_out); }
+
+private:
+  std::string m_out;
+};
+
+class Reader
+{
+public:
+  explicit Reader(std::string_view in) : m_in(in) {}
+
+  template <class T>
+  bool get(T& value)
+  {
+    if (m_in.size() < sizeof(value)) {
+      return false;
+    }
+    std::memcpy(&value, m_in.data(), sizeof(value));
+    m_in.remove_prefix(sizeof(value));
+    return true;
+  }
+
+  bool getBool(bool& value)
+  {
+    uint8_t b = 0;
+    if (!get(b)) {
+      return false;
+    }
+    value = b != 0;
+    return true;
+  }
+
+  bool getString(std::string& s)
+  {
+    uint32_t size = 0;
+    if (!get(size) || size > m_in.size()) {
+      return false;
+    }
+    s.assign(m_in.data(), size);
+    m_in.remove_prefix(size);
+    return true;
+  }
+
+  bool getMods(HelperModList& mods)
+  {
+    uint32_t count = 0;
+    // every entry takes at least its two sizes, so this bounds the reserve
+    if (!get(count) || count > m_in.size() / (2 * sizeof(uint32_t))) {
+      return false;
+    }
+
+    mods.clear();
+    mods.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+      auto& [name, path] = mods.emplace_back();
+      if (!getString(name) || !getString(path)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool done() const { return m_in.empty(); }
+
+private:
+  std::string_view m_in;
+};
+
+}  // namespace
+
+HelperModListDelta diffModList(const HelperModList& from, const HelperModList& to)
+{
+  const size_t common = std::min(from.size(), to.size());
+
+  size_t front = 0;
+  while (front < common && from[front] == to[front]) {
+    ++front;
+  }
+
+  size_t back = 0;
+  while (back < common - front &&
+         from[from.size() - 1 - back] == to[to.size() - 1 - back]) {
+    ++back;
+  }
+
+  HelperModListDelta delta;
+  delta.keep_front = static_cast<uint32_t>(front);
+  delta.keep_back  = static_cast<uint32_t>(back);
+  delta.middle.assign(to.begin() + front, to.end() - back);
+  return delta;
+}
+
+bool applyModListDelta(HelperModList& mods, const HelperModListDelta& delta)
+{
+  if (static_cast<size_t>(delta.keep_front) + delta.keep_back > mods.size()) {
+    return false;
+  }
+
+  const auto at = mods.erase(mods.begin() + delta.keep_front, mods.end() - delta.keep_back);
+  mods.insert(at, delta.middle.begin(), delta.middle.end());
+  return true;
+}
+
+std::string frameHelperMessage(HelperMessage type, std::string_view payload)
+{
+  Writer w;
+  w.put(static_cast<uint32_t>(payload.size()));
+  w.put(static_cast<uint8_t>(type));
+
+  std::string out = w.take();
+  out.append(payload);
+  return out;
+}
+
+void parseHelperHeader(const char* header, HelperMessage& type, uint32_t& size)
+{
+  uint8_t raw = 0;
+  std::memcpy(&size, header, sizeof(size));
+  std::memcpy(&raw, header + sizeof(size), sizeof(raw));
+  type = static_cast<HelperMessage>(raw);
+}
+
+std::string encodeHelperConfig(const HelperConfig& config)
+{
+  Writer w;
+  for (char c : Magic) {
+    w.put(c);
+  }
+  w.put(Version);
+  w.putString(config.mount_point);
+  w.putString(config.game_dir);
+  w.putString(config.data_dir_name);
+  w.putString(config.overwrite_dir);
+  w.put(static_cast<uint8_t>(config.splice_reads));
+  w.put(static_cast<uint8_t>(config.passthrough));
+  w.put(static_cast<uint8_t>(config.writeback));
+  w.put(static_cast<uint8_t>(config.archives));
+  w.put(static_cast<uint8_t>(config.lazy_copy_up));
+  w.put(static_cast<uint8_t>(config.prefetch));
+  w.put(static_cast<int32_t>(config.negative_ttl));
+  w.put(static_cast<uint32_t>(config.loop.max_threads));
+  w.put(static_cast<uint32_t>(config.loop.max_idle_threads));
+  w.put(static_cast<uint8_t>(config.loop.clone_fd));
+  w.putMods(config.mods);
+  w.putMods(config.extra_files);
+  w.putString(config.access_trace);
+  w.put(static_cast<int32_t>(config.layers_fd));
+  w.put(static_cast<int32_t>(config.status_fd));
+  w.put(static_cast<int32_t>(config.event_fd));
+  return w.take();
+}
+
+bool decodeHelperConfig(std::string_view payload, HelperConfig& config)
+{
+  Reader r(payload);
+
+  char magic[sizeof(Magic)] = {};
+  uint32_t version          = 0;
+  for (char& c : magic) {
+    if (!r.get(c)) {
+      return false;
+    }
+  }
+  if (std::memcmp(magic, Magic, sizeof(Magic)) != 0 || !r.get(version) ||
+      version != Version) {
+    return false;
+  }
+
+  int32_t negativeTtl = 0;
+  uint32_t maxThreads = 0;
+  uint32_t maxIdle    = 0;
+  int32_t layersFd    = -1;
+  int32_t statusFd    = -1;
+  int32_t eventFd     = -1;
+
+  if (!r.getString(config.mount_point) || !r.getString(config.game_dir) ||
+      !r.getString(config.data_dir_name) || !r.getString(config.overwrite_dir) ||
+      !r.getBool(config.splice_reads) || !r.getBool(config.passthrough) ||
+      !r.getBool(config.writeback) || !r.getBool(config.archives) ||
+      !r.getBool(config.lazy_copy_up) ||
+      !r.getBool(config.prefetch) || !r.get(negativeTtl) || !r.get(maxThreads) ||
+      !r.get(maxIdle) ||
+      !r.getBool(config.loop.clone_fd) || !r.getMods(config.mods) ||
+      !r.getMods(config.extra_files) || !r.getString(config.access_trace) ||
+      !r.get(layersFd) || !r.get(statusFd) || !r.get(eventFd)) {
+    return false;
+  }
+
+  config.negative_ttl          = negativeTtl;
+  config.loop.max_threads      = maxThreads;
+  config.loop.max_idle_threads = maxIdle;
+  config.layers_fd             = layersFd;
+  config.status_fd             = statusFd;
+  config.event_fd              = eventFd;
+  return r.done();
+}
+
+std::string encodeHelperUpdate(const HelperUpdate& update)
+{
+  Writer w;
+  w.putString(update.overwrite_dir);
+  w.putString(update.data_dir_name);
+  w.put(update.mods.keep_front);
+  w.put(update.mods.keep_back);
+  w.putMods(update.mods.middle);
+  w.putMods(update.extra_files);
+  w.putString(update.layers);
+  w.putString(update.access_trace);
+  return w.take();
+}
+
+bool decodeHelperUpdate(std::string_view payload, HelperUpdate& update)
+{
+  Reader r(payload);
+  return r.getString(update.overwrite_dir) && r.getString(update.data_dir_name) &&
+         r.get(update.mods.keep_front) && r.get(update.mods.keep_back) &&
+         r.getMods(update.mods.middle) && r.getMods(update.extra_files) &&
+         r.getString(update.layers) && r.getString(update.access_trace) && r.done();
+}
+
+std::string encodeLayerImage(const VfsLayerList& layers)
+{
+  std::vector<ImageLayer> layerRecords;
+  std::vector<ImageEntry> entryRecords;
+  std::string strings;
+
+  const auto addString = [&](std::string_view s) {
+    const ImageString ref{static_cast<uint32_t>(strings.size()),
+                          static_cast<uint32_t>(s.size())};
+    strings.append(s);
+    return ref;
+  };
+
+  for (const auto& layer : layers) {
+    if (layer == nullptr || layer->is_backing) {
+      continue;
+    }
+
+    ImageLayer record{};
+    record.origin      = addString(layer->origin);
+    record.root        = addString(layer->root);
+    record.root_mtime  = layer->root_mtime.time_since_epoch().count();
+    record.first_entry = entryRecords.size();
+    record.entry_count = layer->entries.size();
+    layerRecords.push_back(record);
+
+    for (const auto& cf : layer->entries) {
+      ImageEntry entry{};
+      entry.path   = addString(cf.relative_path);
+      entry.size   = cf.size;
+      entry.mtime  = cf.mtime.time_since_epoch().count();
+      entry.is_dir = cf.is_dir ? 1 : 0;
+      entryRecords.push_back(entry);
+    }
+  }
+
+  // string offsets are 32 bits
+  if (strings.size() > UINT32_MAX) {
+    return {};
+  }
+
+  ImageHeader header{};
+  std::memcpy(header.magic, ImageMagic, sizeof(ImageMagic));
+  header.version      = ImageVersion;
+  header.layer_count  = static_cast<uint32_t>(layerRecords.size());
+  header.entry_count  = entryRecords.size();
+  header.strings_size = strings.size();
+
+  std::string image;
+  image.reserve(sizeof(header) + layerRecords.size() * sizeof(ImageLayer) +
+                entryRecords.size() * sizeof(ImageEntry) + strings.size());
+  image.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  image.append(reinterpret_cast<const char*>(layerRecords.data()),
+               layerRecords.size() * sizeof(ImageLayer));
+  image.append(reinterpret_cast<const char*>(entryRecords.data()),
+               entryRecords.size() * sizeof(ImageEntry));
+  image.append(strings);
+  return image;
+}
+
+bool decodeLayerImage(std::string_view image, VfsLayerList& layers)
+{
+  if (image.size() < sizeof(ImageHeader)) {
+    return false;
+  }
+
+  const auto header = readRecord<ImageHeader>(image, 0);
+  if (std::memcmp(header.magic, ImageMagic, sizeof(ImageMagic)) != 0 ||
+      header.version != ImageVersion) {
+    return false;
+  }
+
+  const size_t layersAt  = sizeof(ImageHeader);
+  const size_t entriesAt = layersAt + size_t(header.layer_count) * sizeof(ImageLayer);
+  if (header.entry_count > (image.size() - std::min(image.size(), entriesAt)) /
+                               sizeof(ImageEntry)) {
+    return false;
+  }
+  const size_t stringsAt = entriesAt + header.entry_count * sizeof(ImageEntry);
+  if (stringsAt > image.size() || image.size() - stringsAt != header.strings_size) {
+    return false;
+  }
+
+  const std::string_view strings = image.substr(stringsAt);
+  const auto string = [&](ImageString ref, std::string& out) {
+    if (ref.offset > strings.size() || ref.size > strings.size() - ref.offset) {
+      return false;
+    }
+    out.assign(strings.substr(ref.offset, ref.size));
+    return true;
+  };
+
+  VfsLayerList out;
+  out.reserve(header.layer_count);
+
+  for (uint32_t i = 0; i < header.layer_count; ++i) {
+    const auto record = readRecord<ImageLayer>(image, layersAt + i * sizeof(ImageLayer));
+    if (record.first_entry > header.entry_count ||
+        record.entry_count > header.entry_count - record.first_entry) {
+      return false;
+    }
+
+    auto layer = std::make_shared<VfsLayer>();
+    if (!string(record.origin, layer->origin) || !string(record.root, layer->root)) {
+      return false;
+    }
+    layer->root_mtime = std::chrono::system_clock::time_point(
+        std::chrono::system_clock::duration(record.root_mtime));
+    layer->entries.resize(record.entry_count);
+
+    for (uint64_t e = 0; e < record.entry_count; ++e) {
+      const auto entry = readRecord<ImageEntry>(
+          image, entriesAt + (record.first_entry + e) * sizeof(ImageEntry));
+      CachedBaseFile& cf = layer->entries[e];
+
+      if (!string(entry.path, cf.relative_path)) {
+        return false;
+      }
+      cf.size   = entry.size;
+      cf.mtime  = std::chrono::system_clock::time_point(
+          std::chrono::system_clock::duration(entry.mtime));
+      cf.is_dir = entry.is_dir != 0;
+    }
+
+    out.push_back(std::move(layer));
+  }
+
+  layers = std::move(out);
+  return true;
+}
+
+int createLayerImageFd(const VfsLayerList& layers)
+{
+  const std::string image = encodeLayerImage(layers);
+  if (image.empty()) {
+    return -1;
+  }
+
+  const int fd = ::memfd_create("mo2-vfs-layers", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd < 0) {
+    return -1;
+  }
+
+  // sealed so the helper can map it without the GUI changing it underneath
+  if (!writeAll(fd, image) ||
+      ::fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0) {
+    ::close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+bool readLayerImageFd(int fd, VfsLayerList& layers)
+{
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+    ::close(fd);
+    return false;
+  }
+
+  const size_t size = static_cast<size_t>(st.st_size);
+  void* data        = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+
+  ::madvise(data, size, MADV_SEQUENTIAL);
+  const bool ok =
+      decodeLayerImage(std::string_view(static_cast<const char*>(data), size), layers);
+  ::munmap(data, size);
+  return ok;
+}
+
+uint64_t pendingStagingBytes(const HelperStatus& status)
+{
+  const uint64_t written =
+      status.metrics.writeBytes() + status.metrics.copyUpBytes();
+  const uint64_t flushed = status.flushed_bytes.load(std::memory_order_relaxed);
+  return written > flushed ? written - flushed : 0;
+}
+
+int createHelperStatusFd(HelperStatus*& status)
+{
+  const int fd = ::memfd_create("mo2-vfs-status", MFD_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+
+  if (::ftruncate(fd, sizeof(HelperStatus)) != 0) {
+    ::close(fd);
+    return -1;
+  }
+
+  void* data =
+      ::mmap(nullptr, sizeof(HelperStatus), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    ::close(fd);
+    return -1;
+  }
+
+  status = new (data) HelperStatus;
+  return fd;
+}
+
+HelperStatus* mapHelperStatus(int fd)
+{
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(HelperStatus))) {
+    return nullptr;
+  }
+
+  // constructed by the GUI in createHelperStatusFd()
+  void* data =
+      ::mmap(nullptr, sizeof(HelperStatus), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  return data == MAP_FAILED ? nullptr : static_cast<HelperStatus*>(data);
+}
+
+void unmapHelperStatus(HelperStatus* status)
+{
+  if (status != nullptr) {
+    ::munmap(status, sizeof(HelperStatus));
+  }
+}
+
+void completeHelperMessage(HelperStatus& status, int eventFd, bool ok,
+                           std::string_view error)
+{
+  if (!ok) {
+    const size_t n = std::min(error.size(), sizeof(status.last_error) - 1);
+    std::memcpy(status.last_error, error.data(), n);
+    status.last_error[n] = '\0';
+  }
+
+  status.last_ok.store(ok ? 1 : 0, std::memory_order_relaxed);
+  status.completed.fetch_add(1, std::memory_order_release);
+
+  if (eventFd >= 0) {
+    ::eventfd_write(eventFd, 1);
+  }
+}
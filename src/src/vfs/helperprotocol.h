@@ -0,0 +1,191 @@
+#ifndef VFS_HELPERPROTOCOL_H
+#define VFS_HELPERPROTOCOL_H
+
+#include "mo2filesystem.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Messages sent to mo2-vfs-helper over its stdin.  Each one is framed as a
+// little header (payload size, then type) followed by the payload; strings
+// are length-prefixed.  Both ends are built from the same tree, the version
+// in the config message only guards against a stale helper binary.
+//
+// The helper reports back through a HelperStatus the GUI shares with it,
+// signalling an eventfd whenever it's done with a message.  A helper started
+// without one answers with text lines on stdout instead ("mounted", "ok",
+// "error: ...").
+//
+using HelperModList = std::vector<std::pair<std::string, std::string>>;
+
+enum class HelperMessage : uint8_t
+{
+  Config = 1,
+  Update,
+  Flush,
+  Metrics,
+  MetricsReset,
+  Quit
+};
+
+constexpr size_t HelperHeaderSize   = sizeof(uint32_t) + sizeof(uint8_t);
+constexpr uint32_t HelperMaxPayload = 256u << 20;
+
+// everything the helper needs to mount, sent once before anything else
+//
+struct HelperConfig
+{
+  std::string mount_point;
+  std::string game_dir;
+  std::string data_dir_name;
+  std::string overwrite_dir;
+  bool splice_reads = true;
+  bool passthrough  = false;
+  bool writeback    = false;
+  bool archives     = false;
+  bool lazy_copy_up = true;
+  bool prefetch     = true;
+  int negative_ttl  = 30;
+  FuseLoopOptions loop;
+  HelperModList mods;
+  HelperModList extra_files;
+
+  // where the launch's file accesses are traced and the previous trace is
+  // read ahead from, empty to not trace; see VfsAccessTrace
+  std::string access_trace;
+
+  // inherited memfd with the layers the GUI already scanned, -1 if none; see
+  // createLayerImageFd()
+  int layers_fd = -1;
+
+  // inherited memfd with the HelperStatus and the eventfd signalled when it
+  // changes, -1 to answer on stdout
+  int status_fd = -1;
+  int event_fd  = -1;
+};
+
+enum class HelperState : uint32_t
+{
+  Starting,
+  Mounted,
+  Failed,
+  Stopped
+};
+
+// State of the helper in memory both processes map, so the GUI reads it in
+// place instead of asking for it.  Only the helper writes it, except for the
+// metrics the GUI resets; everything is a lock-free atomic, which is what
+// makes sharing it across processes well-defined.
+//
+struct HelperStatus
+{
+  std::atomic<uint32_t> state{static_cast<uint32_t>(HelperState::Starting)};
+
+  // messages the helper is done with, the config counts as the first one,
+  // and whether the last one succeeded; `last_error` is written before
+  // `completed` is bumped
+  std::atomic<uint64_t> completed{0};
+  std::atomic<uint32_t> last_ok{1};
+  char last_error[256] = {};
+
+  // written and copied up bytes at the last flush, see pendingStagingBytes()
+  std::atomic<uint64_t> flushed_bytes{0};
+
+  VfsMetrics metrics;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free &&
+              std::atomic<uint64_t>::is_always_lock_free);
+
+// bytes written or copied up into staging since the last flush
+//
+uint64_t pendingStagingBytes(const HelperStatus& status);
+
+// close-on-exec memfd holding a new HelperStatus mapped at `status`, -1 on
+// failure
+//
+int createHelperStatusFd(HelperStatus*& status);
+
+// maps the status created by createHelperStatusFd(), null on failure; `fd`
+// stays open
+//
+HelperStatus* mapHelperStatus(int fd);
+void unmapHelperStatus(HelperStatus* status);
+
+// records the result of the current message and wakes the GUI
+//
+void completeHelperMessage(HelperStatus& status, int eventFd, bool ok,
+                           std::string_view error = {});
+
+// a mod list as the range that differs from the previous one: the first
+// `keep_front` and last `keep_back` entries are unchanged and `middle`
+// replaces everything between them, which covers enabling, disabling and
+// moving a mod with only the affected range on the wire
+//
+struct HelperModListDelta
+{
+  uint32_t keep_front = 0;
+  uint32_t keep_back  = 0;
+  HelperModList middle;
+};
+
+HelperModListDelta diffModList(const HelperModList& from, const HelperModList& to);
+
+// false if `delta` doesn't fit `mods`, which is left untouched then
+//
+bool applyModListDelta(HelperModList& mods, const HelperModListDelta& delta);
+
+// a rebuild against the mods the helper already has
+//
+struct HelperUpdate
+{
+  std::string overwrite_dir;
+  std::string data_dir_name;
+  HelperModListDelta mods;
+  HelperModList extra_files;
+
+  // layer image of the overwrite directory and the mods in `mods.middle`
+  std::string layers;
+
+  // trace of the launch this update is for, empty to keep the current one
+  std::string access_trace;
+};
+
+// header followed by `payload`
+//
+std::string frameHelperMessage(HelperMessage type, std::string_view payload = {});
+
+// reads the payload size and type from the first HelperHeaderSize bytes
+//
+void parseHelperHeader(const char* header, HelperMessage& type, uint32_t& size);
+
+std::string encodeHelperConfig(const HelperConfig& config);
+bool decodeHelperConfig(std::string_view payload, HelperConfig& config);
+
+std::string encodeHelperUpdate(const HelperUpdate& update);
+bool decodeHelperUpdate(std::string_view payload, HelperUpdate& update);
+
+// Scanned layers as one flat image: a header, fixed-size layer and entry
+// records, then a blob with every string.  Records refer to each other and to
+// the strings by offset only, so the image is read in place wherever it is
+// mapped.  Backing layers are skipped, the helper scans the base game itself.
+//
+// The decoded layers go to scanLayers() as `previous`, which still checks
+// each one is current before using it.
+//
+std::string encodeLayerImage(const VfsLayerList& layers);
+bool decodeLayerImage(std::string_view image, VfsLayerList& layers);
+
+// sealed, close-on-exec memfd holding the image of `layers`, -1 on failure
+//
+int createLayerImageFd(const VfsLayerList& layers);
+
+// maps and decodes an image created by createLayerImageFd(), closes `fd`
+//
+bool readLayerImageFd(int fd, VfsLayerList& layers);
+
+#endif
@@ -0,0 +1,739 @@
+#include "indexer.h"
+#include "layercache.h"
+#include "vfstree.h"
+
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <new>
+#include <set>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace
+{
+namespace fs = std::filesystem;
+using Clock  = std::chrono::steady_clock;
+
+constexpr uint64_t IndexerMagic  = 0x3158444e4953464dull;
+constexpr const char* StatusName = "VFS_indexer.bin";
+
+// changes are picked up once nothing changed for this long, an install
+// touches thousands of files in a row; a burst that doesn't end is picked up
+// after MaxDelay anyway
+constexpr auto Settle   = std::chrono::milliseconds(500);
+constexpr auto MaxDelay = std::chrono::seconds(5);
+
+// how often everything is checked again when changes can't be watched
+constexpr auto Recheck = std::chrono::seconds(60);
+
+// how often the stop flag is looked at while nothing happens
+constexpr int IdlePollMs = 1000;
+
+constexpr uint32_t LayerEvents = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                 IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_ONLYDIR;
+
+std::string withoutTrailingSlash(std::string path)
+{
+  while (path.size() > 1 && path.back() == '/') {
+    path.pop_back();
+  }
+  return path;
+}
+
+// whether `root` is a mod directory right in `modsDir` or overwrite, which is
+// everything an indexer for them watches
+//
+bool covers(std::string_view modsDir, std::string_view overwriteDir,
+            std::string_view root)
+{
+  if (root == overwriteDir) {
+    return true;
+  }
+
+  return root.size() > modsDir.size() + 1 && root.starts_with(modsDir) &&
+         root[modsDir.size()] == '/' &&
+         root.find('/', modsDir.size() + 1) == std::string_view::npos;
+}
+
+bool sameLayer(const VfsLayer& a, const VfsLayer& b)
+{
+  return a.origin == b.origin && a.root_mtime == b.root_mtime &&
+         std::equal(a.entries.begin(), a.entries.end(), b.entries.begin(),
+                    b.entries.end(), [](const auto& x, const auto& y) {
+                      return x.relative_path == y.relative_path &&
+                             x.size == y.size && x.mtime == y.mtime &&
+                             x.is_dir == y.is_dir;
+                    });
+}
+
+// a write lock on the whole file, released by the kernel however the process
+// ends
+//
+bool lockStatus(int fd)
+{
+  struct flock lock = {};
+  lock.l_type       = F_WRLCK;
+  lock.l_whence     = SEEK_SET;
+  return ::fcntl(fd, F_SETLK, &lock) == 0;
+}
+
+class Indexer
+{
+public:
+  Indexer(std::string modsDir, std::string overwriteDir, IndexerStatus& status)
+      : m_modsDir(std::move(modsDir)), m_overwriteDir(std::move(overwriteDir)),
+        m_cachePath(layerCachePath(m_overwriteDir)),
+        m_cacheName(fs::path(m_cachePath).filename().string()),
+        m_overwriteName(fs::path(m_overwriteDir).filename().string()),
+        m_status(status)
+  {}
+
+  ~Indexer()
+  {
+    if (m_inotify >= 0) {
+      ::close(m_inotify);
+    }
+  }
+
+  Indexer(const Indexer&)            = delete;
+  Indexer& operator=(const Indexer&) = delete;
+
+  int run()
+  {
+    m_inotify = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify < 0) {
+      return 1;
+    }
+
+    // mods coming and going, and the cache file written by someone else
+    m_modsWatch = ::inotify_add_watch(m_inotify, m_modsDir.c_str(),
+                                      IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                                          IN_MOVED_TO | IN_DELETE_SELF |
+                                          IN_MOVE_SELF | IN_ONLYDIR);
+    m_instanceWatch = ::inotify_add_watch(
+        m_inotify, fs::path(m_cachePath).parent_path().c_str(),
+        IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE |
+            IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+
+    if (m_modsWatch < 0 || m_instanceWatch < 0) {
+      return 1;
+    }
+
+    start();
+
+    while (m_status.stop.load() == 0) {
+      pollfd pfd = {m_inotify, POLLIN, 0};
+      const int n = ::poll(&pfd, 1, timeoutMs());
+      if (n < 0 && errno != EINTR) {
+        return 1;
+      }
+
+      if (n > 0) {
+        readEvents();
+      }
+
+      acknowledge();
+
+      if (m_gone) {
+        return 0;
+      }
+
+      if (due()) {
+        flush();
+      }
+    }
+
+    return 0;
+  }
+
+private:
+  std::string m_modsDir;
+  std::string m_overwriteDir;
+  std::string m_cachePath;
+  std::string m_cacheName;
+  std::string m_overwriteName;
+  IndexerStatus& m_status;
+
+  int m_inotify       = -1;
+  int m_modsWatch     = -1;
+  int m_instanceWatch = -1;
+
+  // root of the layer every watched directory is in
+  std::unordered_map<int, std::string> m_watches;
+
+  // origin by root of everything indexed, and its layer as of the last flush
+  std::map<std::string, std::string> m_roots;
+  std::map<std::string, std::shared_ptr<const VfsLayer>> m_layers;
+
+  std::unique_ptr<VfsLayerCache> m_cache;
+  uint64_t m_ownStamp = 0;
+
+  // what the next flush has to do
+  std::set<std::string> m_changed;
+  bool m_listRoots  = false;
+  bool m_rescanAll  = false;
+  bool m_reloadFile = false;
+
+  // the instance was removed
+  bool m_gone = false;
+
+  bool m_queued = false;
+  Clock::time_point m_firstChange;
+  Clock::time_point m_lastChange;
+
+  // set when watching ran out, from then on everything is checked every
+  // Recheck instead
+  bool m_degraded = false;
+  Clock::time_point m_nextCheck = Clock::time_point::max();
+
+  bool ours(const std::string& root) const
+  {
+    return covers(m_modsDir, m_overwriteDir, root);
+  }
+
+  // answers a sync() of Mod Organizer: whatever it changed before asking is
+  // queued by the time the request is seen, reading it sets `pending`
+  //
+  void acknowledge()
+  {
+    const uint64_t requested = m_status.requested.load();
+    if (requested != m_status.acknowledged.load()) {
+      readEvents();
+      m_status.acknowledged.store(requested);
+    }
+  }
+
+  void changed()
+  {
+    m_status.pending.store(1);
+
+    const auto now = Clock::now();
+    if (!m_queued) {
+      m_firstChange = now;
+      m_queued      = true;
+    }
+    m_lastChange = now;
+  }
+
+  int timeoutMs() const
+  {
+    auto until = m_nextCheck;
+    if (m_queued) {
+      until = std::min({until, m_lastChange + Settle, m_firstChange + MaxDelay});
+    }
+
+    const auto left =
+        std::chrono::duration_cast<std::chrono::milliseconds>(until - Clock::now());
+    return static_cast<int>(std::clamp<int64_t>(left.count(), 0, IdlePollMs));
+  }
+
+  bool due() const
+  {
+    const auto now = Clock::now();
+    return now >= m_nextCheck ||
+           (m_queued &&
+            (now >= m_lastChange + Settle || now >= m_firstChange + MaxDelay));
+  }
+
+  // loads the cache file and checks every root against the disk the way any
+  // other user of the cache does, from then on the watches tell what changed
+  //
+  void start()
+  {
+    m_status.pending.store(1);
+
+    m_cache = std::make_unique<VfsLayerCache>(m_cachePath);
+    m_cache->retain([this](const std::string& root) {
+      return !ours(root);
+    });
+
+    std::map<std::string, std::shared_ptr<const VfsLayer>> cached;
+    for (const auto& layer : m_cache->layers()) {
+      cached.emplace(layer->root, layer);
+    }
+
+    listRoots();
+    m_changed.clear();
+
+    for (const auto& [root, origin] : m_roots) {
+      auto it = cached.find(root);
+      if (it != cached.end() && it->second->origin == origin &&
+          layerIsCurrent(*it->second, LayerCheck::Files)) {
+        m_cache->update({it->second});
+        m_layers[root] = it->second;
+        watch(root, *it->second);
+      } else {
+        m_changed.insert(root);
+      }
+    }
+
+    m_queued = true;
+    flush();
+  }
+
+  // reads everything queued without blocking
+  //
+  void readEvents()
+  {
+    alignas(inotify_event) char buffer[64 * 1024];
+
+    for (;;) {
+      const ssize_t n = ::read(m_inotify, buffer, sizeof(buffer));
+      if (n <= 0) {
+        return;
+      }
+
+      for (const char* p = buffer; p < buffer + n;) {
+        const auto* e = reinterpret_cast<const inotify_event*>(p);
+        p += sizeof(inotify_event) + e->len;
+        handle(*e);
+      }
+    }
+  }
+
+  void handle(const inotify_event& e)
+  {
+    if (e.mask & IN_Q_OVERFLOW) {
+      // whatever was lost can be anywhere
+      changed();
+      m_listRoots = true;
+      m_rescanAll = true;
+      return;
+    }
+
+    if (e.wd == m_instanceWatch || e.wd == m_modsWatch) {
+      if (e.mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+        m_gone = true;
+        return;
+      }
+
+      if (e.wd == m_modsWatch) {
+        if (e.mask & IN_ISDIR) {
+          changed();
+          m_listRoots = true;
+        }
+      } else if (e.len > 0 && m_cacheName == e.name &&
+                 layerCacheStamp(m_cachePath) != m_ownStamp) {
+        changed();
+        m_reloadFile = true;
+      } else if (e.len > 0 && m_overwriteName == e.name) {
+        changed();
+        m_listRoots = true;
+      }
+
+      return;
+    }
+
+    const auto it = m_watches.find(e.wd);
+    if (it == m_watches.end()) {
+      return;
+    }
+
+    if (e.mask & IN_IGNORED) {
+      // the directory is gone, its parent reported that already
+      m_watches.erase(it);
+      return;
+    }
+
+    changed();
+    m_changed.insert(it->second);
+  }
+
+  void listRoots()
+  {
+    std::map<std::string, std::string> roots;
+    std::error_code ec;
+
+    for (const auto& entry : fs::directory_iterator(m_modsDir, ec)) {
+      std::error_code typeEc;
+      if (entry.is_directory(typeEc)) {
+        const std::string name = entry.path().filename().string();
+        roots.emplace(m_modsDir + "/" + name, name);
+      }
+    }
+
+    if (fs::is_directory(m_overwriteDir, ec)) {
+      roots.emplace(m_overwriteDir, fs::path(m_overwriteDir).filename().string());
+    }
+
+    for (const auto& [root, origin] : m_roots) {
+      if (!roots.contains(root)) {
+        unwatch(root);
+        m_layers.erase(root);
+        m_cache->forget(root);
+      }
+    }
+
+    for (const auto& [root, origin] : roots) {
+      if (!m_roots.contains(root)) {
+        m_changed.insert(root);
+      }
+    }
+
+    m_roots = std::move(roots);
+  }
+
+  // watches every directory of `layer`, true if any of them wasn't watched
+  // yet
+  //
+  bool watch(const std::string& root, const VfsLayer& layer)
+  {
+    bool added = false;
+
+    const auto add = [&](const std::string& path) {
+      if (m_degraded) {
+        return;
+      }
+
+      const int wd = ::inotify_add_watch(m_inotify, path.c_str(), LayerEvents);
+      if (wd >= 0) {
+        added = m_watches.insert_or_assign(wd, root).second || added;
+      } else if (errno == ENOSPC) {
+        degrade();
+      }
+    };
+
+    add(root);
+
+    std::string path;
+    for (const auto& cf : layer.entries) {
+      if (cf.is_dir) {
+        path.assign(root);
+        path.push_back('/');
+        path.append(cf.relative_path);
+        add(path);
+      }
+    }
+
+    return added;
+  }
+
+  void unwatch(const std::string& root)
+  {
+    std::erase_if(m_watches, [&](const auto& item) {
+      if (item.second != root) {
+        return false;
+      }
+      ::inotify_rm_watch(m_inotify, item.first);
+      return true;
+    });
+  }
+
+  // out of inotify watches: nothing is vouched for anymore and everything is
+  // checked again every Recheck, which is what Mod Organizer does itself
+  //
+  void degrade()
+  {
+    m_degraded = true;
+    m_status.complete.store(0);
+
+    for (const auto& [wd, root] : m_watches) {
+      ::inotify_rm_watch(m_inotify, wd);
+    }
+    m_watches.clear();
+  }
+
+  void rescan(const std::string& root, const std::string& origin)
+  {
+    auto layer = scanLayer(origin, root);
+
+    // a directory created in the meantime may already have files the scan
+    // didn't see when it came before the watch
+    for (int i = 0; i < 3 && watch(root, *layer); ++i) {
+      layer = scanLayer(origin, root);
+    }
+
+    m_layers[root] = layer;
+    m_cache->update({layer});
+  }
+
+  // replaces the cache by the file someone else wrote, keeping the layers of
+  // other games and instances it has; the ones for watched roots are current
+  // here and win over the file's
+  //
+  void reloadFile()
+  {
+    m_cache = std::make_unique<VfsLayerCache>(m_cachePath);
+    m_cache->retain([this](const std::string& root) {
+      return !ours(root);
+    });
+
+    std::map<std::string, std::shared_ptr<const VfsLayer>> loaded;
+    for (const auto& layer : m_cache->layers()) {
+      loaded.emplace(layer->root, layer);
+    }
+
+    for (const auto& [root, layer] : m_layers) {
+      auto it = loaded.find(root);
+      if (it != loaded.end() && sameLayer(*it->second, *layer)) {
+        m_cache->update({it->second});
+      } else {
+        m_cache->update({layer});
+      }
+    }
+
+    // the file may be missing or broken altogether
+    m_listRoots = true;
+  }
+
+  void flush()
+  {
+    m_queued = false;
+
+    if (m_reloadFile) {
+      m_reloadFile = false;
+      reloadFile();
+    }
+
+    if (m_listRoots) {
+      m_listRoots = false;
+      listRoots();
+    }
+
+    const bool recheck = m_degraded && Clock::now() >= m_nextCheck;
+    if (m_rescanAll || recheck) {
+      for (const auto& [root, origin] : m_roots) {
+        auto it = m_layers.find(root);
+        if (m_rescanAll || it == m_layers.end() || !layerIsCurrent(*it->second)) {
+          m_changed.insert(root);
+        }
+      }
+      m_rescanAll = false;
+    }
+
+    for (const auto& root : std::exchange(m_changed, {})) {
+      if (auto it = m_roots.find(root); it != m_roots.end()) {
+        rescan(root, it->second);
+      }
+    }
+
+    if (!m_cache->save()) {
+      // tried again with the next check
+      m_nextCheck = Clock::now() + Recheck;
+      return;
+    }
+
+    m_ownStamp  = m_cache->stamp();
+    m_nextCheck = m_degraded ? Clock::now() + Recheck : Clock::time_point::max();
+
+    // whatever changed during the flush is queued by now, it keeps the
+    // changes pending
+    readEvents();
+
+    m_status.current.store(m_ownStamp);
+    if (!m_queued && !m_gone) {
+      m_status.pending.store(0);
+    }
+    if (!m_degraded) {
+      m_status.complete.store(1);
+    }
+  }
+};
+
+}  // namespace
+
+std::string indexerStatusPath(const std::string& overwrite_dir)
+{
+  return (fs::path(layerCachePath(overwrite_dir)).parent_path() / StatusName).string();
+}
+
+int runIndexer(std::string mods_dir, std::string overwrite_dir)
+{
+  mods_dir      = withoutTrailingSlash(std::move(mods_dir));
+  overwrite_dir = withoutTrailingSlash(std::move(overwrite_dir));
+
+  if (mods_dir.size() >= sizeof(IndexerStatus::mods_dir) ||
+      overwrite_dir.size() >= sizeof(IndexerStatus::overwrite_dir) ||
+      !fs::is_directory(mods_dir)) {
+    return 1;
+  }
+
+  // detached from whoever started it so it outlives Mod Organizer, which
+  // also has flatpak-spawn return right away
+  const pid_t pid = ::fork();
+  if (pid < 0) {
+    return 1;
+  }
+  if (pid > 0) {
+    return 0;
+  }
+
+  ::setsid();
+  if (const int devnull = ::open("/dev/null", O_RDWR); devnull >= 0) {
+    ::dup2(devnull, STDIN_FILENO);
+    ::dup2(devnull, STDOUT_FILENO);
+    ::dup2(devnull, STDERR_FILENO);
+    if (devnull > STDERR_FILENO) {
+      ::close(devnull);
+    }
+  }
+
+  const std::string path = indexerStatusPath(overwrite_dir);
+
+  // the file is never removed or truncated, so Mod Organizer's mapping of it
+  // stays valid across indexers
+  const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return 1;
+  }
+
+  // one indexer per instance
+  if (!lockStatus(fd)) {
+    ::close(fd);
+    return 0;
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 ||
+      (st.st_size < static_cast<off_t>(sizeof(IndexerStatus)) &&
+       ::ftruncate(fd, sizeof(IndexerStatus)) != 0)) {
+    ::close(fd);
+    return 1;
+  }
+
+  void* data =
+      ::mmap(nullptr, sizeof(IndexerStatus), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    ::close(fd);
+    return 1;
+  }
+
+  auto* status = new (data) IndexerStatus;
+  std::memcpy(status->mods_dir, mods_dir.c_str(), mods_dir.size() + 1);
+  std::memcpy(status->overwrite_dir, overwrite_dir.c_str(), overwrite_dir.size() + 1);
+  status->magic.store(IndexerMagic, std::memory_order_release);
+
+  int result = 0;
+  {
+    Indexer indexer(std::move(mods_dir), std::move(overwrite_dir), *status);
+    result = indexer.run();
+  }
+
+  status->complete.store(0);
+  status->current.store(0);
+  ::munmap(data, sizeof(IndexerStatus));
+  ::close(fd);
+
+  return result;
+}
+
+std::unique_ptr<IndexerLink> IndexerLink::open(const std::string& overwrite_dir)
+{
+  const std::string path = indexerStatusPath(overwrite_dir);
+
+  const int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(IndexerStatus))) {
+    ::close(fd);
+    return nullptr;
+  }
+
+  void* data =
+      ::mmap(nullptr, sizeof(IndexerStatus), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    ::close(fd);
+    return nullptr;
+  }
+
+  return std::unique_ptr<IndexerLink>(
+      new IndexerLink(path, fd, static_cast<IndexerStatus*>(data)));
+}
+
+IndexerLink::IndexerLink(std::string path, int fd, IndexerStatus* status)
+    : m_path(std::move(path)), m_fd(fd), m_status(status)
+{}
+
+IndexerLink::~IndexerLink()
+{
+  ::munmap(m_status, sizeof(IndexerStatus));
+  ::close(m_fd);
+}
+
+bool IndexerLink::running() const
+{
+  // only asks for the lock, taking it would keep an indexer from starting
+  struct flock lock = {};
+  lock.l_type       = F_WRLCK;
+  lock.l_whence     = SEEK_SET;
+  return ::fcntl(m_fd, F_GETLK, &lock) == 0 && lock.l_type != F_UNLCK;
+}
+
+bool IndexerLink::sync(std::chrono::milliseconds timeout)
+{
+  if (m_status->magic.load(std::memory_order_acquire) != IndexerMagic || !running()) {
+    return false;
+  }
+
+  const uint64_t token = m_status->requested.fetch_add(1) + 1;
+
+  // the indexer sleeps in poll(), a file closed after writing in the instance
+  // directory wakes it up
+  if (const int fd = ::open(m_path.c_str(), O_WRONLY | O_CLOEXEC); fd >= 0) {
+    ::close(fd);
+  }
+
+  const auto until = Clock::now() + timeout;
+  while (m_status->acknowledged.load() < token) {
+    if (Clock::now() >= until) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  return true;
+}
+
+bool IndexerLink::indexes(const std::string& root) const
+{
+  const IndexerStatus& s = *m_status;
+  if (s.magic.load(std::memory_order_acquire) != IndexerMagic) {
+    return false;
+  }
+
+  const std::string_view mods(s.mods_dir, strnlen(s.mods_dir, sizeof(s.mods_dir)));
+  const std::string_view overwrite(
+      s.overwrite_dir, strnlen(s.overwrite_dir, sizeof(s.overwrite_dir)));
+
+  return covers(mods, overwrite, withoutTrailingSlash(root));
+}
+
+uint64_t IndexerLink::current() const
+{
+  const IndexerStatus& s = *m_status;
+
+  // `current` is written before `pending` is cleared, so a cleared flag
+  // comes with the stamp of the file that has the changes
+  if (s.magic.load(std::memory_order_acquire) != IndexerMagic ||
+      s.complete.load() == 0 || s.pending.load() != 0) {
+    return 0;
+  }
+
+  return s.current.load();
+}
+
+bool IndexerLink::vouches(const std::string& root, uint64_t stamp) const
+{
+  return stamp != 0 && current() == stamp && indexes(root) && running();
+}
+
+void IndexerLink::stop()
+{
+  m_status->stop.store(1);
+}
@@ -0,0 +1,113 @@
+#ifndef VFS_INDEXER_H
+#define VFS_INDEXER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Optional resident process that keeps the layer cache of an instance current
+// while Mod Organizer isn't running, so a start only has to load the cache
+// file instead of checking every directory of every mod against it.
+//
+// The indexer is the VFS helper started with `--indexer MODS OVERWRITE`.  It
+// watches every directory of the mods and of overwrite with inotify, rescans
+// a mod once its changes settled and writes the cache file again.  When
+// another process replaces the file, its own layers win over the ones in it.
+//
+// It shares an IndexerStatus with Mod Organizer in a file next to the cache
+// and holds a lock on that file for as long as it runs, which is how a second
+// indexer and Mod Organizer tell that one is running.
+//
+struct IndexerStatus
+{
+  // IndexerMagic once the directories below are filled in
+  std::atomic<uint64_t> magic{0};
+
+  // set once every root was checked after the start, cleared for good when
+  // the indexer ran out of watches and only checks everything periodically
+  std::atomic<uint32_t> complete{0};
+
+  // changes were seen that aren't in the cache file yet
+  std::atomic<uint32_t> pending{0};
+
+  // layerCacheStamp() of the cache file the indexer knows to be current;
+  // written before `pending` is cleared
+  std::atomic<uint64_t> current{0};
+
+  // set by Mod Organizer to have the indexer exit
+  std::atomic<uint32_t> stop{0};
+
+  char mods_dir[4096]      = {};
+  char overwrite_dir[4096] = {};
+
+  // barrier, see IndexerLink::sync(): Mod Organizer bumps `requested` and the
+  // indexer stores it in `acknowledged` once it read every change queued
+  // before, so `pending` covers them; last so an older indexer's layout holds
+  std::atomic<uint64_t> requested{0};
+  std::atomic<uint64_t> acknowledged{0};
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free &&
+              std::atomic<uint64_t>::is_always_lock_free);
+
+// the status file of the instance owning `overwrite_dir`, next to the layer
+// cache
+//
+std::string indexerStatusPath(const std::string& overwrite_dir);
+
+// detaches and indexes until the instance is gone or it's asked to stop;
+// returns right away with 0 if an indexer is already running for it
+//
+int runIndexer(std::string mods_dir, std::string overwrite_dir);
+
+// Mod Organizer's end of the IndexerStatus of an instance.
+//
+class IndexerLink
+{
+public:
+  // null if no indexer ever ran for the instance
+  static std::unique_ptr<IndexerLink> open(const std::string& overwrite_dir);
+
+  ~IndexerLink();
+
+  IndexerLink(const IndexerLink&)            = delete;
+  IndexerLink& operator=(const IndexerLink&) = delete;
+
+  bool running() const;
+
+  // waits up to `timeout` for the indexer to have seen every change made on
+  // disk before the call; until then `pending` may lack writes Mod Organizer
+  // just did itself, so nothing is vouched for without it
+  //
+  bool sync(std::chrono::milliseconds timeout);
+
+  // whether `root` is a directory the indexer watches
+  //
+  bool indexes(const std::string& root) const;
+
+  // layerCacheStamp() of the cache file the indexer knows to be current, 0
+  // while it has changes pending or isn't done with its start
+  //
+  uint64_t current() const;
+
+  // whether the layer of `root` in the cache file with `stamp` is known to
+  // be current, so it doesn't have to be checked against the disk; only
+  // after a sync()
+  //
+  bool vouches(const std::string& root, uint64_t stamp) const;
+
+  // asks the indexer to exit
+  //
+  void stop();
+
+private:
+  IndexerLink(std::string path, int fd, IndexerStatus* status);
+
+  std::string m_path;
+  int m_fd;
+  IndexerStatus* m_status;
+};
+
+#endif
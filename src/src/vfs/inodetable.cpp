@@ -2,6 +2,8 @@
 
 #include "vfstree.h"
 
+#include <functional>
+#include <mutex>
 #include <vector>
 
 namespace
@@ -24,76 +26,255 @@ std::string canonicalizePath(const std::string& path)
 
   return canonical;
 }
+
+// characters of `s` that don't fit in the object itself
+size_t heapBytes(const std::string& s)
+{
+  const char* self = reinterpret_cast<const char*>(&s);
+  if (s.data() >= self && s.data() < self + sizeof(s)) {
+    return 0;
+  }
+  return s.capacity() + 1;
+}
+
+// nodes and buckets of an unordered_map, nodes being a pointer and the cached
+// hash besides the pair
+template <class Map>
+size_t hashBytes(const Map& map)
+{
+  return map.size() * (sizeof(typename Map::value_type) + 2 * sizeof(void*)) +
+         map.bucket_count() * sizeof(void*);
+}
 }  // namespace
 
 InodeTable::InodeTable()
 {
-  m_pathToInode.emplace("", 1);
-  m_inodeToPath.emplace(1, "");
+  pathShard("").pathToInode.emplace("", 1);
+  inodeShard(1).inodeToPath.emplace(1, InodeEntry{});
+}
+
+InodeTable::PathShard& InodeTable::pathShard(const std::string& key)
+{
+  return m_pathShards[std::hash<std::string>{}(key) % ShardCount];
+}
+
+const InodeTable::PathShard& InodeTable::pathShard(const std::string& key) const
+{
+  return m_pathShards[std::hash<std::string>{}(key) % ShardCount];
+}
+
+InodeTable::InodeShard& InodeTable::inodeShard(uint64_t ino)
+{
+  return m_inodeShards[ino % ShardCount];
+}
+
+const InodeTable::InodeShard& InodeTable::inodeShard(uint64_t ino) const
+{
+  return m_inodeShards[ino % ShardCount];
 }
 
 uint64_t InodeTable::getOrCreate(const std::string& path)
+{
+  return getOrCreate(path, nullptr, 0);
+}
+
+uint64_t InodeTable::getOrCreate(const std::string& path, const VfsNode* node,
+                                 uint64_t generation)
 {
   const std::string key = normalizeForLookup(path);
-  auto existing         = m_pathToInode.find(key);
-  if (existing != m_pathToInode.end()) {
-    return existing->second;
+  PathShard& shard      = pathShard(key);
+
+  {
+    std::shared_lock lock(shard.mutex);
+    auto existing = shard.pathToInode.find(key);
+    if (existing != shard.pathToInode.end()) {
+      const uint64_t ino = existing->second;
+      lock.unlock();
+
+      if (node != nullptr) {
+        cacheNode(ino, node, generation);
+      }
+      return ino;
+    }
+  }
+
+  std::unique_lock lock(shard.mutex);
+  auto existing = shard.pathToInode.find(key);
+  if (existing != shard.pathToInode.end()) {
+    const uint64_t ino = existing->second;
+    lock.unlock();
+
+    if (node != nullptr) {
+      cacheNode(ino, node, generation);
+    }
+    return ino;
+  }
+
+  // publish the reverse mapping first so nobody can be handed an inode whose
+  // path isn't resolvable yet
+  const uint64_t ino = m_nextInode.fetch_add(1, std::memory_order_relaxed);
+  {
+    InodeShard& inodes = inodeShard(ino);
+    std::unique_lock inodeLock(inodes.mutex);
+    inodes.inodeToPath.emplace(ino, InodeEntry{canonicalizePath(path), node, generation});
   }
 
-  const uint64_t ino = m_nextInode++;
-  m_pathToInode.emplace(key, ino);
-  m_inodeToPath.emplace(ino, canonicalizePath(path));
+  shard.pathToInode.emplace(key, ino);
   return ino;
 }
 
 std::string InodeTable::getPath(uint64_t ino) const
 {
-  auto it = m_inodeToPath.find(ino);
-  if (it == m_inodeToPath.end()) {
+  const InodeShard& shard = inodeShard(ino);
+  std::shared_lock lock(shard.mutex);
+
+  auto it = shard.inodeToPath.find(ino);
+  if (it == shard.inodeToPath.end()) {
     return "";
   }
-  return it->second;
+  return it->second.path;
+}
+
+uint64_t InodeTable::find(const std::string& path) const
+{
+  const std::string key  = normalizeForLookup(path);
+  const PathShard& shard = pathShard(key);
+  std::shared_lock lock(shard.mutex);
+
+  auto it = shard.pathToInode.find(key);
+  return it == shard.pathToInode.end() ? 0 : it->second;
+}
+
+std::vector<std::pair<uint64_t, std::string>> InodeTable::entries() const
+{
+  std::vector<std::pair<uint64_t, std::string>> out;
+  for (const auto& shard : m_inodeShards) {
+    std::shared_lock lock(shard.mutex);
+    for (const auto& [ino, entry] : shard.inodeToPath) {
+      if (ino != 1) {
+        out.emplace_back(ino, entry.path);
+      }
+    }
+  }
+  return out;
+}
+
+size_t InodeTable::memoryUsage(size_t& inodes) const
+{
+  size_t bytes = sizeof(InodeTable);
+  inodes       = 0;
+
+  for (const auto& shard : m_pathShards) {
+    std::shared_lock lock(shard.mutex);
+    bytes += hashBytes(shard.pathToInode);
+    for (const auto& [path, ino] : shard.pathToInode) {
+      bytes += heapBytes(path);
+    }
+  }
+
+  for (const auto& shard : m_inodeShards) {
+    std::shared_lock lock(shard.mutex);
+    bytes += hashBytes(shard.inodeToPath);
+    inodes += shard.inodeToPath.size();
+    for (const auto& [ino, entry] : shard.inodeToPath) {
+      bytes += heapBytes(entry.path);
+    }
+  }
+
+  return bytes;
+}
+
+const VfsNode* InodeTable::cachedNode(uint64_t ino, uint64_t generation,
+                                      std::string* path) const
+{
+  const InodeShard& shard = inodeShard(ino);
+  std::shared_lock lock(shard.mutex);
+
+  auto it = shard.inodeToPath.find(ino);
+  if (it == shard.inodeToPath.end()) {
+    path->clear();
+    return nullptr;
+  }
+
+  if (it->second.node != nullptr && it->second.generation == generation) {
+    return it->second.node;
+  }
+
+  *path = it->second.path;
+  return nullptr;
+}
+
+void InodeTable::cacheNode(uint64_t ino, const VfsNode* node, uint64_t generation)
+{
+  InodeShard& shard = inodeShard(ino);
+
+  {
+    std::shared_lock lock(shard.mutex);
+    auto it = shard.inodeToPath.find(ino);
+    if (it == shard.inodeToPath.end() ||
+        (it->second.node == node && it->second.generation == generation)) {
+      return;
+    }
+  }
+
+  std::unique_lock lock(shard.mutex);
+  auto it = shard.inodeToPath.find(ino);
+  if (it != shard.inodeToPath.end()) {
+    it->second.node       = node;
+    it->second.generation = generation;
+  }
 }
 
 void InodeTable::rename(const std::string& old_path, const std::string& new_path)
 {
+  std::vector<std::unique_lock<std::shared_mutex>> locks;
+  locks.reserve(ShardCount * 2);
+  for (auto& shard : m_pathShards) {
+    locks.emplace_back(shard.mutex);
+  }
+  for (auto& shard : m_inodeShards) {
+    locks.emplace_back(shard.mutex);
+  }
+
   const std::string oldCanonical = canonicalizePath(old_path);
   const std::string newCanonical = canonicalizePath(new_path);
   const std::string oldKey       = normalizeForLookup(oldCanonical);
   const std::string newKey       = normalizeForLookup(newCanonical);
 
-  auto it = m_pathToInode.find(oldKey);
-  if (it != m_pathToInode.end()) {
-    const uint64_t ino = it->second;
-    m_pathToInode.erase(it);
-    m_pathToInode.emplace(newKey, ino);
-    m_inodeToPath[ino] = newCanonical;
+  {
+    PathShard& from = pathShard(oldKey);
+    auto it         = from.pathToInode.find(oldKey);
+    if (it != from.pathToInode.end()) {
+      const uint64_t ino = it->second;
+      from.pathToInode.erase(it);
+      pathShard(newKey).pathToInode[newKey]  = ino;
+      inodeShard(ino).inodeToPath[ino] = InodeEntry{newCanonical};
+    }
   }
 
   std::vector<std::pair<std::string, uint64_t>> descendants;
-  descendants.reserve(m_pathToInode.size());
 
   const std::string oldPrefix = oldKey.empty() ? oldKey : oldKey + "/";
-  for (const auto& [key, ino] : m_pathToInode) {
-    if (oldPrefix.empty() || key.rfind(oldPrefix, 0) == 0) {
-      descendants.emplace_back(key, ino);
+  for (const auto& shard : m_pathShards) {
+    for (const auto& [key, ino] : shard.pathToInode) {
+      if (key != oldKey && (oldPrefix.empty() || key.rfind(oldPrefix, 0) == 0)) {
+        descendants.emplace_back(key, ino);
+      }
     }
   }
 
   for (const auto& [descKey, ino] : descendants) {
-    if (descKey == oldKey) {
-      continue;
-    }
-
-    const std::string suffix = descKey.substr(oldPrefix.size());
+    const std::string suffix  = descKey.substr(oldPrefix.size());
     const std::string nextKey = newKey.empty() ? suffix : newKey + "/" + suffix;
-    m_pathToInode.erase(descKey);
-    m_pathToInode.emplace(nextKey, ino);
+    pathShard(descKey).pathToInode.erase(descKey);
+    pathShard(nextKey).pathToInode[nextKey] = ino;
 
-    auto inodeIt = m_inodeToPath.find(ino);
-    if (inodeIt != m_inodeToPath.end()) {
-      const std::string suffixCanonical = inodeIt->second.substr(oldCanonical.size());
-      inodeIt->second = newCanonical + suffixCanonical;
+    auto& inodes = inodeShard(ino).inodeToPath;
+    auto inodeIt = inodes.find(ino);
+    if (inodeIt != inodes.end()) {
+      const std::string suffixCanonical =
+          inodeIt->second.path.substr(oldCanonical.size());
+      inodeIt->second = InodeEntry{newCanonical + suffixCanonical};
     }
   }
 }
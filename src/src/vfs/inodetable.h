@@ -1,23 +1,96 @@
 #ifndef VFS_INODETABLE_H
 #define VFS_INODETABLE_H
 
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
+struct VfsNode;
+
+// Thread-safe path <-> inode mapping.  Both directions are split into
+// independently locked shards so concurrent FUSE workers only contend when
+// they touch the same shard; lookups take shared locks.  rename() is rare and
+// locks every shard, always path shards before inode shards, which is the
+// same order getOrCreate() uses.
+//
+// Each inode can also carry a pointer to the tree node it last resolved to,
+// tagged with the tree generation it was resolved in (see
+// Mo2FsContext::tree_generation), so hot operations skip re-walking the tree
+// by path.
 class InodeTable
 {
 public:
   InodeTable();
 
   uint64_t getOrCreate(const std::string& path);
+
+  // same as above, but also remembers `node` as the inode's resolution for
+  // the given tree generation
+  //
+  uint64_t getOrCreate(const std::string& path, const VfsNode* node,
+                       uint64_t generation);
+
   std::string getPath(uint64_t ino) const;
+
+  // inode handed out for `path`, 0 if the kernel was never told about it
+  //
+  uint64_t find(const std::string& path) const;
+
+  // every known inode with its path, the root excluded
+  //
+  std::vector<std::pair<uint64_t, std::string>> entries() const;
+
+  // returns the node cached for `ino` if it was recorded in `generation`;
+  // otherwise returns null and, if the inode is known, stores its path in
+  // `path` so the caller can re-resolve it (only the root has an empty path)
+  //
+  const VfsNode* cachedNode(uint64_t ino, uint64_t generation,
+                            std::string* path) const;
+
+  void cacheNode(uint64_t ino, const VfsNode* node, uint64_t generation);
+
   void rename(const std::string& old_path, const std::string& new_path);
 
+  // estimated bytes taken by both directions of the mapping, `inodes` is set
+  // to the number of inodes
+  //
+  size_t memoryUsage(size_t& inodes) const;
+
 private:
-  std::unordered_map<std::string, uint64_t> m_pathToInode;
-  std::unordered_map<uint64_t, std::string> m_inodeToPath;
-  uint64_t m_nextInode = 2;
+  static constexpr size_t ShardCount = 64;
+
+  struct PathShard
+  {
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, uint64_t> pathToInode;
+  };
+
+  struct InodeEntry
+  {
+    std::string path;
+    const VfsNode* node = nullptr;
+    uint64_t generation = 0;
+  };
+
+  struct InodeShard
+  {
+    mutable std::shared_mutex mutex;
+    std::unordered_map<uint64_t, InodeEntry> inodeToPath;
+  };
+
+  PathShard& pathShard(const std::string& key);
+  const PathShard& pathShard(const std::string& key) const;
+  InodeShard& inodeShard(uint64_t ino);
+  const InodeShard& inodeShard(uint64_t ino) const;
+
+  std::array<PathShard, ShardCount> m_pathShards;
+  std::array<InodeShard, ShardCount> m_inodeShards;
+  std::atomic<uint64_t> m_nextInode{2};
 };
 
 #endif
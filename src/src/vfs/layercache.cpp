@@ -0,0 +1,425 @@
+#include "layercache.h"
+#include "indexer.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+namespace fs = std::filesystem;
+
+constexpr char Magic[8]         = {'M', 'O', '2', 'V', 'F', 'S', 'L', 'C'};
+constexpr uint32_t Version      = 1;
+constexpr const char* CacheName = "VFS_scan_cache.bin";
+
+// how long a scan waits for the indexer to catch up, it's busy rescanning
+// when it takes longer; a failed sync is reused for SyncRetry, the quick
+// check is done meanwhile
+constexpr auto SyncTimeout = std::chrono::milliseconds(250);
+constexpr auto SyncRetry   = std::chrono::seconds(1);
+
+int64_t toTicks(std::chrono::system_clock::time_point t)
+{
+  return static_cast<int64_t>(t.time_since_epoch().count());
+}
+
+std::chrono::system_clock::time_point fromTicks(int64_t ticks)
+{
+  return std::chrono::system_clock::time_point(
+      std::chrono::system_clock::duration(ticks));
+}
+
+class Writer
+{
+public:
+  explicit Writer(std::ofstream& out) : m_out(out) {}
+
+  template <class T>
+  void put(T value)
+  {
+    m_out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  void putString(std::string_view s)
+  {
+    put(static_cast<uint32_t>(s.size()));
+    m_out.write(s.data(), static_cast<std::streamsize>(s.size()));
+  }
+
+private:
+  std::ofstream& m_out;
+};
+
+class Reader
+{
+public:
+  explicit Reader(std::ifstream& in) : m_in(in) {}
+
+  template <class T>
+  bool get(T& value)
+  {
+    return static_cast<bool>(m_in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+  }
+
+  bool getString(std::string& s, size_t keep = 0)
+  {
+    uint32_t size = 0;
+    if (!get(size) || size > (1u << 20)) {
+      return false;
+    }
+    s.resize(keep + size);
+    return static_cast<bool>(m_in.read(s.data() + keep, size));
+  }
+
+private:
+  std::ifstream& m_in;
+};
+
+size_t commonPrefix(const std::string& a, const std::string& b)
+{
+  const size_t n = std::min({a.size(), b.size(), size_t(UINT16_MAX)});
+  size_t i       = 0;
+  while (i < n && a[i] == b[i]) {
+    ++i;
+  }
+  return i;
+}
+
+}  // namespace
+
+VfsLayerCache::VfsLayerCache(std::string path) : m_path(std::move(path))
+{
+  const uint64_t before = layerCacheStamp(m_path);
+  load();
+  m_stamp = (layerCacheStamp(m_path) == before ? before : 0);
+}
+
+void VfsLayerCache::load()
+{
+  std::ifstream in(m_path, std::ios::binary);
+  if (!in) {
+    return;
+  }
+
+  char magic[sizeof(Magic)] = {};
+  uint32_t version          = 0;
+  uint32_t count            = 0;
+  Reader r(in);
+
+  if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, Magic, sizeof(Magic)) != 0 ||
+      !r.get(version) || version != Version || !r.get(count)) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < count; ++i) {
+    auto layer       = std::make_shared<VfsLayer>();
+    int64_t rootTime = 0;
+    uint64_t entries = 0;
+
+    if (!r.getString(layer->origin) || !r.getString(layer->root) || !r.get(rootTime) ||
+        !r.get(entries)) {
+      return;
+    }
+    layer->root_mtime = fromTicks(rootTime);
+    layer->entries.reserve(entries);
+
+    // relative paths are stored as the length shared with the previous entry
+    // plus the remaining suffix, walk order makes that share most of the path
+    std::string previous;
+    for (uint64_t e = 0; e < entries; ++e) {
+      CachedBaseFile cf;
+      uint16_t shared = 0;
+      int64_t mtime   = 0;
+      uint8_t isDir   = 0;
+
+      if (!r.get(shared) || shared > previous.size()) {
+        return;
+      }
+      cf.relative_path.assign(previous, 0, shared);
+      if (!r.getString(cf.relative_path, shared) || !r.get(cf.size) || !r.get(mtime) ||
+          !r.get(isDir)) {
+        return;
+      }
+      cf.mtime  = fromTicks(mtime);
+      cf.is_dir = isDir != 0;
+
+      previous = cf.relative_path;
+      layer->entries.push_back(std::move(cf));
+    }
+
+    m_layers.insert_or_assign(layer->root, std::move(layer));
+  }
+}
+
+std::shared_ptr<const VfsLayer> VfsLayerCache::scan(const std::string& origin,
+                                                    const std::string& root,
+                                                    LayerCheck check)
+{
+  const auto indexer = (check == LayerCheck::Quick) ? syncIndexer() : nullptr;
+
+  std::shared_ptr<const VfsLayer> cached;
+  uint64_t stamp = 0;
+  {
+    std::scoped_lock lock(m_mutex);
+    m_used.insert(root);
+    if (auto it = m_layers.find(root); it != m_layers.end()) {
+      cached = it->second;
+    }
+    stamp = m_stamp;
+  }
+
+  const bool vouched = indexer != nullptr && indexer->vouches(root, stamp);
+  const bool current =
+      cached != nullptr && (vouched || layerIsCurrent(*cached, check));
+
+  std::shared_ptr<const VfsLayer> layer;
+  if (!current) {
+    layer = scanLayer(origin, root);
+  } else if (cached->origin != origin) {
+    auto renamed    = std::make_shared<VfsLayer>(*cached);
+    renamed->origin = origin;
+    layer           = std::move(renamed);
+  } else {
+    return cached;
+  }
+
+  std::scoped_lock lock(m_mutex);
+  m_layers.insert_or_assign(root, layer);
+  m_dirty = true;
+  return layer;
+}
+
+VfsLayerList VfsLayerCache::layers() const
+{
+  std::scoped_lock lock(m_mutex);
+
+  VfsLayerList out;
+  out.reserve(m_layers.size());
+  for (const auto& [root, layer] : m_layers) {
+    out.push_back(layer);
+  }
+  return out;
+}
+
+void VfsLayerCache::update(const VfsLayerList& layers)
+{
+  std::scoped_lock lock(m_mutex);
+
+  for (const auto& layer : layers) {
+    if (layer == nullptr || layer->is_backing) {
+      continue;
+    }
+
+    m_used.insert(layer->root);
+    auto [it, inserted] = m_layers.try_emplace(layer->root, layer);
+    if (!inserted && it->second != layer) {
+      it->second = layer;
+      inserted   = true;
+    }
+    m_dirty = m_dirty || inserted;
+  }
+}
+
+bool VfsLayerCache::save()
+{
+  std::vector<std::shared_ptr<const VfsLayer>> layers;
+  {
+    std::scoped_lock lock(m_mutex);
+    if (!m_dirty) {
+      return true;
+    }
+    // layers nobody asked for in this run belong to mods that are gone
+    for (const auto& [root, layer] : m_layers) {
+      if (m_used.contains(root)) {
+        layers.push_back(layer);
+      }
+    }
+    m_dirty = false;
+  }
+
+  const auto failed = [this] {
+    std::scoped_lock lock(m_mutex);
+    m_dirty = true;
+    return false;
+  };
+
+  const std::string tmpPath = m_path + ".tmp";
+  {
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return failed();
+    }
+
+    Writer w(out);
+    out.write(Magic, sizeof(Magic));
+    w.put(Version);
+    w.put(static_cast<uint32_t>(layers.size()));
+
+    for (const auto& layer : layers) {
+      w.putString(layer->origin);
+      w.putString(layer->root);
+      w.put(toTicks(layer->root_mtime));
+      w.put(static_cast<uint64_t>(layer->entries.size()));
+
+      const std::string* previous = nullptr;
+      for (const auto& cf : layer->entries) {
+        const size_t shared = previous ? commonPrefix(*previous, cf.relative_path) : 0;
+        w.put(static_cast<uint16_t>(shared));
+        w.putString(std::string_view(cf.relative_path).substr(shared));
+        w.put(cf.size);
+        w.put(toTicks(cf.mtime));
+        w.put(static_cast<uint8_t>(cf.is_dir ? 1 : 0));
+        previous = &cf.relative_path;
+      }
+    }
+
+    if (!out.flush()) {
+      std::remove(tmpPath.c_str());
+      return failed();
+    }
+  }
+
+  std::error_code ec;
+  fs::rename(tmpPath, m_path, ec);
+  if (ec) {
+    fs::remove(tmpPath, ec);
+    return failed();
+  }
+
+  std::scoped_lock lock(m_mutex);
+  m_stamp = layerCacheStamp(m_path);
+  return true;
+}
+
+void VfsLayerCache::linkIndexer(std::string overwrite_dir)
+{
+  m_indexerDir = std::move(overwrite_dir);
+}
+
+std::shared_ptr<const IndexerLink> VfsLayerCache::syncIndexer()
+{
+  if (m_indexerDir.empty()) {
+    return nullptr;
+  }
+
+  const auto entered = Clock::now();
+  std::scoped_lock lock(m_syncMutex);
+
+  // a sync started after this call covers every write done before it
+  const bool covered = m_syncStarted >= entered ||
+                       (!m_synced && entered - m_syncStarted < SyncRetry);
+  if (!covered) {
+    m_syncStarted = Clock::now();
+
+    // the indexer may have been started after the cache was loaded
+    if (m_indexer == nullptr) {
+      m_indexer = IndexerLink::open(m_indexerDir);
+    }
+
+    m_synced = m_indexer != nullptr && m_indexer->sync(SyncTimeout);
+    if (m_synced) {
+      adopt(*m_indexer);
+    }
+  }
+
+  return m_synced ? m_indexer : nullptr;
+}
+
+void VfsLayerCache::adopt(const IndexerLink& indexer)
+{
+  // the indexer wrote the file after this process loaded or saved it, it
+  // keeps a file it agrees with
+  const uint64_t current = indexer.current();
+  if (current == 0 || current == stamp()) {
+    return;
+  }
+
+  const VfsLayerCache file(m_path);
+  if (file.m_stamp != current) {
+    return;
+  }
+
+  std::scoped_lock lock(m_mutex);
+
+  // roots the file lacks are mods that are gone
+  std::erase_if(m_layers, [&](const auto& item) {
+    return indexer.indexes(item.first) && !file.m_layers.contains(item.first);
+  });
+  for (const auto& [root, layer] : file.m_layers) {
+    if (indexer.indexes(root)) {
+      m_layers.insert_or_assign(root, layer);
+    }
+  }
+
+  m_stamp = current;
+}
+
+void VfsLayerCache::retain(const std::function<bool(const std::string& root)>& keep)
+{
+  std::scoped_lock lock(m_mutex);
+
+  for (const auto& [root, layer] : m_layers) {
+    if (keep(root)) {
+      m_used.insert(root);
+    }
+  }
+}
+
+void VfsLayerCache::forget(const std::string& root)
+{
+  std::scoped_lock lock(m_mutex);
+
+  m_used.erase(root);
+  m_dirty = m_layers.erase(root) > 0 || m_dirty;
+}
+
+uint64_t VfsLayerCache::stamp() const
+{
+  std::scoped_lock lock(m_mutex);
+  return m_stamp;
+}
+
+std::string layerCachePath(const std::string& overwrite_dir)
+{
+  fs::path overwrite = fs::path(overwrite_dir).lexically_normal();
+  if (!overwrite.has_filename()) {
+    overwrite = overwrite.parent_path();
+  }
+  return (overwrite.parent_path() / CacheName).string();
+}
+
+uint64_t layerCacheStamp(const std::string& path)
+{
+  struct stat st;
+  if (::stat(path.c_str(), &st) != 0) {
+    return 0;
+  }
+
+  // the file is always replaced by a rename, so a new version gets a new
+  // inode even if it's written within the timestamp granularity
+  const uint64_t mtime = static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000ull +
+                         static_cast<uint64_t>(st.st_mtim.tv_nsec);
+  return (mtime ^ (static_cast<uint64_t>(st.st_ino) * 0x9e3779b97f4a7c15ull)) | 1;
+}
+
+std::shared_ptr<VfsLayerCache> sharedLayerCache(const std::string& overwrite_dir)
+{
+  static std::mutex mutex;
+  static std::shared_ptr<VfsLayerCache> cache;
+  static std::string cachePath;
+
+  const std::string path = layerCachePath(overwrite_dir);
+
+  std::scoped_lock lock(mutex);
+  if (cache == nullptr || cachePath != path) {
+    cache = std::make_shared<VfsLayerCache>(path);
+    cache->linkIndexer(overwrite_dir);
+    cachePath = path;
+  }
+  return cache;
+}
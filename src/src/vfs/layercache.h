@@ -0,0 +1,112 @@
+#ifndef VFS_LAYERCACHE_H
+#define VFS_LAYERCACHE_H
+
+#include "vfstree.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+class IndexerLink;
+
+// Scanned layers persisted next to the instance, so a cold start only walks
+// the directories that changed since the last run.  Entries are loaded as is
+// and validated with layerIsCurrent() whenever they're handed out.
+//
+// Shared by the VFS and the directory refresher; all members are thread-safe.
+class VfsLayerCache
+{
+public:
+  explicit VfsLayerCache(std::string path);
+
+  // returns the cached layer for `root` if layerIsCurrent() with `check` says
+  // it's still current, scanning the directory and caching the result
+  // otherwise; quick checks are skipped for layers the indexer vouches for,
+  // see linkIndexer()
+  //
+  std::shared_ptr<const VfsLayer> scan(const std::string& origin,
+                                       const std::string& root,
+                                       LayerCheck check = LayerCheck::Quick);
+
+  // every cached layer, to be passed to scanLayers() as `previous`
+  //
+  VfsLayerList layers() const;
+
+  // records freshly scanned layers; backing layers are ignored
+  //
+  void update(const VfsLayerList& layers);
+
+  // writes the layers used by this process if anything changed since the
+  // file was loaded or last saved
+  //
+  bool save();
+
+  // the instance owning `overwrite_dir`, whose indexer vouches for layers
+  // once it has seen everything changed before a scan; it's looked for again
+  // until one runs, set before the cache is shared
+  //
+  void linkIndexer(std::string overwrite_dir);
+
+  // has save() keep the loaded layers `keep` returns true for, even if this
+  // process doesn't use them
+  //
+  void retain(const std::function<bool(const std::string& root)>& keep);
+
+  // drops the layer of `root`
+  //
+  void forget(const std::string& root);
+
+  // layerCacheStamp() of the file as it was loaded or last saved, 0 if it
+  // was replaced while it was read
+  //
+  uint64_t stamp() const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  void load();
+
+  // the indexer if it saw every change made before the call, see
+  // IndexerLink::sync(); the scans of a refresh share one sync
+  //
+  std::shared_ptr<const IndexerLink> syncIndexer();
+
+  // takes the indexer's layers from the file if it's the one the indexer
+  // knows to be current, which it can't vouch for otherwise
+  //
+  void adopt(const IndexerLink& indexer);
+
+  std::string m_path;
+  mutable std::mutex m_mutex;
+  std::unordered_map<std::string, std::shared_ptr<const VfsLayer>> m_layers;
+  std::unordered_set<std::string> m_used;
+  bool m_dirty     = false;
+  uint64_t m_stamp = 0;
+
+  std::string m_indexerDir;
+  std::mutex m_syncMutex;
+  std::shared_ptr<IndexerLink> m_indexer;
+  Clock::time_point m_syncStarted;
+  bool m_synced = false;
+};
+
+// the cache file for the instance owning `overwrite_dir`
+//
+std::string layerCachePath(const std::string& overwrite_dir);
+
+// identifies the version of the cache file at `path`, it changes whenever the
+// file is written again; 0 if there is none
+//
+uint64_t layerCacheStamp(const std::string& path);
+
+// process-wide cache for the instance owning `overwrite_dir`, loaded on first
+// use and linked to the indexer of the instance if one ran for it
+//
+std::shared_ptr<VfsLayerCache> sharedLayerCache(const std::string& overwrite_dir);
+
+#endif
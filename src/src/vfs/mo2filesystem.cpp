@@ -1,13 +1,16 @@
 #include "mo2filesystem.h"
 
 #include <fcntl.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include <algorithm>
+#include <array>
 #include <chrono>
 #include <cstring>
 #include <filesystem>
-#include <fstream>
+#include <stdexcept>
+#include <thread>
 
 namespace
 {
@@ -15,16 +18,32 @@ namespace fs = std::filesystem;
 
 constexpr double TTL_SECONDS = 60.0 * 60.0 * 24.0 * 365.0;
 
+// negative entries tracked at most, see Mo2FsContext::negative_entries
+constexpr size_t MAX_NEGATIVE_ENTRIES = 65536;
+
 struct NodeSnapshot
 {
   bool found        = false;
   bool is_directory = false;
   bool is_backing   = false;
+  bool from_archive = false;
   uint64_t size     = 0;
   std::chrono::system_clock::time_point mtime{};
   std::string real_path;
 };
 
+// Files already in the tree get new attributes under the shared tree lock,
+// see updateFileNode(), so saves and logs being written don't stall lookups
+// of everything else.  The attributes of a file node are read and written
+// under its lock here; changes to the shape of the tree still take the
+// unique lock, which excludes both.
+std::mutex& attributeLock(const VfsNode* node)
+{
+  static std::array<std::mutex, 64> locks;
+  const auto slot = reinterpret_cast<uintptr_t>(node) / sizeof(VfsNode);
+  return locks[slot % locks.size()];
+}
+
 Mo2FsContext* getContext(fuse_req_t req)
 {
   return static_cast<Mo2FsContext*>(fuse_req_userdata(req));
@@ -56,17 +75,20 @@ std::vector<std::string> splitPath(const std::string& path)
   return out;
 }
 
-std::string joinPath(const std::string& base, const std::string& name)
+std::string joinPath(const std::string& base, std::string_view name)
 {
-  if (base.empty()) {
-    return name;
+  std::string out;
+  out.reserve(base.size() + name.size() + 1);
+  out.append(base);
+  if (!base.empty()) {
+    out.push_back('/');
   }
-  return base + "/" + name;
+  out.append(name);
+  return out;
 }
 
 std::string inodeToPath(const Mo2FsContext* ctx, fuse_ino_t ino, bool* ok)
 {
-  std::scoped_lock lock(ctx->inode_mutex);
   const std::string path = ctx->inodes->getPath(ino);
 
   if (ino == 1) {
@@ -78,12 +100,9 @@ std::string inodeToPath(const Mo2FsContext* ctx, fuse_ino_t ino, bool* ok)
   return path;
 }
 
-NodeSnapshot snapshotForPath(const Mo2FsContext* ctx, const std::string& path)
+NodeSnapshot snapshotOf(const VfsTree& tree, const VfsNode* node)
 {
   NodeSnapshot snap;
-  std::shared_lock lock(ctx->tree_mutex);
-
-  const VfsNode* node = path.empty() ? &ctx->tree->root : ctx->tree->root.resolve(splitPath(path));
   if (node == nullptr) {
     return snap;
   }
@@ -91,33 +110,67 @@ NodeSnapshot snapshotForPath(const Mo2FsContext* ctx, const std::string& path)
   snap.found        = true;
   snap.is_directory = node->is_directory;
   if (!node->is_directory) {
-    snap.real_path  = node->file_info.real_path;
+    std::scoped_lock lock(attributeLock(node));
+    snap.real_path  = tree.realPath(*node);
     snap.size       = node->file_info.size;
     snap.mtime      = node->file_info.mtime;
-    snap.is_backing = node->file_info.is_backing;
+    snap.is_backing   = node->file_info.is_backing;
+    snap.from_archive = node->file_info.from_archive;
   }
 
   return snap;
 }
 
-std::vector<std::pair<std::string, bool>> listChildrenSnapshot(
-    const Mo2FsContext* ctx, const std::string& path, bool* ok)
+NodeSnapshot snapshotIn(const VfsTree& tree, const std::string& path)
+{
+  return snapshotOf(tree, path.empty() ? &tree.root() : tree.resolve(splitPath(path)));
+}
+
+NodeSnapshot snapshotForPath(const Mo2FsContext* ctx, const std::string& path)
 {
-  std::vector<std::pair<std::string, bool>> out;
   std::shared_lock lock(ctx->tree_mutex);
+  return snapshotIn(*ctx->tree, path);
+}
 
-  const VfsNode* node = path.empty() ? &ctx->tree->root : ctx->tree->root.resolve(splitPath(path));
-  if (node == nullptr || !node->is_directory) {
-    *ok = false;
-    return out;
+// Resolves an inode to its tree node, using the node cached in the inode table
+// when it is still valid for the current tree generation.  The caller must
+// hold tree_mutex.
+const VfsNode* nodeForInode(const Mo2FsContext* ctx, fuse_ino_t ino)
+{
+  if (ino == 1) {
+    return &ctx->tree->root();
   }
 
-  *ok = true;
-  for (const auto& [name, child] : node->listChildren()) {
-    out.emplace_back(name, child->is_directory);
+  const uint64_t generation = ctx->tree_generation.load(std::memory_order_acquire);
+
+  std::string path;
+  if (const VfsNode* cached = ctx->inodes->cachedNode(ino, generation, &path)) {
+    return cached;
   }
 
-  return out;
+  if (path.empty()) {
+    return nullptr;
+  }
+
+  const VfsNode* node = ctx->tree->resolve(splitPath(path));
+  if (node != nullptr) {
+    ctx->inodes->cacheNode(ino, node, generation);
+  }
+
+  return node;
+}
+
+NodeSnapshot snapshotForInode(const Mo2FsContext* ctx, fuse_ino_t ino)
+{
+  std::shared_lock lock(ctx->tree_mutex);
+  return snapshotOf(*ctx->tree, nodeForInode(ctx, ino));
+}
+
+// Must be called with the unique tree lock held after any change that may
+// free or replace existing nodes.
+void invalidateNodeCache(Mo2FsContext* ctx)
+{
+  ctx->tree_generation.fetch_add(1, std::memory_order_release);
 }
 
 void fillStatForDir(struct stat* st, fuse_ino_t ino, uid_t uid, gid_t gid)
@@ -149,60 +202,928 @@ void fillStatForFile(struct stat* st, fuse_ino_t ino, uid_t uid, gid_t gid,
   st->st_atim.tv_sec = secs.count();
 }
 
+void fillEntryParam(struct fuse_entry_param* e, const Mo2FsContext* ctx,
+                    fuse_ino_t ino, bool isDirectory, uint64_t size,
+                    const std::chrono::system_clock::time_point& mtime)
+{
+  std::memset(e, 0, sizeof(*e));
+  e->ino           = ino;
+  e->attr_timeout  = TTL_SECONDS;
+  e->entry_timeout = TTL_SECONDS;
+
+  if (isDirectory) {
+    fillStatForDir(&e->attr, ino, ctx->uid, ctx->gid);
+  } else {
+    fillStatForFile(&e->attr, ino, ctx->uid, ctx->gid, size, mtime);
+  }
+}
+
 void replyEntryFromSnapshot(fuse_req_t req, const Mo2FsContext* ctx, fuse_ino_t ino,
                             const NodeSnapshot& snap)
 {
+  struct fuse_entry_param e;
+  fillEntryParam(&e, ctx, ino, snap.is_directory, snap.size, snap.mtime);
+  fuse_reply_entry(req, &e);
+}
+
+// Captures a directory listing once, together with the attributes needed by
+// readdirplus.  Offsets handed to the kernel are indices into this snapshot,
+// so continuation calls stay stable even if the tree is rebuilt meanwhile.
+std::shared_ptr<Mo2FsContext::OpenDir> snapshotDirectory(Mo2FsContext* ctx,
+                                                         fuse_ino_t ino, int* err)
+{
+  bool ok = false;
+  const std::string path = inodeToPath(ctx, ino, &ok);
+  if (!ok) {
+    *err = ENOENT;
+    return nullptr;
+  }
+
+  auto dir = std::make_shared<Mo2FsContext::OpenDir>();
+
+  std::shared_lock lock(ctx->tree_mutex);
+  const VfsNode* node = nodeForInode(ctx, ino);
+  if (node == nullptr || !node->is_directory) {
+    *err = ENOTDIR;
+    return nullptr;
+  }
+
+  const uint64_t generation = ctx->tree_generation.load(std::memory_order_acquire);
+  const auto children       = ctx->tree->listChildren(*node);
+
+  dir->entries.reserve(children.size() + 2);
+  dir->entries.push_back({ino, ".", true});
+  dir->entries.push_back({1, "..", true});
+
+  for (const auto& [name, child] : children) {
+    Mo2FsContext::DirEntry entry;
+    entry.ino          = ctx->inodes->getOrCreate(joinPath(path, name), child, generation);
+    entry.name         = name;
+    entry.is_directory = child->is_directory;
+    if (!child->is_directory) {
+      std::scoped_lock attributes(attributeLock(child));
+      entry.size  = child->file_info.size;
+      entry.mtime = child->file_info.mtime;
+    }
+    dir->entries.push_back(std::move(entry));
+  }
+
+  return dir;
+}
+
+void replyDirectory(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
+                    struct fuse_file_info* fi, bool plus)
+{
+  Mo2FsContext* ctx = getContext(req);
+  VfsOpTimer timer(ctx ? ctx->metrics : nullptr, VfsOp::Readdir);
+  if (ctx == nullptr || off < 0) {
+    fuse_reply_err(req, EINVAL);
+    return;
+  }
+
+  std::shared_ptr<Mo2FsContext::OpenDir> dir;
+  if (fi != nullptr) {
+    std::scoped_lock lock(ctx->open_dirs_mutex);
+    auto it = ctx->open_dirs.find(fi->fh);
+    if (it != ctx->open_dirs.end()) {
+      dir = it->second;
+    }
+  }
+
+  if (dir == nullptr) {
+    // no handle from opendir, list the directory for this call only
+    int err = 0;
+    dir     = snapshotDirectory(ctx, ino, &err);
+    if (dir == nullptr) {
+      fuse_reply_err(req, err);
+      return;
+    }
+  }
+
+  std::vector<char> buf(size);
+  size_t used = 0;
+
+  for (size_t i = static_cast<size_t>(off); i < dir->entries.size(); ++i) {
+    const auto& entry = dir->entries[i];
+    size_t ent        = 0;
+
+    if (plus) {
+      struct fuse_entry_param e;
+      fillEntryParam(&e, ctx, entry.ino, entry.is_directory, entry.size, entry.mtime);
+      ent = fuse_add_direntry_plus(req, buf.data() + used, size - used,
+                                   entry.name.c_str(), &e, static_cast<off_t>(i + 1));
+    } else {
+      struct stat st;
+      std::memset(&st, 0, sizeof(st));
+      st.st_ino  = entry.ino;
+      st.st_mode = entry.is_directory ? (S_IFDIR | 0755) : (S_IFREG | 0644);
+      ent = fuse_add_direntry(req, buf.data() + used, size - used, entry.name.c_str(),
+                              &st, static_cast<off_t>(i + 1));
+    }
+
+    if (ent > size - used) {
+      break;
+    }
+    used += ent;
+  }
+
+  fuse_reply_buf(req, buf.data(), used);
+}
+
+bool isWritableOpen(int flags)
+{
+  return (flags & O_WRONLY) != 0 || (flags & O_RDWR) != 0;
+}
+
+// Opens the file that a handle reads from.  Backing (base game) files are
+// stored relative to the data directory and must be opened through the fd
+// that was taken before the mount hid them.
+int openRealFd(const Mo2FsContext* ctx, const std::string& realPath,
+               bool isBacking, bool writable)
+{
+  const int flags = (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC;
+  if (isBacking && ctx->backing_dir_fd >= 0) {
+    return openat(ctx->backing_dir_fd, realPath.c_str(), flags);
+  }
+  return open(realPath.c_str(), flags);
+}
+
+std::shared_ptr<Mo2FsContext::OpenFile> findOpenFile(Mo2FsContext* ctx, uint64_t fh)
+{
+  std::scoped_lock lock(ctx->open_files_mutex);
+  auto it = ctx->open_files.find(fh);
+  if (it == ctx->open_files.end()) {
+    return nullptr;
+  }
+  return it->second;
+}
+
+bool isArchive(std::string_view path)
+{
+  const auto dot = path.rfind('.');
+  if (dot == std::string_view::npos) {
+    return false;
+  }
+  const std::string ext = normalizeForLookup(path.substr(dot + 1));
+  return ext == "bsa" || ext == "ba2";
+}
+
+// The folder and file records of an archive sit at its start and are read
+// before anything else, have them in the page cache by the first read.
+void prefetchArchiveIndex(const Mo2FsContext* ctx, const Mo2FsContext::OpenFile& of)
+{
+  if (ctx->prefetch && !of.writable && isArchive(of.relative_path)) {
+    posix_fadvise(of.fd, 0, Mo2FsContext::ArchiveIndexPrefetch, POSIX_FADV_WILLNEED);
+  }
+}
+
+// Called for each read on a handle: a read that starts where the previous
+// one ended extends the sequential run, which gets the range ahead of it
+// prefetched.  A new hint is only issued once the reader gets within half a
+// window of what was already requested, so a long run costs a syscall every
+// few megabytes rather than one per read.
+void prefetchAhead(const Mo2FsContext* ctx, Mo2FsContext::OpenFile& of, off_t off,
+                   size_t size)
+{
+  if (!ctx->prefetch) {
+    return;
+  }
+
+  const int64_t end      = off + static_cast<int64_t>(size);
+  const int64_t expected = of.next_offset.exchange(end, std::memory_order_relaxed);
+
+  if (off != expected) {
+    of.prefetch_window.store(0, std::memory_order_relaxed);
+    of.prefetched_to.store(0, std::memory_order_relaxed);
+    return;
+  }
+
+  uint32_t window = of.prefetch_window.load(std::memory_order_relaxed);
+  if (window == 0) {
+    // the first read of a run only arms it, single reads don't get a hint
+    of.prefetch_window.store(Mo2FsContext::PrefetchMinWindow, std::memory_order_relaxed);
+    return;
+  }
+
+  const int64_t prefetched = of.prefetched_to.load(std::memory_order_relaxed);
+  if (end + window / 2 < prefetched) {
+    return;
+  }
+
+  const int64_t from = std::max(end, prefetched);
+  const int64_t to   = end + window;
+  posix_fadvise(of.fd, from, to - from, POSIX_FADV_WILLNEED);
+
+  of.prefetched_to.store(to, std::memory_order_relaxed);
+  of.prefetch_window.store(std::min(window * 2, Mo2FsContext::PrefetchMaxWindow),
+                           std::memory_order_relaxed);
+}
+
+std::chrono::system_clock::time_point fileMtimeOrNow(const std::string& path)
+{
+  std::error_code ec;
+  const auto mtime = fs::last_write_time(path, ec);
+  if (ec) {
+    return std::chrono::system_clock::now();
+  }
+
+  const auto nowFs  = fs::file_time_type::clock::now();
+  const auto nowSys = std::chrono::system_clock::now();
+  return nowSys + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                      mtime - nowFs);
+}
+
+void updateFileNode(Mo2FsContext* ctx, const std::string& relative,
+                    const std::string& realPath, const std::string& origin)
+{
+  std::error_code ec;
+  const auto fileSize = static_cast<uint64_t>(fs::file_size(realPath, ec));
+  const uint64_t size = ec ? 0 : fileSize;
+  const auto mtime    = fileMtimeOrNow(realPath);
+
+  const auto components = splitPath(relative);
+
+  // a file that's in the tree already only needs new attributes
+  {
+    std::shared_lock lock(ctx->tree_mutex);
+    VfsNode* existing = ctx->tree->resolve(components);
+    if (existing != nullptr && !existing->is_directory) {
+      std::scoped_lock attributes(attributeLock(existing));
+      if (ctx->tree->updateFileInfo(*existing, realPath, size, mtime, origin)) {
+        return;
+      }
+    }
+  }
+
+  std::unique_lock lock(ctx->tree_mutex);
+
+  // update existing files in place so cached inode -> node pointers stay valid
+  VfsNode* existing = ctx->tree->resolve(components);
+  if (existing != nullptr && !existing->is_directory) {
+    ctx->tree->setFileInfo(*existing, realPath, size, mtime, origin);
+    return;
+  }
+
+  ctx->tree->insertFile(components, realPath, size, mtime, origin);
+  if (existing != nullptr) {
+    invalidateNodeCache(ctx);
+  } else {
+    ++ctx->tree->file_count;
+  }
+}
+
+std::chrono::system_clock::time_point toTimePoint(const struct timespec& ts)
+{
+  return std::chrono::system_clock::time_point(
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec)));
+}
+
+// Gives the tree the size and mtime of a handle that was written to.  The fd
+// still refers to the file after a rename or unlink, so the node is only
+// updated while it still has the handle's file; nothing is brought back.
+void settleWrites(Mo2FsContext* ctx, Mo2FsContext::OpenFile& of)
+{
+  if (!of.dirty.exchange(false)) {
+    return;
+  }
+  ctx->dirty_handles.fetch_sub(1, std::memory_order_relaxed);
+
+  struct stat st;
+  if (fstat(of.fd, &st) != 0) {
+    return;
+  }
+
+  const auto components = splitPath(of.relative_path);
+  const auto size       = static_cast<uint64_t>(st.st_size);
+  const auto mtime      = toTimePoint(st.st_mtim);
+
+  {
+    std::shared_lock lock(ctx->tree_mutex);
+
+    VfsNode* existing = ctx->tree->resolve(components);
+    if (existing == nullptr || existing->is_directory) {
+      return;
+    }
+
+    std::scoped_lock attributes(attributeLock(existing));
+    if (ctx->tree->realPath(*existing) != of.real_path ||
+        ctx->tree->updateFileInfo(*existing, of.real_path, size, mtime, "Staging")) {
+      return;
+    }
+  }
+
+  std::unique_lock lock(ctx->tree_mutex);
+
+  VfsNode* existing = ctx->tree->resolve(components);
+  if (existing != nullptr && !existing->is_directory &&
+      ctx->tree->realPath(*existing) == of.real_path) {
+    ctx->tree->setFileInfo(*existing, of.real_path, size, mtime, "Staging");
+  }
+}
+
+// Settles the dirty handles of `path`, or of every file if it's empty.
+void settleWrites(Mo2FsContext* ctx, const std::string& path)
+{
+  if (ctx->dirty_handles.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+
+  std::vector<std::shared_ptr<Mo2FsContext::OpenFile>> dirty;
+  {
+    std::scoped_lock lock(ctx->open_files_mutex);
+    for (const auto& [fh, of] : ctx->open_files) {
+      if (of->dirty.load(std::memory_order_relaxed) &&
+          (path.empty() || of->relative_path == path)) {
+        dirty.push_back(of);
+      }
+    }
+  }
+
+  for (const auto& of : dirty) {
+    settleWrites(ctx, *of);
+  }
+}
+
+// Gives the staged copy of `path` the mtime the kernel set, which it does for
+// `touch` and, with the writeback cache, whenever it writes a file back.
+// Files that aren't staged keep theirs, that's not worth copying a mod file.
+void applyMtime(Mo2FsContext* ctx, const std::string& path, const struct stat& attr,
+                int to_set)
+{
+  const auto snap = snapshotForPath(ctx, path);
+  if (!snap.found || snap.is_directory || snap.is_backing) {
+    return;
+  }
+
+  const std::string staged = ctx->overwrite->stagingPath(path);
+  if (fs::path(snap.real_path).lexically_normal() !=
+      fs::path(staged).lexically_normal()) {
+    return;
+  }
+
+  struct timespec times[2];
+  times[0].tv_sec  = 0;
+  times[0].tv_nsec = UTIME_OMIT;
+  if ((to_set & FUSE_SET_ATTR_MTIME_NOW) != 0) {
+    times[1].tv_sec  = 0;
+    times[1].tv_nsec = UTIME_NOW;
+  } else {
+    times[1] = attr.st_mtim;
+  }
+
+  if (utimensat(AT_FDCWD, staged.c_str(), times, 0) == 0) {
+    updateFileNode(ctx, path, staged, "Staging");
+  }
+}
+
+// Writes the file `relative` from the archive at `archivePath` to staging.
+// Throws like OverwriteManager::writeFile().
+std::string extractToStaging(Mo2FsContext* ctx, const std::string& relative,
+                             const std::string& archivePath)
+{
+  const auto content = ctx->archive_files.read(archivePath, relative);
+  if (content == nullptr) {
+    throw std::runtime_error("can't read " + relative + " from " + archivePath);
+  }
+
+  return ctx->overwrite->writeFile(
+      relative, std::vector<uint8_t>(content->data.begin(), content->data.end()));
+}
+
+// Copies the file providing `relative` into staging unless it's staged
+// already, either from the backing dir, from an archive or from its real
+// path.  Throws like OverwriteManager::copyOnWrite().
+std::string copyToStaging(Mo2FsContext* ctx, const std::string& relative,
+                          const std::string& realPath, bool isBacking,
+                          bool fromArchive)
+{
+  // the copy is only looked for by name, one still being written mustn't be
+  // taken for a finished one
+  std::scoped_lock copyLock(ctx->copy_up_mutex);
+
+  std::error_code ec;
+  const std::string staged = ctx->overwrite->stagingPath(relative);
+  const bool wasStaged     = fs::exists(staged, ec);
+
+  std::string copy;
+  if (fromArchive) {
+    copy = wasStaged ? staged : extractToStaging(ctx, relative, realPath);
+  } else if (isBacking && ctx->backing_dir_fd >= 0) {
+    copy = ctx->overwrite->copyOnWriteFromFd(ctx->backing_dir_fd, relative);
+  } else {
+    copy = ctx->overwrite->copyOnWrite(realPath, relative);
+  }
+
+  if (!wasStaged) {
+    const auto size = fs::file_size(copy, ec);
+    ctx->metrics->addCopyUp(ec ? 0 : size);
+  }
+  return copy;
+}
+
+// Performs the deferred copy-up of a lazily opened writable handle and rebinds
+// the handle to the staged copy.  Returns the handle to write through, or
+// null with *err set.
+std::shared_ptr<Mo2FsContext::OpenFile> copyUpHandle(Mo2FsContext* ctx, uint64_t fh,
+                                                     int* err)
+{
+  std::scoped_lock copyLock(ctx->copy_up_mutex);
+
+  auto open = findOpenFile(ctx, fh);
+  if (open == nullptr) {
+    *err = EBADF;
+    return nullptr;
+  }
+  if (!open->copy_up_pending) {
+    return open;
+  }
+
+  std::string staged;
+  try {
+    // archived handles are never deferred, see mo2_open()
+    staged = copyToStaging(ctx, open->relative_path, open->real_path, open->is_backing,
+                           false);
+  } catch (...) {
+    *err = EIO;
+    return nullptr;
+  }
+
+  auto rebound           = std::make_shared<Mo2FsContext::OpenFile>();
+  rebound->real_path     = staged;
+  rebound->writable      = true;
+  rebound->relative_path = open->relative_path;
+  rebound->ino           = open->ino;
+  rebound->fd            = openRealFd(ctx, staged, false, true);
+  if (rebound->fd < 0) {
+    *err = errno != 0 ? errno : EIO;
+    return nullptr;
+  }
+
+  {
+    std::scoped_lock lock(ctx->open_files_mutex);
+    if (auto it = ctx->open_files.find(fh); it != ctx->open_files.end()) {
+      it->second = rebound;
+    }
+  }
+
+  updateFileNode(ctx, rebound->relative_path, staged, "Staging");
+  return rebound;
+}
+
+// whether `ino` is in passthrough, see InodeOpens
+bool inPassthrough(Mo2FsContext* ctx, fuse_ino_t ino)
+{
+  std::scoped_lock lock(ctx->inode_opens_mutex);
+  const auto it = ctx->inode_opens.find(ino);
+  return it != ctx->inode_opens.end() && it->second.passthrough > 0;
+}
+
+// Accounts the handle `of` to `ino`, in passthrough if `wantsPassthrough` and
+// the inode can be, see InodeOpens.  Returns false if the inode is in
+// passthrough and `of` can't share its backing file.
+bool registerOpen(fuse_req_t req, Mo2FsContext* ctx, fuse_ino_t ino,
+                  Mo2FsContext::OpenFile& of, bool wantsPassthrough,
+                  struct fuse_file_info* fi)
+{
+  std::scoped_lock lock(ctx->inode_opens_mutex);
+  auto& opens = ctx->inode_opens[ino];
+  of.ino      = ino;
+
+#ifdef FUSE_CAP_PASSTHROUGH
+  if (opens.passthrough > 0) {
+    // joined even once new inodes stopped entering passthrough
+    if (!wantsPassthrough || opens.real_path != of.real_path) {
+      return false;
+    }
+
+    ++opens.passthrough;
+    of.passthrough = true;
+    fi->backing_id = opens.backing_id;
+    return true;
+  }
+
+  if (wantsPassthrough && opens.other == 0 &&
+      ctx->passthrough_active.load(std::memory_order_relaxed)) {
+    const int backingId = fuse_passthrough_open(req, of.fd);
+    const int err       = errno;
+    if (backingId > 0) {
+      opens.passthrough = 1;
+      opens.backing_id  = backingId;
+      opens.real_path   = of.real_path;
+      of.passthrough    = true;
+      fi->backing_id    = backingId;
+      return true;
+    }
+
+    // unprivileged, no open will get a backing id; otherwise it's just this
+    // fd type and only this inode is served by the daemon
+    if (err == EPERM) {
+      ctx->passthrough_active.store(false, std::memory_order_relaxed);
+    }
+  }
+#else
+  (void)req;
+  (void)wantsPassthrough;
+  (void)fi;
+#endif
+
+  ++opens.other;
+  return true;
+}
+
+// undoes registerOpen() for `of`, the inode leaves passthrough with its last
+// passthrough handle
+void unregisterOpen(fuse_req_t req, Mo2FsContext* ctx, const Mo2FsContext::OpenFile& of)
+{
+  std::scoped_lock lock(ctx->inode_opens_mutex);
+  const auto it = ctx->inode_opens.find(of.ino);
+  if (it == ctx->inode_opens.end()) {
+    return;
+  }
+
+  auto& opens = it->second;
+  if (!of.passthrough) {
+    --opens.other;
+  } else if (--opens.passthrough == 0) {
+#ifdef FUSE_CAP_PASSTHROUGH
+    fuse_passthrough_close(req, opens.backing_id);
+#endif
+    opens.backing_id = 0;
+    opens.real_path.clear();
+  }
+
+  if (opens.passthrough == 0 && opens.other == 0) {
+    ctx->inode_opens.erase(it);
+  }
+}
+
+// `path` with its prefix `from` replaced by `to`, or empty if it's neither
+// `from` nor below it
+std::string renamedPath(const std::string& path, const std::string& from,
+                        const std::string& to)
+{
+  if (path == from) {
+    return to;
+  }
+  if (path.size() > from.size() && path.starts_with(from) && path[from.size()] == '/') {
+    return to + path.substr(from.size());
+  }
+  return {};
+}
+
+// Rebinds the open handles of `from`, or of anything below it, to the paths
+// they have after the rename to `to`; a dirty handle would otherwise settle
+// its size and mtime on the old path.  The handles are replaced rather than
+// changed, reads in flight may still use the old ones.
+void rebindRenamed(Mo2FsContext* ctx, const std::string& from, const std::string& to)
+{
+  const std::string stagedFrom    = ctx->overwrite->stagingPath(from);
+  const std::string stagedTo      = ctx->overwrite->stagingPath(to);
+  const std::string overwriteFrom = ctx->overwrite->overwritePath(from);
+  const std::string overwriteTo   = ctx->overwrite->overwritePath(to);
+
+  std::scoped_lock lock(ctx->open_files_mutex);
+  for (auto& [fh, open] : ctx->open_files) {
+    std::string relative = renamedPath(open->relative_path, from, to);
+    if (relative.empty() || open->archived != nullptr || open->fd < 0) {
+      continue;
+    }
+
+    std::string real = renamedPath(open->real_path, stagedFrom, stagedTo);
+    if (real.empty()) {
+      real = renamedPath(open->real_path, overwriteFrom, overwriteTo);
+    }
+
+    const int fd = fcntl(open->fd, F_DUPFD_CLOEXEC, 0);
+    if (fd < 0) {
+      continue;
+    }
+
+    auto rebound             = std::make_shared<Mo2FsContext::OpenFile>();
+    rebound->real_path       = real.empty() ? open->real_path : std::move(real);
+    rebound->writable        = open->writable;
+    rebound->is_backing      = open->is_backing;
+    rebound->relative_path   = std::move(relative);
+    rebound->fd              = fd;
+    rebound->ino             = open->ino;
+    rebound->passthrough     = open->passthrough;
+    rebound->copy_up_pending = open->copy_up_pending;
+    rebound->next_offset     = open->next_offset.load(std::memory_order_relaxed);
+    rebound->prefetched_to   = open->prefetched_to.load(std::memory_order_relaxed);
+    rebound->prefetch_window = open->prefetch_window.load(std::memory_order_relaxed);
+
+    // the dirty count stays, it moves with the flag
+    if (open->dirty.exchange(false)) {
+      rebound->dirty = true;
+    }
+
+    if (rebound->passthrough) {
+      std::scoped_lock opensLock(ctx->inode_opens_mutex);
+      if (auto it = ctx->inode_opens.find(rebound->ino);
+          it != ctx->inode_opens.end() && it->second.real_path == open->real_path) {
+        it->second.real_path = rebound->real_path;
+      }
+    }
+
+    open = std::move(rebound);
+  }
+}
+
+
+// A path the kernel has an inode for, and what it was last told about it.
+struct KernelEntry
+{
+  fuse_ino_t ino = 0;
+  std::string path;
+  NodeSnapshot before;
+};
+
+// snapshots the paths among `inodes` in `tree`; the caller must hold
+// tree_mutex
+std::vector<KernelEntry>
+kernelEntries(const VfsTree& tree,
+              std::vector<std::pair<uint64_t, std::string>> inodes)
+{
+  std::vector<KernelEntry> out;
+  out.reserve(inodes.size());
+  for (auto& [ino, path] : inodes) {
+    NodeSnapshot before = snapshotIn(tree, path);
+    out.push_back({ino, std::move(path), std::move(before)});
+  }
+  return out;
+}
+
+// same as above for the inodes, if any, of lookup keys
+std::vector<KernelEntry> kernelEntries(const Mo2FsContext* ctx, const VfsTree& tree,
+                                       const std::vector<std::string>& keys)
+{
+  std::vector<std::pair<uint64_t, std::string>> inodes;
+  for (const auto& key : keys) {
+    if (const uint64_t ino = ctx->inodes->find(key); ino != 0) {
+      inodes.emplace_back(ino, ctx->inodes->getPath(ino));
+    }
+  }
+  return kernelEntries(tree, std::move(inodes));
+}
+
+bool sameAttributes(const NodeSnapshot& a, const NodeSnapshot& b)
+{
+  return a.found == b.found && a.is_directory == b.is_directory && a.size == b.size &&
+         a.mtime == b.mtime && a.real_path == b.real_path;
+}
+
+// Drops what the kernel cached for entries that changed in the current tree:
+// attributes and pages of changed files, and the dentry of anything that went
+// away or changed type.  Everything else keeps its long TTLs and page cache.
+//
+// Dentries are invalidated under the name the inode was first looked up
+// with; other casings of the same name the kernel may hold aren't known.
+void invalidateChanged(Mo2FsContext* ctx, const std::vector<KernelEntry>& entries)
+{
+  if (ctx->session == nullptr || entries.empty()) {
+    return;
+  }
+
+  struct Notification
+  {
+    fuse_ino_t ino    = 0;
+    fuse_ino_t parent = 0;
+    std::string name;
+  };
+
+  std::vector<Notification> notifications;
+  {
+    std::shared_lock lock(ctx->tree_mutex);
+    for (const auto& entry : entries) {
+      const NodeSnapshot after = snapshotIn(*ctx->tree, entry.path);
+      if (sameAttributes(entry.before, after)) {
+        continue;
+      }
+
+      Notification n;
+      n.ino = entry.ino;
+      if (!after.found || after.is_directory != entry.before.is_directory) {
+        const size_t slash = entry.path.rfind('/');
+        if (slash == std::string::npos) {
+          n.parent = 1;
+          n.name   = entry.path;
+        } else {
+          n.parent = ctx->inodes->find(entry.path.substr(0, slash));
+          n.name   = entry.path.substr(slash + 1);
+        }
+      }
+      notifications.push_back(std::move(n));
+    }
+  }
+
+  // sent without the tree lock, the kernel may wait for requests on these
+  // inodes that are still in flight
+  for (const auto& n : notifications) {
+    if (n.parent != 0) {
+      fuse_lowlevel_notify_inval_entry(ctx->session, n.parent, n.name.c_str(),
+                                       n.name.size());
+    }
+    fuse_lowlevel_notify_inval_inode(ctx->session, n.ino, 0, 0);
+  }
+}
+
+// Remembers that `path` is about to be handed out as a negative entry under
+// `parent`.  Returns false if the table is full of entries the kernel may
+// still hold.
+bool trackNegativeEntry(Mo2FsContext* ctx, fuse_ino_t parent, std::string path)
+{
+  const auto now = std::chrono::steady_clock::now();
+  std::scoped_lock lock(ctx->negative_mutex);
+
+  if (ctx->negative_entries.size() >= MAX_NEGATIVE_ENTRIES &&
+      !ctx->negative_entries.contains(path)) {
+    std::erase_if(ctx->negative_entries, [&](const auto& entry) {
+      return entry.second.second <= now;
+    });
+    if (ctx->negative_entries.size() >= MAX_NEGATIVE_ENTRIES) {
+      return false;
+    }
+  }
+
+  const auto expiry = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                std::chrono::duration<double>(ctx->negative_timeout));
+  ctx->negative_entries.insert_or_assign(std::move(path), std::make_pair(parent, expiry));
+  return true;
+}
+
+void replyMissing(fuse_req_t req, Mo2FsContext* ctx, fuse_ino_t parent,
+                  const std::string& parentPath, const char* name)
+{
+  if (ctx->negative_timeout <= 0 ||
+      !trackNegativeEntry(ctx, parent, joinPath(parentPath, name))) {
+    fuse_reply_err(req, ENOENT);
+    return;
+  }
+
+  // a zero inode is a negative entry, cached for entry_timeout
   struct fuse_entry_param e;
   std::memset(&e, 0, sizeof(e));
-  e.ino           = ino;
-  e.attr_timeout  = TTL_SECONDS;
-  e.entry_timeout = TTL_SECONDS;
+  e.ino           = 0;
+  e.entry_timeout = ctx->negative_timeout;
+  fuse_reply_entry(req, &e);
+}
 
-  if (snap.is_directory) {
-    fillStatForDir(&e.attr, ino, ctx->uid, ctx->gid);
-  } else {
-    fillStatForFile(&e.attr, ino, ctx->uid, ctx->gid, snap.size, snap.mtime);
+// Invalidates the negative entries handed out for paths that exist in the
+// current tree and forgets those that expired.
+void invalidateNegativeEntries(Mo2FsContext* ctx)
+{
+  std::vector<std::pair<fuse_ino_t, std::string>> found;
+  {
+    const auto now = std::chrono::steady_clock::now();
+    std::shared_lock treeLock(ctx->tree_mutex);
+    std::scoped_lock lock(ctx->negative_mutex);
+
+    for (auto it = ctx->negative_entries.begin(); it != ctx->negative_entries.end();) {
+      const auto& [path, entry] = *it;
+      if (entry.second <= now) {
+        it = ctx->negative_entries.erase(it);
+      } else if (snapshotIn(*ctx->tree, path).found) {
+        const size_t slash = path.rfind('/');
+        found.emplace_back(entry.first,
+                           slash == std::string::npos ? path : path.substr(slash + 1));
+        it = ctx->negative_entries.erase(it);
+      } else {
+        ++it;
+      }
+    }
   }
 
-  fuse_reply_entry(req, &e);
+  if (ctx->session == nullptr) {
+    return;
+  }
+  for (const auto& [parent, name] : found) {
+    fuse_lowlevel_notify_inval_entry(ctx->session, parent, name.c_str(), name.size());
+  }
 }
 
-bool isWritableOpen(int flags)
+}  // namespace
+
+void Mo2FsContext::replaceTree(std::shared_ptr<VfsTree> newTree)
 {
-  return (flags & O_WRONLY) != 0 || (flags & O_RDWR) != 0;
+  // the old tree is released by the caller's argument after the lock is gone,
+  // so tearing down a large tree doesn't stall readers
+  std::unique_lock lock(tree_mutex);
+  tree.swap(newTree);
+  tree_generation.fetch_add(1, std::memory_order_release);
 }
 
-std::chrono::system_clock::time_point fileMtimeOrNow(const std::string& path)
+bool Mo2FsContext::updateLayers(
+    VfsLayerList newLayers, std::vector<std::pair<std::string, std::string>> extraFiles,
+    bool allowIncremental)
 {
-  std::error_code ec;
-  const auto mtime = fs::last_write_time(path, ec);
-  if (ec) {
-    return std::chrono::system_clock::now();
+  if (serve_archives) {
+    newLayers = archive_files.addLayers(newLayers, layers);
   }
 
-  const auto nowFs  = fs::file_time_type::clock::now();
-  const auto nowSys = std::chrono::system_clock::now();
-  return nowSys + std::chrono::duration_cast<std::chrono::system_clock::duration>(
-                      mtime - nowFs);
+  if (allowIncremental && tree != nullptr) {
+    // injected files are re-resolved every time so removed mappings go away
+    std::vector<std::string> extraTouched;
+    extraTouched.reserve(extra_files.size() + extraFiles.size());
+    for (const auto& [relPath, realPath] : extra_files) {
+      extraTouched.push_back(relPath);
+    }
+    for (const auto& [relPath, realPath] : extraFiles) {
+      extraTouched.push_back(relPath);
+    }
+
+    VfsLayerPatch patch;
+    std::vector<KernelEntry> known;
+    bool planned = false;
+    {
+      std::shared_lock lock(tree_mutex);
+      planned = planLayerChanges(*tree, layers, newLayers, extraTouched, &patch);
+      if (planned && session != nullptr) {
+        known = kernelEntries(this, *tree, patch.touched);
+      }
+    }
+
+    if (planned) {
+      {
+        std::unique_lock lock(tree_mutex);
+        applyLayerPatch(*tree, patch);
+        injectExtraFiles(*tree, extraFiles);
+        tree_generation.fetch_add(1, std::memory_order_release);
+      }
+      invalidateChanged(this, known);
+      invalidateNegativeEntries(this);
+
+      // the old layers are released with `newLayers` on return
+      layers.swap(newLayers);
+      extra_files = std::move(extraFiles);
+      return true;
+    }
+  }
+
+  auto newTree = std::make_shared<VfsTree>(buildTreeFromLayers(newLayers));
+  injectExtraFiles(*newTree, extraFiles);
+
+  // any path the kernel knows may have changed, compare them all
+  std::vector<KernelEntry> known;
+  if (session != nullptr && tree != nullptr) {
+    std::shared_lock lock(tree_mutex);
+    known = kernelEntries(*tree, inodes->entries());
+  }
+
+  replaceTree(std::move(newTree));
+  invalidateChanged(this, known);
+  invalidateNegativeEntries(this);
+
+  layers      = std::move(newLayers);
+  extra_files = std::move(extraFiles);
+  return false;
 }
 
-void updateFileNode(Mo2FsContext* ctx, const std::string& relative,
-                    const std::string& realPath, const std::string& origin)
+Mo2FsContext::OpenFile::~OpenFile()
 {
-  std::error_code ec;
-  const uint64_t size = static_cast<uint64_t>(fs::file_size(realPath, ec));
-  const auto mtime    = fileMtimeOrNow(realPath);
-
-  std::unique_lock lock(ctx->tree_mutex);
-  ctx->tree->root.insertFile(splitPath(relative), realPath, ec ? 0 : size, mtime,
-                             origin);
+  if (fd >= 0) {
+    close(fd);
+  }
 }
 
-}  // namespace
+void mo2_init(void* userdata, struct fuse_conn_info* conn)
+{
+  auto* ctx = static_cast<Mo2FsContext*>(userdata);
+  if (ctx == nullptr || conn == nullptr) {
+    return;
+  }
+
+  if (ctx->splice_reads) {
+    if ((conn->capable & FUSE_CAP_SPLICE_WRITE) != 0) {
+      conn->want |= FUSE_CAP_SPLICE_WRITE;
+    }
+    if ((conn->capable & FUSE_CAP_SPLICE_MOVE) != 0) {
+      conn->want |= FUSE_CAP_SPLICE_MOVE;
+    }
+  }
+
+  if ((conn->capable & FUSE_CAP_READDIRPLUS) != 0) {
+    conn->want |= FUSE_CAP_READDIRPLUS;
+  }
+
+#ifdef FUSE_CAP_PASSTHROUGH
+  if (ctx->passthrough && (conn->capable & FUSE_CAP_PASSTHROUGH) != 0) {
+    conn->want |= FUSE_CAP_PASSTHROUGH;
+    ctx->passthrough_active.store(true, std::memory_order_relaxed);
+  }
+#endif
+
+  if (ctx->writeback_cache &&
+      !ctx->passthrough_active.load(std::memory_order_relaxed) &&
+      (conn->capable & FUSE_CAP_WRITEBACK_CACHE) != 0) {
+    conn->want |= FUSE_CAP_WRITEBACK_CACHE;
+  }
+}
 
 void mo2_lookup(fuse_req_t req, fuse_ino_t parent, const char* name)
 {
   Mo2FsContext* ctx = getContext(req);
+  VfsOpTimer timer(ctx ? ctx->metrics : nullptr, VfsOp::Lookup);
   if (ctx == nullptr || name == nullptr) {
     fuse_reply_err(req, EINVAL);
     return;
@@ -215,17 +1136,31 @@ void mo2_lookup(fuse_req_t req, fuse_ino_t parent, const char* name)
     return;
   }
 
-  const std::string childPath = joinPath(parentPath, name);
-  const auto snap             = snapshotForPath(ctx, childPath);
-  if (!snap.found) {
-    fuse_reply_err(req, ENOENT);
-    return;
+  NodeSnapshot snap;
+  fuse_ino_t childIno = 0;
+  bool parentIsDir    = false;
+  {
+    std::shared_lock lock(ctx->tree_mutex);
+    const VfsNode* parentNode = nodeForInode(ctx, parent);
+    if (parentNode != nullptr && parentNode->is_directory) {
+      parentIsDir          = true;
+      const VfsNode* child = ctx->tree->findChild(*parentNode, name);
+      if (child != nullptr) {
+        snap     = snapshotOf(*ctx->tree, child);
+        childIno = ctx->inodes->getOrCreate(
+            joinPath(parentPath, name), child,
+            ctx->tree_generation.load(std::memory_order_acquire));
+      }
+    }
   }
 
-  fuse_ino_t childIno;
-  {
-    std::scoped_lock lock(ctx->inode_mutex);
-    childIno = ctx->inodes->getOrCreate(childPath);
+  if (!snap.found) {
+    if (parentIsDir) {
+      replyMissing(req, ctx, parent, parentPath, name);
+    } else {
+      fuse_reply_err(req, ENOENT);
+    }
+    return;
   }
 
   replyEntryFromSnapshot(req, ctx, childIno, snap);
@@ -234,6 +1169,7 @@ void mo2_lookup(fuse_req_t req, fuse_ino_t parent, const char* name)
 void mo2_getattr(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* /*fi*/)
 {
   Mo2FsContext* ctx = getContext(req);
+  VfsOpTimer timer(ctx ? ctx->metrics : nullptr, VfsOp::Getattr);
   if (ctx == nullptr) {
     fuse_reply_err(req, EINVAL);
     return;
@@ -246,14 +1182,16 @@ void mo2_getattr(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* /*fi*/)
     return;
   }
 
-  bool ok = false;
-  const std::string path = inodeToPath(ctx, ino, &ok);
-  if (!ok) {
-    fuse_reply_err(req, ENOENT);
-    return;
+  // the size of a file being written is only in the tree once it's settled,
+  // the kernel must never be told an older one
+  if (ctx->dirty_handles.load(std::memory_order_relaxed) > 0) {
+    bool ok = false;
+    if (const std::string path = inodeToPath(ctx, ino, &ok); ok) {
+      settleWrites(ctx, path);
+    }
   }
 
-  const auto snap = snapshotForPath(ctx, path);
+  const auto snap = snapshotForInode(ctx, ino);
   if (!snap.found) {
     fuse_reply_err(req, ENOENT);
     return;
@@ -269,73 +1207,69 @@ void mo2_getattr(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* /*fi*/)
   fuse_reply_attr(req, &st, TTL_SECONDS);
 }
 
-void mo2_readdir(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
-                 struct fuse_file_info* /*fi*/)
+void mo2_opendir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi)
 {
   Mo2FsContext* ctx = getContext(req);
-  if (ctx == nullptr || off < 0) {
+  VfsOpTimer timer(ctx ? ctx->metrics : nullptr, VfsOp::Opendir);
+  if (ctx == nullptr || fi == nullptr) {
     fuse_reply_err(req, EINVAL);
     return;
   }
 
-  bool ok = false;
-  const std::string path = inodeToPath(ctx, ino, &ok);
-  if (!ok) {
-    fuse_reply_err(req, ENOENT);
-    return;
-  }
-
-  bool listOk = false;
-  auto children = listChildrenSnapshot(ctx, path, &listOk);
-  if (!listOk) {
-    fuse_reply_err(req, ENOTDIR);
+  int err  = 0;
+  auto dir = snapshotDirectory(ctx, ino, &err);
+  if (dir == nullptr) {
+    fuse_reply_err(req, err);
     return;
   }
 
-  struct Entry
+  const uint64_t fh = ctx->next_fh.fetch_add(1, std::memory_order_relaxed);
   {
-    fuse_ino_t ino;
-    std::string name;
-    bool isDir;
-  };
+    std::scoped_lock lock(ctx->open_dirs_mutex);
+    ctx->open_dirs[fh] = std::move(dir);
+  }
 
-  std::vector<Entry> entries;
-  entries.reserve(children.size() + 2);
-  entries.push_back({ino, ".", true});
-  entries.push_back({1, "..", true});
+  fi->fh = fh;
+  fuse_reply_open(req, fi);
+}
 
-  {
-    std::scoped_lock lock(ctx->inode_mutex);
-    for (const auto& [name, isDir] : children) {
-      const std::string childPath = joinPath(path, name);
-      entries.push_back({ctx->inodes->getOrCreate(childPath), name, isDir});
-    }
-  }
+void mo2_readdir(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
+                 struct fuse_file_info* fi)
+{
+  replyDirectory(req, ino, size, off, fi, false);
+}
 
-  std::vector<char> buf(size);
-  size_t used = 0;
+void mo2_readdirplus(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
+                     struct fuse_file_info* fi)
+{
+  replyDirectory(req, ino, size, off, fi, true);
+}
 
-  for (size_t i = static_cast<size_t>(off); i < entries.size(); ++i) {
-    struct stat st;
-    std::memset(&st, 0, sizeof(st));
-    st.st_ino  = entries[i].ino;
-    st.st_mode = entries[i].isDir ? (S_IFDIR | 0755) : (S_IFREG | 0644);
+void mo2_releasedir(fuse_req_t req, fuse_ino_t /*ino*/, struct fuse_file_info* fi)
+{
+  Mo2FsContext* ctx = getContext(req);
+  if (ctx == nullptr || fi == nullptr) {
+    fuse_reply_err(req, EINVAL);
+    return;
+  }
 
-    const size_t ent = fuse_add_direntry(req, buf.data() + used, size - used,
-                                         entries[i].name.c_str(), &st,
-                                         static_cast<off_t>(i + 1));
-    if (ent > size - used) {
-      break;
+  std::shared_ptr<Mo2FsContext::OpenDir> dir;
+  {
+    std::scoped_lock lock(ctx->open_dirs_mutex);
+    auto it = ctx->open_dirs.find(fi->fh);
+    if (it != ctx->open_dirs.end()) {
+      dir = std::move(it->second);
+      ctx->open_dirs.erase(it);
     }
-    used += ent;
   }
 
-  fuse_reply_buf(req, buf.data(), used);
+  fuse_reply_err(req, 0);
 }
 
 void mo2_open(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi)
 {
   Mo2FsContext* ctx = getContext(req);
+  VfsOpTimer timer(ctx ? ctx->metrics : nullptr, VfsOp::Open);
   if (ctx == nullptr || fi == nullptr) {
     fuse_reply_err(req, EINVAL);
     return;
@@ -348,7 +1282,7 @@ void mo2_open(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi)
     return;
   }
 
-  const auto snap = snapshotForPath(ctx, path);
+  const auto snap = snapshotForInode(ctx, ino);
   if (!snap.found || snap.is_directory) {
     fuse_reply_err(req, ENOENT);
     return;
@@ -358,13 +1292,24 @@ void mo2_open(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi)
   const bool writable  = isWritableOpen(fi->flags);
   bool isBacking       = snap.is_backing;
 
-  if (writable) {
+  // lazily copied handles keep reading the original until the first write;
+  // truncating opens change the contents right away and are copied now, and
+  // so are archived files, there's no original to read through an fd
+  const bool deferCopy = writable && ctx->lazy_copy_up && (fi->flags & O_TRUNC) == 0 &&
+                         !snap.from_archive &&
+                         realPath != ctx->overwrite->stagingPath(path);
+
+  // a writable handle can't share the backing file of passthrough readers and
+  // the kernel refuses to mix it with them, so it's refused before anything
+  // is copied
+  if (writable && inPassthrough(ctx, ino)) {
+    fuse_reply_err(req, EBUSY);
+    return;
+  }
+
+  if (writable && !deferCopy) {
     try {
-      if (isBacking && ctx->backing_dir_fd >= 0) {
-        realPath = ctx->overwrite->copyOnWriteFromFd(ctx->backing_dir_fd, path);
-      } else {
-        realPath = ctx->overwrite->copyOnWrite(realPath, path);
-      }
+      realPath  = copyToStaging(ctx, path, realPath, isBacking, snap.from_archive);
       isBacking = false;
       updateFileNode(ctx, path, realPath, "Staging");
     } catch (...) {
@@ -373,14 +1318,46 @@ void mo2_open(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi)
     }
   }
 
+  auto of             = std::make_shared<Mo2FsContext::OpenFile>();
+  of->real_path       = realPath;
+  of->writable        = writable;
+  of->is_backing      = isBacking;
+  of->relative_path   = path;
+  of->copy_up_pending = deferCopy;
+
+  if (snap.from_archive && !writable) {
+    of->archived = ctx->archive_files.read(realPath, path);
+    if (of->archived == nullptr) {
+      fuse_reply_err(req, EIO);
+      return;
+    }
+  } else {
+    of->fd = openRealFd(ctx, realPath, isBacking, writable && !deferCopy);
+    if (of->fd < 0) {
+      fuse_reply_err(req, errno != 0 ? errno : EIO);
+      return;
+    }
+  }
+
+  // staged files are the ones being written to, they're kept out of
+  // passthrough
+  const bool wantsPassthrough =
+      !writable && of->fd >= 0 && realPath != ctx->overwrite->stagingPath(path);
+  if (!registerOpen(req, ctx, ino, *of, wantsPassthrough, fi)) {
+    fuse_reply_err(req, EBUSY);
+    return;
+  }
+
+  // still worth it with passthrough, the kernel then reads the same file
+  prefetchArchiveIndex(ctx, *of);
+
+  if (!writable && of->fd >= 0) {
+    ctx->access_trace.record(of->real_path, of->is_backing, 0);
+  }
+
   const uint64_t fh = ctx->next_fh.fetch_add(1, std::memory_order_relaxed);
   {
     std::scoped_lock lock(ctx->open_files_mutex);
-    Mo2FsContext::OpenFile of;
-    of.real_path     = realPath;
-    of.writable      = writable;
-    of.is_backing    = isBacking;
-    of.relative_path = path;
     ctx->open_files[fh] = std::move(of);
   }
 
@@ -393,45 +1370,63 @@ void mo2_read(fuse_req_t req, fuse_ino_t /*ino*/, size_t size, off_t off,
               struct fuse_file_info* fi)
 {
   Mo2FsContext* ctx = getContext(req);
+  VfsOpTimer timer(ctx ? ctx->metrics : nullptr, VfsOp::Read);
   if (ctx == nullptr || fi == nullptr || off < 0) {
     fuse_reply_err(req, EINVAL);
     return;
   }
 
-  std::string realPath;
-  bool isBacking = false;
-  {
-    std::scoped_lock lock(ctx->open_files_mutex);
-    auto it = ctx->open_files.find(fi->fh);
-    if (it == ctx->open_files.end()) {
-      fuse_reply_err(req, EBADF);
-      return;
-    }
-    realPath   = it->second.real_path;
-    isBacking  = it->second.is_backing;
+  const auto open = findOpenFile(ctx, fi->fh);
+  if (open == nullptr) {
+    fuse_reply_err(req, EBADF);
+    return;
   }
 
-  int fd = -1;
-  if (isBacking && ctx->backing_dir_fd >= 0) {
-    fd = openat(ctx->backing_dir_fd, realPath.c_str(), O_RDONLY);
-  } else {
-    fd = open(realPath.c_str(), O_RDONLY);
+  if (open->archived != nullptr) {
+    const auto& data  = open->archived->data;
+    const size_t from = std::min(static_cast<size_t>(off), data.size());
+    const size_t n    = std::min(size, data.size() - from);
+
+    ctx->metrics->addReadBytes(n);
+    fuse_reply_buf(req, reinterpret_cast<const char*>(data.data() + from), n);
+    return;
   }
 
-  if (fd < 0) {
-    fuse_reply_err(req, EIO);
+  prefetchAhead(ctx, *open, off, size);
+  ctx->access_trace.record(open->real_path, open->is_backing, off);
+
+  if (ctx->splice_reads) {
+    struct fuse_bufvec buf = FUSE_BUFVEC_INIT(size);
+    buf.buf[0].flags       = static_cast<fuse_buf_flags>(FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK);
+    buf.buf[0].fd          = open->fd;
+    buf.buf[0].pos         = off;
+
+    // fuse_reply_data() doesn't say how much it moved; reads only come up
+    // short at the end of the file, so that's where the count is cut off
+    uint64_t n = size;
+    struct stat st;
+    if (fstat(open->fd, &st) == 0) {
+      const auto end = static_cast<uint64_t>(std::max<off_t>(st.st_size, 0));
+      n = static_cast<uint64_t>(off) >= end
+              ? 0
+              : std::min<uint64_t>(size, end - static_cast<uint64_t>(off));
+    }
+
+    if (fuse_reply_data(req, &buf, FUSE_BUF_SPLICE_MOVE) == 0) {
+      ctx->metrics->addReadBytes(n);
+    }
     return;
   }
 
   std::vector<char> out(size);
-  const ssize_t n = pread(fd, out.data(), size, off);
-  close(fd);
+  const ssize_t n = pread(open->fd, out.data(), size, off);
 
   if (n < 0) {
     fuse_reply_err(req, EIO);
     return;
   }
 
+  ctx->metrics->addReadBytes(static_cast<uint64_t>(n));
   fuse_reply_buf(req, out.data(), static_cast<size_t>(n));
 }
 
@@ -439,48 +1434,51 @@ void mo2_write(fuse_req_t req, fuse_ino_t /*ino*/, const char* buf, size_t size,
                off_t off, struct fuse_file_info* fi)
 {
   Mo2FsContext* ctx = getContext(req);
+  VfsOpTimer timer(ctx ? ctx->metrics : nullptr, VfsOp::Write);
   if (ctx == nullptr || fi == nullptr || off < 0 || (buf == nullptr && size > 0)) {
     fuse_reply_err(req, EINVAL);
     return;
   }
 
-  Mo2FsContext::OpenFile open;
-  {
-    std::scoped_lock lock(ctx->open_files_mutex);
-    auto it = ctx->open_files.find(fi->fh);
-    if (it == ctx->open_files.end()) {
-      fuse_reply_err(req, EBADF);
-      return;
-    }
-    open = it->second;
+  auto open = findOpenFile(ctx, fi->fh);
+  if (open == nullptr) {
+    fuse_reply_err(req, EBADF);
+    return;
   }
 
-  if (!open.writable) {
+  if (!open->writable) {
     fuse_reply_err(req, EACCES);
     return;
   }
 
-  std::fstream io(open.real_path, std::ios::binary | std::ios::in | std::ios::out);
-  if (!io) {
-    io.open(open.real_path, std::ios::binary | std::ios::out);
-    io.close();
-    io.open(open.real_path, std::ios::binary | std::ios::in | std::ios::out);
+  if (open->copy_up_pending) {
+    int err = 0;
+    open    = copyUpHandle(ctx, fi->fh, &err);
+    if (open == nullptr) {
+      fuse_reply_err(req, err);
+      return;
+    }
   }
 
-  if (!io) {
-    fuse_reply_err(req, EIO);
-    return;
+  size_t written = 0;
+  while (written < size) {
+    const ssize_t n = pwrite(open->fd, buf + written, size - written,
+                             off + static_cast<off_t>(written));
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fuse_reply_err(req, errno);
+      return;
+    }
+    written += static_cast<size_t>(n);
   }
 
-  io.seekp(off, std::ios::beg);
-  io.write(buf, static_cast<std::streamsize>(size));
-  io.flush();
-  if (!io) {
-    fuse_reply_err(req, EIO);
-    return;
+  if (!open->dirty.exchange(true)) {
+    ctx->dirty_handles.fetch_add(1, std::memory_order_relaxed);
   }
 
-  updateFileNode(ctx, open.relative_path, open.real_path, "Staging");
+  ctx->metrics->addWriteBytes(size);
   fuse_reply_write(req, size);
 }
 
@@ -488,6 +1486,7 @@ void mo2_create(fuse_req_t req, fuse_ino_t parent, const char* name, mode_t /*mo
                 struct fuse_file_info* fi)
 {
   Mo2FsContext* ctx = getContext(req);
+  VfsOpTimer timer(ctx ? ctx->metrics : nullptr, VfsOp::Create);
   if (ctx == nullptr || fi == nullptr || name == nullptr) {
     fuse_reply_err(req, EINVAL);
     return;
@@ -511,16 +1510,8 @@ void mo2_create(fuse_req_t req, fuse_ino_t parent, const char* name, mode_t /*mo
   }
 
   updateFileNode(ctx, relative, realPath, "Staging");
-  {
-    std::unique_lock lock(ctx->tree_mutex);
-    ++ctx->tree->file_count;
-  }
 
-  fuse_ino_t newIno;
-  {
-    std::scoped_lock lock(ctx->inode_mutex);
-    newIno = ctx->inodes->getOrCreate(relative);
-  }
+  const fuse_ino_t newIno = ctx->inodes->getOrCreate(relative);
 
   const auto snap = snapshotForPath(ctx, relative);
   if (!snap.found || snap.is_directory) {
@@ -528,14 +1519,25 @@ void mo2_create(fuse_req_t req, fuse_ino_t parent, const char* name, mode_t /*mo
     return;
   }
 
+  auto of           = std::make_shared<Mo2FsContext::OpenFile>();
+  of->real_path     = realPath;
+  of->writable      = true;
+  of->is_backing    = false;
+  of->relative_path = relative;
+  of->fd            = openRealFd(ctx, realPath, false, true);
+  if (of->fd < 0) {
+    fuse_reply_err(req, EIO);
+    return;
+  }
+
+  if (!registerOpen(req, ctx, newIno, *of, false, fi)) {
+    fuse_reply_err(req, EBUSY);
+    return;
+  }
+
   const uint64_t fh = ctx->next_fh.fetch_add(1, std::memory_order_relaxed);
   {
     std::scoped_lock lock(ctx->open_files_mutex);
-    Mo2FsContext::OpenFile of;
-    of.real_path     = realPath;
-    of.writable      = true;
-    of.is_backing    = false;
-    of.relative_path = relative;
     ctx->open_files[fh] = std::move(of);
   }
 
@@ -556,6 +1558,7 @@ void mo2_rename(fuse_req_t req, fuse_ino_t parent, const char* name,
                 fuse_ino_t newparent, const char* newname, unsigned int flags)
 {
   Mo2FsContext* ctx = getContext(req);
+  VfsOpTimer timer(ctx ? ctx->metrics : nullptr, VfsOp::Rename);
   if (ctx == nullptr || name == nullptr || newname == nullptr || flags != 0) {
     fuse_reply_err(req, EINVAL);
     return;
@@ -579,30 +1582,39 @@ void mo2_rename(fuse_req_t req, fuse_ino_t parent, const char* name,
     return;
   }
 
+  // the new node gets the current size, writes settled later can't find it
+  settleWrites(ctx, oldRelative);
+
   if (!ctx->overwrite->rename(oldRelative, newRelative)) {
     fuse_reply_err(req, EACCES);
     return;
   }
 
+  // everything but the splice is done before taking the unique lock
+  const auto oldComponents = splitPath(oldRelative);
+  const auto newComponents = splitPath(newRelative);
+
+  std::string real;
+  if (!oldSnap.is_directory) {
+    const std::string staged = ctx->overwrite->stagingPath(newRelative);
+    real = fs::exists(staged) ? staged : ctx->overwrite->overwritePath(newRelative);
+  }
+
   {
     std::unique_lock lock(ctx->tree_mutex);
-    ctx->tree->root.removeFromTree(splitPath(oldRelative));
+    ctx->tree->removeFromTree(oldComponents);
+    invalidateNodeCache(ctx);
 
     if (oldSnap.is_directory) {
-      ctx->tree->root.insertDirectory(splitPath(newRelative));
+      ctx->tree->insertDirectory(newComponents);
     } else {
-      const std::string staged = ctx->overwrite->stagingPath(newRelative);
-      const std::string over   = ctx->overwrite->overwritePath(newRelative);
-      const std::string real   = fs::exists(staged) ? staged : over;
-      ctx->tree->root.insertFile(splitPath(newRelative), real, oldSnap.size,
-                                 std::chrono::system_clock::now(), "Staging");
+      ctx->tree->insertFile(newComponents, real, oldSnap.size,
+                            std::chrono::system_clock::now(), "Staging");
     }
   }
 
-  {
-    std::scoped_lock lock(ctx->inode_mutex);
-    ctx->inodes->rename(oldRelative, newRelative);
-  }
+  ctx->inodes->rename(oldRelative, newRelative);
+  rebindRenamed(ctx, oldRelative, newRelative);
 
   fuse_reply_err(req, 0);
 }
@@ -611,6 +1623,7 @@ void mo2_setattr(fuse_req_t req, fuse_ino_t ino, struct stat* attr, int to_set,
                  struct fuse_file_info* fi)
 {
   Mo2FsContext* ctx = getContext(req);
+  VfsOpTimer timer(ctx ? ctx->metrics : nullptr, VfsOp::Setattr);
   if (ctx == nullptr) {
     fuse_reply_err(req, EINVAL);
     return;
@@ -633,49 +1646,66 @@ void mo2_setattr(fuse_req_t req, fuse_ino_t ino, struct stat* attr, int to_set,
   if ((to_set & FUSE_SET_ATTR_SIZE) != 0 && attr != nullptr) {
     std::string target;
     bool targetIsBacking = false;
+    bool targetIsArchived = false;
     uint64_t fh = 0;
 
     if (fi != nullptr) {
       fh = fi->fh;
-      std::scoped_lock lock(ctx->open_files_mutex);
-      auto it = ctx->open_files.find(fh);
-      if (it != ctx->open_files.end()) {
-        target          = it->second.real_path;
-        targetIsBacking = it->second.is_backing;
+      auto open = findOpenFile(ctx, fh);
+      if (open != nullptr && open->copy_up_pending) {
+        int err = 0;
+        open    = copyUpHandle(ctx, fh, &err);
+        if (open == nullptr) {
+          fuse_reply_err(req, err);
+          return;
+        }
+      }
+      if (open != nullptr) {
+        target           = open->real_path;
+        targetIsBacking  = open->is_backing;
+        targetIsArchived = open->archived != nullptr;
       }
     }
 
     if (target.empty()) {
-      const auto snap = snapshotForPath(ctx, path);
+      const auto snap = snapshotForInode(ctx, ino);
       if (!snap.found || snap.is_directory) {
         fuse_reply_err(req, ENOENT);
         return;
       }
-      target          = snap.real_path;
-      targetIsBacking = snap.is_backing;
+      target           = snap.real_path;
+      targetIsBacking  = snap.is_backing;
+      targetIsArchived = snap.from_archive;
     }
 
     const std::string stagedPath = ctx->overwrite->stagingPath(path);
     if (fs::path(target).lexically_normal().string() !=
         fs::path(stagedPath).lexically_normal().string()) {
       try {
-        if (targetIsBacking && ctx->backing_dir_fd >= 0) {
-          target = ctx->overwrite->copyOnWriteFromFd(ctx->backing_dir_fd, path);
-        } else {
-          target = ctx->overwrite->copyOnWrite(target, path);
-        }
+        target = copyToStaging(ctx, path, target, targetIsBacking, targetIsArchived);
       } catch (...) {
         fuse_reply_err(req, EIO);
         return;
       }
 
-      if (fi != nullptr) {
-        std::scoped_lock lock(ctx->open_files_mutex);
-        auto it = ctx->open_files.find(fh);
-        if (it != ctx->open_files.end()) {
-          it->second.real_path = target;
-          it->second.writable  = true;
+      // the handle now refers to the staged copy; rebind it to a fresh fd
+      // and let in-flight reads finish on the old one
+      if (const auto open = fi != nullptr ? findOpenFile(ctx, fh) : nullptr) {
+        auto rebound           = std::make_shared<Mo2FsContext::OpenFile>();
+        rebound->real_path     = target;
+        rebound->writable      = true;
+        rebound->is_backing    = false;
+        rebound->relative_path = open->relative_path;
+        rebound->ino           = open->ino;
+        rebound->passthrough   = open->passthrough;
+        rebound->fd            = openRealFd(ctx, target, false, true);
+        if (rebound->fd < 0) {
+          fuse_reply_err(req, EIO);
+          return;
         }
+
+        std::scoped_lock lock(ctx->open_files_mutex);
+        ctx->open_files[fh] = std::move(rebound);
       }
     }
 
@@ -689,7 +1719,12 @@ void mo2_setattr(fuse_req_t req, fuse_ino_t ino, struct stat* attr, int to_set,
     updateFileNode(ctx, path, target, "Staging");
   }
 
-  const auto snap = snapshotForPath(ctx, path);
+  if ((to_set & (FUSE_SET_ATTR_MTIME | FUSE_SET_ATTR_MTIME_NOW)) != 0 &&
+      attr != nullptr) {
+    applyMtime(ctx, path, *attr, to_set);
+  }
+
+  const auto snap = snapshotForInode(ctx, ino);
   if (!snap.found) {
     fuse_reply_err(req, ENOENT);
     return;
@@ -707,6 +1742,7 @@ void mo2_setattr(fuse_req_t req, fuse_ino_t ino, struct stat* attr, int to_set,
 void mo2_unlink(fuse_req_t req, fuse_ino_t parent, const char* name)
 {
   Mo2FsContext* ctx = getContext(req);
+  VfsOpTimer timer(ctx ? ctx->metrics : nullptr, VfsOp::Unlink);
   if (ctx == nullptr || name == nullptr) {
     fuse_reply_err(req, EINVAL);
     return;
@@ -725,10 +1761,12 @@ void mo2_unlink(fuse_req_t req, fuse_ino_t parent, const char* name)
     return;
   }
 
+  const auto components = splitPath(relative);
   {
     std::unique_lock lock(ctx->tree_mutex);
-    if (ctx->tree->root.removeFromTree(splitPath(relative))) {
+    if (ctx->tree->removeFromTree(components)) {
       ctx->tree->file_count = ctx->tree->file_count > 0 ? ctx->tree->file_count - 1 : 0;
+      invalidateNodeCache(ctx);
     }
   }
 
@@ -738,6 +1776,7 @@ void mo2_unlink(fuse_req_t req, fuse_ino_t parent, const char* name)
 void mo2_mkdir(fuse_req_t req, fuse_ino_t parent, const char* name, mode_t /*mode*/)
 {
   Mo2FsContext* ctx = getContext(req);
+  VfsOpTimer timer(ctx ? ctx->metrics : nullptr, VfsOp::Mkdir);
   if (ctx == nullptr || name == nullptr) {
     fuse_reply_err(req, EINVAL);
     return;
@@ -756,17 +1795,15 @@ void mo2_mkdir(fuse_req_t req, fuse_ino_t parent, const char* name, mode_t /*mod
     return;
   }
 
+  const auto components = splitPath(relative);
   {
     std::unique_lock lock(ctx->tree_mutex);
-    ctx->tree->root.insertDirectory(splitPath(relative));
+    ctx->tree->insertDirectory(components);
     ++ctx->tree->dir_count;
+    invalidateNodeCache(ctx);
   }
 
-  fuse_ino_t dirIno;
-  {
-    std::scoped_lock lock(ctx->inode_mutex);
-    dirIno = ctx->inodes->getOrCreate(relative);
-  }
+  const fuse_ino_t dirIno = ctx->inodes->getOrCreate(relative);
 
   const auto snap = snapshotForPath(ctx, relative);
   if (!snap.found) {
@@ -777,18 +1814,99 @@ void mo2_mkdir(fuse_req_t req, fuse_ino_t parent, const char* name, mode_t /*mod
   replyEntryFromSnapshot(req, ctx, dirIno, snap);
 }
 
+void mo2_flush(fuse_req_t req, fuse_ino_t /*ino*/, struct fuse_file_info* fi)
+{
+  Mo2FsContext* ctx = getContext(req);
+  if (ctx == nullptr || fi == nullptr) {
+    fuse_reply_err(req, EINVAL);
+    return;
+  }
+
+  // called on every close() of the file, the handle may live on in a dup
+  if (const auto open = findOpenFile(ctx, fi->fh)) {
+    settleWrites(ctx, *open);
+  }
+
+  fuse_reply_err(req, 0);
+}
+
+void mo2_fsync(fuse_req_t req, fuse_ino_t /*ino*/, int datasync,
+               struct fuse_file_info* fi)
+{
+  Mo2FsContext* ctx = getContext(req);
+  if (ctx == nullptr || fi == nullptr) {
+    fuse_reply_err(req, EINVAL);
+    return;
+  }
+
+  const auto open = findOpenFile(ctx, fi->fh);
+  if (open == nullptr) {
+    fuse_reply_err(req, EBADF);
+    return;
+  }
+
+  // the kernel has written its cached pages back before sending this
+  settleWrites(ctx, *open);
+
+  if (open->fd < 0) {
+    // served from an archive, there's nothing to sync
+    fuse_reply_err(req, 0);
+    return;
+  }
+
+  const int ret = datasync != 0 ? fdatasync(open->fd) : fsync(open->fd);
+  fuse_reply_err(req, ret == 0 ? 0 : errno);
+}
+
 void mo2_release(fuse_req_t req, fuse_ino_t /*ino*/, struct fuse_file_info* fi)
 {
   Mo2FsContext* ctx = getContext(req);
+  VfsOpTimer timer(ctx ? ctx->metrics : nullptr, VfsOp::Release);
   if (ctx == nullptr || fi == nullptr) {
     fuse_reply_err(req, EINVAL);
     return;
   }
 
+  std::shared_ptr<Mo2FsContext::OpenFile> open;
   {
     std::scoped_lock lock(ctx->open_files_mutex);
-    ctx->open_files.erase(fi->fh);
+    auto it = ctx->open_files.find(fi->fh);
+    if (it != ctx->open_files.end()) {
+      open = std::move(it->second);
+      ctx->open_files.erase(it);
+    }
+  }
+
+  if (open != nullptr) {
+    settleWrites(ctx, *open);
+  }
+
+  if (open != nullptr) {
+    unregisterOpen(req, ctx, *open);
   }
 
   fuse_reply_err(req, 0);
 }
+
+int runFuseLoop(struct fuse_session* session, const FuseLoopOptions& options)
+{
+  unsigned maxThreads = options.max_threads;
+  if (maxThreads == 0) {
+    maxThreads = std::max(10u, 2 * std::thread::hardware_concurrency());
+  }
+
+  struct fuse_loop_config* config = fuse_loop_cfg_create();
+  if (config == nullptr) {
+    return fuse_session_loop_mt(session, nullptr);
+  }
+
+  fuse_loop_cfg_set_max_threads(config, maxThreads);
+  if (options.max_idle_threads != 0) {
+    fuse_loop_cfg_set_idle_threads(config, std::min(options.max_idle_threads, maxThreads));
+  }
+  fuse_loop_cfg_set_clone_fd(config, options.clone_fd ? 1 : 0);
+
+  const int ret = fuse_session_loop_mt(session, config);
+  fuse_loop_cfg_destroy(config);
+  return ret;
+}
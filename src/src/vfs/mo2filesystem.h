@@ -3,49 +3,240 @@
 
 #include <fuse3/fuse_lowlevel.h>
 
+#include "accesstrace.h"
+#include "archivefiles.h"
 #include "inodetable.h"
 #include "overwritemanager.h"
+#include "vfsmetrics.h"
 #include "vfstree.h"
 
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 struct Mo2FsContext
 {
   std::shared_ptr<VfsTree> tree;
   mutable std::shared_mutex tree_mutex;
 
+  // Bumped under the unique tree lock whenever nodes may have been freed or
+  // replaced.  Node pointers cached in the inode table are only trusted for
+  // the generation they were recorded in.
+  std::atomic<uint64_t> tree_generation{1};
+
+  // internally synchronized, see InodeTable
   std::unique_ptr<InodeTable> inodes;
-  mutable std::mutex inode_mutex;
 
   std::unique_ptr<OverwriteManager> overwrite;
 
   int backing_dir_fd = -1;
 
+  // One entry per FUSE file handle.  The backing fd is opened once in
+  // open/create and closed when the last reference goes away, so reads are a
+  // single pread() instead of open+pread+close per request.  Handles are
+  // shared so that a read in flight keeps its fd alive even if the handle is
+  // rebound (copy-up on truncate) or released concurrently.
   struct OpenFile
   {
     std::string real_path;
     bool writable    = false;
     bool is_backing  = false;
     std::string relative_path;
+    int fd           = -1;
+
+    // inode the handle was opened for, and whether the kernel reads it through
+    // passthrough, see inode_opens
+    fuse_ino_t ino   = 0;
+    bool passthrough = false;
+
+    // writable handle still reading the original file, see lazy_copy_up
+    bool copy_up_pending = false;
+
+    // read-only handle of a file in an archive, served from memory; there's
+    // no fd and `real_path` is the archive
+    std::shared_ptr<const ArchiveFiles::Content> archived;
+
+    // written to since the tree last got the size and mtime of the file;
+    // writes go straight to the fd and the node is updated once on flush or
+    // release, see settleWrites()
+    std::atomic<bool> dirty{false};
+
+    // sequential read detection, see prefetch; updated without a lock since
+    // concurrent reads on one handle only make the hints less accurate
+    std::atomic<int64_t> next_offset{0};
+    std::atomic<int64_t> prefetched_to{0};
+    std::atomic<uint32_t> prefetch_window{0};
+
+    OpenFile() = default;
+    OpenFile(const OpenFile&)            = delete;
+    OpenFile& operator=(const OpenFile&) = delete;
+    ~OpenFile();
   };
 
-  std::unordered_map<uint64_t, OpenFile> open_files;
+  std::unordered_map<uint64_t, std::shared_ptr<OpenFile>> open_files;
   mutable std::mutex open_files_mutex;
+
+  // number of dirty handles; getattr only looks for one when this isn't 0
+  std::atomic<int> dirty_handles{0};
+
+  // Defer the copy into staging of files opened for writing until the first
+  // write or truncate; many games open their configs read-write and never
+  // write to them.  Until then the handle reads the original file.
+  // copy_up_mutex serializes every copy into staging, so a file is copied only
+  // once and nobody opens a staged copy that is still being written; deferred
+  // copy-ups hold it across the copy and the rebind of their handle.
+  bool lazy_copy_up = true;
+  std::recursive_mutex copy_up_mutex;
+
+  // Read-ahead hints on the backing fds: archives (BSA/BA2) get the head of
+  // the file, where their index lives, prefetched on open, and a handle that
+  // keeps reading where the last read ended has the range ahead of it
+  // prefetched in a window that doubles up to PrefetchMaxWindow.
+  bool prefetch = true;
+  static constexpr uint32_t PrefetchMinWindow    = 256 * 1024;
+  static constexpr uint32_t PrefetchMaxWindow    = 8 * 1024 * 1024;
+  static constexpr uint32_t ArchiveIndexPrefetch = 4 * 1024 * 1024;
+
+  // chunks read by the launch being traced, replayed ahead of the next launch
+  // of the profile; idle unless the connector starts it.  With passthrough
+  // reads don't reach the daemon and only opens are traced.
+  VfsAccessTrace access_trace;
+
+  // Directory listings are snapshotted once per opendir handle; readdir and
+  // readdirplus page through the snapshot instead of re-listing the node.
+  struct DirEntry
+  {
+    fuse_ino_t ino = 0;
+    std::string name;
+    bool is_directory = false;
+    uint64_t size     = 0;
+    std::chrono::system_clock::time_point mtime{};
+  };
+
+  struct OpenDir
+  {
+    std::vector<DirEntry> entries;
+  };
+
+  std::unordered_map<uint64_t, std::shared_ptr<OpenDir>> open_dirs;
+  mutable std::mutex open_dirs_mutex;
   std::atomic<uint64_t> next_fh{1};
 
   uid_t uid = 0;
   gid_t gid = 0;
+
+  // Lookup misses are answered with a negative entry the kernel caches for
+  // `negative_timeout` seconds (0 disables), so repeated probes for files
+  // that don't exist never reach the daemon.  Handed out entries are tracked
+  // by exact path, so a rebuild that makes one exist can invalidate it; when
+  // the table is full misses fall back to a plain ENOENT.
+  double negative_timeout = 30.0;
+  std::unordered_map<std::string,
+                     std::pair<fuse_ino_t, std::chrono::steady_clock::time_point>>
+      negative_entries;
+  std::mutex negative_mutex;
+
+  // counters and latencies of every operation, dumped on request by the
+  // diagnostics tab; the helper points this at the status it shares with the
+  // GUI
+  VfsMetrics own_metrics;
+  VfsMetrics* metrics = &own_metrics;
+
+  // Session to send cache invalidations to once a rebuild changed entries
+  // the kernel knows about, null until the session exists.
+  struct fuse_session* session = nullptr;
+
+  // Reply to reads with an fd-backed fuse_bufvec so libfuse can splice pages
+  // from the page cache into /dev/fuse instead of copying through userspace.
+  // libfuse falls back to a plain read when splicing isn't possible.
+  bool splice_reads = true;
+
+  // Opt-in kernel passthrough (Linux 6.9+): read-only opens register their fd
+  // with the kernel, which then serves reads without calling into the
+  // daemon.  `passthrough_active` is set in init when the kernel accepts the
+  // capability and cleared if registering a backing fd is refused for lack of
+  // privileges (it needs CAP_SYS_ADMIN on current kernels), so later opens
+  // skip the attempt.
+  bool passthrough = false;
+  std::atomic<bool> passthrough_active{false};
+
+  // The kernel refuses to mix passthrough and other opens of one inode, and
+  // the passthrough opens of an inode must share one backing file.  So an
+  // inode is either in passthrough, with every handle on its backing id, or
+  // not at all; it only enters passthrough while nothing else has it open,
+  // and leaves once its last passthrough handle is released.
+  struct InodeOpens
+  {
+    int passthrough = 0;
+    int other       = 0;
+    int backing_id  = 0;
+    std::string real_path;
+  };
+
+  std::unordered_map<fuse_ino_t, InodeOpens> inode_opens;
+  std::mutex inode_opens_mutex;
+
+  // Opt-in writeback cache: the kernel buffers writes in the page cache and
+  // sends them in large batches, and it keeps the size and mtime of files
+  // being written itself, pushing them with setattr.  Not requested together
+  // with passthrough, which takes precedence.
+  bool writeback_cache = false;
+
+  // Opt-in: the files in the BSA/BA2 archives of mods show up as loose files
+  // at the mod's priority, decompressed on demand when they're read, so mods
+  // don't have to be extracted to win over others.  Opening one for writing
+  // extracts it into staging.
+  bool serve_archives = false;
+  ArchiveFiles archive_files;
+
+  // swaps in a freshly built tree and invalidates cached inode resolutions
+  //
+  void replaceTree(std::shared_ptr<VfsTree> newTree);
+
+  // layer stack and injected files the current tree was built from, only
+  // touched by the thread that mounts and rebuilds
+  VfsLayerList layers;
+  std::vector<std::pair<std::string, std::string>> extra_files;
+
+  // Moves the tree to `newLayers` with `extraFiles` injected on top.  When
+  // only a few layers were added, removed or reordered the live tree is
+  // patched in place; otherwise a new tree is built outside the lock and
+  // swapped in.  Returns true if the tree was patched.
+  //
+  bool updateLayers(VfsLayerList newLayers,
+                    std::vector<std::pair<std::string, std::string>> extraFiles,
+                    bool allowIncremental = true);
 };
 
+// Worker pool of the multi-threaded session loop.  With clone_fd every worker
+// reads requests from its own /dev/fuse fd instead of contending on the
+// session's, libfuse falls back to the shared fd if cloning fails.
+//
+struct FuseLoopOptions
+{
+  unsigned max_threads      = 0;  // 0: twice the core count, at least 10
+  unsigned max_idle_threads = 0;  // 0: libfuse's default
+  bool clone_fd             = true;
+};
+
+// runs the session loop on a worker pool until the session exits
+//
+int runFuseLoop(struct fuse_session* session, const FuseLoopOptions& options);
+
+void mo2_init(void* userdata, struct fuse_conn_info* conn);
 void mo2_lookup(fuse_req_t req, fuse_ino_t parent, const char* name);
 void mo2_getattr(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi);
 void mo2_readdir(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
                  struct fuse_file_info* fi);
+void mo2_opendir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi);
+void mo2_readdirplus(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
+                     struct fuse_file_info* fi);
+void mo2_releasedir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi);
 void mo2_open(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi);
 void mo2_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
               struct fuse_file_info* fi);
@@ -59,6 +250,8 @@ void mo2_setattr(fuse_req_t req, fuse_ino_t ino, struct stat* attr, int to_set,
                  struct fuse_file_info* fi);
 void mo2_unlink(fuse_req_t req, fuse_ino_t parent, const char* name);
 void mo2_mkdir(fuse_req_t req, fuse_ino_t parent, const char* name, mode_t mode);
+void mo2_flush(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi);
+void mo2_fsync(fuse_req_t req, fuse_ino_t ino, int datasync, struct fuse_file_info* fi);
 void mo2_release(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi);
 
 #endif
@@ -1,10 +1,14 @@
 #include "overwritemanager.h"
+#include "fileclone.h"
 
 #include <fcntl.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#include <cerrno>
 #include <filesystem>
 #include <fstream>
+#include <iterator>
 
 namespace
 {
@@ -23,15 +27,196 @@ std::string sanitizeRelative(const std::string& relative)
   }
   return out;
 }
+
+// Creates `name` in `dir_fd` as a copy of the open file `src`, keeping its
+// permissions.  A partially written copy is removed again.  Returns 0 or an
+// errno.
+int copyFileAt(int src, int dir_fd, const char* name)
+{
+  struct stat st;
+  const mode_t mode = fstat(src, &st) == 0 ? (st.st_mode & 07777) : 0644;
+
+  const int dst = openat(dir_fd, name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+  if (dst < 0) {
+    return errno;
+  }
+
+  int err = cloneFileContents(src, dst);
+  if (close(dst) != 0 && err == 0) {
+    err = errno;
+  }
+  if (err != 0) {
+    unlinkat(dir_fd, name, 0);
+  }
+  return err;
+}
+
+// the journal lives next to the staging directory so it never ends up in
+// overwrite itself
+std::string journalPathFor(const std::string& staging_dir)
+{
+  fs::path staging = fs::path(staging_dir).lexically_normal();
+  if (!staging.has_filename()) {
+    staging = staging.parent_path();
+  }
+  return staging.string() + ".journal";
+}
+
+// Moves the staged files `names` from `src_dir` to `dst_dir`.  Returns false
+// if anything other than a file that is gone already couldn't be moved.
+bool moveFiles(int src_dir, int dst_dir, const std::vector<std::string>& names)
+{
+  bool complete = true;
+
+  for (const auto& name : names) {
+    if (renameat(src_dir, name.c_str(), dst_dir, name.c_str()) == 0 ||
+        errno == ENOENT) {
+      // ENOENT: removed or renamed away after it was staged
+      continue;
+    }
+
+    if (errno != EXDEV) {
+      complete = false;
+      continue;
+    }
+
+    const int src = openat(src_dir, name.c_str(), O_RDONLY | O_CLOEXEC);
+    if (src < 0) {
+      complete = false;
+      continue;
+    }
+
+    const int err = copyFileAt(src, dst_dir, name.c_str());
+    close(src);
+    if (err == 0) {
+      unlinkat(src_dir, name.c_str(), 0);
+    } else {
+      complete = false;
+    }
+  }
+
+  return complete;
+}
+
 }  // namespace
 
 OverwriteManager::OverwriteManager(const std::string& staging_dir,
                                    const std::string& overwrite_dir)
-    : m_stagingDir(staging_dir), m_overwriteDir(overwrite_dir)
+    : m_stagingDir(staging_dir), m_overwriteDir(overwrite_dir),
+      m_journalPath(journalPathFor(staging_dir))
 {
   std::error_code ec;
   fs::create_directories(m_stagingDir, ec);
   fs::create_directories(m_overwriteDir, ec);
+
+  loadJournal();
+}
+
+OverwriteManager::~OverwriteManager()
+{
+  if (m_journalFd >= 0) {
+    close(m_journalFd);
+  }
+}
+
+void OverwriteManager::loadJournal()
+{
+  std::ifstream in(m_journalPath, std::ios::binary);
+  if (!in) {
+    // anything staged without a journal was left by a build that didn't keep
+    // one
+    std::error_code ec;
+    m_needsScan = fs::directory_iterator(m_stagingDir, ec) != fs::directory_iterator();
+    return;
+  }
+
+  const std::string contents{std::istreambuf_iterator<char>(in),
+                             std::istreambuf_iterator<char>()};
+
+  // a torn last line means the session died mid-append
+  if (!contents.empty() && contents.back() != '\n') {
+    m_needsScan = true;
+  }
+
+  size_t begin = 0;
+  while (begin < contents.size()) {
+    size_t end = contents.find('\n', begin);
+    if (end == std::string::npos) {
+      end = contents.size();
+    }
+
+    const std::string_view line(contents.data() + begin, end - begin);
+    begin = end + 1;
+
+    if (line.size() > 2 && line[1] == '\t' &&
+        (line[0] == static_cast<char>(Staged::File) ||
+         line[0] == static_cast<char>(Staged::Directory))) {
+      m_staged.insert_or_assign(std::string(line.substr(2)), Staged{line[0]});
+    } else {
+      m_needsScan = true;
+    }
+  }
+}
+
+void OverwriteManager::appendJournal(const std::string& line)
+{
+  if (m_journalFd == -1) {
+    m_journalFd =
+        open(m_journalPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  }
+
+  // a single O_APPEND write per entry, so entries never interleave and survive
+  // the process dying; not fsync'd, staging itself isn't either
+  if (m_journalFd >= 0 &&
+      write(m_journalFd, line.data(), line.size()) == static_cast<ssize_t>(line.size())) {
+    return;
+  }
+
+  // without a complete journal the next session has to walk staging, make
+  // sure it doesn't trust a partial one
+  if (m_journalFd >= 0) {
+    close(m_journalFd);
+  }
+  unlink(m_journalPath.c_str());
+  m_journalFd = -2;
+  m_needsScan = true;
+}
+
+void OverwriteManager::record(Staged kind, const std::string& relative)
+{
+  const std::string rel = sanitizeRelative(relative);
+  if (rel.empty()) {
+    return;
+  }
+  if (rel.find('\n') != std::string::npos) {
+    recordRescan();
+    return;
+  }
+
+  std::scoped_lock lock(m_journalMutex);
+
+  auto it = m_staged.find(rel);
+  if (it != m_staged.end() && it->second == kind) {
+    return;
+  }
+  m_staged.insert_or_assign(it, rel, kind);
+
+  if (m_journalFd != -2) {
+    appendJournal(std::string{static_cast<char>(kind), '\t'} + rel + '\n');
+  }
+}
+
+void OverwriteManager::recordRescan()
+{
+  std::scoped_lock lock(m_journalMutex);
+  if (m_needsScan) {
+    return;
+  }
+
+  m_needsScan = true;
+  if (m_journalFd != -2) {
+    appendJournal("S\n");
+  }
 }
 
 std::string OverwriteManager::stagingPath(const std::string& relative_path) const
@@ -48,6 +233,7 @@ std::string OverwriteManager::copyOnWrite(const std::string& source_path,
                                           const std::string& relative_path)
 {
   const fs::path dest = stagingPath(relative_path);
+  record(Staged::File, relative_path);
 
   std::error_code ec;
   fs::create_directories(dest.parent_path(), ec);
@@ -56,10 +242,14 @@ std::string OverwriteManager::copyOnWrite(const std::string& source_path,
     return dest.string();
   }
 
-  if (!source_path.empty() && fs::exists(source_path, ec)) {
-    fs::copy_file(source_path, dest, fs::copy_options::overwrite_existing, ec);
-    if (ec) {
-      throw fs::filesystem_error("copyOnWrite", fs::path(source_path), dest, ec);
+  const int src_fd =
+      source_path.empty() ? -1 : open(source_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (src_fd >= 0) {
+    const int err = copyFileAt(src_fd, AT_FDCWD, dest.c_str());
+    close(src_fd);
+    if (err != 0) {
+      throw fs::filesystem_error("copyOnWrite", fs::path(source_path), dest,
+                                 std::error_code(err, std::generic_category()));
     }
   } else {
     std::ofstream out(dest, std::ios::binary);
@@ -73,6 +263,7 @@ std::string OverwriteManager::copyOnWriteFromFd(int dir_fd,
                                                 const std::string& relative_path)
 {
   const fs::path dest = stagingPath(relative_path);
+  record(Staged::File, relative_path);
 
   std::error_code ec;
   fs::create_directories(dest.parent_path(), ec);
@@ -82,7 +273,7 @@ std::string OverwriteManager::copyOnWriteFromFd(int dir_fd,
   }
 
   const std::string rel = sanitizeRelative(relative_path);
-  const int src_fd      = openat(dir_fd, rel.c_str(), O_RDONLY);
+  const int src_fd      = openat(dir_fd, rel.c_str(), O_RDONLY | O_CLOEXEC);
   if (src_fd < 0) {
     // Source doesn't exist in backing dir, create empty file
     std::ofstream out(dest, std::ios::binary);
@@ -90,20 +281,13 @@ std::string OverwriteManager::copyOnWriteFromFd(int dir_fd,
     return dest.string();
   }
 
-  std::ofstream out(dest, std::ios::binary);
-  if (!out) {
-    close(src_fd);
+  const int err = copyFileAt(src_fd, AT_FDCWD, dest.c_str());
+  close(src_fd);
+  if (err != 0) {
     throw fs::filesystem_error("copyOnWriteFromFd", dest,
-                               std::error_code(errno, std::generic_category()));
+                               std::error_code(err, std::generic_category()));
   }
 
-  char buf[65536];
-  ssize_t n;
-  while ((n = read(src_fd, buf, sizeof(buf))) > 0) {
-    out.write(buf, n);
-  }
-
-  close(src_fd);
   return dest.string();
 }
 
@@ -111,6 +295,8 @@ std::string OverwriteManager::writeFile(const std::string& relative_path,
                                         const std::vector<uint8_t>& data)
 {
   const fs::path path = stagingPath(relative_path);
+  record(Staged::File, relative_path);
+
   std::error_code ec;
   fs::create_directories(path.parent_path(), ec);
 
@@ -140,6 +326,11 @@ bool OverwriteManager::rename(const std::string& old_relative,
     if (!fs::exists(from, ec)) {
       return false;
     }
+  } else if (fs::is_directory(from, ec)) {
+    // the journal only knows the old paths of everything below
+    recordRescan();
+  } else {
+    record(Staged::File, new_relative);
   }
 
   fs::create_directories(to.parent_path(), ec);
@@ -165,6 +356,8 @@ bool OverwriteManager::removeFile(const std::string& relative_path)
 
 bool OverwriteManager::createDirectory(const std::string& relative_path)
 {
+  record(Staged::Directory, relative_path);
+
   std::error_code ec;
   fs::create_directories(stagingPath(relative_path), ec);
   return !ec;
@@ -176,3 +369,111 @@ bool OverwriteManager::exists(const std::string& relative_path) const
   return fs::exists(stagingPath(relative_path), ec) ||
          fs::exists(overwritePath(relative_path), ec);
 }
+
+void OverwriteManager::scanStaging()
+{
+  const fs::path staging(m_stagingDir);
+  m_staged.clear();
+
+  std::error_code ec;
+  for (auto it = fs::recursive_directory_iterator(
+           staging, fs::directory_options::skip_permission_denied, ec);
+       !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+    const auto& entry      = *it;
+    const std::string rel = entry.path().lexically_relative(staging).generic_string();
+    if (rel.empty()) {
+      continue;
+    }
+
+    std::error_code typeEc;
+    if (entry.is_directory(typeEc)) {
+      m_staged.insert_or_assign(rel, Staged::Directory);
+    } else if (entry.is_regular_file(typeEc)) {
+      m_staged.insert_or_assign(rel, Staged::File);
+    }
+  }
+}
+
+bool OverwriteManager::replay()
+{
+  const fs::path overwrite(m_overwriteDir);
+  std::error_code ec;
+
+  // group by parent so every directory is opened and created once; map order
+  // puts parents before their children
+  std::map<std::string, std::vector<std::string>> byDir;
+  for (const auto& [rel, kind] : m_staged) {
+    if (kind == Staged::Directory) {
+      fs::create_directories(overwrite / rel, ec);
+      continue;
+    }
+
+    const size_t slash = rel.rfind('/');
+    if (slash == std::string::npos) {
+      byDir[std::string()].push_back(rel);
+    } else {
+      byDir[rel.substr(0, slash)].push_back(rel.substr(slash + 1));
+    }
+  }
+
+  const int stagingFd = open(m_stagingDir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (stagingFd < 0) {
+    return false;
+  }
+
+  bool complete = true;
+  for (const auto& [dir, names] : byDir) {
+    const char* dirName = dir.empty() ? "." : dir.c_str();
+
+    const int src = openat(stagingFd, dirName, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (src < 0) {
+      // the whole directory went away after its files were staged
+      complete = complete && errno == ENOENT;
+      continue;
+    }
+
+    fs::create_directories(overwrite / dir, ec);
+    const int dst = open((overwrite / dir).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dst < 0) {
+      close(src);
+      complete = false;
+      continue;
+    }
+
+    complete = moveFiles(src, dst, names) && complete;
+    close(dst);
+    close(src);
+  }
+
+  close(stagingFd);
+  return complete;
+}
+
+void OverwriteManager::flush()
+{
+  std::scoped_lock lock(m_journalMutex);
+
+  if (m_journalFd >= 0) {
+    close(m_journalFd);
+  }
+  m_journalFd = -1;
+
+  std::error_code ec;
+  if (fs::exists(m_stagingDir, ec)) {
+    if (m_needsScan) {
+      scanStaging();
+    }
+
+    // whatever the journal couldn't account for gets the full walk
+    if (!replay() && !m_needsScan) {
+      scanStaging();
+      replay();
+    }
+
+    fs::remove_all(m_stagingDir, ec);
+  }
+
+  fs::remove(m_journalPath, ec);
+  m_staged.clear();
+  m_needsScan = false;
+}
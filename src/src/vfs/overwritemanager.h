@@ -2,13 +2,25 @@
 #define VFS_OVERWRITEMANAGER_H
 
 #include <cstdint>
+#include <map>
+#include <mutex>
 #include <string>
 #include <vector>
 
+// Stages writes to the overwrite directory.  Every path created in staging is
+// appended to a journal next to the staging directory, so flush() only has to
+// move what the session actually wrote instead of walking the staging tree.
+// The journal is reloaded on construction, a session that crashed is flushed
+// by the next one.
+//
 class OverwriteManager
 {
 public:
   OverwriteManager(const std::string& staging_dir, const std::string& overwrite_dir);
+  ~OverwriteManager();
+
+  OverwriteManager(const OverwriteManager&)            = delete;
+  OverwriteManager& operator=(const OverwriteManager&) = delete;
 
   std::string copyOnWrite(const std::string& source_path,
                           const std::string& relative_path);
@@ -26,9 +38,34 @@ public:
   std::string overwritePath(const std::string& relative_path) const;
   std::string stagingPath(const std::string& relative_path) const;
 
+  // moves everything staged into the overwrite directory, one directory at a
+  // time, then removes the staging directory and the journal; falls back to
+  // walking staging when the journal is missing or can't describe a change
+  //
+  void flush();
+
 private:
+  enum class Staged : char
+  {
+    File      = 'F',
+    Directory = 'D',
+  };
+
+  void loadJournal();
+  void record(Staged kind, const std::string& relative);
+  void recordRescan();
+  void appendJournal(const std::string& line);
+  void scanStaging();
+  bool replay();
+
   std::string m_stagingDir;
   std::string m_overwriteDir;
+  std::string m_journalPath;
+
+  std::mutex m_journalMutex;
+  int m_journalFd = -1;
+  std::map<std::string, Staged> m_staged;
+  bool m_needsScan = false;
 };
 
 #endif
@@ -0,0 +1,198 @@
+#include "taskpool.h"
+
+#include <algorithm>
+
+namespace
+{
+constexpr size_t NoWorker = static_cast<size_t>(-1);
+
+thread_local VfsTaskPool* t_pool = nullptr;
+thread_local size_t t_worker     = NoWorker;
+}  // namespace
+
+VfsTaskPool::VfsTaskPool(size_t threads)
+{
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  m_workers.reserve(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    m_workers.push_back(std::make_unique<Worker>());
+  }
+
+  // only started once every deque exists, workers steal from all of them
+  for (size_t i = 0; i < threads; ++i) {
+    m_workers[i]->thread = std::thread([this, i] {
+      workerMain(i);
+    });
+  }
+}
+
+VfsTaskPool::~VfsTaskPool()
+{
+  {
+    std::scoped_lock lock(m_mutex);
+    m_stop = true;
+  }
+  m_cv.notify_all();
+
+  for (auto& worker : m_workers) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+}
+
+VfsTaskPool* VfsTaskPool::current()
+{
+  return t_pool;
+}
+
+VfsTaskPool& VfsTaskPool::shared()
+{
+  // walks are dominated by syscall latency, so this scales well past the core
+  // count on SSDs; capped to avoid thrashing spinning disks
+  static VfsTaskPool pool(
+      std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()) * 2, 16));
+  return pool;
+}
+
+void VfsTaskPool::submit(Group& group, std::function<void()> task)
+{
+  group.m_pending.fetch_add(1, std::memory_order_relaxed);
+
+  const size_t queue = (t_pool == this && t_worker != NoWorker)
+                           ? t_worker
+                           : m_nextQueue.fetch_add(1, std::memory_order_relaxed) %
+                                 m_workers.size();
+  {
+    Worker& worker = *m_workers[queue];
+    std::scoped_lock lock(worker.mutex);
+    // counted before it can be taken, so the count never runs below zero
+    m_queued.fetch_add(1, std::memory_order_release);
+    worker.tasks.push_back({std::move(task), &group});
+  }
+
+  // taking the lock orders this against a sleeper checking the count
+  { std::scoped_lock lock(m_mutex); }
+  m_cv.notify_one();
+}
+
+void VfsTaskPool::wait(Group& group)
+{
+  // a thread outside the pool helps too, and its subtasks land in this pool
+  VfsTaskPool* const previousPool = t_pool;
+  const size_t previousWorker     = t_worker;
+  if (t_pool != this) {
+    t_pool   = this;
+    t_worker = NoWorker;
+  }
+
+  while (group.m_pending.load(std::memory_order_acquire) != 0) {
+    if (runOne(t_worker)) {
+      continue;
+    }
+
+    std::unique_lock lock(m_mutex);
+    m_cv.wait(lock, [&] {
+      return group.m_pending.load(std::memory_order_acquire) == 0 ||
+             m_queued.load(std::memory_order_acquire) != 0;
+    });
+  }
+
+  t_pool   = previousPool;
+  t_worker = previousWorker;
+}
+
+void VfsTaskPool::workerMain(size_t index)
+{
+  t_pool   = this;
+  t_worker = index;
+
+  for (;;) {
+    if (runOne(index)) {
+      continue;
+    }
+
+    std::unique_lock lock(m_mutex);
+    m_cv.wait(lock, [&] {
+      return m_stop || m_queued.load(std::memory_order_acquire) != 0;
+    });
+    if (m_stop && m_queued.load(std::memory_order_acquire) == 0) {
+      return;
+    }
+  }
+}
+
+bool VfsTaskPool::runOne(size_t self)
+{
+  Task task;
+  if (!take(self, task)) {
+    return false;
+  }
+
+  task.fn();
+  finish(task);
+  return true;
+}
+
+bool VfsTaskPool::take(size_t self, Task& task)
+{
+  const size_t count = m_workers.size();
+
+  if (self != NoWorker) {
+    Worker& own = *m_workers[self];
+    std::scoped_lock lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      m_queued.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  const size_t start = self != NoWorker ? self + 1 : m_nextQueue.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < count; ++i) {
+    Worker& victim = *m_workers[(start + i) % count];
+    std::scoped_lock lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      m_queued.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void VfsTaskPool::finish(Task& task)
+{
+  if (task.group->m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    { std::scoped_lock lock(m_mutex); }
+    m_cv.notify_all();
+  }
+}
+
+void parallelFor(size_t count, const std::function<void(size_t)>& fn)
+{
+  if (count <= 1) {
+    if (count == 1) {
+      fn(0);
+    }
+    return;
+  }
+
+  VfsTaskPool& pool = VfsTaskPool::current() ? *VfsTaskPool::current()
+                                             : VfsTaskPool::shared();
+  VfsTaskPool::Group group;
+  for (size_t i = 1; i < count; ++i) {
+    pool.submit(group, [&fn, i] {
+      fn(i);
+    });
+  }
+
+  fn(0);
+  pool.wait(group);
+}
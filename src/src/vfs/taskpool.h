@@ -0,0 +1,97 @@
+#ifndef VFS_TASKPOOL_H
+#define VFS_TASKPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool for directory walks.  Every worker has its own deque:
+// tasks submitted from a worker go to the back of its deque and are taken
+// from there (depth first, so a walk stays local), idle workers steal from
+// the front of the others' (the biggest, oldest subtrees).  Threads wait on a
+// condition variable, nothing polls.
+//
+// Tasks belong to a Group that is waited on.  A worker waiting on a group
+// runs queued tasks until the group is done, so tasks may split themselves
+// into subtasks and wait for them without tying up the pool.
+//
+class VfsTaskPool
+{
+public:
+  class Group
+  {
+  public:
+    Group() = default;
+    Group(const Group&)            = delete;
+    Group& operator=(const Group&) = delete;
+
+  private:
+    friend class VfsTaskPool;
+    std::atomic<size_t> m_pending{0};
+  };
+
+  // `threads` of 0 uses the core count
+  //
+  explicit VfsTaskPool(size_t threads = 0);
+  ~VfsTaskPool();
+
+  VfsTaskPool(const VfsTaskPool&)            = delete;
+  VfsTaskPool& operator=(const VfsTaskPool&) = delete;
+
+  size_t threadCount() const { return m_workers.size(); }
+
+  void submit(Group& group, std::function<void()> task);
+
+  // returns once every task of `group` has run, running tasks meanwhile
+  //
+  void wait(Group& group);
+
+  // pool of the calling worker thread, null if it isn't one
+  //
+  static VfsTaskPool* current();
+
+  // process-wide pool sized for directory walks, started on first use
+  //
+  static VfsTaskPool& shared();
+
+private:
+  struct Task
+  {
+    std::function<void()> fn;
+    Group* group = nullptr;
+  };
+
+  struct Worker
+  {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+    std::thread thread;
+  };
+
+  void workerMain(size_t index);
+  bool runOne(size_t self);
+  bool take(size_t self, Task& task);
+  void finish(Task& task);
+
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  std::atomic<size_t> m_queued{0};
+  std::atomic<size_t> m_nextQueue{0};
+
+  // sleeping workers and waiters
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  bool m_stop = false;
+};
+
+// Calls fn(0) .. fn(count - 1) on the current pool, or the shared one when
+// not called from a worker.
+//
+void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+#endif
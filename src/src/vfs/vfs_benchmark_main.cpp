@@ -0,0 +1,575 @@
+// Benchmarks of the VFS on a synthetic mod setup.
+//
+// Generates a data directory and `--mods` mods of `--files` files each below a
+// temporary directory, `--overlap` percent of the files of a mod are also in
+// every other mod.  It then times scanning the mods and building the tree, the
+// way the helper does it on mount and on a mod list change, along with the
+// memory the tree takes.
+//
+// Unless --no-mount is given, the data directory is also mounted like the
+// helper does it and `--threads` threads run lookups, directory listings,
+// reads and writes against the mount for `--seconds` seconds each.  The
+// latencies are measured from the caller's side, so they include the kernel;
+// the metrics of the filesystem itself are printed as JSON at the end.
+//
+//   mo2-vfs-benchmark --mods=500 --files=200 --overlap=20 --depth=3 --threads=8
+
+#include "inodetable.h"
+#include "mo2filesystem.h"
+#include "overwritemanager.h"
+#include "vfstree.h"
+
+#include <fuse3/fuse_lowlevel.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchConfig
+{
+  int mods      = 200;
+  int files     = 100;
+  int overlap   = 10;  // percent of the files of a mod shared by all mods
+  int depth     = 3;
+  int fanout    = 4;  // subdirectories per directory
+  int file_size = 4096;
+  int threads   = 4;
+  int seconds   = 3;
+  int repeat    = 3;
+  bool mount    = true;
+  bool keep     = false;
+  std::string dir;
+};
+
+static bool parseArgs(int argc, char** argv, BenchConfig& config)
+{
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg   = argv[i];
+    const auto eq           = arg.find('=');
+    const std::string key   = arg.substr(0, eq);
+    const std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+    const auto number = [&](int& target, int min) {
+      char* end    = nullptr;
+      const long n = std::strtol(value.c_str(), &end, 10);
+      if (value.empty() || *end != '\0' || n < min) {
+        std::cerr << "invalid value for " << key << ": '" << value << "'\n";
+        return false;
+      }
+      target = static_cast<int>(n);
+      return true;
+    };
+
+    bool ok = true;
+    if (key == "--mods") {
+      ok = number(config.mods, 1);
+    } else if (key == "--files") {
+      ok = number(config.files, 1);
+    } else if (key == "--overlap") {
+      ok = number(config.overlap, 0) && config.overlap <= 100;
+    } else if (key == "--depth") {
+      ok = number(config.depth, 0);
+    } else if (key == "--fanout") {
+      ok = number(config.fanout, 1);
+    } else if (key == "--size") {
+      ok = number(config.file_size, 0);
+    } else if (key == "--threads") {
+      ok = number(config.threads, 1);
+    } else if (key == "--seconds") {
+      ok = number(config.seconds, 1);
+    } else if (key == "--repeat") {
+      ok = number(config.repeat, 1);
+    } else if (key == "--dir") {
+      config.dir = value;
+    } else if (key == "--no-mount") {
+      config.mount = false;
+    } else if (key == "--keep") {
+      config.keep = true;
+    } else {
+      std::cerr << "unknown option " << arg << "\n"
+                << "usage: mo2-vfs-benchmark [--mods=N] [--files=N] [--overlap=%] "
+                   "[--depth=N] [--fanout=N] [--size=BYTES] [--threads=N] "
+                   "[--seconds=N] [--repeat=N] [--dir=PATH] [--no-mount] [--keep]\n";
+      return false;
+    }
+
+    if (!ok) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// resident memory of the process in KiB, `field` is VmRSS or VmHWM
+static long memoryKiB(const char* field)
+{
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  const std::string prefix = std::string(field) + ":";
+  while (std::getline(status, line)) {
+    if (line.starts_with(prefix)) {
+      return std::strtol(line.c_str() + prefix.size(), nullptr, 10);
+    }
+  }
+  return 0;
+}
+
+static double milliseconds(Clock::duration d)
+{
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+// relative directory of the `n`th file, spread over a tree of `depth` levels
+static std::string directoryOf(const BenchConfig& config, int n)
+{
+  std::string dir;
+  for (int level = 0; level < config.depth; ++level) {
+    n /= config.fanout;
+    dir += "dir" + std::to_string(level) + "_" + std::to_string(n % config.fanout) +
+           "/";
+  }
+  return dir;
+}
+
+// the mod layout: shared files first, then the ones only `mod` has
+static std::string fileOf(const BenchConfig& config, int mod, int n)
+{
+  const int shared = config.files * config.overlap / 100;
+  if (n < shared) {
+    return directoryOf(config, n) + "shared" + std::to_string(n) + ".dat";
+  }
+  return directoryOf(config, n) + "mod" + std::to_string(mod) + "_" +
+         std::to_string(n) + ".dat";
+}
+
+static bool writeFile(const fs::path& path, const std::string& content)
+{
+  std::error_code ec;
+  fs::create_directories(path.parent_path(), ec);
+  std::ofstream out(path, std::ios::binary);
+  out << content;
+  return static_cast<bool>(out);
+}
+
+struct Setup
+{
+  std::string root;
+  std::string data_dir;
+  std::string overwrite_dir;
+  std::string staging_dir;
+  std::vector<std::pair<std::string, std::string>> mods;
+
+  // every file and directory visible in the data directory, relative
+  std::vector<std::string> files;
+  std::vector<std::string> directories;
+};
+
+static bool generate(const BenchConfig& config, Setup& setup)
+{
+  std::string base = config.dir;
+  if (base.empty()) {
+    std::string pattern = (fs::temp_directory_path() / "mo2-vfs-bench-XXXXXX").string();
+    if (::mkdtemp(pattern.data()) == nullptr) {
+      std::cerr << "failed to create a temporary directory: " << std::strerror(errno)
+                << "\n";
+      return false;
+    }
+    base = pattern;
+  }
+
+  setup.root          = base;
+  setup.data_dir      = (fs::path(base) / "data").string();
+  setup.overwrite_dir = (fs::path(base) / "overwrite").string();
+  setup.staging_dir   = (fs::path(base) / "VFS_staging").string();
+
+  std::error_code ec;
+  fs::create_directories(setup.data_dir, ec);
+  fs::create_directories(setup.overwrite_dir, ec);
+  fs::create_directories(setup.staging_dir, ec);
+
+  const std::string content(static_cast<size_t>(config.file_size), 'x');
+
+  // the game has the shared files as well, so they're overridden by all mods
+  for (int n = 0; n < config.files * config.overlap / 100; ++n) {
+    const std::string relative = fileOf(config, 0, n);
+    if (!writeFile(fs::path(setup.data_dir) / relative, content)) {
+      std::cerr << "failed to write " << relative << "\n";
+      return false;
+    }
+    setup.files.push_back(relative);
+  }
+
+  for (int mod = 0; mod < config.mods; ++mod) {
+    const std::string name = "mod" + std::to_string(mod);
+    const fs::path path    = fs::path(base) / "mods" / name;
+
+    for (int n = 0; n < config.files; ++n) {
+      const std::string relative = fileOf(config, mod, n);
+      if (!writeFile(path / relative, content)) {
+        std::cerr << "failed to write " << relative << "\n";
+        return false;
+      }
+      if (n >= config.files * config.overlap / 100) {
+        setup.files.push_back(relative);
+      }
+    }
+
+    setup.mods.emplace_back(name, path.string());
+  }
+
+  const fs::path first = fs::path(base) / "mods" / "mod0";
+  for (const auto& entry : fs::recursive_directory_iterator(first)) {
+    if (entry.is_directory()) {
+      setup.directories.push_back(fs::relative(entry.path(), first).string());
+    }
+  }
+  setup.directories.push_back("");
+
+  return true;
+}
+
+static void benchmarkBuild(const BenchConfig& config, const Setup& setup)
+{
+  std::cout << "build (" << config.repeat << " runs, best of)\n";
+
+  const auto best = [&](const char* label, const std::function<void()>& run) {
+    Clock::duration fastest = Clock::duration::max();
+    for (int i = 0; i < config.repeat; ++i) {
+      const auto start = Clock::now();
+      run();
+      fastest = std::min(fastest, Clock::now() - start);
+    }
+    std::printf("  %-28s %10.2f ms\n", label, milliseconds(fastest));
+  };
+
+  const auto baseFiles = scanDataDir(setup.data_dir);
+  const auto base      = makeBaseLayer(baseFiles);
+
+  best("scanDataDir", [&] {
+    scanDataDir(setup.data_dir);
+  });
+
+  best("buildDataDirVfs", [&] {
+    buildDataDirVfs(baseFiles, setup.data_dir, setup.mods, setup.overwrite_dir);
+  });
+
+  VfsLayerList layers;
+  best("scanLayers (cold)", [&] {
+    layers = scanLayers(base, setup.mods, setup.overwrite_dir);
+  });
+
+  best("scanLayers (cached)", [&] {
+    scanLayers(base, setup.mods, setup.overwrite_dir, layers);
+  });
+
+  best("buildTreeFromLayers", [&] {
+    buildTreeFromLayers(layers);
+  });
+
+  // a mod list change, the last mod moved to the front
+  auto reordered = setup.mods;
+  std::rotate(reordered.begin(), reordered.end() - 1, reordered.end());
+  Mo2FsContext context;
+  context.inodes = std::make_unique<InodeTable>();
+  context.updateLayers(layers, {}, false);
+  bool toggle = false;
+  best("updateLayers (reorder)", [&] {
+    toggle = !toggle;
+    context.updateLayers(
+        scanLayers(base, toggle ? reordered : setup.mods, setup.overwrite_dir, layers),
+        {});
+  });
+
+  // the tree is kept alive while measuring, only the growth is its own
+  const long before = memoryKiB("VmRSS");
+  auto tree         = std::make_unique<VfsTree>(
+      buildDataDirVfs(baseFiles, setup.data_dir, setup.mods, setup.overwrite_dir));
+  const long after = memoryKiB("VmRSS");
+
+  std::printf("  %-28s %10zu files, %zu directories, %zu nodes\n", "tree",
+              tree->file_count, tree->dir_count, tree->nodeCount());
+  std::printf("  %-28s %10ld KiB (peak %ld KiB)\n", "tree memory", after - before,
+              memoryKiB("VmHWM"));
+}
+
+struct Latencies
+{
+  std::vector<uint64_t> ns;
+  uint64_t bytes  = 0;
+  uint64_t errors = 0;
+};
+
+// runs `op` from all threads for the configured time and prints the results
+static void runPhase(const BenchConfig& config, const char* label,
+                     const std::function<bool(std::mt19937&, Latencies&, int)>& op)
+{
+  std::vector<Latencies> results(static_cast<size_t>(config.threads));
+  std::vector<std::thread> threads;
+  std::atomic<bool> stop = false;
+
+  const auto start = Clock::now();
+  for (int t = 0; t < config.threads; ++t) {
+    threads.emplace_back([&, t] {
+      std::mt19937 random(static_cast<unsigned>(t) * 7919u + 1u);
+      Latencies& own = results[static_cast<size_t>(t)];
+      while (!stop.load(std::memory_order_relaxed)) {
+        const auto opStart = Clock::now();
+        if (!op(random, own, t)) {
+          ++own.errors;
+        }
+        own.ns.push_back(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - opStart)
+                .count()));
+      }
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::seconds(config.seconds));
+  stop = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+  Latencies all;
+  for (auto& result : results) {
+    all.ns.insert(all.ns.end(), result.ns.begin(), result.ns.end());
+    all.bytes += result.bytes;
+    all.errors += result.errors;
+  }
+  if (all.ns.empty()) {
+    return;
+  }
+
+  const auto percentile = [&](double p) {
+    auto it = all.ns.begin() + static_cast<ptrdiff_t>(p * (all.ns.size() - 1));
+    std::nth_element(all.ns.begin(), it, all.ns.end());
+    return static_cast<double>(*it) / 1000.0;
+  };
+
+  const double p50 = percentile(0.5);
+  const double p99 = percentile(0.99);
+  const double max =
+      static_cast<double>(*std::max_element(all.ns.begin(), all.ns.end())) / 1000.0;
+
+  std::printf("  %-12s %10.0f ops/s  p50 %8.1f us  p99 %8.1f us  max %9.1f us", label,
+              static_cast<double>(all.ns.size()) / elapsed, p50, p99, max);
+  if (all.bytes > 0) {
+    std::printf("  %8.1f MiB/s", static_cast<double>(all.bytes) / elapsed / 1048576.0);
+  }
+  if (all.errors > 0) {
+    std::printf("  %llu errors", static_cast<unsigned long long>(all.errors));
+  }
+  std::printf("\n");
+}
+
+static void benchmarkMount(const BenchConfig& config, const Setup& setup)
+{
+  const std::string mount = setup.data_dir;
+  const auto pick = [](std::mt19937& random, const std::vector<std::string>& from) {
+    return from[std::uniform_int_distribution<size_t>(0, from.size() - 1)(random)];
+  };
+
+  std::cout << "mounted (" << config.threads << " threads, " << config.seconds
+            << " s each)\n";
+
+  runPhase(config, "getattr", [&](std::mt19937& random, Latencies&, int) {
+    struct ::stat st;
+    return ::stat((mount + "/" + pick(random, setup.files)).c_str(), &st) == 0;
+  });
+
+  runPhase(config, "lookup miss", [&](std::mt19937& random, Latencies&, int) {
+    struct ::stat st;
+    const std::string path = mount + "/" + pick(random, setup.directories) +
+                             "/missing" + std::to_string(random() % 100000);
+    return ::stat(path.c_str(), &st) != 0 && errno == ENOENT;
+  });
+
+  runPhase(config, "readdir", [&](std::mt19937& random, Latencies&, int) {
+    DIR* dir = ::opendir((mount + "/" + pick(random, setup.directories)).c_str());
+    if (dir == nullptr) {
+      return false;
+    }
+    while (::readdir(dir) != nullptr) {
+    }
+    ::closedir(dir);
+    return true;
+  });
+
+  runPhase(config, "open+read", [&](std::mt19937& random, Latencies& own, int) {
+    const int fd = ::open((mount + "/" + pick(random, setup.files)).c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    char data[64 * 1024];
+    ssize_t n = 0;
+    while ((n = ::read(fd, data, sizeof(data))) > 0) {
+      own.bytes += static_cast<uint64_t>(n);
+    }
+    ::close(fd);
+    return n == 0;
+  });
+
+  std::error_code ec;
+  fs::create_directories(mount + "/bench_writes", ec);
+  const std::string buffer(static_cast<size_t>(config.file_size), 'y');
+  std::vector<uint64_t> counters(static_cast<size_t>(config.threads));
+
+  runPhase(config, "create+write", [&](std::mt19937&, Latencies& own, int t) {
+    const std::string path = mount + "/bench_writes/t" + std::to_string(t) + "_" +
+                             std::to_string(counters[static_cast<size_t>(t)]++);
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      return false;
+    }
+    const ssize_t n = ::write(fd, buffer.data(), buffer.size());
+    ::close(fd);
+    if (n > 0) {
+      own.bytes += static_cast<uint64_t>(n);
+    }
+    return n == static_cast<ssize_t>(buffer.size());
+  });
+}
+
+static bool mountAndBenchmark(const BenchConfig& config, const Setup& setup)
+{
+  const auto baseFiles = scanDataDir(setup.data_dir);
+
+  const int backingFd = ::open(setup.data_dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (backingFd < 0) {
+    std::cerr << "failed to open " << setup.data_dir << "\n";
+    return false;
+  }
+
+  auto context       = std::make_shared<Mo2FsContext>();
+  context->inodes    = std::make_unique<InodeTable>();
+  context->overwrite =
+      std::make_unique<OverwriteManager>(setup.staging_dir, setup.overwrite_dir);
+  context->backing_dir_fd = backingFd;
+  context->uid            = ::getuid();
+  context->gid            = ::getgid();
+  context->updateLayers(
+      scanLayers(makeBaseLayer(baseFiles), setup.mods, setup.overwrite_dir), {}, false);
+
+  std::vector<std::string> argvStorage = {"mo2-vfs-benchmark", "-o",
+                                          "fsname=mo2linux",   "-o",
+                                          "default_permissions", "-o",
+                                          "noatime"};
+  std::vector<char*> fuseArgv;
+  for (auto& s : argvStorage) {
+    fuseArgv.push_back(s.data());
+  }
+  struct fuse_args args =
+      FUSE_ARGS_INIT(static_cast<int>(fuseArgv.size()), fuseArgv.data());
+
+  struct fuse_lowlevel_ops ops;
+  std::memset(&ops, 0, sizeof(ops));
+  ops.init        = mo2_init;
+  ops.lookup      = mo2_lookup;
+  ops.getattr     = mo2_getattr;
+  ops.opendir     = mo2_opendir;
+  ops.readdir     = mo2_readdir;
+  ops.readdirplus = mo2_readdirplus;
+  ops.releasedir  = mo2_releasedir;
+  ops.open        = mo2_open;
+  ops.read        = mo2_read;
+  ops.write       = mo2_write;
+  ops.create      = mo2_create;
+  ops.rename      = mo2_rename;
+  ops.setattr     = mo2_setattr;
+  ops.unlink      = mo2_unlink;
+  ops.mkdir       = mo2_mkdir;
+  ops.flush       = mo2_flush;
+  ops.fsync       = mo2_fsync;
+  ops.release     = mo2_release;
+
+  struct fuse_session* session =
+      fuse_session_new(&args, &ops, sizeof(ops), context.get());
+  if (session == nullptr) {
+    ::close(backingFd);
+    std::cerr << "failed to create the FUSE session\n";
+    return false;
+  }
+
+  if (fuse_session_mount(session, setup.data_dir.c_str()) != 0) {
+    fuse_session_destroy(session);
+    ::close(backingFd);
+    std::cerr << "failed to mount FUSE at " << setup.data_dir << "\n";
+    return false;
+  }
+  context->session = session;
+
+  std::thread fuseThread([session] {
+    runFuseLoop(session, FuseLoopOptions{});
+  });
+
+  benchmarkMount(config, setup);
+
+  fuse_session_exit(session);
+  fuse_session_unmount(session);
+  if (fuseThread.joinable()) {
+    fuseThread.join();
+  }
+  context->session = nullptr;
+  fuse_session_destroy(session);
+  ::close(backingFd);
+
+  std::cout << "filesystem metrics\n" << context->metrics->toJson() << "\n";
+  return true;
+}
+
+int main(int argc, char** argv)
+{
+  BenchConfig config;
+  if (!parseArgs(argc, argv, config)) {
+    return 2;
+  }
+
+  Setup setup;
+  std::cout << "generating " << config.mods << " mods x " << config.files
+            << " files (" << config.overlap << "% overlap, depth " << config.depth
+            << ")\n";
+  const auto start = Clock::now();
+  if (!generate(config, setup)) {
+    return 1;
+  }
+  std::printf("  %-28s %10.2f ms in %s\n", "generated",
+              milliseconds(Clock::now() - start), setup.root.c_str());
+
+  benchmarkBuild(config, setup);
+
+  bool ok = true;
+  if (config.mount) {
+    ok = mountAndBenchmark(config, setup);
+  }
+
+  if (!config.keep) {
+    std::error_code ec;
+    fs::remove_all(setup.root, ec);
+  }
+
+  return ok ? 0 : 1;
+}
@@ -1,22 +1,30 @@
 // Standalone VFS helper for Flatpak FUSE support.
 // Runs on the host via flatpak-spawn --host, where FUSE works normally.
-// Communicates with MO2 GUI via stdin/stdout pipes.
-
+// Reads messages from MO2 GUI on stdin and reports back through the status it
+// shares, see helperprotocol.h.
+//
+// Started with `--indexer MODS OVERWRITE` it's the background indexer of an
+// instance instead, see indexer.h.
+
+#include "helperprotocol.h"
+#include "indexer.h"
 #include "inodetable.h"
+#include "layercache.h"
 #include "mo2filesystem.h"
 #include "overwritemanager.h"
 #include "vfstree.h"
 
 #include <fuse3/fuse_lowlevel.h>
 
+#include <errno.h>
 #include <fcntl.h>
 #include <signal.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include <cstdlib>
 #include <cstring>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -25,57 +33,38 @@
 
 namespace fs = std::filesystem;
 
-struct HelperConfig
-{
-  std::string mount_point;
-  std::string game_dir;
-  std::string data_dir_name;
-  std::string overwrite_dir;
-  std::vector<std::pair<std::string, std::string>> mods;
-  std::vector<std::pair<std::string, std::string>> extra_files;
-};
-
-static HelperConfig readConfig(const std::string& path)
+// reads exactly `size` bytes, false on EOF or a broken pipe
+static bool readFull(int fd, char* data, size_t size)
 {
-  HelperConfig cfg;
-  std::ifstream in(path);
-  std::string line;
-
-  while (std::getline(in, line)) {
-    if (line.empty() || line[0] == '#') {
+  while (size > 0) {
+    const ssize_t n = ::read(fd, data, size);
+    if (n < 0 && errno == EINTR) {
       continue;
     }
-
-    const auto eq = line.find('=');
-    if (eq == std::string::npos) {
-      continue;
+    if (n <= 0) {
+      return false;
     }
+    data += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
 
-    const std::string key = line.substr(0, eq);
-    const std::string val = line.substr(eq + 1);
-
-    if (key == "mount_point") {
-      cfg.mount_point = val;
-    } else if (key == "game_dir") {
-      cfg.game_dir = val;
-    } else if (key == "data_dir_name") {
-      cfg.data_dir_name = val;
-    } else if (key == "overwrite_dir") {
-      cfg.overwrite_dir = val;
-    } else if (key == "mod") {
-      const auto pipe = val.find('|');
-      if (pipe != std::string::npos) {
-        cfg.mods.emplace_back(val.substr(0, pipe), val.substr(pipe + 1));
-      }
-    } else if (key == "extra_file") {
-      const auto pipe = val.find('|');
-      if (pipe != std::string::npos) {
-        cfg.extra_files.emplace_back(val.substr(0, pipe), val.substr(pipe + 1));
-      }
-    }
+static bool readMessage(HelperMessage& type, std::string& payload)
+{
+  char header[HelperHeaderSize];
+  uint32_t size = 0;
+
+  if (!readFull(STDIN_FILENO, header, sizeof(header))) {
+    return false;
+  }
+  parseHelperHeader(header, type, size);
+  if (size > HelperMaxPayload) {
+    return false;
   }
 
-  return cfg;
+  payload.resize(size);
+  return readFull(STDIN_FILENO, payload.data(), size);
 }
 
 static void tryUnmountStale(const std::string& path)
@@ -96,68 +85,58 @@ static void tryUnmountStale(const std::string& path)
   }
 }
 
-static void flushStaging(const std::string& stagingDir,
-                         const std::string& overwriteDir)
+static void setupFuseOps(struct fuse_lowlevel_ops* ops)
 {
-  const fs::path staging(stagingDir);
-  const fs::path overwrite(overwriteDir);
-  if (!fs::exists(staging)) {
-    return;
-  }
-
-  std::error_code ec;
-  for (auto it = fs::recursive_directory_iterator(
-           staging, fs::directory_options::skip_permission_denied);
-       it != fs::recursive_directory_iterator(); ++it) {
-    const auto& entry = *it;
-    const fs::path rel = fs::relative(entry.path(), staging, ec);
-    if (ec || rel.empty()) {
-      continue;
-    }
+  std::memset(ops, 0, sizeof(struct fuse_lowlevel_ops));
+  ops->init        = mo2_init;
+  ops->lookup      = mo2_lookup;
+  ops->getattr     = mo2_getattr;
+  ops->opendir     = mo2_opendir;
+  ops->readdir     = mo2_readdir;
+  ops->readdirplus = mo2_readdirplus;
+  ops->releasedir  = mo2_releasedir;
+  ops->open        = mo2_open;
+  ops->read        = mo2_read;
+  ops->write       = mo2_write;
+  ops->create      = mo2_create;
+  ops->rename      = mo2_rename;
+  ops->setattr     = mo2_setattr;
+  ops->unlink      = mo2_unlink;
+  ops->mkdir       = mo2_mkdir;
+  ops->flush       = mo2_flush;
+  ops->fsync       = mo2_fsync;
+  ops->release     = mo2_release;
+}
 
-    const fs::path dest = overwrite / rel;
-    if (entry.is_directory(ec)) {
-      fs::create_directories(dest, ec);
-      continue;
-    }
+static struct fuse_session* g_session = nullptr;
 
-    if (!entry.is_regular_file(ec)) {
-      continue;
-    }
+// shared with the GUI, null if it didn't send one and reads stdout instead
+static HelperStatus* g_status = nullptr;
+static int g_eventFd          = -1;
 
-    fs::create_directories(dest.parent_path(), ec);
-    fs::rename(entry.path(), dest, ec);
-    if (ec) {
-      ec.clear();
-      fs::copy_file(entry.path(), dest, fs::copy_options::overwrite_existing, ec);
-      if (!ec) {
-        fs::remove(entry.path(), ec);
-      }
-    }
+static void reply(bool ok, const std::string& error = {})
+{
+  if (g_status == nullptr) {
+    std::cout << (ok ? "ok" : "error: " + error) << std::endl;
+    return;
   }
 
-  fs::remove_all(staging, ec);
+  if (!ok) {
+    std::cerr << "error: " << error << std::endl;
+  }
+  completeHelperMessage(*g_status, g_eventFd, ok, error);
 }
 
-static void setupFuseOps(struct fuse_lowlevel_ops* ops)
+static int failMount(const std::string& error)
 {
-  std::memset(ops, 0, sizeof(struct fuse_lowlevel_ops));
-  ops->lookup  = mo2_lookup;
-  ops->getattr = mo2_getattr;
-  ops->readdir = mo2_readdir;
-  ops->open    = mo2_open;
-  ops->read    = mo2_read;
-  ops->write   = mo2_write;
-  ops->create  = mo2_create;
-  ops->rename  = mo2_rename;
-  ops->setattr = mo2_setattr;
-  ops->unlink  = mo2_unlink;
-  ops->mkdir   = mo2_mkdir;
-  ops->release = mo2_release;
+  if (g_status != nullptr) {
+    g_status->state.store(static_cast<uint32_t>(HelperState::Failed),
+                          std::memory_order_relaxed);
+  }
+  reply(false, error);
+  return 1;
 }
 
-static struct fuse_session* g_session = nullptr;
-
 static void signalHandler(int /*sig*/)
 {
   if (g_session) {
@@ -165,19 +144,34 @@ static void signalHandler(int /*sig*/)
   }
 }
 
-int main(int argc, char* argv[])
+int main(int argc, char** argv)
 {
-  if (argc < 2) {
-    std::cerr << "Usage: mo2-vfs-helper <config-file>\n";
+  if (argc == 4 && std::strcmp(argv[1], "--indexer") == 0) {
+    return runIndexer(argv[2], argv[3]);
+  }
+
+  // the GUI sends the configuration first, see helperprotocol.h
+  HelperMessage type = HelperMessage::Quit;
+  std::string payload;
+  HelperConfig config;
+
+  if (!readMessage(type, payload) || type != HelperMessage::Config ||
+      !decodeHelperConfig(payload, config)) {
+    std::cout << "error: invalid or incompatible VFS configuration" << std::endl;
     return 1;
   }
 
-  const std::string configPath = argv[1];
-  auto config                  = readConfig(configPath);
+  if (config.status_fd >= 0) {
+    g_status  = mapHelperStatus(config.status_fd);
+    g_eventFd = config.event_fd;
+    if (g_status == nullptr) {
+      std::cout << "error: failed to map the shared status" << std::endl;
+      return 1;
+    }
+  }
 
   if (config.mount_point.empty()) {
-    std::cout << "error: mount_point not set in config" << std::endl;
-    return 1;
+    return failMount("mount_point not set in config");
   }
 
   const std::string dataDirPath = config.mount_point;
@@ -185,9 +179,7 @@ int main(int argc, char* argv[])
       (fs::path(config.overwrite_dir).parent_path() / "VFS_staging").string();
 
   if (!fs::exists(dataDirPath)) {
-    std::cout << "error: data directory does not exist: " << dataDirPath
-              << std::endl;
-    return 1;
+    return failMount("data directory does not exist: " + dataDirPath);
   }
 
   std::error_code ec;
@@ -195,33 +187,50 @@ int main(int argc, char* argv[])
   fs::create_directories(config.overwrite_dir, ec);
 
   // Scan base game files BEFORE mounting (after mount they're hidden)
-  auto baseFileCache = scanDataDir(dataDirPath);
+  // (the persisted layer cache only re-walks directories that changed)
+  auto layerCache    = std::make_shared<VfsLayerCache>(layerCachePath(config.overwrite_dir));
+  auto baseFileCache = layerCache->scan("_base_game", dataDirPath)->entries;
 
   // Open fd to data dir BEFORE mounting so we can access original files
   int backingFd = open(dataDirPath.c_str(), O_RDONLY | O_DIRECTORY);
   if (backingFd < 0) {
-    std::cout << "error: failed to open backing fd for " << dataDirPath
-              << std::endl;
-    return 1;
+    return failMount("failed to open backing fd for " + dataDirPath);
   }
 
   // Clean up any stale FUSE mount
   tryUnmountStale(dataDirPath);
 
-  // Build VFS tree
-  auto tree = std::make_shared<VfsTree>(
-      buildDataDirVfs(baseFileCache, dataDirPath, config.mods,
-                      config.overwrite_dir));
-  injectExtraFiles(*tree, config.extra_files);
-
-  auto context            = std::make_shared<Mo2FsContext>();
-  context->tree           = tree;
-  context->inodes         = std::make_unique<InodeTable>();
+  auto context              = std::make_shared<Mo2FsContext>();
+  context->inodes           = std::make_unique<InodeTable>();
   context->overwrite =
       std::make_unique<OverwriteManager>(stagingDir, config.overwrite_dir);
-  context->backing_dir_fd = backingFd;
-  context->uid            = ::getuid();
-  context->gid            = ::getgid();
+  context->backing_dir_fd   = backingFd;
+  context->uid              = ::getuid();
+  context->gid              = ::getgid();
+  context->splice_reads     = config.splice_reads;
+  context->passthrough      = config.passthrough;
+  context->writeback_cache  = config.writeback;
+  context->serve_archives   = config.archives;
+  context->lazy_copy_up     = config.lazy_copy_up;
+  context->prefetch         = config.prefetch;
+  context->negative_timeout = config.negative_ttl;
+  if (g_status != nullptr) {
+    context->metrics = &g_status->metrics;
+  }
+
+  // Build VFS tree, starting from the layers the GUI already scanned
+  VfsLayerList previous;
+  if (config.layers_fd >= 0 && !readLayerImageFd(config.layers_fd, previous)) {
+    std::cerr << "warning: ignoring unreadable layer image" << std::endl;
+  }
+  const VfsLayerList cached = layerCache->layers();
+  previous.insert(previous.end(), cached.begin(), cached.end());
+
+  auto layers = scanLayers(makeBaseLayer(baseFileCache), config.mods,
+                           config.overwrite_dir, previous);
+  layerCache->update(layers);
+  context->updateLayers(std::move(layers), config.extra_files, false);
+  layerCache->save();
 
   // Setup FUSE
   std::vector<std::string> argvStorage = {
@@ -244,18 +253,17 @@ int main(int argc, char* argv[])
       fuse_session_new(&args, &ops, sizeof(ops), context.get());
   if (session == nullptr) {
     close(backingFd);
-    std::cout << "error: failed to create FUSE session" << std::endl;
-    return 1;
+    return failMount("failed to create FUSE session");
   }
 
   if (fuse_session_mount(session, dataDirPath.c_str()) != 0) {
     fuse_session_destroy(session);
     close(backingFd);
-    std::cout << "error: failed to mount FUSE at " << dataDirPath << std::endl;
-    return 1;
+    return failMount("failed to mount FUSE at " + dataDirPath);
   }
 
-  g_session = session;
+  g_session        = session;
+  context->session = session;
 
   // Handle signals for clean shutdown
   struct sigaction sa;
@@ -266,50 +274,112 @@ int main(int argc, char* argv[])
   sigaction(SIGTERM, &sa, nullptr);
 
   // Start FUSE event loop in background thread
-  std::thread fuseThread([session]() {
-    fuse_session_loop_mt(session, nullptr);
+  std::thread fuseThread([session, options = config.loop]() {
+    runFuseLoop(session, options);
   });
 
-  std::cout << "mounted" << std::endl;
+  // reads ahead what the previous launch of the profile traced while this one
+  // starts, with the trace of the launch an update is for replacing it
+  std::thread accessReplay;
+  const auto stopAccessReplay = [&] {
+    context->access_trace.cancel();
+    if (accessReplay.joinable()) {
+      accessReplay.join();
+    }
+  };
+  const auto startAccessTrace = [&](const std::string& path) {
+    stopAccessReplay();
+    context->access_trace.start(path);
+    accessReplay = std::thread([context, backingFd] {
+      context->access_trace.replay(backingFd);
+    });
+  };
+
+  if (!config.access_trace.empty()) {
+    startAccessTrace(config.access_trace);
+  }
 
-  // Command loop: read commands from stdin
-  std::string line;
-  while (std::getline(std::cin, line)) {
-    if (line == "rebuild") {
-      auto newConfig = readConfig(configPath);
-      auto newTree   = std::make_shared<VfsTree>(buildDataDirVfs(
-          baseFileCache, dataDirPath, newConfig.mods, newConfig.overwrite_dir));
-      injectExtraFiles(*newTree, newConfig.extra_files);
+  if (g_status != nullptr) {
+    g_status->state.store(static_cast<uint32_t>(HelperState::Mounted),
+                          std::memory_order_relaxed);
+    reply(true);
+  } else {
+    std::cout << "mounted" << std::endl;
+  }
 
-      {
-        std::unique_lock lock(context->tree_mutex);
-        context->tree.swap(newTree);
+  // Command loop: read messages from stdin
+  while (readMessage(type, payload)) {
+    if (type == HelperMessage::Update) {
+      HelperUpdate update;
+      if (!decodeHelperUpdate(payload, update) ||
+          !applyModListDelta(config.mods, update.mods)) {
+        reply(false, "invalid VFS update");
+        continue;
+      }
+      config.overwrite_dir = std::move(update.overwrite_dir);
+      config.data_dir_name = std::move(update.data_dir_name);
+      config.extra_files   = std::move(update.extra_files);
+
+      // the layers already in the tree come first, keeping them lets
+      // updateLayers() patch only what the new ones change
+      VfsLayerList previous = context->layers;
+      VfsLayerList scanned;
+      if (!update.layers.empty() && decodeLayerImage(update.layers, scanned)) {
+        previous.insert(previous.end(), scanned.begin(), scanned.end());
       }
 
-      config = newConfig;
-      std::cout << "ok" << std::endl;
-    } else if (line == "flush") {
-      flushStaging(stagingDir, config.overwrite_dir);
-      fs::create_directories(stagingDir, ec);
-
-      auto newTree = std::make_shared<VfsTree>(buildDataDirVfs(
-          baseFileCache, dataDirPath, config.mods, config.overwrite_dir));
-      injectExtraFiles(*newTree, config.extra_files);
+      auto layers = scanLayers(context->layers.front(), config.mods,
+                               config.overwrite_dir, previous);
+      layerCache->update(layers);
+      context->updateLayers(std::move(layers), config.extra_files);
+      layerCache->save();
 
-      {
-        std::unique_lock lock(context->tree_mutex);
-        context->tree.swap(newTree);
+      if (!update.access_trace.empty()) {
+        startAccessTrace(update.access_trace);
       }
 
+      reply(true);
+    } else if (type == HelperMessage::Flush) {
+      context->overwrite->flush();
+      fs::create_directories(stagingDir, ec);
+
+      auto layers = scanLayers(context->layers.front(), config.mods,
+                               config.overwrite_dir, context->layers);
+      layerCache->update(layers);
+      context->updateLayers(std::move(layers), config.extra_files, false);
+      layerCache->save();
+
       context->overwrite =
           std::make_unique<OverwriteManager>(stagingDir, config.overwrite_dir);
-      std::cout << "ok" << std::endl;
-    } else if (line == "quit") {
+      if (g_status != nullptr) {
+        g_status->flushed_bytes.store(
+            context->metrics->writeBytes() + context->metrics->copyUpBytes(),
+            std::memory_order_relaxed);
+      }
+      reply(true);
+    } else if (type == HelperMessage::Metrics) {
+      // a GUI sharing the status reads them in place
+      if (g_status == nullptr) {
+        std::cout << context->metrics->toJson() << "\n";
+      }
+      reply(true);
+    } else if (type == HelperMessage::MetricsReset) {
+      context->metrics->reset();
+      if (g_status != nullptr) {
+        g_status->flushed_bytes.store(0, std::memory_order_relaxed);
+      }
+      reply(true);
+    } else if (type == HelperMessage::Quit) {
       break;
     }
   }
 
   // Clean shutdown
+  stopAccessReplay();
+  if (!context->access_trace.stop()) {
+    std::cerr << "warning: failed to write the access trace" << std::endl;
+  }
+
   fuse_session_exit(session);
   fuse_session_unmount(session);
 
@@ -317,12 +387,17 @@ int main(int argc, char* argv[])
     fuseThread.join();
   }
 
+  context->session = nullptr;
   fuse_session_destroy(session);
   g_session = nullptr;
 
-  flushStaging(stagingDir, config.overwrite_dir);
+  context->overwrite->flush();
   close(backingFd);
 
-  std::cout << "ok" << std::endl;
+  if (g_status != nullptr) {
+    g_status->state.store(static_cast<uint32_t>(HelperState::Stopped),
+                          std::memory_order_relaxed);
+  }
+  reply(true);
   return 0;
 }
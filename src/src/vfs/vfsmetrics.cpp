@@ -0,0 +1,108 @@
+#include "vfsmetrics.h"
+
+#include <algorithm>
+#include <bit>
+#include <iterator>
+
+namespace
+{
+constexpr const char* OpNames[] = {"lookup", "getattr", "opendir", "readdir", "open",
+                                   "read",   "write",   "create",  "rename",  "setattr",
+                                   "unlink", "mkdir",   "release"};
+
+static_assert(std::size(OpNames) == static_cast<size_t>(VfsOp::Count));
+
+void appendField(std::string& out, const char* key, uint64_t value)
+{
+  out += '"';
+  out += key;
+  out += "\":";
+  out += std::to_string(value);
+}
+}  // namespace
+
+const char* VfsMetrics::name(VfsOp op)
+{
+  return OpNames[static_cast<size_t>(op)];
+}
+
+void VfsMetrics::record(VfsOp op, std::chrono::steady_clock::duration elapsed)
+{
+  const auto us = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+  const size_t bucket =
+      std::min<size_t>(us < 2 ? 0 : std::bit_width(us) - 1, Buckets - 1);
+
+  OpStats& stats = m_ops[static_cast<size_t>(op)];
+  stats.count.fetch_add(1, std::memory_order_relaxed);
+  stats.total_us.fetch_add(us, std::memory_order_relaxed);
+  stats.histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+
+  uint64_t max = stats.max_us.load(std::memory_order_relaxed);
+  while (us > max &&
+         !stats.max_us.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+  }
+}
+
+void VfsMetrics::reset()
+{
+  for (auto& stats : m_ops) {
+    stats.count.store(0, std::memory_order_relaxed);
+    stats.total_us.store(0, std::memory_order_relaxed);
+    stats.max_us.store(0, std::memory_order_relaxed);
+    for (auto& bucket : stats.histogram) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  m_readBytes.store(0, std::memory_order_relaxed);
+  m_writeBytes.store(0, std::memory_order_relaxed);
+  m_copyUps.store(0, std::memory_order_relaxed);
+  m_copyUpBytes.store(0, std::memory_order_relaxed);
+}
+
+std::string VfsMetrics::toJson() const
+{
+  std::string out = "{\"ops\":{";
+
+  for (size_t i = 0; i < m_ops.size(); ++i) {
+    const OpStats& stats = m_ops[i];
+
+    if (i != 0) {
+      out += ',';
+    }
+    out += '"';
+    out += OpNames[i];
+    out += "\":{";
+    appendField(out, "count", stats.count.load(std::memory_order_relaxed));
+    out += ',';
+    appendField(out, "total_us", stats.total_us.load(std::memory_order_relaxed));
+    out += ',';
+    appendField(out, "max_us", stats.max_us.load(std::memory_order_relaxed));
+    out += ",\"histogram\":[";
+
+    size_t used = Buckets;
+    while (used > 0 && stats.histogram[used - 1].load(std::memory_order_relaxed) == 0) {
+      --used;
+    }
+    for (size_t b = 0; b < used; ++b) {
+      if (b != 0) {
+        out += ',';
+      }
+      out += std::to_string(stats.histogram[b].load(std::memory_order_relaxed));
+    }
+    out += "]}";
+  }
+
+  out += "},";
+  appendField(out, "read_bytes", m_readBytes.load(std::memory_order_relaxed));
+  out += ',';
+  appendField(out, "write_bytes", m_writeBytes.load(std::memory_order_relaxed));
+  out += ',';
+  appendField(out, "copy_ups", m_copyUps.load(std::memory_order_relaxed));
+  out += ',';
+  appendField(out, "copy_up_bytes", m_copyUpBytes.load(std::memory_order_relaxed));
+  out += '}';
+
+  return out;
+}
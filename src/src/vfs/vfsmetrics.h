@@ -0,0 +1,110 @@
+#ifndef VFS_VFSMETRICS_H
+#define VFS_VFSMETRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+enum class VfsOp : uint8_t
+{
+  Lookup,
+  Getattr,
+  Opendir,
+  Readdir,
+  Open,
+  Read,
+  Write,
+  Create,
+  Rename,
+  Setattr,
+  Unlink,
+  Mkdir,
+  Release,
+  Count
+};
+
+// Per-operation counters and latency histograms of the daemon.  Everything is
+// a relaxed atomic so recording never blocks a FUSE worker; a snapshot taken
+// while requests are in flight may be off by the requests being recorded.
+//
+// Latencies go into power-of-two buckets of microseconds: bucket 0 holds
+// everything under 2us, bucket i everything in [2^i, 2^(i+1)) us.
+class VfsMetrics
+{
+public:
+  static constexpr size_t Buckets = 32;
+
+  void record(VfsOp op, std::chrono::steady_clock::duration elapsed);
+
+  // bytes served by read; spliced reads count what was requested since
+  // libfuse doesn't report how much was moved
+  //
+  void addReadBytes(uint64_t bytes) { m_readBytes.fetch_add(bytes, std::memory_order_relaxed); }
+  void addWriteBytes(uint64_t bytes) { m_writeBytes.fetch_add(bytes, std::memory_order_relaxed); }
+
+  void addCopyUp(uint64_t bytes)
+  {
+    m_copyUps.fetch_add(1, std::memory_order_relaxed);
+    m_copyUpBytes.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  uint64_t writeBytes() const { return m_writeBytes.load(std::memory_order_relaxed); }
+  uint64_t copyUpBytes() const { return m_copyUpBytes.load(std::memory_order_relaxed); }
+
+  void reset();
+
+  // single-line JSON object:
+  //   {"ops":{"lookup":{"count":..,"total_us":..,"max_us":..,"histogram":[..]},..},
+  //    "read_bytes":..,"write_bytes":..,"copy_ups":..,"copy_up_bytes":..}
+  // histograms are trimmed after the last non-empty bucket
+  //
+  std::string toJson() const;
+
+  static const char* name(VfsOp op);
+
+private:
+  struct OpStats
+  {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_us{0};
+    std::atomic<uint64_t> max_us{0};
+    std::array<std::atomic<uint64_t>, Buckets> histogram{};
+  };
+
+  std::array<OpStats, static_cast<size_t>(VfsOp::Count)> m_ops;
+  std::atomic<uint64_t> m_readBytes{0};
+  std::atomic<uint64_t> m_writeBytes{0};
+  std::atomic<uint64_t> m_copyUps{0};
+  std::atomic<uint64_t> m_copyUpBytes{0};
+};
+
+// Records the time until it goes out of scope as one `op`; does nothing
+// without metrics.
+class VfsOpTimer
+{
+public:
+  VfsOpTimer(VfsMetrics* metrics, VfsOp op)
+      : m_metrics(metrics), m_op(op),
+        m_start(metrics ? std::chrono::steady_clock::now()
+                        : std::chrono::steady_clock::time_point{})
+  {}
+
+  ~VfsOpTimer()
+  {
+    if (m_metrics != nullptr) {
+      m_metrics->record(m_op, std::chrono::steady_clock::now() - m_start);
+    }
+  }
+
+  VfsOpTimer(const VfsOpTimer&)            = delete;
+  VfsOpTimer& operator=(const VfsOpTimer&) = delete;
+
+private:
+  VfsMetrics* m_metrics;
+  VfsOp m_op;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+#endif
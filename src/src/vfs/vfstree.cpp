@@ -1,19 +1,32 @@
 #include "vfstree.h"
+#include "../shared/casefold.h"
+#include "taskpool.h"
 
 #include <algorithm>
-#include <cctype>
+#include <atomic>
+#include <deque>
 #include <filesystem>
+#include <unordered_set>
+#include <utility>
 
 namespace
 {
 namespace fs = std::filesystem;
 
+// exact conversion, so the same file time always maps to the same value and
+// recorded mtimes can be compared later
 std::chrono::system_clock::time_point
 fsTimeToSystemClock(const fs::file_time_type& t)
 {
-  const auto nowFs  = fs::file_time_type::clock::now();
-  const auto nowSys = std::chrono::system_clock::now();
-  return nowSys + std::chrono::duration_cast<std::chrono::system_clock::duration>(t - nowFs);
+  return std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+      std::chrono::file_clock::to_sys(t));
+}
+
+std::chrono::system_clock::time_point pathMtime(const fs::path& path)
+{
+  std::error_code ec;
+  const auto mtime = fs::last_write_time(path, ec);
+  return ec ? std::chrono::system_clock::time_point{} : fsTimeToSystemClock(mtime);
 }
 
 std::vector<std::string> splitPath(const std::string& path)
@@ -42,111 +55,426 @@ std::vector<std::string> splitPath(const std::string& path)
   return out;
 }
 
-void addDirectoryToTree(VfsTree& tree, const fs::path& walkDir,
-                        const fs::path& stripPrefix, const std::string& origin,
-                        const std::vector<std::string>& prefix,
-                        bool is_backing = false)
+// a directory merged into the tree as one priority layer
+struct ScanSource
 {
-  if (!fs::exists(walkDir)) {
-    return;
-  }
-
-  for (auto it = fs::recursive_directory_iterator(
-           walkDir, fs::directory_options::skip_permission_denied);
-       it != fs::recursive_directory_iterator(); ++it) {
+  fs::path dir;
+  std::string origin;
+  std::vector<std::string> prefix;
+};
+
+// Lists one directory of a walk into `out`, pre-order: each subdirectory's
+// own entry is followed by its contents.  Subdirectories are walked as tasks
+// of the current pool and spliced in afterwards, so one huge mod spreads over
+// every worker instead of one.  Relative paths are built lexically, which is
+// far cheaper than fs::relative() since that canonicalizes both paths.
+void scanTree(const fs::path& dir, const std::string& relative, bool skipMetaIni,
+              std::vector<CachedBaseFile>& out)
+{
+  std::error_code ec;
+  fs::directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec);
+
+  struct Subtree
+  {
+    size_t position;  // index of the directory's own entry in `out`
+    fs::path path;
+    std::vector<CachedBaseFile> entries;
+  };
+  std::deque<Subtree> subtrees;
+
+  for (; !ec && it != fs::directory_iterator(); it.increment(ec)) {
     const auto& entry = *it;
-    std::error_code ec;
+    std::error_code entryEc;
 
-    const fs::path rel = fs::relative(entry.path(), stripPrefix, ec);
-    if (ec || rel.empty()) {
+    CachedBaseFile cf;
+    cf.relative_path = relative;
+    if (!relative.empty()) {
+      cf.relative_path.push_back('/');
+    }
+    cf.relative_path.append(entry.path().filename().string());
+    if (skipMetaIni && cf.relative_path == "meta.ini") {
       continue;
     }
 
-    const std::string relStr = rel.generic_string();
-    if (relStr == "meta.ini") {
-      continue;
+    cf.is_dir = entry.is_directory(entryEc);
+    if (!cf.is_dir) {
+      if (!entry.is_regular_file(entryEc)) {
+        continue;
+      }
+      cf.size = entry.file_size(entryEc);
     }
 
-    auto relParts = splitPath(relStr);
-    std::vector<std::string> components;
-    components.reserve(prefix.size() + relParts.size());
-    components.insert(components.end(), prefix.begin(), prefix.end());
-    components.insert(components.end(), relParts.begin(), relParts.end());
+    // directory mtimes are recorded too, they're what tells a stale layer apart
+    const auto mtime = entry.last_write_time(entryEc);
+    cf.mtime         = entryEc ? std::chrono::system_clock::time_point{}
+                               : fsTimeToSystemClock(mtime);
 
-    if (entry.is_directory(ec)) {
-      tree.root.insertDirectory(components);
-      ++tree.dir_count;
-      continue;
+    // like the recursive iterator this replaced, symlinked directories are
+    // listed but not followed
+    if (cf.is_dir && !entry.is_symlink(entryEc)) {
+      subtrees.push_back({out.size(), entry.path(), {}});
     }
+    out.push_back(std::move(cf));
+  }
 
-    if (!entry.is_regular_file(ec)) {
-      continue;
+  if (subtrees.empty()) {
+    return;
+  }
+
+  parallelFor(subtrees.size(), [&](size_t i) {
+    Subtree& sub = subtrees[i];
+    scanTree(sub.path, out[sub.position].relative_path, false, sub.entries);
+  });
+
+  size_t total = out.size();
+  for (const auto& sub : subtrees) {
+    total += sub.entries.size();
+  }
+
+  // splice every subtree in right after its directory's entry
+  std::vector<CachedBaseFile> merged;
+  merged.reserve(total);
+  size_t next = 0;
+  for (auto& sub : subtrees) {
+    merged.insert(merged.end(), std::make_move_iterator(out.begin() + next),
+                  std::make_move_iterator(out.begin() + sub.position + 1));
+    merged.insert(merged.end(), std::make_move_iterator(sub.entries.begin()),
+                  std::make_move_iterator(sub.entries.end()));
+    next = sub.position + 1;
+  }
+  merged.insert(merged.end(), std::make_move_iterator(out.begin() + next),
+                std::make_move_iterator(out.end()));
+  out = std::move(merged);
+}
+
+// Walks `root` into a flat list of entries relative to it, see scanTree().
+std::vector<CachedBaseFile> scanDirectory(const fs::path& root, bool skipMetaIni)
+{
+  std::vector<CachedBaseFile> out;
+
+  std::error_code ec;
+  if (!fs::is_directory(root, ec)) {
+    return out;
+  }
+
+  scanTree(root, {}, skipMetaIni, out);
+  return out;
+}
+
+void insertEntry(VfsTree& tree, const CachedBaseFile& cf, const std::string& realRoot,
+                 const std::string& origin, const std::vector<std::string>& prefix,
+                 bool is_backing, std::string& realPath)
+{
+  std::vector<std::string> components = prefix;
+  auto relParts                       = splitPath(cf.relative_path);
+  components.insert(components.end(), std::make_move_iterator(relParts.begin()),
+                    std::make_move_iterator(relParts.end()));
+
+  if (cf.is_dir) {
+    tree.insertDirectory(components);
+    ++tree.dir_count;
+    return;
+  }
+
+  if (realRoot.empty()) {
+    realPath = cf.relative_path;
+  } else {
+    realPath.assign(realRoot);
+    if (realPath.back() != '/') {
+      realPath.push_back('/');
     }
+    realPath.append(cf.relative_path);
+  }
 
-    const auto size  = entry.file_size(ec);
-    const auto mtime = entry.last_write_time(ec);
-    tree.root.insertFile(components, entry.path().string(), size,
-                         ec ? std::chrono::system_clock::time_point{}
-                            : fsTimeToSystemClock(mtime),
-                         origin, is_backing);
-    ++tree.file_count;
+  tree.insertFile(components, realPath, cf.size, cf.mtime, origin, is_backing);
+  ++tree.file_count;
+}
+
+// like insertEntry() for an entry of `layer`; the files of archive layers are
+// all backed by the archive itself
+void insertLayerEntry(VfsTree& tree, const VfsLayer& layer, const CachedBaseFile& cf,
+                      std::string& realPath)
+{
+  if (!layer.from_archive || cf.is_dir) {
+    insertEntry(tree, cf, layer.root, layer.origin, {}, layer.is_backing, realPath);
+    return;
   }
+
+  tree.insertFile(splitPath(cf.relative_path), layer.root, cf.size, cf.mtime,
+                  layer.origin, false, true);
+  ++tree.file_count;
 }
 
-bool removeNodeRecursive(VfsNode* node, const std::vector<std::string>& components,
-                         size_t index)
+void insertScanned(VfsTree& tree, const std::vector<CachedBaseFile>& entries,
+                   const std::string& realRoot, const std::string& origin,
+                   const std::vector<std::string>& prefix, bool is_backing)
 {
-  if (node == nullptr || !node->is_directory || index >= components.size()) {
-    return false;
+  std::string realPath;
+  for (const auto& cf : entries) {
+    insertEntry(tree, cf, realRoot, origin, prefix, is_backing, realPath);
   }
+}
 
-  const std::string key = normalizeForLookup(components[index]);
-  auto it               = node->dir_info.children.find(key);
-  if (it == node->dir_info.children.end()) {
-    return false;
+// flags the elements that are part of one longest strictly increasing
+// subsequence of `values`
+std::vector<bool> longestIncreasingRun(const std::vector<size_t>& values)
+{
+  std::vector<size_t> tails;  // index of the smallest tail for each length
+  std::vector<size_t> previous(values.size(), SIZE_MAX);
+
+  for (size_t i = 0; i < values.size(); ++i) {
+    auto it = std::lower_bound(tails.begin(), tails.end(), values[i],
+                               [&](size_t index, size_t value) {
+                                 return values[index] < value;
+                               });
+    if (it != tails.begin()) {
+      previous[i] = *std::prev(it);
+    }
+    if (it == tails.end()) {
+      tails.push_back(i);
+    } else {
+      *it = i;
+    }
   }
 
-  if (index + 1 == components.size()) {
-    node->dir_info.children.erase(it);
-    node->dir_info.display_names.erase(key);
-    return true;
+  std::vector<bool> out(values.size(), false);
+  for (size_t i = tails.empty() ? SIZE_MAX : tails.back(); i != SIZE_MAX;
+       i        = previous[i]) {
+    out[i] = true;
   }
+  return out;
+}
 
-  VfsNode* child = it->second.get();
-  if (!removeNodeRecursive(child, components, index + 1)) {
-    return false;
+std::string lookupKey(const std::string& path)
+{
+  std::string joined;
+  for (const auto& part : splitPath(path)) {
+    if (!joined.empty()) {
+      joined.push_back('/');
+    }
+    joined.append(part);
   }
+  return normalizeForLookup(joined);
+}
 
-  if (child->is_directory && child->dir_info.children.empty()) {
-    node->dir_info.children.erase(key);
-    node->dir_info.display_names.erase(key);
+// Scans all sources concurrently, then merges them into the tree in order so
+// later sources still override earlier ones exactly as a sequential walk would.
+void addSources(VfsTree& tree, const std::vector<ScanSource>& sources)
+{
+  std::vector<std::vector<CachedBaseFile>> scanned(sources.size());
+  parallelFor(sources.size(), [&](size_t i) {
+    scanned[i] = scanDirectory(sources[i].dir, true);
+  });
+
+  for (size_t i = 0; i < sources.size(); ++i) {
+    insertScanned(tree, scanned[i], sources[i].dir.string(), sources[i].origin,
+                  sources[i].prefix, false);
+    // release each layer as soon as it's merged to keep peak memory down
+    std::vector<CachedBaseFile>().swap(scanned[i]);
   }
+}
 
-  return true;
+std::pair<std::string_view, std::string_view> splitRealPath(std::string_view path)
+{
+  const size_t slash = path.rfind('/');
+  if (slash == std::string_view::npos) {
+    return {std::string_view{}, path};
+  }
+  if (slash == 0) {
+    return {path.substr(0, 1), path.substr(1)};
+  }
+  return {path.substr(0, slash), path.substr(slash + 1)};
 }
 
 }  // namespace
 
-std::string normalizeForLookup(const std::string& path)
+std::string normalizeForLookup(std::string_view path)
 {
-  std::string result;
-  result.reserve(path.size());
-  for (unsigned char c : path) {
-    result.push_back(c == '\\' ? '/' : static_cast<char>(std::tolower(c)));
-  }
+  std::string result(path);
+  MOShared::foldAsciiInPlace(result.data(), result.size());
+  std::replace(result.begin(), result.end(), '\\', '/');
   return result;
 }
 
-void VfsNode::insertFile(const std::vector<std::string>& components,
+VfsStringPool::VfsStringPool()
+{
+  m_strings.emplace_back();
+  m_index.emplace(std::string_view{}, 0);
+}
+
+uint32_t VfsStringPool::intern(std::string_view s)
+{
+  if (auto it = m_index.find(s); it != m_index.end()) {
+    return it->second;
+  }
+
+  char* storage = nullptr;
+  if (s.size() > ChunkSize / 4) {
+    // oversized strings get their own chunk so they don't waste the current one
+    m_chunks.insert(m_chunks.begin(), std::make_unique<char[]>(s.size()));
+    storage = m_chunks.front().get();
+  } else {
+    if (m_chunkUsed + s.size() > ChunkSize) {
+      m_chunks.push_back(std::make_unique<char[]>(ChunkSize));
+      m_chunkUsed = 0;
+    }
+    storage = m_chunks.back().get() + m_chunkUsed;
+    m_chunkUsed += s.size();
+  }
+
+  std::copy(s.begin(), s.end(), storage);
+  const std::string_view stored(storage, s.size());
+  const auto id = static_cast<uint32_t>(m_strings.size());
+  m_strings.push_back(stored);
+  m_index.emplace(stored, id);
+  return id;
+}
+
+uint32_t VfsStringPool::find(std::string_view s) const
+{
+  auto it = m_index.find(s);
+  return it == m_index.end() ? npos : it->second;
+}
+
+size_t VfsStringPool::memoryUsage() const
+{
+  // nodes of the index are a pointer and its hash besides the pair
+  return m_chunks.size() * ChunkSize +
+         m_chunks.capacity() * sizeof(std::unique_ptr<char[]>) +
+         m_strings.capacity() * sizeof(std::string_view) +
+         m_index.size() * (sizeof(std::pair<std::string_view, uint32_t>) +
+                           2 * sizeof(void*)) +
+         m_index.bucket_count() * sizeof(void*);
+}
+
+VfsTree::VfsTree()
+{
+  m_nodes.emplace_back();
+}
+
+size_t VfsTree::memoryUsage() const
+{
+  size_t bytes = sizeof(VfsTree) + m_nodes.size() * sizeof(VfsNode);
+
+  for (const VfsNode& node : m_nodes) {
+    bytes += node.children.capacity() * sizeof(uint32_t);
+  }
+
+  bytes += m_buildIndex.size() * (sizeof(std::pair<BuildKey, uint32_t>) +
+                                  2 * sizeof(void*)) +
+           m_buildIndex.bucket_count() * sizeof(void*);
+
+  return bytes + m_strings.memoryUsage();
+}
+
+std::string_view VfsTree::origin(const VfsNode& node) const
+{
+  return m_strings.get(node.file_info.origin);
+}
+
+std::string VfsTree::realPath(const VfsNode& node) const
+{
+  const std::string_view dir  = m_strings.get(node.file_info.real_dir);
+  const std::string_view file = m_strings.get(node.file_info.real_name);
+
+  std::string out;
+  out.reserve(dir.size() + file.size() + 1);
+  out.append(dir);
+  if (!dir.empty() && dir.back() != '/') {
+    out.push_back('/');
+  }
+  out.append(file);
+  return out;
+}
+
+uint32_t VfsTree::newNode(uint32_t name, uint32_t key, bool isDirectory)
+{
+  const auto index = static_cast<uint32_t>(m_nodes.size());
+  VfsNode& node     = m_nodes.emplace_back();
+  node.name         = name;
+  node.key          = key;
+  node.is_directory = isDirectory;
+  return index;
+}
+
+std::vector<uint32_t>::const_iterator
+VfsTree::lowerBound(const VfsNode& dir, std::string_view key) const
+{
+  return std::lower_bound(dir.children.begin(), dir.children.end(), key,
+                          [this](uint32_t child, std::string_view k) {
+                            return m_strings.get(m_nodes[child].key) < k;
+                          });
+}
+
+uint32_t VfsTree::findChildIndex(const VfsNode& dir, std::string_view key) const
+{
+  if (!dir.is_directory) {
+    return VfsStringPool::npos;
+  }
+
+  if (!m_finalized) {
+    const uint32_t keyId = m_strings.find(key);
+    if (keyId == VfsStringPool::npos) {
+      return VfsStringPool::npos;
+    }
+    auto it = m_buildIndex.find(BuildKey{&dir, keyId});
+    return it == m_buildIndex.end() ? VfsStringPool::npos : it->second;
+  }
+
+  auto it = lowerBound(dir, key);
+  if (it == dir.children.end() || m_strings.get(m_nodes[*it].key) != key) {
+    return VfsStringPool::npos;
+  }
+  return *it;
+}
+
+void VfsTree::setChild(VfsNode& dir, uint32_t child)
+{
+  if (!m_finalized) {
+    dir.children.push_back(child);
+    m_buildIndex.emplace(BuildKey{&dir, m_nodes[child].key}, child);
+    return;
+  }
+
+  auto it = lowerBound(dir, m_strings.get(m_nodes[child].key));
+  dir.children.insert(it, child);
+}
+
+void VfsTree::unlinkChild(VfsNode& dir, uint32_t child)
+{
+  auto it = std::find(dir.children.begin(), dir.children.end(), child);
+  if (it == dir.children.end()) {
+    return;
+  }
+  dir.children.erase(it);
+
+  if (!m_finalized) {
+    m_buildIndex.erase(BuildKey{&dir, m_nodes[child].key});
+  }
+}
+
+const VfsNode* VfsTree::findChild(const VfsNode& dir, std::string_view name) const
+{
+  const uint32_t index = findChildIndex(dir, normalizeForLookup(name));
+  return index == VfsStringPool::npos ? nullptr : &m_nodes[index];
+}
+
+VfsNode* VfsTree::findChild(const VfsNode& dir, std::string_view name)
+{
+  return const_cast<VfsNode*>(std::as_const(*this).findChild(dir, name));
+}
+
+void VfsTree::insertFile(const std::vector<std::string>& components,
                          const std::string& real_path, uint64_t size,
                          std::chrono::system_clock::time_point mtime,
-                         const std::string& origin, bool is_backing)
+                         const std::string& origin, bool is_backing,
+                         bool from_archive)
 {
   if (components.empty()) {
     return;
   }
 
-  VfsNode* current = this;
+  VfsNode* current = &root();
   for (size_t i = 0; i < components.size(); ++i) {
     const std::string& part = components[i];
     if (part.empty()) {
@@ -155,38 +483,37 @@ void VfsNode::insertFile(const std::vector<std::string>& components,
 
     if (!current->is_directory) {
       current->is_directory = true;
-      current->dir_info     = VfsDirInfo{};
+      current->file_info    = VfsFileInfo{};
     }
 
-    const std::string key = normalizeForLookup(part);
-    current->dir_info.display_names[key] = part;
+    const std::string key   = normalizeForLookup(part);
+    const uint32_t nameId   = m_strings.intern(part);
+    const uint32_t existing = findChildIndex(*current, key);
+    const bool last         = i + 1 == components.size();
 
-    if (i + 1 == components.size()) {
-      auto fileNode              = std::make_unique<VfsNode>();
-      fileNode->is_directory     = false;
-      fileNode->file_info        = {real_path, size, mtime, origin, is_backing};
-      current->dir_info.children[key] = std::move(fileNode);
-      return;
+    if (existing == VfsStringPool::npos) {
+      const uint32_t child = newNode(nameId, m_strings.intern(key), !last);
+      setChild(*current, child);
+      current = &m_nodes[child];
+    } else {
+      current       = &m_nodes[existing];
+      current->name = nameId;
     }
 
-    auto it = current->dir_info.children.find(key);
-    if (it == current->dir_info.children.end() || !it->second->is_directory) {
-      auto newDir          = std::make_unique<VfsNode>();
-      newDir->is_directory = true;
-      current->dir_info.children[key] = std::move(newDir);
+    if (last) {
+      setFileInfo(*current, real_path, size, mtime, origin, is_backing, from_archive);
+      return;
     }
-
-    current = current->dir_info.children[key].get();
   }
 }
 
-void VfsNode::insertDirectory(const std::vector<std::string>& components)
+void VfsTree::insertDirectory(const std::vector<std::string>& components)
 {
   if (components.empty()) {
     return;
   }
 
-  VfsNode* current = this;
+  VfsNode* current = &root();
   for (const auto& part : components) {
     if (part.empty()) {
       continue;
@@ -194,26 +521,76 @@ void VfsNode::insertDirectory(const std::vector<std::string>& components)
 
     if (!current->is_directory) {
       current->is_directory = true;
-      current->dir_info     = VfsDirInfo{};
+      current->file_info    = VfsFileInfo{};
     }
 
-    const std::string key = normalizeForLookup(part);
-    current->dir_info.display_names[key] = part;
+    const std::string key   = normalizeForLookup(part);
+    const uint32_t nameId   = m_strings.intern(part);
+    const uint32_t existing = findChildIndex(*current, key);
 
-    auto it = current->dir_info.children.find(key);
-    if (it == current->dir_info.children.end() || !it->second->is_directory) {
-      auto newDir          = std::make_unique<VfsNode>();
-      newDir->is_directory = true;
-      current->dir_info.children[key] = std::move(newDir);
+    if (existing == VfsStringPool::npos) {
+      const uint32_t child = newNode(nameId, m_strings.intern(key), true);
+      setChild(*current, child);
+      current = &m_nodes[child];
+    } else {
+      current       = &m_nodes[existing];
+      current->name = nameId;
     }
+  }
 
-    current = current->dir_info.children[key].get();
+  if (!current->is_directory) {
+    current->is_directory = true;
+    current->file_info    = VfsFileInfo{};
   }
 }
 
-const VfsNode* VfsNode::resolve(const std::vector<std::string>& components) const
+void VfsTree::setFileInfo(VfsNode& node, const std::string& real_path,
+                          uint64_t size, std::chrono::system_clock::time_point mtime,
+                          const std::string& origin, bool is_backing,
+                          bool from_archive)
 {
-  const VfsNode* current = this;
+  if (node.is_directory && !node.children.empty()) {
+    // the directory is being shadowed by a file, drop its contents
+    if (!m_finalized) {
+      for (uint32_t child : node.children) {
+        m_buildIndex.erase(BuildKey{&node, m_nodes[child].key});
+      }
+    }
+    node.children.clear();
+    node.children.shrink_to_fit();
+  }
+
+  const auto [dir, file] = splitRealPath(real_path);
+  node.is_directory      = false;
+  node.file_info         = VfsFileInfo{m_strings.intern(dir), m_strings.intern(file),
+                                       m_strings.intern(origin), is_backing,
+                                       from_archive, size, mtime};
+}
+
+bool VfsTree::updateFileInfo(VfsNode& node, std::string_view real_path, uint64_t size,
+                             std::chrono::system_clock::time_point mtime,
+                             std::string_view origin)
+{
+  if (node.is_directory) {
+    return false;
+  }
+
+  const auto [dir, file]  = splitRealPath(real_path);
+  const uint32_t dirId    = m_strings.find(dir);
+  const uint32_t fileId   = m_strings.find(file);
+  const uint32_t originId = m_strings.find(origin);
+  if (dirId == VfsStringPool::npos || fileId == VfsStringPool::npos ||
+      originId == VfsStringPool::npos) {
+    return false;
+  }
+
+  node.file_info = VfsFileInfo{dirId, fileId, originId, false, false, size, mtime};
+  return true;
+}
+
+const VfsNode* VfsTree::resolve(const std::vector<std::string>& components) const
+{
+  const VfsNode* current = &root();
 
   for (const auto& part : components) {
     if (part.empty()) {
@@ -224,60 +601,111 @@ const VfsNode* VfsNode::resolve(const std::vector<std::string>& components) cons
       return nullptr;
     }
 
-    const std::string key = normalizeForLookup(part);
-    auto it               = current->dir_info.children.find(key);
-    if (it == current->dir_info.children.end()) {
+    current = findChild(*current, part);
+    if (current == nullptr) {
       return nullptr;
     }
-
-    current = it->second.get();
   }
 
   return current;
 }
 
-std::vector<std::pair<std::string, const VfsNode*>> VfsNode::listChildren() const
+VfsNode* VfsTree::resolve(const std::vector<std::string>& components)
 {
-  std::vector<std::pair<std::string, const VfsNode*>> out;
-  if (!is_directory) {
+  return const_cast<VfsNode*>(std::as_const(*this).resolve(components));
+}
+
+std::vector<std::pair<std::string_view, const VfsNode*>>
+VfsTree::listChildren(const VfsNode& dir) const
+{
+  std::vector<std::pair<std::string_view, const VfsNode*>> out;
+  if (!dir.is_directory) {
     return out;
   }
 
-  out.reserve(dir_info.children.size());
-  for (const auto& [key, node] : dir_info.children) {
-    auto display = dir_info.display_names.find(key);
-    if (display == dir_info.display_names.end()) {
-      continue;
-    }
-    out.emplace_back(display->second, node.get());
+  out.reserve(dir.children.size());
+  for (uint32_t child : dir.children) {
+    const VfsNode& node = m_nodes[child];
+    out.emplace_back(m_strings.get(node.name), &node);
   }
 
   return out;
 }
 
-bool VfsNode::removeFromTree(const std::vector<std::string>& components)
+bool VfsTree::removeRecursive(VfsNode& dir, const std::vector<std::string>& components,
+                              size_t index)
+{
+  if (!dir.is_directory || index >= components.size()) {
+    return false;
+  }
+
+  const uint32_t child = findChildIndex(dir, normalizeForLookup(components[index]));
+  if (child == VfsStringPool::npos) {
+    return false;
+  }
+
+  if (index + 1 == components.size()) {
+    unlinkChild(dir, child);
+    return true;
+  }
+
+  VfsNode& childNode = m_nodes[child];
+  if (!removeRecursive(childNode, components, index + 1)) {
+    return false;
+  }
+
+  if (childNode.is_directory && childNode.children.empty()) {
+    unlinkChild(dir, child);
+  }
+
+  return true;
+}
+
+bool VfsTree::removeFromTree(const std::vector<std::string>& components)
 {
   if (components.empty()) {
     return false;
   }
-  return removeNodeRecursive(this, components, 0);
+  return removeRecursive(root(), components, 0);
+}
+
+void VfsTree::finalize()
+{
+  if (m_finalized) {
+    return;
+  }
+
+  for (VfsNode& node : m_nodes) {
+    if (node.children.size() < 2) {
+      continue;
+    }
+    std::sort(node.children.begin(), node.children.end(),
+              [this](uint32_t a, uint32_t b) {
+                return m_strings.get(m_nodes[a].key) < m_strings.get(m_nodes[b].key);
+              });
+    node.children.shrink_to_fit();
+  }
+
+  m_buildIndex = {};
+  m_finalized  = true;
 }
 
 VfsTree buildVfsTree(const std::vector<std::pair<std::string, std::string>>& mods,
                      const std::string& overwrite_dir)
 {
   VfsTree tree;
-  tree.root.is_directory = true;
-  tree.file_count        = 0;
-  tree.dir_count         = 1;
-
-  addDirectoryToTree(tree, fs::path(overwrite_dir), fs::path(overwrite_dir),
-                     "Overwrite", {});
+  tree.file_count = 0;
+  tree.dir_count  = 1;
 
+  std::vector<ScanSource> sources;
+  sources.reserve(mods.size() + 1);
+  sources.push_back({overwrite_dir, "Overwrite", {}});
   for (const auto& [modName, modPath] : mods) {
-    addDirectoryToTree(tree, fs::path(modPath), fs::path(modPath), modName, {});
+    sources.push_back({modPath, modName, {}});
   }
+  addSources(tree, sources);
 
+  tree.finalize();
   return tree;
 }
 
@@ -286,99 +714,287 @@ VfsTree buildFullGameVfs(const std::string& game_dir, const std::string& data_di
                          const std::string& overwrite_dir)
 {
   VfsTree tree;
-  tree.root.is_directory = true;
-  tree.file_count        = 0;
-  tree.dir_count         = 1;
+  tree.file_count = 0;
+  tree.dir_count  = 1;
 
-  addDirectoryToTree(tree, fs::path(game_dir), fs::path(game_dir), "_base_game", {});
-  addDirectoryToTree(tree, fs::path(overwrite_dir), fs::path(overwrite_dir),
-                     "Overwrite", {});
+  std::vector<ScanSource> sources;
+  sources.reserve(mods.size() + 2);
+  sources.push_back({game_dir, "_base_game", {}});
+  sources.push_back({overwrite_dir, "Overwrite", {}});
 
   const auto dataPrefix = splitPath(data_dir);
   for (const auto& [modName, modPath] : mods) {
     // Step D requirement: no Root/ handling. Every mod file is projected under data_dir.
-    addDirectoryToTree(tree, fs::path(modPath), fs::path(modPath), modName, dataPrefix);
+    sources.push_back({modPath, modName, dataPrefix});
   }
+  addSources(tree, sources);
 
+  tree.finalize();
   return tree;
 }
 
 std::vector<CachedBaseFile> scanDataDir(const std::string& data_dir_path)
 {
-  std::vector<CachedBaseFile> cache;
-  const fs::path dataDir(data_dir_path);
+  return scanDirectory(fs::path(data_dir_path), false);
+}
+
+VfsTree buildDataDirVfs(const std::vector<CachedBaseFile>& cached_files,
+                        const std::string& data_dir,
+                        const std::vector<std::pair<std::string, std::string>>& mods,
+                        const std::string& overwrite_dir)
+{
+  // Layer 1: Base game files from cache (is_backing=true)
+  // real_path stores the relative path; FUSE handler uses openat(backing_fd, rel)
+  // Layer 2: Overwrite (higher priority, overwrites base game)
+  // Layer 3: Mods in priority order (highest priority)
+  return buildTreeFromLayers(
+      scanLayers(makeBaseLayer(cached_files), mods, overwrite_dir));
+}
+
+std::shared_ptr<const VfsLayer> scanLayer(const std::string& origin,
+                                          const std::string& root)
+{
+  auto layer        = std::make_shared<VfsLayer>();
+  layer->origin     = origin;
+  layer->root       = root;
+  layer->root_mtime = pathMtime(root);
+  layer->entries    = scanDirectory(root, true);
+  return layer;
+}
+
+bool layerIsCurrent(const VfsLayer& layer, LayerCheck check)
+{
+  if (pathMtime(layer.root) != layer.root_mtime) {
+    return false;
+  }
 
-  if (!fs::exists(dataDir)) {
-    return cache;
+  if (layer.from_archive) {
+    return true;
   }
 
-  for (auto it = fs::recursive_directory_iterator(
-           dataDir, fs::directory_options::skip_permission_denied);
-       it != fs::recursive_directory_iterator(); ++it) {
-    const auto& entry = *it;
-    std::error_code ec;
+  // small layers are cheap enough to check file by file every time
+  constexpr size_t SmallLayerEntries = 256;
+  const bool allFiles =
+      (check == LayerCheck::Files || layer.entries.size() <= SmallLayerEntries);
 
-    const fs::path rel = fs::relative(entry.path(), dataDir, ec);
-    if (ec || rel.empty()) {
+  std::string path;
+  for (const auto& cf : layer.entries) {
+    const bool inRoot = (cf.relative_path.find('/') == std::string::npos);
+    if (!cf.is_dir && !allFiles && !inRoot) {
       continue;
     }
 
-    CachedBaseFile cf;
-    cf.relative_path = rel.generic_string();
-    cf.is_dir        = entry.is_directory(ec);
+    path.assign(layer.root);
+    path.push_back('/');
+    path.append(cf.relative_path);
+    if (pathMtime(path) != cf.mtime) {
+      return false;
+    }
 
     if (!cf.is_dir) {
-      if (!entry.is_regular_file(ec)) {
-        continue;
+      std::error_code ec;
+      const auto size = fs::file_size(path, ec);
+      if (ec || size != cf.size) {
+        return false;
       }
-      cf.size  = entry.file_size(ec);
-      const auto mtime = entry.last_write_time(ec);
-      cf.mtime = ec ? std::chrono::system_clock::time_point{}
-                     : fsTimeToSystemClock(mtime);
     }
-
-    cache.push_back(std::move(cf));
   }
 
-  return cache;
+  return true;
 }
 
-VfsTree buildDataDirVfs(const std::vector<CachedBaseFile>& cached_files,
-                        const std::string& data_dir,
+std::shared_ptr<const VfsLayer> makeBaseLayer(const std::vector<CachedBaseFile>& cached_files)
+{
+  auto layer        = std::make_shared<VfsLayer>();
+  layer->origin     = "_base_game";
+  layer->is_backing = true;
+  layer->entries    = cached_files;
+  return layer;
+}
+
+VfsLayerList scanLayers(const std::shared_ptr<const VfsLayer>& base,
                         const std::vector<std::pair<std::string, std::string>>& mods,
-                        const std::string& overwrite_dir)
+                        const std::string& overwrite_dir,
+                        const VfsLayerList& previous, LayerCheck check)
 {
-  VfsTree tree;
-  tree.root.is_directory = true;
-  tree.file_count        = 0;
-  tree.dir_count         = 1;
+  std::vector<std::pair<std::string, std::string>> sources;
+  sources.reserve(mods.size() + 1);
+  sources.emplace_back("Overwrite", overwrite_dir);
+  sources.insert(sources.end(), mods.begin(), mods.end());
+
+  std::unordered_map<std::string, std::shared_ptr<const VfsLayer>> reusable;
+  for (const auto& layer : previous) {
+    if (layer != nullptr && !layer->is_backing && !layer->from_archive) {
+      reusable.emplace(layer->root, layer);
+    }
+  }
 
-  // Layer 1: Base game files from cache (is_backing=true)
-  // real_path stores the relative path; FUSE handler uses openat(backing_fd, rel)
-  for (const auto& cf : cached_files) {
-    const auto components = splitPath(cf.relative_path);
-    if (cf.is_dir) {
-      tree.root.insertDirectory(components);
-      ++tree.dir_count;
+  VfsLayerList layers(sources.size() + 1);
+  layers[0] = base;
+
+  parallelFor(sources.size(), [&](size_t i) {
+    const auto& [origin, root] = sources[i];
+
+    auto it = reusable.find(root);
+    if (it == reusable.end() || !layerIsCurrent(*it->second, check)) {
+      layers[i + 1] = scanLayer(origin, root);
+    } else if (it->second->origin != origin) {
+      // same directory under another name, copying beats walking it again
+      auto renamed    = std::make_shared<VfsLayer>(*it->second);
+      renamed->origin = origin;
+      layers[i + 1]   = std::move(renamed);
     } else {
-      tree.root.insertFile(components, cf.relative_path, cf.size, cf.mtime,
-                           "_base_game", /*is_backing=*/true);
-      ++tree.file_count;
+      layers[i + 1] = it->second;
     }
+  });
+
+  if (base == nullptr) {
+    layers.erase(layers.begin());
   }
 
-  // Layer 2: Overwrite (higher priority, overwrites base game)
-  addDirectoryToTree(tree, fs::path(overwrite_dir), fs::path(overwrite_dir),
-                     "Overwrite", {});
+  return layers;
+}
 
-  // Layer 3: Mods in priority order (highest priority)
-  for (const auto& [modName, modPath] : mods) {
-    addDirectoryToTree(tree, fs::path(modPath), fs::path(modPath), modName, {});
+VfsTree buildTreeFromLayers(const VfsLayerList& layers)
+{
+  VfsTree tree;
+  tree.file_count = 0;
+  tree.dir_count  = 1;
+
+  std::string realPath;
+  for (const auto& layer : layers) {
+    for (const auto& cf : layer->entries) {
+      insertLayerEntry(tree, *layer, cf, realPath);
+    }
   }
 
+  tree.finalize();
   return tree;
 }
 
+bool planLayerChanges(const VfsTree& tree, const VfsLayerList& before,
+                      const VfsLayerList& after,
+                      const std::vector<std::string>& extra_touched,
+                      VfsLayerPatch* patch)
+{
+  patch->touched.clear();
+  patch->inserts.clear();
+
+  std::unordered_map<const VfsLayer*, size_t> beforeIndex;
+  for (size_t i = 0; i < before.size(); ++i) {
+    beforeIndex.emplace(before[i].get(), i);
+  }
+
+  std::vector<const VfsLayer*> changed;
+  std::vector<const VfsLayer*> kept;
+  std::vector<size_t> keptPositions;
+  std::unordered_map<const VfsLayer*, bool> inAfter;
+
+  for (const auto& layer : after) {
+    inAfter.emplace(layer.get(), true);
+    auto it = beforeIndex.find(layer.get());
+    if (it == beforeIndex.end()) {
+      changed.push_back(layer.get());
+    } else {
+      kept.push_back(layer.get());
+      keptPositions.push_back(it->second);
+    }
+  }
+
+  for (const auto& layer : before) {
+    if (!inAfter.contains(layer.get())) {
+      changed.push_back(layer.get());
+    }
+  }
+
+  // kept layers whose order relative to the others changed
+  const auto inOrder = longestIncreasingRun(keptPositions);
+  for (size_t i = 0; i < kept.size(); ++i) {
+    if (!inOrder[i]) {
+      changed.push_back(kept[i]);
+    }
+  }
+
+  size_t changedEntries = 0;
+  for (const VfsLayer* layer : changed) {
+    changedEntries += layer->entries.size();
+  }
+  size_t totalEntries = 0;
+  for (const auto& layer : after) {
+    totalEntries += layer->entries.size();
+  }
+  if (changedEntries * 2 > totalEntries) {
+    // most of the tree is affected, rebuilding is cheaper
+    return false;
+  }
+
+  std::unordered_set<std::string> touched;
+  for (const VfsLayer* layer : changed) {
+    for (const auto& cf : layer->entries) {
+      touched.insert(normalizeForLookup(cf.relative_path));
+    }
+  }
+  for (const auto& path : extra_touched) {
+    touched.insert(lookupKey(path));
+  }
+  touched.erase(std::string());
+
+  if (touched.empty()) {
+    return true;
+  }
+
+  // whether the final winner for a touched path is a directory
+  std::unordered_map<std::string, bool> winnerIsDir;
+  for (const auto& layer : after) {
+    for (const auto& cf : layer->entries) {
+      std::string key = normalizeForLookup(cf.relative_path);
+      if (!touched.contains(key)) {
+        continue;
+      }
+      patch->inserts.emplace_back(layer.get(), &cf);
+      winnerIsDir.insert_or_assign(std::move(key), cf.is_dir);
+    }
+  }
+
+  for (const auto& [key, isDir] : winnerIsDir) {
+    if (!isDir) {
+      continue;
+    }
+    // a file giving way to a directory would need that directory's contents
+    // from layers that weren't touched
+    const VfsNode* node = tree.resolve(splitPath(key));
+    if (node != nullptr && !node->is_directory) {
+      patch->inserts.clear();
+      return false;
+    }
+  }
+
+  patch->touched.assign(touched.begin(), touched.end());
+  // children sort after their parents, so this clears leaves first
+  std::sort(patch->touched.begin(), patch->touched.end(), std::greater<>());
+  return true;
+}
+
+void applyLayerPatch(VfsTree& tree, const VfsLayerPatch& patch)
+{
+  for (const auto& key : patch.touched) {
+    const auto components = splitPath(key);
+    const VfsNode* node   = tree.resolve(components);
+    if (node == nullptr) {
+      continue;
+    }
+    // directories still holding untouched entries stay
+    if (!node->is_directory || node->children.empty()) {
+      tree.removeFromTree(components);
+    }
+  }
+
+  std::string realPath;
+  for (const auto& [layer, cf] : patch.inserts) {
+    insertLayerEntry(tree, *layer, *cf, realPath);
+  }
+}
+
 void injectExtraFiles(
     VfsTree& tree,
     const std::vector<std::pair<std::string, std::string>>& extra_files)
@@ -391,9 +1007,9 @@ void injectExtraFiles(
 
     std::error_code ec;
     const auto size = fs::file_size(realPath, ec);
-    tree.root.insertFile(components, realPath, ec ? 0ULL : size,
-                         std::chrono::system_clock::now(), "_profile",
-                         /*is_backing=*/false);
+    tree.insertFile(components, realPath, ec ? 0ULL : size,
+                    std::chrono::system_clock::now(), "_profile",
+                    /*is_backing=*/false);
     ++tree.file_count;
   }
 }
@@ -3,21 +3,59 @@
 
 #include <chrono>
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
-struct VfsNode;
+// Append-only pool of interned strings.  Strings are copied into large chunks
+// so interning doesn't allocate per string, and ids stay valid for the
+// lifetime of the pool.  Id 0 is always the empty string.
+class VfsStringPool
+{
+public:
+  static constexpr uint32_t npos = UINT32_MAX;
+
+  VfsStringPool();
+  VfsStringPool(VfsStringPool&&) noexcept            = default;
+  VfsStringPool& operator=(VfsStringPool&&) noexcept = default;
+  VfsStringPool(const VfsStringPool&)                = delete;
+  VfsStringPool& operator=(const VfsStringPool&)     = delete;
+
+  uint32_t intern(std::string_view s);
+
+  // id of an already interned string, npos if it was never interned
+  //
+  uint32_t find(std::string_view s) const;
+
+  std::string_view get(uint32_t id) const { return m_strings[id]; }
+  size_t size() const { return m_strings.size(); }
+
+  // estimated bytes taken by the pool, its chunks and index
+  //
+  size_t memoryUsage() const;
+
+private:
+  static constexpr size_t ChunkSize = 64 * 1024;
+
+  std::vector<std::unique_ptr<char[]>> m_chunks;
+  size_t m_chunkUsed     = ChunkSize;
+  std::vector<std::string_view> m_strings;
+  std::unordered_map<std::string_view, uint32_t> m_index;
+};
 
 struct VfsFileInfo
 {
-  std::string real_path;
-  uint64_t size = 0;
+  uint32_t real_dir  = 0;  // interned directory containing the real file
+  uint32_t real_name = 0;  // interned file name on disk
+  uint32_t origin    = 0;  // interned origin name (mod, "Overwrite", ...)
+  bool is_backing    = false;
+  bool from_archive  = false;  // stored in the BSA/BA2 archive at the real path
+  uint64_t size      = 0;
   std::chrono::system_clock::time_point mtime{};
-  std::string origin;
-  bool is_backing = false;
 };
 
 struct CachedBaseFile
@@ -28,40 +66,165 @@ struct CachedBaseFile
   bool is_dir = false;
 };
 
-struct VfsDirInfo
-{
-  std::unordered_map<std::string, std::unique_ptr<VfsNode>> children;
-  std::unordered_map<std::string, std::string> display_names;
-};
-
 struct VfsNode
 {
+  uint32_t name     = 0;  // interned display name
+  uint32_t key      = 0;  // interned normalizeForLookup(name)
   bool is_directory = true;
   VfsFileInfo file_info;
-  VfsDirInfo dir_info;
+
+  // indices of child nodes; sorted by key once the tree is finalized
+  std::vector<uint32_t> children;
+};
+
+// The merged virtual data directory.  Nodes live in a deque owned by the tree
+// and are never freed individually (removed nodes are only unlinked), so node
+// pointers stay valid until the whole tree is dropped.  Names, origins and
+// real directories are interned, so a file costs one node plus a child index.
+//
+// While a tree is being built, children are appended unsorted and found
+// through a hash index; finalize() sorts every child list and drops the index,
+// after which lookups are binary searches and live inserts keep lists sorted.
+class VfsTree
+{
+public:
+  VfsTree();
+  VfsTree(VfsTree&&) noexcept            = default;
+  VfsTree& operator=(VfsTree&&) noexcept = default;
+  VfsTree(const VfsTree&)                = delete;
+  VfsTree& operator=(const VfsTree&)     = delete;
+
+  size_t file_count = 0;
+  size_t dir_count  = 0;
+
+  const VfsNode& root() const { return m_nodes.front(); }
+  VfsNode& root() { return m_nodes.front(); }
+
+  const VfsNode& node(uint32_t index) const { return m_nodes[index]; }
+  VfsNode& node(uint32_t index) { return m_nodes[index]; }
+  size_t nodeCount() const { return m_nodes.size(); }
+
+  std::string_view name(const VfsNode& node) const { return m_strings.get(node.name); }
+  std::string_view origin(const VfsNode& node) const;
+  std::string realPath(const VfsNode& node) const;
+
+  const VfsStringPool& strings() const { return m_strings; }
+
+  const VfsNode* findChild(const VfsNode& dir, std::string_view name) const;
+  VfsNode* findChild(const VfsNode& dir, std::string_view name);
+
+  const VfsNode* resolve(const std::vector<std::string>& components) const;
+  VfsNode* resolve(const std::vector<std::string>& components);
+
+  std::vector<std::pair<std::string_view, const VfsNode*>>
+  listChildren(const VfsNode& dir) const;
 
   void insertFile(const std::vector<std::string>& components,
                   const std::string& real_path, uint64_t size,
                   std::chrono::system_clock::time_point mtime,
-                  const std::string& origin, bool is_backing = false);
+                  const std::string& origin, bool is_backing = false,
+                  bool from_archive = false);
 
   void insertDirectory(const std::vector<std::string>& components);
 
-  const VfsNode* resolve(const std::vector<std::string>& components) const;
+  bool removeFromTree(const std::vector<std::string>& components);
 
-  std::vector<std::pair<std::string, const VfsNode*>> listChildren() const;
+  // replaces the file information of an existing file node in place
+  //
+  void setFileInfo(VfsNode& node, const std::string& real_path, uint64_t size,
+                   std::chrono::system_clock::time_point mtime,
+                   const std::string& origin, bool is_backing = false,
+                   bool from_archive = false);
 
-  bool removeFromTree(const std::vector<std::string>& components);
+  // same as above for a file node, as long as `real_path` and `origin` only
+  // need strings that are interned already; returns false without touching
+  // the node otherwise.  Only writes the node itself, so it may run alongside
+  // readers of other nodes.
+  //
+  bool updateFileInfo(VfsNode& node, std::string_view real_path, uint64_t size,
+                      std::chrono::system_clock::time_point mtime,
+                      std::string_view origin);
+
+  // sorts all child lists and releases the build-time index
+  //
+  void finalize();
+
+  bool isFinalized() const { return m_finalized; }
+
+  // estimated bytes taken by the nodes, their child lists and the strings
+  //
+  size_t memoryUsage() const;
+
+private:
+  struct BuildKey
+  {
+    const VfsNode* parent;
+    uint32_t key;
+
+    bool operator==(const BuildKey&) const = default;
+  };
+
+  struct BuildKeyHash
+  {
+    size_t operator()(const BuildKey& k) const noexcept
+    {
+      return std::hash<const void*>{}(k.parent) ^ (static_cast<size_t>(k.key) * 0x9E3779B97F4A7C15ull);
+    }
+  };
+
+  uint32_t newNode(uint32_t name, uint32_t key, bool isDirectory);
+
+  // finds the position of `key` in a finalized child list
+  //
+  std::vector<uint32_t>::const_iterator lowerBound(const VfsNode& dir,
+                                                   std::string_view key) const;
+
+  uint32_t findChildIndex(const VfsNode& dir, std::string_view key) const;
+
+  // links `child` under `dir`, replacing any existing child with the same key
+  //
+  void setChild(VfsNode& dir, uint32_t child);
+
+  void unlinkChild(VfsNode& dir, uint32_t child);
+
+  bool removeRecursive(VfsNode& dir, const std::vector<std::string>& components,
+                       size_t index);
+
+  std::deque<VfsNode> m_nodes;
+  VfsStringPool m_strings;
+  bool m_finalized = false;
+  std::unordered_map<BuildKey, uint32_t, BuildKeyHash> m_buildIndex;
 };
 
-struct VfsTree
+// One priority layer of the merged data directory: the scanned contents of the
+// base game, the overwrite directory or a single mod.  Layers are immutable
+// once scanned and are shared between successive builds, so a rebuild only
+// walks directories that changed.
+struct VfsLayer
 {
-  VfsNode root;
-  size_t file_count = 0;
-  size_t dir_count  = 0;
+  std::string origin;
+  std::string root;  // real directory, empty for backing (base game) layers
+  bool is_backing = false;
+  std::chrono::system_clock::time_point root_mtime{};
+  std::vector<CachedBaseFile> entries;
+
+  // the contents of the archive at `root`, see ArchiveFiles; only the VFS
+  // builds these, they're neither cached nor handed to the helper
+  bool from_archive = false;
+};
+
+using VfsLayerList = std::vector<std::shared_ptr<const VfsLayer>>;
+
+// The part of a layer stack change that has to be re-resolved: every path
+// provided by an added, removed or reordered layer, and the layer entries
+// that now provide those paths, in priority order.
+struct VfsLayerPatch
+{
+  std::vector<std::string> touched;
+  std::vector<std::pair<const VfsLayer*, const CachedBaseFile*>> inserts;
 };
 
-std::string normalizeForLookup(const std::string& path);
+std::string normalizeForLookup(std::string_view path);
 
 VfsTree buildVfsTree(const std::vector<std::pair<std::string, std::string>>& mods,
                      const std::string& overwrite_dir);
@@ -77,6 +240,57 @@ VfsTree buildDataDirVfs(const std::vector<CachedBaseFile>& cached_files,
                         const std::vector<std::pair<std::string, std::string>>& mods,
                         const std::string& overwrite_dir);
 
+std::shared_ptr<const VfsLayer> scanLayer(const std::string& origin,
+                                          const std::string& root);
+
+// How closely layerIsCurrent() looks at a layer.
+//
+// Adding, removing or renaming anything bumps the mtime of the containing
+// directory, but rewriting a file in place (a tool saving a plugin, patching a
+// texture) only changes the file itself.  A quick check compares the mtime of
+// every directory, and the size and mtime of the files right in the root,
+// which is where plugins and archives are, and of every file of small layers.
+// A full check compares every file; it's only for when the user asked for a
+// refresh, and for the indexer's start, whose word replaces the quick check
+// until the next start.
+enum class LayerCheck
+{
+  Quick,
+  Files
+};
+
+// whether the files of `layer` are still what was scanned; archive layers are
+// valid while the archive is unchanged
+bool layerIsCurrent(const VfsLayer& layer, LayerCheck check = LayerCheck::Quick);
+
+std::shared_ptr<const VfsLayer> makeBaseLayer(const std::vector<CachedBaseFile>& cached_files);
+
+// Builds the layer stack for the data directory: `base` first, then the
+// overwrite directory and the mods in priority order.  Directories are walked
+// in parallel; layers from `previous` are reused while layerIsCurrent() with
+// `check` says nothing changed since they were scanned.
+VfsLayerList scanLayers(const std::shared_ptr<const VfsLayer>& base,
+                        const std::vector<std::pair<std::string, std::string>>& mods,
+                        const std::string& overwrite_dir,
+                        const VfsLayerList& previous = {},
+                        LayerCheck check             = LayerCheck::Quick);
+
+VfsTree buildTreeFromLayers(const VfsLayerList& layers);
+
+// Works out how to move `tree`, built from `before`, to `after` without a full
+// rebuild.  `extra_touched` are additional paths to re-resolve (e.g. injected
+// files that may have gone away).  Returns false when the change isn't worth
+// or can't be applied incrementally, like a file giving way to a directory
+// whose contents come from untouched layers.
+bool planLayerChanges(const VfsTree& tree, const VfsLayerList& before,
+                      const VfsLayerList& after,
+                      const std::vector<std::string>& extra_touched,
+                      VfsLayerPatch* patch);
+
+// Applies a patch from planLayerChanges(); the layers it refers to must still
+// be alive.
+void applyLayerPatch(VfsTree& tree, const VfsLayerPatch& patch);
+
 // Inject individual file mappings into an already-built VFS tree.
 // Each entry is (relative_vfs_path, absolute_real_path).  Inserted with
 // highest priority (overwrites any existing entry at the same path).
@@ -7,10 +7,52 @@
 using namespace MOShared;
 
 ViewMarkingScrollBar::ViewMarkingScrollBar(QTreeView* view, int role)
-    : QScrollBar(view), m_view(view), m_role(role)
+    : QScrollBar(view), m_view(view), m_role(role), m_markersValid(false)
 {
   // not implemented for horizontal sliders
   Q_ASSERT(this->orientation() == Qt::Vertical);
+
+  // collapsed rows don't have a marker
+  connect(m_view, &QTreeView::expanded, this, &ViewMarkingScrollBar::invalidateMarkers);
+  connect(m_view, &QTreeView::collapsed, this,
+          &ViewMarkingScrollBar::invalidateMarkers);
+}
+
+void ViewMarkingScrollBar::invalidateMarkers()
+{
+  m_markersValid = false;
+}
+
+void ViewMarkingScrollBar::watchModel(QAbstractItemModel* model)
+{
+  if (m_model != nullptr) {
+    disconnect(m_model, nullptr, this, nullptr);
+  }
+
+  m_model = model;
+  invalidateMarkers();
+
+  if (model == nullptr) {
+    return;
+  }
+
+  connect(model, &QAbstractItemModel::dataChanged, this,
+          [this](auto&&, auto&&, const QList<int>& roles) {
+            if (roles.isEmpty() || roles.contains(m_role)) {
+              invalidateMarkers();
+            }
+          });
+
+  connect(model, &QAbstractItemModel::modelReset, this,
+          &ViewMarkingScrollBar::invalidateMarkers);
+  connect(model, &QAbstractItemModel::layoutChanged, this,
+          &ViewMarkingScrollBar::invalidateMarkers);
+  connect(model, &QAbstractItemModel::rowsInserted, this,
+          &ViewMarkingScrollBar::invalidateMarkers);
+  connect(model, &QAbstractItemModel::rowsRemoved, this,
+          &ViewMarkingScrollBar::invalidateMarkers);
+  connect(model, &QAbstractItemModel::rowsMoved, this,
+          &ViewMarkingScrollBar::invalidateMarkers);
 }
 
 QColor ViewMarkingScrollBar::color(const QModelIndex& index) const
@@ -22,6 +64,34 @@ QColor ViewMarkingScrollBar::color(const QModelIndex& index) const
   return QColor();
 }
 
+void ViewMarkingScrollBar::drawMarkers(const QSize& size, int width)
+{
+  const qreal ratio = devicePixelRatioF();
+
+  m_markers = QPixmap(size * ratio);
+  m_markers.setDevicePixelRatio(ratio);
+  m_markers.fill(Qt::transparent);
+
+  QPainter painter(&m_markers);
+
+  auto indices = visibleIndex(m_view, 0);
+
+  painter.translate(QPoint(0, 3));
+  qreal scale =
+      static_cast<qreal>(size.height() - 3) / static_cast<qreal>(indices.size());
+
+  for (int i = 0; i < indices.size(); ++i) {
+    QColor color = this->color(indices[i]);
+    if (color.isValid()) {
+      painter.setPen(color);
+      painter.setBrush(color);
+      painter.drawRect(QRect(2, i * scale - 2, width - 5, 3));
+    }
+  }
+
+  m_markersValid = true;
+}
+
 void ViewMarkingScrollBar::paintEvent(QPaintEvent* event)
 {
   if (m_view->model() == nullptr) {
@@ -29,28 +99,26 @@ void ViewMarkingScrollBar::paintEvent(QPaintEvent* event)
   }
   QScrollBar::paintEvent(event);
 
+  if (m_view->model() != m_model) {
+    watchModel(m_view->model());
+  }
+
   QStyleOptionSlider styleOption;
   initStyleOption(&styleOption);
 
-  QPainter painter(this);
-
   QRect handleRect = style()->subControlRect(QStyle::CC_ScrollBar, &styleOption,
                                              QStyle::SC_ScrollBarSlider, this);
   QRect innerRect  = style()->subControlRect(QStyle::CC_ScrollBar, &styleOption,
                                              QStyle::SC_ScrollBarGroove, this);
 
-  auto indices = visibleIndex(m_view, 0);
-
-  painter.translate(innerRect.topLeft() + QPoint(0, 3));
-  qreal scale =
-      static_cast<qreal>(innerRect.height() - 3) / static_cast<qreal>(indices.size());
+  // the pixmap is as large as the groove, the width of the handle follows it
+  const bool resized = m_markers.deviceIndependentSize().toSize() != innerRect.size() ||
+                       m_markers.devicePixelRatio() != devicePixelRatioF();
 
-  for (int i = 0; i < indices.size(); ++i) {
-    QColor color = this->color(indices[i]);
-    if (color.isValid()) {
-      painter.setPen(color);
-      painter.setBrush(color);
-      painter.drawRect(QRect(2, i * scale - 2, handleRect.width() - 5, 3));
-    }
+  if (!m_markersValid || resized) {
+    drawMarkers(innerRect.size(), handleRect.width());
   }
+
+  QPainter painter(this);
+  painter.drawPixmap(innerRect.topLeft(), m_markers);
 }
@@ -1,6 +1,8 @@
 #ifndef VIEWMARKINGSCROLLBAR_H
 #define VIEWMARKINGSCROLLBAR_H
 
+#include <QPixmap>
+#include <QPointer>
 #include <QScrollBar>
 #include <QTreeView>
 
@@ -9,6 +11,11 @@ class ViewMarkingScrollBar : public QScrollBar
 public:
   ViewMarkingScrollBar(QTreeView* view, int role);
 
+  // redraws the markers on the next paint, for colors that don't come from the
+  // model; changes of the model itself are picked up on their own
+  //
+  void invalidateMarkers();
+
 protected:
   void paintEvent(QPaintEvent* event) override;
 
@@ -19,6 +26,17 @@ protected:
 private:
   QTreeView* m_view;
   int m_role;
+
+  // the markers as drawn last, asking the model for the color of every row on
+  // each paint makes scrolling large lists slow
+  QPixmap m_markers;
+  bool m_markersValid;
+
+  // the model the scrollbar listens to, the view may switch models
+  QPointer<QAbstractItemModel> m_model;
+
+  void watchModel(QAbstractItemModel* model);
+  void drawMarkers(const QSize& size, int width);
 };
 
 #endif  // VIEWMARKINGSCROLLBAR_H
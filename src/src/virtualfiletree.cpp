@@ -15,9 +15,11 @@ public:
    *
    */
   VirtualFileTreeImpl(std::shared_ptr<const IFileTree> parent,
-                      const DirectoryEntry* dir)
+                      const DirectoryEntry* root, const DirectoryEntry* dir,
+                      std::wstring path, Guard guard)
       : FileTreeEntry(parent, parent ? QString::fromStdWString(dir->getName()) : ""),
-        VirtualFileTree(), m_dirEntry(dir)
+        VirtualFileTree(), m_root(root), m_dirEntry(dir), m_path(std::move(path)),
+        m_guard(guard)
   {}
 
 protected:
@@ -51,13 +53,47 @@ protected:
   bool doPopulate(std::shared_ptr<const IFileTree> parent,
                   std::vector<std::shared_ptr<FileTreeEntry>>& entries) const override
   {
-    for (auto* subdirEntry : m_dirEntry->getSubDirectories()) {
-      entries.push_back(std::make_shared<VirtualFileTreeImpl>(parent, subdirEntry));
+    std::shared_lock<std::shared_mutex> lock;
+    const DirectoryEntry* dirEntry = m_dirEntry;
+    Guard guard                    = m_guard;
+
+    if (m_guard.access != nullptr) {
+      lock = std::shared_lock(*m_guard.access);
+
+      const auto patches = m_guard.patches->load(std::memory_order_acquire);
+      if (patches != m_guard.made) {
+        // the structure was patched since this node was made, the directory
+        // may be gone, so it's looked up again; the lookup doesn't create
+        // anything
+        dirEntry = const_cast<DirectoryEntry*>(m_root)->findDirectoryByPath(m_path);
+        if (dirEntry == nullptr) {
+          return true;
+        }
+
+        guard.made = patches;
+      }
     }
-    for (auto& file : m_dirEntry->getFiles()) {
-      entries.push_back(
-          createFileEntry(parent, QString::fromStdWString(file->getName())));
+
+    // only this directory is read, subdirectories are populated when they're
+    // accessed; the files are visited in place rather than copied out of the
+    // register first
+    entries.reserve(dirEntry->getSubDirectories().size() + dirEntry->fileCount());
+
+    for (auto* subdirEntry : dirEntry->getSubDirectories()) {
+      std::wstring path = m_path;
+      if (!path.empty()) {
+        path += L'\\';
+      }
+      path += subdirEntry->getName();
+
+      entries.push_back(std::make_shared<VirtualFileTreeImpl>(
+          parent, m_root, subdirEntry, std::move(path), guard));
     }
+    dirEntry->forEachFile([&](const FileEntry& file) {
+      entries.push_back(
+          createFileEntry(parent, QString::fromStdWString(file.getName())));
+      return true;
+    });
 
     // Vector is already sorted:
     return true;
@@ -65,18 +101,23 @@ protected:
 
   std::shared_ptr<IFileTree> doClone() const
   {
-    return std::make_shared<VirtualFileTreeImpl>(nullptr, m_dirEntry);
+    return std::make_shared<VirtualFileTreeImpl>(nullptr, m_root, m_dirEntry, m_path,
+                                                 m_guard);
   }
 
 private:
+  const DirectoryEntry* m_root;
   const DirectoryEntry* m_dirEntry;
+  std::wstring m_path;
+  Guard m_guard;
 };
 
 /**
  *
  */
 std::shared_ptr<const VirtualFileTree>
-VirtualFileTree::makeTree(const DirectoryEntry* rootEntry)
+VirtualFileTree::makeTree(const DirectoryEntry* rootEntry, Guard guard)
 {
-  return std::make_shared<VirtualFileTreeImpl>(nullptr, rootEntry);
+  return std::make_shared<VirtualFileTreeImpl>(nullptr, rootEntry, rootEntry, L"",
+                                               guard);
 }
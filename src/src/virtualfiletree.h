@@ -22,6 +22,10 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QDir>
 
+#include <atomic>
+#include <cstdint>
+#include <shared_mutex>
+
 #include "ifiletree.h"
 
 namespace MOShared
@@ -41,15 +45,31 @@ class DirectoryEntry;
 class VirtualFileTree : public MOBase::IFileTree
 {
 public:
+  /**
+   * @brief Guards a tree over a structure that is patched in place.
+   *
+   * Subtrees are populated under a shared lock of `access`. Once `patches`
+   * moved on from `made`, the directories the tree points to may be gone, so
+   * a subtree populated after that looks its directory up again by path from
+   * the root, which is patched in place and stays.
+   */
+  struct Guard
+  {
+    std::shared_mutex* access                 = nullptr;
+    const std::atomic<std::uint64_t>* patches = nullptr;
+    std::uint64_t made                        = 0;
+  };
+
   /**
    * @brief Create a new file tree representing the given VFS directory.
    *
    * @param root Root directory.
+   * @param guard Guard of the structure, none if it doesn't change.
    *
    * @return a file tree representing the VFS directory.
    */
   static std::shared_ptr<const VirtualFileTree>
-  makeTree(const MOShared::DirectoryEntry* root);
+  makeTree(const MOShared::DirectoryEntry* root, Guard guard = {});
 
 protected:
   using IFileTree::IFileTree;
@@ -1,13 +1,19 @@
 #include "wineprefix.h"
+#include "dircopy.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
 
 #include <QDateTime>
 #include <QDir>
 #include <QDirIterator>
 #include <QFile>
 #include <QFileInfo>
-#include <QTextStream>
 #include <log.h>
 #include <uibase/filesystemutilities.h>
+#include <uibase/safewritefile.h>
 
 namespace
 {
@@ -15,34 +21,100 @@ constexpr const char* BackupSavesUpper = ".mo2linux_backup_Saves";
 constexpr const char* BackupSavesLower = ".mo2linux_backup_saves";
 constexpr const char* BackupIniSuffix  = ".mo2linux_backup";
 
-bool copyFileWithParents(const QString& source, const QString& destination)
+// How transferFile() may put a file in place.
+enum class Transfer
+{
+  // an independent copy, a reflink where the filesystem supports it
+  Copy,
+
+  // a hard link is fine as well; used for saves deployed into the prefix,
+  // which are removed again and synced back after the game exits
+  Link,
+
+  // the source isn't needed anymore and can be renamed
+  Move,
+};
+
+// Whether `destination` is `source` or has the same size and modification
+// time, which transferFile() preserves. Like rsync's quick check, contents
+// aren't hashed: games always write a changed file anew.
+bool isUpToDate(const QString& source, const QString& destination)
 {
-  const QFileInfo destinationInfo(destination);
-  if (!QDir().mkpath(destinationInfo.dir().absolutePath())) {
+  struct stat s;
+  struct stat d;
+  if (stat(QFile::encodeName(source).constData(), &s) != 0 ||
+      stat(QFile::encodeName(destination).constData(), &d) != 0) {
     return false;
   }
 
-  if (QFile::exists(destination) && !QFile::remove(destination)) {
+  if (s.st_dev == d.st_dev && s.st_ino == d.st_ino) {
+    return true;
+  }
+
+  return s.st_size == d.st_size && s.st_mtim.tv_sec == d.st_mtim.tv_sec &&
+         s.st_mtim.tv_nsec == d.st_mtim.tv_nsec;
+}
+
+// Puts `source` at `destination`, replacing it and creating its parents.
+bool transferFile(const QString& source, const QString& destination, Transfer how)
+{
+  if (!QDir().mkpath(QFileInfo(destination).dir().absolutePath())) {
+    return false;
+  }
+
+  const QByteArray src = QFile::encodeName(source);
+  const QByteArray dst = QFile::encodeName(destination);
+
+  // fails across filesystems, such as a prefix on another drive
+  if (how == Transfer::Move && rename(src.constData(), dst.constData()) == 0) {
+    return true;
+  }
+
+  if (unlink(dst.constData()) != 0 && errno != ENOENT) {
     return false;
   }
 
-  return QFile::copy(source, destination);
+  if (how == Transfer::Link && link(src.constData(), dst.constData()) == 0) {
+    return true;
+  }
+
+  return cloneFile(source, destination);
 }
 
-bool copyTreeContents(const QString& sourceRoot, const QString& destinationRoot)
+// Brings the files below `sourceRoot` to `destinationRoot`, skipping the ones
+// that are up to date there. Files only in the destination are kept.
+bool syncTreeContents(const QString& sourceRoot, const QString& destinationRoot,
+                      Transfer how)
 {
+  // listed first, Transfer::Move takes files out of the tree
+  QStringList sources;
   QDirIterator it(sourceRoot, QDir::Files, QDirIterator::Subdirectories);
-
   while (it.hasNext()) {
-    const QString source = it.next();
-    const QString relativePath = QDir(sourceRoot).relativeFilePath(source);
-    const QString destination = QDir(destinationRoot).filePath(relativePath);
+    sources.append(it.next());
+  }
 
-    if (!copyFileWithParents(source, destination)) {
+  const QDir sourceDir(sourceRoot);
+  const QDir destinationDir(destinationRoot);
+  int transferred = 0;
+
+  for (const QString& source : sources) {
+    const QString destination =
+        destinationDir.filePath(sourceDir.relativeFilePath(source));
+
+    if (isUpToDate(source, destination)) {
+      continue;
+    }
+
+    if (!transferFile(source, destination, how)) {
       return false;
     }
+
+    ++transferred;
   }
 
+  MOBase::log::debug("Synced {} of {} files from '{}' to '{}'", transferred,
+                     sources.size(), sourceRoot, destinationRoot);
+
   return true;
 }
 
@@ -141,30 +213,28 @@ bool WinePrefix::deployPlugins(const QStringList& plugins, const QString& dataDi
     return false;
   }
 
-  QFile pluginsFile(QDir(pluginsDir).filePath("Plugins.txt"));
-  if (!pluginsFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
-    return false;
-  }
-
-  QTextStream pluginsStream(&pluginsFile);
+  QByteArray pluginsData;
+  QByteArray loadOrderData;
   for (const QString& plugin : plugins) {
-    pluginsStream << plugin << "\r\n";
-  }
-  pluginsFile.close();
-
-  QFile loadOrderFile(QDir(pluginsDir).filePath("loadorder.txt"));
-  if (!loadOrderFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
-    return false;
-  }
+    pluginsData += plugin.toUtf8() + "\r\n";
 
-  QTextStream loadOrderStream(&loadOrderFile);
-  for (const QString& plugin : plugins) {
     QString line = plugin;
     if (line.startsWith('*')) {
       line.remove(0, 1);
     }
 
-    loadOrderStream << line << "\r\n";
+    loadOrderData += line.toUtf8() + "\r\n";
+  }
+
+  // unchanged between launches most of the time, the files and their times
+  // are kept as they are then
+  try {
+    MOBase::writeFileIfDifferent(QDir(pluginsDir).filePath("Plugins.txt"), pluginsData);
+    MOBase::writeFileIfDifferent(QDir(pluginsDir).filePath("loadorder.txt"),
+                                 loadOrderData);
+  } catch (const std::exception& e) {
+    MOBase::log::warn("Failed to deploy plugins to '{}': {}", pluginsDir, e.what());
+    return false;
   }
 
   return true;
@@ -204,7 +274,7 @@ bool WinePrefix::deployProfileIni(const QString& sourceIniPath,
     }
   }
 
-  return copyFileWithParents(iniInfo.absoluteFilePath(), destination);
+  return transferFile(iniInfo.absoluteFilePath(), destination, Transfer::Copy);
 }
 
 bool WinePrefix::deployProfileSaves(const QString& profileSaveDir, const QString& gameName,
@@ -251,7 +321,7 @@ bool WinePrefix::deployProfileSaves(const QString& profileSaveDir, const QString
     return true;
   }
 
-  return copyTreeContents(profileSaveDir, destinationSavesDirUpper);
+  return syncTreeContents(profileSaveDir, destinationSavesDirUpper, Transfer::Link);
 }
 
 bool WinePrefix::syncSavesBack(const QString& profileSaveDir, const QString& gameName,
@@ -281,7 +351,8 @@ bool WinePrefix::syncSavesBack(const QString& profileSaveDir, const QString& gam
     return false;
   }
 
-  const bool copied = copyTreeContents(sourceSavesDir, profileSaveDir);
+  // the prefix's saves are removed right after, so they're moved when possible
+  const bool copied = syncTreeContents(sourceSavesDir, profileSaveDir, Transfer::Move);
   if (!copied) {
     MOBase::log::warn("Failed syncing saves from '{}' to '{}'", sourceSavesDir,
                       profileSaveDir);
@@ -379,8 +450,10 @@ bool WinePrefix::syncProfileInisBack(
       continue;
     }
 
-    // Sync the game's version back to the profile.
-    if (!copyFileWithParents(newestVariant, profileIniPath)) {
+    // Sync the game's version back to the profile unless it didn't change,
+    // all the variants are removed below so it can be moved.
+    if (!isUpToDate(newestVariant, profileIniPath) &&
+        !transferFile(newestVariant, profileIniPath, Transfer::Move)) {
       allCopied = false;
     }
 
@@ -17,7 +17,8 @@ public:
   QString myGamesPath() const;    // .../Documents/My Games
   QString appdataLocal() const;   // .../AppData/Local
 
-  // Deploy profile files into prefix
+  // Deploy profile files into prefix; saves are hard linked or reflinked
+  // where possible and files that are already up to date are skipped
   bool deployPlugins(const QStringList& plugins, const QString& dataDir) const;
   bool deployProfileIni(const QString& sourceIniPath,
                         const QString& targetIniPath) const;
@@ -25,7 +26,7 @@ public:
                           const QString& saveRelativePath,
                           bool clearDestination) const;
 
-  // Sync saves back from prefix to profile
+  // Sync saves back from prefix to profile, only the files that changed
   bool syncSavesBack(const QString& profileSaveDir, const QString& gameName,
                      const QString& saveRelativePath) const;
   bool syncProfileInisBack(